@@ -86,4 +86,34 @@
         }                                       \
     } while (0)
 
+/* Opcode dispatch.  The cores normally decode opcodes with a plain
+   `switch'.  If configured with --enable-computed-goto and the compiler
+   supports taking the address of a label (GCC, clang), they jump through a
+   table of label addresses instead.  Each core provides its own
+   OPCODE_DISPATCH_TABLE listing the handler label of all 256 opcodes.  */
+#if defined(FEATURE_CPU_COMPUTED_GOTO) && defined(__GNUC__)
+
+#define OPCODE_DISPATCH_BEGIN(op)                                 \
+    {                                                             \
+        static const void *const opcode_dispatch_table[0x100] = { \
+            OPCODE_DISPATCH_TABLE                                 \
+        };                                                        \
+        goto *opcode_dispatch_table[(op) & 0xff];                 \
+    }                                                             \
+    {
+#define OPCODE_CASE(op)         opcode_##op:
+#define OPCODE_DEFAULT          opcode_default:
+#define OPCODE_BREAK            goto opcode_dispatch_done
+#define OPCODE_DISPATCH_END     } opcode_dispatch_done: ;
+
+#else
+
+#define OPCODE_DISPATCH_BEGIN(op)       switch (op) {
+#define OPCODE_CASE(op)                 case op:
+#define OPCODE_DEFAULT                  default:
+#define OPCODE_BREAK                    break
+#define OPCODE_DISPATCH_END             }
+
+#endif
+
 #endif
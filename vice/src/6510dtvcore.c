@@ -52,8 +52,77 @@
 #endif
 #endif
 
+#include "6510core.h"
 #include "traps.h"
 
+/* Handler labels for OPCODE_DISPATCH_BEGIN(), see 6510core.h.  */
+#define OPCODE_DISPATCH_TABLE                                                 \
+    &&opcode_0x00, &&opcode_0x01, &&opcode_0x02, &&opcode_0x03,               \
+    &&opcode_0x04, &&opcode_0x05, &&opcode_0x06, &&opcode_0x07,               \
+    &&opcode_0x08, &&opcode_0x09, &&opcode_0x0a, &&opcode_0x0b,               \
+    &&opcode_0x0c, &&opcode_0x0d, &&opcode_0x0e, &&opcode_0x0f,               \
+    &&opcode_0x10, &&opcode_0x11, &&opcode_0x12, &&opcode_0x13,               \
+    &&opcode_0x14, &&opcode_0x15, &&opcode_0x16, &&opcode_0x17,               \
+    &&opcode_0x18, &&opcode_0x19, &&opcode_0x1a, &&opcode_0x1b,               \
+    &&opcode_0x1c, &&opcode_0x1d, &&opcode_0x1e, &&opcode_0x1f,               \
+    &&opcode_0x20, &&opcode_0x21, &&opcode_0x22, &&opcode_0x23,               \
+    &&opcode_0x24, &&opcode_0x25, &&opcode_0x26, &&opcode_0x27,               \
+    &&opcode_0x28, &&opcode_0x29, &&opcode_0x2a, &&opcode_0x2b,               \
+    &&opcode_0x2c, &&opcode_0x2d, &&opcode_0x2e, &&opcode_0x2f,               \
+    &&opcode_0x30, &&opcode_0x31, &&opcode_0x32, &&opcode_0x33,               \
+    &&opcode_0x34, &&opcode_0x35, &&opcode_0x36, &&opcode_0x37,               \
+    &&opcode_0x38, &&opcode_0x39, &&opcode_0x3a, &&opcode_0x3b,               \
+    &&opcode_0x3c, &&opcode_0x3d, &&opcode_0x3e, &&opcode_0x3f,               \
+    &&opcode_0x40, &&opcode_0x41, &&opcode_0x42, &&opcode_0x43,               \
+    &&opcode_0x44, &&opcode_0x45, &&opcode_0x46, &&opcode_0x47,               \
+    &&opcode_0x48, &&opcode_0x49, &&opcode_0x4a, &&opcode_0x4b,               \
+    &&opcode_0x4c, &&opcode_0x4d, &&opcode_0x4e, &&opcode_0x4f,               \
+    &&opcode_0x50, &&opcode_0x51, &&opcode_0x52, &&opcode_0x53,               \
+    &&opcode_0x54, &&opcode_0x55, &&opcode_0x56, &&opcode_0x57,               \
+    &&opcode_0x58, &&opcode_0x59, &&opcode_0x5a, &&opcode_0x5b,               \
+    &&opcode_0x5c, &&opcode_0x5d, &&opcode_0x5e, &&opcode_0x5f,               \
+    &&opcode_0x60, &&opcode_0x61, &&opcode_0x62, &&opcode_0x63,               \
+    &&opcode_0x64, &&opcode_0x65, &&opcode_0x66, &&opcode_0x67,               \
+    &&opcode_0x68, &&opcode_0x69, &&opcode_0x6a, &&opcode_0x6b,               \
+    &&opcode_0x6c, &&opcode_0x6d, &&opcode_0x6e, &&opcode_0x6f,               \
+    &&opcode_0x70, &&opcode_0x71, &&opcode_0x72, &&opcode_0x73,               \
+    &&opcode_0x74, &&opcode_0x75, &&opcode_0x76, &&opcode_0x77,               \
+    &&opcode_0x78, &&opcode_0x79, &&opcode_0x7a, &&opcode_0x7b,               \
+    &&opcode_0x7c, &&opcode_0x7d, &&opcode_0x7e, &&opcode_0x7f,               \
+    &&opcode_0x80, &&opcode_0x81, &&opcode_0x82, &&opcode_0x83,               \
+    &&opcode_0x84, &&opcode_0x85, &&opcode_0x86, &&opcode_0x87,               \
+    &&opcode_0x88, &&opcode_0x89, &&opcode_0x8a, &&opcode_0x8b,               \
+    &&opcode_0x8c, &&opcode_0x8d, &&opcode_0x8e, &&opcode_0x8f,               \
+    &&opcode_0x90, &&opcode_0x91, &&opcode_0x92, &&opcode_0x93,               \
+    &&opcode_0x94, &&opcode_0x95, &&opcode_0x96, &&opcode_0x97,               \
+    &&opcode_0x98, &&opcode_0x99, &&opcode_0x9a, &&opcode_0x9b,               \
+    &&opcode_0x9c, &&opcode_0x9d, &&opcode_0x9e, &&opcode_0x9f,               \
+    &&opcode_0xa0, &&opcode_0xa1, &&opcode_0xa2, &&opcode_0xa3,               \
+    &&opcode_0xa4, &&opcode_0xa5, &&opcode_0xa6, &&opcode_0xa7,               \
+    &&opcode_0xa8, &&opcode_0xa9, &&opcode_0xaa, &&opcode_0xab,               \
+    &&opcode_0xac, &&opcode_0xad, &&opcode_0xae, &&opcode_0xaf,               \
+    &&opcode_0xb0, &&opcode_0xb1, &&opcode_0xb2, &&opcode_0xb3,               \
+    &&opcode_0xb4, &&opcode_0xb5, &&opcode_0xb6, &&opcode_0xb7,               \
+    &&opcode_0xb8, &&opcode_0xb9, &&opcode_0xba, &&opcode_0xbb,               \
+    &&opcode_0xbc, &&opcode_0xbd, &&opcode_0xbe, &&opcode_0xbf,               \
+    &&opcode_0xc0, &&opcode_0xc1, &&opcode_0xc2, &&opcode_0xc3,               \
+    &&opcode_0xc4, &&opcode_0xc5, &&opcode_0xc6, &&opcode_0xc7,               \
+    &&opcode_0xc8, &&opcode_0xc9, &&opcode_0xca, &&opcode_0xcb,               \
+    &&opcode_0xcc, &&opcode_0xcd, &&opcode_0xce, &&opcode_0xcf,               \
+    &&opcode_0xd0, &&opcode_0xd1, &&opcode_0xd2, &&opcode_0xd3,               \
+    &&opcode_0xd4, &&opcode_0xd5, &&opcode_0xd6, &&opcode_0xd7,               \
+    &&opcode_0xd8, &&opcode_0xd9, &&opcode_0xda, &&opcode_0xdb,               \
+    &&opcode_0xdc, &&opcode_0xdd, &&opcode_0xde, &&opcode_0xdf,               \
+    &&opcode_0xe0, &&opcode_0xe1, &&opcode_0xe2, &&opcode_0xe3,               \
+    &&opcode_0xe4, &&opcode_0xe5, &&opcode_0xe6, &&opcode_0xe7,               \
+    &&opcode_0xe8, &&opcode_0xe9, &&opcode_0xea, &&opcode_0xeb,               \
+    &&opcode_0xec, &&opcode_0xed, &&opcode_0xee, &&opcode_0xef,               \
+    &&opcode_0xf0, &&opcode_0xf1, &&opcode_0xf2, &&opcode_0xf3,               \
+    &&opcode_0xf4, &&opcode_0xf5, &&opcode_0xf6, &&opcode_0xf7,               \
+    &&opcode_0xf8, &&opcode_0xf9, &&opcode_0xfa, &&opcode_0xfb,               \
+    &&opcode_0xfc, &&opcode_0xfd, &&opcode_0xfe, &&opcode_0xff
+
+#include "fuzz.h"
 #include "profiler.h"
 
 #ifndef C64DTV
@@ -103,29 +172,26 @@
         }                          \
     } while (0)
 
-#define LOCAL_SET_CARRY(val)   \
-    do {                       \
-        if (val) {             \
-            reg_p |= P_CARRY;  \
-        } else {               \
-            reg_p &= ~P_CARRY; \
-        }                      \
-    } while (0)
+/* Like N and Z, the carry is kept in its own variable `flag_c' (0 or
+   P_CARRY) and only merged into the status when it is read as a whole.
+   The P_CARRY bit of `reg_p' is always 0 then.  */
+#define LOCAL_SET_CARRY(val)     (flag_c = (val) ? P_CARRY : 0)
 
 #define LOCAL_SET_SIGN(val)      (flag_n = (val) ? 0x80 : 0)
 #define LOCAL_SET_ZERO(val)      (flag_z = !(val))
-#define LOCAL_SET_STATUS(val)    (reg_p = ((val) & ~(P_ZERO | P_SIGN)), \
-                                  LOCAL_SET_ZERO((val) & P_ZERO),       \
+#define LOCAL_SET_STATUS(val)    (reg_p = ((val) & ~(P_ZERO | P_SIGN | P_CARRY)), \
+                                  flag_c = (val) & P_CARRY,                       \
+                                  LOCAL_SET_ZERO((val) & P_ZERO),                 \
                                   flag_n = (val))
 
 #define LOCAL_OVERFLOW()         (reg_p & P_OVERFLOW)
 #define LOCAL_BREAK()            (reg_p & P_BREAK)
 #define LOCAL_DECIMAL()          (reg_p & P_DECIMAL)
 #define LOCAL_INTERRUPT()        (reg_p & P_INTERRUPT)
-#define LOCAL_CARRY()            (reg_p & P_CARRY)
+#define LOCAL_CARRY()            (flag_c)
 #define LOCAL_SIGN()             (flag_n & 0x80)
 #define LOCAL_ZERO()             (!flag_z)
-#define LOCAL_STATUS()           (reg_p | (flag_n & 0x80) | P_UNUSED    \
+#define LOCAL_STATUS()           (reg_p | flag_c | (flag_n & 0x80) | P_UNUSED \
                                   | (LOCAL_ZERO() ? P_ZERO : 0))
 
 #ifdef LAST_OPCODE_INFO
@@ -166,16 +232,16 @@
 
 #ifndef C64DTV
 /* Export the local version of the registers.  */
-#define EXPORT_REGISTERS()          \
-    do {                            \
-        GLOBAL_REGS.pc = reg_pc ;   \
-        GLOBAL_REGS.a = reg_a_read; \
-        GLOBAL_REGS.x = reg_x;      \
-        GLOBAL_REGS.y = reg_y;      \
-        GLOBAL_REGS.sp = reg_sp;    \
-        GLOBAL_REGS.p = reg_p;      \
-        GLOBAL_REGS.n = flag_n;     \
-        GLOBAL_REGS.z = flag_z;     \
+#define EXPORT_REGISTERS()              \
+    do {                                \
+        GLOBAL_REGS.pc = reg_pc ;       \
+        GLOBAL_REGS.a = reg_a_read;     \
+        GLOBAL_REGS.x = reg_x;          \
+        GLOBAL_REGS.y = reg_y;          \
+        GLOBAL_REGS.sp = reg_sp;        \
+        GLOBAL_REGS.p = reg_p | flag_c; \
+        GLOBAL_REGS.n = flag_n;         \
+        GLOBAL_REGS.z = flag_z;         \
     } while (0)
 
 /* Import the public version of the registers.  */
@@ -185,7 +251,8 @@
         reg_x = GLOBAL_REGS.x;                             \
         reg_y = GLOBAL_REGS.y;                             \
         reg_sp = GLOBAL_REGS.sp;                           \
-        reg_p = GLOBAL_REGS.p;                             \
+        reg_p = GLOBAL_REGS.p & ~P_CARRY;                  \
+        flag_c = GLOBAL_REGS.p & P_CARRY;                  \
         flag_n = GLOBAL_REGS.n;                            \
         flag_z = GLOBAL_REGS.z;                            \
         bank_start = bank_limit = 0; /* prevent caching */ \
@@ -202,7 +269,7 @@
         GLOBAL_REGS.x = dtv_registers[2];                            \
         GLOBAL_REGS.y = dtv_registers[1];                            \
         GLOBAL_REGS.sp = reg_sp;                                     \
-        GLOBAL_REGS.p = reg_p;                                       \
+        GLOBAL_REGS.p = reg_p | flag_c;                              \
         GLOBAL_REGS.n = flag_n;                                      \
         GLOBAL_REGS.z = flag_z;                                      \
         GLOBAL_REGS.r3 = dtv_registers[3];                           \
@@ -229,7 +296,8 @@
         dtv_registers[2] = GLOBAL_REGS.x;                  \
         dtv_registers[1] = GLOBAL_REGS.y;                  \
         reg_sp = GLOBAL_REGS.sp;                           \
-        reg_p = GLOBAL_REGS.p;                             \
+        reg_p = GLOBAL_REGS.p & ~P_CARRY;                  \
+        flag_c = GLOBAL_REGS.p & P_CARRY;                  \
         flag_n = GLOBAL_REGS.n;                            \
         flag_z = GLOBAL_REGS.z;                            \
         dtv_registers[3] = GLOBAL_REGS.r3;                 \
@@ -283,6 +351,17 @@
 #define CHECK_PROFILE_RTI()
 #endif
 
+#if !defined(DRIVE_CPU)
+#define CHECK_FUZZ_EDGE(dest_addr)           \
+    do {                                     \
+        if (fuzz_coverage != NULL) {         \
+            FUZZ_EDGE(dest_addr);            \
+        }                                    \
+    } while (0)
+#else
+#define CHECK_FUZZ_EDGE(dest_addr)
+#endif
+
 #ifdef DEBUG
 #define TRACE_NMI()                         \
     do {                                    \
@@ -744,7 +823,7 @@
         get_func(tmp_value);                                                                       \
                                                                                                    \
         if (LOCAL_DECIMAL()) {                                                                     \
-            tmp = (reg_a_read & 0xf) + (tmp_value & 0xf) + (reg_p & 0x1);                          \
+            tmp = (reg_a_read & 0xf) + (tmp_value & 0xf) + LOCAL_CARRY();                          \
             if (tmp > 0x9) {                                                                       \
                 tmp += 0x6;                                                                        \
             }                                                                                      \
@@ -753,7 +832,7 @@
             } else {                                                                               \
                 tmp = (tmp & 0xf) + (reg_a_read & 0xf0) + (tmp_value & 0xf0) + 0x10;               \
             }                                                                                      \
-            LOCAL_SET_ZERO(!((reg_a_read + tmp_value + (reg_p & 0x1)) & 0xff));                    \
+            LOCAL_SET_ZERO(!((reg_a_read + tmp_value + LOCAL_CARRY()) & 0xff));                    \
             LOCAL_SET_SIGN(tmp & 0x80);                                                            \
             LOCAL_SET_OVERFLOW(((reg_a_read ^ tmp) & 0x80) && !((reg_a_read ^ tmp_value) & 0x80)); \
             if ((tmp & 0x1f0) > 0x90) {                                                            \
@@ -761,7 +840,7 @@
             }                                                                                      \
             LOCAL_SET_CARRY((tmp & 0xff0) > 0xf0);                                                 \
         } else {                                                                                   \
-            tmp = tmp_value + reg_a_read + (reg_p & P_CARRY);                                      \
+            tmp = tmp_value + reg_a_read + LOCAL_CARRY();                                          \
             LOCAL_SET_NZ(tmp & 0xff);                                                              \
             LOCAL_SET_OVERFLOW(!((reg_a_read ^ tmp_value) & 0x80) && ((reg_a_read ^ tmp) & 0x80)); \
             LOCAL_SET_CARRY(tmp > 0xff);                                                           \
@@ -889,7 +968,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         tmp = reg_a_read & (p1);                                    \
         if (LOCAL_DECIMAL()) {                                      \
             int tmp_2 = tmp;                                        \
-            tmp_2 |= (reg_p & P_CARRY) << 8;                        \
+            tmp_2 |= LOCAL_CARRY() << 8;                            \
             tmp_2 >>= 1;                                            \
             LOCAL_SET_SIGN(LOCAL_CARRY());                          \
             LOCAL_SET_ZERO(!tmp_2);                                 \
@@ -905,7 +984,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
             }                                                       \
             reg_a_write = tmp_2;                                    \
         } else {                                                    \
-            tmp |= (reg_p & P_CARRY) << 8;                          \
+            tmp |= LOCAL_CARRY() << 8;                              \
             tmp >>= 1;                                              \
             LOCAL_SET_NZ(tmp);                                      \
             LOCAL_SET_CARRY(tmp & 0x40);                            \
@@ -979,6 +1058,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
             }                                                     \
             JUMP(dest_addr & 0xffff);                             \
         }                                                         \
+        CHECK_FUZZ_EDGE(reg_pc);                                  \
     } while (0)
 
 #else /* !C64DTV */
@@ -1002,6 +1082,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
             }                                                 \
             JUMP(dest_addr & 0xffff);                         \
         }                                                     \
+        CHECK_FUZZ_EDGE(reg_pc);                              \
     } while (0)
 
 #endif
@@ -1176,9 +1257,10 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         set_func(old_value, new_value)      \
     } while (0)
 
-#define JMP(addr)   \
-    do {            \
-        JUMP(addr); \
+#define JMP(addr)                \
+    do {                         \
+        JUMP(addr);              \
+        CHECK_FUZZ_EDGE(reg_pc); \
     } while (0)
 
 #define JMP_IND()                                                    \
@@ -1189,6 +1271,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         dest_addr |= (LOAD((p2 & 0xff00) | ((p2 + 1) & 0xff)) << 8); \
         CLK_INC();                                                   \
         JUMP(dest_addr);                                             \
+        CHECK_FUZZ_EDGE(reg_pc);                                     \
     } while (0)
 
 /* HACK: fix JSR MSB in monitor CPU history */
@@ -1217,6 +1300,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         CLK_INC();                                \
         CHECK_PROFILE_JSR(dest_addr);             \
         JUMP(dest_addr);                          \
+        CHECK_FUZZ_EDGE(reg_pc);                  \
     } while (0)
 
 #define LAS()                                          \
@@ -1399,7 +1483,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
     do {                                                  \
         unsigned int old_value, new_value;                \
         get_func(old_value)                               \
-        new_value = (old_value << 1) | (reg_p & P_CARRY); \
+        new_value = (old_value << 1) | LOCAL_CARRY();     \
         LOCAL_SET_CARRY(new_value & 0x100);               \
         reg_a_write = reg_a_read & new_value;             \
         LOCAL_SET_NZ(reg_a_read);                         \
@@ -1411,7 +1495,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
     do {                                                  \
         unsigned int old_value, new_value;                \
         get_func(old_value)                               \
-        new_value = (old_value << 1) | (reg_p & P_CARRY); \
+        new_value = (old_value << 1) | LOCAL_CARRY();     \
         LOCAL_SET_CARRY(new_value & 0x100);               \
         LOCAL_SET_NZ(new_value & 0xff);                   \
         INC_PC(pc_inc);                                   \
@@ -1422,7 +1506,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
     do {                                       \
         unsigned int tmp = reg_a_read << 1;    \
                                                \
-        reg_a_write = tmp | (reg_p & P_CARRY); \
+        reg_a_write = tmp | LOCAL_CARRY();     \
         LOCAL_SET_CARRY(tmp & 0x100);          \
         LOCAL_SET_NZ(reg_a_read);              \
         INC_PC(1);                             \
@@ -1433,7 +1517,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         unsigned int old_value, new_value; \
         get_func(old_value)                \
         new_value = old_value;             \
-        if (reg_p & P_CARRY) {             \
+        if (LOCAL_CARRY()) {               \
             new_value |= 0x100;            \
         }                                  \
         LOCAL_SET_CARRY(new_value & 0x01); \
@@ -1447,7 +1531,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
     do {                                                \
         uint8_t tmp = reg_a_read;                          \
                                                         \
-        reg_a_write = (reg_a_read >> 1) | (reg_p << 7); \
+        reg_a_write = (reg_a_read >> 1) | (LOCAL_CARRY() << 7); \
         LOCAL_SET_CARRY(tmp & 0x01);                    \
         LOCAL_SET_NZ(reg_a_read);                       \
         INC_PC(1);                                      \
@@ -1458,7 +1542,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         unsigned int old_value, new_value; \
         get_func(old_value)                \
         new_value = old_value;             \
-        if (reg_p & P_CARRY) {             \
+        if (LOCAL_CARRY()) {               \
             new_value |= 0x100;            \
         }                                  \
         LOCAL_SET_CARRY(new_value & 0x01); \
@@ -1490,25 +1574,27 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         tmp |= (uint16_t)PULL() << 8;   \
         CLK_INC();                      \
         JUMP(tmp);                      \
+        CHECK_FUZZ_EDGE(reg_pc);        \
     } while (0)
 
-#define RTS()                 \
-    do {                      \
-        uint16_t tmp;         \
-                              \
-        CHECK_PROFILE_RTS();  \
-        if (!SKIP_CYCLE) {    \
-            STACK_PEEK();     \
-            CLK_INC();        \
-        }                     \
-        tmp = PULL();         \
-        CLK_INC();            \
-        tmp |= (PULL() << 8); \
-        CLK_INC();            \
-        LOAD(tmp);            \
-        CLK_INC();            \
-        tmp++;                \
-        JUMP(tmp);            \
+#define RTS()                    \
+    do {                         \
+        uint16_t tmp;            \
+                                 \
+        CHECK_PROFILE_RTS();     \
+        if (!SKIP_CYCLE) {       \
+            STACK_PEEK();        \
+            CLK_INC();           \
+        }                        \
+        tmp = PULL();            \
+        CLK_INC();               \
+        tmp |= (PULL() << 8);    \
+        CLK_INC();               \
+        LOAD(tmp);               \
+        CLK_INC();               \
+        tmp++;                   \
+        JUMP(tmp);               \
+        CHECK_FUZZ_EDGE(reg_pc); \
     } while (0)
 
 #define SAC()                       \
@@ -1523,10 +1609,10 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         uint16_t src, tmp;                                                                      \
                                                                                             \
         get_func(src)                                                                       \
-        tmp = reg_a_read - src - ((reg_p & P_CARRY) ? 0 : 1);                               \
+        tmp = reg_a_read - src - (LOCAL_CARRY() ? 0 : 1);                                   \
         if (reg_p & P_DECIMAL) {                                                            \
             unsigned int tmp_a;                                                             \
-            tmp_a = (reg_a_read & 0xf) - (src & 0xf) - ((reg_p & P_CARRY) ? 0 : 1);         \
+            tmp_a = (reg_a_read & 0xf) - (src & 0xf) - (LOCAL_CARRY() ? 0 : 1);             \
             if (tmp_a & 0x10) {                                                             \
                 tmp_a = ((tmp_a - 6) & 0xf) | ((reg_a_read & 0xf0) - (src & 0xf0) - 0x10);  \
             } else {                                                                        \
@@ -1811,6 +1897,8 @@ static const uint8_t fetch_tab[] = {
             }
         }
 
+        PERF_COUNT_OPCODE(0, p0);
+
 #ifdef FEATURE_CPUMEMHISTORY
         /* If reg_pc >= bank_limit  then JSR (0x20) hasn't load p2 yet.
            The earlier LOAD(reg_pc+2) hack can break stealing badly on x64sc.
@@ -1842,952 +1930,952 @@ trap_skipped:
         SET_LAST_OPCODE(p0);
 #endif
 
-        switch (p0) {
-            case 0x00:          /* BRK */
+        OPCODE_DISPATCH_BEGIN(p0)
+            OPCODE_CASE(0x00)   /* BRK */
                 BRK();
-                break;
+                OPCODE_BREAK;
 
-            case 0x01:          /* ORA ($nn,X) */
+            OPCODE_CASE(0x01)   /* ORA ($nn,X) */
                 ORA(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x02:          /* JAM - also used for traps */
+            OPCODE_CASE(0x02)   /* JAM - also used for traps */
                 STATIC_ASSERT(TRAP_OPCODE == 0x02);
                 JAM_02();
-                break;
-
-            case 0x22:          /* JAM */
-            case 0x52:          /* JAM */
-            case 0x62:          /* JAM */
-            case 0x72:          /* JAM */
-            case 0x92:          /* JAM */
-            case 0xb2:          /* JAM */
-            case 0xd2:          /* JAM */
-            case 0xf2:          /* JAM */
+                OPCODE_BREAK;
+
+            OPCODE_CASE(0x22)   /* JAM */
+            OPCODE_CASE(0x52)   /* JAM */
+            OPCODE_CASE(0x62)   /* JAM */
+            OPCODE_CASE(0x72)   /* JAM */
+            OPCODE_CASE(0x92)   /* JAM */
+            OPCODE_CASE(0xb2)   /* JAM */
+            OPCODE_CASE(0xd2)   /* JAM */
+            OPCODE_CASE(0xf2)   /* JAM */
 #ifndef C64DTV
-            case 0x12:          /* JAM */
-            case 0x32:          /* JAM */
-            case 0x42:          /* JAM */
+            OPCODE_CASE(0x12)   /* JAM */
+            OPCODE_CASE(0x32)   /* JAM */
+            OPCODE_CASE(0x42)   /* JAM */
 #endif
                 CPU_IS_JAMMED = 1;
                 REWIND_FETCH_OPCODE(CLK);
                 JAM();
-                break;
+                OPCODE_BREAK;
 
 #ifdef C64DTV
-            case 0x12:          /* BRA $nnnn */
+            OPCODE_CASE(0x12)   /* BRA $nnnn */
                 BRANCH(1);
-                break;
+                OPCODE_BREAK;
 
-            case 0x32:          /* SAC #$nn */
+            OPCODE_CASE(0x32)   /* SAC #$nn */
                 SAC();
-                break;
+                OPCODE_BREAK;
 
-            case 0x42:          /* SIR #$nn */
+            OPCODE_CASE(0x42)   /* SIR #$nn */
                 SIR();
-                break;
+                OPCODE_BREAK;
 #endif
 
-            case 0x03:          /* SLO ($nn,X) */
+            OPCODE_CASE(0x03)   /* SLO ($nn,X) */
                 SLO(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x04:          /* NOOP $nn */
-            case 0x44:          /* NOOP $nn */
-            case 0x64:          /* NOOP $nn */
+            OPCODE_CASE(0x04)   /* NOOP $nn */
+            OPCODE_CASE(0x44)   /* NOOP $nn */
+            OPCODE_CASE(0x64)   /* NOOP $nn */
                 NOOP(GET_ZERO_DUMMY, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x05:          /* ORA $nn */
+            OPCODE_CASE(0x05)   /* ORA $nn */
                 ORA(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x06:          /* ASL $nn */
+            OPCODE_CASE(0x06)   /* ASL $nn */
                 ASL(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x07:          /* SLO $nn */
+            OPCODE_CASE(0x07)   /* SLO $nn */
                 SLO(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x08:          /* PHP */
+            OPCODE_CASE(0x08)   /* PHP */
                 PHP();
-                break;
+                OPCODE_BREAK;
 
-            case 0x09:          /* ORA #$nn */
+            OPCODE_CASE(0x09)   /* ORA #$nn */
                 ORA(GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x0a:          /* ASL A */
+            OPCODE_CASE(0x0a)   /* ASL A */
                 ASL_A();
-                break;
+                OPCODE_BREAK;
 
-            case 0x0b:          /* ANC #$nn */
-            case 0x2b:          /* ANC #$nn */
+            OPCODE_CASE(0x0b)   /* ANC #$nn */
+            OPCODE_CASE(0x2b)   /* ANC #$nn */
                 ANC();
-                break;
+                OPCODE_BREAK;
 
-            case 0x0c:          /* NOOP $nnnn */
+            OPCODE_CASE(0x0c)   /* NOOP $nnnn */
                 NOOP(GET_ABS_DUMMY, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x0d:          /* ORA $nnnn */
+            OPCODE_CASE(0x0d)   /* ORA $nnnn */
                 ORA(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x0e:          /* ASL $nnnn */
+            OPCODE_CASE(0x0e)   /* ASL $nnnn */
                 ASL(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x0f:          /* SLO $nnnn */
+            OPCODE_CASE(0x0f)   /* SLO $nnnn */
                 SLO(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x10:          /* BPL $nnnn */
+            OPCODE_CASE(0x10)   /* BPL $nnnn */
                 BRANCH(!LOCAL_SIGN());
-                break;
+                OPCODE_BREAK;
 
-            case 0x11:          /* ORA ($nn),Y */
+            OPCODE_CASE(0x11)   /* ORA ($nn),Y */
                 ORA(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x13:          /* SLO ($nn),Y */
+            OPCODE_CASE(0x13)   /* SLO ($nn),Y */
                 SLO(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
-
-            case 0x14:          /* NOOP $nn,X */
-            case 0x34:          /* NOOP $nn,X */
-            case 0x54:          /* NOOP $nn,X */
-            case 0x74:          /* NOOP $nn,X */
-            case 0xd4:          /* NOOP $nn,X */
-            case 0xf4:          /* NOOP $nn,X */
+                OPCODE_BREAK;
+
+            OPCODE_CASE(0x14)   /* NOOP $nn,X */
+            OPCODE_CASE(0x34)   /* NOOP $nn,X */
+            OPCODE_CASE(0x54)   /* NOOP $nn,X */
+            OPCODE_CASE(0x74)   /* NOOP $nn,X */
+            OPCODE_CASE(0xd4)   /* NOOP $nn,X */
+            OPCODE_CASE(0xf4)   /* NOOP $nn,X */
                 NOOP(GET_ZERO_X_DUMMY, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x15:          /* ORA $nn,X */
+            OPCODE_CASE(0x15)   /* ORA $nn,X */
                 ORA(GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x16:          /* ASL $nn,X */
+            OPCODE_CASE(0x16)   /* ASL $nn,X */
                 ASL(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x17:          /* SLO $nn,X */
+            OPCODE_CASE(0x17)   /* SLO $nn,X */
                 SLO(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x18:          /* CLC */
+            OPCODE_CASE(0x18)   /* CLC */
                 CLC();
-                break;
+                OPCODE_BREAK;
 
-            case 0x19:          /* ORA $nnnn,Y */
+            OPCODE_CASE(0x19)   /* ORA $nnnn,Y */
                 ORA(GET_ABS_Y, 3);
-                break;
-
-            case 0x1a:          /* NOOP */
-            case 0x3a:          /* NOOP */
-            case 0x5a:          /* NOOP */
-            case 0x7a:          /* NOOP */
-            case 0xda:          /* NOOP */
-            case 0xfa:          /* NOOP */
-            case 0xea:          /* NOP */
+                OPCODE_BREAK;
+
+            OPCODE_CASE(0x1a)   /* NOOP */
+            OPCODE_CASE(0x3a)   /* NOOP */
+            OPCODE_CASE(0x5a)   /* NOOP */
+            OPCODE_CASE(0x7a)   /* NOOP */
+            OPCODE_CASE(0xda)   /* NOOP */
+            OPCODE_CASE(0xfa)   /* NOOP */
+            OPCODE_CASE(0xea)   /* NOP */
                 NOOP(GET_IMM_DUMMY, 1);
-                break;
+                OPCODE_BREAK;
 
-            case 0x1b:          /* SLO $nnnn,Y */
+            OPCODE_CASE(0x1b)   /* SLO $nnnn,Y */
                 SLO(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
-
-            case 0x1c:          /* NOOP $nnnn,X */
-            case 0x3c:          /* NOOP $nnnn,X */
-            case 0x5c:          /* NOOP $nnnn,X */
-            case 0x7c:          /* NOOP $nnnn,X */
-            case 0xdc:          /* NOOP $nnnn,X */
-            case 0xfc:          /* NOOP $nnnn,X */
+                OPCODE_BREAK;
+
+            OPCODE_CASE(0x1c)   /* NOOP $nnnn,X */
+            OPCODE_CASE(0x3c)   /* NOOP $nnnn,X */
+            OPCODE_CASE(0x5c)   /* NOOP $nnnn,X */
+            OPCODE_CASE(0x7c)   /* NOOP $nnnn,X */
+            OPCODE_CASE(0xdc)   /* NOOP $nnnn,X */
+            OPCODE_CASE(0xfc)   /* NOOP $nnnn,X */
                 NOOP(GET_ABS_X_DUMMY, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x1d:          /* ORA $nnnn,X */
+            OPCODE_CASE(0x1d)   /* ORA $nnnn,X */
                 ORA(GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x1e:          /* ASL $nnnn,X */
+            OPCODE_CASE(0x1e)   /* ASL $nnnn,X */
                 ASL(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x1f:          /* SLO $nnnn,X */
+            OPCODE_CASE(0x1f)   /* SLO $nnnn,X */
                 SLO(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x20:          /* JSR $nnnn */
+            OPCODE_CASE(0x20)   /* JSR $nnnn */
                 JSR();
-                break;
+                OPCODE_BREAK;
 
-            case 0x21:          /* AND ($nn,X) */
+            OPCODE_CASE(0x21)   /* AND ($nn,X) */
                 AND(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x23:          /* RLA ($nn,X) */
+            OPCODE_CASE(0x23)   /* RLA ($nn,X) */
                 RLA(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x24:          /* BIT $nn */
+            OPCODE_CASE(0x24)   /* BIT $nn */
                 BIT(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x25:          /* AND $nn */
+            OPCODE_CASE(0x25)   /* AND $nn */
                 AND(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x26:          /* ROL $nn */
+            OPCODE_CASE(0x26)   /* ROL $nn */
                 ROL(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x27:          /* RLA $nn */
+            OPCODE_CASE(0x27)   /* RLA $nn */
                 RLA(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x28:          /* PLP */
+            OPCODE_CASE(0x28)   /* PLP */
                 PLP();
-                break;
+                OPCODE_BREAK;
 
-            case 0x29:          /* AND #$nn */
+            OPCODE_CASE(0x29)   /* AND #$nn */
                 AND(GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x2a:          /* ROL A */
+            OPCODE_CASE(0x2a)   /* ROL A */
                 ROL_A();
-                break;
+                OPCODE_BREAK;
 
-            case 0x2c:          /* BIT $nnnn */
+            OPCODE_CASE(0x2c)   /* BIT $nnnn */
                 BIT(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x2d:          /* AND $nnnn */
+            OPCODE_CASE(0x2d)   /* AND $nnnn */
                 AND(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x2e:          /* ROL $nnnn */
+            OPCODE_CASE(0x2e)   /* ROL $nnnn */
                 ROL(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x2f:          /* RLA $nnnn */
+            OPCODE_CASE(0x2f)   /* RLA $nnnn */
                 RLA(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x30:          /* BMI $nnnn */
+            OPCODE_CASE(0x30)   /* BMI $nnnn */
                 BRANCH(LOCAL_SIGN());
-                break;
+                OPCODE_BREAK;
 
-            case 0x31:          /* AND ($nn),Y */
+            OPCODE_CASE(0x31)   /* AND ($nn),Y */
                 AND(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x33:          /* RLA ($nn),Y */
+            OPCODE_CASE(0x33)   /* RLA ($nn),Y */
                 RLA(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x35:          /* AND $nn,X */
+            OPCODE_CASE(0x35)   /* AND $nn,X */
                 AND(GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x36:          /* ROL $nn,X */
+            OPCODE_CASE(0x36)   /* ROL $nn,X */
                 ROL(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x37:          /* RLA $nn,X */
+            OPCODE_CASE(0x37)   /* RLA $nn,X */
                 RLA(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x38:          /* SEC */
+            OPCODE_CASE(0x38)   /* SEC */
                 SEC();
-                break;
+                OPCODE_BREAK;
 
-            case 0x39:          /* AND $nnnn,Y */
+            OPCODE_CASE(0x39)   /* AND $nnnn,Y */
                 AND(GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x3b:          /* RLA $nnnn,Y */
+            OPCODE_CASE(0x3b)   /* RLA $nnnn,Y */
                 RLA(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x3d:          /* AND $nnnn,X */
+            OPCODE_CASE(0x3d)   /* AND $nnnn,X */
                 AND(GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x3e:          /* ROL $nnnn,X */
+            OPCODE_CASE(0x3e)   /* ROL $nnnn,X */
                 ROL(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x3f:          /* RLA $nnnn,X */
+            OPCODE_CASE(0x3f)   /* RLA $nnnn,X */
                 RLA(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x40:          /* RTI */
+            OPCODE_CASE(0x40)   /* RTI */
                 RTI();
-                break;
+                OPCODE_BREAK;
 
-            case 0x41:          /* EOR ($nn,X) */
+            OPCODE_CASE(0x41)   /* EOR ($nn,X) */
                 EOR(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x43:          /* SRE ($nn,X) */
+            OPCODE_CASE(0x43)   /* SRE ($nn,X) */
                 SRE(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x45:          /* EOR $nn */
+            OPCODE_CASE(0x45)   /* EOR $nn */
                 EOR(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x46:          /* LSR $nn */
+            OPCODE_CASE(0x46)   /* LSR $nn */
                 LSR(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x47:          /* SRE $nn */
+            OPCODE_CASE(0x47)   /* SRE $nn */
                 SRE(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x48:          /* PHA */
+            OPCODE_CASE(0x48)   /* PHA */
                 PHA();
-                break;
+                OPCODE_BREAK;
 
-            case 0x49:          /* EOR #$nn */
+            OPCODE_CASE(0x49)   /* EOR #$nn */
                 EOR(GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x4a:          /* LSR A */
+            OPCODE_CASE(0x4a)   /* LSR A */
                 LSR_A();
-                break;
+                OPCODE_BREAK;
 
-            case 0x4b:          /* ASR #$nn */
+            OPCODE_CASE(0x4b)   /* ASR #$nn */
                 ASR();
-                break;
+                OPCODE_BREAK;
 
-            case 0x4c:          /* JMP $nnnn */
+            OPCODE_CASE(0x4c)   /* JMP $nnnn */
                 JMP(p2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x4d:          /* EOR $nnnn */
+            OPCODE_CASE(0x4d)   /* EOR $nnnn */
                 EOR(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x4e:          /* LSR $nnnn */
+            OPCODE_CASE(0x4e)   /* LSR $nnnn */
                 LSR(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x4f:          /* SRE $nnnn */
+            OPCODE_CASE(0x4f)   /* SRE $nnnn */
                 SRE(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x50:          /* BVC $nnnn */
+            OPCODE_CASE(0x50)   /* BVC $nnnn */
                 BRANCH(!LOCAL_OVERFLOW());
-                break;
+                OPCODE_BREAK;
 
-            case 0x51:          /* EOR ($nn),Y */
+            OPCODE_CASE(0x51)   /* EOR ($nn),Y */
                 EOR(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x53:          /* SRE ($nn),Y */
+            OPCODE_CASE(0x53)   /* SRE ($nn),Y */
                 SRE(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x55:          /* EOR $nn,X */
+            OPCODE_CASE(0x55)   /* EOR $nn,X */
                 EOR(GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x56:          /* LSR $nn,X */
+            OPCODE_CASE(0x56)   /* LSR $nn,X */
                 LSR(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x57:          /* SRE $nn,X */
+            OPCODE_CASE(0x57)   /* SRE $nn,X */
                 SRE(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x58:          /* CLI */
+            OPCODE_CASE(0x58)   /* CLI */
                 CLI();
-                break;
+                OPCODE_BREAK;
 
-            case 0x59:          /* EOR $nnnn,Y */
+            OPCODE_CASE(0x59)   /* EOR $nnnn,Y */
                 EOR(GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x5b:          /* SRE $nnnn,Y */
+            OPCODE_CASE(0x5b)   /* SRE $nnnn,Y */
                 SRE(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x5d:          /* EOR $nnnn,X */
+            OPCODE_CASE(0x5d)   /* EOR $nnnn,X */
                 EOR(GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x5e:          /* LSR $nnnn,X */
+            OPCODE_CASE(0x5e)   /* LSR $nnnn,X */
                 LSR(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x5f:          /* SRE $nnnn,X */
+            OPCODE_CASE(0x5f)   /* SRE $nnnn,X */
                 SRE(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x60:          /* RTS */
+            OPCODE_CASE(0x60)   /* RTS */
                 RTS();
-                break;
+                OPCODE_BREAK;
 
-            case 0x61:          /* ADC ($nn,X) */
+            OPCODE_CASE(0x61)   /* ADC ($nn,X) */
                 ADC(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x63:          /* RRA ($nn,X) */
+            OPCODE_CASE(0x63)   /* RRA ($nn,X) */
                 RRA(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x65:          /* ADC $nn */
+            OPCODE_CASE(0x65)   /* ADC $nn */
                 ADC(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x66:          /* ROR $nn */
+            OPCODE_CASE(0x66)   /* ROR $nn */
                 ROR(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x67:          /* RRA $nn */
+            OPCODE_CASE(0x67)   /* RRA $nn */
                 RRA(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x68:          /* PLA */
+            OPCODE_CASE(0x68)   /* PLA */
                 PLA();
-                break;
+                OPCODE_BREAK;
 
-            case 0x69:          /* ADC #$nn */
+            OPCODE_CASE(0x69)   /* ADC #$nn */
                 ADC(GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x6a:          /* ROR A */
+            OPCODE_CASE(0x6a)   /* ROR A */
                 ROR_A();
-                break;
+                OPCODE_BREAK;
 
-            case 0x6b:          /* ARR #$nn */
+            OPCODE_CASE(0x6b)   /* ARR #$nn */
                 ARR();
-                break;
+                OPCODE_BREAK;
 
-            case 0x6c:          /* JMP ($nnnn) */
+            OPCODE_CASE(0x6c)   /* JMP ($nnnn) */
                 JMP_IND();
-                break;
+                OPCODE_BREAK;
 
-            case 0x6d:          /* ADC $nnnn */
+            OPCODE_CASE(0x6d)   /* ADC $nnnn */
                 ADC(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x6e:          /* ROR $nnnn */
+            OPCODE_CASE(0x6e)   /* ROR $nnnn */
                 ROR(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x6f:          /* RRA $nnnn */
+            OPCODE_CASE(0x6f)   /* RRA $nnnn */
                 RRA(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x70:          /* BVS $nnnn */
+            OPCODE_CASE(0x70)   /* BVS $nnnn */
                 BRANCH(LOCAL_OVERFLOW());
-                break;
+                OPCODE_BREAK;
 
-            case 0x71:          /* ADC ($nn),Y */
+            OPCODE_CASE(0x71)   /* ADC ($nn),Y */
                 ADC(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x73:          /* RRA ($nn),Y */
+            OPCODE_CASE(0x73)   /* RRA ($nn),Y */
                 RRA(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x75:          /* ADC $nn,X */
+            OPCODE_CASE(0x75)   /* ADC $nn,X */
                 ADC(GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x76:          /* ROR $nn,X */
+            OPCODE_CASE(0x76)   /* ROR $nn,X */
                 ROR(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x77:          /* RRA $nn,X */
+            OPCODE_CASE(0x77)   /* RRA $nn,X */
                 RRA(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x78:          /* SEI */
+            OPCODE_CASE(0x78)   /* SEI */
                 SEI();
-                break;
+                OPCODE_BREAK;
 
-            case 0x79:          /* ADC $nnnn,Y */
+            OPCODE_CASE(0x79)   /* ADC $nnnn,Y */
                 ADC(GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x7b:          /* RRA $nnnn,Y */
+            OPCODE_CASE(0x7b)   /* RRA $nnnn,Y */
                 RRA(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x7d:          /* ADC $nnnn,X */
+            OPCODE_CASE(0x7d)   /* ADC $nnnn,X */
                 ADC(GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x7e:          /* ROR $nnnn,X */
+            OPCODE_CASE(0x7e)   /* ROR $nnnn,X */
                 ROR(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x7f:          /* RRA $nnnn,X */
+            OPCODE_CASE(0x7f)   /* RRA $nnnn,X */
                 RRA(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0x80:          /* NOOP #$nn */
-            case 0x82:          /* NOOP #$nn */
-            case 0x89:          /* NOOP #$nn */
-            case 0xc2:          /* NOOP #$nn */
-            case 0xe2:          /* NOOP #$nn */
+            OPCODE_CASE(0x80)   /* NOOP #$nn */
+            OPCODE_CASE(0x82)   /* NOOP #$nn */
+            OPCODE_CASE(0x89)   /* NOOP #$nn */
+            OPCODE_CASE(0xc2)   /* NOOP #$nn */
+            OPCODE_CASE(0xe2)   /* NOOP #$nn */
                 NOOP(GET_IMM_DUMMY, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x81:          /* STA ($nn,X) */
+            OPCODE_CASE(0x81)   /* STA ($nn,X) */
                 ST(reg_a_read, SET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x83:          /* SAX ($nn,X) */
+            OPCODE_CASE(0x83)   /* SAX ($nn,X) */
                 ST(reg_a_read & reg_x, SET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x84:          /* STY $nn */
+            OPCODE_CASE(0x84)   /* STY $nn */
                 ST(reg_y, SET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x85:          /* STA $nn */
+            OPCODE_CASE(0x85)   /* STA $nn */
                 ST(reg_a_read, SET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x86:          /* STX $nn */
+            OPCODE_CASE(0x86)   /* STX $nn */
                 ST(reg_x, SET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x87:          /* SAX $nn */
+            OPCODE_CASE(0x87)   /* SAX $nn */
                 ST(reg_a_read & reg_x, SET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x88:          /* DEY */
+            OPCODE_CASE(0x88)   /* DEY */
                 DEY();
-                break;
+                OPCODE_BREAK;
 
-            case 0x8a:          /* TXA */
+            OPCODE_CASE(0x8a)   /* TXA */
                 TXA();
-                break;
+                OPCODE_BREAK;
 
-            case 0x8b:          /* ANE #$nn */
+            OPCODE_CASE(0x8b)   /* ANE #$nn */
                 ANE();
-                break;
+                OPCODE_BREAK;
 
-            case 0x8c:          /* STY $nnnn */
+            OPCODE_CASE(0x8c)   /* STY $nnnn */
                 ST(reg_y, SET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x8d:          /* STA $nnnn */
+            OPCODE_CASE(0x8d)   /* STA $nnnn */
                 ST(reg_a_read, SET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x8e:          /* STX $nnnn */
+            OPCODE_CASE(0x8e)   /* STX $nnnn */
                 ST(reg_x, SET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x8f:          /* SAX $nnnn */
+            OPCODE_CASE(0x8f)   /* SAX $nnnn */
                 ST(reg_a_read & reg_x, SET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x90:          /* BCC $nnnn */
+            OPCODE_CASE(0x90)   /* BCC $nnnn */
                 BRANCH(!LOCAL_CARRY());
-                break;
+                OPCODE_BREAK;
 
-            case 0x91:          /* STA ($nn),Y */
+            OPCODE_CASE(0x91)   /* STA ($nn),Y */
                 ST(reg_a_read, SET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x93:          /* SHA ($nn),Y */
+            OPCODE_CASE(0x93)   /* SHA ($nn),Y */
                 SHA_IND_Y();
-                break;
+                OPCODE_BREAK;
 
-            case 0x94:          /* STY $nn,X */
+            OPCODE_CASE(0x94)   /* STY $nn,X */
                 ST(reg_y, SET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x95:          /* STA $nn,X */
+            OPCODE_CASE(0x95)   /* STA $nn,X */
                 ST(reg_a_read, SET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x96:          /* STX $nn,Y */
+            OPCODE_CASE(0x96)   /* STX $nn,Y */
                 ST(reg_x, SET_ZERO_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x97:          /* SAX $nn,Y */
+            OPCODE_CASE(0x97)   /* SAX $nn,Y */
                 ST(reg_a_read & reg_x, SET_ZERO_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0x98:          /* TYA */
+            OPCODE_CASE(0x98)   /* TYA */
                 TYA();
-                break;
+                OPCODE_BREAK;
 
-            case 0x99:          /* STA $nnnn,Y */
+            OPCODE_CASE(0x99)   /* STA $nnnn,Y */
                 ST(reg_a_read, SET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x9a:          /* TXS */
+            OPCODE_CASE(0x9a)   /* TXS */
                 TXS();
-                break;
+                OPCODE_BREAK;
 
-            case 0x9b:          /* NOP (SHS) $nnnn,Y */
+            OPCODE_CASE(0x9b)   /* NOP (SHS) $nnnn,Y */
 #ifdef C64DTV
                 NOOP(GET_ABS_Y_DUMMY, 3);
 #else
                 SHS_ABS_Y();
 #endif
-                break;
+                OPCODE_BREAK;
 
-            case 0x9c:          /* SHY $nnnn,X */
+            OPCODE_CASE(0x9c)   /* SHY $nnnn,X */
                 SH_ABS_I(reg_y, reg_x);
-                break;
+                OPCODE_BREAK;
 
-            case 0x9d:          /* STA $nnnn,X */
+            OPCODE_CASE(0x9d)   /* STA $nnnn,X */
                 ST(reg_a_read, SET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0x9e:          /* SHX $nnnn,Y */
+            OPCODE_CASE(0x9e)   /* SHX $nnnn,Y */
                 SH_ABS_I(reg_x, reg_y);
-                break;
+                OPCODE_BREAK;
 
-            case 0x9f:          /* SHA $nnnn,Y */
+            OPCODE_CASE(0x9f)   /* SHA $nnnn,Y */
                 SH_ABS_I(reg_a_read & reg_x, reg_y);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa0:          /* LDY #$nn */
+            OPCODE_CASE(0xa0)   /* LDY #$nn */
                 LD(reg_y, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa1:          /* LDA ($nn,X) */
+            OPCODE_CASE(0xa1)   /* LDA ($nn,X) */
                 LD(reg_a_write, GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa2:          /* LDX #$nn */
+            OPCODE_CASE(0xa2)   /* LDX #$nn */
                 LD(reg_x, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa3:          /* LAX ($nn,X) */
+            OPCODE_CASE(0xa3)   /* LAX ($nn,X) */
                 LAX(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa4:          /* LDY $nn */
+            OPCODE_CASE(0xa4)   /* LDY $nn */
                 LD(reg_y, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa5:          /* LDA $nn */
+            OPCODE_CASE(0xa5)   /* LDA $nn */
                 LD(reg_a_write, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa6:          /* LDX $nn */
+            OPCODE_CASE(0xa6)   /* LDX $nn */
                 LD(reg_x, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa7:          /* LAX $nn */
+            OPCODE_CASE(0xa7)   /* LAX $nn */
                 LAX(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xa8:          /* TAY */
+            OPCODE_CASE(0xa8)   /* TAY */
                 TAY();
-                break;
+                OPCODE_BREAK;
 
-            case 0xa9:          /* LDA #$nn */
+            OPCODE_CASE(0xa9)   /* LDA #$nn */
                 LD(reg_a_write, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xaa:          /* TAX */
+            OPCODE_CASE(0xaa)   /* TAX */
                 TAX();
-                break;
+                OPCODE_BREAK;
 
-            case 0xab:          /* LXA #$nn */
+            OPCODE_CASE(0xab)   /* LXA #$nn */
                 LXA();
-                break;
+                OPCODE_BREAK;
 
-            case 0xac:          /* LDY $nnnn */
+            OPCODE_CASE(0xac)   /* LDY $nnnn */
                 LD(reg_y, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xad:          /* LDA $nnnn */
+            OPCODE_CASE(0xad)   /* LDA $nnnn */
                 LD(reg_a_write, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xae:          /* LDX $nnnn */
+            OPCODE_CASE(0xae)   /* LDX $nnnn */
                 LD(reg_x, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xaf:          /* LAX $nnnn */
+            OPCODE_CASE(0xaf)   /* LAX $nnnn */
                 LAX(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb0:          /* BCS $nnnn */
+            OPCODE_CASE(0xb0)   /* BCS $nnnn */
                 BRANCH(LOCAL_CARRY());
-                break;
+                OPCODE_BREAK;
 
-            case 0xb1:          /* LDA ($nn),Y */
+            OPCODE_CASE(0xb1)   /* LDA ($nn),Y */
                 LD(reg_a_write, GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb3:          /* LAX ($nn),Y */
+            OPCODE_CASE(0xb3)   /* LAX ($nn),Y */
                 LAX(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb4:          /* LDY $nn,X */
+            OPCODE_CASE(0xb4)   /* LDY $nn,X */
                 LD(reg_y, GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb5:          /* LDA $nn,X */
+            OPCODE_CASE(0xb5)   /* LDA $nn,X */
                 LD(reg_a_write, GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb6:          /* LDX $nn,Y */
+            OPCODE_CASE(0xb6)   /* LDX $nn,Y */
                 LD(reg_x, GET_ZERO_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb7:          /* LAX $nn,Y */
+            OPCODE_CASE(0xb7)   /* LAX $nn,Y */
                 LAX(GET_ZERO_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xb8:          /* CLV */
+            OPCODE_CASE(0xb8)   /* CLV */
                 CLV();
-                break;
+                OPCODE_BREAK;
 
-            case 0xb9:          /* LDA $nnnn,Y */
+            OPCODE_CASE(0xb9)   /* LDA $nnnn,Y */
                 LD(reg_a_write, GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xba:          /* TSX */
+            OPCODE_CASE(0xba)   /* TSX */
                 TSX();
-                break;
+                OPCODE_BREAK;
 
-            case 0xbb:          /* LAS $nnnn,Y */
+            OPCODE_CASE(0xbb)   /* LAS $nnnn,Y */
                 LAS();
-                break;
+                OPCODE_BREAK;
 
-            case 0xbc:          /* LDY $nnnn,X */
+            OPCODE_CASE(0xbc)   /* LDY $nnnn,X */
                 LD(reg_y, GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xbd:          /* LDA $nnnn,X */
+            OPCODE_CASE(0xbd)   /* LDA $nnnn,X */
                 LD(reg_a_write, GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xbe:          /* LDX $nnnn,Y */
+            OPCODE_CASE(0xbe)   /* LDX $nnnn,Y */
                 LD(reg_x, GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xbf:          /* LAX $nnnn,Y */
+            OPCODE_CASE(0xbf)   /* LAX $nnnn,Y */
                 LAX(GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc0:          /* CPY #$nn */
+            OPCODE_CASE(0xc0)   /* CPY #$nn */
                 CP(reg_y, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc1:          /* CMP ($nn,X) */
+            OPCODE_CASE(0xc1)   /* CMP ($nn,X) */
                 CP(reg_a_read, GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc3:          /* DCP ($nn,X) */
+            OPCODE_CASE(0xc3)   /* DCP ($nn,X) */
                 DCP(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc4:          /* CPY $nn */
+            OPCODE_CASE(0xc4)   /* CPY $nn */
                 CP(reg_y, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc5:          /* CMP $nn */
+            OPCODE_CASE(0xc5)   /* CMP $nn */
                 CP(reg_a_read, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc6:          /* DEC $nn */
+            OPCODE_CASE(0xc6)   /* DEC $nn */
                 DEC(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc7:          /* DCP $nn */
+            OPCODE_CASE(0xc7)   /* DCP $nn */
                 DCP(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xc8:          /* INY */
+            OPCODE_CASE(0xc8)   /* INY */
                 INY();
-                break;
+                OPCODE_BREAK;
 
-            case 0xc9:          /* CMP #$nn */
+            OPCODE_CASE(0xc9)   /* CMP #$nn */
                 CP(reg_a_read, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xca:          /* DEX */
+            OPCODE_CASE(0xca)   /* DEX */
                 DEX();
-                break;
+                OPCODE_BREAK;
 
-            case 0xcb:          /* SBX #$nn */
+            OPCODE_CASE(0xcb)   /* SBX #$nn */
                 SBX();
-                break;
+                OPCODE_BREAK;
 
-            case 0xcc:          /* CPY $nnnn */
+            OPCODE_CASE(0xcc)   /* CPY $nnnn */
                 CP(reg_y, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xcd:          /* CMP $nnnn */
+            OPCODE_CASE(0xcd)   /* CMP $nnnn */
                 CP(reg_a_read, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xce:          /* DEC $nnnn */
+            OPCODE_CASE(0xce)   /* DEC $nnnn */
                 DEC(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xcf:          /* DCP $nnnn */
+            OPCODE_CASE(0xcf)   /* DCP $nnnn */
                 DCP(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd0:          /* BNE $nnnn */
+            OPCODE_CASE(0xd0)   /* BNE $nnnn */
                 BRANCH(!LOCAL_ZERO());
-                break;
+                OPCODE_BREAK;
 
-            case 0xd1:          /* CMP ($nn),Y */
+            OPCODE_CASE(0xd1)   /* CMP ($nn),Y */
                 CP(reg_a_read, GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd3:          /* DCP ($nn),Y */
+            OPCODE_CASE(0xd3)   /* DCP ($nn),Y */
                 DCP(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd5:          /* CMP $nn,X */
+            OPCODE_CASE(0xd5)   /* CMP $nn,X */
                 CP(reg_a_read, GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd6:          /* DEC $nn,X */
+            OPCODE_CASE(0xd6)   /* DEC $nn,X */
                 DEC(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd7:          /* DCP $nn,X */
+            OPCODE_CASE(0xd7)   /* DCP $nn,X */
                 DCP(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xd8:          /* CLD */
+            OPCODE_CASE(0xd8)   /* CLD */
                 CLD();
-                break;
+                OPCODE_BREAK;
 
-            case 0xd9:          /* CMP $nnnn,Y */
+            OPCODE_CASE(0xd9)   /* CMP $nnnn,Y */
                 CP(reg_a_read, GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xdb:          /* DCP $nnnn,Y */
+            OPCODE_CASE(0xdb)   /* DCP $nnnn,Y */
                 DCP(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xdd:          /* CMP $nnnn,X */
+            OPCODE_CASE(0xdd)   /* CMP $nnnn,X */
                 CP(reg_a_read, GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xde:          /* DEC $nnnn,X */
+            OPCODE_CASE(0xde)   /* DEC $nnnn,X */
                 DEC(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xdf:          /* DCP $nnnn,X */
+            OPCODE_CASE(0xdf)   /* DCP $nnnn,X */
                 DCP(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe0:          /* CPX #$nn */
+            OPCODE_CASE(0xe0)   /* CPX #$nn */
                 CP(reg_x, GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe1:          /* SBC ($nn,X) */
+            OPCODE_CASE(0xe1)   /* SBC ($nn,X) */
                 SBC(GET_IND_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe3:          /* ISB ($nn,X) */
+            OPCODE_CASE(0xe3)   /* ISB ($nn,X) */
                 ISB(2, GET_IND_X, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe4:          /* CPX $nn */
+            OPCODE_CASE(0xe4)   /* CPX $nn */
                 CP(reg_x, GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe5:          /* SBC $nn */
+            OPCODE_CASE(0xe5)   /* SBC $nn */
                 SBC(GET_ZERO, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe6:          /* INC $nn */
+            OPCODE_CASE(0xe6)   /* INC $nn */
                 INC(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe7:          /* ISB $nn */
+            OPCODE_CASE(0xe7)   /* ISB $nn */
                 ISB(2, GET_ZERO, SET_ZERO_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xe8:          /* INX */
+            OPCODE_CASE(0xe8)   /* INX */
                 INX();
-                break;
+                OPCODE_BREAK;
 
-            case 0xe9:          /* SBC #$nn */
-            case 0xeb:          /* USBC #$nn (same as SBC) */
+            OPCODE_CASE(0xe9)   /* SBC #$nn */
+            OPCODE_CASE(0xeb)   /* USBC #$nn (same as SBC) */
                 SBC(GET_IMM, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xec:          /* CPX $nnnn */
+            OPCODE_CASE(0xec)   /* CPX $nnnn */
                 CP(reg_x, GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xed:          /* SBC $nnnn */
+            OPCODE_CASE(0xed)   /* SBC $nnnn */
                 SBC(GET_ABS, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xee:          /* INC $nnnn */
+            OPCODE_CASE(0xee)   /* INC $nnnn */
                 INC(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xef:          /* ISB $nnnn */
+            OPCODE_CASE(0xef)   /* ISB $nnnn */
                 ISB(3, GET_ABS, SET_ABS_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf0:          /* BEQ $nnnn */
+            OPCODE_CASE(0xf0)   /* BEQ $nnnn */
                 BRANCH(LOCAL_ZERO());
-                break;
+                OPCODE_BREAK;
 
-            case 0xf1:          /* SBC ($nn),Y */
+            OPCODE_CASE(0xf1)   /* SBC ($nn),Y */
                 SBC(GET_IND_Y, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf3:          /* ISB ($nn),Y */
+            OPCODE_CASE(0xf3)   /* ISB ($nn),Y */
                 ISB(2, GET_IND_Y_RMW, SET_IND_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf5:          /* SBC $nn,X */
+            OPCODE_CASE(0xf5)   /* SBC $nn,X */
                 SBC(GET_ZERO_X, 2);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf6:          /* INC $nn,X */
+            OPCODE_CASE(0xf6)   /* INC $nn,X */
                 INC(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf7:          /* ISB $nn,X */
+            OPCODE_CASE(0xf7)   /* ISB $nn,X */
                 ISB(2, GET_ZERO_X, SET_ZERO_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xf8:          /* SED */
+            OPCODE_CASE(0xf8)   /* SED */
                 SED();
-                break;
+                OPCODE_BREAK;
 
-            case 0xf9:          /* SBC $nnnn,Y */
+            OPCODE_CASE(0xf9)   /* SBC $nnnn,Y */
                 SBC(GET_ABS_Y, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xfb:          /* ISB $nnnn,Y */
+            OPCODE_CASE(0xfb)   /* ISB $nnnn,Y */
                 ISB(3, GET_ABS_Y_RMW, SET_ABS_Y_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xfd:          /* SBC $nnnn,X */
+            OPCODE_CASE(0xfd)   /* SBC $nnnn,X */
                 SBC(GET_ABS_X, 3);
-                break;
+                OPCODE_BREAK;
 
-            case 0xfe:          /* INC $nnnn,X */
+            OPCODE_CASE(0xfe)   /* INC $nnnn,X */
                 INC(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
+                OPCODE_BREAK;
 
-            case 0xff:          /* ISB $nnnn,X */
+            OPCODE_CASE(0xff)   /* ISB $nnnn,X */
                 ISB(3, GET_ABS_X_RMW, SET_ABS_X_RMW);
-                break;
-        }
+                OPCODE_BREAK;
+        OPCODE_DISPATCH_END
 
 #if !defined(DRIVE_CPU)
         if (maincpu_profiling) {
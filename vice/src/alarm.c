@@ -33,6 +33,7 @@
 #include "alarm.h"
 #include "lib.h"
 #include "log.h"
+#include "perfcounters.h"
 #include "types.h"
 
 
@@ -54,10 +55,19 @@ void alarm_context_init(alarm_context_t *context, const char *name)
 
     context->num_pending_alarms = 0;
     context->next_pending_alarm_clk = CLOCK_MAX;
+    context->next_pending_alarm_idx = -1;
+
+#ifdef FEATURE_PERF_COUNTERS
+    perf_counters_register_alarm_context(context);
+#endif
 }
 
 void alarm_context_destroy(alarm_context_t *context)
 {
+#ifdef FEATURE_PERF_COUNTERS
+    perf_counters_unregister_alarm_context(context);
+#endif
+
     lib_free(context->name);
 
     /* Destroy all the alarms.  */
@@ -111,6 +121,9 @@ static void alarm_init(alarm_t *alarm, alarm_context_t *context,
     alarm->data = data;
 
     alarm->pending_idx = -1;      /* Not pending.  */
+#ifdef FEATURE_PERF_COUNTERS
+    alarm->dispatch_count = 0;
+#endif
 
     /* Add to the head of the alarm list of the alarm context.  */
     if (context->alarms == NULL) {
@@ -164,6 +177,47 @@ void alarm_destroy(alarm_t *alarm)
     lib_free(alarm);
 }
 
+#if ALARM_BACKEND == ALARM_BACKEND_HEAP
+
+void alarm_unset(alarm_t *alarm)
+{
+    alarm_context_t *context;
+    int idx, last;
+
+    idx = alarm->pending_idx;
+
+    if (idx < 0) {
+        return;                 /* Not pending.  */
+    }
+    context = alarm->context;
+
+    last = (int)(--context->num_pending_alarms);
+
+    if (last != idx) {
+        /* Fill the hole with the last heap entry and restore the heap
+           property from there.  */
+        CLOCK old_clk = context->pending_alarms[idx].clk;
+
+        context->pending_alarms[idx].alarm
+            = context->pending_alarms[last].alarm;
+        context->pending_alarms[idx].clk
+            = context->pending_alarms[last].clk;
+        context->pending_alarms[idx].alarm->pending_idx = idx;
+
+        if (context->pending_alarms[idx].clk < old_clk) {
+            alarm_context_heap_sift_up(context, idx);
+        } else {
+            alarm_context_heap_sift_down(context, idx);
+        }
+    }
+
+    alarm_context_update_next_pending(context);
+
+    alarm->pending_idx = -1;
+}
+
+#else /* ALARM_BACKEND_LINEAR */
+
 void alarm_unset(alarm_t *alarm)
 {
     alarm_context_t *context;
@@ -206,6 +260,8 @@ void alarm_unset(alarm_t *alarm)
     alarm->pending_idx = -1;
 }
 
+#endif
+
 void alarm_log_too_many_alarms(void)
 {
     log_error(LOG_DEFAULT, "alarm_set(): Too many alarms set!");
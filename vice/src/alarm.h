@@ -32,6 +32,21 @@
 
 #define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
 
+/* Available backends for keeping track of the pending alarms.
+
+   ALARM_BACKEND_LINEAR keeps the pending alarms in an unsorted array which
+   is scanned completely whenever the earliest alarm changes.
+
+   ALARM_BACKEND_HEAP keeps the same array ordered as an indexed binary
+   min-heap, so the earliest alarm is always at index 0 and setting or
+   unsetting an alarm costs O(log n) instead of O(n).  */
+#define ALARM_BACKEND_LINEAR    0
+#define ALARM_BACKEND_HEAP      1
+
+#ifndef ALARM_BACKEND
+#define ALARM_BACKEND ALARM_BACKEND_HEAP
+#endif
+
 typedef void (*alarm_callback_t)(CLOCK offset, void *data);
 
 /* An alarm.  */
@@ -54,6 +69,11 @@ struct alarm_s {
 
     /* Link to the next and previous alarms in the list.  */
     struct alarm_s *next, *prev;
+
+#ifdef FEATURE_PERF_COUNTERS
+    /* Number of times the alarm has been dispatched.  */
+    uint64_t dispatch_count;
+#endif
 };
 typedef struct alarm_s alarm_t;
 
@@ -107,6 +127,78 @@ inline static CLOCK alarm_context_next_pending_clk(alarm_context_t *context)
     return context->next_pending_alarm_clk;
 }
 
+#if ALARM_BACKEND == ALARM_BACKEND_HEAP
+
+/* Move the pending alarm at `idx' towards the root of the heap until its
+   parent is not later than itself.  */
+inline static void alarm_context_heap_sift_up(alarm_context_t *context, int idx)
+{
+    pending_alarms_t *pending = context->pending_alarms;
+    alarm_t *alarm = pending[idx].alarm;
+    CLOCK clk = pending[idx].clk;
+
+    while (idx > 0) {
+        int parent = (idx - 1) >> 1;
+
+        if (pending[parent].clk <= clk) {
+            break;
+        }
+        pending[idx].alarm = pending[parent].alarm;
+        pending[idx].clk = pending[parent].clk;
+        pending[idx].alarm->pending_idx = idx;
+        idx = parent;
+    }
+
+    pending[idx].alarm = alarm;
+    pending[idx].clk = clk;
+    alarm->pending_idx = idx;
+}
+
+/* Move the pending alarm at `idx' away from the root of the heap until none
+   of its children is earlier than itself.  */
+inline static void alarm_context_heap_sift_down(alarm_context_t *context, int idx)
+{
+    pending_alarms_t *pending = context->pending_alarms;
+    int num = (int)(context->num_pending_alarms);
+    alarm_t *alarm = pending[idx].alarm;
+    CLOCK clk = pending[idx].clk;
+
+    for (;;) {
+        int child = (idx << 1) + 1;
+
+        if (child >= num) {
+            break;
+        }
+        if (child + 1 < num && pending[child + 1].clk < pending[child].clk) {
+            child++;
+        }
+        if (clk <= pending[child].clk) {
+            break;
+        }
+        pending[idx].alarm = pending[child].alarm;
+        pending[idx].clk = pending[child].clk;
+        pending[idx].alarm->pending_idx = idx;
+        idx = child;
+    }
+
+    pending[idx].alarm = alarm;
+    pending[idx].clk = clk;
+    alarm->pending_idx = idx;
+}
+
+inline static void alarm_context_update_next_pending(alarm_context_t *context)
+{
+    if (context->num_pending_alarms > 0) {
+        context->next_pending_alarm_clk = context->pending_alarms[0].clk;
+        context->next_pending_alarm_idx = 0;
+    } else {
+        context->next_pending_alarm_clk = CLOCK_MAX;
+        context->next_pending_alarm_idx = -1;
+    }
+}
+
+#else /* ALARM_BACKEND_LINEAR */
+
 inline static void alarm_context_update_next_pending(alarm_context_t *context)
 {
     CLOCK next_pending_alarm_clk = CLOCK_MAX;
@@ -128,6 +220,8 @@ inline static void alarm_context_update_next_pending(alarm_context_t *context)
     context->next_pending_alarm_idx = next_pending_alarm_idx;
 }
 
+#endif
+
 inline static void alarm_context_dispatch(alarm_context_t *context,
                                           CLOCK cpu_clk)
 {
@@ -140,9 +234,58 @@ inline static void alarm_context_dispatch(alarm_context_t *context,
     idx = context->next_pending_alarm_idx;
     alarm = context->pending_alarms[idx].alarm;
 
+#ifdef FEATURE_PERF_COUNTERS
+    alarm->dispatch_count++;
+#endif
+
     (alarm->callback)(offset, alarm->data);
 }
 
+#if ALARM_BACKEND == ALARM_BACKEND_HEAP
+
+inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
+{
+    alarm_context_t *context;
+    int idx;
+
+    context = alarm->context;
+    idx = alarm->pending_idx;
+
+    if (idx < 0) {
+        int new_idx;
+
+        /* Not pending yet: add.  */
+
+        new_idx = (int)(context->num_pending_alarms);
+        if (new_idx >= (int)ALARM_CONTEXT_MAX_PENDING_ALARMS) {
+            alarm_log_too_many_alarms();
+            return;
+        }
+
+        context->pending_alarms[new_idx].alarm = alarm;
+        context->pending_alarms[new_idx].clk = cpu_clk;
+
+        context->num_pending_alarms++;
+
+        alarm_context_heap_sift_up(context, new_idx);
+    } else {
+        /* Already pending: modify.  */
+
+        CLOCK old_clk = context->pending_alarms[idx].clk;
+
+        context->pending_alarms[idx].clk = cpu_clk;
+        if (cpu_clk < old_clk) {
+            alarm_context_heap_sift_up(context, idx);
+        } else if (cpu_clk > old_clk) {
+            alarm_context_heap_sift_down(context, idx);
+        }
+    }
+
+    alarm_context_update_next_pending(context);
+}
+
+#else /* ALARM_BACKEND_LINEAR */
+
 inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
 {
     alarm_context_t *context;
@@ -185,3 +328,5 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
 }
 
 #endif
+
+#endif
@@ -204,7 +204,36 @@ static void settings_load_from_action(ui_action_map_t *self)
     gtk_widget_show_all(dialog);
 }
 
+/** \brief  Report a failed save of the settings on the UI thread
+ *
+ * \param[in]   unused  extra data (unused)
+ *
+ * \return FALSE to run only once
+ */
+static gboolean settings_save_failed_idle(gpointer unused)
+{
+    vice_gtk3_message_error(NULL, /* current emu window as parent */
+                            "VICE core error",
+                            "Failed to save default settings file");
+    return FALSE;
+}
+
+/** \brief  Called on the save thread when the settings file is written
+ *
+ * \param[in]   result  result of the save, 0 on success
+ * \param[in]   unused  extra data (unused)
+ */
+static void settings_save_done(int result, void *unused)
+{
+    if (result != 0) {
+        g_idle_add(settings_save_failed_idle, NULL);
+    }
+}
+
 /** \brief  Save current settings
+ *
+ * The settings are taken while holding the main lock, the file is written
+ * in the background.
  *
  * \param[in]   self    action map
  */
@@ -213,7 +242,7 @@ static void settings_save_action(ui_action_map_t *self)
     int result;
 
     mainlock_obtain();
-    result = resources_save(NULL);
+    result = resources_save_async(NULL, settings_save_done, NULL);
     mainlock_release();
     if (result != 0) {
         vice_gtk3_message_error(NULL, /* current emu window as parent */
@@ -34,10 +34,12 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "rewind.h"
 #include "uiactions.h"
 #include "uiapi.h"
 #include "uisnapshot.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 #include "actions-snapshot.h"
 
@@ -121,6 +123,24 @@ static void history_playback_stop_action(ui_action_map_t *self)
     event_playback_stop();
 }
 
+/** \brief  Skip back ten seconds in history playback action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_back_action(ui_action_map_t *self)
+{
+    event_playback_skip(-10);
+}
+
+/** \brief  Skip forward ten seconds in history playback action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_forward_action(ui_action_map_t *self)
+{
+    event_playback_skip(10);
+}
+
 /** \brief  Set history milestone action
  *
  * \param[in]   self    action map
@@ -140,6 +160,26 @@ static void history_milestone_reset_action(ui_action_map_t *self)
 }
 /* }}} */
 
+/* {{{ Rewind actions */
+/** \brief  Rewind one frame action
+ *
+ * \param[in]   self    action map
+ */
+static void rewind_frame_action(ui_action_map_t *self)
+{
+    rewind_step_back(1);
+}
+
+/** \brief  Rewind one second action
+ *
+ * \param[in]   self    action map
+ */
+static void rewind_second_action(ui_action_map_t *self)
+{
+    rewind_step_back((int)(vsync_get_refresh_frequency() + 0.5));
+}
+/* }}} */
+
 
 /** \brief  List of snapshot and event-related actions */
 static const ui_action_map_t snapshot_actions[] = {
@@ -178,12 +218,26 @@ static const ui_action_map_t snapshot_actions[] = {
         .handler  = history_playback_stop_action,
         .uithread = true
     },
+    {   .action  = ACTION_HISTORY_PLAYBACK_BACK,
+        .handler = history_playback_back_action
+    },
+    {   .action  = ACTION_HISTORY_PLAYBACK_FORWARD,
+        .handler = history_playback_forward_action
+    },
     {   .action  = ACTION_HISTORY_MILESTONE_SET,
         .handler = history_milestone_set_action
     },
     {   .action  = ACTION_HISTORY_MILESTONE_RESET,
         .handler = history_milestone_reset_action
     },
+
+    /* Rewind actions */
+    {   .action  = ACTION_REWIND_FRAME,
+        .handler = rewind_frame_action
+    },
+    {   .action  = ACTION_REWIND_SECOND,
+        .handler = rewind_second_action
+    },
     UI_ACTION_MAP_TERMINATOR
 };
 
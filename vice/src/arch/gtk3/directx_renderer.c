@@ -115,6 +115,9 @@ static void vice_directx_destroy_context(video_canvas_t *canvas)
 {
     context_t *context;
 
+    /* a frame being rendered is shown with the context */
+    video_canvas_render_wait(canvas);
+
     CANVAS_LOCK();
 
     context = canvas->renderer_context;
@@ -263,47 +266,83 @@ static void vice_directx_update_context(video_canvas_t *canvas, unsigned int wid
     CANVAS_UNLOCK();
 }
 
-/** \brief It's time to draw a complete emulated frame */
-static void vice_directx_refresh_rect(video_canvas_t *canvas,
-                                     unsigned int xs, unsigned int ys,
-                                     unsigned int xi, unsigned int yi,
-                                     unsigned int w, unsigned int h)
+/** \brief  Show a frame rendered on the thread of the canvas */
+static void vice_directx_frame_rendered(video_canvas_t *canvas, void *param)
 {
-    context_t *context;
+    context_t *context = param;
     backbuffer_t *backbuffer;
-    int pixel_data_size_bytes;
+    unsigned int width = context->rendering_width;
+    unsigned int height = context->rendering_height;
 
-    CANVAS_LOCK();
+    render_queue_mark_frame_dirty(context->render_queue,
+                                  context->rendering_y, context->rendering_rows);
 
-    context = canvas->renderer_context;
-    if (!context || !context->render_queue) {
-        CANVAS_UNLOCK();
-        return;
-    }
+    CANVAS_LOCK();
 
-    /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
-    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+    /* Obtain an unused backbuffer to show the frame */
+    backbuffer = render_queue_get_from_pool(context->render_queue, width * height * 4);
 
     if (!backbuffer) {
+        canvas->draw_buffer->refresh_pending = 1;
         CANVAS_UNLOCK();
         return;
     }
+    canvas->draw_buffer->refresh_pending = 0;
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
+    backbuffer->width = width;
+    backbuffer->height = height;
     backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
     backbuffer->interlaced = canvas->videoconfig->interlaced;
     backbuffer->interlace_field = canvas->videoconfig->interlace_field;
 
+    render_queue_copy_frame(context->render_queue, backbuffer);
+
+    render_queue_enqueue_for_display(context->render_queue, backbuffer);
+    render_thread_push_job(context->render_thread, render_thread_render);
     CANVAS_UNLOCK();
+}
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+/** \brief It's time to draw a complete emulated frame */
+static void vice_directx_refresh_rect(video_canvas_t *canvas,
+                                     unsigned int xs, unsigned int ys,
+                                     unsigned int xi, unsigned int yi,
+                                     unsigned int w, unsigned int h)
+{
+    context_t *context;
+    unsigned char *frame;
+    unsigned int width;
+    unsigned int height;
+    bool reset;
 
     CANVAS_LOCK();
-    render_queue_enqueue_for_display(context->render_queue, backbuffer);
-    render_thread_push_job(context->render_thread, render_thread_render);
+
+    context = canvas->renderer_context;
+    if (!context || !context->render_queue) {
+        CANVAS_UNLOCK();
+        return;
+    }
+
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+
     CANVAS_UNLOCK();
+
+    /* the frame may still be rendered from the last call */
+    video_canvas_render_wait(canvas);
+
+    /* Render into the kept frame, which needs all of the screen when new */
+    frame = render_queue_get_frame(context->render_queue, width, height, &reset);
+    if (reset) {
+        video_canvas_refresh_all(canvas);
+        return;
+    }
+
+    context->rendering_width = width;
+    context->rendering_height = height;
+    context->rendering_y = yi;
+    context->rendering_rows = h;
+    video_canvas_render_async(canvas, frame, w, h, xs, ys, xi, yi, width * 4,
+                              vice_directx_frame_rendered, context);
 }
 
 static void vice_directx_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *canvas)
@@ -343,13 +382,34 @@ static void vice_directx_set_palette(video_canvas_t *canvas)
     video_render_initraw(canvas->videoconfig);
 }
 
+/** \brief Check if the render thread has taken the last frame */
+static bool vice_directx_ready_for_frame(video_canvas_t *canvas)
+{
+    context_t *context;
+    bool ready = true;
+
+    if (video_canvas_render_busy(canvas)) {
+        return false;
+    }
+
+    CANVAS_LOCK();
+    context = canvas->renderer_context;
+    if (context && context->render_queue) {
+        ready = render_queue_length(context->render_queue) == 0;
+    }
+    CANVAS_UNLOCK();
+
+    return ready;
+}
+
 vice_renderer_backend_t vice_directx_backend = {
     vice_directx_initialise_canvas,
     vice_directx_update_context,
     vice_directx_destroy_context,
     vice_directx_refresh_rect,
     vice_directx_on_ui_frame_clock,
-    vice_directx_set_palette
+    vice_directx_set_palette,
+    vice_directx_ready_for_frame
 };
 
 #endif
@@ -354,12 +354,15 @@ static void build_render_bitmap(vice_directx_renderer_context_t *context, backbu
             ID2D1Bitmap *swap_bitmap              = context->previous_frame_render_bitmap;
             unsigned int swap_width               = context->previous_frame_bitmap_width;
             unsigned int swap_height              = context->previous_frame_bitmap_height;
+            unsigned int swap_seq                 = context->previous_frame_bitmap_seq;
             context->previous_frame_render_bitmap = context->render_bitmap;
             context->previous_frame_bitmap_width  = context->bitmap_width;
             context->previous_frame_bitmap_height = context->bitmap_height;
+            context->previous_frame_bitmap_seq    = context->bitmap_seq;
             context->render_bitmap                = swap_bitmap;
             context->bitmap_width                 = swap_width;
             context->bitmap_height                = swap_height;
+            context->bitmap_seq                   = swap_seq;
             context->current_interlace_field      = backbuffer->interlace_field;
         }
 
@@ -394,18 +397,33 @@ static void build_render_bitmap(vice_directx_renderer_context_t *context, backbu
 
             context->bitmap_width  = backbuffer->width;
             context->bitmap_height = backbuffer->height;
+            context->bitmap_seq    = 0;
         }
 
         context->interlaced = backbuffer->interlaced;
         context->pixel_aspect_ratio = backbuffer->pixel_aspect_ratio;
 
-        /* Copy the emulated screen to the Bitmap */
+        /* Copy the emulated screen to the Bitmap, only the changed rows if
+           the bitmap has the frame before this one */
         D2D1_RECT_U bitmap_rect = D2D1::RectU(0, 0, backbuffer->width, backbuffer->height);
+        unsigned char *pixel_data = backbuffer->pixel_data;
+
+        if (!backbuffer->interlaced
+            && context->bitmap_seq != 0
+            && backbuffer->frame_seq == context->bitmap_seq + 1) {
+            bitmap_rect = D2D1::RectU(0, backbuffer->dirty_y, backbuffer->width, backbuffer->dirty_y + backbuffer->dirty_height);
+            pixel_data += backbuffer->dirty_y * backbuffer->width * 4;
+        }
+        context->bitmap_seq = backbuffer->frame_seq;
+
+        if (bitmap_rect.bottom == bitmap_rect.top) {
+            return;
+        }
 
         result =
             context->render_bitmap->CopyFromMemory(
                 &bitmap_rect,
-                backbuffer->pixel_data,
+                pixel_data,
                 backbuffer->width * 4);
         if (FAILED(result)) {
             vice_directx_impl_log_windows_error("CopyFromMemory");
@@ -96,6 +96,9 @@ typedef struct vice_directx_renderer_context_s {
     /** \brief size of the current gpu bitmap in pixels */
     unsigned int bitmap_height;
 
+    /** \brief number of the frame last copied to the current gpu bitmap, 0 if none */
+    unsigned int bitmap_seq;
+
     /** \brief Direct2D bitmap used to retain the last frame */
     ID2D1Bitmap *previous_frame_render_bitmap;
 
@@ -105,6 +108,9 @@ typedef struct vice_directx_renderer_context_s {
     /** \brief size of the current gpu bitmap in pixels */
     unsigned int previous_frame_bitmap_height;
 
+    /** \brief number of the frame last copied to the previous gpu bitmap */
+    unsigned int previous_frame_bitmap_seq;
+
     /** \brief Where emu bitmap gets placed on the target surface */
     D2D1_RECT_F render_dest_rect;
 
@@ -138,6 +144,13 @@ typedef struct vice_directx_renderer_context_s {
     /** \brief pixel aspect ratio of the next emulated frame */
     float pixel_aspect_ratio_next;
 
+    /** \brief size of the frame being rendered on the thread of the canvas,
+     *         and the rows of it that are rendered */
+    unsigned int rendering_width;
+    unsigned int rendering_height;
+    unsigned int rendering_y;
+    unsigned int rendering_rows;
+
     /** \brief if the next render should use interlaced mode */
     bool interlaced;
 
@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <gtk/gtk.h>
 #include <math.h>
+#include <string.h>
 
 #ifdef MACOS_COMPILE
 #include <CoreGraphics/CGDirectDisplay.h>
@@ -57,6 +58,11 @@
 #include "macOS-util.h"
 #endif
 
+/* Log the time from a finished emulated frame to its present, summarised
+   every RENDER_LATENCY_FRAMES frames */
+/* #define DEBUG_RENDER_LATENCY */
+#define RENDER_LATENCY_FRAMES 250
+
 log_t opengl_log = LOG_DEFAULT;
 
 #define CANVAS_LOCK() pthread_mutex_lock(&canvas->lock)
@@ -149,6 +155,9 @@ static void vice_opengl_destroy_context(video_canvas_t *canvas)
 {
     context_t *context;
 
+    /* a frame being rendered is shown with the context */
+    video_canvas_render_wait(canvas);
+
     CANVAS_LOCK();
 
     context = canvas->renderer_context;
@@ -209,6 +218,17 @@ static void on_widget_realized(GtkWidget *widget, gpointer data)
 
     glGenTextures(1, &context->current_frame_texture);
     glGenTextures(1, &context->previous_frame_texture);
+    context->current_texture_width      = 0;
+    context->current_texture_height     = 0;
+    context->previous_texture_width     = 0;
+    context->previous_texture_height    = 0;
+    context->current_texture_seq        = 0;
+    context->previous_texture_seq       = 0;
+
+    context->texture_storage_supported  = GLEW_ARB_texture_storage ? true : false;
+    context->upload_buffers_supported   = !context->gl_context_is_legacy && GLEW_ARB_buffer_storage;
+    context->upload_buffer_size         = 0;
+    context->upload_buffer_next         = 0;
 
     vice_opengl_renderer_clear_current(context);
 
@@ -279,6 +299,8 @@ static void on_widget_resized(GtkWidget *widget, GtkAllocation *allocation, gpoi
     context->gl_backing_layer_width     = allocation->width    * gtk_scale;
     context->gl_backing_layer_height    = allocation->height   * gtk_scale;
 
+    context->redraw_needed = true;
+
     CANVAS_UNLOCK();
 
     /* Update the size of the native child window to match the gtk drawing area */
@@ -334,44 +356,39 @@ static void vice_opengl_update_context(video_canvas_t *canvas, unsigned int widt
     CANVAS_UNLOCK();
 }
 
-/** \brief It's time to draw a complete emulated frame */
-static void vice_opengl_refresh_rect(video_canvas_t *canvas,
-                                     unsigned int xs, unsigned int ys,
-                                     unsigned int xi, unsigned int yi,
-                                     unsigned int w, unsigned int h)
+/** \brief  Show a frame rendered on the thread of the canvas */
+static void vice_opengl_frame_rendered(video_canvas_t *canvas, void *param)
 {
-    context_t *context;
+    context_t *context = param;
     backbuffer_t *backbuffer;
-    int pixel_data_size_bytes;
+    unsigned int width = context->rendering_width;
+    unsigned int height = context->rendering_height;
 
-    CANVAS_LOCK();
+    render_queue_mark_frame_dirty(context->render_queue,
+                                  context->rendering_y, context->rendering_rows);
 
-    context = canvas->renderer_context;
-    if (!context || !context->render_queue) {
-        CANVAS_UNLOCK();
-        return;
-    }
+    CANVAS_LOCK();
 
-    /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
-    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+    /* Obtain an unused backbuffer to show the frame, the changed rows are
+       kept for the next one if there is none */
+    backbuffer = render_queue_get_from_pool(context->render_queue, width * height * 4);
 
     if (!backbuffer) {
+        canvas->draw_buffer->refresh_pending = 1;
         CANVAS_UNLOCK();
         return;
     }
+    canvas->draw_buffer->refresh_pending = 0;
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
+    backbuffer->width = width;
+    backbuffer->height = height;
     backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
     backbuffer->interlaced = canvas->videoconfig->interlaced;
     backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    backbuffer->frame_tick = tick_now();
 
-    CANVAS_UNLOCK();
-
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+    render_queue_copy_frame(context->render_queue, backbuffer);
 
-    CANVAS_LOCK();
     if (context->render_thread) {
         render_queue_enqueue_for_display(context->render_queue, backbuffer);
         render_thread_push_job(context->render_thread, render_thread_render);
@@ -382,6 +399,78 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
     CANVAS_UNLOCK();
 }
 
+/** \brief Check if the render thread has taken the last frame
+ *
+ * Neither the filters nor the render thread may still be busy with it, and
+ * while rendering is skipped nothing is shown at all.
+ */
+static bool vice_opengl_ready_for_frame(video_canvas_t *canvas)
+{
+    context_t *context;
+    bool ready = true;
+
+    if (video_canvas_render_busy(canvas)) {
+        return false;
+    }
+
+    CANVAS_LOCK();
+    context = canvas->renderer_context;
+    if (context && context->render_queue) {
+        ready = !context->render_skip
+                && render_queue_length(context->render_queue) == 0;
+    }
+    CANVAS_UNLOCK();
+
+    return ready;
+}
+
+/** \brief It's time to draw a complete emulated frame */
+static void vice_opengl_refresh_rect(video_canvas_t *canvas,
+                                     unsigned int xs, unsigned int ys,
+                                     unsigned int xi, unsigned int yi,
+                                     unsigned int w, unsigned int h)
+{
+    context_t *context;
+    unsigned char *frame;
+    unsigned int width;
+    unsigned int height;
+    bool reset;
+
+    CANVAS_LOCK();
+
+    context = canvas->renderer_context;
+    if (!context || !context->render_queue) {
+        CANVAS_UNLOCK();
+        return;
+    }
+
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+
+    CANVAS_UNLOCK();
+
+    /* the frame may still be rendered from the last call */
+    video_canvas_render_wait(canvas);
+
+    /*
+     * Render into the kept frame rather than straight into a backbuffer, so
+     * that the core can pass only the rows that changed. A new frame has
+     * nothing in it yet, so the whole screen is rendered first.
+     */
+    frame = render_queue_get_frame(context->render_queue, width, height, &reset);
+    if (reset) {
+        video_canvas_refresh_all(canvas);
+        return;
+    }
+
+    context->rendering_width = width;
+    context->rendering_height = height;
+    context->rendering_y = yi;
+    context->rendering_rows = h;
+    video_canvas_render_async(canvas, frame, w, h, xs, ys, xi, yi, width * 4,
+                              vice_opengl_frame_rendered, context);
+}
+
 
 #ifdef MACOS_COMPILE
 static void macos_set_host_mouse_visibility(GtkWindow *gtk_window)
@@ -473,14 +562,17 @@ static void vice_opengl_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *
      * of the GTK/GDK window.
      *
      * So, each GdkFrameClock event, check if we are currently paused, and if we
-     * are, queue up a refresh of the existing emu frame.
+     * are, queue up a refresh of the existing emu frame. The same is needed
+     * after a resize, as a screen that doesn't change sends no new frames.
      *
      * This ensures that resizing while paused doesn't glitch like busy win95,
      * and also fixes various issues on some crappy X11 setups :)
      */
 
-    if (ui_pause_active() || monitor_is_inside_monitor() || machine_is_jammed()) {
+    if (ui_pause_active() || monitor_is_inside_monitor() || machine_is_jammed()
+        || context->redraw_needed) {
         render_thread_push_job(context->render_thread, render_thread_render);
+        context->redraw_needed = false;
     }
 
 #ifdef MACOS_COMPILE
@@ -494,19 +586,29 @@ static void vice_opengl_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *
 #endif
 }
 
-static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
+/** \brief Take over the frame properties of a new backbuffer.
+ *
+ *  Must be called with the canvas lock held, as the layout calculation
+ *  reads these values.
+ */
+static void update_frame_properties(context_t *context, backbuffer_t *backbuffer)
 {
-    /*
-     * Update the OpenGL texture with the new backbuffer bitmap
-     */
-
     if (backbuffer->interlace_field != context->current_interlace_field) {
         /* Retain the previous texture to use in interlaced mode */
         GLuint swap_texture                 = context->previous_frame_texture;
+        unsigned int swap_texture_width     = context->previous_texture_width;
+        unsigned int swap_texture_height    = context->previous_texture_height;
+        unsigned int swap_texture_seq       = context->previous_texture_seq;
         context->previous_frame_texture     = context->current_frame_texture;
         context->previous_frame_width       = context->current_frame_width;
         context->previous_frame_height      = context->current_frame_height;
+        context->previous_texture_width     = context->current_texture_width;
+        context->previous_texture_height    = context->current_texture_height;
+        context->previous_texture_seq       = context->current_texture_seq;
         context->current_frame_texture      = swap_texture;
+        context->current_texture_width      = swap_texture_width;
+        context->current_texture_height     = swap_texture_height;
+        context->current_texture_seq        = swap_texture_seq;
         context->current_interlace_field    = backbuffer->interlace_field;
     }
 
@@ -514,19 +616,172 @@ static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
     context->current_frame_height   = backbuffer->height;
     context->interlaced             = backbuffer->interlaced;
     context->pixel_aspect_ratio     = backbuffer->pixel_aspect_ratio;
+}
+
+/** \brief Delete the upload buffers, waiting for uploads from them to finish. */
+static void upload_buffers_free(context_t *context)
+{
+    int i;
+
+    if (context->upload_buffer_size == 0) {
+        return;
+    }
+
+    for (i = 0; i < VICE_OPENGL_UPLOAD_BUFFERS; i++) {
+        if (context->upload_buffer_fence[i]) {
+            glClientWaitSync(context->upload_buffer_fence[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(context->upload_buffer_fence[i]);
+            context->upload_buffer_fence[i] = NULL;
+        }
+        if (context->upload_buffer_data[i]) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->upload_buffer[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            context->upload_buffer_data[i] = NULL;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(VICE_OPENGL_UPLOAD_BUFFERS, context->upload_buffer);
+    context->upload_buffer_size = 0;
+}
+
+/** \brief Create the upload buffers, big enough for \a size bytes each.
+ *
+ *  Their storage is immutable and mapped once for good, so an upload is
+ *  a copy into memory the GPU reads from directly, without the driver
+ *  copying the pixels again or waiting for the texture to be unused.
+ *
+ *  \return true on success, else the pixels are uploaded from the backbuffer
+ */
+static bool upload_buffers_create(context_t *context, size_t size)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    int i;
+
+    upload_buffers_free(context);
+
+    glGenBuffers(VICE_OPENGL_UPLOAD_BUFFERS, context->upload_buffer);
+    context->upload_buffer_size = size;
+    context->upload_buffer_next = 0;
+
+    for (i = 0; i < VICE_OPENGL_UPLOAD_BUFFERS; i++) {
+        context->upload_buffer_fence[i] = NULL;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->upload_buffer[i]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        context->upload_buffer_data[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        if (context->upload_buffer_data[i] == NULL) {
+            log_warning(opengl_log, "Cannot map pixel buffer, uploading frames without.");
+            upload_buffers_free(context);
+            context->upload_buffers_supported = false;
+            return false;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return true;
+}
+
+/** \brief Upload rows of a backbuffer to the bound frame texture. */
+static void upload_rows(context_t *context, backbuffer_t *backbuffer, unsigned int y, unsigned int rows)
+{
+    const uint8_t *pixels = backbuffer->pixel_data + y * backbuffer->width * 4;
+    size_t len = (size_t)rows * backbuffer->width * 4;
+    unsigned int slot;
+
+    if (!context->upload_buffers_supported
+        || (len > context->upload_buffer_size && !upload_buffers_create(context, (size_t)backbuffer->width * backbuffer->height * 4))) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, backbuffer->width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        return;
+    }
 
+    /* Wait until the GPU is done with the last upload from this buffer,
+       which with a ring of them is usually long since the case */
+    slot = context->upload_buffer_next;
+    context->upload_buffer_next = (slot + 1) % VICE_OPENGL_UPLOAD_BUFFERS;
+    if (context->upload_buffer_fence[slot]) {
+        glClientWaitSync(context->upload_buffer_fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(context->upload_buffer_fence[slot]);
+    }
+
+    memcpy(context->upload_buffer_data[slot], pixels, len);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->upload_buffer[slot]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, backbuffer->width, rows, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    context->upload_buffer_fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/** \brief Upload a backbuffer to the current frame texture.
+ *
+ *  Only touches state owned by the render thread, so this runs without
+ *  the canvas lock and doesn't stall the emulation thread while the
+ *  driver copies the pixels.
+ */
+static void update_frame_texture(context_t *context, backbuffer_t *backbuffer)
+{
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, context->current_frame_texture);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->width);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, backbuffer->pixel_data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (context->current_texture_width == backbuffer->width
+        && context->current_texture_height == backbuffer->height
+        && !backbuffer->interlaced
+        && context->current_texture_seq != 0
+        && backbuffer->frame_seq == context->current_texture_seq + 1) {
+        /* The texture has the frame before this one, only upload the rows
+           that changed since */
+        if (backbuffer->dirty_height) {
+            upload_rows(context, backbuffer, backbuffer->dirty_y, backbuffer->dirty_height);
+        }
+    } else if (context->current_texture_width == backbuffer->width
+        && context->current_texture_height == backbuffer->height) {
+        /* Same size as last time, just replace the pixels rather than having
+           the driver reallocate the texture storage for every frame */
+        upload_rows(context, backbuffer, 0, backbuffer->height);
+    } else {
+        if (context->texture_storage_supported) {
+            /* Immutable storage can't change size, so start over with a
+               new texture */
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glDeleteTextures(1, &context->current_frame_texture);
+            glGenTextures(1, &context->current_frame_texture);
+            glBindTexture(GL_TEXTURE_2D, context->current_frame_texture);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, backbuffer->width, backbuffer->height);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        context->current_texture_width  = backbuffer->width;
+        context->current_texture_height = backbuffer->height;
+        upload_rows(context, backbuffer, 0, backbuffer->height);
+    }
+    context->current_texture_seq = backbuffer->frame_seq;
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+#ifdef DEBUG_RENDER_LATENCY
+static void log_latency(context_t *context, tick_t frame_tick)
+{
+    tick_t latency = tick_now_delta(frame_tick);
+
+    context->latency_total += latency;
+    if (latency > context->latency_max) {
+        context->latency_max = latency;
+    }
+
+    if (++context->latency_frames == RENDER_LATENCY_FRAMES) {
+        log_message(opengl_log, "Frame to present latency: avg %u us, max %u us",
+                    TICK_TO_MICRO(context->latency_total / RENDER_LATENCY_FRAMES),
+                    TICK_TO_MICRO(context->latency_max));
+        context->latency_frames = 0;
+        context->latency_total = 0;
+        context->latency_max = 0;
+    }
+}
+#endif
+
 static void legacy_render(video_canvas_t *canvas, float scale_x, float scale_y)
 {
     /* Used when OpenGL 3.2+ is NOT available */
@@ -731,6 +986,7 @@ static void render(void *job_data, void *pool_data)
     video_canvas_t *canvas = pool_data;
     vice_opengl_renderer_context_t *context = (vice_opengl_renderer_context_t *)canvas->renderer_context;
     backbuffer_t *backbuffer;
+    tick_t frame_tick = 0;
     int vsync = 1;
     float scale_x = 1.0f;
     float scale_y = 1.0f;
@@ -772,9 +1028,7 @@ static void render(void *job_data, void *pool_data)
     vice_opengl_renderer_make_current(context);
 
     if (backbuffer) {
-        /* Upload the frame(s) to the GPU and then return it */
-        update_frame_textures(context, backbuffer);
-        render_queue_return_to_pool(context->render_queue, backbuffer);
+        update_frame_properties(context, backbuffer);
     }
 
     /*
@@ -826,6 +1080,13 @@ static void render(void *job_data, void *pool_data)
 
     CANVAS_UNLOCK();
 
+    if (backbuffer) {
+        /* Upload the frame to the GPU and then return it */
+        frame_tick = backbuffer->frame_tick;
+        update_frame_texture(context, backbuffer);
+        render_queue_return_to_pool(context->render_queue, backbuffer);
+    }
+
     vice_opengl_renderer_set_viewport(context);
 
     /* Enable or disable vsync as needed */
@@ -850,6 +1111,12 @@ static void render(void *job_data, void *pool_data)
     vice_opengl_renderer_present_backbuffer(context);
     glFinish();
 
+#ifdef DEBUG_RENDER_LATENCY
+    if (backbuffer) {
+        log_latency(context, frame_tick);
+    }
+#endif
+
     vice_opengl_renderer_clear_current(context);
 
     RENDER_UNLOCK();
@@ -1023,5 +1290,6 @@ vice_renderer_backend_t vice_opengl_backend = {
     vice_opengl_destroy_context,
     vice_opengl_refresh_rect,
     vice_opengl_on_ui_frame_clock,
-    vice_opengl_set_palette
+    vice_opengl_set_palette,
+    vice_opengl_ready_for_frame
 };
@@ -38,6 +38,7 @@
 
 #include <stdbool.h>
 
+#include "archdep_tick.h"
 #include "render_thread.h"
 #include "videoarch.h"
 
@@ -47,6 +48,9 @@
  */
 extern vice_renderer_backend_t vice_opengl_backend;
 
+/** \brief Number of pixel buffers the frames are uploaded through */
+#define VICE_OPENGL_UPLOAD_BUFFERS 3
+
 /** \brief Rendering context for the OpenGL backend.
  *  \sa video_canvas_s::renderer_context */
 typedef struct vice_opengl_renderer_context_s {
@@ -59,6 +63,10 @@ typedef struct vice_opengl_renderer_context_s {
     /** \brief While true, render jobs will be skipped. Used during resize on macOS. */
     bool render_skip;
 
+    /** \brief The widget was resized, the current frame has to be shown again
+     *         as the emulation doesn't send unchanged frames */
+    bool redraw_needed;
+
     /** \brief A 'pool' of one thread used to render backbuffers */
     render_thread_t render_thread;
 
@@ -139,6 +147,12 @@ typedef struct vice_opengl_renderer_context_s {
     GLuint current_frame_texture;
     unsigned int current_frame_width;
     unsigned int current_frame_height;
+
+    /** \brief size of the storage currently allocated for current_frame_texture */
+    unsigned int current_texture_width;
+    unsigned int current_texture_height;
+    /** \brief number of the frame last uploaded to current_frame_texture, 0 if none */
+    unsigned int current_texture_seq;
     bool interlaced;
     int current_interlace_field;
     float pixel_aspect_ratio;
@@ -148,6 +162,30 @@ typedef struct vice_opengl_renderer_context_s {
     unsigned int previous_frame_width;
     unsigned int previous_frame_height;
 
+    /** \brief size of the storage currently allocated for previous_frame_texture */
+    unsigned int previous_texture_width;
+    unsigned int previous_texture_height;
+    unsigned int previous_texture_seq;
+
+    /** \brief the frame textures get immutable storage (ARB_texture_storage) */
+    bool texture_storage_supported;
+
+    /** \brief frames are uploaded through persistently mapped pixel buffers
+     *         (ARB_buffer_storage) */
+    bool upload_buffers_supported;
+
+    /** \brief ring of pixel unpack buffers the frames are uploaded through,
+     *         with their mapping and the fence of the last upload from each */
+    GLuint upload_buffer[VICE_OPENGL_UPLOAD_BUFFERS];
+    uint8_t *upload_buffer_data[VICE_OPENGL_UPLOAD_BUFFERS];
+    GLsync upload_buffer_fence[VICE_OPENGL_UPLOAD_BUFFERS];
+
+    /** \brief size of each upload buffer, 0 if not created yet */
+    size_t upload_buffer_size;
+
+    /** \brief the upload buffer to use next */
+    unsigned int upload_buffer_next;
+
     /** \brief size of the next frame to be emulated */
     unsigned int emulated_width_next;
 
@@ -157,12 +195,25 @@ typedef struct vice_opengl_renderer_context_s {
     /** \brief pixel aspect ratio of the next frame to be emulated */
     float pixel_aspect_ratio_next;
 
+    /** \brief size of the frame being rendered on the thread of the canvas,
+     *         and the rows of it that are rendered */
+    unsigned int rendering_width;
+    unsigned int rendering_height;
+    unsigned int rendering_y;
+    unsigned int rendering_rows;
+
     /** \brief when the last frame was rendered */
     unsigned long last_render_time;
 
     /** \brief cached value of the vsync resource to avoid setting it each frame */
     unsigned long cached_vsync_resource;
 
+    /** \brief frames, total and worst frame to present latency since the
+     *         last DEBUG_RENDER_LATENCY report */
+    unsigned int latency_frames;
+    tick_t latency_total;
+    tick_t latency_max;
+
 } vice_opengl_renderer_context_t;
 
 void vice_opengl_renderer_create_child_view(GtkWidget *widget, vice_opengl_renderer_context_t *context);
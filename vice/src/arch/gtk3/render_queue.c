@@ -32,10 +32,13 @@
 #include <pthread.h>
 #include <string.h>
 
+#include "archdep.h"
+#include "frametrace.h"
 #include "lib.h"
+#include "metrics.h"
 #include "vsyncapi.h"
 
-#define LOCK() pthread_mutex_lock(&rq->lock)
+#define LOCK() render_queue_lock(rq)
 #define UNLOCK() pthread_mutex_unlock(&rq->lock)
 
 typedef struct vice_render_queue_s {
@@ -58,10 +61,35 @@ typedef struct vice_render_queue_s {
 
     /** Allows discarding of late buffer returns */
     unsigned int backbuffer_generation;
+
+    /** The last rendered frame, only used by the emulation thread */
+    unsigned char *frame;
+    unsigned int frame_width;
+    unsigned int frame_height;
+
+    /** Number of the last frame copied to a backbuffer */
+    unsigned int frame_seq;
+
+    /** Rows of the frame changed since it was last copied to a backbuffer */
+    unsigned int dirty_start;
+    unsigned int dirty_end;
 } render_queue_t;
 
+/* Take the lock, the time spent waiting for another thread to release it
+   shows up in frame traces */
+static void render_queue_lock(render_queue_t *rq)
+{
+    if (pthread_mutex_trylock(&rq->lock) == 0) {
+        return;
+    }
+
+    FRAMETRACE_BEGIN(FRAMETRACE_RENDER_QUEUE);
+    pthread_mutex_lock(&rq->lock);
+    FRAMETRACE_END(FRAMETRACE_RENDER_QUEUE);
+}
+
 static void free_backbuffer(backbuffer_t *backbuffer) {
-    lib_free(backbuffer->pixel_data);
+    archdep_large_free(backbuffer->pixel_data);
     lib_free(backbuffer);
 }
 
@@ -81,11 +109,15 @@ void *render_queue_create(void)
     for (i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
 
         bb = lib_malloc(sizeof(backbuffer_t));
-        bb->pixel_data = lib_malloc(0);
+        bb->pixel_data = NULL;
         bb->pixel_data_size_bytes = 0;
         bb->width = 0;
         bb->height = 0;
         bb->pixel_aspect_ratio = 0.0f;
+        bb->frame_tick = 0;
+        bb->frame_seq = 0;
+        bb->dirty_y = 0;
+        bb->dirty_height = 0;
 
         rq->backbuffer_stack[rq->backbuffer_stack_size++] = bb;
     }
@@ -105,11 +137,14 @@ void render_queue_destroy(void *render_queue)
     }
 
     /* The backbuffers queued for rendering */
+    metrics_gauge_add(METRIC_RENDER_QUEUE_DEPTH, -(double)rq->render_queue_length);
     for (i = 0; i < rq->render_queue_length; i++) {
         free_backbuffer(rq->render_queue[rq->render_queue_next++]);
         rq->render_queue_next = rq->render_queue_next % RENDER_QUEUE_MAX_BACKBUFFERS;
     }
 
+    archdep_large_free(rq->frame);
+
     pthread_mutex_destroy(&rq->lock);
     lib_free(render_queue);
 }
@@ -137,14 +172,15 @@ backbuffer_t *render_queue_get_from_pool(void *render_queue, int pixel_data_size
 
     /* Make sure there's at least the requested size in bytes */
     if (bb->pixel_data_size_bytes < pixel_data_size_bytes) {
-        lib_free(bb->pixel_data);
-        bb->pixel_data = lib_calloc(pixel_data_size_bytes, 1);
+        archdep_large_free(bb->pixel_data);
+        bb->pixel_data = archdep_large_alloc(pixel_data_size_bytes);
         bb->pixel_data_size_bytes = pixel_data_size_bytes;
     }
 
     bb->width = 0;
     bb->height = 0;
     bb->pixel_aspect_ratio = 0.0f;
+    bb->frame_tick = 0;
 
     return bb;
 }
@@ -162,6 +198,8 @@ void render_queue_enqueue_for_display(void *render_queue, backbuffer_t *backbuff
     rq->render_queue_length++;
 
     UNLOCK();
+
+    metrics_gauge_add(METRIC_RENDER_QUEUE_DEPTH, 1.0);
 }
 
 unsigned int render_queue_length(void *render_queue)
@@ -199,6 +237,8 @@ backbuffer_t *render_queue_dequeue_for_display(void *render_queue)
 
     UNLOCK();
 
+    metrics_gauge_add(METRIC_RENDER_QUEUE_DEPTH, -1.0);
+
     return backbuffer;
 }
 
@@ -215,3 +255,89 @@ void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer)
 
     UNLOCK();
 }
+
+/****/
+
+/** \brief Get the frame kept for rendering only the changed part of the screen
+ *
+ *  The frame keeps what was rendered before, so only the changed rows have to
+ *  be rendered again and marked with render_queue_mark_frame_dirty().
+ *
+ *  \param[in]  render_queue  render queue
+ *  \param[in]  width         width of the frame in pixels
+ *  \param[in]  height        height of the frame in pixels
+ *  \param[out] reset         set to true if the frame was just made, then all
+ *                            of it has to be rendered
+ *
+ *  \return the frame, 4 bytes per pixel
+ */
+unsigned char *render_queue_get_frame(void *render_queue, unsigned int width, unsigned int height, bool *reset)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+
+    *reset = false;
+
+    if (!rq->frame || rq->frame_width != width || rq->frame_height != height) {
+        archdep_large_free(rq->frame);
+        rq->frame = archdep_large_alloc(width * height * 4);
+        rq->frame_width = width;
+        rq->frame_height = height;
+        rq->dirty_start = 0;
+        rq->dirty_end = height;
+        *reset = true;
+    }
+
+    return rq->frame;
+}
+
+/** \brief Note that rows of the frame were rendered again */
+void render_queue_mark_frame_dirty(void *render_queue, unsigned int y, unsigned int height)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    unsigned int end;
+
+    if (y >= rq->frame_height || height == 0) {
+        return;
+    }
+    end = y + height;
+    if (end > rq->frame_height) {
+        end = rq->frame_height;
+    }
+
+    if (rq->dirty_start >= rq->dirty_end) {
+        rq->dirty_start = y;
+        rq->dirty_end = end;
+    } else {
+        if (y < rq->dirty_start) {
+            rq->dirty_start = y;
+        }
+        if (end > rq->dirty_end) {
+            rq->dirty_end = end;
+        }
+    }
+}
+
+/** \brief Copy the frame to a backbuffer for display
+ *
+ *  The backbuffer gets the next frame number and the rows changed since the
+ *  frame was last copied, so the render thread can upload only those when it
+ *  has seen the frame before it.
+ */
+void render_queue_copy_frame(void *render_queue, backbuffer_t *backbuffer)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+
+    memcpy(backbuffer->pixel_data, rq->frame, rq->frame_width * rq->frame_height * 4);
+
+    backbuffer->frame_seq = ++rq->frame_seq;
+    if (rq->dirty_start < rq->dirty_end) {
+        backbuffer->dirty_y = rq->dirty_start;
+        backbuffer->dirty_height = rq->dirty_end - rq->dirty_start;
+    } else {
+        backbuffer->dirty_y = 0;
+        backbuffer->dirty_height = 0;
+    }
+
+    rq->dirty_start = 0;
+    rq->dirty_end = 0;
+}
@@ -31,6 +31,8 @@
 
 #include <stdbool.h>
 
+#include "archdep_tick.h"
+
 typedef struct {
     bool interlaced;
     int interlace_field;
@@ -39,6 +41,13 @@ typedef struct {
     unsigned int width;
     unsigned int height;
     float pixel_aspect_ratio;
+    /** when the emulated frame was handed over for rendering */
+    tick_t frame_tick;
+    /** number of the frame, one more than the frame handed over before */
+    unsigned int frame_seq;
+    /** rows that changed since the frame handed over before */
+    unsigned int dirty_y;
+    unsigned int dirty_height;
 } backbuffer_t;
 
 void *render_queue_create(void);
@@ -50,4 +59,8 @@ unsigned int render_queue_length(void *render_queue);
 backbuffer_t *render_queue_dequeue_for_display(void *render_queue);
 void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer);
 
+unsigned char *render_queue_get_frame(void *render_queue, unsigned int width, unsigned int height, bool *reset);
+void render_queue_mark_frame_dirty(void *render_queue, unsigned int y, unsigned int height);
+void render_queue_copy_frame(void *render_queue, backbuffer_t *backbuffer);
+
 #endif /* #ifndef VICE_RENDER_QUEUE_H */
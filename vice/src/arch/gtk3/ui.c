@@ -2620,7 +2620,9 @@ bool ui_pause_loop_iteration(void)
         return false;
     }
 
-    /* Otherwise give the UI the lock for a while */
+    /* Otherwise give the UI the lock for a while, with the status bars
+       showing what was changed while paused */
+    ui_statusbar_publish_machine_state();
     mainlock_yield_and_sleep(tick_per_second() / 60);
 
     /* Another iteration needed unless pause was disabled during sleep */
@@ -589,6 +589,14 @@ static ui_menu_item_t snapshot_menu[] = {
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_HISTORY_PLAYBACK_STOP
     },
+    {   .label    = "Skip back in playback",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_HISTORY_PLAYBACK_BACK
+    },
+    {   .label    = "Skip forward in playback",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_HISTORY_PLAYBACK_FORWARD
+    },
     {   .label    = "Set recording milestone",
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_HISTORY_MILESTONE_SET
@@ -599,6 +607,16 @@ static ui_menu_item_t snapshot_menu[] = {
     },
     UI_MENU_SEPARATOR,
 
+    {   .label    = "Rewind one frame",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_REWIND_FRAME
+    },
+    {   .label    = "Rewind one second",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_REWIND_SECOND
+    },
+    UI_MENU_SEPARATOR,
+
     {   .label    = "Save/Record media...",
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_MEDIA_RECORD,
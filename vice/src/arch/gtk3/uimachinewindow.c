@@ -686,6 +686,10 @@ static void machine_window_create(video_canvas_t *canvas)
     backend_label = "OpenGL";
 #endif
 
+    /* Both backends keep the last frame, so the core only has to pass the
+       lines that changed */
+    canvas->draw_buffer->refresh_changed_lines = 1;
+
     log_message(machine_window_log, "Chip '%s' using GTK3 backend '%s'.",
                 canvas->videoconfig->chip_name , backend_label);
 
@@ -138,13 +138,19 @@ static int native_monitor(void)
     return res;
 }
 
+/* Interval in milliseconds in which the output is fed to the terminal.
+   Output written in between is collected, so that a command printing many
+   lines does not make the terminal lay out its text for every line.  */
+#define OUTPUT_INTERVAL_MS  20
+
 static gboolean write_to_terminal(gpointer _)
 {
     pthread_mutex_lock(&fixed.lock);
 
     if (!fixed.term) {
-        /* Terminal hasn't been created yet, queue up the write for now. */
-        goto done;
+        /* Terminal hasn't been created yet, try again later. */
+        pthread_mutex_unlock(&fixed.lock);
+        return TRUE;
     }
 
     if (fixed.output_buffer) {
@@ -156,49 +162,40 @@ static gboolean write_to_terminal(gpointer _)
         fixed.output_buffer_used_size = 0;
     }
 
-done:
     pthread_mutex_unlock(&fixed.lock);
 
     return FALSE;
 }
 
-void uimon_write_to_terminal(struct console_private_s *t,
-                             const char *data,
-                             glong length)
+/* Append to the output buffer, with fixed.lock held.  The first write into
+   an empty buffer schedules feeding it to the terminal.  */
+static void output_buffer_append(const char *data, size_t length)
 {
     size_t output_buffer_required_size;
-    bool write_scheduled = false;
-
-    pthread_mutex_lock(&fixed.lock);
 
-    /*
-     * If the output buffer exists, we've already scheduled a write
-     * so we just append to the existing buffer.
-     */
+    if (!fixed.output_buffer) {
+        /* schedule a call on the ui thread */
+        gdk_threads_add_timeout(OUTPUT_INTERVAL_MS, write_to_terminal, NULL);
+    }
 
     output_buffer_required_size = fixed.output_buffer_used_size + length;
 
     if (output_buffer_required_size > fixed.output_buffer_allocated_size) {
-        output_buffer_required_size += 4096;
-
-        if (fixed.output_buffer) {
-            write_scheduled = true;
-            fixed.output_buffer = lib_realloc(fixed.output_buffer, output_buffer_required_size);
-        } else {
-            fixed.output_buffer = lib_malloc(output_buffer_required_size);
-        }
-
+        output_buffer_required_size = output_buffer_required_size * 2 + 4096;
+        fixed.output_buffer = lib_realloc(fixed.output_buffer, output_buffer_required_size);
         fixed.output_buffer_allocated_size = output_buffer_required_size;
     }
 
     memcpy(fixed.output_buffer + fixed.output_buffer_used_size, data, length);
     fixed.output_buffer_used_size += length;
+}
 
-    if (!write_scheduled) {
-        /* schedule a call on the ui thread */
-        gdk_threads_add_timeout(0, write_to_terminal, NULL);
-    }
-
+void uimon_write_to_terminal(struct console_private_s *t,
+                             const char *data,
+                             glong length)
+{
+    pthread_mutex_lock(&fixed.lock);
+    output_buffer_append(data, (size_t)length);
     pthread_mutex_unlock(&fixed.lock);
 }
 
@@ -213,22 +210,26 @@ int uimon_out(const char *buffer)
 
     /* Substitute \n for \r\n when feeding the terminal */
 
+    pthread_mutex_lock(&fixed.lock);
+
     line = buffer;
     while (*line != '\0') {
         line_end = strchr(line, '\n');
 
         if (line_end == NULL) {
             /* buffer ends without a \n */
-            uimon_write_to_terminal(&fixed, line, strlen(line));
+            output_buffer_append(line, strlen(line));
             break;
         }
 
-        uimon_write_to_terminal(&fixed, line, line_end - line);
-        uimon_write_to_terminal(&fixed, "\r\n", 2);
+        output_buffer_append(line, (size_t)(line_end - line));
+        output_buffer_append("\r\n", 2);
 
         line = line_end + 1;
     }
 
+    pthread_mutex_unlock(&fixed.lock);
+
     return 0;
 }
 
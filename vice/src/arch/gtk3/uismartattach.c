@@ -492,7 +492,7 @@ static GtkWidget *create_extra_widget(GtkWidget *parent)
 }
 
 
-/** \brief  Wrapper around disk/tape contents readers
+/** \brief  Read disk or tape contents
  *
  * First treats \a path as disk image file and when that fails it falls back
  * to treating \a path as a tape image, when that fails as well, it gives up.
@@ -501,7 +501,7 @@ static GtkWidget *create_extra_widget(GtkWidget *parent)
  *
  * \return  image contents or `NULL` on failure
  */
-static image_contents_t *read_contents_wrapper(const char *path)
+static image_contents_t *read_contents(const char *path)
 {
     image_contents_t *content;
 
@@ -515,6 +515,21 @@ static image_contents_t *read_contents_wrapper(const char *path)
 }
 
 
+/** \brief  Wrapper around disk/tape contents readers
+ *
+ * Reads the contents through the image contents cache, so browsing through
+ * a directory of images only reads each image once.
+ *
+ * \param[in]   path    path to image file
+ *
+ * \return  image contents or `NULL` on failure
+ */
+static image_contents_t *read_contents_wrapper(const char *path)
+{
+    return image_contents_read_cached(path, read_contents);
+}
+
+
 
 static void on_destroy(GtkWidget *self, gpointer data)
 {
@@ -58,6 +58,7 @@
  */
 
 #include "vice.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <gtk/gtk.h>
 
@@ -86,6 +87,7 @@
 #include "log.h"
 #include "machine.h"
 #include "mainlock.h"
+#include "petpia.h"
 #include "resources.h"
 #include "statusbarledwidget.h"
 #include "statusbarrecordingwidget.h"
@@ -101,6 +103,7 @@
 #include "uifliplist.h"
 #include "uimenu.h"
 #include "uisettings.h"
+#include "userport.h"
 #include "userport/userport_joystick.h"
 #include "vice_gtk3.h"
 
@@ -127,6 +130,20 @@
 /** \brief  Maximum length for drive track status string */
 #define DRIVE_TRACK_STR_MAX_LEN 16
 
+/** \brief  Flag for a drive head that has reported its position */
+#define DRIVE_TRACK_VALID   0x80000000u
+
+/** \brief  Pack a drive head position into a single value */
+#define DRIVE_TRACK_PACK(half_track, side) \
+    (DRIVE_TRACK_VALID | ((side) << 16) | ((half_track) & 0xffff))
+
+/** \brief  Minimum time between status bar refreshes in microseconds
+ *
+ * The renderers refresh the status bars with every frame they present, this
+ * keeps several windows or fast displays from doing it more often.
+ */
+#define STATUSBAR_UPDATE_INTERVAL   (G_USEC_PER_SEC / 100)
+
 
 /** \brief  Tape status widget column indexes
  */
@@ -273,15 +290,6 @@ typedef struct ui_sb_state_s {
      * isn't erased by some older message timing out. */
     intptr_t statustext_msgid;
 
-    /** \brief Current tape state (play, rewind, etc) */
-    int tape_control[TAPEPORT_MAX_PORTS];
-
-    /** \brief Nonzero if the tape motor is powered. */
-    int tape_motor_status[TAPEPORT_MAX_PORTS];
-
-    /** \brief Location on the tape of datasette #1 */
-    int tape_counter[TAPEPORT_MAX_PORTS];
-
     /** \brief Which drives are to be displayed in the status bar.
      *
      *  This is a bitmask, with bits 0-3 representing drives 8-11,
@@ -314,32 +322,6 @@ typedef struct ui_sb_state_s {
     /** \brief Color descriptors for the drive LED colors, 0=red, 1=green */
     int drive_led_types[NUM_DISK_UNITS][2][DRIVE_LEDS_MAX];
 
-    /** \brief Current intensity of each drive LED, 0=off,
-     *         1000=max. */
-    unsigned int current_drive_leds[NUM_DISK_UNITS][2][DRIVE_LEDS_MAX];
-
-    /** \brief true if a drive led has been changed */
-    bool current_drive_leds_updated[NUM_DISK_UNITS][2][DRIVE_LEDS_MAX];
-
-    /** \brief unit:drive label for each unit and its drives */
-    char current_drive_unit_str[NUM_DISK_UNITS][2][DRIVE_UNIT_STR_MAX_LEN];
-
-    /** \brief true if a drive unit string has been changed */
-    bool current_drive_unit_str_updated[NUM_DISK_UNITS][2];
-
-    /** \brief device:track.halftrack label for each unit and its drives */
-    char current_drive_track_str[NUM_DISK_UNITS][2][DRIVE_TRACK_STR_MAX_LEN];
-
-    /** \brief true if a drive track string has been changed */
-    bool current_drive_track_str_updated[NUM_DISK_UNITS][2];
-
-    /** \brief Current state for each of the joyports.
-     *
-     *  This is an 7-bit bitmask, representing, from least to most
-     *  significant bits: up, down, left, right, fire button,
-     *  secondary fire button, tertiary fire button. */
-    int current_joyports[JOYPORT_MAX_PORTS];
-
     /** \brief Which joystick ports are actually available.
      *
      *  This is a bitmask representing notional ports 0-4, which are
@@ -384,6 +366,73 @@ static pthread_mutex_t sb_state_lock = PTHREAD_MUTEX_INITIALIZER;
 static ui_sb_state_t sb_state_do_not_use_directly;
 
 
+/** \brief Machine state published by the emulation thread
+ *
+ * Written once a frame, read by the UI whenever it updates the status bars.
+ * Instead of a lock it has a sequence count: the writer keeps it odd while
+ * it copies the state in, and readers copy the state out again if it was
+ * odd or changed meanwhile.  The emulation thread never waits for the UI.
+ */
+static ui_sb_machine_state_t machine_state;
+
+/** \brief Sequence count of machine_state */
+static atomic_uint machine_state_seq;
+
+
+/** \brief Device status reported by the emulation thread
+ *
+ * Drive LEDs and heads, the tapes and the joyports report their state at
+ * emulation rate, often several times a frame and for every drive.  The
+ * reports only store the new value here, without taking sb_state_lock or
+ * queueing redraws; ui_update_statusbars() compares it against what each
+ * status bar shows when it refreshes them, at most every
+ * #STATUSBAR_UPDATE_INTERVAL.
+ *
+ * Every value is independent of the others, so relaxed atomics will do.
+ */
+typedef struct ui_sb_device_state_s {
+    /** \brief Current intensity of each drive LED, 0=off, 1000=max. */
+    atomic_uint drive_leds[NUM_DISK_UNITS][2][DRIVE_LEDS_MAX];
+
+    /** \brief Head of each drive, see DRIVE_TRACK_PACK() */
+    atomic_uint drive_tracks[NUM_DISK_UNITS][2];
+
+    /** \brief Current tape state (play, rewind, etc) */
+    atomic_int tape_control[TAPEPORT_MAX_PORTS];
+
+    /** \brief Nonzero if the tape motor is powered. */
+    atomic_int tape_motor_status[TAPEPORT_MAX_PORTS];
+
+    /** \brief Location on the tape of each datasette */
+    atomic_int tape_counter[TAPEPORT_MAX_PORTS];
+
+    /** \brief Current state for each of the joyports.
+     *
+     *  This is an 7-bit bitmask, representing, from least to most
+     *  significant bits: up, down, left, right, fire button,
+     *  secondary fire button, tertiary fire button. */
+    atomic_uint joyports[JOYPORT_MAX_PORTS];
+} ui_sb_device_state_t;
+
+/** \brief Device status, written by the emulation thread */
+static ui_sb_device_state_t device_state;
+
+/** \brief Store a device status value unless it is unchanged
+ *
+ * Leaves the cache line alone for the many reports that change nothing.
+ */
+#define DEVICE_STATE_SET(field, value) \
+    do { \
+        if (atomic_load_explicit(&(field), memory_order_relaxed) != (value)) { \
+            atomic_store_explicit(&(field), (value), memory_order_relaxed); \
+        } \
+    } while (0)
+
+/** \brief Get a device status value */
+#define DEVICE_STATE_GET(field) \
+    atomic_load_explicit(&(field), memory_order_relaxed)
+
+
 /** \brief The full structure representing a status bar widget.
  *
  *  This includes the top-level widget and then every subwidget that
@@ -475,11 +524,19 @@ typedef struct ui_statusbar_s {
      */
     GtkWidget *tape_menu[TAPEPORT_MAX_PORTS];
 
-    /** \brief  Used to optimise tape widget updates
-     *
-     * FIXME:   Should probably be moved to sb_status?
+    /** \brief  Tape state shown by the widgets, to only update them when
+     *          the device state differs
      */
     int displayed_tape_counter[TAPEPORT_MAX_PORTS];
+    int displayed_tape_motor_status[TAPEPORT_MAX_PORTS];
+    int displayed_tape_control[TAPEPORT_MAX_PORTS];
+
+    /** \brief  Joyport inputs shown by the joystick widgets */
+    unsigned int displayed_joyports[JOYPORT_MAX_PORTS];
+
+    /** \brief  Drive LEDs and heads shown by the drive widgets */
+    unsigned int displayed_drive_leds[NUM_DISK_UNITS][2][DRIVE_LEDS_MAX];
+    unsigned int displayed_drive_tracks[NUM_DISK_UNITS][2];
 
     /** \brief The joyport status widget. */
     GtkWidget *joysticks;
@@ -541,30 +598,6 @@ static void disk_dir_autostart_callback(const char *image,
                                         unsigned int drive);
 
 
-/** \brief  Trigger redraw of a widget on the UI thread
- *
- * \param[in,out]   user_data   widget to redraw
- *
- * \return  FALSE
- */
-static gboolean redraw_widget_on_ui_thread_impl(gpointer user_data)
-{
-    gtk_widget_queue_draw((GtkWidget *)user_data);
-
-    return FALSE;
-}
-
-/** \brief Queue a redraw of widget on the ui thread.
- *
- * It's not safe to ask a widget to redraw from the vice thread.
- *
- * \param[in,out]   widget  widget to redraw
- */
-static void redraw_widget_on_ui_thread(GtkWidget *widget)
-{
-    gdk_threads_add_timeout(0, redraw_widget_on_ui_thread_impl, (gpointer)widget);
-}
-
 /** \brief Get a locked reference to sb_state */
 static ui_sb_state_t *lock_sb_state(void)
 {
@@ -613,14 +646,10 @@ static gboolean draw_tape_icon_cb(GtkWidget *widget, cairo_t *cr, gpointer data)
     double x, y, inset;
     int tape_motor_status;
     int tape_control;
-    ui_sb_state_t *sb_state;
     int index = GPOINTER_TO_INT(data);
 
-    /* Copy any sb_state that we need to use - don't hold lock while drawing */
-    sb_state = lock_sb_state();
-    tape_motor_status = sb_state->tape_motor_status[index];
-    tape_control = sb_state->tape_control[index];
-    unlock_sb_state();
+    tape_motor_status = DEVICE_STATE_GET(device_state.tape_motor_status[index]);
+    tape_control = DEVICE_STATE_GET(device_state.tape_control[index]);
 
     width = gtk_widget_get_allocated_width(widget);
     height = gtk_widget_get_allocated_height(widget);
@@ -756,10 +785,12 @@ static gboolean draw_drive_led_cb(GtkWidget *widget, cairo_t *cr, gpointer data)
        two LEDs of a drive into one that we display. */
     for (i = 0; i < DRIVE_LEDS_MAX; ++i) {
         int led_color = sb_state->drive_led_types[unit][drive][i];
+        unsigned int pwm = DEVICE_STATE_GET(device_state.drive_leds[unit][drive][i]);
+
         if (led_color) {
-            green += sb_state->current_drive_leds[unit][drive][i] / 1000.0;
+            green += pwm / 1000.0;
         } else {
-            red += sb_state->current_drive_leds[unit][drive][i] / 1000.0;
+            red += pwm / 1000.0;
         }
     }
     unlock_sb_state();
@@ -799,7 +830,6 @@ static gboolean draw_joyport_cb(GtkWidget *widget, cairo_t *cr, gpointer data)
 {
     int width, height, val;
     double e, s, x, y;
-    ui_sb_state_t *sb_state;
 
     /* FIXME This is called very often due to cpu/fps label updates
      * triggering a relayout/redraw */
@@ -807,9 +837,7 @@ static gboolean draw_joyport_cb(GtkWidget *widget, cairo_t *cr, gpointer data)
     width = gtk_widget_get_allocated_width(widget);
     height = gtk_widget_get_allocated_height(widget);
 
-    sb_state = lock_sb_state();
-    val = sb_state->current_joyports[GPOINTER_TO_INT(data)];
-    unlock_sb_state();
+    val = (int)DEVICE_STATE_GET(device_state.joyports[GPOINTER_TO_INT(data)]);
 
     /* This widget "wants" to draw 6x6 squares inside a 20x20
      * space. We compute x and y offsets for a scaled square within
@@ -1689,10 +1717,65 @@ static uint32_t build_active_joyport_mask(void)
     return active_joyport_mask;
 }
 
+/** \brief  Publish the machine state shown on the status bars
+ *
+ * Called by the emulation thread once a frame, and while paused.
+ */
+void ui_statusbar_publish_machine_state(void)
+{
+    ui_sb_machine_state_t state;
+    int drv;
+
+    state.jammed = machine_is_jammed();
+    for (drv = 0; drv < NUM_DISK_UNITS; drv++) {
+        state.drive_jammed[drv] = drive_is_jammed(drv);
+    }
+    state.shiftlock = keyboard_get_shiftlock();
+    state.mode4080 = false;
+    state.capslock = false;
+    if (machine_class == VICE_MACHINE_C128) {
+        state.mode4080 = keyboard_custom_key_get(KBD_CUSTOM_4080);
+        state.capslock = keyboard_custom_key_get(KBD_CUSTOM_CAPS);
+    }
+    state.userport_device = userport_get_device();
+    state.diagnostic_pin = false;
+    if (machine_class == VICE_MACHINE_PET
+            && state.userport_device == USERPORT_DEVICE_DIAGNOSTIC_PIN) {
+        state.diagnostic_pin = pia1_get_diagnostic_pin();
+    }
+    state.active_joyports = 0;
+    if (machine_class != VICE_MACHINE_VSID) {
+        state.active_joyports = build_active_joyport_mask();
+    }
+
+    atomic_fetch_add_explicit(&machine_state_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    machine_state = state;
+    atomic_fetch_add_explicit(&machine_state_seq, 1, memory_order_release);
+}
+
+/** \brief  Get the machine state last published by the emulation thread
+ *
+ * \param[out]  state   machine state
+ */
+void ui_statusbar_get_machine_state(ui_sb_machine_state_t *state)
+{
+    unsigned int seq;
+
+    do {
+        seq = atomic_load_explicit(&machine_state_seq, memory_order_acquire);
+        *state = machine_state;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1)
+             || seq != atomic_load_explicit(&machine_state_seq, memory_order_relaxed));
+}
+
 /** \brief Alter widget visibility within the joyport widget so that
  *         only currently existing joystick ports are displayed.
+ *
+ * \param[in]   active_joyports mask of the active joyports
  */
-static void update_joyport_layout(void)
+static void update_joyport_layout(uint32_t active_joyports)
 {
     int i;
     int j;
@@ -1713,7 +1796,7 @@ static void update_joyport_layout(void)
             child = gtk_grid_get_child_at(GTK_GRID(joyports_grid),
                                           i + JOYSTICK_COL_STATUS, 0);
             if (child) {
-                if (joyport_port_is_active(i)) {
+                if (active_joyports & (1U << (JOYPORT_MAX_PORTS - 1 - i))) {
                     gtk_widget_set_no_show_all(child, FALSE);
                     gtk_widget_show_all(child);
                     active++;
@@ -1804,6 +1887,30 @@ static GtkWidget *ui_joystick_widget_create(void)
 }
 
 
+/** \brief  Make the next status bar update redraw all drive widgets of a bar
+ *
+ * \param[in]   bar_index   status bar index
+ */
+static void invalidate_displayed_drives(int bar_index)
+{
+    ui_statusbar_t *bar = &allocated_bars[bar_index];
+    int unit;
+    int drive;
+    int i;
+
+    for (unit = 0; unit < NUM_DISK_UNITS; unit++) {
+        for (drive = 0; drive < 2; drive++) {
+            for (i = 0; i < DRIVE_LEDS_MAX; i++) {
+                bar->displayed_drive_leds[unit][drive][i] = ~0u;
+            }
+            /* not DRIVE_TRACK_VALID: heads that never reported keep their
+               labels */
+            bar->displayed_drive_tracks[unit][drive] = 0;
+        }
+    }
+}
+
+
 /** \brief Lay out the disk drive widgets inside a status bar.
  *
  * Enable/disable unit, drive, LED widgets based on current configuration.
@@ -2440,6 +2547,7 @@ static void statusbar_append_widget_end(int bar, GtkWidget *widget)
 void ui_statusbar_init(void)
 {
     int i;
+    int j;
     ui_sb_state_t *sb_state;
 
     /* Most things need initialisation to zero and allocated_bars is
@@ -2462,8 +2570,15 @@ void ui_statusbar_init(void)
         allocated_bars[i].widget_row_grid = grid;
         allocated_bars[i].widget_row_column = 0;
 
-        allocated_bars[i].displayed_tape_counter[0] = -1;
-        allocated_bars[i].displayed_tape_counter[1] = -1;
+        for (j = 0; j < TAPEPORT_MAX_PORTS; j++) {
+            allocated_bars[i].displayed_tape_counter[j] = -1;
+            allocated_bars[i].displayed_tape_motor_status[j] = -1;
+            allocated_bars[i].displayed_tape_control[j] = -1;
+        }
+        for (j = 0; j < JOYPORT_MAX_PORTS; j++) {
+            allocated_bars[i].displayed_joyports[j] = ~0u;
+        }
+        invalidate_displayed_drives(i);
     }
 
     sb_state = lock_sb_state();
@@ -2958,34 +3073,13 @@ void ui_display_volume(int vol)
 void ui_display_joyport(uint16_t *joyport)
 {
     int i;
-    ui_sb_state_t *sb_state;
-
-    sb_state = lock_sb_state();
 
+    /* Ok to call from VICE thread, ui_update_statusbars() redraws the
+     * joyports that changed. And yes, the input joystick ports are
+     * 1-indexed. I don't know either. */
     for (i = 0; i < JOYPORT_MAX_PORTS; ++i) {
-        /* Compare the new value to the current one, set the new
-         * value, and queue a redraw if and only if there was a
-         * change. And yes, the input joystick ports are 1-indexed. I
-         * don't know either. */
-        if (sb_state->current_joyports[i] != joyport[i+1]) {
-            int j;
-            sb_state->current_joyports[i] = joyport[i+1];
-            for (j = 0; j < MAX_STATUS_BARS; ++j) {
-                if (allocated_bars[j].joysticks) {
-                    GtkWidget *grid;
-                    GtkWidget *widget;
-
-                    grid = gtk_bin_get_child(GTK_BIN(allocated_bars[j].joysticks));
-                    widget = gtk_grid_get_child_at(GTK_GRID(grid), i + 1, 0);
-                    if (widget) {
-                        redraw_widget_on_ui_thread(widget);
-                    }
-                }
-            }
-        }
+        DEVICE_STATE_SET(device_state.joyports[i], (unsigned int)joyport[i + 1]);
     }
-
-    unlock_sb_state();
 }
 
 
@@ -3018,25 +3112,8 @@ static GtkWidget *tape_get_motor_widget(int bar, int port)
  */
 void ui_display_tape_control_status(int port, int control)
 {
-    ui_sb_state_t *sb_state;
-
     /* Ok to call from VICE thread */
-
-    sb_state = lock_sb_state();
-
-    if (control != sb_state->tape_control[port]) {
-        int i;
-        sb_state->tape_control[port] = control;
-
-        for (i = 0; i < MAX_STATUS_BARS; ++i) {
-            GtkWidget *motor = tape_get_motor_widget(i, port);
-            if (motor != NULL) {
-                redraw_widget_on_ui_thread(motor);
-            }
-        }
-    }
-
-    unlock_sb_state();
+    DEVICE_STATE_SET(device_state.tape_control[port], control);
 }
 
 /** \brief  Statusbar API function to report changes in tape position.
@@ -3048,12 +3125,8 @@ void ui_display_tape_control_status(int port, int control)
  */
 void ui_display_tape_counter(int port, int counter)
 {
-    ui_sb_state_t *sb_state;
-    int index = port;
-
-    sb_state = lock_sb_state();
-    sb_state->tape_counter[index] = counter;
-    unlock_sb_state();
+    /* Ok to call from VICE thread */
+    DEVICE_STATE_SET(device_state.tape_counter[port], counter);
 }
 
 
@@ -3064,25 +3137,8 @@ void ui_display_tape_counter(int port, int counter)
  */
 void ui_display_tape_motor_status(int port, int motor)
 {
-    ui_sb_state_t *sb_state;
-
     /* Ok to call from VICE thread */
-    sb_state = lock_sb_state();
-
-    if (motor != sb_state->tape_motor_status[port]) {
-        int i;
-        sb_state->tape_motor_status[port] = motor;
-
-        for (i = 0; i < MAX_STATUS_BARS; ++i) {
-            GtkWidget *widget = tape_get_motor_widget(i, port);
-
-            if (widget != NULL) {
-                redraw_widget_on_ui_thread(widget);
-            }
-        }
-    }
-
-    unlock_sb_state();
+    DEVICE_STATE_SET(device_state.tape_motor_status[port], motor);
 }
 
 
@@ -3129,8 +3185,6 @@ void ui_display_drive_led(unsigned int drive_number,
                           unsigned int led_pwm1,
                           unsigned int led_pwm2)
 {
-    ui_sb_state_t *sb_state;
-
     /* Ok to call from VICE thread */
 
     if (drive_number > NUM_DISK_UNITS - 1) {
@@ -3139,18 +3193,15 @@ void ui_display_drive_led(unsigned int drive_number,
         abort();
     }
 
-    sb_state = lock_sb_state();
-    sb_state->current_drive_leds[drive_number][drive_base][0] = led_pwm1;
-    sb_state->current_drive_leds[drive_number][drive_base][1] = led_pwm2;
-    sb_state->current_drive_leds_updated[drive_number][drive_base][0] = true;
-    sb_state->current_drive_leds_updated[drive_number][drive_base][1] = true;
-    unlock_sb_state();
+    DEVICE_STATE_SET(device_state.drive_leds[drive_number][drive_base][0], led_pwm1);
+    DEVICE_STATE_SET(device_state.drive_leds[drive_number][drive_base][1], led_pwm2);
 }
 
 
 /** \brief  Statusbar API function to report changes in drive head location.
  *
- * This function simply updates global state, rendering occurs in ui_update_statusbars().
+ * This function simply updates global state, rendering occurs in ui_update_statusbars(),
+ * which also formats the labels.
  *
  *  \param  drive_number        The unit to update (0-3 for drives 8-11)
  *  \param  drive_base          Drive 0 or 1 of dualdrives
@@ -3167,9 +3218,6 @@ void ui_display_drive_track(unsigned int drive_number,
                             unsigned int half_track_number,
                             unsigned int drive_side)
 {
-    ui_sb_state_t *sb_state;
-    int doubleside, dualdrive;
-
     /* Ok to call from VICE thread */
 
     if (drive_number > NUM_DISK_UNITS - 1) {
@@ -3177,47 +3225,8 @@ void ui_display_drive_track(unsigned int drive_number,
         return;
     }
 
-    sb_state = lock_sb_state();
-    doubleside = drive_get_num_heads(sb_state->drives_type[drive_number]) == 2 ? 1 : 0;
-    dualdrive = drive_check_dual(sb_state->drives_type[drive_number]);
-
-    if (dualdrive) {
-        snprintf(
-            sb_state->current_drive_unit_str[drive_number][drive_base],
-            DRIVE_UNIT_STR_MAX_LEN - 1,
-            "%u:%u",
-            drive_number + 8,
-            drive_base);
-    } else {
-        snprintf(
-            sb_state->current_drive_unit_str[drive_number][drive_base],
-            DRIVE_UNIT_STR_MAX_LEN - 1,
-            "%u",
-            drive_number + 8);
-    }
-    sb_state->current_drive_unit_str[drive_number][drive_base][DRIVE_UNIT_STR_MAX_LEN - 1] = '\0';
-    sb_state->current_drive_unit_str_updated[drive_number][drive_base] = true;
-
-    if (doubleside) {
-        snprintf(
-            sb_state->current_drive_track_str[drive_number][drive_base],
-            DRIVE_TRACK_STR_MAX_LEN - 1,
-            " %u:%04.1lf",  /* space instead of 0 padding looks weird with the
-                               drive side in front */
-            drive_side,
-            half_track_number / 2.0);
-    } else {
-        snprintf(
-            sb_state->current_drive_track_str[drive_number][drive_base],
-            DRIVE_TRACK_STR_MAX_LEN - 1,
-            " %4.1lf",
-            half_track_number / 2.0);
-    }
-
-    sb_state->current_drive_track_str[drive_number][drive_base][DRIVE_TRACK_STR_MAX_LEN - 1] = '\0';
-    sb_state->current_drive_track_str_updated[drive_number][drive_base] = true;
-
-    unlock_sb_state();
+    DEVICE_STATE_SET(device_state.drive_tracks[drive_number][drive_base],
+                     DRIVE_TRACK_PACK(half_track_number, drive_side));
 }
 
 
@@ -3260,7 +3269,7 @@ void ui_enable_drive_status(ui_drive_enable_t state, int *drive_led_color)
             if (enabled & 1) {
                 for (i = 0; i < DRIVE_LEDS_MAX; i++) {
                     sb_state->drive_led_types[unit][drive][i] = (drive_led_color[unit] >> i) & 1;
-                    sb_state->current_drive_leds[unit][drive][i] = 0;
+                    DEVICE_STATE_SET(device_state.drive_leds[unit][drive][i], 0);
                 }
             }
         }
@@ -3422,11 +3431,61 @@ void ui_update_vsid_statusbar(void)
 }
 
 
+/** \brief  Set the unit and head labels of a drive
+ *
+ * \param[in]   number  unit number label or NULL
+ * \param[in]   head    head position label or NULL
+ * \param[in]   unit    unit index (0-3 for drives 8-11)
+ * \param[in]   drive   drive 0 or 1 of dualdrives
+ * \param[in]   type    drive type of the unit
+ * \param[in]   track   head position, see DRIVE_TRACK_PACK()
+ */
+static void update_drive_labels(GtkWidget *number,
+                                GtkWidget *head,
+                                int unit,
+                                int drive,
+                                int type,
+                                unsigned int track)
+{
+    char buffer[DRIVE_TRACK_STR_MAX_LEN];
+    unsigned int half_track_number = track & 0xffff;
+    unsigned int drive_side = (track >> 16) & 0xff;
+
+    if (number != NULL) {
+        if (drive_check_dual(type)) {
+            g_snprintf(buffer, DRIVE_UNIT_STR_MAX_LEN, "%d:%d", unit + 8, drive);
+        } else {
+            g_snprintf(buffer, DRIVE_UNIT_STR_MAX_LEN, "%d", unit + 8);
+        }
+        gtk_label_set_text(GTK_LABEL(number), buffer);
+    }
+
+    if (head != NULL) {
+        if (drive_get_num_heads(type) == 2) {
+            /* space instead of 0 padding looks weird with the drive side in
+               front */
+            g_snprintf(buffer, sizeof(buffer), " %u:%04.1lf",
+                       drive_side, half_track_number / 2.0);
+        } else {
+            g_snprintf(buffer, sizeof(buffer), " %4.1lf",
+                       half_track_number / 2.0);
+        }
+        gtk_label_set_text(GTK_LABEL(head), buffer);
+    }
+}
+
+
 /** \brief  Update status bars for non-VSID machines
+ *
+ * Called by the renderers for every frame they present, the status bars are
+ * refreshed at most every #STATUSBAR_UPDATE_INTERVAL.  Only widgets whose
+ * device state differs from what they show are touched.
  */
 void ui_update_statusbars(void)
 {
     /* TODO: Don't call this for each top level window as it updates all statusbars */
+    static gint64 last_update = 0;
+    gint64 now;
     ui_statusbar_t *bar;
     GtkWidget *speed_widget;
     int i;
@@ -3436,10 +3495,20 @@ void ui_update_statusbars(void)
     uint32_t active_joyports;
     bool active_joyports_changed = false;
     int unit;
+    ui_sb_machine_state_t machine;
+
+    now = g_get_monotonic_time();
+    if (now - last_update < STATUSBAR_UPDATE_INTERVAL) {
+        return;
+    }
+    last_update = now;
+
+    ui_statusbar_get_machine_state(&machine);
+
     sb_state = lock_sb_state();
 
     /* Have any joyports been enabled / disabled? */
-    active_joyports = build_active_joyport_mask();
+    active_joyports = machine.active_joyports;
     if (active_joyports != sb_state->active_joyports) {
         active_joyports_changed = true;
         sb_state->active_joyports = active_joyports;
@@ -3451,17 +3520,6 @@ void ui_update_statusbars(void)
     /* Reset any 'updated needed' flags */
     sb_state->drives_layout_needed = false;
 
-    for (j = 0; j < NUM_DISK_UNITS; ++j) {
-        sb_state->current_drive_track_str_updated[j][0] = false;
-        sb_state->current_drive_track_str_updated[j][1] = false;
-        sb_state->current_drive_unit_str_updated[j][0]  = false;
-        sb_state->current_drive_unit_str_updated[j][1]  = false;
-        for (int d = 0; d < 2; d++) {
-            sb_state->current_drive_leds_updated[j][d][0] = false;
-            sb_state->current_drive_leds_updated[j][d][1] = false;
-        }
-    }
-
     /* statusbar messages */
     statusbar_update_message(sb_state);
 
@@ -3488,16 +3546,19 @@ void ui_update_statusbars(void)
          */
         for (j = 0; j < TAPEPORT_MAX_PORTS; j++) {
             GtkWidget *tape_status = bar->tape_status[j];
+            int count = DEVICE_STATE_GET(device_state.tape_counter[j]);
+            int motor = DEVICE_STATE_GET(device_state.tape_motor_status[j]);
+            int control = DEVICE_STATE_GET(device_state.tape_control[j]);
+
+            if (tape_status == NULL) {
+                continue;
+            }
 
-            if (tape_status != NULL
-                    && bar->displayed_tape_counter[j] != state_snapshot.tape_counter[j]) {
+            if (bar->displayed_tape_counter[j] != count) {
                 GtkWidget *tape_counter;
-                int count;
 
                 tape_counter = gtk_grid_get_child_at(GTK_GRID(tape_status),
                                                      TAPE_STATUS_COL_COUNTER, 0);
-                count = state_snapshot.tape_counter[j];
-
                 if (tape_counter != NULL) {
                     char buffer[32];
 
@@ -3506,6 +3567,17 @@ void ui_update_statusbars(void)
                 }
                 bar->displayed_tape_counter[j] = count;
             }
+
+            if (bar->displayed_tape_motor_status[j] != motor
+                    || bar->displayed_tape_control[j] != control) {
+                GtkWidget *tape_motor = tape_get_motor_widget(i, j);
+
+                if (tape_motor != NULL) {
+                    gtk_widget_queue_draw(tape_motor);
+                }
+                bar->displayed_tape_motor_status[j] = motor;
+                bar->displayed_tape_control[j] = control;
+            }
         }
 
         /*
@@ -3513,7 +3585,24 @@ void ui_update_statusbars(void)
          */
 
         if (active_joyports_changed) {
-            update_joyport_layout();
+            update_joyport_layout(active_joyports);
+        }
+
+        if (bar->joysticks != NULL) {
+            GtkWidget *grid = gtk_bin_get_child(GTK_BIN(bar->joysticks));
+
+            for (j = 0; j < JOYPORT_MAX_PORTS; j++) {
+                unsigned int joyport = DEVICE_STATE_GET(device_state.joyports[j]);
+
+                if (bar->displayed_joyports[j] != joyport) {
+                    GtkWidget *widget = gtk_grid_get_child_at(GTK_GRID(grid), j + 1, 0);
+
+                    if (widget != NULL) {
+                        gtk_widget_queue_draw(widget);
+                    }
+                    bar->displayed_joyports[j] = joyport;
+                }
+            }
         }
 
         /*
@@ -3522,33 +3611,40 @@ void ui_update_statusbars(void)
 
         if (state_snapshot.drives_layout_needed) {
             layout_statusbar_drives(&state_snapshot, i);
+            invalidate_displayed_drives(i);
         }
 
         for (unit = DRIVE_UNIT_MIN; unit <= DRIVE_UNIT_MAX; unit++) {
+            int index = unit - DRIVE_UNIT_MIN;
 
             /* Only update the widgets if their state has changed .. */
             for (int drive = 0; drive < 2; drive++) {
-
-                GtkWidget *number = drive_get_number_widget(i, unit, drive);
-                GtkWidget *head = drive_get_head_widget(i, unit, drive);
-                GtkWidget *led = drive_get_led_widget(i, unit, drive);
-
-                if (state_snapshot.current_drive_track_str_updated[unit - DRIVE_UNIT_MIN][drive]) {
-                    if (head != NULL) {
-                        char *s = state_snapshot.current_drive_track_str[unit - DRIVE_UNIT_MIN][drive];
-                        gtk_label_set_text(GTK_LABEL(head), s);
-                    }
+                unsigned int track = DEVICE_STATE_GET(device_state.drive_tracks[index][drive]);
+                bool leds_changed = false;
+
+                if (bar->displayed_drive_tracks[index][drive] != track) {
+                    update_drive_labels(drive_get_number_widget(i, unit, drive),
+                                        drive_get_head_widget(i, unit, drive),
+                                        index,
+                                        drive,
+                                        state_snapshot.drives_type[index],
+                                        track);
+                    bar->displayed_drive_tracks[index][drive] = track;
                 }
 
-                if (state_snapshot.current_drive_unit_str_updated[unit - DRIVE_UNIT_MIN][drive]) {
-                    if (number != NULL) {
-                        char *s = state_snapshot.current_drive_unit_str[unit - DRIVE_UNIT_MIN][drive];
-                        gtk_label_set_text(GTK_LABEL(number), s);
+                for (j = 0; j < DRIVE_LEDS_MAX; j++) {
+                    unsigned int pwm = DEVICE_STATE_GET(device_state.drive_leds[index][drive][j]);
+
+                    if (bar->displayed_drive_leds[index][drive][j] != pwm) {
+                        bar->displayed_drive_leds[index][drive][j] = pwm;
+                        leds_changed = true;
                     }
                 }
 
                 /* Only draw the LEDs if they have changed */
-                if (state_snapshot.current_drive_leds_updated[unit - DRIVE_UNIT_MIN][drive][0]) {
+                if (leds_changed) {
+                    GtkWidget *led = drive_get_led_widget(i, unit, drive);
+
                     if (led != NULL) {
                         gtk_widget_queue_draw(led);
                     }
@@ -37,6 +37,27 @@
 
 #include "vice.h"
 #include <gtk/gtk.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "drive.h"
+
+/** \brief  Machine state shown on the status bars
+ *
+ * Published once a frame by the emulation thread, so the UI can read it
+ * without the main lock or reading the emulation while it runs.
+ */
+typedef struct ui_sb_machine_state_s {
+    bool jammed;                        /**< main CPU is jammed */
+    bool drive_jammed[NUM_DISK_UNITS];  /**< drive CPU is jammed */
+    bool shiftlock;                     /**< shift lock is down */
+    bool mode4080;                      /**< x128 40/80 key is down */
+    bool capslock;                      /**< x128 caps lock is down */
+    bool diagnostic_pin;                /**< PET diagnostic pin is set */
+    int userport_device;                /**< device on the userport */
+    uint32_t active_joyports;           /**< joyports that exist, see
+                                             build_active_joyport_mask() */
+} ui_sb_machine_state_t;
 
 void ui_statusbar_init(void);
 void ui_statusbar_shutdown(void);
@@ -61,6 +82,9 @@ int ui_statusbar_index_for_window(GtkWidget *window);
 void ui_update_vsid_statusbar(void);
 void ui_update_statusbars(void);
 
+void ui_statusbar_publish_machine_state(void);
+void ui_statusbar_get_machine_state(ui_sb_machine_state_t *state);
+
 void warp_led_set_active          (int bar, gboolean active);
 void pause_led_set_active         (int bar, gboolean active);
 void shiftlock_led_set_active     (int bar, gboolean active);
@@ -237,6 +237,18 @@ char video_canvas_can_resize(video_canvas_t *canvas)
     return 1;
 }
 
+/** \brief Query whether the display of a canvas can show another frame.
+ *  \param canvas The canvas to query
+ *  \return true if the last frame was taken by the display.
+ */
+bool video_canvas_ready_for_frame(video_canvas_t *canvas)
+{
+    if (canvas->renderer_backend && canvas->renderer_backend->ready_for_frame) {
+        return canvas->renderer_backend->ready_for_frame(canvas);
+    }
+    return true;
+}
+
 /** \brief  Create a new video_canvas_s.
  *
  *  \param[in,out]  canvas  A freshly allocated canvas object.
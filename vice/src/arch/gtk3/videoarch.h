@@ -220,6 +220,14 @@ typedef struct vice_renderer_backend_s {
      * \param canvas The canvas being initialized
      */
     void (*set_palette)(video_canvas_t *canvas);
+    /** \brief Check if the display has taken the last frame.
+     *
+     * A frame refreshed before that would only replace the last one.
+     *
+     * \param canvas The canvas to check
+     * \return true if a new frame would be shown
+     */
+    bool (*ready_for_frame)(video_canvas_t *canvas);
 } vice_renderer_backend_t;
 
 #endif
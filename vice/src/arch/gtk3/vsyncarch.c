@@ -31,6 +31,7 @@
 #include "vice.h"
 
 #include "ui.h"
+#include "uistatusbar.h"
 #include "vsyncapi.h"
 #include "videoarch.h"
 
@@ -45,6 +46,8 @@ void vsyncarch_presync(void)
 
 void vsyncarch_postsync(void)
 {
+    ui_statusbar_publish_machine_state();
+
     /* this function is called once a frame, so this
        handles single frame advance */
     if (pause_pending) {
@@ -69,6 +69,19 @@ static GtkWidget *content_view = NULL;
 static GtkWidget *parent_dialog;
 
 
+/** \brief  Number of the current read of image contents
+ *
+ * Incremented when another image is set, results of older reads are
+ * dropped.
+ */
+static volatile gint read_generation = 0;
+
+
+/** \brief  Lock to do one read of image contents at a time
+ */
+static GMutex read_lock;
+
+
 /** \brief  Handler for the "row-activated" event of the view
  *
  * This function handles auto-starting a file selected in the preview. It
@@ -117,21 +130,30 @@ static void on_row_activated(
 }
 
 
+/** \brief  Create an empty model for the view
+ *
+ * \return  model
+ */
+static GtkListStore *create_empty_model(void)
+{
+    return gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_INT);
+}
+
+
 /** \brief  Create the model for the view
  *
  * The model created has two columns, a string representing a file:
  * '\<blocks\> "\<filename\>" \<filetype-and-flags\>' and an integer which indicates
  * the file's index in the image's "directory".
  *
- * \param[in]   path    path to image file
+ * \param[in]   contents    image contents, `NULL` if reading the image failed
  *
- * \return  model (empty if reading the image failed)
+ * \return  model
  */
-static GtkListStore *create_model(const char *path)
+static GtkListStore *create_model(image_contents_t *contents)
 {
     GtkListStore *model;
     GtkTreeIter iter;
-    image_contents_t *contents;
     image_contents_file_list_t *entry;
     char *tmp;
     char *sep;
@@ -139,22 +161,7 @@ static GtkListStore *create_model(const char *path)
     int row;
     int blocks;
 
-    model = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_INT);
-    if (path == NULL) {
-        return model;
-    }
-    /* don't try to read from a directory: avoid error messages from
-     * vdrive/fsimage */
-    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
-        return model;
-    }
-
-    if (content_func == NULL) {
-        log_error(LOG_DEFAULT, "no content-get function specified, bailing!");
-        return model;
-    }
-
-    contents = content_func(path);
+    model = create_empty_model();
     if (contents == NULL) {
         gtk_list_store_append(model, &iter);
         gtk_list_store_set(model, &iter,
@@ -218,27 +225,40 @@ static GtkListStore *create_model(const char *path)
         lib_free(tmp);
         lib_free(utf8);
     }
-    image_contents_destroy(contents);
     return model;
 }
 
 
-/** \brief  Create the view for the content widget
+/** \brief  Handler for the 'destroy' event of the view
  *
- * Creates a GtkTreeView to display the contents of image \a path
+ * Makes reads still running drop their result.
  *
- * \param[in]   path    path to image file
+ * \param[in]   view    tree view
+ * \param[in]   data    extra event data (unused)
+ */
+static void on_view_destroy(GtkWidget *view, gpointer data)
+{
+    if (view == content_view) {
+        content_view = NULL;
+        g_atomic_int_inc(&read_generation);
+    }
+}
+
+
+/** \brief  Create the view for the content widget
+ *
+ * Creates an empty GtkTreeView to display the contents of an image
  *
  * \return  GtkTreeView
  */
-static GtkWidget *create_view(const char *path)
+static GtkWidget *create_view(void)
 {
     GtkTreeView *view;
     GtkTreeViewColumn *column;
     GtkListStore *model;
     GtkCellRenderer *renderer;
 
-    model = create_model(path);
+    model = create_empty_model();
 
     view = GTK_TREE_VIEW(gtk_tree_view_new_with_model(GTK_TREE_MODEL(model)));
     g_object_unref(model);
@@ -280,11 +300,87 @@ static GtkWidget *create_view(const char *path)
     gtk_widget_set_vexpand(GTK_WIDGET(view), TRUE);
 
     g_signal_connect(view, "row-activated", G_CALLBACK(on_row_activated), NULL);
+    g_signal_connect(view, "destroy", G_CALLBACK(on_view_destroy), NULL);
 
     return GTK_WIDGET(view);
 }
 
 
+/** \brief  Data of a read of image contents in a worker thread
+ */
+typedef struct read_task_s {
+    char *path;                     /**< path to image file */
+    read_contents_func_type func;   /**< function to read the contents */
+    gint generation;                /**< value of read_generation when started */
+} read_task_t;
+
+
+/** \brief  Free read task data
+ *
+ * \param[in]   data    read task data
+ */
+static void read_task_free(gpointer data)
+{
+    read_task_t *task_data = data;
+
+    lib_free(task_data->path);
+    lib_free(task_data);
+}
+
+
+/** \brief  Read image contents, run in a worker thread
+ *
+ * Reads are done one at a time, the readers share the vdrive and image code.
+ *
+ * \param[in]   task            task
+ * \param[in]   source_object   source object (unused)
+ * \param[in]   data            read task data
+ * \param[in]   cancellable     cancellable (unused)
+ */
+static void read_thread(GTask *task,
+                        gpointer source_object,
+                        gpointer data,
+                        GCancellable *cancellable)
+{
+    read_task_t *task_data = data;
+    image_contents_t *contents = NULL;
+
+    g_mutex_lock(&read_lock);
+    /* skip reads that were already superseded while waiting */
+    if (task_data->generation == g_atomic_int_get(&read_generation)) {
+        contents = task_data->func(task_data->path);
+    }
+    g_mutex_unlock(&read_lock);
+
+    g_task_return_pointer(task, contents, NULL);
+}
+
+
+/** \brief  Show the contents read by a worker thread, run in the UI thread
+ *
+ * \param[in]   source_object   source object (unused)
+ * \param[in]   result          task
+ * \param[in]   data            extra data (unused)
+ */
+static void on_read_done(GObject *source_object,
+                         GAsyncResult *result,
+                         gpointer data)
+{
+    read_task_t *task_data = g_task_get_task_data(G_TASK(result));
+    image_contents_t *contents = g_task_propagate_pointer(G_TASK(result), NULL);
+    GtkListStore *model;
+
+    if (task_data->generation == read_generation && content_view != NULL) {
+        model = create_model(contents);
+        gtk_tree_view_set_model(GTK_TREE_VIEW(content_view), GTK_TREE_MODEL(model));
+        g_object_unref(model);
+    }
+    if (contents != NULL) {
+        image_contents_destroy(contents);
+    }
+}
+
+
 /*****************************************************************************
  *                          Public functions                                 *
  ****************************************************************************/
@@ -328,7 +424,7 @@ GtkWidget *content_preview_widget_create(
 
     /* create scrolled window to contain the GktTreeView */
     scroll = gtk_scrolled_window_new(NULL, NULL);
-    content_view = create_view(NULL);
+    content_view = create_view();
     gtk_container_add(GTK_CONTAINER(scroll), content_view);
 
     /* set scrolled window properties */
@@ -348,6 +444,9 @@ GtkWidget *content_preview_widget_create(
 
 
 /** \brief  Set image file for the widget
+ *
+ * The contents are read in a worker thread, the view is updated when that
+ * is done, unless another image was set in the meantime.
  *
  * \param[in,out]   widget  preview widget
  * \param[in]       path    path to image file
@@ -355,12 +454,38 @@ GtkWidget *content_preview_widget_create(
 void content_preview_widget_set_image(GtkWidget *widget, const char *path)
 {
     GtkListStore *model;
+    GTask *task;
+    read_task_t *data;
 
-    model = create_model(path);
+    /* show nothing until the contents have been read */
+    g_atomic_int_inc(&read_generation);
+    model = create_empty_model();
     gtk_tree_view_set_model(GTK_TREE_VIEW(content_view), GTK_TREE_MODEL(model));
-    if (model != NULL) {
-        g_object_unref(model);
+    g_object_unref(model);
+
+    if (path == NULL) {
+        return;
     }
+    /* don't try to read from a directory: avoid error messages from
+     * vdrive/fsimage */
+    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        return;
+    }
+
+    if (content_func == NULL) {
+        log_error(LOG_DEFAULT, "no content-get function specified, bailing!");
+        return;
+    }
+
+    data = lib_malloc(sizeof(read_task_t));
+    data->path = lib_strdup(path);
+    data->func = content_func;
+    data->generation = read_generation;
+
+    task = g_task_new(NULL, NULL, on_read_done, NULL);
+    g_task_set_task_data(task, data, read_task_free);
+    g_task_run_in_thread(task, read_thread);
+    g_object_unref(task);
 }
 
 
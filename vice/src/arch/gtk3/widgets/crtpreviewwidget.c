@@ -408,5 +408,5 @@ void crt_preview_widget_update(const gchar *path)
 #if 0
     debug_gtk3("read %d CHIP packets.", packets);
 #endif
-    fclose(fd);
+    crt_close(fd);
 }
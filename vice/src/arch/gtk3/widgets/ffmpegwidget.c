@@ -11,6 +11,7 @@
  * $VICERES FFMPEGAudioCodec            -vsid
  * $VICERES FFMPEGVideoCodec            -vsid
  * $VICERES FFMPEGVideoHalveFramerate   -vsid
+ * $VICERES FFMPEGVideoDropFrames       -vsid
  * $VICERES ZMBVFormat                  -vsid
  * $VICERES ZMBVAudioCodec              -vsid
  * $VICERES ZMBVVideoCodec              -vsid
@@ -509,6 +510,7 @@ GtkWidget *ffmpeg_widget_create(const char *driver)
     GtkWidget *grid;
     GtkWidget *label;
     GtkWidget *fps;
+    GtkWidget *drop;
     gfxoutputdrv_format_t *formatlist;
     const char *current_format = NULL;
     int fmt_index;
@@ -588,6 +590,13 @@ GtkWidget *ffmpeg_widget_create(const char *driver)
     gtk_grid_attach(GTK_GRID(grid), fps, 0, 3, 4, 1);
     gtk_widget_set_sensitive(fps, (flags & GFXOUTPUTDRV_HAS_HALF_VIDEO_FRAMERATE) ? TRUE : FALSE);
 
+    /* frame drop widget */
+    drop = vice_gtk3_resource_check_button_new("FFMPEGVideoDropFrames",
+            "Repeat frames instead of slowing down when ffmpeg cannot keep up");
+    gtk_widget_set_halign(drop, GTK_ALIGN_START);
+    gtk_widget_set_margin_start(drop, 16);
+    gtk_grid_attach(GTK_GRID(grid), drop, 0, 4, 4, 1);
+
     update_format_combo_box(current_format);
 
     /* connect event handlers */
@@ -72,6 +72,15 @@ static const vice_gtk3_radiogroup_entry_t autostart_drop_modes[] = {
     { NULL,                         -1 }
 };
 
+/** \brief  List of warp modes for autostart
+ */
+static const vice_gtk3_radiogroup_entry_t autostart_warp_modes[] = {
+    { "Off",                                AUTOSTART_WARP_OFF },
+    { "Until the program is started",       AUTOSTART_WARP_ON },
+    { "Until the program stops loading",    AUTOSTART_WARP_ADAPTIVE },
+    { NULL,                                 -1 }
+};
+
 
 /*
  * Layout helpers
@@ -236,6 +245,7 @@ GtkWidget *settings_autostart_widget_create(GtkWidget *parent)
 #define NUM_COLS    3
     GtkWidget *grid;
     GtkWidget *tde;
+    GtkWidget *label;
     GtkWidget *warp;
     GtkWidget *doubleclick;
     int        row = 0;
@@ -248,9 +258,16 @@ GtkWidget *settings_autostart_widget_create(GtkWidget *parent)
     gtk_grid_attach(GTK_GRID(grid), tde, 0, row, NUM_COLS, 1);
     row++;
 
-    warp = vice_gtk3_resource_check_button_new("AutostartWarp",
-                                               "Warp on autostart");
-    gtk_grid_attach(GTK_GRID(grid), warp, 0, row, NUM_COLS, 1);
+    label = gtk_label_new("Warp on autostart");
+    gtk_widget_set_halign(label, GTK_ALIGN_START);
+    gtk_widget_set_valign(label, GTK_ALIGN_START);
+    warp = vice_gtk3_resource_radiogroup_new("AutostartWarp",
+                                             autostart_warp_modes,
+                                             GTK_ORIENTATION_VERTICAL);
+    gtk_widget_set_margin_bottom(label, 8);
+    gtk_widget_set_margin_bottom(warp, 8);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1,            1);
+    gtk_grid_attach(GTK_GRID(grid), warp,  1, row, NUM_COLS - 1, 1);
     row++;
 
     doubleclick = vice_gtk3_resource_check_button_new("AutostartOnDoubleClick",
@@ -23,6 +23,7 @@
  * $VICERES JoyPort2Device  -xcbm2 -xpet -xvic -vsid
  *
  * $VICERES JoyOpposite     -vsid
+ * $VICERES InputLateLatch  -vsid
  * $VICERES KeySetEnable    -vsid
  *
  *  (see used external widgets for more)
@@ -212,6 +213,16 @@ static GtkWidget *create_opposite_enable_checkbox(void)
                                                "Allow opposite directions");
 }
 
+/** \brief  Create a check button to enable "Latch input without delay"
+ *
+ * \return  GtkCheckButton
+ */
+static GtkWidget *create_late_latch_checkbox(void)
+{
+    return vice_gtk3_resource_check_button_new("InputLateLatch",
+                                               "Latch input without delay");
+}
+
 /** \brief  Create button to pop up dialog to configure a keyset
  *
  * \param[in]   keyset  keyset number (1 for 'A', 2 for 'B')
@@ -537,6 +548,8 @@ GtkWidget *settings_joystick_widget_create(GtkWidget *parent)
     gtk_grid_attach(GTK_GRID(layout), keyset_enabled,   0, row, 1, 1);
     gtk_grid_attach(GTK_GRID(layout), opposite_enabled, 1, row, 1, 1);
     row++;
+    gtk_grid_attach(GTK_GRID(layout), create_late_latch_checkbox(), 0, row, 1, 1);
+    row++;
 
     /* add buttons to activate keyset dialog */
     keyset_1_button = create_keyset_configure_button(1);
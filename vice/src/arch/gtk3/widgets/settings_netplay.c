@@ -78,7 +78,8 @@ static const char *net_modes[] = {
     "Idle",             /* NETWORK_IDLE */
     "Server",           /* NETWORK_SERVER */
     "Server connected", /* NETWORK_SERVER_CONNECTED */
-    "Client connected"  /* NETWORK_CLIENT */
+    "Client connected", /* NETWORK_CLIENT */
+    "Spectator"         /* NETWORK_SPECTATOR */
 };
 
 
@@ -190,7 +191,7 @@ static void on_netplay_notify_active(GtkSwitch  *widget,
 
     debug_gtk3("active = %s, role = %s, mode = %s",
                active ? "TRUE" : "FALSE",
-               role == 0 ? "Server" : "Client",
+               role == 0 ? "Server" : (role == 1 ? "Client" : "Spectator"),
                mode >= 0 && mode < G_N_ELEMENTS(net_modes) ? net_modes[mode] : "(invalid)");
 
     /* disconnect when not idle */
@@ -206,12 +207,18 @@ static void on_netplay_notify_active(GtkSwitch  *widget,
                 log_error(LOG_DEFAULT, "Failed to start netplay server.");
                 failed = true;
            }
-        } else {
+        } else if (role == 1) {
             /* start the client */
             if (network_connect_client() < 0) {
                 log_error(LOG_DEFAULT, "Failed to start client.");
                 failed = true;
             }
+        } else {
+            /* watch the game of a server */
+            if (network_connect_spectator() < 0) {
+                log_error(LOG_DEFAULT, "Failed to start spectator.");
+                failed = true;
+            }
         }
         if (failed) {
             g_signal_handler_block(widget, netplay_handler);
@@ -273,9 +280,15 @@ static GtkWidget *create_combo_box(void)
             NULL, "This emulator is the server");
     gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(combo),
             NULL, "This emulator is the client");
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(combo),
+            NULL, "This emulator is a spectator");
 
     if (netplay_mode < 0) {
-        netplay_mode = (mode == NETWORK_CLIENT ? 1 : 0);
+        if (mode == NETWORK_SPECTATOR) {
+            netplay_mode = 2;
+        } else {
+            netplay_mode = (mode == NETWORK_CLIENT ? 1 : 0);
+        }
     }
     gtk_combo_box_set_active(GTK_COMBO_BOX(combo), netplay_mode);
 
@@ -10,6 +10,7 @@
  * $VICERES TapePort1Device                 -xscpu64 -vsid
  * $VICERES TapePort2Device                 -xscpu64 -vsid -x64sc -x64 -xvic -xplus4 -xcbm2 -xcbm5x0
  * $VICERES DatasetteResetWithCPU           -xscpu64 -vsid
+ * $VICERES DatasetteTurbo                  -xscpu64 -vsid
  * $VICERES DatasetteSound                  -xscpu64 -vsid
  * $VICERES DatasetteSoundVolume            -xscpu64 -vsid
  * $VICERES DatasetteSpeedTuning            -xscpu64 -vsid
@@ -98,6 +99,9 @@ static GtkWidget *ds_traps2 = NULL;
 /** \brief  Datasette reset toggle button */
 static GtkWidget *ds_reset = NULL;
 
+/** \brief  Datasette turbo toggle button */
+static GtkWidget *ds_turbo = NULL;
+
 /** \brief  Datasette zerogap delay spine button */
 static GtkWidget *ds_zerogap = NULL;
 
@@ -168,6 +172,7 @@ static gboolean machine_has_second_tape_port(void)
 static void set_datasette_active(gboolean state)
 {
     gtk_widget_set_sensitive(ds_reset,      state);
+    gtk_widget_set_sensitive(ds_turbo,      state);
     gtk_widget_set_sensitive(ds_zerogap,    state);
     gtk_widget_set_sensitive(ds_speed,      state);
     gtk_widget_set_sensitive(ds_wobblefreq, state);
@@ -285,6 +290,11 @@ static GtkWidget *create_datasette_widget(void)
     gtk_widget_set_margin_bottom(ds_reset, 8);
     gtk_grid_attach(GTK_GRID(grid), ds_reset, 0, row, 2, 1);
 
+    ds_turbo = vice_gtk3_resource_check_button_new("DatasetteTurbo",
+                                                   "Warp while loading from tape");
+    gtk_widget_set_margin_bottom(ds_turbo, 8);
+    gtk_grid_attach(GTK_GRID(grid), ds_turbo, 2, row, 2, 1);
+
     row++;
 
     ds_sound = vice_gtk3_resource_check_button_new("DatasetteSound",
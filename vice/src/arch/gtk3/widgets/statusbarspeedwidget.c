@@ -43,7 +43,6 @@
 #include "keyboard.h"
 #include "lib.h"
 #include "machine.h"
-#include "petpia.h"
 #include "resources.h"
 #include "statusbarledwidget.h"
 #include "uiapi.h"
@@ -480,6 +479,7 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     double vsync_metric_cpu_percent;
     double vsync_metric_emulated_fps;
     int vsync_metric_warp_enabled;
+    ui_sb_machine_state_t machine;
     tick_t now;
 
     /*
@@ -492,11 +492,14 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     }
     state->last_render_tick = now;
 
+    /* read what the emulation thread published, not the emulation itself */
+    ui_statusbar_get_machine_state(&machine);
+
     /*
      * Jammed machines show the jam message instead of stats
      */
 
-    if (machine_is_jammed()) {
+    if (machine.jammed) {
         if (!jammed) {
 #if 0
             char *temp = lib_strdup(machine_jam_reason());
@@ -524,7 +527,7 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     }
 
     for (drv = 0; drv < NUM_DISK_UNITS; drv++) {
-        if (drive_is_jammed(drv)) {
+        if (machine.drive_jammed[drv]) {
             if (drivejammed[drv] == false) {
                 drivejammed[drv] = true;
                 ui_display_statustext(drive_jam_reason(drv), false);
@@ -546,20 +549,11 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     int this_cpu_int = (int)(vsync_metric_cpu_percent  * pow(10, CPU_DECIMAL_PLACES) + 0.5);
     int this_fps_int = (int)(vsync_metric_emulated_fps * pow(10, FPS_DECIMAL_PLACES) + 0.5);
     bool is_paused = ui_pause_active();
-    bool is_shiftlock = keyboard_get_shiftlock();
-    bool is_mode4080 = false;
-    bool is_capslock = false;
-    bool is_diagnostic_pin = false;
-    int updev = userport_get_device();
-
-    if (machine_class == VICE_MACHINE_C128) {
-        is_mode4080 = keyboard_custom_key_get(KBD_CUSTOM_4080);
-        is_capslock = keyboard_custom_key_get(KBD_CUSTOM_CAPS);
-    }
-
-    if ((machine_class == VICE_MACHINE_PET) && (updev == USERPORT_DEVICE_DIAGNOSTIC_PIN)) {
-        is_diagnostic_pin = pia1_get_diagnostic_pin();
-    }
+    bool is_shiftlock = machine.shiftlock;
+    bool is_mode4080 = machine.mode4080;
+    bool is_capslock = machine.capslock;
+    bool is_diagnostic_pin = machine.diagnostic_pin;
+    int updev = machine.userport_device;
 
     if (state->last_cpu_int != this_cpu_int) {
         /* get grid containing the two labels */
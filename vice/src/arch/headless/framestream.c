@@ -0,0 +1,577 @@
+/**
+ * \file framestream.c
+ * \brief Headless UI frame and audio streaming
+ *
+ * Sends every frame of the emulated screen and the sound to a client
+ * connected to "StreamServerAddress", for an external encoder.  Frames are
+ * sent as the 8-bit palette indices of the draw buffer, only the changed
+ * part of each line after the first one, and the sound as the 16-bit
+ * samples of the "stream" sound device.  Everything is sent at the end of
+ * the frame it belongs to, so the emulator paces the stream, and never
+ * blocks the emulation: a client too slow for the frames misses some.
+ *
+ * Every packet starts with its type (1 byte) and the length of the rest
+ * (4 bytes), all numbers are little endian:
+ *
+ * - 0x01 format: width (2), height (2), number of colors (2), and red,
+ *   green and blue of every color.  Sent before the first frame and when
+ *   any of it changes; the frame after it is a full one.
+ * - 0x02 frame: frame number (4), 1 for a full frame or 0 (1), number of
+ *   spans (2), and for every span line (2), first pixel (2), number of
+ *   pixels (2), then the pixels.  The pixels outside of the spans are the
+ *   same as in the previous frame.
+ * - 0x03 audio: frame number (4), sample rate (4), channels (1), then the
+ *   interleaved signed 16-bit samples.
+ */
+
+/* This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "machine-video.h"
+#include "palette.h"
+#include "resources.h"
+#include "screenshot.h"
+#include "sound.h"
+#include "util.h"
+#include "vicesocket.h"
+
+#include "framestream.h"
+
+
+/** \brief  Packet types */
+enum {
+    STREAM_FORMAT = 0x01,
+    STREAM_FRAME = 0x02,
+    STREAM_AUDIO = 0x03
+};
+
+/** \brief  Frames queued for the client before new ones are dropped */
+#define STREAM_QUEUE_FRAMES     3
+
+/** \brief  Bytes queued for the client before it is disconnected */
+#define STREAM_QUEUE_MAX        (16 * 1024 * 1024)
+
+/** \brief  Bytes sent at once, a socket that polls writable takes that many
+ *          without blocking */
+#define STREAM_CHUNK            4096
+
+/** \brief  Most colors sent in a format packet */
+#define STREAM_COLORS_MAX       256
+
+
+/** \brief  StreamServer resource */
+static int stream_enabled = 0;
+
+/** \brief  StreamServerAddress resource */
+static char *stream_address = NULL;
+
+/** \brief  Sample rate and channels of the stream sound device */
+static int audio_speed = 0;
+static int audio_channels = 0;
+
+/** \brief  Number of the frame being emulated */
+static uint32_t frame_number = 0;
+
+#ifdef HAVE_NETWORK
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+/** \brief  Sockets of the server and the client */
+static vice_network_socket_t *listen_socket = NULL;
+static vice_network_socket_t *client_socket = NULL;
+
+/** \brief  Packets waiting to be sent, from queue_sent on */
+static uint8_t *queue = NULL;
+static size_t queue_size = 0;
+static size_t queue_max = 0;
+static size_t queue_sent = 0;
+
+/** \brief  Size of the last frame packet, to tell how many frames are queued */
+static size_t last_frame_size = 0;
+
+/** \brief  Pixels of the last frame sent, and its format */
+static uint8_t *last_pixels = NULL;
+static unsigned int last_width = 0;
+static unsigned int last_height = 0;
+static uint8_t last_colors[STREAM_COLORS_MAX * 3];
+static unsigned int last_num_colors = 0;
+
+/** \brief  Send a full frame next */
+static bool full_frame = true;
+
+
+static uint8_t *queue_reserve(size_t len)
+{
+    uint8_t *p;
+
+    if (queue_size + len > queue_max) {
+        queue_max = (queue_size + len) * 2;
+        queue = lib_realloc(queue, queue_max);
+    }
+    p = queue + queue_size;
+    queue_size += len;
+    return p;
+}
+
+/* Start a packet, the length is filled in by packet_end() */
+static size_t packet_begin(uint8_t type)
+{
+    size_t start = queue_size;
+    uint8_t *p = queue_reserve(5);
+
+    p[0] = type;
+    return start;
+}
+
+static void packet_end(size_t start)
+{
+    util_dword_to_le_buf(queue + start + 1, (uint32_t)(queue_size - start - 5));
+}
+
+static void stream_disconnect(void)
+{
+    vice_network_socket_close(client_socket);
+    client_socket = NULL;
+    queue_size = 0;
+    queue_sent = 0;
+}
+
+static void stream_close(void)
+{
+    stream_disconnect();
+    vice_network_socket_close(listen_socket);
+    listen_socket = NULL;
+}
+
+static int stream_open(void)
+{
+    vice_network_socket_address_t *addr;
+
+    if (stream_address == NULL || *stream_address == '\0') {
+        return -1;
+    }
+    addr = vice_network_address_generate(stream_address, 0);
+    if (addr == NULL) {
+        log_error(LOG_DEFAULT, "Cannot resolve stream server address '%s'.", stream_address);
+        return -1;
+    }
+    listen_socket = vice_network_server(addr);
+    vice_network_address_close(addr);
+    if (listen_socket == NULL) {
+        log_error(LOG_DEFAULT, "Cannot open the stream server on '%s'.", stream_address);
+        return -1;
+    }
+    return 0;
+}
+
+/* Accept a client, notice when it goes away, and send what it takes
+   without blocking */
+static void stream_update(void)
+{
+    uint8_t buf[256];
+    ssize_t n;
+
+    if (client_socket == NULL) {
+        if (vice_network_select_poll_one(listen_socket) > 0) {
+            client_socket = vice_network_accept(listen_socket);
+            if (client_socket != NULL) {
+                log_message(LOG_DEFAULT, "Stream client connected.");
+                last_width = 0;
+                last_num_colors = 0;
+                full_frame = true;
+            }
+        }
+        return;
+    }
+
+    /* the client has nothing to say, reading only tells when it is gone */
+    if (vice_network_select_poll_one(client_socket) > 0) {
+        n = vice_network_receive(client_socket, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            log_message(LOG_DEFAULT, "Stream client disconnected.");
+            stream_disconnect();
+            return;
+        }
+    }
+
+    while (queue_sent < queue_size
+           && vice_network_select_poll_write_one(client_socket) > 0) {
+        n = vice_network_send(client_socket, queue + queue_sent,
+                              queue_size - queue_sent < STREAM_CHUNK
+                              ? queue_size - queue_sent : STREAM_CHUNK, SEND_FLAGS);
+        if (n <= 0) {
+            log_message(LOG_DEFAULT, "Stream client disconnected.");
+            stream_disconnect();
+            return;
+        }
+        queue_sent += (size_t)n;
+    }
+    if (queue_sent == queue_size) {
+        queue_size = 0;
+        queue_sent = 0;
+    } else if (queue_size - queue_sent > STREAM_QUEUE_MAX) {
+        log_message(LOG_DEFAULT, "Stream client too far behind, disconnected.");
+        stream_disconnect();
+    }
+}
+
+static void stream_format(unsigned int width, unsigned int height,
+                          const uint8_t *colors, unsigned int num_colors)
+{
+    size_t start = packet_begin(STREAM_FORMAT);
+    uint8_t *p = queue_reserve(6 + num_colors * 3);
+
+    util_word_to_le_buf(&p[0], (uint16_t)width);
+    util_word_to_le_buf(&p[2], (uint16_t)height);
+    util_word_to_le_buf(&p[4], (uint16_t)num_colors);
+    memcpy(&p[6], colors, num_colors * 3);
+    packet_end(start);
+}
+
+static void stream_frame(screenshot_t *screenshot)
+{
+    unsigned int width = screenshot->max_width & ~3;
+    unsigned int height = screenshot->last_displayed_line - screenshot->first_displayed_line + 1;
+    uint8_t colors[STREAM_COLORS_MAX * 3];
+    unsigned int num_colors = 0;
+    unsigned int y, first, last, spans = 0;
+    size_t start, spans_at;
+    const uint8_t *line;
+    uint8_t *prev, *p;
+    palette_t *palette = screenshot->palette;
+
+    if (palette != NULL) {
+        num_colors = palette->num_entries < STREAM_COLORS_MAX
+                     ? palette->num_entries : STREAM_COLORS_MAX;
+        for (y = 0; y < num_colors; y++) {
+            colors[y * 3] = palette->entries[y].red;
+            colors[y * 3 + 1] = palette->entries[y].green;
+            colors[y * 3 + 2] = palette->entries[y].blue;
+        }
+    }
+
+    if (width != last_width || height != last_height
+        || num_colors != last_num_colors
+        || memcmp(colors, last_colors, num_colors * 3) != 0) {
+        stream_format(width, height, colors, num_colors);
+        if (width * height != last_width * last_height) {
+            last_pixels = lib_realloc(last_pixels, width * height);
+        }
+        last_width = width;
+        last_height = height;
+        last_num_colors = num_colors;
+        memcpy(last_colors, colors, num_colors * 3);
+        full_frame = true;
+    }
+
+    start = packet_begin(STREAM_FRAME);
+    p = queue_reserve(7);
+    util_dword_to_le_buf(&p[0], frame_number);
+    p[4] = full_frame ? 1 : 0;
+    spans_at = queue_size - 2;
+
+    for (y = 0; y < height; y++) {
+        line = screenshot->draw_buffer
+               + (y + screenshot->first_displayed_line) * screenshot->draw_buffer_line_size
+               + screenshot->x_offset;
+        prev = last_pixels + y * width;
+
+        if (full_frame) {
+            first = 0;
+            last = width - 1;
+        } else {
+            for (first = 0; first < width && line[first] == prev[first]; first++) {
+            }
+            if (first == width) {
+                continue;
+            }
+            for (last = width - 1; line[last] == prev[last]; last--) {
+            }
+        }
+
+        p = queue_reserve(6 + last - first + 1);
+        util_word_to_le_buf(&p[0], (uint16_t)y);
+        util_word_to_le_buf(&p[2], (uint16_t)first);
+        util_word_to_le_buf(&p[4], (uint16_t)(last - first + 1));
+        memcpy(&p[6], &line[first], last - first + 1);
+        memcpy(&prev[first], &line[first], last - first + 1);
+        spans++;
+    }
+
+    util_word_to_le_buf(queue + spans_at, (uint16_t)spans);
+    packet_end(start);
+    last_frame_size = queue_size - start;
+    full_frame = false;
+}
+
+static void stream_end_of_frame(void)
+{
+    screenshot_t screenshot;
+    struct video_canvas_s *canvas;
+
+    if (listen_socket == NULL) {
+        return;
+    }
+    stream_update();
+    if (client_socket == NULL) {
+        return;
+    }
+
+    /* the x128 stream shows the VIC-II */
+    canvas = machine_video_canvas_get(machine_class == VICE_MACHINE_C128 ? 1 : 0);
+    if (canvas == NULL || machine_screenshot(&screenshot, canvas) < 0
+        || screenshot.draw_buffer == NULL || screenshot.max_width < 4) {
+        return;
+    }
+
+    /* drop the frame while the client is still busy with the last ones,
+       a full one follows */
+    if (last_frame_size > 0
+        && queue_size - queue_sent > STREAM_QUEUE_FRAMES * last_frame_size) {
+        full_frame = true;
+        return;
+    }
+
+    stream_frame(&screenshot);
+    stream_update();
+}
+
+/** \brief  Send the frame just emulated
+ *
+ * Called at the end of every frame, after the sound of it was written.
+ */
+void framestream_end_of_frame(void)
+{
+    stream_end_of_frame();
+    frame_number++;
+}
+
+/** \brief  Check whether the pixels of every frame are needed
+ *
+ * \return  true while a client is connected
+ */
+bool framestream_wants_pixels(void)
+{
+    return client_socket != NULL;
+}
+
+static int stream_write(int16_t *pbuf, size_t nr)
+{
+    size_t start;
+    uint8_t *p;
+    size_t i;
+
+    if (client_socket == NULL || nr == 0) {
+        return 0;
+    }
+
+    start = packet_begin(STREAM_AUDIO);
+    p = queue_reserve(9 + nr * 2);
+    util_dword_to_le_buf(&p[0], frame_number);
+    util_dword_to_le_buf(&p[4], (uint32_t)audio_speed);
+    p[8] = (uint8_t)audio_channels;
+    for (i = 0; i < nr; i++) {
+        util_word_to_le_buf(&p[9 + i * 2], (uint16_t)pbuf[i]);
+    }
+    packet_end(start);
+
+    return 0;
+}
+
+#else
+
+void framestream_end_of_frame(void)
+{
+    frame_number++;
+}
+
+bool framestream_wants_pixels(void)
+{
+    return false;
+}
+
+static int stream_write(int16_t *pbuf, size_t nr)
+{
+    return 0;
+}
+
+static int stream_open(void)
+{
+    log_error(LOG_DEFAULT, "Streaming needs network support.");
+    return -1;
+}
+
+static void stream_close(void)
+{
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static int stream_init(const char *param, int *speed, int *fragsize, int *fragnr, int *channels)
+{
+    audio_speed = *speed;
+    audio_channels = *channels;
+    return 0;
+}
+
+/** \brief  Sound device sending the samples with the frames
+ *
+ * Not a timing source, the emulator paces itself like with "dummy".
+ */
+static const sound_device_t stream_device =
+{
+    "stream",
+    stream_init,
+    stream_write,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0,
+    2,
+    false
+};
+
+int sound_init_stream_device(void)
+{
+    return sound_register_device(&stream_device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_stream_enabled(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+    if (val == stream_enabled) {
+        return 0;
+    }
+    if (val) {
+        if (stream_open() < 0) {
+            return -1;
+        }
+    } else {
+        stream_close();
+    }
+    stream_enabled = val;
+    return 0;
+}
+
+static int set_stream_address(const char *name, void *param)
+{
+    if (stream_address != NULL && name != NULL
+        && strcmp(name, stream_address) == 0) {
+        return 0;
+    }
+
+    if (stream_enabled) {
+        stream_close();
+    }
+    util_string_set(&stream_address, name);
+    if (stream_enabled && stream_open() < 0) {
+        stream_enabled = 0;
+    }
+    return 0;
+}
+
+/** \brief  String resources of the frame stream
+ */
+static const resource_string_t resources_string[] = {
+    { "StreamServerAddress", "ip4://127.0.0.1:6510", RES_EVENT_NO, NULL,
+      &stream_address, set_stream_address, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+/** \brief  Integer/boolean resources of the frame stream
+ */
+static const resource_int_t resources_int[] = {
+    { "StreamServer", 0, RES_EVENT_NO, NULL,
+      &stream_enabled, set_stream_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+/** \brief  Command line options of the frame stream
+ */
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-stream", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "StreamServer", (void *)1,
+      NULL, "Send the frames and the sound of the \"stream\" sound device to a client" },
+    { "+stream", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "StreamServer", (void *)0,
+      NULL, "Do not stream the frames" },
+    { "-streamaddress", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "StreamServerAddress", NULL,
+      "<Name>", "The local address the stream server should bind to" },
+    CMDLINE_LIST_END
+};
+
+/** \brief  Register the resources of the frame stream
+ *
+ * \return  0 on success, < 0 on failure
+ */
+int framestream_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+    return resources_register_int(resources_int);
+}
+
+/** \brief  Register the command line options of the frame stream
+ *
+ * \return  0 on success, < 0 on failure
+ */
+int framestream_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/** \brief  Close the stream and free its resources
+ */
+void framestream_shutdown(void)
+{
+    stream_close();
+#ifdef HAVE_NETWORK
+    lib_free(queue);
+    queue = NULL;
+    lib_free(last_pixels);
+    last_pixels = NULL;
+#endif
+    lib_free(stream_address);
+    stream_address = NULL;
+}
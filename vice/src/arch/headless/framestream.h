@@ -0,0 +1,38 @@
+/**
+ * \file framestream.h
+ * \brief Headless UI frame and audio streaming - header
+ */
+
+/* This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FRAMESTREAM_H
+#define VICE_FRAMESTREAM_H
+
+#include <stdbool.h>
+
+int framestream_resources_init(void);
+int framestream_cmdline_options_init(void);
+void framestream_shutdown(void);
+
+bool framestream_wants_pixels(void);
+void framestream_end_of_frame(void);
+
+#endif
@@ -31,16 +31,43 @@
 #include <stdio.h>
 
 #include "cmdline.h"
+#include "framestream.h"
 #include "machine.h"
+#include "maincpu.h"
 #include "resources.h"
 #include "videoarch.h"
 #include "video.h"
 
 
+/** \brief  Don't draw the pixels of frames nobody asked for
+ */
+static int no_video = 0;
+
+
+/** \brief  Set the NoVideo resource
+ *
+ * \param[in]   val     new value
+ * \param[in]   param   extra argument (unused)
+ *
+ * \return 0
+ */
+static int set_no_video(int val, void *param)
+{
+    no_video = val ? 1 : 0;
+    return 0;
+}
+
+
 /** \brief  Command line options related to generic video output
  */
 static const cmdline_option_t cmdline_options[] =
 {
+    { "-novideo", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NoVideo", (void *)1,
+      NULL, "Only draw the frames that screenshots or the monitor ask for" },
+    { "+novideo", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NoVideo", (void *)0,
+      NULL, "Draw every frame" },
     CMDLINE_LIST_END
 };
 
@@ -49,9 +76,59 @@ static const cmdline_option_t cmdline_options[] =
  */
 static const resource_int_t resources_int[] =
 {
+    { "NoVideo", 0, RES_EVENT_NO, NULL,
+      &no_video, set_no_video, NULL },
     RESOURCE_INT_LIST_END
 };
 
+
+/** \brief  Check if an exit screenshot may be written during the next frame
+ *
+ * \param[in]   name    resource holding the screenshot file name
+ *
+ * \return  true if the pixels of the next frame are needed for it
+ */
+static bool exit_screenshot_due(const char *name)
+{
+    const char *filename = NULL;
+    CLOCK frame;
+
+    if (resources_get_string(name, &filename) < 0
+            || filename == NULL || *filename == '\0') {
+        return false;
+    }
+
+    /* only a cycle limit tells when the emulator exits, without one every
+       frame may be the last */
+    if (maincpu_clk_limit == 0) {
+        return true;
+    }
+    frame = (CLOCK)machine_get_cycles_per_frame();
+    return maincpu_clk_limit <= maincpu_clk + 2 * frame;
+}
+
+
+/** \brief  Decide whether the pixels of the next frame are drawn
+ *
+ * Called at the end of every frame.  With NoVideo the chips skip drawing
+ * unless the next frame may end up in the exit screenshot or is streamed,
+ * or something asked for the pixels, see video_pixels_request().  Those
+ * take the whole screen, so the next frame is not clipped to the viewport
+ * either.
+ */
+void video_headless_end_of_frame(void)
+{
+    bool needed;
+
+    needed = framestream_wants_pixels()
+             || exit_screenshot_due("ExitScreenshotName")
+             || (machine_class == VICE_MACHINE_C128
+                 && exit_screenshot_due("ExitScreenshotName1"));
+
+    video_pixels_set_skipped(no_video && !needed);
+    video_pixels_set_clipping(!needed);
+}
+
 /** \brief  Arch-sepcific function to check which chip is
  *          currently "active", or has the focus of the user.
  *
@@ -83,6 +160,9 @@ int video_arch_cmdline_options_init(void)
     /* printf("%s\n", __func__); */
 
     if (machine_class != VICE_MACHINE_VSID) {
+        if (framestream_cmdline_options_init() < 0) {
+            return -1;
+        }
         return cmdline_register_options(cmdline_options);
     }
     return 0;
@@ -98,6 +178,9 @@ int video_arch_resources_init(void)
     /* printf("%s\n", __func__); */
 
     if (machine_class != VICE_MACHINE_VSID) {
+        if (framestream_resources_init() < 0) {
+            return -1;
+        }
         return resources_register_int(resources_int);
     }
     return 0;
@@ -107,6 +190,10 @@ int video_arch_resources_init(void)
 void video_arch_resources_shutdown(void)
 {
     /* printf("%s\n", __func__); */
+
+    if (machine_class != VICE_MACHINE_VSID) {
+        framestream_shutdown();
+    }
 }
 
 /** \brief Query whether a canvas is resizable.
@@ -120,6 +207,15 @@ char video_canvas_can_resize(video_canvas_t *canvas)
     return 0;
 }
 
+/** \brief Query whether the display of a canvas can show another frame.
+ *  \param canvas The canvas to query
+ *  \return true, there is no display to wait for.
+ */
+bool video_canvas_ready_for_frame(video_canvas_t *canvas)
+{
+    return true;
+}
+
 /** \brief Create a new video_canvas_s.
  *  \param[inout] canvas A freshly allocated canvas object.
  *  \param[in]    width  Pointer to a width value. May be NULL if canvas
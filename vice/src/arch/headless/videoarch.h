@@ -67,4 +67,6 @@ typedef struct video_canvas_s {
 typedef struct vice_renderer_backend_s {
 } vice_renderer_backend_t;
 
+void video_headless_end_of_frame(void);
+
 #endif
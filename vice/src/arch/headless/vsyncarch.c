@@ -30,6 +30,7 @@
 
 #include "vice.h"
 
+#include "framestream.h"
 #include "kbdbuf.h"
 #include "mainlock.h"
 #include "ui.h"
@@ -69,6 +70,9 @@ void vsyncarch_presync(void)
 
 void vsyncarch_postsync(void)
 {
+    framestream_end_of_frame();
+    video_headless_end_of_frame();
+
     /* this function is called once a frame, so this
        handles single frame advance */
     if (pause_pending) {
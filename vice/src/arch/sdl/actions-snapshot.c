@@ -32,10 +32,12 @@
 
 #include "menu_common.h"
 #include "menu_snapshot.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "uiactions.h"
 #include "uimenu.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 #include "actions-snapshot.h"
 
@@ -135,6 +137,26 @@ static void history_playback_stop_action(ui_action_map_t *self)
     ui_action_finish(self->action);
 }
 
+/** \brief  Skip back ten seconds in history playback action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_back_action(ui_action_map_t *self)
+{
+    event_playback_skip(-10);
+    ui_action_finish(self->action);
+}
+
+/** \brief  Skip forward ten seconds in history playback action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_forward_action(ui_action_map_t *self)
+{
+    event_playback_skip(10);
+    ui_action_finish(self->action);
+}
+
 /** \brief  Start history recording action
  *
  * \param[in]   self    action map
@@ -172,6 +194,24 @@ static void history_milestone_set_action(ui_action_map_t *self)
     event_record_set_milestone();
 }
 
+/** \brief  Rewind one frame action
+ *
+ * \param[in]   self    action map
+ */
+static void rewind_frame_action(ui_action_map_t *self)
+{
+    rewind_step_back(1);
+}
+
+/** \brief  Rewind one second action
+ *
+ * \param[in]   self    action map
+ */
+static void rewind_second_action(ui_action_map_t *self)
+{
+    rewind_step_back((int)(vsync_get_refresh_frequency() + 0.5));
+}
+
 /** \brief  Reset history to milestone action
  *
  * \param[in]   self    action map
@@ -208,6 +248,14 @@ static const ui_action_map_t snapshot_actions[] = {
         .handler = history_playback_stop_action,
         .blocks  = true
     },
+    {   .action  = ACTION_HISTORY_PLAYBACK_BACK,
+        .handler = history_playback_back_action,
+        .blocks  = true
+    },
+    {   .action  = ACTION_HISTORY_PLAYBACK_FORWARD,
+        .handler = history_playback_forward_action,
+        .blocks  = true
+    },
     {   .action  = ACTION_HISTORY_RECORD_START,
         .handler = history_record_start_action,
         .blocks  = true
@@ -222,6 +270,12 @@ static const ui_action_map_t snapshot_actions[] = {
     {   .action  = ACTION_HISTORY_MILESTONE_RESET,
         .handler = history_milestone_reset_action
     },
+    {   .action  = ACTION_REWIND_FRAME,
+        .handler = rewind_frame_action
+    },
+    {   .action  = ACTION_REWIND_SECOND,
+        .handler = rewind_second_action
+    },
     UI_ACTION_MAP_TERMINATOR
 };
 
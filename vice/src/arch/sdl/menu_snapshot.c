@@ -51,6 +51,7 @@ static int save_disks = 1;
 static int save_roms = 0;
 
 UI_MENU_DEFINE_RADIO(EventStartMode)
+UI_MENU_DEFINE_TOGGLE(Rewind)
 
 static UI_MENU_CALLBACK(toggle_save_disk_images_callback)
 {
@@ -311,6 +312,16 @@ ui_menu_entry_t snapshot_menu[] = {
         .status    = MENU_STATUS_INACTIVE,
         .activated = MENU_EXIT_UI_STRING
     },
+    {   .action    = ACTION_HISTORY_PLAYBACK_BACK,
+        .string    = "Skip back 10 seconds",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
+    {   .action    = ACTION_HISTORY_PLAYBACK_FORWARD,
+        .string    = "Skip forward 10 seconds",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
 
     {   .action    = ACTION_HISTORY_MILESTONE_SET,
         .string    = "Set recording milestone",
@@ -324,6 +335,22 @@ ui_menu_entry_t snapshot_menu[] = {
     },
     SDL_MENU_ITEM_SEPARATOR,
 
+    {   .string   = "Record rewind buffer",
+        .type     = MENU_ENTRY_RESOURCE_TOGGLE,
+        .callback = toggle_Rewind_callback
+    },
+    {   .action    = ACTION_REWIND_FRAME,
+        .string    = "Rewind one frame",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
+    {   .action    = ACTION_REWIND_SECOND,
+        .string    = "Rewind one second",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
+    SDL_MENU_ITEM_SEPARATOR,
+
     SDL_MENU_ITEM_TITLE("Record start mode"),
     {   .string   = "Save new snapshot",
         .type     = MENU_ENTRY_RESOURCE_RADIO,
@@ -1141,6 +1141,12 @@ char video_canvas_can_resize(video_canvas_t *canvas)
     return 1;
 }
 
+/* frames are shown right away, so the display always takes the next one */
+bool video_canvas_ready_for_frame(video_canvas_t *canvas)
+{
+    return true;
+}
+
 void sdl_ui_init_finalize(void)
 {
     unsigned int width = sdl_active_canvas->draw_buffer->canvas_width;
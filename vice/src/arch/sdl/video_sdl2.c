@@ -49,6 +49,8 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
+
 #include "vice_sdl.h"
 
 #include "archdep.h"
@@ -290,6 +292,7 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
         return;
     }
 
+    canvas->texture_is_current = 0;
     width = surface->w;
     height = surface->h;
 
@@ -320,6 +323,50 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
 }
 
 
+/* Copy rows of the screen surface to the streaming texture.  Locking the
+   texture gives memory that goes to the GPU directly, rather than
+   SDL_UpdateTexture() copying the pixels once more.  */
+static void update_canvas_texture(video_canvas_t *canvas, unsigned int y, unsigned int rows)
+{
+    SDL_Surface *surface = canvas->screen;
+    SDL_Rect rect;
+    const uint8_t *src;
+    uint8_t *dst;
+    void *pixels;
+    int pitch;
+    size_t len;
+    unsigned int i;
+
+    if (!canvas->texture_is_current) {
+        y = 0;
+        rows = (unsigned int)surface->h;
+    }
+    if (rows == 0) {
+        return;
+    }
+
+    rect.x = 0;
+    rect.y = (int)y;
+    rect.w = surface->w;
+    rect.h = (int)rows;
+    src = (const uint8_t *)surface->pixels + y * surface->pitch;
+
+    if (SDL_LockTexture(canvas->texture, &rect, &pixels, &pitch) < 0) {
+        SDL_UpdateTexture(canvas->texture, &rect, src, surface->pitch);
+    } else {
+        /* the locked memory is write only, every pixel of it has to be set */
+        dst = pixels;
+        len = (size_t)surface->w * surface->format->BytesPerPixel;
+        for (i = 0; i < rows; i++) {
+            memcpy(dst, src, len);
+            dst += pitch;
+            src += surface->pitch;
+        }
+        SDL_UnlockTexture(canvas->texture);
+    }
+    canvas->texture_is_current = 1;
+}
+
 static void recreate_all_textures(void)
 {
     int i;
@@ -865,11 +912,11 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
         recreate_textures = 0;
         /* NOTE: The texture isn't holding the screen's values
          *       here. We can get away with that because the call to
-         *       SDL_UpdateTexture below updates the entire canvas */
+         *       update_canvas_texture below then updates the entire canvas */
     }
 
-    /* Upload the new frame to the GPU texture. TODO: use SDL_LockTexture for this as the docs day it's faster. */
-    SDL_UpdateTexture(canvas->texture, NULL, canvas->screen->pixels, canvas->screen->pitch);
+    /* Upload the new frame to the GPU texture */
+    update_canvas_texture(canvas, yi, h);
 
     /* Render. */
     SDL_RenderClear(canvas->container->renderer);
@@ -926,10 +973,15 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
 
     SDL_RenderPresent(canvas->container->renderer);
 
-    /* Swap the textures references so we can easily re-render this frame under the next frame. */
-    texture_swap = canvas->previous_frame_texture;
-    canvas->previous_frame_texture = canvas->texture;
-    canvas->texture = texture_swap;
+    /* Swap the textures references so we can easily re-render this frame
+       under the next frame.  Otherwise the texture keeps the frame, and the
+       next one only needs the rows rendered for it.  */
+    if (canvas->videoconfig->interlaced) {
+        texture_swap = canvas->previous_frame_texture;
+        canvas->previous_frame_texture = canvas->texture;
+        canvas->texture = texture_swap;
+        canvas->texture_is_current = 0;
+    }
 
     if (canvas->container->leaving_fullscreen) {
         int curr_w, curr_h, flags;
@@ -1263,6 +1315,12 @@ char video_canvas_can_resize(video_canvas_t *canvas)
     return 1;
 }
 
+/* frames are shown right away, so the display always takes the next one */
+bool video_canvas_ready_for_frame(video_canvas_t *canvas)
+{
+    return true;
+}
+
 /** \brief  Hides the secondary window.
  *
  * Internally this just destroys the window and its textures.
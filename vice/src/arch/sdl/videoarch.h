@@ -105,6 +105,10 @@ struct video_canvas_s {
     /** \brief Last frame's texture, used for interlaced modes. */
     SDL_Texture* previous_frame_texture;
 
+    /** \brief texture holds the whole screen surface as of the last refresh,
+     *         so only the rows rendered since have to be uploaded */
+    int texture_is_current;
+
     /** \brief The SDL2 objects that this canvas can output to. */
     video_container_t* container;
 #endif
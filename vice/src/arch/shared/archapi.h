@@ -68,6 +68,7 @@
 #include "archdep_file_exists.h"
 #include "archdep_file_is_blockdev.h"
 #include "archdep_file_is_chardev.h"
+#include "archdep_file_map.h"
 #include "archdep_file_size.h"
 #include "archdep_filename_parameter.h"
 #include "archdep_fix_permissions.h"
@@ -89,6 +90,7 @@
 #include "archdep_is_macos_bindist.h"
 #include "archdep_is_windows_nt.h"
 #include "archdep_kbd_get_host_mapping.h"
+#include "archdep_large_alloc.h"
 #include "archdep_list_drives.h"
 #include "archdep_make_backup_filename.h"
 #include "archdep_mkdir.h"
@@ -0,0 +1,201 @@
+/** \file   archdep_file_map.c
+ * \brief   Map a file into memory
+ *
+ * Used for RAM expansion images, so attaching a large image does not read
+ * the whole file and several emulator instances using the same image share
+ * its pages until they write to them.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+#include "archdep_defs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(UNIX_COMPILE)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#elif defined(WINDOWS_COMPILE)
+# include <windows.h>
+#endif
+
+#include "lib.h"
+
+#include "archdep_file_map.h"
+
+
+/** \brief  Mapped file */
+struct archdep_file_map_s {
+    uint8_t *data;      /**< start of the mapping */
+    size_t size;        /**< size of the mapping */
+    int shared;         /**< writes go to the file */
+#ifdef WINDOWS_COMPILE
+    HANDLE file;        /**< file handle */
+    HANDLE mapping;     /**< file mapping handle */
+#endif
+};
+
+
+/** \brief  Map a file into memory
+ *
+ * With \a shared set, writes to the mapped memory go to the file. Otherwise
+ * the mapping is copy-on-write and the file is left alone, it is opened
+ * read-only then.
+ *
+ * \param[in]   path    pathname of the file
+ * \param[in]   size    size to map, must match the size of the file
+ * \param[in]   shared  write changes back to the file
+ *
+ * \return  mapping or NULL if the file cannot be mapped, the caller should
+ *          then fall back to reading the file
+ */
+archdep_file_map_t *archdep_file_map(const char *path, size_t size, int shared)
+{
+#if defined(UNIX_COMPILE)
+    archdep_file_map_t *map;
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, shared ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size != size) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    /* the mapping keeps its own reference to the file */
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    map = lib_malloc(sizeof *map);
+    map->data = data;
+    map->size = size;
+    map->shared = shared;
+    return map;
+#elif defined(WINDOWS_COMPILE)
+    archdep_file_map_t *map;
+    LARGE_INTEGER file_size;
+    HANDLE file;
+    HANDLE mapping;
+    void *data;
+
+    file = CreateFileA(path, shared ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &file_size) || (size_t)file_size.QuadPart != size) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, shared ? PAGE_READWRITE : PAGE_WRITECOPY,
+                                 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return NULL;
+    }
+    data = MapViewOfFile(mapping, shared ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, size);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return NULL;
+    }
+
+    map = lib_malloc(sizeof *map);
+    map->data = data;
+    map->size = size;
+    map->shared = shared;
+    map->file = file;
+    map->mapping = mapping;
+    return map;
+#else
+    return NULL;
+#endif
+}
+
+/** \brief  Get the start of a mapped file
+ *
+ * \param[in]   map mapping
+ *
+ * \return  pointer to the mapped memory
+ */
+uint8_t *archdep_file_map_data(archdep_file_map_t *map)
+{
+    return map->data;
+}
+
+/** \brief  Write the changes of a shared mapping to the file
+ *
+ * \param[in]   map mapping
+ *
+ * \return  0 on success, -1 on failure
+ */
+int archdep_file_map_sync(archdep_file_map_t *map)
+{
+    if (!map->shared) {
+        return 0;
+    }
+#if defined(UNIX_COMPILE)
+    return msync(map->data, map->size, MS_SYNC) == 0 ? 0 : -1;
+#elif defined(WINDOWS_COMPILE)
+    if (!FlushViewOfFile(map->data, 0) || !FlushFileBuffers(map->file)) {
+        return -1;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/** \brief  Unmap a file
+ *
+ * Changes of a shared mapping are not guaranteed to be on disk before
+ * archdep_file_map_sync() has been called.
+ *
+ * \param[in]   map mapping
+ */
+void archdep_file_map_close(archdep_file_map_t *map)
+{
+    if (map == NULL) {
+        return;
+    }
+#if defined(UNIX_COMPILE)
+    munmap(map->data, map->size);
+#elif defined(WINDOWS_COMPILE)
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#endif
+    lib_free(map);
+}
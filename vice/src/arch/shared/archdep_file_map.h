@@ -0,0 +1,39 @@
+/** \file   archdep_file_map.h
+ * \brief   Map a file into memory - header
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_ARCHDEP_FILE_MAP_H
+#define VICE_ARCHDEP_FILE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct archdep_file_map_s archdep_file_map_t;
+
+archdep_file_map_t *archdep_file_map(const char *path, size_t size, int shared);
+uint8_t *archdep_file_map_data(archdep_file_map_t *map);
+int archdep_file_map_sync(archdep_file_map_t *map);
+void archdep_file_map_close(archdep_file_map_t *map);
+
+#endif
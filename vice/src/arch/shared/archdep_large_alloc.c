@@ -0,0 +1,210 @@
+/** \file   archdep_large_alloc.c
+ * \brief   Allocate large, long-lived buffers
+ *
+ * Used for RAM expansions and frame buffers, which are allocated once and
+ * then accessed all over for a long time.  The memory is taken directly from
+ * the system, aligned to a page, or to a huge page for buffers of at least
+ * that size which are also marked for transparent huge pages where
+ * available.  All pages are touched right away, so accessing the buffer
+ * later does not page fault in the middle of a frame.
+ *
+ * Like with lib_calloc() the memory is cleared and running out of it is
+ * fatal.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+#include "archdep_defs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(UNIX_COMPILE)
+# include <sys/mman.h>
+# include <unistd.h>
+#elif defined(WINDOWS_COMPILE)
+# include <windows.h>
+#endif
+
+#include "lib.h"
+
+#include "archdep_large_alloc.h"
+
+
+/** \brief  Size of a huge page, also used for the alignment of large buffers */
+#define HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+/** \brief  Fallback page size */
+#define PAGE_SIZE_DEFAULT   4096
+
+/** \brief  Bookkeeping stored right in front of a buffer */
+typedef struct large_header_s {
+    void *base;         /**< start of the allocation */
+    size_t length;      /**< length of the allocation */
+    size_t size;        /**< size requested by the caller */
+    int system;         /**< allocated from the system, not lib_calloc() */
+} large_header_t;
+
+
+static size_t page_size(void)
+{
+#if defined(UNIX_COMPILE)
+    long size = sysconf(_SC_PAGESIZE);
+
+    return size > 0 ? (size_t)size : PAGE_SIZE_DEFAULT;
+#elif defined(WINDOWS_COMPILE)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwPageSize > 0 ? (size_t)info.dwPageSize : PAGE_SIZE_DEFAULT;
+#else
+    return PAGE_SIZE_DEFAULT;
+#endif
+}
+
+/* Get cleared memory from the system, NULL on failure.  */
+static void *system_alloc(size_t length)
+{
+#if defined(UNIX_COMPILE) && defined(MAP_ANONYMOUS)
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return p == MAP_FAILED ? NULL : p;
+#elif defined(WINDOWS_COMPILE)
+    return VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    return NULL;
+#endif
+}
+
+static void system_free(void *p, size_t length)
+{
+#if defined(UNIX_COMPILE) && defined(MAP_ANONYMOUS)
+    munmap(p, length);
+#elif defined(WINDOWS_COMPILE)
+    VirtualFree(p, 0, MEM_RELEASE);
+#endif
+}
+
+
+/** \brief  Allocate a large buffer
+ *
+ * \param[in]   size    size of the buffer in bytes
+ *
+ * \return  cleared buffer, to be freed with archdep_large_free()
+ */
+void *archdep_large_alloc(size_t size)
+{
+    large_header_t *header;
+    size_t page = page_size();
+    size_t align = size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : page;
+    size_t length = size + align + sizeof(large_header_t);
+    uint8_t *base;
+    uint8_t *data;
+    int system = 1;
+    size_t i;
+
+    base = system_alloc(length);
+    if (base == NULL) {
+        /* the pages are still touched below, only the alignment is lost */
+        align = sizeof(large_header_t);
+        length = size + align + sizeof(large_header_t);
+        base = lib_calloc(1, length);
+        system = 0;
+    }
+
+    data = base + sizeof(large_header_t);
+    data += (align - ((uintptr_t)data % align)) % align;
+
+#if defined(UNIX_COMPILE) && defined(MADV_HUGEPAGE)
+    if (system && size >= HUGE_PAGE_SIZE) {
+        /* only a hint, the buffer works the same without huge pages */
+        madvise(data, size - size % HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+    }
+#endif
+
+    /* pre-fault every page now rather than during emulation */
+    for (i = 0; i < size; i += page) {
+        ((volatile uint8_t *)data)[i] = 0;
+    }
+
+    header = (large_header_t *)data - 1;
+    header->base = base;
+    header->length = length;
+    header->size = size;
+    header->system = system;
+
+    return data;
+}
+
+/** \brief  Change the size of a large buffer
+ *
+ * The contents are kept up to the smaller of the old and new size, memory
+ * added at the end is cleared.
+ *
+ * \param[in]   p       buffer from archdep_large_alloc(), or NULL
+ * \param[in]   size    new size of the buffer in bytes
+ *
+ * \return  the resized buffer, to be freed with archdep_large_free()
+ */
+void *archdep_large_realloc(void *p, size_t size)
+{
+    large_header_t *header;
+    void *data;
+
+    if (p == NULL) {
+        return archdep_large_alloc(size);
+    }
+
+    header = (large_header_t *)p - 1;
+    if (header->size == size) {
+        return p;
+    }
+
+    data = archdep_large_alloc(size);
+    memcpy(data, p, header->size < size ? header->size : size);
+    archdep_large_free(p);
+
+    return data;
+}
+
+/** \brief  Free a large buffer
+ *
+ * \param[in]   p   buffer from archdep_large_alloc(), or NULL
+ */
+void archdep_large_free(void *p)
+{
+    large_header_t *header;
+
+    if (p == NULL) {
+        return;
+    }
+
+    header = (large_header_t *)p - 1;
+    if (header->system) {
+        system_free(header->base, header->length);
+    } else {
+        lib_free(header->base);
+    }
+}
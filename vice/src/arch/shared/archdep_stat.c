@@ -71,3 +71,24 @@ int archdep_stat(const char *path, size_t *len, unsigned int *isdir)
     }
     return 0;
 }
+
+
+/** \brief  Determine the size and modification time of \a path
+ *
+ * \param[in]   path    pathname
+ * \param[out]  len     length of file \a path
+ * \param[out]  mtime   time of last modification of \a path
+ *
+ * \return  0 on success, -1 on failure
+ */
+int archdep_stat_mtime(const char *path, size_t *len, time_t *mtime)
+{
+    struct stat statbuf;
+
+    if (stat(path, &statbuf) < 0) {
+        return -1;
+    }
+    *len = statbuf.st_size;
+    *mtime = statbuf.st_mtime;
+    return 0;
+}
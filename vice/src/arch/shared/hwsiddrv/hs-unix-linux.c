@@ -27,6 +27,14 @@
  *
  */
 
+/* The writes and delays for the SID are not done right away, but put into a
+   queue with the cycles since the last one, so the emulation never waits for
+   the device.  A writer thread takes what is queued and writes the register
+   writes that follow each other to the device with a single write().  The
+   emulation only waits when the queue is full, and before a read, which has
+   to see all writes before it.  If the thread cannot be started, the queue
+   is not used.  */
+
 #include "vice.h"
 
 #ifdef UNIX_COMPILE
@@ -34,6 +42,8 @@
 #if defined(HAVE_HARDSID) && defined(HAVE_LINUX_HARDSID_H)
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
@@ -59,8 +69,171 @@ static alarm_t *hsid_alarm = 0;
 
 static int sids_found = -1;
 
+/* Number of writes and delays that can be queued, a power of two.  */
+#define HARDSID_QUEUE_SIZE  4096
+
+typedef struct hsid_queue_entry_s {
+    int delay;      /* delay instead of a write */
+    uint packet;
+} hsid_queue_entry_t;
+
+static hsid_queue_entry_t hsid_queue[HARDSID_QUEUE_SIZE];
+static unsigned int queue_head = 0;    /* next entry to fill */
+static unsigned int queue_tail = 0;    /* next entry for the thread */
+static unsigned int queue_busy = 0;    /* entries taken by the thread */
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when something was queued or the thread should stop */
+static pthread_cond_t queue_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when the thread is done with entries */
+static pthread_cond_t queue_done = PTHREAD_COND_INITIALIZER;
+
+static pthread_t hsid_thread;
+static int thread_running = 0;
+static int thread_stop = 0;
+
 static void hardsid_alarm_handler(CLOCK offset, void *data);
 
+/* ---------------------------------------------------------------------*/
+
+static void hsid_do_delay(uint cycles)
+{
+    ioctl(hsid_fd, HSID_IOCTL_DELAY, cycles);
+}
+
+static void hsid_do_write(const uint *packets, size_t num)
+{
+    if (write(hsid_fd, packets, num * sizeof(uint)) < 0) {
+        /* nothing sensible to do, the tune goes on */
+    }
+}
+
+/* Do the entries from `start' on, in order, writing the writes that follow
+   each other at once.  */
+static void hsid_do_entries(unsigned int start, unsigned int num)
+{
+    uint packets[HARDSID_QUEUE_SIZE];
+    size_t num_packets = 0;
+    unsigned int i;
+
+    for (i = 0; i < num; i++) {
+        hsid_queue_entry_t *entry = &hsid_queue[(start + i) & (HARDSID_QUEUE_SIZE - 1)];
+
+        if (entry->delay) {
+            if (num_packets > 0) {
+                hsid_do_write(packets, num_packets);
+                num_packets = 0;
+            }
+            hsid_do_delay(entry->packet);
+        } else {
+            packets[num_packets++] = entry->packet;
+        }
+    }
+    if (num_packets > 0) {
+        hsid_do_write(packets, num_packets);
+    }
+}
+
+static void *hsid_thread_main(void *unused)
+{
+    unsigned int start, num;
+
+    pthread_mutex_lock(&queue_lock);
+    while (1) {
+        while (queue_head == queue_tail && !thread_stop) {
+            pthread_cond_wait(&queue_queued, &queue_lock);
+        }
+        if (queue_head == queue_tail) {
+            break;
+        }
+        start = queue_tail;
+        num = queue_head - queue_tail;
+        queue_busy = num;
+        pthread_mutex_unlock(&queue_lock);
+
+        hsid_do_entries(start, num);
+
+        pthread_mutex_lock(&queue_lock);
+        queue_tail += num;
+        queue_busy = 0;
+        pthread_cond_broadcast(&queue_done);
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return NULL;
+}
+
+static void hsid_thread_start(void)
+{
+    struct sched_param param;
+
+    queue_head = queue_tail = 0;
+    thread_stop = 0;
+    if (pthread_create(&hsid_thread, NULL, hsid_thread_main, NULL)) {
+        log_warning(LOG_DEFAULT, "Linux HardSID: cannot start writer thread, writing directly.");
+        return;
+    }
+    thread_running = 1;
+
+    /* The timing of the writes is what is heard, so try to get ahead of
+       the other threads.  That is only allowed with the right privileges,
+       without them the thread runs at normal priority.  */
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(hsid_thread, SCHED_FIFO, &param);
+}
+
+static void hsid_thread_stop(void)
+{
+    if (!thread_running) {
+        return;
+    }
+    pthread_mutex_lock(&queue_lock);
+    thread_stop = 1;
+    pthread_cond_signal(&queue_queued);
+    pthread_mutex_unlock(&queue_lock);
+
+    pthread_join(hsid_thread, NULL);
+    thread_running = 0;
+}
+
+/* Queue a write or a delay, or do it right away without the thread.  */
+static void hsid_queue_entry(int delay, uint packet)
+{
+    if (!thread_running) {
+        if (delay) {
+            hsid_do_delay(packet);
+        } else {
+            hsid_do_write(&packet, 1);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    while (queue_head - queue_tail == HARDSID_QUEUE_SIZE) {
+        pthread_cond_wait(&queue_done, &queue_lock);
+    }
+    hsid_queue[queue_head & (HARDSID_QUEUE_SIZE - 1)].delay = delay;
+    hsid_queue[queue_head & (HARDSID_QUEUE_SIZE - 1)].packet = packet;
+    queue_head++;
+    pthread_cond_signal(&queue_queued);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/* Wait until everything queued was written to the device.  */
+static void hsid_queue_sync(void)
+{
+    if (!thread_running) {
+        return;
+    }
+    pthread_mutex_lock(&queue_lock);
+    while (queue_head != queue_tail) {
+        pthread_cond_wait(&queue_done, &queue_lock);
+    }
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/* ---------------------------------------------------------------------*/
+
 static int hardsid_init(void)
 {
     /* Already open */
@@ -112,6 +285,7 @@ int hs_linux_open(void)
         return -1;
     }
     hsid_alarm = alarm_new(maincpu_alarm_context, "hardsid", hardsid_alarm_handler, 0);
+    hsid_thread_start();
     sids_found = 1;
     hardsid_reset();
     log_message(LOG_DEFAULT, "Linux HardSID: opened.");
@@ -120,9 +294,13 @@ int hs_linux_open(void)
 
 int hs_linux_close(void)
 {
+    /* write what is still queued before closing */
+    hsid_thread_stop();
+
     /* Driver cleans up after itself */
     if (hsid_fd >= 0) {
         close(hsid_fd);
+        hsid_fd = -1;
     }
     alarm_destroy(hsid_alarm);
     hsid_alarm = 0;
@@ -139,10 +317,13 @@ int hs_linux_read(uint16_t addr, int chipno)
 
         while (cycles > 0xffff) {
             /* delay */
-            ioctl(hsid_fd, HSID_IOCTL_DELAY, 0xffff);
+            hsid_queue_entry(1, 0xffff);
             cycles -= 0xffff;
         }
 
+        /* the read has to come after the writes queued so far */
+        hsid_queue_sync();
+
         {
             uint packet = ((cycles & 0xffff) << 16) | ((addr & 0x1f) << 8);
             ioctl(hsid_fd, HSID_IOCTL_READ, &packet);
@@ -160,12 +341,12 @@ void hs_linux_store(uint16_t addr, uint8_t val, int chipno)
 
         while (cycles > 0xffff) {
             /* delay */
-            ioctl(hsid_fd, HSID_IOCTL_DELAY, 0xffff);
+            hsid_queue_entry(1, 0xffff);
             cycles -= 0xffff;
         }
 
         uint packet = ((cycles & 0xffff) << 16) | ((addr & 0x1f) << 8) | val;
-        write(hsid_fd, &packet, sizeof (packet));
+        hsid_queue_entry(0, packet);
     }
 }
 
@@ -182,7 +363,7 @@ static void hardsid_alarm_handler(CLOCK offset, void *data)
         hsid_alarm_clk = hsid_main_clk + HARDSID_DELAY_CYCLES;
     } else {
         uint delay = (uint) cycles;
-        ioctl(hsid_fd, HSID_IOCTL_DELAY, delay);
+        hsid_queue_entry(1, delay);
         hsid_main_clk   = maincpu_clk - offset;
         hsid_alarm_clk  = hsid_main_clk + HARDSID_DELAY_CYCLES;
     }
@@ -64,6 +64,7 @@
 #include "cmdline.h"
 #include "lib.h"
 #include "log.h"
+#include "midi.h"
 #include "mididrv.h"
 #include "resources.h"
 #include "types.h"
@@ -559,13 +560,24 @@ static midi_driver_t midi_drivers[] = {
     { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
 };
 
+/* The driver is only started when the MIDI interface opens a stream, so
+   there is no ALSA sequencer client and no device access at startup unless
+   MIDI is actually used. */
+static int driver_started = 0;
+
+static void driver_start(void)
+{
+    if (!driver_started) {
+        midi_drivers[midi_driver_num].init();
+        driver_started = 1;
+    }
+}
+
 void mididrv_init(void)
 {
     if (mididrv_log == LOG_DEFAULT) {
         mididrv_log = log_open("MIDIdrv");
     }
-
-    midi_drivers[midi_driver_num].init();
 }
 
 int mididrv_in(uint8_t *b)
@@ -580,6 +592,7 @@ void mididrv_out(uint8_t b)
 
 int mididrv_in_open(void)
 {
+    driver_start();
     return midi_drivers[midi_driver_num].in_open();
 }
 
@@ -590,6 +603,7 @@ void mididrv_in_close(void)
 
 int mididrv_out_open(void)
 {
+    driver_start();
     return midi_drivers[midi_driver_num].out_open();
 }
 
@@ -604,10 +618,17 @@ void mididrv_out_close(void)
 static void driver_restart(void)
 {
     int in_was_open, out_was_open;
+
+    if (!driver_started) {
+        return;
+    }
+
     /* shut down and restart new driver */
     in_was_open = (fd_in >= 0) ? 1 : 0;
     out_was_open = (fd_out >= 0) ? 1 : 0;
 
+    midi_io_lock();
+
     midi_drivers[midi_driver_num].shutdown();
 
     midi_drivers[midi_driver_num].init();
@@ -619,6 +640,8 @@ static void driver_restart(void)
     if (out_was_open) {
         midi_drivers[midi_driver_num].out_open();
     }
+
+    midi_io_unlock();
 }
 
 #ifdef USE_ALSA
@@ -686,10 +709,17 @@ static int set_midi_driver(int val, void *param)
         return 0;
     }
 
+    if (!driver_started) {
+        midi_driver_num = val;
+        return 0;
+    }
+
     /* shut down driver and start new driver */
     in_was_open = (fd_in >= 0) ? 1 : 0;
     out_was_open = (fd_out >= 0) ? 1 : 0;
 
+    midi_io_lock();
+
     midi_drivers[midi_driver_num].shutdown();
 
     midi_driver_num = val;
@@ -703,6 +733,8 @@ static int set_midi_driver(int val, void *param)
     if (out_was_open) {
         midi_drivers[midi_driver_num].out_open();
     }
+
+    midi_io_unlock();
     return 0;
 }
 
@@ -728,7 +760,10 @@ int mididrv_resources_init(void)
 void mididrv_resources_shutdown(void)
 {
     /* TODO move somewhere else */
-    midi_drivers[midi_driver_num].shutdown();
+    if (driver_started) {
+        midi_drivers[midi_driver_num].shutdown();
+        driver_started = 0;
+    }
 
 #ifdef USE_OSS
     lib_free(midi_in_dev);
@@ -306,9 +306,6 @@ void mididrv_init(void)
     if (mididrv_log == LOG_DEFAULT) {
         mididrv_log = log_open("MIDIdrv");
     }
-    log_message(mididrv_log, "init driver");
-    dump_sources();
-    dump_destinations();
 }
 
 /* opens a MIDI-In device, returns handle */
@@ -73,14 +73,26 @@
 #ifdef UNIX_COMPILE
 /* On Unix, we implement an abstraction layer to support two rawnet drivers:
  * one based on libpcap, and one based on TUN/TAP.
+ *
+ * While an interface is active, a packet thread does all the receiving and
+ * transmitting of the driver. It waits in poll() for frames, reads all that
+ * are waiting at once into a ring of frames and sends the frames queued for
+ * transmission, so the emulation only ever copies frames from and to memory.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+
 /* Pointer to the rawnet driver in use. */
 const rawnet_arch_driver_t *rawnet_arch_driver = NULL;
 char *rawnet_arch_driver_name = NULL;
 
 #define DRIVER_NAME_NONE        "none"
 
+static void rawnet_thread_join(void);
+
 /* Resources configuration ***************************************************/
 
 static int set_ethernet_driver(const char *name, void *param)
@@ -95,6 +107,9 @@ static int set_ethernet_driver(const char *name, void *param)
         return 0;
     }
 
+    /* the packet thread uses the driver */
+    rawnet_thread_join();
+
     if (strcmp(name, DRIVER_NAME_NONE) == 0) {
         if (old_driver) {
             old_driver->deactivate();
@@ -236,6 +251,243 @@ void rawnet_arch_debug_output(const char *text, uint8_t *what, int count)
 }
 #endif /* #ifdef RAWNET_DEBUG_PKTDUMP */
 
+
+/* Packet thread *************************************************************/
+
+/* Size of the frames in the rings, more than the longest ethernet frame.  */
+#define RAWNET_FRAME_SIZE       1536
+
+/* Number of frames in the rings, powers of two.  */
+#define RAWNET_RX_FRAMES        64
+#define RAWNET_TX_FRAMES        32
+
+/* Longest wait for frames, when the driver has no file descriptor for it.  */
+#define RAWNET_POLL_FALLBACK_MS 1
+
+typedef struct rawnet_frame_s {
+    int len;
+    /* transmit flags */
+    int force;
+    int onecoll;
+    int inhibit_crc;
+    int tx_pad_dis;
+    /* receive flags */
+    int hashed;
+    int hash_index;
+    int rx_ok;
+    int correct_mac;
+    int broadcast;
+    int crc_error;
+    uint8_t data[RAWNET_FRAME_SIZE];
+} rawnet_frame_t;
+
+static pthread_mutex_t rawnet_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t rawnet_thread;
+static int rawnet_thread_running = 0;
+static int rawnet_thread_stop = 0;
+
+/* written to by the emulation to wake up the packet thread */
+static int rawnet_wakeup_fd[2] = { -1, -1 };
+
+static rawnet_frame_t rawnet_rx_ring[RAWNET_RX_FRAMES];
+static unsigned int rawnet_rx_head = 0, rawnet_rx_count = 0;
+static rawnet_frame_t rawnet_tx_ring[RAWNET_TX_FRAMES];
+static unsigned int rawnet_tx_head = 0, rawnet_tx_count = 0;
+
+static void rawnet_thread_wakeup(void)
+{
+    char c = 0;
+
+    if (write(rawnet_wakeup_fd[1], &c, 1) < 0) {
+        /* the pipe is full, so the thread is going to wake up anyway */
+    }
+}
+
+/* Send the queued frames, with rawnet_lock held.  */
+static void rawnet_thread_transmit(void)
+{
+    rawnet_frame_t *frame;
+
+    while (rawnet_tx_count > 0) {
+        frame = &rawnet_tx_ring[rawnet_tx_head];
+        /* the slot stays ours until it is taken off the ring below */
+        pthread_mutex_unlock(&rawnet_lock);
+        rawnet_arch_driver->transmit(frame->force, frame->onecoll,
+                                     frame->inhibit_crc, frame->tx_pad_dis,
+                                     frame->len, frame->data);
+        pthread_mutex_lock(&rawnet_lock);
+        rawnet_tx_head = (rawnet_tx_head + 1) & (RAWNET_TX_FRAMES - 1);
+        rawnet_tx_count--;
+    }
+}
+
+/* Read all frames waiting, as long as there is room, with rawnet_lock held.  */
+static void rawnet_thread_receive(void)
+{
+    rawnet_frame_t *frame;
+    int got;
+
+    while (rawnet_rx_count < RAWNET_RX_FRAMES) {
+        frame = &rawnet_rx_ring[(rawnet_rx_head + rawnet_rx_count) & (RAWNET_RX_FRAMES - 1)];
+        frame->len = RAWNET_FRAME_SIZE;
+        pthread_mutex_unlock(&rawnet_lock);
+        got = rawnet_arch_driver->receive(frame->data, &frame->len, &frame->hashed,
+                                          &frame->hash_index, &frame->rx_ok,
+                                          &frame->correct_mac, &frame->broadcast,
+                                          &frame->crc_error);
+        pthread_mutex_lock(&rawnet_lock);
+        if (!got) {
+            break;
+        }
+        rawnet_rx_count++;
+    }
+}
+
+static void *rawnet_thread_main(void *unused)
+{
+    struct pollfd pfd[2];
+    char buf[16];
+    int fd = rawnet_arch_driver->get_fd();
+    nfds_t nfds;
+
+    pthread_mutex_lock(&rawnet_lock);
+    while (!rawnet_thread_stop) {
+        rawnet_thread_transmit();
+        rawnet_thread_receive();
+
+        pfd[0].fd = rawnet_wakeup_fd[0];
+        pfd[0].events = POLLIN;
+        nfds = 1;
+        if (fd >= 0 && rawnet_rx_count < RAWNET_RX_FRAMES) {
+            pfd[1].fd = fd;
+            pfd[1].events = POLLIN;
+            nfds = 2;
+        }
+        pthread_mutex_unlock(&rawnet_lock);
+
+        if (poll(pfd, nfds, fd >= 0 ? -1 : RAWNET_POLL_FALLBACK_MS) > 0
+            && (pfd[0].revents & POLLIN)) {
+            while (read(rawnet_wakeup_fd[0], buf, sizeof(buf)) > 0) {
+                /* drain */
+            }
+        }
+
+        pthread_mutex_lock(&rawnet_lock);
+    }
+    pthread_mutex_unlock(&rawnet_lock);
+
+    return NULL;
+}
+
+static void rawnet_thread_start(void)
+{
+    if (rawnet_wakeup_fd[0] < 0) {
+        if (pipe(rawnet_wakeup_fd) < 0) {
+            log_error(rawnet_arch_log, "Cannot create pipe for the packet thread: %s.",
+                      strerror(errno));
+            return;
+        }
+        fcntl(rawnet_wakeup_fd[0], F_SETFL, O_NONBLOCK);
+        fcntl(rawnet_wakeup_fd[1], F_SETFL, O_NONBLOCK);
+    }
+
+    rawnet_rx_head = rawnet_rx_count = 0;
+    rawnet_tx_head = rawnet_tx_count = 0;
+    rawnet_thread_stop = 0;
+    if (pthread_create(&rawnet_thread, NULL, rawnet_thread_main, NULL) != 0) {
+        log_error(rawnet_arch_log, "Cannot start the packet thread.");
+        return;
+    }
+    rawnet_thread_running = 1;
+}
+
+static void rawnet_thread_join(void)
+{
+    if (!rawnet_thread_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&rawnet_lock);
+    rawnet_thread_stop = 1;
+    pthread_mutex_unlock(&rawnet_lock);
+    rawnet_thread_wakeup();
+
+    pthread_join(rawnet_thread, NULL);
+    rawnet_thread_running = 0;
+}
+
+/* Queue a frame for the packet thread, dropped when the queue is full the
+   same as on a congested network.  */
+static void rawnet_thread_queue_transmit(int force, int onecoll, int inhibit_crc,
+                                         int tx_pad_dis, int txlength, uint8_t *txframe)
+{
+    rawnet_frame_t *frame;
+    int wakeup;
+
+    if (txlength > RAWNET_FRAME_SIZE) {
+        txlength = RAWNET_FRAME_SIZE;
+    }
+
+    pthread_mutex_lock(&rawnet_lock);
+    if (rawnet_tx_count == RAWNET_TX_FRAMES) {
+        pthread_mutex_unlock(&rawnet_lock);
+        log_warning(rawnet_arch_log, "Transmit queue full, frame dropped.");
+        return;
+    }
+    frame = &rawnet_tx_ring[(rawnet_tx_head + rawnet_tx_count) & (RAWNET_TX_FRAMES - 1)];
+    frame->force = force;
+    frame->onecoll = onecoll;
+    frame->inhibit_crc = inhibit_crc;
+    frame->tx_pad_dis = tx_pad_dis;
+    frame->len = txlength;
+    memcpy(frame->data, txframe, (size_t)txlength);
+    wakeup = (rawnet_tx_count++ == 0);
+    pthread_mutex_unlock(&rawnet_lock);
+
+    if (wakeup) {
+        rawnet_thread_wakeup();
+    }
+}
+
+/* Take a frame received by the packet thread.  */
+static int rawnet_thread_take_frame(uint8_t *pbuffer, int *plen, int *phashed,
+                                    int *phash_index, int *prx_ok,
+                                    int *pcorrect_mac, int *pbroadcast,
+                                    int *pcrc_error)
+{
+    rawnet_frame_t *frame;
+    int wakeup;
+    int len;
+
+    pthread_mutex_lock(&rawnet_lock);
+    if (rawnet_rx_count == 0) {
+        pthread_mutex_unlock(&rawnet_lock);
+        return 0;
+    }
+    frame = &rawnet_rx_ring[rawnet_rx_head];
+
+    len = frame->len < *plen ? frame->len : *plen;
+    memcpy(pbuffer, frame->data, (size_t)len);
+    *plen = frame->len;
+    *phashed = frame->hashed;
+    *phash_index = frame->hash_index;
+    *prx_ok = frame->rx_ok;
+    *pcorrect_mac = frame->correct_mac;
+    *pbroadcast = frame->broadcast;
+    *pcrc_error = frame->crc_error;
+
+    /* the thread stops reading when the ring is full */
+    wakeup = (rawnet_rx_count == RAWNET_RX_FRAMES);
+    rawnet_rx_head = (rawnet_rx_head + 1) & (RAWNET_RX_FRAMES - 1);
+    rawnet_rx_count--;
+    pthread_mutex_unlock(&rawnet_lock);
+
+    if (wakeup) {
+        rawnet_thread_wakeup();
+    }
+    return 1;
+}
+
 int rawnet_arch_init(void)
 {
     rawnet_arch_log = log_open("TFEARCH");
@@ -270,7 +522,12 @@ int rawnet_arch_activate(const char *interface_name)
     if (rawnet_arch_driver == NULL) {
         return -1;
     }
-    return rawnet_arch_driver->activate(interface_name);
+    rawnet_thread_join();
+    if (!rawnet_arch_driver->activate(interface_name)) {
+        return 0;
+    }
+    rawnet_thread_start();
+    return 1;
 }
 
 void rawnet_arch_deactivate(void)
@@ -279,6 +536,7 @@ void rawnet_arch_deactivate(void)
     log_message(rawnet_arch_log, "rawnet_arch_deactivate() (driver: %s).",
                 rawnet_arch_driver->name == NULL ? "NULL" : rawnet_arch_driver->name);
 #endif
+    rawnet_thread_join();
     rawnet_arch_driver->deactivate();
 }
 
@@ -346,6 +604,10 @@ void rawnet_arch_transmit(int force, int onecoll, int inhibit_crc, int tx_pad_di
 #ifdef RAWNET_DEBUG_PKTDUMP
     rawnet_arch_debug_output("Transmit frame: ", txframe, txlength);
 #endif /* #ifdef RAWNET_DEBUG_PKTDUMP */
+    if (rawnet_thread_running) {
+        rawnet_thread_queue_transmit(force, onecoll, inhibit_crc, tx_pad_dis, txlength, txframe);
+        return;
+    }
     rawnet_arch_driver->transmit(force, onecoll, inhibit_crc, tx_pad_dis, txlength, txframe);
 }
 
@@ -356,6 +618,9 @@ int rawnet_arch_receive(uint8_t *pbuffer, int *plen, int *phashed, int *phash_in
             "rawnet_arch_receive() called, with *plen=%u (driver: %s).",
             *plen, rawnet_arch_driver->name);
 #endif
+    if (rawnet_thread_running) {
+        return rawnet_thread_take_frame(pbuffer, plen, phashed, phash_index, prx_ok, pcorrect_mac, pbroadcast, pcrc_error);
+    }
     return rawnet_arch_driver->receive(pbuffer, plen, phashed, phash_index, prx_ok, pcorrect_mac, pbroadcast, pcrc_error);
 }
 
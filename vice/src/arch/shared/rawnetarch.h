@@ -110,6 +110,9 @@ typedef struct rawnet_arch_driver_s {
     int (*enumadapter_close)(void);
 
     char *(*get_standard_interface)(void);
+
+    /* file descriptor to poll() for incoming frames, -1 if there is none */
+    int (*get_fd)(void);
 } rawnet_arch_driver_t;
 
 #ifdef HAVE_PCAP
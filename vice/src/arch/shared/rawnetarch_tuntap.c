@@ -316,6 +316,15 @@ static char *rawnet_arch_tuntap_get_standard_interface(void)
     return NULL; /* Use the interface configured for cs89000io */
 }
 
+/** \brief  Get file descriptor to poll for frames
+ *
+ * \return  file descriptor of the TAP interface
+ */
+static int rawnet_arch_tuntap_get_fd(void)
+{
+    return rawnet_arch_tuntap_tun_fd;
+}
+
 /** Finally, let's expose the driver interface */
 rawnet_arch_driver_t rawnet_arch_driver_tuntap = {
     "tuntap",
@@ -338,7 +347,9 @@ rawnet_arch_driver_t rawnet_arch_driver_tuntap = {
     rawnet_arch_tuntap_enumadapter,
     rawnet_arch_tuntap_enumadapter_close,
 
-    rawnet_arch_tuntap_get_standard_interface
+    rawnet_arch_tuntap_get_standard_interface,
+
+    rawnet_arch_tuntap_get_fd
 };
 
 #endif /* #ifdef HAVE_TUNTAP */
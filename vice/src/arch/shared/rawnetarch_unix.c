@@ -515,6 +515,18 @@ static char *rawnet_arch_pcap_get_standard_interface(void)
     return dev;
 }
 
+/** \brief  Get file descriptor to poll for frames
+ *
+ * \return  selectable file descriptor of the capture, -1 if not supported
+ */
+static int rawnet_arch_pcap_get_fd(void)
+{
+    if (rawnet_pcap_fp == NULL) {
+        return -1;
+    }
+    return pcap_get_selectable_fd(rawnet_pcap_fp);
+}
+
 /** Finally, let's expose the driver interface */
 rawnet_arch_driver_t rawnet_arch_driver_pcap = {
     "pcap",
@@ -537,7 +549,9 @@ rawnet_arch_driver_t rawnet_arch_driver_pcap = {
     rawnet_arch_pcap_enumadapter,
     rawnet_arch_pcap_enumadapter_close,
 
-    rawnet_arch_pcap_get_standard_interface
+    rawnet_arch_pcap_get_standard_interface,
+
+    rawnet_arch_pcap_get_fd
 };
 
 #endif /* #ifdef HAVE_PCAP */
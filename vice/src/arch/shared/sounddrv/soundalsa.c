@@ -37,6 +37,7 @@
 #include "debug.h"
 #include "log.h"
 #include "sound.h"
+#include "soundring.h"
 #include "archdep_sleep.h"
 
 /* NetBSD doesn't define ESTRPIPE, this fix I noticed in gstreamer code */
@@ -50,6 +51,65 @@ static int alsa_fragsize;
 static int alsa_channels;
 static int alsa_can_pause;
 
+/* The emulation queues its samples in a ring, a writer thread passes them on
+ * to the blocking snd_pcm_writei(). ALSA itself only buffers two periods, the
+ * rest of the requested buffer size is in the ring.  */
+static sound_ring_t *ring = NULL;
+
+#define ALSA_PERIODS 2
+
+static int xrun_recovery(snd_pcm_t *hnd, int err)
+{
+    if (err == -EPIPE) {    /* under-run */
+        if ((err = snd_pcm_prepare(hnd)) < 0) {
+            log_message(LOG_DEFAULT, "Can't recover from underrun, prepare failed: %s", snd_strerror(err));
+        }
+        return 0;
+    } else if (err == -ESTRPIPE) {
+        while ((err = snd_pcm_resume(hnd)) == -EAGAIN) {
+            log_message(LOG_DEFAULT, "xrun_recovery: %s", snd_strerror(err));
+            archdep_sleep(1);       /* wait until the suspend flag is released */
+        }
+        if (err < 0) {
+            if ((err = snd_pcm_prepare(hnd)) < 0) {
+                log_message(LOG_DEFAULT, "Can't recover from suspend, prepare failed: %s", snd_strerror(err));
+            }
+        }
+        return 0;
+    }
+    return err;
+}
+
+static int alsa_write_frames(int16_t *pbuf, size_t nr)
+{
+    int err;
+
+    while (nr > 0) {
+        err = (int)snd_pcm_writei(handle, pbuf, nr);
+        if (err == -EAGAIN) {
+            log_message(LOG_DEFAULT, "Write error: %s", snd_strerror(err));
+            continue;
+        } else if (err < 0 && (err = xrun_recovery(handle, err)) < 0) {
+            log_message(LOG_DEFAULT, "Write error: %s", snd_strerror(err));
+            return 1;
+        }
+        pbuf += err * alsa_channels;
+        nr -= (size_t)err;
+    }
+
+    return 0;
+}
+
+static int alsa_write(int16_t *pbuf, size_t nr)
+{
+    if (sound_ring_thread_failed(ring)) {
+        return 1;
+    }
+    sound_ring_write(ring, pbuf, nr / (size_t)alsa_channels);
+
+    return 0;
+}
+
 static int alsa_init(const char *param, int *speed, int *fragsize, int *fragnr, int *channels)
 {
     int err, dir;
@@ -114,14 +174,13 @@ static int alsa_init(const char *param, int *speed, int *fragsize, int *fragnr,
     /* number of periods according to the buffer size we wanted, nearest val */
     *fragnr = (alsa_bufsize + *fragsize / 2) / *fragsize;
 
-    periods = (unsigned int)*fragnr;
+    periods = ALSA_PERIODS;
     dir = 0;
     if ((err = snd_pcm_hw_params_set_periods_near(handle, hwparams, &periods, &dir)) < 0) {
         log_message(LOG_DEFAULT, "Unable to set periods %u for playback: %s",
                 periods, snd_strerror(err));
         goto fail;
     }
-    *fragnr = (int)periods;
 
     alsa_can_pause = snd_pcm_hw_params_can_pause(hwparams);
 
@@ -134,6 +193,13 @@ static int alsa_init(const char *param, int *speed, int *fragsize, int *fragnr,
     alsa_fragsize = *fragsize;
     alsa_channels = *channels;
 
+    ring = sound_ring_new((size_t)alsa_bufsize, alsa_channels);
+    if (sound_ring_thread_start(ring, alsa_write_frames, (size_t)alsa_fragsize) < 0) {
+        sound_ring_free(ring);
+        ring = NULL;
+        goto fail;
+    }
+
     return 0;
 
 fail:
@@ -142,67 +208,19 @@ fail:
     return 1;
 }
 
-static int xrun_recovery(snd_pcm_t *hnd, int err)
-{
-    if (err == -EPIPE) {    /* under-run */
-        if ((err = snd_pcm_prepare(hnd)) < 0) {
-            log_message(LOG_DEFAULT, "Can't recover from underrun, prepare failed: %s", snd_strerror(err));
-        }
-        return 0;
-    } else if (err == -ESTRPIPE) {
-        while ((err = snd_pcm_resume(hnd)) == -EAGAIN) {
-            log_message(LOG_DEFAULT, "xrun_recovery: %s", snd_strerror(err));
-            archdep_sleep(1);       /* wait until the suspend flag is released */
-        }
-        if (err < 0) {
-            if ((err = snd_pcm_prepare(hnd)) < 0) {
-                log_message(LOG_DEFAULT, "Can't recover from suspend, prepare failed: %s", snd_strerror(err));
-            }
-        }
-        return 0;
-    }
-    return err;
-}
-
-static int alsa_write(int16_t *pbuf, size_t nr)
-{
-    int err;
-
-    nr /= (size_t)alsa_channels;
-
-    while (nr > 0) {
-        err = (int)snd_pcm_writei(handle, pbuf, nr);
-        if (err == -EAGAIN) {
-            log_message(LOG_DEFAULT, "Write error: %s", snd_strerror(err));
-            continue;
-        } else if (err < 0 && (err = xrun_recovery(handle, err)) < 0) {
-            log_message(LOG_DEFAULT, "Write error: %s", snd_strerror(err));
-            return 1;
-        }
-        pbuf += err * alsa_channels;
-        nr -= (size_t)err;
-    }
-
-    return 0;
-}
-
 static int alsa_bufferspace(void)
 {
-#ifdef HAVE_SND_PCM_AVAIL
-    snd_pcm_sframes_t space = snd_pcm_avail(handle);
-#else
-    snd_pcm_sframes_t space = snd_pcm_avail_update(handle);
-#endif
-    /* keep alsa values real. Values < 0 mean errors, call to alsa_write
-     * will resume. */
-    if (space < 0 || space > alsa_bufsize) {
-        space = alsa_bufsize;
-    }
-    return (int)space;
+    return (int)sound_ring_space(ring);
 }
 
 static void alsa_close(void)
 {
+    if (ring) {
+        sound_ring_thread_stop(ring);
+        sound_ring_log_stats(ring, "alsa");
+        sound_ring_free(ring);
+        ring = NULL;
+    }
     if (handle) {
         snd_pcm_close(handle);
         handle = NULL;
@@ -219,6 +237,7 @@ static int alsa_suspend(void)
         return 1;
     }
 
+    sound_ring_thread_pause(ring, 1);
     if ((err = snd_pcm_pause(handle, 1)) < 0) {
         log_message(LOG_DEFAULT, "Unable to pause playback: %s", snd_strerror(err));
         return 1;
@@ -239,6 +258,7 @@ static int alsa_resume(void)
         log_message(LOG_DEFAULT, "Unable to resume playback: %s", snd_strerror(err));
         return 1;
     }
+    sound_ring_thread_pause(ring, 0);
 
     return 0;
 }
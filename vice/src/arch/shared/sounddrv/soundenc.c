@@ -0,0 +1,220 @@
+/** \file   soundenc.c
+ * \brief   Encoder thread of the sound recording devices
+ *
+ * The recording devices that compress their output (MP3, FLAC, Ogg Vorbis)
+ * take too long encoding to do it in their write function, which runs on
+ * the emulation thread. Instead the samples are queued here and encoded by
+ * a thread of their own. The queue is bounded: when the encoder cannot keep
+ * up the emulation waits for it, so no samples are lost.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "lib.h"
+#include "log.h"
+
+#include "soundenc.h"
+
+
+/* Length of the queue in seconds.  */
+#define SOUND_ENCODER_QUEUE_SECONDS 2
+
+/* Most frames passed to the encode function at once.  */
+#define SOUND_ENCODER_CHUNK_FRAMES  4096
+
+struct sound_encoder_s {
+    int16_t *buf;
+    size_t size;            /* in samples, a multiple of the channels */
+    size_t head;            /* samples ever queued */
+    size_t tail;            /* samples ever encoded */
+    int channels;
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t consumed;
+    pthread_t thread;
+
+    int stop;
+    int failed;
+    sound_encoder_func_t encode;
+};
+
+
+static void *sound_encoder_thread(void *arg)
+{
+    sound_encoder_t *enc = arg;
+    size_t pos, len;
+    int failed = 0;
+
+    pthread_mutex_lock(&enc->lock);
+    while (1) {
+        while (enc->head == enc->tail && !enc->stop) {
+            pthread_cond_wait(&enc->queued, &enc->lock);
+        }
+        if (enc->head == enc->tail) {
+            break;
+        }
+
+        /* samples are queued in whole frames and the size is a multiple of
+           the frame size, so the part up to the end of the buffer is whole
+           frames as well */
+        pos = enc->tail % enc->size;
+        len = enc->head - enc->tail;
+        if (len > enc->size - pos) {
+            len = enc->size - pos;
+        }
+        if (len > SOUND_ENCODER_CHUNK_FRAMES * (size_t)enc->channels) {
+            len = SOUND_ENCODER_CHUNK_FRAMES * (size_t)enc->channels;
+        }
+        pthread_mutex_unlock(&enc->lock);
+
+        /* after a failure the samples are only dropped, so the emulation
+           does not wait on the queue until the device is closed */
+        if (!failed && enc->encode(enc->buf + pos, len)) {
+            log_error(LOG_DEFAULT, "Sound encoder failed.");
+            failed = 1;
+        }
+
+        pthread_mutex_lock(&enc->lock);
+        enc->failed = failed;
+        enc->tail += len;
+        pthread_cond_signal(&enc->consumed);
+    }
+    pthread_mutex_unlock(&enc->lock);
+
+    return NULL;
+}
+
+/** \brief  Start an encoder thread
+ *
+ * \param[in]   encode      encode function of the device
+ * \param[in]   speed       sample rate
+ * \param[in]   channels    samples per frame
+ *
+ * \return  encoder, NULL on failure
+ */
+sound_encoder_t *sound_encoder_start(sound_encoder_func_t encode, int speed, int channels)
+{
+    sound_encoder_t *enc = lib_calloc(1, sizeof(sound_encoder_t));
+
+    enc->size = (size_t)speed * SOUND_ENCODER_QUEUE_SECONDS * (size_t)channels;
+    enc->buf = lib_malloc(enc->size * sizeof(int16_t));
+    enc->channels = channels;
+    enc->encode = encode;
+
+    pthread_mutex_init(&enc->lock, NULL);
+    pthread_cond_init(&enc->queued, NULL);
+    pthread_cond_init(&enc->consumed, NULL);
+
+    if (pthread_create(&enc->thread, NULL, sound_encoder_thread, enc)) {
+        log_error(LOG_DEFAULT, "Cannot start sound encoder thread.");
+        pthread_cond_destroy(&enc->consumed);
+        pthread_cond_destroy(&enc->queued);
+        pthread_mutex_destroy(&enc->lock);
+        lib_free(enc->buf);
+        lib_free(enc);
+        return NULL;
+    }
+
+    return enc;
+}
+
+/** \brief  Queue samples for encoding
+ *
+ * Waits while the queue is full.
+ *
+ * \param[in]   enc     encoder
+ * \param[in]   pbuf    interleaved samples
+ * \param[in]   nr      number of samples, whole frames
+ *
+ * \return  0 on success, 1 if encoding has failed
+ */
+int sound_encoder_write(sound_encoder_t *enc, const int16_t *pbuf, size_t nr)
+{
+    size_t pos, len;
+    int failed;
+
+    pthread_mutex_lock(&enc->lock);
+    while (nr > 0 && !enc->failed) {
+        while (enc->head - enc->tail == enc->size && !enc->failed) {
+            pthread_cond_wait(&enc->consumed, &enc->lock);
+        }
+        if (enc->failed) {
+            break;
+        }
+
+        pos = enc->head % enc->size;
+        len = enc->size - (enc->head - enc->tail);
+        if (len > enc->size - pos) {
+            len = enc->size - pos;
+        }
+        if (len > nr) {
+            len = nr;
+        }
+        memcpy(enc->buf + pos, pbuf, len * sizeof(int16_t));
+
+        enc->head += len;
+        pbuf += len;
+        nr -= len;
+        pthread_cond_signal(&enc->queued);
+    }
+    failed = enc->failed;
+    pthread_mutex_unlock(&enc->lock);
+
+    return failed;
+}
+
+/** \brief  Encode what is queued and stop the encoder thread
+ *
+ * \param[in]   enc     encoder, may be NULL
+ *
+ * \return  0 on success, 1 if encoding has failed
+ */
+int sound_encoder_stop(sound_encoder_t *enc)
+{
+    int failed;
+
+    if (enc == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&enc->lock);
+    enc->stop = 1;
+    pthread_cond_signal(&enc->queued);
+    pthread_mutex_unlock(&enc->lock);
+    pthread_join(enc->thread, NULL);
+
+    failed = enc->failed;
+
+    pthread_cond_destroy(&enc->consumed);
+    pthread_cond_destroy(&enc->queued);
+    pthread_mutex_destroy(&enc->lock);
+    lib_free(enc->buf);
+    lib_free(enc);
+
+    return failed;
+}
@@ -0,0 +1,52 @@
+/** \file   soundenc.h
+ * \brief   Encoder thread of the sound recording devices
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SOUNDENC_H
+#define VICE_SOUNDENC_H
+
+#include "vice.h"
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* Buffer size for the files written by the encoders, so the disk is written
+   in large blocks.  */
+#define SOUND_ENCODER_FILE_BUFFER   (256 * 1024)
+
+typedef struct sound_encoder_s sound_encoder_t;
+
+/** \brief  Encode function of a sound recording device, called by the
+ *          encoder thread with a whole number of frames
+ *
+ * Takes the same arguments as the write function of the device.
+ */
+typedef int (*sound_encoder_func_t)(int16_t *pbuf, size_t nr);
+
+sound_encoder_t *sound_encoder_start(sound_encoder_func_t encode, int speed, int channels);
+int sound_encoder_write(sound_encoder_t *enc, const int16_t *pbuf, size_t nr);
+int sound_encoder_stop(sound_encoder_t *enc);
+
+#endif
@@ -31,6 +31,7 @@
 #include <FLAC/stream_encoder.h>
 
 #include "sound.h"
+#include "soundenc.h"
 #include "types.h"
 #include "archdep.h"
 #include "lib.h"
@@ -45,6 +46,7 @@ static FLAC__int32 *pcm_buffer = NULL;
 static FLAC__StreamEncoder *encoder = NULL;
 static FLAC__StreamMetadata *metadata[2];
 static unsigned int samples = 0;
+static sound_encoder_t *sound_enc = NULL;
 
 static void progress_callback(const FLAC__StreamEncoder *enc,
                               FLAC__uint64 bytes_written,
@@ -55,6 +57,31 @@ static void progress_callback(const FLAC__StreamEncoder *enc,
     /* NOP */
 }
 
+/* runs on the encoder thread */
+static int flac_encode(int16_t *pbuf, size_t nr)
+{
+    FLAC__bool ok;
+    unsigned int i;
+    unsigned int amount = (unsigned int)((stereo == 1) ? nr / 2 : nr);
+
+    if (pcm_buffer == NULL) {
+        return 1;
+    }
+
+    for (i = 0; i < nr; ++i) {
+        pcm_buffer[i] = (FLAC__int32)(pbuf[i]);
+    }
+
+    ok = FLAC__stream_encoder_process_interleaved(encoder, pcm_buffer, amount);
+
+    if (!ok) {
+        /* the encoder is deleted when the device is closed */
+        return 1;
+    }
+    samples += amount;
+    return 0;
+}
+
 static int flac_init(const char *param,
                      int *speed,
                      int *fragsize,
@@ -62,6 +89,7 @@ static int flac_init(const char *param,
                      int *channels)
 {
     const char *flacname;
+    FILE *flac_fd;
     FLAC__bool ok = true;
     FLAC__StreamEncoderInitStatus init_status;
     FLAC__StreamMetadata_VorbisComment_Entry entry;
@@ -106,12 +134,28 @@ static int flac_init(const char *param,
     }
 
     if (ok) {
-        init_status = FLAC__stream_encoder_init_file(encoder, flacname, progress_callback, NULL);
+        flac_fd = fopen(flacname, MODE_WRITE);
+        if (flac_fd == NULL) {
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        /* from here on the file belongs to the encoder */
+        setvbuf(flac_fd, NULL, _IOFBF, SOUND_ENCODER_FILE_BUFFER);
+        init_status = FLAC__stream_encoder_init_FILE(encoder, flac_fd, progress_callback, NULL);
         if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
             ok = false;
         }
     }
 
+    if (ok) {
+        sound_enc = sound_encoder_start(flac_encode, *speed, *channels);
+        if (sound_enc == NULL) {
+            ok = false;
+        }
+    }
+
     if (!ok) {
         FLAC__stream_encoder_finish(encoder);
         FLAC__metadata_object_delete(metadata[0]);
@@ -129,33 +173,14 @@ static int flac_init(const char *param,
 
 static int flac_write(int16_t *pbuf, size_t nr)
 {
-    FLAC__bool ok;
-    unsigned int i;
-    unsigned int amount = (unsigned int)((stereo == 1) ? nr / 2 : nr);
-
-    if (pcm_buffer == NULL) {
-        return 1;
-    }
-
-    for (i = 0; i < nr; ++i) {
-        pcm_buffer[i] = (FLAC__int32)(pbuf[i]);
-    }
-
-    ok = FLAC__stream_encoder_process_interleaved(encoder, pcm_buffer, amount);
-
-    if (!ok) {
-        FLAC__stream_encoder_finish(encoder);
-        FLAC__metadata_object_delete(metadata[0]);
-        FLAC__metadata_object_delete(metadata[1]);
-        FLAC__stream_encoder_delete(encoder);
-        return 1;
-    }
-    samples += amount;
-    return 0;
+    return sound_encoder_write(sound_enc, pbuf, nr);
 }
 
 static void flac_close(void)
 {
+    sound_encoder_stop(sound_enc);
+    sound_enc = NULL;
+
     FLAC__stream_encoder_set_total_samples_estimate(encoder, samples);
     FLAC__stream_encoder_finish(encoder);
     FLAC__metadata_object_delete(metadata[0]);
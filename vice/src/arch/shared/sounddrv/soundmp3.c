@@ -30,6 +30,7 @@
 
 #include "lamelib.h"
 #include "sound.h"
+#include "soundenc.h"
 #include "types.h"
 #include "archdep.h"
 #include "lib.h"
@@ -44,6 +45,40 @@ static int stereo = 0;
 static int16_t *pcm_buffer = NULL;
 static unsigned char *mp3_buffer = NULL;
 static lame_global_flags *gfp;
+static sound_encoder_t *encoder = NULL;
+
+/* runs on the encoder thread */
+static int mp3_encode(int16_t *pbuf, size_t nr)
+{
+    int mp3_size;
+    unsigned int i;
+
+    if (pcm_buffer == NULL) {
+        return 1;
+    }
+
+    if (mp3_buffer == NULL) {
+        return 1;
+    }
+
+    for (i = 0; i < nr; i++) {
+        if (stereo == 1) {
+            pcm_buffer[i] = pbuf[i];
+        } else {
+            pcm_buffer[i * 2] = pbuf[i];
+            pcm_buffer[(i * 2) + 1] = pbuf[i];
+        }
+    }
+
+    mp3_size = vice_lame_encode_buffer_interleaved(gfp, pcm_buffer,
+            (int)((stereo == 1) ? nr / 2 : nr), mp3_buffer, MP3_BUFFER_SIZE);
+    if (mp3_size != 0) {
+        if (mp3_size != (int)fwrite(mp3_buffer, 1, (size_t)mp3_size, mp3_fd)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
 static int mp3_init(const char *param, int *speed, int *fragsize, int *fragnr, int *channels)
 {
@@ -51,6 +86,7 @@ static int mp3_init(const char *param, int *speed, int *fragsize, int *fragnr, i
     if (!mp3_fd) {
         return 1;
     }
+    setvbuf(mp3_fd, NULL, _IOFBF, SOUND_ENCODER_FILE_BUFFER);
 
     gfp = vice_lame_init();
     vice_lame_set_num_channels(gfp, *channels);
@@ -82,45 +118,29 @@ static int mp3_init(const char *param, int *speed, int *fragsize, int *fragnr, i
         stereo = 1;
     }
 
+    encoder = sound_encoder_start(mp3_encode, *speed, *channels);
+    if (encoder == NULL) {
+        vice_lame_close(gfp);
+        fclose(mp3_fd);
+        mp3_fd = NULL;
+        return 1;
+    }
+
     return 0;
 }
 
 static int mp3_write(int16_t *pbuf, size_t nr)
 {
-    int mp3_size;
-    unsigned int i;
-
-    if (pcm_buffer == NULL) {
-        return 1;
-    }
-
-    if (mp3_buffer == NULL) {
-        return 1;
-    }
-
-    for (i = 0; i < nr; i++) {
-        if (stereo == 1) {
-            pcm_buffer[i] = pbuf[i];
-        } else {
-            pcm_buffer[i * 2] = pbuf[i];
-            pcm_buffer[(i * 2) + 1] = pbuf[i];
-        }
-    }
-
-    mp3_size = vice_lame_encode_buffer_interleaved(gfp, pcm_buffer,
-            (int)((stereo == 1) ? nr / 2 : nr), mp3_buffer, MP3_BUFFER_SIZE);
-    if (mp3_size != 0) {
-        if (mp3_size != (int)fwrite(mp3_buffer, 1, (size_t)mp3_size, mp3_fd)) {
-            return 1;
-        }
-    }
-    return 0;
+    return sound_encoder_write(encoder, pbuf, nr);
 }
 
 static void mp3_close(void)
 {
     int mp3_size;
 
+    sound_encoder_stop(encoder);
+    encoder = NULL;
+
     mp3_size = vice_lame_encode_flush(gfp, mp3_buffer, MP3_BUFFER_SIZE);
 
     if (fwrite(mp3_buffer, 1, (size_t)mp3_size, mp3_fd) != (size_t)mp3_size) {
@@ -30,12 +30,17 @@
 
 #include "log.h"
 #include "sound.h"
+#include "soundring.h"
 
 #include <pulse/simple.h>
 #include <pulse/error.h>
 
 static pa_simple *simple = NULL;
 
+/* samples queued for the writer thread, which blocks in pa_simple_write() */
+static sound_ring_t *ring = NULL;
+static int pulsedrv_channels;
+
 
 /* XXX: gcc's -pedantic will warn about these initializations being invalid for
  *      C90, but PulseAudio uses C99 (it uses inttypes.h), so in this case
@@ -57,10 +62,21 @@ static pa_buffer_attr attr = {
 };
 
 
-/* This driver does not use the bufferspace function because it should be
- * unnecessary. Pulse is already going to do its own thing regarding latency
- * and hopefully just does the right thing for us without forcing us to
- * bother with our own timing code. */
+/* The emulation queues its samples in a ring, a writer thread passes them on
+ * to the blocking pa_simple_write(). Pulse itself only buffers two fragments,
+ * the rest of the requested latency is in the ring, where the emulation can
+ * see the buffer space. */
+static int pulsedrv_write_frames(int16_t *pbuf, size_t frames)
+{
+    int error = 0;
+    if (pa_simple_write(simple, pbuf, frames * sizeof(int16_t) * (size_t)pulsedrv_channels, &error)) {
+        log_error(LOG_DEFAULT, "pa_simple_write(,%d): %s", (int)frames, pa_strerror(error));
+        return 1;
+    }
+
+    return 0;
+}
+
 static int pulsedrv_init(const char *param, int *speed, int *fragsize, int *fragnr, int *channels)
 {
     int error = 0;
@@ -69,7 +85,7 @@ static int pulsedrv_init(const char *param, int *speed, int *fragsize, int *frag
     ss.channels = (uint8_t)*channels;
 
     attr.fragsize = (uint32_t)(*fragsize * 2);
-    attr.tlength = (uint32_t)(*fragsize * *fragnr * 2);
+    attr.tlength = (uint32_t)(*fragsize * 2 * 2 * *channels);
 
     simple = pa_simple_new(NULL, "VICE", PA_STREAM_PLAYBACK, NULL, "playback", &ss, NULL, &attr, &error);
     if (simple == NULL) {
@@ -77,23 +93,39 @@ static int pulsedrv_init(const char *param, int *speed, int *fragsize, int *frag
         return 1;
     }
 
+    pulsedrv_channels = *channels;
+    ring = sound_ring_new((size_t)(*fragsize * *fragnr), *channels);
+    if (sound_ring_thread_start(ring, pulsedrv_write_frames, (size_t)*fragsize) < 0) {
+        sound_ring_free(ring);
+        ring = NULL;
+        pa_simple_free(simple);
+        simple = NULL;
+        return 1;
+    }
+
     return 0;
 }
 
 static int pulsedrv_write(int16_t *pbuf, size_t nr)
 {
-    int error = 0;
-    if (pa_simple_write(simple, pbuf, nr * 2, &error)) {
-        log_error(LOG_DEFAULT, "pa_simple_write(,%d): %s", (int)nr, pa_strerror(error));
+    if (sound_ring_thread_failed(ring)) {
         return 1;
     }
+    sound_ring_write(ring, pbuf, nr / (size_t)pulsedrv_channels);
 
     return 0;
 }
 
+static int pulsedrv_bufferspace(void)
+{
+    return (int)sound_ring_space(ring);
+}
+
 static int pulsedrv_suspend(void)
 {
     int error = 0;
+
+    sound_ring_thread_pause(ring, 1);
     if (pa_simple_flush(simple, &error)) {
         log_error(LOG_DEFAULT, "pa_simple_flush(): %s", pa_strerror(error));
         return 1;
@@ -101,9 +133,22 @@ static int pulsedrv_suspend(void)
     return 0;
 }
 
+static int pulsedrv_resume(void)
+{
+    sound_ring_thread_pause(ring, 0);
+    return 0;
+}
+
 static void pulsedrv_close(void)
 {
     int error = 0;
+
+    if (ring) {
+        sound_ring_thread_stop(ring);
+        sound_ring_log_stats(ring, "pulse");
+        sound_ring_free(ring);
+        ring = NULL;
+    }
     if (simple) {
         if (pa_simple_flush(simple, &error)) {
             log_error(LOG_DEFAULT, "pa_simple_flush(): %s", pa_strerror(error));
@@ -121,10 +166,10 @@ static const sound_device_t pulsedrv_device =
     pulsedrv_write,
     NULL,
     NULL,
-    NULL,
+    pulsedrv_bufferspace,
     pulsedrv_close,
     pulsedrv_suspend,
-    NULL,
+    pulsedrv_resume,
     1,
     2,
     true
@@ -0,0 +1,344 @@
+/** \file   soundring.c
+ * \brief   Lock-free sample ring between the emulation and the audio output
+ *
+ * The emulation thread is the only producer and the audio output the only
+ * consumer of a ring, so the read and write positions can be kept in two
+ * atomic counters without any lock. The consumer is either the callback of
+ * the audio API (SDL) or, for drivers whose write call blocks, a writer
+ * thread started with sound_ring_thread_start(). Either way the emulation
+ * thread never blocks on the audio output: it asks for the free space with
+ * sound_ring_space() and only writes what fits.
+ *
+ * The consumer always gets the amount of samples it asks for, the part the
+ * ring cannot serve is filled with silence and counted as underrun.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "lib.h"
+#include "log.h"
+
+#include "soundring.h"
+
+
+struct sound_ring_s {
+    int16_t *buf;
+    size_t size;
+    int channels;
+
+    /* frames ever written and read, the difference is the fill */
+    atomic_size_t head;
+    atomic_size_t tail;
+
+    /* telemetry */
+    atomic_size_t fill_min;
+    atomic_ulong underruns;
+    atomic_ulong overruns;
+
+    /* writer thread for drivers with a blocking write */
+    pthread_t thread;
+    int thread_running;
+    atomic_int thread_stop;
+    atomic_int thread_pause;
+    atomic_int thread_paused;
+    atomic_int thread_failed;
+    sound_ring_write_func_t write;
+    int16_t *chunk_buf;
+    size_t chunk;
+};
+
+
+/** \brief  Create a ring
+ *
+ * \param[in]   frames      size of the ring in frames
+ * \param[in]   channels    samples per frame
+ *
+ * \return  new ring
+ */
+sound_ring_t *sound_ring_new(size_t frames, int channels)
+{
+    sound_ring_t *ring = lib_calloc(1, sizeof(sound_ring_t));
+
+    ring->buf = lib_calloc(frames * (size_t)channels, sizeof(int16_t));
+    ring->size = frames;
+    ring->channels = channels;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->fill_min, SIZE_MAX);
+    atomic_init(&ring->underruns, 0);
+    atomic_init(&ring->overruns, 0);
+    atomic_init(&ring->thread_stop, 0);
+    atomic_init(&ring->thread_pause, 0);
+    atomic_init(&ring->thread_paused, 0);
+    atomic_init(&ring->thread_failed, 0);
+
+    return ring;
+}
+
+/** \brief  Free a ring, stopping its writer thread first
+ *
+ * \param[in]   ring    ring
+ */
+void sound_ring_free(sound_ring_t *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+    sound_ring_thread_stop(ring);
+    lib_free(ring->buf);
+    lib_free(ring);
+}
+
+/** \brief  Queue frames, producer side
+ *
+ * \param[in]   ring    ring
+ * \param[in]   pbuf    interleaved samples
+ * \param[in]   frames  number of frames in \a pbuf
+ *
+ * \return  number of frames queued, less than \a frames if the ring is full
+ */
+size_t sound_ring_write(sound_ring_t *ring, const int16_t *pbuf, size_t frames)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t space = ring->size - (head - tail);
+    size_t pos = head % ring->size;
+    size_t first;
+    size_t ch = (size_t)ring->channels;
+
+    if (frames > space) {
+        atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+        frames = space;
+    }
+
+    first = ring->size - pos;
+    if (first > frames) {
+        first = frames;
+    }
+    memcpy(ring->buf + pos * ch, pbuf, first * ch * sizeof(int16_t));
+    memcpy(ring->buf, pbuf + first * ch, (frames - first) * ch * sizeof(int16_t));
+
+    atomic_store_explicit(&ring->head, head + frames, memory_order_release);
+
+    return frames;
+}
+
+/** \brief  Take frames, consumer side
+ *
+ * Always fills all of \a pbuf, padding with silence when the ring runs dry.
+ *
+ * \param[in]   ring    ring
+ * \param[out]  pbuf    interleaved samples
+ * \param[in]   frames  number of frames to take
+ *
+ * \return  number of frames taken from the ring
+ */
+size_t sound_ring_read(sound_ring_t *ring, int16_t *pbuf, size_t frames)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t fill = head - tail;
+    size_t pos = tail % ring->size;
+    size_t count = frames;
+    size_t first;
+    size_t ch = (size_t)ring->channels;
+
+    if (fill < atomic_load_explicit(&ring->fill_min, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->fill_min, fill, memory_order_relaxed);
+    }
+
+    if (count > fill) {
+        /* running dry before the first samples arrived is no underrun */
+        if (head != 0) {
+            atomic_fetch_add_explicit(&ring->underruns, 1, memory_order_relaxed);
+        }
+        count = fill;
+        memset(pbuf + count * ch, 0, (frames - count) * ch * sizeof(int16_t));
+    }
+
+    first = ring->size - pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(pbuf, ring->buf + pos * ch, first * ch * sizeof(int16_t));
+    memcpy(pbuf + first * ch, ring->buf, (count - first) * ch * sizeof(int16_t));
+
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+/** \brief  Get the number of frames that can be queued without overrun
+ *
+ * \param[in]   ring    ring
+ *
+ * \return  free space in frames
+ */
+size_t sound_ring_space(sound_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    return ring->size - (head - tail);
+}
+
+/** \brief  Get the buffer fill telemetry of a ring
+ *
+ * Restarts the tracking of the lowest fill.
+ *
+ * \param[in]   ring    ring
+ * \param[out]  stats   telemetry
+ */
+void sound_ring_get_stats(sound_ring_t *ring, sound_ring_stats_t *stats)
+{
+    size_t fill_min;
+
+    stats->size = ring->size;
+    stats->fill = ring->size - sound_ring_space(ring);
+    fill_min = atomic_exchange_explicit(&ring->fill_min, SIZE_MAX, memory_order_relaxed);
+    stats->fill_min = fill_min == SIZE_MAX ? stats->fill : fill_min;
+    stats->underruns = atomic_load_explicit(&ring->underruns, memory_order_relaxed);
+    stats->overruns = atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+}
+
+/** \brief  Log the buffer fill telemetry of a ring
+ *
+ * \param[in]   ring    ring
+ * \param[in]   name    name of the sound device
+ */
+void sound_ring_log_stats(sound_ring_t *ring, const char *name)
+{
+    sound_ring_stats_t stats;
+
+    sound_ring_get_stats(ring, &stats);
+    log_message(LOG_DEFAULT,
+                "Sound device %s: %lu underruns, %lu overruns, lowest fill %lu of %lu frames.",
+                name, stats.underruns, stats.overruns,
+                (unsigned long)stats.fill_min, (unsigned long)stats.size);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+static void *sound_ring_thread(void *arg)
+{
+    sound_ring_t *ring = arg;
+
+    while (!atomic_load(&ring->thread_stop)) {
+        if (atomic_load(&ring->thread_pause)) {
+            atomic_store(&ring->thread_paused, 1);
+            tick_sleep(tick_per_second() / 1000);
+            continue;
+        }
+        atomic_store(&ring->thread_paused, 0);
+        sound_ring_read(ring, ring->chunk_buf, ring->chunk);
+        if (ring->write(ring->chunk_buf, ring->chunk)) {
+            atomic_store(&ring->thread_failed, 1);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/** \brief  Start a thread feeding the ring to a blocking audio output
+ *
+ * \param[in]   ring    ring
+ * \param[in]   write   blocking write function of the audio output
+ * \param[in]   chunk   frames to pass to \a write at once
+ *
+ * \return  0 on success, -1 on failure
+ */
+int sound_ring_thread_start(sound_ring_t *ring, sound_ring_write_func_t write, size_t chunk)
+{
+    ring->write = write;
+    ring->chunk = chunk;
+    ring->chunk_buf = lib_malloc(chunk * (size_t)ring->channels * sizeof(int16_t));
+    atomic_store(&ring->thread_stop, 0);
+    atomic_store(&ring->thread_pause, 0);
+    atomic_store(&ring->thread_paused, 0);
+    atomic_store(&ring->thread_failed, 0);
+
+    if (pthread_create(&ring->thread, NULL, sound_ring_thread, ring)) {
+        log_error(LOG_DEFAULT, "Cannot start sound writer thread.");
+        lib_free(ring->chunk_buf);
+        ring->chunk_buf = NULL;
+        return -1;
+    }
+    ring->thread_running = 1;
+
+    return 0;
+}
+
+/** \brief  Stop the writer thread of a ring
+ *
+ * \param[in]   ring    ring
+ */
+void sound_ring_thread_stop(sound_ring_t *ring)
+{
+    if (!ring->thread_running) {
+        return;
+    }
+    atomic_store(&ring->thread_stop, 1);
+    pthread_join(ring->thread, NULL);
+    ring->thread_running = 0;
+    lib_free(ring->chunk_buf);
+    ring->chunk_buf = NULL;
+}
+
+/** \brief  Pause or resume the writer thread of a ring
+ *
+ * When pausing, waits until the thread has finished its current write, so
+ * the caller may then pause the audio output itself.
+ *
+ * \param[in]   ring    ring
+ * \param[in]   pause   nonzero to stop writing to the audio output
+ */
+void sound_ring_thread_pause(sound_ring_t *ring, int pause)
+{
+    atomic_store(&ring->thread_pause, pause ? 1 : 0);
+
+    while (pause && ring->thread_running
+           && !atomic_load(&ring->thread_paused)
+           && !atomic_load(&ring->thread_failed)) {
+        tick_sleep(tick_per_second() / 1000);
+    }
+}
+
+/** \brief  Check whether the writer thread stopped on a write error
+ *
+ * \param[in]   ring    ring
+ *
+ * \return  nonzero after a failed write
+ */
+int sound_ring_thread_failed(sound_ring_t *ring)
+{
+    return atomic_load(&ring->thread_failed);
+}
@@ -0,0 +1,65 @@
+/** \file   soundring.h
+ * \brief   Lock-free sample ring between the emulation and the audio output
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SOUNDRING_H
+#define VICE_SOUNDRING_H
+
+#include "vice.h"
+
+#include <stddef.h>
+
+#include "types.h"
+
+typedef struct sound_ring_s sound_ring_t;
+
+/** \brief  Buffer fill telemetry of a sound ring */
+typedef struct sound_ring_stats_s {
+    size_t size;            /**< size of the ring in frames */
+    size_t fill;            /**< frames currently queued */
+    size_t fill_min;        /**< lowest fill seen by the consumer since the last call */
+    unsigned long underruns;    /**< reads the ring could not fully serve */
+    unsigned long overruns;     /**< writes the ring could not fully take */
+} sound_ring_stats_t;
+
+/** \brief  Blocking write function of an audio output, called by the
+ *          writer thread with a whole number of frames
+ */
+typedef int (*sound_ring_write_func_t)(int16_t *pbuf, size_t frames);
+
+sound_ring_t *sound_ring_new(size_t frames, int channels);
+void sound_ring_free(sound_ring_t *ring);
+
+size_t sound_ring_write(sound_ring_t *ring, const int16_t *pbuf, size_t frames);
+size_t sound_ring_read(sound_ring_t *ring, int16_t *pbuf, size_t frames);
+size_t sound_ring_space(sound_ring_t *ring);
+void sound_ring_get_stats(sound_ring_t *ring, sound_ring_stats_t *stats);
+void sound_ring_log_stats(sound_ring_t *ring, const char *name);
+
+int sound_ring_thread_start(sound_ring_t *ring, sound_ring_write_func_t write, size_t chunk);
+void sound_ring_thread_stop(sound_ring_t *ring);
+void sound_ring_thread_pause(sound_ring_t *ring, int pause);
+int sound_ring_thread_failed(sound_ring_t *ring);
+
+#endif
@@ -40,46 +40,17 @@
 #include "lib.h"
 #include "log.h"
 #include "sound.h"
+#include "soundring.h"
 
 static log_t sdlaudio_log = LOG_DEFAULT;
 
-static int16_t *sdl_buf = NULL;
+static sound_ring_t *sdl_ring = NULL;
 static SDL_AudioSpec sdl_spec;
-static volatile int sdl_inptr = 0;
-static volatile int sdl_outptr = 0;
-static volatile int sdl_full = 0;
-static int sdl_len = 0;
 
 static void sdl_callback(void *userdata, Uint8 *stream, int len)
 {
-    int amount, total;
-    total = 0;
-
-    while (total < (len / (int)sizeof(int16_t))) {
-        amount = sdl_inptr - sdl_outptr;
-        if (amount <= 0) {
-            amount = sdl_len - sdl_outptr;
-        }
-
-        if (amount + total > (len / (int)sizeof(int16_t))) {
-            amount = len / (int)sizeof(int16_t) - total;
-        }
-
-        sdl_full = 0;
-
-        if (!amount) {
-            memset(stream + total * (int)sizeof(int16_t), 0, (size_t)(len - total) * sizeof(int16_t));
-            return;
-        }
-
-        memcpy(stream + total * (int)sizeof(int16_t), sdl_buf + sdl_outptr, (size_t)amount * sizeof(int16_t));
-        total += amount;
-        sdl_outptr += amount;
-
-        if (sdl_outptr == sdl_len) {
-            sdl_outptr = 0;
-        }
-    }
+    sound_ring_read(sdl_ring, (int16_t *)stream,
+                    (size_t)len / (sizeof(int16_t) * sdl_spec.channels));
 }
 
 #ifdef USE_SDL2UI
@@ -161,14 +132,7 @@ static int sdl_init(const char *param, int *speed,
      * buffersize */
     nr = ((*fragnr) * (*fragsize)) / sdl_spec.samples;
 
-    sdl_len = sdl_spec.samples * nr;
-    sdl_inptr = sdl_outptr = sdl_full = 0;
-    sdl_buf = lib_calloc((size_t)sdl_len, sizeof(int16_t));
-
-    if (!sdl_buf) {
-        SDL_CloseAudio();
-        return 1;
-    }
+    sdl_ring = sound_ring_new((size_t)sdl_spec.samples * (size_t)nr, sdl_spec.channels);
 
     *speed = sdl_spec.freq;
     *fragsize = sdl_spec.samples;
@@ -199,9 +163,6 @@ void swab(void *src, void *dst, size_t length)
 
 static int sdl_write(int16_t *pbuf, size_t nr)
 {
-    int total, amount;
-    total = 0;
-
 #ifdef WORDS_BIGENDIAN
     if (sdl_spec.format != AUDIO_S16MSB) {
         /* Swap bytes if we're on a big-endian machine, like the Macintosh */
@@ -209,67 +170,28 @@ static int sdl_write(int16_t *pbuf, size_t nr)
     }
 #endif
 
-    while (total < (int)nr) {
-        amount = sdl_outptr - sdl_inptr;
-
-        if (amount <= 0) {
-            amount = sdl_len - sdl_inptr;
-        }
-
-        if (total + amount > (int)nr) {
-            amount = (int)nr - total;
-        }
-
-        if (amount <= 0) {
-            SDL_Delay(5);
-            continue;
-        }
-
-        memcpy(sdl_buf + sdl_inptr, pbuf + total, (size_t)amount * sizeof(int16_t));
-        sdl_inptr += amount;
-        total += amount;
-
-        if (sdl_inptr == sdl_len) {
-            sdl_inptr = 0;
-        }
-    }
-
-    if (sdl_inptr == sdl_outptr) {
-        sdl_full = 1;
-    }
+    /* sound.c checks the buffer space first, so this does not overrun */
+    sound_ring_write(sdl_ring, pbuf, nr / sdl_spec.channels);
 
     return 0;
 }
 
 static int sdl_bufferspace(void)
 {
-    int amount;
-
-    if (sdl_full) {
-        amount = sdl_len;
-    } else {
-        amount = sdl_inptr - sdl_outptr;
-    }
-
-    if (amount < 0) {
-        amount += sdl_len;
-    }
-
-    return sdl_len - amount;
+    return (int)sound_ring_space(sdl_ring);
 }
 
 static void sdl_close(void)
 {
     SDL_CloseAudio();
-    lib_free(sdl_buf);
-    sdl_buf = NULL;
-    sdl_inptr = sdl_outptr = sdl_len = sdl_full = 0;
+    sound_ring_log_stats(sdl_ring, "sdl");
+    sound_ring_free(sdl_ring);
+    sdl_ring = NULL;
 }
 
 static int sdl_suspend(void)
 {
     SDL_PauseAudio(1);
-    sdl_full = 0;
     return 0;
 }
 
@@ -36,6 +36,7 @@
 #include <vorbis/vorbisenc.h>
 
 #include "sound.h"
+#include "soundenc.h"
 #include "types.h"
 #include "archdep.h"
 #include "log.h"
@@ -49,6 +50,49 @@ static ogg_packet op;
 static vorbis_info vi;
 static vorbis_comment vc;
 static ogg_page og;
+static sound_encoder_t *encoder = NULL;
+
+/* runs on the encoder thread */
+static int vorbis_encode(int16_t *pbuf, size_t nr)
+{
+    float **buffer;
+    size_t i;
+    size_t amount = (stereo) ? nr / 2 : nr;
+    int result;
+    int eos = 0;
+
+    buffer = vorbis_analysis_buffer(&vd, (int)amount);
+    for (i = 0; i < amount; i++) {
+        if (stereo == 1) {
+            buffer[0][i]= pbuf[i * 2] / 32768.f;
+            buffer[1][i]= pbuf[(i * 2) + 1] / 32768.f;
+        } else {
+            buffer[0][i]= pbuf[i] / 32768.f;
+        }
+    }
+
+    vorbis_analysis_wrote(&vd, (int)i);
+
+    while (vorbis_analysis_blockout(&vd, &vb) == 1) {
+        vorbis_analysis(&vb, NULL);
+        vorbis_bitrate_addblock(&vb);
+        while (vorbis_bitrate_flushpacket(&vd, &op)) {
+            ogg_stream_packetin(&os, &op);
+            while(!eos) {
+                result = ogg_stream_pageout(&os, &og);
+                if (!result) {
+                    break;
+                }
+                fwrite(og.header, 1, (size_t)(og.header_len), vorbis_fd);
+                fwrite(og.body, 1, (size_t)(og.body_len), vorbis_fd);
+                if (ogg_page_eos(&og)) {
+                    eos = 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
 
 static int vorbis_init(const char *param, int *speed, int *fragsize, int *fragnr, int *channels)
 {
@@ -63,6 +107,7 @@ static int vorbis_init(const char *param, int *speed, int *fragsize, int *fragnr
     if (!vorbis_fd) {
         return 1;
     }
+    setvbuf(vorbis_fd, NULL, _IOFBF, SOUND_ENCODER_FILE_BUFFER);
 
     if (*channels == 2) {
         stereo = 1;
@@ -98,52 +143,24 @@ static int vorbis_init(const char *param, int *speed, int *fragsize, int *fragnr
         fwrite(og.body, 1, (size_t)(og.body_len), vorbis_fd);
     }
 
+    encoder = sound_encoder_start(vorbis_encode, *speed, *channels);
+    if (encoder == NULL) {
+        return 1;
+    }
+
     return 0;
 }
 
 static int vorbis_write(int16_t *pbuf, size_t nr)
 {
-    float **buffer;
-    size_t i;
-    size_t amount = (stereo) ? nr / 2 : nr;
-    int result;
-    int eos = 0;
-
-    buffer = vorbis_analysis_buffer(&vd, (int)amount);
-    for (i = 0; i < amount; i++) {
-        if (stereo == 1) {
-            buffer[0][i]= pbuf[i * 2] / 32768.f;
-            buffer[1][i]= pbuf[(i * 2) + 1] / 32768.f;
-        } else {
-            buffer[0][i]= pbuf[i] / 32768.f;
-        }
-    }
-
-    vorbis_analysis_wrote(&vd, (int)i);
-
-    while (vorbis_analysis_blockout(&vd, &vb) == 1) {
-        vorbis_analysis(&vb, NULL);
-        vorbis_bitrate_addblock(&vb);
-        while (vorbis_bitrate_flushpacket(&vd, &op)) {
-            ogg_stream_packetin(&os, &op);
-            while(!eos) {
-                result = ogg_stream_pageout(&os, &og);
-                if (!result) {
-                    break;
-                }
-                fwrite(og.header, 1, (size_t)(og.header_len), vorbis_fd);
-                fwrite(og.body, 1, (size_t)(og.body_len), vorbis_fd);
-                if (ogg_page_eos(&og)) {
-                    eos = 1;
-                }
-            }
-        }
-    }
-    return 0;
+    return sound_encoder_write(encoder, pbuf, nr);
 }
 
 static void vorbis_close(void)
 {
+    sound_encoder_stop(encoder);
+    encoder = NULL;
+
     ogg_stream_clear(&os);
     vorbis_block_clear(&vb);
     vorbis_dsp_clear(&vd);
@@ -295,8 +295,12 @@ static const ui_action_info_private_t action_info_list[] = {
     { ACTION_HISTORY_RECORD_STOP,       "history-record-stop",      "Stop recording events",            VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_HISTORY_PLAYBACK_START,    "history-playback-start",   "Start playing back events",        VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_HISTORY_PLAYBACK_STOP,     "history-playback-stop",    "Stop playing back events",         VICE_MACHINE_ALL^VICE_MACHINE_VSID },
+    { ACTION_HISTORY_PLAYBACK_BACK,     "history-playback-back",    "Skip back in event playback",      VICE_MACHINE_ALL^VICE_MACHINE_VSID },
+    { ACTION_HISTORY_PLAYBACK_FORWARD,  "history-playback-forward", "Skip forward in event playback",   VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_HISTORY_MILESTONE_SET,     "history-milestone-set",    "Set recording milestone",          VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_HISTORY_MILESTONE_RESET,   "history-milestone-reset",  "Return to recording milestone",    VICE_MACHINE_ALL^VICE_MACHINE_VSID },
+    { ACTION_REWIND_FRAME,              "rewind-frame",             "Rewind one frame",                 VICE_MACHINE_ALL^VICE_MACHINE_VSID },
+    { ACTION_REWIND_SECOND,             "rewind-second",            "Rewind one second",                VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_MEDIA_RECORD,              "media-record",             "Start recording media",            VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_MEDIA_RECORD_AUDIO,        "media-record-audio",       "Start recording audio",            VICE_MACHINE_ALL^VICE_MACHINE_VSID },
     { ACTION_MEDIA_RECORD_SCREENSHOT,   "media-record-screenshot",  "Take screenshot",                  VICE_MACHINE_ALL^VICE_MACHINE_VSID },
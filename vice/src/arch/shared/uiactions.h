@@ -239,6 +239,8 @@ enum {
     ACTION_HELP_MANUAL,
     ACTION_HISTORY_MILESTONE_RESET,
     ACTION_HISTORY_MILESTONE_SET,
+    ACTION_HISTORY_PLAYBACK_BACK,
+    ACTION_HISTORY_PLAYBACK_FORWARD,
     ACTION_HISTORY_PLAYBACK_START,
     ACTION_HISTORY_PLAYBACK_STOP,
     ACTION_HISTORY_RECORD_START,
@@ -275,6 +277,8 @@ enum {
     ACTION_RESET_DRIVE_11_CONFIG,
     ACTION_RESET_DRIVE_11_INSTALL,
     ACTION_RESTORE_DISPLAY,
+    ACTION_REWIND_FRAME,
+    ACTION_REWIND_SECOND,
     ACTION_SCREENSHOT_QUICKSAVE,
     ACTION_SETTINGS_DEFAULT,
     ACTION_SETTINGS_DIALOG,
@@ -155,6 +155,9 @@ static int handle_drive_true_emulation_by_machine;
 /* Flag: autostart is initialized.  */
 static int autostart_enabled = 0;
 
+/* Flag: autostart is enabled or adaptive warp is watching the activity.  */
+int autostart_advance_needed = 0;
+
 /* Flag: Autostart the file or just load it?  */
 static unsigned int autostart_run_mode;
 
@@ -192,7 +195,7 @@ static int AutostartRunWithColon = 0;
 
 static int AutostartHandleTrueDriveEmulation = 0;
 
-static int AutostartWarp = 0;
+static int AutostartWarp = AUTOSTART_WARP_OFF;
 
 static int AutostartDelay = 0;
 static int AutostartDelayDefaultSeconds = 0;
@@ -204,6 +207,8 @@ static char *AutostartPrgDiskImage = NULL;
 
 static int AutostartDropMode = AUTOSTART_DROP_MODE_RUN;
 
+static int AutostartCache = 0;
+
 
 static const char * const AutostartRunCommandsAvailable[] = {
     "RUN\r", "RUN:\r"
@@ -288,7 +293,15 @@ static int set_autostart_handle_tde(int val, void *param)
 /*! \internal \brief set if autostart should enable warp mode */
 static int set_autostart_warp(int val, void *param)
 {
-    AutostartWarp = val ? 1 : 0;
+    switch (val) {
+        case AUTOSTART_WARP_OFF:
+        case AUTOSTART_WARP_ON:
+        case AUTOSTART_WARP_ADAPTIVE:
+            break;
+        default:
+            return -1;
+    }
+    AutostartWarp = val;
 
     return 0;
 }
@@ -365,6 +378,12 @@ static int set_autostart_drop_mode(int mode, void *unused)
  *
  * \return  0 on success, -1 on error
  */
+static int set_autostart_cache(int val, void *param)
+{
+    AutostartCache = val ? 1 : 0;
+    return 0;
+}
+
 static int cmdline_set_autostart_drop_mode(const char *value, void *unused)
 {
     if ((strcmp(value, "0") == 0) || (strcmp(value, "attach") == 0)) {
@@ -410,7 +429,7 @@ static resource_int_t resources_int[] = {
       &AutostartRunWithColon, set_autostart_run_with_colon, NULL },
     { "AutostartHandleTrueDriveEmulation", 0, RES_EVENT_NO, (resource_value_t)0,
       &AutostartHandleTrueDriveEmulation, set_autostart_handle_tde, NULL },
-    { "AutostartWarp", 1, RES_EVENT_NO, (resource_value_t)0,
+    { "AutostartWarp", AUTOSTART_WARP_ON, RES_EVENT_NO, (resource_value_t)0,
       &AutostartWarp, set_autostart_warp, NULL },
     { "AutostartPrgMode", AUTOSTART_PRG_MODE_DEFAULT, RES_EVENT_NO, (resource_value_t)0,
       &AutostartPrgMode, set_autostart_prg_mode, NULL },
@@ -420,6 +439,8 @@ static resource_int_t resources_int[] = {
       &AutostartDelayRandom, set_autostart_delayrandom, NULL },
     { "AutostartDropMode",  AUTOSTART_DROP_MODE_RUN, RES_EVENT_NO, (resource_value_t)0,
       &AutostartDropMode, set_autostart_drop_mode, NULL },
+    { "AutostartCache", 0, RES_EVENT_NO, (resource_value_t)0,
+      &AutostartCache, set_autostart_cache, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -530,6 +551,15 @@ static const cmdline_option_t cmdline_options[] =
     { "+autostart-warp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "AutostartWarp", (resource_value_t)0,
       NULL, "Disable warp mode during autostart" },
+    { "-autostart-warp-adaptive", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutostartWarp", (resource_value_t)AUTOSTART_WARP_ADAPTIVE,
+      NULL, "Keep warp mode after autostart until the program stops loading" },
+    { "-autostartcache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutostartCache", (resource_value_t)1,
+      NULL, "Restore snapshots of earlier autostarts of the same file" },
+    { "+autostartcache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutostartCache", (resource_value_t)0,
+      NULL, "Always load the program on autostart" },
     { "-autostartprgmode", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "AutostartPrgMode", NULL,
       "<Mode>", "Set autostart mode for PRG files (0: VirtualFS, 1: Inject, 2: Disk image)" },
@@ -659,6 +689,36 @@ static CHECKYESNO check(const char *s, unsigned int blink_mode)
     return check2(s, blink_mode, 0, AUTOSTART_CHECK_FIRST_COLUMN);
 }
 
+/** \brief  Check whether the power-on sequence has ended
+ *
+ * Used to find the untouched state of a machine that just got powered on,
+ * so nothing may have been typed yet and a running autostart must still be
+ * waiting for the initial delay.
+ *
+ * \return  1 if the READY prompt is shown, 0 if not yet, -1 if the machine
+ *          is no longer in its power-on state
+ */
+int autostart_power_on_ready(void)
+{
+    if (autostart_enabled && autostartmode != AUTOSTART_NONE
+        && !autostart_wait_for_reset && maincpu_clk >= autostart_initial_delay_cycles) {
+        return -1;
+    }
+
+    switch (check("READY.", AUTOSTART_WAIT_BLINK)) {
+        case YES:
+            return 1;
+        case NOT_YET:
+            /* also returned when something was typed */
+            if (!kbdbuf_is_empty() || !kbdbuf_queue_is_empty()) {
+                return -1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 
 static void set_true_drive_emulation_mode(int on, int unit)
@@ -742,6 +802,73 @@ static void disable_warp_if_was_requested(void)
     }
 }
 
+/* With adaptive warp, warp mode is kept on after the program was started for
+   as long as a drive or datasette is working, and turned off when they were
+   idle for a while, i.e. when the program is done loading and shows a title
+   screen or waits for input.  */
+
+/* Seconds of emulated time without drive or datasette activity after which
+   warp mode is turned off.  */
+#define ADAPTIVE_WARP_IDLE_SECONDS  2
+
+/* Flag: was warp off when the autostart began?  */
+static int adaptive_warp_allowed = 0;
+/* Clock of the next activity check, 0 when not watching.  */
+static CLOCK adaptive_warp_check_clk = 0;
+/* Clock of the last drive or datasette activity.  */
+static CLOCK adaptive_warp_active_clk;
+
+static void update_advance_needed(void)
+{
+    autostart_advance_needed = autostart_enabled || adaptive_warp_check_clk != 0;
+}
+
+static void adaptive_warp_start(void)
+{
+    if (AutostartWarp != AUTOSTART_WARP_ADAPTIVE || !adaptive_warp_allowed
+        || autostart_run_mode != AUTOSTART_MODE_RUN) {
+        return;
+    }
+    adaptive_warp_allowed = 0;
+    set_warp_mode(1);
+    adaptive_warp_active_clk = maincpu_clk;
+    adaptive_warp_check_clk = maincpu_clk + 1;
+    update_advance_needed();
+}
+
+static void adaptive_warp_stop(void)
+{
+    if (adaptive_warp_check_clk != 0) {
+        adaptive_warp_check_clk = 0;
+        update_advance_needed();
+        set_warp_mode(0);
+    }
+}
+
+static void advance_adaptive_warp(void)
+{
+    adaptive_warp_check_clk = maincpu_clk + (CLOCK)machine_get_cycles_per_frame();
+
+    if (!vsync_get_warp_mode()) {
+        /* turned off by the user */
+        adaptive_warp_check_clk = 0;
+        update_advance_needed();
+        return;
+    }
+
+    if (drive_is_busy() || datasette_motor_running()
+        || maincpu_clk < adaptive_warp_active_clk) {
+        adaptive_warp_active_clk = maincpu_clk;
+        return;
+    }
+
+    if (maincpu_clk - adaptive_warp_active_clk
+        >= (CLOCK)machine_get_cycles_per_second() * ADAPTIVE_WARP_IDLE_SECONDS) {
+        log_message(autostart_log, "No more loading, turning off warp mode.");
+        adaptive_warp_stop();
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 
 /* returns 0 if we left ROM area and should disable autostart */
@@ -901,6 +1028,155 @@ static void load_snapshot_trap(uint16_t unused_addr, void *unused_data)
 
 /* ------------------------------------------------------------------------- */
 
+/* With AutostartCache enabled, the first autostart of a file saves a snapshot
+   at the point the program is started, and later autostarts of the same file
+   restore that snapshot instead of resetting the machine and loading the
+   program again.  The snapshot is named after a hash of the file and of
+   everything that changes what the autostart does, so a changed file or
+   configuration gets a new snapshot.  A snapshot that cannot be read (e.g.
+   one of another VICE version) is removed and the autostart is done the
+   usual way.  */
+
+#define AUTOSTART_CACHE_DIR "autostart"
+
+/* snapshot for the autostart being set up */
+static char *autostart_cache_file = NULL;
+/* snapshot of the autostart in progress, saved when the program is started */
+static char *autostart_cache_store = NULL;
+
+static uint64_t cache_hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len-- > 0) {
+        hash = (hash ^ *p++) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t cache_hash_string(uint64_t hash, const char *s)
+{
+    if (s == NULL) {
+        s = "";
+    }
+    return cache_hash_bytes(hash, s, strlen(s) + 1);
+}
+
+static uint64_t cache_hash_int(uint64_t hash, int value)
+{
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    return cache_hash_string(hash, buf);
+}
+
+static void autostart_cache_forget(void)
+{
+    lib_free(autostart_cache_file);
+    autostart_cache_file = NULL;
+}
+
+/* Find the snapshot for autostarting `file_name', before anything is
+   attached or changed for it.  */
+static void autostart_cache_prepare(const char *kind, int unit, int drive,
+                                    const char *file_name, const char *program_name,
+                                    unsigned int program_number, unsigned int runmode)
+{
+    FILE *fd;
+    uint8_t buf[0x1000];
+    size_t len;
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t resources_hash;
+    char name[24];
+    char *dir;
+
+    autostart_cache_forget();
+
+    if (!AutostartCache || file_name == NULL) {
+        return;
+    }
+
+    fd = fopen(file_name, MODE_READ);
+    if (fd == NULL) {
+        return;
+    }
+    while ((len = fread(buf, 1, sizeof(buf), fd)) > 0) {
+        hash = cache_hash_bytes(hash, buf, len);
+    }
+    fclose(fd);
+
+    hash = cache_hash_string(hash, machine_get_name());
+    hash = cache_hash_string(hash, kind);
+    hash = cache_hash_int(hash, unit);
+    hash = cache_hash_int(hash, drive);
+    hash = cache_hash_string(hash, program_name);
+    hash = cache_hash_int(hash, (int)program_number);
+    hash = cache_hash_int(hash, (int)runmode);
+    hash = cache_hash_int(hash, AutostartPrgMode);
+    hash = cache_hash_int(hash, autostart_basic_load);
+    hash = cache_hash_int(hash, autostart_tape_basic_load);
+    hash = cache_hash_int(hash, AutostartHandleTrueDriveEmulation);
+    resources_hash = resources_get_event_safe_hash();
+    hash = cache_hash_bytes(hash, &resources_hash, sizeof(resources_hash));
+
+    dir = util_join_paths(archdep_user_cache_path(), AUTOSTART_CACHE_DIR, NULL);
+    archdep_mkdir(dir, ARCHDEP_MKDIR_RWXU);
+    snprintf(name, sizeof(name), "%016" PRIx64 ".vsf", hash);
+    autostart_cache_file = util_join_paths(dir, name, NULL);
+    lib_free(dir);
+}
+
+static void autostart_start_program(void);
+
+static void cache_store_trap(uint16_t unused_addr, void *unused_data)
+{
+    if (autostart_cache_store != NULL) {
+        if (machine_write_snapshot(autostart_cache_store, 0, 0, 0) < 0) {
+            log_warning(autostart_log, "Cannot save autostart snapshot `%s'.",
+                        autostart_cache_store);
+            archdep_remove(autostart_cache_store);
+        } else {
+            log_message(autostart_log, "Saved autostart snapshot `%s'.",
+                        autostart_cache_store);
+        }
+        lib_free(autostart_cache_store);
+        autostart_cache_store = NULL;
+    }
+
+    autostart_start_program();
+}
+
+static void cache_restore_trap(uint16_t unused_addr, void *unused_data)
+{
+    if (autostart_cache_store == NULL) {
+        return;
+    }
+
+    if (machine_read_snapshot(autostart_cache_store, 0) < 0) {
+        /* do the autostart the usual way and save a new snapshot */
+        log_warning(autostart_log, "Cannot read autostart snapshot `%s', removing it.",
+                    autostart_cache_store);
+        archdep_remove(autostart_cache_store);
+        machine_trigger_reset(MACHINE_RESET_MODE_POWER_CYCLE);
+        enable_warp_if_requested();
+        return;
+    }
+
+    log_message(autostart_log, "Restored autostart snapshot `%s'.",
+                autostart_cache_store);
+    lib_free(autostart_cache_store);
+    autostart_cache_store = NULL;
+
+    autostart_ignore_reset = 0;
+    autostart_wait_for_reset = 0;
+    mon_update_all_checkpoint_state();
+
+    autostart_done(); /* -> AUTOSTART_DONE */
+    autostart_start_program();
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* Reset autostart.  */
 /* FIXME: cbm2 and pet pass 0,0 into this function before loading
             kernal ... why is this?
@@ -926,6 +1202,7 @@ static void autostart_reinit(int default_seconds, int handle_tde)
     } else {
         autostart_enabled = 0;
     }
+    update_advance_needed();
 }
 
 /* Initialize autostart.  */
@@ -971,10 +1248,10 @@ void autostart_trigger_monitor(int enable)
     trigger_monitor = enable;
 }
 
-/* this is called after successful loading */
-static void autostart_finish(void)
+/* Type the run command, and whatever was given with -keybuf.  */
+static void autostart_start_program(void)
 {
-    DBG(("autostart_finish"));
+    adaptive_warp_start();
 
     if (autostart_run_mode == AUTOSTART_MODE_RUN) {
         log_message(autostart_log, "Starting program.");
@@ -994,6 +1271,21 @@ static void autostart_finish(void)
     }
 }
 
+/* this is called after successful loading */
+static void autostart_finish(void)
+{
+    DBG(("autostart_finish"));
+
+    if (autostart_cache_store != NULL) {
+        /* autostart_done() runs right after this, so the snapshot has the
+           drive settings put back */
+        interrupt_maincpu_trigger_trap(cache_store_trap, NULL);
+        return;
+    }
+
+    autostart_start_program();
+}
+
 /* This is called if all steps of an autostart operation were passed successfully */
 static void autostart_done(void)
 {
@@ -1427,6 +1719,10 @@ static void advance_inject(void)
    mode if necessary.  */
 void autostart_advance(void)
 {
+    if (adaptive_warp_check_clk != 0 && maincpu_clk >= adaptive_warp_check_clk) {
+        advance_adaptive_warp();
+    }
+
     if (!autostart_enabled) {
         return;
     }
@@ -1517,6 +1813,8 @@ static void reboot_for_autostart(const char *program_name, unsigned int mode,
 
     autostart_ignore_reset = 1;
     deallocate_program_name();
+    adaptive_warp_stop();
+    adaptive_warp_allowed = !vsync_get_warp_mode();
     if (program_name && program_name[0]) {
         autostart_program_name = lib_strdup(program_name);
     }
@@ -1538,6 +1836,15 @@ static void reboot_for_autostart(const char *program_name, unsigned int mode,
     }
     DBG(("reboot_for_autostart - autostart_initial_delay_cycles: %"PRIu64, autostart_initial_delay_cycles));
 
+    lib_free(autostart_cache_store);
+    autostart_cache_store = autostart_cache_file;
+    autostart_cache_file = NULL;
+
+    if (autostart_cache_store != NULL && util_file_exists(autostart_cache_store)) {
+        interrupt_maincpu_trigger_trap(cache_restore_trap, NULL);
+        return;
+    }
+
     machine_trigger_reset(MACHINE_RESET_MODE_POWER_CYCLE);
 
     /* enable warp before reset */
@@ -1560,6 +1867,7 @@ int autostart_snapshot(const char *file_name, const char *program_name)
     }
 
     deallocate_program_name();  /* not needed at all */
+    autostart_cache_forget();
 
     if (!(snap = snapshot_open(file_name, &vmajor, &vminor, machine_get_name()))) {
         autostartmode = AUTOSTART_ERROR;
@@ -1590,6 +1898,9 @@ int autostart_tape(const char *file_name, const char *program_name,
         return -1;
     }
 
+    autostart_cache_prepare("tape", (int)tapeunit, 0, file_name, program_name,
+                            program_number, runmode);
+
     /* make sure to init TDE and traps status before each autostart */
     /* FIXME: this should perhaps be handled differently for tape */
     init_drive_emulation_state(DRIVE_UNIT_MIN, 0);
@@ -1770,6 +2081,9 @@ int autostart_disk(int unit, int drive, const char *file_name, const char *progr
         return -1;
     }
 
+    autostart_cache_prepare("disk", unit, drive, file_name, program_name,
+                            program_number, runmode);
+
     /* make sure to init TDE and traps status before each autostart */
     init_drive_emulation_state(unit, drive);
 
@@ -1930,6 +2244,8 @@ int autostart_prg(const char *file_name, unsigned int runmode)
         return -1;
     }
 
+    autostart_cache_prepare("prg", unit, drive, file_name, NULL, 0, runmode);
+
     /* make sure to init TDE and traps status before each autostart */
     init_drive_emulation_state(unit, drive);
 
@@ -2039,6 +2355,8 @@ int autostart_tapecart(const char *file_name, void *unused)
         return -1;
     }
 
+    autostart_cache_forget();
+
     /* make sure to init TDE and traps status before each autostart */
     /* FIXME: this likely needs to be handled differently for tapecart */
     init_drive_emulation_state(DRIVE_UNIT_MIN, 0);
@@ -2218,6 +2536,8 @@ int autostart_device(int device)
         return -1;
     }
 
+    autostart_cache_forget();
+
     /* make sure to init TDE and traps status before each autostart */
     if (device >= DRIVE_UNIT_MIN) {
         init_drive_emulation_state(device);
@@ -2245,6 +2565,10 @@ void autostart_reset(void)
 
     DBG(("autostart_reset (autostart_enabled:%d)", autostart_enabled));
 
+    if (!autostart_ignore_reset) {
+        adaptive_warp_stop();
+    }
+
     if (!autostart_enabled) {
         return;
     }
@@ -2263,12 +2587,20 @@ void autostart_reset(void)
         deallocate_program_name();
         log_message(autostart_log, "Turned off.");
     }
+    if (autostart_ignore_reset) {
+        /* the reset autostart was waiting for, which may also be a restored
+           power-on state with the clock already past the initial delay */
+        autostart_wait_for_reset = 0;
+    }
     autostart_ignore_reset = 0;
 }
 
 void autostart_shutdown(void)
 {
     deallocate_program_name();
+    autostart_cache_forget();
+    lib_free(autostart_cache_store);
+    autostart_cache_store = NULL;
 
     autostart_prg_shutdown();
 }
@@ -35,6 +35,13 @@
 #define AUTOSTART_MODE_RUN  0
 #define AUTOSTART_MODE_LOAD 1
 
+/** \brief  Values of the AutostartWarp resource */
+enum {
+    AUTOSTART_WARP_OFF,         /**< never use warp */
+    AUTOSTART_WARP_ON,          /**< warp until the program is started */
+    AUTOSTART_WARP_ADAPTIVE     /**< warp until the program stops loading */
+};
+
 /** \brief  Behaviour for autostart when dropping media onto the emulator window */
 enum {
     AUTOSTART_DROP_MODE_ATTACH, /**< attach only */
@@ -68,6 +75,11 @@ int autostart_tapecart(const char *file_name, void *unused);
 
 void autostart_disable(void);
 void autostart_advance(void);
+int autostart_power_on_ready(void);
+
+/* Flag: autostart_advance() has something to do, checked by the CPU loops
+   before calling it.  */
+extern int autostart_advance_needed;
 
 /* int autostart_device(int unit); */
 
@@ -0,0 +1,497 @@
+/*
+ * benchmark.c - Built-in workloads for measuring the emulator speed.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With "-benchmark <workloads>" the emulator runs built-in workloads in warp
+   mode one after the other, then writes the results as JSON and quits.
+   Every workload sets a few resources, power cycles the machine, types a
+   BASIC program and lets it run for a while before "-benchmarkframes"
+   frames are measured.
+
+   Besides the emulated cycles and frames per second, the host time spent in
+   the drives, the sound chips and drawing the frames is measured.  The rest
+   is the main CPU along with the video and I/O chips, which are emulated
+   interleaved cycle by cycle and cannot be told apart without timing every
+   single cycle.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "archdep.h"
+#include "benchmark.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "kbdbuf.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+#include "version.h"
+#include "vsync.h"
+
+/* Frames from the power cycle until the program is typed */
+#define BENCHMARK_BOOT_FRAMES       150
+
+/* Frames after the program is typed until the measurement starts */
+#define BENCHMARK_WARMUP_FRAMES     50
+
+/* Machines with a VIC-II and a SID at $D400 */
+#define BENCHMARK_VICII_MACHINES    (VICE_MACHINE_C64 | VICE_MACHINE_C64SC | VICE_MACHINE_C128 | VICE_MACHINE_SCPU64)
+
+/* Machines running BASIC, the ones with disk drives */
+#define BENCHMARK_BASIC_MACHINES    (VICE_MACHINE_ALL & ~VICE_MACHINE_VSID)
+
+typedef struct benchmark_setting_s {
+    const char *name;
+    int value;
+} benchmark_setting_t;
+
+typedef struct benchmark_workload_s {
+    const char *name;
+    unsigned int machines;
+    const benchmark_setting_t *settings;    /* ended by a NULL name */
+    const char *program;                    /* typed after the power cycle */
+} benchmark_workload_t;
+
+typedef struct benchmark_result_s {
+    const benchmark_workload_t *workload;
+    CLOCK cycles;
+    unsigned int frames;
+    uint64_t ns;
+    uint64_t part_ns[BENCHMARK_NUM];
+} benchmark_result_t;
+
+typedef enum benchmark_state_e {
+    BENCHMARK_OFF,
+    BENCHMARK_PENDING,      /* waiting for the trap starting the next workload */
+    BENCHMARK_BOOT,
+    BENCHMARK_WARMUP,
+    BENCHMARK_MEASURE
+} benchmark_state_t;
+
+static const benchmark_setting_t settings_none[] = {
+    { NULL, 0 }
+};
+
+static const benchmark_setting_t settings_sid[] = {
+    { "Sound", 1 },
+    { "SidStereo", 2 },
+    { "Sid2AddressStart", 0xde00 },
+    { "Sid3AddressStart", 0xdf00 },
+    { NULL, 0 }
+};
+
+static const benchmark_setting_t settings_drive[] = {
+    { "Drive8TrueEmulation", 1 },
+    { "Drive8IdleMethod", 0 },
+    { NULL, 0 }
+};
+
+static const benchmark_setting_t settings_reu[] = {
+    { "REU", 1 },
+    { "REUsize", 512 },
+    { NULL, 0 }
+};
+
+static const benchmark_workload_t workloads[] = {
+    /* floating point BASIC */
+    { "basic", BENCHMARK_BASIC_MACHINES, settings_none,
+      "10 A=A+1:B=SIN(A)*SQR(A)/3:C$=STR$(B)\r"
+      "20 GOTO 10\rRUN\r" },
+    /* printing and scrolling the screen */
+    { "screen", BENCHMARK_BASIC_MACHINES, settings_none,
+      "10 PRINT \"BENCHMARK\";A;\r"
+      "20 A=A+1:GOTO 10\rRUN\r" },
+    /* all sprites on, border and background changing mid frame */
+    { "raster", BENCHMARK_VICII_MACHINES, settings_none,
+      "10 FOR I=0 TO 7:POKE 2040+I,13:POKE 53248+I*2,24+I*32:POKE 53249+I*2,100:NEXT\r"
+      "20 POKE 53269,255:POKE 53271,255:POKE 53277,255\r"
+      "30 POKE 53280,A:POKE 53281,A:A=(A+1)AND 15:GOTO 30\rRUN\r" },
+    /* three SIDs playing random notes */
+    { "sid", BENCHMARK_VICII_MACHINES, settings_sid,
+      "10 DIM A(2):A(0)=54272:A(1)=56832:A(2)=57088\r"
+      "20 FOR S=0 TO 2:B=A(S):POKE B+24,15:FOR V=0 TO 14 STEP 7\r"
+      "30 POKE B+V+5,9:POKE B+V+6,240:POKE B+V+3,8:POKE B+V+4,65:NEXT:NEXT\r"
+      "40 FOR S=0 TO 2:B=A(S):FOR V=0 TO 14 STEP 7:POKE B+V+1,RND(1)*64:NEXT:NEXT\r"
+      "50 GOTO 40\rRUN\r" },
+    /* talking to a true emulated drive that never idles */
+    { "drive", BENCHMARK_BASIC_MACHINES, settings_drive,
+      "10 OPEN 15,8,15:PRINT#15,\"I\":CLOSE 15\r"
+      "20 GOTO 10\rRUN\r" },
+    /* copying the screen to the REU and back */
+    { "reu", BENCHMARK_VICII_MACHINES, settings_reu,
+      "10 POKE 57090,0:POKE 57091,4:POKE 57092,0:POKE 57093,0:POKE 57094,0\r"
+      "20 POKE 57095,232:POKE 57096,3:POKE 57089,144:POKE 57089,145\r"
+      "30 GOTO 10\rRUN\r" },
+    { NULL, 0, NULL, NULL }
+};
+
+int benchmark_timing = 0;
+
+static log_t benchmark_log = LOG_DEFAULT;
+
+static char *selection = NULL;
+static char *report_name = NULL;
+static int measure_frames = 1500;
+
+static benchmark_state_t state = BENCHMARK_OFF;
+
+static benchmark_result_t *results = NULL;
+static int results_num = 0;
+
+/* Workload being run, -1 before the first one */
+static int current = -1;
+
+static unsigned int frames;
+static CLOCK start_clk;
+static uint64_t start_ns;
+static uint64_t part_ns[BENCHMARK_NUM];
+
+/* Values of the resources changed by the current workload */
+static int saved_values[8];
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Get the host time in nanoseconds
+ *
+ * \return  time, never 0
+ */
+uint64_t benchmark_now(void)
+{
+#ifdef UNIX_COMPILE
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec + 1;
+#else
+    return TICK_TO_NANO(tick_now()) + 1;
+#endif
+}
+
+/** \brief  Add the time since `start' to a part of the emulator
+ *
+ * \param[in]   part    BENCHMARK_* part
+ * \param[in]   start   time returned by benchmark_now()
+ */
+void benchmark_add(int part, uint64_t start)
+{
+    part_ns[part] += benchmark_now() - start;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int workload_available(const benchmark_workload_t *workload)
+{
+    return (workload->machines & machine_class) != 0;
+}
+
+/* Turn the comma separated list of workloads, or "all", into the results to
+   fill in.  */
+static int select_workloads(const char *list)
+{
+    const benchmark_workload_t *workload;
+    char *names, *name, *next;
+    int all = strcmp(list, "all") == 0;
+
+    for (workload = workloads; workload->name != NULL; workload++) {
+        if (all && workload_available(workload)) {
+            results = lib_realloc(results, sizeof(benchmark_result_t) * (size_t)(results_num + 1));
+            memset(&results[results_num], 0, sizeof(benchmark_result_t));
+            results[results_num++].workload = workload;
+        }
+    }
+    if (all) {
+        return results_num > 0 ? 0 : -1;
+    }
+
+    names = lib_strdup(list);
+    for (name = names; name != NULL; name = next) {
+        next = strchr(name, ',');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        for (workload = workloads; workload->name != NULL; workload++) {
+            if (strcmp(workload->name, name) == 0) {
+                break;
+            }
+        }
+        if (workload->name == NULL || !workload_available(workload)) {
+            log_error(benchmark_log, "Unknown benchmark workload `%s'.", name);
+            lib_free(names);
+            return -1;
+        }
+        results = lib_realloc(results, sizeof(benchmark_result_t) * (size_t)(results_num + 1));
+        memset(&results[results_num], 0, sizeof(benchmark_result_t));
+        results[results_num++].workload = workload;
+    }
+    lib_free(names);
+
+    return 0;
+}
+
+static void write_report(FILE *fp)
+{
+    benchmark_result_t *result;
+    double seconds;
+    int i;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"machine\": \"%s\",\n", machine_name);
+    fprintf(fp, "  \"version\": \"%s\",\n", VERSION);
+    fprintf(fp, "  \"frames\": %d,\n", measure_frames);
+    fprintf(fp, "  \"workloads\": [\n");
+
+    for (i = 0; i < results_num; i++) {
+        result = &results[i];
+        seconds = (double)result->ns / 1e9;
+        if (seconds <= 0.0) {
+            seconds = 1e-9;
+        }
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": \"%s\",\n", result->workload->name);
+        fprintf(fp, "      \"cycles\": %"PRIu64",\n", (uint64_t)result->cycles);
+        fprintf(fp, "      \"seconds\": %.6f,\n", seconds);
+        fprintf(fp, "      \"cycles_per_second\": %.0f,\n", (double)result->cycles / seconds);
+        fprintf(fp, "      \"frames_per_second\": %.2f,\n", (double)result->frames / seconds);
+        fprintf(fp, "      \"speed_percent\": %.1f,\n",
+                (double)result->cycles / seconds * 100.0 / (double)machine_get_cycles_per_second());
+        fprintf(fp, "      \"seconds_per_part\": {\n");
+        fprintf(fp, "        \"emulation\": %.6f,\n",
+                (double)(result->ns - result->part_ns[BENCHMARK_DRIVES]
+                         - result->part_ns[BENCHMARK_SOUND]
+                         - result->part_ns[BENCHMARK_RENDER]) / 1e9);
+        fprintf(fp, "        \"drives\": %.6f,\n", (double)result->part_ns[BENCHMARK_DRIVES] / 1e9);
+        fprintf(fp, "        \"sound\": %.6f,\n", (double)result->part_ns[BENCHMARK_SOUND] / 1e9);
+        fprintf(fp, "        \"render\": %.6f\n", (double)result->part_ns[BENCHMARK_RENDER] / 1e9);
+        fprintf(fp, "      }\n");
+        fprintf(fp, "    }%s\n", i + 1 < results_num ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
+
+static void restore_settings(void)
+{
+    const benchmark_setting_t *setting;
+    int i;
+
+    if (current < 0) {
+        return;
+    }
+    setting = results[current].workload->settings;
+    for (i = 0; setting[i].name != NULL; i++) {
+        resources_set_int(setting[i].name, saved_values[i]);
+    }
+}
+
+/* Write the report and quit */
+static void finish(void)
+{
+    FILE *fp;
+
+    state = BENCHMARK_OFF;
+    restore_settings();
+
+    if (report_name != NULL) {
+        fp = fopen(report_name, MODE_WRITE_TEXT);
+        if (fp == NULL) {
+            log_error(benchmark_log, "Cannot write benchmark report `%s'.", report_name);
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+        write_report(fp);
+        fclose(fp);
+    } else {
+        write_report(stdout);
+        fflush(stdout);
+    }
+
+    archdep_vice_exit(EXIT_SUCCESS);
+}
+
+/* Set up the next workload and power cycle the machine */
+static void start_workload_trap(uint16_t addr, void *data)
+{
+    const benchmark_setting_t *setting;
+    int i;
+
+    restore_settings();
+
+    if (++current >= results_num) {
+        finish();
+        return;
+    }
+
+    setting = results[current].workload->settings;
+    for (i = 0; setting[i].name != NULL; i++) {
+        if (resources_get_int(setting[i].name, &saved_values[i]) < 0
+            || resources_set_int(setting[i].name, setting[i].value) < 0) {
+            log_error(benchmark_log, "Cannot set `%s' for benchmark workload `%s'.",
+                      setting[i].name, results[current].workload->name);
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+    }
+
+    log_message(benchmark_log, "Workload %d/%d: %s", current + 1, results_num,
+                results[current].workload->name);
+
+    machine_trigger_reset(MACHINE_RESET_MODE_POWER_CYCLE);
+
+    state = BENCHMARK_BOOT;
+    frames = 0;
+}
+
+static void start_measure(void)
+{
+    state = BENCHMARK_MEASURE;
+    frames = 0;
+    memset(part_ns, 0, sizeof(part_ns));
+    start_clk = maincpu_clk;
+    start_ns = benchmark_now();
+    benchmark_timing = 1;
+}
+
+static void end_measure(void)
+{
+    benchmark_result_t *result = &results[current];
+
+    benchmark_timing = 0;
+    result->ns = benchmark_now() - start_ns;
+    result->cycles = maincpu_clk - start_clk;
+    result->frames = frames;
+    memcpy(result->part_ns, part_ns, sizeof(part_ns));
+
+    log_message(benchmark_log, "Workload %d/%d: %"PRIu64" cycles in %.3f seconds.",
+                current + 1, results_num, (uint64_t)result->cycles, (double)result->ns / 1e9);
+
+    state = BENCHMARK_PENDING;
+    interrupt_maincpu_trigger_trap(start_workload_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  End of frame hook, moves on through the workloads */
+void benchmark_do_vsync(void)
+{
+    switch (state) {
+        case BENCHMARK_OFF:
+            if (selection == NULL || current >= 0) {
+                return;
+            }
+            benchmark_log = log_open("Benchmark");
+            if (select_workloads(selection) < 0) {
+                log_error(benchmark_log, "No benchmark workloads to run.");
+                archdep_vice_exit(EXIT_FAILURE);
+                return;
+            }
+            resources_set_int("SoundEmulateOnWarp", 1);
+            vsync_set_warp_mode(1);
+            state = BENCHMARK_PENDING;
+            interrupt_maincpu_trigger_trap(start_workload_trap, NULL);
+            break;
+        case BENCHMARK_BOOT:
+            if (++frames >= BENCHMARK_BOOT_FRAMES) {
+                kbdbuf_feed(results[current].workload->program);
+                state = BENCHMARK_WARMUP;
+                frames = 0;
+            }
+            break;
+        case BENCHMARK_WARMUP:
+            if (kbdbuf_queue_is_empty() && ++frames >= BENCHMARK_WARMUP_FRAMES) {
+                start_measure();
+            }
+            break;
+        case BENCHMARK_MEASURE:
+            if (++frames >= (unsigned int)measure_frames) {
+                end_measure();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_benchmark(const char *param, void *extra_param)
+{
+    util_string_set(&selection, param);
+    return 0;
+}
+
+static int cmdline_benchmarkframes(const char *param, void *extra_param)
+{
+    int value = atoi(param);
+
+    if (value < 1) {
+        return -1;
+    }
+    measure_frames = value;
+    return 0;
+}
+
+static int cmdline_benchmarkreport(const char *param, void *extra_param)
+{
+    util_string_set(&report_name, param);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-benchmark", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchmark, NULL, NULL, NULL,
+      "<workloads>", "Run the benchmark workloads (comma separated list of basic, screen, raster, sid, drive, reu, or all), then quit" },
+    { "-benchmarkframes", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchmarkframes, NULL, NULL, NULL,
+      "<frames>", "Number of frames measured per benchmark workload" },
+    { "-benchmarkreport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchmarkreport, NULL, NULL, NULL,
+      "<filename>", "Write the benchmark results as JSON to the file instead of stdout" },
+    CMDLINE_LIST_END
+};
+
+int benchmark_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void benchmark_shutdown(void)
+{
+    lib_free(results);
+    results = NULL;
+    results_num = 0;
+
+    lib_free(selection);
+    selection = NULL;
+    lib_free(report_name);
+    report_name = NULL;
+}
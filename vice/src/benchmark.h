@@ -0,0 +1,57 @@
+/*
+ * benchmark.h - Built-in workloads for measuring the emulator speed.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_BENCHMARK_H
+#define VICE_BENCHMARK_H
+
+#include "types.h"
+
+/* Parts of the emulator timed separately while benchmarking.  */
+enum {
+    BENCHMARK_DRIVES = 0,   /* drive CPUs and chips */
+    BENCHMARK_SOUND,        /* sound chip synthesis and output */
+    BENCHMARK_RENDER,       /* drawing the frame to the canvas */
+    BENCHMARK_NUM
+};
+
+/* Set while a workload is measured */
+extern int benchmark_timing;
+
+uint64_t benchmark_now(void);
+void benchmark_add(int part, uint64_t start);
+
+/* Time the code between the two, `start' is a uint64_t of the caller.  */
+#define BENCHMARK_BEGIN(start)      ((start) = benchmark_timing ? benchmark_now() : 0)
+#define BENCHMARK_END(part, start)                                            \
+    do {                                                                      \
+        if (start) {                                                          \
+            benchmark_add((part), (start));                                   \
+        }                                                                     \
+    } while (0)
+
+int benchmark_cmdline_options_init(void);
+void benchmark_shutdown(void);
+
+void benchmark_do_vsync(void);
+
+#endif
@@ -83,6 +83,12 @@ static int force_c64_mode = 0;
 
 static int mmu_config64 = 0;
 
+/* The CR value the memory configuration was last set up for, with bit 8 set
+   when the full banks are enabled, -1 if unknown.  Programs write the same
+   bank to $FF00 (or load it from the same preconfiguration register) over
+   and over, those writes do not need to set up the configuration again.  */
+static int mmu_cr_applied = -1;
+
 /* Logging goes here.  */
 static log_t mmu_log = LOG_DEFAULT;
 
@@ -480,6 +486,10 @@ void mmu_store(uint16_t address, uint8_t value)
     if (address < 0xb) {
         uint8_t oldvalue;
 
+        if (address == 0 && (value | (c128_full_banks << 8)) == mmu_cr_applied) {
+            return;
+        }
+
         oldvalue = mmu[address];
         mmu[address] = value;
 
@@ -548,6 +558,8 @@ void mmu_store(uint16_t address, uint8_t value)
         mmu_update_page01_pointers();
 
         mmu_update_config();
+
+        mmu_cr_applied = mmu[0] | (c128_full_banks << 8);
     }
 }
 
@@ -687,6 +699,7 @@ void mmu_reset(void)
     for (i = 0; i < 0xb; i++) {
         mmu[i] = 0;
     }
+    mmu_cr_applied = -1;
     /* defaults */
     mmu[7] = 0;
     c128_mem_set_mmu_page_0(mmu[7]);
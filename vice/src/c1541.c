@@ -106,6 +106,8 @@
 
 #ifdef UNIX_COMPILE
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #endif
 
 /* #define DEBUG_DRIVE */
@@ -187,6 +189,7 @@ static int translate_fsimage_error(int err);
 /* command handlers */
 static int attach_cmd(int nargs, char **args);
 static int bam_cmd(int nargs, char **args);
+static int batch_cmd(int nargs, char **args);
 static int bcopy_cmd(int nargs, char **args);
 static int bfill_cmd(int nargs, char **args);
 static int block_cmd(int nargs, char **args);
@@ -296,6 +299,15 @@ const command_t command_list[] = {
       "<track-max>",
       0, 3,
       bam_cmd },
+    { "batch",
+      "batch <manifest> [<workers>]",
+      "Run the jobs listed in <manifest>, one per line.  A job is a disk "
+      "image followed\nby commands separated by `;', the image is attached "
+      "to unit 8 once for all\ncommands of the job.  The jobs are spread "
+      "over <workers> processes (default:\nnumber of CPUs).  An image "
+      "attached to unit 8 is detached first.",
+      1, 2,
+      batch_cmd },
     { "bcopy",
       "bcopy <src-track> <src-sector> <dst-track> <dst-sector> [<src-unit> "
       "[<dst-unit>]]",
@@ -1507,6 +1519,241 @@ static int bam_cmd(int nargs, char **args)
 }
 
 
+/** \brief  Maximum length of a line in a batch manifest */
+#define BATCH_LINE_MAX  4096
+
+/** \brief  Check if a manifest line holds a job
+ *
+ * Empty lines and lines starting with `#' are skipped.
+ *
+ * \param[in]   line    manifest line
+ *
+ * \return  bool
+ */
+static int batch_is_job(const char *line)
+{
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    return *line != '\0' && *line != '\n' && *line != '\r' && *line != '#';
+}
+
+
+/** \brief  Run a single batch job
+ *
+ * Attaches the image to unit 8, runs the commands of the job on it and
+ * detaches the image again.  The commands after a failing one are skipped.
+ *
+ * \param[in]   line    manifest line: `<image> <command> [; <command> ...]`
+ *
+ * \return  0 on success, -1 on failure
+ */
+static int batch_run_job(const char *line)
+{
+    char *args[MAXARG];
+    char *path = NULL;
+    int nargs = 0;
+    int first;
+    int i;
+    int rc = 0;
+
+    for (i = 0; i < MAXARG; i++) {
+        args[i] = NULL;
+    }
+
+    if (split_args(line, &nargs, args) < 0 || nargs == 0) {
+        rc = -1;
+    } else {
+        archdep_expand_path(&path, args[0]);
+        if (open_disk_image(drives[0], path, DRIVE_UNIT_MIN) < 0) {
+            rc = -1;
+        } else {
+            drive_index = 0;
+            for (first = 1; first < nargs; first = i + 1) {
+                for (i = first; i < nargs && strcmp(args[i], ";") != 0; i++) {
+                    /* NOP */
+                }
+                if (i > first && lookup_and_execute_command(i - first, args + first) < 0) {
+                    rc = -1;
+                    break;
+                }
+            }
+            close_disk_image(drives[0], DRIVE_UNIT_MIN);
+        }
+        lib_free(path);
+    }
+
+    for (i = 0; i < MAXARG; i++) {
+        if (args[i] != NULL) {
+            lib_free(args[i]);
+        }
+    }
+    return rc;
+}
+
+
+/** \brief  Run the share of the batch jobs of one worker
+ *
+ * Worker \a worker runs every \a workers th job, starting with job number
+ * \a worker.  Each worker reads the manifest on its own.
+ *
+ * \param[in]   manifest    path to the manifest
+ * \param[in]   worker      worker number
+ * \param[in]   workers     number of workers
+ *
+ * \return  number of failed jobs, -1 if the manifest cannot be read
+ */
+static int batch_worker(const char *manifest, int worker, int workers)
+{
+    char line[BATCH_LINE_MAX];
+    FILE *fd;
+    int lineno = 0;
+    int job = 0;
+    int failed = 0;
+    int c;
+
+    fd = fopen(manifest, "r");
+    if (fd == NULL) {
+        fprintf(stderr, "cannot open `%s'\n", manifest);
+        return -1;
+    }
+
+    while (fgets(line, (int)sizeof line, fd) != NULL) {
+        lineno++;
+        if (strchr(line, '\n') == NULL && !feof(fd)) {
+            /* skip the rest of the line */
+            while ((c = fgetc(fd)) != EOF && c != '\n') {
+                /* NOP */
+            }
+            if (job++ % workers == worker) {
+                fprintf(stderr, "%s:%d: line too long\n", manifest, lineno);
+                failed++;
+            }
+            continue;
+        }
+        if (!batch_is_job(line) || job++ % workers != worker) {
+            continue;
+        }
+        if (batch_run_job(line) < 0) {
+            fprintf(stderr, "%s:%d: job failed\n", manifest, lineno);
+            failed++;
+        }
+        /* keep the output of a job together */
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    fclose(fd);
+    return failed;
+}
+
+
+/** \brief  Run the jobs of a manifest, in parallel where possible
+ *
+ * Syntax: `batch <manifest> [<workers>]`
+ *
+ * vdrive keeps its state in globals, so the workers are processes rather
+ * than threads: each one is forked once and then runs its share of the jobs
+ * without starting c1541 again.  Where fork() is not available, all jobs run
+ * in this process.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int batch_cmd(int nargs, char **args)
+{
+    char *manifest = NULL;
+    int workers = 1;
+    int started = 0;
+    int failed = 0;
+    int unreadable = 0;
+    int result;
+    int w;
+#ifdef UNIX_COMPILE
+    pid_t *pids;
+    int status;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus > 1) {
+        workers = (int)cpus;
+    }
+#endif
+
+    if (nargs == 3) {
+        if (arg_to_int(args[2], &workers) < 0 || workers < 1 || workers > 256) {
+            return FD_BADVAL;
+        }
+    }
+
+    archdep_expand_path(&manifest, args[1]);
+    if (!util_file_exists(manifest)) {
+        fprintf(stderr, "cannot open `%s'\n", manifest);
+        lib_free(manifest);
+        return FD_NOTRD;
+    }
+
+    /* the jobs use unit 8 */
+    close_disk_image(drives[0], DRIVE_UNIT_MIN);
+
+#ifdef UNIX_COMPILE
+    if (workers > 1) {
+        pids = lib_malloc(sizeof(pid_t) * (size_t)workers);
+        fflush(stdout);
+        fflush(stderr);
+        for (started = 0; started < workers; started++) {
+            pids[started] = fork();
+            if (pids[started] < 0) {
+                fprintf(stderr, "cannot start worker %d, running its jobs here\n",
+                        started);
+                break;
+            }
+            if (pids[started] == 0) {
+                result = batch_worker(manifest, started, workers);
+                fflush(NULL);
+                _exit(result < 0 ? 255 : (result > 254 ? 254 : result));
+            }
+        }
+        for (w = 0; w < started; w++) {
+            if (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status)) {
+                fprintf(stderr, "worker %d died\n", w);
+                failed++;
+            } else if (WEXITSTATUS(status) == 255) {
+                unreadable = 1;
+            } else {
+                failed += WEXITSTATUS(status);
+            }
+        }
+        lib_free(pids);
+    }
+#endif
+
+    /* jobs of the workers that could not be started */
+    for (w = started; w < workers && !unreadable; w++) {
+        result = batch_worker(manifest, w, workers);
+        if (result < 0) {
+            unreadable = 1;
+        } else {
+            failed += result;
+        }
+    }
+    lib_free(manifest);
+
+    /* the last job left unit 8 shut down */
+    vdrive_device_setup(drives[0], DRIVE_UNIT_MIN);
+
+    if (unreadable) {
+        return FD_NOTRD;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "batch: %d job%s failed\n", failed, failed == 1 ? "" : "s");
+        return FD_BADIMAGE;
+    }
+    return FD_OK;
+}
+
+
 /** \brief  Copy block to another block
  *
  * Copies a single block (sector) to another block, optionally between different
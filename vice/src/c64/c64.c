@@ -218,6 +218,7 @@ static const trap_t c64_serial_traps[] = {
     { "SerialSendByte", 0xED41, 0xEDAB, { 0x20, 0x97, 0xEE }, serial_trap_send, c64memrom_trap_read, c64memrom_trap_store },
     { "SerialReceiveByte", 0xEE14, 0xEDAB, { 0xA9, 0x00, 0x85 }, serial_trap_receive, c64memrom_trap_read, c64memrom_trap_store },
     { "SerialReady", 0xEEA9, 0xEDAB, { 0xAD, 0x00, 0xDD }, serial_trap_ready, c64memrom_trap_read, c64memrom_trap_store },
+    { "SerialLoad", 0xF4F3, 0xF528, { 0xA9, 0xFD, 0x25 }, serial_trap_load, c64memrom_trap_read, c64memrom_trap_store },
     { NULL, 0, 0, { 0, 0, 0 }, NULL, NULL, NULL }
 };
 
@@ -1012,6 +1013,8 @@ static void c64_monitor_init(void)
         drive_interface_init[dnr] = drive_cpu_monitor_interface_get(dnr);
     }
 
+    maincpu_monitor_interface_get()->mem_bank_peek_block = mem_bank_peek_block;
+
     /* Initialize the monitor.  */
     monitor_init(maincpu_monitor_interface_get(), drive_interface_init, asmarray);
 }
@@ -25,8 +25,10 @@
 
 #include "vice.h"
 
+#include "c64mem.h"
 #include "maincpu.h"
 #include "mem.h"
+#include "perfcounters.h"
 
 #include "cpmcart.h"
 
@@ -104,12 +106,14 @@ inline static void memmap_mem_update(unsigned int addr, int write)
 static void memmap_mem_store(unsigned int addr, unsigned int value)
 {
     memmap_mem_update(addr, 1);
+    PERF_COUNT_MEM_WRITE(addr);
     (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
 }
 
 static uint8_t memmap_mem_read(unsigned int addr)
 {
     memmap_mem_update(addr, 0);
+    PERF_COUNT_MEM_READ(addr);
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
@@ -129,11 +133,44 @@ static uint8_t memmap_mem_read_dummy(unsigned int addr)
     memmap_mem_update(addr, 0);
     return (*_mem_read_tab_ptr_dummy[(addr) >> 8])((uint16_t)(addr));
 }
+#else
+
+/* Loads from plain RAM pages are read directly, all others call the read
+   function.  */
+static inline uint8_t c64cpu_load(unsigned int addr)
+{
+    if (_mem_read_ram_tab_ptr[addr >> 8]) {
+        return mem_ram[addr];
+    }
+    PERF_COUNT_MEM_READ(addr);
+    return (*_mem_read_tab_ptr[addr >> 8])((uint16_t)addr);
+}
+
+#define LOAD(addr) c64cpu_load((unsigned int)(addr))
+
+/* Stores to plain RAM pages are written directly, all others (I/O,
+   cartridges, VIC-II bank, watchpoints) call the store function.  */
+#define STORE(addr, value)                                                  \
+    do {                                                                    \
+        unsigned int store_addr = (addr);                                   \
+        uint8_t *store_base = _mem_write_base_tab_ptr[store_addr >> 8];     \
+                                                                            \
+        if (store_base != NULL) {                                           \
+            store_base[store_addr] = (uint8_t)(value);                      \
+        } else {                                                            \
+            PERF_COUNT_MEM_WRITE(store_addr);                               \
+            (*_mem_write_tab_ptr[store_addr >> 8])((uint16_t)store_addr,    \
+                                                   (uint8_t)(value));       \
+        }                                                                   \
+    } while (0)
+
 #endif
 
-static void check_and_run_alternate_cpu(void)
+static inline void check_and_run_alternate_cpu(void)
 {
-    cpmcart_check_and_run_z80();
+    if (cpmcart_z80_started) {
+        cpmcart_check_and_run_z80();
+    }
 }
 
 #define CHECK_AND_RUN_ALTERNATE_CPU check_and_run_alternate_cpu();
@@ -34,8 +34,6 @@
 
 /* ------------------------------------------------------------------------- */
 
-/* Global clock counter.  */
-CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
 
@@ -180,9 +178,11 @@ int maincpu_ba_low_flags = 0;
 
 #endif /* WORDS_BIGENDIAN || !ALLOW_UNALIGNED_ACCESS */
 
-static void check_and_run_alternate_cpu(void)
+static inline void check_and_run_alternate_cpu(void)
 {
-    cpmcart_check_and_run_z80();
+    if (cpmcart_z80_started) {
+        cpmcart_check_and_run_z80();
+    }
 }
 
 #define CHECK_AND_RUN_ALTERNATE_CPU check_and_run_alternate_cpu();
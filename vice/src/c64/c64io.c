@@ -78,6 +78,73 @@ static io_source_list_t c64io_dd00_head = { NULL, NULL, NULL };
 static io_source_list_t c64io_de00_head = { NULL, NULL, NULL };
 static io_source_list_t c64io_df00_head = { NULL, NULL, NULL };
 
+/* For every low byte of an address in a page, the only device whose range
+   contains an address with that low byte, NULL if there is none, or
+   IO_DISPATCH_WALK if there are several and the list has to be walked to
+   handle collisions.  Rebuilt when a device is registered or unregistered,
+   which the devices do whenever they are enabled or change their range.  */
+typedef io_source_t *io_dispatch_t[0x100];
+
+static io_source_t io_dispatch_walk;
+#define IO_DISPATCH_WALK (&io_dispatch_walk)
+
+static io_dispatch_t c64io_d000_dispatch;
+static io_dispatch_t c64io_d100_dispatch;
+static io_dispatch_t c64io_d200_dispatch;
+static io_dispatch_t c64io_d300_dispatch;
+static io_dispatch_t c64io_d400_dispatch;
+static io_dispatch_t c64io_d500_dispatch;
+static io_dispatch_t c64io_d600_dispatch;
+static io_dispatch_t c64io_d700_dispatch;
+static io_dispatch_t c64io_dd00_dispatch;
+static io_dispatch_t c64io_de00_dispatch;
+static io_dispatch_t c64io_df00_dispatch;
+
+static const struct {
+    io_source_list_t *head;
+    io_source_t **dispatch;
+} io_pages[] = {
+    { &c64io_d000_head, c64io_d000_dispatch },
+    { &c64io_d100_head, c64io_d100_dispatch },
+    { &c64io_d200_head, c64io_d200_dispatch },
+    { &c64io_d300_head, c64io_d300_dispatch },
+    { &c64io_d400_head, c64io_d400_dispatch },
+    { &c64io_d500_head, c64io_d500_dispatch },
+    { &c64io_d600_head, c64io_d600_dispatch },
+    { &c64io_d700_head, c64io_d700_dispatch },
+    { &c64io_dd00_head, c64io_dd00_dispatch },
+    { &c64io_de00_head, c64io_de00_dispatch },
+    { &c64io_df00_head, c64io_df00_dispatch },
+};
+
+static void io_dispatch_rebuild(io_source_list_t *head)
+{
+    io_source_list_t *current;
+    io_source_t **dispatch = NULL;
+    unsigned int addr;
+    size_t i;
+
+    for (i = 0; i < sizeof(io_pages) / sizeof(io_pages[0]); i++) {
+        if (io_pages[i].head == head) {
+            dispatch = io_pages[i].dispatch;
+            break;
+        }
+    }
+    assert(dispatch != NULL);
+
+    memset(dispatch, 0, sizeof(io_dispatch_t));
+
+    for (current = head->next; current != NULL; current = current->next) {
+        for (addr = current->device->start_address; addr <= current->device->end_address; addr++) {
+            if (dispatch[addr & 0xff] == NULL) {
+                dispatch[addr & 0xff] = current->device;
+            } else if (dispatch[addr & 0xff] != current->device) {
+                dispatch[addr & 0xff] = IO_DISPATCH_WALK;
+            }
+        }
+    }
+}
+
 static void io_source_detach(io_source_detach_t *source)
 {
     switch (source->det_id) {
@@ -292,9 +359,10 @@ static void io_source_log_collisions(uint16_t addr, int amount, io_source_list_t
     }
 }
 
-static inline uint8_t io_read(io_source_list_t *list, uint16_t addr)
+static inline uint8_t io_read(io_source_list_t *list, io_source_t **dispatch, uint16_t addr)
 {
     io_source_list_t *current = list->next;
+    io_source_t *device = dispatch[addr & 0xff];
     int io_source_counter = 0;
     int io_source_valid = 0;
     uint8_t realval = 0;
@@ -304,6 +372,18 @@ static inline uint8_t io_read(io_source_list_t *list, uint16_t addr)
 
     vicii_handle_pending_alarms_external(0);
 
+    /* no collision possible, the same as the walk below with one device */
+    if (device != IO_DISPATCH_WALK) {
+        if (device != NULL && device->read != NULL
+            && addr >= device->start_address && addr <= device->end_address) {
+            retval = device->read((uint16_t)(addr & device->address_mask));
+            if (device->io_source_valid) {
+                return retval;
+            }
+        }
+        return vicii_read_phi1();
+    }
+
     while (current) {
         if (current->device->read != NULL) {
             if ((addr >= current->device->start_address) && (addr <= current->device->end_address)) {
@@ -390,15 +470,25 @@ static inline uint8_t io_peek(io_source_list_t *list, uint16_t addr)
     return vicii_read_phi1();
 }
 
-static inline void io_store(io_source_list_t *list, uint16_t addr, uint8_t value)
+static inline void io_store(io_source_list_t *list, io_source_t **dispatch, uint16_t addr, uint8_t value)
 {
     int writes = 0;
     uint16_t addy = 0xffff;
     io_source_list_t *current = list->next;
+    io_source_t *device = dispatch[addr & 0xff];
     void (*store)(uint16_t address, uint8_t data) = NULL;
 
     vicii_handle_pending_alarms_external_write();
 
+    /* no collision possible, the same as the walk below with one device */
+    if (device != IO_DISPATCH_WALK) {
+        if (device != NULL && device->store != NULL
+            && addr >= device->start_address && addr <= device->end_address) {
+            device->store((uint16_t)(addr & device->address_mask), value);
+        }
+        return;
+    }
+
     while (current) {
         if (current->device->store != NULL) {
             if (addr >= current->device->start_address && addr <= current->device->end_address) {
@@ -482,6 +572,11 @@ io_source_list_t *io_source_register(io_source_t *device)
     retval->next = NULL;
     retval->device->order = order++;
 
+    while (current->previous != NULL) {
+        current = current->previous;
+    }
+    io_dispatch_rebuild(current);
+
     return retval;
 }
 
@@ -505,6 +600,11 @@ void io_source_unregister(io_source_list_t *device)
         }
     }
 
+    while (prev->previous != NULL) {
+        prev = prev->previous;
+    }
+    io_dispatch_rebuild(prev);
+
     lib_free(device);
 }
 
@@ -589,7 +689,7 @@ void cartio_set_highest_order(unsigned int nr)
 uint8_t c64io_d000_read(uint16_t addr)
 {
     DBGRW(("IO: io-d000 r %04x", addr));
-    return io_read(&c64io_d000_head, addr);
+    return io_read(&c64io_d000_head, c64io_d000_dispatch, addr);
 }
 
 uint8_t c64io_d000_peek(uint16_t addr)
@@ -601,13 +701,13 @@ uint8_t c64io_d000_peek(uint16_t addr)
 void c64io_d000_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d000 w %04x %02x", addr, value));
-    io_store(&c64io_d000_head, addr, value);
+    io_store(&c64io_d000_head, c64io_d000_dispatch, addr, value);
 }
 
 uint8_t c64io_d100_read(uint16_t addr)
 {
     DBGRW(("IO: io-d100 r %04x", addr));
-    return io_read(&c64io_d100_head, addr);
+    return io_read(&c64io_d100_head, c64io_d100_dispatch, addr);
 }
 
 uint8_t c64io_d100_peek(uint16_t addr)
@@ -619,13 +719,13 @@ uint8_t c64io_d100_peek(uint16_t addr)
 void c64io_d100_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d100 w %04x %02x", addr, value));
-    io_store(&c64io_d100_head, addr, value);
+    io_store(&c64io_d100_head, c64io_d100_dispatch, addr, value);
 }
 
 uint8_t c64io_d200_read(uint16_t addr)
 {
     DBGRW(("IO: io-d200 r %04x", addr));
-    return io_read(&c64io_d200_head, addr);
+    return io_read(&c64io_d200_head, c64io_d200_dispatch, addr);
 }
 
 uint8_t c64io_d200_peek(uint16_t addr)
@@ -637,13 +737,13 @@ uint8_t c64io_d200_peek(uint16_t addr)
 void c64io_d200_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d200 w %04x %02x", addr, value));
-    io_store(&c64io_d200_head, addr, value);
+    io_store(&c64io_d200_head, c64io_d200_dispatch, addr, value);
 }
 
 uint8_t c64io_d300_read(uint16_t addr)
 {
     DBGRW(("IO: io-d300 r %04x", addr));
-    return io_read(&c64io_d300_head, addr);
+    return io_read(&c64io_d300_head, c64io_d300_dispatch, addr);
 }
 
 uint8_t c64io_d300_peek(uint16_t addr)
@@ -655,13 +755,13 @@ uint8_t c64io_d300_peek(uint16_t addr)
 void c64io_d300_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d300 w %04x %02x", addr, value));
-    io_store(&c64io_d300_head, addr, value);
+    io_store(&c64io_d300_head, c64io_d300_dispatch, addr, value);
 }
 
 uint8_t c64io_d400_read(uint16_t addr)
 {
     DBGRW(("IO: io-d400 r %04x", addr));
-    return io_read(&c64io_d400_head, addr);
+    return io_read(&c64io_d400_head, c64io_d400_dispatch, addr);
 }
 
 uint8_t c64io_d400_peek(uint16_t addr)
@@ -673,13 +773,13 @@ uint8_t c64io_d400_peek(uint16_t addr)
 void c64io_d400_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d400 w %04x %02x", addr, value));
-    io_store(&c64io_d400_head, addr, value);
+    io_store(&c64io_d400_head, c64io_d400_dispatch, addr, value);
 }
 
 uint8_t c64io_d500_read(uint16_t addr)
 {
     DBGRW(("IO: io-d500 r %04x", addr));
-    return io_read(&c64io_d500_head, addr);
+    return io_read(&c64io_d500_head, c64io_d500_dispatch, addr);
 }
 
 uint8_t c64io_d500_peek(uint16_t addr)
@@ -691,13 +791,13 @@ uint8_t c64io_d500_peek(uint16_t addr)
 void c64io_d500_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d500 w %04x %02x", addr, value));
-    io_store(&c64io_d500_head, addr, value);
+    io_store(&c64io_d500_head, c64io_d500_dispatch, addr, value);
 }
 
 uint8_t c64io_d600_read(uint16_t addr)
 {
     DBGRW(("IO: io-d600 r %04x", addr));
-    return io_read(&c64io_d600_head, addr);
+    return io_read(&c64io_d600_head, c64io_d600_dispatch, addr);
 }
 
 uint8_t c64io_d600_peek(uint16_t addr)
@@ -709,13 +809,13 @@ uint8_t c64io_d600_peek(uint16_t addr)
 void c64io_d600_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d600 w %04x %02x", addr, value));
-    io_store(&c64io_d600_head, addr, value);
+    io_store(&c64io_d600_head, c64io_d600_dispatch, addr, value);
 }
 
 uint8_t c64io_d700_read(uint16_t addr)
 {
     DBGRW(("IO: io-d700 r %04x", addr));
-    return io_read(&c64io_d700_head, addr);
+    return io_read(&c64io_d700_head, c64io_d700_dispatch, addr);
 }
 
 uint8_t c64io_d700_peek(uint16_t addr)
@@ -727,13 +827,13 @@ uint8_t c64io_d700_peek(uint16_t addr)
 void c64io_d700_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-d700 w %04x %02x", addr, value));
-    io_store(&c64io_d700_head, addr, value);
+    io_store(&c64io_d700_head, c64io_d700_dispatch, addr, value);
 }
 
 uint8_t c64io_dd00_read(uint16_t addr)
 {
     DBGRW(("IO: io-dd00 r %04x", addr));
-    return io_read(&c64io_dd00_head, addr);
+    return io_read(&c64io_dd00_head, c64io_dd00_dispatch, addr);
 }
 
 uint8_t c64io_dd00_peek(uint16_t addr)
@@ -745,13 +845,13 @@ uint8_t c64io_dd00_peek(uint16_t addr)
 void c64io_dd00_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-dd00 w %04x %02x", addr, value));
-    io_store(&c64io_dd00_head, addr, value);
+    io_store(&c64io_dd00_head, c64io_dd00_dispatch, addr, value);
 }
 
 uint8_t c64io_de00_read(uint16_t addr)
 {
     DBGRW(("IO: io-de00 r %04x", addr));
-    return io_read(&c64io_de00_head, addr);
+    return io_read(&c64io_de00_head, c64io_de00_dispatch, addr);
 }
 
 uint8_t c64io_de00_peek(uint16_t addr)
@@ -763,13 +863,13 @@ uint8_t c64io_de00_peek(uint16_t addr)
 void c64io_de00_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-de00 w %04x %02x", addr, value));
-    io_store(&c64io_de00_head, addr, value);
+    io_store(&c64io_de00_head, c64io_de00_dispatch, addr, value);
 }
 
 uint8_t c64io_df00_read(uint16_t addr)
 {
     DBGRW(("IO: io-df00 r %04x", addr));
-    return io_read(&c64io_df00_head, addr);
+    return io_read(&c64io_df00_head, c64io_df00_dispatch, addr);
 }
 
 uint8_t c64io_df00_peek(uint16_t addr)
@@ -781,7 +881,7 @@ uint8_t c64io_df00_peek(uint16_t addr)
 void c64io_df00_store(uint16_t addr, uint8_t value)
 {
     DBGRW(("IO: io-df00 w %04x %02x", addr, value));
-    io_store(&c64io_df00_head, addr, value);
+    io_store(&c64io_df00_head, c64io_df00_dispatch, addr, value);
 }
 
 /* ---------------------------------------------------------------------------------------------------------- */
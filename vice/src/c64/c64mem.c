@@ -56,6 +56,7 @@
 #include "mem.h"
 #include "monitor.h"
 #include "plus256k.h"
+#include "perfcounters.h"
 #include "plus60k.h"
 #include "ram.h"
 #include "resources.h"
@@ -103,15 +104,35 @@ store_func_ptr_t *_mem_write_tab_ptr_dummy;
 static uint8_t **_mem_read_base_tab_ptr;
 static uint32_t *mem_read_limit_tab_ptr;
 
+/* Pointers to the currently used direct read and write tables.  */
+uint8_t *_mem_read_ram_tab_ptr;
+uint8_t **_mem_write_base_tab_ptr;
+
 /* Memory read and write tables.  */
 static store_func_ptr_t mem_write_tab[NUM_VBANKS][NUM_CONFIGS][0x101];
 static read_func_ptr_t mem_read_tab[NUM_CONFIGS][0x101];
 static uint8_t *mem_read_base_tab[NUM_CONFIGS][0x101];
 static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
 
+/* Pages whose store function is `ram_store()' can be written directly, the
+   CPU uses these tables instead of calling the function.  NULL entries go
+   through `mem_write_tab'.  */
+static uint8_t *mem_write_base_tab[NUM_VBANKS][NUM_CONFIGS][0x101];
+
+/* Nonzero for pages whose read function is `ram_read()', the CPU loads
+   these from `mem_ram' directly.  Unlike `mem_read_base_tab', which is meant
+   for opcode fetches and is qualified by the limits, this follows
+   `mem_read_tab' exactly.  A flag rather than a pointer, so the load itself
+   does not have to wait for the table lookup.  */
+static uint8_t mem_read_ram_tab[NUM_CONFIGS][0x101];
+
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
 
+/* All loads and stores go through the watchpoint functions.  */
+static uint8_t mem_read_ram_tab_watch[0x101];
+static uint8_t *mem_write_base_tab_watch[0x101];
+
 /* Current video bank (0, 1, 2 or 3).  */
 static int vbank;
 
@@ -165,6 +186,8 @@ static void mem_update_tab_ptrs(int flag)
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_ram_tab_ptr = mem_read_ram_tab_watch;
+        _mem_write_base_tab_ptr = mem_write_base_tab_watch;
         if (flag > 1) {
             /* enable watchpoints on dummy accesses */
             _mem_read_tab_ptr_dummy = mem_read_tab_watch;
@@ -177,6 +200,8 @@ static void mem_update_tab_ptrs(int flag)
         /* all watchpoints disabled */
         _mem_read_tab_ptr = mem_read_tab[mem_config];
         _mem_write_tab_ptr = mem_write_tab[vbank][mem_config];
+        _mem_read_ram_tab_ptr = mem_read_ram_tab[mem_config];
+        _mem_write_base_tab_ptr = mem_write_base_tab[vbank][mem_config];
         _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
         _mem_write_tab_ptr_dummy = mem_write_tab[vbank][mem_config];
     }
@@ -207,13 +232,25 @@ void mem_toggle_watchpoints(int flag, void *context)
     see testprogs/CPU/cpuport for details and tests
 */
 
+/* Direct access to plain RAM pages for REU DMA.  */
+static uint8_t *c64_mem_dma_ram(uint16_t addr, int write)
+{
+    if (write) {
+        return _mem_write_base_tab_ptr[addr >> 8];
+    }
+    return _mem_read_ram_tab_ptr[addr >> 8] ? mem_ram : NULL;
+}
+
 void c64_mem_init(void)
 {
+    /* Initialize REU direct RAM interface */
+    reu_dma_ram_register(c64_mem_dma_ram);
 }
 
 void mem_pla_config_changed(void)
 {
     mem_config = (((~pport.dir | pport.data) & 0x7) | (export.exrom << 3) | (export.game << 4));
+    PERF_SET_MEM_CONFIG(mem_config);
 
     /* NOTE: CPU port bits 3,4,5 are not connected on the SX64 board */
     if (board_type == BOARD_SX64) {
@@ -783,18 +820,47 @@ static void plus60k_init_config(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* update the direct write table from the store functions */
+static void mem_write_base_update(int vb, int config, int page)
+{
+    mem_write_base_tab[vb][config][page] =
+        (mem_write_tab[vb][config][page] == ram_store) ? mem_ram : NULL;
+}
+
+/* update the direct read table from the read functions */
+static void mem_read_ram_update(int config, int page)
+{
+    mem_read_ram_tab[config][page] = (mem_read_tab[config][page] == ram_read);
+}
+
+static void mem_direct_tabs_update_all(void)
+{
+    int i, j, k;
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        for (j = 0; j <= 0x100; j++) {
+            for (k = 0; k < NUM_VBANKS; k++) {
+                mem_write_base_update(k, i, j);
+            }
+            mem_read_ram_update(i, j);
+        }
+    }
+}
+
 void mem_set_write_hook(int config, int page, store_func_t *f)
 {
     int i;
 
     for (i = 0; i < NUM_VBANKS; i++) {
         mem_write_tab[i][config][page] = f;
+        mem_write_base_update(i, config, page);
     }
 }
 
 void mem_read_tab_set(unsigned int base, unsigned int index, read_func_ptr_t read_func)
 {
     mem_read_tab[base][index] = read_func;
+    mem_read_ram_update((int)base, (int)index);
 }
 
 
@@ -966,6 +1032,10 @@ void mem_initialize_memory(void)
     if (board == BOARD_MAX) {
         mem_limit_max_init();
     }
+
+    /* the function tables above may have been changed directly */
+    mem_direct_tabs_update_all();
+    mem_update_tab_ptrs(watchpoints_active);
 }
 
 void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit)
@@ -1003,6 +1073,7 @@ void mem_set_vbank(int new_vbank)
     /* Do not override watchpoints on vbank switches.  */
     if (_mem_write_tab_ptr != mem_write_tab_watch) {
         _mem_write_tab_ptr = mem_write_tab[new_vbank][mem_config];
+        _mem_write_base_tab_ptr = mem_write_base_tab[new_vbank][mem_config];
     }
 
     vicii_set_vbank(new_vbank);
@@ -1419,6 +1490,30 @@ uint8_t mem_bank_peek(int bank, uint16_t addr, void *context)
     return mem_ram[addr];
 }
 
+/* used by the monitor to read larger blocks without side effects, pages
+   that come straight from `mem_ram' are copied at once */
+void mem_bank_peek_block(int bank, uint16_t addr, uint8_t *data, unsigned int len, void *context)
+{
+    unsigned int chunk, i;
+
+    while (len > 0) {
+        chunk = 0x100 - (addr & 0xff);
+        if (chunk > len) {
+            chunk = len;
+        }
+        if (bank == 1 || (bank == 0 && _mem_read_ram_tab_ptr[addr >> 8])) {
+            memcpy(data, mem_ram + addr, chunk);
+        } else {
+            for (i = 0; i < chunk; i++) {
+                data[i] = mem_bank_peek(bank, (uint16_t)(addr + i), context);
+            }
+        }
+        data += chunk;
+        addr = (uint16_t)(addr + chunk);
+        len -= chunk;
+    }
+}
+
 void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
 {
     switch (bank) {
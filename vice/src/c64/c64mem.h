@@ -62,6 +62,12 @@ void mem_set_tape_motor_in(int val);
 
 extern uint8_t mem_chargen_rom[C64_CHARGEN_ROM_SIZE];
 
+/* Pages of the current configuration that are loaded from `mem_ram' (flag)
+   and stored to (base pointer) directly, 0/NULL where the read or store
+   function must be called.  */
+extern uint8_t *_mem_read_ram_tab_ptr;
+extern uint8_t **_mem_write_base_tab_ptr;
+
 void mem_set_write_hook(int config, int page, store_func_t *f);
 void mem_read_tab_set(unsigned int base, unsigned int index, read_func_ptr_t read_func);
 void mem_read_base_set(unsigned int base, unsigned int index, uint8_t *mem_ptr);
@@ -70,6 +76,8 @@ void mem_read_limit_set(unsigned int base, unsigned int index, uint32_t limit);
 
 void mem_store_without_ultimax(uint16_t addr, uint8_t value);
 uint8_t mem_read_without_ultimax(uint16_t addr);
+
+void mem_bank_peek_block(int bank, uint16_t addr, uint8_t *data, unsigned int len, void *context);
 void mem_store_without_romlh(uint16_t addr, uint8_t value);
 
 void store_bank_io(uint16_t addr, uint8_t byte);
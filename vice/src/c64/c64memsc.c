@@ -58,6 +58,7 @@
 #include "mem.h"
 #include "monitor.h"
 #include "plus256k.h"
+#include "perfcounters.h"
 #include "plus60k.h"
 #include "ram.h"
 #include "resources.h"
@@ -162,10 +163,31 @@ static void store_watch(uint16_t addr, uint8_t value)
     mem_write_tab[mem_config][addr >> 8](addr, value);
 }
 
+/* Only the pages with a watchpoint go through the watchpoint functions, all
+   others keep the functions of the current configuration.  */
+static void mem_update_watch_tabs(void)
+{
+    unsigned int i;
+
+    for (i = 0; i <= 0x100; i++) {
+        if (monitor_watch_page_load(e_comp_space, i & 0xff)) {
+            mem_read_tab_watch[i] = (i & 0xff) ? read_watch : zero_read_watch;
+        } else {
+            mem_read_tab_watch[i] = mem_read_tab[mem_config][i];
+        }
+        if (monitor_watch_page_store(e_comp_space, i & 0xff)) {
+            mem_write_tab_watch[i] = (i & 0xff) ? store_watch : zero_store_watch;
+        } else {
+            mem_write_tab_watch[i] = mem_write_tab[mem_config][i];
+        }
+    }
+}
+
 /* called by mem_pla_config_changed(), mem_toggle_watchpoints() */
 static void mem_update_tab_ptrs(int flag)
 {
     if (flag) {
+        mem_update_watch_tabs();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
         if (flag > 1) {
@@ -226,6 +248,7 @@ int mem_get_current_bank_config(void) {
 void mem_pla_config_changed(void)
 {
     mem_config = (((~pport.dir | pport.data) & 0x7) | (export.exrom << 3) | (export.game << 4));
+    PERF_SET_MEM_CONFIG(mem_config);
 
     /* NOTE: CPU port bits 3,4,5 are not connected on the SX64 board */
     if (board_type == BOARD_SX64) {
@@ -746,11 +769,17 @@ static void plus60k_init_config(void)
 void mem_set_write_hook(int config, int page, store_func_t *f)
 {
     mem_write_tab[config][page] = f;
+    if (watchpoints_active && config == mem_config) {
+        mem_update_watch_tabs();
+    }
 }
 
 void mem_read_tab_set(unsigned int base, unsigned int index, read_func_ptr_t read_func)
 {
     mem_read_tab[base][index] = read_func;
+    if (watchpoints_active && (int)base == mem_config) {
+        mem_update_watch_tabs();
+    }
 }
 
 /* set c64 base */
@@ -782,14 +811,6 @@ void mem_initialize_memory(void)
 
     mem_limit_init();
 
-    /* setup watchpoint tables */
-    mem_read_tab_watch[0] = zero_read_watch;
-    mem_write_tab_watch[0] = zero_store_watch;
-    for (i = 1; i <= 0x100; i++) {
-        mem_read_tab_watch[i] = read_watch;
-        mem_write_tab_watch[i] = store_watch;
-    }
-
     resources_get_int("BoardType", &board);
 
     /* first init everything to "nothing" */
@@ -1394,6 +1415,30 @@ uint8_t mem_bank_peek(int bank, uint16_t addr, void *context)
     return mem_ram[addr];
 }
 
+/* used by the monitor to read larger blocks without side effects, the ram
+   bank is copied at once */
+void mem_bank_peek_block(int bank, uint16_t addr, uint8_t *data, unsigned int len, void *context)
+{
+    unsigned int chunk, i;
+
+    while (len > 0) {
+        chunk = 0x10000 - addr;
+        if (chunk > len) {
+            chunk = len;
+        }
+        if (bank == 1) {
+            memcpy(data, mem_ram + addr, chunk);
+        } else {
+            for (i = 0; i < chunk; i++) {
+                data[i] = mem_bank_peek(bank, (uint16_t)(addr + i), context);
+            }
+        }
+        data += chunk;
+        addr = (uint16_t)(addr + chunk);
+        len -= chunk;
+    }
+}
+
 void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
 {
     switch (bank) {
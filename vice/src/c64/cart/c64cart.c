@@ -1048,7 +1048,7 @@ static int crt_attach(const char *filename, uint8_t *rawcart)
         }
     }
 
-    fclose(fd);
+    crt_close(fd);
 
     if (rc == -1) {
         DBG(("crt_attach error (%d)\n", rc));
@@ -470,6 +470,35 @@ void cart_port_config_changed_slotmain(void)
     ultimax_memptr_update();
 }
 
+#ifdef USESLOTS
+/*
+    returns 1 if a new config of the main slot only switches the ROM bank.
+
+    bank switching carts (easyflash, gmod2, magic desk, ocean...) can do that
+    thousands of times per second. the memory configuration of the PLA, and
+    what the VIC-II sees, stays the same then, so only the bank numbers and
+    the direct pointer of the CPU into the banks have to be updated.
+*/
+static int cart_bank_only_changed_slotmain(uint8_t mode_phi1, uint8_t mode_phi2, unsigned int wflag)
+{
+    uint8_t game = mode_phi2 & 1;
+    uint8_t exrom = ((mode_phi2 >> 1) & 1) ^ 1;
+
+    /* in ultimax mode the VIC-II sees the cartridge ROM */
+    if ((mode_phi1 & 3) == CMODE_ULTIMAX || (mode_phi2 & 3) == CMODE_ULTIMAX) {
+        return 0;
+    }
+    if (wflag & (CMODE_RELEASE_FREEZE | CMODE_TRIGGER_FREEZE_NMI_ONLY)) {
+        return 0;
+    }
+    return export_slotmain.game == game
+        && export_slotmain.exrom == exrom
+        && export_slotmain.ultimax_phi1 == 0
+        && export_slotmain.ultimax_phi2 == 0
+        && export_ram == (int)((wflag >> CMODE_EXPORT_RAM_SHIFT) & 1);
+}
+#endif
+
 void cart_config_changed_slotmain(uint8_t mode_phi1, uint8_t mode_phi2, unsigned int wflag)
 {
 #ifndef USESLOTS
@@ -490,6 +519,13 @@ void cart_config_changed_slotmain(uint8_t mode_phi1, uint8_t mode_phi2, unsigned
         machine_handle_pending_alarms(0);
     }
 
+    if (cart_bank_only_changed_slotmain(mode_phi1, mode_phi2, wflag)) {
+        cart_romhbank_set_slotmain((mode_phi2 >> CMODE_BANK_SHIFT) & CMODE_BANK_MASK);
+        cart_romlbank_set_slotmain((mode_phi2 >> CMODE_BANK_SHIFT) & CMODE_BANK_MASK);
+        maincpu_resync_limits();
+        return;
+    }
+
     export_slotmain.game = mode_phi2 & 1;
     export_slotmain.exrom = ((mode_phi2 >> 1) & 1) ^ 1;
 
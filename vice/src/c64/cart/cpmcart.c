@@ -48,6 +48,7 @@
 #include "monitor.h"
 #include "resources.h"
 #include "snapshot.h"
+#include "testrunner.h"
 #include "types.h"
 #include "z80regs.h"
 
@@ -55,7 +56,7 @@
 
 z80_regs_t z80_regs;
 
-static int z80_started = 0;
+int cpmcart_z80_started = 0;
 static int cpmcart_enabled = 0;
 
 static uint8_t cpmcart_wrap_read(uint16_t addr)
@@ -75,10 +76,10 @@ static void cpmcart_io_store(uint16_t addr, uint8_t byte)
 {
     int val = byte & 1;
 
-    if (!z80_started && !val) {
-        z80_started = 1;
-    } else if (z80_started && val) {
-        z80_started = 0;
+    if (!cpmcart_z80_started && !val) {
+        cpmcart_z80_started = 1;
+    } else if (cpmcart_z80_started && val) {
+        cpmcart_z80_started = 0;
     }
 }
 
@@ -89,7 +90,7 @@ int cpmcart_cart_enabled(void)
 
 static int cpmcart_dump(void)
 {
-    mon_out("Active CPU: %s\n", z80_started ? "Z80" : "6510");
+    mon_out("Active CPU: %s\n", cpmcart_z80_started ? "Z80" : "6510");
     return 0;
 }
 
@@ -132,7 +133,7 @@ static int set_cpmcart_enabled(int value, void *param)
             io_source_unregister(cpmcart_list_item);
             cpmcart_list_item = NULL;
             cpmcart_enabled = 0;
-            z80_started = 0;
+            cpmcart_z80_started = 0;
         }
     }
     return 0;
@@ -266,7 +267,7 @@ void cpmcart_clock_stretch(void)
 /* ------------------------------------------------------------------------- */
 
 #define Z80_SET_DMA_REQUEST(x)
-#define Z80_LOOP_COND z80_started
+#define Z80_LOOP_COND cpmcart_z80_started
 
 
 #include "z80core.c"
@@ -278,7 +279,7 @@ static void cpmcart_mainloop(interrupt_cpu_status_t *cpu_int_status, alarm_conte
 
 void cpmcart_check_and_run_z80(void)
 {
-    if (z80_started) {
+    if (cpmcart_z80_started) {
         cpmcart_mainloop(maincpu_int_status, maincpu_alarm_context);
     }
 }
@@ -364,7 +365,7 @@ int cpmcart_snapshot_write_module(snapshot_t *s)
         || SMW_B(m, reg_f2) < 0
         || SMW_B(m, reg_h2) < 0
         || SMW_B(m, reg_l2) < 0
-        || SMW_B(m, (uint8_t)z80_started) < 0
+        || SMW_B(m, (uint8_t)cpmcart_z80_started) < 0
         || SMW_DW(m, (uint32_t)z80_last_opcode_info) < 0
         || SMW_DW(m, (uint32_t)z80_last_opcode_addr) < 0) {
         snapshot_module_close(m);
@@ -424,7 +425,7 @@ int cpmcart_snapshot_read_module(snapshot_t *s)
         || SMR_B(m, &reg_f2) < 0
         || SMR_B(m, &reg_h2) < 0
         || SMR_B(m, &reg_l2) < 0
-        || SMR_B_INT(m, &z80_started) < 0
+        || SMR_B_INT(m, &cpmcart_z80_started) < 0
         || SMR_DW_UINT(m, &z80_last_opcode_info) < 0
         || SMR_DW_UINT(m, &z80_last_opcode_addr) < 0) {
         goto fail;
@@ -48,6 +48,9 @@ int cpmcart_cart_enabled(void);
 void cpmcart_clock_stretch(void);
 #endif
 
+/* Flag: the Z80 is running instead of the 6510 */
+extern int cpmcart_z80_started;
+
 void cpmcart_check_and_run_z80(void);
 
 typedef int cpmcart_ba_check_callback_t (void);
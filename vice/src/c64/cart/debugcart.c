@@ -34,6 +34,7 @@
 #include "resources.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "testrunner.h"
 #include "archdep.h"
 
 #include "debugcart.h"
@@ -75,7 +76,7 @@ static void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
-    archdep_vice_exit(n);
+    testrunner_exit(n);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -107,7 +107,7 @@ int digimax_cart_enabled(void)
 static void digimax_sound_store(uint16_t addr, uint8_t value)
 {
     digimax_sound_data[addr] = value;
-    sound_store((uint16_t)(digimax_sound_chip_offset | addr), value, 0);
+    digimax_dac_store(addr, value);
 }
 
 static uint8_t digimax_sound_read(uint16_t addr)
@@ -104,6 +104,12 @@ static uint8_t easyflash_ram[CART_RAM_SIZE];
 static char *easyflash_filename = NULL;
 static int easyflash_filetype = 0;
 
+/* file offsets of the ROML (0) and ROMH (1) data of each bank in the attached
+   file, -1 if the file has no chip for it. Used to write back only the 8 KiB
+   blocks the flash state machines marked dirty. */
+static long easyflash_file_offset[2][EASYFLASH_N_BANKS];
+static int easyflash_file_offset_valid = 0;
+
 static const char STRING_EASYFLASH[] = CARTRIDGE_NAME_EASYFLASH;
 
 static const unsigned char eapiam29f040[768] = {
@@ -506,7 +512,10 @@ void easyflash_config_setup(uint8_t *rawcart)
         }
         eapi[k] = 0;
         log_message(LOG_DEFAULT, "EF: EAPI found (%s)", eapi);
-        memcpy(romh_banks + 0x1800, eapiam29f040, 768);
+        if (memcmp(romh_banks + 0x1800, eapiam29f040, 768) != 0) {
+            memcpy(romh_banks + 0x1800, eapiam29f040, 768);
+            flash040core_set_dirty(easyflash_state_high, 0x1800, 768);
+        }
     } else {
         log_warning(LOG_DEFAULT, "EF: EAPI not found! Are you sure this is a proper EasyFlash image?");
     }
@@ -530,12 +539,30 @@ static int easyflash_common_attach(const char *filename)
 
 int easyflash_bin_attach(const char *filename, uint8_t *rawcart)
 {
+    FILE *fd;
+    long start = 0;
+    int i;
+
     easyflash_filetype = 0;
 
     if (util_file_load(filename, rawcart, 0x4000 * EASYFLASH_N_BANKS, UTIL_FILE_LOAD_SKIP_ADDRESS) < 0) {
         return -1;
     }
 
+    /* util_file_load() skipped a load address if there is one */
+    fd = fopen(filename, MODE_READ);
+    if (fd != NULL) {
+        if (archdep_file_size(fd) & 2) {
+            start = 2;
+        }
+        fclose(fd);
+    }
+    for (i = 0; i < EASYFLASH_N_BANKS; i++) {
+        easyflash_file_offset[0][i] = start + i * 0x4000;
+        easyflash_file_offset[1][i] = start + i * 0x4000 + 0x2000;
+    }
+    easyflash_file_offset_valid = 1;
+
     easyflash_filetype = CARTRIDGE_FILETYPE_BIN;
     return easyflash_common_attach(filename);
 }
@@ -544,13 +571,22 @@ int easyflash_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
 {
     crt_chip_header_t chip;
 
+    long offset;
+    int i;
+
     easyflash_filetype = 0;
     memset(rawcart, 0xff, 0x100000); /* empty flash */
 
+    for (i = 0; i < EASYFLASH_N_BANKS; i++) {
+        easyflash_file_offset[0][i] = -1;
+        easyflash_file_offset[1][i] = -1;
+    }
+
     while (1) {
         if (crt_read_chip_header(&chip, fd)) {
             break;
         }
+        offset = ftell(fd);
 
         if (chip.size == 0x2000) {
             if (chip.bank >= EASYFLASH_N_BANKS || !(chip.start == 0x8000 || chip.start == 0xa000 || chip.start == 0xe000)) {
@@ -559,6 +595,7 @@ int easyflash_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
             if (crt_read_chip(rawcart, (chip.bank << 14) | (chip.start & 0x2000), &chip, fd)) {
                 return -1;
             }
+            easyflash_file_offset[(chip.start & 0x2000) ? 1 : 0][chip.bank] = offset;
         } else if (chip.size == 0x4000) {
             if (chip.bank >= EASYFLASH_N_BANKS || chip.start != 0x8000) {
                 return -1;
@@ -566,10 +603,13 @@ int easyflash_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
             if (crt_read_chip(rawcart, chip.bank << 14, &chip, fd)) {
                 return -1;
             }
+            easyflash_file_offset[0][chip.bank] = offset;
+            easyflash_file_offset[1][chip.bank] = offset + 0x2000;
         } else {
             return -1;
         }
     }
+    easyflash_file_offset_valid = 1;
 
     easyflash_filetype = CARTRIDGE_FILETYPE_CRT;
     return easyflash_common_attach(filename);
@@ -586,6 +626,7 @@ void easyflash_detach(void)
     lib_free(easyflash_state_high);
     lib_free(easyflash_filename);
     easyflash_filename = NULL;
+    easyflash_file_offset_valid = 0;
     io_source_unregister(easyflash_io1_list_item);
     io_source_unregister(easyflash_io2_list_item);
     easyflash_io1_list_item = NULL;
@@ -593,15 +634,101 @@ void easyflash_detach(void)
     export_remove(&export_res);
 }
 
+/* Write the dirty 8 KiB blocks into the attached file in place. Blocks the
+   CRT file has no chip for are appended as new chips, unless they are empty
+   and the CRT is to be optimized. Returns -1 if the file has to be rewritten
+   as a whole instead, the blocks stay dirty then. */
+static int easyflash_update_image(void)
+{
+    flash040_context_t *state[2];
+    crt_chip_header_t chip;
+    uint8_t *data;
+    FILE *fd;
+    long end;
+    int bank;
+    int half;
+
+    if (!easyflash_file_offset_valid) {
+        return -1;
+    }
+
+    state[0] = easyflash_state_low;
+    state[1] = easyflash_state_high;
+
+    fd = NULL;
+    for (bank = 0; bank < EASYFLASH_N_BANKS; bank++) {
+        for (half = 0; half < 2; half++) {
+            if (!flash040core_is_dirty(state[half], bank * 0x2000)) {
+                continue;
+            }
+            data = state[half]->flash_data + bank * 0x2000;
+
+            if (fd == NULL) {
+                fd = fopen(easyflash_filename, MODE_READ_WRITE);
+                if (fd == NULL) {
+                    return -1;
+                }
+            }
+
+            if (easyflash_file_offset[half][bank] >= 0) {
+                if (fseek(fd, easyflash_file_offset[half][bank], SEEK_SET) != 0
+                    || fwrite(data, 1, 0x2000, fd) != 0x2000) {
+                    fclose(fd);
+                    return -1;
+                }
+                continue;
+            }
+
+            if (easyflash_filetype != CARTRIDGE_FILETYPE_CRT) {
+                fclose(fd);
+                return -1;
+            }
+            chip.type = 2;
+            chip.size = 0x2000;
+            chip.bank = bank;
+            chip.start = half ? 0xa000 : 0x8000;
+            if (fseek(fd, 0, SEEK_END) != 0) {
+                fclose(fd);
+                return -1;
+            }
+            end = ftell(fd);
+            if (easyflash_write_chip_if_not_empty(fd, &chip, data) != 0) {
+                fclose(fd);
+                return -1;
+            }
+            if (ftell(fd) != end) {
+                easyflash_file_offset[half][bank] = ftell(fd) - 0x2000;
+            }
+        }
+    }
+
+    if (fd != NULL && fclose(fd) != 0) {
+        return -1;
+    }
+
+    flash040core_clear_dirty(easyflash_state_low);
+    flash040core_clear_dirty(easyflash_state_high);
+    return 0;
+}
+
 int easyflash_flush_image(void)
 {
+    int res;
+
     if (easyflash_filename != NULL) {
+        if (easyflash_update_image() == 0) {
+            return 0;
+        }
         if (easyflash_filetype == CARTRIDGE_FILETYPE_BIN) {
-            return easyflash_bin_save(easyflash_filename);
+            res = easyflash_bin_save(easyflash_filename);
         } else if (easyflash_filetype == CARTRIDGE_FILETYPE_CRT) {
-            return easyflash_crt_save(easyflash_filename);
+            res = easyflash_crt_save(easyflash_filename);
+        } else {
+            return -1;
         }
-        return -1;
+        /* the layout of the rewritten file is not known */
+        easyflash_file_offset_valid = 0;
+        return res;
     }
     return -2;
 }
@@ -750,6 +877,7 @@ int easyflash_snapshot_read_module(snapshot_t *s)
         || (SMR_BA(m, romh_banks, 0x80000) < 0)) {
         goto fail;
     }
+    easyflash_file_offset_valid = 0;
 
     snapshot_module_close(m);
 
@@ -108,6 +108,12 @@ static uint8_t georam[2];
 static uint8_t *georam_ram = NULL;
 static int old_georam_ram_size = 0;
 
+/* Page write stamps of georam_ram, for memory snapshots.  */
+static uint32_t *georam_ram_pages = NULL;
+
+/* Mapping of the GEORAM image, if georam_ram is the mapped file.  */
+static archdep_file_map_t *georam_map = NULL;
+
 static log_t georam_log = LOG_DEFAULT;
 
 static int georam_activate(void);
@@ -127,6 +133,8 @@ static char *georam_filename = NULL;
 
 static int georam_write_image = 0;
 
+static int georam_map_image = 0;
+
 /* Flag: swap io1/io2, currently only used for vic20 masC=uerade,
          but future usage of an io-swapper is possible */
 static int georam_io_swap = 0;
@@ -199,6 +207,7 @@ static uint8_t georam_io1_read(uint16_t addr)
 static void georam_io1_store(uint16_t addr, uint8_t byte)
 {
     georam_ram[(georam[1] * 16384) + (georam[0] * 256) + addr] = byte;
+    SNAPSHOT_PAGE_TOUCH(georam_ram_pages, (georam[1] * 16384) + (georam[0] * 256) + addr);
 }
 
 static uint8_t georam_io2_peek(uint16_t addr)
@@ -255,6 +264,7 @@ void georam_powerup(void)
     }
     if (georam_ram) {
         ram_init_with_pattern(georam_ram, georam_size, &ramparam);
+        snapshot_pages_touch_all(georam_ram_pages, georam_size);
     }
 }
 
@@ -264,7 +274,27 @@ static int georam_activate(void)
         return 0;
     }
 
-    georam_ram = lib_realloc((void *)georam_ram, (size_t)georam_size);
+    /* map the image file if it exists with the right size, a writable image
+       is mapped shared so changes go straight to the file */
+    if (georam_map_image && !util_check_null_string(georam_filename)) {
+        georam_map = archdep_file_map(georam_filename, (size_t)georam_size, georam_write_image);
+        if (georam_map != NULL) {
+            archdep_large_free(georam_ram);
+            georam_ram = archdep_file_map_data(georam_map);
+            georam_ram_pages = snapshot_pages_realloc(georam_ram_pages, georam_size);
+            snapshot_pages_touch_all(georam_ram_pages, georam_size);
+            old_georam_ram_size = georam_size;
+
+            log_message(georam_log, "%dKiB unit installed.", georam_size >> 10);
+            log_message(georam_log, "Mapping GEORAM image %s.", georam_filename);
+
+            georam_reset();
+            return 0;
+        }
+    }
+
+    georam_ram = archdep_large_realloc(georam_ram, (size_t)georam_size);
+    georam_ram_pages = snapshot_pages_realloc(georam_ram_pages, georam_size);
 
     /* Clear newly allocated RAM.  */
     if (georam_size > old_georam_ram_size) {
@@ -309,8 +339,15 @@ static int georam_deactivate(void)
         }
     }
 
-    lib_free(georam_ram);
+    if (georam_map != NULL) {
+        archdep_file_map_close(georam_map);
+        georam_map = NULL;
+    } else {
+        archdep_large_free(georam_ram);
+    }
     georam_ram = NULL;
+    lib_free(georam_ram_pages);
+    georam_ram_pages = NULL;
     old_georam_ram_size = 0;
 
     return 0;
@@ -435,6 +472,29 @@ static int set_georam_image_write(int val, void *param)
 {
     georam_write_image = val ? 1 : 0;
 
+    /* a mapped image has to be remapped shared or copy-on-write */
+    if (georam_map != NULL) {
+        georam_deactivate();
+        georam_activate();
+    }
+
+    return 0;
+}
+
+static int set_georam_image_map(int val, void *param)
+{
+    if (georam_map_image == (val ? 1 : 0)) {
+        return 0;
+    }
+
+    if (georam_enabled) {
+        georam_deactivate();
+        georam_map_image = val ? 1 : 0;
+        georam_activate();
+    } else {
+        georam_map_image = val ? 1 : 0;
+    }
+
     return 0;
 }
 
@@ -449,6 +509,8 @@ static const resource_int_t resources_int[] = {
       &georam_size_kb, set_georam_size, NULL },
     { "GEORAMImageWrite", 0, RES_EVENT_NO, NULL,
       &georam_write_image, set_georam_image_write, NULL },
+    { "GEORAMImageMap", 0, RES_EVENT_NO, NULL,
+      &georam_map_image, set_georam_image_map, NULL },
     /* CAUTION: the order matters here, enable must happen last */
     { "GEORAM", 0, RES_EVENT_STRICT, (resource_value_t)0,
       &georam_enabled, set_georam_enabled, NULL },
@@ -504,6 +566,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+georamimagerw", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "GEORAMImageWrite", (resource_value_t)0,
       NULL, "Do not write to GEORAM image" },
+    { "-georamimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "GEORAMImageMap", (resource_value_t)1,
+      NULL, "Map the GEORAM image file into memory instead of loading it" },
+    { "+georamimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "GEORAMImageMap", (resource_value_t)0,
+      NULL, "Load the GEORAM image file into memory" },
     CMDLINE_LIST_END
 };
 
@@ -571,6 +639,7 @@ void georam_config_setup(uint8_t *rawcart)
 {
     if (georam_size > 0) {
         memcpy(georam_ram, rawcart, georam_size);
+        snapshot_pages_touch_all(georam_ram_pages, georam_size);
     }
 }
 
@@ -607,6 +676,9 @@ int georam_bin_attach(const char *filename, uint8_t *rawcart)
 
 int georam_bin_save(const char *filename)
 {
+    uint8_t *buffer;
+    int res;
+
     if (georam_ram == NULL) {
         return -1;
     }
@@ -615,6 +687,19 @@ int georam_bin_save(const char *filename)
         return -1;
     }
 
+    if (georam_map != NULL && strcmp(filename, georam_filename) == 0) {
+        /* a shared mapping is the file already, a copy-on-write one must
+           not be read while its file is being rewritten */
+        if (georam_write_image) {
+            return archdep_file_map_sync(georam_map);
+        }
+        buffer = lib_malloc((size_t)georam_size);
+        memcpy(buffer, georam_ram, (size_t)georam_size);
+        res = util_file_save(filename, buffer, georam_size);
+        lib_free(buffer);
+        return res < 0 ? -1 : 0;
+    }
+
     if (util_file_save(filename, georam_ram, georam_size) < 0) {
         return -1;
     }
@@ -657,11 +742,16 @@ int georam_write_snapshot_module(snapshot_t *s)
         || SMW_B(m, (uint8_t)georam_io_swap) < 0
         || SMW_DW(m, (georam_size >> 10)) < 0
         || SMW_BA(m, georam, sizeof(georam)) < 0
-        || SMW_BA(m, georam_ram, georam_size) < 0) {
+        || SMW_BAP(m, georam_ram, georam_size, georam_ram_pages) < 0) {
         snapshot_module_close(m);
         return -1;
     }
 
+    /* keep a shared image file consistent with the snapshot */
+    if (georam_map != NULL && archdep_file_map_sync(georam_map) < 0) {
+        log_message(georam_log, "Writing GEORAM image %s failed.", georam_filename);
+    }
+
     return snapshot_module_close(m);
 }
 
@@ -711,6 +801,7 @@ int georam_read_snapshot_module(snapshot_t *s)
     if (SMR_BA(m, georam, sizeof(georam)) < 0 || SMR_BA(m, georam_ram, georam_size) < 0) {
         goto fail;
     }
+    snapshot_pages_touch_all(georam_ram_pages, georam_size);
 
     snapshot_module_close(m);
     georam_enabled = 1;
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "archdep.h"
 #define CARTRIDGE_INCLUDE_SLOT0_API
 #include "c64cartsystem.h"
 #undef CARTRIDGE_INCLUDE_SLOT0_API
@@ -117,6 +118,7 @@ extern unsigned int reg_pc;
 /* resources */
 static int rl_enabled = 0;
 static int rl_write_image = 0;
+static int rl_map_image = 0;
 static int rl_cardsizemb = 0;
 static int rl_normal = 1; /* either 1=normal, 0=direct */
 static int rl_rtcsave = 0;
@@ -141,6 +143,7 @@ static i8255a_state rl_i8255a;
 static uint8_t rl_i8255a_i[3];
 static uint8_t rl_i8255a_o[3];
 static uint8_t *rl_card = NULL;
+static archdep_file_map_t *rl_card_map = NULL; /* mapping of the image, if rl_card is the mapped file */
 static uint32_t rl_cardsize = 0;
 static uint32_t rl_cardsize_old = 0;
 static uint32_t rl_scanned = 0;
@@ -735,6 +738,9 @@ static void ramlink_unregisterio(void)
 
 int ramlink_ram_save(const char *filename)
 {
+    uint8_t *buffer;
+    int res;
+
     if (rl_card == NULL) {
         return -1;
     }
@@ -743,6 +749,26 @@ int ramlink_ram_save(const char *filename)
         return -1;
     }
 
+    if (rl_card_map != NULL && strcmp(filename, rl_filename) == 0) {
+        /* a shared mapping is the file already, a copy-on-write one must
+           not be read while its file is being rewritten */
+        LOG1((LOG, "RAMLINK: Writing RAMLINK memory image %s.", filename));
+        if (rl_write_image) {
+            res = archdep_file_map_sync(rl_card_map);
+        } else {
+            buffer = lib_malloc(rl_cardsize);
+            memcpy(buffer, rl_card, rl_cardsize);
+            res = util_file_save(filename, buffer, rl_cardsize);
+            lib_free(buffer);
+        }
+        if (res < 0) {
+            CRIT((LOG, "RAMLINK: Writing RAMLINK memory image %s failed.",
+                filename));
+            return -1;
+        }
+        return 0;
+    }
+
     if (!util_check_null_string(filename)) {
         LOG1((LOG, "RAMLINK: Writing RAMLINK memory image %s.", filename));
         if (util_file_save(filename, rl_card, rl_cardsize) < 0) {
@@ -850,7 +876,21 @@ static int ramlink_activate(void)
         return 0;
     }
 
-    rl_card = lib_realloc(rl_card, rl_cardsize);
+    /* map the image file if it exists with the right size, a writable image
+       is mapped shared so changes go straight to the file */
+    if (rl_map_image && !util_check_null_string(rl_filename)) {
+        rl_card_map = archdep_file_map(rl_filename, rl_cardsize, rl_write_image);
+        if (rl_card_map != NULL) {
+            archdep_large_free(rl_card);
+            rl_card = archdep_file_map_data(rl_card_map);
+            rl_cardsize_old = rl_cardsize;
+            LOG1((LOG, "RAMLINK: %dMiB unit installed.", rl_cardsizemb));
+            LOG1((LOG, "RAMLINK: Mapping RAMLINK memory image %s.", rl_filename));
+            return 0;
+        }
+    }
+
+    rl_card = archdep_large_realloc(rl_card, rl_cardsize);
 
     /* Clear newly allocated RAM.  */
     if (rl_cardsize > rl_cardsize_old) {
@@ -881,7 +921,12 @@ static int ramlink_deactivate(void)
 
     res = ramlink_save_ram_image();
 
-    lib_free(rl_card);
+    if (rl_card_map != NULL) {
+        archdep_file_map_close(rl_card_map);
+        rl_card_map = NULL;
+    } else {
+        archdep_large_free(rl_card);
+    }
     rl_card = NULL;
 
     return res;
@@ -1051,6 +1096,30 @@ static int set_image_write(int val, void *param)
 {
     rl_write_image = val ? 1 : 0;
 
+    /* a mapped image has to be remapped shared or copy-on-write */
+    if (rl_card_map != NULL) {
+        ramlink_deactivate();
+        ramlink_activate();
+    }
+
+    return 0;
+}
+
+static int set_image_map(int val, void *param)
+{
+    if (rl_map_image == (val ? 1 : 0)) {
+        return 0;
+    }
+
+    if (rl_enabled) {
+        ramlink_deactivate();
+    }
+    rl_map_image = val ? 1 : 0;
+
+    if (rl_enabled) {
+        ramlink_activate();
+    }
+
     return 0;
 }
 
@@ -1117,6 +1186,8 @@ static const resource_string_t resources_string[] = {
 static const resource_int_t resources_int[] = {
     { "RAMLINKImageWrite", 0, RES_EVENT_NO, NULL,
       &rl_write_image, set_image_write, NULL },
+    { "RAMLINKImageMap", 0, RES_EVENT_NO, NULL,
+      &rl_map_image, set_image_map, NULL },
     { "RAMLINKsize", 16, RES_EVENT_NO, NULL,
       &rl_cardsizemb, set_size, 0 },
     { "RAMLINKmode", RL_MODE_NORMAL, RES_EVENT_NO, NULL,
@@ -1161,6 +1232,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+ramlinkimagerw", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "RAMLINKImageWrite", (resource_value_t)0,
       NULL, "Do not write to " CARTRIDGE_NAME_RAMLINK " image" },
+    { "-ramlinkimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "RAMLINKImageMap", (resource_value_t)1,
+      NULL, "Map the " CARTRIDGE_NAME_RAMLINK " image file into memory instead of loading it" },
+    { "+ramlinkimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "RAMLINKImageMap", (resource_value_t)0,
+      NULL, "Load the " CARTRIDGE_NAME_RAMLINK " image file into memory" },
     CMDLINE_LIST_END
 };
 
@@ -1211,9 +1288,13 @@ int ramlink_resources_shutdown(void)
         rl_bios_filename = NULL;
     }
 
-    if (rl_card) {
-        lib_free(rl_card);
+    if (rl_card_map != NULL) {
+        archdep_file_map_close(rl_card_map);
+        rl_card_map = NULL;
+    } else {
+        archdep_large_free(rl_card);
     }
+    rl_card = NULL;
 
     if (rl_ram) {
         lib_free(rl_ram);
@@ -2172,6 +2253,11 @@ int ramlink_snapshot_write_module(snapshot_t *s)
         goto fail;
     }
 
+    /* keep a shared image file consistent with the snapshot */
+    if (rl_card_map != NULL && archdep_file_map_sync(rl_card_map) < 0) {
+        CRIT((LOG, "RAMLINK: Writing RAMLINK memory image %s failed.", rl_filename));
+    }
+
     snapshot_module_close(m);
 
     return 0;
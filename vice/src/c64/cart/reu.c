@@ -232,6 +232,10 @@ static uint8_t *reu_ram = NULL;
 /*! \brief the old ram size of reu_ram. Used to determine if and how much of the
     buffer has to cleared when resizing the REU. */
 static unsigned int old_reu_ram_size = 0;
+/*! \brief page write stamps of reu_ram, for memory snapshots */
+static uint32_t *reu_ram_pages = NULL;
+/*! \brief mapping of the REU image, if reu_ram is the mapped file */
+static archdep_file_map_t *reu_map = NULL;
 
 static log_t reu_log = LOG_DEFAULT; /*!< the log output for the REU */
 
@@ -256,8 +260,13 @@ static struct reu_ba_s reu_ba = {
     NULL, NULL, NULL, 0, 0, 0, 0
 };
 
+/*! \brief function giving direct access to plain RAM pages of the host, used for x64 */
+static reu_dma_ram_callback_t *reu_dma_ram = NULL;
+
 static int reu_write_image = 0;
 
+static int reu_map_image = 0;
+
 static int floating_bus_value = 0xff;
 
 /* ------------------------------------------------------------------------- */
@@ -482,6 +491,30 @@ static int set_reu_image_write(int val, void *param)
 {
     reu_write_image = val ? 1 : 0;
 
+    /* a mapped image has to be remapped shared or copy-on-write */
+    if (reu_map != NULL) {
+        reu_deactivate();
+        reu_activate();
+    }
+
+    return 0;
+}
+
+static int set_reu_image_map(int val, void *param)
+{
+    if (reu_map_image == (val ? 1 : 0)) {
+        return 0;
+    }
+
+    if (reu_enabled) {
+        reu_deactivate();
+    }
+    reu_map_image = val ? 1 : 0;
+
+    if (reu_enabled) {
+        reu_activate();
+    }
+
     return 0;
 }
 
@@ -496,6 +529,8 @@ static const resource_string_t resources_string[] = {
 static const resource_int_t resources_int[] = {
     { "REUImageWrite", 0, RES_EVENT_NO, NULL,
       &reu_write_image, set_reu_image_write, NULL },
+    { "REUImageMap", 0, RES_EVENT_NO, NULL,
+      &reu_map_image, set_reu_image_map, NULL },
     { "REUsize", 512, RES_EVENT_NO, NULL,
       &reu_size_kb, set_reu_size, NULL },
     /* keeping "enable" resource last prevents unnecessary (re)init when loading config file */
@@ -549,6 +584,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+reuimagerw", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "REUImageWrite", (resource_value_t)0,
       NULL, "Do not write to REU image" },
+    { "-reuimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "REUImageMap", (resource_value_t)1,
+      NULL, "Map the REU image file into memory instead of loading it" },
+    { "+reuimagemap", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "REUImageMap", (resource_value_t)0,
+      NULL, "Load the REU image file into memory" },
     CMDLINE_LIST_END
 };
 
@@ -583,6 +624,7 @@ void reu_config_setup(uint8_t *rawcart)
 {
     if (reu_size > 0) {
         memcpy(reu_ram, rawcart, reu_size); /* FIXME */
+        snapshot_pages_touch_all(reu_ram_pages, reu_size);
     }
 }
 
@@ -598,6 +640,18 @@ void reu_ba_register(reu_ba_check_callback_t *ba_check,
     reu_ba.enabled = 1;
 }
 
+/*! \brief register the direct RAM access interface
+
+  \param dma_ram
+    Function returning the base of the host RAM if the page of the given
+    address is plain RAM for reading (write = 0) or writing (write != 0),
+    or NULL if the access has to go through mem_dma_read()/mem_dma_store().
+*/
+void reu_dma_ram_register(reu_dma_ram_callback_t *dma_ram)
+{
+    reu_dma_ram = dma_ram;
+}
+
 /*! \brief reset the REU */
 void reu_reset(void)
 {
@@ -661,6 +715,7 @@ static void reu_init_ram(void)
                 invertblock(0x02ac00 + ((i + b) << 16), 0x2a00);
             }
         }
+        snapshot_pages_touch_all(reu_ram_pages, reu_size);
     }
 }
 
@@ -681,7 +736,27 @@ static int reu_activate(void)
         return 0;
     }
 
-    reu_ram = lib_realloc(reu_ram, reu_size);
+    /* map the image file if it exists with the right size, a writable image
+       is mapped shared so changes go straight to the file */
+    if (reu_map_image && !util_check_null_string(reu_filename)) {
+        reu_map = archdep_file_map(reu_filename, reu_size, reu_write_image);
+        if (reu_map != NULL) {
+            archdep_large_free(reu_ram);
+            reu_ram = archdep_file_map_data(reu_map);
+            reu_ram_pages = snapshot_pages_realloc(reu_ram_pages, reu_size);
+            snapshot_pages_touch_all(reu_ram_pages, reu_size);
+            old_reu_ram_size = reu_size;
+
+            log_message(reu_log, "%uKiB unit installed.", reu_size >> 10);
+            log_message(reu_log, "Mapping REU image %s.", reu_filename);
+
+            reu_reset();
+            return 0;
+        }
+    }
+
+    reu_ram = archdep_large_realloc(reu_ram, reu_size);
+    reu_ram_pages = snapshot_pages_realloc(reu_ram_pages, reu_size);
 
     /* Clear newly allocated RAM.  */
     reu_init_ram();
@@ -725,8 +800,15 @@ static int reu_deactivate(void)
         }
     }
 
-    lib_free(reu_ram);
+    if (reu_map != NULL) {
+        archdep_file_map_close(reu_map);
+        reu_map = NULL;
+    } else {
+        archdep_large_free(reu_ram);
+    }
     reu_ram = NULL;
+    lib_free(reu_ram_pages);
+    reu_ram_pages = NULL;
     old_reu_ram_size = 0;
 
     return 0;
@@ -786,6 +868,9 @@ int reu_bin_attach(const char *filename, uint8_t *rawcart)
 
 int reu_bin_save(const char *filename)
 {
+    uint8_t *buffer;
+    int res;
+
     if (reu_ram == NULL) {
         return -1;
     }
@@ -794,6 +879,19 @@ int reu_bin_save(const char *filename)
         return -1;
     }
 
+    if (reu_map != NULL && strcmp(filename, reu_filename) == 0) {
+        /* a shared mapping is the file already, a copy-on-write one must
+           not be read while its file is being rewritten */
+        if (reu_write_image) {
+            return archdep_file_map_sync(reu_map);
+        }
+        buffer = lib_malloc(reu_size);
+        memcpy(buffer, reu_ram, reu_size);
+        res = util_file_save(filename, buffer, reu_size);
+        lib_free(buffer);
+        return res < 0 ? -1 : 0;
+    }
+
     if (util_file_save(filename, reu_ram, reu_size) < 0) {
         return -1;
     }
@@ -1113,6 +1211,7 @@ inline static void store_to_reu(unsigned int reu_addr, uint8_t value)
     if (reu_addr < rec_options.not_backedup_addresses) {
         assert(reu_addr < reu_size);
         reu_ram[reu_addr] = value;
+        SNAPSHOT_PAGE_TOUCH(reu_ram_pages, reu_addr);
     } else {
         DEBUG_LOG(DEBUG_LEVEL_NO_DRAM, (reu_log, "--> writing to REU address %05X, but no DRAM!", reu_addr));
     }
@@ -1223,6 +1322,151 @@ static void reu_dma_update_regs(uint16_t host_addr, unsigned int reu_addr, int l
     }
 }
 
+/*! \brief get the number of bytes a DMA operation can transfer in one block
+
+  On x64, a run of bytes where the host side is plain RAM, the REU side is
+  backed by DRAM and no alarm falls due can be transferred without going
+  through the memory access functions byte by byte.
+
+  \param host_addr
+    The host (computer) address where the run starts
+
+  \param reu_addr
+    The REU address where the run starts
+
+  \param host_step
+    The increment to use for the host address; must be either 0 or 1
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param len
+    The remaining transfer length of the operation
+
+  \param host_write
+    If 0, the host is read. If 1, the host is written. If 2, both.
+
+  \param cycles
+    The number of cycles per byte
+
+  \return
+    The number of bytes that can be transferred in one block, or 0 if the
+    next byte has to take the slow path
+*/
+static int reu_dma_block_len(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len,
+                             int host_write, unsigned int cycles)
+{
+#ifdef REU_DEBUG
+    return 0;
+#else
+    CLOCK next_alarm;
+    unsigned int n;
+    unsigned int page;
+    unsigned int offset;
+    unsigned int dram_addr;
+
+    if (reu_ba.enabled || reu_dma_ram == NULL) {
+        return 0;
+    }
+
+    /* stop before the first byte that would see an alarm */
+    next_alarm = alarm_context_next_pending_clk(maincpu_alarm_context);
+    if (next_alarm <= maincpu_clk + cycles) {
+        return 0;
+    }
+    n = (unsigned int)len;
+    if ((next_alarm - maincpu_clk - 1) / cycles < n) {
+        n = (unsigned int)((next_alarm - maincpu_clk - 1) / cycles);
+    }
+
+    /* the host side has to be plain RAM, without wrapping at $ffff */
+    if (host_step) {
+        if (n > 0x10000 - (unsigned int)host_addr) {
+            n = 0x10000 - (unsigned int)host_addr;
+        }
+        offset = 0;
+        for (page = host_addr & 0xff00; page <= ((host_addr + n - 1) & 0xff00); page += 0x100) {
+            if ((host_write != 1 && reu_dma_ram((uint16_t)page, 0) == NULL)
+                || (host_write != 0 && reu_dma_ram((uint16_t)page, 1) == NULL)) {
+                break;
+            }
+            offset = page + 0x100 - host_addr;
+        }
+        if (offset < n) {
+            n = offset;
+        }
+    } else if ((host_write != 1 && reu_dma_ram(host_addr, 0) == NULL)
+               || (host_write != 0 && reu_dma_ram(host_addr, 1) == NULL)) {
+        return 0;
+    }
+
+    /* the REU side has to be backed by DRAM, without any wrap around */
+    if ((reu_addr & 0x0007ffff) >= rec_options.wrap_around) {
+        return 0;
+    }
+    dram_addr = reu_addr & (rec_options.dram_wrap_around - 1);
+    if (dram_addr >= rec_options.not_backedup_addresses) {
+        return 0;
+    }
+    if (reu_step) {
+        if (n > rec_options.wrap_around - (reu_addr & 0x0007ffff)) {
+            n = rec_options.wrap_around - (reu_addr & 0x0007ffff);
+        }
+        if (n > rec_options.dram_wrap_around - dram_addr) {
+            n = rec_options.dram_wrap_around - dram_addr;
+        }
+        if (n > rec_options.not_backedup_addresses - dram_addr) {
+            n = rec_options.not_backedup_addresses - dram_addr;
+        }
+    }
+
+    return (int)n;
+#endif
+}
+
+/*! \brief advance the addresses and the clock after a block transfer
+
+  \param host_addr
+    Pointer to the host address to advance
+
+  \param reu_addr
+    Pointer to the REU address to advance
+
+  \param host_step
+    The increment to use for the host address; must be either 0 or 1
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param n
+    The number of bytes transferred
+
+  \param reu_written
+    Non-zero if the REU RAM has been written
+
+  \param cycles
+    The number of cycles per byte
+*/
+static void reu_dma_block_done(uint16_t *host_addr, unsigned int *reu_addr, int host_step, int reu_step, int n,
+                               int reu_written, unsigned int cycles)
+{
+    unsigned int dram_addr = *reu_addr & (rec_options.dram_wrap_around - 1);
+    unsigned int page;
+
+    if (reu_written) {
+        for (page = dram_addr >> SNAPSHOT_PAGE_SHIFT;
+             page <= (dram_addr + (reu_step ? n - 1 : 0)) >> SNAPSHOT_PAGE_SHIFT; page++) {
+            reu_ram_pages[page] = snapshot_page_generation;
+        }
+    }
+    if (reu_step) {
+        /* reu_dma_block_len() made sure this does not carry out of the low 19 bits */
+        *reu_addr = increment_reu_with_wrap_around(*reu_addr + n - 1, 1);
+    }
+    *host_addr = (uint16_t)((*host_addr + host_step * n) & 0xffff);
+    maincpu_clk += (CLOCK)n * cycles;
+}
+
 /*! \brief DMA operation writing from the host to the REU
 
   \param host_addr
@@ -1243,6 +1487,9 @@ static void reu_dma_update_regs(uint16_t host_addr, unsigned int reu_addr, int l
 static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    uint8_t *host;
+    uint8_t *reu;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s<= main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1251,6 +1498,23 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block_len(host_addr, reu_addr, host_step, reu_step, len, 0, 1);
+        if (n > 0) {
+            host = reu_dma_ram(host_addr, 0) + host_addr;
+            reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+            value = host[host_step * (n - 1)];
+            if (host_step && reu_step) {
+                memcpy(reu, host, (size_t)n);
+            } else if (reu_step) {
+                memset(reu, value, (size_t)n);
+            } else {
+                *reu = value;
+            }
+            reu_dma_block_done(&host_addr, &reu_addr, host_step, reu_step, n, 1, 1);
+            len -= n;
+            continue;
+        }
+
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value = mem_dma_read(host_addr);
@@ -1288,6 +1552,9 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
 static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    uint8_t *host;
+    uint8_t *reu;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1296,6 +1563,23 @@ static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block_len(host_addr, reu_addr, host_step, reu_step, len, 1, 1);
+        if (n > 0) {
+            host = reu_dma_ram(host_addr, 1) + host_addr;
+            reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+            floating_bus_value = reu[reu_step * (n - 1)];
+            if (host_step && reu_step) {
+                memcpy(host, reu, (size_t)n);
+            } else if (host_step) {
+                memset(host, *reu, (size_t)n);
+            } else {
+                *host = (uint8_t)floating_bus_value;
+            }
+            reu_dma_block_done(&host_addr, &reu_addr, host_step, reu_step, n, 0, 1);
+            len -= n;
+            continue;
+        }
+
         DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring byte: %x from ext $%05X to main $%04X.", reu_ram[reu_addr % reu_size], reu_addr, host_addr));
         nonsc_reu_clk_inc_pre();
         /* after a transfer from REU to host, the last (pre)fetched value from valid
@@ -1342,6 +1626,10 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
 {
     uint8_t value_from_reu;
     uint8_t value_from_c64;
+    uint8_t *host;
+    uint8_t *reu;
+    int i;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "swap ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1350,6 +1638,22 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block_len(host_addr, reu_addr, host_step, reu_step, len, 2, 2);
+        if (n > 0) {
+            host = reu_dma_ram(host_addr, 1) + host_addr;
+            reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+            for (i = 0; i < n; i++) {
+                value_from_reu = *reu;
+                *reu = *host;
+                *host = value_from_reu;
+                host += host_step;
+                reu += reu_step;
+            }
+            reu_dma_block_done(&host_addr, &reu_addr, host_step, reu_step, n, 1, 2);
+            len -= n;
+            continue;
+        }
+
         value_from_reu = read_from_reu(reu_addr);
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
@@ -1397,6 +1701,11 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
 
     uint8_t new_status_or_mask = 0;
 
+    const uint8_t *host;
+    const uint8_t *reu;
+    int i;
+    int n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "compare ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1410,6 +1719,23 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
     /* rec.status &= ~ (REU_REG_R_STATUS_VERIFY_ERROR | REU_REG_R_STATUS_END_OF_BLOCK); */
 
     while (len) {
+        /* the bytes up to the first difference can be compared in one go,
+           the difference itself takes the slow path below */
+        n = reu_dma_block_len(host_addr, reu_addr, host_step, reu_step, len, 0, 1);
+        if (n > 0) {
+            host = reu_dma_ram(host_addr, 0) + host_addr;
+            reu = reu_ram + (reu_addr & (rec_options.dram_wrap_around - 1));
+            for (i = 0; i < n && *host == *reu; i++) {
+                host += host_step;
+                reu += reu_step;
+            }
+            if (i > 0) {
+                reu_dma_block_done(&host_addr, &reu_addr, host_step, reu_step, i, 0, 1);
+                len -= i;
+                continue;
+            }
+        }
+
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value_from_reu = read_from_reu(reu_addr);
@@ -1610,11 +1936,16 @@ int reu_write_snapshot_module(snapshot_t *s)
     if (0
         || SMW_DW(m, (reu_size >> 10)) < 0
         || SMW_BA(m, reu, sizeof(reu)) < 0
-        || SMW_BA(m, reu_ram, reu_size) < 0) {
+        || SMW_BAP(m, reu_ram, reu_size, reu_ram_pages) < 0) {
         snapshot_module_close(m);
         return -1;
     }
 
+    /* keep a shared image file consistent with the snapshot */
+    if (reu_map != NULL && archdep_file_map_sync(reu_map) < 0) {
+        log_error(reu_log, "Writing REU image %s failed.", reu_filename);
+    }
+
     return snapshot_module_close(m);
 }
 
@@ -1666,6 +1997,7 @@ int reu_read_snapshot_module(snapshot_t *s)
     if (SMR_BA(m, reu, sizeof(reu)) < 0 || SMR_BA(m, reu_ram, reu_size) < 0) {
         goto fail;
     }
+    snapshot_pages_touch_all(reu_ram_pages, reu_size);
 
     if (reu[REU_REG_R_STATUS] & 0x80) {
         interrupt_restore_irq(maincpu_int_status, reu_int_num, 1);
@@ -48,6 +48,10 @@ void reu_ba_register(reu_ba_check_callback_t *ba_check,
                      reu_ba_steal_callback_t *ba_steal,
                      int *ba_var, int ba_mask);
 
+typedef uint8_t *reu_dma_ram_callback_t (uint16_t addr, int write);
+
+void reu_dma_ram_register(reu_dma_ram_callback_t *dma_ram);
+
 void reu_reset(void);
 int reu_dma(int immed);
 void reu_dma_start(void);
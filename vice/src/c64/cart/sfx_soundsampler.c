@@ -325,7 +325,7 @@ static uint8_t sfx_soundsampler_sound_data;
 static void sfx_soundsampler_sound_store(uint16_t addr, uint8_t value)
 {
     sfx_soundsampler_sound_data = value;
-    sound_store(sfx_soundsampler_sound_chip_offset, value, 0);
+    sound_dac_store(&sfx_soundsampler_dac, sfx_soundsampler_sound_chip_offset, value, (int)value * 128);
 }
 
 struct sfx_soundsampler_sound_s {
@@ -40,6 +40,7 @@
 #include "machine.h"
 #include "mem.h"
 #include "monitor.h"
+#include "perfcounters.h"
 #include "r65c02.h"
 #include "resources.h"
 #include "snapshot.h"
@@ -102,15 +103,6 @@ static void turbomaster_generic_dma(void)
 #define DMA_FUNC turbomaster_generic_dma()
 #endif
 
-/* Information about the last executed opcode.  This is used to know the
-   number of write cycles in the last executed opcode and to delay interrupts
-   by one more cycle if necessary, as happens with conditional branch opcodes
-   when the branch is taken.  */
-unsigned int last_opcode_info;
-
-/* Address of the last executed opcode. This is used by watchpoints. */
-unsigned int last_opcode_addr;
-
 /* Return nonzero if a pending NMI should be dispatched now.  This takes
    account for the internal delays of the 65c02, but does not actually check
    the status of the NMI line.  */
@@ -882,7 +874,7 @@ void turbomaster_mainloop(interrupt_cpu_status_t *cpu_int_status, alarm_context_
     while (turbomaster_s1_cpu_started) {
 #define CLK maincpu_clk
 #define RMW_FLAG maincpu_rmw_flag
-#define LAST_OPCODE_ADDR last_opcode_addr
+#define LAST_OPCODE_ADDR (maincpu_state.last_opcode_addr)
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS cpu_int_status
@@ -0,0 +1,461 @@
+/** \file   vsid-batch.c
+ * \brief   Batch rendering of PSID files to sound files
+ *
+ * A batch is a list file naming PSID files, optionally with a subtune and a
+ * length in seconds per line:
+ *
+ * \verbatim
+ * # comment
+ * MUSICIANS/H/Hubbard_Rob/Commando.sid
+ * MUSICIANS/H/Hubbard_Rob/Monty_on_the_Run.sid 1 120
+ * \endverbatim
+ *
+ * A missing or zero subtune renders every subtune of the file. A missing
+ * length is looked up in the HVSC song length database and falls back to
+ * the -sidbatchseconds default.
+ *
+ * The emulator state is global, so the songs cannot be emulated side by side
+ * in one process. Instead the batch coordinator runs every song in a vsid
+ * worker process of its own, and keeps one worker per host core busy. The
+ * worker renders in offline mode: as fast as the host allows, without video
+ * and without dropping sound like warp mode does, and exits when the song
+ * has played for the requested time.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "hvsc.h"
+#include "lib.h"
+#include "log.h"
+#include "util.h"
+#include "vsync.h"
+
+#include "vsid-batch.h"
+
+
+/** \brief  Length of a song when neither the list nor the SLDB gives one */
+#define BATCH_SECONDS_DEFAULT   180
+
+/** \brief  Maximum length of a line in the batch list file */
+#define BATCH_LINE_MAX          4096
+
+/** \brief  A single song to render */
+typedef struct batch_job_s {
+    char *file;     /**< PSID file */
+    int tune;       /**< subtune, starting at 1 */
+    int seconds;    /**< length to render */
+    char *output;   /**< sound file to write */
+} batch_job_t;
+
+static log_t batch_log = LOG_DEFAULT;
+
+/* Batch coordinator settings */
+static char *batch_list = NULL;
+static char *batch_dir = NULL;
+static char *batch_format = NULL;
+static int batch_jobs = 0;
+static int batch_seconds = BATCH_SECONDS_DEFAULT;
+
+/* Worker: seconds to render before exiting, 0 when not a worker */
+static int worker_seconds = 0;
+
+static batch_job_t *jobs = NULL;
+static int jobs_num = 0;
+static int jobs_max = 0;
+
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_batch_list(const char *param, void *extra_param)
+{
+    return util_string_set(&batch_list, param);
+}
+
+static int cmdline_batch_dir(const char *param, void *extra_param)
+{
+    return util_string_set(&batch_dir, param);
+}
+
+static int cmdline_batch_format(const char *param, void *extra_param)
+{
+    if (strcmp(param, "wav") != 0 && strcmp(param, "flac") != 0) {
+        return -1;
+    }
+    return util_string_set(&batch_format, param);
+}
+
+static int cmdline_batch_jobs(const char *param, void *extra_param)
+{
+    batch_jobs = atoi(param);
+    if (batch_jobs < 0) {
+        batch_jobs = 0;
+    }
+    return 0;
+}
+
+static int cmdline_batch_seconds(const char *param, void *extra_param)
+{
+    batch_seconds = atoi(param);
+    if (batch_seconds <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int cmdline_batch_time(const char *param, void *extra_param)
+{
+    worker_seconds = atoi(param);
+    if (worker_seconds <= 0) {
+        worker_seconds = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-sidbatch", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_list, NULL, NULL, NULL,
+      "<Name>", "Render the songs listed in file <Name> to sound files and exit" },
+    { "-sidbatchdir", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_dir, NULL, NULL, NULL,
+      "<Path>", "Write the rendered sound files to directory <Path>" },
+    { "-sidbatchformat", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_format, NULL, NULL, NULL,
+      "<Type>", "Sound file format of rendered songs (wav, flac)" },
+    { "-sidbatchjobs", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_jobs, NULL, NULL, NULL,
+      "<number>", "Number of songs to render at the same time (0: one per core)" },
+    { "-sidbatchseconds", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_seconds, NULL, NULL, NULL,
+      "<seconds>", "Length of songs not listed with a length or in the song length database" },
+    { "-sidbatchtime", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch_time, NULL, NULL, NULL,
+      "<seconds>", "Play the tune for <seconds> as fast as possible without video, then exit" },
+    CMDLINE_LIST_END
+};
+
+/** \brief  Register the batch rendering command line options
+ *
+ * \return  0 on success, -1 on failure
+ */
+int vsid_batch_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Number of subtunes in a PSID file, 0 if the file is no PSID file.  */
+static int batch_get_tunes(const char *file)
+{
+    FILE *f;
+    uint8_t header[0x10];
+    int tunes = 0;
+
+    f = fopen(file, MODE_READ);
+    if (f == NULL) {
+        return 0;
+    }
+    if (fread(header, 1, sizeof header, f) == sizeof header
+        && (memcmp(header, "PSID", 4) == 0 || memcmp(header, "RSID", 4) == 0)) {
+        tunes = (header[0x0e] << 8) | header[0x0f];
+    }
+    fclose(f);
+
+    return tunes;
+}
+
+/* Output file for a song: the listed path with the directory separators
+   flattened, so songs of different directories keep apart.  */
+static char *batch_get_output(const char *file, int tune)
+{
+    char *name;
+    char *ext;
+    char *p;
+    char *output;
+
+    name = lib_strdup(file);
+    ext = strrchr(name, '.');
+    if (ext != NULL && util_strcasecmp(ext, ".sid") == 0) {
+        *ext = '\0';
+    }
+    for (p = name; *p != '\0'; p++) {
+        if (*p == '/' || *p == '\\' || *p == ':') {
+            *p = '_';
+        }
+    }
+    while (*name == '_' || *name == '.') {
+        memmove(name, name + 1, strlen(name));
+    }
+
+    output = lib_msprintf("%s" ARCHDEP_DIR_SEP_STR "%s-%d.%s",
+                          batch_dir != NULL ? batch_dir : ".", name, tune,
+                          batch_format != NULL ? batch_format : "wav");
+    lib_free(name);
+
+    return output;
+}
+
+static void batch_add_job(const char *file, int tune, int seconds)
+{
+    batch_job_t *job;
+
+    if (jobs_num == jobs_max) {
+        jobs_max = jobs_max ? jobs_max * 2 : 64;
+        jobs = lib_realloc(jobs, sizeof(batch_job_t) * (size_t)jobs_max);
+    }
+    job = &jobs[jobs_num++];
+    job->file = lib_strdup(file);
+    job->tune = tune;
+    job->seconds = seconds;
+    job->output = batch_get_output(file, tune);
+}
+
+static void batch_strip_right(char *line)
+{
+    char *end = line + strlen(line);
+
+    while (end > line && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+}
+
+/* Add the songs of one line of the list file.  */
+static void batch_add_line(char *line, int lineno)
+{
+    char *digits;
+    int numbers[2];
+    int count = 0;
+    int tune = 0;
+    int seconds = 0;
+    int tunes;
+    long *lengths = NULL;
+    int lengths_num;
+    int i;
+
+    batch_strip_right(line);
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (*line == '\0' || *line == '#') {
+        return;
+    }
+
+    /* file names may contain blanks, so the numbers are taken from the end */
+    while (count < 2) {
+        digits = line + strlen(line);
+        while (digits > line && isdigit((unsigned char)digits[-1])) {
+            digits--;
+        }
+        if (*digits == '\0' || digits == line || !isspace((unsigned char)digits[-1])) {
+            break;
+        }
+        numbers[count++] = atoi(digits);
+        *digits = '\0';
+        batch_strip_right(line);
+    }
+    if (count == 2) {
+        tune = numbers[1];
+        seconds = numbers[0];
+    } else if (count == 1) {
+        tune = numbers[0];
+    }
+
+    tunes = batch_get_tunes(line);
+    if (tunes == 0) {
+        log_error(batch_log, "line %d: `%s' is no PSID file.", lineno, line);
+        return;
+    }
+    if (tune > tunes) {
+        log_error(batch_log, "line %d: `%s' has no tune %d.", lineno, line, tune);
+        return;
+    }
+
+    lengths_num = seconds > 0 ? -1 : hvsc_sldb_get_lengths(line, &lengths);
+
+    for (i = 1; i <= tunes; i++) {
+        if (tune == 0 || tune == i) {
+            int length = seconds;
+
+            if (length == 0 && i <= lengths_num && lengths[i - 1] > 0) {
+                length = (int)lengths[i - 1];
+            }
+            batch_add_job(line, i, length > 0 ? length : batch_seconds);
+        }
+    }
+
+    if (lengths != NULL) {
+        lib_free(lengths);
+    }
+}
+
+static int batch_read_list(void)
+{
+    FILE *f;
+    char *line;
+    int lineno = 0;
+
+    f = fopen(batch_list, MODE_READ_TEXT);
+    if (f == NULL) {
+        log_error(batch_log, "Cannot open batch list `%s'.", batch_list);
+        return -1;
+    }
+
+    line = lib_malloc(BATCH_LINE_MAX);
+    while (fgets(line, BATCH_LINE_MAX, f) != NULL) {
+        batch_add_line(line, ++lineno);
+    }
+    lib_free(line);
+    fclose(f);
+
+    return 0;
+}
+
+/* Render one song in a worker process, return its exit status.  */
+static int batch_run_job(const batch_job_t *job)
+{
+    char *argv[16];
+    char *seconds = lib_msprintf("%d", job->seconds);
+    char *tune = lib_msprintf("%d", job->tune);
+    int argc = 0;
+    int status;
+
+    argv[argc++] = (char *)archdep_program_path();
+    argv[argc++] = "-console";
+    argv[argc++] = "-silent";
+    argv[argc++] = "-sound";
+    argv[argc++] = "-sounddev";
+    argv[argc++] = batch_format != NULL ? batch_format : "wav";
+    argv[argc++] = "-soundarg";
+    argv[argc++] = job->output;
+    argv[argc++] = "-sidbatchtime";
+    argv[argc++] = seconds;
+    argv[argc++] = "-tune";
+    argv[argc++] = tune;
+    argv[argc++] = job->file;
+    argv[argc] = NULL;
+
+    status = archdep_spawn(argv[0], argv, NULL, NULL);
+
+    lib_free(seconds);
+    lib_free(tune);
+
+    return status;
+}
+
+/* Render all listed songs and exit.  */
+static void batch_run(void)
+{
+    int failed = 0;
+    int i;
+
+    if (batch_read_list() < 0) {
+        archdep_vice_exit(EXIT_FAILURE);
+    }
+
+    log_message(batch_log, "Rendering %d songs to `%s'.",
+                jobs_num, batch_dir != NULL ? batch_dir : ".");
+
+#ifdef _OPENMP
+    if (batch_jobs > 0) {
+        omp_set_num_threads(batch_jobs);
+    }
+#endif
+
+#pragma omp parallel for schedule(dynamic) reduction(+:failed)
+    for (i = 0; i < jobs_num; i++) {
+        if (batch_run_job(&jobs[i]) != 0) {
+            log_error(batch_log, "Rendering tune %d of `%s' failed.",
+                      jobs[i].tune, jobs[i].file);
+            failed++;
+        }
+    }
+
+    log_message(batch_log, "Rendered %d of %d songs.", jobs_num - failed, jobs_num);
+
+    archdep_vice_exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/** \brief  Start the batch, or offline rendering of a batch worker
+ *
+ * Called at the end of the machine initialization. Running a batch does not
+ * return.
+ */
+void vsid_batch_init(void)
+{
+    batch_log = log_open("VSIDBatch");
+
+    if (worker_seconds > 0) {
+        vsync_set_offline_mode(1);
+    } else if (batch_list != NULL) {
+        batch_run();
+    }
+}
+
+/** \brief  End a batch worker once its tune has played long enough
+ *
+ * \param[in]   frames          frames played since the tune was started
+ * \param[in]   rfsh_per_sec    frames per second of the machine
+ */
+void vsid_batch_vsync_hook(unsigned int frames, double rfsh_per_sec)
+{
+    if (worker_seconds > 0 && frames >= worker_seconds * rfsh_per_sec) {
+        archdep_vice_exit(EXIT_SUCCESS);
+    }
+}
+
+/** \brief  Free the batch settings and job list */
+void vsid_batch_shutdown(void)
+{
+    int i;
+
+    for (i = 0; i < jobs_num; i++) {
+        lib_free(jobs[i].file);
+        lib_free(jobs[i].output);
+    }
+    lib_free(jobs);
+    jobs = NULL;
+    jobs_num = 0;
+    jobs_max = 0;
+
+    lib_free(batch_list);
+    lib_free(batch_dir);
+    lib_free(batch_format);
+    batch_list = NULL;
+    batch_dir = NULL;
+    batch_format = NULL;
+}
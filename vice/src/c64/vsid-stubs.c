@@ -658,6 +658,15 @@ image_contents_t *tapecontents_read(const char *file_name)
     return NULL;
 }
 
+image_contents_t *image_contents_read_cached(const char *path, read_contents_func_type func)
+{
+    return NULL;
+}
+
+void image_contents_cache_shutdown(void)
+{
+}
+
 image_contents_t *diskcontents_block_read(struct vdrive_s *vdrive, int part)
 {
     return NULL;
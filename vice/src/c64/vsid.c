@@ -66,6 +66,7 @@
 #include "vicii.h"
 #include "vicii-mem.h"
 #include "video.h"
+#include "vsid-batch.h"
 #include "vsid-cmdline-options.h"
 #include "vsidui.h"
 #include "vsid-debugcart.h"
@@ -149,6 +150,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("c64");
         return -1;
     }
+    if (vsid_batch_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("vsid batch");
+        return -1;
+    }
 #if defined(USE_SDLUI) || defined(USE_SDL2UI)
     if (vicii_cmdline_options_init() < 0) {
         init_cmdline_options_fail("vicii");
@@ -254,6 +259,9 @@ int machine_specific_init(void)
 
     machine_drive_stub();
 
+    /* Render a batch of songs, or play as a worker of one */
+    vsid_batch_init();
+
     return 0;
 }
 
@@ -300,6 +308,8 @@ void machine_specific_shutdown(void)
     sid_cmdline_options_shutdown();
 
     psid_shutdown();
+
+    vsid_batch_shutdown();
 }
 
 void machine_handle_pending_alarms(CLOCK num_write_cycles)
@@ -313,6 +323,7 @@ void machine_handle_pending_alarms(CLOCK num_write_cycles)
 static void machine_vsync_hook(void)
 {
     int i;
+    unsigned int frames;
     unsigned int playtime;
     static unsigned int time = 0;
 
@@ -330,12 +341,15 @@ static void machine_vsync_hook(void)
         }
     }
 
+    frames = psid_increment_frames();
+    vsid_batch_vsync_hook(frames, machine_timing.rfsh_per_sec);
+
 #if 0
-    playtime = (psid_increment_frames() * machine_timing.cycles_per_rfsh)
+    playtime = (frames * machine_timing.cycles_per_rfsh)
         / machine_timing.cycles_per_sec;
 #else
     /* Count deciseconds */
-    playtime = (double)psid_increment_frames()
+    playtime = (double)frames
         / machine_timing.rfsh_per_sec * 10.0;
 #endif
     if (playtime != time) {
@@ -208,6 +208,15 @@ static const trap_t c64_serial_traps[] = {
         c64memrom_trap_read,
         c64memrom_trap_store
     },
+    {
+        "SerialLoad",
+        0xF4F3,
+        0xF528,
+        { 0xA9, 0xFD, 0x25 },
+        serial_trap_load,
+        c64memrom_trap_read,
+        c64memrom_trap_store
+    },
     {
         NULL,
         0,
@@ -77,10 +77,6 @@ int dtvclockneg = 0;
 /* Experimental cycle exact alarm handling */
 /* #define CYCLE_EXACT_ALARM */
 
-#ifdef CYCLE_EXACT_ALARM
-alarm_context_t *maincpu_alarm_context = NULL;
-#endif
-
 #define REWIND_FETCH_OPCODE(clock) clock -= dtvrewind; dtvclockneg += dtvrewind
 
 /* Burst mode implementation */
@@ -108,6 +104,23 @@ inline static void c64dtvcpu_clock_add(CLOCK *clock, int amount)
                 alarm_context_dispatch(maincpu_alarm_context, (*clock));
             }
 #endif
+            /* copy RAM to RAM in one go up to the next alarm */
+            if ((dtvclockneg == 0) && !blitter_active && dma_active && (amount > 1)) {
+                int cycles = amount;
+#ifdef CYCLE_EXACT_ALARM
+                CLOCK next_alarm = alarm_context_next_pending_clk(maincpu_alarm_context);
+
+                if (next_alarm - (*clock) < (CLOCK)cycles) {
+                    cycles = (int)(next_alarm - (*clock));
+                }
+#endif
+                cycles = c64dtvdma_perform_dma_burst(cycles);
+                if (cycles > 0) {
+                    (*clock) += cycles;
+                    amount -= cycles;
+                    continue;
+                }
+            }
             (*clock)++;
             --amount;
             if (dtvclockneg == 0) {
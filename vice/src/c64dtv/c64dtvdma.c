@@ -297,6 +297,50 @@ static inline void perform_dma_cycle(void)
     }
 }
 
+/* Copy between plain RAM without going through the state machine for every
+   cycle.  Only done for transfers without swap and modulo, stopping before
+   the last byte so that the end of the transfer and its IRQ are handled by
+   perform_dma_cycle() in the right cycle.  Each byte still takes the two
+   cycles of a read and a write.  */
+static inline int perform_dma_burst(int cycles)
+{
+    int source_step, dest_step, source, dest, num;
+    uint8_t reg1f = GET_REG8(0x1f);
+
+    if ((dma_state != DMA_READ)
+        || (reg1f & 0x02)
+        || (GET_REG8(0x1e) & 0x03)
+        || ((source_memtype != 0x40) && (source_memtype != 0x80))
+        || ((dest_memtype != 0x40) && (dest_memtype != 0x80))) {
+        return 0;
+    }
+
+    source_step = GET_REG16(0x06) * ((reg1f & 0x04) ? +1 : -1);
+    dest_step = GET_REG16(0x08) * ((reg1f & 0x08) ? +1 : -1);
+
+    for (num = 0; (num < cycles / 2) && (dma_count > 1); num++) {
+        source = dma_source_off & 0x1fffff;
+        dest = dma_dest_off & 0x1fffff;
+
+        /* registers are left to the state machine */
+        if (((source_memtype == 0x80) && (source >= 0xd000) && (source < 0xe000))
+            || ((dest_memtype == 0x80) && (dest >= 0xd000) && (dest < 0xe000))) {
+            break;
+        }
+
+        dma_data = mem_ram[source];
+        mem_ram[dest] = dma_data;
+
+        source_line_off++;
+        dest_line_off++;
+        dma_source_off += source_step;
+        dma_dest_off += dest_step;
+        dma_count--;
+    }
+
+    return num * 2;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /* These are the $D3xx DMA register engine handlers */
@@ -435,6 +479,17 @@ void c64dtvdma_perform_dma(void)
     }
 }
 
+/* Run up to `cycles' cycles of a plain RAM transfer at once, returns the
+   number of cycles done; 0 if the transfer has to go cycle by cycle.  */
+int c64dtvdma_perform_dma_burst(int cycles)
+{
+#ifdef DEBUG
+    if (dma_log_enabled) {
+        return 0;
+    }
+#endif
+    return perform_dma_burst(cycles);
+}
 
 /* ------------------------------------------------------------------------- */
 
@@ -45,6 +45,7 @@ void c64dtvdma_shutdown(void);
 uint8_t c64dtv_dma_read(uint16_t addr);
 void c64dtv_dma_store(uint16_t addr, uint8_t value);
 void c64dtvdma_perform_dma(void);
+int c64dtvdma_perform_dma_burst(int cycles);
 void c64dtvdma_trigger_dma(void);
 
 struct snapshot_s;
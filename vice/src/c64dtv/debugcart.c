@@ -35,6 +35,7 @@
 #include "resources.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "testrunner.h"
 
 #include "debugcart.h"
 
@@ -78,7 +79,7 @@ void debugcart_store(uint16_t addr, uint8_t value)
                 n, (unsigned long)maincpu_clk); /* CLOCK can be 32 bit or 64 bit
                                                  *  so this will kinda work
                                                  */
-        archdep_vice_exit(n);
+        testrunner_exit(n);
     }
 }
 
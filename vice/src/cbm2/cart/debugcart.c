@@ -35,6 +35,7 @@
 #include "resources.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "testrunner.h"
 
 #include "debugcart.h"
 
@@ -76,7 +77,7 @@ static void debugcart_store(uint16_t addr, uint8_t value)
     int n = (int)value;
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
 
-    archdep_vice_exit(n);
+    testrunner_exit(n);
 }
 
 /* ------------------------------------------------------------------------- */
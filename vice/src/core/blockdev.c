@@ -0,0 +1,327 @@
+/*
+ * blockdev.c - Cached block access to disk images of hard disks and cards.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The IDE64 drives and the SD cards read and write their images one sector
+   at a time, each with its own seek and read or write of the host file.
+   That is slow on images on network storage, where every one of them is a
+   round trip.  Here the image is cached in blocks: when the blocks are read
+   in order, the following ones are read along with the missing one in a
+   single read, and written blocks are kept in the cache until they are
+   evicted or the image is flushed or closed.
+
+   Bytes past the end of the image read as zero, and the image only grows
+   as far as it was written.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "blockdev.h"
+#include "lib.h"
+#include "types.h"
+
+/* Size of the cache blocks.  */
+#define BLOCKDEV_BLOCK_SIZE     512
+
+/* Number of blocks in the cache, a power of two.  */
+#define BLOCKDEV_CACHE_BLOCKS   1024
+
+/* Blocks read at once when reading in order.  */
+#define BLOCKDEV_READAHEAD      64
+
+typedef struct blockdev_block_s {
+    off_t block;    /* number of the block held, -1 if none */
+    int dirty;
+    uint8_t *data;
+} blockdev_block_t;
+
+struct blockdev_s {
+    FILE *file;
+    int readonly;
+    off_t size;     /* size of the image including unflushed writes */
+    off_t last;     /* last block missed, for detecting reads in order */
+    blockdev_block_t cache[BLOCKDEV_CACHE_BLOCKS];
+    uint8_t *data;
+};
+
+static blockdev_block_t *cache_slot(blockdev_t *bdev, off_t block)
+{
+    return &bdev->cache[block & (BLOCKDEV_CACHE_BLOCKS - 1)];
+}
+
+/* Write a dirty block back to the image.  */
+static int block_writeback(blockdev_t *bdev, blockdev_block_t *slot)
+{
+    off_t start = slot->block * BLOCKDEV_BLOCK_SIZE;
+    size_t len = BLOCKDEV_BLOCK_SIZE;
+
+    if (!slot->dirty) {
+        return 0;
+    }
+    slot->dirty = 0;
+
+    if (start + (off_t)len > bdev->size) {
+        len = (size_t)(bdev->size - start);
+    }
+    if (archdep_fseeko(bdev->file, start, SEEK_SET)
+        || fwrite(slot->data, 1, len, bdev->file) != len) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Make `block' present in the cache, reading it and when reading in order
+   the ones after it too.  */
+static blockdev_block_t *block_get(blockdev_t *bdev, off_t block, int *error)
+{
+    blockdev_block_t *slot = cache_slot(bdev, block);
+    uint8_t buf[BLOCKDEV_READAHEAD * BLOCKDEV_BLOCK_SIZE];
+    off_t start = block * BLOCKDEV_BLOCK_SIZE;
+    size_t num = 1, len, i;
+    int read_error = 0;
+
+    if (slot->block == block) {
+        return slot;
+    }
+
+    if (block == bdev->last + 1) {
+        num = BLOCKDEV_READAHEAD;
+    }
+    bdev->last = block;
+
+    /* the file only holds what was flushed so far, unflushed data is in the
+       cache and not overwritten below */
+    len = 0;
+    if (start < bdev->size) {
+        len = num * BLOCKDEV_BLOCK_SIZE;
+        if (start + (off_t)len > bdev->size) {
+            len = (size_t)(bdev->size - start);
+        }
+        clearerr(bdev->file);
+        if (archdep_fseeko(bdev->file, start, SEEK_SET)) {
+            read_error = 1;
+            len = 0;
+        } else {
+            len = fread(buf, 1, len, bdev->file);
+            if (ferror(bdev->file)) {
+                read_error = 1;
+            }
+        }
+    }
+    memset(buf + len, 0, num * BLOCKDEV_BLOCK_SIZE - len);
+    if (read_error) {
+        *error = 1;
+        num = 1;
+    }
+
+    for (i = 0; i < num; i++) {
+        blockdev_block_t *s = cache_slot(bdev, block + (off_t)i);
+
+        if (s->block == block + (off_t)i) {
+            continue;
+        }
+        if (i > 0 && (s->dirty || (off_t)(i * BLOCKDEV_BLOCK_SIZE) >= (off_t)len)) {
+            /* do not evict written data or cache what is not there for read
+               ahead */
+            continue;
+        }
+        if (block_writeback(bdev, s) < 0) {
+            *error = 1;
+        }
+        s->block = block + (off_t)i;
+        memcpy(s->data, buf + i * BLOCKDEV_BLOCK_SIZE, BLOCKDEV_BLOCK_SIZE);
+    }
+    if (read_error) {
+        /* try again next time */
+        slot->block = -1;
+    }
+    return slot;
+}
+
+/** \brief  Open a disk image
+ *
+ * \param[in]   filename    name of the image
+ * \param[in]   readonly    open the image for reading only
+ *
+ * \return  the image, NULL if it cannot be opened
+ */
+blockdev_t *blockdev_open(const char *filename, int readonly)
+{
+    blockdev_t *bdev;
+    FILE *file;
+    int i;
+
+    file = fopen(filename, readonly ? MODE_READ : MODE_READ_WRITE);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    bdev = lib_calloc(1, sizeof(blockdev_t));
+    bdev->file = file;
+    bdev->readonly = readonly;
+    bdev->last = -2;
+
+    if (archdep_fseeko(file, 0, SEEK_END) == 0) {
+        bdev->size = archdep_ftello(file);
+        if (bdev->size < 0) {
+            bdev->size = 0;
+        }
+    }
+
+    bdev->data = lib_malloc(BLOCKDEV_CACHE_BLOCKS * BLOCKDEV_BLOCK_SIZE);
+    for (i = 0; i < BLOCKDEV_CACHE_BLOCKS; i++) {
+        bdev->cache[i].block = -1;
+        bdev->cache[i].data = bdev->data + i * BLOCKDEV_BLOCK_SIZE;
+    }
+
+    return bdev;
+}
+
+/** \brief  Write back what is cached and close an image
+ *
+ * \param[in]   bdev    image, may be NULL
+ */
+void blockdev_close(blockdev_t *bdev)
+{
+    if (bdev == NULL) {
+        return;
+    }
+
+    blockdev_flush(bdev);
+    fclose(bdev->file);
+    lib_free(bdev->data);
+    lib_free(bdev);
+}
+
+/** \brief  Read from an image
+ *
+ * \param[in]   bdev    image
+ * \param[in]   offset  position in the image
+ * \param[out]  buf     data read
+ * \param[in]   len     number of bytes
+ *
+ * \return  0 on success, -1 on error
+ */
+int blockdev_read(blockdev_t *bdev, off_t offset, uint8_t *buf, size_t len)
+{
+    blockdev_block_t *slot;
+    size_t pos, num;
+    int error = 0;
+
+    while (len > 0) {
+        pos = (size_t)(offset % BLOCKDEV_BLOCK_SIZE);
+        num = BLOCKDEV_BLOCK_SIZE - pos;
+        if (num > len) {
+            num = len;
+        }
+
+        slot = block_get(bdev, offset / BLOCKDEV_BLOCK_SIZE, &error);
+        memcpy(buf, slot->data + pos, num);
+
+        offset += (off_t)num;
+        buf += num;
+        len -= num;
+    }
+    return error ? -1 : 0;
+}
+
+/** \brief  Write to an image
+ *
+ * The data is written back to the image when it is evicted from the cache
+ * or when the image is flushed or closed.
+ *
+ * \param[in]   bdev    image
+ * \param[in]   offset  position in the image
+ * \param[in]   buf     data to write
+ * \param[in]   len     number of bytes
+ *
+ * \return  0 on success, -1 on error
+ */
+int blockdev_write(blockdev_t *bdev, off_t offset, const uint8_t *buf, size_t len)
+{
+    blockdev_block_t *slot;
+    off_t block;
+    size_t pos, num;
+    int error = 0;
+
+    if (bdev->readonly) {
+        return -1;
+    }
+
+    while (len > 0) {
+        pos = (size_t)(offset % BLOCKDEV_BLOCK_SIZE);
+        num = BLOCKDEV_BLOCK_SIZE - pos;
+        if (num > len) {
+            num = len;
+        }
+
+        block = offset / BLOCKDEV_BLOCK_SIZE;
+        slot = cache_slot(bdev, block);
+        if (slot->block != block && num == BLOCKDEV_BLOCK_SIZE) {
+            /* overwritten completely, no need to read it */
+            if (block_writeback(bdev, slot) < 0) {
+                error = 1;
+            }
+            slot->block = block;
+        } else {
+            slot = block_get(bdev, block, &error);
+        }
+        if (slot->block == block) {
+            memcpy(slot->data + pos, buf, num);
+            slot->dirty = 1;
+        }
+
+        offset += (off_t)num;
+        buf += num;
+        len -= num;
+
+        if (offset > bdev->size) {
+            bdev->size = offset;
+        }
+    }
+    return error ? -1 : 0;
+}
+
+/** \brief  Write back everything written to an image
+ *
+ * \param[in]   bdev    image
+ *
+ * \return  0 on success, -1 on error
+ */
+int blockdev_flush(blockdev_t *bdev)
+{
+    int error = 0;
+    int i;
+
+    for (i = 0; i < BLOCKDEV_CACHE_BLOCKS; i++) {
+        if (block_writeback(bdev, &bdev->cache[i]) < 0) {
+            error = 1;
+        }
+    }
+    if (fflush(bdev->file)) {
+        error = 1;
+    }
+    return error ? -1 : 0;
+}
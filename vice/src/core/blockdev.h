@@ -0,0 +1,45 @@
+/*
+ * blockdev.h - Cached block access to disk images of hard disks and cards.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_BLOCKDEV_H
+#define VICE_BLOCKDEV_H
+
+/* required for off_t on some platforms */
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+
+#include <stdio.h>
+
+#include "types.h"
+
+typedef struct blockdev_s blockdev_t;
+
+blockdev_t *blockdev_open(const char *filename, int readonly);
+void blockdev_close(blockdev_t *bdev);
+
+int blockdev_read(blockdev_t *bdev, off_t offset, uint8_t *buf, size_t len);
+int blockdev_write(blockdev_t *bdev, off_t offset, const uint8_t *buf, size_t len);
+int blockdev_flush(blockdev_t *bdev);
+
+#endif
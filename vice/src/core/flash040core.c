@@ -127,6 +127,15 @@ inline static void flash_clear_erase_mask(flash040_context_t *flash040_context)
     }
 }
 
+inline static void flash_set_dirty(flash040_context_t *flash040_context, unsigned int addr, unsigned int len)
+{
+    unsigned int block;
+
+    for (block = addr >> FLASH040_BLOCK_SHIFT; block <= (addr + len - 1) >> FLASH040_BLOCK_SHIFT; block++) {
+        flash040_context->dirty_mask[block >> 3] |= (uint8_t)(1 << (block & 0x7));
+    }
+}
+
 inline static unsigned int flash_sector_to_addr(flash040_context_t *flash040_context, unsigned int sector)
 {
     unsigned int sector_size = flash_types[flash040_context->flash_type].sector_size;
@@ -159,6 +168,7 @@ inline static void flash_erase_sector(flash040_context_t *flash040_context, unsi
     FLASH_DEBUG(("Erasing 0x%x - 0x%x", sector_addr, sector_addr + sector_size - 1));
     memset(&(flash040_context->flash_data[sector_addr]), 0xff, sector_size);
     flash040_context->flash_dirty = 1;
+    flash_set_dirty(flash040_context, sector_addr, sector_size);
 }
 
 inline static void flash_erase_chip(flash040_context_t *flash040_context)
@@ -166,6 +176,7 @@ inline static void flash_erase_chip(flash040_context_t *flash040_context)
     FLASH_DEBUG(("Erasing chip"));
     memset(flash040_context->flash_data, 0xff, flash_types[flash040_context->flash_type].size);
     flash040_context->flash_dirty = 1;
+    flash_set_dirty(flash040_context, 0, flash_types[flash040_context->flash_type].size);
 }
 
 inline static int flash_program_byte(flash040_context_t *flash040_context, unsigned int addr, uint8_t byte)
@@ -177,6 +188,9 @@ inline static int flash_program_byte(flash040_context_t *flash040_context, unsig
     flash040_context->program_byte = byte;
     flash040_context->flash_data[addr] = new_data;
     flash040_context->flash_dirty = 1;
+    if (new_data != old_data) {
+        flash_set_dirty(flash040_context, addr, 1);
+    }
 
     return (new_data == byte) ? 1 : 0;
 }
@@ -488,6 +502,7 @@ void flash040core_init(struct flash040_context_s *flash040_context,
     flash040_context->program_byte = 0;
     flash_clear_erase_mask(flash040_context);
     flash040_context->flash_dirty = 0;
+    flash040core_clear_dirty(flash040_context);
     flash040_context->erase_alarm = alarm_new(alarm_context, "Flash040Alarm", erase_alarm_handler, flash040_context);
 }
 
@@ -498,6 +513,30 @@ void flash040core_shutdown(flash040_context_t *flash040_context)
 
 /* -------------------------------------------------------------------------- */
 
+/* Blocks changed since the last flush of the image, so carts can write back
+   only what changed. */
+
+void flash040core_set_dirty(flash040_context_t *flash040_context, unsigned int addr, unsigned int len)
+{
+    if (len > 0) {
+        flash_set_dirty(flash040_context, addr, len);
+    }
+}
+
+int flash040core_is_dirty(flash040_context_t *flash040_context, unsigned int addr)
+{
+    unsigned int block = addr >> FLASH040_BLOCK_SHIFT;
+
+    return (flash040_context->dirty_mask[block >> 3] >> (block & 0x7)) & 1;
+}
+
+void flash040core_clear_dirty(flash040_context_t *flash040_context)
+{
+    memset(flash040_context->dirty_mask, 0, FLASH040_DIRTY_MASK_SIZE);
+}
+
+/* -------------------------------------------------------------------------- */
+
 #define FLASH040_DUMP_VER_MAJOR   2
 #define FLASH040_DUMP_VER_MINOR   0
 
@@ -554,103 +554,91 @@ inline static void advance_lfo(FM_OPL *OPL)
     LFO_PM = ((OPL->lfo_pm_cnt >> LFO_SH) & 7) | OPL->lfo_pm_depth_range;
 }
 
-/* advance to next sample */
-inline static void advance(FM_OPL *OPL)
+/* advance the envelope of an operator by one tick of the envelope generator */
+inline static void advance_eg_slot(OPL_SLOT *op, UINT32 eg_cnt)
 {
-    OPL_CH *CH;
-    OPL_SLOT *op;
-    int i;
-
-    OPL->eg_timer += OPL->eg_timer_add;
-
-    while (OPL->eg_timer >= OPL->eg_timer_overflow) {
-        OPL->eg_timer -= OPL->eg_timer_overflow;
-
-        OPL->eg_cnt++;
-
-        for (i = 0; i < 9 * 2; i++) {
-            CH = &OPL->P_CH[i / 2];
-            op = &CH->SLOT[i & 1];
-
-            /* Envelope Generator */
-            switch (op->state) {
-                case EG_ATT:            /* attack phase */
-                    if (!(OPL->eg_cnt & ((1 << op->eg_sh_ar) - 1))) {
-                        op->volume += (~op->volume * (eg_inc[op->eg_sel_ar + ((OPL->eg_cnt >> op->eg_sh_ar) & 7)])) >> 3;
-
-                        if (op->volume <= MIN_ATT_INDEX) {
-                            op->volume = MIN_ATT_INDEX;
-                            op->state = EG_DEC;
-                        }
-                    }
-                    break;
-                case EG_DEC:    /* decay phase */
-                    if (!(OPL->eg_cnt & ((1 << op->eg_sh_dr) - 1))) {
-                        op->volume += eg_inc[op->eg_sel_dr + ((OPL->eg_cnt >> op->eg_sh_dr) & 7)];
+    /* Envelope Generator */
+    switch (op->state) {
+        case EG_ATT:            /* attack phase */
+            if (!(eg_cnt & ((1 << op->eg_sh_ar) - 1))) {
+                op->volume += (~op->volume * (eg_inc[op->eg_sel_ar + ((eg_cnt >> op->eg_sh_ar) & 7)])) >> 3;
+
+                if (op->volume <= MIN_ATT_INDEX) {
+                    op->volume = MIN_ATT_INDEX;
+                    op->state = EG_DEC;
+                }
+            }
+            break;
+        case EG_DEC:    /* decay phase */
+            if (!(eg_cnt & ((1 << op->eg_sh_dr) - 1))) {
+                op->volume += eg_inc[op->eg_sel_dr + ((eg_cnt >> op->eg_sh_dr) & 7)];
 
-                        if ((UINT32)(op->volume) >= op->sl) {
-                            op->state = EG_SUS;
-                        }
-                    }
-                    break;
-                case EG_SUS:    /* sustain phase */
+                if ((UINT32)(op->volume) >= op->sl) {
+                    op->state = EG_SUS;
+                }
+            }
+            break;
+        case EG_SUS:    /* sustain phase */
 
-                    /* this is important behaviour:
-                       one can change percusive/non-percussive modes on the fly and
-                       the chip will remain in sustain phase - verified on real YM3812 */
+            /* this is important behaviour:
+               one can change percusive/non-percussive modes on the fly and
+               the chip will remain in sustain phase - verified on real YM3812 */
 
-                    if (op->eg_type) {          /* non-percussive mode */
-                        /* do nothing */
-                    } else {                            /* percussive mode */
-                        /* during sustain phase chip adds Release Rate (in percussive mode) */
-                        if (!(OPL->eg_cnt & ((1 << op->eg_sh_rr) - 1))) {
-                            op->volume += eg_inc[op->eg_sel_rr + ((OPL->eg_cnt >> op->eg_sh_rr) & 7)];
+            if (op->eg_type) {          /* non-percussive mode */
+                /* do nothing */
+            } else {                            /* percussive mode */
+                /* during sustain phase chip adds Release Rate (in percussive mode) */
+                if (!(eg_cnt & ((1 << op->eg_sh_rr) - 1))) {
+                    op->volume += eg_inc[op->eg_sel_rr + ((eg_cnt >> op->eg_sh_rr) & 7)];
 
-                            if (op->volume >= MAX_ATT_INDEX) {
-                                op->volume = MAX_ATT_INDEX;
-                            }
-                        }
-                        /* else do nothing in sustain phase */
+                    if (op->volume >= MAX_ATT_INDEX) {
+                        op->volume = MAX_ATT_INDEX;
                     }
-                    break;
-                case EG_REL:    /* release phase */
-                    if (!(OPL->eg_cnt & ((1 << op->eg_sh_rr) - 1))) {
-                        op->volume += eg_inc[op->eg_sel_rr + ((OPL->eg_cnt >> op->eg_sh_rr) & 7)];
+                }
+                /* else do nothing in sustain phase */
+            }
+            break;
+        case EG_REL:    /* release phase */
+            if (!(eg_cnt & ((1 << op->eg_sh_rr) - 1))) {
+                op->volume += eg_inc[op->eg_sel_rr + ((eg_cnt >> op->eg_sh_rr) & 7)];
 
-                        if (op->volume >= MAX_ATT_INDEX) {
-                            op->volume = MAX_ATT_INDEX;
-                            op->state = EG_OFF;
-                        }
-                    }
-                    break;
-                default:
-                    break;
+                if (op->volume >= MAX_ATT_INDEX) {
+                    op->volume = MAX_ATT_INDEX;
+                    op->state = EG_OFF;
+                }
             }
-        }
+            break;
+        default:
+            break;
     }
+}
 
-    for (i = 0; i < 9 * 2; i++) {
-        CH = &OPL->P_CH[i / 2];
-        op = &CH->SLOT[i & 1];
-
-        /* Phase Generator */
-        if (op->vib) {
-            UINT8 block;
-            unsigned int block_fnum = CH->block_fnum;
-            unsigned int fnum_lfo = (block_fnum & 0x0380) >> 7;
-            signed int lfo_fn_table_index_offset = lfo_pm_table[LFO_PM + 16 * fnum_lfo];
-
-            if (lfo_fn_table_index_offset) {    /* LFO phase modulation active */
-                block_fnum += lfo_fn_table_index_offset;
-                block = (block_fnum & 0x1c00) >> 10;
-                op->Cnt += (OPL->fn_tab[block_fnum & 0x03ff] >> (7 - block)) * op->mul;
-            } else {    /* LFO phase modulation  = zero */
-                op->Cnt += op->Incr;
-            }
-        } else {        /* LFO phase modulation disabled for this operator */
+/* advance the phase of an operator to the next sample */
+inline static void advance_pg_slot(FM_OPL *OPL, OPL_CH *CH, OPL_SLOT *op)
+{
+    /* Phase Generator */
+    if (op->vib) {
+        UINT8 block;
+        unsigned int block_fnum = CH->block_fnum;
+        unsigned int fnum_lfo = (block_fnum & 0x0380) >> 7;
+        signed int lfo_fn_table_index_offset = lfo_pm_table[LFO_PM + 16 * fnum_lfo];
+
+        if (lfo_fn_table_index_offset) {    /* LFO phase modulation active */
+            block_fnum += lfo_fn_table_index_offset;
+            block = (block_fnum & 0x1c00) >> 10;
+            op->Cnt += (OPL->fn_tab[block_fnum & 0x03ff] >> (7 - block)) * op->mul;
+        } else {    /* LFO phase modulation  = zero */
             op->Cnt += op->Incr;
         }
+    } else {        /* LFO phase modulation disabled for this operator */
+        op->Cnt += op->Incr;
     }
+}
+
+/* advance the noise generator to the next sample */
+inline static void advance_noise(FM_OPL *OPL)
+{
+    int i;
 
     /*  The Noise Generator of the YM3812 is 23-bit shift register.
      *   Period is equal to 2^23-2 samples.
@@ -1700,6 +1688,126 @@ int ym3812_timer_over(FM_OPL *chip, int c)
     return OPLTimerOver(chip, c);
 }
 
+/* Samples rendered at once by OPL_render().  */
+#define OPL_BLOCK_LEN   64
+
+/* a channel that makes no sound and does not change but for its phase */
+#define OPL_CH_IDLE(CH) ((CH)->SLOT[SLOT1].state == EG_OFF && (CH)->SLOT[SLOT2].state == EG_OFF \
+                         && (CH)->SLOT[SLOT1].op1_out[0] == 0 && (CH)->SLOT[SLOT1].op1_out[1] == 0)
+
+/* Advance both operators of a channel after sample n of the block.  */
+inline static void OPL_advance_ch(FM_OPL *OPL, OPL_CH *CH, UINT32 eg_cnt, UINT32 eg_ticks, INT32 lfo_pm)
+{
+    while (eg_ticks--) {
+        eg_cnt++;
+        advance_eg_slot(&CH->SLOT[SLOT1], eg_cnt);
+        advance_eg_slot(&CH->SLOT[SLOT2], eg_cnt);
+    }
+    LFO_PM = lfo_pm;
+    advance_pg_slot(OPL, CH, &CH->SLOT[SLOT1]);
+    advance_pg_slot(OPL, CH, &CH->SLOT[SLOT2]);
+}
+
+/* Generate samples a block at a time.  The LFO, envelope generator timing
+   and noise, shared by all channels, are worked out first for the whole
+   block, then each channel is rendered over the block on its own.  Channels
+   that are keyed off and silent only have their phase advanced.  The
+   samples are the same as those of generating one sample of all channels
+   after the other.  */
+static void OPL_render(FM_OPL *OPL, OPLSAMPLE *buf, int length)
+{
+    UINT32 lfo_am[OPL_BLOCK_LEN];
+    INT32 lfo_pm[OPL_BLOCK_LEN];
+    UINT32 eg_cnt[OPL_BLOCK_LEN];       /* envelope counter at sample n */
+    UINT32 eg_ticks[OPL_BLOCK_LEN];     /* envelope ticks after sample n */
+    UINT8 noise[OPL_BLOCK_LEN];
+    signed int out[OPL_BLOCK_LEN];
+    UINT8 rhythm = OPL->rhythm & 0x20;
+    int len, n, c, s;
+
+    while (length > 0) {
+        len = length < OPL_BLOCK_LEN ? length : OPL_BLOCK_LEN;
+
+        for (n = 0; n < len; n++) {
+            advance_lfo(OPL);
+            lfo_am[n] = LFO_AM;
+            lfo_pm[n] = LFO_PM;
+            noise[n] = OPL->noise_rng & 1;
+            out[n] = 0;
+
+            eg_cnt[n] = OPL->eg_cnt;
+            eg_ticks[n] = 0;
+            OPL->eg_timer += OPL->eg_timer_add;
+            while (OPL->eg_timer >= OPL->eg_timer_overflow) {
+                OPL->eg_timer -= OPL->eg_timer_overflow;
+                OPL->eg_cnt++;
+                eg_ticks[n]++;
+            }
+
+            advance_noise(OPL);
+        }
+
+        /* FM part */
+        for (c = 0; c < (rhythm ? 6 : 9); c++) {
+            OPL_CH *CH = &OPL->P_CH[c];
+
+            if (OPL_CH_IDLE(CH)) {
+                for (s = SLOT1; s <= SLOT2; s++) {
+                    OPL_SLOT *op = &CH->SLOT[s];
+
+                    if (op->vib) {
+                        for (n = 0; n < len; n++) {
+                            LFO_PM = lfo_pm[n];
+                            advance_pg_slot(OPL, CH, op);
+                        }
+                    } else {
+                        op->Cnt += op->Incr * (UINT32)len;
+                    }
+                }
+                continue;
+            }
+
+            for (n = 0; n < len; n++) {
+                LFO_AM = lfo_am[n];
+                output[0] = 0;
+                OPL_CALC_CH(CH);
+                out[n] += output[0];
+
+                OPL_advance_ch(OPL, CH, eg_cnt[n], eg_ticks[n], lfo_pm[n]);
+            }
+        }
+
+        /* Rhythm part */
+        if (rhythm) {
+            for (n = 0; n < len; n++) {
+                LFO_AM = lfo_am[n];
+                output[0] = 0;
+                OPL_CALC_RH(&OPL->P_CH[0], noise[n]);
+                out[n] += output[0];
+
+                for (c = 6; c < 9; c++) {
+                    OPL_advance_ch(OPL, &OPL->P_CH[c], eg_cnt[n], eg_ticks[n], lfo_pm[n]);
+                }
+            }
+        }
+
+        for (n = 0; n < len; n++) {
+            int lt = out[n];
+
+            lt >>= FINAL_SH;
+
+            /* limit check */
+            lt = limit(lt, MAXOUT, MINOUT);
+
+            /* store to sound buffer */
+            buf[n] = lt;
+        }
+
+        buf += len;
+        length -= len;
+    }
+}
+
 /*
 ** Generate samples for one of the YM3812's
 **
@@ -1710,9 +1818,6 @@ int ym3812_timer_over(FM_OPL *chip, int c)
 void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
 {
     FM_OPL *OPL = (FM_OPL *)chip;
-    UINT8 rhythm = OPL->rhythm & 0x20;
-    OPLSAMPLE *buf = buffer;
-    int i;
 
     if ((void *)OPL != cur_chip) {
         cur_chip = (void *)OPL;
@@ -1722,41 +1827,7 @@ void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
         SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
         SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
     }
-    for (i = 0; i < length; i++) {
-        int lt;
-
-        output[0] = 0;
-
-        advance_lfo(OPL);
-
-        /* FM part */
-        OPL_CALC_CH(&OPL->P_CH[0]);
-        OPL_CALC_CH(&OPL->P_CH[1]);
-        OPL_CALC_CH(&OPL->P_CH[2]);
-        OPL_CALC_CH(&OPL->P_CH[3]);
-        OPL_CALC_CH(&OPL->P_CH[4]);
-        OPL_CALC_CH(&OPL->P_CH[5]);
-
-        if (!rhythm) {
-            OPL_CALC_CH(&OPL->P_CH[6]);
-            OPL_CALC_CH(&OPL->P_CH[7]);
-            OPL_CALC_CH(&OPL->P_CH[8]);
-        } else {                /* Rhythm part */
-            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1 );
-        }
-
-        lt = output[0];
-
-        lt >>= FINAL_SH;
-
-        /* limit check */
-        lt = limit(lt, MAXOUT, MINOUT);
-
-        /* store to sound buffer */
-        buf[i] = lt;
-
-        advance(OPL);
-    }
+    OPL_render(OPL, buffer, length);
 }
 
 FM_OPL *ym3526_init(UINT32 clock, UINT32 rate)
@@ -1811,9 +1882,6 @@ int ym3526_timer_over(FM_OPL *chip, int c)
 void ym3526_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
 {
     FM_OPL *OPL = (FM_OPL *)chip;
-    UINT8 rhythm = OPL->rhythm & 0x20;
-    OPLSAMPLE *buf = buffer;
-    int i;
 
     if ((void *)OPL != cur_chip) {
         cur_chip = (void *)OPL;
@@ -1823,41 +1891,7 @@ void ym3526_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
         SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
         SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
     }
-    for (i = 0; i < length; i++) {
-        int lt;
-
-        output[0] = 0;
-
-        advance_lfo(OPL);
-
-        /* FM part */
-        OPL_CALC_CH(&OPL->P_CH[0]);
-        OPL_CALC_CH(&OPL->P_CH[1]);
-        OPL_CALC_CH(&OPL->P_CH[2]);
-        OPL_CALC_CH(&OPL->P_CH[3]);
-        OPL_CALC_CH(&OPL->P_CH[4]);
-        OPL_CALC_CH(&OPL->P_CH[5]);
-
-        if (!rhythm) {
-            OPL_CALC_CH(&OPL->P_CH[6]);
-            OPL_CALC_CH(&OPL->P_CH[7]);
-            OPL_CALC_CH(&OPL->P_CH[8]);
-        } else {                /* Rhythm part */
-            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1);
-        }
-
-        lt = output[0];
-
-        lt >>= FINAL_SH;
-
-        /* limit check */
-        lt = limit(lt, MAXOUT, MINOUT);
-
-        /* store to sound buffer */
-        buf[i] = lt;
-
-        advance(OPL);
-    }
+    OPL_render(OPL, buffer, length);
 }
 
 /* ---------------------------------------------------------------------*/
@@ -143,7 +143,7 @@ static void ds1602_write_protocol_bit(rtc_ds1602_t *context)
             context->reg = 0;
             context->bit = 0;
         } else if ((context->reg & 0xc4) == 0x04) {
-            context->offset = time(NULL);
+            context->offset = rtc_get_latch(0);
             context->state = DS1602_IDLE;
         } else if ((context->reg & 0xc2) == 0x02) {
             /* FIXME: do clear active timer */
@@ -165,7 +165,7 @@ static void ds1602_write_seconds_bit(rtc_ds1602_t *context)
     context->reg |= val;
     ++context->bit;
     if (context->bit == 32) {
-        now = time(NULL) + context->offset;
+        now = rtc_get_latch(context->offset);
         context->offset = context->offset + ((context->reg + context->offset0) - now);
         context->state = DS1602_IDLE;
     }
@@ -32,15 +32,66 @@
 #include <sys/time.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "archdep.h"
 #include "lib.h"
 #include "machine.h"
+#include "maincpu.h"
 #include "util.h"
 
 #include "rtc.h"
 
+/* Time the clocks show at cycle 0 when they run on emulated time,
+   2000-01-01 00:00:00 UTC */
+#define RTC_EMULATED_EPOCH  946684800
+
+/* If set, the clocks run on the cycles emulated instead of the host clock */
+static int emulated_time = 0;
+
+static time_t rtc_now(void)
+{
+    if (emulated_time) {
+        return (time_t)(RTC_EMULATED_EPOCH + maincpu_clk / (CLOCK)machine_get_cycles_per_second());
+    }
+    return rtc_now();
+}
+
+static int rtc_now_centisecond(void)
+{
+    if (emulated_time) {
+        long cycles_per_sec = machine_get_cycles_per_second();
+
+        return (int)((maincpu_clk % (CLOCK)cycles_per_sec) * 100 / (CLOCK)cycles_per_sec);
+    }
+    return archdep_rtc_get_centisecond();
+}
+
+/** \brief  Make the clocks run on emulated time
+ *
+ * The clocks then start at 2000-01-01 00:00:00 UTC when the machine is
+ * started and advance with the cycles emulated, so runs do not depend on
+ * when or on which host they are done.  The time zone is set to UTC for the
+ * same reason.
+ *
+ * \param[in]   enabled clocks run on emulated time
+ */
+void rtc_set_emulated_time(int enabled)
+{
+    emulated_time = enabled ? 1 : 0;
+
+    if (emulated_time) {
+#if defined(WINDOWS_COMPILE)
+        _putenv("TZ=UTC0");
+        _tzset();
+#else
+        setenv("TZ", "UTC0", 1);
+        tzset();
+#endif
+    }
+}
+
 
 inline static int int_to_bcd(int dec)
 {
@@ -57,8 +108,8 @@ inline static int bcd_to_int(int bcd)
 /* get 1/100 seconds from clock */
 uint8_t rtc_get_centisecond(int bcd)
 {
-    return (uint8_t)((bcd) ? (uint8_t)int_to_bcd(archdep_rtc_get_centisecond())
-                           : archdep_rtc_get_centisecond());
+    return (uint8_t)((bcd) ? (uint8_t)int_to_bcd(rtc_now_centisecond())
+                           : rtc_now_centisecond());
 }
 
 /* get seconds from time value
@@ -191,7 +242,7 @@ int rtc_get_dst(time_t time_val)
 /* get the current clock based on time + offset so the value can be latched */
 time_t rtc_get_latch(time_t offset)
 {
-    return time(NULL) + offset;
+    return rtc_now() + offset;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -200,7 +251,7 @@ time_t rtc_get_latch(time_t offset)
    0 - 59 */
 time_t rtc_set_second(int seconds, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_seconds = (bcd) ? bcd_to_int(seconds) : seconds;
@@ -219,7 +270,7 @@ time_t rtc_set_second(int seconds, time_t offset, int bcd)
    0 - 59 */
 time_t rtc_set_minute(int minutes, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_minutes = (bcd) ? bcd_to_int(minutes) : minutes;
@@ -238,7 +289,7 @@ time_t rtc_set_minute(int minutes, time_t offset, int bcd)
    0 - 23 */
 time_t rtc_set_hour(int hours, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_hours = (bcd) ? bcd_to_int(hours) : hours;
@@ -257,7 +308,7 @@ time_t rtc_set_hour(int hours, time_t offset, int bcd)
    1 - 12 and AM/PM indicator */
 time_t rtc_set_hour_am_pm(int hours, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_hours = (bcd) ? bcd_to_int(hours & 0x1f) : hours & 0x1f;
@@ -284,7 +335,7 @@ time_t rtc_set_hour_am_pm(int hours, time_t offset, int bcd)
    1 - 31 */
 time_t rtc_set_day_of_month(int day, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int is_leap_year = 0;
@@ -334,7 +385,7 @@ time_t rtc_set_day_of_month(int day, time_t offset, int bcd)
    1 - 12 */
 time_t rtc_set_month(int month, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_month = (bcd) ? bcd_to_int(month) : month;
@@ -353,7 +404,7 @@ time_t rtc_set_month(int month, time_t offset, int bcd)
    0 - 99 */
 time_t rtc_set_year(int year, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_year = (bcd) ? bcd_to_int(year) : year;
@@ -373,7 +424,7 @@ time_t rtc_set_year(int year, time_t offset, int bcd)
    19 - 20 */
 time_t rtc_set_century(int century, time_t offset, int bcd)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     time_t offset_now;
     int real_century = (bcd) ? bcd_to_int(century) : century;
@@ -394,7 +445,7 @@ time_t rtc_set_century(int century, time_t offset, int bcd)
    0 - 6 */
 time_t rtc_set_weekday(int day, time_t offset)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
 
     /* sanity check */
@@ -408,7 +459,7 @@ time_t rtc_set_weekday(int day, time_t offset)
    0 - 365 */
 time_t rtc_set_day_of_year(int day, time_t offset)
 {
-    time_t now = time(NULL) + offset;
+    time_t now = rtc_now() + offset;
     struct tm *local = localtime(&now);
     int is_leap_year = 0;
     int year = local->tm_year + 1900;
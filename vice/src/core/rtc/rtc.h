@@ -55,6 +55,8 @@ enum {
 /* max amount of RTC's in use at the same time */
 #define RTC_MAX 20
 
+void rtc_set_emulated_time(int enabled);
+
 uint8_t rtc_get_centisecond(int bcd);
 
 uint8_t rtc_get_second(time_t time_val, int bcd);         /* 0 - 61 (leap seconds would be 60 and 61) */
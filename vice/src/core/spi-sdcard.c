@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "blockdev.h"
 #include "log.h"
 #include "snapshot.h"
 #include "spi-sdcard.h"
@@ -94,11 +95,14 @@ static int mmc_card_type = CARD_TYPE_MMC;
 static int mmc_card_rw = 0;
 
 /* Image file */
-static FILE *mmc_image_file = NULL;
+static blockdev_t *mmc_image_file = NULL;
 
 /* Pointer inside image */
 static sd_addr_t mmc_image_pointer;
 
+/* Address of the block being written */
+static sd_addr_t mmc_write_address;
+
 /* write sequence counter */
 static unsigned int mmc_write_sequence;
 
@@ -635,29 +639,22 @@ static void mmc_execute_cmd(void)
 #endif
                     mmc_card_state = MMC_CARD_DUMMY_READ;
                 } else {
+                    uint8_t readbuf[0x1000];    /* FIXME */
 #ifdef DEBUG_MMC
                     log_debug(LOG_DEFAULT, "Address: %08x", mmc_current_address_pointer);
+                    log_debug(LOG_DEFAULT, "Buffering: %08x", mmc_current_address_pointer);
 #endif
-                    if (fseek(mmc_image_file, mmc_current_address_pointer, SEEK_SET) != 0) {
+                    if (mmc_block_size > sizeof(readbuf)
+                        || blockdev_read(mmc_image_file, (off_t)mmc_current_address_pointer,
+                                         readbuf, mmc_block_size) < 0) {
                         mmc_card_state = MMC_CARD_DUMMY_READ;
                     } else {
-                        uint8_t readbuf[0x1000];    /* FIXME */
-#ifdef DEBUG_MMC
-                        log_debug(LOG_DEFAULT, "Buffering: %08x", mmc_current_address_pointer);
-#endif
-                        fseek(mmc_image_file, mmc_current_address_pointer, SEEK_SET);
-                        if (!feof(mmc_image_file)) {
-                            if (fread(readbuf, 1, mmc_block_size, mmc_image_file) > 0) {
-                                mmc_read_buffer_readptr = 0;
-                                mmc_read_buffer_writeptr = 0;
-                                mmc_read_buffer_set(readbuf, mmc_block_size);
+                        mmc_read_buffer_readptr = 0;
+                        mmc_read_buffer_writeptr = 0;
+                        mmc_read_buffer_set(readbuf, mmc_block_size);
 #ifdef DEBUG_MMC
-                                log_debug(LOG_DEFAULT, "Buffered: %02x %02x", readbuf[0], readbuf[1]);
+                        log_debug(LOG_DEFAULT, "Buffered: %02x %02x", readbuf[0], readbuf[1]);
 #endif
-                            } else {
-                                /* FIXME: handle error */
-                            }
-                        }
                     }
                 }
             } else {
@@ -680,6 +677,7 @@ static void mmc_execute_cmd(void)
                     log_debug(LOG_DEFAULT, "Address Overflow: %08x", mmc_current_address_pointer);
 #endif
                 } else {
+                    mmc_write_address = mmc_current_address_pointer;
                     mmc_write_sequence = 0;
                     mmc_card_state = MMC_CARD_WRITE;
                 }
@@ -802,7 +800,9 @@ static void mmc_write_to_mmc(uint8_t value)
             break;
         case 1:
             if (mmc_card_state == MMC_CARD_WRITE) {
-                if (fwrite(&value, 1, 1, mmc_image_file) != 1) {
+                if (blockdev_write(mmc_image_file,
+                                   (off_t)mmc_write_address + mmc_image_pointer,
+                                   &value, 1) < 0) {
                     LOG(("could not write to mmc image file"));
                     /* FIXME: handle error */
                 }
@@ -850,11 +850,11 @@ int mmc_open_card_image(char *name, int rw)
     }
 
     if (rw) {
-        mmc_image_file = fopen(mmc_image_filename, "rb+");
+        mmc_image_file = blockdev_open(mmc_image_filename, 0);
     }
 
     if (mmc_image_file == NULL) {
-        mmc_image_file = fopen(mmc_image_filename, "rb");
+        mmc_image_file = blockdev_open(mmc_image_filename, 1);
 
         if (mmc_image_file == NULL) {
             LOG(("could not open sd card image: %s", mmc_image_filename));
@@ -880,7 +880,7 @@ void mmc_close_card_image(void)
 {
     /* unmount mmc cart image */
     if (mmc_image_file != NULL) {
-        fclose(mmc_image_file);
+        blockdev_close(mmc_image_file);
         mmc_image_file = NULL;
         spi_mmc_set_card_inserted(MMC_CARD_NOTINSERTED);
     }
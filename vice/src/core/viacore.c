@@ -535,6 +535,38 @@ inline static void alarm_set_if_not_pending(alarm_t *alarm, CLOCK cpu_clk)
     }
 }
 
+/*
+ * A free running T1 whose IRQ is masked and that does not drive PB7 has
+ * no visible effect once VIA_IM_T1 is set, so viacore_t1_zero_alarm() then
+ * stops rescheduling itself and only t1zero is left. This catches up with
+ * the underflows before rclk that were skipped that way, and schedules the
+ * alarm again for the next one.
+ *
+ * To be called together with run_pending_alarms() before the CPU accesses
+ * a register that could observe or change the T1 state.
+ */
+static void viacore_t1_catchup(via_context_t *via_context, CLOCK rclk)
+{
+    unsigned int full_cycle;
+    CLOCK nuf;
+
+    if (via_context->t1zero == 0 || alarm_is_pending(via_context->t1_zero_alarm)) {
+        return;
+    }
+
+    if (rclk > via_context->t1zero) {
+        full_cycle = via_context->tal + FULL_CYCLE_2;
+        nuf = (rclk - via_context->t1zero - 1) / full_cycle + 1;
+        via_context->t1zero += nuf * full_cycle;
+        via_context->t1reload += nuf * full_cycle;
+        if (nuf & 1) {
+            via_context->t1_pb7 ^= 0x80;
+        }
+    }
+
+    alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+}
+
 /*
  * Before calling this, make sure that t2cl and t2ch are the correct T2
  * values for time rclk.
@@ -654,6 +686,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
     if (addr == VIA_PRB || (addr >= VIA_T1CL && addr <= VIA_IER)) {
         run_pending_alarms(rclk, via_context->write_offset, via_context->alarm_context);
         /* run_pending_alarms(rclk, 0, via_context->alarm_context); */
+        viacore_t1_catchup(via_context, rclk);
     }
 
     switch (addr) {
@@ -1061,6 +1094,7 @@ uint8_t viacore_read_(via_context_t *via_context, uint16_t addr)
 
     if (addr == VIA_PRB || (addr >= VIA_T1CL && addr <= VIA_IER)) {
         run_pending_alarms(rclk, 0, via_context->alarm_context);
+        viacore_t1_catchup(via_context, rclk);
     }
 
     switch (addr) {
@@ -1313,7 +1347,14 @@ static void viacore_t1_zero_alarm(CLOCK offset, void *data)
         /* we want another alarm for the next T1 interrupt */
         unsigned int full_cycle = via_context->tal + FULL_CYCLE_2;
         via_context->t1zero += full_cycle;
-        alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+
+        /* unless nobody can see it, see viacore_t1_catchup() */
+        if ((via_context->ier & VIA_IM_T1)
+            || (via_context->via[VIA_ACR] & VIA_ACR_T1_PB7_USED)) {
+            alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+        } else {
+            alarm_unset(via_context->t1_zero_alarm);
+        }
 
         /* Let t1reload also keep up with the cpu clock;
            this should avoid `% full_cycle` case. */
@@ -1940,6 +1981,7 @@ int viacore_snapshot_write_module(via_context_t *via_context, snapshot_t *s)
     uint8_t byte4;
 
     run_pending_alarms(rclk, 0, via_context->alarm_context);
+    viacore_t1_catchup(via_context, rclk);
 
     m = snapshot_module_create(s, via_context->my_module_name, VIA_DUMP_VER_MAJOR, VIA_DUMP_VER_MINOR);
 
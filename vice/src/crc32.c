@@ -41,9 +41,13 @@
  */
 #define CRC32_POLY  0xedb88320
 
-/** \brief  Table of constants
+/** \brief  Tables of constants
+ *
+ * crc32_table[0] is the usual table for one byte, crc32_table[n] gives the
+ * CRC of a byte followed by n zero bytes, which allows processing 8 bytes
+ * at a time ("slicing-by-8").
  */
-static uint32_t crc32_table[256];
+static uint32_t crc32_table[8][256];
 
 
 /** \brief  Flag indicating if crc32_table has been initialized
@@ -51,6 +55,29 @@ static uint32_t crc32_table[256];
 static int crc32_is_initialized = 0;
 
 
+static void crc32_init(void)
+{
+    int i, j;
+    uint32_t c;
+
+    for (i = 0; i < 256; i++) {
+        c = (uint32_t)i;
+        for (j = 0; j < 8; j++) {
+            c = c & 1 ? CRC32_POLY ^ (c >> 1) : c >> 1;
+        }
+        crc32_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        c = crc32_table[0][i];
+        for (j = 1; j < 8; j++) {
+            c = (c >> 8) ^ crc32_table[0][c & 0xff];
+            crc32_table[j][i] = c;
+        }
+    }
+    crc32_is_initialized = 1;
+}
+
+
 /** \brief  Calculate CRC32 checksum of \a len bytes of \a buffer
  *
  * \param[in]   buffer  buffer
@@ -62,24 +89,33 @@ static int crc32_is_initialized = 0;
  */
 uint32_t crc32_buf(const char *buffer, unsigned int len)
 {
-    int i, j;
-    uint32_t crc, c;
-    const char *p;
+    uint32_t crc, lo, hi;
+    const uint8_t *p = (const uint8_t *)buffer;
 
     if (!crc32_is_initialized) {
-        for (i = 0; i < 256; i++) {
-            c = (uint32_t)i;
-            for (j = 0; j < 8; j++) {
-                c = c & 1 ? CRC32_POLY ^ (c >> 1) : c >> 1;
-            }
-            crc32_table[i] = c;
-        }
-        crc32_is_initialized = 1;
+        crc32_init();
     }
 
     crc = 0xffffffff;
-    for (p = buffer; len > 0; ++p, --len) {
-        crc = (crc >> 8) ^ crc32_table[(crc ^ *p) & 0xff];
+
+    /* bytes are combined by hand, so this works regardless of endianness
+       and alignment */
+    for (; len >= 8; p += 8, len -= 8) {
+        lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8)
+                    | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8)
+             | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        crc = crc32_table[7][lo & 0xff]
+              ^ crc32_table[6][(lo >> 8) & 0xff]
+              ^ crc32_table[5][(lo >> 16) & 0xff]
+              ^ crc32_table[4][lo >> 24]
+              ^ crc32_table[3][hi & 0xff]
+              ^ crc32_table[2][(hi >> 8) & 0xff]
+              ^ crc32_table[1][(hi >> 16) & 0xff]
+              ^ crc32_table[0][hi >> 24];
+    }
+    for (; len > 0; ++p, --len) {
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p) & 0xff];
     }
 
     return ~crc;
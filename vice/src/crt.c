@@ -33,6 +33,7 @@
 #include "archdep.h"
 #include "cartridge.h"
 #include "crt.h"
+#include "lib.h"
 #include "log.h"
 #include "machine.h"
 #include "resources.h"
@@ -61,6 +62,29 @@ static const char CRT_HEADER_PLUS4[] = "PLUS4 CARTRIDGE ";
 
 static const char CHIP_HEADER[] = "CHIP";
 
+#define CHIP_HEADER_SIZE    0x10
+
+/*
+ * The image opened last is mapped into memory and its CHIP packets are
+ * indexed once, so reading a chip is a copy from the mapping instead of
+ * going through stdio.  The file position of the stream is still kept in
+ * sync, cartridge code uses ftell()/fseek() on it.
+ */
+
+typedef struct crt_chip_entry_s {
+    long offset;                /* offset of the CHIP packet in the file */
+    crt_chip_header_t header;
+} crt_chip_entry_t;
+
+static struct {
+    FILE *fd;                   /* stream returned by crt_open() */
+    archdep_file_map_t *map;
+    uint8_t *data;
+    size_t size;
+    crt_chip_entry_t *chips;
+    int num_chips;
+} crt_image = { NULL, NULL, NULL, 0, NULL, 0 };
+
 static void expected_header_error(void)
 {
     switch (machine_class) {
@@ -85,6 +109,127 @@ static void expected_header_error(void)
     }
 }
 
+/*
+    Parse a chip header, return -1 on fault
+*/
+static int crt_parse_chip_header(crt_chip_header_t *header, uint8_t *chipheader)
+{
+    if (memcmp(chipheader, CHIP_HEADER, 4)) {
+        return -1; /* invalid header signature */
+    }
+
+    /* 1: grab size of chip packet from the file */
+    header->skip = util_be_buf_to_dword(&chipheader[4]);
+
+    if (header->skip < CHIP_HEADER_SIZE) {
+        return -1; /* invalid packet size */
+    }
+    /* 2: subtract header size, we now have the payload size */
+    header->skip -= CHIP_HEADER_SIZE; /* without header */
+
+    header->size = util_be_buf_to_word(&chipheader[14]);
+    if (header->size > header->skip) {
+        return -1; /* rom bigger then total size?! */
+    }
+    /* 3: subtract ROM size, we get the unused portion at the end,
+          which we need to skip */
+    header->skip -= header->size; /* skip size after image */
+
+    header->type = util_be_buf_to_word(&chipheader[8]);
+    header->bank = util_be_buf_to_word(&chipheader[10]);
+    header->start = util_be_buf_to_word(&chipheader[12]);
+
+    if (header->start + header->size > 0x10000) {
+        return -1; /* rom crossing the 64k boundary?! */
+    }
+
+    return 0;
+}
+
+static void crt_image_close(void)
+{
+    if (crt_image.map != NULL) {
+        archdep_file_map_close(crt_image.map);
+    }
+    lib_free(crt_image.chips);
+    crt_image.fd = NULL;
+    crt_image.map = NULL;
+    crt_image.data = NULL;
+    crt_image.size = 0;
+    crt_image.chips = NULL;
+    crt_image.num_chips = 0;
+}
+
+/*
+    Map the image and index its chip packets, starting at `offset'.  If the
+    image cannot be mapped it is read through stdio as usual.
+*/
+static void crt_image_open(const char *filename, FILE *fd, long offset)
+{
+    off_t size;
+    int max_chips = 0;
+
+    crt_image_close();
+
+    size = archdep_file_size(fd);
+    if (size <= 0) {
+        return;
+    }
+    crt_image.map = archdep_file_map(filename, (size_t)size, 0);
+    if (crt_image.map == NULL) {
+        return;
+    }
+    crt_image.fd = fd;
+    crt_image.data = archdep_file_map_data(crt_image.map);
+    crt_image.size = (size_t)size;
+
+    while (offset >= 0 && (size_t)offset + CHIP_HEADER_SIZE <= crt_image.size) {
+        crt_chip_entry_t *entry;
+
+        if (crt_image.num_chips == max_chips) {
+            max_chips = max_chips ? max_chips * 2 : 64;
+            crt_image.chips = lib_realloc(crt_image.chips, max_chips * sizeof(crt_chip_entry_t));
+        }
+        entry = &crt_image.chips[crt_image.num_chips];
+        if (crt_parse_chip_header(&entry->header, crt_image.data + offset) < 0) {
+            break;
+        }
+        entry->offset = offset;
+        crt_image.num_chips++;
+        offset += CHIP_HEADER_SIZE + entry->header.size + (long)entry->header.skip;
+    }
+    DBG(("CRT mapped, %d chips indexed.", crt_image.num_chips));
+}
+
+/*
+    Find the chip packet at the current position of the stream, NULL if the
+    stream is not the mapped image or there is none
+*/
+static const crt_chip_entry_t *crt_image_find_chip(FILE *fd)
+{
+    int lo = 0, hi;
+    long pos;
+
+    if (fd != crt_image.fd || crt_image.num_chips == 0) {
+        return NULL;
+    }
+    pos = ftell(fd);
+    hi = crt_image.num_chips - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+
+        if (crt_image.chips[mid].offset == pos) {
+            return &crt_image.chips[mid];
+        }
+        if (crt_image.chips[mid].offset < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
 /*
     Open a crt file and read header
 
@@ -176,6 +321,8 @@ FILE *crt_open(const char *filename, crt_header_t *header)
 
         fseek(fd, skip, SEEK_CUR); /* skip the rest */
 
+        crt_image_open(filename, fd, (long)(sizeof(crt_header) + skip));
+
         return fd; /* Ok, exit */
     } while (0);
 
@@ -197,7 +344,7 @@ int crt_getid(const char *filename)
         return -1;
     }
 
-    fclose(fd);
+    crt_close(fd);
 
     id = header.type;
 
@@ -215,41 +362,21 @@ int crt_getid(const char *filename)
 */
 int crt_read_chip_header(crt_chip_header_t *header, FILE *fd)
 {
-    uint8_t chipheader[0x10];
+    uint8_t chipheader[CHIP_HEADER_SIZE];
+    const crt_chip_entry_t *entry;
+
+    entry = crt_image_find_chip(fd);
+    if (entry != NULL) {
+        *header = entry->header;
+        fseek(fd, entry->offset + CHIP_HEADER_SIZE, SEEK_SET);
+        return 0;
+    }
 
     if (fread(chipheader, sizeof(chipheader), 1, fd) < 1) {
         return -1; /* couldn't read header */
     }
-    if (memcmp(chipheader, CHIP_HEADER, 4)) {
-        return -1; /* invalid header signature */
-    }
-
-    /* 1: grab size of chip packet from the file */
-    header->skip = util_be_buf_to_dword(&chipheader[4]);
 
-    if (header->skip < sizeof(chipheader)) {
-        return -1; /* invalid packet size */
-    }
-    /* 2: subtract header size, we now have the payload size */
-    header->skip -= sizeof(chipheader); /* without header */
-
-    header->size = util_be_buf_to_word(&chipheader[14]);
-    if (header->size > header->skip) {
-        return -1; /* rom bigger then total size?! */
-    }
-    /* 3: subtract ROM size, we get the unused portion at the end,
-          which we need to skip */
-    header->skip -= header->size; /* skip size after image */
-
-    header->type = util_be_buf_to_word(&chipheader[8]);
-    header->bank = util_be_buf_to_word(&chipheader[10]);
-    header->start = util_be_buf_to_word(&chipheader[12]);
-
-    if (header->start + header->size > 0x10000) {
-        return -1; /* rom crossing the 64k boundary?! */
-    }
-
-    return 0;
+    return crt_parse_chip_header(header, chipheader);
 }
 /*
     Read chip data, return -1 on error
@@ -259,6 +386,15 @@ int crt_read_chip(uint8_t *rawcart, int offset, crt_chip_header_t *chip, FILE *f
     if (offset + chip->size > C64CART_IMAGE_LIMIT) {
         return -1; /* overflow */
     }
+    if (fd == crt_image.fd) {
+        long pos = ftell(fd);
+
+        if (pos >= 0 && (size_t)pos + chip->size <= crt_image.size) {
+            memcpy(&rawcart[offset], crt_image.data + pos, chip->size);
+            fseek(fd, pos + chip->size + (long)chip->skip, SEEK_SET);
+            return 0;
+        }
+    }
     if (fread(&rawcart[offset], chip->size, 1, fd) < 1) {
         return -1; /* eof?! */
     }
@@ -266,6 +402,16 @@ int crt_read_chip(uint8_t *rawcart, int offset, crt_chip_header_t *chip, FILE *f
 
     return 0;
 }
+/*
+    Close a crt file opened with crt_open
+*/
+void crt_close(FILE *fd)
+{
+    if (fd == crt_image.fd) {
+        crt_image_close();
+    }
+    fclose(fd);
+}
 /*
     Write chip header and data, return -1 on fault
 */
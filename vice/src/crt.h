@@ -50,6 +50,7 @@ typedef struct crt_chip_header_s {
 } crt_chip_header_t;
 
 FILE *crt_open(const char *filename, crt_header_t *header);
+void crt_close(FILE *fd);
 int crt_getid(const char *filename);
 int crt_read_chip_header(crt_chip_header_t *header, FILE *fd);
 int crt_read_chip(uint8_t *rawcart, int offset, crt_chip_header_t *chip, FILE *fd);
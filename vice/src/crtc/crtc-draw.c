@@ -33,6 +33,7 @@
 #include "crtc-draw.h"
 #include "crtc.h"
 #include "crtctypes.h"
+#include "raster-cache-fill.h"
 #include "raster-modes.h"
 #include "types.h"
 
@@ -210,13 +211,103 @@ static void draw_reverse_line(void)
          (crtc.rl_len + 1) * crtc.hw_cols);
 }
 
-static int get_std_text(raster_cache_t *cache, unsigned int *xs,
-                        unsigned int *xe, int rr)
+/* Work out the pixel bytes DRAW() puts on the "normal" part of the current
+   line, so the cache can tell whether the line changed.  Returns the number
+   of columns, or 0 if the line cannot be cached: when part of it comes
+   from the previous line, when it is longer than the cache or when a hires
+   board draws over it.  */
+static unsigned int get_line_data(int reverse_flag, uint8_t *line)
 {
+    uint8_t *chargen_ptr, *screen_ptr;
+    int screen_rel, crsrrel = -1;
+    int xc = crtc.rl_visible * crtc.hw_cols;
+    int xe = (crtc.rl_len + 1) * crtc.hw_cols;
+    int len = (xc > xe) ? xc : xe;
+    int i, d;
+
+    if (crtc.xoffset + crtc.hjitter > 8
+        || len <= 0 || len > RASTER_CACHE_MAX_TEXTCOLS
+        || crtc.hires_draw_callback) {
+        return 0;
+    }
+
+    chargen_ptr = crtc.chargen_base
+                  + crtc.chargen_rel
+                  + (crtc.raster.ycounter & 0x0f);
+#if CRTC_BEAM_RACING
+    screen_ptr = &crtc.prefetch[0];
+    screen_rel = 0;
+#else
+    screen_ptr = crtc.screen_base;
+    screen_rel = crtc.screen_rel;
+#endif
+
+    if (crtc.crsrmode && crtc.cursor_lines && crtc.crsrstate) {
+        crsrrel = ((crtc.regs[CRTC_REG_CURSORPOSH] << 8) |
+                    crtc.regs[CRTC_REG_CURSORPOSL]) & crtc.vaddr_mask_eff;
+#if CRTC_BEAM_RACING
+        crsrrel -= crtc.screen_rel;
+#endif
+    }
+
+    for (i = 0; i < xc; i++) {
+        d = *(chargen_ptr
+              + (screen_ptr[screen_rel & crtc.vaddr_mask_eff] << 4));
+        if (screen_rel == crsrrel) {
+            d ^= 0xff;
+        }
+        screen_rel++;
+        if (reverse_flag) {
+            d ^= 0xff;
+        }
+        line[i] = (uint8_t)d;
+    }
+    for (; i < len; i++) {
+        line[i] = 0;
+    }
+
+    return (unsigned int)len;
+}
+
+/* Fill the cache with the current line.  The whole line is redrawn when it
+   changed, but an unchanged line is skipped, so a screen where little
+   happens costs next to nothing to draw.  */
+static int get_text(raster_cache_t *cache, unsigned int *xs,
+                    unsigned int *xe, int rr, int reverse_flag)
+{
+    uint8_t line[RASTER_CACHE_MAX_TEXTCOLS];
+    unsigned int len, cxs, cxe;
+    int rl_pos = crtc.xoffset + crtc.hjitter;
+
     *xs = 0;
     *xe = (crtc.rl_len + 1) * crtc.hw_cols;
 
-    return 1;
+    len = get_line_data(reverse_flag, line);
+    if (len == 0) {
+        cache->numcols = 0;
+        return 1;
+    }
+
+    /* the horizontal position of the line is kept in color_data_1 */
+    if (cache->numcols != len
+        || cache->color_data_1[0] != (uint8_t)rl_pos
+        || cache->color_data_1[1] != (uint8_t)(rl_pos >> 8)) {
+        rr = 1;
+    }
+    cache->numcols = len;
+    cache->color_data_1[0] = (uint8_t)rl_pos;
+    cache->color_data_1[1] = (uint8_t)(rl_pos >> 8);
+
+    cxs = len;
+    cxe = 0;
+    return raster_cache_data_fill(cache->foreground_data, line, len,
+                                  &cxs, &cxe, rr);
+}
+
+static int get_std_text(raster_cache_t *cache, unsigned int *xs,
+                        unsigned int *xe, int rr)
+{
+    return get_text(cache, xs, xe, rr, 0);
 }
 
 static void draw_std_text_cached(raster_cache_t *cache, unsigned int xs,
@@ -228,10 +319,7 @@ static void draw_std_text_cached(raster_cache_t *cache, unsigned int xs,
 static int get_rev_text(raster_cache_t *cache, unsigned int *xs,
                         unsigned int *xe, int rr)
 {
-    *xs = 0;
-    *xe = (crtc.rl_len + 1) * crtc.hw_cols;
-
-    return 1;
+    return get_text(cache, xs, xe, rr, 1);
 }
 
 static void draw_rev_text_cached(raster_cache_t *cache, unsigned int xs,
@@ -52,6 +52,7 @@
 #include "types.h"
 #include "uiapi.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 #ifdef DEBUG_TAPE
 #define DBG(x) log_printf  x
@@ -61,7 +62,7 @@
 
 #define MOTOR_DELAY         32000   /* for PLAY and RECORD */
 #define MOTOR_DELAY_FAST     1000   /* for fast forward/reverse */
-#define TAP_BUFFER_LENGTH   100000
+#define TAP_BUFFER_CHUNK    100000
 
 /* at least every DATASETTE_MAX_GAP cycle there should be an alarm */
 #define DATASETTE_MAX_GAP   100000
@@ -70,10 +71,15 @@
 /* Attached TAP tape image.  */
 static tap_t *current_image[TAPEPORT_MAX_PORTS];
 
-/* Buffer for the TAP */
+/* Buffer for the TAP, holds all of the pulse data so it is read from the
+   file only once, and again after recording.  */
 static uint8_t *tap_buffer[TAPEPORT_MAX_PORTS];
 
-/* Pointer and length of the tap-buffer */
+/* Flag: does the tap-buffer hold the current contents of the file?  */
+static int tap_buffer_valid[TAPEPORT_MAX_PORTS];
+
+/* Pointer and length of the tap-buffer, next_tap is the same as the
+   current_file_seek_position of the image */
 static long next_tap[TAPEPORT_MAX_PORTS], last_tap[TAPEPORT_MAX_PORTS];
 
 /* State of the datasette motor.  */
@@ -110,6 +116,12 @@ static int reset_datasette_with_maincpu;
 /* how long to wait, if a zero occurs in the tap ? */
 static int datasette_zero_gap_delay;
 
+/* run in warp mode while a tape is loading? */
+static int datasette_turbo;
+
+/* Flag: was warp mode turned on by the turbo?  */
+static int datasette_turbo_active = 0;
+
 /* finetuning for speed of motor */
 static int datasette_speed_tuning;
 
@@ -136,11 +148,15 @@ int datasette_sound_emulation = 1;
 /* volume of sound from datasette device */
 int datasette_sound_emulation_volume;
 
+/* load the kernal files of a TAP in the first datasette with the tape traps */
+int datasette_kernal_traps = 0;
+
 static log_t datasette_log = LOG_DEFAULT;
 
 static void datasette_internal_reset(int port);
 static void datasette_event_record(int command);
 static void datasette_control_internal(int port, int command);
+static void datasette_turbo_update(void);
 
 static void datasette_set_motor(int port, int flag);
 static void datasette_toggle_write_bit(int port, int write_bit);
@@ -256,6 +272,24 @@ static int set_datasette_sound_emulation(int val, void *param)
     return 0;
 }
 
+static int set_datasette_kernal_traps(int val, void *param)
+{
+    datasette_kernal_traps = val ? 1 : 0;
+
+    tape_traps_refresh();
+
+    return 0;
+}
+
+static int set_datasette_turbo(int val, void *param)
+{
+    datasette_turbo = val ? 1 : 0;
+
+    datasette_turbo_update();
+
+    return 0;
+}
+
 static int set_datasette_sound_emulation_volume(int val, void *param)
 {
     if ((val < 0) || (val > TAPE_SOUND_VOLUME_MAX)) {
@@ -293,6 +327,12 @@ static const resource_int_t resources_int[] = {
     { "DatasetteSoundVolume", TAPE_SOUND_VOLUME_DEFAULT, RES_EVENT_SAME, NULL,
       &datasette_sound_emulation_volume,
       set_datasette_sound_emulation_volume, NULL },
+    { "DatasetteKernalTraps", 0, RES_EVENT_SAME, NULL,
+      &datasette_kernal_traps,
+      set_datasette_kernal_traps, NULL },
+    { "DatasetteTurbo", 0, RES_EVENT_NO, NULL,
+      &datasette_turbo,
+      set_datasette_turbo, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -341,6 +381,18 @@ static const cmdline_option_t cmdline_options[] =
     { "-dssoundvolume", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "DatasetteSoundVolume", NULL,
       "<value>", "Set volume of Datasette sound" },
+    { "-dskernaltraps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteKernalTraps", (resource_value_t)1,
+      NULL, "Load kernal files of TAP images with the tape traps" },
+    { "+dskernaltraps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteKernalTraps", (resource_value_t)0,
+      NULL, "Load kernal files of TAP images through the Datasette" },
+    { "-dsturbo", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteTurbo", (resource_value_t)1,
+      NULL, "Enable warp mode while the Datasette motor runs in play mode" },
+    { "+dsturbo", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteTurbo", (resource_value_t)0,
+      NULL, "Disable warp mode while the Datasette motor runs in play mode" },
     CMDLINE_LIST_END
 };
 
@@ -388,48 +440,59 @@ void datasette_reset_counter(int port)
 }
 
 
-inline static int datasette_move_buffer_forward(int port, int offset)
+/* Read all pulse data of the image into the tap-buffer, unless it is
+   already there.  The file position is left alone, recording writes at the
+   position set by datasette_start_motor().  */
+static int datasette_load_buffer(int port)
 {
-    /* reads buffer to fit the next gap-read
-       tap_buffer[port][next_tap[port]] ~ current_file_seek_position
-    */
-    if (next_tap[port] + offset >= last_tap[port]) {
-        if (fseek(current_image[port]->fd, current_image[port]->current_file_seek_position
-                  + current_image[port]->offset, SEEK_SET)) {
+    tap_t *image = current_image[port];
+    long size = 0;
+    size_t len;
+
+    if (!tap_buffer_valid[port]) {
+        long pos = ftell(image->fd);
+
+        if (fseek(image->fd, image->offset, SEEK_SET)) {
             log_error(datasette_log, "Cannot read in tap-file.");
             return 0;
         }
-        last_tap[port] = (long)fread(tap_buffer[port], 1, TAP_BUFFER_LENGTH, current_image[port]->fd);
-        next_tap[port] = 0;
-        if (next_tap[port] >= last_tap[port]) {
-            return 0;
+        do {
+            tap_buffer[port] = lib_realloc(tap_buffer[port], (size_t)size + TAP_BUFFER_CHUNK);
+            len = fread(tap_buffer[port] + size, 1, TAP_BUFFER_CHUNK, image->fd);
+            size += (long)len;
+        } while (len == TAP_BUFFER_CHUNK);
+        if (pos >= 0) {
+            fseek(image->fd, pos, SEEK_SET);
         }
+        last_tap[port] = size;
+        tap_buffer_valid[port] = 1;
     }
+    /* the position may have been changed by seeking in tape.c */
+    next_tap[port] = image->current_file_seek_position;
     return 1;
 }
 
+inline static int datasette_move_buffer_forward(int port, int offset)
+{
+    /* makes sure the buffer holds the next gap-read
+       tap_buffer[port][next_tap[port]] ~ current_file_seek_position
+    */
+    if (!datasette_load_buffer(port)) {
+        return 0;
+    }
+    return next_tap[port] < last_tap[port];
+}
+
 inline static int datasette_move_buffer_back(int port, int offset)
 {
-    /* reads buffer to fit the next gap-read at current_file_seek_position-1
+    /* makes sure the buffer holds the next gap-read at
+       current_file_seek_position-1
        tap_buffer[port][next_tap[port]] ~ current_file_seek_position
     */
-    if (next_tap[port] + offset < 0) {
-        if (current_image[port]->current_file_seek_position >= TAP_BUFFER_LENGTH) {
-            next_tap[port] = TAP_BUFFER_LENGTH;
-        } else {
-            next_tap[port] = current_image[port]->current_file_seek_position;
-        }
-        if (fseek(current_image[port]->fd, current_image[port]->current_file_seek_position
-                  - next_tap[port] + current_image[port]->offset, SEEK_SET)) {
-            log_error(datasette_log, "Cannot read in tap-file.");
-            return 0;
-        }
-        last_tap[port] = (long)fread(tap_buffer[port], 1, TAP_BUFFER_LENGTH, current_image[port]->fd);
-        if (next_tap[port] > last_tap[port]) {
-            return 0;
-        }
+    if (!datasette_load_buffer(port)) {
+        return 0;
     }
-    return 1;
+    return next_tap[port] <= last_tap[port];
 }
 
 /* calculate tape wobble, add speed tuning */
@@ -737,6 +800,7 @@ static void datasette_read_bit(CLOCK offset, void *data)
             motor_stop_clk[port] = 0;
             ui_display_tape_motor_status(port, 0);
             datasette_motor[port] = 0;
+            datasette_turbo_update();
         } else {
             /* we cleared the alarm above, setup a new one further into the
                future that will trigger the motor stop */
@@ -885,14 +949,10 @@ void datasette_set_tape_image(int port, tap_t *image)
 
     current_image[port] = image;
     last_tap[port] = next_tap[port] = 0;
+    tap_buffer_valid[port] = 0;
     datasette_internal_reset(port);
 
     if (image != NULL) {
-        /* allocate buffer for the image */
-        if (tap_buffer[port] == NULL) {
-            tap_buffer[port] = lib_malloc(TAP_BUFFER_LENGTH);
-            DBG(("allocated tap_buffer[%d] %p", port, (void*)tap_buffer[port]));
-        }
         /* We need the length of tape for realistic counter. */
         current_image[port]->cycle_counter_total = 0;
         do {
@@ -906,10 +966,11 @@ void datasette_set_tape_image(int port, tap_t *image)
         tapeport_set_tape_sense(0, port);
     }
 
-    last_tap[port] = next_tap[port] = 0;
+    next_tap[port] = 0;
     fullwave[port] = 0;
 
     ui_set_tape_status(port, current_image[port] ? 1 : 0);
+    datasette_turbo_update();
 
     /* if image was removed, get rid of the buffer */
     if (image == NULL) {
@@ -918,6 +979,7 @@ void datasette_set_tape_image(int port, tap_t *image)
             lib_free(tap_buffer[port]);
             tap_buffer[port] = NULL;
         }
+        last_tap[port] = 0;
     }
 }
 
@@ -1099,6 +1161,7 @@ static void datasette_control_internal(int port, int command)
                 break;
         }
         ui_display_tape_control_status(port, current_image[port]->mode);
+        datasette_turbo_update();
     } else {
        switch (command) {
             case DATASETTE_CONTROL_RESET_COUNTER:
@@ -1152,8 +1215,53 @@ static void datasette_control_internal(int port, int command)
         }
         ui_display_tape_control_status(port, notape_mode[port]);
     }
-    /* clear the tap-buffer */
-    last_tap[port] = next_tap[port] = 0;
+}
+
+/** \brief  Check if the motor of any datasette is running
+ *
+ * \return  1 if a motor is running
+ */
+int datasette_motor_running(void)
+{
+    int port;
+
+    for (port = 0; port < TAPEPORT_MAX_PORTS; port++) {
+        if (datasette_motor[port]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* With the turbo, the whole machine runs in warp mode while a datasette
+   plays a tape with its motor on, so only the loading goes faster.  Warp
+   mode skips frames and drops the sound, and ends when the motor stops or
+   the tape is stopped.  Warp mode turned on by the user is left alone.  */
+static void datasette_turbo_update(void)
+{
+    int port;
+    int loading = 0;
+
+    if (datasette_turbo) {
+        for (port = 0; port < TAPEPORT_MAX_PORTS; port++) {
+            if (datasette_motor[port] && current_image[port] != NULL
+                && current_image[port]->mode == DATASETTE_CONTROL_START) {
+                loading = 1;
+            }
+        }
+    }
+
+    if (loading && !datasette_turbo_active) {
+        if (!vsync_get_warp_mode()) {
+            log_message(datasette_log, "Tape loading, turning warp mode on.");
+            vsync_set_warp_mode(1);
+            datasette_turbo_active = 1;
+        }
+    } else if (!loading && datasette_turbo_active) {
+        log_message(datasette_log, "Tape stopped, turning warp mode off.");
+        datasette_turbo_active = 0;
+        vsync_set_warp_mode(0);
+    }
 }
 
 void datasette_control(int port, int command)
@@ -1188,6 +1296,7 @@ static void datasette_set_motor(int port, int motor)
             datasette_start_motor(port);
             ui_display_tape_motor_status(port, 1);
             datasette_motor[port] = 1;
+            datasette_turbo_update();
         } else {
             DBG(("datasette_set_motor() not starting motor"));
         }
@@ -1272,6 +1381,9 @@ inline static void bit_write(int port)
             }
         }
     }
+    /* the tap-buffer has to be read again */
+    tap_buffer_valid[port] = 0;
+
     /* adjust file size */
     if (current_image[port]->size < current_image[port]->current_file_seek_position) {
         current_image[port]->size = current_image[port]->current_file_seek_position;
@@ -1450,6 +1562,7 @@ static int datasette_read_snapshot(int port, snapshot_t *s)
     }
 
     ui_set_tape_status(port, current_image[port] ? 1 : 0);
+    datasette_turbo_update();
     datasette_update_ui_counter(port);
     ui_display_tape_motor_status(port, datasette_motor[port]);
     if (current_image[port]) {
@@ -1466,8 +1579,8 @@ static int datasette_read_snapshot(int port, snapshot_t *s)
         }
     }
 
-    /* reset buffer */
-    next_tap[port] = last_tap[port] = 0;
+    /* the image may have been replaced */
+    tap_buffer_valid[port] = 0;
 
     snapshot_module_close(m);
 
@@ -81,12 +81,14 @@ struct tap_s;
 
 extern int datasette_sound_emulation;
 extern int datasette_sound_emulation_volume;
+extern int datasette_kernal_traps;
 
 void datasette_init(void);
 void datasette_set_tape_image(int port, struct tap_s *image);
 void datasette_control(int port, int command);
 void datasette_reset(void);
 void datasette_reset_counter(int port);
+int datasette_motor_running(void);
 void datasette_event_playback_port1(CLOCK offset, void *data);
 void datasette_event_playback_port2(CLOCK offset, void *data);
 
@@ -360,7 +360,8 @@ static void debug_int(interrupt_cpu_status_t *cs, const char *name,
     textout = lib_strdup(name);
 
     for (i = 0; i < cs->num_ints; i++) {
-        if (cs->pending_int[i] & type) {
+        if (interrupt_get_irq(cs, (int)i) & type
+            || interrupt_get_nmi(cs, (int)i) & type) {
             texttmp = util_concat(textout, " ", cs->int_name[i], NULL);
             lib_free(textout);
             textout = texttmp;
@@ -142,6 +142,13 @@ static void digimax_sound_machine_store(sound_t *psid, uint16_t addr, uint8_t va
     snd.voice[addr & 3] = val;
 }
 
+/* Write a DAC, placed in the sound at the clock of the write */
+static void digimax_dac_store(uint16_t addr, uint8_t value)
+{
+    sound_dac_store(&digimax_dac[addr & 3], (uint16_t)(digimax_sound_chip_offset | addr),
+                    value, (int)value * 64);
+}
+
 static uint8_t digimax_sound_machine_read(sound_t *psid, uint16_t addr)
 {
     return digimax_sound_data[addr & 3];
@@ -45,6 +45,7 @@
 #include "fsimage-dxx.h"
 #include "fsimage-gcr.h"
 #include "fsimage-p64.h"
+#include "fsimage-writeback.h"
 #include "fsimage.h"
 #include "lib.h"
 #include "log.h"
@@ -739,6 +740,12 @@ int disk_image_write_p64_image(const disk_image_t *image)
     return fsimage_write_p64_image(image);
 }
 
+/* Wait until all writes to image files are done.  */
+void disk_image_flush_all(void)
+{
+    fsimage_writeback_flush_all();
+}
+
 /*-----------------------------------------------------------------------*/
 /* Initialization.  */
 
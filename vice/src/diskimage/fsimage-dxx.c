@@ -35,6 +35,7 @@
 #include "cbmdos.h"
 #include "fsimage-dxx.h"
 #include "fsimage.h"
+#include "fsimage-writeback.h"
 #include "gcr.h"
 #include "log.h"
 #include "lib.h"
@@ -108,7 +109,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buffer, max_sector * 256, offset) < 0) {
+    if (fsimage_writeback_write(fsimage, buffer, max_sector * 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u to disk image.",
                   track);
         lib_free(buffer);
@@ -126,11 +127,11 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
 #endif
             fsimage->error_info.dirty = 0;
             if (error_info_created) {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map,
-                                   fsimage->error_info.len, fsimage->error_info.len * 256);
+                res = fsimage_writeback_write(fsimage, fsimage->error_info.map,
+                                              fsimage->error_info.len, fsimage->error_info.len * 256);
             } else {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map + sectors,
-                                   max_sector, offset);
+                res = fsimage_writeback_write(fsimage, fsimage->error_info.map + sectors,
+                                              max_sector, offset);
             }
             if (res < 0) {
                 log_error(fsimage_dxx_log,
@@ -140,29 +141,149 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
             }
         }
     }
-
-    /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
     return 0;
 }
 
-int fsimage_read_dxx_image(const disk_image_t *image)
+/* What is needed to encode the tracks of the image on first access.  */
+typedef struct dxx_encode_s {
+    const disk_image_t *image;
+    /* start of the first sector of each track, the tracks are skewed */
+    unsigned long trackoffset[MAX_GCR_TRACKS / 2 + 1];
+    /* disk id of each side */
+    uint8_t id1[2], id2[2];
+    int image_has_two_single_sides;
+    int d64_in_double_sided_drive;
+} dxx_encode_t;
+
+static uint8_t *dxx_alloc_track(disk_track_t *raw, unsigned int track_size)
 {
-    uint8_t buffer[256], *bam_id;
+    if (raw->data == NULL) {
+        raw->data = lib_malloc(track_size);
+    } else if (raw->size != (int)track_size) {
+        raw->data = lib_realloc(raw->data, track_size);
+    }
+    raw->size = track_size;
+    return raw->data;
+}
+
+static void dxx_encode_track(const dxx_encode_t *enc, unsigned int track, uint8_t *dest)
+{
+    const disk_image_t *image = enc->image;
+    fsimage_t *fsimage = image->media.fsimage;
+    uint8_t buffer[256];
     int gap, headergap, synclen;
-    unsigned int track, sector, track_size;
+    unsigned int sector, max_sector, track_size;
+    unsigned long trackoffset;
     gcr_header_t header;
     fdc_err_t rf;
-    int image_has_two_single_sides = 0;
+    uint8_t *ptr, *tempgcr;
+    int sectors, side;
+    long offset;
+
+    track_size = disk_image_raw_track_size(image->type, track);
+
+    /* special case for second side of the 1571. If each side was formatted
+       separately in one-sided mode, we must start from track 1 again and use
+       the ID from the BAM on the second side. */
+    side = (enc->image_has_two_single_sides && track >= 36) ? 1 : 0;
+    header.track = side ? track - 35 : track;
+    header.id1 = enc->id1[side];
+    header.id2 = enc->id2[side];
+
+    /* get temp buffer */
+    ptr = tempgcr = lib_malloc(track_size);
+
+    gap = disk_image_gap_size(image->type, track);
+    headergap = disk_image_header_gap_size(image->type, track);
+    synclen = disk_image_sync_size(image->type, track);
+
+    max_sector = disk_image_sector_per_track(image->type, track);
+
+    /* Clear track to avoid read errors.  */
+    memset(ptr, 0x55, track_size);
+
+    fsimage_writeback_flush(fsimage);
+
+    for (sector = 0; sector < max_sector; sector++) {
+        sectors = disk_image_check_sector(image, track, sector);
+        offset = sectors * 256;
+
+#ifdef HAVE_X64_IMAGE
+        if (image->type == DISK_IMAGE_TYPE_X64) {
+            offset += X64_HEADER_LENGTH;
+        }
+#endif
+        if (sectors >= 0) {
+            rf = CBMDOS_FDC_ERR_DRIVE;
+            if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
+                if (fsimage->error_info.map != NULL) {
+                    rf = fsimage->error_info.map[sectors];
+                }
+            }
+            header.sector = sector;
+            gcr_convert_sector_to_GCR(buffer, ptr, &header, headergap, synclen, rf);
+        }
+
+        ptr += SECTOR_GCR_SIZE_WITH_HEADER + headergap + gap + (synclen * 2);
+    }
+
+#if 0
+    /* copy gcr data to buffer (this creates perfectly aligned tracks) */
+    memcpy(dest, tempgcr, track_size);
+#else
+    /* copy gcr data to final buffer with offset + wraparound */
+    trackoffset = enc->trackoffset[track];
+    memset(dest, 0x55, track_size);
+    memcpy(dest + trackoffset, tempgcr, track_size - trackoffset);
+    memcpy(dest, tempgcr + (track_size - trackoffset), track_size - (track_size - trackoffset));
+#endif
+    lib_free(tempgcr);
+}
+
+/* Encode a half track of the image, called by the GCR code on first
+   access.  */
+static void dxx_encode_half_track(gcr_t *gcr, unsigned int half_track, void *data)
+{
+    const dxx_encode_t *enc = data;
+    const disk_image_t *image = enc->image;
+    unsigned int track, track_size;
+    uint8_t *ptr;
+
+    if (half_track < image->max_half_tracks) {
+        track = half_track / 2 + 1;
+        track_size = disk_image_raw_track_size(image->type, track);
+        ptr = dxx_alloc_track(&gcr->tracks[half_track], track_size);
+        if (half_track & 1) {
+            /* empty half track */
+            memset(ptr, 0, track_size);
+        } else if (track <= image->tracks) {
+            dxx_encode_track(enc, track, ptr);
+        } else {
+            memset(ptr, 0x55, track_size);
+        }
+    } else {
+        /* second side of a d64 in a 1571 is "unformatted" */
+        track = (half_track - 70) / 2;
+        track_size = disk_image_raw_track_size(image->type, track);
+        ptr = dxx_alloc_track(&gcr->tracks[half_track], track_size);
+        memset(ptr, 0, track_size);
+    }
+}
+
+/* The tracks are not encoded here but on first access, see
+   dxx_encode_half_track().  */
+int fsimage_read_dxx_image(const disk_image_t *image)
+{
+    uint8_t buffer[256], *bam_id;
+    int gap, headergap, synclen;
+    unsigned int track, track_size;
     int double_sided_drive = 0;
     fsimage_t *fsimage = image->media.fsimage;
     unsigned int max_sector;
-    uint8_t *ptr;
     int half_track;
     int sectors;
-    long offset;
     unsigned long trackoffset = 0;
-    uint8_t *tempgcr;
+    dxx_encode_t *enc;
 
     if (image->type == DISK_IMAGE_TYPE_D80
         || image->type == DISK_IMAGE_TYPE_D82) {
@@ -173,162 +294,72 @@ int fsimage_read_dxx_image(const disk_image_t *image)
         bam_id = &buffer[BAM_ID_1541];
     }
 
+    fsimage_writeback_flush(fsimage);
+
     bam_id[0] = bam_id[1] = 0xa0;
     if (sectors >= 0) {
         util_fpread(fsimage->fd, buffer, 256, sectors << 8);
     } else {
         return -1;
     }
-    header.id1 = bam_id[0];
-    header.id2 = bam_id[1];
+
+    enc = lib_calloc(1, sizeof(dxx_encode_t));
+    enc->image = image;
+    enc->id1[0] = enc->id1[1] = bam_id[0];
+    enc->id2[0] = enc->id2[1] = bam_id[1];
 
     /* check double sided images */
-    image_has_two_single_sides = (image->type == DISK_IMAGE_TYPE_D71) && !(buffer[0x03] & 0x80);
+    enc->image_has_two_single_sides = (image->type == DISK_IMAGE_TYPE_D71) && !(buffer[0x03] & 0x80);
     double_sided_drive = (drive_get_disk_drive_type(image->device) == DRIVE_TYPE_1571) ||
                          (drive_get_disk_drive_type(image->device) == DRIVE_TYPE_1571CR);
+    enc->d64_in_double_sided_drive = double_sided_drive && (image->type != DISK_IMAGE_TYPE_D71);
 
-    /* special case for 1571: if we are inserting a d64 image into a 1571, fill
-       the second side with "unformatted" data */
-    if (double_sided_drive && (image->type != DISK_IMAGE_TYPE_D71)) {
-        for (header.track = track = 1; track <= image->max_half_tracks / 2; track++, header.track++) {
-            half_track = (36 + track) * 2 - 2;
-
-            track_size = disk_image_raw_track_size(image->type, track);
-            if (image->gcr->tracks[half_track].data == NULL) {
-                image->gcr->tracks[half_track].data = lib_malloc(track_size);
-            } else if (image->gcr->tracks[half_track].size != (int)track_size) {
-                image->gcr->tracks[half_track].data = lib_realloc(image->gcr->tracks[half_track].data, track_size);
-            }
-            ptr = image->gcr->tracks[half_track].data;
-            image->gcr->tracks[half_track].size = track_size;
-            /* regular track */
-            memset(ptr, 0, track_size);
-
-            /* Clear odd track */
-            half_track++;
+    if (enc->image_has_two_single_sides && image->tracks >= 36) {
+        sectors = disk_image_check_sector(image, BAM_TRACK_1571 + 35, BAM_SECTOR_1571);
 
-            /* create an (empty) half track */
-            if (image->gcr->tracks[half_track].data == NULL) {
-                image->gcr->tracks[half_track].data = lib_malloc(track_size);
-            } else if (image->gcr->tracks[half_track].size != (int)track_size) {
-                image->gcr->tracks[half_track].data = lib_realloc(image->gcr->tracks[half_track].data, track_size);
-            }
-            image->gcr->tracks[half_track].size = track_size;
-            ptr = image->gcr->tracks[half_track].data;
-            memset(ptr, 0, track_size);
+        buffer[BAM_ID_1571] = buffer[BAM_ID_1571 + 1] = 0xa0;
+        if (sectors >= 0) {
+            util_fpread(fsimage->fd, buffer, 256, sectors << 8);
         }
+        enc->id1[1] = buffer[BAM_ID_1571]; /* second side */
+        enc->id2[1] = buffer[BAM_ID_1571 + 1];
     }
 
-    for (header.track = track = 1; track <= image->max_half_tracks / 2; track++, header.track++) {
-        half_track = track * 2 - 2;
-
+    /* On real disks, the track skew depends on many factors of which
+       none is exactly defined: the mechanical properties of the drive,
+       and last not least the code used for formatting the disk. Thus
+       the offset we use here is somewhat arbitrary, the choosen values
+       are tweaked to be somewhat close to what the skew1.prg program
+       shows for the first few tracks. */
+    for (track = 1; track <= image->max_half_tracks / 2 && track <= image->tracks; track++) {
         track_size = disk_image_raw_track_size(image->type, track);
-        if (image->gcr->tracks[half_track].data == NULL) {
-            image->gcr->tracks[half_track].data = lib_malloc(track_size);
-        } else if (image->gcr->tracks[half_track].size != (int)track_size) {
-            image->gcr->tracks[half_track].data = lib_realloc(image->gcr->tracks[half_track].data, track_size);
-        }
-        ptr = image->gcr->tracks[half_track].data;
-        image->gcr->tracks[half_track].size = track_size;
-
-        if (track <= image->tracks) {
-            /* get temp buffer */
-            ptr = tempgcr = lib_malloc(track_size);
-
-            /* special case for second side of the 1571. If each side was formatted
-               separately in one-sided mode, we must start from track 1 again and use
-               the ID from the BAM on the second side. */
-            if (image_has_two_single_sides && track == 36) {
-                sectors = disk_image_check_sector(image, BAM_TRACK_1571 + 35, BAM_SECTOR_1571);
-
-                buffer[BAM_ID_1571] = buffer[BAM_ID_1571 + 1] = 0xa0;
-                if (sectors >= 0) {
-                    util_fpread(fsimage->fd, buffer, 256, sectors << 8);
-                }
-                header.id1 = buffer[BAM_ID_1571]; /* second side, update id and track */
-                header.id2 = buffer[BAM_ID_1571 + 1];
-                header.track = 1;
-            }
-
-            gap = disk_image_gap_size(image->type, track);
-            headergap = disk_image_header_gap_size(image->type, track);
-            synclen = disk_image_sync_size(image->type, track);
-
-            max_sector = disk_image_sector_per_track(image->type, track);
-
-            /* Clear track to avoid read errors.  */
-            memset(ptr, 0x55, track_size);
-
-            for (sector = 0; sector < max_sector; sector++) {
-                sectors = disk_image_check_sector(image, track, sector);
-                offset = sectors * 256;
-
-#ifdef HAVE_X64_IMAGE
-                if (image->type == DISK_IMAGE_TYPE_X64) {
-                    offset += X64_HEADER_LENGTH;
-                }
-#endif
-                if (sectors >= 0) {
-                    rf = CBMDOS_FDC_ERR_DRIVE;
-                    if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
-                        if (fsimage->error_info.map != NULL) {
-                            rf = fsimage->error_info.map[sectors];
-                        }
-                    }
-                    header.sector = sector;
-                    gcr_convert_sector_to_GCR(buffer, ptr, &header, headergap, synclen, rf);
-                }
+        gap = disk_image_gap_size(image->type, track);
+        headergap = disk_image_header_gap_size(image->type, track);
+        synclen = disk_image_sync_size(image->type, track);
+        max_sector = disk_image_sector_per_track(image->type, track);
+
+        trackoffset += max_sector * (SECTOR_GCR_SIZE_WITH_HEADER + headergap + gap + (synclen * 2))
+                       - gap; /* bytes we have written */
+        trackoffset += (track_size * 100) / 270; /* time it takes to step */
+        trackoffset %= track_size;
+        /*printf("track: %2u sectors: %2u size: %5u offset: %5lu\n", track, max_sector, track_size, trackoffset);*/
+        enc->trackoffset[track] = trackoffset;
+    }
 
-                ptr += SECTOR_GCR_SIZE_WITH_HEADER + headergap + gap + (synclen * 2);
-            }
+    gcr_set_encoder(image->gcr, dxx_encode_half_track, enc);
 
-#if 0
-            /* copy gcr data to buffer (this creates perfectly aligned tracks) */
-            ptr = image->gcr->tracks[half_track].data;
-            memcpy(ptr, tempgcr, track_size);
-#else
-            /* copy gcr data to final buffer with offset + wraparound */
-            /* On real disks, the track skew depends on many factors of which
-               none is exactly defined: the mechanical properties of the drive,
-               and last not least the code used for formatting the disk. Thus
-               the offset we use here is somewhat arbitrary, the choosen values
-               are tweaked to be somewhat close to what the skew1.prg program
-               shows for the first few tracks. */
-            trackoffset += (ptr - tempgcr) - gap; /* bytes we have written */
-            trackoffset += (track_size * 100) / 270; /* time it takes to step */
-            trackoffset %= track_size;
-            /*printf("track: %2u sectors: %2u size: %5u offset: %5lu\n", track, max_sector, track_size, trackoffset);*/
-            ptr = image->gcr->tracks[half_track].data;
-            memset(ptr, 0x55, track_size);
-            memcpy(ptr + trackoffset, tempgcr, track_size - trackoffset);
-            memcpy(ptr, tempgcr + (track_size - trackoffset), track_size - (track_size - trackoffset));
-#endif
-            lib_free(tempgcr);
-        } else {
-            memset(ptr, 0x55, track_size);
-        }
-
-        /* Clear odd track */
-        half_track++;
-#if 0
-        /* this does not work for some reason (skew.d64 fails) */
-        if (image->gcr->tracks[half_track].data) {
-            image->gcr->tracks[half_track].size = track_size;
-            ptr = image->gcr->tracks[half_track].data;
-            memset(ptr, 0, track_size);
-        }
-#else
-        /* create an (empty) half track */
-        if (image->gcr->tracks[half_track].data == NULL) {
-            image->gcr->tracks[half_track].data = lib_malloc(track_size);
-        } else if (image->gcr->tracks[half_track].size != (int)track_size) {
-            image->gcr->tracks[half_track].data = lib_realloc(image->gcr->tracks[half_track].data, track_size);
+    /* special case for 1571: if we are inserting a d64 image into a 1571, fill
+       the second side with "unformatted" data */
+    if (enc->d64_in_double_sided_drive) {
+        for (track = 1; track <= image->max_half_tracks / 2; track++) {
+            half_track = (36 + track) * 2 - 2;
+            gcr_set_track_pending(image->gcr, half_track);
+            gcr_set_track_pending(image->gcr, half_track + 1);
         }
-        image->gcr->tracks[half_track].size = track_size;
-        ptr = image->gcr->tracks[half_track].data;
-        memset(ptr, 0, track_size);
-#endif
+    }
 
+    for (half_track = 0; half_track < (int)image->max_half_tracks; half_track++) {
+        gcr_set_track_pending(image->gcr, half_track);
     }
     return 0;
 }
@@ -382,7 +413,7 @@ int fsimage_dxx_read_sector(const disk_image_t *image, uint8_t *buf, const disk_
                 rf = fsimage->error_info.map ? fsimage->error_info.map[sectors] : CBMDOS_FDC_ERR_OK;
             }
         } else {
-            rf = gcr_read_sector(&image->gcr->tracks[(dadr->track * 2) - 2], buf, (uint8_t)dadr->sector);
+            rf = gcr_read_sector(gcr_get_track(image->gcr, (dadr->track * 2) - 2), buf, (uint8_t)dadr->sector);
             /* HACK: if the image has an error map, and the "FDC" did not detect an
             error in the GCR stream, use the error from the error map instead.
             FIXME: what should really be done is encoding the errors from the
@@ -450,13 +481,13 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buf, 256, offset) < 0) {
+    if (fsimage_writeback_write(fsimage, buf, 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u S:%u to disk image.",
                   dadr->track, dadr->sector);
         return -1;
     }
     if (image->gcr != NULL) {
-        gcr_write_sector(&image->gcr->tracks[(dadr->track * 2) - 2], buf, (uint8_t)dadr->sector);
+        gcr_write_sector(gcr_get_track(image->gcr, (dadr->track * 2) - 2), buf, (uint8_t)dadr->sector);
     }
 
     if ((fsimage->error_info.map != NULL)
@@ -469,15 +500,12 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         }
 #endif
         fsimage->error_info.map[sectors] = CBMDOS_FDC_ERR_OK;
-        if (util_fpwrite(fsimage->fd, &fsimage->error_info.map[sectors], 1, offset) < 0) {
+        if (fsimage_writeback_write(fsimage, &fsimage->error_info.map[sectors], 1, offset) < 0) {
             log_error(fsimage_dxx_log,
                     "Error writing T:%u S:%u error info to disk image.",
                     dadr->track, dadr->sector);
         }
     }
-
-    /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
     return 0;
 }
 
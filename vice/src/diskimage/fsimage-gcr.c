@@ -33,6 +33,7 @@
 #include "diskimage.h"
 #include "fsimage-gcr.h"
 #include "fsimage.h"
+#include "fsimage-writeback.h"
 #include "gcr.h"
 #include "cbmdos.h"
 #include "log.h"
@@ -54,6 +55,8 @@ int fsimage_read_gcr_image(const disk_image_t *image)
 {
     unsigned int half_track;
 
+    gcr_set_encoder(image->gcr, NULL, NULL);
+
     for (half_track = 0; half_track < MAX_GCR_TRACKS; half_track++) {
         /* free existing track */
         if (image->gcr->tracks[half_track].data) {
@@ -85,6 +88,8 @@ static long fsimage_gcr_seek_half_track(fsimage_t *fsimage, unsigned int half_tr
         log_error(fsimage_gcr_log, "Attempt to read without disk image.");
         return -1;
     }
+    /* The offsets may just have been written.  */
+    fsimage_writeback_flush(fsimage);
     if (util_fpread(fsimage->fd, buf, 12, 0) < 0) {
         log_error(fsimage_gcr_log, "Could not read GCR disk image.");
         return -1;
@@ -185,11 +190,11 @@ static int fsimage_gcr_read_track(const disk_image_t *image, unsigned int track,
 int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
                                  const disk_track_t *raw)
 {
-    int gap;
     int extend = 0;
-    long res;
+    int res;
     uint16_t max_track_length;
     uint8_t buf[4];
+    uint8_t *data;
     long offset;
     fsimage_t *fsimage;
     uint8_t num_half_tracks;
@@ -225,30 +230,16 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     if (raw->data != NULL) {
-        util_word_to_le_buf(buf, (uint16_t)raw->size);
-
-        if (util_fpwrite(fsimage->fd, buf, 2, offset) < 0) {
-            log_error(fsimage_gcr_log, "Could not write GCR disk image.");
-            return -1;
-        }
-
-        /* Clear gap between the end of the actual track and the start of
-           the next track.  */
-        if (fwrite(raw->data, raw->size, 1, fsimage->fd) < 1) {
+        /* length, track data and the gap up to the next track in one go */
+        data = lib_calloc(1, 2 + max_track_length);
+        util_word_to_le_buf(data, (uint16_t)raw->size);
+        memcpy(data + 2, raw->data, raw->size);
+        res = fsimage_writeback_write(fsimage, data, 2 + max_track_length, offset);
+        lib_free(data);
+        if (res < 0) {
             log_error(fsimage_gcr_log, "Could not write GCR disk image.");
             return -1;
         }
-        gap = max_track_length - raw->size;
-
-        if (gap > 0) {
-            uint8_t *padding = lib_calloc(1, gap);
-            res = fwrite(padding, gap, 1, fsimage->fd);
-            lib_free(padding);
-            if (res < 1) {
-                log_error(fsimage_gcr_log, "Could not write GCR disk image.");
-                return -1;
-            }
-        }
 
         if (extend) {
             /* FIXME: danger zone: 'DWORD' is a loose term, doesn't indicate
@@ -257,22 +248,19 @@ int fsimage_gcr_write_half_track(disk_image_t *image, unsigned int half_track,
              *        -- compyx 2020-07-24
              */
             util_dword_to_le_buf(buf, (uint32_t)offset);
-            if (util_fpwrite(fsimage->fd, buf, 4, 12 + (half_track - 2) * 4) < 0) {
+            if (fsimage_writeback_write(fsimage, buf, 4, 12 + (half_track - 2) * 4) < 0) {
                 log_error(fsimage_gcr_log, "Could not write GCR disk image.");
                 return -1;
             }
 
             util_dword_to_le_buf(buf, disk_image_speed_map(image->type, half_track / 2));
-            if (util_fpwrite(fsimage->fd, buf, 4, 12 + (half_track - 2 + num_half_tracks) * 4) < 0) {
+            if (fsimage_writeback_write(fsimage, buf, 4, 12 + (half_track - 2 + num_half_tracks) * 4) < 0) {
                 log_error(fsimage_gcr_log, "Could not write GCR disk image.");
                 return -1;
             }
         }
     }
 
-    /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
-
     return 0;
 }
 
@@ -34,6 +34,7 @@
 #include "diskimage.h"
 #include "fsimage-p64.h"
 #include "fsimage.h"
+#include "fsimage-writeback.h"
 #include "cbmdos.h"
 #include "gcr.h"
 #include "log.h"
@@ -59,6 +60,7 @@ int fsimage_read_p64_image(const disk_image_t *image)
 
     fsimage = image->media.fsimage;
 
+    fsimage_writeback_flush(fsimage);
     lSize = archdep_file_size(fsimage->fd);
     if (lSize < 0) {
         log_error(fsimage_p64_log, "Failed to get size of P64 disk image.");
@@ -102,11 +104,10 @@ int fsimage_write_p64_image(const disk_image_t *image)
     P64MemoryStreamCreate(&P64MemoryStreamInstance);
     P64MemoryStreamClear(&P64MemoryStreamInstance);
     if (P64ImageWriteToStream(P64Image, &P64MemoryStreamInstance)) {
-        if (util_fpwrite(fsimage->fd, P64MemoryStreamInstance.Data, P64MemoryStreamInstance.Size, 0) < 0) {
+        if (fsimage_writeback_write(fsimage, P64MemoryStreamInstance.Data, P64MemoryStreamInstance.Size, 0) < 0) {
             rc = -1;
             log_error(fsimage_p64_log, "Could not write P64 disk image.");
         } else {
-            fflush(fsimage->fd);
             rc = 0;
         }
     } else {
@@ -45,17 +45,22 @@
 #include "util.h"
 #include "x64.h"
 
-#define IS_D67_LEN(x) ((x) == D67_FILE_SIZE)
-#define IS_D71_LEN(x) (((x) == D71_FILE_SIZE) || ((x) == D71_FILE_SIZE_E))
-#define IS_D81_LEN(x) (((x) == D81_FILE_SIZE) || ((x) == D81_FILE_SIZE_E) || \
-                       ((x) == D81_FILE_SIZE_81) || ((x) == D81_FILE_SIZE_81E) || \
-                       ((x) == D81_FILE_SIZE_82) || ((x) == D81_FILE_SIZE_82E) || \
-                       ((x) == D81_FILE_SIZE_83) || ((x) == D81_FILE_SIZE_83E))
-#define IS_D80_LEN(x) ((x) == D80_FILE_SIZE)
-#define IS_D82_LEN(x) ((x) == D82_FILE_SIZE)
-#define IS_D1M_LEN(x) (((x) == D1M_FILE_SIZE) || ((x) == D1M_FILE_SIZE_E))
-#define IS_D2M_LEN(x) (((x) == D2M_FILE_SIZE) || ((x) == D2M_FILE_SIZE_E))
-#define IS_D4M_LEN(x) (((x) == D4M_FILE_SIZE) || ((x) == D4M_FILE_SIZE_E))
+/* Size of the header read from every file, that of X64 is the longest one
+   checked.  */
+#define PROBE_HEADER_LENGTH 64
+
+/* D64 sizes for 35 to 42 tracks, without and with error info */
+#define D64_LEN(t)      ((NUM_BLOCKS_1541 + ((t) - NUM_TRACKS_1541) * 17) * 256)
+#define D64_LEN_E(t)    ((NUM_BLOCKS_1541 + ((t) - NUM_TRACKS_1541) * 17) * 257)
+
+/* What the checks know about the file: its size and the start of it.  They
+   don't read the file again unless they need more than that, like the error
+   info of an image.  */
+typedef struct probe_info_s {
+    off_t size;
+    uint8_t header[PROBE_HEADER_LENGTH];
+    size_t header_len;
+} probe_info_t;
 
 static log_t disk_image_probe_log = LOG_DEFAULT;
 
@@ -70,42 +75,39 @@ static void disk_image_check_log(disk_image_t *image, const char *type)
                 image->read_only ? " (read only)." : ".");
 }
 
-static int disk_image_check_min_block(unsigned int blk, unsigned int length)
+static int disk_image_read_error_info(fsimage_t *fsimage, unsigned int blocks)
 {
-    if (blk < length) {
-        log_error(disk_image_probe_log, "Cannot read block %u.", blk);
+    fsimage->error_info.map = lib_calloc(1, blocks);
+    fsimage->error_info.len = blocks;
+    if (util_fpread(fsimage->fd, fsimage->error_info.map, blocks, 256 * blocks) < 0) {
+        log_error(disk_image_probe_log, "Cannot read error info.");
         return -1;
     }
     return 0;
 }
 
 
-static int disk_image_check_for_d64(disk_image_t *image)
+static int disk_image_check_for_d64(disk_image_t *image, const probe_info_t *info)
 {
     /*** detect 35..42 track d64 image, determine image parameters.
          Walk from 35 to 42, calculate expected image file size for each track,
          and compare this with the size of the given image. */
 
     int checkimage_tracks, checkimage_errorinfo;
-    size_t countbytes, checkimage_blocks;
-    off_t checkimage_realsize;
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    size_t checkimage_blocks;
 
     checkimage_errorinfo = 0;
 
-    checkimage_realsize = archdep_file_size(fsimage->fd);
     checkimage_tracks = NUM_TRACKS_1541; /* start at track 35 */
     checkimage_blocks = D64_FILE_SIZE_35 / 256;
 
     while (1) {
         /* check if image matches "checkimage_tracks" */
-        if (checkimage_realsize == checkimage_blocks * 256) {
+        if (info->size == (off_t)(checkimage_blocks * 256)) {
             /* image file matches size-with-no-error-info */
             checkimage_errorinfo = 0;
             break;
-        } else if (checkimage_realsize == checkimage_blocks * 256 + checkimage_blocks) {
+        } else if (info->size == (off_t)(checkimage_blocks * 256 + checkimage_blocks)) {
             /* image file matches size-with-error-info */
             checkimage_errorinfo = 1;
             break;
@@ -121,25 +123,14 @@ static int disk_image_check_for_d64(disk_image_t *image)
         }
     }
 
-    /*** test image file: read it (fgetc is pretty fast).
-         further size checks are no longer necessary (done during detection) */
-    rewind(fsimage->fd);
-    for (countbytes = 0; countbytes < checkimage_realsize; countbytes++) {
-        if (fgetc(fsimage->fd) == EOF) {
-            log_error(disk_image_probe_log, "Cannot read D64 image.");
-            return 0;
-        }
-    }
-
     /*** set parameters in image structure, read error info */
     image->type = DISK_IMAGE_TYPE_D64;
     image->tracks = checkimage_tracks;
     image->max_half_tracks = MAX_TRACKS_1541 * 2;
 
     if (checkimage_errorinfo) {
-        fsimage->error_info.map = lib_calloc(1, checkimage_blocks);
-        fsimage->error_info.len = (int)checkimage_blocks;
-        if (util_fpread(fsimage->fd, fsimage->error_info.map, checkimage_blocks, 256 * checkimage_blocks) < 0) {
+        if (disk_image_read_error_info(image->media.fsimage,
+                                       (unsigned int)checkimage_blocks) < 0) {
             return 0;
         }
     }
@@ -150,88 +141,24 @@ static int disk_image_check_for_d64(disk_image_t *image)
 }
 
 
-static int disk_image_check_for_d67(disk_image_t *image)
+static int disk_image_check_for_d67(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    if (!(IS_D67_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     image->type = DISK_IMAGE_TYPE_D67;
     image->tracks = NUM_TRACKS_2040;
     image->max_half_tracks = MAX_TRACKS_2040 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        /* FIXME */
-        if (++blk > (NUM_BLOCKS_2040)) {
-            log_error(disk_image_probe_log, "Disk image too large");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_2040) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_2040:
-            image->tracks = NUM_TRACKS_2040;
-            image->max_half_tracks = MAX_TRACKS_2040 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D67");
     return 1;
 }
 
-static int disk_image_check_for_d71(disk_image_t *image)
+static int disk_image_check_for_d71(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-    size_t checkimage_realsize;
-    int checkimage_errorinfo;
-
-    fsimage = image->media.fsimage;
-    checkimage_realsize = archdep_file_size(fsimage->fd);
-    checkimage_errorinfo = 0;
-
-    if (!(IS_D71_LEN(checkimage_realsize))) {
-        return 0;
-    }
-
-    checkimage_errorinfo = (checkimage_realsize == D71_FILE_SIZE_E) ? 1 : 0;
-
     image->type = DISK_IMAGE_TYPE_D71;
     image->tracks = NUM_TRACKS_1571;
     image->max_half_tracks = MAX_TRACKS_1571 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk == NUM_BLOCKS_1571) {
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_1571) < 0) {
-        return 0;
-    }
-
-    if (checkimage_errorinfo) {
-        fsimage->error_info.map = lib_calloc(1, blk);
-        fsimage->error_info.len = blk;
-        if (util_fpread(fsimage->fd, fsimage->error_info.map, blk, 256 * blk) < 0) {
+    if (info->size == D71_FILE_SIZE_E) {
+        if (disk_image_read_error_info(image->media.fsimage, NUM_BLOCKS_1571) < 0) {
             return 0;
         }
     }
@@ -240,22 +167,15 @@ static int disk_image_check_for_d71(disk_image_t *image)
     return 1;
 }
 
-static int disk_image_check_for_d81(disk_image_t *image)
+static int disk_image_check_for_d81(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
     char *ext;
-    size_t len;
-    uint8_t block[256];
     fsimage_t *fsimage;
+    unsigned int blk;
     int checkimage_errorinfo;
-    unsigned int checkimage_blocks;
 
     fsimage = image->media.fsimage;
 
-    if (!(IS_D81_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     /* .d1m images share the same sizes with .d81, so we reject based on the
        file extension what is likely a .d1m image */
     ext = util_get_extension(fsimage->name);
@@ -263,18 +183,8 @@ static int disk_image_check_for_d81(disk_image_t *image)
         return 0;
     }
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > (MAX_BLOCKS_1581 + 13)) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_1581) < 0) {
-        return 0;
-    }
+    /* whole blocks in the file, the error info of 80 tracks adds 12 */
+    blk = (unsigned int)(info->size / 256);
 
     switch (blk) {
         case NUM_BLOCKS_1581:          /* 80 tracks */
@@ -313,10 +223,7 @@ static int disk_image_check_for_d81(disk_image_t *image)
     }
 
     if (checkimage_errorinfo) {
-        checkimage_blocks = image->tracks * 40;
-        fsimage->error_info.map = lib_calloc(1, checkimage_blocks);
-        fsimage->error_info.len = checkimage_blocks;
-        if (util_fpread(fsimage->fd, fsimage->error_info.map, checkimage_blocks, 256 * checkimage_blocks) < 0) {
+        if (disk_image_read_error_info(fsimage, image->tracks * 40) < 0) {
             return 0;
         }
     }
@@ -324,108 +231,32 @@ static int disk_image_check_for_d81(disk_image_t *image)
     return 1;
 }
 
-static int disk_image_check_for_d80(disk_image_t *image)
+static int disk_image_check_for_d80(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    if (!(IS_D80_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     image->type = DISK_IMAGE_TYPE_D80;
     image->tracks = NUM_TRACKS_8050;
     image->max_half_tracks = MAX_TRACKS_8050 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_8050 + 6) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_8050) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_8050:
-            image->tracks = NUM_TRACKS_8050;
-            image->max_half_tracks = MAX_TRACKS_8050 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D80");
     return 1;
 }
 
-static int disk_image_check_for_d82(disk_image_t *image)
+static int disk_image_check_for_d82(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    if (!(IS_D82_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     image->type = DISK_IMAGE_TYPE_D82;
     image->tracks = NUM_TRACKS_8250;
     image->max_half_tracks = MAX_TRACKS_8250 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_8250 + 6) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_8250) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_8250:
-            image->tracks = NUM_TRACKS_8250;
-            image->max_half_tracks = MAX_TRACKS_8250 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D82");
     return 1;
 }
 
 #ifdef HAVE_X64_IMAGE
-static int disk_image_check_for_x64(disk_image_t *image)
+static int disk_image_check_for_x64(disk_image_t *image, const probe_info_t *info)
 {
-    uint8_t header[X64_HEADER_LENGTH];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    const uint8_t *header = info->header;
 
-    rewind(fsimage->fd);
-
-    if (fread(header, X64_HEADER_LENGTH, 1, fsimage->fd) < 1) {
-        return 0;
-    }
-
-    if (header[X64_HEADER_MAGIC_OFFSET + 0] != X64_HEADER_MAGIC_1 ||
-        header[X64_HEADER_MAGIC_OFFSET + 1] != X64_HEADER_MAGIC_2 ||
-        header[X64_HEADER_MAGIC_OFFSET + 2] != X64_HEADER_MAGIC_3 ||
-        header[X64_HEADER_MAGIC_OFFSET + 3] != X64_HEADER_MAGIC_4) {
+    if (info->header_len < X64_HEADER_LENGTH) {
         return 0;
     }
 
@@ -442,7 +273,7 @@ static int disk_image_check_for_x64(disk_image_t *image)
 }
 #endif
 
-static int disk_image_check_for_gcr(disk_image_t *image)
+static int disk_image_check_for_gcr(disk_image_t *image, const probe_info_t *info)
 {
 #if 0
     /* if 0'ed because of:
@@ -451,12 +282,9 @@ static int disk_image_check_for_gcr(disk_image_t *image)
     */
     WORD max_track_length;
 #endif
-    uint8_t header[32];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    const uint8_t *header = info->header;
 
-    if (util_fpread(fsimage->fd, header, sizeof (header), 0) < 0) {
+    if (info->header_len < 32) {
         log_error(disk_image_probe_log, "Cannot read image header.");
         return 0;
     }
@@ -490,12 +318,10 @@ static int disk_image_check_for_gcr(disk_image_t *image)
     }
 #endif
 
-    if (!strncmp("GCR-1541", (char*)header, 8)) {
+    if (!strncmp("GCR-1541", (const char *)header, 8)) {
         image->type = DISK_IMAGE_TYPE_G64;
-    } else if (!strncmp("GCR-1571", (char*)header, 8)) {
-        image->type = DISK_IMAGE_TYPE_G71;
     } else {
-        return 0;
+        image->type = DISK_IMAGE_TYPE_G71;
     }
 
     image->tracks = header[9] / 2;
@@ -504,22 +330,8 @@ static int disk_image_check_for_gcr(disk_image_t *image)
     return 1;
 }
 
-static int disk_image_check_for_p64(disk_image_t *image)
+static int disk_image_check_for_p64(disk_image_t *image, const probe_info_t *info)
 {
-    uint8_t header[8];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    if (util_fpread(fsimage->fd, header, sizeof(header), 0) < 0) {
-        log_error(disk_image_probe_log, "Cannot read image header.");
-        return 0;
-    }
-
-    if (strncmp("P64-1541", (char*)header, 8)) {
-        return 0;
-    }
-
     /*log_error(disk_image_probe_log, "P64 detected"); */
 
     image->type = DISK_IMAGE_TYPE_P64;
@@ -535,21 +347,13 @@ static int disk_image_check_for_p64(disk_image_t *image)
     return 1;
 }
 
-static int disk_image_check_for_d1m(disk_image_t *image)
+static int disk_image_check_for_d1m(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
     char *ext;
-    size_t len;
-    uint8_t block[256];
     fsimage_t *fsimage;
 
     fsimage = image->media.fsimage;
 
-    /* reject files with unknown size */
-    if (!(IS_D1M_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     /* .d81 images share the same sizes with .d1m, so we reject based on the
        file extension what is likely a .d81 image */
     ext = util_get_extension(fsimage->name);
@@ -561,120 +365,31 @@ static int disk_image_check_for_d1m(disk_image_t *image)
     image->tracks = NUM_TRACKS_1000;
     image->max_half_tracks = MAX_TRACKS_1000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_1000 + 13) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_1000) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_1000:
-        case NUM_BLOCKS_1000 + 12: /* with errors */
-            image->tracks = NUM_TRACKS_1000;
-            image->max_half_tracks = MAX_TRACKS_1000 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D1M");
     return 1;
 }
 
-static int disk_image_check_for_d2m(disk_image_t *image)
+static int disk_image_check_for_d2m(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    if (!(IS_D2M_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     image->type = DISK_IMAGE_TYPE_D2M;
     image->tracks = NUM_TRACKS_2000;
     image->max_half_tracks = MAX_TRACKS_2000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_2000 + 26) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_2000) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_2000:
-        case NUM_BLOCKS_2000 + 25: /* with errors */
-            image->tracks = NUM_TRACKS_2000;
-            image->max_half_tracks = MAX_TRACKS_2000 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D2M");
     return 1;
 }
 
-static int disk_image_check_for_d4m(disk_image_t *image)
+static int disk_image_check_for_d4m(disk_image_t *image, const probe_info_t *info)
 {
-    unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-    image->tracks = NUM_TRACKS_2000;
-
-    if (!(IS_D4M_LEN(archdep_file_size(fsimage->fd)))) {
-        return 0;
-    }
-
     image->type = DISK_IMAGE_TYPE_D4M;
     image->tracks = NUM_TRACKS_4000;
     image->max_half_tracks = MAX_TRACKS_4000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_4000 + 51) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
-
-    if (disk_image_check_min_block(blk, NUM_BLOCKS_4000) < 0) {
-        return 0;
-    }
-
-    switch (blk) {
-        case NUM_BLOCKS_4000:
-        case NUM_BLOCKS_4000 + 50: /* with errors */
-            image->tracks = NUM_TRACKS_4000;
-            image->max_half_tracks = MAX_TRACKS_4000 * 2;
-            break;
-        default:
-            return 0;
-    }
     disk_image_check_log(image, "D4M");
     return 1;
 }
 
-static int disk_image_check_for_dhd(disk_image_t *image)
+static int disk_image_check_for_dhd(disk_image_t *image, const probe_info_t *info)
 {
     off_t blk = 0;
     uint8_t sector[512];
@@ -686,7 +401,7 @@ static int disk_image_check_for_dhd(disk_image_t *image)
     fsimage = image->media.fsimage;
     image->tracks = 65535;
 
-    blk = archdep_file_size(fsimage->fd);
+    blk = info->size;
 
     /* only allow blank images to be attached if the CMDHD rom is loaded */
     if (blk == 0) {
@@ -759,25 +474,15 @@ good:
     return 1;
 }
 
-static int disk_image_check_for_d90(disk_image_t *image)
+static int disk_image_check_for_d90(disk_image_t *image, const probe_info_t *info)
 {
-    off_t blk = 0;
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
-
-    /* get file size */
-    blk = archdep_file_size(fsimage->fd);
-
     /* only allow true D9090/D9060 image sizes right now */
-    if (blk == D9060_FILE_SIZE) {
+    if (info->size == D9060_FILE_SIZE) {
         /* D9060 has 4 heads */
         image->sectors = 4 * 32;
-    } else if (blk == D9090_FILE_SIZE) {
+    } else {
         /* D9090 has 6 heads */
         image->sectors = 6 * 32;
-    } else {
-        return 0;
     }
 
     /* set max track, for now; it starts at 0 */
@@ -791,51 +496,105 @@ static int disk_image_check_for_d90(disk_image_t *image)
     return 1;
 }
 
-int fsimage_probe(disk_image_t *image)
-{
-    if (disk_image_check_for_d64(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d67(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d71(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d81(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d80(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d82(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_p64(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_gcr(image)) {
-        return 0;
-    }
+/* File sizes of the image types, lists end with 0.  */
+static const off_t d64_sizes[] = {
+    D64_LEN(35), D64_LEN_E(35), D64_LEN(36), D64_LEN_E(36),
+    D64_LEN(37), D64_LEN_E(37), D64_LEN(38), D64_LEN_E(38),
+    D64_LEN(39), D64_LEN_E(39), D64_LEN(40), D64_LEN_E(40),
+    D64_LEN(41), D64_LEN_E(41), D64_LEN(42), D64_LEN_E(42),
+    0
+};
+static const off_t d67_sizes[] = { D67_FILE_SIZE, 0 };
+static const off_t d71_sizes[] = { D71_FILE_SIZE, D71_FILE_SIZE_E, 0 };
+static const off_t d81_sizes[] = {
+    D81_FILE_SIZE, D81_FILE_SIZE_E, D81_FILE_SIZE_81, D81_FILE_SIZE_81E,
+    D81_FILE_SIZE_82, D81_FILE_SIZE_82E, D81_FILE_SIZE_83, D81_FILE_SIZE_83E,
+    0
+};
+static const off_t d80_sizes[] = { D80_FILE_SIZE, 0 };
+static const off_t d82_sizes[] = { D82_FILE_SIZE, 0 };
+static const off_t d1m_sizes[] = { D1M_FILE_SIZE, D1M_FILE_SIZE_E, 0 };
+static const off_t d2m_sizes[] = { D2M_FILE_SIZE, D2M_FILE_SIZE_E, 0 };
+static const off_t d4m_sizes[] = { D4M_FILE_SIZE, D4M_FILE_SIZE_E, 0 };
+static const off_t d90_sizes[] = { D9060_FILE_SIZE, D9090_FILE_SIZE, 0 };
+
 #ifdef HAVE_X64_IMAGE
-    if (disk_image_check_for_x64(image)) {
-        return 0;
-    }
+static const char x64_magic[] = {
+    X64_HEADER_MAGIC_1, X64_HEADER_MAGIC_2, X64_HEADER_MAGIC_3, X64_HEADER_MAGIC_4
+};
 #endif
-    if (disk_image_check_for_d1m(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d2m(image)) {
-        return 0;
-    }
-    if (disk_image_check_for_d4m(image)) {
-        return 0;
+
+typedef struct probe_type_s {
+    const off_t *sizes;     /* file sizes of the type, NULL for any size */
+    const char *magic;      /* start of the file, NULL for any */
+    size_t magic_len;
+    int (*check)(disk_image_t *image, const probe_info_t *info);
+} probe_type_t;
+
+/* The image types in the order they are tried.  A check is only called if
+   the size and start of the file fit its type.  */
+static const probe_type_t probe_types[] = {
+    { d64_sizes, NULL, 0, disk_image_check_for_d64 },
+    { d67_sizes, NULL, 0, disk_image_check_for_d67 },
+    { d71_sizes, NULL, 0, disk_image_check_for_d71 },
+    { d81_sizes, NULL, 0, disk_image_check_for_d81 },
+    { d80_sizes, NULL, 0, disk_image_check_for_d80 },
+    { d82_sizes, NULL, 0, disk_image_check_for_d82 },
+    { NULL, "P64-1541", 8, disk_image_check_for_p64 },
+    { NULL, "GCR-1541", 8, disk_image_check_for_gcr },
+    { NULL, "GCR-1571", 8, disk_image_check_for_gcr },
+#ifdef HAVE_X64_IMAGE
+    { NULL, x64_magic, sizeof(x64_magic), disk_image_check_for_x64 },
+#endif
+    { d1m_sizes, NULL, 0, disk_image_check_for_d1m },
+    { d2m_sizes, NULL, 0, disk_image_check_for_d2m },
+    { d4m_sizes, NULL, 0, disk_image_check_for_d4m },
+    { d90_sizes, NULL, 0, disk_image_check_for_d90 },
+    { NULL, NULL, 0, disk_image_check_for_dhd }
+};
+
+static int probe_size_matches(const off_t *sizes, off_t size)
+{
+    for (; *sizes != 0; sizes++) {
+        if (*sizes == size) {
+            return 1;
+        }
     }
-    if (disk_image_check_for_d90(image)) {
-        return 0;
+    return 0;
+}
+
+int fsimage_probe(disk_image_t *image)
+{
+    fsimage_t *fsimage;
+    probe_info_t info;
+    const probe_type_t *type;
+    size_t i;
+
+    fsimage = image->media.fsimage;
+
+    info.size = archdep_file_size(fsimage->fd);
+    if (info.size < 0) {
+        log_error(disk_image_probe_log, "Cannot get size of `%s'.", fsimage->name);
+        return -1;
     }
-    if (disk_image_check_for_dhd(image)) {
-        return 0;
+
+    rewind(fsimage->fd);
+    info.header_len = fread(info.header, 1, sizeof(info.header), fsimage->fd);
+    rewind(fsimage->fd);
+
+    for (i = 0; i < sizeof(probe_types) / sizeof(probe_types[0]); i++) {
+        type = &probe_types[i];
+        if (type->sizes != NULL && !probe_size_matches(type->sizes, info.size)) {
+            continue;
+        }
+        if (type->magic != NULL
+            && (info.header_len < type->magic_len
+                || memcmp(info.header, type->magic, type->magic_len) != 0)) {
+            continue;
+        }
+        if (type->check(image, &info)) {
+            return 0;
+        }
     }
 
     return -1;
@@ -0,0 +1,273 @@
+/*
+ * fsimage-writeback.c - Background writing of disk image files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Writes to disk image files are copied into a queue and done by a single
+   writer thread, in the order they were queued, so the emulation does not
+   wait for the host file system.  A write replacing an identical range of
+   the same image that is still queued updates the queued data instead of
+   adding another write, as long as no overlapping write of that image was
+   queued after it.  This keeps a drive writing the same track over and over
+   from piling up writes.
+
+   Anything else using the file of an image (reading, checking its size,
+   closing it) must call fsimage_writeback_flush() first, which waits until
+   all queued writes of the image are done.  If the thread cannot be
+   started, writes are done right away.  */
+
+#include "vice.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "diskimage.h"
+#include "fsimage.h"
+#include "fsimage-writeback.h"
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "util.h"
+
+/* Writers wait when more than this many bytes are queued.  */
+#define WRITEBACK_MAX_PENDING   (1024 * 1024)
+
+typedef struct writeback_item_s {
+    fsimage_t *fsimage;
+    long offset;
+    size_t num;
+    uint8_t *data;
+    struct writeback_item_s *next;
+} writeback_item_t;
+
+static log_t fsimage_writeback_log = LOG_DEFAULT;
+
+static pthread_mutex_t writeback_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when an item was queued */
+static pthread_cond_t writeback_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when an item was written */
+static pthread_cond_t writeback_done = PTHREAD_COND_INITIALIZER;
+
+static writeback_item_t *queue_head = NULL;
+static writeback_item_t *queue_tail = NULL;
+/* item being written by the thread, no longer in the queue */
+static writeback_item_t *writing = NULL;
+static size_t pending_bytes = 0;
+
+static int thread_started = 0;
+static int thread_failed = 0;
+static pthread_t writeback_thread;
+
+static void *writeback_thread_main(void *unused)
+{
+    writeback_item_t *item;
+    int res;
+
+    pthread_mutex_lock(&writeback_lock);
+    while (1) {
+        while (queue_head == NULL) {
+            pthread_cond_wait(&writeback_queued, &writeback_lock);
+        }
+        item = queue_head;
+        queue_head = item->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        writing = item;
+        pthread_mutex_unlock(&writeback_lock);
+
+        res = util_fpwrite(item->fsimage->fd, item->data, item->num, item->offset);
+        if (res >= 0) {
+            /* Make the write visible to other readers of the file.  */
+            fflush(item->fsimage->fd);
+        }
+
+        pthread_mutex_lock(&writeback_lock);
+        if (res < 0) {
+            log_error(fsimage_writeback_log, "Error writing %lu bytes at %ld to `%s'.",
+                      (unsigned long)item->num, item->offset, item->fsimage->name);
+            item->fsimage->writeback_error = 1;
+        }
+        writing = NULL;
+        pending_bytes -= item->num;
+        pthread_cond_broadcast(&writeback_done);
+        lib_free(item->data);
+        lib_free(item);
+    }
+
+    return NULL;
+}
+
+static int start_thread(void)
+{
+    if (!thread_started && !thread_failed) {
+        if (pthread_create(&writeback_thread, NULL, writeback_thread_main, NULL)) {
+            log_error(fsimage_writeback_log,
+                      "Cannot start disk image writer thread, writing directly.");
+            thread_failed = 1;
+        } else {
+            pthread_detach(writeback_thread);
+            thread_started = 1;
+        }
+    }
+    return thread_started;
+}
+
+/* Is anything of `fsimage' (or of any image if NULL) queued or being
+   written?  */
+static int is_pending(const fsimage_t *fsimage)
+{
+    writeback_item_t *item;
+
+    if (writing != NULL && (fsimage == NULL || writing->fsimage == fsimage)) {
+        return 1;
+    }
+    for (item = queue_head; item != NULL; item = item->next) {
+        if (fsimage == NULL || item->fsimage == fsimage) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Find a queued write of the same range that can take the new data.  */
+static writeback_item_t *find_replaceable(const fsimage_t *fsimage, size_t num, long offset)
+{
+    writeback_item_t *item, *found = NULL;
+
+    /* The queue is singly linked, so walk all of it and keep the last
+       match; any overlapping write after that match makes it unusable.  */
+    for (item = queue_head; item != NULL; item = item->next) {
+        if (item->fsimage != fsimage) {
+            continue;
+        }
+        if (item->offset == offset && item->num == num) {
+            found = item;
+        } else if (found != NULL
+                   && item->offset < offset + (long)num
+                   && offset < item->offset + (long)item->num) {
+            found = NULL;
+        }
+    }
+    return found;
+}
+
+/** \brief  Queue a write to the file of a disk image
+ *
+ * The data is copied, \a buf can be reused when this returns.
+ *
+ * \param[in]   fsimage image
+ * \param[in]   buf     data
+ * \param[in]   num     size of the data
+ * \param[in]   offset  position in the file
+ *
+ * \return  0 on success, -1 if writing directly failed
+ */
+int fsimage_writeback_write(fsimage_t *fsimage, const void *buf, size_t num, long offset)
+{
+    writeback_item_t *item;
+
+    if (num == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writeback_lock);
+
+    if (!start_thread()) {
+        pthread_mutex_unlock(&writeback_lock);
+        if (util_fpwrite(fsimage->fd, buf, num, offset) < 0) {
+            return -1;
+        }
+        fflush(fsimage->fd);
+        return 0;
+    }
+
+    item = find_replaceable(fsimage, num, offset);
+    if (item != NULL) {
+        memcpy(item->data, buf, num);
+        pthread_mutex_unlock(&writeback_lock);
+        return 0;
+    }
+
+    while (pending_bytes > WRITEBACK_MAX_PENDING) {
+        pthread_cond_wait(&writeback_done, &writeback_lock);
+    }
+
+    item = lib_malloc(sizeof(writeback_item_t));
+    item->fsimage = fsimage;
+    item->offset = offset;
+    item->num = num;
+    item->data = lib_malloc(num);
+    item->next = NULL;
+    memcpy(item->data, buf, num);
+
+    if (queue_tail == NULL) {
+        queue_head = item;
+    } else {
+        queue_tail->next = item;
+    }
+    queue_tail = item;
+    pending_bytes += num;
+
+    pthread_cond_signal(&writeback_queued);
+    pthread_mutex_unlock(&writeback_lock);
+
+    return 0;
+}
+
+/** \brief  Wait until all queued writes to a disk image are done
+ *
+ * \param[in]   fsimage image
+ *
+ * \return  0 on success, -1 if one of the writes since the last flush
+ *          failed
+ */
+int fsimage_writeback_flush(fsimage_t *fsimage)
+{
+    int rc;
+
+    pthread_mutex_lock(&writeback_lock);
+    while (is_pending(fsimage)) {
+        pthread_cond_wait(&writeback_done, &writeback_lock);
+    }
+    rc = fsimage->writeback_error ? -1 : 0;
+    fsimage->writeback_error = 0;
+    pthread_mutex_unlock(&writeback_lock);
+
+    return rc;
+}
+
+/** \brief  Wait until all queued writes to all disk images are done
+ */
+void fsimage_writeback_flush_all(void)
+{
+    pthread_mutex_lock(&writeback_lock);
+    while (is_pending(NULL)) {
+        pthread_cond_wait(&writeback_done, &writeback_lock);
+    }
+    pthread_mutex_unlock(&writeback_lock);
+}
+
+void fsimage_writeback_init(void)
+{
+    fsimage_writeback_log = log_open("Filesystem Image Writeback");
+}
@@ -36,6 +36,7 @@
 #include "fsimage-gcr.h"
 #include "fsimage-p64.h"
 #include "fsimage-probe.h"
+#include "fsimage-writeback.h"
 #include "fsimage.h"
 #include "lib.h"
 #include "log.h"
@@ -93,6 +94,9 @@ void *fsimage_fd_get(const disk_image_t *image)
 
     fsimage = image->media.fsimage;
 
+    if (fsimage->fd != NULL) {
+        fsimage_writeback_flush(fsimage);
+    }
     return (void *)(fsimage->fd);
 }
 
@@ -186,6 +190,10 @@ int fsimage_close(disk_image_t *image)
         fsimage_write_p64_image(image);
     }
 
+    if (fsimage_writeback_flush(fsimage) < 0) {
+        log_error(fsimage_log, "Some writes to `%s' failed.", fsimage->name);
+    }
+
     if (fsimage->error_info.map) {
         lib_free(fsimage->error_info.map);
         fsimage->error_info.map = NULL;
@@ -209,6 +217,8 @@ int fsimage_read_sector(const disk_image_t *image, uint8_t *buf, const disk_addr
         return CBMDOS_IPE_NOT_READY;
     }
 
+    fsimage_writeback_flush(fsimage);
+
     switch (image->type) {
         case DISK_IMAGE_TYPE_D64:
         case DISK_IMAGE_TYPE_D67:
@@ -296,6 +306,7 @@ void fsimage_init(void)
     fsimage_gcr_init();
     fsimage_p64_init();
     fsimage_probe_init();
+    fsimage_writeback_init();
 }
 
 /*-----------------------------------------------------------------------*/
@@ -305,5 +316,6 @@ off_t fsimage_size(const disk_image_t *image)
     fsimage_t *fsimage;
 
     fsimage = image->media.fsimage;
+    fsimage_writeback_flush(fsimage);
     return archdep_file_size(fsimage->fd);
 }
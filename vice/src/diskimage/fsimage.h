@@ -42,6 +42,8 @@ typedef struct fsimage_s {
         int dirty;
         int len;
     } error_info;
+    /* a background write failed, see fsimage-writeback.c */
+    int writeback_error;
 } fsimage_t;
 
 
@@ -295,6 +295,7 @@ static int set_drive_idling_method(int val, void *param)
         case DRIVE_IDLE_SKIP_CYCLES:
         case DRIVE_IDLE_TRAP_IDLE:
         case DRIVE_IDLE_NO_IDLE:
+        case DRIVE_IDLE_FAST_FORWARD:
             break;
         default:
             return -1;
@@ -130,6 +130,7 @@ int drive_snapshot_write_module(snapshot_t *s, int save_disks, int save_roms)
     }
 
     drive_gcr_data_writeback_all();
+    disk_image_flush_all();
     rotation_table_get(rotation_table_ptr); /* FIXME: should this not be per drive rather than unit? */
 
     for (unr = 0; unr < NUM_DISK_UNITS; unr++) {
@@ -837,6 +838,7 @@ static int drive_snapshot_write_gcrimage_module(snapshot_t *s, unsigned int dnr)
     }
 
     /* Write half track data */
+    gcr_encode_all_tracks(drive->gcr);
     for (i = 0; i < num_half_tracks; i++) {
         data = drive->gcr->tracks[i].data;
         track_size = data ? drive->gcr->tracks[i].size : 0;
@@ -895,6 +897,9 @@ static int drive_snapshot_read_gcrimage_module(snapshot_t *s, unsigned int dnr)
         return -1;
     }
 
+    /* the tracks of the snapshot replace those of the image */
+    gcr_set_encoder(drive->gcr, NULL, NULL);
+
     for (i = 0; i < num_half_tracks; i++) {
         if (SMR_DW(m, &track_size) < 0
             || track_size > NUM_MAX_MEM_BYTES_TRACK) {
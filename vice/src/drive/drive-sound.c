@@ -1429,15 +1429,61 @@ static const signed char *motor[NUM_DISK_UNITS];
 static int stepvol[NUM_DISK_UNITS];
 static int motorvol[NUM_DISK_UNITS];
 
+/* Units with a motor or head sound playing, bit n for unit n.  Only these
+   are mixed and advanced.  */
+static unsigned int active_units;
+
 static int cycles_per_sec = 1000000;
 static int sample_rate = 22050;
 
+/* Move the sounds of the active units on by one sample.  */
+static void drive_sound_advance(void)
+{
+    unsigned int units;
+    int j;
+
+    for (units = active_units, j = 0; units != 0; units >>= 1, j++) {
+        if (!(units & 1)) {
+            continue;
+        }
+        motor[j]++;
+        if (motor[j] == &spinup[sizeof(spinup)]) {
+            motor[j] = hum;
+        }
+        if (motor[j] == &hum[sizeof(hum)]) {
+            motor[j] = hum;
+        }
+        if (motor[j] == &spindown[sizeof(spindown)]) {
+            motor[j] = nosound;
+        }
+        if (motor[j] == nosound + 1) {
+            motor[j] = nosound;
+        }
+        step[j]++;
+        if (step[j] == &stepping[sizeof(stepping)]) {
+            step[j] = nosound;
+        }
+        if (step[j] == &stepping2[sizeof(stepping2)]) {
+            step[j] = nosound;
+        }
+        if (step[j] == &bump[sizeof(bump)]) {
+            step[j] = nosound;
+        }
+        if (step[j] == nosound + 1) {
+            step[j] = nosound;
+        }
+        if (motor[j] == nosound && step[j] == nosound) {
+            active_units &= ~(1U << j);
+        }
+    }
+}
+
 /* resources */
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int scc, CLOCK *delta_t)
 {
-    int i, j, nos = 0;
+    int i, j;
     static int div = 0;
     float m, s;
 
@@ -1445,6 +1491,9 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, in
         pbuf[i] = 0.0;
 
         for (j = 0; j < NUM_DISK_UNITS; j++) {
+            if (!(active_units & (1U << j))) {
+                continue;
+            }
             m = ((((*motor[j]) * motorvol[j]) * drive_sound_emulation_volume) >> 8) / 32767.0;
             s = ((((*step[j]) * stepvol[j]) * drive_sound_emulation_volume) >> 8) / 32767.0;
 
@@ -1454,42 +1503,10 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, in
         div += 44100;
         while (div >= sample_rate) {
             div -= sample_rate;
-            nos = 1;
-            for (j = 0; j < NUM_DISK_UNITS; j++) {
-                motor[j]++;
-                if (motor[j] == &spinup[sizeof(spinup)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &hum[sizeof(hum)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &spindown[sizeof(spindown)]) {
-                    motor[j] = nosound;
-                }
-                if (motor[j] == nosound + 1) {
-                    motor[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-                step[j]++;
-                if (step[j] == &stepping[sizeof(stepping)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &stepping2[sizeof(stepping2)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &bump[sizeof(bump)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == nosound + 1) {
-                    step[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-            }
+            drive_sound_advance();
         }
     }
-    if (nos) {
+    if (!active_units) {
         drive_sound.chip_enabled = 0;
     }
     return nr;
@@ -1497,12 +1514,15 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, in
 #else
 static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
-    int i, j, nos = 0;
+    int i, j;
     static int div = 0;
     int m, s;
 
     for (i = 0; i < nr; i++) {
         for (j = 0; j < NUM_DISK_UNITS; j++) {
+            if (!(active_units & (1U << j))) {
+                continue;
+            }
             m = (((*motor[j]) * motorvol[j]) * drive_sound_emulation_volume) >> 8;
             s = (((*step[j]) * stepvol[j]) * drive_sound_emulation_volume) >> 8;
             switch (soc) {
@@ -1522,42 +1542,10 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf,
         div += 44100;
         while (div >= sample_rate) {
             div -= sample_rate;
-            nos = 1;
-            for (j = 0; j < NUM_DISK_UNITS; j++) {
-                motor[j]++;
-                if (motor[j] == &spinup[sizeof(spinup)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &hum[sizeof(hum)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &spindown[sizeof(spindown)]) {
-                    motor[j] = nosound;
-                }
-                if (motor[j] == nosound + 1) {
-                    motor[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-                step[j]++;
-                if (step[j] == &stepping[sizeof(stepping)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &stepping2[sizeof(stepping2)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &bump[sizeof(bump)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == nosound + 1) {
-                    step[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-            }
+            drive_sound_advance();
         }
     }
-    if (nos) {
+    if (!active_units) {
         drive_sound.chip_enabled = 0;
     }
     return nr;
@@ -1618,10 +1606,12 @@ void drive_sound_update(int i, int unit)
     switch (i) {
         case DRIVE_SOUND_MOTOR_ON:
             motor[unit] = spinup;
+            active_units |= 1U << unit;
             drive_sound.chip_enabled = 1;
             break;
         case DRIVE_SOUND_MOTOR_OFF:
             motor[unit] = spindown;
+            active_units |= 1U << unit;
             drive_sound.chip_enabled = 1;
             break;
     }
@@ -1639,9 +1629,11 @@ void drive_sound_head(int track, int dir, int unit)
         if (step[unit] == nosound) {
             drive_sound.chip_enabled = 1;
             step[unit] = bump;
+            active_units |= 1U << unit;
         }
     } else {
         step[unit] = (track < 18) ? stepping : stepping2;
+        active_units |= 1U << unit;
         drive_sound.chip_enabled = 1;
     }
 }
@@ -1654,6 +1646,7 @@ void drive_sound_stop(void)
         step[i] = nosound;
         stepvol[i] = 0;
     }
+    active_units = 0;
     drive_sound.chip_enabled = 0;
 }
 
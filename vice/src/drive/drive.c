@@ -48,6 +48,7 @@
 
 #include "attach.h"
 #include "archdep.h"
+#include "benchmark.h"
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive-check.h"
@@ -58,6 +59,7 @@
 #include "drivesync.h"
 #include "driverom.h"
 #include "drivetypes.h"
+#include "frametrace.h"
 #include "gcr.h"
 #include "iecbus.h"
 #include "iecdrive.h"
@@ -66,6 +68,7 @@
 #include "machine-drive.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "metrics.h"
 #include "resources.h"
 #include "rotation.h"
 #include "sound.h"
@@ -690,6 +693,7 @@ void drive_set_half_track(int num, int side, drive_t *dptr)
 {
     unsigned int type = dptr->diskunit->type;
     int tmp;
+    disk_track_t *track;
 
     if ((type == DRIVE_TYPE_1540
          || type == DRIVE_TYPE_1541
@@ -718,18 +722,23 @@ void drive_set_half_track(int num, int side, drive_t *dptr)
     /* FIXME: why would the offset be different for D71 and G71? */
     tmp = (dptr->image && dptr->image->type == DISK_IMAGE_TYPE_G71) ? DRIVE_HALFTRACKS_1571 : 70;
 
-    dptr->GCR_track_start_ptr = dptr->gcr->tracks[dptr->current_half_track - 2 + (dptr->side * tmp)].data;
+    /* a track the drive wrote to must not be encoded again */
+    if (dptr->GCR_dirty_track && dptr->gcr->current_track >= 0) {
+        gcr_keep_track(dptr->gcr, (unsigned int)dptr->gcr->current_track);
+    }
+    dptr->gcr->current_track = dptr->current_half_track - 2 + (dptr->side * tmp);
+    track = gcr_get_track(dptr->gcr, (unsigned int)dptr->gcr->current_track);
+
+    dptr->GCR_track_start_ptr = track->data;
 
     if (dptr->GCR_current_track_size != 0) {
-        dptr->GCR_head_offset = (dptr->GCR_head_offset
-                                 * dptr->gcr->tracks[dptr->current_half_track - 2 + (dptr->side * tmp)].size)
+        dptr->GCR_head_offset = (dptr->GCR_head_offset * track->size)
                                 / dptr->GCR_current_track_size;
     } else {
         dptr->GCR_head_offset = 0;
     }
 
-    dptr->GCR_current_track_size =
-        dptr->gcr->tracks[dptr->current_half_track - 2 + (dptr->side * tmp)].size;
+    dptr->GCR_current_track_size = track->size;
 }
 
 /*-------------------------------------------------------------------------- */
@@ -768,11 +777,14 @@ void drive_gcr_data_writeback(drive_t *drive)
         return;
     }
 
+    /* the track must not be encoded from the image again */
+    gcr_keep_track(drive->gcr, half_track - 2);
+
     /* always write track to GCR images, no need to extend the image */
     if ((drive->image->type == DISK_IMAGE_TYPE_G64) ||
         (drive->image->type == DISK_IMAGE_TYPE_G71)) {
         disk_image_write_half_track(drive->image, half_track,
-                                    &drive->gcr->tracks[half_track - 2]);
+                                    gcr_get_track(drive->gcr, half_track - 2));
         drive->GCR_dirty_track = 0;
         return;
     }
@@ -834,13 +846,14 @@ void drive_gcr_data_writeback(drive_t *drive)
         DBG(("extend track: %u drive->image->max_half_tracks: %u drive->image->tracks: %u", track, drive->image->max_half_tracks, drive->image->tracks));
         while (half_track < end_half_track) {
             DBG(("write halftrack: %u end: %u track: %u", half_track, end_half_track, half_track / 2));
-            disk_image_write_half_track(drive->image, half_track, &drive->gcr->tracks[half_track - 2]);
+            gcr_keep_track(drive->gcr, half_track - 2);
+            disk_image_write_half_track(drive->image, half_track, gcr_get_track(drive->gcr, half_track - 2));
             half_track += 2;
         }
     } else {
         /* write (only) the requested track */
         DBG(("write track: %u drive->image->max_half_tracks: %u drive->image->tracks: %u", track, drive->image->max_half_tracks, drive->image->tracks));
-        disk_image_write_half_track(drive->image, half_track, &drive->gcr->tracks[half_track - 2]);
+        disk_image_write_half_track(drive->image, half_track, gcr_get_track(drive->gcr, half_track - 2));
     }
 
     drive->GCR_dirty_track = 0;
@@ -968,6 +981,33 @@ void drive_update_ui_status(void)
     }
 }
 
+/** \brief  Check if any emulated drive is working
+ *
+ * \return  1 if the motor or the LED of a drive with true drive emulation
+ *          is on
+ */
+int drive_is_busy(void)
+{
+    int i, d;
+
+    for (i = 0; i < NUM_DISK_UNITS; i++) {
+        diskunit_context_t *unit = diskunit_context[i];
+
+        if (!unit->enable) {
+            continue;
+        }
+        for (d = 0; d < (drive_check_dual(unit->type) ? 2 : 1); d++) {
+            drive_t *drive = unit->drives[d];
+
+            if ((drive->byte_ready_active & BRA_MOTOR_ON)
+                || (drive->led_status & 1)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 int drive_num_leds(unsigned int dnr)
 {
     diskunit_context_t *unit = diskunit_context[dnr];
@@ -990,14 +1030,31 @@ int drive_num_leds(unsigned int dnr)
 
 void drive_cpu_execute_one(diskunit_context_t *drv, CLOCK clk_value)
 {
+    uint64_t bench_start;
+
+    if (clk_value > drv->cpu->last_clk) {
+        metrics_histogram_observe(METRIC_DRIVE_CATCHUP, clk_value - drv->cpu->last_clk);
+    }
+
+    FRAMETRACE_BEGIN(FRAMETRACE_DRIVES);
+    BENCHMARK_BEGIN(bench_start);
     if (drv->type == DRIVE_TYPE_2000 || drv->type == DRIVE_TYPE_4000 ||
         drv->type == DRIVE_TYPE_CMDHD) {
         drivecpu65c02_execute(drv, clk_value);
     } else {
         drivecpu_execute(drv, clk_value);
     }
+    BENCHMARK_END(BENCHMARK_DRIVES, bench_start);
+    FRAMETRACE_END(FRAMETRACE_DRIVES);
 }
 
+/* Catch up all drives to `clk_value'.  The units are run one after the
+   other on purpose: they share the IEC bus and parallel cable state, and
+   a unit that runs later sees the line changes of the units run before
+   it.  Running them on separate threads would need every bus access to
+   be cycle-stamped and a whole drive (CPU, VIAs/CIAs, alarms, rotation)
+   to be rolled back on a conflict to keep the results identical, which
+   the drive code does not support.  */
 void drive_cpu_execute_all(CLOCK clk_value)
 {
     unsigned int dnr;
@@ -1036,7 +1093,8 @@ void drive_vsync_hook(void)
             if (unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
                 drive_cpu_execute_one(diskunit_context[dnr], maincpu_clk);
             }
-            if (unit->idling_method == DRIVE_IDLE_NO_IDLE) {
+            if (unit->idling_method == DRIVE_IDLE_NO_IDLE
+                || unit->idling_method == DRIVE_IDLE_FAST_FORWARD) {
                 /* if drive is never idle, also rotate the disk. this prevents
                  * huge peaks in cpu usage when the drive must catch up with
                  * a longer period of time.
@@ -1067,6 +1125,7 @@ static void drive_setup_context_for_unit(diskunit_context_t *drv,
     }
 
     drv->clk_ptr = &diskunit_clk[unr];
+    drv->idle_loop = -1;
 
     drivecpu_setup_context(drv, 1); /* no need for 65c02, only allocating common stuff */
 
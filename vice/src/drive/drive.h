@@ -75,15 +75,19 @@
 /* Upped to 64K due to CMD HD */
 #define DRIVE_RAM_SIZE 0x10000
 
+/* Size of the drive RAM compared by the idle loop fast-forward.  */
+#define DRIVE_IDLE_FF_RAM_SIZE 0x800
+
 /* Extended disk image handling.  */
 #define DRIVE_EXTEND_NEVER  0
 #define DRIVE_EXTEND_ASK    1
 #define DRIVE_EXTEND_ACCESS 2
 
 /* Drive idling methods.  */
-#define DRIVE_IDLE_NO_IDLE     0
-#define DRIVE_IDLE_SKIP_CYCLES 1
-#define DRIVE_IDLE_TRAP_IDLE   2
+#define DRIVE_IDLE_NO_IDLE      0
+#define DRIVE_IDLE_SKIP_CYCLES  1
+#define DRIVE_IDLE_TRAP_IDLE    2
+#define DRIVE_IDLE_FAST_FORWARD 3
 
 /* Drive type ID's and names. When adding things here, please also update
  * the `drive_type_info_list` array in src/drive/drive.c to keep UI's current
@@ -432,6 +436,7 @@ int drive_check_stardos(int drive_type);
 int drive_check_rtc(int drive_type);
 int drive_check_iec(int drive_type);
 int drive_num_leds(unsigned int dnr);
+int drive_is_busy(void);
 
 int drive_get_type_by_devnr(int devnr);
 int drive_is_dualdrive_by_devnr(int devnr);
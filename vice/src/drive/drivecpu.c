@@ -50,10 +50,12 @@
 #include "mem.h"
 #include "monitor.h"
 #include "mos6510.h"
+#include "perfcounters.h"
 #include "rotation.h"
 #include "snapshot.h"
 #include "types.h"
 #include "uiapi.h"
+#include "via.h"
 
 
 #define DRIVE_CPU
@@ -289,6 +291,83 @@ inline static uint32_t drive_trap_handler(diskunit_context_t *drv)
     return (uint32_t)-1;
 }
 
+/* Fast-forward through the DOS idle loop (`DRIVE_IDLE_FAST_FORWARD').
+   This is called whenever the drive CPU is about to execute the head of
+   the idle loop.  The loop iteration only depends on the registers, the
+   RAM and VIA2 port B; if all of them are the same as at the previous loop
+   head, no interrupt or alarm occurred in between and the inputs could not
+   change (same call of `drivecpu_execute()', motor off, no disk change in
+   progress), every following iteration is identical to the last one.
+   The clock is then advanced by a whole number of iterations, as long as
+   it stays before the next alarm and below `stop_clk', so the drive ends
+   up in exactly the state normal emulation would have reached.  */
+static void drive_idle_fast_forward(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    interrupt_cpu_status_t *cs = cpu->int_status;
+    drive_t *drive = drv->drives[0];
+    CLOCK clk = *(drv->clk_ptr);
+    CLOCK alarm_clk = alarm_context_next_pending_clk(cpu->alarm_context);
+    CLOCK period, limit;
+
+    /* Inputs read by the loop that may change over time, and things that
+       must see every single iteration.  */
+    if ((drive->byte_ready_active & BRA_MOTOR_ON) != 0
+        || drive->attach_clk != (CLOCK)0
+        || drive->detach_clk != (CLOCK)0
+        || drive->attach_detach_clk != (CLOCK)0
+        || cs->global_pending_int != IK_NONE
+        || monitor_mask[cpu->monspace] != 0
+#ifdef DEBUG
+        || debug.drivecpu_traceflg[drv->mynumber]
+#endif
+        ) {
+        drv->idle_ff_valid = 0;
+        return;
+    }
+
+    /* No ATN pending ($7C), no channel active ($6F, $70) and no LED blink
+       ($026C): the iteration neither leaves the loop nor touches anything
+       but the RAM and $1C00.  */
+    if (drv->idle_ff_valid
+        && drv->idle_ff_stop_clk == cpu->stop_clk
+        && drv->idle_ff_alarm_clk == alarm_clk
+        && cs->irq_clk < drv->idle_ff_clk
+        && cs->nmi_clk < drv->idle_ff_clk
+        && drv->drive_ram[0x7c] == 0
+        && drv->drive_ram[0x6f] == 0
+        && drv->drive_ram[0x70] == 0
+        && drv->drive_ram[0x26c] == 0
+        && drv->idle_ff_regs.a == cpu->cpu_regs.a
+        && drv->idle_ff_regs.x == cpu->cpu_regs.x
+        && drv->idle_ff_regs.y == cpu->cpu_regs.y
+        && drv->idle_ff_regs.sp == cpu->cpu_regs.sp
+        && drv->idle_ff_regs.p == cpu->cpu_regs.p
+        && drv->idle_ff_regs.n == cpu->cpu_regs.n
+        && drv->idle_ff_regs.z == cpu->cpu_regs.z
+        && drv->idle_ff_prb == drv->via2->via[VIA_PRB]
+        && drv->idle_ff_ddrb == drv->via2->via[VIA_DDRB]
+        && memcmp(drv->idle_ff_ram, drv->drive_ram, DRIVE_IDLE_FF_RAM_SIZE) == 0) {
+        period = clk - drv->idle_ff_clk;
+        limit = (alarm_clk < cpu->stop_clk) ? alarm_clk : cpu->stop_clk - 1;
+        if (limit >= clk + period) {
+            clk += ((limit - clk) / period) * period;
+            *(drv->clk_ptr) = clk;
+        }
+        drv->idle_ff_clk = clk;
+        return;
+    }
+
+    drv->idle_ff_valid = 1;
+    drv->idle_ff_clk = clk;
+    drv->idle_ff_stop_clk = cpu->stop_clk;
+    drv->idle_ff_alarm_clk = alarm_clk;
+    drv->idle_ff_regs = cpu->cpu_regs;
+    drv->idle_ff_prb = drv->via2->via[VIA_PRB];
+    drv->idle_ff_ddrb = drv->via2->via[VIA_DDRB];
+    memcpy(drv->idle_ff_ram, drv->drive_ram, DRIVE_IDLE_FF_RAM_SIZE);
+}
+
 static void drive_generic_dma(void)
 {
     /* Generic DMA hosts can be implemented here.
@@ -391,6 +470,10 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
     /* Run drive CPU emulation until the stop_clk clock has been reached. */
     while (*drv->clk_ptr < cpu->stop_clk) {
+        if (reg_pc == (unsigned int)drv->idle_loop) {
+            drive_idle_fast_forward(drv);
+        }
+
 /* Include the 6502/6510 CPU emulation core.  */
 #define CPU_LOG_ID (drv->log)
 /* #define ANE_LOG_LEVEL ane_log_level */
@@ -432,6 +515,8 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
 #define drivecpu_byte_ready() (drv->drives[0]->byte_ready_edge)
 
+#define FETCH_OPCODE_DIRECT_DONE(lastbyte) (cpu->cpu_last_data = (uint8_t)(lastbyte))
+
 #define cpu_reset() (cpu_reset)(drv)
 #define bank_limit (cpu->d_bank_limit)
 #define bank_start (cpu->d_bank_start)
@@ -661,7 +746,7 @@ int drivecpu_snapshot_read_module(diskunit_context_t *drv, snapshot_t *s)
     MOS6510_REGS_SET_PC(&(cpu->cpu_regs), pc);
     MOS6510_REGS_SET_STATUS(&(cpu->cpu_regs), status);
 
-    log_message(drv->log, "RESET (For undump).");
+    log_verbose(drv->log, "RESET (For undump).");
 
     interrupt_cpu_status_reset(cpu->int_status);
 
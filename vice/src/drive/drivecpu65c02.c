@@ -43,6 +43,7 @@
 #include "machine.h"
 #include "mem.h"
 #include "monitor.h"
+#include "perfcounters.h"
 #include "r65c02.h"
 #include "rotation.h"
 #include "snapshot.h"
@@ -536,7 +537,7 @@ int drivecpu65c02_snapshot_read_module(diskunit_context_t *drv, snapshot_t *s)
     R65C02_REGS_SET_PC(&(cpu->cpu_R65C02_regs), pc);
     R65C02_REGS_SET_STATUS(&(cpu->cpu_R65C02_regs), status);
 
-    log_message(drv->log, "RESET (For undump).");
+    log_verbose(drv->log, "RESET (For undump).");
 
     interrupt_cpu_status_reset(cpu->int_status);
 
@@ -268,6 +268,7 @@ int drive_image_detach(disk_image_t *image, unsigned int unit, unsigned int drv)
         drive_gcr_data_writeback(drive);
     }
 
+    gcr_set_encoder(drive->gcr, NULL, NULL);
     for (i = 0; i < MAX_GCR_TRACKS; i++) {
         if (drive->gcr->tracks[i].data) {
             lib_free(drive->gcr->tracks[i].data);
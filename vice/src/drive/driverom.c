@@ -239,10 +239,34 @@ void driverom_initialize_traps(diskunit_context_t *unit)
 
     unit->trap = -1;
     unit->trapcont = -1;
+    unit->idle_loop = -1;
+    unit->idle_ff_valid = 0;
 
     DBG(("driverom_initialize_traps type: %u trap idle: %s", unit->type,
            unit->idling_method == DRIVE_IDLE_TRAP_IDLE ? "enabled" : "disabled"));
 
+    if (unit->idling_method == DRIVE_IDLE_FAST_FORWARD) {
+        /* The ROM is left unpatched, only the 1541 family idle loop is
+           known to be safe for fast-forwarding (see drivecpu.c).  */
+        switch (unit->type) {
+            case DRIVE_TYPE_1540:
+            case DRIVE_TYPE_1541:
+            case DRIVE_TYPE_1541II:
+            case DRIVE_TYPE_1570:
+            case DRIVE_TYPE_1571:
+            case DRIVE_TYPE_1571CR:
+                if (unit->rom[0xec9b - 0x8000] == 0x4c
+                    && unit->rom[0xec9b - 0x8000 + 1] == 0xff
+                    && unit->rom[0xec9b - 0x8000 + 2] == 0xeb) {
+                    unit->idle_loop = 0xebff;
+                }
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
     if (unit->idling_method != DRIVE_IDLE_TRAP_IDLE) {
         return;
     }
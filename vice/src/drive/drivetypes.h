@@ -248,6 +248,19 @@ typedef struct diskunit_context_s {
     uint8_t trap_rom[DRIVE_ROM_SIZE];
     int trap, trapcont;
 
+    /* DOS idle loop fast-forward (`DRIVE_IDLE_FAST_FORWARD').  `idle_loop'
+       is the address of the head of the idle loop, or -1 if the ROM does
+       not have a known one.  The other fields hold the drive state seen
+       the last time the loop head was reached.  */
+    int idle_loop;
+    int idle_ff_valid;
+    CLOCK idle_ff_clk;
+    CLOCK idle_ff_stop_clk;
+    CLOCK idle_ff_alarm_clk;
+    mos6510_regs_t idle_ff_regs;
+    uint8_t idle_ff_prb, idle_ff_ddrb;
+    uint8_t idle_ff_ram[DRIVE_IDLE_FF_RAM_SIZE];
+
     /* Drive RAM */
     uint8_t drive_ram[DRIVE_RAM_SIZE];
 
@@ -54,9 +54,20 @@
 
 const int fdd_data_rates[4] = { 500, 300, 250, 1000 }; /* kbit/s */
 #define INDEXLEN (16)
+
+/* Every track and head combination the head can be on */
+#define FDD_TRACK_CACHE_SIZE ((FDD_MAX_TRACK + 1) * 2)
+
 static void fdd_flush_raw(fd_drive_t *drv);
+static void fdd_track_cache_clear(fd_drive_t *drv);
 static uint16_t *crc1021 = NULL;
 
+/* A track encoded in MFM, see raw in fd_drive_s */
+typedef struct fdd_raw_track_s {
+    uint8_t *data;
+    uint8_t *sync;
+} fdd_raw_track_t;
+
 struct fd_drive_s {
     char *myname;
     int number;
@@ -84,9 +95,15 @@ struct fd_drive_s {
         int size;
         int track_head;
         int dirty;
+        int written; /* written to since it was encoded */
         uint8_t *data;
         uint8_t *sync;
     } raw;
+    /* Tracks encoded earlier, so that going back to them or switching the
+       head does not encode them from the image again.  Tracks that were
+       written to are not kept, those are always encoded again from what
+       ended up in the image.  */
+    fdd_raw_track_t track_cache[FDD_TRACK_CACHE_SIZE];
 };
 
 fd_drive_t *fdd_init(int num, drive_t *drive)
@@ -145,10 +162,23 @@ void fdd_shutdown(fd_drive_t *drv)
         /* prevent multiple instances of fdd_shutdown to unallocate this table */
         crc1021 = NULL;
     }
+    fdd_track_cache_clear(drv);
     lib_free(drv->myname);
     lib_free(drv);
 }
 
+static void fdd_track_cache_clear(fd_drive_t *drv)
+{
+    int i;
+
+    for (i = 0; i < FDD_TRACK_CACHE_SIZE; i++) {
+        lib_free(drv->track_cache[i].data);
+        drv->track_cache[i].data = NULL;
+        lib_free(drv->track_cache[i].sync);
+        drv->track_cache[i].sync = NULL;
+    }
+}
+
 void fdd_image_attach(fd_drive_t *drv, struct disk_image_s *image)
 {
     if (!drv) {
@@ -213,8 +243,10 @@ void fdd_image_attach(fd_drive_t *drv, struct disk_image_s *image)
     drv->raw.sync = lib_calloc(1, (size_t)((drv->raw.size + 7) >> 3));
     drv->raw.track_head = -1;
     drv->raw.dirty = 0;
+    drv->raw.written = 0;
     drv->raw.head = 0;
     /*drv->write_beyond = 0;*/
+    fdd_track_cache_clear(drv);
 
     drv->disk_change = 1;
     drv->write_protect = (int)(image->read_only);
@@ -226,6 +258,7 @@ void fdd_image_detach(fd_drive_t *drv)
         return;
     }
     fdd_flush_raw(drv);
+    fdd_track_cache_clear(drv);
     drv->image = NULL;
     lib_free(drv->raw.data);
     drv->raw.data = NULL;
@@ -445,7 +478,32 @@ static void fdd_update_raw(fd_drive_t *drv)
     if (drv->raw.dirty) {
         fdd_flush_raw(drv);
     }
+
+    /* keep the track if it still matches the image, and take the new one
+       from the cache if it was encoded before */
+    if (drv->raw.track_head >= 0 && drv->raw.track_head < FDD_TRACK_CACHE_SIZE
+        && !drv->raw.written && drv->track_cache[drv->raw.track_head].data == NULL) {
+        drv->track_cache[drv->raw.track_head].data = drv->raw.data;
+        drv->track_cache[drv->raw.track_head].sync = drv->raw.sync;
+        drv->raw.data = NULL;
+        drv->raw.sync = NULL;
+    }
     drv->raw.track_head = drv->track * 2 + drv->head;
+    drv->raw.written = 0;
+
+    if (drv->track_cache[drv->raw.track_head].data != NULL) {
+        lib_free(drv->raw.data);
+        lib_free(drv->raw.sync);
+        drv->raw.data = drv->track_cache[drv->raw.track_head].data;
+        drv->raw.sync = drv->track_cache[drv->raw.track_head].sync;
+        drv->track_cache[drv->raw.track_head].data = NULL;
+        drv->track_cache[drv->raw.track_head].sync = NULL;
+        return;
+    }
+    if (drv->raw.data == NULL) {
+        drv->raw.data = lib_malloc((size_t)(drv->raw.size));
+        drv->raw.sync = lib_malloc((size_t)((drv->raw.size + 7) >> 3));
+    }
 
     memset(drv->raw.data, 0x4e, (size_t)(drv->raw.size));
     memset(drv->raw.sync, 0, (size_t)((drv->raw.size + 7) >> 3));
@@ -669,6 +727,7 @@ int fdd_write(fd_drive_t *drv, uint16_t data)
             drv->raw.sync[p >> 3] &= (uint8_t)(0xff7f >> (p & 7));
         }
         drv->raw.dirty = 1;
+        drv->raw.written = 1;
     }
     p++;
     if (p >= drv->raw.size) {
@@ -679,6 +738,39 @@ int fdd_write(fd_drive_t *drv, uint16_t data)
     return 0;
 }
 
+/* Skip the bytes fdd_read() would return up to the next one with the sync
+   flag, which is where an address mark can start.  Stops at the last byte of
+   the track, so the index count is only advanced by fdd_read().  Returns the
+   number of bytes skipped, at most `max', the caller accounts for their
+   time.  */
+int fdd_skip_to_sync(fd_drive_t *drv, int max)
+{
+    int p, end;
+
+    if (!drv || !drv->motor || drv->disk_rate != drv->rate || max <= 0) {
+        return 0;
+    }
+    fdd_update_raw(drv);
+
+    p = drv->raw.head;
+    end = drv->raw.size - 1;
+    if (end - p > max) {
+        end = p + max;
+    }
+    /* whole bytes of the sync bitmap at once */
+    while (p < end && !(drv->raw.sync[p >> 3] & (0x80 >> (p & 7)))) {
+        if (!(p & 7) && p + 8 <= end && !drv->raw.sync[p >> 3]) {
+            p += 8;
+        } else {
+            p++;
+        }
+    }
+
+    max = p - drv->raw.head;
+    drv->raw.head = p;
+    return max;
+}
+
 void fdd_flush(fd_drive_t *drv)
 {
     if (!drv) {
@@ -857,6 +949,8 @@ int fdd_snapshot_read_module(fd_drive_t *drv, struct snapshot_s *s)
 
     drv->raw.size = 25 * fdd_data_rates[drv->disk_rate];
     drv->raw.head %= drv->raw.size;
+    drv->raw.written = 1;
+    fdd_track_cache_clear(drv);
 
     lib_free(drv->raw.data);
     drv->raw.data = lib_malloc((size_t)drv->raw.size);
@@ -42,6 +42,7 @@ void fdd_image_attach(fd_drive_t *drv, struct disk_image_s *image);
 void fdd_image_detach(fd_drive_t *drv);
 uint16_t fdd_read(fd_drive_t *drv);
 int fdd_write(fd_drive_t *drv, uint16_t data);
+int fdd_skip_to_sync(fd_drive_t *drv, int max);
 void fdd_flush(fd_drive_t *drv);
 void fdd_seek_pulse(fd_drive_t *drv, int dir);
 void fdd_select_head(fd_drive_t *drv, int head);
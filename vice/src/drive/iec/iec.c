@@ -323,5 +323,10 @@ void iec_drive_port_default(struct diskunit_context_s *drv)
     if (drive_iecbus != NULL) {
         drive_iecbus->drv_bus[drv->mynumber + 8] = 0xff;
         drive_iecbus->drv_data[drv->mynumber + 8] = 0xff;
+        /* the computer does not calculate the bus again unless its own
+           lines change */
+        if (iecbus_update_ports != NULL) {
+            (*iecbus_update_ports)();
+        }
     }
 }
@@ -166,14 +166,14 @@ void memiec_init(struct diskunit_context_s *drv, unsigned int type)
         if (drv->drive_ram8_enabled) {
             drivemem_set_func(cpud, 0x80, 0xa0, drive_read_ram, drive_store_ram, drive_peek_ram, &drv->drive_ram[0x8000], 0);
         } else {
-            drivemem_set_func(cpud, 0x80, 0xa0, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0);
+            drivemem_set_func(cpud, 0x80, 0xa0, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0x80009ffd);
         }
         if (drv->drive_rama_enabled) {
             drivemem_set_func(cpud, 0xa0, 0xc0, drive_read_ram, drive_store_ram, drive_peek_ram, &drv->drive_ram[0xa000], 0);
         } else {
-            drivemem_set_func(cpud, 0xa0, 0xc0, drive_read_rom, NULL, drive_peek_rom, &drv->trap_rom[0x2000], 0);
+            drivemem_set_func(cpud, 0xa0, 0xc0, drive_read_rom, NULL, drive_peek_rom, &drv->trap_rom[0x2000], 0xa000bffd);
         }
-        drivemem_set_func(cpud, 0xc0, 0x100, drive_read_rom, NULL, drive_peek_rom, &drv->trap_rom[0x4000], 0);
+        drivemem_set_func(cpud, 0xc0, 0x100, drive_read_rom, NULL, drive_peek_rom, &drv->trap_rom[0x4000], 0xc000fffd);
         break;
     case DRIVE_TYPE_1570:
     case DRIVE_TYPE_1571:
@@ -195,7 +195,7 @@ void memiec_init(struct diskunit_context_s *drv, unsigned int type)
         } else {
             drivemem_set_func(cpud, 0x60, 0x80, cia1571_read, cia1571_store, cia1571_peek, NULL, 0);
         }
-        drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0);
+        drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0x8000fffd);
         break;
     case DRIVE_TYPE_1571CR:
         /* The mos5710 IC in the 1571CR drive implements:
@@ -243,7 +243,7 @@ void memiec_init(struct diskunit_context_s *drv, unsigned int type)
         } else {
             drivemem_set_func(cpud, 0x60, 0x80, mos5710_read, mos5710_store, mos5710_peek, NULL, 0);
         }
-        drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0);
+        drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, drive_peek_rom, drv->trap_rom, 0x8000fffd);
         break;
     /* FIXME: check open-i/o behaviour for 1581/65C02, see bug #2113 */
     case DRIVE_TYPE_1581:
@@ -200,6 +200,20 @@ void wd1770_shutdown(wd1770_t *drv)
     lib_free(drv);
 }
 
+/* While looking for an ID mark, skip the bytes that cannot start one in one
+   go instead of reading them one by one, with the same timing.  At least one
+   byte of time is left to read the next one.  */
+static inline void wd1770_skip_to_sync(wd1770_t *drv)
+{
+    int max;
+
+    if (drv->sync) {
+        return;
+    }
+    max = (int)((*drv->cpu_clk_ptr - drv->clk) / BYTE_RATE) - 1;
+    drv->clk += (CLOCK)fdd_skip_to_sync(drv->fdd, max) * BYTE_RATE;
+}
+
 /* Execute microcode */
 static void wd1770_execute(wd1770_t *drv)
 {
@@ -333,6 +347,7 @@ static void wd1770_execute(wd1770_t *drv)
                         if (*drv->cpu_clk_ptr < drv->clk + BYTE_RATE) {
                             return;
                         }
+                        wd1770_skip_to_sync(drv);
                         drv->clk += BYTE_RATE;
                         res = fdd_read(drv->fdd);
                         if (!drv->dden || res != 0x1fe) {
@@ -431,6 +446,7 @@ static void wd1770_execute(wd1770_t *drv)
                         if (*drv->cpu_clk_ptr < drv->clk + BYTE_RATE) {
                             return;
                         }
+                        wd1770_skip_to_sync(drv);
                         drv->clk += BYTE_RATE;
                         res = fdd_read(drv->fdd);
                         if (!drv->dden || res != 0x1fe) {
@@ -680,6 +696,7 @@ static void wd1770_execute(wd1770_t *drv)
                         if (*drv->cpu_clk_ptr < drv->clk + BYTE_RATE) {
                             return;
                         }
+                        wd1770_skip_to_sync(drv);
                         drv->clk += BYTE_RATE;
                         res = fdd_read(drv->fdd);
                         if (!drv->dden || res != 0x1fe) {
@@ -630,6 +630,36 @@ static inline int rotation_p64_get_delta(drive_t *dptr)
     return P64PulseSamplesPerRotation - rptr->PulseHeadPosition;
 }
 
+/* Index of the first cached pulse at (`after' = 0) or after (`after' = 1)
+   a head position, the number of pulses if there is none */
+static inline uint32_t rotation_p64_find_pulse(PP64PulseStream P64PulseStream, uint32_t position, int after)
+{
+    const p64_uint32_t *positions = P64PulseStream->CachePositions;
+    uint32_t low = 0, high = P64PulseStream->CacheCount, mid;
+
+    while (low < high) {
+        mid = low + ((high - low) >> 1);
+        if (positions[mid] < position || (after && positions[mid] == position)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Calculate delta to the next cached NRZI transition flux pulse */
+static inline int rotation_p64_get_cached_delta(PP64PulseStream P64PulseStream, uint32_t cursor, uint32_t position)
+{
+    if (cursor < P64PulseStream->CacheCount) {
+        return P64PulseStream->CachePositions[cursor] - position;
+    }
+
+    /* wrap around */
+    /* FIXME: this is incorrect, see https://sourceforge.net/p/vice-emu/bugs/1305/ */
+    return P64PulseSamplesPerRotation - position;
+}
+
 /* FIXME: RPM related resources "DriveXRPM" and "DriveXwobble" are ignored for p64 */
 
 static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
@@ -637,33 +667,46 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
     rotation_t *rptr;
     PP64PulseStream P64PulseStream;
     CLOCK DeltaPositionToNextPulse, ToDo;
+    uint32_t Cursor;
 
     rptr = &rotation[dptr->diskunit->mynumber];
 
     P64PulseStream = &dptr->p64->PulseStreams[dptr->side][dptr->current_half_track];
 
-    /* Reset if out of head position bounds */
-    if ((P64PulseStream->UsedLast >= 0) &&
-        (P64PulseStream->Pulses[P64PulseStream->UsedLast].Position <= rptr->PulseHeadPosition)) {
-        P64PulseStream->CurrentIndex = -1;
+    if (dptr->read_write_mode) {
+        /* reading walks flat arrays of the pulses, they are only rebuilt
+           after the track was written to */
+        P64PulseStreamUpdateCache(P64PulseStream);
+        Cursor = rotation_p64_find_pulse(P64PulseStream, rptr->PulseHeadPosition, 1);
+        DeltaPositionToNextPulse = rotation_p64_get_cached_delta(P64PulseStream, Cursor, rptr->PulseHeadPosition);
     } else {
-        if (P64PulseStream->CurrentIndex < 0) {
-            P64PulseStream->CurrentIndex = P64PulseStream->UsedFirst;
+        /* writing changes the pulse list itself */
+        P64PulseStreamChanged(P64PulseStream);
+        Cursor = 0;
+
+        /* Reset if out of head position bounds */
+        if ((P64PulseStream->UsedLast >= 0) &&
+            (P64PulseStream->Pulses[P64PulseStream->UsedLast].Position <= rptr->PulseHeadPosition)) {
+            P64PulseStream->CurrentIndex = -1;
         } else {
+            if (P64PulseStream->CurrentIndex < 0) {
+                P64PulseStream->CurrentIndex = P64PulseStream->UsedFirst;
+            } else {
+                while ((P64PulseStream->CurrentIndex >= 0) &&
+                       ((P64PulseStream->CurrentIndex != P64PulseStream->UsedFirst) &&
+                        ((P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous >= 0) &&
+                         (P64PulseStream->Pulses[P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous].Position > rptr->PulseHeadPosition)))) {
+                    P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous;
+                }
+            }
             while ((P64PulseStream->CurrentIndex >= 0) &&
-                   ((P64PulseStream->CurrentIndex != P64PulseStream->UsedFirst) &&
-                    ((P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous >= 0) &&
-                     (P64PulseStream->Pulses[P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous].Position > rptr->PulseHeadPosition)))) {
-                P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous;
+                   (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position <= rptr->PulseHeadPosition)) {
+                P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Next;
             }
         }
-        while ((P64PulseStream->CurrentIndex >= 0) &&
-               (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position <= rptr->PulseHeadPosition)) {
-            P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Next;
-        }
-    }
 
-    DeltaPositionToNextPulse = rotation_p64_get_delta(dptr);
+        DeltaPositionToNextPulse = rotation_p64_get_delta(dptr);
+    }
 
     if (dptr->read_write_mode) {
         while (ref_cycles > 0) {
@@ -781,19 +824,15 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
                 if (rptr->PulseHeadPosition >= P64PulseSamplesPerRotation) {
                     rptr->PulseHeadPosition -= P64PulseSamplesPerRotation;
 
-                    P64PulseStream->CurrentIndex = P64PulseStream->UsedFirst;
-                    while ((P64PulseStream->CurrentIndex >= 0) &&
-                           (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position < rptr->PulseHeadPosition)) {
-                        P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Next;
-                    }
-                    DeltaPositionToNextPulse = rotation_p64_get_delta(dptr);
+                    Cursor = rotation_p64_find_pulse(P64PulseStream, rptr->PulseHeadPosition, 0);
+                    DeltaPositionToNextPulse = rotation_p64_get_cached_delta(P64PulseStream, Cursor, rptr->PulseHeadPosition);
                 }
 
                 /* Next NRZI transition flux pulse handling */
                 if (!DeltaPositionToNextPulse) {
-                    if ((P64PulseStream->CurrentIndex >= 0) &&
-                        (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position == rptr->PulseHeadPosition)) {
-                        uint32_t Strength = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Strength;
+                    if ((Cursor < P64PulseStream->CacheCount) &&
+                        (P64PulseStream->CachePositions[Cursor] == rptr->PulseHeadPosition)) {
+                        uint32_t Strength = P64PulseStream->CacheStrengths[Cursor];
 
                         /* Forward pulse high hit to the decoder logic */
                         if ((Strength == 0xffffffffUL) ||                                   /* Strong pulse */
@@ -802,9 +841,9 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
                             rptr->filter_counter = 0;
                         }
 
-                        P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Next;
+                        Cursor++;
                     }
-                    DeltaPositionToNextPulse = rotation_p64_get_delta(dptr);
+                    DeltaPositionToNextPulse = rotation_p64_get_cached_delta(P64PulseStream, Cursor, rptr->PulseHeadPosition);
                 }
             }
             /****************************************************************************************************************************************/
@@ -1031,6 +1070,42 @@ static void rotation_1541_simple(drive_t *dptr)
         }
 
         while (bits_moved-- != 0) {
+            /* a whole byte without SYNC can be shifted in at once */
+            if ((off & 7) == 7 && bits_moved >= 7) {
+                unsigned int next = (off >> 3) + 1, ones = 0, lead = 0, done, nbyte;
+
+                if (next >= dptr->GCR_current_track_size) {
+                    next = 0;
+                }
+                /* if no image is attached or track does not exists, read 0 */
+                if (dptr->GCR_image_loaded == 0 || dptr->GCR_track_start_ptr == NULL) {
+                    nbyte = 0;
+                } else {
+                    nbyte = dptr->GCR_track_start_ptr[next];
+                }
+                while (ones < 10 && (last_read_data & (0x80 << ones))) {
+                    ones++;
+                }
+                while (lead < 8 && (nbyte & (0x80 >> lead))) {
+                    lead++;
+                }
+                if (ones + lead < 10) {
+                    /* the byte counter wraps after `done' of the 8 bits */
+                    done = 8 - bit_counter;
+                    dptr->GCR_read = (uint8_t)(((last_read_data << done) >> 7) | (nbyte >> (8 - done)));
+                    rptr->last_write_data = (uint8_t)(dptr->GCR_read << (8 - done));
+                    if ((dptr->byte_ready_active & BRA_BYTE_READY) != 0) {
+                        dptr->byte_ready_edge = 1;
+                        dptr->byte_ready_level = 1;
+                    }
+                    last_read_data = (last_read_data << 8) | (nbyte << 7);
+                    off = (int)(next << 3) + 7;
+                    byte = nbyte << 7;
+                    bits_moved -= 7;
+                    continue;
+                }
+            }
+
             byte <<= 1; off++;
             if (!(off & 7)) {
                 if ((off >> 3) >= (int)dptr->GCR_current_track_size) {
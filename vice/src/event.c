@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "alarm.h"
 #include "archdep.h"
@@ -42,6 +43,7 @@
 #include "crc32.h"
 #include "datasette.h"
 #include "debug.h"
+#include "eventlog.h"
 #include "interrupt.h"
 #include "joystick.h"
 #include "keyboard.h"
@@ -59,6 +61,7 @@
 #include "util.h"
 #include "version.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 #ifdef EVENT_DEBUG
 #define DBG(x) log_printf  x
@@ -70,6 +73,11 @@
 #define EVENT_END_SNAPSHOT "end.vsf"
 #define EVENT_MILESTONE_SNAPSHOT "milestone.vsf"
 
+/* Version 0 of the snapshot module has every event stored as type, clock,
+   size and data, version 1 has them encoded by eventlog.  */
+#define EVENT_SNAP_MAJOR 1
+#define EVENT_SNAP_MINOR 0
+
 
 /** \brief  Size of the CRC32 entries
  *
@@ -96,6 +104,7 @@ static log_t event_log = LOG_DEFAULT;
 static unsigned int playback_active = 0, record_active = 0;
 
 static unsigned int current_timestamp, milestone_timestamp, playback_time;
+static unsigned int playback_reset_ack = 0;
 static CLOCK next_timestamp_clk;
 static CLOCK milestone_timestamp_alarm;
 
@@ -108,6 +117,32 @@ static char *event_end_snapshot = NULL;
 static char *event_snapshot_path_str = NULL;
 static int event_start_mode;
 static int event_image_include;
+static int event_keyframe_interval;
+
+/* While recording, a snapshot of the machine is added to the event list
+   every "EventKeyframeInterval" seconds as an EVENT_KEYFRAME event. Its
+   data is the timestamp (DWORD), the size of the snapshot (DWORD) and the
+   deflated snapshot. Seeking during playback looks up the last keyframe
+   before the target in `keyframes', loads it and plays back the remaining
+   events in warp mode. */
+typedef struct event_keyframe_s {
+    unsigned int timestamp;
+    event_list_t *event;
+} event_keyframe_t;
+
+#define EVENT_KEYFRAME_HEADER_SIZE 8
+
+static event_keyframe_t *keyframes = NULL;
+static unsigned int keyframes_num = 0;
+static unsigned int keyframes_max = 0;
+
+/* Timestamp requested by event_playback_seek() */
+static unsigned int seek_request;
+
+/* Flag: warping towards `seek_target', and the warp mode to go back to */
+static int seek_active = 0;
+static unsigned int seek_target;
+static int seek_warp_mode;
 
 static char *event_snapshot_path(const char *snapshot_file)
 {
@@ -343,6 +378,7 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
         case EVENT_KEYBOARD_MATRIX:     /* fall through */
         case EVENT_KEYBOARD_RESTORE:    /* fall through */
         case EVENT_KEYBOARD_DELAY:      /* fall through */
+        case EVENT_JOYSTICK_DELAY:      /* fall through */
         case EVENT_JOYSTICK_VALUE:      /* fall through */
         case EVENT_DATASETTE:           /* fall through */
         case EVENT_ATTACHDISK:          /* fall through */
@@ -350,7 +386,8 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
         case EVENT_ATTACHIMAGE:         /* fall through */
         case EVENT_INITIAL:             /* fall through */
         case EVENT_SYNC_TEST:           /* fall through */
-        case EVENT_RESOURCE:
+        case EVENT_RESOURCE:            /* fall through */
+        case EVENT_KEYFRAME:
             event_data = lib_malloc(size);
             memcpy(event_data, data, size);
             break;
@@ -397,6 +434,154 @@ static void next_current_list(void)
     event_list->current = event_list->current->next;
 }
 
+/*-----------------------------------------------------------------------*/
+
+static unsigned int keyframe_get_dword(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void keyframe_put_dword(uint8_t *p, unsigned int v)
+{
+    p[0] = (uint8_t)(v & 0xff);
+    p[1] = (uint8_t)((v >> 8) & 0xff);
+    p[2] = (uint8_t)((v >> 16) & 0xff);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void keyframe_index_add(event_list_t *event)
+{
+    if (event->size < EVENT_KEYFRAME_HEADER_SIZE) {
+        return;
+    }
+    if (keyframes_num == keyframes_max) {
+        keyframes_max += 64;
+        keyframes = lib_realloc(keyframes, keyframes_max * sizeof(event_keyframe_t));
+    }
+    keyframes[keyframes_num].timestamp = keyframe_get_dword(event->data);
+    keyframes[keyframes_num].event = event;
+    keyframes_num++;
+}
+
+/* Collect the keyframes of the event list, after it was replaced or cut */
+static void keyframe_index_rebuild(void)
+{
+    event_list_t *curr;
+
+    keyframes_num = 0;
+    if (event_list == NULL) {
+        return;
+    }
+    for (curr = event_list->base; curr != NULL && curr->type != EVENT_LIST_END; curr = curr->next) {
+        if (curr->type == EVENT_KEYFRAME) {
+            keyframe_index_add(curr);
+        }
+    }
+}
+
+/* Find the last keyframe at or before `timestamp', NULL if there is none */
+static event_keyframe_t *keyframe_find(unsigned int timestamp)
+{
+    unsigned int lo = 0, hi = keyframes_num, mid;
+
+    /* keyframes are recorded in order, so the index is sorted */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (keyframes[mid].timestamp <= timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? &keyframes[lo - 1] : NULL;
+}
+
+static void event_record_keyframe_trap(uint16_t addr, void *data)
+{
+    snapshot_memory_t *mem;
+    event_list_t *event;
+    uint8_t *buf;
+    uLongf zsize;
+    size_t size;
+    int err;
+
+    if (record_active == 0) {
+        return;
+    }
+
+    mem = snapshot_memory_new();
+    snapshot_memory_redirect(mem);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_redirect(NULL);
+
+    if (err < 0) {
+        log_error(event_log, "Could not save keyframe snapshot.");
+        snapshot_memory_free(mem);
+        return;
+    }
+
+    size = snapshot_memory_size(mem);
+    zsize = compressBound((uLong)size);
+    buf = lib_malloc(EVENT_KEYFRAME_HEADER_SIZE + zsize);
+    keyframe_put_dword(buf, current_timestamp);
+    keyframe_put_dword(buf + 4, (unsigned int)size);
+
+    if (compress2(buf + EVENT_KEYFRAME_HEADER_SIZE, &zsize, snapshot_memory_data(mem), (uLong)size, 1) == Z_OK) {
+        /* the event is filled into the current list entry */
+        event = event_list->current;
+        event_record(EVENT_KEYFRAME, buf, (unsigned int)(EVENT_KEYFRAME_HEADER_SIZE + zsize));
+        if (event->type == EVENT_KEYFRAME) {
+            keyframe_index_add(event);
+        }
+    } else {
+        log_error(event_log, "Could not compress keyframe snapshot.");
+    }
+
+    lib_free(buf);
+    snapshot_memory_free(mem);
+}
+
+/* Restore the machine from a keyframe and continue playback after it */
+static int keyframe_load(event_keyframe_t *keyframe)
+{
+    event_list_t *event = keyframe->event;
+    snapshot_memory_t *mem;
+    uLongf size;
+    int err = -1;
+
+    size = keyframe_get_dword((uint8_t *)event->data + 4);
+    mem = snapshot_memory_new();
+
+    if (uncompress(snapshot_memory_fill(mem, size), &size,
+                   (uint8_t *)event->data + EVENT_KEYFRAME_HEADER_SIZE,
+                   event->size - EVENT_KEYFRAME_HEADER_SIZE) == Z_OK) {
+        snapshot_memory_redirect(mem);
+        err = machine_read_snapshot("", 0);
+        snapshot_memory_redirect(NULL);
+    }
+    snapshot_memory_free(mem);
+
+    if (err < 0) {
+        return -1;
+    }
+
+    playback_reset_ack = 0;
+    current_timestamp = keyframe->timestamp;
+    event_list->current = event->next;
+    alarm_unset(event_alarm);
+    next_alarm_set();
+    ui_display_event_time(current_timestamp, playback_time);
+    return 0;
+}
+
+static void seek_warp_end(void)
+{
+    if (seek_active) {
+        seek_active = 0;
+        vsync_set_warp_mode(seek_warp_mode);
+    }
+}
+
 static void event_alarm_handler(CLOCK offset, void *data)
 {
     alarm_unset(event_alarm);
@@ -406,6 +591,10 @@ static void event_alarm_handler(CLOCK offset, void *data)
         ui_display_event_time(current_timestamp++, 0);
         next_timestamp_clk = next_timestamp_clk + (CLOCK)machine_get_cycles_per_second();
         alarm_set(event_alarm, next_timestamp_clk);
+        if (event_keyframe_interval > 0
+            && current_timestamp % (unsigned int)event_keyframe_interval == 0) {
+            interrupt_maincpu_trigger_trap(event_record_keyframe_trap, NULL);
+        }
         return;
     }
 
@@ -452,6 +641,12 @@ static void event_alarm_handler(CLOCK offset, void *data)
             break;
         case EVENT_TIMESTAMP:
             ui_display_event_time(current_timestamp++, playback_time);
+            if (seek_active && current_timestamp >= seek_target) {
+                seek_warp_end();
+            }
+            break;
+        case EVENT_KEYFRAME:
+            /* only used for seeking */
             break;
         case EVENT_LIST_END:
             event_playback_stop();
@@ -595,8 +790,68 @@ void event_clear_list(event_list_state_t *list)
     }
 }
 
+/** \brief  Encode the events of a list up to its end
+ *
+ * \param[in]   list    event list
+ * \param[out]  len     length of the encoded events
+ *
+ * \return  the encoded events, to be freed with lib_free()
+ */
+uint8_t *event_list_encode(event_list_state_t *list, size_t *len)
+{
+    eventlog_writer_t writer;
+    event_list_t *curr;
+
+    eventlog_writer_init(&writer);
+
+    for (curr = list->base; curr != NULL; curr = curr->next) {
+        if (curr->type != EVENT_TIMESTAMP) {
+            eventlog_write(&writer, curr->type, curr->clk, curr->data, curr->size);
+        }
+        if (curr->type == EVENT_LIST_END) {
+            break;
+        }
+    }
+
+    return eventlog_writer_finish(&writer, len);
+}
+
+/** \brief  Append encoded events to a list
+ *
+ * The events are recorded at the current clock.  The list is always ended,
+ * even if the encoded events are broken.
+ *
+ * \param[in,out]   list    event list
+ * \param[in]       buf     encoded events
+ * \param[in]       len     length of \a buf
+ *
+ * \return  0 on success, -1 if the encoded events are broken
+ */
+int event_list_decode(event_list_state_t *list, const uint8_t *buf, size_t len)
+{
+    eventlog_reader_t reader;
+    const uint8_t *data;
+    unsigned int type, size;
+    CLOCK clk;
+    int res;
+
+    eventlog_reader_init(&reader, buf, len);
+
+    while ((res = eventlog_read(&reader, &type, &clk, &data, &size)) > 0) {
+        event_record_in_list(list, type, (void *)data, size);
+        if (type == EVENT_LIST_END) {
+            return 0;
+        }
+    }
+
+    log_error(event_log, "Broken event data.");
+    event_record_in_list(list, EVENT_LIST_END, NULL, 0);
+    return -1;
+}
+
 static void destroy_list(void)
 {
+    keyframes_num = 0;
     event_clear_list(event_list);
     lib_free(event_list);
     event_destroy_image_list();
@@ -733,6 +988,7 @@ static void event_record_start_trap(uint16_t addr, void *data)
             cut_list(event_list->current->next);
             event_list->current->next = NULL;
             event_list->current->type = EVENT_LIST_END;
+            keyframe_index_rebuild();
             event_destroy_image_list();
             event_write_version();
             record_active = 1;
@@ -806,8 +1062,6 @@ int event_record_stop(void)
 
 /*-----------------------------------------------------------------------*/
 
-static unsigned int playback_reset_ack = 0;
-
 void event_reset_ack(void)
 {
     if (event_list == NULL) {
@@ -938,6 +1192,7 @@ int event_playback_stop(void)
     playback_active = 0;
 
     alarm_unset(event_alarm);
+    seek_warp_end();
 
     ui_display_playback(0, NULL);
 
@@ -1011,6 +1266,95 @@ int event_record_reset_milestone(void)
 }
 
 
+static void event_playback_seek_trap(uint16_t addr, void *data)
+{
+    unsigned int target = seek_request;
+    event_keyframe_t *keyframe;
+
+    if (playback_active == 0) {
+        return;
+    }
+
+    if (target > playback_time) {
+        target = playback_time;
+    }
+    keyframe = keyframe_find(target);
+
+    /* jump if going back or if a keyframe is closer than the current spot */
+    if (target < current_timestamp
+        || (keyframe != NULL && keyframe->timestamp > current_timestamp)) {
+        if (keyframe == NULL) {
+            /* nothing before the target but the start snapshot */
+            seek_warp_end();
+            playback_active = 0;
+            event_playback_start_trap(addr, NULL);
+            if (playback_active == 0) {
+                return;
+            }
+        } else if (keyframe_load(keyframe) < 0) {
+            ui_error("Could not restore keyframe snapshot.");
+            event_playback_stop();
+            return;
+        }
+    }
+
+    /* play back the rest in warp mode */
+    if (target > current_timestamp) {
+        if (!seek_active) {
+            seek_warp_mode = vsync_get_warp_mode();
+            vsync_set_warp_mode(1);
+        }
+        seek_active = 1;
+        seek_target = target;
+    } else {
+        seek_warp_end();
+    }
+}
+
+/** \brief  Seek to a point in the event history being played back
+ *
+ * The machine is restored from the last keyframe before \a seconds (or from
+ * the start snapshot if there is none), then the events up to \a seconds
+ * are played back in warp mode.
+ *
+ * \param[in]   seconds time since the start of the recording
+ *
+ * \return 0 on success, -1 if no playback is active
+ */
+int event_playback_seek(unsigned int seconds)
+{
+    if (playback_active == 0) {
+        return -1;
+    }
+
+    seek_request = seconds;
+    interrupt_maincpu_trigger_trap(event_playback_seek_trap, NULL);
+
+    return 0;
+}
+
+/** \brief  Seek relative to the current point of the playback
+ *
+ * \param[in]   seconds number of seconds to skip, negative to go back
+ *
+ * \return 0 on success, -1 if no playback is active
+ */
+int event_playback_skip(int seconds)
+{
+    unsigned int now = seek_active ? seek_target : current_timestamp;
+
+    if (seconds < 0 && (unsigned int)-seconds > now) {
+        return event_playback_seek(0);
+    }
+    return event_playback_seek(now + seconds);
+}
+
+/** \brief  Get the current time of the playback in seconds */
+unsigned int event_playback_get_time(void)
+{
+    return playback_active ? current_timestamp : 0;
+}
+
 /*-----------------------------------------------------------------------*/
 
 int event_record_active(void)
@@ -1031,6 +1375,9 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
     uint8_t major_version, minor_version;
     event_list_t *curr;
     unsigned int num_of_timestamps;
+    eventlog_reader_t reader;
+    uint8_t *encoded = NULL;
+    unsigned int encoded_len;
 
     if (event_mode == 0) {
         return 0;
@@ -1051,6 +1398,20 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
     playback_time = 0;
     next_timestamp_clk = CLOCK_MAX;
 
+    if (major_version > 0) {
+        if (SMR_DW_UINT(m, &encoded_len) < 0) {
+            snapshot_module_close(m);
+            return -1;
+        }
+        encoded = lib_malloc(encoded_len);
+        if (SMR_BA(m, encoded, encoded_len) < 0) {
+            lib_free(encoded);
+            snapshot_module_close(m);
+            return -1;
+        }
+        eventlog_reader_init(&reader, encoded, encoded_len);
+    }
+
     while (1) {
         unsigned int type, size;
         CLOCK clk;
@@ -1061,6 +1422,21 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
             1.14.x so there might exist history files with TIMESTAMP events)
         */
         do {
+            if (encoded != NULL) {
+                const uint8_t *encoded_data;
+
+                if (eventlog_read(&reader, &type, &clk, &encoded_data, &size) <= 0) {
+                    lib_free(encoded);
+                    snapshot_module_close(m);
+                    return -1;
+                }
+                if (size > 0 && type != EVENT_TIMESTAMP) {
+                    data = lib_malloc(size);
+                    memcpy(data, encoded_data, size);
+                }
+                continue;
+            }
+
             if (SMR_DW_UINT(m, &(type)) < 0) {
                 snapshot_module_close(m);
                 return -1;
@@ -1077,7 +1453,7 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
             }
         } while (type == EVENT_TIMESTAMP);
 
-        if (size > 0) {
+        if (size > 0 && encoded == NULL) {
             data = lib_malloc(size);
             if (SMR_BA(m, data, size) < 0) {
                 snapshot_module_close(m);
@@ -1130,6 +1506,10 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
         playback_time = num_of_timestamps - 1;
     }
 
+    lib_free(encoded);
+
+    keyframe_index_rebuild();
+
     snapshot_module_close(m);
 
     return 0;
@@ -1138,32 +1518,28 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
 int event_snapshot_write_module(struct snapshot_s *s, int event_mode)
 {
     snapshot_module_t *m;
-    event_list_t *curr;
+    uint8_t *encoded;
+    size_t encoded_len;
 
     if (event_mode == 0) {
         return 0;
     }
 
-    m = snapshot_module_create(s, "EVENT", 0, 1);
+    m = snapshot_module_create(s, "EVENT", EVENT_SNAP_MAJOR, EVENT_SNAP_MINOR);
 
     if (m == NULL) {
         return -1;
     }
 
-    curr = event_list->base;
+    encoded = event_list_encode(event_list, &encoded_len);
 
-    while (curr != NULL) {
-        if (curr->type != EVENT_TIMESTAMP
-            && (0
-                || SMW_DW(m, (uint32_t)curr->type) < 0
-                || SMW_CLOCK(m, curr->clk) < 0
-                || SMW_DW(m, (uint32_t)curr->size) < 0
-                || SMW_BA(m, curr->data, curr->size) < 0)) {
-            snapshot_module_close(m);
-            return -1;
-        }
-        curr = curr->next;
+    if (SMW_DW(m, (uint32_t)encoded_len) < 0
+        || SMW_BA(m, encoded, (unsigned int)encoded_len) < 0) {
+        lib_free(encoded);
+        snapshot_module_close(m);
+        return -1;
     }
+    lib_free(encoded);
 
     if (snapshot_module_close(m) < 0) {
         return -1;
@@ -1231,6 +1607,17 @@ static int set_event_image_include(int enable, void *param)
     return 0;
 }
 
+static int set_event_keyframe_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+
+    event_keyframe_interval = val;
+
+    return 0;
+}
+
 static const resource_string_t resources_string[] = {
     { "EventSnapshotDir",
       ARCHDEP_FSDEVICE_DEFAULT_DIR ARCHDEP_DIR_SEP_STR, RES_EVENT_NO, NULL,
@@ -1247,6 +1634,8 @@ static const resource_int_t resources_int[] = {
       &event_start_mode, set_event_start_mode, NULL },
     { "EventImageInclude", 1, RES_EVENT_NO, NULL,
       &event_image_include, set_event_image_include, NULL },
+    { "EventKeyframeInterval", 60, RES_EVENT_NO, NULL,
+      &event_keyframe_interval, set_event_keyframe_interval, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -1267,6 +1656,9 @@ void event_shutdown(void)
     lib_free(event_snapshot_path_str);
     event_snapshot_path_str = NULL;
     destroy_list();
+    lib_free(keyframes);
+    keyframes = NULL;
+    keyframes_max = 0;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1299,6 +1691,9 @@ static const cmdline_option_t cmdline_options[] =
     { "+eventimageinc", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "EventImageInclude", (resource_value_t)0,
       NULL, "Disable including disk images" },
+    { "-eventkeyframeinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "EventKeyframeInterval", NULL,
+      "<seconds>", "Set the interval of keyframe snapshots for seeking in the event history (0: none)" },
     CMDLINE_LIST_END
 };
 
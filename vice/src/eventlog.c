@@ -0,0 +1,288 @@
+/** \file   eventlog.c
+ * \brief   Compact binary encoding of recorded events
+ *
+ * Used for the events sent over the network and the ones stored in the
+ * history snapshot.  Every event is encoded as
+ *
+ *  - the type shifted left by one, with bit 0 set if the payload is the one
+ *    of a recent event of the same type,
+ *  - the difference of the clock to the one of the previous event (it goes
+ *    backwards after a reset), zigzag encoded,
+ *  - for a recent payload the index of it in the dictionary, otherwise the
+ *    size followed by the payload itself.
+ *
+ * Numbers are stored in 7 bit groups, least significant first, with bit 7
+ * set in all but the last one.  Keyboard and joystick events keep switching
+ * between a few states, so their payloads are remembered in a small
+ * dictionary that writer and reader both update the same way.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <string.h>
+
+#include "eventlog.h"
+#include "lib.h"
+#include "types.h"
+#include "vice-event.h"
+
+/* initial size of the writer buffer */
+#define EVENTLOG_BUF_SIZE   256
+
+
+static void dict_init(eventlog_dict_t *dict)
+{
+    memset(dict, 0, sizeof(eventlog_dict_t));
+}
+
+/* Only the input events are looked up, the other ones rarely repeat.  */
+static int dict_type(unsigned int type, unsigned int size)
+{
+    switch (type) {
+        case EVENT_KEYBOARD_MATRIX:
+        case EVENT_KEYBOARD_RESTORE:
+        case EVENT_KEYBOARD_DELAY:
+        case EVENT_JOYSTICK_VALUE:
+        case EVENT_JOYSTICK_DELAY:
+            return size > 0 && size <= EVENTLOG_DICT_DATA_MAX;
+        default:
+            return 0;
+    }
+}
+
+static int dict_find(const eventlog_dict_t *dict, unsigned int type,
+                     const void *data, unsigned int size)
+{
+    int i;
+
+    for (i = 0; i < EVENTLOG_DICT_SIZE; i++) {
+        const eventlog_dict_entry_t *e = &dict->entry[i];
+
+        if (e->type == type && e->size == size && memcmp(e->data, data, size) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void dict_add(eventlog_dict_t *dict, unsigned int type,
+                     const void *data, unsigned int size)
+{
+    eventlog_dict_entry_t *e = &dict->entry[dict->next];
+
+    e->type = type;
+    e->size = size;
+    memcpy(e->data, data, size);
+    dict->next = (dict->next + 1) % EVENTLOG_DICT_SIZE;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void put_bytes(eventlog_writer_t *writer, const void *data, size_t len)
+{
+    if (writer->len + len > writer->size) {
+        while (writer->len + len > writer->size) {
+            writer->size *= 2;
+        }
+        writer->buf = lib_realloc(writer->buf, writer->size);
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+static void put_number(eventlog_writer_t *writer, uint64_t value)
+{
+    uint8_t tmp[10];
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        tmp[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    tmp[len++] = (uint8_t)value;
+    put_bytes(writer, tmp, len);
+}
+
+/** \brief  Start a new encoded event stream
+ *
+ * \param[out]  writer  writer
+ */
+void eventlog_writer_init(eventlog_writer_t *writer)
+{
+    writer->size = EVENTLOG_BUF_SIZE;
+    writer->buf = lib_malloc(writer->size);
+    writer->len = 0;
+    writer->clk = 0;
+    dict_init(&writer->dict);
+}
+
+/** \brief  Append an event to the stream
+ *
+ * \param[in,out]   writer  writer
+ * \param[in]       type    event type
+ * \param[in]       clk     clock of the event
+ * \param[in]       data    payload
+ * \param[in]       size    size of \a data
+ */
+void eventlog_write(eventlog_writer_t *writer, unsigned int type, CLOCK clk,
+                    const void *data, unsigned int size)
+{
+    int64_t delta = (int64_t)(clk - writer->clk);
+    int index = -1;
+
+    if (dict_type(type, size)) {
+        index = dict_find(&writer->dict, type, data, size);
+        if (index < 0) {
+            dict_add(&writer->dict, type, data, size);
+        }
+    }
+
+    put_number(writer, ((uint64_t)type << 1) | (index >= 0 ? 1 : 0));
+    put_number(writer, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+    if (index >= 0) {
+        put_number(writer, (uint64_t)index);
+    } else {
+        put_number(writer, size);
+        if (size > 0) {
+            put_bytes(writer, data, size);
+        }
+    }
+    writer->clk = clk;
+}
+
+/** \brief  Take the encoded stream from the writer
+ *
+ * \param[in,out]   writer  writer, must be initialized again for reuse
+ * \param[out]      len     length of the stream
+ *
+ * \return  the stream, to be freed with lib_free()
+ */
+uint8_t *eventlog_writer_finish(eventlog_writer_t *writer, size_t *len)
+{
+    uint8_t *buf = writer->buf;
+
+    *len = writer->len;
+    writer->buf = NULL;
+    writer->len = 0;
+    writer->size = 0;
+
+    return buf;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int get_number(eventlog_reader_t *reader, uint64_t *value)
+{
+    int shift = 0;
+    uint8_t b;
+
+    *value = 0;
+    do {
+        if (reader->ptr >= reader->end || shift > 63) {
+            return -1;
+        }
+        b = *reader->ptr++;
+        *value |= (uint64_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+
+    return 0;
+}
+
+/** \brief  Start reading an encoded event stream
+ *
+ * \param[out]  reader  reader
+ * \param[in]   buf     the stream, kept until reading is done
+ * \param[in]   len     length of \a buf
+ */
+void eventlog_reader_init(eventlog_reader_t *reader, const uint8_t *buf, size_t len)
+{
+    reader->ptr = buf;
+    reader->end = buf + len;
+    reader->clk = 0;
+    dict_init(&reader->dict);
+}
+
+/** \brief  Read the next event of the stream
+ *
+ * The payload points into the stream or the reader and is only valid until
+ * the next call.
+ *
+ * \param[in,out]   reader  reader
+ * \param[out]      type    event type
+ * \param[out]      clk     clock of the event
+ * \param[out]      data    payload, NULL if there is none
+ * \param[out]      size    size of \a data
+ *
+ * \return  1 if an event was read, 0 at the end of the stream, -1 if the
+ *          stream is broken
+ */
+int eventlog_read(eventlog_reader_t *reader, unsigned int *type, CLOCK *clk,
+                  const uint8_t **data, unsigned int *size)
+{
+    uint64_t head, delta, value;
+
+    if (reader->ptr == reader->end) {
+        return 0;
+    }
+
+    if (get_number(reader, &head) < 0
+        || get_number(reader, &delta) < 0
+        || get_number(reader, &value) < 0
+        || (head >> 1) > 0xffffffffU) {
+        return -1;
+    }
+
+    *type = (unsigned int)(head >> 1);
+    reader->clk += (CLOCK)((delta >> 1) ^ (0 - (delta & 1)));
+    *clk = reader->clk;
+
+    if (head & 1) {
+        eventlog_dict_entry_t *e;
+
+        if (value >= EVENTLOG_DICT_SIZE) {
+            return -1;
+        }
+        e = &reader->dict.entry[value];
+        if (e->type != *type || e->size == 0) {
+            return -1;
+        }
+        *data = e->data;
+        *size = e->size;
+        return 1;
+    }
+
+    if (value > (uint64_t)(reader->end - reader->ptr)) {
+        return -1;
+    }
+    *size = (unsigned int)value;
+    *data = *size > 0 ? reader->ptr : NULL;
+    reader->ptr += *size;
+
+    if (dict_type(*type, *size)) {
+        dict_add(&reader->dict, *type, *data, *size);
+    }
+
+    return 1;
+}
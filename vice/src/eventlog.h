@@ -0,0 +1,74 @@
+/** \file   eventlog.h
+ * \brief   Compact binary encoding of recorded events - header
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_EVENTLOG_H
+#define VICE_EVENTLOG_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/** \brief  Number of recent payloads remembered for the input events */
+#define EVENTLOG_DICT_SIZE      16
+
+/** \brief  Largest payload that is remembered */
+#define EVENTLOG_DICT_DATA_MAX  128
+
+typedef struct eventlog_dict_entry_s {
+    unsigned int type;      /**< event type, EVENT_LIST_END if unused */
+    unsigned int size;
+    uint8_t data[EVENTLOG_DICT_DATA_MAX];
+} eventlog_dict_entry_t;
+
+typedef struct eventlog_dict_s {
+    eventlog_dict_entry_t entry[EVENTLOG_DICT_SIZE];
+    unsigned int next;      /**< entry replaced next */
+} eventlog_dict_t;
+
+typedef struct eventlog_writer_s {
+    uint8_t *buf;
+    size_t len;
+    size_t size;
+    CLOCK clk;              /**< clock of the previous event */
+    eventlog_dict_t dict;
+} eventlog_writer_t;
+
+typedef struct eventlog_reader_s {
+    const uint8_t *ptr;
+    const uint8_t *end;
+    CLOCK clk;              /**< clock of the previous event */
+    eventlog_dict_t dict;
+} eventlog_reader_t;
+
+void eventlog_writer_init(eventlog_writer_t *writer);
+void eventlog_write(eventlog_writer_t *writer, unsigned int type, CLOCK clk,
+                    const void *data, unsigned int size);
+uint8_t *eventlog_writer_finish(eventlog_writer_t *writer, size_t *len);
+
+void eventlog_reader_init(eventlog_reader_t *reader, const uint8_t *buf, size_t len);
+int eventlog_read(eventlog_reader_t *reader, unsigned int *type, CLOCK *clk,
+                  const uint8_t **data, unsigned int *size);
+
+#endif
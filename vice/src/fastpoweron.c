@@ -0,0 +1,315 @@
+/*
+ * fastpoweron.c - Skip the power-on sequence by restoring a cached state.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* While "FastPowerOn" is enabled, the first power cycle with a given
+   configuration runs the whole power-on sequence (RAM test, memory sizing,
+   drive self-tests) as usual, and the machine state is saved to memory as
+   soon as the READY prompt shows up. Later power cycles with the same
+   configuration restore that state instead of running the sequence again.
+
+   The configuration is identified by a hash of all resources, which covers
+   the machine model, the ROM files and the expansions. Anything typed or
+   autostarted before the prompt showed up leaves that boot out of the
+   cache, so only untouched power-on states are ever restored. */
+
+#include "vice.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "autostart.h"
+#include "cmdline.h"
+#include "fastpoweron.h"
+#include "interrupt.h"
+#include "kbdbuf.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "network.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vice-event.h"
+#include "vsync.h"
+
+/* Number of configurations kept, the least recently used one is replaced */
+#define FASTPOWERON_ENTRIES 8
+
+/* Number of frames to wait for the READY prompt before giving up */
+#define FASTPOWERON_MAX_FRAMES (60 * 60)
+
+typedef struct fastpoweron_entry_s {
+    /* Hash of the resources the state was recorded with */
+    uint64_t key;
+
+    /* Machine state at the READY prompt, NULL if the entry is unused */
+    snapshot_memory_t *state;
+
+    /* Value of `use_counter' when the entry was last used */
+    unsigned long last_used;
+} fastpoweron_entry_t;
+
+static log_t fastpoweron_log = LOG_DEFAULT;
+
+/* "FastPowerOn" resource, flag: restore cached power-on states */
+static int fastpoweron_enabled = 0;
+
+static fastpoweron_entry_t entries[FASTPOWERON_ENTRIES];
+static unsigned long use_counter = 0;
+
+/* Waiting for the READY prompt of a power cycle that is not cached yet */
+static bool recording = false;
+static uint64_t recording_key;
+static int recording_frames;
+
+/* Key of the state to be restored by restore_trap() */
+static uint64_t restore_key;
+
+static void fastpoweron_free(void)
+{
+    int i;
+
+    for (i = 0; i < FASTPOWERON_ENTRIES; i++) {
+        if (entries[i].state != NULL) {
+            snapshot_memory_free(entries[i].state);
+            entries[i].state = NULL;
+        }
+    }
+    recording = false;
+}
+
+/* Whether power cycles may be recorded or restored right now */
+static bool fastpoweron_possible(void)
+{
+    return fastpoweron_enabled
+           && machine_class != VICE_MACHINE_VSID
+           && !network_connected()
+           && !event_record_active()
+           && !event_playback_active();
+}
+
+static fastpoweron_entry_t *fastpoweron_lookup(uint64_t key)
+{
+    int i;
+
+    for (i = 0; i < FASTPOWERON_ENTRIES; i++) {
+        if (entries[i].state != NULL && entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+/* Get the entry to record a new state in, reusing the least recently used
+   one if all are taken */
+static fastpoweron_entry_t *fastpoweron_victim(void)
+{
+    fastpoweron_entry_t *entry = &entries[0];
+    int i;
+
+    for (i = 0; i < FASTPOWERON_ENTRIES; i++) {
+        if (entries[i].state == NULL) {
+            return &entries[i];
+        }
+        if (entries[i].last_used < entry->last_used) {
+            entry = &entries[i];
+        }
+    }
+    return entry;
+}
+
+static void record_trap(uint16_t addr, void *data)
+{
+    fastpoweron_entry_t *entry;
+    int err;
+
+    if (!recording) {
+        return;
+    }
+    recording = false;
+
+    entry = fastpoweron_lookup(recording_key);
+    if (entry == NULL) {
+        entry = fastpoweron_victim();
+        if (entry->state == NULL) {
+            entry->state = snapshot_memory_new();
+        }
+        entry->key = recording_key;
+    }
+    entry->last_used = ++use_counter;
+
+    snapshot_memory_redirect(entry->state);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_redirect(NULL);
+
+    if (err < 0) {
+        log_error(fastpoweron_log, "Cannot save the power-on state.");
+        snapshot_memory_free(entry->state);
+        entry->state = NULL;
+        return;
+    }
+
+    log_message(fastpoweron_log, "Saved the power-on state (%016" PRIx64 ", %lu bytes).",
+                entry->key, (unsigned long)snapshot_memory_size(entry->state));
+}
+
+static void restore_trap(uint16_t addr, void *data)
+{
+    fastpoweron_entry_t *entry = fastpoweron_lookup(restore_key);
+
+    if (entry != NULL && rewind_read_memory_snapshot(entry->state) == 0) {
+        /* the restored state is a machine that was just reset, let the
+           parts that wait for the reset know */
+        kbdbuf_abort();
+        autostart_reset();
+        return;
+    }
+
+    if (entry != NULL) {
+        log_error(fastpoweron_log, "Cannot restore the power-on state, running the power-on sequence.");
+        snapshot_memory_free(entry->state);
+        entry->state = NULL;
+    }
+
+    /* power cycle the usual way, and record it again */
+    recording = fastpoweron_possible();
+    recording_key = restore_key;
+    recording_frames = 0;
+    machine_powerup();
+    maincpu_trigger_reset();
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Power cycle from the cache, called by machine_trigger_reset()
+ *
+ * If the state after the power-on sequence of the current configuration is
+ * cached, it is restored at the next instruction. Otherwise the power-on
+ * sequence of this power cycle gets recorded.
+ *
+ * \return  1 if the cached state will be restored, 0 if the machine has to
+ *          be power cycled the usual way
+ */
+int fastpoweron_power_cycle(void)
+{
+    fastpoweron_entry_t *entry;
+    uint64_t key;
+
+    recording = false;
+
+    if (!fastpoweron_possible()) {
+        return 0;
+    }
+
+    key = resources_get_hash();
+    entry = fastpoweron_lookup(key);
+    if (entry != NULL) {
+        entry->last_used = ++use_counter;
+        restore_key = key;
+        interrupt_maincpu_trigger_trap(restore_trap, NULL);
+        return 1;
+    }
+
+    recording = true;
+    recording_key = key;
+    recording_frames = 0;
+    return 0;
+}
+
+/** \brief  End of frame hook, called by vsync_do_vsync() for shown frames */
+void fastpoweron_do_vsync(void)
+{
+    if (!recording) {
+        return;
+    }
+
+    if (!fastpoweron_possible() || ++recording_frames > FASTPOWERON_MAX_FRAMES) {
+        recording = false;
+        return;
+    }
+
+    switch (autostart_power_on_ready()) {
+        case 0:
+            break;
+        case 1:
+            if (resources_get_hash() == recording_key) {
+                interrupt_maincpu_trigger_trap(record_trap, NULL);
+            } else {
+                /* the configuration changed during the power-on sequence */
+                recording = false;
+            }
+            break;
+        default:
+            recording = false;
+            break;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_fastpoweron_enabled(int val, void *param)
+{
+    fastpoweron_enabled = val ? 1 : 0;
+
+    if (!fastpoweron_enabled) {
+        fastpoweron_free();
+    }
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "FastPowerOn", 0, RES_EVENT_NO, NULL,
+      &fastpoweron_enabled, set_fastpoweron_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int fastpoweron_resources_init(void)
+{
+    fastpoweron_log = log_open("FastPowerOn");
+
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-fastpoweron", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FastPowerOn", (resource_value_t)1,
+      NULL, "Restore the state after the power-on sequence instead of running it again" },
+    { "+fastpoweron", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FastPowerOn", (resource_value_t)0,
+      NULL, "Always run the whole power-on sequence (default)" },
+    CMDLINE_LIST_END
+};
+
+int fastpoweron_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void fastpoweron_shutdown(void)
+{
+    fastpoweron_free();
+}
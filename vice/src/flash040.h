@@ -68,6 +68,11 @@ typedef enum flash040_state_s flash040_state_t;
 
 #define FLASH040_ERASE_MASK_SIZE 8
 
+/* changed data is tracked in blocks of 8 KiB, one bit each for up to 8 MiB */
+#define FLASH040_BLOCK_SHIFT 13
+#define FLASH040_BLOCK_SIZE (1 << FLASH040_BLOCK_SHIFT)
+#define FLASH040_DIRTY_MASK_SIZE 128
+
 typedef struct flash040_context_s {
     uint8_t *flash_data;
     flash040_state_t flash_state;
@@ -76,6 +81,7 @@ typedef struct flash040_context_s {
     uint8_t program_byte;
     uint8_t erase_mask[FLASH040_ERASE_MASK_SIZE];
     int flash_dirty;
+    uint8_t dirty_mask[FLASH040_DIRTY_MASK_SIZE];
 
     flash040_type_t flash_type;
 
@@ -98,6 +104,12 @@ uint8_t flash040core_read(struct flash040_context_s *flash040_context,
 uint8_t flash040core_peek(struct flash040_context_s *flash040_context,
                           unsigned int addr);
 
+void flash040core_set_dirty(struct flash040_context_s *flash040_context,
+                            unsigned int addr, unsigned int len);
+int flash040core_is_dirty(struct flash040_context_s *flash040_context,
+                          unsigned int addr);
+void flash040core_clear_dirty(struct flash040_context_s *flash040_context);
+
 struct snapshot_s;
 
 int flash040core_snapshot_write_module(struct snapshot_s *s,
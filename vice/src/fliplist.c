@@ -46,6 +46,7 @@
 #include "log.h"
 #include "resources.h"
 #include "util.h"
+#include "zfile.h"
 
 #ifdef DEBUG_FLIPLIST
 #define DBG(x) log_printf    x
@@ -278,6 +279,20 @@ void fliplist_remove(unsigned int unit, const char *image)
 }
 
 
+/* Have the images before and after the head read in the background, so
+   the next flip in either direction does not wait for them.  */
+static void prefetch_neighbours(unsigned int unit)
+{
+    fliplist_t head = fliplist[unit - 8];
+
+    if (head->next != head) {
+        zfile_prefetch(head->next->image);
+    }
+    if (head->prev != head && head->prev != head->next) {
+        zfile_prefetch(head->prev->image);
+    }
+}
+
 /** \brief  Attach new image from the fliplist
  *
  * \param[in]   unit        drive unit number (8-11)
@@ -304,6 +319,7 @@ bool fliplist_attach_head(unsigned int unit, int direction)
         /* shouldn't happen, so ignore it */
         return false;   /* handle it anyway */
     }
+    prefetch_neighbours(unit);
     return true;
 }
 
@@ -641,6 +657,8 @@ int fliplist_load_list(unsigned int unit, const char *filename, int autoattach)
 
         if (autoattach) {
             fliplist_attach_head(unit, 1);
+        } else {
+            prefetch_neighbours(unit);
         }
 
         return 0;
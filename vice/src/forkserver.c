@@ -0,0 +1,366 @@
+/*
+ * forkserver.c - Start emulator instances by forking an initialized one.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With "-forkserver <socket>" the headless emulator does all of its startup
+   (resources, ROMs, machine and video init) once and then waits for jobs on
+   a Unix domain socket instead of running the machine.  A job is a single
+   line of command-line options, the same as would be given to the emulator,
+   with double quotes around arguments containing spaces.  Every connection
+   gets its own child process, forked from the waiting emulator, which
+   parses the options of the job and then runs the machine as usual, with
+   its output written to the connection.  When the child has exited, the
+   server writes "exit <code>" to the connection and closes it.
+
+   The server forks before the emulation thread is created, so the only
+   other thread that may be running is the log writer; it is stopped before
+   forking and started again in the child.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(UNIX_COMPILE) && defined(USE_HEADLESSUI)
+#define FORKSERVER_SUPPORTED
+#endif
+
+#ifdef FORKSERVER_SUPPORTED
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+#include "cmdline.h"
+#include "forkserver.h"
+#include "initcmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "resources.h"
+#include "util.h"
+
+#ifdef FORKSERVER_SUPPORTED
+
+/* Longest job line accepted.  */
+#define FORKSERVER_LINE_MAX     4096
+
+/* Most options a job can have.  */
+#define FORKSERVER_ARGS_MAX     128
+
+typedef struct forkserver_child_s {
+    pid_t pid;
+    int fd;
+} forkserver_child_t;
+
+static log_t forkserver_log = LOG_DEFAULT;
+
+static char *socket_name = NULL;
+
+static forkserver_child_t *children = NULL;
+static int children_num = 0;
+
+/* ------------------------------------------------------------------------- */
+
+/* Split off the next field of a job line, with the same quoting as the
+   manifest of the test runner.  */
+static char *next_field(char **line)
+{
+    char *p = *line;
+    char *field;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p == '\0') {
+        return NULL;
+    }
+
+    if (*p == '"') {
+        field = ++p;
+        while (*p != '\0' && *p != '"') {
+            p++;
+        }
+    } else {
+        field = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+    }
+    if (*p != '\0') {
+        *p++ = '\0';
+    }
+    *line = p;
+
+    return field;
+}
+
+/* Read the job line from the connection, without the line end.  */
+static int read_job(int fd, char *line)
+{
+    size_t len = 0;
+    ssize_t res;
+
+    while (len < FORKSERVER_LINE_MAX - 1) {
+        res = read(fd, line + len, 1);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0 || line[len] == '\n') {
+            break;
+        }
+        len++;
+    }
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = '\0';
+
+    return len == FORKSERVER_LINE_MAX - 1 ? -1 : 0;
+}
+
+/* Set up the child for the job of connection `fd'.  */
+static int start_job(int listen_fd, int fd, int log_async)
+{
+    char line[FORKSERVER_LINE_MAX];
+    char *argv[FORKSERVER_ARGS_MAX + 2];
+    char *p = line;
+    int argc = 1;
+
+    close(listen_fd);
+    signal(SIGCHLD, SIG_DFL);
+
+    if (read_job(fd, line) < 0) {
+        log_error(forkserver_log, "Job line too long.");
+        return -1;
+    }
+
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    if (log_async) {
+        resources_set_int("LogAsync", 1);
+    }
+
+    log_message(forkserver_log, "Starting job: %s", line);
+
+    argv[0] = "vice";
+    while (argc <= FORKSERVER_ARGS_MAX && (argv[argc] = next_field(&p)) != NULL) {
+        argc++;
+    }
+    if (argc > FORKSERVER_ARGS_MAX) {
+        log_error(forkserver_log, "Too many options in job.");
+        return -1;
+    }
+    argv[argc] = NULL;
+
+    /* The machine is reset when the emulation starts, which also does the
+       autostart and the attaching of images given here.  */
+    return initcmdline_check_args(argc, argv);
+}
+
+/* Tell the clients of the children that have exited.  */
+static void reap_children(void)
+{
+    char buf[32];
+    int status, code, i;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (i = 0; i < children_num; i++) {
+            if (children[i].pid == pid) {
+                break;
+            }
+        }
+        if (i == children_num) {
+            continue;
+        }
+
+        code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        sprintf(buf, "exit %d\n", code);
+        if (write(children[i].fd, buf, strlen(buf)) < 0) {
+            log_warning(forkserver_log, "Client of job %d is gone.", (int)pid);
+        }
+        close(children[i].fd);
+
+        children[i] = children[--children_num];
+    }
+}
+
+static int open_socket(void)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(socket_name) >= sizeof(addr.sun_path)) {
+        log_error(forkserver_log, "Socket name `%s' is too long.", socket_name);
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        log_error(forkserver_log, "Cannot create socket: %s.", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_name);
+    unlink(socket_name);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(fd, 16) < 0) {
+        log_error(forkserver_log, "Cannot listen on `%s': %s.",
+                  socket_name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void sigchld_handler(int sig)
+{
+    /* only there to interrupt poll() */
+}
+
+/** \brief  Wait for jobs and fork a child for each one
+ *
+ * Does nothing unless "-forkserver" was given.  Otherwise this only returns
+ * in the children, which go on starting the emulation with the options of
+ * their job.
+ *
+ * \return  0 to start the emulation, -1 on error
+ */
+int forkserver_run(void)
+{
+    struct pollfd pfd;
+    int listen_fd, fd;
+    int log_async = 0;
+    pid_t pid;
+
+    if (socket_name == NULL) {
+        return 0;
+    }
+
+    forkserver_log = log_open("Fork Server");
+
+    listen_fd = open_socket();
+    if (listen_fd < 0) {
+        return -1;
+    }
+
+    resources_get_int("LogAsync", &log_async);
+    if (log_async) {
+        resources_set_int("LogAsync", 0);
+    }
+
+    signal(SIGCHLD, sigchld_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    log_message(forkserver_log, "Waiting for jobs on `%s'.", socket_name);
+
+    while (1) {
+        reap_children();
+
+        pfd.fd = listen_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 1000) <= 0) {
+            continue;
+        }
+
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        pid = fork();
+        if (pid < 0) {
+            log_error(forkserver_log, "Cannot fork: %s.", strerror(errno));
+            close(fd);
+            continue;
+        }
+        if (pid == 0) {
+            signal(SIGPIPE, SIG_DFL);
+            return start_job(listen_fd, fd, log_async);
+        }
+
+        children = lib_realloc(children, sizeof(forkserver_child_t) * (size_t)(children_num + 1));
+        children[children_num].pid = pid;
+        children[children_num].fd = fd;
+        children_num++;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_forkserver(const char *param, void *extra_param)
+{
+    util_string_set(&socket_name, param);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-forkserver", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_forkserver, NULL, NULL, NULL,
+      "<socket>", "Initialize once, then fork an emulator for each job received on the socket" },
+    CMDLINE_LIST_END
+};
+
+int forkserver_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void forkserver_shutdown(void)
+{
+    lib_free(socket_name);
+    socket_name = NULL;
+}
+
+#else /* #ifdef FORKSERVER_SUPPORTED */
+
+int forkserver_run(void)
+{
+    return 0;
+}
+
+int forkserver_cmdline_options_init(void)
+{
+    return 0;
+}
+
+void forkserver_shutdown(void)
+{
+}
+
+#endif /* #ifdef FORKSERVER_SUPPORTED */
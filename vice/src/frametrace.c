@@ -0,0 +1,339 @@
+/*
+ * frametrace.c - Host time spent in the parts of the emulator per frame.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+
+/* While "FrameTrace" is enabled, the parts of the emulator that can make a
+   frame late mark where they start and end.  Every thread writes the marks
+   with host timestamps to a ring buffer of its own, so writing one takes no
+   lock and costs a clock read, and only the most recent marks are kept.
+
+   The rings are saved on demand, from the monitor with "frametracesave", in
+   the JSON trace event format read by chrome://tracing and Perfetto, which
+   show the spans of all threads on one timeline.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#endif
+
+#include "archdep.h"
+#include "archdep_large_alloc.h"
+#include "benchmark.h"
+#include "cmdline.h"
+#include "frametrace.h"
+#include "lib.h"
+#include "log.h"
+#include "mainlock.h"
+#include "resources.h"
+#include "types.h"
+
+/* Threads that get a ring, marks of any more threads are dropped */
+#define FRAMETRACE_THREADS  16
+
+/* Marks kept per thread, a power of 2 */
+#define FRAMETRACE_RECORDS  32768
+
+typedef struct frametrace_record_s {
+    uint64_t time;      /* benchmark_now() */
+    uint8_t span;       /* FRAMETRACE_* */
+    uint8_t end;        /* end of the span, else start */
+} frametrace_record_t;
+
+typedef struct frametrace_thread_s {
+    char name[16];
+    frametrace_record_t *records;
+    /* Marks written so far, the ring holds the last FRAMETRACE_RECORDS */
+    atomic_uint_least64_t written;
+} frametrace_thread_t;
+
+/* Names of the spans in the trace */
+static const char * const span_names[FRAMETRACE_NUM] = {
+    "frame",
+    "drives",
+    "sound flush",
+    "render",
+    "render queue wait",
+    "mainlock wait",
+    "pacing"
+};
+
+/* "FrameTrace" resource, flag: record marks */
+int frametrace_enabled = 0;
+
+static log_t frametrace_log = LOG_DEFAULT;
+
+static frametrace_thread_t threads[FRAMETRACE_THREADS];
+static atomic_int threads_num;
+
+#ifdef USE_VICE_THREAD
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+
+/* Stored for threads that did not get a ring */
+static frametrace_thread_t no_thread;
+#endif
+
+/* Give a ring to the calling thread, NULL if all are taken.  The rings are
+   only freed on shutdown, so the marks of threads that have ended can still
+   be saved.  */
+static frametrace_thread_t *thread_new(void)
+{
+    frametrace_thread_t *thread;
+    int num = atomic_load_explicit(&threads_num, memory_order_relaxed);
+
+    if (num == FRAMETRACE_THREADS) {
+        return NULL;
+    }
+
+    thread = &threads[num];
+    thread->records = archdep_large_alloc(FRAMETRACE_RECORDS * sizeof(frametrace_record_t));
+    atomic_init(&thread->written, 0);
+    if (mainlock_is_vice_thread()) {
+        strcpy(thread->name, "emulation");
+    } else {
+        snprintf(thread->name, sizeof(thread->name), "thread %d", num + 1);
+    }
+
+    atomic_store_explicit(&threads_num, num + 1, memory_order_release);
+    return thread;
+}
+
+#ifdef USE_VICE_THREAD
+static void thread_key_create(void)
+{
+    pthread_key_create(&thread_key, NULL);
+}
+#endif
+
+static frametrace_thread_t *thread_current(void)
+{
+#ifdef USE_VICE_THREAD
+    frametrace_thread_t *thread;
+
+    pthread_once(&thread_key_once, thread_key_create);
+
+    thread = pthread_getspecific(thread_key);
+    if (thread == NULL) {
+        pthread_mutex_lock(&threads_lock);
+        thread = thread_new();
+        pthread_mutex_unlock(&threads_lock);
+        if (thread == NULL) {
+            log_warning(frametrace_log, "More than %d threads, marks of the others are dropped.",
+                        FRAMETRACE_THREADS);
+            thread = &no_thread;
+        }
+        pthread_setspecific(thread_key, thread);
+    }
+    return thread != &no_thread ? thread : NULL;
+#else
+    if (atomic_load_explicit(&threads_num, memory_order_relaxed) == 0) {
+        return thread_new();
+    }
+    return &threads[0];
+#endif
+}
+
+/** \brief  Mark the start or end of a span on the timeline of the calling
+ *          thread, use FRAMETRACE_BEGIN() and FRAMETRACE_END() instead
+ *
+ * \param[in]   span    FRAMETRACE_* span
+ * \param[in]   end     end of the span, else start
+ */
+void frametrace_event(int span, int end)
+{
+    frametrace_thread_t *thread = thread_current();
+    frametrace_record_t *record;
+    uint64_t written;
+
+    if (thread == NULL) {
+        return;
+    }
+
+    /* only this thread writes to the ring, the release lets a thread saving
+       it see the mark complete */
+    written = atomic_load_explicit(&thread->written, memory_order_relaxed);
+    record = &thread->records[written & (FRAMETRACE_RECORDS - 1)];
+    record->time = benchmark_now();
+    record->span = (uint8_t)span;
+    record->end = (uint8_t)end;
+    atomic_store_explicit(&thread->written, written + 1, memory_order_release);
+}
+
+/* Copy the marks of a thread that are still complete, the ring may be
+   written to while it is copied.  Returns the number of marks copied.  */
+static unsigned int thread_copy(frametrace_thread_t *thread, frametrace_record_t *copy)
+{
+    uint64_t first;
+    uint64_t last;
+    uint64_t written;
+    uint64_t i;
+
+    last = atomic_load_explicit(&thread->written, memory_order_acquire);
+    first = last > FRAMETRACE_RECORDS ? last - FRAMETRACE_RECORDS : 0;
+    for (i = first; i < last; i++) {
+        copy[i - first] = thread->records[i & (FRAMETRACE_RECORDS - 1)];
+    }
+
+    /* marks are overwritten by the ones FRAMETRACE_RECORDS later, including
+       the one that may be written right now */
+    written = atomic_load_explicit(&thread->written, memory_order_acquire);
+    if (written + 1 > first + FRAMETRACE_RECORDS) {
+        i = written + 1 - FRAMETRACE_RECORDS;
+        if (i >= last) {
+            return 0;
+        }
+        memmove(copy, copy + (i - first), (size_t)(last - i) * sizeof(frametrace_record_t));
+        first = i;
+    }
+    return (unsigned int)(last - first);
+}
+
+/** \brief  Save the recorded marks of all threads as a Chrome/Perfetto trace
+ *
+ * Ends of spans whose start is no longer in a ring are left out, spans that
+ * have not ended yet are not closed.
+ *
+ * \param[in]   filename    name of the JSON file to write
+ *
+ * \return  number of marks saved, -1 on error
+ */
+int frametrace_save(const char *filename)
+{
+    frametrace_record_t *copies[FRAMETRACE_THREADS];
+    unsigned int counts[FRAMETRACE_THREADS];
+    int num = atomic_load_explicit(&threads_num, memory_order_acquire);
+    uint64_t base = UINT64_MAX;
+    int saved = 0;
+    int depth;
+    unsigned int i;
+    int t;
+    FILE *fp;
+
+    fp = fopen(filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        log_error(frametrace_log, "Cannot open `%s' for writing.", filename);
+        return -1;
+    }
+
+    for (t = 0; t < num; t++) {
+        copies[t] = lib_malloc(FRAMETRACE_RECORDS * sizeof(frametrace_record_t));
+        counts[t] = thread_copy(&threads[t], copies[t]);
+        if (counts[t] > 0 && copies[t][0].time < base) {
+            base = copies[t][0].time;
+        }
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+            "\"args\":{\"name\":\"%s\"}}", archdep_program_name());
+    for (t = 0; t < num; t++) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}", t + 1, threads[t].name);
+
+        depth = 0;
+        for (i = 0; i < counts[t]; i++) {
+            frametrace_record_t *record = &copies[t][i];
+            uint64_t time = record->time - base;
+
+            if (record->end) {
+                if (depth == 0) {
+                    continue;
+                }
+                depth--;
+            } else {
+                depth++;
+            }
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%"PRIu64".%03u,"
+                    "\"pid\":1,\"tid\":%d}",
+                    span_names[record->span], record->end ? 'E' : 'B',
+                    time / 1000, (unsigned int)(time % 1000), t + 1);
+            saved++;
+        }
+        lib_free(copies[t]);
+    }
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) != 0) {
+        log_error(frametrace_log, "Cannot write `%s'.", filename);
+        return -1;
+    }
+    return saved;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_frametrace_enabled(int val, void *param)
+{
+    frametrace_enabled = val ? 1 : 0;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "FrameTrace", 0, RES_EVENT_NO, NULL,
+      &frametrace_enabled, set_frametrace_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int frametrace_resources_init(void)
+{
+    frametrace_log = log_open("FrameTrace");
+
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-frametrace", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FrameTrace", (resource_value_t)1,
+      NULL, "Record where the host time of every frame goes, to be saved from the monitor" },
+    { "+frametrace", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FrameTrace", (resource_value_t)0,
+      NULL, "Do not record where the host time of every frame goes (default)" },
+    CMDLINE_LIST_END
+};
+
+int frametrace_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void frametrace_shutdown(void)
+{
+    int num = atomic_load_explicit(&threads_num, memory_order_acquire);
+    int t;
+
+    frametrace_enabled = 0;
+
+    for (t = 0; t < num; t++) {
+        archdep_large_free(threads[t].records);
+        threads[t].records = NULL;
+    }
+    atomic_store_explicit(&threads_num, 0, memory_order_release);
+}
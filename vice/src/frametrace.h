@@ -0,0 +1,68 @@
+/*
+ * frametrace.h - Host time spent in the parts of the emulator per frame.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+
+#ifndef VICE_FRAMETRACE_H
+#define VICE_FRAMETRACE_H
+
+#include "types.h"
+
+/* Spans recorded on the timeline, nested spans are left out of the time of
+   the spans around them in the trace viewer.  */
+enum {
+    FRAMETRACE_FRAME = 0,       /* from one vsync to the next */
+    FRAMETRACE_DRIVES,          /* drive CPUs catching up with the main CPU */
+    FRAMETRACE_SOUND_FLUSH,     /* sound generated and passed to the device */
+    FRAMETRACE_RENDER,          /* frame rendered through the video filters */
+    FRAMETRACE_RENDER_QUEUE,    /* waiting for the render queue lock */
+    FRAMETRACE_MAINLOCK,        /* waiting for the other thread to hand over the main lock */
+    FRAMETRACE_PACING,          /* sleeping to keep the emulation speed */
+    FRAMETRACE_NUM
+};
+
+/* Set while events are recorded */
+extern int frametrace_enabled;
+
+void frametrace_event(int span, int end);
+
+/* Start and end a span on the timeline of the calling thread.  */
+#define FRAMETRACE_BEGIN(span)                                                \
+    do {                                                                      \
+        if (frametrace_enabled) {                                             \
+            frametrace_event((span), 0);                                      \
+        }                                                                     \
+    } while (0)
+#define FRAMETRACE_END(span)                                                  \
+    do {                                                                      \
+        if (frametrace_enabled) {                                             \
+            frametrace_event((span), 1);                                      \
+        }                                                                     \
+    } while (0)
+
+int frametrace_save(const char *filename);
+
+int frametrace_resources_init(void);
+int frametrace_cmdline_options_init(void);
+void frametrace_shutdown(void);
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ * fsdevice-async.c - Reading host files and directories in the background.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* A channel reading a host file or a directory listing gets its data from a
+   job done by a single I/O thread, in the order the channels were opened.
+   The thread reads ahead into a buffer of the job, which the emulation
+   takes bytes from, so it only waits for the host when it catches up with
+   the thread.  A directory listing is made line by line, the emulation can
+   print the first lines while the thread still looks at the other files.
+
+   The file or directory belongs to the thread until the job is stopped with
+   fsdevice_async_stop().  If the thread cannot be started, no jobs are made
+   and the channels read the host directly.  */
+
+#include "vice.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "fileio.h"
+#include "fsdevice-async.h"
+#include "fsdevice-read.h"
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "util.h"
+#include "vdrive.h"
+
+/* The thread waits when this many bytes of a job are not taken yet.  */
+#define ASYNC_READAHEAD_MAX (256 * 1024)
+
+/* Size of the reads from host files.  */
+#define ASYNC_CHUNK         4096
+
+typedef enum async_kind_e {
+    ASYNC_FILE,
+    ASYNC_DIRECTORY
+} async_kind_t;
+
+struct fsdevice_async_s {
+    async_kind_t kind;
+
+    /* ASYNC_FILE */
+    fileio_info_t *finfo;
+
+    /* ASYNC_DIRECTORY */
+    vdrive_t *vdrive;
+    archdep_dir_t *host_dir;
+    char *dir;
+    char *dirmask;
+    unsigned int format;
+
+    /* data read by the thread, the emulation takes it from `pos' */
+    uint8_t *data;
+    size_t len;
+    size_t size;
+    size_t pos;
+
+    int done;
+    int error;
+    int cancel;
+
+    struct fsdevice_async_s *next;
+};
+
+static log_t fsdevice_async_log = LOG_DEFAULT;
+
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a job was queued */
+static pthread_cond_t async_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when the thread added data to a job or finished it */
+static pthread_cond_t async_produced = PTHREAD_COND_INITIALIZER;
+/* signalled when the emulation took data from a job or stopped it */
+static pthread_cond_t async_consumed = PTHREAD_COND_INITIALIZER;
+
+static fsdevice_async_t *queue_head = NULL;
+static fsdevice_async_t *queue_tail = NULL;
+
+static int thread_started = 0;
+static int thread_failed = 0;
+static pthread_t async_thread;
+
+/* Add data to a job, waiting while enough of it is not taken yet.  Returns
+   0 if the job was stopped.  Called with the lock held.  */
+static int job_append(fsdevice_async_t *job, const uint8_t *buf, size_t num)
+{
+    while (job->len - job->pos >= ASYNC_READAHEAD_MAX && !job->cancel) {
+        pthread_cond_wait(&async_consumed, &async_lock);
+    }
+    if (job->cancel) {
+        return 0;
+    }
+
+    /* drop what was taken already */
+    if (job->pos > 0) {
+        memmove(job->data, job->data + job->pos, job->len - job->pos);
+        job->len -= job->pos;
+        job->pos = 0;
+    }
+    if (job->len + num > job->size) {
+        job->size = job->len + num + ASYNC_CHUNK;
+        job->data = lib_realloc(job->data, job->size);
+    }
+    memcpy(job->data + job->len, buf, num);
+    job->len += num;
+
+    pthread_cond_broadcast(&async_produced);
+    return 1;
+}
+
+static void run_file_job(fsdevice_async_t *job)
+{
+    uint8_t buf[ASYNC_CHUNK];
+    unsigned int num;
+    int error;
+
+    while (1) {
+        num = fileio_read(job->finfo, buf, ASYNC_CHUNK);
+        error = fileio_ferror(job->finfo);
+
+        pthread_mutex_lock(&async_lock);
+        if (error) {
+            job->error = 1;
+        }
+        if (num == 0 || error || !job_append(job, buf, num)) {
+            pthread_mutex_unlock(&async_lock);
+            return;
+        }
+        pthread_mutex_unlock(&async_lock);
+    }
+}
+
+static void run_directory_job(fsdevice_async_t *job)
+{
+    uint8_t line[ARCHDEP_PATH_MAX];
+    int len, last, more;
+
+    do {
+        len = fsdevice_directory_line(job->vdrive, job->host_dir, job->dir,
+                                      job->dirmask, job->format, line, &last);
+
+        pthread_mutex_lock(&async_lock);
+        more = job_append(job, line, (size_t)len);
+        pthread_mutex_unlock(&async_lock);
+    } while (more && !last);
+}
+
+static void *async_thread_main(void *unused)
+{
+    fsdevice_async_t *job;
+
+    pthread_mutex_lock(&async_lock);
+    while (1) {
+        while (queue_head == NULL) {
+            pthread_cond_wait(&async_queued, &async_lock);
+        }
+        job = queue_head;
+        queue_head = job->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        job->next = NULL;
+        pthread_mutex_unlock(&async_lock);
+
+        if (job->kind == ASYNC_FILE) {
+            run_file_job(job);
+        } else {
+            run_directory_job(job);
+        }
+
+        pthread_mutex_lock(&async_lock);
+        job->done = 1;
+        pthread_cond_broadcast(&async_produced);
+    }
+
+    return NULL;
+}
+
+static int start_thread(void)
+{
+    if (!thread_started && !thread_failed) {
+        if (pthread_create(&async_thread, NULL, async_thread_main, NULL)) {
+            log_error(fsdevice_async_log,
+                      "Cannot start host I/O thread, reading directly.");
+            thread_failed = 1;
+        } else {
+            pthread_detach(async_thread);
+            thread_started = 1;
+        }
+    }
+    return thread_started;
+}
+
+static fsdevice_async_t *job_new(async_kind_t kind)
+{
+    fsdevice_async_t *job;
+
+    pthread_mutex_lock(&async_lock);
+    if (!start_thread()) {
+        pthread_mutex_unlock(&async_lock);
+        return NULL;
+    }
+    pthread_mutex_unlock(&async_lock);
+
+    job = lib_calloc(1, sizeof(fsdevice_async_t));
+    job->kind = kind;
+    return job;
+}
+
+static void job_queue(fsdevice_async_t *job)
+{
+    pthread_mutex_lock(&async_lock);
+    if (queue_tail == NULL) {
+        queue_head = job;
+    } else {
+        queue_tail->next = job;
+    }
+    queue_tail = job;
+    pthread_cond_signal(&async_queued);
+    pthread_mutex_unlock(&async_lock);
+}
+
+/** \brief  Start reading a host file in the background
+ *
+ * \param[in]   finfo   file opened for reading, used by the thread until
+ *                      the job is stopped
+ *
+ * \return  job, or NULL if the file has to be read directly
+ */
+fsdevice_async_t *fsdevice_async_file_start(fileio_info_t *finfo)
+{
+    fsdevice_async_t *job = job_new(ASYNC_FILE);
+
+    if (job != NULL) {
+        job->finfo = finfo;
+        job_queue(job);
+    }
+    return job;
+}
+
+/** \brief  Start making a directory listing in the background
+ *
+ * \param[in]   vdrive      drive
+ * \param[in]   host_dir    directory, used by the thread until the job is
+ *                          stopped
+ * \param[in]   dir         path of the directory
+ * \param[in]   dirmask     pattern of the files to list
+ *
+ * \return  job, or NULL if the listing has to be made directly
+ */
+fsdevice_async_t *fsdevice_async_directory_start(vdrive_t *vdrive,
+                                                 archdep_dir_t *host_dir,
+                                                 const char *dir,
+                                                 const char *dirmask)
+{
+    fsdevice_async_t *job = job_new(ASYNC_DIRECTORY);
+
+    if (job != NULL) {
+        job->vdrive = vdrive;
+        job->host_dir = host_dir;
+        job->dir = lib_strdup(dir);
+        job->dirmask = lib_strdup(dirmask);
+        job->format = fsdevice_directory_format(vdrive);
+        job_queue(job);
+    }
+    return job;
+}
+
+/** \brief  Get the next byte of a job
+ *
+ * Waits for the thread if it has not read that far yet.  Like the direct
+ * reads, EOF is signalled along with the last byte.
+ *
+ * \param[in]   job     job
+ * \param[out]  data    byte
+ *
+ * \return  SERIAL_OK, SERIAL_EOF or SERIAL_ERROR
+ */
+int fsdevice_async_read(fsdevice_async_t *job, uint8_t *data)
+{
+    int rc = SERIAL_OK;
+
+    pthread_mutex_lock(&async_lock);
+
+    while (job->pos == job->len && !job->done) {
+        pthread_cond_wait(&async_produced, &async_lock);
+    }
+
+    if (job->pos == job->len) {
+        *data = 0xc7;
+        rc = job->error ? SERIAL_ERROR : SERIAL_EOF;
+    } else {
+        *data = job->data[job->pos++];
+        pthread_cond_signal(&async_consumed);
+
+        /* find out if this was the last byte */
+        while (job->pos == job->len && !job->done) {
+            pthread_cond_wait(&async_produced, &async_lock);
+        }
+        if (job->pos == job->len) {
+            rc = job->error ? SERIAL_ERROR : SERIAL_EOF;
+        }
+    }
+
+    pthread_mutex_unlock(&async_lock);
+
+    return rc;
+}
+
+/** \brief  Stop a job and free it
+ *
+ * Returns when the thread no longer uses the file or directory of the job.
+ *
+ * \param[in]   job     job, may be NULL
+ */
+void fsdevice_async_stop(fsdevice_async_t *job)
+{
+    fsdevice_async_t *p, *prev = NULL;
+
+    if (job == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&async_lock);
+
+    for (p = queue_head; p != NULL; prev = p, p = p->next) {
+        if (p == job) {
+            break;
+        }
+    }
+
+    if (p != NULL) {
+        /* not started yet */
+        if (prev == NULL) {
+            queue_head = job->next;
+        } else {
+            prev->next = job->next;
+        }
+        if (queue_tail == job) {
+            queue_tail = prev;
+        }
+    } else {
+        job->cancel = 1;
+        pthread_cond_broadcast(&async_consumed);
+        while (!job->done) {
+            pthread_cond_wait(&async_produced, &async_lock);
+        }
+    }
+
+    pthread_mutex_unlock(&async_lock);
+
+    lib_free(job->dir);
+    lib_free(job->dirmask);
+    lib_free(job->data);
+    lib_free(job);
+}
+
+void fsdevice_async_init(void)
+{
+    fsdevice_async_log = log_open("FS Device I/O");
+}
@@ -0,0 +1,45 @@
+/*
+ * fsdevice-async.h - Reading host files and directories in the background.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FSDEVICE_ASYNC_H
+#define VICE_FSDEVICE_ASYNC_H
+
+#include "archdep_dir.h"
+#include "types.h"
+
+struct fileio_info_s;
+struct vdrive_s;
+
+typedef struct fsdevice_async_s fsdevice_async_t;
+
+void fsdevice_async_init(void);
+
+fsdevice_async_t *fsdevice_async_file_start(struct fileio_info_s *finfo);
+fsdevice_async_t *fsdevice_async_directory_start(struct vdrive_s *vdrive,
+                                                 archdep_dir_t *host_dir,
+                                                 const char *dir,
+                                                 const char *dirmask);
+int fsdevice_async_read(fsdevice_async_t *job, uint8_t *data);
+void fsdevice_async_stop(fsdevice_async_t *job);
+
+#endif
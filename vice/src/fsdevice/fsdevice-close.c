@@ -38,6 +38,7 @@
 
 #include "cbmdos.h"
 #include "fileio.h"
+#include "fsdevice-async.h"
 #include "fsdevice-close.h"
 #include "fsdevice-read.h"
 #include "fsdevicetypes.h"
@@ -57,6 +58,9 @@ int fsdevice_close(vdrive_t *vdrive, unsigned int secondary)
         return FLOPPY_COMMAND_OK;
     }
 
+    fsdevice_async_stop(bufinfo->async);
+    bufinfo->async = NULL;
+
     switch (bufinfo->mode) {
         case Relative:
             fsdevice_relative_pad_record(bufinfo);
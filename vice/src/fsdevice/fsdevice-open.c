@@ -45,6 +45,7 @@
 #include "cbmdos.h"
 #include "charset.h"
 #include "fileio.h"
+#include "fsdevice-async.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-read.h"
 #include "fsdevice-resources.h"
@@ -214,6 +215,9 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
     bufinfo[secondary].mode = Directory;
     bufinfo[secondary].host_dir = host_dir;
     bufinfo[secondary].eof = 0;
+    bufinfo[secondary].async = fsdevice_async_directory_start(vdrive, host_dir,
+                                                              bufinfo[secondary].dir,
+                                                              bufinfo[secondary].dirmask);
 
     return FLOPPY_COMMAND_OK;
 }
@@ -367,6 +371,8 @@ static int fsdevice_open_file(vdrive_t *vdrive, unsigned int secondary,
 
         if (bufinfo[secondary].mode == Relative) {
             fsdevice_relative_switch_record(vdrive, &bufinfo[secondary], 0, 0);
+        } else {
+            bufinfo[secondary].async = fsdevice_async_file_start(finfo);
         }
 
         return FLOPPY_COMMAND_OK;
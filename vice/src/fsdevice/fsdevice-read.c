@@ -41,6 +41,7 @@
 #include "archdep.h"
 #include "cbmdos.h"
 #include "fileio.h"
+#include "fsdevice-async.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-resources.h"
 #include "fsdevicetypes.h"
@@ -107,6 +108,9 @@ static int command_read(bufinfo_t *bufinfo, uint8_t *data)
         }
         return SERIAL_OK;
     } else {
+        if (bufinfo->async) {
+            return fsdevice_async_read(bufinfo->async, data);
+        }
         if (bufinfo->fileio_info) {
             /* If we are already at an EOF state, check next read, next stream
                may be available */
@@ -377,19 +381,10 @@ static int relative_read(vdrive_t *vdrive, bufinfo_t *bufinfo, uint8_t *data)
     return SERIAL_OK;
 }
 
-static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
-                                  uint8_t *data, unsigned int secondary)
+/* Format of the files shown in directory listings of a unit.  */
+unsigned int fsdevice_directory_format(vdrive_t *vdrive)
 {
-    int i, l, f, statrc;
-    unsigned long blocks;
-    const char *direntry;
-    size_t filelen;
-    unsigned int isdir;
-    fileio_info_t *finfo = NULL;
     unsigned int format = 0;
-    char buf[ARCHDEP_PATH_MAX];
-
-    bufinfo->bufp = bufinfo->name;
 
     if (fsdevice_convert_p00_enabled[(vdrive->unit) - 8]) {
         format |= FILEIO_FORMAT_P00;
@@ -397,6 +392,27 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
     if (!fsdevice_hide_cbm_files_enabled[vdrive->unit - 8]) {
         format |= FILEIO_FORMAT_RAW;
     }
+    return format;
+}
+
+/* Put the next line of the directory listing of `host_dir' into `line',
+   which must hold ARCHDEP_PATH_MAX bytes.  Returns the length of the line,
+   `last' is set for the final "BLOCKS FREE." line.  This is also called
+   from the I/O thread, see fsdevice-async.c.  */
+int fsdevice_directory_line(vdrive_t *vdrive, archdep_dir_t *host_dir,
+                            const char *dir, const char *dirmask,
+                            unsigned int format, uint8_t *line, int *last)
+{
+    int i, l, f, statrc, type = 0;
+    unsigned long blocks;
+    const char *direntry;
+    size_t filelen;
+    unsigned int isdir;
+    fileio_info_t *finfo = NULL;
+    char buf[ARCHDEP_PATH_MAX];
+    int len;
+
+    *last = 0;
 
     /*
      * Find the next directory entry and return it as a CBM
@@ -410,13 +426,13 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
         uint8_t *p;
         finfo = NULL;
 
-        direntry = archdep_readdir(bufinfo->host_dir);
+        direntry = archdep_readdir(host_dir);
 
         if (direntry == NULL) {
             break;
         }
 
-        finfo = fileio_open(direntry, bufinfo->dir, format,
+        finfo = fileio_open(direntry, dir, format,
                             FILEIO_COMMAND_STAT | FILEIO_COMMAND_FSNAME,
                             FILEIO_TYPE_PRG, NULL);
 
@@ -424,13 +440,13 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
             continue;
         }
 
-        bufinfo->type = finfo->type;
+        type = finfo->type;
 
-        if (bufinfo->dirmask[0] == '\0') {
+        if (dirmask[0] == '\0') {
             break;
         }
 
-        l = (int)strlen(bufinfo->dirmask);
+        l = (int)strlen(dirmask);
 
         /* fix 2 bugs:
          * - pattern A*Z would not match AZZ because it jumped to the first Z
@@ -439,11 +455,11 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
          */
 
         for (p = finfo->name, i = 0;
-             *p && bufinfo->dirmask[i] && i < l; i++) {
-            if (bufinfo->dirmask[i] == '?') {
+             *p && dirmask[i] && i < l; i++) {
+            if (dirmask[i] == '?') {
                 p++;
-            } else if (bufinfo->dirmask[i] == '*') {
-                if (bufinfo->dirmask[i + 1] == '\0') {
+            } else if (dirmask[i] == '*') {
+                if (dirmask[i + 1] == '\0') {
                     f = 0;
                     break;
                 } /* end mask */
@@ -451,19 +467,19 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
                  * When at the * in A*XYZ, skip to 3 positions before
                  * the end of the file name to try to match XYZ.  */
                 size_t rest_of_filename = strlen((const char *)p);
-                size_t rest_of_pattern = strlen(&bufinfo->dirmask[i + 1]);
+                size_t rest_of_pattern = strlen(&dirmask[i + 1]);
 
                 if (rest_of_filename < rest_of_pattern) {
                     break;      /* no match: file name too short */
                 }
                 p = p + rest_of_filename - rest_of_pattern;
             } else {
-                if (*p != bufinfo->dirmask[i]) {
+                if (*p != dirmask[i]) {
                     break;
                 }
                 p++;
             }
-            if (*p == '\0' && bufinfo->dirmask[i + 1] == '\0') {
+            if (*p == '\0' && dirmask[i + 1] == '\0') {
                 f = 0;
                 break;
             }
@@ -472,8 +488,8 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
          * pattern "FOO*" should match filename "FOO". */
         if (f > 0 &&
                 *p == '\0' &&
-                bufinfo->dirmask[i    ] == '*' &&
-                bufinfo->dirmask[i + 1] == '\0') {
+                dirmask[i    ] == '*' &&
+                dirmask[i + 1] == '\0') {
             f = 0;
         }
         if (f > 0) {
@@ -482,11 +498,11 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
     } while (f);
 
     if (direntry != NULL) {
-        uint8_t *p = bufinfo->name;
+        uint8_t *p = line;
         int splatfile = 0;
         int protectfile = 0;
 
-        strcpy(buf, bufinfo->dir);
+        strcpy(buf, dir);
         strcat(buf, ARCHDEP_DIR_SEP_STR);
         strcat(buf, direntry);
 
@@ -554,7 +570,7 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
             } else {
                 *p++ = '*'; /* splat file */
             }
-            switch (bufinfo->type) {
+            switch (type) {
                 case CBMDOS_FT_DEL:
                     *p++ = 'D';
                     *p++ = 'E';
@@ -591,7 +607,7 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
 
         /* some (really very) old programs rely on the directory
            entry to be 32 Bytes in total (incl. nullbyte) */
-        l = (int)strlen((char *)(bufinfo->name + 4)) + 4;
+        l = (int)strlen((char *)(line + 4)) + 4;
         while (l < 31) {
             *p++ = ' ';
             l++;
@@ -599,9 +615,9 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
 
         *p++ = '\0';
 
-        bufinfo->buflen = (int)(p - bufinfo->name);
+        len = (int)(p - line);
     } else {
-        uint8_t *p = bufinfo->name;
+        uint8_t *p = line;
 
         /* EOF => End file */
 
@@ -615,13 +631,30 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
         p += 13;
 
         memset(p, 0, 3);
-        bufinfo->buflen = 32;
-        bufinfo->eof++;
+        len = 32;
+        *last = 1;
     }
 
     if (finfo != NULL) {
         fileio_close(finfo);
     }
+
+    return len;
+}
+
+static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
+                                  uint8_t *data, unsigned int secondary)
+{
+    int last;
+
+    bufinfo->bufp = bufinfo->name;
+    bufinfo->buflen = fsdevice_directory_line(vdrive, bufinfo->host_dir,
+                                              bufinfo->dir, bufinfo->dirmask,
+                                              fsdevice_directory_format(vdrive),
+                                              bufinfo->name, &last);
+    if (last) {
+        bufinfo->eof++;
+    }
 }
 
 
@@ -633,6 +666,10 @@ static int command_directory(vdrive_t *vdrive, bufinfo_t *bufinfo,
     }
 
     if (bufinfo->buflen <= 0) {
+        if (bufinfo->async) {
+            /* the header is done, the rest comes from the I/O thread */
+            return fsdevice_async_read(bufinfo->async, data);
+        }
         if (bufinfo->eof) {
             *data = 0xc7;
             return SERIAL_EOF;
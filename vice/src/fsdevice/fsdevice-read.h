@@ -29,6 +29,8 @@
 
 #include "types.h"
 
+#include "archdep_dir.h"
+
 struct vdrive_s;
 struct bufinfo_s;
 
@@ -38,5 +40,9 @@ void fsdevice_relative_pad_record(struct bufinfo_s *bufinfo);
 int fsdevice_relative_switch_record(struct vdrive_s *vdrive,
                                     struct bufinfo_s *bufinfo,
                                     int record, int pos);
+unsigned int fsdevice_directory_format(struct vdrive_s *vdrive);
+int fsdevice_directory_line(struct vdrive_s *vdrive, archdep_dir_t *host_dir,
+                            const char *dir, const char *dirmask,
+                            unsigned int format, uint8_t *line, int *last);
 
 #endif
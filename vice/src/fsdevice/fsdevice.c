@@ -45,6 +45,7 @@
 #include "attach.h"
 #include "cbmdos.h"
 #include "fileio.h"
+#include "fsdevice-async.h"
 #include "fsdevice-close.h"
 #include "fsdevice-flush.h"
 #include "fsdevice-open.h"
@@ -209,6 +210,8 @@ void fsdevice_init(void)
 {
     unsigned int i, j;
 
+    fsdevice_async_init();
+
     for (i = 0; i < FSDEVICE_DEVICE_MAX; i++) {
         bufinfo_t *bufinfo;
 
@@ -42,11 +42,13 @@ enum fsmode {
 
 struct fileio_info_s;
 struct tape_image_s;
+struct fsdevice_async_s;
 
 struct bufinfo_s {
     struct fileio_info_s *fileio_info;
     archdep_dir_t *host_dir;
     struct tape_image_s *tape;
+    struct fsdevice_async_s *async;     /* background reading, see fsdevice-async.c */
     enum fsmode mode;
     char *dir;
     uint8_t *name;
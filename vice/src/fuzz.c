@@ -0,0 +1,425 @@
+/*
+ * fuzz.c - Run a 6502 program over and over with inputs from a fuzzer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With "-fuzzinput <address>" the emulator runs a harness program once per
+   input of a fuzzer.  The harness is autostarted as usual and writes to the
+   debug cartridge when it is ready to take an input.  The machine state at
+   that point is kept as an in-memory snapshot; every run restores it, puts
+   the input into memory and lets the harness go on until it writes its exit
+   code to the debug cartridge, jams the CPU or reaches the "-fuzzcycles"
+   limit.  An exit code other than 0 and a jam are crashes.
+
+   The input is read from the file given with "-fuzzfile", or from stdin.
+   Its length is stored as a 16-bit little-endian value at the input
+   address, followed by at most "-fuzzsize" bytes of the input.
+
+   While fuzzing, the CPU counts the edges between the destinations of the
+   branches, jumps, calls and returns in a map like the one of AFL.  When
+   started by afl-fuzz, the map is the shared memory of afl-fuzz and the
+   emulator talks the fork server protocol of AFL, but without forking: it
+   reports its own PID for every run and restores the snapshot instead.
+   Without afl-fuzz, a single input is run and the emulator exits with its
+   exit code.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef UNIX_COMPILE
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "fuzz.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "types.h"
+#include "util.h"
+
+/* File descriptors of the AFL fork server, control and status.  */
+#define FUZZ_FORKSRV_FD     198
+
+typedef enum fuzz_state_e {
+    FUZZ_OFF,
+    FUZZ_SETUP,         /* the harness is not ready yet */
+    FUZZ_RUNNING,
+    FUZZ_PENDING        /* waiting for the trap starting the next run */
+} fuzz_state_t;
+
+typedef enum fuzz_result_e {
+    FUZZ_RESULT_OK,
+    FUZZ_RESULT_CRASH,
+    FUZZ_RESULT_JAM,
+    FUZZ_RESULT_TIMEOUT
+} fuzz_result_t;
+
+uint8_t *fuzz_coverage = NULL;
+unsigned int fuzz_prev_loc = 0;
+
+static log_t fuzz_log = LOG_DEFAULT;
+
+static int input_addr = -1;
+static int input_size = 256;
+static char *input_name = NULL;
+static CLOCK run_cycles = 0;
+
+static fuzz_state_t state = FUZZ_OFF;
+static int afl_mode = 0;
+static int run_exit_code = 0;
+
+static uint8_t *input = NULL;
+
+/* Machine state every run starts from */
+static snapshot_memory_t *baseline = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+/* Use the map of afl-fuzz if there is one.  */
+static void open_coverage(void)
+{
+#ifdef UNIX_COMPILE
+    const char *shm_id = getenv("__AFL_SHM_ID");
+
+    if (shm_id != NULL) {
+        void *map = shmat(atoi(shm_id), NULL, 0);
+
+        if (map != (void *)-1) {
+            fuzz_coverage = map;
+            return;
+        }
+        log_error(fuzz_log, "Cannot attach the coverage map of afl-fuzz.");
+    }
+#endif
+    fuzz_coverage = lib_calloc(1, FUZZ_MAP_SIZE);
+}
+
+/* Tell afl-fuzz we are there, if it started us.  */
+static int afl_hello(void)
+{
+#ifdef UNIX_COMPILE
+    uint32_t value = 0;
+
+    if (getenv("__AFL_SHM_ID") != NULL) {
+        return write(FUZZ_FORKSRV_FD + 1, &value, 4) == 4;
+    }
+#endif
+    return 0;
+}
+
+/* Wait for afl-fuzz to ask for the next run.  */
+static int afl_next(void)
+{
+#ifdef UNIX_COMPILE
+    uint32_t value;
+
+    if (read(FUZZ_FORKSRV_FD, &value, 4) != 4) {
+        return -1;
+    }
+    value = (uint32_t)getpid();
+    if (write(FUZZ_FORKSRV_FD + 1, &value, 4) != 4) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+/* Report the end of a run as the wait status of a child.  */
+static void afl_done(fuzz_result_t result)
+{
+#ifdef UNIX_COMPILE
+    uint32_t status;
+
+    switch (result) {
+        case FUZZ_RESULT_CRASH:
+            status = 6;     /* killed by SIGABRT */
+            break;
+        case FUZZ_RESULT_JAM:
+            status = 4;     /* killed by SIGILL */
+            break;
+        default:
+            status = 0;
+            break;
+    }
+    if (write(FUZZ_FORKSRV_FD + 1, &status, 4) != 4) {
+        archdep_vice_exit(EXIT_SUCCESS);
+    }
+#endif
+}
+
+/* Put the next input into memory.  */
+static int load_input(void)
+{
+    FILE *fp = stdin;
+    size_t len;
+    int i;
+
+    if (input_name != NULL) {
+        fp = fopen(input_name, MODE_READ);
+        if (fp == NULL) {
+            log_error(fuzz_log, "Cannot open `%s'.", input_name);
+            return -1;
+        }
+    } else {
+        /* afl-fuzz rewrites the file behind stdin for every run */
+        clearerr(stdin);
+        fseek(stdin, 0, SEEK_SET);
+    }
+
+    len = fread(input, 1, (size_t)input_size, fp);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+
+    mem_inject((uint32_t)input_addr, (uint8_t)(len & 0xff));
+    mem_inject((uint32_t)((input_addr + 1) & 0xffff), (uint8_t)(len >> 8));
+    for (i = 0; i < (int)len; i++) {
+        mem_inject((uint32_t)((input_addr + 2 + i) & 0xffff), input[i]);
+    }
+    return 0;
+}
+
+/* Take or restore the baseline and start the next run */
+static void start_run_trap(uint16_t addr, void *data)
+{
+    if (baseline == NULL) {
+        baseline = snapshot_memory_new();
+        snapshot_memory_redirect(baseline);
+        if (machine_write_snapshot("", 0, 0, 0) < 0) {
+            snapshot_memory_redirect(NULL);
+            log_error(fuzz_log, "Cannot save the machine state.");
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+        snapshot_memory_redirect(NULL);
+
+        input = lib_malloc((size_t)input_size);
+        open_coverage();
+        afl_mode = afl_hello();
+        log_message(fuzz_log, "Harness ready, %s.",
+                    afl_mode ? "running inputs from afl-fuzz" : "running one input");
+    } else {
+        snapshot_memory_redirect(baseline);
+        if (machine_read_snapshot("", 0) < 0) {
+            snapshot_memory_redirect(NULL);
+            log_error(fuzz_log, "Cannot restore the machine state.");
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+        snapshot_memory_redirect(NULL);
+    }
+
+    if (afl_mode && afl_next() < 0) {
+        /* afl-fuzz is gone */
+        archdep_vice_exit(EXIT_SUCCESS);
+        return;
+    }
+
+    if (load_input() < 0) {
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+
+    fuzz_prev_loc = 0;
+    maincpu_clk_limit = run_cycles != 0 ? maincpu_clk + run_cycles : 0;
+    state = FUZZ_RUNNING;
+}
+
+static void end_run(fuzz_result_t result, int exit_code)
+{
+    unsigned int edges = 0;
+    int i;
+
+    maincpu_clk_limit = 0;
+
+    if (afl_mode) {
+        afl_done(result);
+        state = FUZZ_PENDING;
+        interrupt_maincpu_trigger_trap(start_run_trap, NULL);
+        return;
+    }
+
+    for (i = 0; i < FUZZ_MAP_SIZE; i++) {
+        if (fuzz_coverage[i] != 0) {
+            edges++;
+        }
+    }
+    log_message(fuzz_log, "Run %s (exit code %d, %u edges).",
+                result == FUZZ_RESULT_OK ? "passed"
+                : result == FUZZ_RESULT_CRASH ? "crashed"
+                : result == FUZZ_RESULT_JAM ? "jammed" : "reached the cycle limit",
+                exit_code, edges);
+
+    archdep_vice_exit(result == FUZZ_RESULT_OK || result == FUZZ_RESULT_CRASH
+                      ? exit_code : EXIT_FAILURE);
+}
+
+static void end_run_trap(uint16_t addr, void *data)
+{
+    end_run((fuzz_result_t)vice_ptr_to_int(data), run_exit_code);
+}
+
+static void trigger_end(fuzz_result_t result, int exit_code)
+{
+    state = FUZZ_PENDING;
+    run_exit_code = exit_code;
+    interrupt_maincpu_trigger_trap(end_run_trap, vice_int_to_ptr((int)result));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Handle a write to the debug cartridge
+ *
+ * The first write tells the harness is ready, the next ones end a run.
+ *
+ * \param[in]   exit_code   value written
+ *
+ * \return  true if fuzzing, false if the emulator should quit as usual
+ */
+bool fuzz_exit(int exit_code)
+{
+    switch (state) {
+        case FUZZ_OFF:
+            return false;
+        case FUZZ_SETUP:
+            state = FUZZ_PENDING;
+            interrupt_maincpu_trigger_trap(start_run_trap, NULL);
+            break;
+        case FUZZ_RUNNING:
+            trigger_end(exit_code == 0 ? FUZZ_RESULT_OK : FUZZ_RESULT_CRASH, exit_code);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+/** \brief  Handle reaching the cycle limit
+ *
+ * \return  true if this ended a run
+ */
+bool fuzz_cycle_limit(void)
+{
+    if (state == FUZZ_RUNNING) {
+        trigger_end(FUZZ_RESULT_TIMEOUT, 0);
+    }
+    return state == FUZZ_PENDING;
+}
+
+/** \brief  Handle a CPU jam
+ *
+ * \return  true if this ended a run, the jam is then ignored
+ */
+bool fuzz_jam(void)
+{
+    if (state == FUZZ_RUNNING) {
+        trigger_end(FUZZ_RESULT_JAM, 0);
+    }
+    return state == FUZZ_PENDING;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_fuzzinput(const char *param, void *extra_param)
+{
+    long addr = strtol(param, NULL, 0);
+
+    if (addr < 0 || addr > 0xffff) {
+        return -1;
+    }
+    input_addr = (int)addr;
+
+    if (state == FUZZ_OFF) {
+        fuzz_log = log_open("Fuzz");
+        resources_set_int("WarpMode", 1);
+        state = FUZZ_SETUP;
+    }
+    return 0;
+}
+
+static int cmdline_fuzzsize(const char *param, void *extra_param)
+{
+    long size = strtol(param, NULL, 0);
+
+    if (size < 1 || size > 0xfffd) {
+        return -1;
+    }
+    input_size = (int)size;
+    return 0;
+}
+
+static int cmdline_fuzzfile(const char *param, void *extra_param)
+{
+    util_string_set(&input_name, param);
+    return 0;
+}
+
+static int cmdline_fuzzcycles(const char *param, void *extra_param)
+{
+    run_cycles = (CLOCK)strtoull(param, NULL, 0);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-fuzzinput", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_fuzzinput, NULL, NULL, NULL,
+      "<address>", "Run the autostarted harness once per fuzzer input, put at <address>" },
+    { "-fuzzsize", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_fuzzsize, NULL, NULL, NULL,
+      "<bytes>", "Largest fuzzer input put into memory (default 256)" },
+    { "-fuzzfile", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_fuzzfile, NULL, NULL, NULL,
+      "<filename>", "Read the fuzzer input from <filename> instead of stdin" },
+    { "-fuzzcycles", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_fuzzcycles, NULL, NULL, NULL,
+      "<cycles>", "End a run of the harness after <cycles> cycles" },
+    CMDLINE_LIST_END
+};
+
+int fuzz_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void fuzz_shutdown(void)
+{
+    snapshot_memory_free(baseline);
+    baseline = NULL;
+
+    lib_free(input);
+    input = NULL;
+    lib_free(input_name);
+    input_name = NULL;
+}
@@ -0,0 +1,57 @@
+/*
+ * fuzz.h - Run a 6502 program over and over with inputs from a fuzzer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FUZZ_H
+#define VICE_FUZZ_H
+
+#include <stdbool.h>
+
+#include "types.h"
+
+/* Size of the coverage map, the same as the one of AFL.  */
+#define FUZZ_MAP_SIZE   65536
+
+/* Coverage map, NULL unless fuzzing */
+extern uint8_t *fuzz_coverage;
+extern unsigned int fuzz_prev_loc;
+
+/* Used by the CPU for the destination of every branch, jump, call and
+   return while fuzzing.  The edge is counted the same way AFL does it.  This
+   is a macro as the CPU cores include this inside their main loop.  */
+#define FUZZ_EDGE(dest_addr)                                                  \
+    do {                                                                      \
+        unsigned int fuzz_loc = (((dest_addr) >> 4) ^ ((dest_addr) << 8))     \
+                                & (FUZZ_MAP_SIZE - 1);                        \
+                                                                              \
+        fuzz_coverage[fuzz_loc ^ fuzz_prev_loc]++;                            \
+        fuzz_prev_loc = fuzz_loc >> 1;                                        \
+    } while (0)
+
+int fuzz_cmdline_options_init(void);
+void fuzz_shutdown(void);
+
+bool fuzz_exit(int exit_code);
+bool fuzz_cycle_limit(void);
+bool fuzz_jam(void);
+
+#endif
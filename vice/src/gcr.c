@@ -65,48 +65,68 @@ static const uint8_t From_GCR_conv_data[32] =
 };
 
 
-static void gcr_convert_4bytes_to_GCR(const uint8_t *source, uint8_t *dest)
+/* The codec works on whole bytes: a byte is encoded into 10 GCR bits and
+   10 GCR bits are decoded into a byte.  The tables are built from the
+   nybble tables above on first use.  */
+static uint16_t GCR_encode_table[256];
+static uint8_t GCR_decode_table[1024];
+/* number of 1 bits at the top and at the bottom of a byte */
+static uint8_t leading_ones[256];
+static uint8_t trailing_ones[256];
+static int gcr_tables_ready = 0;
+
+static void gcr_init_tables(void)
 {
-    int i;
-    register unsigned int tdest = 0;    /* at least 16 bits for overflow shifting */
-
-    for (i = 2; i < 10; i += 2, source++, dest++)
-    {
-        tdest <<= 5;  /* make room for the upper nybble */
-        tdest |= GCR_conv_data[(*source) >> 4];
+    unsigned int i, j;
 
-        tdest <<= 5;  /* make room for the lower nybble */
-        tdest |= GCR_conv_data[(*source) & 0x0f];
-
-        *dest = (uint8_t)(tdest >> i);
+    if (gcr_tables_ready) {
+        return;
     }
-
-    *dest = (uint8_t)tdest;
+    for (i = 0; i < 256; i++) {
+        GCR_encode_table[i] = (uint16_t)((GCR_conv_data[i >> 4] << 5) | GCR_conv_data[i & 0x0f]);
+        for (j = 0; j < 8 && (i & (0x80 >> j)); j++) {
+        }
+        leading_ones[i] = (uint8_t)j;
+        for (j = 0; j < 8 && (i & (1 << j)); j++) {
+        }
+        trailing_ones[i] = (uint8_t)j;
+    }
+    for (i = 0; i < 1024; i++) {
+        GCR_decode_table[i] = (uint8_t)((From_GCR_conv_data[i >> 5] << 4) | From_GCR_conv_data[i & 0x1f]);
+    }
+    gcr_tables_ready = 1;
 }
 
-static void gcr_convert_GCR_to_4bytes(const uint8_t *source, uint8_t *dest)
+static void gcr_convert_4bytes_to_GCR(const uint8_t *source, uint8_t *dest)
 {
-    int i;
-    /* at least 24 bits for shifting into bits 16...20 */
-    register uint32_t tdest = *source;
-
-    tdest <<= 13;
-
-    for (i = 5; i < 13; i += 2, dest++)
-    {
-        source++;
-        tdest |= ((uint32_t)(*source)) << i;
+    uint64_t tdest;
+
+    tdest = ((uint64_t)GCR_encode_table[source[0]] << 30)
+            | ((uint64_t)GCR_encode_table[source[1]] << 20)
+            | ((uint64_t)GCR_encode_table[source[2]] << 10)
+            | GCR_encode_table[source[3]];
+
+    dest[0] = (uint8_t)(tdest >> 32);
+    dest[1] = (uint8_t)(tdest >> 24);
+    dest[2] = (uint8_t)(tdest >> 16);
+    dest[3] = (uint8_t)(tdest >> 8);
+    dest[4] = (uint8_t)tdest;
+}
 
-        /*  "tdest >> 16" could be optimized to a word
-         *  aligned access, hopefully the compiler does
-         *  this for us (in a portable way)
-         */
-        *dest = From_GCR_conv_data[(tdest >> 16) & 0x1f] << 4;
-        tdest <<= 5;
+/* Decode 40 GCR bits into 4 bytes.  */
+static inline void gcr_convert_40bits(uint64_t source, uint8_t *dest)
+{
+    dest[0] = GCR_decode_table[(source >> 30) & 0x3ff];
+    dest[1] = GCR_decode_table[(source >> 20) & 0x3ff];
+    dest[2] = GCR_decode_table[(source >> 10) & 0x3ff];
+    dest[3] = GCR_decode_table[source & 0x3ff];
+}
 
-        *dest |= From_GCR_conv_data[(tdest >> 16) & 0x1f];
-        tdest <<= 5;
-    }
+static void gcr_convert_GCR_to_4bytes(const uint8_t *source, uint8_t *dest)
+{
+    gcr_convert_40bits(((uint64_t)source[0] << 32) | ((uint64_t)source[1] << 24)
+                       | ((uint64_t)source[2] << 16) | ((uint64_t)source[3] << 8)
+                       | source[4], dest);
 }
 
 void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *data, const gcr_header_t *header,
@@ -115,6 +135,8 @@ void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *data, const gcr_h
     int i;
     uint8_t buf[4], chksum, idm;
 
+    gcr_init_tables();
+
     idm = (error_code == CBMDOS_FDC_ERR_ID) ? 0xff : 0x00;
 
     memset(data, (error_code == CBMDOS_FDC_ERR_SYNC) ? 0x55 : 0xff, 5);       /* Sync */
@@ -167,36 +189,46 @@ void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *data, const gcr_h
     gcr_convert_4bytes_to_GCR(buf, data);
 }
 
+/* Return the position of the first bit after a sync mark (10 or more 1
+   bits), looking at `s' bits from `p' on.  Whole bytes are looked at
+   where possible.  */
 static int gcr_find_sync(const disk_track_t *raw, int p, int s)
 {
-    unsigned int w;
-    int b;
+    unsigned int ones;
+    int b, end;
 
     if (!raw->data || !raw->size) {
         return -CBMDOS_FDC_ERR_SYNC;
     }
 
-    w = 0;
-    b = raw->data[p >> 3] << (p & 7);
-    while (s--) {
-        if (b & 0x80) {
-            w = (w << 1) | 1;
-        } else {
-            if (~w & 0x3ff) {
-                w <<= 1;
+    end = raw->size * 8;
+    ones = 0;
+    while (s > 0) {
+        if ((p & 7) == 0 && s >= 8) {
+            b = raw->data[p >> 3];
+            if (b == 0xff) {
+                ones += 8;
             } else {
-                return p;
+                if (ones + leading_ones[b] >= 10) {
+                    return p + leading_ones[b];
+                }
+                ones = trailing_ones[b];
             }
-        }
-        if (~p & 7) {
-            p++;
-            b <<= 1;
+            p += 8;
+            s -= 8;
         } else {
-            p++;
-            if (p >= raw->size * 8) {
-                p = 0;
+            if (raw->data[p >> 3] & (0x80 >> (p & 7))) {
+                ones++;
+            } else if (ones >= 10) {
+                return p;
+            } else {
+                ones = 0;
             }
-            b = raw->data[p >> 3];
+            p++;
+            s--;
+        }
+        if (p >= end) {
+            p = 0;
         }
     }
     return -CBMDOS_FDC_ERR_SYNC;
@@ -206,11 +238,23 @@ static void gcr_decode_block(const disk_track_t *raw, int p, uint8_t *buf, int n
 {
     int shift, i, j;
     uint8_t gcr[5], b;
-    uint8_t *offset, *end = raw->data + raw->size;
+    const uint8_t *offset, *end = raw->data + raw->size;
+    uint64_t bits;
 
     shift = p & 7;
     offset = raw->data + (p >> 3);
 
+    /* no wrap around: take 48 bits at a time straight from the track */
+    if (offset + num * 5 < end) {
+        for (i = 0; i < num; i++, buf += 4, offset += 5) {
+            bits = ((uint64_t)offset[0] << 40) | ((uint64_t)offset[1] << 32)
+                   | ((uint64_t)offset[2] << 24) | ((uint64_t)offset[3] << 16)
+                   | ((uint64_t)offset[4] << 8) | offset[5];
+            gcr_convert_40bits(bits >> (8 - shift), buf);
+        }
+        return;
+    }
+
     b = offset[0] << shift;
     for (i = 0; i < num; i++, buf += 4) {
         /* get 5 bytes of gcr data */
@@ -266,6 +310,8 @@ fdc_err_t gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector
     uint8_t b;
     int i, p;
 
+    gcr_init_tables();
+
     p = gcr_find_sector_header(raw, sector);
     if (p < 0) {
         return -p;
@@ -298,6 +344,8 @@ fdc_err_t gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t secto
     uint8_t gcr[5], chksum, b;
     int i, j, shift, p;
 
+    gcr_init_tables();
+
     p = gcr_find_sector_header(raw, sector);
     if (p < 0) {
         return -p;
@@ -347,11 +395,111 @@ fdc_err_t gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t secto
 
 gcr_t *gcr_create_image(void)
 {
-    return (gcr_t *)lib_calloc(1, sizeof(gcr_t));
+    gcr_t *gcr = (gcr_t *)lib_calloc(1, sizeof(gcr_t));
+
+    gcr->current_track = -1;
+    return gcr;
 }
 
 void gcr_destroy_image(gcr_t *gcr)
 {
+    lib_free(gcr->encode_data);
     lib_free(gcr);
     return;
 }
+
+/* Set the function that encodes pending tracks, `data' is freed with the
+   next call.  All tracks are marked as loaded, tracks to be encoded later
+   are marked with gcr_set_track_pending().  */
+void gcr_set_encoder(gcr_t *gcr, gcr_encode_track_t *encode, void *data)
+{
+    lib_free(gcr->encode_data);
+    gcr->encode = encode;
+    gcr->encode_data = data;
+    memset(gcr->track_state, GCR_TRACK_LOADED, sizeof(gcr->track_state));
+    gcr->encoded_tracks = 0;
+}
+
+void gcr_set_track_pending(gcr_t *gcr, unsigned int half_track)
+{
+    if (half_track >= MAX_GCR_TRACKS || gcr->encode == NULL) {
+        return;
+    }
+    if (gcr->track_state[half_track] == GCR_TRACK_ENCODED) {
+        gcr->encoded_tracks--;
+    }
+    lib_free(gcr->tracks[half_track].data);
+    gcr->tracks[half_track].data = NULL;
+    gcr->tracks[half_track].size = 0;
+    gcr->track_state[half_track] = GCR_TRACK_PENDING;
+}
+
+/* Drop the least recently used encoded track, it is encoded again when
+   needed.  Returns 0 if there was no track to drop.  */
+static int gcr_drop_track(gcr_t *gcr)
+{
+    int i, lru = -1;
+
+    for (i = 0; i < MAX_GCR_TRACKS; i++) {
+        if (gcr->track_state[i] == GCR_TRACK_ENCODED && i != gcr->current_track
+            && (lru < 0 || gcr->track_used[i] < gcr->track_used[lru])) {
+            lru = i;
+        }
+    }
+    if (lru < 0) {
+        return 0;
+    }
+    gcr_set_track_pending(gcr, (unsigned int)lru);
+    return 1;
+}
+
+/* Return a track of the image (0 is the first half track), encoding it
+   first if it is still pending.  */
+disk_track_t *gcr_get_track(gcr_t *gcr, unsigned int half_track)
+{
+    switch (gcr->track_state[half_track]) {
+        case GCR_TRACK_PENDING:
+            while (gcr->encoded_tracks >= GCR_MAX_ENCODED_TRACKS) {
+                if (!gcr_drop_track(gcr)) {
+                    break;
+                }
+            }
+            gcr->encode(gcr, half_track, gcr->encode_data);
+            gcr->track_state[half_track] = GCR_TRACK_ENCODED;
+            gcr->encoded_tracks++;
+            /* fall through */
+        case GCR_TRACK_ENCODED:
+            gcr->track_used[half_track] = ++gcr->use_count;
+            break;
+        default:
+            break;
+    }
+    return &gcr->tracks[half_track];
+}
+
+/* Keep a track from being dropped, used once the drive wrote to it.  */
+void gcr_keep_track(gcr_t *gcr, unsigned int half_track)
+{
+    if (half_track >= MAX_GCR_TRACKS) {
+        return;
+    }
+    gcr_get_track(gcr, half_track);
+    if (gcr->track_state[half_track] == GCR_TRACK_ENCODED) {
+        gcr->track_state[half_track] = GCR_TRACK_LOADED;
+        gcr->encoded_tracks--;
+    }
+}
+
+/* Encode all pending tracks, used before the whole image is accessed.  */
+void gcr_encode_all_tracks(gcr_t *gcr)
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_GCR_TRACKS; i++) {
+        if (gcr->track_state[i] == GCR_TRACK_PENDING) {
+            gcr->encode(gcr, i, gcr->encode_data);
+            gcr->track_state[i] = GCR_TRACK_ENCODED;
+            gcr->encoded_tracks++;
+        }
+    }
+}
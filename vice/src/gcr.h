@@ -53,9 +53,35 @@ typedef struct disk_track_s {
     int size;
 } disk_track_t;
 
+/* Maximum number of tracks kept encoded from a sector based image.  */
+#define GCR_MAX_ENCODED_TRACKS 16
+
+/* States of the tracks of the raw GCR image.  */
+enum {
+    GCR_TRACK_LOADED = 0,   /* the data is the only copy, it is never dropped */
+    GCR_TRACK_PENDING,      /* not encoded yet, the data is NULL */
+    GCR_TRACK_ENCODED       /* encoded from the image, can be dropped again */
+};
+
+struct gcr_s;
+
+/* Fill in a pending track, called on first access.  */
+typedef void gcr_encode_track_t(struct gcr_s *gcr, unsigned int half_track, void *data);
+
 typedef struct gcr_s {
     /* Raw GCR image of the disk.  */
     disk_track_t tracks[MAX_GCR_TRACKS];
+
+    /* Tracks of sector based images are encoded on first access, only the
+       least recently used GCR_MAX_ENCODED_TRACKS of them are kept.  */
+    uint8_t track_state[MAX_GCR_TRACKS];
+    unsigned long track_used[MAX_GCR_TRACKS];
+    unsigned long use_count;
+    int encoded_tracks;
+    /* The track under the head, it is never dropped.  */
+    int current_track;
+    gcr_encode_track_t *encode;
+    void *encode_data;
 } gcr_t;
 
 typedef struct gcr_header_s {
@@ -70,4 +96,10 @@ enum fdc_err_e gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t
 gcr_t *gcr_create_image(void);
 void gcr_destroy_image(gcr_t *gcr);
 
+void gcr_set_encoder(gcr_t *gcr, gcr_encode_track_t *encode, void *data);
+void gcr_set_track_pending(gcr_t *gcr, unsigned int half_track);
+disk_track_t *gcr_get_track(gcr_t *gcr, unsigned int half_track);
+void gcr_keep_track(gcr_t *gcr, unsigned int half_track);
+void gcr_encode_all_tracks(gcr_t *gcr);
+
 #endif
@@ -53,6 +53,7 @@
 
 #include <assert.h>
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -61,6 +62,7 @@
 
 #include "archdep.h"
 #include "archdep_sleep.h"
+#include "archdep_tick.h"
 #include "cmdline.h"
 #include "coproc.h"
 #include "ffmpegexedrv.h"
@@ -240,6 +242,40 @@ typedef struct {
 } VIDEOFrame;
 static VIDEOFrame *video_st_frame;
 
+/* Video frames are sent to ffmpeg by a writer thread, so the emulation does
+   not wait while ffmpeg encodes.  The emulation converts a frame into a free
+   slot of the queue; when all slots are full it either waits for one, or with
+   FFMPEGVideoDropFrames sends the last queued frame once more instead of the
+   new one, so the video keeps its length.  If the thread cannot be started,
+   frames are sent directly from video_st_frame.  */
+#define VIDEO_QUEUE_FRAMES  8
+
+typedef struct {
+    VIDEOFrame *frame;
+    int repeat;             /* number of times the frame is sent */
+} video_queue_slot_t;
+
+static video_queue_slot_t video_queue[VIDEO_QUEUE_FRAMES];
+static int video_queue_head;    /* slot sent next */
+static int video_queue_used;    /* slots queued or being sent */
+
+static pthread_mutex_t video_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a frame was queued or the writer is to stop */
+static pthread_cond_t video_queue_filled = PTHREAD_COND_INITIALIZER;
+/* signalled when a slot was freed */
+static pthread_cond_t video_queue_freed = PTHREAD_COND_INITIALIZER;
+
+static pthread_t video_writer_thread;
+static int video_writer_running;
+static int video_writer_stop;
+static int video_writer_error;
+
+/* statistics, logged when the recording is closed */
+static uint64_t video_stat_queued;      /* frames queued */
+static uint64_t video_stat_dropped;     /* frames replaced by a repeat */
+static uint64_t video_stat_waits;       /* times the emulation waited */
+static uint64_t video_stat_wait_ticks;  /* time the emulation waited */
+
 /* input audio stream */
 #define AUDIO_BUFFER_SAMPLES        0x400
 #define AUDIO_BUFFER_MAX_CHANNELS   2
@@ -289,6 +325,7 @@ static int video_codec;
 static int audio_bitrate;
 static int video_bitrate;
 static int video_halve_framerate;
+static int video_drop_frames;
 
 static int set_container_format(const char *val, void *param)
 {
@@ -368,6 +405,12 @@ static int set_video_halve_framerate(int value, void *param)
     return 0;
 }
 
+static int set_video_drop_frames(int value, void *param)
+{
+    video_drop_frames = value ? 1 : 0;
+    return 0;
+}
+
 /*---------- Resources ------------------------------------------------*/
 
 static const resource_string_t resources_string[] = {
@@ -391,6 +434,8 @@ static const resource_int_t resources_int[] = {
       &video_codec, set_video_codec, NULL },
     { "FFMPEGVideoHalveFramerate", 0, RES_EVENT_NO, NULL,
       &video_halve_framerate, set_video_halve_framerate, NULL },
+    { "FFMPEGVideoDropFrames", 0, RES_EVENT_NO, NULL,
+      &video_drop_frames, set_video_drop_frames, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -417,6 +462,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-ffmpegvideobitrate", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "FFMPEGVideoBitrate", NULL,
       "<value>", "Set bitrate for video stream in media file" },
+    { "-ffmpegdropframes", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FFMPEGVideoDropFrames", (resource_value_t)1,
+      NULL, "Repeat frames instead of waiting when ffmpeg cannot keep up" },
+    { "+ffmpegdropframes", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "FFMPEGVideoDropFrames", (resource_value_t)0,
+      NULL, "Wait for ffmpeg when it cannot keep up" },
     CMDLINE_LIST_END
 };
 
@@ -436,6 +487,7 @@ static void log_resource_values(const char *func)
     DBG(("%s FFMPEGAudioCodec:%d:'%s'", func, audio_codec, av_codec_get_option(audio_codec)));
     DBG(("%s FFMPEGAudioBitrate:%d", func, audio_bitrate));
     DBG(("%s FFMPEGVideoHalveFramerate:%d", func, video_halve_framerate));
+    DBG(("%s FFMPEGVideoDropFrames:%d", func, video_drop_frames));
 }
 
 static void prepare_port_numbers(void)
@@ -1085,11 +1137,22 @@ static int video_fill_rgb_image(screenshot_t *screenshot, VIDEOFrame *pic)
 {
     int x, y;
     int dx, dy;
-    int colnum;
+    unsigned int i;
     int bufferoffset;
     int x_dim = screenshot->width;
     int y_dim = screenshot->height;
-    int pix = 0;
+    uint8_t rgb[256 * INPUT_VIDEO_BPP];
+    const uint8_t *src, *col;
+    uint8_t *dst;
+
+    /* packed lookup table, so each pixel is one lookup */
+    memset(rgb, 0, sizeof(rgb));
+    for (i = 0; i < screenshot->palette->num_entries && i < 256; i++) {
+        rgb[i * INPUT_VIDEO_BPP] = screenshot->palette->entries[i].red;
+        rgb[i * INPUT_VIDEO_BPP + 1] = screenshot->palette->entries[i].green;
+        rgb[i * INPUT_VIDEO_BPP + 2] = screenshot->palette->entries[i].blue;
+    }
+
     /* center the screenshot in the video */
     pic->linesize = video_width * INPUT_VIDEO_BPP;
     dx = (video_width - x_dim) / 2;
@@ -1097,15 +1160,17 @@ static int video_fill_rgb_image(screenshot_t *screenshot, VIDEOFrame *pic)
     bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
         + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
 
+    dst = pic->data;
     for (y = 0; y < video_height; y++) {
+        src = screenshot->draw_buffer + bufferoffset;
         for (x = 0; x < video_width; x++) {
-            colnum = screenshot->draw_buffer[bufferoffset + x];
-            pic->data[pix + INPUT_VIDEO_BPP * x] = screenshot->palette->entries[colnum].red;
-            pic->data[pix + INPUT_VIDEO_BPP * x + 1] = screenshot->palette->entries[colnum].green;
-            pic->data[pix + INPUT_VIDEO_BPP * x + 2] = screenshot->palette->entries[colnum].blue;
+            col = &rgb[src[x] * INPUT_VIDEO_BPP];
+            dst[0] = col[0];
+            dst[1] = col[1];
+            dst[2] = col[2];
+            dst += INPUT_VIDEO_BPP;
         }
         bufferoffset += screenshot->draw_buffer_line_size;
-        pix += pic->linesize;
     }
 
     return 0;
@@ -1137,6 +1202,135 @@ static void video_free_picture(VIDEOFrame *picture)
     lib_free(picture);
 }
 
+static void *video_writer_main(void *unused)
+{
+    video_queue_slot_t *slot;
+    ssize_t res;
+
+    pthread_mutex_lock(&video_queue_lock);
+    while (1) {
+        while (video_queue_used == 0 && !video_writer_stop) {
+            pthread_cond_wait(&video_queue_filled, &video_queue_lock);
+        }
+        if (video_queue_used == 0) {
+            /* stopped and all frames are sent */
+            break;
+        }
+
+        slot = &video_queue[video_queue_head];
+        /* the emulation may add repeats while the frame is sent */
+        while (slot->repeat > 0 && !video_writer_error) {
+            slot->repeat--;
+            pthread_mutex_unlock(&video_queue_lock);
+            res = write_video_frame(slot->frame);
+            pthread_mutex_lock(&video_queue_lock);
+            if (res < 0) {
+                video_writer_error = 1;
+            }
+        }
+        slot->repeat = 0;
+        video_queue_head = (video_queue_head + 1) % VIDEO_QUEUE_FRAMES;
+        video_queue_used--;
+        pthread_cond_signal(&video_queue_freed);
+    }
+    pthread_mutex_unlock(&video_queue_lock);
+
+    return NULL;
+}
+
+static void video_writer_start(void)
+{
+    int i;
+
+    video_queue_head = 0;
+    video_queue_used = 0;
+    video_writer_stop = 0;
+    video_writer_error = 0;
+    video_stat_queued = 0;
+    video_stat_dropped = 0;
+    video_stat_waits = 0;
+    video_stat_wait_ticks = 0;
+
+    for (i = 0; i < VIDEO_QUEUE_FRAMES; i++) {
+        video_queue[i].frame = video_alloc_picture(INPUT_VIDEO_BPP, video_width, video_height);
+        video_queue[i].repeat = 0;
+    }
+
+    if (pthread_create(&video_writer_thread, NULL, video_writer_main, NULL)) {
+        log_error(ffmpeg_log, "ffmpegexedrv: Cannot start video writer thread, writing directly.");
+        video_writer_running = 0;
+    } else {
+        video_writer_running = 1;
+    }
+}
+
+static void video_writer_finish(void)
+{
+    int i;
+
+    if (video_writer_running) {
+        pthread_mutex_lock(&video_queue_lock);
+        video_writer_stop = 1;
+        pthread_cond_signal(&video_queue_filled);
+        pthread_mutex_unlock(&video_queue_lock);
+        pthread_join(video_writer_thread, NULL);
+        video_writer_running = 0;
+
+        log_message(ffmpeg_log,
+                    "ffmpegexedrv: %"PRIu64" frames queued, %"PRIu64" dropped, "
+                    "waited %"PRIu64" times for %"PRIu64" ms",
+                    video_stat_queued, video_stat_dropped, video_stat_waits,
+                    (uint64_t)TICK_TO_MILLI(video_stat_wait_ticks));
+    }
+
+    for (i = 0; i < VIDEO_QUEUE_FRAMES; i++) {
+        if (video_queue[i].frame != NULL) {
+            video_free_picture(video_queue[i].frame);
+            video_queue[i].frame = NULL;
+        }
+    }
+}
+
+/* Get the frame of the next free slot, waiting for one if needed.  Returns
+   NULL if the frame is dropped, the last queued one is then sent `repeat'
+   more times.  */
+static VIDEOFrame *video_queue_get_frame(int repeat)
+{
+    VIDEOFrame *frame;
+    tick_t start;
+
+    pthread_mutex_lock(&video_queue_lock);
+    if (video_queue_used == VIDEO_QUEUE_FRAMES) {
+        if (video_drop_frames) {
+            video_queue[(video_queue_head + video_queue_used - 1) % VIDEO_QUEUE_FRAMES].repeat += repeat;
+            video_stat_dropped += repeat;
+            pthread_mutex_unlock(&video_queue_lock);
+            return NULL;
+        }
+        start = tick_now();
+        while (video_queue_used == VIDEO_QUEUE_FRAMES) {
+            pthread_cond_wait(&video_queue_freed, &video_queue_lock);
+        }
+        video_stat_waits++;
+        video_stat_wait_ticks += (tick_t)(tick_now() - start);
+    }
+    frame = video_queue[(video_queue_head + video_queue_used) % VIDEO_QUEUE_FRAMES].frame;
+    pthread_mutex_unlock(&video_queue_lock);
+
+    return frame;
+}
+
+/* Queue the frame returned by video_queue_get_frame().  */
+static void video_queue_put_frame(int repeat)
+{
+    pthread_mutex_lock(&video_queue_lock);
+    video_queue[(video_queue_head + video_queue_used) % VIDEO_QUEUE_FRAMES].repeat = repeat;
+    video_queue_used++;
+    video_stat_queued++;
+    pthread_cond_signal(&video_queue_filled);
+    pthread_mutex_unlock(&video_queue_lock);
+}
+
 /* called by ffmpegexedrv_init_file */
 static int ffmpegexedrv_open_video(void)
 {
@@ -1151,6 +1345,8 @@ static int ffmpegexedrv_open_video(void)
         return -1;
     }
 
+    video_writer_start();
+
     return 0;
 }
 
@@ -1158,6 +1354,7 @@ static int ffmpegexedrv_open_video(void)
 static void ffmpegexedrv_close_video(void)
 {
     DBG(("ffmpegexedrv_close_video"));
+    video_writer_finish();
     close_video_stream();
     video_is_open = 0;
     if (video_st_frame) {
@@ -1316,6 +1513,8 @@ static int ffmpegexedrv_record(screenshot_t *screenshot)
 {
     double frametime = (double)framecounter / fps;
     double audiotime = (double)audio_input_counter / (double)audio_input_sample_rate;
+    VIDEOFrame *frame;
+    int repeat = 1;
     DBGFRAMES(("ffmpegexedrv_record(framecount:%lu, audiocount:%lu frametime:%f, audiotime:%f)",
         framecounter, audio_input_counter, frametime, audiotime));
     /* log_resource_values(__FUNCTION__); */
@@ -1340,19 +1539,30 @@ static int ffmpegexedrv_record(screenshot_t *screenshot)
         return 0;
     }
 
-    /*DBGFRAMES(("ffmpegexedrv_record (%u)", framecounter));*/
-    video_fill_rgb_image(screenshot, video_st_frame);
-
-    if (write_video_frame(video_st_frame) < 0) {
-        return -1;
-    }
-
     /* the video is late */
     if (frametime < (audiotime - (time_base * 1.5f))) {
         /* insert one frame */
         framecounter++;
+        repeat = 2;
         DBG(("video is late, inserting a frame (framecount:%lu, audiocount:%lu frametime:%f, audiotime:%f)",
             framecounter, audio_input_counter, frametime, audiotime));
+    }
+
+    /*DBGFRAMES(("ffmpegexedrv_record (%u)", framecounter));*/
+    if (video_writer_running) {
+        if (video_writer_error) {
+            return -1;
+        }
+        frame = video_queue_get_frame(repeat);
+        if (frame != NULL) {
+            video_fill_rgb_image(screenshot, frame);
+            video_queue_put_frame(repeat);
+        }
+        return 0;
+    }
+
+    video_fill_rgb_image(screenshot, video_st_frame);
+    while (repeat-- > 0) {
         if (write_video_frame(video_st_frame) < 0) {
             return -1;
         }
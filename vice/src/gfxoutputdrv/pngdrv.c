@@ -28,20 +28,107 @@
 #include "vice.h"
 
 #ifdef HAVE_PNG
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <png.h>
 #include <zlib.h>
 
 #include "archdep.h"
+#include "cmdline.h"
 #include "gfxoutput.h"
 #include "lib.h"
 #include "pngdrv.h"
+#include "resources.h"
 #include "screenshot.h"
 #include "types.h"
 #include "util.h"
 
+/* Row filters, the values of the PNGFilter resource.  */
+#define PNG_FILTER_ADAPTIVE     0   /* best of all filters for every row */
+#define PNG_FILTER_MODE_NONE    1
+#define PNG_FILTER_MODE_SUB     2
+#define PNG_FILTER_MODE_UP      3
+#define PNG_FILTER_MODE_AVG     4
+#define PNG_FILTER_MODE_PAETH   5
+
+#define PNG_COMPLEVEL_DEFAULT   Z_BEST_COMPRESSION
+
+/* Screenshots are compressed in this many bands of rows at once, each on a
+   thread of its own.  Every band starts with the end of the previous one as
+   dictionary, so the file is hardly larger than with a single band.  */
+#define PNG_BANDS               4
+
+/* Fewest rows in a band worth a thread of its own.  */
+#define PNG_BAND_MIN_ROWS       16
+
+/* Bytes of the previous band used as dictionary.  */
+#define PNG_DICT_SIZE           32768
+
+static int compression_level = PNG_COMPLEVEL_DEFAULT;   /* PNGCompressionLevel */
+static int filter_mode = PNG_FILTER_ADAPTIVE;           /* PNGFilter */
+
+static int set_compression_level(int val, void *param)
+{
+    if (val < Z_NO_COMPRESSION || val > Z_BEST_COMPRESSION) {
+        return -1;
+    }
+    compression_level = val;
+    return 0;
+}
+
+static int set_filter_mode(int val, void *param)
+{
+    if (val < PNG_FILTER_ADAPTIVE || val > PNG_FILTER_MODE_PAETH) {
+        return -1;
+    }
+    filter_mode = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "PNGCompressionLevel", PNG_COMPLEVEL_DEFAULT, RES_EVENT_NO, NULL,
+      &compression_level, set_compression_level, NULL },
+    { "PNGFilter", PNG_FILTER_ADAPTIVE, RES_EVENT_NO, NULL,
+      &filter_mode, set_filter_mode, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+static int pngdrv_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-pngcompressionlevel", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "PNGCompressionLevel", NULL,
+      "<level>", "Set zlib compression level of PNG screenshots (0: none, 1: fastest - 9: smallest)" },
+    { "-pngfilter", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "PNGFilter", NULL,
+      "<filter>", "Set row filter of PNG screenshots (0: adaptive, 1: none, 2: sub, 3: up, 4: average, 5: paeth)" },
+    CMDLINE_LIST_END
+};
+
+static int pngdrv_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* Use the compression settings of the resources for libpng.  */
+static void pngdrv_set_compression(png_structp png_ptr)
+{
+    static const int filters[] = {
+        PNG_ALL_FILTERS, PNG_FILTER_NONE, PNG_FILTER_SUB,
+        PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH
+    };
+
+    png_set_compression_level(png_ptr, compression_level);
+    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters[filter_mode]);
+}
+
 
 typedef struct gfxoutputdrv_data_s {
     FILE *fd;
@@ -103,7 +190,7 @@ static int pngdrv_open(screenshot_t *screenshot, const char *filename)
     sdata->data = lib_malloc(screenshot->width * 4);
 
     png_init_io(sdata->png_ptr, sdata->fd);
-    png_set_compression_level(sdata->png_ptr, Z_BEST_COMPRESSION);
+    pngdrv_set_compression(sdata->png_ptr);
 
     png_set_IHDR(sdata->png_ptr, sdata->info_ptr, screenshot->width, screenshot->height,
                  8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
@@ -149,23 +236,333 @@ static int pngdrv_close(screenshot_t *screenshot)
     return 0;
 }
 
-static int pngdrv_save(screenshot_t *screenshot, const char *filename)
+/* ------------------------------------------------------------------------- */
+
+/* Screenshots are written without libpng, which can only compress the rows
+   one after another on a single thread.  The rows are filtered first, then
+   the bands of rows are deflated in parallel and joined into one zlib
+   stream, the same way pigz does it: every band but the last one ends with
+   a sync flush, so the compressed bands can simply be put together.  */
+
+typedef struct png_band_s {
+    const uint8_t *data;        /* filtered rows of the band */
+    size_t len;
+    const uint8_t *dict;        /* end of the previous band, or NULL */
+    size_t dict_len;
+    int last;
+    uint8_t *out;               /* compressed band */
+    size_t out_len;
+    uLong adler;
+    int result;
+    pthread_t thread;
+    int threaded;
+} png_band_t;
+
+static uint8_t paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc) {
+        return (uint8_t)a;
+    }
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+/* Filter one row of `len' bytes with `bpp' bytes per pixel, `prev' is the
+   row above or NULL for the first one.  The filter type goes to out[0].  */
+static void filter_row(uint8_t *out, int type, const uint8_t *row,
+                       const uint8_t *prev, size_t len, size_t bpp)
+{
+    size_t i;
+    int a, b, c;
+
+    out[0] = (uint8_t)type;
+    out++;
+
+    for (i = 0; i < len; i++) {
+        a = i >= bpp ? row[i - bpp] : 0;
+        b = prev != NULL ? prev[i] : 0;
+        c = (i >= bpp && prev != NULL) ? prev[i - bpp] : 0;
+
+        switch (type) {
+            case 1:
+                out[i] = (uint8_t)(row[i] - a);
+                break;
+            case 2:
+                out[i] = (uint8_t)(row[i] - b);
+                break;
+            case 3:
+                out[i] = (uint8_t)(row[i] - ((a + b) >> 1));
+                break;
+            case 4:
+                out[i] = (uint8_t)(row[i] - paeth_predictor(a, b, c));
+                break;
+            default:
+                out[i] = row[i];
+                break;
+        }
+    }
+}
+
+/* Sum of the filtered bytes taken as signed, the heuristic libpng uses to
+   pick the filter of a row.  */
+static unsigned long filter_cost(const uint8_t *out, size_t len)
 {
-    if (pngdrv_open(screenshot, filename) < 0) {
+    unsigned long sum = 0;
+    size_t i;
+
+    for (i = 1; i <= len; i++) {
+        sum += (unsigned long)abs((int)(int8_t)out[i]);
+    }
+    return sum;
+}
+
+static void filter_rows(uint8_t *out, const uint8_t *image, unsigned int width,
+                        unsigned int height)
+{
+    size_t len = (size_t)width * 4;
+    uint8_t *best = NULL, *tmp = NULL;
+    const uint8_t *prev = NULL;
+    unsigned int y;
+    int type;
+
+    if (filter_mode == PNG_FILTER_ADAPTIVE) {
+        best = lib_malloc(len + 1);
+        tmp = lib_malloc(len + 1);
+    }
+
+    for (y = 0; y < height; y++) {
+        const uint8_t *row = image + y * len;
+        uint8_t *dest = out + y * (len + 1);
+
+        if (filter_mode != PNG_FILTER_ADAPTIVE) {
+            filter_row(dest, filter_mode - PNG_FILTER_MODE_NONE, row, prev, len, 4);
+        } else {
+            unsigned long cost, best_cost = 0;
+
+            for (type = 0; type <= 4; type++) {
+                filter_row(tmp, type, row, prev, len, 4);
+                cost = filter_cost(tmp, len);
+                if (type == 0 || cost < best_cost) {
+                    uint8_t *swap = best;
+
+                    best = tmp;
+                    tmp = swap;
+                    best_cost = cost;
+                }
+            }
+            memcpy(dest, best, len + 1);
+        }
+        prev = row;
+    }
+
+    lib_free(best);
+    lib_free(tmp);
+}
+
+static void *compress_band(void *arg)
+{
+    png_band_t *band = arg;
+    z_stream strm;
+    int res;
+
+    band->result = -1;
+    band->adler = adler32(1L, band->data, (uInt)band->len);
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, compression_level, Z_DEFLATED, -MAX_WBITS, 8,
+                     filter_mode == PNG_FILTER_MODE_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED) != Z_OK) {
+        return NULL;
+    }
+    if (band->dict != NULL
+        && deflateSetDictionary(&strm, band->dict, (uInt)band->dict_len) != Z_OK) {
+        deflateEnd(&strm);
+        return NULL;
+    }
+
+    /* room for the sync flush too */
+    band->out_len = deflateBound(&strm, (uLong)band->len) + 16;
+    band->out = lib_malloc(band->out_len);
+
+    strm.next_in = (Bytef *)band->data;
+    strm.avail_in = (uInt)band->len;
+    strm.next_out = band->out;
+    strm.avail_out = (uInt)band->out_len;
+
+    res = deflate(&strm, band->last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((band->last && res == Z_STREAM_END)
+        || (!band->last && res == Z_OK && strm.avail_in == 0 && strm.avail_out > 0)) {
+        band->out_len = band->out_len - strm.avail_out;
+        band->result = 0;
+    }
+    deflateEnd(&strm);
+
+    return NULL;
+}
+
+static int write_chunk(FILE *fd, const char *type, const uint8_t *data, size_t len)
+{
+    uint8_t buf[4];
+    uLong crc;
+
+    util_dword_to_be_buf(buf, (uint32_t)len);
+    crc = crc32(0L, (const Bytef *)type, 4);
+    if (len > 0) {
+        crc = crc32(crc, data, (uInt)len);
+    }
+
+    if (fwrite(buf, 1, 4, fd) != 4
+        || fwrite(type, 1, 4, fd) != 4
+        || (len > 0 && fwrite(data, 1, len, fd) != len)) {
         return -1;
     }
+    util_dword_to_be_buf(buf, (uint32_t)crc);
+    return fwrite(buf, 1, 4, fd) == 4 ? 0 : -1;
+}
+
+/* Compress the filtered image and write the PNG file.  */
+static int write_png(FILE *fd, const uint8_t *filtered, unsigned int width,
+                     unsigned int height)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    png_band_t bands[PNG_BANDS];
+    size_t row_len = (size_t)width * 4 + 1;
+    size_t pos, idat_len;
+    uint8_t ihdr[13];
+    uint8_t *idat;
+    unsigned int num, rows, y, i;
+    uLong adler;
+    int result = 0;
+
+    num = height / PNG_BAND_MIN_ROWS;
+    if (num > PNG_BANDS) {
+        num = PNG_BANDS;
+    } else if (num == 0) {
+        num = 1;
+    }
+    rows = (height + num - 1) / num;
+
+    memset(bands, 0, sizeof(bands));
+    for (i = 0, y = 0; i < num; i++, y += rows) {
+        png_band_t *band = &bands[i];
+
+        band->data = filtered + y * row_len;
+        band->len = (size_t)((y + rows > height ? height - y : rows)) * row_len;
+        if (i > 0) {
+            pos = (size_t)y * row_len;
+            band->dict_len = pos > PNG_DICT_SIZE ? PNG_DICT_SIZE : pos;
+            band->dict = band->data - band->dict_len;
+        }
+        band->last = (i == num - 1);
+
+        /* the first band is done on this thread */
+        if (i > 0 && pthread_create(&band->thread, NULL, compress_band, band) == 0) {
+            band->threaded = 1;
+        }
+    }
+    for (i = 0; i < num; i++) {
+        if (!bands[i].threaded) {
+            compress_band(&bands[i]);
+        }
+    }
+    for (i = 0; i < num; i++) {
+        if (bands[i].threaded) {
+            pthread_join(bands[i].thread, NULL);
+        }
+        if (bands[i].result < 0) {
+            result = -1;
+        }
+    }
+
+    /* zlib header, the compressed bands and the checksum of it all */
+    idat_len = 2 + 4;
+    for (i = 0; i < num; i++) {
+        idat_len += bands[i].out_len;
+    }
+    idat = lib_malloc(idat_len);
+    idat[0] = 0x78;
+    idat[1] = compression_level < 2 ? 0x01 : compression_level < 6 ? 0x5e
+              : compression_level == 6 ? 0x9c : 0xda;
+    pos = 2;
+    adler = 1L;
+    for (i = 0; i < num; i++) {
+        if (bands[i].out != NULL) {
+            memcpy(idat + pos, bands[i].out, bands[i].out_len);
+            pos += bands[i].out_len;
+            lib_free(bands[i].out);
+        }
+        adler = i == 0 ? bands[i].adler
+                : adler32_combine(adler, bands[i].adler, (z_off_t)bands[i].len);
+    }
+    util_dword_to_be_buf(idat + pos, (uint32_t)adler);
+
+    util_dword_to_be_buf(&ihdr[0], width);
+    util_dword_to_be_buf(&ihdr[4], height);
+    ihdr[8] = 8;    /* bit depth */
+    ihdr[9] = 6;    /* RGB with alpha */
+    ihdr[10] = 0;   /* deflate */
+    ihdr[11] = 0;   /* adaptive filtering */
+    ihdr[12] = 0;   /* no interlace */
+
+    if (result < 0
+        || fwrite(signature, 1, sizeof(signature), fd) != sizeof(signature)
+        || write_chunk(fd, "IHDR", ihdr, sizeof(ihdr)) < 0
+        || write_chunk(fd, "IDAT", idat, idat_len) < 0
+        || write_chunk(fd, "IEND", NULL, 0) < 0) {
+        result = -1;
+    }
+    lib_free(idat);
+
+    return result;
+}
+
+static int pngdrv_save(screenshot_t *screenshot, const char *filename)
+{
+    unsigned int width = screenshot->width;
+    unsigned int height = screenshot->height;
+    size_t row_len = (size_t)width * 4;
+    uint8_t *image, *filtered;
+    char *ext_filename;
+    unsigned int y;
+    size_t i;
+    FILE *fd;
+    int result;
 
-    for (screenshot->gfxoutputdrv_data->line = 0;
-         screenshot->gfxoutputdrv_data->line < screenshot->height;
-         (screenshot->gfxoutputdrv_data->line)++) {
-        pngdrv_write(screenshot);
+    if (width == 0 || height == 0) {
+        return -1;
     }
 
-    if (pngdrv_close(screenshot) < 0) {
+    ext_filename = util_add_extension_const(filename, png_drv.default_extension);
+    fd = fopen(ext_filename, MODE_WRITE);
+    lib_free(ext_filename);
+    if (fd == NULL) {
         return -1;
     }
 
-    return 0;
+    image = lib_malloc(row_len * height);
+    for (y = 0; y < height; y++) {
+        (screenshot->convert_line)(screenshot, image + y * row_len, y,
+                                   SCREENSHOT_MODE_RGB32);
+    }
+    /* the alpha of the converted lines is inverted */
+    for (i = 3; i < row_len * height; i += 4) {
+        image[i] = (uint8_t)~image[i];
+    }
+
+    filtered = lib_malloc((row_len + 1) * height);
+    filter_rows(filtered, image, width, height);
+    lib_free(image);
+
+    result = write_png(fd, filtered, width, height);
+    lib_free(filtered);
+
+    if (fclose(fd) != 0) {
+        result = -1;
+    }
+    return result;
 }
 
 #ifdef FEATURE_CPUMEMHISTORY
@@ -241,7 +638,7 @@ static int pngdrv_open_memmap(const char *filename, int x_size, int y_size, uint
     pngdrv_memmap_png_data = lib_malloc(x_size * 4);
 
     png_init_io(pngdrv_memmap_png_ptr, pngdrv_memmap_fd);
-    png_set_compression_level(pngdrv_memmap_png_ptr, Z_BEST_COMPRESSION);
+    pngdrv_set_compression(pngdrv_memmap_png_ptr);
 
     png_set_IHDR(pngdrv_memmap_png_ptr, pngdrv_memmap_info_ptr, x_size, y_size,
                  8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
@@ -290,8 +687,8 @@ static gfxoutputdrv_t png_drv =
     NULL,
     NULL,
     NULL,
-    NULL,
-    NULL
+    pngdrv_resources_init,
+    pngdrv_cmdline_options_init
 #ifdef FEATURE_CPUMEMHISTORY
     , pngdrv_save_memmap
 #endif
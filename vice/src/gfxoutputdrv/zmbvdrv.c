@@ -75,6 +75,10 @@
 
 #define MAX_AUDIO_BUFFER_SIZE   (((44800 * 2) / 50) * 2)
 
+#define ZMBV_COMPLEVEL_MIN      1
+#define ZMBV_COMPLEVEL_MAX      9
+#define ZMBV_COMPLEVEL_DEFAULT  4
+
 /* each KEYFRAME_INTERVAL frame will be key one */
 #define KEYFRAME_INTERVAL  (300)
 
@@ -84,7 +88,7 @@ static int frameno = 0;
 
 static zmvb_init_flags_t iflg = ZMBV_INIT_FLAG_NONE;
 
-static int complevel = -1;  /* compression level, -1 means default */
+static int complevel = ZMBV_COMPLEVEL_DEFAULT;  /* ZMBVCompressionLevel */
 static int no_zlib = 0;
 
 static uint8_t cur_pal[PALETTE_SIZE];
@@ -101,7 +105,8 @@ static void *video_work_buffer = NULL;
 static int video_codec;
 static int audio_codec;
 
-static uint8_t *cur_screen = NULL;
+/* lines of the frame in the draw buffer, encoded without copying them */
+static const void **cur_lines = NULL;
 
 /* general */
 static int file_init_done = 1;
@@ -218,6 +223,15 @@ static int set_video_codec(int val, void *param)
     return 0;
 }
 
+static int set_compression_level(int val, void *param)
+{
+    if (val < ZMBV_COMPLEVEL_MIN || val > ZMBV_COMPLEVEL_MAX) {
+        return -1;
+    }
+    complevel = val;
+    return 0;
+}
+
 /*---------- Resources ------------------------------------------------*/
 
 static const resource_string_t resources_string[] = {
@@ -231,6 +245,8 @@ static const resource_int_t resources_int[] = {
       &audio_codec, set_audio_codec, NULL },
     { "ZMBVVideoCodec", AV_CODEC_ID_ZMBV, RES_EVENT_NO, NULL,
       &video_codec, set_video_codec, NULL },
+    { "ZMBVCompressionLevel", ZMBV_COMPLEVEL_DEFAULT, RES_EVENT_NO, NULL,
+      &complevel, set_compression_level, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -248,6 +264,9 @@ static int zmbvdrv_resources_init(void)
 
 static const cmdline_option_t cmdline_options[] =
 {
+    { "-zmbvcompressionlevel", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "ZMBVCompressionLevel", NULL,
+      "<level>", "Set zlib compression level of ZMBV video (1: fastest - 9: smallest)" },
     CMDLINE_LIST_END
 };
 
@@ -387,6 +406,8 @@ static soundmovie_funcs_t zmbvdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
+/* The video is palette indexed like the draw buffer, so only the palette is
+   copied and the lines are encoded straight from the draw buffer.  */
 static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
 {
     int x, y;
@@ -405,7 +426,9 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
     bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
         + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
 
-    for (x = 0; x < PALETTE_NUM_COLORS; x++) {
+    /* colors the palette does not have are black */
+    memset(cur_pal, 0, sizeof(cur_pal));
+    for (x = 0; x < PALETTE_NUM_COLORS && x < (int)screenshot->palette->num_entries; x++) {
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 0] = screenshot->palette->entries[x].red;
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 1] = screenshot->palette->entries[x].green;
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 2] = screenshot->palette->entries[x].blue;
@@ -413,9 +436,7 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
 
     LOGFRAMES(("zmbvdrv_fill_rgb_image video_width/height: %dx%d", video_width, video_height));
     for (y = 0; y < video_height; y++) {
-        for (x = 0; x < video_width; x++) {
-            cur_screen[(y * video_width) + x] = screenshot->draw_buffer[bufferoffset + x];
-        }
+        cur_lines[y] = screenshot->draw_buffer + bufferoffset;
         bufferoffset += screenshot->draw_buffer_line_size;
     }
     LOGFRAMES(("zmbvdrv_fill_rgb_image done"));
@@ -423,24 +444,13 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
     return 0;
 }
 
-static uint8_t *zmbvdrv_alloc_picture(int width, int height)
-{
-    /* the pixel format is always 8bpp, with a 256 entries, 24bit, palette */
-    LOG(("zmbvdrv_alloc_picture width:%d height:%d", width, height));
-    return lib_malloc(width * height);
-}
-
 /* called by zmbvdrv_init_file() */
 static int zmbvdrv_open_video(int width, int height)
 {
     LOG(("zmbvdrv_open_video width:%d height:%d", width, height));
     /* MOVE? open the codec */
     video_is_open = 1;
-    /* FIXME: allocate the encoded raw picture */
-    cur_screen = zmbvdrv_alloc_picture(width, height);
-    if (cur_screen == NULL) {
-        return -1;
-    }
+    cur_lines = lib_calloc(height, sizeof(const void *));
     return 0;
 }
 
@@ -449,9 +459,9 @@ static void zmbvdrv_close_video(void)
 {
     LOG(("zmbvdrv_close_video"));
     video_is_open = 0;
-    if (cur_screen != NULL) {
-        lib_free (cur_screen);
-        cur_screen = NULL;
+    if (cur_lines != NULL) {
+        lib_free(cur_lines);
+        cur_lines = NULL;
     }
 }
 /* called by zmbvdrv_save */
@@ -630,11 +640,9 @@ static int zmbvdrv_record(screenshot_t *screenshot)
         LOG(("FATAL: can't prepare frame for screen #%d", frameno));
         goto quit;
     }
-    for (int y = 0; y < video_height; ++y) {
-        if (zmbv_encode_line(zcodec, cur_screen+(y*video_width)) < 0) {
-            LOG(("FATAL: can't encode line #%d for screen #%d", y, frameno));
-            goto quit;
-        }
+    if (zmbv_encode_lines(zcodec, video_height, cur_lines) < 0) {
+        LOG(("FATAL: can't encode lines for screen #%d", frameno));
+        goto quit;
     }
     written = zmvb_encode_finish_frame(zcodec);
     if (written < 0) {
@@ -54,6 +54,44 @@
 #define READFILE_LINE_SIZE  1024
 
 
+/** \brief  Entry of a line index
+ *
+ * Only the hash of the key is kept, the line is read from the file and
+ * compared with the key on lookup.
+ */
+typedef struct hvsc_index_entry_s {
+    uint32_t hash;          /**< hash of the key */
+    long     lineno;        /**< number of the line, counting from 0 */
+    long     offset;        /**< file offset of the line */
+    long     prev_offset;   /**< file offset of the line before it, or -1 */
+    long     next;          /**< next entry in the hash chain, or -1 */
+} hvsc_index_entry_t;
+
+
+/** \brief  Index of the key lines of one of the HVSC text files
+ *
+ * Finding an entry in STIL.txt, BUGlist.txt or Songlengths.md5 used to read
+ * the file from the start up to the entry, for every tune. The first lookup
+ * now reads the file once and keeps the positions of the lines that can be
+ * looked up, hashed by their key.
+ */
+typedef struct hvsc_index_s {
+    bool                built;      /**< index was built */
+    bool                failed;     /**< file could not be read */
+    hvsc_index_entry_t *entries;    /**< entries */
+    long                count;      /**< number of entries */
+    long               *buckets;    /**< first entry of each hash chain */
+    uint32_t            mask;       /**< number of buckets - 1 */
+} hvsc_index_t;
+
+
+/** \brief  Indexes of the HVSC text files
+ *
+ * \see hvsc_index_type_t
+ */
+static hvsc_index_t hvsc_indexes[HVSC_INDEX_COUNT];
+
+
 /** \brief  Error messages
  */
 static const char *hvsc_err_messages[HVSC_ERR_CODE_COUNT] = {
@@ -225,6 +263,111 @@ void hvsc_free(void *ptr)
 }
 
 
+#ifdef HVSC_STANDALONE
+/** \brief  Allocation in a standalone arena
+ *
+ * Without VICE's arenas the arena is just a list of plain allocations.
+ */
+typedef struct hvsc_arena_block_s {
+    struct hvsc_arena_block_s *next;    /**< next allocation */
+    union {
+        long double ld;
+        long long   ll;
+        void       *p;
+    } data[];                           /**< the memory handed out */
+} hvsc_arena_block_t;
+
+/** \brief  Standalone arena
+ */
+struct hvsc_arena_s {
+    hvsc_arena_block_t *blocks;         /**< list of allocations */
+};
+#endif
+
+
+/** \brief  Create a memory arena
+ *
+ * \return  arena, free with hvsc_arena_free()
+ */
+hvsc_arena_t *hvsc_arena_new(void)
+{
+#ifndef HVSC_STANDALONE
+    return (hvsc_arena_t *)lib_arena_new(0);
+#else
+    hvsc_arena_t *arena = hvsc_malloc(sizeof *arena);
+
+    arena->blocks = NULL;
+    return arena;
+#endif
+}
+
+
+/** \brief  Allocate \a size bytes from \a arena
+ *
+ * \param[in,out]   arena   memory arena
+ * \param[in]       size    number of bytes
+ *
+ * \return  memory, valid until \a arena is freed
+ */
+void *hvsc_arena_alloc(hvsc_arena_t *arena, size_t size)
+{
+#ifndef HVSC_STANDALONE
+    return lib_arena_alloc((lib_arena_t *)arena, size);
+#else
+    hvsc_arena_block_t *block = hvsc_malloc(sizeof *block + size);
+
+    block->next   = arena->blocks;
+    arena->blocks = block;
+    return block->data;
+#endif
+}
+
+
+/** \brief  Copy at most \a n bytes of \a s into \a arena
+ *
+ * \param[in,out]   arena   memory arena
+ * \param[in]       s       string to copy
+ * \param[in]       n       maximum number of bytes to copy
+ *
+ * \return  nul-terminated copy of \a s, valid until \a arena is freed
+ */
+char *hvsc_arena_strndup(hvsc_arena_t *arena, const char *s, size_t n)
+{
+#ifndef HVSC_STANDALONE
+    return lib_arena_strndup((lib_arena_t *)arena, s, n);
+#else
+    char *t = hvsc_arena_alloc(arena, n + 1);
+    strncpy(t, s, n);
+    t[n] = '\0';
+    return t;
+#endif
+}
+
+
+/** \brief  Free \a arena and all memory allocated from it
+ *
+ * \param[in,out]   arena   memory arena (can be `NULL`)
+ */
+void hvsc_arena_free(hvsc_arena_t *arena)
+{
+#ifndef HVSC_STANDALONE
+    lib_arena_free((lib_arena_t *)arena);
+#else
+    hvsc_arena_block_t *block;
+
+    if (arena == NULL) {
+        return;
+    }
+    while (arena->blocks != NULL) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        hvsc_free(block);
+    }
+    hvsc_free(arena);
+#endif
+}
+
+
 
 
 /** \brief  Initialize text file handle
@@ -549,6 +692,15 @@ void hvsc_set_paths(const char *path)
  */
 void hvsc_free_paths(void)
 {
+    int i;
+
+    /* the indexes belong to the files of these paths */
+    for (i = 0; i < HVSC_INDEX_COUNT; i++) {
+        hvsc_free(hvsc_indexes[i].entries);
+        hvsc_free(hvsc_indexes[i].buckets);
+        memset(&hvsc_indexes[i], 0, sizeof hvsc_indexes[i]);
+    }
+
     if (hvsc_root_path != NULL) {
         hvsc_free(hvsc_root_path);
         hvsc_root_path = NULL;
@@ -861,3 +1013,256 @@ bool hvsc_md5_digest(const char *psid, char *digest)
 
     return true;
 }
+
+
+/** \brief  Get the key of \a line for index \a type
+ *
+ * \param[in]   type    index type
+ * \param[in]   line    line of text
+ * \param[out]  len     length of the key
+ *
+ * \return  start of the key in \a line, or `NULL` if the line has none
+ */
+static const char *index_line_key(int type, const char *line, size_t *len)
+{
+    switch (type) {
+        case HVSC_INDEX_STIL:
+        case HVSC_INDEX_BUGS:
+            /* entries start with the HVSC-relative path of the tune */
+            if (*line == '/') {
+                *len = strlen(line);
+                return line;
+            }
+            break;
+        case HVSC_INDEX_SLDB_MD5:
+            if (isalnum((unsigned char)*line)
+                    && strlen(line) >= HVSC_DIGEST_SIZE * 2u) {
+                *len = HVSC_DIGEST_SIZE * 2u;
+                return line;
+            }
+            break;
+        case HVSC_INDEX_SLDB_PATH:
+            /* "; /path/to/tune.sid" comment before the digest */
+            if (line[0] == ';' && line[1] == ' ') {
+                *len = strlen(line + 2);
+                return line + 2;
+            }
+            break;
+        default:
+            break;
+    }
+    return NULL;
+}
+
+
+/** \brief  Hash a key of an index
+ *
+ * \param[in]   key key
+ * \param[in]   len length of the key
+ *
+ * \return  hash
+ */
+static uint32_t index_hash(const char *key, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t   i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+/** \brief  Get the path of the file of index \a type
+ *
+ * \param[in]   type    index type
+ *
+ * \return  path
+ */
+static const char *index_file_path(int type)
+{
+    switch (type) {
+        case HVSC_INDEX_STIL:
+            return hvsc_stil_path;
+        case HVSC_INDEX_BUGS:
+            return hvsc_bugs_path;
+        default:
+            return hvsc_sldb_path;
+    }
+}
+
+
+/** \brief  Build index \a type by reading its file once
+ *
+ * \param[in]   type    index type
+ *
+ * \return  bool
+ */
+static bool index_build(int type)
+{
+    hvsc_index_t *index = &hvsc_indexes[type];
+    uint8_t      *data;
+    long          size;
+    long          pos = 0;
+    long          prev = -1;
+    long          lineno = 0;
+    long          max = 0;
+    long          i;
+
+    index->built = true;
+    size = hvsc_read_file(&data, index_file_path(type));
+    if (size < 0) {
+        index->failed = true;
+        return false;
+    }
+
+    /* split into lines the same way hvsc_text_file_read() does */
+    while (pos < size) {
+        char       *line = (char *)data + pos;
+        char       *end = memchr(line, '\n', (size_t)(size - pos));
+        long        next;
+        const char *key;
+        size_t      keylen;
+
+        if (end == NULL) {
+            end = (char *)data + size;
+            next = size;
+        } else {
+            next = (long)(end - (char *)data) + 1;
+        }
+        if (end > line && end[-1] == '\r') {
+            end--;
+        }
+        *end = '\0';
+
+        key = index_line_key(type, line, &keylen);
+        if (key != NULL) {
+            hvsc_index_entry_t *entry;
+
+            if (index->count == max) {
+                max = max == 0 ? 4096 : max * 2;
+                index->entries = hvsc_realloc(index->entries,
+                                              (size_t)max * sizeof *(index->entries));
+            }
+            entry = &index->entries[index->count++];
+            entry->hash = index_hash(key, keylen);
+            entry->lineno = lineno;
+            entry->offset = pos;
+            entry->prev_offset = prev;
+        }
+
+        prev = pos;
+        pos = next;
+        lineno++;
+    }
+    hvsc_free(data);
+
+    /* hash the entries, keeping the order of the file in each chain so the
+     * first of several equal keys is found, as when reading the file */
+    index->mask = 1023;
+    while ((long)index->mask < index->count) {
+        index->mask = index->mask * 2u + 1u;
+    }
+    index->buckets = hvsc_malloc(((size_t)index->mask + 1u) * sizeof *(index->buckets));
+    for (i = 0; i <= (long)index->mask; i++) {
+        index->buckets[i] = -1;
+    }
+    for (i = index->count - 1; i >= 0; i--) {
+        long *head = &index->buckets[index->entries[i].hash & index->mask];
+
+        index->entries[i].next = *head;
+        *head = i;
+    }
+    hvsc_dbg("indexed %ld entries of '%s'\n", index->count, index_file_path(type));
+    return true;
+}
+
+
+/** \brief  Move text file \a handle to the line at \a offset
+ *
+ * \param[in,out]   handle  text file handle
+ * \param[in]       offset  file offset of a line
+ * \param[in]       lineno  number of lines before it
+ *
+ * \return  bool
+ */
+static bool text_file_seek(hvsc_text_file_t *handle, long offset, long lineno)
+{
+    if (fseek(handle->fp, offset, SEEK_SET) != 0) {
+        hvsc_errno = HVSC_ERR_IO;
+        return false;
+    }
+    handle->lineno = lineno;
+    handle->buffer[0] = '\0';
+    return true;
+}
+
+
+/** \brief  Find the line with \a key in the text file of \a handle
+ *
+ * Positions \a handle as if the file had been read up to and including the
+ * line with \a key: the line is in the buffer of \a handle, the line before
+ * it in the previous-line buffer, and the next read gets the line after it.
+ *
+ * \param[in,out]   handle  text file handle, opened on the file of \a type
+ * \param[in]       type    index type
+ * \param[in]       key     key to look for
+ *
+ * \return  bool, with `hvsc_errno` set to `HVSC_ERR_NOT_FOUND` when there is
+ *          no such line
+ */
+bool hvsc_text_file_find(hvsc_text_file_t *handle, int type, const char *key)
+{
+    hvsc_index_t *index = &hvsc_indexes[type];
+    size_t        keylen;
+    uint32_t      hash;
+    long          i;
+
+    if (!index->built) {
+        index_build(type);
+    }
+    if (index->failed) {
+        hvsc_errno = HVSC_ERR_IO;
+        return false;
+    }
+
+    keylen = strlen(key);
+    if (type == HVSC_INDEX_SLDB_MD5 && keylen > HVSC_DIGEST_SIZE * 2u) {
+        keylen = HVSC_DIGEST_SIZE * 2u;
+    }
+    hash = index_hash(key, keylen);
+
+    for (i = index->buckets[hash & index->mask]; i >= 0; i = index->entries[i].next) {
+        const hvsc_index_entry_t *entry = &index->entries[i];
+        const char               *line;
+        const char               *line_key;
+        size_t                    line_keylen;
+
+        if (entry->hash != hash) {
+            continue;
+        }
+        if (entry->prev_offset >= 0) {
+            if (!text_file_seek(handle, entry->prev_offset, entry->lineno - 1)
+                    || hvsc_text_file_read(handle) == NULL) {
+                return false;
+            }
+        } else {
+            if (!text_file_seek(handle, entry->offset, entry->lineno)) {
+                return false;
+            }
+        }
+        line = hvsc_text_file_read(handle);
+        if (line == NULL) {
+            return false;
+        }
+        /* the file may have changed since it was indexed */
+        line_key = index_line_key(type, line, &line_keylen);
+        if (line_key != NULL && line_keylen == keylen
+                && memcmp(line_key, key, keylen) == 0) {
+            return true;
+        }
+    }
+    hvsc_errno = HVSC_ERR_NOT_FOUND;
+    return false;
+}
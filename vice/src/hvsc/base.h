@@ -65,6 +65,18 @@
 #endif
 
 
+/** \brief  Index types for hvsc_text_file_find()
+ */
+typedef enum hvsc_index_type_e {
+    HVSC_INDEX_STIL,        /**< STIL.txt, by HVSC-relative path */
+    HVSC_INDEX_BUGS,        /**< BUGlist.txt, by HVSC-relative path */
+    HVSC_INDEX_SLDB_MD5,    /**< Songlengths.md5, by md5 digest */
+    HVSC_INDEX_SLDB_PATH,   /**< Songlengths.md5, by path in the comments */
+
+    HVSC_INDEX_COUNT        /**< number of index types */
+} hvsc_index_type_t;
+
+
 extern char *hvsc_root_path;
 extern char *hvsc_sldb_path;
 extern char *hvsc_stil_path;
@@ -77,6 +89,12 @@ void        hvsc_free(void *ptr);
 
 char *      hvsc_strdup(const char *s);
 char *      hvsc_strndup(const char *s, size_t n);
+
+hvsc_arena_t *hvsc_arena_new(void);
+void *      hvsc_arena_alloc(hvsc_arena_t *arena, size_t size);
+char *      hvsc_arena_strndup(hvsc_arena_t *arena, const char *s, size_t n);
+void        hvsc_arena_free(hvsc_arena_t *arena);
+
 char *      hvsc_paths_join(const char *p1, const char *p2);
 long        hvsc_read_file(uint8_t **dest, const char *path);
 void        hvsc_set_paths(const char *path);
@@ -85,6 +103,7 @@ void        hvsc_text_file_init_handle(hvsc_text_file_t *handle);
 bool        hvsc_text_file_open(const char *path, hvsc_text_file_t *handle);
 const char *hvsc_text_file_read(hvsc_text_file_t *handle);
 void        hvsc_text_file_close(hvsc_text_file_t *handle);
+bool        hvsc_text_file_find(hvsc_text_file_t *handle, int type, const char *key);
 
 char *      hvsc_path_strip_root(const char *path);
 bool        hvsc_path_is_hvsc(const char *path);
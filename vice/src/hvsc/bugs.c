@@ -151,32 +151,13 @@ bool hvsc_bugs_open(const char *psid, hvsc_bugs_t *handle)
     }
 
     /* find the entry */
-    while (true) {
-        const char *line;
-
-        line = hvsc_text_file_read(&(handle->bugs));
-        if (line == NULL) {
-            if (feof(handle->bugs.fp)) {
-                /* EOF, so simply not found */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
-            }
-            hvsc_bugs_close(handle);
-            /* I/O error is already set */
-            return false;
-        }
-
-        if (strcmp(line, handle->psid_path) == 0) {
-            hvsc_dbg("Found '%s' at line %ld\n", line, handle->bugs.lineno);
-            return bugs_parse(handle);
-        }
+    if (!hvsc_text_file_find(&(handle->bugs), HVSC_INDEX_BUGS, handle->psid_path)) {
+        hvsc_bugs_close(handle);
+        /* I/O error or not found is already set */
+        return false;
     }
-
-#if 0 /* above loop never breaks - following code can never execute */
-    /* not found */
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    hvsc_bugs_close(handle);
-    return true;
-#endif
+    hvsc_dbg("Found '%s' at line %ld\n", handle->bugs.buffer, handle->bugs.lineno);
+    return bugs_parse(handle);
 }
 
 
@@ -108,6 +108,11 @@ typedef enum hvsc_stil_field_type_e {
 } hvsc_stil_field_type_t;
 
 
+/** \brief  Memory arena, allocations from it are freed all at once
+ */
+typedef struct hvsc_arena_s hvsc_arena_t;
+
+
 /** \brief  Handle for the text file reader functions
  */
 typedef struct hvsc_text_file_s {
@@ -170,6 +175,8 @@ typedef struct hvsc_stil_s {
     hvsc_stil_block_t **blocks;         /**< STIL blocks */
     size_t              blocks_max;     /**< number of available blocks */
     size_t              blocks_used;    /**< number of used blocks */
+    hvsc_arena_t       *arena;          /**< memory for the entry text and the
+                                             parsed fields and blocks */
 } hvsc_stil_t;
 
 /** \brief  Handle for the BUGlist functions
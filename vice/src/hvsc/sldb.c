@@ -103,33 +103,18 @@ static bool create_md5_hash(const char *psid, unsigned char *digest)
 static char *find_sldb_entry_md5(const char *digest)
 {
     hvsc_text_file_t  handle;
-    const char       *line;
+    char             *s = NULL;
 
     if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
         return NULL;
     }
 
-    while (true) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
-            return NULL;
-        }
-#if 0
-        printf("%s\n", line);
-#endif
-        if (memcmp(digest, line, HVSC_DIGEST_SIZE * 2) == 0) {
-            /* copy the current line before closing the file */
-            char *s = hvsc_strdup(handle.buffer);
-            hvsc_text_file_close(&handle);
-            return s;
-        }
+    if (hvsc_text_file_find(&handle, HVSC_INDEX_SLDB_MD5, digest)) {
+        /* copy the current line before closing the file */
+        s = hvsc_strdup(handle.buffer);
     }
-/*
     hvsc_text_file_close(&handle);
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    return NULL;
-*/
+    return s;
 }
 
 /** \brief  Find song length entry by PSID name in the comments
@@ -141,8 +126,8 @@ static char *find_sldb_entry_md5(const char *digest)
 static char *find_sldb_entry_txt(const char *path)
 {
     hvsc_text_file_t  handle;
-    size_t            plen;
     const char       *line;
+    char             *s;
 
 #ifndef HVSC_STANDALONE
     log_message(LOG_DEFAULT, "VSID: Opening '%s'.", hvsc_sldb_path);
@@ -154,41 +139,24 @@ static char *find_sldb_entry_txt(const char *path)
         return NULL;
     }
 
-    plen = strlen(path);
-
-    while (true) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
+    if (!hvsc_text_file_find(&handle, HVSC_INDEX_SLDB_PATH, path)) {
+        hvsc_text_file_close(&handle);
 #ifndef HVSC_STANDALONE
-            log_warning(LOG_DEFAULT,
-                    "VSID: Could not find song length data for current SID.");
+        log_warning(LOG_DEFAULT,
+                "VSID: Could not find song length data for current SID.");
 #endif
-            return NULL;
-        }
-
-
-        if (*line == ';') {
-            if (strncmp(path, line + 2, plen) == 0) {
-                /* next line contains the actual entry */
-                char *s;
-                line = hvsc_text_file_read(&handle);
-                if (line == NULL) {
-                    hvsc_text_file_close(&handle);
-                    return NULL;
-                }
-                s = hvsc_strdup(handle.buffer);
-                hvsc_text_file_close(&handle);
-                return s;
-            }
-        }
+        return NULL;
     }
 
-#if 0 /* above loop never breaks - following code can never execute */
+    /* next line contains the actual entry */
+    line = hvsc_text_file_read(&handle);
+    if (line == NULL) {
+        hvsc_text_file_close(&handle);
+        return NULL;
+    }
+    s = hvsc_strdup(handle.buffer);
     hvsc_text_file_close(&handle);
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    return NULL;
-#endif
+    return s;
 }
 
 /** \brief  Parse SLDB entry
@@ -369,26 +337,17 @@ int hvsc_sldb_get_lengths(const char *psid, long **lengths)
  */
 char *hvsc_sldb_get_path_for_md5(const char *digest)
 {
-    hvsc_text_file_t handle;
-#ifdef HVSC_DEBUG
-    int              lineno = 1;
-#endif
+    hvsc_text_file_t  handle;
+    char             *path = NULL;
 
     if (hvsc_text_file_open(hvsc_sldb_path, &handle)) {
-        const char *line;
-
-        while ((line = hvsc_text_file_read(&handle)) != NULL) {
-            if (isalnum((unsigned char)*line) &&
-                    strncmp(digest, line, HVSC_DIGEST_SIZE * 2u) == 0) {
-                hvsc_dbg("got matching md5 sum at line %d: %s\n",
-                         lineno, digest);
-                hvsc_dbg("HVSC path for md5 sum: %s\n", handle.prevbuf + 2);
-                return hvsc_strdup(handle.prevbuf + 2);
-            }
-#ifdef HVSC_DEBUG
-            lineno++;
-#endif
+        if (hvsc_text_file_find(&handle, HVSC_INDEX_SLDB_MD5, digest)) {
+            hvsc_dbg("got matching md5 sum at line %ld: %s\n",
+                     handle.lineno, digest);
+            hvsc_dbg("HVSC path for md5 sum: %s\n", handle.prevbuf + 2);
+            path = hvsc_strdup(handle.prevbuf + 2);
         }
+        hvsc_text_file_close(&handle);
     }
-    return NULL;
+    return path;
 }
@@ -52,22 +52,20 @@
  */
 
 static void                 stil_field_init(hvsc_stil_field_t *field);
-static hvsc_stil_field_t *  stil_field_new(int type,
-                                           const char *text,
-                                           size_t      tlen,
-                                           long        ts_from,
-                                           long        ts_to,
-                                           const char *album,
-                                           size_t      alen);
-static void                 stil_field_free(hvsc_stil_field_t *field);
-static hvsc_stil_field_t *  stil_field_dup(const hvsc_stil_field_t *field);
+static hvsc_stil_field_t *  stil_field_new(hvsc_arena_t *arena,
+                                           int           type,
+                                           const char   *text,
+                                           size_t        tlen,
+                                           long          ts_from,
+                                           long          ts_to,
+                                           const char   *album,
+                                           size_t        alen);
 
 static void                 stil_block_init(hvsc_stil_block_t *block);
-static hvsc_stil_block_t *  stil_block_new(void);
-static void                 stil_block_free(hvsc_stil_block_t *block);
-static void                 stil_block_add_field(hvsc_stil_block_t *block,
+static hvsc_stil_block_t *  stil_block_new(hvsc_arena_t *arena);
+static void                 stil_block_add_field(hvsc_arena_t      *arena,
+                                                 hvsc_stil_block_t *block,
                                                  hvsc_stil_field_t *field);
-static hvsc_stil_block_t *  stil_block_dup(const hvsc_stil_block_t *block);
 
 static int                  stil_parse_timestamp(char                   *s,
                                                  hvsc_stil_timestamp_t  *ts,
@@ -190,8 +188,10 @@ static void stil_field_init(hvsc_stil_field_t *field)
 
 /** \brief  Allocate a new STIL field object
  *
- * The copy of \a text will be nul-terminated.
+ * The field and the copy of \a text are allocated from \a arena, the copy
+ * will be nul-terminated.
  *
+ * \param[in]   arena   memory arena
  * \param[in]   type    field type
  * \param[in]   text    field text
  * \param[in]   tlen    number of bytes to copy from \a text
@@ -202,42 +202,28 @@ static void stil_field_init(hvsc_stil_field_t *field)
  *
  * \return  new STIL field object or `NULL` on failure
  */
-static hvsc_stil_field_t *stil_field_new(int         type,
-                                         const char *text,
-                                         size_t      tlen,
-                                         long        ts_from,
-                                         long        ts_to,
-                                         const char *album,
-                                         size_t      alen)
+static hvsc_stil_field_t *stil_field_new(hvsc_arena_t *arena,
+                                         int           type,
+                                         const char   *text,
+                                         size_t        tlen,
+                                         long          ts_from,
+                                         long          ts_to,
+                                         const char   *album,
+                                         size_t        alen)
 {
-    hvsc_stil_field_t *field = hvsc_malloc(sizeof *field);
+    hvsc_stil_field_t *field = hvsc_arena_alloc(arena, sizeof *field);
 
     stil_field_init(field);
     field->type           = type;
     field->timestamp.from = ts_from;
     field->timestamp.to   = ts_to;
-    field->text = hvsc_strndup(text, tlen);
+    field->text = hvsc_arena_strndup(arena, text, tlen);
     if (album != NULL && *album != '\0') {
-        field->album = hvsc_strndup(album, alen);
+        field->album = hvsc_arena_strndup(arena, album, alen);
     }
     return field;
 }
 
-/** \brief  Free memory used by member of \a field and \a field itself
- *
- * \param[in,out]   field   STIL field object
- */
-static void stil_field_free(hvsc_stil_field_t *field)
-{
-    if (field->text != NULL) {
-        hvsc_free(field->text);
-    }
-    if (field->album != NULL) {
-        hvsc_free(field->album);
-    }
-    hvsc_free(field);
-}
-
 
 /*
  * STIL block functions
@@ -258,18 +244,21 @@ static void stil_block_init(hvsc_stil_block_t *block)
 }
 
 /** \brief  Allocate and intialize a new STIL block
+ *
+ * \param[in,out]   arena   memory arena to allocate the block from
  *
  * \return  new STIL block or `NULL` on failure
  */
-static hvsc_stil_block_t *stil_block_new(void)
+static hvsc_stil_block_t *stil_block_new(hvsc_arena_t *arena)
 {
     hvsc_stil_block_t *block;
     size_t             i;
 
-    block = hvsc_malloc(sizeof *block);
+    block = hvsc_arena_alloc(arena, sizeof *block);
     stil_block_init(block);
 
-    block->fields = hvsc_malloc(HVSC_STIL_BLOCK_FIELDS_INIT * sizeof *(block->fields));
+    block->fields = hvsc_arena_alloc(arena,
+            HVSC_STIL_BLOCK_FIELDS_INIT * sizeof *(block->fields));
     block->fields_max = HVSC_STIL_BLOCK_FIELDS_INIT;
     for (i = 0; i < HVSC_STIL_BLOCK_FIELDS_INIT; i++) {
         block->fields[i] = NULL;
@@ -277,78 +266,27 @@ static hvsc_stil_block_t *stil_block_new(void)
     return block;
 }
 
-/** \brief  Make a deep copy of \a field
- *
- * \param[in]   field   STIL field
- *
- * \return  copy of \a field
- */
-static hvsc_stil_field_t *stil_field_dup(const hvsc_stil_field_t *field)
-{
-    return stil_field_new(field->type,
-                          field->text,
-                          strlen(field->text),
-                          field->timestamp.from,
-                          field->timestamp.to,
-                          field->album,
-                          field->album != NULL ? strlen(field->album) : 0);
-}
-
-/** \brief  Make a deep copy of \a block
- *
- * \param[in]   block   STIL block
- *
- * \return  copy of \a block
- */
-static hvsc_stil_block_t *stil_block_dup(const hvsc_stil_block_t *block)
-{
-    hvsc_stil_block_t *copy;
-    size_t             i;
-
-    copy = hvsc_malloc(sizeof *copy);
-    stil_block_init(copy);
-
-    copy->tune        = block->tune;
-    copy->fields_max  = block->fields_max;
-    copy->fields_used = block->fields_used;
-    copy->fields      = hvsc_malloc(block->fields_max * sizeof *(copy->fields));
-    for (i = 0; i < copy->fields_used; i++) {
-        copy->fields[i] = stil_field_dup(block->fields[i]);
-    }
-    return copy;
-}
-
-/** \brief  Free STIL block and its members
- *
- * \param[in,out]   block   STIL block
- */
-static void stil_block_free(hvsc_stil_block_t *block)
-{
-    size_t i;
-
-    for (i = 0; i < block->fields_used; i++) {
-        stil_field_free(block->fields[i]);
-    }
-    hvsc_free(block->fields);
-    hvsc_free(block);
-}
-
 /** \brief  Add STIL \a field to STIL \a block
  *
+ * \param[in,out]   arena   memory arena the block was allocated from
  * \param[in,out]   block   STIL block
  * \param[in]       field   STIL field
  */
-static void stil_block_add_field(hvsc_stil_block_t *block,
+static void stil_block_add_field(hvsc_arena_t      *arena,
+                                 hvsc_stil_block_t *block,
                                  hvsc_stil_field_t *field)
 {
     hvsc_dbg("max = %" PRI_SIZE_T ", used = %" PRI_SIZE_T "\n",
              block->fields_max, block->fields_used);
     /* do we need to resize the array? */
     if (block->fields_max == block->fields_used) {
-        /* yep */
+        /* yep, the old array stays in the arena until the handle is closed */
+        hvsc_stil_field_t **fields;
+
         block->fields_max *= 2;
-        block->fields = hvsc_realloc(block->fields,
-                                     block->fields_max * sizeof *(block->fields));
+        fields = hvsc_arena_alloc(arena, block->fields_max * sizeof *fields);
+        memcpy(fields, block->fields, block->fields_used * sizeof *fields);
+        block->fields = fields;
     }
     block->fields[block->fields_used++] = field;
 }
@@ -368,6 +306,7 @@ static void stil_init_handle(hvsc_stil_t *handle)
     handle->blocks        = NULL;
     handle->blocks_max    = 0;
     handle->blocks_used   = 0;
+    handle->arena         = hvsc_arena_new();
 }
 
 /** \brief  Allocate initial 'blocks' array
@@ -388,18 +327,15 @@ static void stil_handle_init_blocks(hvsc_stil_t *handle)
     handle->blocks_max  = HVSC_HANDLE_BLOCKS_INIT;
 }
 
-/** \brief  Free STIL blocks (entries + array)
+/** \brief  Free STIL blocks array
+ *
+ * The blocks themselves are in the handle's arena.
  *
  * \param[in,out]   handle  STIL handle
  */
 static void stil_handle_free_blocks(hvsc_stil_t *handle)
 {
     if (handle->blocks != NULL) {
-        size_t i;
-
-        for (i = 0; i < handle->blocks_used; i++) {
-            stil_block_free(handle->blocks[i]);
-        }
         hvsc_free(handle->blocks);
         handle->blocks = NULL;
     }
@@ -419,8 +355,7 @@ static void stil_handle_add_block(hvsc_stil_t *handle, hvsc_stil_block_t *block)
         handle->blocks = hvsc_realloc(handle->blocks,
                                       handle->blocks_max * sizeof *(handle->blocks));
     }
-    /* make a copy */
-    handle->blocks[handle->blocks_used++] = stil_block_dup(block);
+    handle->blocks[handle->blocks_used++] = block;
 }
 
 
@@ -486,29 +421,22 @@ bool hvsc_stil_open(const char *psid, hvsc_stil_t *handle)
     hvsc_dbg("stripped path is '%s'\n", handle->psid_path);
 
     /* find the entry */
-    while (true) {
-        line = hvsc_text_file_read(&(handle->stil));
-        if (line == NULL) {
-            if (feof(handle->stil.fp)) {
-                /* EOF, so simply not found */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
+    if (!hvsc_text_file_find(&(handle->stil), HVSC_INDEX_STIL, handle->psid_path)) {
 #ifndef HVSC_STANDALONE
-                log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
-#endif
-            }
-            hvsc_stil_close(handle);
-            /* I/O error is already set */
-            return false;
+        if (hvsc_errno == HVSC_ERR_NOT_FOUND) {
+            log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
         }
-
-        if (strcmp(line, handle->psid_path) == 0) {
-#ifndef HVSC_STANDALONE
-            log_message(LOG_DEFAULT,
-                    "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
 #endif
-            return true;
-        }
+        hvsc_stil_close(handle);
+        /* I/O error is already set */
+        return false;
     }
+    line = handle->stil.buffer;
+#ifndef HVSC_STANDALONE
+    log_message(LOG_DEFAULT,
+            "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
+#endif
+    return true;
 }
 
 
@@ -525,6 +453,7 @@ bool hvsc_stil_open_md5(const char *digest, hvsc_stil_t *handle)
 
     if (!hvsc_text_file_open(hvsc_stil_path, &(handle->stil))) {
         hvsc_dbg("failed to open STIL.");
+        hvsc_stil_close(handle);
         return false;
     }
 
@@ -542,29 +471,20 @@ bool hvsc_stil_open_md5(const char *digest, hvsc_stil_t *handle)
     }
 
     /* look up entry */
-    while (true) {
-        const char *line = hvsc_text_file_read(&(handle->stil));
-
-        if (line == NULL) {
-            if (feof(handle->stil.fp)) {
-                /* EOF, OK */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
+    if (!hvsc_text_file_find(&(handle->stil), HVSC_INDEX_STIL, handle->psid_path)) {
 #ifndef HVSC_STANDALONE
-                log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
-#endif
-            }
-            hvsc_stil_close(handle);
-            return false;
+        if (hvsc_errno == HVSC_ERR_NOT_FOUND) {
+            log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
         }
-
-        if (strcmp(line, handle->psid_path) == 0) {
-#ifndef HVSC_STANDALONE
-            log_message(LOG_DEFAULT,
-                    "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
 #endif
-            return true;
-        }
+        hvsc_stil_close(handle);
+        return false;
     }
+#ifndef HVSC_STANDALONE
+    log_message(LOG_DEFAULT,
+            "VSID: Found '%s' at line %ld.", handle->stil.buffer, handle->stil.lineno);
+#endif
+    return true;
 }
 
 
@@ -579,20 +499,15 @@ void hvsc_stil_close(hvsc_stil_t *handle)
     hvsc_text_file_close(&(handle->stil));
     hvsc_free(handle->psid_path);
 
+    /* the lines, the comment and the blocks are in the arena */
     if (handle->entry_buffer != NULL) {
-        size_t i;
-        for (i = 0; i < handle->entry_bufused; i++){
-            hvsc_free(handle->entry_buffer[i]);
-        }
         hvsc_free(handle->entry_buffer);
     }
-
-    if (handle->sid_comment != NULL) {
-        hvsc_free(handle->sid_comment);
-    }
     if (handle->blocks != NULL) {
         stil_handle_free_blocks(handle);
     }
+    hvsc_arena_free(handle->arena);
+    handle->arena = NULL;
 }
 
 
@@ -614,7 +529,8 @@ static void hvsc_stil_entry_add_line(hvsc_stil_t *handle, const char *line)
         handle->entry_buffer = hvsc_realloc(handle->entry_buffer,
                 handle->entry_bufmax * sizeof *(handle->entry_buffer));
     }
-    handle->entry_buffer[handle->entry_bufused++] = hvsc_strdup(line);
+    handle->entry_buffer[handle->entry_bufused++] =
+        hvsc_arena_strndup(handle->arena, line, strlen(line));
 }
 
 
@@ -679,6 +595,8 @@ void hvsc_stil_dump_entry(hvsc_stil_t *handle)
  * comment is expected to start with 'COMMENT:' on the first line and each
  * subsequent line is expected to start with 9 spaces, per STIL.faq.
  *
+ * The comment is allocated from the handle's arena.
+ *
  * \param[in]   state   parser state
  *
  * \return  comment
@@ -688,28 +606,35 @@ static char *stil_parse_comment(hvsc_stil_parser_state_t *state)
     char       *comment;
     size_t      len;    /* len per line, excluding '\0' */
     size_t      total;  /* total line of comment, excluding '\0' */
-    const char *line = state->handle->entry_buffer[state->lineno];
-
-    /* first line is 'COMMENT: <text>' */
-    comment = hvsc_strdup(line + 9);
-    total   = strlen(line) - 9;
-    state->lineno++;
-
-    while (state->lineno < state->handle->entry_bufused) {
-        line = state->handle->entry_buffer[state->lineno];
-        len = strlen(line);
+    size_t      first = state->lineno;
+    size_t      last;
+    const char *line  = state->handle->entry_buffer[first];
+
+    /* first line is 'COMMENT: <text>', find the last line and the length */
+    total = strlen(line) - 9;
+    for (last = first + 1; last < state->handle->entry_bufused; last++) {
+        line = state->handle->entry_buffer[last];
         /* check for nine spaces */
         if (strncmp("         ", line, 9) != 0) {
-            return comment;
+            break;
         }
-        /* realloc to add new line */
-        comment = hvsc_realloc(comment, total + len - 8 + 1);
+        total += strlen(line) - 8;
+    }
+
+    comment = hvsc_arena_alloc(state->handle->arena, total + 1);
+    line = state->handle->entry_buffer[first];
+    len  = strlen(line) - 9;
+    memcpy(comment, line + 9, len);
+    total = len;
+    for (state->lineno = first + 1; state->lineno < last; state->lineno++) {
+        line = state->handle->entry_buffer[state->lineno];
         /* add line to comment, adding a space from the nine spaces indent to
          * get a proper separating space in the final comment text */
-        memcpy(comment + total, line + 8, len - 8 + 1);
-        total += (len - 8);
-        state->lineno++;
+        len = strlen(line) - 8;
+        memcpy(comment + total, line + 8, len);
+        total += len;
     }
+    comment[total] = '\0';
     return comment;
 }
 
@@ -735,22 +660,19 @@ static void stil_parser_init(hvsc_stil_parser_state_t *parser,
     parser->album_len = 0;
 
     /* add block for tune #1 */
-    parser->block = stil_block_new();
+    parser->block = stil_block_new(handle->arena);
 }
 
 /** \brief  Free memory used by the parser's members
  *
  * Frees memory used by the members of \a parser, but not parser itself. The
  * STIL handle stored in \a parser also isn't freed, that is done by
- * hvsc_stil_close()
+ * hvsc_stil_close(), which also frees the blocks.
  *
  * \param[in,out]   parser  STIL parser state
  */
 static void stil_parser_free(hvsc_stil_parser_state_t *parser)
 {
-    if (parser->block != NULL) {
-        stil_block_free(parser->block);
-    }
     if (parser->album != NULL) {
         hvsc_free(parser->album);
         parser->album = NULL;
@@ -803,8 +725,7 @@ void hvsc_stil_parse_entry(hvsc_stil_t *handle)
              */
             if (state.tune > 1) {
                 stil_handle_add_block(state.handle, state.block);
-                stil_block_free(state.block);
-                state.block       = stil_block_new();
+                state.block       = stil_block_new(handle->arena);
                 state.block->tune = num;
             }
 
@@ -912,17 +833,12 @@ void hvsc_stil_parse_entry(hvsc_stil_t *handle)
 
             if (state.tune > 0) {
                 hvsc_dbg("Adding '%s'\n", line);
-                state.field = stil_field_new(type,
+                state.field = stil_field_new(handle->arena, type,
                                              line, state.linelen,
                                              state.ts.from, state.ts.to,
                                              state.album, state.album_len);
-                stil_block_add_field(state.block, state.field);
+                stil_block_add_field(handle->arena, state.block, state.field);
 
-                /* if the line was a comment, free the comment */
-                if (type == HVSC_FIELD_COMMENT) {
-                    hvsc_free(comment);
-                    comment = NULL;
-                }
                 /* free album, if present */
                 if (state.album != NULL) {
                     hvsc_free(state.album);
@@ -208,6 +208,23 @@ void iecbus_cpu_undump(uint8_t data)
     iec_old_atn = iecbus.cpu_bus & 0x10;
 }
 
+/* Does a write of the computer change any of its lines on the bus?  Most
+   writes to the port only change the other bits (like the VIC-II bank on
+   the C64), the drives and IEC devices cannot see those, so they are
+   neither synced nor is the bus state calculated again.  The drives update
+   their own part of the bus state when they write to it.  */
+static int iecbus_cpu_bus_changes(uint8_t data)
+{
+    uint8_t old_bus = iecbus.cpu_bus;
+    int changed;
+
+    iec_update_cpu_bus(data);
+    changed = (iecbus.cpu_bus != old_bus);
+    iecbus.cpu_bus = old_bus;
+
+    return changed;
+}
+
 /* No drive is enabled.  */
 static uint8_t iecbus_cpu_read_conf0(CLOCK clock)
 {
@@ -238,6 +255,10 @@ static void iecbus_cpu_write_conf1(uint8_t data, CLOCK clock)
 {
     diskunit_context_t *unit = diskunit_context[0];
 
+    if (!iecbus_cpu_bus_changes(data)) {
+        return;
+    }
+
     drive_cpu_execute_one(unit, clock);
 
     DEBUG_IEC_CPU_WRITE(data);
@@ -301,6 +322,10 @@ static void iecbus_cpu_write_conf2(uint8_t data, CLOCK clock)
 {
     diskunit_context_t *unit = diskunit_context[1];
 
+    if (!iecbus_cpu_bus_changes(data)) {
+        return;
+    }
+
     drive_cpu_execute_one(unit, clock);
 
     DEBUG_IEC_CPU_WRITE(data);
@@ -365,6 +390,10 @@ static void iecbus_cpu_write_conf3(uint8_t data, CLOCK clock)
 {
     unsigned int dnr;
 
+    if (!iecbus_cpu_bus_changes(data)) {
+        return;
+    }
+
     drive_cpu_execute_all(clock);
     serial_iec_device_exec(clock);
 
@@ -103,4 +103,7 @@ char *image_contents_filename_by_number(image_contents_t *contents, unsigned int
 
 image_contents_t *diskcontents_iec_read(unsigned int unit);
 
+image_contents_t *image_contents_read_cached(const char *path, read_contents_func_type func);
+void image_contents_cache_shutdown(void);
+
 #endif
@@ -0,0 +1,550 @@
+/** \file   imagecontents-cache.c
+ * \brief   Persistent cache of image directory listings
+ *
+ * Used by the file dialog previews, which read the contents of every image
+ * the user selects.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The listings are kept in memory, hashed by path, and appended to a file
+   in the user's cache directory as they are read, so they survive a
+   restart.  An entry is only used while the size and modification time of
+   the image are the same as when it was read.  Failed reads are cached
+   too, so files that are not images are not parsed again.
+
+   File format: the magic, then records of
+       u32 length of the rest of the record
+       u16 path length, path
+       i64 modification time, u64 size
+       u8 1 if the listing could be read, and then
+           name, id, i32 blocks free, i32 partition, u32 number of files,
+           and per file: name, type, u32 size
+   all in little endian.  A later record for the same path replaces an
+   earlier one; the file is rewritten without the replaced records when
+   there are too many of them.
+
+   The functions can be called from any thread.  */
+
+#include "vice.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "archdep.h"
+#include "imagecontents.h"
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "util.h"
+
+#define CACHE_FILE_NAME     "imagecontents.cache"
+#define CACHE_MAGIC         "VICEDIR1"
+#define CACHE_MAGIC_LEN     8
+
+/* Don't add entries beyond this.  */
+#define CACHE_MAX_ENTRIES   50000
+
+/* Sizes of the encoded fields.  */
+#define CACHE_NAME_SIZE     (IMAGE_CONTENTS_NAME_T64_LEN + 1)
+#define CACHE_ID_SIZE       (IMAGE_CONTENTS_ID_LEN + 1)
+#define CACHE_FNAME_SIZE    (IMAGE_CONTENTS_FILE_NAME_LEN + 1)
+#define CACHE_TYPE_SIZE     (IMAGE_CONTENTS_TYPE_LEN + 1)
+#define CACHE_HEADER_SIZE   (1 + CACHE_NAME_SIZE + CACHE_ID_SIZE + 4 + 4 + 4)
+#define CACHE_FILE_SIZE     (CACHE_FNAME_SIZE + CACHE_TYPE_SIZE + 4)
+
+typedef struct cache_entry_s {
+    char *path;
+    int64_t mtime;
+    uint64_t size;
+    uint8_t *data;      /* encoded listing, starting at the valid flag */
+    size_t data_len;
+    struct cache_entry_s *next;
+} cache_entry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int cache_loaded = 0;
+static cache_entry_t **buckets = NULL;
+static unsigned int bucket_mask = 0;
+static unsigned int num_entries = 0;
+
+/* records in the file that were replaced by later ones */
+static unsigned int num_stale = 0;
+
+static log_t cache_log = LOG_DEFAULT;
+
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+    int i;
+
+    for (i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static uint64_t get_le(const uint8_t *p, int bytes)
+{
+    uint64_t value = 0;
+    int i;
+
+    for (i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static unsigned int hash_path(const char *path)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*path != '\0') {
+        hash = (hash ^ (uint8_t)*path++) * 16777619u;
+    }
+    return hash;
+}
+
+static cache_entry_t *cache_find(const char *path)
+{
+    cache_entry_t *entry;
+
+    if (buckets == NULL) {
+        return NULL;
+    }
+    for (entry = buckets[hash_path(path) & bucket_mask]; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_grow(void)
+{
+    cache_entry_t **old = buckets;
+    unsigned int old_count = buckets == NULL ? 0 : bucket_mask + 1;
+    unsigned int i;
+
+    bucket_mask = old_count == 0 ? 255 : old_count * 2 - 1;
+    buckets = lib_calloc(bucket_mask + 1, sizeof(cache_entry_t *));
+
+    for (i = 0; i < old_count; i++) {
+        cache_entry_t *entry = old[i];
+
+        while (entry != NULL) {
+            cache_entry_t *next = entry->next;
+            unsigned int b = hash_path(entry->path) & bucket_mask;
+
+            entry->next = buckets[b];
+            buckets[b] = entry;
+            entry = next;
+        }
+    }
+    lib_free(old);
+}
+
+/* Add or replace the entry of `path', takes over `data'.  Returns NULL when
+   the cache is full.  */
+static cache_entry_t *cache_set(const char *path, int64_t mtime, uint64_t size,
+                                uint8_t *data, size_t data_len)
+{
+    cache_entry_t *entry = cache_find(path);
+
+    if (entry != NULL) {
+        lib_free(entry->data);
+        num_stale++;
+    } else {
+        unsigned int b;
+
+        if (num_entries >= CACHE_MAX_ENTRIES) {
+            lib_free(data);
+            return NULL;
+        }
+        if (buckets == NULL || num_entries > bucket_mask) {
+            cache_grow();
+        }
+        entry = lib_malloc(sizeof(cache_entry_t));
+        entry->path = lib_strdup(path);
+        b = hash_path(path) & bucket_mask;
+        entry->next = buckets[b];
+        buckets[b] = entry;
+        num_entries++;
+    }
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->data = data;
+    entry->data_len = data_len;
+    return entry;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Encode `contents' (NULL for an image that could not be read).  */
+static uint8_t *encode_contents(const image_contents_t *contents, size_t *len)
+{
+    const image_contents_file_list_t *file;
+    unsigned int num_files = 0;
+    uint8_t *data, *p;
+
+    if (contents == NULL) {
+        data = lib_malloc(1);
+        data[0] = 0;
+        *len = 1;
+        return data;
+    }
+
+    for (file = contents->file_list; file != NULL; file = file->next) {
+        num_files++;
+    }
+    *len = CACHE_HEADER_SIZE + num_files * CACHE_FILE_SIZE;
+    data = lib_malloc(*len);
+
+    p = data;
+    *p++ = 1;
+    memcpy(p, contents->name, CACHE_NAME_SIZE);
+    p += CACHE_NAME_SIZE;
+    memcpy(p, contents->id, CACHE_ID_SIZE);
+    p += CACHE_ID_SIZE;
+    put_le(p, (uint32_t)contents->blocks_free, 4);
+    put_le(p + 4, (uint32_t)contents->partition, 4);
+    put_le(p + 8, num_files, 4);
+    p += 12;
+    for (file = contents->file_list; file != NULL; file = file->next) {
+        memcpy(p, file->name, CACHE_FNAME_SIZE);
+        p += CACHE_FNAME_SIZE;
+        memcpy(p, file->type, CACHE_TYPE_SIZE);
+        p += CACHE_TYPE_SIZE;
+        put_le(p, file->size, 4);
+        p += 4;
+    }
+    return data;
+}
+
+/* Check the encoded listing of a record read from the file.  */
+static int check_contents(const uint8_t *data, size_t len)
+{
+    if (len == 1 && data[0] == 0) {
+        return 0;
+    }
+    if (len < CACHE_HEADER_SIZE || data[0] != 1) {
+        return -1;
+    }
+    if (len != CACHE_HEADER_SIZE
+               + get_le(data + CACHE_HEADER_SIZE - 4, 4) * CACHE_FILE_SIZE) {
+        return -1;
+    }
+    return 0;
+}
+
+static image_contents_t *decode_contents(const uint8_t *data)
+{
+    image_contents_t *contents;
+    image_contents_file_list_t *file, *last = NULL;
+    unsigned int num_files, i;
+    const uint8_t *p;
+
+    if (data[0] == 0) {
+        return NULL;
+    }
+
+    contents = image_contents_new();
+    p = data + 1;
+    memcpy(contents->name, p, CACHE_NAME_SIZE);
+    contents->name[CACHE_NAME_SIZE - 1] = 0;
+    p += CACHE_NAME_SIZE;
+    memcpy(contents->id, p, CACHE_ID_SIZE);
+    contents->id[CACHE_ID_SIZE - 1] = 0;
+    p += CACHE_ID_SIZE;
+    contents->blocks_free = (int)(int32_t)get_le(p, 4);
+    contents->partition = (int)(int32_t)get_le(p + 4, 4);
+    num_files = (unsigned int)get_le(p + 8, 4);
+    p += 12;
+
+    for (i = 0; i < num_files; i++) {
+        file = lib_malloc(sizeof(image_contents_file_list_t));
+        memcpy(file->name, p, CACHE_FNAME_SIZE);
+        file->name[CACHE_FNAME_SIZE - 1] = 0;
+        p += CACHE_FNAME_SIZE;
+        memcpy(file->type, p, CACHE_TYPE_SIZE);
+        file->type[CACHE_TYPE_SIZE - 1] = 0;
+        p += CACHE_TYPE_SIZE;
+        file->size = (unsigned int)get_le(p, 4);
+        p += 4;
+
+        file->prev = last;
+        file->next = NULL;
+        if (last == NULL) {
+            contents->file_list = file;
+        } else {
+            last->next = file;
+        }
+        last = file;
+    }
+    return contents;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+static char *cache_file_path(void)
+{
+    return util_join_paths(archdep_user_cache_path(), CACHE_FILE_NAME, NULL);
+}
+
+static int write_record(FILE *fd, const cache_entry_t *entry)
+{
+    size_t path_len = strlen(entry->path);
+    uint8_t head[4 + 2];
+    uint8_t stamp[16];
+
+    put_le(head, 2 + path_len + 16 + entry->data_len, 4);
+    put_le(head + 4, path_len, 2);
+    put_le(stamp, (uint64_t)entry->mtime, 8);
+    put_le(stamp + 8, entry->size, 8);
+
+    if (fwrite(head, 1, sizeof(head), fd) != sizeof(head)
+        || fwrite(entry->path, 1, path_len, fd) != path_len
+        || fwrite(stamp, 1, sizeof(stamp), fd) != sizeof(stamp)
+        || fwrite(entry->data, 1, entry->data_len, fd) != entry->data_len) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Write the file anew from the entries in memory.  */
+static void cache_rewrite(void)
+{
+    char *path = cache_file_path();
+    char *tmp_path = util_concat(path, ".tmp", NULL);
+    FILE *fd;
+    unsigned int i;
+    int err = 0;
+
+    fd = fopen(tmp_path, MODE_WRITE);
+    if (fd == NULL) {
+        lib_free(tmp_path);
+        lib_free(path);
+        return;
+    }
+    err = fwrite(CACHE_MAGIC, 1, CACHE_MAGIC_LEN, fd) != CACHE_MAGIC_LEN;
+    for (i = 0; buckets != NULL && i <= bucket_mask && !err; i++) {
+        cache_entry_t *entry;
+
+        for (entry = buckets[i]; entry != NULL && !err; entry = entry->next) {
+            err = write_record(fd, entry);
+        }
+    }
+    if (fclose(fd) != 0) {
+        err = 1;
+    }
+    if (err || archdep_rename(tmp_path, path) < 0) {
+        log_error(cache_log, "Cannot write `%s'.", path);
+        archdep_remove(tmp_path);
+    } else {
+        num_stale = 0;
+    }
+    lib_free(tmp_path);
+    lib_free(path);
+}
+
+static void cache_append(const cache_entry_t *entry)
+{
+    char *path = cache_file_path();
+    FILE *fd;
+
+    fd = fopen(path, MODE_APPEND);
+    if (fd != NULL) {
+        if (write_record(fd, entry) < 0) {
+            log_error(cache_log, "Cannot write `%s'.", path);
+        }
+        fclose(fd);
+    }
+    lib_free(path);
+}
+
+/* Read the whole file, returns NULL if there is none.  */
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *fd;
+    uint8_t *buf = NULL;
+    size_t size = 0;
+    size_t n;
+
+    fd = fopen(path, MODE_READ);
+    if (fd == NULL) {
+        return NULL;
+    }
+    *len = 0;
+    do {
+        if (*len == size) {
+            size = size == 0 ? 0x10000 : size * 2;
+            buf = lib_realloc(buf, size);
+        }
+        n = fread(buf + *len, 1, size - *len, fd);
+        *len += n;
+    } while (n > 0);
+    fclose(fd);
+    return buf;
+}
+
+static void cache_load(void)
+{
+    char *path;
+    uint8_t *buf;
+    size_t len = 0;
+    size_t pos;
+    int complete = 0;
+
+    cache_loaded = 1;
+    cache_log = log_open("ImageContentsCache");
+
+    path = cache_file_path();
+    buf = read_file(path, &len);
+    if (buf != NULL
+        && len >= CACHE_MAGIC_LEN
+        && memcmp(buf, CACHE_MAGIC, CACHE_MAGIC_LEN) == 0) {
+        pos = CACHE_MAGIC_LEN;
+        while (len - pos >= 4 + 2 + 16) {
+            size_t rec_len = (size_t)get_le(buf + pos, 4);
+            size_t path_len = (size_t)get_le(buf + pos + 4, 2);
+            const uint8_t *rec = buf + pos + 4;
+            char *entry_path;
+            uint8_t *data;
+            size_t data_len;
+
+            if (rec_len > len - pos - 4 || rec_len < 2 + path_len + 16 + 1) {
+                break;
+            }
+            data_len = rec_len - 2 - path_len - 16;
+            if (check_contents(rec + 2 + path_len + 16, data_len) < 0) {
+                break;
+            }
+            entry_path = lib_malloc(path_len + 1);
+            memcpy(entry_path, rec + 2, path_len);
+            entry_path[path_len] = '\0';
+            data = lib_malloc(data_len);
+            memcpy(data, rec + 2 + path_len + 16, data_len);
+            cache_set(entry_path,
+                      (int64_t)get_le(rec + 2 + path_len, 8),
+                      get_le(rec + 2 + path_len + 8, 8),
+                      data, data_len);
+            lib_free(entry_path);
+            pos += 4 + rec_len;
+        }
+        complete = (pos == len);
+    }
+    lib_free(buf);
+    lib_free(path);
+
+    /* start a new file when there is none, when it is damaged or when it
+       holds mostly replaced records */
+    if (!complete || (num_stale > 1024 && num_stale > num_entries)) {
+        cache_rewrite();
+    }
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Read the directory listing of an image through the cache
+ *
+ * Returns the cached listing of \a path when the image did not change
+ * since it was read, otherwise reads it with \a func and caches the result.
+ * The cache doesn't know about \a func, so the same function (or functions
+ * giving the same result) must be used for an image every time.
+ *
+ * \param[in]   path    path to image file
+ * \param[in]   func    function to read the listing
+ *
+ * \return  image contents or `NULL` on failure, free with
+ *          image_contents_destroy()
+ */
+image_contents_t *image_contents_read_cached(const char *path,
+                                             read_contents_func_type func)
+{
+    image_contents_t *contents;
+    cache_entry_t *entry;
+    size_t size;
+    time_t mtime;
+    uint8_t *data;
+    size_t data_len;
+
+    if (archdep_stat_mtime(path, &size, &mtime) < 0) {
+        return func(path);
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    if (!cache_loaded) {
+        cache_load();
+    }
+    entry = cache_find(path);
+    if (entry != NULL && entry->mtime == (int64_t)mtime && entry->size == (uint64_t)size) {
+        contents = decode_contents(entry->data);
+        pthread_mutex_unlock(&cache_lock);
+        return contents;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    contents = func(path);
+    data = encode_contents(contents, &data_len);
+
+    pthread_mutex_lock(&cache_lock);
+    entry = cache_set(path, (int64_t)mtime, (uint64_t)size, data, data_len);
+    if (entry != NULL) {
+        cache_append(entry);
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return contents;
+}
+
+/** \brief  Free the memory used by the cache
+ */
+void image_contents_cache_shutdown(void)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&cache_lock);
+    for (i = 0; buckets != NULL && i <= bucket_mask; i++) {
+        cache_entry_t *entry = buckets[i];
+
+        while (entry != NULL) {
+            cache_entry_t *next = entry->next;
+
+            lib_free(entry->path);
+            lib_free(entry->data);
+            lib_free(entry);
+            entry = next;
+        }
+    }
+    lib_free(buckets);
+    buckets = NULL;
+    bucket_mask = 0;
+    num_entries = 0;
+    num_stale = 0;
+    cache_loaded = 0;
+    pthread_mutex_unlock(&cache_lock);
+}
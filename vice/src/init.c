@@ -29,16 +29,22 @@
 
 #include "archdep.h"
 #include "attach.h"
+#include "benchmark.h"
 #include "cmdline.h"
 #include "console.h"
 #include "debug.h"
 #include "drive.h"
+#include "fastpoweron.h"
+#include "forkserver.h"
+#include "frametrace.h"
+#include "fuzz.h"
 #include "initcmdline.h"
 #include "keyboard.h"
 #include "log.h"
 #include "machine-bus.h"
 #include "machine-video.h"
 #include "machine.h"
+#include "metrics.h"
 #include "maincpu.h"
 #include "monitor.h"
 #ifdef HAVE_NETWORK
@@ -48,10 +54,13 @@
 #include "palette.h"
 #include "ram.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
 #include "screenshot.h"
 #include "signals.h"
+#include "snapshot.h"
 #include "sysfile.h"
+#include "testrunner.h"
 #include "uiapi.h"
 #include "vdrive.h"
 #include "video.h"
@@ -75,6 +84,57 @@ int init_main_is_done(void)
     return init_done;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Startup profiling: main() marks the end of each init phase, and the time
+   each phase took is logged when the first frame is done. */
+
+#define INIT_PROFILE_PHASES_MAX 32
+
+static tick_t init_profile_start_tick;
+static int init_profile_running = 0;
+static int init_profile_count = 0;
+static const char *init_profile_name[INIT_PROFILE_PHASES_MAX];
+static tick_t init_profile_tick[INIT_PROFILE_PHASES_MAX];
+
+void init_profile_start(void)
+{
+    init_profile_start_tick = tick_now();
+    init_profile_count = 0;
+    init_profile_running = 1;
+}
+
+void init_profile_phase(const char *name)
+{
+    if (!init_profile_running || init_profile_count >= INIT_PROFILE_PHASES_MAX) {
+        return;
+    }
+    init_profile_name[init_profile_count] = name;
+    init_profile_tick[init_profile_count] = tick_now();
+    init_profile_count++;
+}
+
+void init_profile_first_frame(void)
+{
+    tick_t last;
+    int i;
+
+    if (!init_profile_running) {
+        return;
+    }
+    init_profile_phase("first frame");
+    init_profile_running = 0;
+
+    last = init_profile_start_tick;
+    for (i = 0; i < init_profile_count; i++) {
+        log_verbose(LOG_DEFAULT, "Startup: %-24s %8.1f ms", init_profile_name[i],
+                    (double)(tick_t)(init_profile_tick[i] - last) * 1000.0 / tick_per_second());
+        last = init_profile_tick[i];
+    }
+    log_message(LOG_DEFAULT, "Startup: first frame after %.1f ms.",
+                (double)(tick_t)(last - init_profile_start_tick) * 1000.0 / tick_per_second());
+}
+
 void init_resource_fail(const char *module)
 {
     archdep_startup_log_error("Cannot initialize %s resources.\n",
@@ -120,6 +180,18 @@ int init_resources(void)
         init_resource_fail("vsync");
         return -1;
     }
+    if (rewind_resources_init() < 0) {
+        init_resource_fail("rewind");
+        return -1;
+    }
+    if (fastpoweron_resources_init() < 0) {
+        init_resource_fail("fast power-on");
+        return -1;
+    }
+    if (snapshot_resources_init() < 0) {
+        init_resource_fail("snapshot");
+        return -1;
+    }
     if (sound_resources_init() < 0) {
         init_resource_fail("sound");
         return -1;
@@ -144,6 +216,14 @@ int init_resources(void)
         init_resource_fail("monitor");
         return -1;
     }
+    if (metrics_resources_init() < 0) {
+        init_resource_fail("metrics");
+        return -1;
+    }
+    if (frametrace_resources_init() < 0) {
+        init_resource_fail("frame trace");
+        return -1;
+    }
 #ifdef HAVE_NETWORK
     if (monitor_network_resources_init() < 0) {
         init_resource_fail("MONITOR_NETWORK");
@@ -205,6 +285,42 @@ int init_cmdline_options(void)
         init_cmdline_options_fail("vsync");
         return -1;
     }
+    if (rewind_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("rewind");
+        return -1;
+    }
+    if (fastpoweron_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("fast power-on");
+        return -1;
+    }
+    if (testrunner_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("test runner");
+        return -1;
+    }
+    if (forkserver_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("fork server");
+        return -1;
+    }
+    if (fuzz_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("fuzz");
+        return -1;
+    }
+    if (benchmark_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("benchmark");
+        return -1;
+    }
+    if (metrics_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("metrics");
+        return -1;
+    }
+    if (frametrace_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("frame trace");
+        return -1;
+    }
+    if (snapshot_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("snapshot");
+        return -1;
+    }
     if (sound_cmdline_options_init() < 0) {
         init_cmdline_options_fail("sound");
         return -1;
@@ -295,12 +411,15 @@ int init_main(void)
 
     machine_bus_init();
     machine_maincpu_init();
+    log_set_clock(&maincpu_clk);
+    init_profile_phase("machine early init");
 
     /* Machine-specific initialization.  */
     if (machine_init() < 0) {
         log_error(LOG_DEFAULT, "Machine initialization failed.");
         return -1;
     }
+    init_profile_phase("machine init");
 
     /* FIXME: what's about uimon_init??? */
     /* the monitor console MUST be available, because of for example cpujam,
@@ -35,4 +35,8 @@ int init_main_is_done(void);
 void init_resource_fail(const char *module);
 void init_cmdline_options_fail(const char *module);
 
+void init_profile_start(void);
+void init_profile_phase(const char *name);
+void init_profile_first_frame(void);
+
 #endif
@@ -37,11 +37,15 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "benchmark.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "console.h"
 #include "drive.h"
 #include "fliplist.h"
+#include "forkserver.h"
+#include "frametrace.h"
+#include "fuzz.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
 #include "initcmdline.h"
@@ -51,16 +55,19 @@
 #include "log.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "metrics.h"
 #include "monitor.h"
 #include "monitor_binary.h"
 #include "monitor_network.h"
 #include "network.h"
 #include "printer.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
 #include "sysfile.h"
 #include "tape.h"
 #include "tapeport.h"
+#include "testrunner.h"
 #include "traps.h"
 #include "uiapi.h"
 #include "util.h"
@@ -211,6 +218,11 @@ static int cmdline_help(const char *param, void *extra_param)
     machine_common_resources_shutdown();
 
     vsync_shutdown();
+    rewind_shutdown();
+    testrunner_shutdown();
+    forkserver_shutdown();
+    fuzz_shutdown();
+    benchmark_shutdown();
 
     sysfile_resources_shutdown();
 #if 0
@@ -227,6 +239,8 @@ static int cmdline_help(const char *param, void *extra_param)
     monitor_network_resources_shutdown();
     monitor_binary_resources_shutdown();
 #endif
+    metrics_shutdown();
+    frametrace_shutdown();
     monitor_resources_shutdown();
 
     archdep_shutdown();
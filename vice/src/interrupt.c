@@ -46,26 +46,22 @@ void interrupt_cpu_status_init(interrupt_cpu_status_t *cs,
                                unsigned int *last_opcode_info_ptr)
 {
     cs->num_ints = 0;
-    cs->pending_int = NULL;
+    cs->irq_lines = 0;
+    cs->nmi_lines = 0;
     cs->int_name = NULL;
     cs->last_opcode_info_ptr = last_opcode_info_ptr;
 }
 
 void interrupt_cpu_status_reset(interrupt_cpu_status_t *cs)
 {
-    unsigned int num_ints, *pending_int, *last_opcode_info_ptr;
+    unsigned int num_ints, *last_opcode_info_ptr;
     char **int_name;
 
     num_ints = cs->num_ints;
-    pending_int = cs->pending_int;
     int_name = cs->int_name;
     last_opcode_info_ptr = cs->last_opcode_info_ptr;
-    if (num_ints > 0) {
-        memset(pending_int, 0, num_ints * sizeof(*(cs->pending_int)));
-    }
     memset(cs, 0, sizeof(interrupt_cpu_status_t));
     cs->num_ints = num_ints;
-    cs->pending_int = pending_int;
     cs->int_name = int_name;
     cs->last_opcode_info_ptr = last_opcode_info_ptr;
 
@@ -83,10 +79,14 @@ void interrupt_cpu_status_reset(interrupt_cpu_status_t *cs)
 unsigned int interrupt_cpu_status_int_new(interrupt_cpu_status_t *cs,
                                           const char *name)
 {
-    cs->num_ints += 1;
+    if (cs->num_ints >= INTERRUPT_MAX_SOURCES) {
+        /* the returned number is ignored by interrupt_set_irq() and
+           interrupt_set_nmi() */
+        log_error(LOG_DEFAULT, "Too many interrupt sources, `%s' is not connected.", name);
+        return cs->num_ints;
+    }
 
-    cs->pending_int = lib_realloc(cs->pending_int, cs->num_ints * sizeof(*(cs->pending_int)));
-    cs->pending_int[cs->num_ints - 1] = 0;
+    cs->num_ints += 1;
 
     cs->int_name = lib_realloc(cs->int_name, cs->num_ints * sizeof(char *));
     cs->int_name[cs->num_ints - 1] = lib_strdup(name);
@@ -109,7 +109,6 @@ void interrupt_cpu_status_destroy(interrupt_cpu_status_t *cs)
         }
 
         lib_free(cs->int_name);
-        lib_free(cs->pending_int);
 
         lib_free(cs->trap_func);
         lib_free(cs->trap_data);
@@ -170,14 +169,16 @@ void interrupt_cpu_status_time_warp(interrupt_cpu_status_t *cs,
     }
 }
 
-void interrupt_log_wrong_nirq(void)
+/* Number of sources with their line active, as in the snapshots.  */
+static int count_lines(uint64_t lines)
 {
-    log_error(LOG_DEFAULT, "interrupt_set_irq(): wrong nirq!");
-}
+    int n = 0;
 
-void interrupt_log_wrong_nnmi(void)
-{
-    log_error(LOG_DEFAULT, "interrupt_set_nmi(): wrong nnmi!");
+    while (lines) {
+        lines &= lines - 1;
+        n++;
+    }
+    return n;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -190,30 +191,42 @@ void interrupt_log_wrong_nnmi(void)
 
 void interrupt_restore_irq(interrupt_cpu_status_t *cs, int int_num, int value)
 {
+    if ((unsigned int)int_num >= cs->num_ints) {
+        return;
+    }
     if (value) {
-        cs->pending_int[int_num] |= IK_IRQ;
+        cs->irq_lines |= (uint64_t)1 << int_num;
     } else {
-        cs->pending_int[int_num] &= ~IK_IRQ;
+        cs->irq_lines &= ~((uint64_t)1 << int_num);
     }
 }
 
 void interrupt_restore_nmi(interrupt_cpu_status_t *cs, int int_num, int value)
 {
+    if ((unsigned int)int_num >= cs->num_ints) {
+        return;
+    }
     if (value) {
-        cs->pending_int[int_num] |= IK_NMI;
+        cs->nmi_lines |= (uint64_t)1 << int_num;
     } else {
-        cs->pending_int[int_num] &= ~IK_NMI;
+        cs->nmi_lines &= ~((uint64_t)1 << int_num);
     }
 }
 
 int interrupt_get_irq(interrupt_cpu_status_t *cs, int int_num)
 {
-    return cs->pending_int[int_num] & IK_IRQ;
+    if ((unsigned int)int_num >= cs->num_ints) {
+        return 0;
+    }
+    return (cs->irq_lines & ((uint64_t)1 << int_num)) ? IK_IRQ : 0;
 }
 
 int interrupt_get_nmi(interrupt_cpu_status_t *cs, int int_num)
 {
-    return cs->pending_int[int_num] & IK_NMI;
+    if ((unsigned int)int_num >= cs->num_ints) {
+        return 0;
+    }
+    return (cs->nmi_lines & ((uint64_t)1 << int_num)) ? IK_NMI : 0;
 }
 
 void interrupt_fixup_int_clk(interrupt_cpu_status_t *cs, CLOCK cpu_clk,
@@ -399,8 +412,8 @@ int interrupt_write_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 int interrupt_write_new_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 {
     if (0
-        || SMW_DW(m, cs->nirq) < 0
-        || SMW_DW(m, cs->nnmi) < 0
+        || SMW_DW(m, (uint32_t)count_lines(cs->irq_lines)) < 0
+        || SMW_DW(m, (uint32_t)count_lines(cs->nmi_lines)) < 0
         || SMW_DW(m, cs->global_pending_int) < 0) {
         return -1;
     }
@@ -421,15 +434,13 @@ int interrupt_write_sc_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m
 
 int interrupt_read_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 {
-    unsigned int i;
     CLOCK qw;
 
-    for (i = 0; i < cs->num_ints; i++) {
-        cs->pending_int[i] = IK_NONE;
-    }
+    cs->irq_lines = 0;
+    cs->nmi_lines = 0;
 
     cs->global_pending_int = IK_NONE;
-    cs->nirq = cs->nnmi = cs->reset = cs->trap = 0;
+    cs->reset = cs->trap = 0;
 
     if (0
         || SMR_CLOCK(m, &cs->irq_clk) < 0
@@ -453,9 +464,12 @@ int interrupt_read_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 
 int interrupt_read_new_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 {
+    int nirq, nnmi;
+
+    /* the numbers of active lines follow from the lines the chips restore */
     if (0
-        || SMR_DW_INT(m, &cs->nirq) < 0
-        || SMR_DW_INT(m, &cs->nnmi) < 0
+        || SMR_DW_INT(m, &nirq) < 0
+        || SMR_DW_INT(m, &nnmi) < 0
         || SMR_DW_UINT(m, &cs->global_pending_int) < 0) {
         return -1;
     }
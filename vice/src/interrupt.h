@@ -33,6 +33,7 @@
 
 #include "debug.h"
 #include "log.h"
+#include "maincpustate.h"
 #include "types.h"
 
 /* Define the number of cycles needed by the CPU to detect the NMI or IRQ.  */
@@ -40,6 +41,9 @@
 
 #define INTRRUPT_MAX_DMA_PER_OPCODE (7 + 10000)
 
+/* Most interrupt sources per CPU, one bit each in the line masks.  */
+#define INTERRUPT_MAX_SOURCES 64
+
 /* These are the available types of interrupt lines.  */
 enum cpu_int {
     IK_NONE    = 0,
@@ -56,22 +60,17 @@ struct interrupt_cpu_status_s {
     /* Number of interrupt lines.  */
     unsigned int num_ints;
 
-    /* Define, for each interrupt source, whether it has a pending interrupt
-       (IK_IRQ, IK_NMI, IK_RESET and IK_TRAP) or not (IK_NONE).  */
-    unsigned int *pending_int;
+    /* One bit for every interrupt source, set while the source holds its
+       IRQ or NMI line active.  */
+    uint64_t irq_lines;
+    uint64_t nmi_lines;
 
     /* Name for each interrupt source */
     char **int_name;
 
-    /* Number of active IRQ lines.  */
-    int nirq;
-
     /* Tick when the IRQ was triggered.  */
     CLOCK irq_clk;
 
-    /* Number of active NMI lines.  */
-    int nnmi;
-
     /* Tick when the NMI was triggered.  */
     CLOCK nmi_clk;
 
@@ -130,9 +129,6 @@ typedef struct interrupt_cpu_status_s interrupt_cpu_status_t;
 
 /* ------------------------------------------------------------------------- */
 
-void interrupt_log_wrong_nirq(void);
-void interrupt_log_wrong_nnmi(void);
-
 void interrupt_trigger_dma(interrupt_cpu_status_t *cs, CLOCK cpu_clk);
 void interrupt_ack_dma(interrupt_cpu_status_t *cs);
 void interrupt_fixup_int_clk(interrupt_cpu_status_t *cs, CLOCK cpu_clk, CLOCK *int_clk);
@@ -142,19 +138,20 @@ inline static void interrupt_set_irq(interrupt_cpu_status_t *cs,
                                      unsigned int int_num,
                                      int value, CLOCK cpu_clk)
 {
+    uint64_t line;
+
     if ((cs == NULL) || (int_num >= cs->num_ints)) {
         return;
     }
+    line = (uint64_t)1 << int_num;
 
     if (value) {                /* Trigger the IRQ.  */
-        if (!(cs->pending_int[int_num] & IK_IRQ)) {
-            cs->pending_int[int_num] |= (unsigned int)IK_IRQ;
-
+        if (!(cs->irq_lines & line)) {
             /*
              * Only when the first IRQ source becomes active, the CPU sees the
              * IRQ input line go active; on additional ones, no change is visible.
              */
-            if (cs->nirq == 0) {
+            if (cs->irq_lines == 0) {
                 cs->global_pending_int |= (unsigned int)(IK_IRQ | IK_IRQPEND);
 
                 cs->irq_pending_clk = CLOCK_MAX;
@@ -176,20 +173,15 @@ inline static void interrupt_set_irq(interrupt_cpu_status_t *cs,
                     interrupt_fixup_int_clk(cs, cpu_clk, &(cs->irq_clk));
                 }
             }
-            cs->nirq++;
+            cs->irq_lines |= line;
         }
     } else {                    /* Remove the IRQ condition.  */
-        if (cs->pending_int[int_num] & IK_IRQ) {
-            if (cs->nirq > 0) {
-                cs->pending_int[int_num] =
-                    (cs->pending_int[int_num] & (unsigned int)~IK_IRQ);
-                if ((--cs->nirq) == 0) {
-                    cs->global_pending_int =
-                        (cs->global_pending_int & (unsigned int)~IK_IRQ);
-                    cs->irq_pending_clk = cpu_clk + 3;
-                }
-            } else {
-                interrupt_log_wrong_nirq();
+        if (cs->irq_lines & line) {
+            cs->irq_lines &= ~line;
+            if (cs->irq_lines == 0) {
+                cs->global_pending_int =
+                    (cs->global_pending_int & (unsigned int)~IK_IRQ);
+                cs->irq_pending_clk = cpu_clk + 3;
             }
         }
     }
@@ -200,13 +192,16 @@ inline static void interrupt_set_nmi(interrupt_cpu_status_t *cs,
                                      unsigned int int_num,
                                      int value, CLOCK cpu_clk)
 {
+    uint64_t line;
+
     if (cs == NULL || int_num >= cs->num_ints) {
         return;
     }
+    line = (uint64_t)1 << int_num;
 
     if (value) {                /* Trigger the NMI.  */
-        if (!(cs->pending_int[int_num] & IK_NMI)) {
-            if (cs->nnmi == 0 && !(cs->global_pending_int & IK_NMI)) {
+        if (!(cs->nmi_lines & line)) {
+            if (cs->nmi_lines == 0 && !(cs->global_pending_int & IK_NMI)) {
                 cs->global_pending_int = (cs->global_pending_int | IK_NMI);
 
 #ifdef DEBUG
@@ -226,25 +221,18 @@ inline static void interrupt_set_nmi(interrupt_cpu_status_t *cs,
                     interrupt_fixup_int_clk(cs, cpu_clk, &(cs->nmi_clk));
                 }
             }
-            cs->nnmi++;
-            cs->pending_int[int_num] = (cs->pending_int[int_num] | IK_NMI);
+            cs->nmi_lines |= line;
         }
     } else {                    /* Remove the NMI condition.  */
-        if (cs->pending_int[int_num] & IK_NMI) {
-            if (cs->nnmi > 0) {
-                cs->nnmi--;
-                cs->pending_int[int_num] =
-                    (cs->pending_int[int_num] & (unsigned int)~IK_NMI);
+        if (cs->nmi_lines & line) {
+            cs->nmi_lines &= ~line;
 #if 0
-                /* It should not be possible to remove the NMI condition,
-                   only interrupt_ack_nmi() should clear it.  */
-                if (cpu_clk == cs->nmi_clk) {
-                    cs->global_pending_int = (enum cpu_int)(cs->global_pending_int & ~IK_NMI);
-                }
-#endif
-            } else {
-                interrupt_log_wrong_nnmi();
+            /* It should not be possible to remove the NMI condition,
+               only interrupt_ack_nmi() should clear it.  */
+            if (cpu_clk == cs->nmi_clk) {
+                cs->global_pending_int = (enum cpu_int)(cs->global_pending_int & ~IK_NMI);
             }
+#endif
         }
     }
 }
@@ -325,8 +313,6 @@ void interrupt_set_nmi_trap_func(interrupt_cpu_status_t *cs, void (*nmi_trap_fun
 
 /* ------------------------------------------------------------------------- */
 
-extern interrupt_cpu_status_t *maincpu_int_status;
-extern CLOCK maincpu_clk;
 
 /* For convenience...  */
 
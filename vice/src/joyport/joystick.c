@@ -198,6 +198,93 @@ static joystick_driver_t joy_driver = {
 /** \brief  Joystick subsystem log */
 static log_t joy_log = LOG_DEFAULT;
 
+/* With "InputLateLatch" set, host joystick changes are latched right away
+   instead of at a random point of the next frame, and the host devices are
+   also polled when the emulated machine reads a joystick, at most once per
+   JOYSTICK_LATE_POLL_CYCLES, so a read sees the state of the host at that
+   moment rather than at the last poll from vsync.  */
+#define JOYSTICK_LATE_POLL_CYCLES       64
+
+static CLOCK joystick_late_poll_clk = 0;
+static int joystick_late_polling = 0;
+
+/* Latency histogram: emulated cycles from a host change of a joystick to
+   the first read of its port that sees the change, in buckets of 64 cycles
+   (about a raster line).  The last bucket counts everything longer.  */
+#define JOYSTICK_LATENCY_BUCKET_CYCLES  64
+#define JOYSTICK_LATENCY_BUCKETS        640
+
+enum {
+    LATENCY_IDLE,       /* no change waiting to be read */
+    LATENCY_CHANGED,    /* host changed the latch */
+    LATENCY_LATCHED     /* the change is visible to the emulation */
+};
+
+static int joystick_latency_state[JOYPORT_MAX_PORTS];
+static CLOCK joystick_latency_clk[JOYPORT_MAX_PORTS];
+static unsigned long joystick_latency_histogram[JOYSTICK_LATENCY_BUCKETS];
+
+static void joystick_latency_changed(unsigned int port)
+{
+    if (port < JOYPORT_MAX_PORTS
+        && joystick_latency_state[port] == LATENCY_IDLE) {
+        joystick_latency_state[port] = LATENCY_CHANGED;
+        joystick_latency_clk[port] = maincpu_clk;
+    }
+}
+
+static void joystick_latency_read(int port)
+{
+    CLOCK bucket;
+
+    if (joystick_latency_state[port] == LATENCY_LATCHED) {
+        joystick_latency_state[port] = LATENCY_IDLE;
+        bucket = (maincpu_clk - joystick_latency_clk[port]) / JOYSTICK_LATENCY_BUCKET_CYCLES;
+        if (maincpu_clk < joystick_latency_clk[port]
+            || bucket >= JOYSTICK_LATENCY_BUCKETS) {
+            bucket = JOYSTICK_LATENCY_BUCKETS - 1;
+        }
+        joystick_latency_histogram[bucket]++;
+    }
+}
+
+/* Log the histogram: a summary, and each line with -verbose.  */
+static void joystick_latency_log(void)
+{
+    unsigned long total = 0, sum = 0, count;
+    unsigned int i, p50 = 0, p99 = 0, max = 0;
+
+    for (i = 0; i < JOYSTICK_LATENCY_BUCKETS; i++) {
+        total += joystick_latency_histogram[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    count = 0;
+    for (i = 0; i < JOYSTICK_LATENCY_BUCKETS; i++) {
+        if (joystick_latency_histogram[i] == 0) {
+            continue;
+        }
+        if (count < (total + 1) / 2 && count + joystick_latency_histogram[i] >= (total + 1) / 2) {
+            p50 = i;
+        }
+        if (count < total - total / 100 && count + joystick_latency_histogram[i] >= total - total / 100) {
+            p99 = i;
+        }
+        count += joystick_latency_histogram[i];
+        sum += joystick_latency_histogram[i] * i;
+        max = i;
+        log_verbose(joy_log, "Input latency %3u lines: %lu",
+                    i, joystick_latency_histogram[i]);
+    }
+
+    log_message(joy_log,
+                "Input latency of %lu changes in lines: mean %lu, median %u, 99%% %u, max %u%s.",
+                total, sum / total, p50, p99, max,
+                max == JOYSTICK_LATENCY_BUCKETS - 1 ? " or more" : "");
+}
+
 static void joystick_latch_matrix(CLOCK offset)
 {
     uint8_t idx;
@@ -214,6 +301,12 @@ static void joystick_latch_matrix(CLOCK offset)
         memcpy(joystick_value, latch_joystick_value.values, sizeof(joystick_value));
     }
 
+    for (port = 0; port < JOYPORT_MAX_PORTS; port++) {
+        if (joystick_latency_state[port] == LATENCY_CHANGED) {
+            joystick_latency_state[port] = LATENCY_LATCHED;
+        }
+    }
+
     if (joystick_machine_func != NULL) {
         joystick_machine_func();
     }
@@ -304,7 +397,12 @@ static void joystick_process_latch(void)
         network_event_record(EVENT_JOYSTICK_DELAY, (void *)&delay, sizeof(delay));
         network_event_record(EVENT_JOYSTICK_VALUE, (void *)&latch_joystick_value, sizeof(latch_joystick_value));
     } else {
-        alarm_set(joystick_alarm, maincpu_clk + delay);
+        joystick_latency_changed(latch_joystick_value.last_used_joyport);
+        if (keyboard_late_latch_enabled()) {
+            joystick_latch_handler(maincpu_clk, NULL);
+        } else {
+            alarm_set(joystick_alarm, maincpu_clk + delay);
+        }
     }
 }
 
@@ -390,10 +488,35 @@ static int get_joystick_autofire(int index)
     return 1;
 }
 
+/* Get and restore the state of all emulated joystick ports, used to keep the
+   host input when the emulation is rewound to an in-memory snapshot. */
+void joystick_get_state(uint16_t *values)
+{
+    memcpy(values, joystick_value, sizeof(joystick_value));
+}
+
+void joystick_set_state(const uint16_t *values)
+{
+    memcpy(joystick_value, values, sizeof(joystick_value));
+}
+
 uint16_t get_joystick_value(int index)
 {
-    uint16_t retval = joystick_value[index] & 0xffef;
-    int fire_button = JOYPORT_BIT_BOOL(joystick_value[index], JOYPORT_FIRE_BIT);
+    uint16_t retval;
+    int fire_button;
+
+    if (keyboard_late_latch_enabled() && !joystick_late_polling
+        && (maincpu_clk < joystick_late_poll_clk
+            || maincpu_clk - joystick_late_poll_clk >= JOYSTICK_LATE_POLL_CYCLES)) {
+        joystick_late_poll_clk = maincpu_clk;
+        joystick_late_polling = 1;
+        joystick();
+        joystick_late_polling = 0;
+    }
+    joystick_latency_read(index);
+
+    retval = joystick_value[index] & 0xffef;
+    fire_button = JOYPORT_BIT_BOOL(joystick_value[index], JOYPORT_FIRE_BIT);
 
     /* check if autofire is enabled */
     if (joystick_autofire_enable[index]) {
@@ -3317,6 +3440,8 @@ void joystick_close(void)
 {
     int i;
 
+    joystick_latency_log();
+
     for (i = 0; i < num_joystick_devices; i++) {
         joystick_device_t *joydev = joystick_devices[i];
 
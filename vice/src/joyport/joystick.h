@@ -395,6 +395,8 @@ void win32_joystick_init(void);
 
 
 uint16_t get_joystick_value(int index);
+void joystick_get_state(uint16_t *values);
+void joystick_set_state(const uint16_t *values);
 
 typedef void (*joystick_machine_func_t)(void);
 
@@ -45,6 +45,7 @@
 
 #include <stdlib.h> /* abs */
 #include <math.h>   /* fabsf */
+#include <pthread.h>
 
 #include "vice.h"
 
@@ -73,10 +74,25 @@ static log_t mouse_log = LOG_DEFAULT;
 /* Weird trial and error based number here :( larger causes mouse jumps. */
 #define MOUSE_MAX_DIFF 63.0f
 
+/* Number of host mouse movements that can be queued between two polls.  */
+#define MOUSE_QUEUE_SIZE 64
+
 /******************************************************************************/
 
 static tick_t mouse_timestamp = 0;
 
+/* The UI thread queues the movements of the host mouse, each with the time
+   it happened, and mouse_poll() takes them in the emulation thread.  */
+typedef struct mouse_event_s {
+    float dx;
+    float dy;
+    tick_t timestamp;
+} mouse_event_t;
+
+static mouse_event_t mouse_queue[MOUSE_QUEUE_SIZE];
+static unsigned int mouse_queue_num = 0;
+static pthread_mutex_t mouse_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int mouse_sx, mouse_sy;
 
 /******************************************************************************/
@@ -134,11 +150,24 @@ int mouse_get_mouse_sy(void)
 /* this is called by the UI to move the mouse position */
 void mouse_move(float dx, float dy)
 {
+    mouse_event_t *event;
+    tick_t now = tick_now();
+
     /* Capture the relative mouse movement to be processed later in mouse_poll() */
-    mouse_move_x += dx;
-    mouse_move_y -= dy;
-    mouse_timestamp = tick_now();
-    DBG(("mouse_move dx:%f dy:%f x:%f y:%f", dx, dy, mouse_move_x, mouse_move_y));
+    pthread_mutex_lock(&mouse_queue_lock);
+    if (mouse_queue_num == MOUSE_QUEUE_SIZE) {
+        /* not polled for a while, add to the latest one */
+        event = &mouse_queue[MOUSE_QUEUE_SIZE - 1];
+        event->dx += dx;
+        event->dy += dy;
+    } else {
+        event = &mouse_queue[mouse_queue_num++];
+        event->dx = dx;
+        event->dy = dy;
+    }
+    event->timestamp = now;
+    pthread_mutex_unlock(&mouse_queue_lock);
+    DBG(("mouse_move dx:%f dy:%f", dx, dy));
 }
 
 /* used by the individual devices to get the mouse position */
@@ -205,6 +234,21 @@ void mouse_poll(void)
 
     DBG(("mouse_poll"));
 
+    /* Take the movements of the host mouse since the last poll, the time of
+       the last one is that of the reading */
+    pthread_mutex_lock(&mouse_queue_lock);
+    if (mouse_queue_num > 0) {
+        unsigned int i;
+
+        for (i = 0; i < mouse_queue_num; i++) {
+            mouse_move_x += mouse_queue[i].dx;
+            mouse_move_y -= mouse_queue[i].dy;
+        }
+        mouse_timestamp = mouse_queue[mouse_queue_num - 1].timestamp;
+        mouse_queue_num = 0;
+    }
+    pthread_mutex_unlock(&mouse_queue_lock);
+
     /* Ensure the mouse hasn't moved too far since the last poll */
     mouse_move_apply_limit();
 
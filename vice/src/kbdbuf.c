@@ -49,6 +49,7 @@
 #include "mem.h"
 #include "resources.h"
 #include "types.h"
+#include "vsync.h"
 
 #ifdef DEBUG_KBDBUF
 #define DBG(x) log_printf  x
@@ -59,6 +60,10 @@
 /* Maximum number of characters we can queue.  */
 #define QUEUE_SIZE      16384
 
+/* Cycles between looking for an empty kernal buffer with fast paste.  The
+   screen editor takes longer than that for a line of BASIC.  */
+#define KBDBUF_POLL_CYCLES  1000
+
 /* First location of the buffer.  */
 static int buffer_location;
 
@@ -92,6 +97,18 @@ static char *kbd_buf_string = NULL;
 
 static int KbdbufDelay = 0;
 
+/* Refill the kernal's buffer as soon as it is empty, not once a frame.  */
+static int KbdbufFastPaste = 0;
+
+/* Turn on warp mode while pasting more than fits into the kernal's buffer.  */
+static int KbdbufWarp = 0;
+
+static alarm_t *kbdbuf_poll_alarm = NULL;
+static int kbdbuf_poll_pending = 0;
+
+/* Flag if warp mode was turned on for the paste going on.  */
+static int paste_warp = 0;
+
 static int use_kbdbuf_flush_alarm = 0;
 
 static alarm_t *kbdbuf_flush_alarm = NULL;
@@ -113,10 +130,28 @@ static int set_kbdbuf_delay(int val, void *param)
     return 0;
 }
 
+/*! \internal \brief set fast paste mode */
+static int set_kbdbuf_fast_paste(int val, void *param)
+{
+    KbdbufFastPaste = val ? 1 : 0;
+    return 0;
+}
+
+/*! \internal \brief set warp mode while pasting */
+static int set_kbdbuf_warp(int val, void *param)
+{
+    KbdbufWarp = val ? 1 : 0;
+    return 0;
+}
+
 /*! \brief integer resources used by keybuf */
 static const resource_int_t resources_int[] = {
     { "KbdbufDelay", 0, RES_EVENT_NO, (resource_value_t)0,
       &KbdbufDelay, set_kbdbuf_delay, NULL },
+    { "KbdbufFastPaste", 0, RES_EVENT_NO, (resource_value_t)0,
+      &KbdbufFastPaste, set_kbdbuf_fast_paste, NULL },
+    { "KbdbufWarp", 0, RES_EVENT_NO, (resource_value_t)0,
+      &KbdbufWarp, set_kbdbuf_warp, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -210,6 +245,18 @@ static const cmdline_option_t cmdline_options[] =
     { "-keybuf-delay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "KbdbufDelay", NULL,
       "<value>", "Set additional keyboard buffer delay (0: use default)" },
+    { "-keybuf-fast", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufFastPaste", (resource_value_t)1,
+      NULL, "Refill the keyboard buffer as soon as it is empty" },
+    { "+keybuf-fast", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufFastPaste", (resource_value_t)0,
+      NULL, "Refill the keyboard buffer once per frame" },
+    { "-keybuf-warp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufWarp", (resource_value_t)1,
+      NULL, "Enable warp mode while pasting long text" },
+    { "+keybuf-warp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufWarp", (resource_value_t)0,
+      NULL, "Disable warp mode while pasting long text" },
     CMDLINE_LIST_END
 };
 
@@ -241,6 +288,40 @@ int kbdbuf_queue_is_empty(void)
     return num_pending > 0 ? 0 : 1;
 }
 
+/* Look for an empty kernal buffer again in a little while.  */
+static void kbdbuf_poll_schedule(void)
+{
+    if (KbdbufFastPaste && num_pending > 0 && !kbdbuf_poll_pending && kbdbuf_poll_alarm != NULL) {
+        alarm_set(kbdbuf_poll_alarm, maincpu_clk + KBDBUF_POLL_CYCLES);
+        kbdbuf_poll_pending = 1;
+    }
+}
+
+static void kbdbuf_poll_alarm_triggered(CLOCK offset, void *data)
+{
+    alarm_unset(kbdbuf_poll_alarm);
+    kbdbuf_poll_pending = 0;
+
+    kbdbuf_flush();
+    kbdbuf_poll_schedule();
+}
+
+static void paste_warp_start(void)
+{
+    if (KbdbufWarp && !paste_warp && !vsync_get_warp_mode()) {
+        vsync_set_warp_mode(1);
+        paste_warp = 1;
+    }
+}
+
+static void paste_warp_stop(void)
+{
+    if (paste_warp) {
+        vsync_set_warp_mode(0);
+        paste_warp = 0;
+    }
+}
+
 /* Feed `string' into the incoming queue.  */
 static int string_to_queue(const char *string)
 {
@@ -259,7 +340,13 @@ static int string_to_queue(const char *string)
 
     num_pending += num;
 
+    /* more than the kernal's buffer takes, i.e. a paste and not a command */
+    if (num_pending > buffer_size) {
+        paste_warp_start();
+    }
+
     kbdbuf_flush();
+    kbdbuf_poll_schedule();
 
     return 0;
 }
@@ -316,6 +403,7 @@ void kbdbuf_abort(void)
        option (else we cancel just that during the initial reset) */
     if (kbd_buf_cmdline == false) {
         num_pending = 0;
+        paste_warp_stop();
     }
 }
 
@@ -328,6 +416,9 @@ void kbdbuf_init(int location, int plocation, int size, CLOCK mincycles)
         mincycles += KbdbufDelay;
     }
     kbdbuf_flush_alarm = alarm_new(maincpu_alarm_context, "Keybuf", kbdbuf_flush_alarm_triggered, NULL);
+    if (kbdbuf_poll_alarm == NULL) {
+        kbdbuf_poll_alarm = alarm_new(maincpu_alarm_context, "KeybufPoll", kbdbuf_poll_alarm_triggered, NULL);
+    }
     kbdbuf_reset(location, plocation, size, mincycles);
     /* printf("kbdbuf_init cmdline_get_autostart_mode(): %d\n", cmdline_get_autostart_mode()); */
     /* inject string given to -keybuf option on commandline into keyboard buffer,
@@ -405,6 +496,10 @@ void kbdbuf_flush(void)
         removefromqueue();
     }
 
+    if (num_pending == 0) {
+        paste_warp_stop();
+    }
+
     kbd_buf_cmdline = false;
     prevent_recursion = false;
 }
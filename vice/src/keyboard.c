@@ -149,6 +149,13 @@ signed long key_joy_keypad[KBD_JOY_KEYPAD_ROWS][KBD_JOY_KEYPAD_COLS]; /* FIXME *
  */
 static int kbd_statusbar_enabled = 0;
 
+/** \brief  Resource value for InputLateLatch
+ *
+ * Latch host keys (and joysticks) as soon as they arrive instead of at a
+ * random point of the next frame.
+ */
+static int input_late_latch = 0;
+
 typedef struct {
     signed long key;
     int mod;
@@ -221,6 +228,21 @@ static CLOCK kbd_make_event_timestap(CLOCK offset, int num)
     if (offset < maincpu_clk) {
         offset = maincpu_clk;
     }
+
+    if (input_late_latch && !network_connected()) {
+        /* no random delay, but keys stay apart long enough for the keyboard
+           scan of the machine to see each of them */
+        if (num == 0) { num = 1; }
+        if (offset < keyboard_latch_timestamp + (CLOCK)(maxdiff / 2 / num)) {
+            offset = keyboard_latch_timestamp + (CLOCK)(maxdiff / 2 / num);
+        }
+        if (offset > (maincpu_clk + maxdiff)) {
+            offset = maincpu_clk + maxdiff;
+        }
+        keyboard_latch_timestamp = offset;
+        return offset;
+    }
+
     if (offset < keyboard_latch_timestamp) {
         offset = keyboard_latch_timestamp;
     }
@@ -626,30 +648,30 @@ static int keyb_find_in_keyconvtab(int sym, int mod)
     int found = -1;
     int i;
 
-    for (i = 0; i < keyconvmap_num_keys; ++i) {
-        if (sym == keyconvmap[i].sym) {
-            /* skip keys from alternative keyset */
-            if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
-                continue;
-            }
+    /* only the entries for this key, in the order of the keymap */
+    for (i = keyboard_keyconvmap_find_next(sym, -1); i >= 0;
+         i = keyboard_keyconvmap_find_next(sym, i)) {
+        /* skip keys from alternative keyset */
+        if ((keyconvmap[i].shift & ALT_MAP) && !key_alternative) {
+            continue;
+        }
 
-            /* find explicit matches on modifiers pressed on host */
-            if ((keyconvmap[i].shift & MAP_MOD_RIGHT_ALT) && (!(mod & KBD_MOD_RALT)) ) {
-                continue;
-            }
-            if ((keyconvmap[i].shift & MAP_MOD_CTRL) && (!(mod & (KBD_MOD_LCTRL | KBD_MOD_RCTRL))) ) {
-                continue;
-            }
-            if ((keyconvmap[i].shift & MAP_MOD_SHIFT) && (!(mod & (KBD_MOD_LSHIFT | KBD_MOD_RSHIFT))) ) {
-                continue;
-            }
+        /* find explicit matches on modifiers pressed on host */
+        if ((keyconvmap[i].shift & MAP_MOD_RIGHT_ALT) && (!(mod & KBD_MOD_RALT)) ) {
+            continue;
+        }
+        if ((keyconvmap[i].shift & MAP_MOD_CTRL) && (!(mod & (KBD_MOD_LCTRL | KBD_MOD_RCTRL))) ) {
+            continue;
+        }
+        if ((keyconvmap[i].shift & MAP_MOD_SHIFT) && (!(mod & (KBD_MOD_LSHIFT | KBD_MOD_RSHIFT))) ) {
+            continue;
+        }
 
-            found = i;
+        found = i;
 
-            /* if the "allow more than one mapping" flag was not found, stop here */
-            if (!(keyconvmap[i].shift & ALLOW_OTHER)) {
-                break;
-            }
+        /* if the "allow more than one mapping" flag was not found, stop here */
+        if (!(keyconvmap[i].shift & ALLOW_OTHER)) {
+            break;
         }
     }
     return found;
@@ -1190,6 +1212,30 @@ int keyboard_statusbar_enabled(void)
     return kbd_statusbar_enabled;
 }
 
+/** \brief  Resource handler for 'InputLateLatch'
+ *
+ * \param[in]   val     latch host input as soon as it arrives
+ * \param[in]   param   extra data (unused)
+ *
+ * \return 0
+ */
+static int keyboard_set_late_latch(int val, void *param)
+{
+    input_late_latch = val ? 1 : 0;
+    return 0;
+}
+
+/** \brief  Get "InputLateLatch" directly
+ *
+ * Used by the joystick code, which latches host joysticks the same way.
+ *
+ * \return  current value of "InputLateLatch" resource
+ */
+int keyboard_late_latch_enabled(void)
+{
+    return input_late_latch;
+}
+
 /*-----------------------------------------------------------------------*/
 
 static void keyboard_event_record(void)
@@ -1301,6 +1347,8 @@ int keyboard_snapshot_read_module(snapshot_t *s)
 static const resource_int_t resources_int[] = {
     { "KbdStatusbar", 0, RES_EVENT_NO, NULL,
       &kbd_statusbar_enabled, keyboard_set_keyboard_statusbar, NULL },
+    { "InputLateLatch", 0, RES_EVENT_NO, NULL,
+      &input_late_latch, keyboard_set_late_latch, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -1331,6 +1379,14 @@ static cmdline_option_t const cmdline_options[] =
         NULL, NULL, "KbdStatusbar", (resource_value_t)0,
         NULL, "Disable keyboard-status bar" },
 
+    /* latch host keys and joysticks without the random delay */
+    { "-inputlatelatch", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+        NULL, NULL, "InputLateLatch", (resource_value_t)1,
+        NULL, "Latch host keyboard and joystick input as soon as it arrives" },
+    { "+inputlatelatch", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+        NULL, NULL, "InputLateLatch", (resource_value_t)0,
+        NULL, "Latch host keyboard and joystick input after a random delay" },
+
     CMDLINE_LIST_END
 };
 
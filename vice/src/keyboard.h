@@ -148,5 +148,6 @@ extern int keyarr[KBD_ROWS];
 extern int rev_keyarr[KBD_COLS];
 
 int keyboard_statusbar_enabled(void);
+int keyboard_late_latch_enabled(void);
 
 #endif
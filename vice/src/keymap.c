@@ -82,6 +82,18 @@ static int keyc_mem = 0;
 /* Number of convs used in sizeof(keyconv_t).  */
 int keyconvmap_num_keys = 0;
 
+/* Index of keyconvmap by host key, so a key press does not have to go through
+   the whole keymap.  keyconvmap_hash_first[] holds the first entry for every
+   hash value and keyconvmap_hash_next[] the next entry with the same hash, in
+   the order of the keymap.  It is rebuilt on the first lookup after the keymap
+   was changed.  */
+#define KEYCONVMAP_HASH_SIZE    256
+
+static int keyconvmap_hash_first[KEYCONVMAP_HASH_SIZE];
+static int *keyconvmap_hash_next = NULL;
+static int keyconvmap_hash_num = 0;
+static int keyconvmap_hash_valid = 0;
+
 /* flag that indicates if a key with SHIFT_LOCK flag exists in the keymap */
 int keyconvmap_has_caps_lock = 0;
 
@@ -143,12 +155,17 @@ static void keyboard_keyconvmap_alloc(void)
     keyc_mem = KEYCONVMAP_SIZE_MIN - 1;
     keyconvmap[0].sym = ARCHDEP_KEYBOARD_SYM_NONE;
     keyconvmap_has_caps_lock = 0;
+    keyconvmap_hash_valid = 0;
 }
 
 static void keyboard_keyconvmap_free(void)
 {
     lib_free(keyconvmap);
     keyconvmap = NULL;
+    lib_free(keyconvmap_hash_next);
+    keyconvmap_hash_next = NULL;
+    keyconvmap_hash_num = 0;
+    keyconvmap_hash_valid = 0;
 }
 
 static void keyboard_keyconvmap_realloc(void)
@@ -157,6 +174,66 @@ static void keyboard_keyconvmap_realloc(void)
     keyconvmap = lib_realloc(keyconvmap, (keyc_mem + 1) * sizeof(keyboard_conv_t));
 }
 
+static unsigned int keyconvmap_hash(signed long sym)
+{
+    unsigned long h = (unsigned long)sym;
+
+    return (unsigned int)((h ^ (h >> 8) ^ (h >> 16)) & (KEYCONVMAP_HASH_SIZE - 1));
+}
+
+static void keyconvmap_hash_build(void)
+{
+    unsigned int h;
+    int i;
+
+    if (keyconvmap_hash_num < keyconvmap_num_keys) {
+        keyconvmap_hash_num = keyconvmap_num_keys;
+        keyconvmap_hash_next = lib_realloc(keyconvmap_hash_next,
+                                           keyconvmap_hash_num * sizeof(int));
+    }
+
+    for (h = 0; h < KEYCONVMAP_HASH_SIZE; h++) {
+        keyconvmap_hash_first[h] = -1;
+    }
+    /* backwards, so every chain ends up in the order of the keymap */
+    for (i = keyconvmap_num_keys - 1; i >= 0; i--) {
+        h = keyconvmap_hash(keyconvmap[i].sym);
+        keyconvmap_hash_next[i] = keyconvmap_hash_first[h];
+        keyconvmap_hash_first[h] = i;
+    }
+    keyconvmap_hash_valid = 1;
+}
+
+/** \brief  Find the next keymap entry for a host key
+ *
+ * \param[in]   sym     host key
+ * \param[in]   prev    entry returned before, -1 to find the first one
+ *
+ * \return  index in keyconvmap of the next entry for \a sym after \a prev, in
+ *          the order of the keymap, or -1 if there is none
+ */
+int keyboard_keyconvmap_find_next(signed long sym, int prev)
+{
+    int i;
+
+    if (keyconvmap == NULL) {
+        return -1;
+    }
+    if (!keyconvmap_hash_valid) {
+        keyconvmap_hash_build();
+    }
+
+    if (prev < 0) {
+        i = keyconvmap_hash_first[keyconvmap_hash(sym)];
+    } else {
+        i = keyconvmap_hash_next[prev];
+    }
+    while (i >= 0 && keyconvmap[i].sym != sym) {
+        i = keyconvmap_hash_next[i];
+    }
+    return i;
+}
+
 /*-----------------------------------------------------------------------*/
 
 static int keyboard_keyword_rowcol(int *row, int *col)
@@ -277,6 +354,7 @@ static void keyboard_keyword_clear(void)
 
     keyconvmap_num_keys = 0;
     keyconvmap[0].sym = ARCHDEP_KEYBOARD_SYM_NONE;
+    keyconvmap_hash_valid = 0;
 
     key_ctrl_restore1 = -1;
     key_ctrl_restore2 = -1;
@@ -329,6 +407,7 @@ static void keyboard_keysym_undef(signed long sym)
                     keyconvmap[i] = keyconvmap[--keyconvmap_num_keys];
                 }
                 keyconvmap[keyconvmap_num_keys].sym = ARCHDEP_KEYBOARD_SYM_NONE;
+                keyconvmap_hash_valid = 0;
                 break;
             }
         }
@@ -420,6 +499,7 @@ static int keyboard_parse_set_pos_row(signed long sym, int row, int col,
             keyconvmap[keyconvmap_num_keys].column = col;
             keyconvmap[keyconvmap_num_keys].shift = shift;
             keyconvmap[++keyconvmap_num_keys].sym = ARCHDEP_KEYBOARD_SYM_NONE;
+            keyconvmap_hash_valid = 0;
         }
     }
     return 0;
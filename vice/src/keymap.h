@@ -122,6 +122,8 @@ typedef struct keyboard_conv_s keyboard_conv_t;
 
 extern keyboard_conv_t *keyconvmap;
 
+int keyboard_keyconvmap_find_next(signed long sym, int prev);
+
 /*****************************************************************************/
 /* FIXME: all of the following should probably not be simply globals, but
           go into a struct of some sort */
@@ -54,6 +54,11 @@
 # endif
 #endif
 
+#if defined(HAVE_EXECINFO_H) && defined(HAVE_BT_SYMBOLS)
+# define LIB_PROFILE_SYMBOLS
+# include <execinfo.h>
+#endif
+
 #if defined(LIB_DEBUG) || defined(DEBUG)
 static log_t log_lib = LOG_DEFAULT;
 #endif
@@ -614,16 +619,341 @@ static void lib_debug_check(void)
 }
 #endif /* DEBUG */
 
+/*----------------------------------------------------------------------------*/
+/* allocation profiling: while it runs, every Nth allocation is recorded with
+   its call site and the sampled blocks are followed until they are freed.
+   Scaled by N this gives the allocations and the live memory per call site,
+   at a fraction of the cost of LIB_DEBUG, so it can be left running for
+   hours.  The call site is the file and line with LIB_DEBUG_PINPOINT and the
+   calling code address otherwise.  The tables are only touched with the lock
+   held.  */
+
+#ifdef __GNUC__
+#define LIB_PROFILE_CALLER  __builtin_return_address(0)
+#else
+#define LIB_PROFILE_CALLER  NULL
+#endif
+
+/* call sites recorded, a power of two */
+#define LIB_PROFILE_SITES   4096
+
+/* sampled blocks followed at once, a power of two */
+#define LIB_PROFILE_BLOCKS  65536
+
+typedef struct lib_profile_site_s {
+    int used;
+    const char *filename;   /* NULL unless from a _pinpoint wrapper */
+    unsigned int line;
+    const void *caller;
+    uint64_t allocs;        /* sampled allocations */
+    uint64_t bytes;         /* bytes of the sampled allocations */
+    uint64_t live;          /* bytes of the sampled blocks not freed yet */
+    uint64_t peak;          /* highest value of live */
+} lib_profile_site_t;
+
+typedef struct lib_profile_block_s {
+    const void *ptr;        /* NULL if the slot is free */
+    size_t size;
+    unsigned int site;
+} lib_profile_block_t;
+
+static unsigned int lib_profile_interval = 0;   /* 0 when not running */
+static unsigned int lib_profile_scale = 1;      /* interval of the last run */
+static unsigned int lib_profile_countdown = 0;
+static unsigned int lib_profile_blocks_used = 0;
+static lib_profile_site_t *lib_profile_sites = NULL;
+static lib_profile_block_t *lib_profile_blocks = NULL;
+
+#ifdef LIB_DEBUG_PINPOINT
+/* set while a _pinpoint wrapper is allocating */
+static int lib_profile_pinpoint = 0;
+#endif
+
+static unsigned int lib_profile_block_hash(const void *ptr)
+{
+    return (unsigned int)(((uintptr_t)ptr >> 4) * 2654435761u) & (LIB_PROFILE_BLOCKS - 1);
+}
+
+/* Find or add the site of an allocation, LIB_PROFILE_SITES if full.  */
+static unsigned int lib_profile_site(const void *caller)
+{
+    const char *filename = NULL;
+    unsigned int line = 0;
+    unsigned int index, n;
+    lib_profile_site_t *site;
+
+#ifdef LIB_DEBUG_PINPOINT
+    if (lib_profile_pinpoint) {
+        filename = lib_debug_pinpoint_filename;
+        line = lib_debug_pinpoint_line;
+        caller = NULL;
+    }
+#endif
+
+    index = (unsigned int)((((uintptr_t)filename >> 3) ^ ((uintptr_t)caller >> 2)
+                            ^ line) * 2654435761u) & (LIB_PROFILE_SITES - 1);
+    for (n = 0; n < LIB_PROFILE_SITES; n++) {
+        site = &lib_profile_sites[index];
+        if (!site->used) {
+            site->used = 1;
+            site->filename = filename;
+            site->line = line;
+            site->caller = caller;
+            return index;
+        }
+        if (site->filename == filename && site->line == line && site->caller == caller) {
+            return index;
+        }
+        index = (index + 1) & (LIB_PROFILE_SITES - 1);
+    }
+    return LIB_PROFILE_SITES;
+}
+
+static void lib_profile_track(const void *ptr, size_t size, unsigned int index)
+{
+    lib_profile_site_t *site;
+    unsigned int slot;
+
+    /* keep the table sparse, the blocks not followed are simply missing from
+       the live memory */
+    if (ptr == NULL || index == LIB_PROFILE_SITES
+        || lib_profile_blocks_used >= LIB_PROFILE_BLOCKS / 4 * 3) {
+        return;
+    }
+
+    site = &lib_profile_sites[index];
+    site->allocs++;
+    site->bytes += size;
+    site->live += size;
+    if (site->live > site->peak) {
+        site->peak = site->live;
+    }
+
+    slot = lib_profile_block_hash(ptr);
+    while (lib_profile_blocks[slot].ptr != NULL) {
+        slot = (slot + 1) & (LIB_PROFILE_BLOCKS - 1);
+    }
+    lib_profile_blocks[slot].ptr = ptr;
+    lib_profile_blocks[slot].size = size;
+    lib_profile_blocks[slot].site = index;
+    lib_profile_blocks_used++;
+}
+
+/* Stop following a block, return its site or LIB_PROFILE_SITES if it was not
+   sampled.  */
+static unsigned int lib_profile_untrack(const void *ptr)
+{
+    unsigned int slot, next, home, index;
+
+    if (ptr == NULL || lib_profile_blocks_used == 0) {
+        return LIB_PROFILE_SITES;
+    }
+
+    slot = lib_profile_block_hash(ptr);
+    while (lib_profile_blocks[slot].ptr != ptr) {
+        if (lib_profile_blocks[slot].ptr == NULL) {
+            return LIB_PROFILE_SITES;
+        }
+        slot = (slot + 1) & (LIB_PROFILE_BLOCKS - 1);
+    }
+
+    index = lib_profile_blocks[slot].site;
+    lib_profile_sites[index].live -= lib_profile_blocks[slot].size;
+    lib_profile_blocks_used--;
+
+    /* move the following entries of the run back into the gap, so lookups
+       need no deleted markers */
+    next = slot;
+    while (1) {
+        next = (next + 1) & (LIB_PROFILE_BLOCKS - 1);
+        if (lib_profile_blocks[next].ptr == NULL) {
+            break;
+        }
+        home = lib_profile_block_hash(lib_profile_blocks[next].ptr);
+        if (((next - home) & (LIB_PROFILE_BLOCKS - 1))
+            >= ((next - slot) & (LIB_PROFILE_BLOCKS - 1))) {
+            lib_profile_blocks[slot] = lib_profile_blocks[next];
+            slot = next;
+        }
+    }
+    lib_profile_blocks[slot].ptr = NULL;
+
+    return index;
+}
+
+/* Called for every allocation while profiling.  */
+static void lib_profile_alloc(const void *ptr, size_t size, const void *caller)
+{
+    if (--lib_profile_countdown > 0) {
+        return;
+    }
+    lib_profile_countdown = lib_profile_interval;
+    lib_profile_track(ptr, size, lib_profile_site(caller));
+}
+
+/* Called for every reallocation while profiling, in two steps as the old
+   block must not be looked at once realloc() has freed it.  A sampled block
+   that is reallocated stays followed and is charged to the site of the
+   realloc, the others were not sampled when allocated and are not sampled
+   now either.  Returns -1 for a new block, 1 if the old one was sampled.  */
+static int lib_profile_realloc_old(const void *old_ptr)
+{
+    if (old_ptr == NULL) {
+        return -1;
+    }
+    return lib_profile_untrack(old_ptr) != LIB_PROFILE_SITES;
+}
+
+static void lib_profile_realloc_new(int old, const void *ptr, size_t size,
+                                    const void *caller)
+{
+    if (old < 0) {
+        lib_profile_alloc(ptr, size, caller);
+    } else if (old > 0) {
+        lib_profile_track(ptr, size, lib_profile_site(caller));
+    }
+}
+
+/** \brief  Start the allocation profiling
+ *
+ * Previous results are flushed.
+ *
+ * \param[in]   interval    sample every interval'th allocation
+ */
+void lib_profile_start(unsigned int interval)
+{
+    LIB_DEBUG_LOCK();
+
+    if (lib_profile_sites == NULL) {
+        lib_profile_sites = calloc(LIB_PROFILE_SITES, sizeof(lib_profile_site_t));
+        lib_profile_blocks = calloc(LIB_PROFILE_BLOCKS, sizeof(lib_profile_block_t));
+        if (lib_profile_sites == NULL || lib_profile_blocks == NULL) {
+            fprintf(stderr, "error: lib_profile_start failed\n");
+            archdep_vice_exit(-1);
+        }
+    } else {
+        memset(lib_profile_sites, 0, LIB_PROFILE_SITES * sizeof(lib_profile_site_t));
+        memset(lib_profile_blocks, 0, LIB_PROFILE_BLOCKS * sizeof(lib_profile_block_t));
+    }
+    lib_profile_blocks_used = 0;
+
+    if (interval == 0) {
+        interval = 1;
+    }
+    lib_profile_scale = interval;
+    lib_profile_countdown = interval;
+    lib_profile_interval = interval;
+
+    LIB_DEBUG_UNLOCK();
+}
+
+/** \brief  Stop the allocation profiling
+ *
+ * The results are kept as they are.
+ */
+void lib_profile_stop(void)
+{
+    LIB_DEBUG_LOCK();
+    lib_profile_interval = 0;
+    LIB_DEBUG_UNLOCK();
+}
+
+/** \brief  Get the sample interval of the allocation profiling
+ *
+ * \return  interval, 0 if not running
+ */
+unsigned int lib_profile_get_interval(void)
+{
+    return lib_profile_interval;
+}
+
+static int lib_profile_compare(const void *a, const void *b)
+{
+    const lib_profile_site_t *sa = a;
+    const lib_profile_site_t *sb = b;
+
+    if (sa->live != sb->live) {
+        return sa->live < sb->live ? 1 : -1;
+    }
+    if (sa->bytes != sb->bytes) {
+        return sa->bytes < sb->bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+/** \brief  Report the results of the allocation profiling
+ *
+ * The call sites are passed to \a func in order of their live memory, the
+ * numbers are estimates scaled by the sample interval.
+ *
+ * \param[in]   max     most call sites reported
+ * \param[in]   func    called for every call site
+ * \param[in]   data    passed to \a func
+ *
+ * \return  number of call sites with results
+ */
+int lib_profile_foreach(unsigned int max, lib_profile_func_t func, void *data)
+{
+    lib_profile_site_t *sites;
+    unsigned int i, num = 0;
+    uint64_t scale;
+    char label[256];
+
+    LIB_DEBUG_LOCK();
+    if (lib_profile_sites == NULL) {
+        LIB_DEBUG_UNLOCK();
+        return 0;
+    }
+    /* work on a copy, reporting allocates too */
+    sites = malloc(LIB_PROFILE_SITES * sizeof(lib_profile_site_t));
+    if (sites != NULL) {
+        for (i = 0; i < LIB_PROFILE_SITES; i++) {
+            if (lib_profile_sites[i].used) {
+                sites[num++] = lib_profile_sites[i];
+            }
+        }
+    }
+    scale = lib_profile_scale;
+    LIB_DEBUG_UNLOCK();
+
+    if (sites == NULL) {
+        return 0;
+    }
+    qsort(sites, num, sizeof(lib_profile_site_t), lib_profile_compare);
+
+    for (i = 0; i < num && i < max; i++) {
+        if (sites[i].filename != NULL) {
+            snprintf(label, sizeof(label), "%s:%u", sites[i].filename, sites[i].line);
+        } else {
+#ifdef LIB_PROFILE_SYMBOLS
+            void *caller = (void *)sites[i].caller;
+            char **symbols = backtrace_symbols(&caller, 1);
+
+            if (symbols != NULL) {
+                snprintf(label, sizeof(label), "%s", symbols[0]);
+                free(symbols);
+            } else
+#endif
+            {
+                snprintf(label, sizeof(label), "%p", sites[i].caller);
+            }
+        }
+        func(label, sites[i].allocs * scale, sites[i].bytes * scale,
+             sites[i].live * scale, sites[i].peak * scale, data);
+    }
+
+    free(sites);
+    return (int)num;
+}
+
 /*----------------------------------------------------------------------------*/
 /* standard memory functions, prefixed by lib_. these will be used directly by
    other code (instead of the actual standard functions), and indirectly by the
    wrappers further below. */
 
-/* like malloc, but abort on out of memory. */
-#ifdef LIB_DEBUG_PINPOINT
-static
-#endif
-void *lib_malloc(size_t size)
+/* like malloc, but abort on out of memory.  `caller' is the call site for
+   the allocation profiling. */
+static void *lib_malloc_from(size_t size, const void *caller)
 {
     void *ptr;
 
@@ -642,6 +972,9 @@ void *lib_malloc(size_t size)
 #ifdef LIB_DEBUG
     lib_debug_alloc(ptr, size, 3);
 #endif
+    if (lib_profile_interval != 0) {
+        lib_profile_alloc(ptr, size, caller);
+    }
 
 #if 0
     /* clear/fill the block - this should only ever be used for debugging! */
@@ -655,6 +988,14 @@ void *lib_malloc(size_t size)
     return ptr;
 }
 
+#ifdef LIB_DEBUG_PINPOINT
+static
+#endif
+void *lib_malloc(size_t size)
+{
+    return lib_malloc_from(size, LIB_PROFILE_CALLER);
+}
+
 
 /* Like calloc, but abort if not enough memory is available.  */
 #ifdef LIB_DEBUG_PINPOINT
@@ -679,6 +1020,9 @@ void *lib_calloc(size_t nmemb, size_t size)
 #ifdef LIB_DEBUG
     lib_debug_alloc(ptr, size * nmemb, 1);
 #endif
+    if (lib_profile_interval != 0) {
+        lib_profile_alloc(ptr, size * nmemb, LIB_PROFILE_CALLER);
+    }
 
     LIB_DEBUG_UNLOCK();
 
@@ -692,9 +1036,14 @@ static
 void *lib_realloc(void *ptr, size_t size)
 {
     void *new_ptr;
+    int profile_old = 0;
 
     LIB_DEBUG_LOCK();
 
+    if (lib_profile_interval != 0) {
+        profile_old = lib_profile_realloc_old(ptr);
+    }
+
 #ifdef LIB_DEBUG
     new_ptr = lib_debug_libc_realloc(ptr, size);
 #else
@@ -709,6 +1058,9 @@ void *lib_realloc(void *ptr, size_t size)
     lib_debug_free(ptr, 1, false);
     lib_debug_alloc(new_ptr, size, 1);
 #endif
+    if (lib_profile_interval != 0) {
+        lib_profile_realloc_new(profile_old, new_ptr, size, LIB_PROFILE_CALLER);
+    }
 
     LIB_DEBUG_UNLOCK();
 
@@ -726,6 +1078,9 @@ void lib_free(void *ptr)
 #ifdef LIB_DEBUG
     lib_debug_free(ptr, 1, true);
 #endif
+    if (lib_profile_interval != 0) {
+        lib_profile_untrack(ptr);
+    }
 
 #ifdef LIB_DEBUG
     lib_debug_libc_free(ptr);
@@ -758,13 +1113,13 @@ char *lib_strdup(const char *str)
     }
 
     size = strlen(str) + 1;
-    ptr = lib_malloc(size);
+    ptr = lib_malloc_from(size, LIB_PROFILE_CALLER);
 
     memcpy(ptr, str, size);
     return ptr;
 }
 
-char *lib_mvsprintf(const char *fmt, va_list ap)
+static char *lib_mvsprintf_from(const char *fmt, va_list ap, const void *caller)
 {
     int maxlen;
     char *p;
@@ -782,7 +1137,7 @@ char *lib_mvsprintf(const char *fmt, va_list ap)
     }
 
     /* Alloc required size */
-    if ((p = lib_malloc(maxlen + 1)) == NULL) {
+    if ((p = lib_malloc_from(maxlen + 1, caller)) == NULL) {
         return NULL;
     }
 
@@ -792,18 +1147,274 @@ char *lib_mvsprintf(const char *fmt, va_list ap)
     return p;
 }
 
+char *lib_mvsprintf(const char *fmt, va_list ap)
+{
+    return lib_mvsprintf_from(fmt, ap, LIB_PROFILE_CALLER);
+}
+
 char *lib_msprintf(const char *fmt, ...)
 {
     va_list args;
     char *buf;
 
     va_start(args, fmt);
-    buf = lib_mvsprintf(fmt, args);
+    buf = lib_mvsprintf_from(fmt, args, LIB_PROFILE_CALLER);
+    va_end(args);
+
+    return buf;
+}
+
+/*----------------------------------------------------------------------------*/
+/* arenas: many small allocations handed out from a few big chunks and all
+   freed at once.  Meant for piles of short lived strings and for data
+   structures that are torn down as a whole, where allocating and freeing
+   each of them with lib_malloc and lib_free would only churn the heap.  */
+
+/* default chunk size */
+#define LIB_ARENA_CHUNK_SIZE    4096
+
+typedef struct lib_arena_chunk_s {
+    struct lib_arena_chunk_s *next; /* previous (older) chunk */
+    size_t base;                    /* arena offset of the start of the chunk */
+    size_t size;                    /* bytes available in the chunk */
+    size_t used;                    /* bytes handed out from the chunk */
+    union {                         /* the data, aligned for any type */
+        long double ld;
+        long long ll;
+        void *p;
+        void (*fp)(void);
+    } data[];
+} lib_arena_chunk_t;
+
+struct lib_arena_s {
+    lib_arena_chunk_t *chunk;       /* chunk allocated from, the newest one */
+    lib_arena_chunk_t *spare;       /* chunk kept for reuse after a release */
+    size_t chunk_size;
+};
+
+#define LIB_ARENA_ALIGN sizeof(((lib_arena_chunk_t *)NULL)->data[0])
+
+static lib_arena_chunk_t *lib_arena_chunk_new(lib_arena_t *arena, size_t size)
+{
+    lib_arena_chunk_t *chunk;
+
+    if (size <= arena->chunk_size && arena->spare != NULL) {
+        chunk = arena->spare;
+        arena->spare = NULL;
+    } else {
+        if (size < arena->chunk_size) {
+            size = arena->chunk_size;
+        }
+        chunk = lib_malloc(sizeof(lib_arena_chunk_t) + size);
+        chunk->size = size;
+    }
+    chunk->next = arena->chunk;
+    chunk->base = chunk->next != NULL ? chunk->next->base + chunk->next->size : 0;
+    chunk->used = 0;
+    arena->chunk = chunk;
+
+    return chunk;
+}
+
+/* Free a chunk dropped from the arena, keeping one of the default size.  */
+static void lib_arena_chunk_drop(lib_arena_t *arena, lib_arena_chunk_t *chunk)
+{
+    if (arena->spare == NULL && chunk->size == arena->chunk_size) {
+        arena->spare = chunk;
+    } else {
+        lib_free(chunk);
+    }
+}
+
+/** \brief  Create an arena
+ *
+ * \param[in]   chunk_size  size of the chunks allocated, 0 for the default
+ *
+ * \return  the arena, free with lib_arena_free()
+ */
+lib_arena_t *lib_arena_new(size_t chunk_size)
+{
+    lib_arena_t *arena = lib_malloc(sizeof(lib_arena_t));
+
+    if (chunk_size == 0) {
+        chunk_size = LIB_ARENA_CHUNK_SIZE;
+    }
+    arena->chunk = NULL;
+    arena->spare = NULL;
+    arena->chunk_size = (chunk_size + LIB_ARENA_ALIGN - 1) & ~(LIB_ARENA_ALIGN - 1);
+
+    return arena;
+}
+
+/** \brief  Free an arena and everything allocated from it
+ *
+ * \param[in]   arena   arena, may be NULL
+ */
+void lib_arena_free(lib_arena_t *arena)
+{
+    lib_arena_chunk_t *chunk, *next;
+
+    if (arena == NULL) {
+        return;
+    }
+    for (chunk = arena->chunk; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        lib_free(chunk);
+    }
+    lib_free(arena->spare);
+    lib_free(arena);
+}
+
+/** \brief  Allocate memory from an arena
+ *
+ * The memory is aligned for any type and stays valid until it is released
+ * with lib_arena_release() or lib_arena_reset(), or the arena is freed.
+ * Aborts when out of memory, like lib_malloc().
+ *
+ * \param[in]   arena   arena
+ * \param[in]   size    number of bytes
+ *
+ * \return  the memory
+ */
+void *lib_arena_alloc(lib_arena_t *arena, size_t size)
+{
+    lib_arena_chunk_t *chunk = arena->chunk;
+    void *ptr;
+
+    size = (size + LIB_ARENA_ALIGN - 1) & ~(LIB_ARENA_ALIGN - 1);
+    if (size == 0) {
+        size = LIB_ARENA_ALIGN;
+    }
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        chunk = lib_arena_chunk_new(arena, size);
+    }
+    ptr = (uint8_t *)chunk->data + chunk->used;
+    chunk->used += size;
+
+    return ptr;
+}
+
+/** \brief  Copy a string into an arena
+ *
+ * \param[in]   arena   arena
+ * \param[in]   str     string
+ *
+ * \return  the copy
+ */
+char *lib_arena_strdup(lib_arena_t *arena, const char *str)
+{
+    return lib_arena_strndup(arena, str, strlen(str));
+}
+
+/** \brief  Copy at most \a len characters of a string into an arena
+ *
+ * \param[in]   arena   arena
+ * \param[in]   str     string
+ * \param[in]   len     most characters to copy
+ *
+ * \return  the copy, always terminated
+ */
+char *lib_arena_strndup(lib_arena_t *arena, const char *str, size_t len)
+{
+    const char *end = memchr(str, '\0', len);
+    char *ptr;
+
+    if (end != NULL) {
+        len = (size_t)(end - str);
+    }
+    ptr = lib_arena_alloc(arena, len + 1);
+    memcpy(ptr, str, len);
+    ptr[len] = '\0';
+
+    return ptr;
+}
+
+/** \brief  Format a string into memory of an arena
+ *
+ * \param[in]   arena   arena
+ * \param[in]   fmt     format
+ * \param[in]   ap      arguments
+ *
+ * \return  the string, NULL on a format error
+ */
+char *lib_arena_mvsprintf(lib_arena_t *arena, const char *fmt, va_list ap)
+{
+    int maxlen;
+    char *p;
+    va_list args;
+
+    va_copy(args, ap);
+    maxlen = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    if (maxlen < 0) {
+        return NULL;
+    }
+
+    p = lib_arena_alloc(arena, (size_t)maxlen + 1);
+    vsnprintf(p, (size_t)maxlen + 1, fmt, ap);
+
+    return p;
+}
+
+char *lib_arena_msprintf(lib_arena_t *arena, const char *fmt, ...)
+{
+    va_list args;
+    char *buf;
+
+    va_start(args, fmt);
+    buf = lib_arena_mvsprintf(arena, fmt, args);
     va_end(args);
 
     return buf;
 }
 
+/** \brief  Get the current position of an arena
+ *
+ * Everything allocated after this can be released at once by passing the
+ * position to lib_arena_release(), which allows nested scopes of temporary
+ * allocations in the same arena.
+ *
+ * \param[in]   arena   arena
+ *
+ * \return  position
+ */
+size_t lib_arena_mark(lib_arena_t *arena)
+{
+    return arena->chunk != NULL ? arena->chunk->base + arena->chunk->used : 0;
+}
+
+/** \brief  Release everything allocated from an arena since a mark
+ *
+ * \param[in]   arena   arena
+ * \param[in]   mark    position from lib_arena_mark()
+ */
+void lib_arena_release(lib_arena_t *arena, size_t mark)
+{
+    lib_arena_chunk_t *chunk;
+
+    /* the first chunk is kept so an arena used for a series of scopes does
+       not allocate and free it every time */
+    while ((chunk = arena->chunk) != NULL && chunk->base >= mark
+           && chunk->next != NULL) {
+        arena->chunk = chunk->next;
+        lib_arena_chunk_drop(arena, chunk);
+    }
+    if (chunk != NULL && mark - chunk->base < chunk->used) {
+        chunk->used = mark - chunk->base;
+    }
+}
+
+/** \brief  Release everything allocated from an arena
+ *
+ * \param[in]   arena   arena
+ */
+void lib_arena_reset(lib_arena_t *arena)
+{
+    lib_arena_release(arena, 0);
+}
+
 /*----------------------------------------------------------------------------*/
 /* wrappers for the standard functions, which will be used when
    LIB_DEBUG_PINPOINT is defined */
@@ -817,7 +1428,9 @@ void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line)
 
     lib_debug_pinpoint_filename = name;
     lib_debug_pinpoint_line = line;
+    lib_profile_pinpoint = 1;
     result = lib_malloc(size);
+    lib_profile_pinpoint = 0;
 
     LIB_DEBUG_UNLOCK();
 
@@ -843,7 +1456,9 @@ void *lib_calloc_pinpoint(size_t nmemb, size_t size, const char *name, unsigned
 
     lib_debug_pinpoint_filename = name;
     lib_debug_pinpoint_line = line;
+    lib_profile_pinpoint = 1;
     result = lib_calloc(nmemb, size);
+    lib_profile_pinpoint = 0;
 
     LIB_DEBUG_UNLOCK();
 
@@ -858,7 +1473,9 @@ void *lib_realloc_pinpoint(void *p, size_t size, const char *name, unsigned int
 
     lib_debug_pinpoint_filename = name;
     lib_debug_pinpoint_line = line;
+    lib_profile_pinpoint = 1;
     result = lib_realloc(p, size);
+    lib_profile_pinpoint = 0;
 
     LIB_DEBUG_UNLOCK();
 
@@ -873,7 +1490,9 @@ char *lib_strdup_pinpoint(const char *str, const char *name, unsigned int line)
 
     lib_debug_pinpoint_filename = name;
     lib_debug_pinpoint_line = line;
+    lib_profile_pinpoint = 1;
     result = lib_strdup(str);
+    lib_profile_pinpoint = 0;
 
     LIB_DEBUG_UNLOCK();
     return result;
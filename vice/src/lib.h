@@ -68,6 +68,27 @@ void lib_rand_printseed(log_t log);
 char *lib_msprintf(const char *fmt, ...) VICE_ATTR_PRINTF;
 char *lib_mvsprintf(const char *fmt, va_list args);
 
+typedef struct lib_arena_s lib_arena_t;
+
+lib_arena_t *lib_arena_new(size_t chunk_size);
+void lib_arena_free(lib_arena_t *arena);
+void *lib_arena_alloc(lib_arena_t *arena, size_t size);
+char *lib_arena_strdup(lib_arena_t *arena, const char *str);
+char *lib_arena_strndup(lib_arena_t *arena, const char *str, size_t len);
+char *lib_arena_msprintf(lib_arena_t *arena, const char *fmt, ...) VICE_ATTR_PRINTF2;
+char *lib_arena_mvsprintf(lib_arena_t *arena, const char *fmt, va_list args);
+size_t lib_arena_mark(lib_arena_t *arena);
+void lib_arena_release(lib_arena_t *arena, size_t mark);
+void lib_arena_reset(lib_arena_t *arena);
+
+typedef void (*lib_profile_func_t)(const char *site, uint64_t allocs, uint64_t bytes,
+                                   uint64_t live, uint64_t peak, void *data);
+
+void lib_profile_start(unsigned int interval);
+void lib_profile_stop(void);
+unsigned int lib_profile_get_interval(void);
+int lib_profile_foreach(unsigned int max, lib_profile_func_t func, void *data);
+
 #ifdef LIB_DEBUG_PINPOINT
 void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line);
 void *lib_calloc_pinpoint(size_t nmemb, size_t size, const char *name, unsigned int line);
@@ -26,30 +26,18 @@
 **
 */
 
-#include "p64.h"
-
-static p64_uint32_t P64CRC32(p64_uint8_t* Data, p64_uint32_t Len) {
-
-    const p64_uint32_t CRC32Table[16] = {
-        0x00000000UL, 0x1db71064UL, 0x3b6e20c8UL, 0x26d930acUL,
-        0x76dc4190UL, 0x6b6b51f4UL, 0x4db26158UL, 0x5005713cUL,
-        0xedb88320UL, 0xf00f9344UL, 0xd6d6a3e8UL, 0xcb61b38cUL,
-        0x9b64c2b0UL, 0x86d3d2d4UL, 0xa00ae278UL, 0xbdbdf21cUL
-    };
+#include <pthread.h>
 
-    p64_uint32_t value, pos;
+#include "p64.h"
+#include "crc32.h"
 
-    if(!Len) {
-        return 0;
-    }
+/* Number of threads decoding or encoding tracks of an image. */
+#define P64Threads 4
 
-    for(value = 0xffffffffUL, pos = 0; pos < Len; pos++) {
-        value ^= Data[pos];
-        value = CRC32Table[value & 0xfUL] ^(value >> 4);
-        value = CRC32Table[value & 0xfUL] ^(value >> 4);
-    }
+/* Uses the table driven CRC32 of VICE, which gives the same result. */
+static p64_uint32_t P64CRC32(p64_uint8_t* Data, p64_uint32_t Len) {
 
-    return value ^ 0xffffffffUL;
+    return crc32_buf((const char *)Data, Len);
 }
 
 typedef p64_uint32_t* PP64RangeCoderProbabilities;
@@ -416,6 +404,14 @@ void P64PulseStreamClear(PP64PulseStream Instance) {
     if(Instance->Pulses) {
         p64_free(Instance->Pulses);
     }
+    if(Instance->CachePositions) {
+        p64_free(Instance->CachePositions);
+        p64_free(Instance->CacheStrengths);
+    }
+    Instance->CachePositions = 0;
+    Instance->CacheStrengths = 0;
+    Instance->CacheCount = 0;
+    P64PulseStreamChanged(Instance);
     Instance->Pulses = 0;
     Instance->PulsesAllocated = 0;
     Instance->PulsesCount = 0;
@@ -454,6 +450,7 @@ p64_int32_t P64PulseStreamAllocatePulse(PP64PulseStream Instance) {
 }
 
 void P64PulseStreamFreePulse(PP64PulseStream Instance, p64_int32_t Index) {
+    P64PulseStreamChanged(Instance);
     if(Instance->CurrentIndex == Index) {
         Instance->CurrentIndex = Instance->Pulses[Index].Next;
     }
@@ -474,6 +471,7 @@ void P64PulseStreamFreePulse(PP64PulseStream Instance, p64_int32_t Index) {
 
 void P64PulseStreamAddPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength) {
     p64_int32_t Current, Index;
+    P64PulseStreamChanged(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -660,6 +658,45 @@ void P64PulseStreamSeek(PP64PulseStream Instance, p64_uint32_t Position) {
     Instance->CurrentIndex = Current;
 }
 
+/* Drop the flat arrays and the encoded chunk of the pulses, called whenever
+   the pulse list changes. */
+void P64PulseStreamChanged(PP64PulseStream Instance) {
+    Instance->CacheValid = 0;
+    if(Instance->EncodedData) {
+        p64_free(Instance->EncodedData);
+        Instance->EncodedData = 0;
+    }
+    Instance->EncodedSize = 0;
+}
+
+/* Flat arrays of the pulse positions and strengths in track order, rebuilt
+   after the pulse list was changed. */
+void P64PulseStreamUpdateCache(PP64PulseStream Instance) {
+    p64_int32_t Current;
+    p64_uint32_t Count;
+    if(Instance->CacheValid) {
+        return;
+    }
+    Count = 0;
+    for(Current = Instance->UsedFirst; Current >= 0; Current = Instance->Pulses[Current].Next) {
+        Count++;
+    }
+    if(Instance->CachePositions) {
+        p64_free(Instance->CachePositions);
+        p64_free(Instance->CacheStrengths);
+    }
+    Instance->CachePositions = p64_malloc((Count + 1) * sizeof(p64_uint32_t));
+    Instance->CacheStrengths = p64_malloc((Count + 1) * sizeof(p64_uint32_t));
+    Count = 0;
+    for(Current = Instance->UsedFirst; Current >= 0; Current = Instance->Pulses[Current].Next) {
+        Instance->CachePositions[Count] = Instance->Pulses[Current].Position;
+        Instance->CacheStrengths[Count] = Instance->Pulses[Current].Strength;
+        Count++;
+    }
+    Instance->CacheCount = Count;
+    Instance->CacheValid = 1;
+}
+
 void P64PulseStreamConvertFromGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len) {
     p64_uint32_t PositionHi, PositionLo, IncrementHi, IncrementLo, BitStreamPosition;
     P64PulseStreamClear(Instance);
@@ -981,6 +1018,89 @@ p64_uint32_t P64PulseStreamWriteToStream(PP64PulseStream Instance, PP64MemoryStr
     return 0;
 }
 
+/* The tracks of an image are independent range coded streams, they are
+   decoded and encoded by a few threads at once. */
+
+typedef struct {
+    PP64PulseStream PulseStream;
+    TP64MemoryStream Stream;
+    p64_uint32_t Result;
+} TP64TrackJob;
+
+typedef TP64TrackJob* PP64TrackJob;
+
+typedef struct {
+    PP64TrackJob Jobs;
+    p64_uint32_t Count;
+    p64_uint32_t Next;
+    void (*Work)(PP64TrackJob Job);
+    pthread_mutex_t Lock;
+} TP64TrackJobs;
+
+static void* P64TrackJobsWorker(void* Data) {
+    TP64TrackJobs* TrackJobs = Data;
+    p64_uint32_t Index;
+    for(;;) {
+        pthread_mutex_lock(&TrackJobs->Lock);
+        Index = TrackJobs->Next++;
+        pthread_mutex_unlock(&TrackJobs->Lock);
+        if(Index >= TrackJobs->Count) {
+            break;
+        }
+        TrackJobs->Work(&TrackJobs->Jobs[Index]);
+    }
+    return 0;
+}
+
+static void P64TrackJobsRun(PP64TrackJob Jobs, p64_uint32_t Count, void (*Work)(PP64TrackJob Job)) {
+    TP64TrackJobs TrackJobs;
+    pthread_t Threads[P64Threads - 1];
+    p64_uint32_t Index, Started;
+    TrackJobs.Jobs = Jobs;
+    TrackJobs.Count = Count;
+    TrackJobs.Next = 0;
+    TrackJobs.Work = Work;
+    pthread_mutex_init(&TrackJobs.Lock, NULL);
+    /* the calling thread works too, and alone if no thread can be started */
+    for(Started = 0; (Started < (P64Threads - 1)) && ((Started + 1) < Count); Started++) {
+        if(pthread_create(&Threads[Started], NULL, P64TrackJobsWorker, &TrackJobs) != 0) {
+            break;
+        }
+    }
+    P64TrackJobsWorker(&TrackJobs);
+    for(Index = 0; Index < Started; Index++) {
+        pthread_join(Threads[Index], NULL);
+    }
+    pthread_mutex_destroy(&TrackJobs.Lock);
+}
+
+static void P64TrackJobDecode(PP64TrackJob Job) {
+    p64_uint32_t WasEmpty = Job->PulseStream->UsedFirst < 0;
+    if(!Job->Stream.Data) {
+        /* already decoded */
+        return;
+    }
+    P64MemoryStreamSeek(&Job->Stream, 0);
+    Job->Result = P64PulseStreamReadFromStream(Job->PulseStream, &Job->Stream);
+    /* keep the chunk, it is written back as is while the track is unchanged */
+    if(Job->Result && WasEmpty) {
+        Job->PulseStream->EncodedData = Job->Stream.Data;
+        Job->PulseStream->EncodedSize = Job->Stream.Size;
+        P64MemoryStreamCreate(&Job->Stream);
+    }
+    P64MemoryStreamDestroy(&Job->Stream);
+}
+
+static void P64TrackJobEncode(PP64TrackJob Job) {
+    Job->Result = P64PulseStreamWriteToStream(Job->PulseStream, &Job->Stream);
+    if(Job->Result) {
+        Job->PulseStream->EncodedData = p64_malloc(Job->Stream.Size ? Job->Stream.Size : 1);
+        memcpy(Job->PulseStream->EncodedData, Job->Stream.Data, Job->Stream.Size);
+        Job->PulseStream->EncodedSize = Job->Stream.Size;
+    }
+    P64MemoryStreamDestroy(&Job->Stream);
+}
+
 void P64ImageCreate(PP64Image Instance) {
     p64_int32_t HalfTrack, side;
     memset(Instance, 0, sizeof(TP64Image));
@@ -1015,11 +1135,13 @@ void P64ImageClear(PP64Image Instance) {
 
 p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream) {
     TP64MemoryStream ChunksMemoryStream, ChunkMemoryStream;
-    p64_uint32_t Version, Flags, Size, Checksum, HalfTrack, OK, side;
+    p64_uint32_t Version, Flags, Size, Checksum, HalfTrack, OK, side, Index, CountJobs;
     TP64HeaderSignature HeaderSignature;
     TP64ChunkSignature ChunkSignature;
+    TP64TrackJob Jobs[2 * (P64LastHalfTrack + 1)];
 
     OK = 0;
+    CountJobs = 0;
     P64ImageClear(Instance);
     if(P64MemoryStreamSeek(Stream, 0) == 0) {
         if(P64MemoryStreamRead(Stream, (void*)&HeaderSignature, sizeof(TP64HeaderSignature)) == sizeof(TP64HeaderSignature)) {
@@ -1057,7 +1179,18 @@ p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream)
                                                                                 if((ChunkSignature[0] == 'H') && (ChunkSignature[1] == 'T') && (ChunkSignature[2] == 'P') && (((ChunkSignature[3] & 127) >= P64FirstHalfTrack) && ((ChunkSignature[3] & 127) <= P64LastHalfTrack))) {
                                                                                     HalfTrack = ChunkSignature[3] & 127;
                                                                                     side = !!(ChunkSignature[3] & 128);
-                                                                                    OK = P64PulseStreamReadFromStream(&Instance->PulseStreams[side][HalfTrack], &ChunkMemoryStream);
+                                                                                    /* decoded below; a second chunk of the same track is added after the first */
+                                                                                    for(Index = 0; Index < CountJobs; Index++) {
+                                                                                        if((Jobs[Index].PulseStream == &Instance->PulseStreams[side][HalfTrack]) && (Jobs[Index].Stream.Data)) {
+                                                                                            P64TrackJobDecode(&Jobs[Index]);
+                                                                                        }
+                                                                                    }
+                                                                                    Jobs[CountJobs].PulseStream = &Instance->PulseStreams[side][HalfTrack];
+                                                                                    Jobs[CountJobs].Stream = ChunkMemoryStream;
+                                                                                    Jobs[CountJobs].Result = 0;
+                                                                                    CountJobs++;
+                                                                                    P64MemoryStreamCreate(&ChunkMemoryStream);
+                                                                                    OK = 1;
                                                                                 } else {
                                                                                     OK = 1;
                                                                                 }
@@ -1085,12 +1218,23 @@ p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream)
             }
         }
     }
+    if(OK) {
+        P64TrackJobsRun(Jobs, CountJobs, P64TrackJobDecode);
+        for(Index = 0; Index < CountJobs; Index++) {
+            OK = OK && Jobs[Index].Result;
+        }
+    } else {
+        for(Index = 0; Index < CountJobs; Index++) {
+            P64MemoryStreamDestroy(&Jobs[Index].Stream);
+        }
+    }
     return OK;
 }
 
 p64_uint32_t P64ImageWriteToStream(PP64Image Instance, PP64MemoryStream Stream) {
     TP64MemoryStream MemoryStream, ChunksMemoryStream, ChunkMemoryStream;
-    p64_uint32_t Version, Flags, Size, Checksum, HalfTrack, result, WriteChunkResult, side;
+    p64_uint32_t Version, Flags, Size, Checksum, HalfTrack, result, WriteChunkResult, side, CountJobs;
+    TP64TrackJob Jobs[2 * (P64LastHalfTrack + 1)];
 
     TP64HeaderSignature HeaderSignature;
     TP64ChunkSignature ChunkSignature;
@@ -1132,12 +1276,29 @@ p64_uint32_t P64ImageWriteToStream(PP64Image Instance, PP64MemoryStream Stream)
     P64MemoryStreamCreate(&MemoryStream);
     P64MemoryStreamCreate(&ChunksMemoryStream);
 
+    /* encode the tracks changed since they were last read or written */
+    CountJobs = 0;
+    for (side = 0; side < (p64_uint32_t)Instance->noSides; side++) {
+        for(HalfTrack = P64FirstHalfTrack; HalfTrack <= P64LastHalfTrack; HalfTrack++) {
+            if(!Instance->PulseStreams[side][HalfTrack].EncodedData) {
+                Jobs[CountJobs].PulseStream = &Instance->PulseStreams[side][HalfTrack];
+                P64MemoryStreamCreate(&Jobs[CountJobs].Stream);
+                Jobs[CountJobs].Result = 0;
+                CountJobs++;
+            }
+        }
+    }
+    P64TrackJobsRun(Jobs, CountJobs, P64TrackJobEncode);
+
     result = 1;
     for (side = 0; side < (p64_uint32_t)Instance->noSides; side++) {
         for(HalfTrack = P64FirstHalfTrack; HalfTrack <= P64LastHalfTrack; HalfTrack++) {
 
             P64MemoryStreamCreate(&ChunkMemoryStream);
-            result = P64PulseStreamWriteToStream(&Instance->PulseStreams[side][HalfTrack], &ChunkMemoryStream);
+            result = Instance->PulseStreams[side][HalfTrack].EncodedData != 0;
+            if(result) {
+                result = P64MemoryStreamWrite(&ChunkMemoryStream, Instance->PulseStreams[side][HalfTrack].EncodedData, Instance->PulseStreams[side][HalfTrack].EncodedSize) == Instance->PulseStreams[side][HalfTrack].EncodedSize;
+            }
             if(result) {
                 ChunkSignature[0] = 'H';
                 ChunkSignature[1] = 'T';
@@ -107,6 +107,12 @@ typedef struct {
 	p64_int32_t UsedLast;
 	p64_int32_t FreeList;
 	p64_int32_t CurrentIndex;
+	p64_uint32_t* CachePositions;
+	p64_uint32_t* CacheStrengths;
+	p64_uint32_t CacheCount;
+	p64_uint32_t CacheValid;
+	p64_uint8_t* EncodedData;
+	p64_uint32_t EncodedSize;
 } TP64PulseStream;
 
 typedef TP64PulseStream* PP64PulseStream;
@@ -163,6 +169,8 @@ p64_uint32_t P64PulseStreamGetPulseCount(PP64PulseStream Instance);
 p64_uint32_t P64PulseStreamGetPulse(PP64PulseStream Instance, p64_uint32_t Position);
 void P64PulseStreamSetPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength);
 void P64PulseStreamSeek(PP64PulseStream Instance, p64_uint32_t Position);
+void P64PulseStreamUpdateCache(PP64PulseStream Instance);
+void P64PulseStreamChanged(PP64PulseStream Instance);
 void P64PulseStreamConvertFromGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len);
 void P64PulseStreamConvertToGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len);
 p64_uint32_t P64PulseStreamConvertToGCRWithLogic(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len, p64_uint32_t SpeedZone);
@@ -40,6 +40,7 @@
 #include "log.h"
 #include "monitor.h"
 #include "resources.h"
+#include "types.h"
 #include "util.h"
 
 #ifdef DBGLOGGING
@@ -60,11 +61,19 @@
  *******************************************************************
  * ANY NEW NON-STATIC FUNCTIONS NEED CALLS TO LOCK() and UNLOCK(). *
  *******************************************************************
+ *
+ * (log_helper() takes the lock itself, since queued messages must not.)
  */
 
 #include <pthread.h>
 static pthread_mutex_t log_lock;
 
+#ifndef __X1541__
+/* messages can be queued and written by a background thread (LogAsync) */
+#define LOG_ASYNC
+#include <stdatomic.h>
+#endif
+
 #define LOCK() { log_init_locks(); pthread_mutex_lock(&log_lock); }
 #define UNLOCK() { pthread_mutex_unlock(&log_lock); }
 #define UNLOCK_AND_RETURN_INT(i) { int result = (i); UNLOCK(); return result; }
@@ -101,6 +110,46 @@ static int log_to_monitor = 0;
 
 static int log_colorize = 1;
 
+#ifndef __X1541__
+static int log_async = 0;
+#endif
+static int log_timestamps = 0;
+static int log_rate_limit = 0;  /* messages per second and log, 0 = unlimited */
+
+/* emulated clock used for the timestamps, see log_set_clock() */
+static const CLOCK *log_clock = NULL;
+
+/* real time of the last message and the time elapsed until then, so the
+   timestamps survive the wraparound of tick_t */
+static int log_time_started = 0;
+static tick_t log_time_last;
+static uint64_t log_time_elapsed;
+
+/* per log rate limiting state */
+typedef struct log_rate_s {
+    tick_t window;              /* start of the current one second window */
+    unsigned int count;         /* messages in the current window */
+    unsigned int suppressed;    /* messages dropped in the current window */
+} log_rate_t;
+
+static log_rate_t *log_rates = NULL;    /* parallel to logs */
+static log_rate_t log_rate_default;
+
+/* log file output collected while draining the message queues */
+static int log_batching = 0;
+static char *log_batch = NULL;
+static size_t log_batch_len = 0;
+static size_t log_batch_size = 0;
+
+#ifdef LOG_ASYNC
+static void log_async_start(void);
+static void log_async_stop(void);
+static void log_async_drain(void);
+static void log_async_free(void);
+#else
+#define log_async_drain()
+#endif
+
 /* ------------------------------------------------------------------------- */
 
 #define LOG_FILE_TYPE_NONE              0
@@ -342,6 +391,42 @@ static int set_log_file_name(const char *val, void *param)
     return 0;
 }
 
+static int set_log_async(int val, void *param)
+{
+    log_async = val ? 1 : 0;
+#ifdef LOG_ASYNC
+    /* not under the lock, the writer thread takes it */
+    if (log_async) {
+        log_async_start();
+    } else {
+        log_async_stop();
+    }
+#endif
+    DBG(("set_log_async:%d\n", val));
+    return 0;
+}
+
+static int set_log_timestamps(int val, void *param)
+{
+    LOCK();
+    log_timestamps = val ? 1 : 0;
+    DBG(("set_log_timestamps:%d\n", val));
+    UNLOCK();
+    return 0;
+}
+
+static int set_log_rate_limit(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    LOCK();
+    log_rate_limit = val;
+    DBG(("set_log_rate_limit:%d\n", val));
+    UNLOCK();
+    return 0;
+}
+
 static const resource_int_t resources_int[] = {
     { "LogLimit", LOG_LIMIT_STANDARD, RES_EVENT_NO, NULL,
       &log_limit, set_log_limit, NULL },
@@ -353,6 +438,12 @@ static const resource_int_t resources_int[] = {
       &log_to_stdout, set_log_to_stdout, NULL },
     { "LogToMonitor", 0, RES_EVENT_NO, NULL,
       &log_to_monitor, set_log_to_monitor, NULL },
+    { "LogAsync", 0, RES_EVENT_NO, NULL,
+      &log_async, set_log_async, NULL },
+    { "LogTimestamps", 0, RES_EVENT_NO, NULL,
+      &log_timestamps, set_log_timestamps, NULL },
+    { "LogRateLimit", 0, RES_EVENT_NO, NULL,
+      &log_rate_limit, set_log_rate_limit, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -462,6 +553,21 @@ static const cmdline_option_t cmdline_options[] =
     { "+logcolorize", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "LogColorize", (void *)0,
       NULL, "Do not colorize the log output." },
+    { "-logasync", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LogAsync", (void *)1,
+      NULL, "Write the log from a background thread." },
+    { "+logasync", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LogAsync", (void *)0,
+      NULL, "Write the log from the thread that logs." },
+    { "-logtimestamps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LogTimestamps", (void *)1,
+      NULL, "Prefix log messages with the real time and the emulated cycle." },
+    { "+logtimestamps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LogTimestamps", (void *)0,
+      NULL, "Do not prefix log messages with timestamps." },
+    { "-lograte", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "LogRateLimit", NULL,
+      "<Messages>", "Limit the messages per second of each log (0: no limit)" },
 
     CMDLINE_LIST_END
 };
@@ -562,9 +668,11 @@ log_t log_open(const char *id)
     if (i == num_logs) {
         new_log = num_logs++;
         logs = lib_realloc(logs, sizeof(*logs) * num_logs);
+        log_rates = lib_realloc(log_rates, sizeof(*log_rates) * num_logs);
     }
 
     logs[new_log] = lib_strdup(id);
+    memset(&log_rates[new_log], 0, sizeof(*log_rates));
 
     /*printf("log_open(%s) = %d\n", id, (int)new_log);*/
     UNLOCK_AND_RETURN_INT(new_log);
@@ -589,18 +697,44 @@ void log_close_all(void)
 {
     log_t i;
 
+#ifdef LOG_ASYNC
+    /* write what is still queued while the log names are known */
+    log_async_stop();
+#endif
+
     LOCK();
 
+    log_async_drain();
+#ifdef LOG_ASYNC
+    log_async_free();
+#endif
+
     for (i = 0; i < num_logs; i++) {
         log_close(i);
     }
 
     lib_free(logs);
     logs = NULL;
+    lib_free(log_rates);
+    log_rates = NULL;
+    lib_free(log_batch);
+    log_batch = NULL;
+    log_batch_size = 0;
 
     UNLOCK();
 }
 
+/** \brief  Set the emulated clock used for the log timestamps
+ *
+ * \param[in]   clk     clock, or NULL for real time only
+ */
+void log_set_clock(const CLOCK *clk)
+{
+    LOCK();
+    log_clock = clk;
+    UNLOCK();
+}
+
 /******************************************************************************/
 
 /* helper function for formatted output to default logger (stdout) */
@@ -651,7 +785,20 @@ static int log_monitor(const char *pretxt, const char *logtxt)
 static int log_tofile(const char *pretxt, const char *logtxt)
 {
     int rc = 0;
-    if (log_file != NULL) {
+    if (log_file != NULL && log_batching) {
+        /* written with a single call when the queues are drained */
+        size_t prelen = strlen(pretxt);
+        size_t len = strlen(logtxt);
+
+        if (log_batch_len + prelen + len + 1 > log_batch_size) {
+            log_batch_size = (log_batch_len + prelen + len + 1) * 2;
+            log_batch = lib_realloc(log_batch, log_batch_size);
+        }
+        memcpy(log_batch + log_batch_len, pretxt, prelen);
+        memcpy(log_batch + log_batch_len + prelen, logtxt, len);
+        log_batch_len += prelen + len;
+        log_batch[log_batch_len++] = '\n';
+    } else if (log_file != NULL) {
         if (fputs(pretxt, log_file) == EOF) {
             rc = -1;
         } else if (fputs(logtxt, log_file) == EOF) {
@@ -690,9 +837,13 @@ static char *logskipcolors(char *txt)
     return p;
 }
 
-/* main log helper */
-static int log_helper(log_t log, unsigned int level, const char *format,
-                      va_list ap)
+/* count a message against the rate limit of its log, called with the lock
+   held. returns nonzero if the message is to be suppressed */
+static int log_rate_check(log_rate_t *rate, log_t log, tick_t tick);
+
+/* write a formatted message to the enabled outputs, called with the lock held */
+static int log_emit(log_t log, unsigned int level, char *logtxt, tick_t tick,
+                    CLOCK clk, int rate_limited)
 {
     static const char * const level_strings[8] = {
         "",             /* LOG_LEVEL_NONE */
@@ -709,38 +860,56 @@ static int log_helper(log_t log, unsigned int level, const char *format,
 
     signed int logi = (signed int)log;
     int rc = 0;
+    char *stamp = NULL;
     char *pretxt = NULL;
-    char *logtxt = NULL;
     char *nocolorpre = NULL;
     char *nocolortxt = NULL;
     char *terminalpre = NULL;
     char *terminaltxt = NULL;
 
-    /* exit early if there is no log enabled */
-    if ((log_limit < level) ||
-        ((log_to_stdout == 0) && (log_to_file == 0) && (log_to_monitor == 0))) {
-        return 0;
-    }
-
     if (logi != LOG_DEFAULT) {
         if ((logs == NULL) || (logi < 0) || (logi >= num_logs) || (logs[logi] == NULL)) {
-            DBG(("log_helper: internal error (invalid id or closed log), message follows:\n"));
+            DBG(("log_emit: internal error (invalid id or closed log), message follows:\n"));
             logi = LOG_DEFAULT;
         }
     }
 
-    /* prepend the log_t prefix, and the loglevel string */
-    if ((logi == LOG_DEFAULT) || (*logs[logi] == '\0')) {
-        pretxt = lib_msprintf("%s", lvlstr);
-    } else {
-        pretxt = lib_msprintf(LOG_COL_LWHITE "%s" LOG_COL_OFF ": %s", logs[logi], lvlstr);
+    /* fatal messages are never suppressed */
+    if (rate_limited && (log_rate_limit > 0) && (level != LOG_LEVEL_FATAL)) {
+        if (log_rate_check(logi == LOG_DEFAULT ? &log_rate_default : &log_rates[logi],
+                           logi, tick)) {
+            return 0;
+        }
     }
 
-    /* build the log string */
-    logtxt = lib_mvsprintf(format, ap);
-    if (logtxt == NULL) {
-        fprintf(stderr, "log_helper: internal error (lib_mvsprintf returned NULL)\n");
-        return -1;
+    if (log_timestamps) {
+        if (!log_time_started) {
+            log_time_started = 1;
+            log_time_last = tick;
+        }
+        /* messages of other threads may have been taken slightly earlier,
+           don't let the time run backwards */
+        if ((tick_t)(tick - log_time_last) < 0x80000000u) {
+            log_time_elapsed += (tick_t)(tick - log_time_last);
+            log_time_last = tick;
+        }
+        if (log_clock != NULL) {
+            stamp = lib_msprintf("[%lu.%06lu %" PRIu64 "] ",
+                                 (unsigned long)(log_time_elapsed / 1000000),
+                                 (unsigned long)(log_time_elapsed % 1000000), clk);
+        } else {
+            stamp = lib_msprintf("[%lu.%06lu] ",
+                                 (unsigned long)(log_time_elapsed / 1000000),
+                                 (unsigned long)(log_time_elapsed % 1000000));
+        }
+    }
+
+    /* prepend the timestamp, the log_t prefix, and the loglevel string */
+    if ((logi == LOG_DEFAULT) || (*logs[logi] == '\0')) {
+        pretxt = lib_msprintf("%s%s", stamp ? stamp : "", lvlstr);
+    } else {
+        pretxt = lib_msprintf("%s" LOG_COL_LWHITE "%s" LOG_COL_OFF ": %s",
+                              stamp ? stamp : "", logs[logi], lvlstr);
     }
 
     if ((log_to_file) || (!log_colorize)) {
@@ -783,13 +952,323 @@ static int log_helper(log_t log, unsigned int level, const char *format,
         }
     }
 
+    lib_free(stamp);
     lib_free(pretxt);
-    lib_free(logtxt);
     lib_free(nocolorpre);
     lib_free(nocolortxt);
     return rc;
 }
 
+static int log_rate_check(log_rate_t *rate, log_t log, tick_t tick)
+{
+    if ((tick_t)(tick - rate->window) >= tick_per_second()) {
+        unsigned int suppressed = rate->suppressed;
+
+        rate->window = tick;
+        rate->count = 0;
+        rate->suppressed = 0;
+        if (suppressed > 0) {
+            char *txt = lib_msprintf("(%u messages suppressed by the rate limit)",
+                                     suppressed);
+            log_emit(log, LOG_LEVEL_WARNING, txt, tick, 0, 0);
+            lib_free(txt);
+        }
+    }
+
+    if (rate->count >= (unsigned int)log_rate_limit) {
+        rate->suppressed++;
+        return 1;
+    }
+    rate->count++;
+    return 0;
+}
+
+/******************************************************************************
+ Message queues
+ ******************************************************************************/
+
+#ifdef LOG_ASYNC
+
+/*
+ * Every thread that logs while LogAsync is enabled gets a queue of its own,
+ * so the thread only formats the message and never waits for the output.
+ * The queues are single producer rings: the owning thread moves the head,
+ * whoever holds the log lock (the writer thread, or a thread logging
+ * synchronously) drains them and moves the tail. A global sequence number
+ * keeps the messages of all threads in order. A thread that finds its queue
+ * full drains the queues itself, so no message is ever lost.
+ */
+
+/* messages per queue, a power of two */
+#define LOG_QUEUE_SIZE  1024
+
+typedef struct log_entry_s {
+    unsigned long seq;
+    log_t log;
+    unsigned int level;
+    tick_t tick;
+    CLOCK clk;
+    char *text;
+} log_entry_t;
+
+typedef struct log_queue_s {
+    log_entry_t entries[LOG_QUEUE_SIZE];
+    atomic_size_t head;
+    atomic_size_t tail;
+    struct log_queue_s *next;
+} log_queue_t;
+
+static _Atomic(log_queue_t *) log_queues = NULL;
+static atomic_ulong log_seq = 0;
+
+static pthread_key_t log_queue_key;
+static int log_queue_key_valid = 0;
+
+static pthread_t log_writer;
+static int log_writer_running = 0;
+static atomic_int log_writer_stop = 0;
+
+/* nonzero while messages are queued instead of written directly */
+static atomic_int log_queueing = 0;
+
+/* get the queue of the calling thread, creating it on first use */
+static log_queue_t *log_queue_get(void)
+{
+    log_queue_t *q = pthread_getspecific(log_queue_key);
+
+    if (q == NULL) {
+        q = lib_calloc(1, sizeof(log_queue_t));
+        atomic_init(&q->head, 0);
+        atomic_init(&q->tail, 0);
+        q->next = atomic_load(&log_queues);
+        while (!atomic_compare_exchange_weak(&log_queues, &q->next, q)) {
+            /* retry with the updated list head */
+        }
+        pthread_setspecific(log_queue_key, q);
+    }
+    return q;
+}
+
+/* queue a message of the calling thread */
+static int log_async_push(log_t log, unsigned int level, tick_t tick, CLOCK clk,
+                          const char *format, va_list ap)
+{
+    log_queue_t *q = log_queue_get();
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    log_entry_t *e;
+
+    if (head - atomic_load_explicit(&q->tail, memory_order_acquire) >= LOG_QUEUE_SIZE) {
+        /* the writer does not keep up, do its work */
+        LOCK();
+        log_async_drain();
+        UNLOCK();
+    }
+
+    e = &q->entries[head & (LOG_QUEUE_SIZE - 1)];
+    e->text = lib_mvsprintf(format, ap);
+    if (e->text == NULL) {
+        fprintf(stderr, "log_async_push: internal error (lib_mvsprintf returned NULL)\n");
+        return -1;
+    }
+    e->log = log;
+    e->level = level;
+    e->tick = tick;
+    e->clk = clk;
+    e->seq = atomic_fetch_add(&log_seq, 1);
+
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/* write the collected log file output */
+static int log_batch_flush(void)
+{
+    int rc = 0;
+
+    if (log_batch_len > 0 && log_file != NULL) {
+        if (fwrite(log_batch, 1, log_batch_len, log_file) != log_batch_len) {
+            rc = -1;
+        }
+    }
+    log_batch_len = 0;
+    return rc;
+}
+
+/* write all queued messages in order, called with the lock held */
+static void log_async_drain(void)
+{
+    log_queue_t *first = atomic_load(&log_queues);
+
+    if (first == NULL) {
+        return;
+    }
+
+    log_batching = 1;
+    for (;;) {
+        log_queue_t *q;
+        log_queue_t *best = NULL;
+        log_entry_t *e = NULL;
+        size_t tail;
+
+        /* pick the oldest message at the tail of any queue */
+        for (q = first; q != NULL; q = q->next) {
+            tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+            if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) {
+                log_entry_t *t = &q->entries[tail & (LOG_QUEUE_SIZE - 1)];
+
+                if (best == NULL || (long)(t->seq - e->seq) < 0) {
+                    best = q;
+                    e = t;
+                }
+            }
+        }
+        if (best == NULL) {
+            break;
+        }
+
+        log_emit(e->log, e->level, e->text, e->tick, e->clk, 1);
+        lib_free(e->text);
+        tail = atomic_load_explicit(&best->tail, memory_order_relaxed);
+        atomic_store_explicit(&best->tail, tail + 1, memory_order_release);
+
+        /* threads may have registered a queue meanwhile */
+        first = atomic_load(&log_queues);
+    }
+    log_batching = 0;
+    log_batch_flush();
+}
+
+static void *log_writer_thread(void *arg)
+{
+    while (!atomic_load(&log_writer_stop)) {
+        LOCK();
+        log_async_drain();
+        UNLOCK();
+        tick_sleep(tick_per_second() / 200);
+    }
+    return NULL;
+}
+
+/* start queueing messages and the thread writing them */
+static void log_async_start(void)
+{
+    if (log_writer_running) {
+        return;
+    }
+    log_init_locks();
+    if (!log_queue_key_valid) {
+        if (pthread_key_create(&log_queue_key, NULL) != 0) {
+            log_error(LOG_DEFAULT, "Cannot create the log queue key.");
+            return;
+        }
+        log_queue_key_valid = 1;
+    }
+
+    atomic_store(&log_writer_stop, 0);
+    if (pthread_create(&log_writer, NULL, log_writer_thread, NULL) != 0) {
+        log_error(LOG_DEFAULT, "Cannot start the log writer thread.");
+        return;
+    }
+    log_writer_running = 1;
+    atomic_store(&log_queueing, 1);
+}
+
+/* stop queueing messages, the queues are drained by the next message
+   written directly */
+static void log_async_stop(void)
+{
+    if (!log_writer_running) {
+        return;
+    }
+    atomic_store(&log_queueing, 0);
+    atomic_store(&log_writer_stop, 1);
+    pthread_join(log_writer, NULL);
+    log_writer_running = 0;
+}
+
+/* free the queues, called with the lock held after log_async_stop() and a
+   final drain. deleting the key forgets the queues of all threads */
+static void log_async_free(void)
+{
+    log_queue_t *q = atomic_exchange(&log_queues, NULL);
+
+    while (q != NULL) {
+        log_queue_t *next = q->next;
+
+        lib_free(q);
+        q = next;
+    }
+    if (log_queue_key_valid) {
+        pthread_key_delete(log_queue_key);
+        log_queue_key_valid = 0;
+    }
+}
+
+#endif /* #ifdef LOG_ASYNC */
+
+/******************************************************************************/
+
+/* flush the outputs, called with the lock held */
+static void log_flush_outputs(void)
+{
+    log_async_drain();
+    if (log_file != NULL) {
+        fflush(log_file);
+    }
+    fflush(stdout);
+}
+
+/* main log helper */
+static int log_helper(log_t log, unsigned int level, const char *format,
+                      va_list ap)
+{
+    int rc;
+    tick_t tick = 0;
+    CLOCK clk;
+    char *logtxt;
+
+    /* exit early if there is no log enabled */
+    if ((log_limit < level) ||
+        ((log_to_stdout == 0) && (log_to_file == 0) && (log_to_monitor == 0))) {
+        return 0;
+    }
+
+    /* the timestamps are taken when the message is logged, not written */
+    if (log_timestamps || (log_rate_limit > 0)) {
+        tick = tick_now();
+    }
+    clk = (log_clock != NULL) ? *log_clock : 0;
+
+#ifdef LOG_ASYNC
+    /* fatal messages are written right away, and the monitor output must
+       come from the thread that logs */
+    if (atomic_load(&log_queueing) && (level != LOG_LEVEL_FATAL) && !log_to_monitor) {
+        return log_async_push(log, level, tick, clk, format, ap);
+    }
+#endif
+
+    LOCK();
+
+    /* keep the order with messages still queued */
+    log_async_drain();
+
+    /* build the log string */
+    logtxt = lib_mvsprintf(format, ap);
+    if (logtxt == NULL) {
+        fprintf(stderr, "log_helper: internal error (lib_mvsprintf returned NULL)\n");
+        UNLOCK_AND_RETURN_INT(-1);
+    }
+
+    rc = log_emit(log, level, logtxt, tick, clk, 1);
+    lib_free(logtxt);
+
+    if (level == LOG_LEVEL_FATAL) {
+        log_flush_outputs();
+    }
+
+    UNLOCK_AND_RETURN_INT(rc);
+}
+
 /******************************************************************************
  High level log functions
  ******************************************************************************/
@@ -799,13 +1278,11 @@ int log_out(log_t log, unsigned int level, const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, level, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_message(log_t log, const char *format, ...)
@@ -813,13 +1290,11 @@ int log_message(log_t log, const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_INFO, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_warning(log_t log, const char *format, ...)
@@ -827,13 +1302,11 @@ int log_warning(log_t log, const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_WARNING, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_error(log_t log, const char *format, ...)
@@ -841,13 +1314,11 @@ int log_error(log_t log, const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_ERROR, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_fatal(log_t log, const char *format, ...)
@@ -855,13 +1326,11 @@ int log_fatal(log_t log, const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_FATAL, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_verbose(log_t log, const char *format, ...)
@@ -869,13 +1338,11 @@ int log_verbose(log_t log, const char *format, ...)
     va_list ap;
     int rc = 0;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_VERBOSE, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_debug(log_t log, const char *format, ...)
@@ -883,13 +1350,11 @@ int log_debug(log_t log, const char *format, ...)
     va_list ap;
     int rc = 0;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(log, LOG_LEVEL_DEBUG, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
 }
 
 int log_printf(const char *format, ...)
@@ -897,11 +1362,20 @@ int log_printf(const char *format, ...)
     va_list ap;
     int rc;
 
-    LOCK();
-
     va_start(ap, format);
     rc = log_helper(LOG_DEFAULT, LOG_LEVEL_DEBUG, format, ap);
     va_end(ap);
 
-    UNLOCK_AND_RETURN_INT(rc);
+    return rc;
+}
+
+/** \brief  Write all queued messages and flush the outputs
+ *
+ * Used before the emulator dies, so nothing logged gets lost.
+ */
+void log_flush(void)
+{
+    LOCK();
+    log_flush_outputs();
+    UNLOCK();
 }
@@ -30,6 +30,8 @@
 
 #include <stdio.h>
 
+#include "types.h"
+
 /* values passed into the log helper (log_out->log_helper) */
 #define LOG_LEVEL_NONE      0x00
 #define LOG_LEVEL_FATAL     0x20
@@ -73,6 +75,12 @@ log_t log_open(const char *id);
 int log_close(log_t log);
 void log_close_all(void);
 
+/* emulated clock for the timestamps (LogTimestamps) */
+void log_set_clock(const CLOCK *clk);
+
+/* write all queued messages (LogAsync) and flush the outputs */
+void log_flush(void);
+
 /* actual log functions */
 
 /* foreground colors */
@@ -39,10 +39,14 @@
 #include "console.h"
 #include "diskimage.h"
 #include "drive.h"
+#include "fastpoweron.h"
 #include "vice-event.h"
 #include "fliplist.h"
+#include "frametrace.h"
 #include "fsdevice.h"
+#include "fuzz.h"
 #include "gfxoutput.h"
+#include "imagecontents.h"
 #include "initcmdline.h"
 #include "interrupt.h"
 #include "joystick.h"
@@ -53,6 +57,7 @@
 #include "machine-video.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "metrics.h"
 #include "mem.h"
 #include "monitor.h"
 #include "monitor_network.h"
@@ -62,6 +67,7 @@
 #include "printer.h"
 #include "profiler.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
 #include "screenshot.h"
 #include "sound.h"
@@ -113,6 +119,11 @@ unsigned int machine_jam(const char *format, ...)
         return JAM_NONE;
     }
 
+    /* a jam only ends the current run of the fuzzing harness */
+    if (fuzz_jam()) {
+        return JAM_NONE;
+    }
+
     is_jammed = true;
 
     va_start(ap, format);
@@ -205,6 +216,9 @@ static void machine_trigger_reset_internal(const unsigned int mode)
 
     switch (mode) {
         case MACHINE_RESET_MODE_POWER_CYCLE:
+            if (fastpoweron_power_cycle()) {
+                break;
+            }
             machine_powerup();
         /* Fall through.  */
         case MACHINE_RESET_MODE_RESET_CPU:
@@ -386,6 +400,7 @@ void machine_shutdown(void)
     gfxoutput_shutdown();
 
     fliplist_shutdown();
+    image_contents_cache_shutdown();
     file_system_shutdown();
     fsdevice_shutdown();
 
@@ -438,6 +453,8 @@ void machine_shutdown(void)
     machine_common_resources_shutdown();
 
     vsync_shutdown();
+    rewind_shutdown();
+    fastpoweron_shutdown();
 
     joystick_resources_shutdown();
     sysfile_resources_shutdown();
@@ -450,6 +467,8 @@ void machine_shutdown(void)
     monitor_network_resources_shutdown();
     monitor_binary_resources_shutdown();
 #endif
+    metrics_shutdown();
+    frametrace_shutdown();
     monitor_resources_shutdown();
 
     archdep_shutdown();
@@ -47,6 +47,7 @@
 #include "console.h"
 #include "debug.h"
 #include "drive.h"
+#include "forkserver.h"
 #include "fullscreen.h"
 #include "gfxoutput.h"
 #include "info.h"
@@ -223,6 +224,9 @@ int main_program(int argc, char **argv)
 
     lib_init();
 
+    tick_init();
+    init_profile_start();
+
     /* create string from the commandline that we can log later */
     cmdline = lib_strdup(argv[0]);
     for (i = 1; i < argc; i++) {
@@ -329,21 +333,25 @@ int main_program(int argc, char **argv)
     }
 
     DBG(("main:early init"));
-    tick_init();
     maincpu_early_init();
     machine_setup_context();
     drive_setup_context();
     machine_early_init();
     DBG(("main:early init done"));
+    init_profile_phase("early init");
 
     /* Initialize system file locator.  */
     sysfile_init(machine_name);
 
     /* generic init, first resources, then cmdline options that use them */
-    if ((init_resources() < 0) ||
-        (init_cmdline_options() < 0)) {
+    if (init_resources() < 0) {
+        return -1;
+    }
+    init_profile_phase("resources");
+    if (init_cmdline_options() < 0) {
         return -1;
     }
+    init_profile_phase("command line options");
 
     /* KLUDGES: this should really get fixed properly, so it can go into the
        regular init function(s) */
@@ -365,6 +373,7 @@ int main_program(int argc, char **argv)
         archdep_startup_log_error("Cannot set defaults.\n");
         return -1;
     }
+    init_profile_phase("factory defaults");
 
     /* Initialize the UI actions system, this needs to happen before the UI
      * init so the UI code can register handlers */
@@ -384,6 +393,7 @@ int main_program(int argc, char **argv)
     if (!console_mode) {
         ui_init_with_args(&argc, argv);
     }
+    init_profile_phase("UI early init");
 
     if ((!help_requested) && (loadconfig)) {
         /* Load the user's default configuration file.  */
@@ -416,11 +426,13 @@ int main_program(int argc, char **argv)
     }
 
     main_log = log_open("Main");
+    init_profile_phase("config file");
 
     DBG(("main:initcmdline_check_args(argc:%d)", argc));
     if (initcmdline_check_args(argc, argv) < 0) {
         return -1;
     }
+    init_profile_phase("command line");
 
     /* Initialize the user interface, 2nd part. */
     DBG(("main:uidata_init(argc:%d)", argc));
@@ -428,6 +440,7 @@ int main_program(int argc, char **argv)
         archdep_startup_log_error("Cannot initialize the UI.\n");
         return -1;
     }
+    init_profile_phase("UI init");
 
     /* VICE boot sequence.  */
     vice_banner();
@@ -451,6 +464,7 @@ int main_program(int argc, char **argv)
     if (/*!console_mode && */video_init() < 0) {
         return -1;
     }
+    init_profile_phase("video init");
 
     if (initcmdline_check_psid() < 0) {
         return -1;
@@ -459,6 +473,12 @@ int main_program(int argc, char **argv)
     if (init_main() < 0) {
         return -1;
     }
+    init_profile_phase("main init");
+
+    /* With -forkserver, only the children for the jobs return here.  */
+    if (forkserver_run() < 0) {
+        return -1;
+    }
 
 #ifdef USE_VICE_THREAD
 
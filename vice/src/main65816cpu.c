@@ -44,6 +44,7 @@
 #include "monitor.h"
 #include "resources.h"
 #include "snapshot.h"
+#include "testrunner.h"
 #include "traps.h"
 #include "types.h"
 #include "wdc65816.h"
@@ -117,30 +118,16 @@ static void maincpu_generic_dma(void)
 
 /* ------------------------------------------------------------------------- */
 
-struct interrupt_cpu_status_s *maincpu_int_status = NULL;
-#ifndef CYCLE_EXACT_ALARM
-alarm_context_t *maincpu_alarm_context = NULL;
-#endif
-monitor_interface_t *maincpu_monitor_interface = NULL;
+/* Clock, alarms, interrupts and last opcode of the CPU.  The RMW flag is
+   an obsolete optimization.  It's always 0 for the 65816 CPU, but has to be
+   kept for the common code.  */
+maincpu_state_t maincpu_state;
 
-/* This flag is an obsolete optimization. It's always 0 for the 65816 CPU,
-   but has to be kept for the common code. */
-int maincpu_rmw_flag = 0;
+monitor_interface_t *maincpu_monitor_interface = NULL;
 
-/* Global clock counter.  */
-CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
 
-/* Information about the last executed opcode.  This is used to know the
-   number of write cycles in the last executed opcode and to delay interrupts
-   by one more cycle if necessary, as happens with conditional branch opcodes
-   when the branch is taken.  */
-unsigned int last_opcode_info;
-
-/* Address of the last executed opcode. This is used by watchpoints. */
-unsigned int last_opcode_addr;
-
 /* Public copy of the CPU registers.  As putting the registers into the
    function makes it faster, you have to generate a `TRAP' interrupt to have
    the values copied into this struct.  */
@@ -220,7 +207,7 @@ void maincpu_early_init(void)
 
 void maincpu_init(void)
 {
-    interrupt_cpu_status_init(maincpu_int_status, &last_opcode_info);
+    interrupt_cpu_status_init(maincpu_int_status, &maincpu_state.last_opcode_info);
 
     /* cpu specific additional init routine */
     CPU_ADDITIONAL_INIT();
@@ -265,9 +252,9 @@ unsigned int reg_pc;
 #endif
 
 static bool bank_base_ready = false;
-static uint8_t *bank_base = NULL;
-static int bank_start = 0;
-static int bank_limit = 0;
+#define bank_base (maincpu_state.bank_base)
+#define bank_start (maincpu_state.bank_start)
+#define bank_limit (maincpu_state.bank_limit)
 static uint8_t bank_bank = 0;
 
 void maincpu_resync_limits(void)
@@ -324,8 +311,8 @@ void maincpu_mainloop(void)
     while (1) {
 
 #define CLK maincpu_clk
-#define LAST_OPCODE_INFO last_opcode_info
-#define LAST_OPCODE_ADDR last_opcode_addr
+#define LAST_OPCODE_INFO (maincpu_state.last_opcode_info)
+#define LAST_OPCODE_ADDR (maincpu_state.last_opcode_addr)
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS maincpu_int_status
@@ -383,10 +370,12 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            testrunner_cycle_limit();
         }
 
-        autostart_advance();
+        if (autostart_advance_needed) {
+            autostart_advance();
+        }
 #if 0
         if (CLK > 246171754)
             debug.maincpu_traceflg = 1;
@@ -476,7 +465,7 @@ int maincpu_snapshot_write_module(snapshot_t *s)
         || SMW_B(m, (uint8_t)WDC65816_REGS_GET_EMUL(&maincpu_regs)) < 0
         || SMW_W(m, (uint16_t)WDC65816_REGS_GET_PC(&maincpu_regs)) < 0
         || SMW_B(m, (uint8_t)WDC65816_REGS_GET_STATUS(&maincpu_regs)) < 0
-        || SMW_DW(m, (uint8_t)last_opcode_info) < 0)
+        || SMW_DW(m, (uint8_t)maincpu_state.last_opcode_info) < 0)
         goto fail;
 
     if (interrupt_write_snapshot(maincpu_int_status, m) < 0) {
@@ -522,7 +511,7 @@ int maincpu_snapshot_read_module(snapshot_t *s)
         || SMR_B(m, &emul) < 0
         || SMR_W(m, &pc) < 0
         || SMR_B(m, &status) < 0
-        || SMR_DW_UINT(m, &last_opcode_info) < 0)
+        || SMR_DW_UINT(m, &maincpu_state.last_opcode_info) < 0)
         goto fail;
 
     WDC65816_REGS_SET_A(&maincpu_regs, a);
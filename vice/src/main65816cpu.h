@@ -27,6 +27,7 @@
 #ifndef VICE_MAIN65816CPU_H
 #define VICE_MAIN65816CPU_H
 
+#include "maincpustate.h"
 #include "types.h"
 
 /* Mask: BA low */
@@ -38,15 +39,12 @@ extern int maincpu_ba_low_flags;
 struct WDC65816_regs_s;
 extern struct WDC65816_regs_s maincpu_regs;
 
-extern CLOCK maincpu_clk;
-
 /* ------------------------------------------------------------------------- */
 
 struct alarm_context_s;
 struct snapshot_s;
 struct monitor_interface_s;
 
-extern struct alarm_context_s *maincpu_alarm_context;
 extern struct monitor_interface_s *maincpu_monitor_interface;
 
 void maincpu_resync_limits(void);
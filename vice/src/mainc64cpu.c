@@ -50,9 +50,11 @@
 #include "mem.h"
 #include "monitor.h"
 #include "mos6510.h"
+#include "perfcounters.h"
 #include "reu.h"
 #include "resources.h"
 #include "snapshot.h"
+#include "testrunner.h"
 #include "traps.h"
 #include "types.h"
 
@@ -261,6 +263,7 @@ inline static void memmap_mem_update(unsigned int addr, int write, int dummy)
 static void memmap_mem_store(unsigned int addr, unsigned int value)
 {
     memmap_mem_update(addr, 1, 0);
+    PERF_COUNT_MEM_WRITE(addr);
     (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
 }
 
@@ -275,6 +278,7 @@ static uint8_t memmap_mem_read(unsigned int addr)
 {
     check_ba();
     memmap_mem_update(addr, 0, 0);
+    PERF_COUNT_MEM_READ(addr);
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
@@ -359,6 +363,7 @@ static uint8_t memmap_mem_read_dummy(unsigned int addr)
 inline static uint8_t mem_read_check_ba(unsigned int addr)
 {
     check_ba();
+    PERF_COUNT_MEM_READ(addr);
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
@@ -371,6 +376,7 @@ inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
 #ifndef STORE
 #define STORE(addr, value) \
     if (reu_dma_triggered == 0) { \
+        PERF_COUNT_MEM_WRITE(addr); \
         (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value)); \
         if (addr == 0xff00) { \
             reu_dma(-1); \
@@ -468,22 +474,12 @@ static void maincpu_generic_dma(void)
 
 /* ------------------------------------------------------------------------- */
 
-struct interrupt_cpu_status_s *maincpu_int_status = NULL;
-alarm_context_t *maincpu_alarm_context = NULL;
-monitor_interface_t *maincpu_monitor_interface = NULL;
-
-/* This flag is an obsolete optimization. It's always 0 for the x64sc CPU,
-   but has to be kept for the common code. */
-int maincpu_rmw_flag = 0;
-
-/* Information about the last executed opcode.  This is used to know the
-   number of write cycles in the last executed opcode and to delay interrupts
-   by one more cycle if necessary, as happens with conditional branch opcodes
-   when the branch is taken.  */
-unsigned int last_opcode_info;
+/* Clock, alarms, interrupts and last opcode of the CPU.  The RMW flag is
+   an obsolete optimization.  It's always 0 for the x64sc CPU, but has to be
+   kept for the common code.  */
+maincpu_state_t maincpu_state;
 
-/* Address of the last executed opcode. This is used by watchpoints. */
-unsigned int last_opcode_addr;
+monitor_interface_t *maincpu_monitor_interface = NULL;
 
 /* Number of write cycles for each 6510 opcode.  */
 const CLOCK maincpu_opcode_write_cycles[] = {
@@ -617,7 +613,7 @@ void maincpu_early_init(void)
 
 void maincpu_init(void)
 {
-    interrupt_cpu_status_init(maincpu_int_status, &last_opcode_info);
+    interrupt_cpu_status_init(maincpu_int_status, &maincpu_state.last_opcode_info);
 
     /* cpu specifix additional init routine */
     CPU_ADDITIONAL_INIT();
@@ -717,9 +713,9 @@ unsigned int reg_pc;
 #endif
 
 static bool bank_base_ready = false;
-static uint8_t *bank_base = NULL;
-static int bank_start = 0;
-static int bank_limit = 0;
+#define bank_base (maincpu_state.bank_base)
+#define bank_start (maincpu_state.bank_start)
+#define bank_limit (maincpu_state.bank_limit)
 
 void maincpu_resync_limits(void)
 {
@@ -740,6 +736,7 @@ void maincpu_mainloop(void)
     uint8_t reg_sp = 0;
     uint8_t flag_n = 0;
     uint8_t flag_z = 0;
+    uint8_t flag_c = 0;
 #ifndef NEED_REG_PC
     /* FIXME: this should really be uint16_t, but it breaks things (eg trap17.prg) */
     unsigned int reg_pc;
@@ -761,8 +758,8 @@ void maincpu_mainloop(void)
 #define CPU_IS_JAMMED maincpu_jammed
 #define CLK maincpu_clk
 #define RMW_FLAG maincpu_rmw_flag
-#define LAST_OPCODE_INFO last_opcode_info
-#define LAST_OPCODE_ADDR last_opcode_addr
+#define LAST_OPCODE_INFO (maincpu_state.last_opcode_info)
+#define LAST_OPCODE_ADDR (maincpu_state.last_opcode_addr)
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS maincpu_int_status
@@ -812,10 +809,12 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(maincpu_log, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            testrunner_cycle_limit();
         }
 
-        autostart_advance();
+        if (autostart_advance_needed) {
+            autostart_advance();
+        }
 #if 0
         if (CLK > 246171754) {
             debug.maincpu_traceflg = 1;
@@ -902,7 +901,7 @@ int maincpu_snapshot_write_module(snapshot_t *s)
         || SMW_B(m, MOS6510_REGS_GET_SP(&maincpu_regs)) < 0
         || SMW_W(m, (uint16_t)MOS6510_REGS_GET_PC(&maincpu_regs)) < 0
         || SMW_B(m, (uint8_t)MOS6510_REGS_GET_STATUS(&maincpu_regs)) < 0
-        || SMW_DW(m, (uint32_t)last_opcode_info) < 0
+        || SMW_DW(m, (uint32_t)maincpu_state.last_opcode_info) < 0
         || SMW_DW(m, (uint32_t)ane_log_level) < 0
         || SMW_DW(m, (uint32_t)lxa_log_level) < 0
         || SMW_DW(m, (uint32_t)maincpu_jammed) < 0
@@ -951,7 +950,7 @@ int maincpu_snapshot_read_module(snapshot_t *s)
         || SMR_B(m, &sp) < 0
         || SMR_W(m, &pc) < 0
         || SMR_B(m, &status) < 0
-        || SMR_DW_UINT(m, &last_opcode_info) < 0
+        || SMR_DW_UINT(m, &maincpu_state.last_opcode_info) < 0
         || SMR_DW_INT(m, &ane_log_level) < 0
         || SMR_DW_INT(m, &lxa_log_level) < 0
         || SMR_DW_INT(m, &maincpu_jammed) < 0
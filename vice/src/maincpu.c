@@ -47,10 +47,12 @@
 #else
 #include "mos6510.h"
 #endif
+#include "perfcounters.h"
 #include "h6809regs.h"
 #include "snapshot.h"
 #include "resources.h"
 #include "cmdline.h"
+#include "testrunner.h"
 #include "traps.h"
 #include "types.h"
 
@@ -235,32 +237,14 @@ static void maincpu_generic_dma(void)
 
 /* ------------------------------------------------------------------------- */
 
-struct interrupt_cpu_status_s *maincpu_int_status = NULL;
-#ifndef CYCLE_EXACT_ALARM
-alarm_context_t *maincpu_alarm_context = NULL;
-#endif
+/* Clock, alarms, interrupts and last opcode of the CPU.  */
+maincpu_state_t maincpu_state;
+
 monitor_interface_t *maincpu_monitor_interface = NULL;
 
-/* Global clock counter.  */
-CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
 
-/* This is flag is set to 1 each time a Read-Modify-Write instructions that
-   accesses memory is executed.  We can emulate the RMW behaviour of the 6510
-   this way.  VERY important notice: Always assign 1 for true, 0 for false!
-   Some functions depend on this to do some optimization.  */
-int maincpu_rmw_flag = 0;
-
-/* Information about the last executed opcode.  This is used to know the
-   number of write cycles in the last executed opcode and to delay interrupts
-   by one more cycle if necessary, as happens with conditional branch opcodes
-   when the branch is taken.  */
-unsigned int last_opcode_info;
-
-/* Address of the last executed opcode. This is used by watchpoints. */
-unsigned int last_opcode_addr;
-
 /* Number of write cycles for each 6510 opcode.  */
 const CLOCK maincpu_opcode_write_cycles[] = {
             /* 0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
@@ -411,7 +395,7 @@ void maincpu_early_init(void)
 
 void maincpu_init(void)
 {
-    interrupt_cpu_status_init(maincpu_int_status, &last_opcode_info);
+    interrupt_cpu_status_init(maincpu_int_status, &maincpu_state.last_opcode_info);
 
     /* cpu specifix additional init routine */
     CPU_ADDITIONAL_INIT();
@@ -512,9 +496,9 @@ unsigned int reg_pc;
 #endif
 
 static bool bank_base_ready = false;
-static uint8_t *bank_base = NULL;
-static int bank_start = 0;
-static int bank_limit = 0;
+#define bank_base (maincpu_state.bank_base)
+#define bank_start (maincpu_state.bank_start)
+#define bank_limit (maincpu_state.bank_limit)
 
 void maincpu_resync_limits(void)
 {
@@ -568,6 +552,7 @@ void maincpu_mainloop(void)
     uint8_t reg_sp = 0;
     uint8_t flag_n = 0;
     uint8_t flag_z = 0;
+    uint8_t flag_c = 0;
 #ifndef NEED_REG_PC
     unsigned int reg_pc;
 #endif
@@ -588,8 +573,8 @@ void maincpu_mainloop(void)
 #define CPU_IS_JAMMED maincpu_jammed
 #define CLK maincpu_clk
 #define RMW_FLAG maincpu_rmw_flag
-#define LAST_OPCODE_INFO last_opcode_info
-#define LAST_OPCODE_ADDR last_opcode_addr
+#define LAST_OPCODE_INFO (maincpu_state.last_opcode_info)
+#define LAST_OPCODE_ADDR (maincpu_state.last_opcode_addr)
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS maincpu_int_status
@@ -639,10 +624,12 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(1);
+            testrunner_cycle_limit();
         }
 
-        autostart_advance();
+        if (autostart_advance_needed) {
+            autostart_advance();
+        }
 #if 0
         if (CLK > 246171754) {
             debug.maincpu_traceflg = 1;
@@ -799,7 +786,7 @@ int maincpu_snapshot_write_module(snapshot_t *s)
             || SMW_BA(m, burst_cache, 4) < 0
             || SMW_W(m, burst_addr) < 0
             || SMW_DW(m, dtvclockneg) < 0
-            || SMW_DW(m, (uint32_t)last_opcode_info) < 0
+            || SMW_DW(m, (uint32_t)maincpu_state.last_opcode_info) < 0
             || SMW_DW(m, (uint32_t)ane_log_level) < 0
             || SMW_DW(m, (uint32_t)lxa_log_level) < 0
         ) {
@@ -813,7 +800,7 @@ int maincpu_snapshot_write_module(snapshot_t *s)
             || SMW_B(m, MOS6510_REGS_GET_SP(&maincpu_regs)) < 0
             || SMW_W(m, (uint16_t)MOS6510_REGS_GET_PC(&maincpu_regs)) < 0
             || SMW_B(m, (uint8_t)MOS6510_REGS_GET_STATUS(&maincpu_regs)) < 0
-            || SMW_DW(m, (uint32_t)last_opcode_info) < 0
+            || SMW_DW(m, (uint32_t)maincpu_state.last_opcode_info) < 0
             || SMW_DW(m, (uint32_t)ane_log_level) < 0
             || SMW_DW(m, (uint32_t)lxa_log_level) < 0
         ) {
@@ -884,7 +871,7 @@ int maincpu_snapshot_read_module(snapshot_t *s)
             || SMR_W(m, &burst_addr) < 0
             || SMR_DW_INT(m, &dtvclockneg) < 0
 #endif
-            || SMR_DW_UINT(m, &last_opcode_info) < 0
+            || SMR_DW_UINT(m, &maincpu_state.last_opcode_info) < 0
             || SMR_DW_INT(m, &ane_log_level) < 0
             || SMR_DW_INT(m, &lxa_log_level) < 0
         ) {
@@ -28,14 +28,11 @@
 #ifndef VICE_MAINCPU_H
 #define VICE_MAINCPU_H
 
+#include "maincpustate.h"
 #include "mainlock.h"
 #include "types.h"
 #include "vsyncapi.h"
 
-/* Information about the last opcode executed by the main CPU.  */
-extern unsigned int last_opcode_info;
-extern unsigned int last_opcode_addr;
-
 /* Masks to extract information. */
 #define OPINFO_NUMBER_MSK               0xff
 
@@ -55,8 +52,6 @@ struct mos6510_regs_s;
 extern struct mos6510_regs_s maincpu_regs;
 #endif
 
-extern int maincpu_rmw_flag;
-extern CLOCK maincpu_clk;
 extern CLOCK maincpu_clk_limit;
 
 /* 8502 cycle stretch indicator */
@@ -77,12 +72,10 @@ struct snapshot_s;
 struct monitor_interface_s;
 
 extern const CLOCK maincpu_opcode_write_cycles[];
-extern struct alarm_context_s *maincpu_alarm_context;
-extern CLOCK maincpu_clk;
 extern struct monitor_interface_s *maincpu_monitor_interface;
 
 /* Return the number of write accesses in the last opcode emulated. */
-#define maincpu_num_write_cycles() maincpu_opcode_write_cycles[OPINFO_NUMBER(last_opcode_info)]
+#define maincpu_num_write_cycles() maincpu_opcode_write_cycles[OPINFO_NUMBER(maincpu_state.last_opcode_info)]
 
 void maincpu_resync_limits(void);
 void maincpu_init(void);
@@ -0,0 +1,80 @@
+/*
+ * maincpustate.h - State of the main CPU used outside of its loop.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MAINCPUSTATE_H
+#define VICE_MAINCPUSTATE_H
+
+#include "types.h"
+
+#ifdef __GNUC__
+#define MAINCPU_STATE_ALIGN __attribute__((aligned(64)))
+#else
+#define MAINCPU_STATE_ALIGN
+#endif
+
+struct alarm_context_s;
+struct interrupt_cpu_status_s;
+
+/* The part of the main CPU state that is touched on every instruction and
+   by every chip access, kept together in one cache line.  The registers
+   themselves stay in locals of the CPU loop.  */
+typedef struct maincpu_state_s {
+    /* Global clock counter.  */
+    CLOCK clk;
+
+    /* Alarms of the main CPU, the clock of the next one is checked after
+       every instruction.  */
+    struct alarm_context_s *alarm_context;
+
+    /* Pending interrupts of the main CPU.  */
+    struct interrupt_cpu_status_s *int_status;
+
+    /* Memory the opcodes are fetched from directly, if any.  */
+    uint8_t *bank_base;
+    int bank_start;
+    int bank_limit;
+
+    /* Information about the last executed opcode.  This is used to know the
+       number of write cycles in the last executed opcode and to delay
+       interrupts by one more cycle if necessary, as happens with conditional
+       branch opcodes when the branch is taken.  */
+    unsigned int last_opcode_info;
+
+    /* Address of the last executed opcode. This is used by watchpoints. */
+    unsigned int last_opcode_addr;
+
+    /* This is flag is set to 1 each time a Read-Modify-Write instructions
+       that accesses memory is executed.  We can emulate the RMW behaviour of
+       the 6510 this way.  VERY important notice: Always assign 1 for true, 0
+       for false!  Some functions depend on this to do some optimization.  */
+    int rmw_flag;
+} MAINCPU_STATE_ALIGN maincpu_state_t;
+
+extern maincpu_state_t maincpu_state;
+
+#define maincpu_clk             (maincpu_state.clk)
+#define maincpu_alarm_context   (maincpu_state.alarm_context)
+#define maincpu_int_status      (maincpu_state.int_status)
+#define maincpu_rmw_flag        (maincpu_state.rmw_flag)
+
+#endif
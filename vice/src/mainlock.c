@@ -43,6 +43,7 @@
 
 #include "archdep.h"
 #include "debug.h"
+#include "frametrace.h"
 #include "log.h"
 #include "machine.h"
 #include "mainlock.h"
@@ -176,7 +177,9 @@ void mainlock_yield_begin(void)
         /* Wake up the UI thread */
         pthread_cond_signal(&ui_waiting_cond);
         /* Block until the UI has the main lock */
+        FRAMETRACE_BEGIN(FRAMETRACE_MAINLOCK);
         pthread_cond_wait(&ui_has_lock_cond, &internal_lock);
+        FRAMETRACE_END(FRAMETRACE_MAINLOCK);
     }
     pthread_mutex_unlock(&internal_lock);
 }
@@ -232,6 +235,8 @@ void mainlock_obtain(void)
         return;
     }
 
+    FRAMETRACE_BEGIN(FRAMETRACE_MAINLOCK);
+
     pthread_mutex_lock(&internal_lock);
 
     if (vice_thread_is_running) {
@@ -246,6 +251,8 @@ void mainlock_obtain(void)
     /* Get the main lock */
     pthread_mutex_lock(&main_lock);
 
+    FRAMETRACE_END(FRAMETRACE_MAINLOCK);
+
     /* Let the VICE thread know we have the mainlock now */
     pthread_cond_signal(&ui_has_lock_cond);
 }
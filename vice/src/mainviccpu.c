@@ -41,9 +41,11 @@
 #include "mem.h"
 #include "monitor.h"
 #include "mos6510.h"
+#include "perfcounters.h"
 #include "snapshot.h"
 #include "resources.h"
 #include "cmdline.h"
+#include "testrunner.h"
 #include "traps.h"
 #include "types.h"
 
@@ -295,22 +297,12 @@ static void maincpu_generic_dma(void)
 
 /* ------------------------------------------------------------------------- */
 
-struct interrupt_cpu_status_s *maincpu_int_status = NULL;
-alarm_context_t *maincpu_alarm_context = NULL;
-monitor_interface_t *maincpu_monitor_interface = NULL;
-
-/* This flag is an obsolete optimization. It's always 0 for the VIC-20 CPU,
-   but has to be kept for the common code. */
-int maincpu_rmw_flag = 0;
-
-/* Information about the last executed opcode.  This is used to know the
-   number of write cycles in the last executed opcode and to delay interrupts
-   by one more cycle if necessary, as happens with conditional branch opcodes
-   when the branch is taken.  */
-unsigned int last_opcode_info;
+/* Clock, alarms, interrupts and last opcode of the CPU.  The RMW flag is
+   an obsolete optimization.  It's always 0 for the VIC-20 CPU, but has to be
+   kept for the common code.  */
+maincpu_state_t maincpu_state;
 
-/* Address of the last executed opcode. This is used by watchpoints. */
-unsigned int last_opcode_addr;
+monitor_interface_t *maincpu_monitor_interface = NULL;
 
 /* Number of write cycles for each 6510 opcode.  */
 const CLOCK maincpu_opcode_write_cycles[] = {
@@ -443,7 +435,7 @@ void maincpu_early_init(void)
 
 void maincpu_init(void)
 {
-    interrupt_cpu_status_init(maincpu_int_status, &last_opcode_info);
+    interrupt_cpu_status_init(maincpu_int_status, &maincpu_state.last_opcode_info);
 
     /* cpu specifix additional init routine */
     CPU_ADDITIONAL_INIT();
@@ -544,9 +536,9 @@ unsigned int reg_pc;
 #endif
 
 static bool bank_base_ready = false;
-static uint8_t *bank_base;
-static int bank_start = 0;
-static int bank_limit = 0;
+#define bank_base (maincpu_state.bank_base)
+#define bank_start (maincpu_state.bank_start)
+#define bank_limit (maincpu_state.bank_limit)
 
 void maincpu_resync_limits(void)
 {
@@ -567,6 +559,7 @@ void maincpu_mainloop(void)
     uint8_t reg_sp = 0;
     uint8_t flag_n = 0;
     uint8_t flag_z = 0;
+    uint8_t flag_c = 0;
 #ifndef NEED_REG_PC
     /* FIXME: this should really be uint16_t, but it breaks things (eg trap17.prg) */
     unsigned int reg_pc;
@@ -588,8 +581,8 @@ void maincpu_mainloop(void)
 #define CPU_IS_JAMMED maincpu_jammed
 #define CLK maincpu_clk
 #define RMW_FLAG maincpu_rmw_flag
-#define LAST_OPCODE_INFO last_opcode_info
-#define LAST_OPCODE_ADDR last_opcode_addr
+#define LAST_OPCODE_INFO (maincpu_state.last_opcode_info)
+#define LAST_OPCODE_ADDR (maincpu_state.last_opcode_addr)
 #define TRACEFLG debug.maincpu_traceflg
 
 #define CPU_INT_STATUS maincpu_int_status
@@ -639,10 +632,12 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            testrunner_cycle_limit();
         }
 
-        autostart_advance();
+        if (autostart_advance_needed) {
+            autostart_advance();
+        }
 #if 0
         if (CLK > 246171754) {
             debug.maincpu_traceflg = 1;
@@ -729,7 +724,7 @@ int maincpu_snapshot_write_module(snapshot_t *s)
         || SMW_B(m, MOS6510_REGS_GET_SP(&maincpu_regs)) < 0
         || SMW_W(m, (uint16_t)MOS6510_REGS_GET_PC(&maincpu_regs)) < 0
         || SMW_B(m, (uint8_t)MOS6510_REGS_GET_STATUS(&maincpu_regs)) < 0
-        || SMW_DW(m, (uint32_t)last_opcode_info) < 0
+        || SMW_DW(m, (uint32_t)maincpu_state.last_opcode_info) < 0
         || SMW_DW(m, (uint32_t)ane_log_level) < 0
         || SMW_DW(m, (uint32_t)lxa_log_level) < 0
         || SMW_DW(m, (uint32_t)maincpu_jammed) < 0) {
@@ -777,7 +772,7 @@ int maincpu_snapshot_read_module(snapshot_t *s)
         || SMR_B(m, &sp) < 0
         || SMR_W(m, &pc) < 0
         || SMR_B(m, &status) < 0
-        || SMR_DW_UINT(m, &last_opcode_info) < 0
+        || SMR_DW_UINT(m, &maincpu_state.last_opcode_info) < 0
         || SMR_DW_INT(m, &ane_log_level) < 0
         || SMR_DW_INT(m, &lxa_log_level) < 0
         || SMR_DW_INT(m, &maincpu_jammed) < 0) {
@@ -0,0 +1,492 @@
+/*
+ * metrics.c - Live health metrics of the emulator.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* A fixed set of counters, gauges and histograms, updated by the parts of
+   the emulator they describe with relaxed atomic operations, so they can be
+   updated from any thread and cost next to nothing.  Gauges are doubles
+   kept in the bits of a 64-bit integer.
+
+   The metrics are read with the binary monitor, and with "-metricsserver"
+   served in the Prometheus text format over HTTP.  The server is polled at
+   the end of every frame, it answers one request per connection.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep_defs.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "metrics.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+#include "vicesocket.h"
+
+typedef struct metric_s {
+    const char *name;
+    const char *help;
+    metric_type_t type;
+    const uint64_t *bounds;
+    atomic_uint_least64_t value;    /* counter, bits of a gauge, histogram sum */
+    atomic_uint_least64_t buckets[METRIC_HISTOGRAM_BUCKETS];
+} metric_t;
+
+/* Microseconds, 60 Hz and 50 Hz frames are 16667 and 20000 */
+static const uint64_t frame_time_bounds[METRIC_HISTOGRAM_BUCKETS - 1] = {
+    2500, 5000, 10000, 16667, 20000, 25000, 33333, 50000, 100000
+};
+
+/* Main CPU cycles */
+static const uint64_t catchup_bounds[METRIC_HISTOGRAM_BUCKETS - 1] = {
+    1, 4, 16, 64, 256, 1024, 4096, 16384, 65536
+};
+
+static metric_t metrics[METRIC_NUM] = {
+    { .name = "vice_speed_percent",
+      .help = "Emulation speed in percent of the real machine",
+      .type = METRIC_GAUGE, .bounds = NULL },
+    { .name = "vice_frames_per_second",
+      .help = "Emulated frames per second",
+      .type = METRIC_GAUGE, .bounds = NULL },
+    { .name = "vice_frames_total",
+      .help = "Emulated frames",
+      .type = METRIC_COUNTER, .bounds = NULL },
+    { .name = "vice_frame_time_microseconds",
+      .help = "Host time taken by an emulated frame",
+      .type = METRIC_HISTOGRAM, .bounds = frame_time_bounds },
+    { .name = "vice_audio_underruns_total",
+      .help = "Times the sound device ran out of samples",
+      .type = METRIC_COUNTER, .bounds = NULL },
+    { .name = "vice_sound_buffer_fill_percent",
+      .help = "Fill of the sound device buffer",
+      .type = METRIC_GAUGE, .bounds = NULL },
+    { .name = "vice_drive_catchup_cycles",
+      .help = "Cycles a drive was behind the main CPU when catching up",
+      .type = METRIC_HISTOGRAM, .bounds = catchup_bounds },
+    { .name = "vice_render_queue_depth",
+      .help = "Frames waiting to be displayed",
+      .type = METRIC_GAUGE, .bounds = NULL }
+};
+
+static uint64_t double_to_bits(double value)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bits_to_double(uint64_t bits)
+{
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/** \brief  Add to a counter
+ *
+ * \param[in]   id  METRIC_* counter
+ * \param[in]   n   amount to add
+ */
+void metrics_counter_add(int id, uint64_t n)
+{
+    atomic_fetch_add_explicit(&metrics[id].value, n, memory_order_relaxed);
+}
+
+/** \brief  Set a gauge
+ *
+ * \param[in]   id      METRIC_* gauge
+ * \param[in]   value   new value
+ */
+void metrics_gauge_set(int id, double value)
+{
+    atomic_store_explicit(&metrics[id].value, double_to_bits(value), memory_order_relaxed);
+}
+
+/** \brief  Add to a gauge
+ *
+ * \param[in]   id      METRIC_* gauge
+ * \param[in]   delta   amount to add, may be negative
+ */
+void metrics_gauge_add(int id, double delta)
+{
+    uint64_t old = atomic_load_explicit(&metrics[id].value, memory_order_relaxed);
+
+    while (!atomic_compare_exchange_weak_explicit(&metrics[id].value, &old,
+                                                  double_to_bits(bits_to_double(old) + delta),
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/** \brief  Count a value in a histogram
+ *
+ * \param[in]   id      METRIC_* histogram
+ * \param[in]   value   value observed
+ */
+void metrics_histogram_observe(int id, uint64_t value)
+{
+    metric_t *m = &metrics[id];
+    int i;
+
+    for (i = 0; i < METRIC_HISTOGRAM_BUCKETS - 1 && value > m->bounds[i]; i++) {
+    }
+    atomic_fetch_add_explicit(&m->buckets[i], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->value, value, memory_order_relaxed);
+}
+
+/** \brief  Get the current state of a metric
+ *
+ * \param[in]   id      METRIC_* metric
+ * \param[out]  value   state of the metric
+ */
+void metrics_get(int id, metric_value_t *value)
+{
+    metric_t *m = &metrics[id];
+    uint64_t bits = atomic_load_explicit(&m->value, memory_order_relaxed);
+    uint64_t total = 0;
+    int i;
+
+    memset(value, 0, sizeof(metric_value_t));
+    value->name = m->name;
+    value->help = m->help;
+    value->type = m->type;
+
+    switch (m->type) {
+        case METRIC_COUNTER:
+            value->value = (double)bits;
+            break;
+        case METRIC_GAUGE:
+            value->value = bits_to_double(bits);
+            break;
+        case METRIC_HISTOGRAM:
+            value->sum = bits;
+            value->bounds = m->bounds;
+            for (i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+                total += atomic_load_explicit(&m->buckets[i], memory_order_relaxed);
+                value->buckets[i] = total;
+            }
+            /* the buckets may have moved on while reading them */
+            value->count = total;
+            break;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct text_buffer_s {
+    char *buf;
+    size_t len;
+    size_t size;
+} text_buffer_t;
+
+static void text_printf(text_buffer_t *text, const char *format, ...) VICE_ATTR_PRINTF2;
+
+static void text_printf(text_buffer_t *text, const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    for (;;) {
+        va_start(ap, format);
+        n = vsnprintf(text->buf + text->len, text->size - text->len, format, ap);
+        va_end(ap);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < text->size - text->len) {
+            text->len += (size_t)n;
+            return;
+        }
+        text->size = text->size * 2 + (size_t)n;
+        text->buf = lib_realloc(text->buf, text->size);
+    }
+}
+
+/** \brief  Format all metrics in the Prometheus text format
+ *
+ * \return  text, to be freed with lib_free()
+ */
+char *metrics_text(void)
+{
+    static const char * const type_names[] = { "counter", "gauge", "histogram" };
+    text_buffer_t text;
+    metric_value_t value;
+    int id, i;
+
+    text.size = 4096;
+    text.buf = lib_malloc(text.size);
+    text.buf[0] = '\0';
+    text.len = 0;
+
+    for (id = 0; id < METRIC_NUM; id++) {
+        metrics_get(id, &value);
+        text_printf(&text, "# HELP %s %s\n# TYPE %s %s\n",
+                    value.name, value.help, value.name, type_names[value.type]);
+        if (value.type != METRIC_HISTOGRAM) {
+            text_printf(&text, "%s %.15g\n", value.name, value.value);
+            continue;
+        }
+        for (i = 0; i < METRIC_HISTOGRAM_BUCKETS - 1; i++) {
+            text_printf(&text, "%s_bucket{le=\"%"PRIu64"\"} %"PRIu64"\n",
+                        value.name, value.bounds[i], value.buckets[i]);
+        }
+        text_printf(&text, "%s_bucket{le=\"+Inf\"} %"PRIu64"\n", value.name, value.count);
+        text_printf(&text, "%s_sum %"PRIu64"\n", value.name, value.sum);
+        text_printf(&text, "%s_count %"PRIu64"\n", value.name, value.count);
+    }
+
+    return text.buf;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef HAVE_NETWORK
+
+/* Frames to wait for the request of a client before giving up on it */
+#define METRICS_CLIENT_TIMEOUT  250
+
+static int metrics_server_enabled = 0;
+static char *metrics_server_address = NULL;
+
+static vice_network_socket_t *listen_socket = NULL;
+static vice_network_socket_t *client_socket = NULL;
+static int client_frames = 0;
+
+static void send_all(vice_network_socket_t *sock, const char *data, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = vice_network_send(sock, data, len, 0);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void client_close(void)
+{
+    if (client_socket != NULL) {
+        vice_network_socket_close(client_socket);
+        client_socket = NULL;
+    }
+}
+
+/* Answer the request of the client, only the first line is looked at.  */
+static void client_answer(void)
+{
+    char request[512];
+    char header[160];
+    char *body;
+    ssize_t n;
+
+    n = vice_network_receive(client_socket, request, sizeof(request) - 1, 0);
+    if (n <= 0) {
+        client_close();
+        return;
+    }
+    request[n] = '\0';
+
+    if (strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0) {
+        body = metrics_text();
+        snprintf(header, sizeof(header),
+                 "HTTP/1.0 200 OK\r\n"
+                 "Content-Type: text/plain; version=0.0.4\r\n"
+                 "Content-Length: %"PRI_SIZE_T"\r\n"
+                 "Connection: close\r\n\r\n", strlen(body));
+        send_all(client_socket, header, strlen(header));
+        send_all(client_socket, body, strlen(body));
+        lib_free(body);
+    } else {
+        snprintf(header, sizeof(header),
+                 "HTTP/1.0 404 Not Found\r\n"
+                 "Content-Length: 0\r\n"
+                 "Connection: close\r\n\r\n");
+        send_all(client_socket, header, strlen(header));
+    }
+
+    client_close();
+}
+
+static int metrics_server_activate(void)
+{
+    vice_network_socket_address_t *server_addr;
+
+    if (metrics_server_address == NULL) {
+        return -1;
+    }
+    server_addr = vice_network_address_generate(metrics_server_address, 0);
+    if (server_addr == NULL) {
+        return -1;
+    }
+    listen_socket = vice_network_server(server_addr);
+    vice_network_address_close(server_addr);
+    if (listen_socket == NULL) {
+        log_error(LOG_DEFAULT, "Cannot start the metrics server on `%s'.", metrics_server_address);
+        return -1;
+    }
+    return 0;
+}
+
+static void metrics_server_deactivate(void)
+{
+    client_close();
+    if (listen_socket != NULL) {
+        vice_network_socket_close(listen_socket);
+        listen_socket = NULL;
+    }
+}
+
+static int set_metrics_server_enabled(int value, void *param)
+{
+    int val = value ? 1 : 0;
+
+    if (val && !metrics_server_enabled) {
+        if (metrics_server_activate() < 0) {
+            return -1;
+        }
+    } else if (!val && metrics_server_enabled) {
+        metrics_server_deactivate();
+    }
+    metrics_server_enabled = val;
+    return 0;
+}
+
+static int set_metrics_server_address(const char *name, void *param)
+{
+    if (metrics_server_address != NULL && name != NULL
+        && strcmp(name, metrics_server_address) == 0) {
+        return 0;
+    }
+
+    if (metrics_server_enabled) {
+        metrics_server_deactivate();
+    }
+    util_string_set(&metrics_server_address, name);
+    if (metrics_server_enabled) {
+        metrics_server_activate();
+    }
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "MetricsServerAddress", "ip4://127.0.0.1:6503", RES_EVENT_NO, NULL,
+      &metrics_server_address, set_metrics_server_address, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "MetricsServer", 0, RES_EVENT_NO, NULL,
+      &metrics_server_enabled, set_metrics_server_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-metricsserver", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MetricsServer", (resource_value_t)1,
+      NULL, "Serve the emulator metrics over HTTP" },
+    { "+metricsserver", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MetricsServer", (resource_value_t)0,
+      NULL, "Do not serve the emulator metrics over HTTP" },
+    { "-metricsserveraddress", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "MetricsServerAddress", NULL,
+      "<Name>", "The local address the metrics server should bind to" },
+    CMDLINE_LIST_END
+};
+
+int metrics_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+    return resources_register_int(resources_int);
+}
+
+int metrics_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void metrics_shutdown(void)
+{
+    metrics_server_deactivate();
+    lib_free(metrics_server_address);
+    metrics_server_address = NULL;
+}
+
+/** \brief  End of frame hook, answers the metrics server clients */
+void metrics_do_vsync(void)
+{
+    if (listen_socket == NULL) {
+        return;
+    }
+
+    if (client_socket != NULL) {
+        if (vice_network_select_poll_one(client_socket)) {
+            client_answer();
+        } else if (++client_frames >= METRICS_CLIENT_TIMEOUT) {
+            client_close();
+        }
+        return;
+    }
+
+    if (vice_network_select_poll_one(listen_socket)) {
+        client_socket = vice_network_accept(listen_socket);
+        client_frames = 0;
+        if (client_socket != NULL && vice_network_select_poll_one(client_socket)) {
+            client_answer();
+        }
+    }
+}
+
+#else
+
+int metrics_resources_init(void)
+{
+    return 0;
+}
+
+int metrics_cmdline_options_init(void)
+{
+    return 0;
+}
+
+void metrics_shutdown(void)
+{
+}
+
+void metrics_do_vsync(void)
+{
+}
+
+#endif
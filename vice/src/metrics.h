@@ -0,0 +1,78 @@
+/*
+ * metrics.h - Live health metrics of the emulator.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_METRICS_H
+#define VICE_METRICS_H
+
+#include "types.h"
+
+/* Metrics, also used as IDs by the binary monitor.  */
+enum {
+    METRIC_SPEED_PERCENT = 0,       /* gauge */
+    METRIC_FRAMES_PER_SECOND,       /* gauge */
+    METRIC_FRAMES,                  /* counter */
+    METRIC_FRAME_TIME,              /* histogram, microseconds */
+    METRIC_AUDIO_UNDERRUNS,         /* counter */
+    METRIC_SOUND_BUFFER_FILL,       /* gauge, percent */
+    METRIC_DRIVE_CATCHUP,           /* histogram, cycles */
+    METRIC_RENDER_QUEUE_DEPTH,      /* gauge */
+    METRIC_NUM
+};
+
+typedef enum metric_type_e {
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} metric_type_t;
+
+/* Buckets of a histogram, the last one is the implicit +Inf one */
+#define METRIC_HISTOGRAM_BUCKETS    10
+
+/* Snapshot of a metric.  For a histogram the bucket counts are cumulative
+   like in the Prometheus text format.  */
+typedef struct metric_value_s {
+    const char *name;
+    const char *help;
+    metric_type_t type;
+    double value;                                   /* counter, gauge */
+    uint64_t count;                                 /* histogram */
+    uint64_t sum;                                   /* histogram */
+    const uint64_t *bounds;                         /* histogram, METRIC_HISTOGRAM_BUCKETS - 1 */
+    uint64_t buckets[METRIC_HISTOGRAM_BUCKETS];     /* histogram */
+} metric_value_t;
+
+void metrics_counter_add(int id, uint64_t n);
+void metrics_gauge_set(int id, double value);
+void metrics_gauge_add(int id, double delta);
+void metrics_histogram_observe(int id, uint64_t value);
+
+void metrics_get(int id, metric_value_t *value);
+char *metrics_text(void);
+
+int metrics_resources_init(void);
+int metrics_cmdline_options_init(void);
+void metrics_shutdown(void);
+
+void metrics_do_vsync(void);
+
+#endif
@@ -30,6 +30,7 @@
 #include "vice.h"
 
 #ifdef HAVE_MIDI
+#include <pthread.h>
 #include <stdio.h>
 
 #include "alarm.h"
@@ -123,6 +124,175 @@ static uint8_t midi_last_read = 0;  /* the byte read the last time (for RMW) */
 
 /******************************************************************/
 
+/* The MIDI devices are read and written by a thread of their own, the
+   emulated ACIA only takes the received bytes from a queue and puts the
+   ones to send into another one.  So a device that is slow to accept
+   data, or the time taken to look for new data, does not hold up the
+   emulation, and a burst of received bytes (a SysEx dump) waits in the
+   queue until the ACIA takes it at the rate of the emulated line.
+
+   The driver functions are only called with midi_io_lock held; the
+   drivers take it themselves around reopening the devices when their
+   settings change.  */
+
+/* Sizes of the queues, powers of two.  */
+#define MIDI_RX_QUEUE_SIZE  0x4000
+#define MIDI_TX_QUEUE_SIZE  0x1000
+
+/* Time the thread sleeps when there is nothing to do.  */
+#define MIDI_IDLE_TICKS     (TICK_PER_SECOND / 1000)
+
+static pthread_mutex_t midi_io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t io_thread;
+static int io_thread_running = 0;
+static volatile int io_thread_stop = 0;
+
+static uint8_t rx_queue[MIDI_RX_QUEUE_SIZE];
+static unsigned int rx_head = 0;    /* written by the thread */
+static unsigned int rx_tail = 0;    /* read by the emulation */
+static int rx_overrun = 0;
+
+static uint8_t tx_queue[MIDI_TX_QUEUE_SIZE];
+static unsigned int tx_head = 0;    /* written by the emulation */
+static unsigned int tx_tail = 0;    /* read by the thread */
+static int tx_overrun = 0;
+
+void midi_io_lock(void)
+{
+    pthread_mutex_lock(&midi_io_mutex);
+}
+
+void midi_io_unlock(void)
+{
+    pthread_mutex_unlock(&midi_io_mutex);
+}
+
+static void *midi_io_thread(void *arg)
+{
+    uint8_t in_buf[256];
+    uint8_t out_buf[256];
+    unsigned int in_len, out_len, i;
+    int stop;
+
+    do {
+        stop = io_thread_stop;
+
+        pthread_mutex_lock(&queue_lock);
+        for (out_len = 0; out_len < sizeof(out_buf) && tx_tail != tx_head; out_len++) {
+            out_buf[out_len] = tx_queue[tx_tail];
+            tx_tail = (tx_tail + 1) & (MIDI_TX_QUEUE_SIZE - 1);
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        in_len = 0;
+        midi_io_lock();
+        if (fd_out >= 0) {
+            for (i = 0; i < out_len; i++) {
+                mididrv_out(out_buf[i]);
+            }
+        }
+        if (fd_in >= 0) {
+            while (in_len < sizeof(in_buf) && mididrv_in(&in_buf[in_len]) == 1) {
+                in_len++;
+            }
+        }
+        midi_io_unlock();
+
+        if (in_len > 0) {
+            pthread_mutex_lock(&queue_lock);
+            for (i = 0; i < in_len; i++) {
+                if (((rx_head + 1) & (MIDI_RX_QUEUE_SIZE - 1)) == rx_tail) {
+                    rx_overrun = 1;
+                    break;
+                }
+                rx_queue[rx_head] = in_buf[i];
+                rx_head = (rx_head + 1) & (MIDI_RX_QUEUE_SIZE - 1);
+            }
+            pthread_mutex_unlock(&queue_lock);
+        }
+
+        if (in_len == 0 && out_len == 0) {
+            /* the queued bytes are all sent before stopping */
+            if (stop) {
+                break;
+            }
+            tick_sleep(MIDI_IDLE_TICKS);
+        }
+    } while (1);
+
+    return NULL;
+}
+
+static void midi_io_start(void)
+{
+    if (io_thread_running || (fd_in < 0 && fd_out < 0)) {
+        return;
+    }
+    io_thread_stop = 0;
+    if (pthread_create(&io_thread, NULL, midi_io_thread, NULL) != 0) {
+        log_error(midi_log, "Cannot create the MIDI I/O thread.");
+        return;
+    }
+    io_thread_running = 1;
+}
+
+static void midi_io_stop(void)
+{
+    if (!io_thread_running) {
+        return;
+    }
+    io_thread_stop = 1;
+    pthread_join(io_thread, NULL);
+    io_thread_running = 0;
+}
+
+/* Drop what was received but not read yet.  */
+static void midi_io_flush_rx(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    rx_tail = rx_head;
+    rx_overrun = 0;
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static int midi_io_take(uint8_t *b)
+{
+    int got = 0;
+
+    pthread_mutex_lock(&queue_lock);
+    if (rx_overrun) {
+        log_warning(midi_log, "Receive queue overrun, bytes were lost.");
+        rx_overrun = 0;
+    }
+    if (rx_tail != rx_head) {
+        *b = rx_queue[rx_tail];
+        rx_tail = (rx_tail + 1) & (MIDI_RX_QUEUE_SIZE - 1);
+        got = 1;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return got;
+}
+
+static void midi_io_send(uint8_t b)
+{
+    pthread_mutex_lock(&queue_lock);
+    if (((tx_head + 1) & (MIDI_TX_QUEUE_SIZE - 1)) == tx_tail) {
+        if (!tx_overrun) {
+            log_warning(midi_log, "Transmit queue full, bytes are lost.");
+        }
+        tx_overrun = 1;
+    } else {
+        tx_queue[tx_head] = b;
+        tx_head = (tx_head + 1) & (MIDI_TX_QUEUE_SIZE - 1);
+        tx_overrun = 0;
+    }
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/******************************************************************/
+
 static CLOCK midi_alarm_clk = 0;
 
 static int midi_irq = IK_NONE;
@@ -206,6 +376,7 @@ int midi_resources_init(void)
 
 void midi_resources_shutdown(void)
 {
+    midi_io_stop();
     mididrv_resources_shutdown();
 }
 
@@ -253,6 +424,9 @@ static void midi_suspend(void)
     status = MIDI_STATUS_DEFAULT;
     intx = 0;
 
+    midi_io_stop();
+    midi_io_flush_rx();
+
     if (fd_in >= 0) {
         mididrv_in_close();
     }
@@ -288,11 +462,15 @@ static void midi_activate(int alarm)
     log_message(midi_log, "activate");
 #endif
     /* open streams only once */
-    if (fd_in < 0) {
-        fd_in = mididrv_in_open();
-    }
-    if (fd_out < 0) {
-        fd_out = mididrv_out_open();
+    if (fd_in < 0 || fd_out < 0) {
+        midi_io_stop();
+        if (fd_in < 0) {
+            fd_in = mididrv_in_open();
+        }
+        if (fd_out < 0) {
+            fd_out = mididrv_out_open();
+        }
+        midi_io_start();
     }
 
     /* set alarm, if requested */
@@ -439,14 +617,14 @@ static void int_midi(CLOCK offset, void *data)
     log_message(midi_log, "int_midi(offset=%ld, clk=%d", (long int)offset, (int)maincpu_clk);
 #endif
     if ((intx == 2) && (fd_out >= 0)) {
-        mididrv_out(txdata);
+        midi_io_send(txdata);
     }
 
     if (intx) {
         intx--;
     }
 
-    if ((fd_in >= 0) && (!(status & MIDI_STATUS_RDRF)) && (mididrv_in(&rxdata) == 1)) {
+    if ((fd_in >= 0) && (!(status & MIDI_STATUS_RDRF)) && midi_io_take(&rxdata)) {
         status |= MIDI_STATUS_RDRF;
         rxirq = 1;
 #ifdef DEBUG
@@ -77,6 +77,10 @@ int midi_test_read(uint16_t a);
 /* returns 1 if address is any MIDI register */
 int midi_test_peek(uint16_t a);
 
+/* used by the drivers around reopening the devices */
+void midi_io_lock(void);
+void midi_io_unlock(void);
+
 int midi_resources_init(void);
 void midi_resources_shutdown(void);
 int midi_cmdline_options_init(void);
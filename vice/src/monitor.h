@@ -42,6 +42,13 @@ enum mon_int {
     MI_STEP = 1 << 2
 };
 
+/* Conditions ending monitor_run_until() besides the cycle budget */
+enum mon_run_until {
+    MON_RUN_UNTIL_VSYNC = 1 << 0,       /* end of a frame */
+    MON_RUN_UNTIL_INTERRUPT = 1 << 1,   /* IRQ or NMI taken */
+    MON_RUN_UNTIL_PC = 1 << 2           /* program counter reaches an address */
+};
+
 enum t_memspace {
     e_default_space = 0,
     e_comp_space,
@@ -140,6 +147,8 @@ struct monitor_interface_s {
 
     uint8_t (*mem_bank_read)(int bank, uint16_t addr, void *context);
     uint8_t (*mem_bank_peek)(int bank, uint16_t addr, void *context);
+    /* optional, peeks len bytes at once, wrapping around at 0xffff */
+    void (*mem_bank_peek_block)(int bank, uint16_t addr, uint8_t *data, unsigned int len, void *context);
     uint8_t (*mem_peek_with_config)(int config, uint16_t addr, void *context);
     void (*mem_bank_write)(int bank, uint16_t addr, uint8_t byte, void *context);
     void (*mem_bank_poke)(int bank, uint16_t addr, uint8_t byte, void *context);
@@ -175,6 +184,7 @@ void monitor_resources_shutdown(void);
 void monitor_startup(MEMSPACE mem);
 void monitor_startup_trap(void);
 bool monitor_is_inside_monitor(void);
+void monitor_run_until(CLOCK cycles, unsigned int events, uint16_t pc);
 
 void monitor_reset_hook(void);
 void monitor_vsync_hook(void);
@@ -190,6 +200,8 @@ void monitor_cpu_type_set_value(int searchcpu);
 
 void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem);
 void monitor_watch_push_store_addr(uint16_t addr, MEMSPACE mem);
+int monitor_watch_page_load(MEMSPACE mem, unsigned int page);
+int monitor_watch_page_store(MEMSPACE mem, unsigned int page);
 
 monitor_interface_t *monitor_interface_new(void);
 void monitor_interface_destroy(monitor_interface_t *monitor_interface);
@@ -68,6 +68,21 @@ static checkpoint_list_t *breakpoints[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_load[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_store[NUM_MEMSPACES];
 
+/* Presence maps of the checkpoints per memspace and operation, one bit per
+   address, plus the number of checked addresses per page. They are rebuilt
+   from the lists above whenever a checkpoint is added or removed, so the
+   hot paths can reject addresses without any checkpoint in O(1), and the
+   machines can keep the fast memory tables for pages without one.  */
+enum {
+    MAP_EXEC = 0,
+    MAP_LOAD,
+    MAP_STORE,
+    NUM_MAPS
+};
+
+static uint8_t checkpoint_map[NUM_MEMSPACES][NUM_MAPS][0x10000 >> 3];
+static unsigned int checkpoint_page_count[NUM_MEMSPACES][NUM_MAPS][0x100];
+
 
 void mon_breakpoint_init(void)
 {
@@ -156,8 +171,94 @@ mon_checkpoint_t *mon_breakpoint_find_checkpoint(int brknum)
     return NULL;
 }
 
+static void build_checkpoint_map(MEMSPACE mem, int map, checkpoint_list_t *list)
+{
+    uint8_t *bits = checkpoint_map[mem][map];
+    unsigned int *pages = checkpoint_page_count[mem][map];
+    unsigned int addr, end;
+
+    memset(bits, 0, sizeof(checkpoint_map[mem][map]));
+    memset(pages, 0, sizeof(checkpoint_page_count[mem][map]));
+
+    for (; list != NULL; list = list->next) {
+        addr = addr_location(list->checkpt->start_addr);
+        end = addr;
+        if (mon_is_valid_addr(list->checkpt->end_addr)) {
+            end = addr_location(list->checkpt->end_addr);
+        }
+
+        /* same range as mon_is_in_range(), including wrap around */
+        for (;; addr = (addr + 1) & 0xffff) {
+            if (!(bits[addr >> 3] & (1 << (addr & 7)))) {
+                bits[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+                pages[addr >> 8]++;
+            }
+            if (addr == end) {
+                break;
+            }
+        }
+    }
+}
+
+static inline int map_for_op(MEMORY_OP op)
+{
+    switch (op) {
+        case e_load:
+            return MAP_LOAD;
+        case e_store:
+            return MAP_STORE;
+        default:
+            return MAP_EXEC;
+    }
+}
+
+/** \brief Check whether any checkpoint covers an address
+ *
+ * \param[in]  mem     memspace
+ * \param[in]  addr    address
+ * \param[in]  op      operation (load, store or exec)
+ *
+ * \return true if a checkpoint, enabled or not, covers \a addr
+ */
+bool mon_breakpoint_check_map(MEMSPACE mem, unsigned int addr, MEMORY_OP op)
+{
+    addr &= 0xffff;
+    return (checkpoint_map[mem][map_for_op(op)][addr >> 3] >> (addr & 7)) & 1;
+}
+
+/** \brief Check whether any load watchpoint is set within a page
+ *
+ * Used by the machines to only route pages with watchpoints through the
+ * watchpoint memory functions.
+ *
+ * \param[in]  mem     memspace
+ * \param[in]  page    page (address >> 8)
+ *
+ * \return non-zero if a load watchpoint covers an address of \a page
+ */
+int monitor_watch_page_load(MEMSPACE mem, unsigned int page)
+{
+    return checkpoint_page_count[mem][MAP_LOAD][page & 0xff] != 0;
+}
+
+/** \brief Check whether any store watchpoint is set within a page
+ *
+ * \param[in]  mem     memspace
+ * \param[in]  page    page (address >> 8)
+ *
+ * \return non-zero if a store watchpoint covers an address of \a page
+ */
+int monitor_watch_page_store(MEMSPACE mem, unsigned int page)
+{
+    return checkpoint_page_count[mem][MAP_STORE][page & 0xff] != 0;
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    build_checkpoint_map(mem, MAP_EXEC, breakpoints[mem]);
+    build_checkpoint_map(mem, MAP_LOAD, watchpoints_load[mem]);
+    build_checkpoint_map(mem, MAP_STORE, watchpoints_store[mem]);
+
     /* calls mem_toggle_watchpoints() */
     if (watchpoints_load[mem] != NULL ||
         watchpoints_store[mem] != NULL) {
@@ -214,6 +315,8 @@ static void remove_checkpoint(mon_checkpoint_t *cp)
     mem = addr_memspace(cp->start_addr);
 
     mon_delete_conditional(cp->condition);
+    mon_cond_free(cp->compiled_condition);
+    cp->compiled_condition = NULL;
     lib_free(cp->command);
     cp->command = NULL;
 
@@ -390,7 +493,12 @@ void mon_breakpoint_set_checkpoint_condition(int cp_num,
         if (!cp) {
             mon_out("#%d not a valid checkpoint\n", cp_num);
         } else {
+            if (cp->condition != NULL && cp->condition != cnode) {
+                mon_delete_conditional(cp->condition);
+            }
+            mon_cond_free(cp->compiled_condition);
             cp->condition = cnode;
+            cp->compiled_condition = mon_cond_compile(cnode);
 
             mon_out("Setting checkpoint %d condition to: ", cp_num);
             mon_print_conditional(cnode);
@@ -480,6 +588,10 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     supported_cpu_type_list_t *cpulist;
     int monbank = mon_interfaces[mem]->current_bank;
 
+    if (!mon_breakpoint_check_map(mem, addr, op)) {
+        return FALSE;
+    }
+
     monitor_cpu = monitor_cpu_for_memspace[mem];
     instpc = new_addr(mem, (monitor_cpu->mon_register_get_val)(mem, e_PC));
     loadstorepc = new_addr(mem, lastpc);
@@ -541,7 +653,11 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
             mon_is_in_range(cp->start_addr, cp->end_addr, addr)) {
 
             /* If condition test fails, skip this checkpoint */
-            if (cp->condition) {
+            if (cp->compiled_condition) {
+                if (!mon_cond_run(cp->compiled_condition)) {
+                    continue;
+                }
+            } else if (cp->condition) {
                 if (!mon_evaluate_conditional(cp->condition)) {
                     continue;
                 }
@@ -668,6 +784,7 @@ int breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     new_cp->hit_count = 0;
     new_cp->ignore_count = 0;
     new_cp->condition = NULL;
+    new_cp->compiled_condition = NULL;
     new_cp->command = NULL;
     new_cp->check_load = memory_op & e_load;
     new_cp->check_store = memory_op & e_store;
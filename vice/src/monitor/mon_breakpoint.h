@@ -28,6 +28,7 @@
 #define VICE_MON_BREAKPOINT_H
 
 #include "montypes.h"
+#include "mon_condition.h"
 
 typedef enum mon_breakpoint_type_e {
     BP_NONE,
@@ -42,6 +43,7 @@ struct mon_checkpoint_s {
     int hit_count;
     int ignore_count;
     cond_node_t *condition;
+    mon_cond_program_t *compiled_condition;
     char *command;
     bool stop;
     bool enabled;
@@ -62,6 +64,7 @@ void mon_breakpoint_set_checkpoint_condition(int brk_num, struct cond_node_s *cn
 void mon_breakpoint_set_checkpoint_command(int brk_num, char *cmd);
 bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr,
                                      unsigned int lastpc, MEMORY_OP op);
+bool mon_breakpoint_check_map(MEMSPACE mem, unsigned int addr, MEMORY_OP op);
 int mon_breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
                                   bool stop, MEMORY_OP op, bool is_temp, bool do_print);
 
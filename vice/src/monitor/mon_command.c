@@ -175,6 +175,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       FILENAME_ARG
     },
 
+    { "rewind", "",
+      "[<frames>]",
+      "Step the machine back by the given number of frames, using the"
+      " rewind buffer (see the Rewind resource). Without an argument, show"
+      " how far back the rewind buffer goes.",
+      NO_FILENAME_ARG
+    },
+
     { "bank", "",
       "[<memspace>] [bankname]",
       "If bankname is not given, print the possible banks for the memspace.\n"
@@ -207,6 +215,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "chisfilter", "",
+      "[<memspace> | <address_range>]",
+      "Only record the instructions of the given device in the CPU history,"
+      " optionally only those within the given address range. Without"
+      " argument, all devices are recorded.",
+      NO_FILENAME_ARG
+    },
+
     { "registers", "r",
       "[<reg_name> = <number> [, <reg_name> = <number>]*]",
       "Assign respective registers (use FL for status flags).  With no"
@@ -220,6 +236,44 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "memprofile", "memprof",
+      "[on|off]|[sample [count]]|[num]",
+      "Allocation profiling of the emulator itself. Commands:\n"
+      "memprof on - Start recording every 100th memory allocation with its call site,"
+      " and flush old results.\n"
+      "memprof sample [<count=100>] - Start recording every 'count'th allocation.\n"
+      "memprof off - Stop recording.\n"
+      "memprof [<num=20>] - Show the 'num' call sites holding the most memory, estimated"
+      " from the recorded allocations.",
+      NO_FILENAME_ARG
+    },
+
+    { "frametrace", "ft",
+      "[on|off|toggle]",
+      "Record where the host time of every frame goes: the frames, drive"
+      " catch-up, sound flushes, rendering, render queue and main lock waits,"
+      " and pacing sleeps of every thread. Without argument shows whether"
+      " recording is on. Only the last marks of each thread are kept.",
+      NO_FILENAME_ARG
+    },
+
+    { "frametracesave", "ftsave",
+      "\"<filename>\"",
+      "Save the recorded frame trace to FILENAME in the JSON trace event"
+      " format, to be opened with chrome://tracing or Perfetto.",
+      FILENAME_ARG
+    },
+
+    { "perfcounters", "perf",
+      "[reset]",
+      "Print the hot path counters of the emulator: executed opcodes per CPU,"
+      " memory read/write function calls per memory configuration and page,"
+      " alarm dispatches, VIC-II cycle events and sound chip writes. 'reset'"
+      " sets all counters to 0. Only available when VICE was configured with"
+      " --enable-perfcounters.",
+      NO_FILENAME_ARG
+    },
+
     { "goto", "g",
       "<address>",
       "Change the PC to ADDRESS and continue execution",
@@ -250,9 +304,11 @@ static const mon_cmds_t mon_cmd_array[] = {
 
 
     { "profile", "prof",
-      "[on|off]|[flat [num]]|[graph [context] [depth]]|[func <function>]",
+      "[on|off]|[sample [cycles]]|[flat [num]]|[graph [context] [depth]]|[func <function>]",
       "Main CPU profiling functions. Commands:\n"
       "prof on - Start profiling and flush old profiling data.\n"
+      "prof sample [<cycles=1000>] - Start sampling the PC every 'cycles' cycles instead of profiling\n"
+      "  each instruction, and flush old profiling data. Call counts are not collected.\n"
       "prof off - Stop profiling.\n"
       "prof flat [<num=20>] - Show flat summary of 'num' top functions sorted by self time.\n"
       "prof graph [<ctx>] [depth <d>] Show callgraph up to 'd' levels deep. If 'ctx' is given, zoom on that subtree.\n"
@@ -261,7 +317,9 @@ static const mon_cmds_t mon_cmd_array[] = {
       "prof context <ctx> - Detailed context information including "
       " per-instruction profiling for function"
       " in a call graph context.\n"
-      "prof clear <function> - Clears all profiling stats for function.\n",
+      "prof clear <function> - Clears all profiling stats for function.\n"
+      "prof flamegraph \"<filename>\" - Save the call graph as collapsed stacks for flame graph tools.\n"
+      "prof callgrind \"<filename>\" - Save the call graph in callgrind format.\n",
       NO_FILENAME_ARG
     },
 
@@ -452,6 +510,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "memmapheat", "mmheat",
+      "[\"<filename>\" [<frames>]]",
+      "Capture read, write and execute counts per address into a file, in"
+      " buckets of 'frames' frames (default 1). Without arguments, stop"
+      " capturing.",
+      FILENAME_ARG
+    },
+
     { "memmapsave", "mmsave",
       "\"<filename>\" <Format>",
       "Save the memmap as a picture. Format is:"
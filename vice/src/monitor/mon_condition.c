@@ -0,0 +1,390 @@
+/*
+ * mon_condition.c - Compiled checkpoint conditions for the VICE built-in monitor.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The parsed condition tree is translated once, when the condition is set,
+   into a flat program for a small stack machine.  Subexpressions made of
+   constants only are folded, a comparison of a register with a constant
+   becomes a single instruction, and && and || skip their right operand
+   when the left one already decides the result.  The tree is kept for
+   printing the condition.  */
+
+#include "vice.h"
+
+#include "lib.h"
+#include "log.h"
+#include "mon_condition.h"
+#include "montypes.h"
+#include "types.h"
+
+/* Deeper conditions are left to mon_evaluate_conditional().  */
+#define COND_STACK_MAX  32
+
+typedef enum cond_opcode_e {
+    COND_CONST,         /* push value */
+    COND_REG,           /* push register reg of memspace mem */
+    COND_REG_CMP,       /* push (register reg of memspace mem <operation> value) */
+    COND_RASTERLINE,    /* push raster line */
+    COND_CYCLE,         /* push raster cycle */
+    COND_MEM,           /* push byte at value in bank */
+    COND_MEM_IND,       /* pop address, push byte at address in bank */
+    COND_BINARY,        /* pop two values, push the result of operation */
+    COND_AND_JUMP,      /* if top is 0, jump to value, else pop */
+    COND_OR_JUMP,       /* if top is not 0, replace with 1 and jump to value, else pop */
+    COND_BOOL           /* replace top with top != 0 */
+} cond_opcode_t;
+
+typedef struct cond_insn_s {
+    cond_opcode_t opcode;
+    int operation;
+    int value;
+    MEMSPACE mem;
+    int reg;
+    int bank;
+} cond_insn_t;
+
+struct mon_cond_program_s {
+    cond_insn_t *insns;
+    int len;
+    int size;
+    int depth;
+    int max_depth;
+};
+
+static cond_insn_t *emit(mon_cond_program_t *program, cond_opcode_t opcode)
+{
+    cond_insn_t *insn;
+
+    if (program->len == program->size) {
+        program->size *= 2;
+        program->insns = lib_realloc(program->insns, sizeof(cond_insn_t) * (size_t)program->size);
+    }
+    insn = &program->insns[program->len++];
+    insn->opcode = opcode;
+    insn->operation = e_INV;
+    insn->value = 0;
+    insn->mem = e_comp_space;
+    insn->reg = 0;
+    insn->bank = -1;
+
+    return insn;
+}
+
+static void push(mon_cond_program_t *program, int n)
+{
+    program->depth += n;
+    if (program->depth > program->max_depth) {
+        program->max_depth = program->depth;
+    }
+}
+
+/* Apply a binary operator, returns 0 when the operator is unknown or on
+   division by zero, like mon_evaluate_conditional().  */
+static inline int cond_apply(int operation, int value_1, int value_2, int *ok)
+{
+    *ok = 1;
+
+    switch (operation) {
+        case e_EQU:
+            return value_1 == value_2;
+        case e_NEQ:
+            return value_1 != value_2;
+        case e_GT:
+            return value_1 > value_2;
+        case e_LT:
+            return value_1 < value_2;
+        case e_GTE:
+            return value_1 >= value_2;
+        case e_LTE:
+            return value_1 <= value_2;
+        case e_LOGICAL_AND:
+            return value_1 && value_2;
+        case e_LOGICAL_OR:
+            return value_1 || value_2;
+        case e_ADD:
+            return value_1 + value_2;
+        case e_SUB:
+            return value_1 - value_2;
+        case e_MUL:
+            return value_1 * value_2;
+        case e_DIV:
+            if (value_2 == 0) {
+                *ok = 0;
+                return 0;
+            }
+            return value_1 / value_2;
+        case e_BINARY_AND:
+            return value_1 & value_2;
+        case e_BINARY_OR:
+            return value_1 | value_2;
+        default:
+            *ok = 0;
+            return 0;
+    }
+}
+
+static int is_comparison(int operation)
+{
+    return operation >= e_EQU && operation <= e_LTE;
+}
+
+/* Compile a subtree, returns -1 if it cannot be compiled.  */
+static int compile_node(mon_cond_program_t *program, cond_node_t *cnode)
+{
+    cond_insn_t *insn;
+    int start = program->len;
+    int jump;
+
+    if (cnode->operation == e_INV) {
+        if (cnode->is_reg && reg_regid(cnode->reg_num) == e_Rasterline) {
+            emit(program, COND_RASTERLINE);
+        } else if (cnode->is_reg && reg_regid(cnode->reg_num) == e_Cycle) {
+            emit(program, COND_CYCLE);
+        } else if (cnode->is_reg) {
+            insn = emit(program, COND_REG);
+            insn->mem = reg_memspace(cnode->reg_num);
+            insn->reg = reg_regid(cnode->reg_num);
+        } else if (cnode->banknum >= 0) {
+            if (cnode->child1 != NULL) {
+                if (compile_node(program, cnode->child1) < 0) {
+                    return -1;
+                }
+                insn = emit(program, COND_MEM_IND);
+                insn->bank = cnode->banknum;
+                return 0;
+            }
+            insn = emit(program, COND_MEM);
+            insn->bank = cnode->banknum;
+            insn->value = (int)addr_location(cnode->value);
+        } else {
+            insn = emit(program, COND_CONST);
+            insn->value = cnode->value;
+        }
+        push(program, 1);
+        return 0;
+    }
+
+    if (cnode->child1 == NULL || cnode->child2 == NULL) {
+        return -1;
+    }
+
+    if (cnode->operation == e_LOGICAL_AND || cnode->operation == e_LOGICAL_OR) {
+        if (compile_node(program, cnode->child1) < 0) {
+            return -1;
+        }
+        jump = program->len;
+        emit(program, cnode->operation == e_LOGICAL_AND ? COND_AND_JUMP : COND_OR_JUMP);
+        program->depth--;
+        if (compile_node(program, cnode->child2) < 0) {
+            return -1;
+        }
+        emit(program, COND_BOOL);
+        program->insns[jump].value = program->len;
+        return 0;
+    }
+
+    if (compile_node(program, cnode->child1) < 0) {
+        return -1;
+    }
+    if (compile_node(program, cnode->child2) < 0) {
+        return -1;
+    }
+
+    /* both operands are single instructions: fold constants and turn
+       register comparisons into a single instruction */
+    if (program->len == start + 2) {
+        cond_insn_t *op1 = &program->insns[start];
+        cond_insn_t *op2 = &program->insns[start + 1];
+        int ok, value;
+
+        if (op1->opcode == COND_CONST && op2->opcode == COND_CONST) {
+            value = cond_apply(cnode->operation, op1->value, op2->value, &ok);
+            if (ok) {
+                program->len = start;
+                program->depth -= 2;
+                insn = emit(program, COND_CONST);
+                insn->value = value;
+                push(program, 1);
+                return 0;
+            }
+        } else if (op1->opcode == COND_REG && op2->opcode == COND_CONST
+                   && is_comparison(cnode->operation)) {
+            op1->opcode = COND_REG_CMP;
+            op1->operation = cnode->operation;
+            op1->value = op2->value;
+            program->len = start + 1;
+            program->depth--;
+            return 0;
+        }
+    }
+
+    insn = emit(program, COND_BINARY);
+    insn->operation = cnode->operation;
+    program->depth--;
+
+    switch (cnode->operation) {
+        case e_EQU:
+        case e_NEQ:
+        case e_GT:
+        case e_LT:
+        case e_GTE:
+        case e_LTE:
+        case e_ADD:
+        case e_SUB:
+        case e_MUL:
+        case e_DIV:
+        case e_BINARY_AND:
+        case e_BINARY_OR:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/** \brief  Compile a condition tree
+ *
+ * \param[in]   cnode   condition tree
+ *
+ * \return  program, or NULL if the condition has to be evaluated with
+ *          mon_evaluate_conditional()
+ */
+mon_cond_program_t *mon_cond_compile(cond_node_t *cnode)
+{
+    mon_cond_program_t *program;
+
+    if (cnode == NULL) {
+        return NULL;
+    }
+
+    program = lib_calloc(1, sizeof(mon_cond_program_t));
+    program->size = 8;
+    program->insns = lib_malloc(sizeof(cond_insn_t) * (size_t)program->size);
+
+    if (compile_node(program, cnode) < 0 || program->max_depth > COND_STACK_MAX) {
+        mon_cond_free(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+static uint8_t cond_peek(int bank, int addr)
+{
+    uint8_t byte;
+    int old_sidefx = sidefx;
+
+    /* make sure we peek when doing the break point */
+    sidefx = 0;
+    byte = mon_get_mem_val_ex(e_comp_space, bank, (uint16_t)addr);
+    sidefx = old_sidefx;
+
+    return byte;
+}
+
+/** \brief  Evaluate a compiled condition
+ *
+ * \param[in]   program compiled condition
+ *
+ * \return  value of the condition
+ */
+int mon_cond_run(mon_cond_program_t *program)
+{
+    int stack[COND_STACK_MAX];
+    int sp = -1;
+    int pc = 0;
+    unsigned int line, cycle;
+    int half_cycle;
+    int ok;
+    const cond_insn_t *insn;
+
+    while (pc < program->len) {
+        insn = &program->insns[pc++];
+
+        switch (insn->opcode) {
+            case COND_CONST:
+                stack[++sp] = insn->value;
+                break;
+            case COND_REG:
+                stack[++sp] = (int)(monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)(insn->mem, insn->reg);
+                break;
+            case COND_REG_CMP:
+                stack[++sp] = cond_apply(insn->operation,
+                                         (int)(monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)(insn->mem, insn->reg),
+                                         insn->value, &ok);
+                break;
+            case COND_RASTERLINE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                stack[++sp] = (int)line;
+                break;
+            case COND_CYCLE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                stack[++sp] = (int)cycle;
+                break;
+            case COND_MEM:
+                stack[++sp] = cond_peek(insn->bank, insn->value);
+                break;
+            case COND_MEM_IND:
+                stack[sp] = cond_peek(insn->bank, stack[sp]);
+                break;
+            case COND_BINARY:
+                sp--;
+                stack[sp] = cond_apply(insn->operation, stack[sp], stack[sp + 1], &ok);
+                if (!ok && insn->operation == e_DIV) {
+                    log_error(LOG_DEFAULT, "Division by zero in conditional\n");
+                }
+                break;
+            case COND_AND_JUMP:
+                if (stack[sp] == 0) {
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_OR_JUMP:
+                if (stack[sp] != 0) {
+                    stack[sp] = 1;
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_BOOL:
+                stack[sp] = (stack[sp] != 0);
+                break;
+        }
+    }
+
+    return stack[sp];
+}
+
+/** \brief  Free a compiled condition
+ *
+ * \param[in]   program compiled condition, may be NULL
+ */
+void mon_cond_free(mon_cond_program_t *program)
+{
+    if (program == NULL) {
+        return;
+    }
+    lib_free(program->insns);
+    lib_free(program);
+}
@@ -37,6 +37,7 @@
 
 #include "asm.h"
 #include "console.h"
+#include "lib.h"
 #include "log.h"
 #include "mon_disassemble.h"
 #include "mon_util.h"
@@ -1489,6 +1490,92 @@ static const char *mon_disassemble_to_string_internal(MEMSPACE memspace,
 #undef p3
 #undef p4
 
+/*****************************************************************************/
+
+/*
+ * Decoded instructions, per memspace and address.  The emulated memory can
+ * change behind the back of the monitor without it noticing, so an entry is
+ * only used when the bytes at its address are still the same, as are the
+ * CPU, the hex mode and the labels (mon_symbol_table_generation).
+ */
+
+/* Entries per memspace, a power of two.  */
+#define DISASM_CACHE_SIZE   4096
+
+typedef struct disasm_cache_entry_s {
+    char *text;                 /* NULL if the entry is unused */
+    monitor_cpu_type_t *cpu;
+    unsigned int generation;
+    uint16_t loc;
+    uint8_t opc[5];
+    uint8_t opc_size;
+    uint8_t hex_mode;
+} disasm_cache_entry_t;
+
+static disasm_cache_entry_t *disasm_cache[NUM_MEMSPACES];
+
+static const char *mon_disassemble_cached(MEMSPACE mem, uint16_t loc, const uint8_t opc[5],
+                                          int hex_mode, unsigned *opc_size_p,
+                                          monitor_cpu_type_t *mon_cpu_type)
+{
+    disasm_cache_entry_t *entry;
+    uint8_t opc_copy[5];
+    unsigned opc_size;
+    const char *text;
+
+    if (mem >= NUM_MEMSPACES || mem == e_default_space) {
+        memcpy(opc_copy, opc, sizeof(opc_copy));
+        return mon_disassemble_to_string_internal(mem, loc, opc_copy, hex_mode,
+                                                  opc_size_p, mon_cpu_type);
+    }
+
+    if (disasm_cache[mem] == NULL) {
+        disasm_cache[mem] = lib_calloc(DISASM_CACHE_SIZE, sizeof(disasm_cache_entry_t));
+    }
+    entry = &disasm_cache[mem][loc & (DISASM_CACHE_SIZE - 1)];
+
+    if (entry->text == NULL
+        || entry->loc != loc
+        || entry->cpu != mon_cpu_type
+        || entry->hex_mode != hex_mode
+        || entry->generation != mon_symbol_table_generation
+        || memcmp(entry->opc, opc, sizeof(entry->opc)) != 0) {
+        /* the decoder modifies the bytes for some prefixes */
+        memcpy(opc_copy, opc, sizeof(opc_copy));
+        text = mon_disassemble_to_string_internal(mem, loc, opc_copy, hex_mode,
+                                                  &opc_size, mon_cpu_type);
+        lib_free(entry->text);
+        entry->text = lib_strdup(text);
+        entry->cpu = mon_cpu_type;
+        entry->generation = mon_symbol_table_generation;
+        entry->loc = loc;
+        memcpy(entry->opc, opc, sizeof(entry->opc));
+        entry->opc_size = (uint8_t)opc_size;
+        entry->hex_mode = (uint8_t)hex_mode;
+    }
+
+    if (opc_size_p) {
+        *opc_size_p = entry->opc_size;
+    }
+    return entry->text;
+}
+
+void mon_disassemble_shutdown(void)
+{
+    int mem, i;
+
+    for (mem = 0; mem < NUM_MEMSPACES; mem++) {
+        if (disasm_cache[mem] == NULL) {
+            continue;
+        }
+        for (i = 0; i < DISASM_CACHE_SIZE; i++) {
+            lib_free(disasm_cache[mem][i].text);
+        }
+        lib_free(disasm_cache[mem]);
+        disasm_cache[mem] = NULL;
+    }
+}
+
 /*
  * Disassemble an instruction based on the current mem_config (implies bank
  * "cpu" but possibly differently configured).
@@ -1513,7 +1600,7 @@ static const char* mon_disassemble_instr_memconfig_internal(unsigned *opc_size,
     opc[3] = mon_get_mem_val_nosfx(mem, mem_config, (uint16_t)(loc + 3));
     opc[4] = mon_get_mem_val_nosfx(mem, mem_config, (uint16_t)(loc + 4));
 
-    dis_inst = mon_disassemble_to_string_internal(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
+    dis_inst = mon_disassemble_cached(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
 
     sprintf(buff, ".%s:%04x  %s", mon_memspace_string[mem], loc, dis_inst);
 
@@ -1543,7 +1630,7 @@ static const char* mon_disassemble_instr_bank_internal(unsigned *opc_size, MON_A
     opc[3] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 3));
     opc[4] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 4));
 
-    dis_inst = mon_disassemble_to_string_internal(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
+    dis_inst = mon_disassemble_cached(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
 
     sprintf(buff, ".%s:%04x  %s", mon_memspace_string[mem], loc, dis_inst);
 
@@ -1551,6 +1638,23 @@ static const char* mon_disassemble_instr_bank_internal(unsigned *opc_size, MON_A
 }
 
 
+/*
+ * Used by the binary monitor.
+ * Disassemble an instruction in the given bank, returns the bytes read
+ * in opc and the instruction without the address.
+ */
+const char *mon_disassemble_bank(MEMSPACE mem, int bank, uint16_t loc,
+                                 uint8_t opc[5], unsigned *opc_size)
+{
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        opc[i] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + i));
+    }
+
+    return mon_disassemble_cached(mem, loc, opc, 1, opc_size, monitor_cpu_for_memspace[mem]);
+}
+
 /*
  * Used by DEBUG cpu trace.
  * Independent of memory config, since it receives the instruction's bytes
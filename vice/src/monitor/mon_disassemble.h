@@ -40,4 +40,9 @@ void mon_disassemble_with_regdump(MEMSPACE mem, unsigned int addr);
 
 void mon_disassemble_lines(MON_ADDR start_addr, MON_ADDR end_addr);
 
+const char *mon_disassemble_bank(MEMSPACE mem, int bank, uint16_t loc,
+                                 uint8_t opc[5], unsigned *opc_size);
+
+void mon_disassemble_shutdown(void);
+
 #endif
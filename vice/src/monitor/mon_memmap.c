@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,9 +36,11 @@
 #include <strings.h>
 #endif
 
+#include "archdep.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
+#include "maincpu.h"
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "monitor.h"
@@ -69,10 +72,47 @@ uint8_t memmap_state = 0;
 #define MEMMAP_ELEM uint16_t
 
 /* CPU history variables */
-static cpuhistory_t *cpuhistory = NULL;
+
+/* The history is kept packed: the cycle of a record is stored as the delta
+   to the previous record of the same CPU, together with the origin in one
+   16 bit word.  A delta that does not fit is stored in an extra slot right
+   before the record, marked with CPUHISTORY_LONG_DELTA as origin.  The
+   absolute cycles are restored when walking the buffer, starting from the
+   cycle of the last record of each CPU.  */
+
+#define CPUHISTORY_ORIGIN_BITS  3
+#define CPUHISTORY_ORIGIN_MASK  ((1 << CPUHISTORY_ORIGIN_BITS) - 1)
+#define CPUHISTORY_LONG_DELTA   CPUHISTORY_ORIGIN_MASK
+#define CPUHISTORY_DELTA_ESCAPE (0xffff >> CPUHISTORY_ORIGIN_BITS)
+
+typedef struct cpuhistory_entry_s {
+    uint16_t addr;
+    uint16_t info;              /* cycle delta << 3 | origin */
+    union {
+        struct {
+            uint8_t op;
+            uint8_t p1;
+            uint8_t p2;
+            uint8_t reg_a;
+            uint8_t reg_x;
+            uint8_t reg_y;
+            uint8_t reg_sp;
+            uint8_t reg_st;
+        } insn;
+        uint32_t delta[2];      /* CPUHISTORY_LONG_DELTA: cycle delta, low word first */
+    } u;
+} cpuhistory_entry_t;
+
+static cpuhistory_entry_t *cpuhistory = NULL;
 static int cpuhistory_buffer_lines = 0;     /* actual size of the cyclic buffer */
 static int cpuhistory_show_lines = 0;       /* number of lines to show in the monitor */
 static int cpuhistory_i = 0;
+static uint64_t cpuhistory_stored = 0;      /* slots written since allocation */
+static CLOCK cpuhistory_last_cycle[NUM_MEMSPACES];
+
+/* capture filter, a CPU is not recorded at all when pc_min > pc_max */
+static unsigned int cpuhistory_pc_min[NUM_MEMSPACES] = { 0, 0, 0, 0, 0, 0 };
+static unsigned int cpuhistory_pc_max[NUM_MEMSPACES] = { 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff };
 
 
 /** \brief  (re)allocate the buffer used for the cpu history info
@@ -109,27 +149,38 @@ int monitor_cpuhistory_allocate(int lines)
     }
     lines = lines * 5 + 1;
 
-    cpuhistory = lib_realloc(cpuhistory, (size_t)lines * sizeof(cpuhistory_t));
-
-    /* do we resize the array? */
-    if (cpuhistory_buffer_lines != lines) {
-        /* Initialize array to avoid mon_memmap_store() using unitialized
-         * data when reading the RESET vector on boot.
-         * WHY reading the RESET vector causes a STORE is another issue.
-         * -- Compyx
-         * */
-        memset((void *)cpuhistory, 0, sizeof(cpuhistory_t) * (size_t)lines);
-        /* flag lines so they won't output anything after startup */
-        for (i = 0; i < lines ; i++) {
-            cpuhistory[i].origin = e_invalid_space;
-        }
+    cpuhistory = lib_realloc(cpuhistory, (size_t)lines * sizeof(cpuhistory_entry_t));
+
+    /* The cycle deltas cannot be continued over a reallocation, so the
+       history always starts over.  Initialize the array to avoid
+       mon_memmap_store() using unitialized data when reading the RESET
+       vector on boot.
+       WHY reading the RESET vector causes a STORE is another issue.
+       -- Compyx
+    */
+    memset((void *)cpuhistory, 0, sizeof(cpuhistory_entry_t) * (size_t)lines);
+    /* flag lines so they won't output anything after startup */
+    for (i = 0; i < lines ; i++) {
+        cpuhistory[i].info = e_invalid_space;
     }
+    memset(cpuhistory_last_cycle, 0, sizeof(cpuhistory_last_cycle));
 
     cpuhistory_buffer_lines = lines;
     cpuhistory_i = 0;
+    cpuhistory_stored = 0;
     return 0;
 }
 
+static inline cpuhistory_entry_t *cpuhistory_next_slot(void)
+{
+    ++cpuhistory_i;
+    if (cpuhistory_i == cpuhistory_buffer_lines) {
+        cpuhistory_i = 0;
+    }
+    ++cpuhistory_stored;
+
+    return &cpuhistory[cpuhistory_i];
+}
 
 void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int p1, unsigned int p2,
@@ -140,92 +191,248 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int reg_st,
                               MEMSPACE origin)
 {
+    cpuhistory_entry_t *entry;
+    CLOCK delta;
+
+    if (addr < cpuhistory_pc_min[origin] || addr > cpuhistory_pc_max[origin]) {
+        return;
+    }
+
     if (machine_is_jammed()) {
         return;
     }
 
-    ++cpuhistory_i;
-    if (cpuhistory_i == cpuhistory_buffer_lines) {
-        cpuhistory_i = 0;
+    delta = cycle - cpuhistory_last_cycle[origin];
+    cpuhistory_last_cycle[origin] = cycle;
+
+    if (delta >= CPUHISTORY_DELTA_ESCAPE) {
+        entry = cpuhistory_next_slot();
+        entry->info = CPUHISTORY_LONG_DELTA;
+        entry->u.delta[0] = (uint32_t)delta;
+        entry->u.delta[1] = (uint32_t)(delta >> 32);
+        delta = CPUHISTORY_DELTA_ESCAPE;
     }
-    cpuhistory[cpuhistory_i].cycle = cycle;
-    cpuhistory[cpuhistory_i].addr = addr;
-    cpuhistory[cpuhistory_i].op = op;
-    cpuhistory[cpuhistory_i].p1 = p1;
-    cpuhistory[cpuhistory_i].p2 = p2;
-    cpuhistory[cpuhistory_i].reg_a = reg_a;
-    cpuhistory[cpuhistory_i].reg_x = reg_x;
-    cpuhistory[cpuhistory_i].reg_y = reg_y;
-    cpuhistory[cpuhistory_i].reg_sp = reg_sp;
-    cpuhistory[cpuhistory_i].reg_st = reg_st;
-    cpuhistory[cpuhistory_i].origin = origin;
+
+    entry = cpuhistory_next_slot();
+    entry->addr = (uint16_t)addr;
+    entry->info = (uint16_t)((delta << CPUHISTORY_ORIGIN_BITS) | origin);
+    entry->u.insn.op = (uint8_t)op;
+    entry->u.insn.p1 = (uint8_t)p1;
+    entry->u.insn.p2 = (uint8_t)p2;
+    entry->u.insn.reg_a = reg_a;
+    entry->u.insn.reg_x = reg_x;
+    entry->u.insn.reg_y = reg_y;
+    entry->u.insn.reg_sp = reg_sp;
+    entry->u.insn.reg_st = (uint8_t)reg_st;
 }
 
 void monitor_cpuhistory_fix_p2(unsigned int p2)
 {
-    cpuhistory[cpuhistory_i].p2 = p2;
+    cpuhistory[cpuhistory_i].u.insn.p2 = p2;
+}
+
+/* Check if the slot with the given number was not overwritten yet.  One slot
+   more is kept than is valid, so the delta of the oldest record is known.  */
+static inline int cpuhistory_valid(uint64_t number)
+{
+    return number >= 1 && number <= cpuhistory_stored
+           && cpuhistory_stored - number < (uint64_t)cpuhistory_buffer_lines - 1;
 }
 
-cpuhistory_t *mon_cpuhistory_seek(int count, MEMSPACE filter1, MEMSPACE filter2,
-                                  MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5) {
-    int i, pos;
+static inline cpuhistory_entry_t *cpuhistory_slot(uint64_t number)
+{
+    return &cpuhistory[number % (uint64_t)cpuhistory_buffer_lines];
+}
 
-    /* 'i' is the actual counter */
-    i = 0;
-    /* start looking at last entry */
-    pos = cpuhistory_i;
+/* Get the origin of a slot, e_invalid_space for empty slots and long deltas */
+static inline MEMSPACE cpuhistory_origin(const cpuhistory_entry_t *entry)
+{
+    int origin = entry->info & CPUHISTORY_ORIGIN_MASK;
+
+    return origin >= NUM_MEMSPACES ? e_invalid_space : (MEMSPACE)origin;
+}
 
-    if (count >= cpuhistory_buffer_lines) {
-        count = cpuhistory_buffer_lines - 1;
+static CLOCK cpuhistory_delta(uint64_t number)
+{
+    cpuhistory_entry_t *entry = cpuhistory_slot(number);
+    CLOCK delta = entry->info >> CPUHISTORY_ORIGIN_BITS;
+
+    if (delta == CPUHISTORY_DELTA_ESCAPE) {
+        entry = cpuhistory_slot(number - 1);
+        delta = ((CLOCK)entry->u.delta[1] << 32) | entry->u.delta[0];
     }
 
-    /* find out where we need to start */
-    while (i < count) {
-        /* make sure the record matches */
-        if ((cpuhistory[pos].origin != e_invalid_space)
-            && ((filter1 == cpuhistory[pos].origin)
-                || (filter2 == cpuhistory[pos].origin)
-                || (filter3 == cpuhistory[pos].origin)
-                || (filter4 == cpuhistory[pos].origin)
-                || (filter5 == cpuhistory[pos].origin))) {
-            i++;
+    return delta;
+}
+
+static int cpuhistory_match(MEMSPACE origin, MEMSPACE filter1, MEMSPACE filter2,
+                            MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5)
+{
+    return (origin != e_invalid_space)
+           && ((filter1 == origin)
+               || (filter2 == origin)
+               || (filter3 == origin)
+               || (filter4 == origin)
+               || (filter5 == origin));
+}
+
+/* Walk back from the newest slot, down to and including the slot `stop',
+   or until `count' records matching the filters were passed.  Leaves the
+   iterator before the last slot passed.  */
+static void cpuhistory_rewind(cpuhistory_iter_t *iter, uint64_t stop, int count,
+                              MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filter3,
+                              MEMSPACE filter4, MEMSPACE filter5)
+{
+    uint64_t number = cpuhistory_stored;
+    MEMSPACE origin;
+    int i = 0;
+
+    memcpy(iter->cycle, cpuhistory_last_cycle, sizeof(iter->cycle));
+
+    while (i < count && number >= stop && cpuhistory_valid(number)) {
+        origin = cpuhistory_origin(cpuhistory_slot(number));
+        if (origin != e_invalid_space) {
+            iter->cycle[origin] -= cpuhistory_delta(number);
+            if (cpuhistory_match(origin, filter1, filter2, filter3, filter4, filter5)) {
+                i++;
+            }
         }
-        pos--;
-        if (pos < 0) {
-            pos += cpuhistory_buffer_lines;
+        number--;
+    }
+
+    iter->number = number;
+}
+
+/** \brief  Position an iterator before the last records
+ *
+ * \param[out]  iter    iterator
+ * \param[in]   count   number of records matching the filters to go back
+ * \param[in]   filter1 memspace to include, or e_invalid_space
+ * \param[in]   filter2 memspace to include, or e_invalid_space
+ * \param[in]   filter3 memspace to include, or e_invalid_space
+ * \param[in]   filter4 memspace to include, or e_invalid_space
+ * \param[in]   filter5 memspace to include, or e_invalid_space
+ */
+void mon_cpuhistory_seek(cpuhistory_iter_t *iter, int count, MEMSPACE filter1, MEMSPACE filter2,
+                         MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5)
+{
+    cpuhistory_rewind(iter, 1, count, filter1, filter2, filter3, filter4, filter5);
+}
+
+/** \brief  Position an iterator after the newest record
+ *
+ * \param[out]  iter    iterator
+ */
+void mon_cpuhistory_head(cpuhistory_iter_t *iter)
+{
+    memcpy(iter->cycle, cpuhistory_last_cycle, sizeof(iter->cycle));
+    iter->number = cpuhistory_stored;
+}
+
+/** \brief  Move an iterator that fell behind to the oldest record
+ *
+ * \param[in,out]   iter    iterator
+ *
+ * \return  number of slots overwritten before they were read
+ */
+uint64_t mon_cpuhistory_catch_up(cpuhistory_iter_t *iter)
+{
+    uint64_t lost;
+
+    if (iter->number > cpuhistory_stored) {
+        /* the buffer was reallocated */
+        mon_cpuhistory_head(iter);
+        return 0;
+    }
+    if (iter->number == cpuhistory_stored || cpuhistory_valid(iter->number + 1)) {
+        return 0;
+    }
+
+    lost = iter->number;
+    cpuhistory_rewind(iter, cpuhistory_stored + 2 - (uint64_t)cpuhistory_buffer_lines, INT_MAX,
+                      e_invalid_space, e_invalid_space, e_invalid_space, e_invalid_space, e_invalid_space);
+
+    return iter->number - lost;
+}
+
+/** \brief  Get the next record matching the filters
+ *
+ * \param[in,out]   iter    iterator
+ * \param[in]       filter1 memspace to include, or e_invalid_space
+ * \param[in]       filter2 memspace to include, or e_invalid_space
+ * \param[in]       filter3 memspace to include, or e_invalid_space
+ * \param[in]       filter4 memspace to include, or e_invalid_space
+ * \param[in]       filter5 memspace to include, or e_invalid_space
+ *
+ * \return  record, valid until the next call, or NULL after the newest record
+ */
+cpuhistory_t *mon_cpuhistory_next(cpuhistory_iter_t *iter, MEMSPACE filter1, MEMSPACE filter2,
+                                  MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5)
+{
+    cpuhistory_entry_t *entry;
+    cpuhistory_t *record = &iter->record;
+    MEMSPACE origin;
+
+    while (iter->number < cpuhistory_stored && cpuhistory_valid(iter->number + 1)) {
+        iter->number++;
+        entry = cpuhistory_slot(iter->number);
+        origin = cpuhistory_origin(entry);
+        if (origin == e_invalid_space) {
+            continue;
         }
-        /* stop if we hit the starting point */
-        /* this is totally possible since the emulation runs each CPU in
-            chunks and eventually syncs up. Syncing is more aggressive
-            when talking between devices. */
-        if (pos == (cpuhistory_i + 1) % cpuhistory_buffer_lines) {
-            break;
+        iter->cycle[origin] += cpuhistory_delta(iter->number);
+
+        if (cpuhistory_match(origin, filter1, filter2, filter3, filter4, filter5)) {
+            record->cycle = iter->cycle[origin];
+            record->addr = entry->addr;
+            record->reg_st = entry->u.insn.reg_st;
+            record->op = entry->u.insn.op;
+            record->p1 = entry->u.insn.p1;
+            record->p2 = entry->u.insn.p2;
+            record->reg_a = entry->u.insn.reg_a;
+            record->reg_x = entry->u.insn.reg_x;
+            record->reg_y = entry->u.insn.reg_y;
+            record->reg_sp = entry->u.insn.reg_sp;
+            record->origin = origin;
+            return record;
         }
     }
 
-    return &cpuhistory[pos];
+    return NULL;
 }
 
-cpuhistory_t *mon_cpuhistory_next(cpuhistory_t *current, MEMSPACE filter1, MEMSPACE filter2,
-                         MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5) {
-    cpuhistory_t *wrap = &cpuhistory[cpuhistory_buffer_lines];
-    cpuhistory_t *head = &cpuhistory[(cpuhistory_i + 1) % cpuhistory_buffer_lines];
-    do {
-        current += 1;
-        if (current >= wrap) {
-            current = &cpuhistory[0];
-        } else if (current == head) {
-            return NULL;
+/** \brief  Set the capture filter of the CPU history
+ *
+ * Only records the instructions of the given CPU with the program counter in
+ * the given range.  Called with e_invalid_space, everything is recorded.
+ *
+ * \param[in]   mem     memspace to record
+ * \param[in]   start   first address to record
+ * \param[in]   end     last address to record
+ */
+void mon_cpuhistory_filter(MEMSPACE mem, unsigned int start, unsigned int end)
+{
+    int i;
+
+    for (i = 0; i < NUM_MEMSPACES; i++) {
+        if (mem == e_invalid_space) {
+            cpuhistory_pc_min[i] = 0;
+            cpuhistory_pc_max[i] = 0xffff;
+        } else if (i == mem) {
+            cpuhistory_pc_min[i] = start;
+            cpuhistory_pc_max[i] = end;
+        } else {
+            cpuhistory_pc_min[i] = 1;
+            cpuhistory_pc_max[i] = 0;
         }
-    /* make sure the record matches */
-    } while (!((current->origin != e_invalid_space)
-        && ((filter1 == current->origin)
-            || (filter2 == current->origin)
-            || (filter3 == current->origin)
-            || (filter4 == current->origin)
-            || (filter5 == current->origin))));
+    }
 
-    return current;
+    if (mem == e_invalid_space) {
+        mon_out("Recording all CPUs.\n");
+    } else {
+        mon_out("Recording %s from $%04x to $%04x only.\n",
+                mon_memspace_string[mem], start, end);
+    }
 }
 
 void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filter3,
@@ -236,6 +443,7 @@ void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filt
     uint16_t loc, addr;
     int hex_mode = 1;
     const char *dis_inst;
+    cpuhistory_iter_t iter;
     cpuhistory_t *current;
     unsigned opc_size;
     CLOCK cycle;
@@ -255,10 +463,10 @@ void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filt
         count = cpuhistory_show_lines;
     }
 
-    current = mon_cpuhistory_seek(count, filter1, filter2, filter3, filter4, filter5);
+    mon_cpuhistory_seek(&iter, count, filter1, filter2, filter3, filter4, filter5);
 
     /* loop through all entries until we find the number records requested */
-    while ((current = mon_cpuhistory_next(current, filter1, filter2, filter3, filter4, filter5))) {
+    while ((current = mon_cpuhistory_next(&iter, filter1, filter2, filter3, filter4, filter5))) {
         cycle = current->cycle;
         addr = current->addr;
         op = current->op;
@@ -297,6 +505,40 @@ static int mon_memmap_picx;
 static int mon_memmap_picy;
 static unsigned int mon_memmap_mask;
 
+/* heatmap variables, the counters are only allocated while capturing */
+enum {
+    HEATMAP_READ = 0,
+    HEATMAP_WRITE,
+    HEATMAP_EXEC,
+    HEATMAP_TYPES
+};
+
+static FILE *heatmap_file = NULL;
+static uint16_t *heatmap_counts = NULL;     /* HEATMAP_TYPES * mon_memmap_size */
+static uint8_t *heatmap_pages = NULL;       /* pages touched in the current bucket */
+static int heatmap_frames;                  /* frames per bucket */
+static int heatmap_frame;                   /* frames in the current bucket */
+static uint32_t heatmap_bucket;
+
+static inline void heatmap_count(unsigned int addr, unsigned int type)
+{
+    uint16_t *counter;
+
+    if (type & (MEMMAP_RAM_X | MEMMAP_ROM_X | MEMMAP_I_O_X)) {
+        counter = &heatmap_counts[HEATMAP_EXEC * mon_memmap_size + addr];
+    } else if (type & (MEMMAP_RAM_W | MEMMAP_ROM_W | MEMMAP_I_O_W)) {
+        counter = &heatmap_counts[HEATMAP_WRITE * mon_memmap_size + addr];
+    } else if (type & (MEMMAP_RAM_R | MEMMAP_ROM_R | MEMMAP_I_O_R)) {
+        counter = &heatmap_counts[HEATMAP_READ * mon_memmap_size + addr];
+    } else {
+        return;
+    }
+    if (*counter != 0xffff) {
+        (*counter)++;
+    }
+    heatmap_pages[addr >> 8] = 1;
+}
+
 /* mmzap */
 void mon_memmap_zap(void)
 {
@@ -391,6 +633,10 @@ void monitor_memmap_store(unsigned int addr, unsigned int type)
         }
     }
     mon_memmap[addr & mon_memmap_mask] |= type;
+
+    if (heatmap_file != NULL) {
+        heatmap_count(addr & mon_memmap_mask, type);
+    }
 }
 
 void mon_memmap_save(const char *filename, int format)
@@ -440,6 +686,140 @@ void mon_memmap_save(const char *filename, int format)
     lib_free(memmap_bitmap);
 }
 
+static uint8_t *heatmap_put(uint8_t *p, uint64_t value, int bytes)
+{
+    int i;
+
+    for (i = 0; i < bytes; i++) {
+        *p++ = (uint8_t)(value >> (i * 8));
+    }
+    return p;
+}
+
+/* Write the counters of the current bucket and clear them. A bucket is the
+   bucket number and the CPU clock at its end, followed by one record per
+   page and access type with any accesses, ended by a page number of $ffff.
+   A record is the page, the type, the number of entries minus one and the
+   entries, each the offset in the page and the count.  */
+static void heatmap_flush(void)
+{
+    uint8_t buffer[4 + 256 * 3];
+    uint8_t *p;
+    uint16_t *counts;
+    int pages = mon_memmap_size >> 8;
+    int page, type, i, n;
+
+    p = heatmap_put(buffer, heatmap_bucket, 4);
+    p = heatmap_put(p, maincpu_clk, 8);
+    fwrite(buffer, 1, (size_t)(p - buffer), heatmap_file);
+
+    for (page = 0; page < pages; page++) {
+        if (!heatmap_pages[page]) {
+            continue;
+        }
+        for (type = 0; type < HEATMAP_TYPES; type++) {
+            counts = &heatmap_counts[type * mon_memmap_size + (page << 8)];
+            p = buffer + 4;
+            n = 0;
+            for (i = 0; i < 256; i++) {
+                if (counts[i] != 0) {
+                    *p++ = (uint8_t)i;
+                    p = heatmap_put(p, counts[i], 2);
+                    n++;
+                }
+            }
+            if (n > 0) {
+                heatmap_put(buffer, (uint64_t)page, 2);
+                buffer[2] = (uint8_t)type;
+                buffer[3] = (uint8_t)(n - 1);
+                fwrite(buffer, 1, (size_t)(p - buffer), heatmap_file);
+                memset(counts, 0, 256 * sizeof(uint16_t));
+            }
+        }
+        heatmap_pages[page] = 0;
+    }
+
+    heatmap_put(buffer, 0xffff, 2);
+    fwrite(buffer, 1, 2, heatmap_file);
+
+    heatmap_bucket++;
+    heatmap_frame = 0;
+}
+
+static void heatmap_close(void)
+{
+    if (heatmap_frame > 0) {
+        heatmap_flush();
+    }
+    fclose(heatmap_file);
+    heatmap_file = NULL;
+    lib_free(heatmap_counts);
+    heatmap_counts = NULL;
+    lib_free(heatmap_pages);
+    heatmap_pages = NULL;
+}
+
+/* mmheat, start capturing access counts per address into buckets of
+   `frames' frames */
+void mon_memmap_heatmap_start(const char *filename, int frames)
+{
+    uint8_t header[12];
+
+    if (frames < 1 || frames > 0xffff) {
+        mon_out("Invalid number of frames per bucket.\n");
+        return;
+    }
+
+    if (heatmap_file != NULL) {
+        heatmap_close();
+    }
+
+    heatmap_file = fopen(filename, MODE_WRITE);
+    if (heatmap_file == NULL) {
+        mon_out("Cannot open `%s' for writing.\n", filename);
+        return;
+    }
+
+    memcpy(header, "VICEHEAT", 8);
+    header[8] = 1; /* version */
+    header[9] = (machine_class == VICE_MACHINE_C64DTV) ? 21 : 16; /* address bits */
+    heatmap_put(header + 10, (uint64_t)frames, 2);
+    fwrite(header, 1, sizeof(header), heatmap_file);
+
+    heatmap_counts = lib_calloc((size_t)(HEATMAP_TYPES * mon_memmap_size), sizeof(uint16_t));
+    heatmap_pages = lib_calloc((size_t)(mon_memmap_size >> 8), 1);
+    heatmap_frames = frames;
+    heatmap_frame = 0;
+    heatmap_bucket = 0;
+
+    mon_out("Capturing memory heatmap to `%s', %d frame(s) per bucket.\n", filename, frames);
+}
+
+/* mmheat, stop capturing and write the last bucket */
+void mon_memmap_heatmap_stop(void)
+{
+    if (heatmap_file == NULL) {
+        mon_out("Memory heatmap capture not running.\n");
+        return;
+    }
+
+    heatmap_close();
+
+    mon_out("Memory heatmap capture stopped after %u bucket(s).\n", heatmap_bucket);
+}
+
+/* called once per frame */
+void mon_memmap_vsync(void)
+{
+    if (heatmap_file == NULL) {
+        return;
+    }
+
+    if (++heatmap_frame >= heatmap_frames) {
+        heatmap_flush();
+    }
+}
+
 void mon_memmap_init(void)
 {
     mon_memmap_picx = MEMMAP_PICX;
@@ -459,6 +839,9 @@ void mon_memmap_init(void)
 
 void mon_memmap_shutdown(void)
 {
+    if (heatmap_file != NULL) {
+        heatmap_close();
+    }
     lib_free(mon_memmap);
     mon_memmap = NULL;
     if (cpuhistory != NULL) {
@@ -481,6 +864,11 @@ void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filt
     mon_memmap_stub();
 }
 
+void mon_cpuhistory_filter(MEMSPACE mem, unsigned int start, unsigned int end)
+{
+    mon_memmap_stub();
+}
+
 void mon_memmap_zap(void)
 {
     mon_memmap_stub();
@@ -496,6 +884,20 @@ void mon_memmap_save(const char* filename, int format)
     mon_memmap_stub();
 }
 
+void mon_memmap_heatmap_start(const char *filename, int frames)
+{
+    mon_memmap_stub();
+}
+
+void mon_memmap_heatmap_stop(void)
+{
+    mon_memmap_stub();
+}
+
+void mon_memmap_vsync(void)
+{
+}
+
 void mon_memmap_init(void)
 {
 }
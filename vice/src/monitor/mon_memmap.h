@@ -45,20 +45,34 @@ struct cpuhistory_s {
 };
 typedef struct cpuhistory_s cpuhistory_t;
 
+/* Position in the CPU history, see mon_cpuhistory_seek() */
+struct cpuhistory_iter_s {
+    uint64_t number;                /* number of the last slot passed */
+    CLOCK cycle[NUM_MEMSPACES];     /* cycle of the last record of each CPU up to there */
+    cpuhistory_t record;            /* record returned by mon_cpuhistory_next() */
+};
+typedef struct cpuhistory_iter_s cpuhistory_iter_t;
+
 void mon_memmap_init(void);
 void mon_memmap_shutdown(void);
 
 int monitor_cpuhistory_allocate(int lines);
 void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filter3,
                     MEMSPACE filter4, MEMSPACE filter5);
-cpuhistory_t *mon_cpuhistory_seek(int count, MEMSPACE filter1, MEMSPACE filter2,
-                                  MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5);
-cpuhistory_t *mon_cpuhistory_next(cpuhistory_t *current, MEMSPACE filter1, MEMSPACE filter2,
+void mon_cpuhistory_filter(MEMSPACE mem, unsigned int start, unsigned int end);
+void mon_cpuhistory_seek(cpuhistory_iter_t *iter, int count, MEMSPACE filter1, MEMSPACE filter2,
                          MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5);
+void mon_cpuhistory_head(cpuhistory_iter_t *iter);
+uint64_t mon_cpuhistory_catch_up(cpuhistory_iter_t *iter);
+cpuhistory_t *mon_cpuhistory_next(cpuhistory_iter_t *iter, MEMSPACE filter1, MEMSPACE filter2,
+                                  MEMSPACE filter3, MEMSPACE filter4, MEMSPACE filter5);
 
 void mon_memmap_zap(void);
 void mon_memmap_show(int mask, MON_ADDR start_addr, MON_ADDR end_addr);
 void mon_memmap_save(const char* filename, int format);
+void mon_memmap_heatmap_start(const char *filename, int frames);
+void mon_memmap_heatmap_stop(void);
+void mon_memmap_vsync(void);
 
 
 #endif
@@ -45,9 +45,45 @@
 
 #define ADDR_LIMIT(x) ((uint16_t)(addr_mask(x)))
 
+/* Find the first match of a masked pattern in `buf', starting at `from'.
+   Returns the offset of the match, or -1 if there is none.  The bytes in
+   `pattern' must already be masked.  If the first byte is not masked, the
+   candidates are found with memchr(), which is vectorized by the C library.  */
+long mon_memory_find(const uint8_t *buf, unsigned int len,
+                     const uint8_t *pattern, const uint8_t *mask,
+                     unsigned int pattern_len, unsigned int from)
+{
+    unsigned int i, j;
+    const uint8_t *p;
+
+    if (pattern_len == 0 || len < pattern_len) {
+        return -1;
+    }
+
+    for (i = from; i <= len - pattern_len; i++) {
+        if (mask[0] == 0xff) {
+            p = memchr(buf + i, pattern[0], len - pattern_len + 1 - i);
+            if (p == NULL) {
+                return -1;
+            }
+            i = (unsigned int)(p - buf);
+        } else if ((buf[i] & mask[0]) != pattern[0]) {
+            continue;
+        }
+        for (j = 1; j < pattern_len; j++) {
+            if ((buf[i + j] & mask[j]) != pattern[j]) {
+                break;
+            }
+        }
+        if (j == pattern_len) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
 void mon_memory_move(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
 {
-    long i;
     unsigned int dst;
     long len;
     uint16_t start;
@@ -68,28 +104,26 @@ void mon_memory_move(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
 
     buf = lib_malloc(sizeof(uint8_t) *len);
 
-    for (i = 0; i < len; i++) {
-        buf[i] = mon_get_mem_val(src_mem, (uint16_t)ADDR_LIMIT(start + i));
-    }
-
-    for (i = 0; i < len; i++) {
-        mon_set_mem_val(dest_mem, (uint16_t)ADDR_LIMIT(dst + i), buf[i]);
-    }
+    mon_get_mem_block(src_mem, start, (uint16_t)(len - 1), buf);
+    mon_set_mem_block(dest_mem, (uint16_t)dst, (uint16_t)(len - 1), buf);
 
     lib_free(buf);
 }
 
+/* Size of the chunks that are skipped with memcmp() when equal */
+#define COMPARE_CHUNK   64
+
 void mon_memory_compare(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
 {
     uint16_t start;
     MEMSPACE src_mem, dest_mem;
-    uint8_t byte1, byte2;
-    long i;
+    uint8_t *buf1, *buf2;
+    long i, chunk;
     unsigned int dst;
     long len;
 
     len = mon_evaluate_address_range(&start_addr, &end_addr, TRUE, -1);
-    if (len < 0) {
+    if (len <= 0) {
         mon_out("Invalid range.\n");
         return;
     }
@@ -100,15 +134,28 @@ void mon_memory_compare(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
     dst = addr_location(dest);
     dest_mem = addr_memspace(dest);
 
-    for (i = 0; i < len; i++) {
-        byte1 = mon_get_mem_val(src_mem, (uint16_t)ADDR_LIMIT(start + i));
-        byte2 = mon_get_mem_val(dest_mem, (uint16_t)ADDR_LIMIT(dst + i));
-
-        if (byte1 != byte2) {
-            mon_out("$%04x $%04x: %02x %02x\n",
-                    ADDR_LIMIT(start + i), ADDR_LIMIT(dst + i), byte1, byte2);
+    buf1 = lib_malloc(len);
+    buf2 = lib_malloc(len);
+    mon_get_mem_block(src_mem, start, (uint16_t)(len - 1), buf1);
+    mon_get_mem_block(dest_mem, (uint16_t)dst, (uint16_t)(len - 1), buf2);
+
+    for (i = 0; i < len; i += chunk) {
+        chunk = (len - i) < COMPARE_CHUNK ? (len - i) : COMPARE_CHUNK;
+        if (memcmp(buf1 + i, buf2 + i, chunk) != 0) {
+            long j;
+
+            for (j = i; j < i + chunk; j++) {
+                if (buf1[j] != buf2[j]) {
+                    mon_out("$%04x $%04x: %02x %02x\n",
+                            ADDR_LIMIT(start + j), ADDR_LIMIT(dst + j),
+                            buf1[j], buf2[j]);
+                }
+            }
         }
     }
+
+    lib_free(buf1);
+    lib_free(buf2);
 }
 
 void mon_memory_fill(MON_ADDR start_addr, MON_ADDR end_addr,
@@ -116,7 +163,7 @@ void mon_memory_fill(MON_ADDR start_addr, MON_ADDR end_addr,
 {
     uint16_t start;
     MEMSPACE dest_mem;
-    unsigned int mon_index;
+    uint8_t *buf;
     long i;
     long len;
 
@@ -135,15 +182,22 @@ void mon_memory_fill(MON_ADDR start_addr, MON_ADDR end_addr,
 
     dest_mem = addr_memspace(start_addr);
 
-    i = 0;
-    mon_index = 0;
-    while (i < len) {
-        mon_set_mem_val(dest_mem, (uint16_t)ADDR_LIMIT(start + i),
-                        data_buf[mon_index++]);
-        if (mon_index >= data_buf_len) {
-            mon_index = 0;
+    if (len > 0 && data_buf_len > 0) {
+        buf = lib_malloc(len);
+        if (data_buf_len == 1) {
+            memset(buf, data_buf[0], len);
+        } else {
+            /* double the copied pattern until the buffer is full */
+            i = (len < (long)data_buf_len) ? len : (long)data_buf_len;
+            memcpy(buf, data_buf, i);
+            while (i < len) {
+                long n = (len - i) < i ? (len - i) : i;
+                memcpy(buf + i, buf, n);
+                i += n;
+            }
         }
-        i++;
+        mon_set_mem_block(dest_mem, start, (uint16_t)(len - 1), buf);
+        lib_free(buf);
     }
 
     mon_clear_buffer();
@@ -153,46 +207,28 @@ void mon_memory_hunt(MON_ADDR start_addr, MON_ADDR end_addr,
                      unsigned char *data)
 {
     uint8_t *buf;
-    uint16_t start, next_read;
+    uint16_t start;
     MEMSPACE mem;
     long i;
     long len;
 
     len = mon_evaluate_address_range(&start_addr, &end_addr, TRUE, -1);
-    if (len < 0 || len < data_buf_len) {
+    if (len <= 0 || len < data_buf_len) {
         mon_out("Invalid range.\n");
         return;
     }
     mem = addr_memspace(start_addr);
     start = addr_location(start_addr);
 
-    buf = lib_malloc(data_buf_len);
+    buf = lib_malloc(len);
+    mon_get_mem_block(mem, start, (uint16_t)(len - 1), buf);
 
-    /* Fill buffer */
-    for (i = 0; i < data_buf_len; i++) {
-        buf[i] = mon_get_mem_val(mem, (uint16_t)ADDR_LIMIT(start + i));
-    }
-
-    /* Do compares */
-    next_read = start + (uint16_t)data_buf_len;
-
-    for (i = 0; i <= (len - data_buf_len); i++, next_read++) {
-        int not_found = 0;
-        unsigned int j;
-        for (j = 0; j < data_buf_len; j++) {
-            if ((buf[j] & data_mask_buf[j]) != data_buf[j]) {
-                not_found = 1;
-                break;
-            }
-        }
-        if (!not_found) {
-            mon_out("%04x\n", ADDR_LIMIT(start + i));
-        }
-
-        if (data_buf_len > 1) {
-            memmove(&(buf[0]), &(buf[1]), data_buf_len - 1);
-        }
-        buf[data_buf_len - 1] = mon_get_mem_val(mem, next_read);
+    i = mon_memory_find(buf, (unsigned int)len, data_buf, data_mask_buf,
+                        data_buf_len, 0);
+    while (i >= 0) {
+        mon_out("%04x\n", ADDR_LIMIT(start + i));
+        i = mon_memory_find(buf, (unsigned int)len, data_buf, data_mask_buf,
+                            data_buf_len, (unsigned int)i + 1);
     }
 
     mon_clear_buffer();
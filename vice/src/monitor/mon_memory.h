@@ -34,6 +34,9 @@ typedef enum mon_display_format_e {
     DF_SCREEN_CODE
 } mon_display_format_t;
 
+long mon_memory_find(const uint8_t *buf, unsigned int len,
+                     const uint8_t *pattern, const uint8_t *mask,
+                     unsigned int pattern_len, unsigned int from);
 void mon_memory_move(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest);
 void mon_memory_compare(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest);
 void mon_memory_fill(MON_ADDR start_addr, MON_ADDR end_addr, unsigned char *data);
@@ -151,11 +151,14 @@ void set_yydebug(int val);
 %token CMD_BACKTRACE CMD_SCREENSHOT CMD_PWD CMD_DIR CMD_MKDIR CMD_RMDIR
 %token CMD_RESOURCE_GET CMD_RESOURCE_SET CMD_LOAD_RESOURCES CMD_SAVE_RESOURCES
 %token CMD_ATTACH CMD_DETACH CMD_MON_RESET CMD_TAPECTRL CMD_TAPEOFFS CMD_CARTFREEZE CMD_UPDB CMD_JPDB
-%token CMD_CPUHISTORY CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
+%token CMD_CPUHISTORY CMD_CHISFILTER CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE CMD_MEMMAPHEAT
 %token CMD_COMMENT CMD_LIST CMD_STOPWATCH RESET
 %token CMD_EXPORT CMD_AUTOSTART CMD_AUTOLOAD CMD_MAINCPU_TRACE
-%token CMD_WARP
-%token CMD_PROFILE FLAT GRAPH FUNC DEPTH DISASS PROFILE_CONTEXT CLEAR
+%token CMD_WARP CMD_REWIND
+%token CMD_PROFILE FLAT GRAPH FUNC DEPTH DISASS PROFILE_CONTEXT CLEAR SAMPLE
+%token FLAMEGRAPH CALLGRIND
+%token CMD_PERFCOUNTERS CMD_MEMPROFILE
+%token CMD_FRAMETRACE CMD_FRAMETRACE_SAVE
 %token<str> CMD_LABEL_ASGN
 %token<i> L_PAREN R_PAREN ARG_IMMEDIATE REG_A REG_X REG_Y COMMA INST_SEP
 %token<i> L_BRACKET R_BRACKET LESS_THAN REG_U REG_S REG_PC REG_PCR
@@ -259,12 +262,28 @@ machine_state_rules: CMD_BANK end_cmd
                      { mon_cpuhistory($3, $5, $7, $9, $11, e_invalid_space); }
                    | CMD_CPUHISTORY opt_sep d_number opt_sep memspace opt_sep memspace opt_sep memspace opt_sep memspace opt_sep memspace end_cmd
                      { mon_cpuhistory($3, $5, $7, $9, $11, $13); }
+                   | CMD_CHISFILTER end_cmd
+                     { mon_cpuhistory_filter(e_invalid_space, 0, 0xffff); }
+                   | CMD_CHISFILTER opt_sep memspace end_cmd
+                     { mon_cpuhistory_filter($3, 0, 0xffff); }
+                   | CMD_CHISFILTER opt_sep address_range end_cmd
+                     {
+                         MEMSPACE mem = addr_memspace($3[0]);
+                         if (mem == e_default_space) {
+                             mem = default_memspace;
+                         }
+                         mon_cpuhistory_filter(mem, addr_location($3[0]), addr_location($3[1]));
+                     }
                    | CMD_RETURN end_cmd
                      { mon_instruction_return(); }
                    | CMD_DUMP filename end_cmd
                      { mon_write_snapshot($2,0,0,0); /* FIXME */ }
                    | CMD_UNDUMP filename end_cmd
                      { mon_read_snapshot($2, 0); }
+                   | CMD_REWIND end_cmd
+                     { mon_rewind(-1); }
+                   | CMD_REWIND opt_sep d_number end_cmd
+                     { mon_rewind($3); }
                    | CMD_STEP end_cmd
                      { mon_instructions_step(-1); }
                    | CMD_STEP opt_sep expression end_cmd
@@ -393,6 +412,12 @@ memory_rules: CMD_MOVE address_range opt_sep address end_cmd
               { mon_memmap_show($3,$4[0],$4[1]); }
             | CMD_MEMMAPSAVE filename opt_sep expression end_cmd
               { mon_memmap_save($2,$4); }
+            | CMD_MEMMAPHEAT filename end_cmd
+              { mon_memmap_heatmap_start($2, 1); }
+            | CMD_MEMMAPHEAT filename opt_sep expression end_cmd
+              { mon_memmap_heatmap_start($2, $4); }
+            | CMD_MEMMAPHEAT end_cmd
+              { mon_memmap_heatmap_stop(); }
             ;
 
 checkpoint_rules: CMD_BREAK opt_mem_op address_opt_range opt_if_cond_expr end_cmd
@@ -603,10 +628,28 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                      { mon_stopwatch_reset(); }
                   | CMD_STOPWATCH end_cmd
                      { mon_stopwatch_show("Stopwatch: ", "\n"); }
+                  | CMD_PERFCOUNTERS RESET end_cmd
+                     { mon_perfcounters(1); }
+                  | CMD_PERFCOUNTERS end_cmd
+                     { mon_perfcounters(0); }
+                  | CMD_FRAMETRACE TOGGLE end_cmd
+                     { mon_frametrace($2); }
+                  | CMD_FRAMETRACE end_cmd
+                     { mon_frametrace(-1); }
+                  | CMD_FRAMETRACE_SAVE filename end_cmd
+                     { mon_frametrace_save($2); }
+                  | CMD_MEMPROFILE TOGGLE end_cmd
+                     { mon_memprofile_action($2); }
+                  | CMD_MEMPROFILE SAMPLE opt_d_number end_cmd
+                     { mon_memprofile_sample($3); }
+                  | CMD_MEMPROFILE opt_d_number end_cmd
+                     { mon_memprofile($2); }
                   | CMD_PROFILE TOGGLE end_cmd
                      { mon_profile_action($2); }
                   | CMD_PROFILE end_cmd
                      { mon_profile(); }
+                  | CMD_PROFILE SAMPLE opt_d_number end_cmd
+                     { mon_profile_sample($3); }
                   | CMD_PROFILE FLAT opt_d_number end_cmd
                      { mon_profile_flat($3); }
                   | CMD_PROFILE GRAPH opt_context_num end_cmd
@@ -621,6 +664,10 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                      { mon_profile_clear($3); }
                   | CMD_PROFILE PROFILE_CONTEXT d_number end_cmd
                      { mon_profile_disass_context($3); }
+                  | CMD_PROFILE FLAMEGRAPH STRING end_cmd
+                     { mon_profile_flamegraph($3); }
+                  | CMD_PROFILE CALLGRIND STRING end_cmd
+                     { mon_profile_callgrind($3); }
                   ;
 
 disk_rules: CMD_LOAD filename device_num opt_address end_cmd
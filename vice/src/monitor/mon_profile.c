@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "archdep.h"
 #include "lib.h"
 #include "machine.h"
 #include "maincpu.h"
@@ -56,7 +57,7 @@ static bool is_merged(profiling_context_t *context) {
 
 void mon_profile(void)
 {
-    if (maincpu_profiling) {
+    if (profile_running()) {
         mon_out("Profiling running.\n");
     } else if (!root_context) {
         mon_out("Profiling not started.\n");
@@ -70,7 +71,7 @@ void mon_profile_action(ACTION action)
 {
     switch(action) {
     case e_OFF: {
-        if (maincpu_profiling) {
+        if (profile_running()) {
             profile_stop();
             mon_out("Profiling stopped.\n");
         } else {
@@ -79,16 +80,16 @@ void mon_profile_action(ACTION action)
         return;
     }
     case e_ON: {
-        profile_start();
-        if (maincpu_profiling) {
+        if (profile_running()) {
             mon_out("Profiling restarted.\n");
         } else {
             mon_out("Profiling started.\n");
         }
+        profile_start();
         return;
     }
     case e_TOGGLE: {
-        if (maincpu_profiling) {
+        if (profile_running()) {
             mon_profile_action(e_OFF);
         } else {
             mon_profile_action(e_ON);
@@ -448,6 +449,22 @@ static void array_compact(context_array_t * output, context_array_t const* sourc
     }
 }
 
+void mon_profile_sample(int interval)
+{
+    if (interval < 0) {
+        interval = 1000;
+    } else if (interval == 0) {
+        mon_out("Sample interval must be at least one cycle.\n");
+        return;
+    }
+    if (profile_running()) {
+        mon_out("Sampled profiling restarted, every %d cycles.\n", interval);
+    } else {
+        mon_out("Sampled profiling started, every %d cycles.\n", interval);
+    }
+    profile_start_sampling((CLOCK)interval);
+}
+
 void mon_profile_flat(int num)
 {
     int i;
@@ -1139,3 +1156,177 @@ void mon_profile_clear(MON_ADDR function)
     clear_recursively(root_context, addr);
 }
 
+
+/* ------------------------------------------------------------------------- */
+/* export */
+
+/* enough for the deepest call stack with names cut to EXPORT_NAME_SIZE */
+#define EXPORT_NAME_SIZE    64
+#define EXPORT_STACK_SIZE   (140 * EXPORT_NAME_SIZE)
+
+static void export_name(char *buf, uint16_t addr)
+{
+    char *name = mon_symbol_table_lookup_name(default_memspace, addr);
+
+    if (name) {
+        snprintf(buf, EXPORT_NAME_SIZE, "%s", name);
+    } else if (addr == 0x0000) {
+        snprintf(buf, EXPORT_NAME_SIZE, "ROOT");
+    } else {
+        snprintf(buf, EXPORT_NAME_SIZE, "%04x", addr);
+    }
+}
+
+static profiling_counter_t self_cycles(profiling_context_t *context)
+{
+    profiling_counter_t total = 0;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        if (context->page[i]) {
+            for (j = 0; j < 256; j++) {
+                total += context->page[i]->data[j].num_cycles;
+            }
+        }
+    }
+    return total;
+}
+
+/* one line per call stack: frames separated by ';', then the self cycles.
+ * Interrupt handlers get the interrupt as prefix, cycles spent in another
+ * memory configuration than the one the function was called in go to an
+ * extra frame naming the configuration. */
+static void export_collapsed_context(FILE *fp, profiling_context_t *context,
+                                     char *stack, size_t len)
+{
+    profiling_context_t *c;
+    profiling_counter_t cycles;
+    char name[EXPORT_NAME_SIZE];
+
+    export_name(name, context->pc_dst);
+    if (len + 2 * EXPORT_NAME_SIZE >= EXPORT_STACK_SIZE) {
+        return;
+    }
+    switch (context->pc_src) {
+    case NMI: len += (size_t)sprintf(stack + len, "%sNMI %s", len ? ";" : "", name); break;
+    case RESET: len += (size_t)sprintf(stack + len, "%sRST %s", len ? ";" : "", name); break;
+    case IRQ: len += (size_t)sprintf(stack + len, "%sIRQ %s", len ? ";" : "", name); break;
+    default: len += (size_t)sprintf(stack + len, "%s%s", len ? ";" : "", name); break;
+    }
+
+    for (c = context; c; c = c->next_mem_config) {
+        cycles = self_cycles(c);
+        if (cycles == 0) {
+            continue;
+        }
+        if (c->memory_bank_config == context->memory_bank_config) {
+            fprintf(fp, "%s %u\n", stack, cycles);
+        } else {
+            fprintf(fp, "%s;{%d} %u\n", stack, c->memory_bank_config, cycles);
+        }
+    }
+
+    if (context->child) {
+        c = context->child;
+        do {
+            export_collapsed_context(fp, c, stack, len);
+            stack[len] = '\0';
+            c = c->next;
+        } while (c != context->child);
+    }
+}
+
+void mon_profile_flamegraph(const char *filename)
+{
+    FILE *fp;
+    char *stack;
+
+    if (!init_profiling_data()) return;
+
+    fp = fopen(filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        mon_out("Cannot open `%s' for writing.\n", filename);
+        return;
+    }
+
+    stack = lib_calloc(1, EXPORT_STACK_SIZE);
+    export_collapsed_context(fp, root_context, stack, 0);
+    lib_free(stack);
+
+    fclose(fp);
+    mon_out("Profile saved to `%s'.\n", filename);
+}
+
+/* every memory configuration goes to its own object, so a function shows up
+ * once for each configuration it ran in */
+static void export_callgrind_context(FILE *fp, profiling_context_t *context)
+{
+    profiling_context_t *c;
+    profiling_data_t *data;
+    char name[EXPORT_NAME_SIZE];
+    uint16_t src;
+    int i, j;
+
+    export_name(name, context->pc_dst);
+
+    for (c = context; c; c = c->next_mem_config) {
+        fprintf(fp, "\nob=config %d\nfn=%s\n", c->memory_bank_config, name);
+        for (i = 0; i < 256; i++) {
+            if (c->page[i]) {
+                for (j = 0; j < 256; j++) {
+                    data = &c->page[i]->data[j];
+                    if (data->num_samples > 0) {
+                        fprintf(fp, "0x%04x %u %u\n", (unsigned)((i << 8) | j),
+                                (unsigned)data->num_cycles, data->num_samples);
+                    }
+                }
+            }
+        }
+    }
+
+    if (context->child) {
+        fprintf(fp, "\nob=config %d\nfn=%s\n", context->memory_bank_config, name);
+        c = context->child;
+        do {
+            export_name(name, c->pc_dst);
+            /* the call site is the JSR, interrupts keep their vector */
+            src = c->pc_src >= NMI ? c->pc_src : (uint16_t)(c->pc_src - 2);
+            fprintf(fp, "cob=config %d\ncfn=%s\ncalls=%u 0x%04x\n0x%04x %u\n",
+                    c->memory_bank_config, name, c->num_enters, c->pc_dst,
+                    src, c->total_cycles);
+            c = c->next;
+        } while (c != context->child);
+
+        c = context->child;
+        do {
+            export_callgrind_context(fp, c);
+            c = c->next;
+        } while (c != context->child);
+    }
+}
+
+void mon_profile_callgrind(const char *filename)
+{
+    FILE *fp;
+
+    if (!init_profiling_data()) return;
+
+    fp = fopen(filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        mon_out("Cannot open `%s' for writing.\n", filename);
+        return;
+    }
+
+    fprintf(fp, "# callgrind format\n");
+    fprintf(fp, "version: 1\n");
+    fprintf(fp, "creator: VICE\n");
+    fprintf(fp, "cmd: %s\n", machine_name);
+    fprintf(fp, "positions: instr\n");
+    fprintf(fp, "events: Cycles Samples\n");
+    fprintf(fp, "summary: %u\n", root_context->total_cycles);
+
+    export_callgrind_context(fp, root_context);
+
+    fclose(fp);
+    mon_out("Profile saved to `%s'.\n", filename);
+}
@@ -31,11 +31,14 @@
 /* monitor commands */
 void mon_profile(void);
 void mon_profile_action(ACTION action); /* on|off|toggle */
+void mon_profile_sample(int interval);
 void mon_profile_flat(int num);
 void mon_profile_graph(int context_id, int depth);
 void mon_profile_func(MON_ADDR function);
 void mon_profile_disass(MON_ADDR function);
 void mon_profile_clear(MON_ADDR function);
 void mon_profile_disass_context(int context_id);
+void mon_profile_flamegraph(const char *filename);
+void mon_profile_callgrind(const char *filename);
 
 #endif /* VICE_MON_PROFILE_H */
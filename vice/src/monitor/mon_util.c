@@ -62,7 +62,10 @@ static const unsigned int bigbuffersize = 10000;
 static unsigned int bigbufferwrite = 0;
 static unsigned int bigbuffermode = 0; /* 0: ascii, 1: petscii, 2: scrcode, 3: petscii (uppercase), 4: scrcode (uppercase) */
 
+static lib_arena_t *mon_out_arena = NULL;
+
 static FILE *mon_log_file = NULL;
+static int mon_log_only = 0;
 
 /******************************************************************************/
 
@@ -91,6 +94,13 @@ void mon_log_file_close(void)
     mon_log_file = NULL;
 }
 
+/* Write the output only to the log file while it is open, without the
+   slower terminal output.  */
+void mon_log_file_set_only(int only)
+{
+    mon_log_only = only;
+}
+
 static int mon_log_file_out(const char *buffer)
 {
     size_t len;
@@ -199,6 +209,10 @@ static int mon_out_buffered(const char *buffer, int mode, int maxlen)
     DBG(("console_log:%p console_cannot_output:%d",
          console_log, console_log ? console_log->console_cannot_output : -1));
 
+    if (mon_log_only && mon_log_file) {
+        return 0;
+    }
+
     if (!console_log || console_log->console_cannot_output) {
 
         if (mode != bigbuffermode) {
@@ -240,14 +254,33 @@ static int mon_out_buffered(const char *buffer, int mode, int maxlen)
     return rv;
 }
 
+/* The output is formatted into an arena, as commands like disassembling or
+   dumping memory print a line at a time, and the string is released when it
+   has been written.  */
+static char *mon_out_format(size_t *mark, const char *format, va_list ap)
+{
+    if (mon_out_arena == NULL) {
+        mon_out_arena = lib_arena_new(0);
+    }
+    *mark = lib_arena_mark(mon_out_arena);
+    return lib_arena_mvsprintf(mon_out_arena, format, ap);
+}
+
+void mon_out_shutdown(void)
+{
+    lib_arena_free(mon_out_arena);
+    mon_out_arena = NULL;
+}
+
 int mon_out(const char *format, ...)
 {
     va_list ap;
     char *buffer;
+    size_t mark;
     int rc = 0;
 
     va_start(ap, format);
-    buffer = lib_mvsprintf(format, ap);
+    buffer = mon_out_format(&mark, format, ap);
     va_end(ap);
 
 #ifdef HAVE_NETWORK
@@ -261,7 +294,7 @@ int mon_out(const char *format, ...)
 #endif
     mon_log_file_out(buffer);
 
-    lib_free(buffer);
+    lib_arena_release(mon_out_arena, mark);
 
     if (rc < 0) {
         monitor_abort();
@@ -274,10 +307,11 @@ int mon_petscii_out(int maxlen, const char *format, ...)
 {
     va_list ap;
     char *buffer;
+    size_t mark;
     int rc = 0;
 
     va_start(ap, format);
-    buffer = lib_mvsprintf(format, ap);
+    buffer = mon_out_format(&mark, format, ap);
     va_end(ap);
 
 #ifdef HAVE_NETWORK
@@ -295,7 +329,7 @@ int mon_petscii_out(int maxlen, const char *format, ...)
 #endif
     mon_log_file_out(buffer);
 
-    lib_free(buffer);
+    lib_arena_release(mon_out_arena, mark);
 
     if (rc < 0) {
         monitor_abort();
@@ -308,10 +342,11 @@ int mon_petscii_upper_out(int maxlen, const char *format, ...)
 {
     va_list ap;
     char *buffer;
+    size_t mark;
     int rc = 0;
 
     va_start(ap, format);
-    buffer = lib_mvsprintf(format, ap);
+    buffer = mon_out_format(&mark, format, ap);
     va_end(ap);
 
 #ifdef HAVE_NETWORK
@@ -335,7 +370,7 @@ int mon_petscii_upper_out(int maxlen, const char *format, ...)
 #endif
     mon_log_file_out(buffer);
 
-    lib_free(buffer);
+    lib_arena_release(mon_out_arena, mark);
 
     if (rc < 0) {
         monitor_abort();
@@ -348,10 +383,11 @@ int mon_scrcode_out(int maxlen, const char *format, ...)
 {
     va_list ap;
     char *buffer;
+    size_t mark;
     int rc = 0;
 
     va_start(ap, format);
-    buffer = lib_mvsprintf(format, ap);
+    buffer = mon_out_format(&mark, format, ap);
     va_end(ap);
 
 #ifdef HAVE_NETWORK
@@ -370,7 +406,7 @@ int mon_scrcode_out(int maxlen, const char *format, ...)
 #endif
     mon_log_file_out(buffer);
 
-    lib_free(buffer);
+    lib_arena_release(mon_out_arena, mark);
 
     if (rc < 0) {
         monitor_abort();
@@ -383,10 +419,11 @@ int mon_scrcode_upper_out(int maxlen, const char *format, ...)
 {
     va_list ap;
     char *buffer;
+    size_t mark;
     int rc = 0;
 
     va_start(ap, format);
-    buffer = lib_mvsprintf(format, ap);
+    buffer = mon_out_format(&mark, format, ap);
     va_end(ap);
 
 #ifdef HAVE_NETWORK
@@ -405,7 +442,7 @@ int mon_scrcode_upper_out(int maxlen, const char *format, ...)
 #endif
     mon_log_file_out(buffer);
 
-    lib_free(buffer);
+    lib_arena_release(mon_out_arena, mark);
 
     if (rc < 0) {
         monitor_abort();
@@ -41,5 +41,8 @@ void mon_event_closed(void);
 
 int mon_log_file_open(const char *name);
 void mon_log_file_close(void);
+void mon_log_file_set_only(int only);
+
+void mon_out_shutdown(void);
 
 #endif
@@ -47,12 +47,14 @@
 
 #include "archdep.h"
 #include "archdep_defs.h"
+#include "alarm.h"
 #include "cartio.h"
 #include "charset.h"
 #include "cmdline.h"
 #include "console.h"
 #include "datasette.h"
 #include "drive.h"
+#include "frametrace.h"
 
 #include "interrupt.h"
 #include "kbdbuf.h"
@@ -61,6 +63,7 @@
 #include "log.h"
 #include "machine.h"
 #include "machine-video.h"
+#include "maincpu.h"
 #include "mem.h"
 #include "mon_breakpoint.h"
 #include "mon_disassemble.h"
@@ -80,7 +83,9 @@
 #include "joyport_io_sim.h"
 #include "joyport.h"
 
+#include "perfcounters.h"
 #include "resources.h"
+#include "rewind.h"
 #include "screenshot.h"
 #include "sysfile.h"
 #include "tape.h"
@@ -124,8 +129,8 @@ static int init_break_address = -1;
 
 #define MAX_LABEL_LEN 255
 #define MAX_MEMSPACE_NAME_LEN 10
-#define HASH_ARRAY_SIZE 256
-#define HASH_ADDR(x) ((x) % 0xff)
+#define HASH_ARRAY_SIZE 4096
+#define HASH_ADDR(x) ((x) & (HASH_ARRAY_SIZE - 1))
 #define OP_JSR 0x20
 #define OP_RTI 0x40
 #define OP_RTS 0x60
@@ -148,11 +153,21 @@ struct symbol_entry {
     uint16_t addr;
     char *name;
     struct symbol_entry *next;
+    /* only used in the name list: previous entry and next entry with the
+       same name hash */
+    struct symbol_entry *prev;
+    struct symbol_entry *hash_next;
 };
 typedef struct symbol_entry symbol_entry_t;
 
+/* Every label is in the name list, in the order it was added, and in the
+   address hash table.  The entries of the name list are also in the name
+   hash table, so that looking up a label by name does not have to go
+   through the whole list; loading a label file with many labels would
+   otherwise take quadratic time.  */
 struct symbol_table {
     symbol_entry_t *name_list;
+    symbol_entry_t *name_hash_table[HASH_ARRAY_SIZE];
     symbol_entry_t *addr_hash_table[HASH_ARRAY_SIZE];
 };
 typedef struct symbol_table symbol_table_t;
@@ -186,6 +201,14 @@ static unsigned int instruction_count;
 static bool skip_jsrs;
 static int wait_for_return_level;
 
+/* State of monitor_run_until() */
+static bool run_until_active = false;
+static unsigned int run_until_events;
+static uint16_t run_until_pc;
+static CLOCK run_until_start_clk;
+static bool run_until_interrupted;
+static alarm_t *run_until_alarm = NULL;
+
 const char * const _mon_space_strings[] = {
     "Default", "Computer", "Disk8", "Disk9", "Disk10", "Disk11", "<<Invalid>>"
 };
@@ -389,6 +412,10 @@ void monitor_reset_hook(void)
 
 void monitor_vsync_hook(void)
 {
+    if (run_until_active && (run_until_events & MON_RUN_UNTIL_VSYNC)) {
+        monitor_startup_trap();
+    }
+
     if (init_break_mode == ON_READY) {
         /*
          * Check if READY has been printed on the screen ..
@@ -401,6 +428,8 @@ void monitor_vsync_hook(void)
         }
     }
 
+    mon_memmap_vsync();
+
 #ifdef HAVE_NETWORK
     /* check if someone wants to connect remotely to the monitor */
     monitor_check_remote();
@@ -916,11 +945,30 @@ uint8_t mon_get_mem_val_nosfx(MEMSPACE mem, uint16_t mem_config, uint16_t mem_ad
     return mon_get_mem_val_ex_nosfx(mem, mon_interfaces[mem]->current_bank, mem_addr);
 }
 
+/* Note: `end' is the number of bytes to get minus one.  */
 void mon_get_mem_block_ex(MEMSPACE mem, int bank, uint16_t start, uint16_t end, uint8_t *data)
 {
-    int i;
-    for (i = 0; i <= end; i++) {
-        data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
+    monitor_interface_t *mi = mon_interfaces[mem];
+    unsigned int len = (unsigned int)end + 1;
+    unsigned int i;
+
+    if (monitor_diskspace_dnr(mem) >= 0) {
+        if (!check_drive_emu_level_ok(monitor_diskspace_dnr(mem) + 8)) {
+            memset(data, 0, len);
+            return;
+        }
+    }
+
+    if ((sidefx == 0) && (mi->mem_bank_peek_block != NULL)) {
+        mi->mem_bank_peek_block(bank, start, data, len, mi->context);
+    } else if ((sidefx == 0) && (mi->mem_bank_peek != NULL)) {
+        for (i = 0; i < len; i++) {
+            data[i] = mi->mem_bank_peek(bank, (uint16_t)(start + i), mi->context);
+        }
+    } else {
+        for (i = 0; i < len; i++) {
+            data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
+        }
     }
 }
 
@@ -986,6 +1034,35 @@ void mon_set_mem_val_ex(MEMSPACE mem, int bank, uint16_t mem_addr, uint8_t val)
     }
 }
 
+/* Note: `end' is the number of bytes to set minus one.  */
+void mon_set_mem_block_ex(MEMSPACE mem, int bank, uint16_t start, uint16_t end, const uint8_t *data)
+{
+    monitor_interface_t *mi = mon_interfaces[mem];
+    unsigned int len = (unsigned int)end + 1;
+    unsigned int i;
+
+    if (monitor_diskspace_dnr(mem) >= 0) {
+        if (!check_drive_emu_level_ok(monitor_diskspace_dnr(mem) + 8)) {
+            return;
+        }
+    }
+
+    if ((sidefx == 0) && (mi->mem_bank_poke != NULL)) {
+        for (i = 0; i < len; i++) {
+            mi->mem_bank_poke(bank, (uint16_t)(start + i), data[i], mi->context);
+        }
+    } else {
+        for (i = 0; i < len; i++) {
+            mi->mem_bank_write(bank, (uint16_t)(start + i), data[i], mi->context);
+        }
+    }
+}
+
+void mon_set_mem_block(MEMSPACE mem, uint16_t start, uint16_t end, const uint8_t *data)
+{
+    mon_set_mem_block_ex(mem, mon_interfaces[mem]->current_bank, start, end, data);
+}
+
 /* exit monitor, G XXXX  */
 void mon_jump(MON_ADDR addr)
 {
@@ -1246,6 +1323,8 @@ void mon_screenshot_save(const char *filename, int format)
     if (screenshot_save(drvname, filename, machine_video_canvas_get(0))) {
         mon_out("Failed.\n");
     }
+    /* scripts driving the monitor expect the file to be there */
+    screenshot_flush();
 }
 
 
@@ -1481,6 +1560,113 @@ void mon_stopwatch_reset(void)
     mon_out("Stopwatch reset to 0.\n");
 }
 
+static void mon_perfcounters_print(int group, unsigned int index,
+                                   const char *name, uint64_t count, void *data)
+{
+    char label[32];
+
+    switch (group) {
+        case PERF_GROUP_OPCODE_MAIN:
+        case PERF_GROUP_OPCODE_DRIVE:
+            snprintf(label, sizeof(label), "$%02x", index);
+            break;
+        case PERF_GROUP_MEM_READ:
+        case PERF_GROUP_MEM_WRITE:
+            snprintf(label, sizeof(label), "config %02x page $%02x", index >> 8, index & 0xff);
+            break;
+        default:
+            snprintf(label, sizeof(label), "%u", index);
+            break;
+    }
+    mon_out("%-12s %-30s %20"PRIu64"\n",
+            perf_counters_group_name(group), name != NULL ? name : label, count);
+}
+
+void mon_perfcounters(int reset)
+{
+    if (!perf_counters_available()) {
+        mon_out("Performance counters are not available, configure with --enable-perfcounters.\n");
+        return;
+    }
+    if (reset) {
+        perf_counters_reset();
+        mon_out("Performance counters reset to 0.\n");
+        return;
+    }
+    perf_counters_foreach(mon_perfcounters_print, NULL);
+}
+
+void mon_frametrace(int action)
+{
+    int enabled;
+
+    resources_get_int("FrameTrace", &enabled);
+    if (action == e_TOGGLE) {
+        action = enabled ? e_OFF : e_ON;
+    }
+    if (action == e_ON || action == e_OFF) {
+        enabled = action == e_ON;
+        resources_set_int("FrameTrace", enabled);
+    }
+    mon_out("Frame trace recording is %s.\n", enabled ? "on" : "off");
+}
+
+void mon_frametrace_save(const char *filename)
+{
+    int saved = frametrace_save(filename);
+
+    if (saved < 0) {
+        mon_out("Cannot save the frame trace to `%s'.\n", filename);
+    } else {
+        mon_out("Saved %d marks to `%s'.\n", saved, filename);
+    }
+}
+
+static void mon_memprofile_print(const char *site, uint64_t allocs, uint64_t bytes,
+                                 uint64_t live, uint64_t peak, void *data)
+{
+    mon_out("%12"PRIu64" %14"PRIu64" %14"PRIu64" %14"PRIu64"  %s\n",
+            allocs, bytes, live, peak, site);
+}
+
+void mon_memprofile(int num)
+{
+    if (num <= 0) {
+        num = 20;
+    }
+    mon_out("      Allocs          Bytes           Live           Peak  Site\n");
+    if (lib_profile_foreach((unsigned int)num, mon_memprofile_print, NULL) == 0) {
+        mon_out("No allocations recorded, start with 'memprofile on'.\n");
+    }
+}
+
+void mon_memprofile_action(int action)
+{
+    unsigned int interval = lib_profile_get_interval();
+
+    if (action == e_TOGGLE) {
+        action = interval != 0 ? e_OFF : e_ON;
+    }
+    if (action == e_ON) {
+        mon_memprofile_sample(-1);
+    } else {
+        lib_profile_stop();
+        mon_out("Allocation profiling stopped.\n");
+    }
+}
+
+void mon_memprofile_sample(int interval)
+{
+    if (interval < 0) {
+        interval = 100;
+    } else if (interval == 0) {
+        mon_out("Sample interval must be at least one allocation.\n");
+        return;
+    }
+    lib_profile_start((unsigned int)interval);
+    mon_out("Allocation profiling started, every %d allocations.\n", interval);
+}
+
 /* Local helper functions for building the lists */
 static monitor_cpu_type_t *find_monitor_cpu_type(CPU_TYPE_t cputype)
 {
@@ -1609,6 +1795,7 @@ void monitor_init(monitor_interface_t *maincpu_interface_init,
         monitor_mask[i] = MI_NONE;
         monitor_labels[i].name_list = NULL;
         for (j = 0; j < HASH_ARRAY_SIZE; j++) {
+            monitor_labels[i].name_hash_table[j] = NULL;
             monitor_labels[i].addr_hash_table[j] = NULL;
         }
     }
@@ -1664,6 +1851,7 @@ void monitor_shutdown(void)
     }
 
     mon_log_file_close();
+    mon_out_shutdown();
 
     list = monitor_cpu_type_list;
 
@@ -1682,6 +1870,7 @@ void monitor_shutdown(void)
     }
 
     mon_memmap_shutdown();
+    mon_disassemble_shutdown();
 
     while (playback_fp_stack_size) {
         playback_end_file();
@@ -1779,6 +1968,15 @@ static int set_monitor_log_enabled(int val, void *param)
     return 0;
 }
 
+static int monitorlogonly = 0;
+
+static int set_monitor_log_only(int val, void *param)
+{
+    monitorlogonly = val ? 1 : 0;
+    mon_log_file_set_only(monitorlogonly);
+    return 0;
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 static int monitorchislines = 0;
 static int set_monitor_chis_lines(int val, void *param)
@@ -1818,6 +2016,8 @@ static const resource_int_t resources_int[] = {
       &refresh_on_break, set_refresh_on_break, NULL },
     { "MonitorLogEnabled", 0, RES_EVENT_NO, NULL,
       &monitorlogenabled, set_monitor_log_enabled, NULL },
+    { "MonitorLogOnly", 0, RES_EVENT_NO, NULL,
+      &monitorlogonly, set_monitor_log_only, NULL },
 #ifdef FEATURE_CPUMEMHISTORY
     { "MonitorChisLines", 8192, RES_EVENT_NO, NULL,
       &monitorchislines, set_monitor_chis_lines, NULL },
@@ -1859,6 +2059,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+monlog", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "MonitorLogEnabled", (resource_value_t)0,
       NULL, "Disable logging monitor output to a file" },
+    { "-monlogonly", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorLogOnly", (resource_value_t)1,
+      NULL, "Write monitor output only to the log file while logging" },
+    { "+monlogonly", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorLogOnly", (resource_value_t)0,
+      NULL, "Write monitor output to the monitor window too while logging" },
     { "-initbreak", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
       monitor_set_initial_breakpoint, NULL, NULL, NULL,
       "<value>", "Set an initial breakpoint for the monitor: <address>, ready, or reset" },
@@ -2335,11 +2541,25 @@ static void playback_next_command(void)
 /* *** SYMBOL TABLE *** */
 
 
+static unsigned int hash_name(const char *name)
+{
+    unsigned int hash = 2166136261U;
+
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619U;
+    }
+    return hash & (HASH_ARRAY_SIZE - 1);
+}
+
+unsigned int mon_symbol_table_generation = 0;
+
 static void free_symbol_table(MEMSPACE mem)
 {
     symbol_entry_t *sym_ptr, *temp;
     int i;
 
+    mon_symbol_table_generation++;
+
     /* Remove name list */
     sym_ptr = monitor_labels[mem].name_list;
     while (sym_ptr) {
@@ -2359,6 +2579,12 @@ static void free_symbol_table(MEMSPACE mem)
             lib_free(temp);
         }
     }
+
+    monitor_labels[mem].name_list = NULL;
+    for (i = 0; i < HASH_ARRAY_SIZE; i++) {
+        monitor_labels[mem].name_hash_table[i] = NULL;
+        monitor_labels[mem].addr_hash_table[i] = NULL;
+    }
 }
 
 char *mon_symbol_table_lookup_name(MEMSPACE mem, uint16_t addr)
@@ -2395,12 +2621,12 @@ int mon_symbol_table_lookup_addr(MEMSPACE mem, char *name)
         return mon_register_name_to_value(mem, &name[1]);
     }
 
-    sym_ptr = monitor_labels[mem].name_list;
+    sym_ptr = monitor_labels[mem].name_hash_table[hash_name(name)];
     while (sym_ptr) {
         if (strcmp(sym_ptr->name, name) == 0) {
             return sym_ptr->addr;
         }
-        sym_ptr = sym_ptr->next;
+        sym_ptr = sym_ptr->hash_next;
     }
 
     return -1;
@@ -2448,14 +2674,23 @@ void mon_add_name_to_symbol_table(MON_ADDR addr, char *name)
         mon_remove_name_from_symbol_table(mem, name);
     }
 
-    /* Add name to name list */
+    mon_symbol_table_generation++;
+
+    /* Add name to name list and name hash table */
     sym_ptr = lib_malloc(sizeof(symbol_entry_t));
     sym_ptr->name = name;
     sym_ptr->addr = loc;
 
+    sym_ptr->prev = NULL;
     sym_ptr->next = monitor_labels[mem].name_list;
+    if (sym_ptr->next) {
+        sym_ptr->next->prev = sym_ptr;
+    }
     monitor_labels[mem].name_list = sym_ptr;
 
+    sym_ptr->hash_next = monitor_labels[mem].name_hash_table[hash_name(name)];
+    monitor_labels[mem].name_hash_table[hash_name(name)] = sym_ptr;
+
     /* Add address to hash table */
     sym_ptr = lib_malloc(sizeof(symbol_entry_t));
     sym_ptr->name = name;
@@ -2468,6 +2703,7 @@ void mon_add_name_to_symbol_table(MON_ADDR addr, char *name)
 void mon_remove_name_from_symbol_table(MEMSPACE mem, char *name)
 {
     int addr;
+    unsigned int hash;
     symbol_entry_t *sym_ptr, *prev_ptr;
 
     if (mem == e_default_space) {
@@ -2485,23 +2721,34 @@ void mon_remove_name_from_symbol_table(MEMSPACE mem, char *name)
         return;
     }
 
-    /* Remove entry in name list */
-    sym_ptr = monitor_labels[mem].name_list;
+    mon_symbol_table_generation++;
+
+    /* Remove entry in name list and name hash table */
+    hash = hash_name(name);
+    sym_ptr = monitor_labels[mem].name_hash_table[hash];
     prev_ptr = NULL;
     while (sym_ptr) {
         if (strcmp(sym_ptr->name, name) == 0) {
             /* Name memory is freed below. */
             addr = sym_ptr->addr;
             if (prev_ptr) {
-                prev_ptr->next = sym_ptr->next;
+                prev_ptr->hash_next = sym_ptr->hash_next;
+            } else {
+                monitor_labels[mem].name_hash_table[hash] = sym_ptr->hash_next;
+            }
+            if (sym_ptr->prev) {
+                sym_ptr->prev->next = sym_ptr->next;
             } else {
                 monitor_labels[mem].name_list = sym_ptr->next;
             }
+            if (sym_ptr->next) {
+                sym_ptr->next->prev = sym_ptr->prev;
+            }
             lib_free(sym_ptr);
             break;
         }
         prev_ptr = sym_ptr;
-        sym_ptr = sym_ptr->next;
+        sym_ptr = sym_ptr->hash_next;
     }
 
     /* Remove entry in address hash table */
@@ -2540,18 +2787,11 @@ void mon_print_symbol_table(MEMSPACE mem)
 
 void mon_clear_symbol_table(MEMSPACE mem)
 {
-    int i;
-
     if (mem == e_default_space) {
         mem = default_memspace;
     }
 
     free_symbol_table(mem);
-    monitor_labels[mem].name_list = NULL;
-
-    for (i = 0; i < HASH_ARRAY_SIZE; i++) {
-        monitor_labels[mem].addr_hash_table[i] = NULL;
-    }
 }
 
 
@@ -2608,6 +2848,75 @@ void mon_instruction_return(void)
     interrupt_monitor_trap_on(mon_interfaces[default_memspace]->int_status);
 }
 
+static void run_until_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(run_until_alarm);
+    monitor_startup_trap();
+}
+
+/* Forget the conditions of monitor_run_until(), called whenever the monitor
+   is entered.  */
+static void run_until_end(void)
+{
+    if (!run_until_active) {
+        return;
+    }
+    run_until_active = false;
+
+    alarm_unset(run_until_alarm);
+    vsync_set_unpaced_mode(0);
+
+    if (run_until_events & (MON_RUN_UNTIL_INTERRUPT | MON_RUN_UNTIL_PC)) {
+        monitor_mask[e_comp_space] &= ~MI_STEP;
+        if (!monitor_mask[e_comp_space]) {
+            interrupt_monitor_trap_off(mon_interfaces[e_comp_space]->int_status);
+        }
+    }
+}
+
+/** \brief  Run the machine for a budget of cycles or until an event
+ *
+ * Leaves the monitor and enters it again at the first instruction boundary
+ * after \a cycles cycles of the main CPU, or after one of \a events,
+ * whichever comes first.  The machine runs as fast as it can in the
+ * meantime, without waiting for the host to catch up with the emulated
+ * time.  Checking for an interrupt or a PC makes the CPU call the monitor
+ * before every instruction, a cycle budget or vsync alone costs nothing.
+ *
+ * \param[in]  cycles  cycle budget, 0 for none
+ * \param[in]  events  MON_RUN_UNTIL_* flags
+ * \param[in]  pc      address for MON_RUN_UNTIL_PC
+ */
+void monitor_run_until(CLOCK cycles, unsigned int events, uint16_t pc)
+{
+    run_until_end();
+
+    run_until_active = true;
+    run_until_events = events;
+    run_until_pc = pc;
+    run_until_start_clk = maincpu_clk;
+    run_until_interrupted = false;
+
+    if (cycles != 0) {
+        if (run_until_alarm == NULL) {
+            run_until_alarm = alarm_new(maincpu_alarm_context, "MonitorRunUntil",
+                                        run_until_alarm_handler, NULL);
+        }
+        alarm_set(run_until_alarm, maincpu_clk + cycles);
+    }
+
+    if (events & (MON_RUN_UNTIL_INTERRUPT | MON_RUN_UNTIL_PC)) {
+        instruction_count = 0;
+        monitor_mask[e_comp_space] |= MI_STEP;
+        interrupt_monitor_trap_on(mon_interfaces[e_comp_space]->int_status);
+    }
+
+    vsync_set_unpaced_mode(1);
+
+    exit_mon = exit_mon_continue;
+    mon_console_suspend_on_leaving = 0;
+}
+
 void mon_stack_up(int count)
 {
     mon_out("Going up %d stack frame(s).\n", (count >= 0) ? count : 1);
@@ -2805,6 +3114,28 @@ int mon_read_snapshot(const char *name, int even_mode)
 }
 
 
+void mon_rewind(int frames)
+{
+    int available = rewind_frames_available();
+    double fps = vsync_get_refresh_frequency();
+
+    if (frames < 0) {
+        mon_out("Rewind buffer: %d frames (%.1f seconds), %u KiB.\n",
+                available, fps > 0 ? available / fps : 0.0,
+                (unsigned int)(rewind_memory_used() >> 10));
+        return;
+    }
+
+    if (rewind_step_back_now(frames) < 0) {
+        mon_out("Nothing to rewind to.\n");
+        return;
+    }
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+}
+
+
 /* *** WATCHPOINTS *** */
 
 
@@ -2814,6 +3145,11 @@ void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    /* only queue addresses that are covered by a watchpoint */
+    if (!mon_breakpoint_check_map(mem, addr, e_load)) {
+        return;
+    }
+
     if (watch_load_count[mem] == MONITOR_MAX_CHECKPOINTS) {
         return;
     }
@@ -2829,6 +3165,11 @@ void monitor_watch_push_store_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    /* only queue addresses that are covered by a watchpoint */
+    if (!mon_breakpoint_check_map(mem, addr, e_store)) {
+        return;
+    }
+
     if (watch_store_count[mem] == MONITOR_MAX_CHECKPOINTS) {
         return;
     }
@@ -2882,6 +3223,14 @@ static bool watchpoints_check_stores(MEMSPACE mem, unsigned int lastpc, unsigned
 /* called by cpu core */
 void monitor_check_icount(uint16_t pc)
 {
+    if (run_until_active && maincpu_clk != run_until_start_clk
+        && (run_until_interrupted
+            || ((run_until_events & MON_RUN_UNTIL_PC) && pc == run_until_pc))) {
+        run_until_end();
+        monitor_startup(e_comp_space);
+        return;
+    }
+
     if (!instruction_count) {
         return;
     }
@@ -2941,6 +3290,10 @@ void monitor_check_icount_interrupt(void)
             wait_for_return_level++;
         }
     }
+
+    if (run_until_active && (run_until_events & MON_RUN_UNTIL_INTERRUPT)) {
+        run_until_interrupted = true;
+    }
 }
 
 /* called by macro DO_INTERRUPT() in 6510(dtv)core.c
@@ -3322,6 +3675,8 @@ void monitor_startup(MEMSPACE mem)
         return;
     }
 
+    run_until_end();
+
     if (ui_pause_active()) {
         should_pause_on_exit_mon = true;
 
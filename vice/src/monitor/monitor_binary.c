@@ -47,14 +47,19 @@
 #include "uiapi.h"
 #include "util.h"
 #include "vicesocket.h"
+#include "video.h"
 #include "machine.h"
+#include "metrics.h"
 #include "screenshot.h"
 #include "machine-video.h"
 #include "palette.h"
+#include "perfcounters.h"
 
 #include "mon_memmap.h"
 #include "mon_breakpoint.h"
+#include "mon_disassemble.h"
 #include "mon_file.h"
+#include "mon_memory.h"
 #include "mon_register.h"
 
 #include "version.h"
@@ -84,6 +89,10 @@ enum t_binary_command {
 
     e_MON_CMD_MEM_GET = 0x01,
     e_MON_CMD_MEM_SET = 0x02,
+    e_MON_CMD_MEM_GET_CHANGED = 0x03,
+    e_MON_CMD_MEM_HUNT = 0x04,
+    e_MON_CMD_MEM_FILL = 0x05,
+    e_MON_CMD_MEM_COMPARE = 0x06,
 
     e_MON_CMD_CHECKPOINT_GET = 0x11,
     e_MON_CMD_CHECKPOINT_SET = 0x12,
@@ -105,6 +114,7 @@ enum t_binary_command {
     e_MON_CMD_ADVANCE_INSTRUCTIONS = 0x71,
     e_MON_CMD_KEYBOARD_FEED = 0x72,
     e_MON_CMD_EXECUTE_UNTIL_RETURN = 0x73,
+    e_MON_CMD_RUN_UNTIL = 0x74,
 
     e_MON_CMD_PING = 0x81,
     e_MON_CMD_BANKS_AVAILABLE = 0x82,
@@ -112,6 +122,11 @@ enum t_binary_command {
     e_MON_CMD_DISPLAY_GET = 0x84,
     e_MON_CMD_VICE_INFO = 0x85,
     e_MON_CMD_CPUHISTORY_GET = 0x86,
+    e_MON_CMD_PERF_COUNTERS_GET = 0x87,
+    e_MON_CMD_TRACE_STREAM = 0x88,
+    e_MON_CMD_BATCH = 0x89,
+    e_MON_CMD_DISASSEMBLE = 0x8a,
+    e_MON_CMD_METRICS_GET = 0x8b,
 
     e_MON_CMD_PALETTE_GET = 0x91,
 
@@ -130,6 +145,10 @@ enum t_binary_response {
     e_MON_RESPONSE_INVALID = 0x00,
     e_MON_RESPONSE_MEM_GET = 0x01,
     e_MON_RESPONSE_MEM_SET = 0x02,
+    e_MON_RESPONSE_MEM_GET_CHANGED = 0x03,
+    e_MON_RESPONSE_MEM_HUNT = 0x04,
+    e_MON_RESPONSE_MEM_FILL = 0x05,
+    e_MON_RESPONSE_MEM_COMPARE = 0x06,
 
     e_MON_RESPONSE_CHECKPOINT_INFO = 0x11,
 
@@ -154,6 +173,7 @@ enum t_binary_response {
     e_MON_RESPONSE_ADVANCE_INSTRUCTIONS = 0x71,
     e_MON_RESPONSE_KEYBOARD_FEED = 0x72,
     e_MON_RESPONSE_EXECUTE_UNTIL_RETURN = 0x73,
+    e_MON_RESPONSE_RUN_UNTIL = 0x74,
 
     e_MON_RESPONSE_PING = 0x81,
     e_MON_RESPONSE_BANKS_AVAILABLE = 0x82,
@@ -161,6 +181,11 @@ enum t_binary_response {
     e_MON_RESPONSE_DISPLAY_GET = 0x84,
     e_MON_RESPONSE_VICE_INFO = 0x85,
     e_MON_RESPONSE_CPUHISTORY_GET = 0x86,
+    e_MON_RESPONSE_PERF_COUNTERS_GET = 0x87,
+    e_MON_RESPONSE_TRACE_STREAM = 0x88,
+    e_MON_RESPONSE_BATCH = 0x89,
+    e_MON_RESPONSE_DISASSEMBLE = 0x8a,
+    e_MON_RESPONSE_METRICS_GET = 0x8b,
 
     e_MON_RESPONSE_PALETTE_GET = 0x91,
 
@@ -207,6 +232,10 @@ struct binary_command_s {
 };
 typedef struct binary_command_s binary_command_t;
 
+static void monitor_binary_trace_stream_stop(void);
+static void monitor_binary_trace_stream_flush(void);
+static void mem_get_shutdown(void);
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     int error = 0;
@@ -224,8 +253,42 @@ int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
     return error;
 }
 
+/* Responses are queued and sent with one call, so the header and the body
+   do not end up in separate packets.  While handling commands the client
+   sent without waiting for the answers, the queue is held until all of them
+   are processed.  */
+static unsigned char *queue_buffer = NULL;
+static size_t queue_length = 0;
+static size_t queue_size = 0;
+static int queue_hold = 0;
+
+/* Append `length' bytes to the queue, returns their offset.  */
+static size_t monitor_binary_queue_reserve(size_t length)
+{
+    size_t offset = queue_length;
+
+    if (queue_length + length > queue_size) {
+        queue_size = (queue_length + length) * 2;
+        queue_buffer = lib_realloc(queue_buffer, queue_size);
+    }
+    queue_length += length;
+
+    return offset;
+}
+
+static void monitor_binary_queue_flush(void)
+{
+    if (queue_length > 0) {
+        monitor_binary_transmit(queue_buffer, queue_length);
+        queue_length = 0;
+    }
+}
+
 static void monitor_binary_quit(void)
 {
+    queue_length = 0;
+    monitor_binary_trace_stream_stop();
+    mem_get_shutdown();
     vice_network_socket_close(connected_socket);
     connected_socket = NULL;
 }
@@ -280,6 +343,8 @@ static int monitor_binary_data_available(void)
 
 void monitor_check_binary(void)
 {
+    monitor_binary_trace_stream_flush();
+
     if (monitor_binary_data_available()) {
         monitor_startup_trap();
     }
@@ -336,21 +401,30 @@ static uint16_t little_endian_to_uint16(unsigned char *input) {
     return (input[1] << 8) + input[0];
 }
 
-static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *body)
-{
-    unsigned char response[12];
+#define MON_RESPONSE_HEADER_SIZE 12
 
+static void write_response_header(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *response)
+{
     response[0] = ASC_STX;
     response[1] = MON_BINARY_API_VERSION;
     write_uint32(length, &response[2]);
     response[6] = (uint8_t)response_type;
     response[7] = (uint8_t)errorcode;
     write_uint32(request_id, &response[8]);
+}
+
+static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *body)
+{
+    size_t offset = monitor_binary_queue_reserve(MON_RESPONSE_HEADER_SIZE + (body != NULL ? length : 0));
 
-    monitor_binary_transmit(response, sizeof response);
+    write_response_header(length, response_type, errorcode, request_id, queue_buffer + offset);
 
     if (body != NULL) {
-        monitor_binary_transmit(body, length);
+        memcpy(queue_buffer + offset + MON_RESPONSE_HEADER_SIZE, body, length);
+    }
+
+    if (!queue_hold) {
+        monitor_binary_queue_flush();
     }
 }
 
@@ -768,6 +842,21 @@ static void monitor_binary_process_execute_until_return(binary_command_t *comman
     monitor_binary_response(0, e_MON_RESPONSE_EXECUTE_UNTIL_RETURN, e_MON_ERR_OK, command->request_id, NULL);
 }
 
+static void monitor_binary_process_run_until(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+
+    if (command->length < 7) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    monitor_run_until((CLOCK)little_endian_to_uint32(&body[0]), body[4],
+                      little_endian_to_uint16(&body[5]));
+
+    monitor_binary_response(0, e_MON_RESPONSE_RUN_UNTIL, e_MON_ERR_OK, command->request_id, NULL);
+}
+
 static void monitor_binary_process_autostart(binary_command_t *command)
 {
     unsigned char *body = command->body;
@@ -1260,6 +1349,9 @@ static void monitor_binary_process_display_get(binary_command_t *command)
         canvas = machine_video_canvas_get(0);
     }
 
+    /* from now on every frame is drawn for the client */
+    video_pixels_request();
+
     if(machine_screenshot(&screenshot, canvas) < 0) {
         monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
         return;
@@ -1458,6 +1550,7 @@ static void monitor_binary_process_cpuhistory(binary_command_t *command)
     uint64_t response_size;
     int item_size = 2 + registers_per_row * (MON_REGISTER_ITEM_SIZE + 1) + 8 + 1 + instruction_length;
 
+    cpuhistory_iter_t iter;
     cpuhistory_t *current;
 
     uint8_t requested_memspace = command->body[0];
@@ -1484,8 +1577,8 @@ static void monitor_binary_process_cpuhistory(binary_command_t *command)
         return;
     }
 
-    current = mon_cpuhistory_seek(requested_count, memspace, memspace, memspace, memspace, memspace);
-    while ((current = mon_cpuhistory_next(current, memspace, memspace, memspace, memspace, memspace))) {
+    mon_cpuhistory_seek(&iter, requested_count, memspace, memspace, memspace, memspace, memspace);
+    while (mon_cpuhistory_next(&iter, memspace, memspace, memspace, memspace, memspace)) {
         ++count;
         response_size = 4 + count * (item_size + 1);
         if (response_size >= UINT32_MAX) {
@@ -1550,8 +1643,8 @@ static void monitor_binary_process_cpuhistory(binary_command_t *command)
 
     response_cursor = write_uint32(count, response_cursor);
 
-    current = mon_cpuhistory_seek(count, memspace, memspace, memspace, memspace, memspace);
-    while ((current = mon_cpuhistory_next(current, memspace, memspace, memspace, memspace, memspace))) {
+    mon_cpuhistory_seek(&iter, count, memspace, memspace, memspace, memspace, memspace);
+    while ((current = mon_cpuhistory_next(&iter, memspace, memspace, memspace, memspace, memspace))) {
         if(reg_a != NULL) {
             reg_a->val = current->reg_a;
         }
@@ -1614,78 +1707,846 @@ static void monitor_binary_process_cpuhistory(binary_command_t *command)
 }
 #endif /* FEATURE_CPUMEMHISTORY */
 
-static void monitor_binary_process_mem_get(binary_command_t *command)
+/* Cursor for serializing the performance counters, with a NULL buffer
+   only the size is summed up.  */
+typedef struct perf_counters_cursor_s {
+    unsigned char *cursor;
+    uint32_t size;
+    uint32_t count;
+} perf_counters_cursor_t;
+
+static void perf_counters_write_item(int group, unsigned int index,
+                                     const char *name, uint64_t count, void *data)
+{
+    perf_counters_cursor_t *pc = data;
+    uint8_t name_length = name != NULL ? (uint8_t)strnlen(name, 255) : 0;
+    uint8_t item_size = 1 + 2 + 8 + 1 + name_length;
+
+    pc->size += item_size + 1;
+    pc->count++;
+
+    if (pc->cursor == NULL) {
+        return;
+    }
+
+    *pc->cursor = item_size;
+    ++pc->cursor;
+    *pc->cursor = (uint8_t)group;
+    ++pc->cursor;
+    pc->cursor = write_uint16((uint16_t)index, pc->cursor);
+    pc->cursor = write_uint64(count, pc->cursor);
+    pc->cursor = write_string(name_length, (unsigned char *)(name != NULL ? name : ""), pc->cursor);
+}
+
+static void monitor_binary_process_perf_counters_get(binary_command_t *command)
 {
+    perf_counters_cursor_t pc = { NULL, 4, 0 };
     unsigned char *response;
-    unsigned char *response_cursor;
+    uint8_t reset = command->length >= 1 ? command->body[0] : 0;
 
-    uint32_t response_size = 2;
-    int banknum = 0;
-    int old_sidefx = sidefx;
-    MEMSPACE memspace = e_default_space;
+    if (!perf_counters_available()) {
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
 
-    unsigned char *body = command->body;
+    perf_counters_foreach(perf_counters_write_item, &pc);
 
-    uint8_t new_sidefx = body[0];
+    response = lib_malloc(pc.size);
+    write_uint32(pc.count, response);
+    pc.cursor = response + 4;
+    pc.size = 4;
+    pc.count = 0;
+    perf_counters_foreach(perf_counters_write_item, &pc);
 
-    uint16_t startaddress = little_endian_to_uint16(&body[1]);
-    uint16_t endaddress = little_endian_to_uint16(&body[3]);
+    if (reset) {
+        perf_counters_reset();
+    }
 
-    uint8_t requested_memspace = body[5];
-    uint16_t requested_banknum = little_endian_to_uint16(&body[6]);
+    monitor_binary_response(pc.size, e_MON_RESPONSE_PERF_COUNTERS_GET, e_MON_ERR_OK, command->request_id, response);
 
-    uint32_t length = (endaddress + 1) - startaddress;
+    lib_free(response);
+}
 
-    if (startaddress > endaddress) {
-        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
-        log_message(LOG_DEFAULT, "monitor binary memget: wrong start and/or end address %04x - %04x",
-                    startaddress, endaddress);
+/* Serialize a metric, with a NULL buffer only the size is returned.  */
+static uint32_t metrics_write_item(const metric_value_t *value, unsigned char *cursor)
+{
+    uint8_t name_length = (uint8_t)strnlen(value->name, 255);
+    uint16_t item_size = 1 + 1 + name_length;
+    int i;
+
+    if (value->type == METRIC_HISTOGRAM) {
+        item_size += 8 + 8 + 1 + (METRIC_HISTOGRAM_BUCKETS - 1) * 16;
+    } else {
+        item_size += 8;
+    }
+
+    if (cursor == NULL) {
+        return item_size + 2;
+    }
+
+    cursor = write_uint16(item_size, cursor);
+    *cursor = (uint8_t)value->type;
+    ++cursor;
+    cursor = write_string(name_length, (unsigned char *)value->name, cursor);
+
+    if (value->type == METRIC_HISTOGRAM) {
+        cursor = write_uint64(value->count, cursor);
+        cursor = write_uint64(value->sum, cursor);
+        *cursor = METRIC_HISTOGRAM_BUCKETS - 1;
+        ++cursor;
+        for (i = 0; i < METRIC_HISTOGRAM_BUCKETS - 1; i++) {
+            cursor = write_uint64(value->bounds[i], cursor);
+            cursor = write_uint64(value->buckets[i], cursor);
+        }
+    } else if (value->type == METRIC_GAUGE) {
+        /* in thousandths */
+        write_uint64((uint64_t)(int64_t)(value->value * 1000.0), cursor);
+    } else {
+        write_uint64((uint64_t)value->value, cursor);
+    }
+
+    return item_size + 2;
+}
+
+static void monitor_binary_process_metrics_get(binary_command_t *command)
+{
+    metric_value_t values[METRIC_NUM];
+    unsigned char *response;
+    uint32_t size = 4;
+    int i;
+
+    for (i = 0; i < METRIC_NUM; i++) {
+        metrics_get(i, &values[i]);
+        size += metrics_write_item(&values[i], NULL);
+    }
+
+    response = lib_malloc(size);
+    write_uint32(METRIC_NUM, response);
+    size = 4;
+    for (i = 0; i < METRIC_NUM; i++) {
+        size += metrics_write_item(&values[i], response + size);
+    }
+
+    monitor_binary_response(size, e_MON_RESPONSE_METRICS_GET, e_MON_ERR_OK, command->request_id, response);
+
+    lib_free(response);
+}
+
+#ifdef FEATURE_CPUMEMHISTORY
+
+/* The trace stream sends the CPU history as it is stored, as events with
+   up to max_records records each.  It is flushed whenever the binary monitor
+   polls its socket, at most TRACE_STREAM_EVENTS_PER_FLUSH events at a time,
+   so a slow client never stalls the emulation for long: what it does not
+   take before the history buffer wraps around is dropped and counted.
+
+   Every record is encoded relative to the previous record of the same CPU,
+   starting from all zero when the stream is started.  */
+
+#define TRACE_STREAM_DEFAULT_RECORDS    4096
+#define TRACE_STREAM_EVENTS_PER_FLUSH   16
+
+/* flags byte of a trace record, set for the fields that follow */
+#define TRACE_FLAG_MEMSPACE 0x01    /* u8 memspace, else same as previous record */
+#define TRACE_FLAG_A        0x02    /* u8 A */
+#define TRACE_FLAG_X        0x04    /* u8 X */
+#define TRACE_FLAG_Y        0x08    /* u8 Y */
+#define TRACE_FLAG_SP       0x10    /* u8 SP */
+#define TRACE_FLAG_ST       0x20    /* u16 status */
+#define TRACE_FLAG_P1       0x40    /* u8 first operand byte */
+#define TRACE_FLAG_P2       0x80    /* u8 second operand byte */
+
+/* longest record: flags, memspace, two varints, opcode, registers, operands */
+#define TRACE_RECORD_MAX    (1 + 1 + 10 + 3 + 1 + 4 + 2 + 2)
+
+static struct {
+    int enabled;
+    MEMSPACE memspace;          /* e_invalid_space for all CPUs */
+    uint16_t max_records;
+    cpuhistory_iter_t iter;     /* last record sent */
+    uint32_t dropped;           /* records lost since the last event */
+    MEMSPACE last_memspace;
+    cpuhistory_t previous[NUM_MEMSPACES];
+    unsigned char *buffer;
+} trace_stream;
+
+static unsigned char *write_varint(uint64_t input, unsigned char *output)
+{
+    while (input >= 0x80) {
+        *output++ = (unsigned char)(input | 0x80);
+        input >>= 7;
+    }
+    *output++ = (unsigned char)input;
+
+    return output;
+}
+
+static unsigned char *trace_stream_write_record(const cpuhistory_t *current, unsigned char *output)
+{
+    cpuhistory_t *previous = &trace_stream.previous[current->origin];
+    unsigned char *flags = output++;
+    int16_t pc_delta = (int16_t)(current->addr - previous->addr);
+
+    *flags = 0;
+    if (current->origin != trace_stream.last_memspace) {
+        *flags |= TRACE_FLAG_MEMSPACE;
+        *output++ = memspace_to_uint8_t(current->origin);
+    }
+
+    /* the cycle only grows per CPU, the PC delta is zigzag encoded */
+    output = write_varint(current->cycle - previous->cycle, output);
+    output = write_varint((uint16_t)((pc_delta << 1) ^ (pc_delta >> 15)), output);
+    *output++ = current->op;
+
+    if (current->reg_a != previous->reg_a) {
+        *flags |= TRACE_FLAG_A;
+        *output++ = current->reg_a;
+    }
+    if (current->reg_x != previous->reg_x) {
+        *flags |= TRACE_FLAG_X;
+        *output++ = current->reg_x;
+    }
+    if (current->reg_y != previous->reg_y) {
+        *flags |= TRACE_FLAG_Y;
+        *output++ = current->reg_y;
+    }
+    if (current->reg_sp != previous->reg_sp) {
+        *flags |= TRACE_FLAG_SP;
+        *output++ = current->reg_sp;
+    }
+    if (current->reg_st != previous->reg_st) {
+        *flags |= TRACE_FLAG_ST;
+        output = write_uint16(current->reg_st, output);
+    }
+    if (current->p1 != previous->p1) {
+        *flags |= TRACE_FLAG_P1;
+        *output++ = current->p1;
+    }
+    if (current->p2 != previous->p2) {
+        *flags |= TRACE_FLAG_P2;
+        *output++ = current->p2;
+    }
+
+    *previous = *current;
+    trace_stream.last_memspace = current->origin;
+
+    return output;
+}
+
+static void monitor_binary_trace_stream_stop(void)
+{
+    trace_stream.enabled = 0;
+    lib_free(trace_stream.buffer);
+    trace_stream.buffer = NULL;
+}
+
+static void monitor_binary_trace_stream_flush(void)
+{
+    cpuhistory_t *current;
+    unsigned char *cursor;
+    uint16_t count;
+    int events;
+    MEMSPACE mem = trace_stream.memspace;
+
+    if (!trace_stream.enabled || connected_socket == NULL) {
         return;
     }
 
-    if (command->length < 8) {
+    for (events = 0; events < TRACE_STREAM_EVENTS_PER_FLUSH; events++) {
+        trace_stream.dropped += (uint32_t)mon_cpuhistory_catch_up(&trace_stream.iter);
+
+        cursor = trace_stream.buffer + 4 + 2;
+        count = 0;
+
+        while (count < trace_stream.max_records) {
+            if (mem == e_invalid_space) {
+                current = mon_cpuhistory_next(&trace_stream.iter, e_comp_space, e_disk8_space,
+                                              e_disk9_space, e_disk10_space, e_disk11_space);
+            } else {
+                current = mon_cpuhistory_next(&trace_stream.iter, mem, mem, mem, mem, mem);
+            }
+            if (current == NULL) {
+                break;
+            }
+            cursor = trace_stream_write_record(current, cursor);
+            count++;
+        }
+
+        if (count == 0 && trace_stream.dropped == 0) {
+            break;
+        }
+
+        write_uint32(trace_stream.dropped, trace_stream.buffer);
+        write_uint16(count, trace_stream.buffer + 4);
+        trace_stream.dropped = 0;
+
+        monitor_binary_response((uint32_t)(cursor - trace_stream.buffer), e_MON_RESPONSE_TRACE_STREAM,
+                                e_MON_ERR_OK, MON_EVENT_ID, trace_stream.buffer);
+
+        if (count < trace_stream.max_records) {
+            break;
+        }
+    }
+
+    /* what is left over is sent next time, unless the buffer wraps first */
+}
+
+static void monitor_binary_process_trace_stream(binary_command_t *command)
+{
+    uint8_t enable;
+    uint8_t requested_memspace;
+    uint16_t max_records;
+    MEMSPACE memspace = e_invalid_space;
+
+    if (command->length < 4) {
         monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
         return;
     }
 
-    memspace = get_requested_memspace(requested_memspace);
+    enable = command->body[0];
+    requested_memspace = command->body[1];
+    max_records = little_endian_to_uint16(&command->body[2]);
 
-    if(memspace == e_invalid_space) {
+    if (requested_memspace != 0xff) {
+        memspace = get_requested_memspace(requested_memspace);
+        if (memspace == e_invalid_space) {
+            monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary trace stream: Unknown memspace %u", requested_memspace);
+            return;
+        }
+    }
+
+    monitor_binary_trace_stream_stop();
+
+    if (enable) {
+        if (max_records == 0) {
+            max_records = TRACE_STREAM_DEFAULT_RECORDS;
+        }
+        memset(&trace_stream, 0, sizeof(trace_stream));
+        trace_stream.enabled = 1;
+        trace_stream.memspace = memspace;
+        trace_stream.max_records = max_records;
+        mon_cpuhistory_head(&trace_stream.iter);
+        trace_stream.last_memspace = e_invalid_space;
+        trace_stream.buffer = lib_malloc(4 + 2 + (size_t)max_records * TRACE_RECORD_MAX);
+    }
+
+    monitor_binary_response(0, e_MON_RESPONSE_TRACE_STREAM, e_MON_ERR_OK, command->request_id, NULL);
+}
+
+#else
+
+static void monitor_binary_trace_stream_stop(void)
+{
+}
+
+static void monitor_binary_trace_stream_flush(void)
+{
+}
+
+static void monitor_binary_process_trace_stream(binary_command_t *command)
+{
+    monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+}
+
+#endif /* FEATURE_CPUMEMHISTORY */
+
+/* Debuggers poll large ranges many times a second, so the response buffer
+   of mem_get is kept between requests.  */
+static unsigned char *mem_get_buffer = NULL;
+static size_t mem_get_buffer_size = 0;
+
+/* Memory as last sent by mem_get_changed, per memspace and bank.  */
+#define MEM_DIFF_SHADOWS    8
+/* Unchanged bytes between two changed ranges that are sent instead of
+   starting a new range, which costs 4 bytes.  */
+#define MEM_DIFF_MIN_GAP    4
+
+typedef struct mem_diff_shadow_s {
+    MEMSPACE memspace;
+    int banknum;
+    uint8_t mem[0x10000];
+    uint8_t known[0x10000 / 8];     /* bytes that were sent */
+} mem_diff_shadow_t;
+
+static mem_diff_shadow_t *mem_diff_shadows[MEM_DIFF_SHADOWS];
+static int mem_diff_evict = 0;
+
+static unsigned char *mem_get_buffer_get(size_t size)
+{
+    if (size > mem_get_buffer_size) {
+        mem_get_buffer = lib_realloc(mem_get_buffer, size);
+        mem_get_buffer_size = size;
+    }
+    return mem_get_buffer;
+}
+
+static void mem_get_shutdown(void)
+{
+    int i;
+
+    lib_free(mem_get_buffer);
+    mem_get_buffer = NULL;
+    mem_get_buffer_size = 0;
+
+    for (i = 0; i < MEM_DIFF_SHADOWS; i++) {
+        lib_free(mem_diff_shadows[i]);
+        mem_diff_shadows[i] = NULL;
+    }
+}
+
+static mem_diff_shadow_t *mem_diff_shadow_get(MEMSPACE memspace, int banknum)
+{
+    mem_diff_shadow_t *shadow;
+    int i;
+
+    for (i = 0; i < MEM_DIFF_SHADOWS; i++) {
+        shadow = mem_diff_shadows[i];
+        if (shadow != NULL && shadow->memspace == memspace && shadow->banknum == banknum) {
+            return shadow;
+        }
+    }
+
+    for (i = 0; i < MEM_DIFF_SHADOWS && mem_diff_shadows[i] != NULL; i++) {
+    }
+    if (i == MEM_DIFF_SHADOWS) {
+        i = mem_diff_evict;
+        mem_diff_evict = (mem_diff_evict + 1) % MEM_DIFF_SHADOWS;
+        lib_free(mem_diff_shadows[i]);
+    }
+
+    shadow = lib_calloc(1, sizeof(mem_diff_shadow_t));
+    shadow->memspace = memspace;
+    shadow->banknum = banknum;
+    mem_diff_shadows[i] = shadow;
+
+    return shadow;
+}
+
+/* Parse the body shared by mem_get and mem_get_changed, sends the error
+   response and returns -1 when it is invalid.  */
+static int mem_get_parse(binary_command_t *command, uint8_t *new_sidefx, uint16_t *startaddress,
+                         uint16_t *endaddress, MEMSPACE *memspace, int *banknum)
+{
+    unsigned char *body = command->body;
+    uint8_t requested_memspace;
+    uint16_t requested_banknum;
+
+    if (command->length < 8) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return -1;
+    }
+
+    *new_sidefx = body[0];
+    *startaddress = little_endian_to_uint16(&body[1]);
+    *endaddress = little_endian_to_uint16(&body[3]);
+    requested_memspace = body[5];
+    requested_banknum = little_endian_to_uint16(&body[6]);
+
+    if (*startaddress > *endaddress) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memget: wrong start and/or end address %04x - %04x",
+                    *startaddress, *endaddress);
+        return -1;
+    }
+
+    *memspace = get_requested_memspace(requested_memspace);
+
+    if(*memspace == e_invalid_space) {
         monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
         log_message(LOG_DEFAULT, "monitor binary memget: Unknown memspace %u", requested_memspace);
-        return;
+        return -1;
     }
 
-    if (mon_banknum_validate(memspace, requested_banknum) == 0) {
+    if (mon_banknum_validate(*memspace, requested_banknum) == 0) {
         monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
         log_message(LOG_DEFAULT, "monitor binary memget: Unknown bank %u", requested_banknum);
-        return;
+        return -1;
     }
 
-    banknum = requested_banknum;
+    *banknum = requested_banknum;
+
+    return 0;
+}
+
+static void monitor_binary_process_mem_get(binary_command_t *command)
+{
+    unsigned char *response;
+    uint32_t response_size = 2;
+    int banknum;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace;
+    uint8_t new_sidefx;
+    uint16_t startaddress, endaddress;
+    uint32_t length;
 
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    length = (endaddress + 1) - startaddress;
     response_size += length;
 
-    response = lib_malloc(response_size);
-    response_cursor = response;
+    response = mem_get_buffer_get(response_size);
 
-    response_cursor = write_uint16(length, response_cursor);
+    write_uint16(length, response);
 
+    /* read straight into the response */
     sidefx = !!new_sidefx;
-    mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, response_cursor);
+    mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, response + 2);
     sidefx = old_sidefx;
 
-    response_cursor += length;
-
     monitor_binary_response(response_size, e_MON_RESPONSE_MEM_GET, e_MON_ERR_OK, command->request_id, response);
+}
 
-    lib_free(response);
+static void monitor_binary_process_mem_get_changed(binary_command_t *command)
+{
+    static uint8_t data[0x10000];
+    mem_diff_shadow_t *shadow;
+    unsigned char *response;
+    unsigned char *response_cursor;
+    int banknum;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace;
+    uint8_t new_sidefx;
+    uint16_t startaddress, endaddress;
+    uint32_t length, addr, range_start, range_end, gap;
+    uint16_t count = 0;
+
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    length = (endaddress + 1) - startaddress;
+
+    sidefx = !!new_sidefx;
+    mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, data);
+    sidefx = old_sidefx;
+
+    shadow = mem_diff_shadow_get(memspace, banknum);
+
+    /* every range has at least one byte and ranges are at least
+       MEM_DIFF_MIN_GAP apart */
+    response = mem_get_buffer_get(2 + length + 4 * (length / (MEM_DIFF_MIN_GAP + 1) + 1));
+    response_cursor = response + 2;
+
+    addr = startaddress;
+    while (addr <= endaddress) {
+        /* find the next changed byte */
+        while (addr <= endaddress
+               && (shadow->known[addr >> 3] & (1 << (addr & 7)))
+               && shadow->mem[addr] == data[addr - startaddress]) {
+            addr++;
+        }
+        if (addr > endaddress) {
+            break;
+        }
+
+        /* extend the range until MEM_DIFF_MIN_GAP unchanged bytes follow */
+        range_start = addr;
+        range_end = addr;
+        gap = 0;
+        for (addr++; addr <= endaddress && gap < MEM_DIFF_MIN_GAP; addr++) {
+            if ((shadow->known[addr >> 3] & (1 << (addr & 7)))
+                && shadow->mem[addr] == data[addr - startaddress]) {
+                gap++;
+            } else {
+                range_end = addr;
+                gap = 0;
+            }
+        }
+        addr = range_end + 1;
+
+        response_cursor = write_uint16((uint16_t)range_start, response_cursor);
+        response_cursor = write_uint16((uint16_t)range_end, response_cursor);
+        memcpy(response_cursor, &data[range_start - startaddress], range_end - range_start + 1);
+        response_cursor += range_end - range_start + 1;
+        count++;
+    }
+
+    write_uint16(count, response);
+
+    memcpy(&shadow->mem[startaddress], data, length);
+    for (addr = startaddress; addr <= endaddress; addr++) {
+        shadow->known[addr >> 3] |= (1 << (addr & 7));
+    }
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_MEM_GET_CHANGED,
+                            e_MON_ERR_OK, command->request_id, response);
 }
 
-static void monitor_binary_process_mem_set(binary_command_t *command)
+static void monitor_binary_process_mem_hunt(binary_command_t *command)
 {
+    static uint8_t data[0x10000];
+    unsigned char *body = command->body;
+    unsigned char *response;
+    unsigned char *response_cursor;
+    uint8_t pattern[0x100];
+    uint8_t *mask;
+    unsigned int pattern_length;
     unsigned int i;
+    int banknum;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace;
+    uint8_t new_sidefx;
+    uint16_t startaddress, endaddress;
+    uint32_t length;
+    uint32_t count = 0;
+    long found;
+
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    if (command->length < 9) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    pattern_length = body[8];
+    if (command->length < 9 + pattern_length * 2) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    if (pattern_length == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        return;
+    }
 
+    mask = &body[9 + pattern_length];
+    for (i = 0; i < pattern_length; i++) {
+        pattern[i] = body[9 + i] & mask[i];
+    }
+
+    length = (endaddress + 1) - startaddress;
+
+    sidefx = !!new_sidefx;
+    mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, data);
+    sidefx = old_sidefx;
+
+    response = mem_get_buffer_get(4 + length * 2);
+    response_cursor = response + 4;
+
+    found = mon_memory_find(data, length, pattern, mask, pattern_length, 0);
+    while (found >= 0) {
+        response_cursor = write_uint16((uint16_t)(startaddress + found), response_cursor);
+        count++;
+        found = mon_memory_find(data, length, pattern, mask, pattern_length, (unsigned int)found + 1);
+    }
+
+    write_uint32(count, response);
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_MEM_HUNT,
+                            e_MON_ERR_OK, command->request_id, response);
+}
+
+static void monitor_binary_process_mem_fill(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+    unsigned char *data;
+    unsigned int pattern_length;
+    int banknum;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace;
+    uint8_t new_sidefx;
+    uint16_t startaddress, endaddress;
+    uint32_t length, i, n;
+
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    if (command->length < 9) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    pattern_length = body[8];
+    if (command->length < 9 + pattern_length) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    if (pattern_length == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        return;
+    }
+
+    length = (endaddress + 1) - startaddress;
+
+    /* double the copied pattern until the range is full */
+    data = mem_get_buffer_get(length);
+    i = pattern_length < length ? pattern_length : length;
+    memcpy(data, &body[9], i);
+    while (i < length) {
+        n = (length - i) < i ? (length - i) : i;
+        memcpy(data + i, data, n);
+        i += n;
+    }
+
+    sidefx = !!new_sidefx;
+    mon_set_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, data);
+    sidefx = old_sidefx;
+
+    monitor_binary_response(0, e_MON_RESPONSE_MEM_FILL, e_MON_ERR_OK, command->request_id, NULL);
+}
+
+static void monitor_binary_process_mem_compare(binary_command_t *command)
+{
+    static uint8_t data[0x10000];
+    static uint8_t dest_data[0x10000];
+    unsigned char *body = command->body;
+    unsigned char *response;
+    unsigned char *response_cursor;
+    int banknum, dest_banknum;
+    int old_sidefx = sidefx;
+    MEMSPACE memspace, dest_memspace;
+    uint8_t new_sidefx;
+    uint8_t requested_memspace;
+    uint16_t requested_banknum;
+    uint16_t startaddress, endaddress, destaddress;
+    uint32_t length, i, j, chunk;
+    uint32_t count = 0;
+
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    if (command->length < 13) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    destaddress = little_endian_to_uint16(&body[8]);
+    requested_memspace = body[10];
+    requested_banknum = little_endian_to_uint16(&body[11]);
+
+    dest_memspace = get_requested_memspace(requested_memspace);
+
+    if (dest_memspace == e_invalid_space) {
+        monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memcompare: Unknown memspace %u", requested_memspace);
+        return;
+    }
+
+    if (mon_banknum_validate(dest_memspace, requested_banknum) == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary memcompare: Unknown bank %u", requested_banknum);
+        return;
+    }
+
+    dest_banknum = requested_banknum;
+
+    length = (endaddress + 1) - startaddress;
+
+    sidefx = !!new_sidefx;
+    mon_get_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, data);
+    mon_get_mem_block_ex(dest_memspace, dest_banknum, destaddress, endaddress - startaddress, dest_data);
+    sidefx = old_sidefx;
+
+    response = mem_get_buffer_get(4 + length * 4);
+    response_cursor = response + 4;
+
+    /* skip equal chunks with memcmp(), only look at the bytes of the others */
+    for (i = 0; i < length; i += chunk) {
+        chunk = (length - i) < 64 ? (length - i) : 64;
+        if (memcmp(&data[i], &dest_data[i], chunk) == 0) {
+            continue;
+        }
+        for (j = i; j < i + chunk; j++) {
+            if (data[j] != dest_data[j]) {
+                response_cursor = write_uint16((uint16_t)(startaddress + j), response_cursor);
+                *response_cursor++ = data[j];
+                *response_cursor++ = dest_data[j];
+                count++;
+            }
+        }
+    }
+
+    write_uint32(count, response);
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_MEM_COMPARE,
+                            e_MON_ERR_OK, command->request_id, response);
+}
+
+/* Longest label and instruction text returned by disassemble, so that an
+   item fits in the 255 bytes of its size field.  */
+#define DISASSEMBLE_TEXT_MAX    120
+
+/* Largest item of the disassemble response, including its size byte.  */
+#define DISASSEMBLE_ITEM_MAX    (1 + 1 + 2 + 1 + 5 + 1 + DISASSEMBLE_TEXT_MAX * 2)
+
+static void monitor_binary_process_disassemble(binary_command_t *command)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+    unsigned char *item;
+    size_t offset;
+    int banknum;
+    MEMSPACE memspace;
+    uint8_t new_sidefx;
+    uint16_t startaddress, endaddress;
+    uint32_t addr;
+    uint32_t count = 0;
+    uint8_t opc[5];
+    unsigned opc_size;
+    const char *text;
+    char *label;
+    size_t len;
+
+    /* the instructions are always read without side effects */
+    if (mem_get_parse(command, &new_sidefx, &startaddress, &endaddress, &memspace, &banknum) < 0) {
+        return;
+    }
+
+    response = mem_get_buffer_get(4 + DISASSEMBLE_ITEM_MAX);
+    response_cursor = response + 4;
+
+    addr = startaddress;
+    while (addr <= endaddress) {
+        offset = (size_t)(response_cursor - response);
+        response = mem_get_buffer_get(offset + DISASSEMBLE_ITEM_MAX);
+        item = response + offset;
+        response_cursor = item + 1;
+
+        text = mon_disassemble_bank(memspace, banknum, (uint16_t)addr, opc, &opc_size);
+        if (opc_size < 1) {
+            opc_size = 1;
+        } else if (opc_size > 5) {
+            opc_size = 5;
+        }
+
+        response_cursor = write_uint16((uint16_t)addr, response_cursor);
+        response_cursor = write_string((uint8_t)opc_size, opc, response_cursor);
+
+        label = mon_symbol_table_lookup_name(memspace, (uint16_t)addr);
+        len = label ? strlen(label) : 0;
+        if (len > DISASSEMBLE_TEXT_MAX) {
+            len = DISASSEMBLE_TEXT_MAX;
+        }
+        response_cursor = write_string((uint8_t)len, (unsigned char *)(label ? label : ""), response_cursor);
+
+        len = strlen(text);
+        if (len > DISASSEMBLE_TEXT_MAX) {
+            len = DISASSEMBLE_TEXT_MAX;
+        }
+        response_cursor = write_string((uint8_t)len, (unsigned char *)text, response_cursor);
+
+        *item = (uint8_t)(response_cursor - item - 1);
+        count++;
+
+        addr += opc_size;
+    }
+
+    write_uint32(count, response);
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_DISASSEMBLE,
+                            e_MON_ERR_OK, command->request_id, response);
+}
+
+static void monitor_binary_process_mem_set(binary_command_t *command)
+{
     int banknum = 0;
     const int header_size = 8;
     int old_sidefx = sidefx;
@@ -1734,16 +2595,75 @@ static void monitor_binary_process_mem_set(binary_command_t *command)
     DBG(("monitor_binary_process_mem_set %04x-%04x (=length:%04x) bank:%d memspace:%d", startaddress, endaddress, length, banknum, memspace));
 
     sidefx = !!new_sidefx;
-    for (i = 0; i < length; i++) {
-        DBG(("%04x:%02x", (uint16_t)ADDR_LIMIT(startaddress + i), body[header_size + i]));
-        mon_set_mem_val_ex(memspace, banknum, (uint16_t)ADDR_LIMIT(startaddress + i), body[header_size + i]);
-    }
+    mon_set_mem_block_ex(memspace, banknum, startaddress, endaddress - startaddress, &body[header_size]);
     sidefx = old_sidefx;
 
     monitor_binary_response(0, e_MON_RESPONSE_MEM_SET, e_MON_ERR_OK, command->request_id, NULL);
 }
 
 
+static void monitor_binary_process_command(unsigned char * pbuffer);
+
+/* The header of a command up to the body: STX, API version, body length,
+   request ID and command type.  */
+#define MON_COMMAND_HEADER_SIZE 11
+
+static void monitor_binary_process_batch(binary_command_t *command)
+{
+    unsigned char *cursor = command->body;
+    uint32_t remaining = command->length;
+    uint32_t body_length;
+    size_t offset;
+    int old_queue_hold = queue_hold;
+
+    /* check the framing of all commands before running any of them */
+    while (remaining > 0) {
+        if (remaining < MON_COMMAND_HEADER_SIZE || cursor[0] != ASC_STX) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        body_length = little_endian_to_uint32(&cursor[2]);
+        if (body_length > remaining - MON_COMMAND_HEADER_SIZE) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        cursor += MON_COMMAND_HEADER_SIZE + body_length;
+        remaining -= MON_COMMAND_HEADER_SIZE + body_length;
+    }
+
+    /* the responses of the commands follow the header of the batch response
+       in the queue */
+    queue_hold = 1;
+    offset = monitor_binary_queue_reserve(MON_RESPONSE_HEADER_SIZE);
+
+    cursor = command->body;
+    remaining = command->length;
+    while (remaining > 0 && exit_mon == exit_mon_no) {
+        body_length = little_endian_to_uint32(&cursor[2]);
+        if (cursor[10] == e_MON_CMD_BATCH) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_TYPE, little_endian_to_uint32(&cursor[6]));
+        } else {
+            monitor_binary_process_command(cursor);
+        }
+        cursor += MON_COMMAND_HEADER_SIZE + body_length;
+        remaining -= MON_COMMAND_HEADER_SIZE + body_length;
+    }
+
+    queue_hold = old_queue_hold;
+
+    if (connected_socket == NULL) {
+        /* quit by one of the commands */
+        return;
+    }
+
+    write_response_header((uint32_t)(queue_length - offset - MON_RESPONSE_HEADER_SIZE),
+                          e_MON_RESPONSE_BATCH, e_MON_ERR_OK, command->request_id, queue_buffer + offset);
+
+    if (!queue_hold) {
+        monitor_binary_queue_flush();
+    }
+}
+
 static void monitor_binary_process_command(unsigned char * pbuffer)
 {
     BINARY_COMMAND command_type;
@@ -1775,6 +2695,14 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_mem_get(&command);
     } else if (command_type == e_MON_CMD_MEM_SET) {
         monitor_binary_process_mem_set(&command);
+    } else if (command_type == e_MON_CMD_MEM_GET_CHANGED) {
+        monitor_binary_process_mem_get_changed(&command);
+    } else if (command_type == e_MON_CMD_MEM_HUNT) {
+        monitor_binary_process_mem_hunt(&command);
+    } else if (command_type == e_MON_CMD_MEM_FILL) {
+        monitor_binary_process_mem_fill(&command);
+    } else if (command_type == e_MON_CMD_MEM_COMPARE) {
+        monitor_binary_process_mem_compare(&command);
 
     } else if (command_type == e_MON_CMD_CHECKPOINT_GET) {
         monitor_binary_process_checkpoint_get(&command);
@@ -1811,6 +2739,8 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_keyboard_feed(&command);
     } else if (command_type == e_MON_CMD_EXECUTE_UNTIL_RETURN) {
         monitor_binary_process_execute_until_return(&command);
+    } else if (command_type == e_MON_CMD_RUN_UNTIL) {
+        monitor_binary_process_run_until(&command);
 
     } else if (command_type == e_MON_CMD_PALETTE_GET) {
         monitor_binary_process_palette_get(&command);
@@ -1831,6 +2761,16 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_vice_info(&command);
     } else if (command_type == e_MON_CMD_CPUHISTORY_GET) {
         monitor_binary_process_cpuhistory(&command);
+    } else if (command_type == e_MON_CMD_PERF_COUNTERS_GET) {
+        monitor_binary_process_perf_counters_get(&command);
+    } else if (command_type == e_MON_CMD_TRACE_STREAM) {
+        monitor_binary_process_trace_stream(&command);
+    } else if (command_type == e_MON_CMD_BATCH) {
+        monitor_binary_process_batch(&command);
+    } else if (command_type == e_MON_CMD_DISASSEMBLE) {
+        monitor_binary_process_disassemble(&command);
+    } else if (command_type == e_MON_CMD_METRICS_GET) {
+        monitor_binary_process_metrics_get(&command);
 
     } else if (command_type == e_MON_CMD_EXIT) {
         monitor_binary_process_exit(&command);
@@ -1953,13 +2893,19 @@ int monitor_binary_get_command_line(void)
             n += o;
         }
 
+        /* answers to pipelined commands are sent together */
+        queue_hold = 1;
         monitor_binary_process_command(buffer);
+        queue_hold = 0;
 
         if (exit_mon != exit_mon_no) {
+            monitor_binary_queue_flush();
             return 0;
         }
     }
 
+    monitor_binary_queue_flush();
+
     return 1;
 }
 
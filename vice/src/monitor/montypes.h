@@ -299,6 +299,8 @@ void mon_display_io_regs(MON_ADDR addr);
 void mon_evaluate_default_addr(MON_ADDR *a);
 void mon_set_mem_val(MEMSPACE mem, uint16_t mem_addr, uint8_t val);
 void mon_set_mem_val_ex(MEMSPACE mem, int bank, uint16_t mem_addr, uint8_t val);
+void mon_set_mem_block(MEMSPACE mem, uint16_t mem_start, uint16_t mem_end, const uint8_t *data);
+void mon_set_mem_block_ex(MEMSPACE mem, int bank, uint16_t mem_start, uint16_t mem_end, const uint8_t *data);
 bool mon_inc_addr_location(MON_ADDR *a, unsigned inc);
 void mon_start_assemble_mode(MON_ADDR addr, char *asm_line);
 long mon_evaluate_address_range(MON_ADDR *start_addr, MON_ADDR *end_addr, bool must_be_range, uint16_t default_len);
@@ -309,6 +311,7 @@ void mon_delete_conditional(cond_node_t *cnode);
 int mon_evaluate_conditional(cond_node_t *cnode);
 int mon_write_snapshot(const char* name, int save_roms, int save_disks, int even_mode);
 int mon_read_snapshot(const char* name, int even_mode);
+void mon_rewind(int frames);
 bool mon_is_valid_addr(MON_ADDR a);
 bool mon_is_in_range(MON_ADDR start_addr, MON_ADDR end_addr, unsigned loc);
 void mon_print_bin(int val, char on, char off);
@@ -327,6 +330,8 @@ void mon_exit(void);
 void mon_quit(void);
 void mon_keyboard_feed(const char *string);
 char *mon_symbol_table_lookup_name(MEMSPACE mem, uint16_t addr);
+/* changed whenever a label is added or removed */
+extern unsigned int mon_symbol_table_generation;
 int mon_symbol_table_lookup_addr(MEMSPACE mem, char *name);
 char* mon_prepend_dot_to_name(char *name);
 void mon_add_name_to_symbol_table(MON_ADDR addr, char *name);
@@ -345,6 +350,12 @@ void mon_export(void);
 
 void mon_stopwatch_show(const char* prefix, const char* suffix);
 void mon_stopwatch_reset(void);
+void mon_perfcounters(int reset);
+void mon_frametrace(int action);
+void mon_frametrace_save(const char *filename);
+void mon_memprofile(int num);
+void mon_memprofile_action(int action);
+void mon_memprofile_sample(int interval);
 void mon_maincpu_trace(void);
 void mon_maincpu_toggle_trace(int state);
 
@@ -32,6 +32,7 @@
 #ifdef HAVE_NETWORK
 
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,6 +52,8 @@
 #include "mos6510.h"
 #include "network.h"
 #include "resources.h"
+#include "snapshot.h"
+#include "sound.h"
 #include "types.h"
 #include "uiapi.h"
 #include "util.h"
@@ -86,11 +89,225 @@ static int res_server_port;
 static int frame_delta;
 static int network_control;
 
-static int frame_buffer_full;
-static int current_frame, frame_to_play;
+static int current_frame;
 static event_list_state_t *frame_event_list = NULL;
 static char *snapshotfilename;
 
+/* Every frame both sides send the inputs recorded during it, preceded by
+   a header (see network_send_frame()). The inputs of a frame are played
+   back at the end of the frame `frame_delta' - 1 frames later. */
+
+/* Number of frames kept of the local and remote inputs */
+#define NETWORK_FRAME_RING          128
+
+/* Largest input delay */
+#define NETWORK_MAX_DELAY           64
+
+/* Frame, sync frame, 5 registers, 3 timing and 2 delay values preceding
+   the events of a frame */
+#define NETWORK_FRAME_HEADER        (12 * 4)
+
+/* Marks an unused frame or tick in the header */
+#define NETWORK_NO_FRAME            0xffffffff
+
+/* Frame being emulated, numbered from the connection */
+static int network_frame;
+
+/* Newest frame the remote inputs have been received for */
+static int remote_frame;
+
+/* Newest frame whose inputs have been played back in lockstep */
+static int played_frame;
+
+static event_list_state_t *remote_frame_list[NETWORK_FRAME_RING];
+
+/* Adaptive delay: both sides keep measuring the round trip time with the
+   timestamps in the frame headers, and derive the delay they want from the
+   slowest round trip of the last few seconds. The server takes the larger
+   of its own and the one the client wants, and announces a new delay a few
+   frames before it switches to it, so both sides switch at the same frame.
+   The delay is raised at once but only lowered one frame at a time: first
+   after the lower one has been enough for a while, then every second while
+   it stays enough. Only used in lockstep. */
+
+/* Frames of delay added to the one-way latency */
+#define NETWORK_DELAY_MARGIN        3
+
+/* Seconds the slowest round trip time is kept for */
+#define NETWORK_DELAY_WINDOW        2
+
+/* Seconds a lower delay must be enough before it is used */
+#define NETWORK_DELAY_SETTLE        5
+
+/* Seconds between lowering the delay again while a lower one is enough */
+#define NETWORK_DELAY_STEP          1
+
+/* "NetworkAdaptiveDelay" resource */
+static int adaptive_delay_enabled;
+
+/* Delay switched to at `delay_switch_frame', -1 if none is pending */
+static int delay_switch_frame = -1;
+static int delay_switch_to;
+
+/* Frame the client switched the delay at last */
+static int delay_switched_frame = -1;
+
+/* Delay the client wants, as received by the server */
+static int remote_delay_wanted;
+
+/* Frames a lower delay has been enough for */
+static int delay_settle;
+
+/* Round trip time and its mean deviation in ticks */
+static int rtt_valid;
+static double rtt_smoothed;
+static double rtt_deviation;
+
+/* Slowest round trip time in ticks in the current and the previous half of
+   the window, and when the current half started */
+static tick_t rtt_max[2];
+static tick_t rtt_max_start;
+
+/* Send tick of the newest remote frame and when it was read, for echoing */
+static int echo_valid;
+static tick_t echo_tick;
+static tick_t echo_read_tick;
+static tick_t last_echo_seen;
+
+/* Statistics of the connection, see network_get_stats() */
+static network_stats_t stats;
+static uint64_t wait_ticks;
+
+/* Rollback: instead of waiting for the inputs of the remote side every
+   frame, the emulation goes on assuming the remote inputs did not change.
+   The machine state is saved before the inputs of such a frame are played
+   back. Once the real remote inputs for it arrive and turn out to contain
+   anything, the state is restored and the frames up to the current one are
+   emulated again, with the real inputs and without being shown or heard.
+
+   The local side may run at most "NetworkRollbackFrames" frames ahead of
+   the inputs it has from the remote, it waits like in lockstep otherwise.
+   The server decides whether rollback is used for a connection. */
+
+/* Largest number of frames that can be predicted */
+#define NETWORK_ROLLBACK_MAX        30
+
+/* Largest input delay used together with rollback */
+#define NETWORK_ROLLBACK_MAX_DELAY  32
+
+/* Number of machine states kept, must be larger than NETWORK_ROLLBACK_MAX */
+#define NETWORK_ROLLBACK_STATES     32
+
+/* "NetworkRollbackFrames" resource */
+static int rollback_frames_resource;
+
+/* Frames predicted at most on this connection, 0 when running in lockstep */
+static int rollback_frames = 0;
+
+/* Oldest frame that has to be emulated again, -1 if none */
+static int rollback_to;
+
+/* Flag: frames are emulated again up to `rollback_resim_end' */
+static int rollback_resimulating = 0;
+static int rollback_resim_end;
+
+/* Frame whose end is handled by the next network_rollback_trap() */
+static int rollback_step_frame;
+
+static uint32_t rollback_regs[NETWORK_FRAME_RING][5];
+static snapshot_memory_t *rollback_state[NETWORK_ROLLBACK_STATES];
+static int rollback_state_frame[NETWORK_ROLLBACK_STATES];
+
+/* Newest frame whose state can no longer change on either side */
+static int sync_frame;
+static int remote_sync_frame;
+static uint32_t remote_sync_regs[5];
+
+/* Spectators: the server sends the inputs it plays back every frame to
+   read-only spectators, which play them back at the end of the same frames
+   as the server. Every "NetworkSpectatorKeyframe" seconds a keyframe, a
+   snapshot taken at the end of a frame, replaces the frames before it, so
+   a spectator joining late gets the newest keyframe and the frames played
+   since, then follows the live ones. A spectator may accept spectators of
+   its own, passing the frames on and taking its own keyframes, to relay the
+   game to more viewers. Spectators only cost the bandwidth of the inputs,
+   and of a keyframe when joining.
+
+   Like the frames of the players, every message starts with its length
+   as 4 bytes:
+
+   - keyframe header: frame of the keyframe, 1 if the inputs are played
+     back in a trap after the end of the frame (rollback), 0 if right at
+     its end (lockstep)
+   - the settings that need to be the same, like for a client
+   - the keyframe snapshot
+   - one per frame: the frame, then the event lists to play back at its
+     end, each preceded by its length, in the order they are played back
+
+   The frames are queued for every spectator and sent as far as it takes
+   them without blocking; a spectator too far behind is dropped. */
+
+/* Largest number of spectators of one emulator */
+#define NETWORK_SPECTATORS_MAX          32
+
+/* Frames kept after a keyframe before a new one is taken early */
+#define NETWORK_SPECTATOR_BACKLOG_MAX   (1024 * 1024)
+
+/* Bytes queued for a spectator besides a keyframe before it is dropped */
+#define NETWORK_SPECTATOR_QUEUE_MAX     (4 * 1024 * 1024)
+
+/* Bytes sent to a spectator at once, small enough not to block */
+#define NETWORK_SPECTATOR_CHUNK         1024
+
+typedef struct network_buffer_s {
+    uint8_t *data;
+    size_t size;
+    size_t max;
+} network_buffer_t;
+
+typedef struct network_spectator_s {
+    vice_network_socket_t *socket;
+    int joined;                 /* got a keyframe */
+    network_buffer_t queue;     /* messages to send from `sent' on */
+    size_t sent;
+} network_spectator_t;
+
+/* "NetworkSpectators", "NetworkSpectatorPort" and "NetworkSpectatorKeyframe"
+   resources */
+static int spectators_max;
+static int spectator_port;
+static int spectator_keyframe_seconds;
+
+static vice_network_socket_t *spectator_listen_socket;
+static network_spectator_t spectators[NETWORK_SPECTATORS_MAX];
+
+/* Messages of the newest keyframe, and the frames since */
+static network_buffer_t spectator_keyframe;
+static network_buffer_t spectator_backlog;
+static int spectator_keyframe_frame = -1;
+static int spectator_keyframe_due;
+
+/* Frame message being put together */
+static network_buffer_t spectator_frame;
+
+/* Newest frame sent to the spectators */
+static int spectator_sent_frame;
+
+/* Flag: the inputs are played back in a trap after the end of the frame */
+static int spectator_trap_playback;
+
+/* Spectator: frame being emulated, and its message while it waits for
+   network_spectator_play_trap() */
+static int spectator_play_frame;
+static uint8_t *spectator_play_buf;
+static unsigned int spectator_play_len;
+
+/* Spectator: messages received when connecting */
+static uint8_t *spectator_join_settings;
+static unsigned int spectator_join_settings_len;
+static uint8_t *spectator_join_snapshot;
+static unsigned int spectator_join_snapshot_len;
+
 static int set_server_name(const char *val, void *param)
 {
     util_string_set(&server_name, val);
@@ -116,6 +333,57 @@ static int set_server_port(int val, void *param)
     return 0;
 }
 
+static int set_rollback_frames(int val, void *param)
+{
+    if (val < 0 || val > NETWORK_ROLLBACK_MAX) {
+        return -1;
+    }
+
+    rollback_frames_resource = val;
+
+    return 0;
+}
+
+static int set_adaptive_delay(int val, void *param)
+{
+    adaptive_delay_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
+static int set_spectators(int val, void *param)
+{
+    if (val < 0 || val > NETWORK_SPECTATORS_MAX) {
+        return -1;
+    }
+
+    spectators_max = val;
+
+    return 0;
+}
+
+static int set_spectator_port(int val, void *param)
+{
+    if (val < 1024 || val > 65535) {
+        return -1;
+    }
+
+    spectator_port = val;
+
+    return 0;
+}
+
+static int set_spectator_keyframe(int val, void *param)
+{
+    if (val < 1 || val > 600) {
+        return -1;
+    }
+
+    spectator_keyframe_seconds = val;
+
+    return 0;
+}
+
 static int set_network_control(int val, void *param)
 {
     network_control = val;
@@ -141,6 +409,16 @@ static const resource_int_t resources_int[] = {
       &res_server_port, set_server_port, NULL },
     { "NetworkControl", NETWORK_CONTROL_DEFAULT, RES_EVENT_SAME, NULL,
       &network_control, set_network_control, NULL },
+    { "NetworkRollbackFrames", 8, RES_EVENT_NO, NULL,
+      &rollback_frames_resource, set_rollback_frames, NULL },
+    { "NetworkAdaptiveDelay", 1, RES_EVENT_NO, NULL,
+      &adaptive_delay_enabled, set_adaptive_delay, NULL },
+    { "NetworkSpectators", 0, RES_EVENT_NO, NULL,
+      &spectators_max, set_spectators, NULL },
+    { "NetworkSpectatorPort", 6503, RES_EVENT_NO, NULL,
+      &spectator_port, set_spectator_port, NULL },
+    { "NetworkSpectatorKeyframe", 10, RES_EVENT_NO, NULL,
+      &spectator_keyframe_seconds, set_spectator_keyframe, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -225,6 +503,24 @@ static const cmdline_option_t cmdline_options[] =
     { "-netplayctrl", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
       network_control_cmd, NULL, NULL, NULL,
       "<key,joy1,joy2,dev,rsrc>", "Set the netplay control elements (keyboard, joystick1, joystick2, devices and resources), each item takes a value (0: None, 1: Server, 2: Client, 3: Both)" },
+    { "-netplayrollback", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkRollbackFrames", NULL,
+      "<frames>", "Set the number of frames the server may predict the remote input for (0: lockstep)" },
+    { "-netplayadaptive", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkAdaptiveDelay", (resource_value_t)1,
+      NULL, "Enable adjusting the netplay frame delay to the connection while playing" },
+    { "+netplayadaptive", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkAdaptiveDelay", (resource_value_t)0,
+      NULL, "Disable adjusting the netplay frame delay to the connection while playing" },
+    { "-netplayspectators", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkSpectators", NULL,
+      "<number>", "Set the number of netplay spectators accepted (0: none)" },
+    { "-netplayspectatorport", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkSpectatorPort", NULL,
+      "<port>", "Set the port used for netplay spectators" },
+    { "-netplaykeyframe", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkSpectatorKeyframe", NULL,
+      "<seconds>", "Set the number of seconds between the snapshots netplay spectators can join from" },
     CMDLINE_LIST_END
 };
 
@@ -241,12 +537,21 @@ static void network_free_frame_event_list(void)
     int i;
     DBG(("network_free_frame_event_list"));
     if (frame_event_list != NULL) {
-        for (i = 0; i < frame_delta; i++) {
+        for (i = 0; i < NETWORK_FRAME_RING; i++) {
             event_clear_list(&(frame_event_list[i]));
         }
         lib_free(frame_event_list);
         frame_event_list = NULL;
     }
+    for (i = 0; i < NETWORK_FRAME_RING; i++) {
+        if (remote_frame_list[i] != NULL) {
+            event_clear_list(remote_frame_list[i]);
+            lib_free(remote_frame_list[i]);
+            remote_frame_list[i] = NULL;
+        }
+    }
+    rollback_resimulating = 0;
+    delay_switch_frame = -1;
     event_destroy_image_list();
 }
 
@@ -265,98 +570,97 @@ static void network_event_record_sync_test(uint16_t addr, void *data)
 
 static void network_init_frame_event_list(void)
 {
+    int i;
+
     DBG(("network_init_frame_event_list"));
-    frame_event_list = lib_malloc(sizeof(event_list_state_t) * frame_delta);
-    memset(frame_event_list, 0, sizeof(event_list_state_t) * frame_delta);
+    frame_event_list = lib_malloc(sizeof(event_list_state_t) * NETWORK_FRAME_RING);
+    memset(frame_event_list, 0, sizeof(event_list_state_t) * NETWORK_FRAME_RING);
     current_frame = 0;
-    frame_buffer_full = 0;
     event_register_event_list(&(frame_event_list[0]));
     event_init_image_list();
-    interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
+
+    network_frame = 0;
+    remote_frame = -1;
+    played_frame = -1;
+
+    delay_switch_frame = -1;
+    remote_delay_wanted = frame_delta;
+    delay_settle = 0;
+    rtt_valid = 0;
+    echo_valid = 0;
+    delay_switched_frame = -1;
+    memset(&stats, 0, sizeof(stats));
+    stats.frame_delay = frame_delta;
+    wait_ticks = 0;
+    sync_frame = -1;
+
+    /* the spectators get a keyframe at the first frame */
+    spectator_keyframe_frame = -1;
+    spectator_keyframe_due = 0;
+    spectator_backlog.size = 0;
+    spectator_sent_frame = -1;
+    spectator_trap_playback = rollback_frames > 0;
+
+    if (rollback_frames > 0) {
+        /* the registers are exchanged separately, see network_rollback_sync() */
+        rollback_to = -1;
+        rollback_resimulating = 0;
+        for (i = 0; i < NETWORK_ROLLBACK_STATES; i++) {
+            rollback_state_frame[i] = -1;
+        }
+        remote_sync_frame = -1;
+    } else {
+        interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
+    }
 }
 
 static void network_prepare_next_frame(void)
 {
     DBGT(("network_prepare_next_frame"));
-    current_frame = (current_frame + 1) % frame_delta;
-    frame_to_play = (current_frame + 1) % frame_delta;
+    network_frame++;
+    current_frame = network_frame % NETWORK_FRAME_RING;
     event_clear_list(&(frame_event_list[current_frame]));
     event_register_event_list(&(frame_event_list[current_frame]));
-    interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
+    if (rollback_frames == 0) {
+        interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
+    }
 }
 
+/* The events of a frame are sent encoded by eventlog.  */
 static unsigned int network_create_event_buffer(uint8_t **buf,
                                                 event_list_state_t *list)
 {
-    int size;
-    uint8_t *bufptr;
-    event_list_t *current_event, *last_event;
-    int data_len = 0;
-    int num_of_events;
+    size_t size;
 
     DBGT(("network_create_event_buffer"));
 
     if (list == NULL) {
+        *buf = NULL;
         return 0;
     }
 
-    /* calculate the buffer length */
-    num_of_events = 0;
-    current_event = list->base;
-    do {
-        num_of_events++;
-        data_len += current_event->size;
-        last_event = current_event;
-        current_event = current_event->next;
-    } while (last_event->type != EVENT_LIST_END);
-
-    size = num_of_events * 3 * sizeof(uint32_t) + data_len;
-
-    *buf = lib_malloc(size);
-
-    /* fill the buffer with the events */
-    current_event = list->base;
-    bufptr = *buf;
-    do {
-        util_dword_to_le_buf(&bufptr[0], (uint32_t)(current_event->type));
-        util_dword_to_le_buf(&bufptr[4], (uint32_t)(current_event->clk));
-        util_dword_to_le_buf(&bufptr[8], (uint32_t)(current_event->size));
-        memcpy(&bufptr[12], current_event->data, current_event->size);
-        bufptr += 12 + current_event->size;
-        last_event = current_event;
-        current_event = current_event->next;
-    } while (last_event->type != EVENT_LIST_END);
+    *buf = event_list_encode(list, &size);
 
-    return size;
+    return (unsigned int)size;
 }
 
-static event_list_state_t *network_create_event_list(uint8_t *remote_event_buffer)
+static event_list_state_t *network_create_event_list(uint8_t *remote_event_buffer,
+                                                     unsigned int len)
 {
     event_list_state_t *list;
-    unsigned int type, size;
-    uint8_t *data = NULL;
-    uint8_t *bufptr = remote_event_buffer;
 
-    DBGT(("network_create_event_list entry: %p", bufptr));
+    DBGT(("network_create_event_list entry: %p", remote_event_buffer));
 
     list = lib_malloc(sizeof(event_list_state_t));
     event_register_event_list(list);
 
-    if (bufptr == NULL) {
+    if (remote_event_buffer == NULL) {
         log_error(LOG_DEFAULT, "network_create_event_list: got NULL pointer");
         event_record_in_list(list, EVENT_LIST_END, NULL, 0);
     } else {
-        do {
-            DBGT(("network_create_event_list: %p", bufptr));
-            type = util_le_buf_to_dword(&bufptr[0]);
-            /*  clk = util_le_buf_to_dword(&bufptr[4]); */
-            size = util_le_buf_to_dword(&bufptr[8]);
-            data = &bufptr[12];
-            bufptr += 12 + size;
-            event_record_in_list(list, type, data, size);
-        } while (type != EVENT_LIST_END);
-    }
-    DBGT(("network_create_event_list exit: %p", bufptr));
+        event_list_decode(list, remote_event_buffer, len);
+    }
+    DBGT(("network_create_event_list exit"));
 
     return list;
 }
@@ -370,8 +674,9 @@ static ssize_t network_recv_buffer(vice_network_socket_t * s, uint8_t *buf, ssiz
     while (received_total < len) {
         t = vice_network_receive(s, buf, len - received_total, 0);
 
-        if (t < 0) {
-            return t;
+        /* 0 means the remote closed the connection */
+        if (t <= 0) {
+            return -1;
         }
 
         received_total += t;
@@ -414,8 +719,10 @@ typedef struct {
 
 static int network_test_delay(void)
 {
-    int i, j, ret = -1;
+    int i, j, delay, ret = -1;
     uint8_t new_frame_delta = 5; /* default to use on error */
+    uint8_t new_rollback_frames = 0;
+    uint8_t params[2];
     unsigned char *buf;
     testpacket pkt;
 
@@ -456,10 +763,28 @@ static int network_test_delay(void)
 
         /* calculate delay with 90% of packets beeing fast enough */
         /* FIXME: This needs some further investigation */
-        new_frame_delta = 5 + (uint8_t)(vsync_get_refresh_frequency()
-                                     * packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]
-                                     / (float)tick_per_second());
-        if (network_send_buffer(network_socket, &new_frame_delta, sizeof(new_frame_delta)) < 0) {
+        delay = 5 + (int)(vsync_get_refresh_frequency()
+                          * packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]
+                          / (float)tick_per_second());
+        new_frame_delta = (uint8_t)(delay > NETWORK_MAX_DELAY ? NETWORK_MAX_DELAY : delay);
+
+        /* with rollback the prediction hides the latency, not the delay */
+        new_rollback_frames = (uint8_t)rollback_frames_resource;
+        if (new_rollback_frames > 0) {
+            if (new_frame_delta > new_rollback_frames) {
+                new_frame_delta -= new_rollback_frames;
+            } else {
+                new_frame_delta = 1;
+            }
+            if (new_frame_delta > NETWORK_ROLLBACK_MAX_DELAY) {
+                new_frame_delta = NETWORK_ROLLBACK_MAX_DELAY;
+            }
+        }
+
+        params[0] = new_frame_delta;
+        params[1] = new_rollback_frames;
+        if (network_send_buffer(network_socket, params, sizeof(params)) < 0) {
+            new_rollback_frames = 0;
             goto exiterror;
         }
     } else {
@@ -472,16 +797,32 @@ static int network_test_delay(void)
                 goto exiterror;
             }
         }
-        network_recv_buffer(network_socket, &new_frame_delta,
-                            sizeof(new_frame_delta));
+        if (network_recv_buffer(network_socket, params, sizeof(params)) < 0) {
+            goto exiterror;
+        }
+        if (params[0] == 0
+            || params[0] > NETWORK_MAX_DELAY
+            || params[1] > NETWORK_ROLLBACK_MAX
+            || (params[1] > 0 && params[0] > NETWORK_ROLLBACK_MAX_DELAY)) {
+            goto exiterror;
+        }
+        new_frame_delta = params[0];
+        new_rollback_frames = params[1];
     }
     ret = 0;
 exiterror:
     network_free_frame_event_list();
     frame_delta = new_frame_delta;
+    rollback_frames = new_rollback_frames;
     network_init_frame_event_list();
-    sprintf(st, "Using %d frames delay.", frame_delta);
-    log_debug(LOG_DEFAULT, "netplay connected with %d frames delta.", frame_delta);
+    if (rollback_frames > 0) {
+        sprintf(st, "Using %d frames delay, predicting up to %d frames.",
+                frame_delta, rollback_frames);
+    } else {
+        sprintf(st, "Using %d frames delay.", frame_delta);
+    }
+    log_debug(LOG_DEFAULT, "netplay connected with %d frames delta, %d frames rollback.",
+              frame_delta, rollback_frames);
     ui_display_statustext(st, true);
     return ret;
 }
@@ -595,7 +936,7 @@ static void network_client_connect_trap(uint16_t addr, void *data)
         return;
     }
 
-    settings_list = network_create_event_list(buf);
+    settings_list = network_create_event_list(buf, (unsigned int)buf_size);
     lib_free(buf);
 
     event_playback_event_list(settings_list);
@@ -623,170 +964,665 @@ static void network_client_connect_trap(uint16_t addr, void *data)
 
 /*-------------------------------------------------------------------------*/
 
-void network_event_record(unsigned int type, void *data, unsigned int size)
+static void network_buffer_append(network_buffer_t *b, const void *data, size_t len)
 {
-    unsigned int control = 0;
-    uint16_t joyport;
+    if (b->size + len > b->max) {
+        b->max = (b->size + len) * 2;
+        b->data = lib_realloc(b->data, b->max);
+    }
+    memcpy(b->data + b->size, data, len);
+    b->size += len;
+}
 
-    DBGT(("network_event_record type: %u size: %u", type, size));
+static void network_buffer_append_message(network_buffer_t *b, const void *data, size_t len)
+{
+    uint8_t len4[4];
 
-    switch (type) {
-        case EVENT_KEYBOARD_MATRIX:
-        case EVENT_KEYBOARD_RESTORE:
-        case EVENT_KEYBOARD_DELAY:
-        case EVENT_KEYBOARD_CLEAR:
-            control = NETWORK_CONTROL_KEYB;
-            break;
-        case EVENT_ATTACHDISK:
-        case EVENT_ATTACHTAPE:
-        case EVENT_DATASETTE:
-            control = NETWORK_CONTROL_DEVC;
-            break;
-        case EVENT_RESOURCE:
-        case EVENT_RESETCPU:
-            control = NETWORK_CONTROL_RSRC;
-            break;
-        case EVENT_JOYSTICK_VALUE:
-            joyport = ((uint16_t *)data)[0];
-            if (joyport == 1) {
-                control = NETWORK_CONTROL_JOY1;
-            }
-            if (joyport == 2) {
-                control = NETWORK_CONTROL_JOY2;
-            }
-            break;
-        default:
-            control = 0;
-    }
+    util_int_to_le_buf4(len4, (int)len);
+    network_buffer_append(b, len4, 4);
+    network_buffer_append(b, data, len);
+}
 
-    if (network_get_mode() == NETWORK_CLIENT) {
-        control <<= NETWORK_CONTROL_CLIENTOFFSET;
-    }
+static void network_buffer_free(network_buffer_t *b)
+{
+    lib_free(b->data);
+    b->data = NULL;
+    b->size = 0;
+    b->max = 0;
+}
 
-    if (control != 0 && (control & network_control) == 0) {
-        return;
+/* Receive a message preceded by its length, NULL on error */
+static uint8_t *network_recv_message(vice_network_socket_t *s, unsigned int *len)
+{
+    uint8_t len4[4];
+    uint8_t *buf;
+
+    if (network_recv_buffer(s, len4, 4) < 0) {
+        return NULL;
+    }
+    *len = (unsigned int)util_le_buf4_to_int(len4);
+    buf = lib_malloc(*len + 1);
+    if (network_recv_buffer(s, buf, *len) < 0) {
+        lib_free(buf);
+        return NULL;
     }
+    return buf;
+}
 
-    event_record_in_list(&(frame_event_list[current_frame]), type, data, size);
+static void network_spectator_drop(network_spectator_t *spectator)
+{
+    vice_network_socket_close(spectator->socket);
+    spectator->socket = NULL;
+    network_buffer_free(&spectator->queue);
+    spectator->sent = 0;
 }
 
-void network_attach_image(unsigned int unit, const char *filename)
+/* Drop the spectators, but keep accepting new ones */
+static void network_spectators_drop(void)
 {
-    /* TODO: drive 1? */
-    unsigned int drive = 0;
+    int i;
 
-    unsigned int control = NETWORK_CONTROL_DEVC;
+    for (i = 0; i < NETWORK_SPECTATORS_MAX; i++) {
+        if (spectators[i].socket != NULL) {
+            network_spectator_drop(&spectators[i]);
+        }
+    }
+    spectator_keyframe_frame = -1;
+}
 
-    DBG(("network_attach_image unit: %u filename: %s", unit, filename));
+static void network_spectators_listen(void)
+{
+    vice_network_socket_address_t *addr;
 
-    if (network_get_mode() == NETWORK_CLIENT) {
-        control <<= NETWORK_CONTROL_CLIENTOFFSET;
+    if (spectators_max == 0 || spectator_listen_socket != NULL) {
+        return;
     }
 
-    if ((control & network_control) == 0) {
+    addr = vice_network_address_generate(server_bind_address, (unsigned short)spectator_port);
+    if (addr == NULL) {
+        log_error(LOG_DEFAULT, "netplay: cannot listen for spectators on port %d.", spectator_port);
         return;
     }
-
-    event_record_attach_in_list(&(frame_event_list[current_frame]), unit, drive, filename, 1);
+    spectator_listen_socket = vice_network_server(addr);
+    vice_network_address_close(addr);
+    if (spectator_listen_socket == NULL) {
+        log_error(LOG_DEFAULT, "netplay: cannot listen for spectators on port %d.", spectator_port);
+    }
 }
 
-int network_get_mode(void)
+static void network_spectators_close(void)
 {
-    return network_mode;
+    network_spectators_drop();
+    vice_network_socket_close(spectator_listen_socket);
+    spectator_listen_socket = NULL;
+    network_buffer_free(&spectator_keyframe);
+    network_buffer_free(&spectator_backlog);
+    network_buffer_free(&spectator_frame);
 }
 
-int network_connected(void)
+/* Take a keyframe at the end of `frame', from a trap */
+static void network_spectator_keyframe(int frame)
 {
-    if ((network_mode == NETWORK_SERVER_CONNECTED) ||
-        (network_mode == NETWORK_CLIENT)) {
-        return 1;
+    snapshot_memory_t *mem;
+    event_list_state_t settings_list;
+    uint8_t header[8];
+    uint8_t *buf;
+    unsigned int len;
+    int i, err;
+
+    spectator_keyframe_due = frame + (int)(spectator_keyframe_seconds * vsync_get_refresh_frequency());
+
+    mem = snapshot_memory_new();
+    snapshot_memory_redirect(mem);
+    err = machine_write_snapshot("", 1, 1, 0);
+    snapshot_memory_redirect(NULL);
+    if (err < 0) {
+        log_error(LOG_DEFAULT, "netplay: cannot take a keyframe for the spectators.");
+        snapshot_memory_free(mem);
+        return;
     }
-    return 0;
-}
-
-int network_start_server(void)
-{
-    vice_network_socket_address_t * server_addr = NULL;
-    int ret = -1;
 
-    DBG(("network_start_server (network_mode is: %u) on %s:%d",
-         network_mode, server_bind_address, server_port));
+    spectator_keyframe.size = 0;
+    util_dword_to_le_buf(&header[0], (uint32_t)frame);
+    util_dword_to_le_buf(&header[4], (uint32_t)spectator_trap_playback);
+    network_buffer_append_message(&spectator_keyframe, header, sizeof(header));
 
-    do {
-        if (network_mode != NETWORK_IDLE) {
-            break;
-        }
+    event_register_event_list(&settings_list);
+    resources_get_event_safe_list(&settings_list);
+    len = network_create_event_buffer(&buf, &settings_list);
+    network_buffer_append_message(&spectator_keyframe, buf, len);
+    event_clear_list(&settings_list);
+    lib_free(buf);
 
-        server_addr = vice_network_address_generate(server_bind_address, server_port);
-        if (!server_addr) {
-            DBG(("vice_network_address_generate failed, can not start server."));
-            break;
-        }
+    network_buffer_append_message(&spectator_keyframe, snapshot_memory_data(mem),
+                                  snapshot_memory_size(mem));
+    snapshot_memory_free(mem);
 
-        listen_socket = vice_network_server(server_addr);
-        if (!listen_socket) {
-            DBG(("vice_network_address_generate failed, can not start server."));
-            break;
-        }
+    spectator_backlog.size = 0;
+    spectator_keyframe_frame = frame;
 
-        /* Setup strict event safe values for the resources that need it */
-        if (resources_set_event_safe() < 0) {
-            ui_error("Warning! Failed to set netplay-safe settings.");
+    /* spectators that connected before there was a keyframe */
+    for (i = 0; i < NETWORK_SPECTATORS_MAX; i++) {
+        if (spectators[i].socket != NULL && !spectators[i].joined) {
+            network_buffer_append(&spectators[i].queue, spectator_keyframe.data,
+                                  spectator_keyframe.size);
+            spectators[i].joined = 1;
         }
+    }
+}
 
-        network_mode = NETWORK_SERVER;
-
-        vsync_suspend_speed_eval();
-        sound_suspend();
+static void network_spectator_keyframe_trap(uint16_t addr, void *data)
+{
+    network_spectator_keyframe(vice_ptr_to_int(data));
+}
 
-        ui_display_statustext("Server is waiting for a client...", false);
+/* The inputs of `frame' were played back, see whether a keyframe is due */
+static void network_spectators_frame_done(int frame, int in_trap)
+{
+    if (spectator_listen_socket == NULL) {
+        return;
+    }
+    if (frame >= spectator_keyframe_due
+        || spectator_backlog.size > NETWORK_SPECTATOR_BACKLOG_MAX) {
+        spectator_keyframe_due = INT32_MAX;
+        if (in_trap) {
+            network_spectator_keyframe(frame);
+        } else {
+            interrupt_maincpu_trigger_trap(network_spectator_keyframe_trap,
+                                           vice_int_to_ptr(frame));
+        }
+    }
+}
 
-        ret = 0;
-    } while (0);
+/* Send a message to the spectators and keep it for the ones joining */
+static void network_spectators_send(const uint8_t *data, size_t len)
+{
+    int i;
 
-    if (network_mode == NETWORK_SERVER_CONNECTED) {
-        ui_display_statustext("Client connected...", true);
+    if (spectator_listen_socket == NULL) {
+        return;
     }
 
-    if (server_addr) {
-        vice_network_address_close(server_addr);
+    network_buffer_append_message(&spectator_backlog, data, len);
+    for (i = 0; i < NETWORK_SPECTATORS_MAX; i++) {
+        if (spectators[i].socket != NULL && spectators[i].joined) {
+            network_buffer_append_message(&spectators[i].queue, data, len);
+        }
     }
-
-    return ret;
 }
 
+static void network_spectators_frame_begin(int frame)
+{
+    uint8_t frame4[4];
 
-int network_connect_client(void)
+    spectator_frame.size = 0;
+    util_dword_to_le_buf(frame4, (uint32_t)frame);
+    network_buffer_append(&spectator_frame, frame4, 4);
+}
+
+static void network_spectators_frame_add(event_list_state_t *list)
 {
-    vice_network_socket_address_t * server_addr;
-    FILE *f;
     uint8_t *buf;
-    uint8_t recv_buf4[4];
-    size_t buf_size;
-
-    DBG(("network_connect_client (network_mode is: %u)", network_mode));
+    unsigned int len;
 
-    if (network_mode != NETWORK_IDLE) {
-        return -1;
+    if (spectator_listen_socket == NULL) {
+        return;
     }
+    len = network_create_event_buffer(&buf, list);
+    network_buffer_append_message(&spectator_frame, buf, len);
+    lib_free(buf);
+}
 
-    vsync_suspend_speed_eval();
+static void network_spectators_frame_end(int frame)
+{
+    network_spectators_send(spectator_frame.data, spectator_frame.size);
+    spectator_sent_frame = frame;
+}
 
-    snapshotfilename = NULL;
+/* Accept new spectators, and send the queued messages as far as they go
+   without blocking */
+static void network_spectators_update(void)
+{
+    vice_network_socket_t *s;
+    network_spectator_t *spectator;
+    ssize_t n;
+    size_t len;
+    int i, count = 0;
 
-    f = archdep_mkstemp_fd(&snapshotfilename, MODE_WRITE);
-    if (f == NULL) {
-        ui_error("Cannot create snapshot file. Select different history directory!");
-        return -1;
+    if (spectator_listen_socket == NULL) {
+        return;
     }
 
-    server_addr = vice_network_address_generate(server_name, server_port);
-    if (server_addr == NULL) {
-        ui_error("Cannot resolve %s", server_name);
-        return -1;
+    for (i = 0; i < NETWORK_SPECTATORS_MAX; i++) {
+        count += spectators[i].socket != NULL;
     }
-    network_socket = vice_network_client(server_addr);
-
+    while (vice_network_select_poll_one(spectator_listen_socket) > 0) {
+        s = vice_network_accept(spectator_listen_socket);
+        if (s == NULL) {
+            break;
+        }
+        if (count >= spectators_max) {
+            vice_network_socket_close(s);
+            continue;
+        }
+        for (i = 0; spectators[i].socket != NULL; i++) {
+        }
+        spectator = &spectators[i];
+        spectator->socket = s;
+        spectator->joined = 0;
+        spectator->queue.size = 0;
+        spectator->sent = 0;
+        if (spectator_keyframe_frame >= 0) {
+            network_buffer_append(&spectator->queue, spectator_keyframe.data,
+                                  spectator_keyframe.size);
+            network_buffer_append(&spectator->queue, spectator_backlog.data,
+                                  spectator_backlog.size);
+            spectator->joined = 1;
+        }
+        count++;
+        log_message(LOG_DEFAULT, "netplay: spectator joined, %d watching.", count);
+    }
+
+    for (i = 0; i < NETWORK_SPECTATORS_MAX; i++) {
+        spectator = &spectators[i];
+        if (spectator->socket == NULL) {
+            continue;
+        }
+        n = 1;
+        while (spectator->sent < spectator->queue.size
+               && vice_network_select_poll_write_one(spectator->socket) > 0) {
+            len = spectator->queue.size - spectator->sent;
+            if (len > NETWORK_SPECTATOR_CHUNK) {
+                len = NETWORK_SPECTATOR_CHUNK;
+            }
+            n = vice_network_send(spectator->socket, spectator->queue.data + spectator->sent,
+                                  len, SEND_FLAGS);
+            if (n <= 0) {
+                break;
+            }
+            spectator->sent += (size_t)n;
+        }
+        if (spectator->sent == spectator->queue.size) {
+            spectator->queue.size = 0;
+            spectator->sent = 0;
+        } else if (n <= 0 || spectator->queue.size - spectator->sent
+                   > spectator_keyframe.size + NETWORK_SPECTATOR_QUEUE_MAX) {
+            log_message(LOG_DEFAULT, "netplay: spectator %s, dropped.",
+                        n <= 0 ? "disconnected" : "too far behind");
+            network_spectator_drop(spectator);
+        }
+    }
+}
+
+/* Play back the event lists of a frame message */
+static int network_spectator_play(uint8_t *buf, unsigned int len)
+{
+    event_list_state_t *list;
+    unsigned int p, n;
+
+    for (p = 4; p < len; p += n) {
+        if (len - p < 4) {
+            return -1;
+        }
+        n = util_le_buf_to_dword(&buf[p]);
+        p += 4;
+        if (n > len - p) {
+            return -1;
+        }
+        list = network_create_event_list(&buf[p], n);
+        event_playback_event_list(list);
+        event_clear_list(list);
+        lib_free(list);
+    }
+    return 0;
+}
+
+/* triggers on a spectator at the end of every frame with rollback */
+static void network_spectator_play_trap(uint16_t addr, void *data)
+{
+    int err;
+
+    if (network_mode != NETWORK_SPECTATOR || spectator_play_buf == NULL) {
+        return;
+    }
+    err = network_spectator_play(spectator_play_buf, spectator_play_len);
+    lib_free(spectator_play_buf);
+    spectator_play_buf = NULL;
+    if (err < 0) {
+        ui_error("Network out of sync - disconnecting.");
+        network_disconnect();
+        return;
+    }
+    network_spectators_frame_done(spectator_play_frame, 1);
+}
+
+static void network_hook_spectator(void)
+{
+    uint8_t *buf;
+    unsigned int len;
+
+    stats.frames++;
+    spectator_play_frame++;
+
+    buf = network_recv_message(network_socket, &len);
+    if (buf == NULL) {
+        ui_display_statustext("Remote host disconnected.", true);
+        network_disconnect();
+        return;
+    }
+    if (len < 4 || (int)util_le_buf_to_dword(buf) != spectator_play_frame) {
+        lib_free(buf);
+        ui_error("Network out of sync - disconnecting.");
+        network_disconnect();
+        return;
+    }
+
+    /* pass it on to the spectators of this one */
+    network_spectators_send(buf, len);
+    spectator_sent_frame = spectator_play_frame;
+
+    if (spectator_trap_playback) {
+        lib_free(spectator_play_buf);
+        spectator_play_buf = buf;
+        spectator_play_len = len;
+        interrupt_maincpu_trigger_trap(network_spectator_play_trap, (void *)0);
+        return;
+    }
+
+    if (network_spectator_play(buf, len) < 0) {
+        lib_free(buf);
+        ui_error("Network out of sync - disconnecting.");
+        network_disconnect();
+        return;
+    }
+    lib_free(buf);
+    network_spectators_frame_done(spectator_play_frame, 0);
+}
+
+/* triggers on a spectator, when it connects */
+static void network_spectator_connect_trap(uint16_t addr, void *data)
+{
+    event_list_state_t *settings_list;
+    snapshot_memory_t *mem;
+    int err;
+
+    DBG(("network_spectator_connect_trap"));
+
+    vsync_suspend_speed_eval();
+    sound_suspend();
+
+    if (resources_set_event_safe() < 0) {
+        ui_error("Warning! Failed to set netplay-safe settings.");
+    }
+
+    settings_list = network_create_event_list(spectator_join_settings,
+                                              spectator_join_settings_len);
+    event_playback_event_list(settings_list);
+    event_clear_list(settings_list);
+    lib_free(settings_list);
+
+    mem = snapshot_memory_new();
+    memcpy(snapshot_memory_fill(mem, spectator_join_snapshot_len),
+           spectator_join_snapshot, spectator_join_snapshot_len);
+    snapshot_memory_redirect(mem);
+    err = machine_read_snapshot("", 0);
+    snapshot_memory_redirect(NULL);
+    snapshot_memory_free(mem);
+
+    lib_free(spectator_join_settings);
+    spectator_join_settings = NULL;
+    lib_free(spectator_join_snapshot);
+    spectator_join_snapshot = NULL;
+
+    if (err < 0) {
+        ui_error("Cannot read the snapshot of the server.");
+        vice_network_socket_close(network_socket);
+        network_socket = NULL;
+        return;
+    }
+
+    event_init_image_list();
+    memset(&stats, 0, sizeof(stats));
+    network_mode = NETWORK_SPECTATOR;
+
+    /* relay the game if spectators are accepted here too */
+    spectator_keyframe_frame = -1;
+    spectator_keyframe_due = 0;
+    spectator_backlog.size = 0;
+    spectator_sent_frame = spectator_play_frame;
+    network_spectators_listen();
+
+    ui_display_statustext("Watching the game.", true);
+}
+
+/* Connect to the spectator port of a server, or of another spectator */
+int network_connect_spectator(void)
+{
+    vice_network_socket_address_t *server_addr;
+    uint8_t *header;
+    unsigned int len;
+
+    DBG(("network_connect_spectator (network_mode is: %u)", network_mode));
+
+    if (network_mode != NETWORK_IDLE) {
+        return -1;
+    }
+
+    vsync_suspend_speed_eval();
+
+    server_addr = vice_network_address_generate(server_name, (unsigned short)spectator_port);
+    if (server_addr == NULL) {
+        ui_error("Cannot resolve %s", server_name);
+        return -1;
+    }
+    network_socket = vice_network_client(server_addr);
+    vice_network_address_close(server_addr);
+
+    if (!network_socket) {
+        ui_error("Cannot connect to %s (no spectators accepted on port %d).", server_name, spectator_port);
+        return -1;
+    }
+
+    ui_display_statustext("Receiving keyframe from server...", false);
+    header = network_recv_message(network_socket, &len);
+    if (header != NULL && len >= 8) {
+        spectator_play_frame = (int)util_le_buf_to_dword(&header[0]);
+        spectator_trap_playback = util_le_buf_to_dword(&header[4]) ? 1 : 0;
+        spectator_join_settings = network_recv_message(network_socket, &spectator_join_settings_len);
+        if (spectator_join_settings != NULL) {
+            spectator_join_snapshot = network_recv_message(network_socket, &spectator_join_snapshot_len);
+        }
+    }
+    lib_free(header);
+
+    if (spectator_join_snapshot == NULL) {
+        ui_error("Cannot receive the keyframe from %s.", server_name);
+        lib_free(spectator_join_settings);
+        spectator_join_settings = NULL;
+        vice_network_socket_close(network_socket);
+        network_socket = NULL;
+        return -1;
+    }
+
+    interrupt_maincpu_trigger_trap(network_spectator_connect_trap, (void *)0);
+    vsync_suspend_speed_eval();
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+
+void network_event_record(unsigned int type, void *data, unsigned int size)
+{
+    unsigned int control = 0;
+    uint16_t joyport;
+
+    DBGT(("network_event_record type: %u size: %u", type, size));
+
+    /* spectators only watch */
+    if (network_mode == NETWORK_SPECTATOR) {
+        return;
+    }
+
+    switch (type) {
+        case EVENT_KEYBOARD_MATRIX:
+        case EVENT_KEYBOARD_RESTORE:
+        case EVENT_KEYBOARD_DELAY:
+        case EVENT_KEYBOARD_CLEAR:
+            control = NETWORK_CONTROL_KEYB;
+            break;
+        case EVENT_ATTACHDISK:
+        case EVENT_ATTACHTAPE:
+        case EVENT_DATASETTE:
+            control = NETWORK_CONTROL_DEVC;
+            break;
+        case EVENT_RESOURCE:
+        case EVENT_RESETCPU:
+            control = NETWORK_CONTROL_RSRC;
+            break;
+        case EVENT_JOYSTICK_VALUE:
+            joyport = ((uint16_t *)data)[0];
+            if (joyport == 1) {
+                control = NETWORK_CONTROL_JOY1;
+            }
+            if (joyport == 2) {
+                control = NETWORK_CONTROL_JOY2;
+            }
+            break;
+        default:
+            control = 0;
+    }
+
+    if (network_get_mode() == NETWORK_CLIENT) {
+        control <<= NETWORK_CONTROL_CLIENTOFFSET;
+    }
+
+    if (control != 0 && (control & network_control) == 0) {
+        return;
+    }
+
+    event_record_in_list(&(frame_event_list[current_frame]), type, data, size);
+}
+
+void network_attach_image(unsigned int unit, const char *filename)
+{
+    /* TODO: drive 1? */
+    unsigned int drive = 0;
+
+    unsigned int control = NETWORK_CONTROL_DEVC;
+
+    DBG(("network_attach_image unit: %u filename: %s", unit, filename));
+
+    if (network_get_mode() == NETWORK_CLIENT) {
+        control <<= NETWORK_CONTROL_CLIENTOFFSET;
+    }
+
+    if ((control & network_control) == 0 || network_mode == NETWORK_SPECTATOR) {
+        return;
+    }
+
+    event_record_attach_in_list(&(frame_event_list[current_frame]), unit, drive, filename, 1);
+}
+
+int network_get_mode(void)
+{
+    return network_mode;
+}
+
+int network_connected(void)
+{
+    if ((network_mode == NETWORK_SERVER_CONNECTED) ||
+        (network_mode == NETWORK_CLIENT) ||
+        (network_mode == NETWORK_SPECTATOR)) {
+        return 1;
+    }
+    return 0;
+}
+
+int network_start_server(void)
+{
+    vice_network_socket_address_t * server_addr = NULL;
+    int ret = -1;
+
+    DBG(("network_start_server (network_mode is: %u) on %s:%d",
+         network_mode, server_bind_address, server_port));
+
+    do {
+        if (network_mode != NETWORK_IDLE) {
+            break;
+        }
+
+        server_addr = vice_network_address_generate(server_bind_address, server_port);
+        if (!server_addr) {
+            DBG(("vice_network_address_generate failed, can not start server."));
+            break;
+        }
+
+        listen_socket = vice_network_server(server_addr);
+        if (!listen_socket) {
+            DBG(("vice_network_address_generate failed, can not start server."));
+            break;
+        }
+
+        /* Setup strict event safe values for the resources that need it */
+        if (resources_set_event_safe() < 0) {
+            ui_error("Warning! Failed to set netplay-safe settings.");
+        }
+
+        network_mode = NETWORK_SERVER;
+        network_spectators_listen();
+
+        vsync_suspend_speed_eval();
+        sound_suspend();
+
+        ui_display_statustext("Server is waiting for a client...", false);
+
+        ret = 0;
+    } while (0);
+
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        ui_display_statustext("Client connected...", true);
+    }
+
+    if (server_addr) {
+        vice_network_address_close(server_addr);
+    }
+
+    return ret;
+}
+
+
+int network_connect_client(void)
+{
+    vice_network_socket_address_t * server_addr;
+    FILE *f;
+    uint8_t *buf;
+    uint8_t recv_buf4[4];
+    size_t buf_size;
+
+    DBG(("network_connect_client (network_mode is: %u)", network_mode));
+
+    if (network_mode != NETWORK_IDLE) {
+        return -1;
+    }
+
+    vsync_suspend_speed_eval();
+
+    snapshotfilename = NULL;
+
+    f = archdep_mkstemp_fd(&snapshotfilename, MODE_WRITE);
+    if (f == NULL) {
+        ui_error("Cannot create snapshot file. Select different history directory!");
+        return -1;
+    }
+
+    server_addr = vice_network_address_generate(server_name, server_port);
+    if (server_addr == NULL) {
+        ui_error("Cannot resolve %s", server_name);
+        return -1;
+    }
+    network_socket = vice_network_client(server_addr);
+
     vice_network_address_close(server_addr);
     server_addr = NULL;
 
@@ -803,175 +1639,689 @@ int network_connect_client(void)
         return -1;
     }
 
-    buf_size = (size_t)util_le_buf4_to_int(recv_buf4);
-    buf = lib_malloc(buf_size);
+    buf_size = (size_t)util_le_buf4_to_int(recv_buf4);
+    buf = lib_malloc(buf_size);
+
+    if (network_recv_buffer(network_socket, buf, (int)buf_size) < 0) {
+        lib_free(snapshotfilename);
+        vice_network_socket_close(network_socket);
+        return -1;
+    }
+
+    if (fwrite(buf, 1, buf_size, f) == 0) {
+        log_debug(LOG_DEFAULT, "network_connect_client write failed.");
+    }
+    fclose(f);
+    lib_free(buf);
+
+    interrupt_maincpu_trigger_trap(network_client_connect_trap, (void *)0);
+    vsync_suspend_speed_eval();
+
+    return 0;
+}
+
+static void network_log_stats(void)
+{
+    network_stats_t s;
+
+    network_get_stats(&s);
+    log_message(LOG_DEFAULT,
+                "netplay: %u frames, %u stalls (%.1f per minute), %.2f ms average frame wait,"
+                " %.1f ms round trip, %.1f ms jitter, %d frames delay (%u changes).",
+                s.frames, s.stalls, s.stalls_per_minute, s.avg_frame_wait_ms,
+                s.rtt_ms, s.jitter_ms, s.frame_delay, s.delay_changes);
+}
+
+void network_disconnect(void)
+{
+    DBG(("network_disconnect (network_mode was:%u)", network_mode));
+    if (network_connected() && stats.frames > 0) {
+        network_log_stats();
+    }
+    vice_network_socket_close(network_socket);
+    network_socket = NULL;
+    rollback_resimulating = 0;
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        /* the spectators cannot follow the next game */
+        network_spectators_drop();
+        network_mode = NETWORK_SERVER;
+    } else {
+        if (network_mode == NETWORK_SPECTATOR) {
+            lib_free(spectator_play_buf);
+            spectator_play_buf = NULL;
+            event_destroy_image_list();
+        }
+        vice_network_socket_close(listen_socket);
+        listen_socket = NULL;
+        network_spectators_close();
+        network_mode = NETWORK_IDLE;
+    }
+    ui_display_statustext("Netplay disconnected...", true);
+}
+
+void network_suspend(void)
+{
+    int dummy_buf_len = 0;
+
+    if (!network_connected() || network_mode == NETWORK_SPECTATOR || suspended == 1) {
+        return;
+    }
+
+    network_send_buffer(network_socket, (uint8_t *)&dummy_buf_len, sizeof(unsigned int));
+
+    suspended = 1;
+}
+
+/* Take the send tick of a remote frame, and the round trip time if the
+   remote echoed one of ours.
+
+   Frames are only read at the end of a frame, so the round trip time
+   includes up to a frame either side waits before reading. */
+static void network_update_rtt(uint8_t *buf)
+{
+    tick_t echoed = util_le_buf_to_dword(&buf[4]);
+    uint32_t hold = util_le_buf_to_dword(&buf[8]);
+    tick_t rtt;
+    double err;
+
+    echo_tick = util_le_buf_to_dword(&buf[0]);
+    echo_read_tick = tick_now();
+    echo_valid = 1;
+
+    if (hold == NETWORK_NO_FRAME || (rtt_valid && echoed == last_echo_seen)) {
+        return;
+    }
+    last_echo_seen = echoed;
+
+    rtt = tick_now_delta(echoed);
+    rtt = rtt > hold ? rtt - hold : 0;
+
+    if (!rtt_valid) {
+        rtt_smoothed = rtt;
+        rtt_deviation = rtt / 2.0;
+        rtt_max[0] = rtt;
+        rtt_max[1] = rtt;
+        rtt_max_start = tick_now();
+        rtt_valid = 1;
+    } else {
+        err = rtt - rtt_smoothed;
+        rtt_smoothed += err / 8.0;
+        rtt_deviation += (fabs(err) - rtt_deviation) / 4.0;
+
+        if (tick_now_delta(rtt_max_start) >= tick_per_second() * NETWORK_DELAY_WINDOW / 2) {
+            rtt_max[1] = rtt_max[0];
+            rtt_max[0] = 0;
+            rtt_max_start = tick_now();
+        }
+        if (rtt > rtt_max[0]) {
+            rtt_max[0] = rtt;
+        }
+    }
+}
+
+/* Delay needed for the remote inputs to arrive in time.
+
+   The slowest recent round trip covers the jitter. A smoothed time plus a
+   multiple of its deviation would take a step in the latency for jitter,
+   and ask for far more delay than needed until it has settled again. */
+static int network_delay_wanted(void)
+{
+    double frames;
+    int wanted;
+
+    if (!rtt_valid) {
+        return frame_delta;
+    }
+
+    frames = (rtt_max[0] > rtt_max[1] ? rtt_max[0] : rtt_max[1]) / 2.0
+             * vsync_get_refresh_frequency() / tick_per_second();
+    if (frames >= NETWORK_MAX_DELAY) {
+        return NETWORK_MAX_DELAY;
+    }
+
+    wanted = NETWORK_DELAY_MARGIN + (int)ceil(frames);
+    return wanted > NETWORK_MAX_DELAY ? NETWORK_MAX_DELAY : wanted;
+}
+
+/* Take the delay values of a remote frame header */
+static int network_receive_delay(uint8_t *buf)
+{
+    uint32_t delay = util_le_buf_to_dword(&buf[0]);
+    uint32_t frame = util_le_buf_to_dword(&buf[4]);
 
-    if (network_recv_buffer(network_socket, buf, (int)buf_size) < 0) {
-        lib_free(snapshotfilename);
-        vice_network_socket_close(network_socket);
+    if (delay == 0 || delay > NETWORK_MAX_DELAY) {
         return -1;
     }
 
-    if (fwrite(buf, 1, buf_size, f) == 0) {
-        log_debug(LOG_DEFAULT, "network_connect_client write failed.");
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        remote_delay_wanted = (int)delay;
+        return 0;
     }
-    fclose(f);
-    lib_free(buf);
 
-    interrupt_maincpu_trigger_trap(network_client_connect_trap, (void *)0);
-    vsync_suspend_speed_eval();
+    if (frame == NETWORK_NO_FRAME || rollback_frames > 0) {
+        return 0;
+    }
 
+    /* the server keeps announcing a switch until it has made it */
+    if ((int)frame <= network_frame) {
+        return (int)frame == delay_switched_frame ? 0 : -1;
+    }
+    delay_switch_frame = (int)frame;
+    delay_switch_to = (int)delay;
     return 0;
 }
 
-void network_disconnect(void)
+/* Switch to the delay announced for this frame */
+static void network_delay_switch(void)
 {
-    DBG(("network_disconnect (network_mode was:%u)", network_mode));
-    vice_network_socket_close(network_socket);
-    if (network_mode == NETWORK_SERVER_CONNECTED) {
-        network_mode = NETWORK_SERVER;
-    } else {
-        vice_network_socket_close(listen_socket);
-        network_mode = NETWORK_IDLE;
+    char st[256];
+
+    if (delay_switch_frame != network_frame) {
+        return;
     }
-    ui_display_statustext("Netplay disconnected...", true);
+
+    frame_delta = delay_switch_to;
+    delay_switched_frame = network_frame;
+    delay_switch_frame = -1;
+    stats.frame_delay = frame_delta;
+    stats.delay_changes++;
+
+    sprintf(st, "Using %d frames delay.", frame_delta);
+    log_debug(LOG_DEFAULT, "netplay switched to %d frames delta at frame %d.",
+              frame_delta, network_frame);
+    ui_display_statustext(st, true);
 }
 
-void network_suspend(void)
+/* Let the server decide whether to announce a new delay */
+static void network_delay_update(void)
 {
-    int dummy_buf_len = 0;
+    int wanted;
 
-    if (!network_connected() || suspended == 1) {
+    if (network_mode != NETWORK_SERVER_CONNECTED || !adaptive_delay_enabled
+        || rollback_frames > 0 || delay_switch_frame >= 0) {
         return;
     }
 
-    network_send_buffer(network_socket, (uint8_t *)&dummy_buf_len, sizeof(unsigned int));
+    wanted = network_delay_wanted();
+    if (remote_delay_wanted > wanted) {
+        wanted = remote_delay_wanted;
+    }
 
-    suspended = 1;
+    if (wanted >= frame_delta) {
+        delay_settle = 0;
+        if (wanted == frame_delta) {
+            return;
+        }
+    } else if (++delay_settle < NETWORK_DELAY_SETTLE * vsync_get_refresh_frequency()) {
+        return;
+    } else {
+        /* the next frame less after another NETWORK_DELAY_STEP seconds */
+        wanted = frame_delta - 1;
+        delay_settle = (int)((NETWORK_DELAY_SETTLE - NETWORK_DELAY_STEP)
+                             * vsync_get_refresh_frequency());
+    }
+
+    /* the client reads the announcement with the frame after this one,
+       at the latest `frame_delta' - 1 frames later */
+    delay_switch_to = wanted;
+    delay_switch_frame = network_frame + frame_delta + 2;
+    DBG(("network_delay_update: %d frames delta from frame %d", wanted, delay_switch_frame));
 }
 
-#ifdef NETWORK_TRAFFIC_DEBUG
-long t1, t2, t3, t4;
-#endif
+/* Send the inputs of the current frame.
 
-static void network_hook_connected_send(void)
+   The header holds the frame, the newest frame both sides know the state
+   of for sure and its registers (only with rollback), the send tick, the
+   newest remote send tick and how long ago it was read (for the round trip
+   time), and the delay: the one the server switches to at the frame given
+   after it, or the one the client wants. */
+static int network_send_frame(void)
 {
-    uint8_t *local_event_buf = NULL;
-    unsigned int send_len;
+    uint8_t *event_buf = NULL;
+    uint8_t *buf;
+    unsigned int event_len;
     uint8_t send_len4[4];
+    uint32_t *regs;
+    int i, ret;
+
+    event_len = network_create_event_buffer(&event_buf, &(frame_event_list[current_frame]));
+
+    buf = lib_malloc(NETWORK_FRAME_HEADER + event_len);
+    util_dword_to_le_buf(&buf[0], (uint32_t)network_frame);
+    util_dword_to_le_buf(&buf[4], (uint32_t)sync_frame);
+    if (sync_frame >= 0) {
+        regs = rollback_regs[sync_frame % NETWORK_FRAME_RING];
+        for (i = 0; i < 5; i++) {
+            util_dword_to_le_buf(&buf[8 + i * 4], regs[i]);
+        }
+    } else {
+        memset(&buf[8], 0, 5 * 4);
+    }
 
-    DBGT(("network_hook_connected_send"));
+    util_dword_to_le_buf(&buf[28], tick_now());
+    if (echo_valid) {
+        util_dword_to_le_buf(&buf[32], echo_tick);
+        util_dword_to_le_buf(&buf[36], tick_now_delta(echo_read_tick));
+    } else {
+        util_dword_to_le_buf(&buf[32], NETWORK_NO_FRAME);
+        util_dword_to_le_buf(&buf[36], NETWORK_NO_FRAME);
+    }
 
-    /* create and send current event buffer */
-    network_event_record(EVENT_LIST_END, NULL, 0);
-    send_len = network_create_event_buffer(&local_event_buf, &(frame_event_list[current_frame]));
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        if (delay_switch_frame >= 0) {
+            util_dword_to_le_buf(&buf[40], (uint32_t)delay_switch_to);
+            util_dword_to_le_buf(&buf[44], (uint32_t)delay_switch_frame);
+        } else {
+            util_dword_to_le_buf(&buf[40], (uint32_t)frame_delta);
+            util_dword_to_le_buf(&buf[44], NETWORK_NO_FRAME);
+        }
+    } else {
+        util_dword_to_le_buf(&buf[40], (uint32_t)network_delay_wanted());
+        util_dword_to_le_buf(&buf[44], NETWORK_NO_FRAME);
+    }
 
-#ifdef NETWORK_TRAFFIC_DEBUG
-    t1 = tick_now();
-#endif
+    memcpy(&buf[NETWORK_FRAME_HEADER], event_buf, event_len);
+    lib_free(event_buf);
 
-    util_int_to_le_buf4(send_len4, (int)send_len);
-    if (network_send_buffer(network_socket, send_len4, 4) < 0) {
-        ui_display_statustext("Remote host disconnected.", true);
-        network_disconnect();
-    } else if (network_send_buffer(network_socket, local_event_buf, send_len) < 0) {
+    util_int_to_le_buf4(send_len4, (int)(NETWORK_FRAME_HEADER + event_len));
+    ret = network_send_buffer(network_socket, send_len4, 4);
+    if (ret >= 0) {
+        ret = network_send_buffer(network_socket, buf, NETWORK_FRAME_HEADER + event_len);
+    }
+    lib_free(buf);
+
+    if (ret < 0) {
         ui_display_statustext("Remote host disconnected.", true);
         network_disconnect();
+        return -1;
     }
-#ifdef NETWORK_TRAFFIC_DEBUG
-    t2 = tick_now_after(t1);
-#endif
-
-    lib_free(local_event_buf);
+    return 0;
 }
 
-static void network_hook_connected_receive(void)
+/* Take the remote inputs that have arrived, wait for the ones up to
+   `needed' */
+static int network_receive_frames(int needed)
 {
-    uint8_t *remote_event_buf = NULL;
+    uint8_t *buf;
     unsigned int recv_len;
     uint8_t recv_len4[4];
-    event_list_state_t *remote_event_list;
-    event_list_state_t *client_event_list, *server_event_list;
-
-    DBGT(("network_hook_connected_receive"));
-
-    suspended = 0;
-
-    if (current_frame == frame_delta - 1) {
-        frame_buffer_full = 1;
+    event_list_state_t **list;
+    int frame, oldest, i;
+    int stalled = 0;
+    tick_t wait_start = 0;
+
+    if (remote_frame < needed && vice_network_select_poll_one(network_socket) == 0) {
+        /* the remote inputs are late */
+        stalled = 1;
+        wait_start = tick_now();
     }
 
-    if (frame_buffer_full) {
-        do {
-            if (network_recv_buffer(network_socket, recv_len4, 4) < 0) {
-                ui_display_statustext("Remote host disconnected.", true);
-                network_disconnect();
-                return;
-            }
+    while (remote_frame < needed
+           || vice_network_select_poll_one(network_socket) != 0) {
+        if (network_recv_buffer(network_socket, recv_len4, 4) < 0) {
+            ui_display_statustext("Remote host disconnected.", true);
+            network_disconnect();
+            return -1;
+        }
 
-            recv_len = util_le_buf4_to_int(recv_len4);
-            if (recv_len == 0 && suspended == 0) {
+        recv_len = util_le_buf4_to_int(recv_len4);
+        if (recv_len == 0) {
+            if (suspended == 0) {
                 /* remote host suspended emulation */
                 ui_display_statustext("Remote host suspending...", false);
                 suspended = 1;
                 vsync_suspend_speed_eval();
             }
-        } while (recv_len == 0);
-
+            /* waiting for the remote user is no stall */
+            stalled = 0;
+            continue;
+        }
         if (suspended == 1) {
             ui_display_statustext("", false);
+            suspended = 0;
         }
 
-        remote_event_buf = lib_malloc(recv_len);
-
-        if (network_recv_buffer(network_socket, remote_event_buf,
-                                recv_len) < 0) {
-            lib_free(remote_event_buf);
-            return;
+        if (recv_len < NETWORK_FRAME_HEADER) {
+            goto outofsync;
         }
 
-#ifdef NETWORK_TRAFFIC_DEBUG
-        t3 = tick_now_after(t2);
-#endif
-
-        remote_event_list = network_create_event_list(remote_event_buf);
-        lib_free(remote_event_buf);
+        buf = lib_malloc(recv_len);
+        if (network_recv_buffer(network_socket, buf, recv_len) < 0) {
+            lib_free(buf);
+            ui_display_statustext("Remote host disconnected.", true);
+            network_disconnect();
+            return -1;
+        }
 
-        if (network_mode == NETWORK_SERVER_CONNECTED) {
-            client_event_list = remote_event_list;
-            server_event_list = &(frame_event_list[frame_to_play]);
+        /* the oldest remote inputs that may still be needed */
+        if (rollback_frames > 0) {
+            oldest = network_frame - frame_delta + 1;
         } else {
-            server_event_list = remote_event_list;
-            client_event_list = &(frame_event_list[frame_to_play]);
+            oldest = played_frame + 1;
         }
 
-        /* test for sync */
-        if (client_event_list->base->type == EVENT_SYNC_TEST
-            && server_event_list->base->type == EVENT_SYNC_TEST) {
-            int i;
+        frame = (int)util_le_buf_to_dword(&buf[0]);
+        if (frame != remote_frame + 1
+            || frame - oldest >= NETWORK_FRAME_RING - NETWORK_ROLLBACK_MAX
+            || network_receive_delay(&buf[40]) < 0) {
+            lib_free(buf);
+            goto outofsync;
+        }
 
+        if (rollback_frames > 0 && remote_sync_frame < 0) {
+            remote_sync_frame = (int)util_le_buf_to_dword(&buf[4]);
             for (i = 0; i < 5; i++) {
-                if (((uint32_t *)client_event_list->base->data)[i]
-                    != ((uint32_t *)server_event_list->base->data)[i]) {
-                    ui_error("Network out of sync - disconnecting.");
-                    network_disconnect();
-                    /* shouldn't happen but resyncing would be nicer */
-                    break;
-                }
+                remote_sync_regs[i] = util_le_buf_to_dword(&buf[8 + i * 4]);
+            }
+        }
+        network_update_rtt(&buf[28]);
+
+        list = &(remote_frame_list[frame % NETWORK_FRAME_RING]);
+        if (*list != NULL) {
+            event_clear_list(*list);
+            lib_free(*list);
+        }
+        *list = network_create_event_list(&buf[NETWORK_FRAME_HEADER],
+                                          recv_len - NETWORK_FRAME_HEADER);
+        lib_free(buf);
+        remote_frame = frame;
+
+        /* a frame played back with a wrong prediction is emulated again */
+        if (rollback_frames > 0
+            && (*list)->base->type != EVENT_LIST_END
+            && frame + frame_delta - 1 < network_frame
+            && (rollback_to < 0 || frame + frame_delta - 1 < rollback_to)) {
+            rollback_to = frame + frame_delta - 1;
+        }
+    }
+
+    if (stalled) {
+        stats.stalls++;
+        wait_ticks += tick_now_delta(wait_start);
+    }
+
+    return 0;
+
+outofsync:
+    ui_error("Network out of sync - disconnecting.");
+    network_disconnect();
+    return -1;
+}
+
+/* Play back the inputs of `frame' in lockstep */
+static void network_lockstep_play(int frame)
+{
+    event_list_state_t **remote_list = &(remote_frame_list[frame % NETWORK_FRAME_RING]);
+    event_list_state_t *local_list = &(frame_event_list[frame % NETWORK_FRAME_RING]);
+    event_list_state_t *client_event_list, *server_event_list;
+
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        client_event_list = *remote_list;
+        server_event_list = local_list;
+    } else {
+        server_event_list = *remote_list;
+        client_event_list = local_list;
+    }
+
+    /* test for sync */
+    if (client_event_list->base->type == EVENT_SYNC_TEST
+        && server_event_list->base->type == EVENT_SYNC_TEST) {
+        int i;
+
+        for (i = 0; i < 5; i++) {
+            if (((uint32_t *)client_event_list->base->data)[i]
+                != ((uint32_t *)server_event_list->base->data)[i]) {
+                ui_error("Network out of sync - disconnecting.");
+                network_disconnect();
+                /* shouldn't happen but resyncing would be nicer */
+                break;
             }
         }
+    }
+
+    /* replay the event_lists; server first, then client */
+    event_playback_event_list(server_event_list);
+    event_playback_event_list(client_event_list);
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        network_spectators_frame_add(server_event_list);
+        network_spectators_frame_add(client_event_list);
+    }
+
+    event_clear_list(*remote_list);
+    lib_free(*remote_list);
+    *remote_list = NULL;
+}
+
+static void network_hook_lockstep(void)
+{
+    int input;
+
+    DBGT(("network_hook_lockstep"));
+
+    suspended = 0;
+    stats.frames++;
+    network_delay_switch();
+
+    /* send the inputs of this frame */
+    network_event_record(EVENT_LIST_END, NULL, 0);
+    if (network_send_frame() < 0) {
+        return;
+    }
+
+    /* play back the inputs of `frame_delta' - 1 frames ago; none when the
+       delay just got higher, more than one when it just got lower */
+    input = network_frame - frame_delta + 1;
+    if (network_receive_frames(input) < 0) {
+        return;
+    }
+    network_spectators_frame_begin(network_frame);
+    while (played_frame < input) {
+        played_frame++;
+        network_lockstep_play(played_frame);
+    }
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        network_spectators_frame_end(network_frame);
+        network_spectators_frame_done(network_frame, 0);
+    }
+
+    network_delay_update();
+    network_prepare_next_frame();
+}
+
+/* Save the machine state before the inputs of `frame' are played back */
+static int network_rollback_save(int frame)
+{
+    int slot = frame % NETWORK_ROLLBACK_STATES;
+    int err;
+
+    if (rollback_state[slot] == NULL) {
+        rollback_state[slot] = snapshot_memory_new();
+    }
+
+    snapshot_memory_redirect(rollback_state[slot]);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_redirect(NULL);
+
+    rollback_state_frame[slot] = err < 0 ? -1 : frame;
+    return err;
+}
+
+/* Go back to the state saved by network_rollback_save() for `frame' */
+static int network_rollback_restore(int frame)
+{
+    int slot = frame % NETWORK_ROLLBACK_STATES;
+    int err;
+
+    if (rollback_state_frame[slot] != frame) {
+        return -1;
+    }
+
+    /* keep the sound of the frames emulated so far */
+    sound_flush();
+
+    snapshot_memory_redirect(rollback_state[slot]);
+    err = machine_read_snapshot("", 0);
+    snapshot_memory_redirect(NULL);
+
+    return err;
+}
+
+/* Play back the inputs that belong to the end of `frame' */
+static int network_rollback_play(int frame)
+{
+    int input = frame - frame_delta + 1;
+    uint32_t *regs = rollback_regs[frame % NETWORK_FRAME_RING];
+    event_list_state_t *local_list, *remote_list = NULL;
+
+    regs[0] = (uint32_t)maincpu_get_pc();
+    regs[1] = (uint32_t)maincpu_get_a();
+    regs[2] = (uint32_t)maincpu_get_x();
+    regs[3] = (uint32_t)maincpu_get_y();
+    regs[4] = (uint32_t)maincpu_get_sp();
+
+    if (input < 0) {
+        return 0;
+    }
+
+    local_list = &(frame_event_list[input % NETWORK_FRAME_RING]);
+    if (input <= remote_frame) {
+        remote_list = remote_frame_list[input % NETWORK_FRAME_RING];
+    } else if (network_rollback_save(frame) < 0) {
+        /* the remote inputs are predicted to be unchanged from here on */
+        return -1;
+    }
+
+    /* replay the event_lists; server first, then client */
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        event_playback_event_list(local_list);
+    }
+    if (remote_list != NULL) {
+        event_playback_event_list(remote_list);
+    }
+    if (network_mode == NETWORK_CLIENT) {
+        event_playback_event_list(local_list);
+    }
+    return 0;
+}
+
+/* Compare the registers of the newest frame both sides know for sure */
+static void network_rollback_sync(int frame)
+{
+    /* the state at the end of a frame depends on the inputs played back
+       up to the end of the frame before */
+    sync_frame = remote_frame + frame_delta;
+    if (sync_frame > frame) {
+        sync_frame = frame;
+    }
+
+    if (remote_sync_frame >= 0 && remote_sync_frame <= sync_frame) {
+        if (frame - remote_sync_frame < NETWORK_FRAME_RING
+            && memcmp(rollback_regs[remote_sync_frame % NETWORK_FRAME_RING],
+                      remote_sync_regs, sizeof(remote_sync_regs)) != 0) {
+            ui_error("Network out of sync - disconnecting.");
+            network_disconnect();
+        }
+        remote_sync_frame = -1;
+    }
+}
+
+/* Send the frames played back with the real remote inputs up to `frame'
+   to the spectators, and take a keyframe when due and `frame' is one of
+   them */
+static void network_rollback_spectators(int frame)
+{
+    int final = remote_frame + frame_delta - 1;
+    int f, input;
+
+    if (spectator_listen_socket == NULL || network_mode != NETWORK_SERVER_CONNECTED) {
+        return;
+    }
+    if (final > frame) {
+        final = frame;
+    }
+
+    for (f = spectator_sent_frame + 1; f <= final; f++) {
+        network_spectators_frame_begin(f);
+        input = f - frame_delta + 1;
+        if (input >= 0) {
+            network_spectators_frame_add(&(frame_event_list[input % NETWORK_FRAME_RING]));
+            network_spectators_frame_add(remote_frame_list[input % NETWORK_FRAME_RING]);
+        }
+        network_spectators_frame_end(f);
+    }
+
+    if (spectator_sent_frame == frame) {
+        network_spectators_frame_done(frame, 1);
+    }
+}
+
+/* triggers at the end of every frame while rollback is used */
+static void network_rollback_trap(uint16_t addr, void *data)
+{
+    int frame = rollback_step_frame;
+
+    if (!network_connected()) {
+        rollback_resimulating = 0;
+        return;
+    }
+
+    if (!rollback_resimulating && rollback_to >= 0) {
+        DBG(("network_rollback_trap: rolling back from %d to %d", frame, rollback_to));
+        if (network_rollback_restore(rollback_to) < 0) {
+            ui_error("Network out of sync - disconnecting.");
+            network_disconnect();
+            return;
+        }
+        rollback_resim_end = frame;
+        rollback_resimulating = 1;
+        frame = rollback_to;
+        rollback_step_frame = frame;
+        rollback_to = -1;
+    }
+
+    if (network_rollback_play(frame) < 0) {
+        ui_error("Cannot save the machine state - disconnecting.");
+        network_disconnect();
+        return;
+    }
+
+    if (rollback_resimulating && frame == rollback_resim_end) {
+        rollback_resimulating = 0;
+    }
+    if (!rollback_resimulating) {
+        network_rollback_sync(frame);
+        network_rollback_spectators(frame);
+    }
+}
+
+static void network_hook_rollback(void)
+{
+    if (rollback_resimulating) {
+        /* end of a frame emulated again */
+        rollback_step_frame++;
+        interrupt_maincpu_trigger_trap(network_rollback_trap, (void *)0);
+        return;
+    }
+
+    suspended = 0;
+    stats.frames++;
 
-        /* replay the event_lists; server first, then client */
-        event_playback_event_list(server_event_list);
-        event_playback_event_list(client_event_list);
+    /* send the inputs of this frame */
+    network_event_record(EVENT_LIST_END, NULL, 0);
+    if (network_send_frame() < 0) {
+        return;
+    }
 
-        event_clear_list(remote_event_list);
-        lib_free(remote_event_list);
+    /* get the remote inputs, do not predict more than allowed */
+    if (network_receive_frames(network_frame - frame_delta + 1 - rollback_frames) < 0) {
+        return;
     }
+
+    rollback_step_frame = network_frame;
+    interrupt_maincpu_trigger_trap(network_rollback_trap, (void *)0);
+
+    /* record the inputs of the next frame */
     network_prepare_next_frame();
-#ifdef NETWORK_TRAFFIC_DEBUG
-    t4 = tick_now_after(t3);
-#endif
 }
 
 void network_hook(void)
@@ -991,27 +2341,77 @@ void network_hook(void)
         }
     }
 
-    if (network_connected()) {
-        network_hook_connected_send();
-        network_hook_connected_receive();
-        DBGT(("network_hook timing: %5ld %5ld %5ld; total: %5ld",
-                  t2 - t1, t3 - t2, t4 - t3, t4 - t1));
+    if (network_mode == NETWORK_SPECTATOR) {
+        network_hook_spectator();
+    } else if (network_connected()) {
+        if (rollback_frames > 0) {
+            network_hook_rollback();
+        } else {
+            network_hook_lockstep();
+        }
+        DBGT(("network_hook: rtt %.0f jitter %.0f ticks, %d frames delta",
+              rtt_smoothed, rtt_deviation, frame_delta));
+    }
+
+    network_spectators_update();
+}
+
+/** \brief  Whether frames are emulated again after a wrong prediction
+ *
+ * These frames are neither shown nor heard nor synchronised, only the
+ * machine's vsync hook is run at their end.
+ */
+int network_resimulating(void)
+{
+    return rollback_resimulating;
+}
+
+/** \brief  Get the statistics of the current or last netplay connection
+ *
+ * \param[out] s   statistics
+ *
+ * \return 0 on success, -1 if there was no connection
+ */
+int network_get_stats(network_stats_t *s)
+{
+    double seconds;
+
+    *s = stats;
+    if (stats.frames == 0) {
+        return -1;
+    }
+
+    seconds = stats.frames / vsync_get_refresh_frequency();
+    s->stalls_per_minute = seconds > 0.0 ? stats.stalls * 60.0 / seconds : 0.0;
+    s->avg_frame_wait_ms = (double)wait_ticks * 1000.0 / tick_per_second() / stats.frames;
+    if (rtt_valid) {
+        s->rtt_ms = rtt_smoothed * 1000.0 / tick_per_second();
+        s->jitter_ms = rtt_deviation * 1000.0 / tick_per_second();
     }
+    return 0;
 }
 
 void network_shutdown(void)
 {
+    int i;
+
     if (network_connected()) {
         network_disconnect();
     }
 
     network_free_frame_event_list();
+    for (i = 0; i < NETWORK_ROLLBACK_STATES; i++) {
+        snapshot_memory_free(rollback_state[i]);
+        rollback_state[i] = NULL;
+    }
     lib_free(server_name);
     lib_free(server_bind_address);
 }
 
 #else
 
+#include <string.h>
+
 #include "network.h"
 
 int network_resources_init(void)
@@ -1044,6 +2444,12 @@ int network_connect_client(void)
     return 0;
 }
 
+int network_connect_spectator(void)
+{
+    DBG(("network_connect_spectator (disabled)"));
+    return 0;
+}
+
 void network_disconnect(void)
 {
     DBG(("network_disconnect (disabled)"));
@@ -1065,4 +2471,15 @@ int network_get_mode(void)
 {
     return NETWORK_IDLE;
 }
+
+int network_resimulating(void)
+{
+    return 0;
+}
+
+int network_get_stats(network_stats_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    return -1;
+}
 #endif
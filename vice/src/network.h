@@ -31,7 +31,8 @@ typedef enum {
     NETWORK_IDLE,
     NETWORK_SERVER,
     NETWORK_SERVER_CONNECTED,
-    NETWORK_CLIENT
+    NETWORK_CLIENT,
+    NETWORK_SPECTATOR
 } network_mode_t;
 
 #define NETWORK_CONTROL_KEYB (1 << 0)
@@ -41,6 +42,19 @@ typedef enum {
 #define NETWORK_CONTROL_RSRC (1 << 4)
 #define NETWORK_CONTROL_CLIENTOFFSET 8
 
+/** \brief  Statistics of a netplay connection
+ */
+typedef struct network_stats_s {
+    unsigned int frames;        /**< frames emulated while connected */
+    unsigned int stalls;        /**< frames that waited for the remote inputs */
+    double stalls_per_minute;   /**< stalls per minute of emulated time */
+    double avg_frame_wait_ms;   /**< average time waited per frame */
+    double rtt_ms;              /**< smoothed round trip time */
+    double jitter_ms;           /**< mean deviation of the round trip time */
+    int frame_delay;            /**< input delay in frames */
+    unsigned int delay_changes; /**< number of times the delay was adjusted */
+} network_stats_t;
+
 #define NETWORK_CONTROL_DEFAULT \
     ( NETWORK_CONTROL_KEYB      \
       | NETWORK_CONTROL_JOY2    \
@@ -54,12 +68,15 @@ int network_resources_init(void);
 int network_cmdline_options_init(void);
 int network_start_server(void);
 int network_connect_client(void);
+int network_connect_spectator(void);
 void network_disconnect(void);
 void network_suspend(void);
 void network_hook(void);
 int network_connected(void);
 int network_get_mode(void);
 void network_hook(void);
+int network_resimulating(void);
+int network_get_stats(network_stats_t *s);
 void network_event_record(unsigned int type, void *data, unsigned int size);
 void network_attach_image(unsigned int unit, const char *filename);
 
@@ -0,0 +1,194 @@
+/*
+ * perfcounters.c - Hot path event counters for profiling the emulator.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The counters only exist when configured with --enable-perfcounters.  The
+   hot paths then bump plain global arrays (or a field of the alarm) without
+   any check, the rest of the emulator sees the PERF_COUNT_* macros expand to
+   nothing.  The counters are read through the monitor ("perfcounters") and
+   the binary monitor.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "perfcounters.h"
+#include "types.h"
+
+static const char * const group_names[PERF_GROUP_NUM] = {
+    "opcode-main",
+    "opcode-drive",
+    "mem-read",
+    "mem-write",
+    "alarm",
+    "vicii",
+    "sound-store"
+};
+
+#ifdef FEATURE_PERF_COUNTERS
+
+/* Maximum number of alarm contexts: the main CPU, the drive CPUs and the
+   second CPUs of some drives.  */
+#define PERF_MAX_ALARM_CONTEXTS 16
+
+uint64_t perf_opcode_count[2][0x100];
+uint64_t perf_mem_read_count[PERF_MEM_CONFIGS][0x100];
+uint64_t perf_mem_write_count[PERF_MEM_CONFIGS][0x100];
+uint64_t perf_vicii_count[PERF_VICII_NUM];
+uint64_t perf_sound_store_count[PERF_SOUND_CHIPS];
+int perf_mem_config = 0;
+
+static alarm_context_t *alarm_contexts[PERF_MAX_ALARM_CONTEXTS];
+
+static const char * const vicii_names[PERF_VICII_NUM] = {
+    "cycle",
+    "ba-low",
+    "ba-fall",
+    "matrix-fetch",
+    "idle-enter",
+    "idle-leave"
+};
+
+void perf_counters_register_alarm_context(alarm_context_t *context)
+{
+    int i;
+
+    for (i = 0; i < PERF_MAX_ALARM_CONTEXTS; i++) {
+        if (alarm_contexts[i] == NULL) {
+            alarm_contexts[i] = context;
+            return;
+        }
+    }
+}
+
+void perf_counters_unregister_alarm_context(alarm_context_t *context)
+{
+    int i;
+
+    for (i = 0; i < PERF_MAX_ALARM_CONTEXTS; i++) {
+        if (alarm_contexts[i] == context) {
+            alarm_contexts[i] = NULL;
+        }
+    }
+}
+
+int perf_counters_available(void)
+{
+    return 1;
+}
+
+void perf_counters_reset(void)
+{
+    alarm_t *alarm;
+    int i;
+
+    memset(perf_opcode_count, 0, sizeof(perf_opcode_count));
+    memset(perf_mem_read_count, 0, sizeof(perf_mem_read_count));
+    memset(perf_mem_write_count, 0, sizeof(perf_mem_write_count));
+    memset(perf_vicii_count, 0, sizeof(perf_vicii_count));
+    memset(perf_sound_store_count, 0, sizeof(perf_sound_store_count));
+
+    for (i = 0; i < PERF_MAX_ALARM_CONTEXTS; i++) {
+        if (alarm_contexts[i] != NULL) {
+            for (alarm = alarm_contexts[i]->alarms; alarm != NULL; alarm = alarm->next) {
+                alarm->dispatch_count = 0;
+            }
+        }
+    }
+}
+
+static void foreach_table(int group, const uint64_t *table, unsigned int size,
+                          perf_counters_callback_t callback, void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        if (table[i] != 0) {
+            callback(group, i, NULL, table[i], data);
+        }
+    }
+}
+
+void perf_counters_foreach(perf_counters_callback_t callback, void *data)
+{
+    alarm_t *alarm;
+    char name[256];
+    unsigned int index = 0;
+    unsigned int i;
+
+    foreach_table(PERF_GROUP_OPCODE_MAIN, perf_opcode_count[0], 0x100, callback, data);
+    foreach_table(PERF_GROUP_OPCODE_DRIVE, perf_opcode_count[1], 0x100, callback, data);
+    foreach_table(PERF_GROUP_MEM_READ, &perf_mem_read_count[0][0],
+                  PERF_MEM_CONFIGS * 0x100, callback, data);
+    foreach_table(PERF_GROUP_MEM_WRITE, &perf_mem_write_count[0][0],
+                  PERF_MEM_CONFIGS * 0x100, callback, data);
+
+    for (i = 0; i < PERF_MAX_ALARM_CONTEXTS; i++) {
+        if (alarm_contexts[i] == NULL) {
+            continue;
+        }
+        for (alarm = alarm_contexts[i]->alarms; alarm != NULL; alarm = alarm->next) {
+            if (alarm->dispatch_count != 0) {
+                snprintf(name, sizeof(name), "%s/%s",
+                         alarm_contexts[i]->name, alarm->name);
+                callback(PERF_GROUP_ALARM, index, name, alarm->dispatch_count, data);
+            }
+            index++;
+        }
+    }
+
+    for (i = 0; i < PERF_VICII_NUM; i++) {
+        if (perf_vicii_count[i] != 0) {
+            callback(PERF_GROUP_VICII, i, vicii_names[i], perf_vicii_count[i], data);
+        }
+    }
+
+    foreach_table(PERF_GROUP_SOUND_STORE, perf_sound_store_count, PERF_SOUND_CHIPS,
+                  callback, data);
+}
+
+#else
+
+int perf_counters_available(void)
+{
+    return 0;
+}
+
+void perf_counters_reset(void)
+{
+}
+
+void perf_counters_foreach(perf_counters_callback_t callback, void *data)
+{
+}
+
+#endif
+
+const char *perf_counters_group_name(int group)
+{
+    if (group < 0 || group >= PERF_GROUP_NUM) {
+        return "?";
+    }
+    return group_names[group];
+}
@@ -0,0 +1,100 @@
+/*
+ * perfcounters.h - Hot path event counters for profiling the emulator.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_PERFCOUNTERS_H
+#define VICE_PERFCOUNTERS_H
+
+#include "vice.h"
+
+#include <stdint.h>
+
+/* Counter groups, also used as group IDs by the binary monitor.  */
+enum {
+    PERF_GROUP_OPCODE_MAIN = 0,     /* index: opcode */
+    PERF_GROUP_OPCODE_DRIVE,        /* index: opcode */
+    PERF_GROUP_MEM_READ,            /* index: (config << 8) | page */
+    PERF_GROUP_MEM_WRITE,           /* index: (config << 8) | page */
+    PERF_GROUP_ALARM,               /* index: position in the alarm list */
+    PERF_GROUP_VICII,               /* index: PERF_VICII_* */
+    PERF_GROUP_SOUND_STORE,         /* index: sound chip number */
+    PERF_GROUP_NUM
+};
+
+/* VIC-II cycle events.  */
+enum {
+    PERF_VICII_CYCLE = 0,           /* cycles emulated */
+    PERF_VICII_BA_LOW,              /* cycles with BA low */
+    PERF_VICII_BA_FALL,             /* BA going low */
+    PERF_VICII_MATRIX_FETCH,        /* bad line matrix fetches */
+    PERF_VICII_IDLE_ENTER,          /* display state to idle state */
+    PERF_VICII_IDLE_LEAVE,          /* idle state to display state */
+    PERF_VICII_NUM
+};
+
+#define PERF_MEM_CONFIGS    32
+#define PERF_SOUND_CHIPS    8
+
+/* Called for every non-zero counter.  `name' is the name of the counter
+   where there is one (alarms, VIC-II events), NULL otherwise.  */
+typedef void (*perf_counters_callback_t)(int group, unsigned int index,
+                                         const char *name, uint64_t count,
+                                         void *data);
+
+#ifdef FEATURE_PERF_COUNTERS
+
+struct alarm_context_s;
+
+extern uint64_t perf_opcode_count[2][0x100];
+extern uint64_t perf_mem_read_count[PERF_MEM_CONFIGS][0x100];
+extern uint64_t perf_mem_write_count[PERF_MEM_CONFIGS][0x100];
+extern uint64_t perf_vicii_count[PERF_VICII_NUM];
+extern uint64_t perf_sound_store_count[PERF_SOUND_CHIPS];
+extern int perf_mem_config;
+
+#define PERF_COUNT_OPCODE(drive, op)    (perf_opcode_count[(drive) ? 1 : 0][(op) & 0xff]++)
+#define PERF_COUNT_MEM_READ(addr)       (perf_mem_read_count[perf_mem_config][((addr) >> 8) & 0xff]++)
+#define PERF_COUNT_MEM_WRITE(addr)      (perf_mem_write_count[perf_mem_config][((addr) >> 8) & 0xff]++)
+#define PERF_COUNT_VICII(event)         (perf_vicii_count[(event)]++)
+#define PERF_COUNT_SOUND_STORE(chipno)  (perf_sound_store_count[(chipno) & (PERF_SOUND_CHIPS - 1)]++)
+#define PERF_SET_MEM_CONFIG(config)     (perf_mem_config = (config) & (PERF_MEM_CONFIGS - 1))
+
+void perf_counters_register_alarm_context(struct alarm_context_s *context);
+void perf_counters_unregister_alarm_context(struct alarm_context_s *context);
+
+#else
+
+#define PERF_COUNT_OPCODE(drive, op)
+#define PERF_COUNT_MEM_READ(addr)
+#define PERF_COUNT_MEM_WRITE(addr)
+#define PERF_COUNT_VICII(event)
+#define PERF_COUNT_SOUND_STORE(chipno)
+#define PERF_SET_MEM_CONFIG(config)
+
+#endif
+
+int perf_counters_available(void);
+void perf_counters_reset(void);
+void perf_counters_foreach(perf_counters_callback_t callback, void *data);
+const char *perf_counters_group_name(int group);
+
+#endif
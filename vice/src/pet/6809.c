@@ -1800,7 +1800,7 @@ void div0_trap(void)
 }
 #endif
 
-static void cwai(struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
+static void cwai(struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarmcontext)
 {
     uint8_t tmp = imm_byte();
     int taken;
@@ -1829,11 +1829,11 @@ static void cwai(struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context
         if (pending) {
             break;
         } else {
-            CLOCK newclock = alarm_context_next_pending_clk(maincpu_alarm_context) - TIME;
+            CLOCK newclock = alarm_context_next_pending_clk(maincpu_alarmcontext) - TIME;
             if (newclock > CLK) {
                 CLK = newclock;
             }
-            alarm_context_dispatch(maincpu_alarm_context, CLK);
+            alarm_context_dispatch(maincpu_alarmcontext, CLK);
             taken = irqs_pending /*| firqs_pending*/;
         }
     }
@@ -2739,7 +2739,7 @@ static void st32(uint32_t arg, int CLK6809, int CLK6309)
 #endif
 
 /* Execute 6809 code for a certain number of cycles. */
-void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
+void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarmcontext)
 {
     uint16_t opcode;
     uint8_t fetch;
@@ -3996,7 +3996,7 @@ void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_con
             case 0x103c:        /* CWAI (UNDOC) */
             case 0x113c:        /* CWAI (UNDOC) */
 #endif
-                cwai(maincpu_intstatus, maincpu_alarm_context);
+                cwai(maincpu_intstatus, maincpu_alarmcontext);
                 break;
 
             case 0x0019:        /* DAA */
@@ -66,6 +66,7 @@
 static uint8_t mem_read_patchbuf(uint16_t addr);
 static void mem_initialize_memory_6809_flat(void);
 static void mem_initialize_memory_6809_banked(void);
+static void mem6809_update_pages(void);
 
 uint8_t petmem_2001_buf_ef[256];
 
@@ -140,6 +141,16 @@ static int mem6809_read_limit_tab[0x101];
 read_func_ptr_t *_mem6809_read_tab_ptr;
 store_func_ptr_t *_mem6809_write_tab_ptr;
 
+/* Pages of RAM and ROM the 6809 can access directly, NULL where the read or
+   store function does more than that.  mem6809_read() and friends use them
+   to skip the function call for most accesses.  With watchpoints enabled
+   the empty table is used, so every access reaches the watch functions.  */
+static uint8_t *mem6809_read_page[0x100];
+static uint8_t *mem6809_write_page[0x100];
+static uint8_t *mem6809_no_page[0x100];
+static uint8_t **mem6809_read_page_ptr = mem6809_read_page;
+static uint8_t **mem6809_write_page_ptr = mem6809_write_page;
+
 static log_t pet_mem_log = LOG_DEFAULT;
 
 static uint8_t last_access = 0;
@@ -632,6 +643,7 @@ void set_spet_bank(int banknr)
 {
     spet_bank = banknr;
     spet_bank_ptr = &mem_ram[EXT_RAM + (banknr << 12)];
+    mem6809_update_pages();
 }
 
 void petmem_reset(void)
@@ -658,6 +670,7 @@ static void superpet_mem_powerup(void)
 /* Those two are not reset by a soft reset (/RES), only by power down */
     spet_diag = 0;
     spet_ramwp = 0;     /* should look at hardware switch */
+    mem6809_update_pages();
 }
 
 int petmem_superpet_diag(void)
@@ -695,6 +708,7 @@ static void store_super_io(uint16_t addr, uint8_t value)
 
     if (addr >= 0xeffe) {       /* RAM/ROM switch */
         spet_ramen = !(value & 1);
+        mem6809_update_pages();
         /* printf("spet_ramen := %d\n", spet_ramen); */
     } else
     if (addr >= 0xeffc) {       /* Bank select */
@@ -734,6 +748,7 @@ static void store_super_io(uint16_t addr, uint8_t value)
                     machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
                 }
                 spet_ramwp = !(value & 0x2);    /* IF hardware w/p switch is PROG */
+                mem6809_update_pages();
                 /* printf("spet_ramwp := %d\n", spet_ramwp); */
                 spet_diag = (value & 0x8);
             }
@@ -782,6 +797,40 @@ static void store_super_flat(uint16_t addr, uint8_t value)
     (mem_ram + EXT_RAM)[addr] = value;
 }
 
+/* Find the pages of the 6809 memory map that can be accessed directly.
+   Called whenever the map or the state of the SuperPET bank changes.  */
+static void mem6809_update_pages(void)
+{
+    int i;
+
+    for (i = 0; i < 0x100; i++) {
+        read_func_ptr_t read = _mem6809_read_tab[i];
+        store_func_ptr_t store = _mem6809_write_tab[i];
+        uint8_t *page = NULL;
+
+        if (read == ram_read || read == zero_read) {
+            page = mem_ram + (i << 8);
+        } else if (read == rom6809_read) {
+            page = mem_6809rom + ((i << 8) - ROM6809_BASE);
+        } else if (read == read_super_flat) {
+            page = mem_ram + EXT_RAM + (i << 8);
+        } else if (read == read_super_9 && spet_ramen) {
+            page = spet_bank_ptr + ((i & 0x0f) << 8);
+        }
+        mem6809_read_page[i] = page;
+
+        page = NULL;
+        if (store == ram_store || store == zero_store) {
+            page = mem_ram + (i << 8);
+        } else if (store == store_super_flat) {
+            page = mem_ram + EXT_RAM + (i << 8);
+        } else if (store == store_super_9 && spet_ramen && !spet_ramwp) {
+            page = spet_bank_ptr + ((i & 0x0f) << 8);
+        }
+        mem6809_write_page[i] = page;
+    }
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -804,31 +853,53 @@ uint8_t mem_read(uint16_t addr)
 
 void mem6809_store(uint16_t addr, uint8_t value)
 {
+    uint8_t *page = mem6809_write_page_ptr[addr >> 8];
+
 #if PRINT_6809_STORE
     if (addr >= 0x8000 && addr < 0x9000) {
         printf("mem6809_store   %04x <- %02x\n", addr, value);
     }
 #endif
+    if (page != NULL) {
+        page[addr & 0xff] = value;
+        last_access = value;
+        return;
+    }
     _mem6809_write_tab_ptr[addr >> 8](addr, value);
 }
 
 uint8_t mem6809_read(uint16_t addr)
 {
+    uint8_t *page = mem6809_read_page_ptr[addr >> 8];
+
 #if PRINT_6809_READ
     uint8_t v;
-    v = _mem6809_read_tab_ptr[addr >> 8](addr);
+    v = page != NULL ? (last_access = page[addr & 0xff]) : _mem6809_read_tab_ptr[addr >> 8](addr);
     printf("mem6809_read   %04x -> %02x\n", addr, v);
     return v;
 #else
+    if (page != NULL) {
+        last_access = page[addr & 0xff];
+        return last_access;
+    }
     return _mem6809_read_tab_ptr[addr >> 8](addr);
 #endif
 }
 
 void mem6809_store16(uint16_t addr, uint16_t value)
 {
+    uint8_t *page = mem6809_write_page_ptr[addr >> 8];
+
 #if PRINT_6809_STORE0
     printf("mem6809_store16 %04x <- %04x\n", addr, value);
 #endif
+    if (page != NULL && (addr & 0xff) != 0xff) {
+        /* both bytes in the same page, same order as below */
+        page[(addr & 0xff) + 1] = (uint8_t)(value & 0xFF);
+        page[addr & 0xff] = (uint8_t)(value >> 8);
+        last_access = (uint8_t)(value >> 8);
+        return;
+    }
     addr++;
     _mem6809_write_tab_ptr[addr >> 8](addr, (uint8_t)(value & 0xFF));
     addr--;
@@ -837,7 +908,15 @@ void mem6809_store16(uint16_t addr, uint16_t value)
 
 uint16_t mem6809_read16(uint16_t addr)
 {
+    uint8_t *page = mem6809_read_page_ptr[addr >> 8];
     uint16_t val;
+
+    if (page != NULL && (addr & 0xff) != 0xff) {
+        /* both bytes in the same page */
+        val = (uint16_t)((page[addr & 0xff] << 8) | page[(addr & 0xff) + 1]);
+        last_access = (uint8_t)val;
+        return val;
+    }
     val = _mem6809_read_tab_ptr[addr >> 8](addr) << 8;
     addr++;
     val |= _mem6809_read_tab_ptr[addr >> 8](addr);
@@ -1293,9 +1372,13 @@ void mem_toggle_watchpoints(int flag, void *context)
     if (flag) {
         _mem6809_read_tab_ptr = _mem6809_read_tab_watch;
         _mem6809_write_tab_ptr = _mem6809_write_tab_watch;
+        mem6809_read_page_ptr = mem6809_no_page;
+        mem6809_write_page_ptr = mem6809_no_page;
     } else {
         _mem6809_read_tab_ptr = _mem6809_read_tab;
         _mem6809_write_tab_ptr = _mem6809_write_tab;
+        mem6809_read_page_ptr = mem6809_read_page;
+        mem6809_write_page_ptr = mem6809_write_page;
     }
 
     mem_update_tab_ptrs(flag);
@@ -1607,6 +1690,8 @@ static void mem_initialize_memory_6809_banked(void)
     _mem6809_read_base_tab[0x100] = _mem6809_read_base_tab[0];
     mem6809_read_limit_tab[0x100] = -1;
 
+    mem6809_update_pages();
+
     /* maincpu_resync_limits(); notyet: 6809 doesn't use bank_base yet. */
 }
 
@@ -1625,6 +1710,9 @@ static void mem_initialize_memory_6809_flat(void)
 
     _mem6809_read_base_tab[0x100] = _mem6809_read_base_tab[0];
     mem6809_read_limit_tab[0x100] = -1;
+
+    mem6809_update_pages();
+
     /* maincpu_resync_limits(); notyet: 6809 doesn't use bank_base yet. */
 }
 
@@ -287,7 +287,7 @@ static void digiblaster_store(uint16_t addr, uint8_t value)
 {
     if ((addr & 1) == 0) {
         digiblaster_sound_data = value;
-        sound_store(digiblaster_sound_chip_offset, value, 0);
+        sound_dac_store(&digiblaster_dac, digiblaster_sound_chip_offset, value, (int)value * 128);
     }
 }
 
@@ -791,7 +791,7 @@ static int crt_attach(const char *filename, uint8_t *rawcart)
             break;
     }
 
-    fclose(fd);
+    crt_close(fd);
 
     if (rc == -1) {
         DBG(("crt_attach error (%d)", rc));
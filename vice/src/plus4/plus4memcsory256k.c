@@ -57,6 +57,11 @@ static int cs256k_segment = 3;
 
 uint8_t *cs256k_ram = NULL;
 
+/* Where each 4KiB chunk of the address space is read from and written to,
+   rebuilt by cs256k_update_chunks() when the block or segment changes so
+   the accesses themselves don't have to work it out.  */
+static uint8_t *cs256k_chunks[0x10];
+
 /* Some prototypes */
 static uint8_t cs256k_reg_read(uint16_t addr);
 static void cs256k_reg_store(uint16_t addr, uint8_t value);
@@ -119,10 +124,24 @@ void cs256k_init(void)
     cs256k_log = log_open("CS256K");
 }
 
+static void cs256k_update_chunks(void)
+{
+    int i;
+
+    for (i = 0; i < 0x10; i++) {
+        if (cs256k_ram != NULL && (i >> 2) == cs256k_segment) {
+            cs256k_chunks[i] = cs256k_ram + (cs256k_block * 0x4000) + ((i & 3) * 0x1000);
+        } else {
+            cs256k_chunks[i] = mem_ram + (i * 0x1000);
+        }
+    }
+}
+
 void cs256k_reset(void)
 {
     cs256k_block = 0xf;
     cs256k_segment = 3;
+    cs256k_update_chunks();
 }
 
 static int cs256k_activate(void)
@@ -139,6 +158,7 @@ static int cs256k_deactivate(void)
 {
     lib_free(cs256k_ram);
     cs256k_ram = NULL;
+    cs256k_update_chunks();
     return 0;
 }
 
@@ -160,24 +180,17 @@ static void cs256k_reg_store(uint16_t addr, uint8_t value)
 {
     cs256k_block = (value & 0xf);
     cs256k_segment = (value & 0xc0) >> 6;
+    cs256k_update_chunks();
 }
 
 void cs256k_store(uint16_t addr, uint8_t value)
 {
-    if (addr >= (cs256k_segment * 0x4000) && addr < ((cs256k_segment + 1) * 0x4000)) {
-        cs256k_ram[(cs256k_block * 0x4000) + (addr & 0x3fff)] = value;
-    } else {
-        mem_ram[addr] = value;
-    }
+    cs256k_chunks[addr >> 12][addr & 0x0fff] = value;
 }
 
 uint8_t cs256k_read(uint16_t addr)
 {
-    if (addr >= (cs256k_segment * 0x4000) && addr < ((cs256k_segment + 1) * 0x4000)) {
-        return cs256k_ram[(cs256k_block * 0x4000) + (addr & 0x3fff)];
-    } else {
-        return mem_ram[addr];
-    }
+    return cs256k_chunks[addr >> 12][addr & 0x0fff];
 }
 
 
@@ -58,12 +58,18 @@ int h256k_enabled = 0;
 static int h256k_bank = 3;
 static int h256k_bound = 1;
 
+/* Where each 4KiB chunk of the address space is read from and written to,
+   rebuilt by h256k_update_chunks() when the bank or boundary changes so
+   the accesses themselves don't have to work it out.  */
+static uint8_t *h256k_chunks[0x10];
+
 uint8_t *h256k_ram = NULL;
 
 /* Some prototypes */
 static uint8_t h256k_reg_read(uint16_t addr);
 static void h256k_reg_store(uint16_t addr, uint8_t value);
 static int h256k_dump(void);
+static void h256k_update_chunks(void);
 
 static io_source_t h256k_device = {
     "HANNES",             /* name of the device */
@@ -121,6 +127,8 @@ int set_h256k_enabled(int val)
         }
         h256k_enabled = val;
     }
+    /* the bank numbers depend on the size */
+    h256k_update_chunks();
     return 0;
 }
 
@@ -131,11 +139,34 @@ void h256k_init(void)
     h256k_log = log_open("H256K");
 }
 
+static void h256k_update_chunks(void)
+{
+    int real_bank;
+    int i;
+
+    if (h256k_enabled != 1 && h256k_bank > 3) {
+        real_bank = h256k_bank - 1;
+    } else {
+        real_bank = h256k_bank;
+    }
+
+    for (i = 0; i < 0x10; i++) {
+        /* $0000-$0fff is always internal RAM, so is $1000-$3fff with the
+           boundary at $4000 */
+        if (h256k_ram == NULL || h256k_bank == 3 || i < 1 || (h256k_bound == 1 && i < 4)) {
+            h256k_chunks[i] = mem_ram + (i * 0x1000);
+        } else {
+            h256k_chunks[i] = h256k_ram + (real_bank * 0x10000) + (i * 0x1000);
+        }
+    }
+}
+
 void h256k_reset(void)
 {
     h256k_reg = 0xff;
     h256k_bank = 3;
     h256k_bound = 1;
+    h256k_update_chunks();
 }
 
 static int h256k_activate(int type)
@@ -187,33 +218,12 @@ static void h256k_reg_store(uint16_t addr, uint8_t value)
         h256k_reg = h256k_reg | 0x70;
     }
     h256k_bound = (value & 0x80) >> 7;
+    h256k_update_chunks();
 }
 
 void h256k_store(uint16_t addr, uint8_t value)
 {
-    int real_bank;
-
-    if (h256k_enabled != 1 && h256k_bank > 3) {
-        real_bank = h256k_bank - 1;
-    } else {
-        real_bank = h256k_bank;
-    }
-
-    if (addr < 0x1000 || h256k_bank == 3) {
-        mem_ram[addr] = value;
-    }
-
-    if (h256k_bound == 0 && addr >= 0x1000 && h256k_bank != 3) {
-        h256k_ram[(real_bank * 0x10000) + addr] = value;
-    }
-
-    if (h256k_bound == 1 && addr >= 0x1000 && addr < 0x4000) {
-        mem_ram[addr] = value;
-    }
-
-    if (addr >= 0x4000 && h256k_bank != 3) {
-        h256k_ram[(real_bank * 0x10000) + addr] = value;
-    }
+    h256k_chunks[addr >> 12][addr & 0x0fff] = value;
 }
 
 void h256k_ram_inject(uint16_t addr, uint8_t value)
@@ -223,31 +233,7 @@ void h256k_ram_inject(uint16_t addr, uint8_t value)
 
 uint8_t h256k_read(uint16_t addr)
 {
-    int real_bank;
-
-    if (h256k_enabled != 1 && h256k_bank > 3) {
-        real_bank = h256k_bank - 1;
-    } else {
-        real_bank = h256k_bank;
-    }
-
-    if (addr < 0x1000 || h256k_bank == 3) {
-        return mem_ram[addr];
-    }
-
-    if (h256k_bound == 0 && addr >= 0x1000 && h256k_bank != 3) {
-        return h256k_ram[(real_bank * 0x10000) + addr];
-    }
-
-    if (h256k_bound == 1 && addr >= 0x1000 && addr < 0x4000) {
-        return mem_ram[addr];
-    }
-
-    if (addr >= 0x4000 && h256k_bank != 3) {
-        return h256k_ram[(real_bank * 0x10000) + addr];
-    }
-
-    return mem_ram[addr];
+    return h256k_chunks[addr >> 12][addr & 0x0fff];
 }
 
 static int h256k_dump(void)
@@ -178,7 +178,7 @@ void ted_fetch_alarm_handler(CLOCK offset, void *data)
        until BA is high again; write accesses happen as usual instead.  */
 
     if (offset > 0) {
-        switch (OPINFO_NUMBER(last_opcode_info)) {
+        switch (OPINFO_NUMBER(maincpu_state.last_opcode_info)) {
             case 0:
                 /* In BRK, IRQ and NMI the 3rd, 4th and 5th cycles are write
                    accesses, while the 1st, 2nd, 6th and 7th are read accesses.  */
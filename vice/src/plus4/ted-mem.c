@@ -465,6 +465,8 @@ inline static void ted08_store(const uint8_t value)
  */
 inline static void ted09_store(const uint8_t value)
 {
+    ted_timer_catchup();
+
     /* Emulates Read-Modify-Write behaviour. */
     if (maincpu_rmw_flag) {
         ted.irq_status &= ~((ted.last_read & 0x5e) | 0x80);
@@ -498,6 +500,8 @@ inline static void ted09_store(const uint8_t value)
  */
 inline static void ted0a_store(uint8_t value)
 {
+    ted_timer_catchup();
+
     ted.regs[0x0a] = value & 0x5f;
 
     ted_irq_set_line();
@@ -39,6 +39,7 @@
 #include "raster-sprite.h"
 #include "ted-irq.h"
 #include "ted-snapshot.h"
+#include "ted-timer.h"
 #include "ted.h"
 #include "tedtypes.h"
 #include "types.h"
@@ -255,6 +256,9 @@ int ted_snapshot_read_module(snapshot_t *s)
         goto fail;
     }
 
+    /* The restored IRQ flags may need the underflows of idle timers */
+    ted_timer_catchup();
+
     /* Sanity check the current raster line and the current raster cycle */
     DBG(("TED read snapshot at clock: %d cycle: %d (%d) tedline: %d (%d) rasterline: %d",
          maincpu_clk, TED_RASTER_CYCLE(maincpu_clk), RasterCycle, TED_RASTER_Y(maincpu_clk),
@@ -57,23 +57,41 @@ static CLOCK t1_value;
 static CLOCK t2_value;
 static CLOCK t3_value;
 
+/* An underflow that only sets an IRQ flag which is already set and masked
+   has no visible effect.  The alarm handlers then stop rescheduling and
+   only remember when the next underflow is due, see ted_timer_catchup().  */
+static CLOCK t1_zero;
+static CLOCK t2_zero;
+static CLOCK t3_zero;
+
+static int t1_idle = 0;
+static int t2_idle = 0;
+static int t3_idle = 0;
+
 /*-----------------------------------------------------------------------*/
 
 static void ted_t1_alarm_handler(CLOCK offset, void *data)
 {
-    alarm_set(ted_t1_alarm, maincpu_clk
-              + (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2 - offset);
+    t1_zero = maincpu_clk
+              + (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2 - offset;
     t1_value = (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2 - offset;
 #ifdef DEBUG_TIMER
     log_debug(LOG_DEFAULT, "TI1 ALARM %x", maincpu_clk);
 #endif
     ted_irq_timer1_set();
     t1_last_restart = maincpu_clk - offset;
+
+    if (ted.regs[0x0a] & 0x08) {
+        alarm_set(ted_t1_alarm, t1_zero);
+    } else {
+        alarm_unset(ted_t1_alarm);
+        t1_idle = 1;
+    }
 }
 
 static void ted_t2_alarm_handler(CLOCK offset, void *data)
 {
-    alarm_set(ted_t2_alarm, maincpu_clk + 65536 * 2 - offset);
+    t2_zero = maincpu_clk + 65536 * 2 - offset;
     t2_start = 0;
     t2_value = 65536 * 2 - offset;
 #ifdef DEBUG_TIMER
@@ -81,11 +99,18 @@ static void ted_t2_alarm_handler(CLOCK offset, void *data)
 #endif
     ted_irq_timer2_set();
     t2_last_restart = maincpu_clk - offset;
+
+    if (ted.regs[0x0a] & 0x10) {
+        alarm_set(ted_t2_alarm, t2_zero);
+    } else {
+        alarm_unset(ted_t2_alarm);
+        t2_idle = 1;
+    }
 }
 
 static void ted_t3_alarm_handler(CLOCK offset, void *data)
 {
-    alarm_set(ted_t3_alarm, maincpu_clk + 65536 * 2 - offset);
+    t3_zero = maincpu_clk + 65536 * 2 - offset;
     t3_start = 0;
     t3_value = 65536 * 2 - offset;
 #ifdef DEBUG_TIMER
@@ -93,6 +118,52 @@ static void ted_t3_alarm_handler(CLOCK offset, void *data)
 #endif
     ted_irq_timer3_set();
     t3_last_restart = maincpu_clk - offset;
+
+    if (ted.regs[0x0a] & 0x40) {
+        alarm_set(ted_t3_alarm, t3_zero);
+    } else {
+        alarm_unset(ted_t3_alarm);
+        t3_idle = 1;
+    }
+}
+
+/* Catch up with the underflows skipped by an idle timer, in closed form:
+   the timer restarted at the last of them, and the alarm is set again for
+   the next one.  */
+static void ted_timer_catchup_one(alarm_t *alarm, int *idle, CLOCK *zero,
+                                  CLOCK *value, CLOCK *last_restart,
+                                  CLOCK period)
+{
+    CLOCK num;
+
+    if (!*idle) {
+        return;
+    }
+    *idle = 0;
+
+    if (maincpu_clk >= *zero) {
+        num = (maincpu_clk - *zero) / period;
+        *last_restart = *zero + num * period;
+        *value = period;
+        *zero = *last_restart + period;
+    }
+    alarm_set(alarm, *zero);
+}
+
+/** \brief  Let idle timers catch up with the clock
+ *
+ * To be called before anything that can make the timer underflows visible
+ * again: clearing the IRQ flags, changing the IRQ mask, accessing the
+ * timers or restoring the IRQ flags from a snapshot.
+ */
+void ted_timer_catchup(void)
+{
+    ted_timer_catchup_one(ted_t1_alarm, &t1_idle, &t1_zero, &t1_value, &t1_last_restart,
+                          (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2);
+    ted_timer_catchup_one(ted_t2_alarm, &t2_idle, &t2_zero, &t2_value, &t2_last_restart,
+                          65536 * 2);
+    ted_timer_catchup_one(ted_t3_alarm, &t3_idle, &t3_zero, &t3_value, &t3_last_restart,
+                          65536 * 2);
 }
 
 /*-----------------------------------------------------------------------*/
@@ -100,6 +171,7 @@ static void ted_t3_alarm_handler(CLOCK offset, void *data)
 static void ted_timer_t1_store_low(uint8_t value)
 {
     alarm_unset(ted_t1_alarm);
+    t1_idle = 0;
     if (ted.timer_running[0]) {
         t1_value -= maincpu_clk - t1_last_restart;
         t1_last_restart = maincpu_clk;
@@ -112,8 +184,9 @@ static void ted_timer_t1_store_high(uint8_t value)
 {
     alarm_unset(ted_t1_alarm);
     t1_value = (ted.t1_start = (ted.t1_start & 0x00ff) | (value << 8)) << 1;
-    alarm_set(ted_t1_alarm, maincpu_clk
-              + (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2);
+    t1_zero = maincpu_clk + (ted.t1_start == 0 ? 65536 : ted.t1_start) * 2;
+    alarm_set(ted_t1_alarm, t1_zero);
+    t1_idle = 0;
     t1_last_restart = maincpu_clk;
     ted.timer_running[0] = 1;
 }
@@ -121,6 +194,7 @@ static void ted_timer_t1_store_high(uint8_t value)
 static void ted_timer_t2_store_low(uint8_t value)
 {
     alarm_unset(ted_t2_alarm);
+    t2_idle = 0;
     t2_value = (t2_start = (t2_start & 0xff00) | value) << 1;
     ted.timer_running[1] = 0;
 }
@@ -129,8 +203,9 @@ static void ted_timer_t2_store_high(uint8_t value)
 {
     alarm_unset(ted_t2_alarm);
     t2_value = (t2_start = (t2_start & 0x00ff) | (value << 8)) << 1;
-    alarm_set(ted_t2_alarm, maincpu_clk
-              + (t2_start == 0 ? 65536 : t2_start) * 2);
+    t2_zero = maincpu_clk + (t2_start == 0 ? 65536 : t2_start) * 2;
+    alarm_set(ted_t2_alarm, t2_zero);
+    t2_idle = 0;
     t2_last_restart = maincpu_clk;
     ted.timer_running[1] = 1;
 }
@@ -138,6 +213,7 @@ static void ted_timer_t2_store_high(uint8_t value)
 static void ted_timer_t3_store_low(uint8_t value)
 {
     alarm_unset(ted_t3_alarm);
+    t3_idle = 0;
     t3_value = (t3_start = (t3_start & 0xff00) | value) << 1;
     ted.timer_running[2] = 0;
 }
@@ -146,8 +222,9 @@ static void ted_timer_t3_store_high(uint8_t value)
 {
     alarm_unset(ted_t3_alarm);
     t3_value = (t3_start = (t3_start & 0x00ff) | (value << 8)) << 1;
-    alarm_set(ted_t3_alarm, maincpu_clk
-              + (t3_start == 0 ? 65536 : t3_start) * 2);
+    t3_zero = maincpu_clk + (t3_start == 0 ? 65536 : t3_start) * 2;
+    alarm_set(ted_t3_alarm, t3_zero);
+    t3_idle = 0;
     t3_last_restart = maincpu_clk;
     ted.timer_running[2] = 1;
 }
@@ -231,6 +308,8 @@ void ted_timer_store(uint16_t addr, uint8_t value)
 #ifdef DEBUG_TIMER
     log_debug(LOG_DEFAULT, "TI STORE %02x %02x CLK %x", addr, value, maincpu_clk);
 #endif
+    ted_timer_catchup();
+
     switch (addr) {
         case 0:
             ted_timer_t1_store_low(value);
@@ -255,6 +334,8 @@ void ted_timer_store(uint16_t addr, uint8_t value)
 
 uint8_t ted_timer_read(uint16_t addr)
 {
+    ted_timer_catchup();
+
     switch (addr) {
         case 0:
             return ted_timer_t1_read_low();
@@ -286,4 +367,7 @@ void ted_timer_reset(void)
     ted.t1_start = 0;
     alarm_unset(ted_t2_alarm);
     alarm_unset(ted_t3_alarm);
+    t1_idle = 0;
+    t2_idle = 0;
+    t3_idle = 0;
 }
@@ -34,5 +34,6 @@ void ted_timer_reset(void);
 
 void ted_timer_store(uint16_t addr, uint8_t value);
 uint8_t ted_timer_read(uint16_t addr);
+void ted_timer_catchup(void);
 
 #endif
@@ -143,6 +143,7 @@ static void reset_scribe_state(plot_t *mps);
 
 static void write_lines(plot_t *mps, int lines)
 {
+    uint8_t row[X_PIXELS];
     int x, y;
     int prnr = mps->prnr;
 
@@ -154,9 +155,9 @@ static void write_lines(plot_t *mps, int lines)
 
     for (y = 0; y < lines; y++) {
         for (x = 0; x < X_PIXELS; x++) {
-            output_select_putc(prnr, tochar[(*mps->sheet)[y][x]]);
+            row[x] = tochar[(*mps->sheet)[y][x]];
         }
-        output_select_putc(prnr, (uint8_t)OUTPUT_NEWLINE);
+        output_select_putline(prnr, row, X_PIXELS);
     }
 }
 
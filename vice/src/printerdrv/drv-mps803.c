@@ -589,13 +589,15 @@ static void print_cbm_char(mps_t *mps, const uint8_t rawchar)
 
 static void write_line(mps_t *mps, unsigned int prnr)
 {
+    uint8_t row[MAX_CHARS_PER_LINE * MAX_COLS_PER_CHAR];
     int x, y;
 
+    /* the dots are stored by column, the output wants whole rows */
     for (y = 0; y < mps->char_height; y++) {
         for (x = 0; x < mps->page_width_dots; x++) {
-            output_select_putc(prnr, (uint8_t)(mps->line[x][y] ? OUTPUT_PIXEL_BLACK : OUTPUT_PIXEL_WHITE));
+            row[x] = mps->line[x][y] ? OUTPUT_PIXEL_BLACK : OUTPUT_PIXEL_WHITE;
         }
-        output_select_putc(prnr, (uint8_t)(OUTPUT_NEWLINE));
+        output_select_putline(prnr, row, (unsigned int)mps->page_width_dots);
     }
 
     /*
@@ -346,9 +346,21 @@ static inline int inc_y(nl10_t *nl10)
 }
 
 
+/* Output a row of dots at once.  */
+static void output_row(unsigned int prnr, const uint8_t *dots)
+{
+    uint8_t row[MAX_COL];
+    int c;
+
+    for (c = 0; c < MAX_COL; c++) {
+        row[c] = dots[c] ? OUTPUT_PIXEL_BLACK : OUTPUT_PIXEL_WHITE;
+    }
+    output_select_putline(prnr, row, MAX_COL);
+}
+
 static void linefeed(nl10_t *nl10, unsigned int prnr)
 {
-    int c, i, j;
+    int i, j;
 
     for (i = 0; i < nl10->linespace; i++) {
         for (j = inc_y(nl10); j > 0; j--) {
@@ -358,10 +370,7 @@ static void linefeed(nl10_t *nl10, unsigned int prnr)
             }
 
             /* output topmost row */
-            for (c = 0; c < MAX_COL; c++) {
-                output_select_putc(prnr, (uint8_t)(nl10->line[0][c] ? OUTPUT_PIXEL_BLACK : OUTPUT_PIXEL_WHITE));
-            }
-            output_select_putc(prnr, (uint8_t)(OUTPUT_NEWLINE));
+            output_row(prnr, nl10->line[0]);
 
             /* move everything else one row up */
             memmove(nl10->line[0], nl10->line[1], (BUF_ROW - 1) * MAX_COL * sizeof(uint8_t));
@@ -390,14 +399,11 @@ static void linefeed(nl10_t *nl10, unsigned int prnr)
 
 static void output_buf(nl10_t *nl10, unsigned int prnr)
 {
-    int r, c;
+    int r;
 
     /* output buffer */
     for (r = 0; r < BUF_ROW; r++) {
-        for (c = 0; c < MAX_COL; c++) {
-            output_select_putc(prnr, (uint8_t)(drv_nl10[prnr].line[r][c] ? OUTPUT_PIXEL_BLACK : OUTPUT_PIXEL_WHITE));
-        }
-        output_select_putc(prnr, (uint8_t)(OUTPUT_NEWLINE));
+        output_row(prnr, nl10->line[r]);
     }
 
     /* clear buffer */
@@ -24,8 +24,17 @@
  *
  */
 
+/* The pages are encoded and written by a writer thread, so the emulation
+   does not wait for the image encoder and the host file system.  Opening a
+   page, its lines and closing it are queued in order for that thread.  Before
+   the page settings or the file name of a printer are changed, output_sync()
+   waits until everything queued for it is done.  If the thread cannot be
+   started, everything is done right away.  */
+
 #include "vice.h"
 
+#include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,10 +60,15 @@
 #define DBG(x)
 #endif
 
+/* Emulation waits when more than this many bytes of lines are queued.  */
+#define OUTPUT_MAX_PENDING      (4 * 1024 * 1024)
+
 struct output_gfx_s {
     gfxoutputdrv_t *gfxoutputdrv;
     screenshot_t screenshot;
     uint8_t *line;
+    uint8_t *blank_line;    /* white line for the empty lines of a page */
+    uint8_t *write_line;    /* line being written by the writer */
     char *filename;
     unsigned int isopen;
     unsigned int line_pos;
@@ -64,7 +78,35 @@ typedef struct output_gfx_s output_gfx_t;
 
 static output_gfx_t output_gfx[NUM_OUTPUT_SELECT];
 
-static unsigned int current_prnr;
+enum {
+    OUTPUT_ITEM_OPEN,
+    OUTPUT_ITEM_LINE,
+    OUTPUT_ITEM_CLOSE
+};
+
+typedef struct output_item_s {
+    output_gfx_t *o;
+    int type;
+    char *filename;         /* OUTPUT_ITEM_OPEN */
+    uint8_t *line;          /* OUTPUT_ITEM_LINE, NULL for a blank line */
+    struct output_item_s *next;
+} output_item_t;
+
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when an item was queued */
+static pthread_cond_t output_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when an item was done */
+static pthread_cond_t output_done = PTHREAD_COND_INITIALIZER;
+
+static output_item_t *queue_head = NULL;
+static output_item_t *queue_tail = NULL;
+/* item being done by the thread, no longer in the queue */
+static output_item_t *writing = NULL;
+static size_t pending_bytes = 0;
+
+static int thread_started = 0;
+static int thread_failed = 0;
+static pthread_t output_thread;
 
 /* ------------------------------------------------------------------------- */
 
@@ -96,7 +138,7 @@ static void output_graphics_line_data(screenshot_t *screenshot, uint8_t *data,
     uint8_t *line_base;
     unsigned int color;
 
-    line_base = output_gfx[current_prnr].line;
+    line_base = ((output_gfx_t *)((char *)screenshot - offsetof(output_gfx_t, screenshot)))->write_line;
 
     switch (mode) {
         case SCREENSHOT_MODE_PALETTE:
@@ -128,6 +170,156 @@ static void output_graphics_line_data(screenshot_t *screenshot, uint8_t *data,
 
 /* ------------------------------------------------------------------------- */
 
+static void output_item_do(output_item_t *item)
+{
+    output_gfx_t *o = item->o;
+
+    switch (item->type) {
+        case OUTPUT_ITEM_OPEN:
+            o->gfxoutputdrv->open(&o->screenshot, item->filename);
+            break;
+        case OUTPUT_ITEM_LINE:
+            o->write_line = item->line != NULL ? item->line : o->blank_line;
+            (o->gfxoutputdrv->write)(&o->screenshot);
+            break;
+        case OUTPUT_ITEM_CLOSE:
+            o->gfxoutputdrv->close(&o->screenshot);
+            break;
+    }
+}
+
+static void output_item_free(output_item_t *item)
+{
+    lib_free(item->filename);
+    lib_free(item->line);
+    lib_free(item);
+}
+
+static void *output_thread_main(void *unused)
+{
+    output_item_t *item;
+
+    pthread_mutex_lock(&output_lock);
+    while (1) {
+        while (queue_head == NULL) {
+            pthread_cond_wait(&output_queued, &output_lock);
+        }
+        item = queue_head;
+        queue_head = item->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        writing = item;
+        pthread_mutex_unlock(&output_lock);
+
+        output_item_do(item);
+
+        pthread_mutex_lock(&output_lock);
+        writing = NULL;
+        if (item->line != NULL) {
+            pending_bytes -= item->o->screenshot.width;
+        }
+        pthread_cond_broadcast(&output_done);
+        output_item_free(item);
+    }
+
+    return NULL;
+}
+
+static int start_thread(void)
+{
+    if (!thread_started && !thread_failed) {
+        if (pthread_create(&output_thread, NULL, output_thread_main, NULL)) {
+            log_error(LOG_DEFAULT, "Cannot start printer output thread, writing directly.");
+            thread_failed = 1;
+        } else {
+            pthread_detach(output_thread);
+            thread_started = 1;
+        }
+    }
+    return thread_started;
+}
+
+/* Is anything of `o' (or of any printer if NULL) queued or being done?  */
+static int is_pending(const output_gfx_t *o)
+{
+    output_item_t *item;
+
+    if (writing != NULL && (o == NULL || writing->o == o)) {
+        return 1;
+    }
+    for (item = queue_head; item != NULL; item = item->next) {
+        if (o == NULL || item->o == o) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Queue opening a page, a line or closing a page.  For a line the current
+   line is copied, unless `blank' is set.  */
+static void output_queue(output_gfx_t *o, int type, int blank)
+{
+    output_item_t *item = lib_malloc(sizeof(output_item_t));
+
+    item->o = o;
+    item->type = type;
+    item->filename = NULL;
+    item->line = NULL;
+    item->next = NULL;
+
+    switch (type) {
+        case OUTPUT_ITEM_OPEN:
+            item->filename = lib_strdup(o->filename);
+            break;
+        case OUTPUT_ITEM_LINE:
+            if (!blank) {
+                item->line = lib_malloc(o->screenshot.width);
+                memcpy(item->line, o->line, o->screenshot.width);
+            }
+            break;
+    }
+
+    pthread_mutex_lock(&output_lock);
+
+    if (!start_thread()) {
+        pthread_mutex_unlock(&output_lock);
+        output_item_do(item);
+        output_item_free(item);
+        return;
+    }
+
+    if (item->line != NULL) {
+        while (pending_bytes > OUTPUT_MAX_PENDING) {
+            pthread_cond_wait(&output_done, &output_lock);
+        }
+        pending_bytes += o->screenshot.width;
+    }
+
+    if (queue_tail != NULL) {
+        queue_tail->next = item;
+    } else {
+        queue_head = item;
+    }
+    queue_tail = item;
+    pthread_cond_signal(&output_queued);
+
+    pthread_mutex_unlock(&output_lock);
+}
+
+/* Wait until everything queued for `o' (or for all printers if NULL) is
+   done.  */
+static void output_sync(const output_gfx_t *o)
+{
+    pthread_mutex_lock(&output_lock);
+    while (is_pending(o)) {
+        pthread_cond_wait(&output_done, &output_lock);
+    }
+    pthread_mutex_unlock(&output_lock);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* when creating a filename for a new file, check if that file already exists,
    and if yes, skip that file and try the next one */
 static int advance_outfile_name(unsigned int prnr)
@@ -174,6 +366,9 @@ static int output_graphics_open(unsigned int prnr,
         return 0;
     }
 
+    /* the writer may still be busy with the last page */
+    output_sync(&output_gfx[prnr]);
+
     switch (prnr) {
         case 0:
             resources_get_int("Printer4TextDevice", &device);
@@ -214,6 +409,11 @@ static int output_graphics_open(unsigned int prnr,
     }
     output_gfx[prnr].line = lib_malloc(output_parameter->maxcol);
     memset(output_gfx[prnr].line, OUTPUT_PIXEL_WHITE, output_parameter->maxcol);
+    if (output_gfx[prnr].blank_line != NULL) {
+        lib_free(output_gfx[prnr].blank_line);
+    }
+    output_gfx[prnr].blank_line = lib_malloc(output_parameter->maxcol);
+    memset(output_gfx[prnr].blank_line, OUTPUT_PIXEL_WHITE, output_parameter->maxcol);
 
     output_gfx[prnr].line_pos = 0;
     output_gfx[prnr].line_no = 0;
@@ -237,52 +437,62 @@ static void output_graphics_close(unsigned int prnr)
         unsigned int i;
 
         /* output current line */
-        current_prnr = prnr;
-        (o->gfxoutputdrv->write)(&o->screenshot);
+        output_queue(o, OUTPUT_ITEM_LINE, 0);
         o->line_no++;
 
         /* fill rest of page with blank lines */
         memset(o->line, OUTPUT_PIXEL_WHITE, o->screenshot.width);
         for (i = o->line_no; i < o->screenshot.height; i++) {
-            (o->gfxoutputdrv->write)(&o->screenshot);
+            output_queue(o, OUTPUT_ITEM_LINE, 1);
         }
 
         /* close output */
-        o->gfxoutputdrv->close(&o->screenshot);
+        output_queue(o, OUTPUT_ITEM_CLOSE, 0);
         o->isopen = 0;
     }
 #endif
 }
 
-static int output_graphics_putc(unsigned int prnr, uint8_t b)
+/* Write the buffered line and clear it.  */
+static int output_graphics_newline(unsigned int prnr)
 {
     output_gfx_t *o = &(output_gfx[prnr]);
 
-    if (b == OUTPUT_NEWLINE) {
-        /* if output is not open yet, open it now */
-        if (!o->isopen) {
-            if (advance_outfile_name(prnr) < 0) {
-                return -1;
-            }
-            /* open output file */
-            o->gfxoutputdrv->open(&o->screenshot, o->filename);
-            o->isopen = 1;
-            o->line_pos = 0;
-            o->line_no = 0;
+    /* if output is not open yet, open it now */
+    if (!o->isopen) {
+        /* the file of the last page must exist to find the next name */
+        output_sync(o);
+        if (advance_outfile_name(prnr) < 0) {
+            return -1;
         }
-
-        /* write buffered line to output and clear buffer */
-        current_prnr = prnr;
-        (o->gfxoutputdrv->write)(&o->screenshot);
-        memset(o->line, OUTPUT_PIXEL_WHITE, o->screenshot.width);
+        /* open output file */
+        output_queue(o, OUTPUT_ITEM_OPEN, 0);
+        o->isopen = 1;
         o->line_pos = 0;
+        o->line_no = 0;
+    }
 
-        /* check for bottom of page.  If so, close output file */
-        o->line_no++;
-        if (o->line_no == o->screenshot.height) {
-            o->gfxoutputdrv->close(&o->screenshot);
-            o->isopen = 0;
-        }
+    /* write buffered line to output and clear buffer */
+    output_queue(o, OUTPUT_ITEM_LINE, 0);
+    memset(o->line, OUTPUT_PIXEL_WHITE, o->screenshot.width);
+    o->line_pos = 0;
+
+    /* check for bottom of page.  If so, close output file */
+    o->line_no++;
+    if (o->line_no == o->screenshot.height) {
+        output_queue(o, OUTPUT_ITEM_CLOSE, 0);
+        o->isopen = 0;
+    }
+
+    return 0;
+}
+
+static int output_graphics_putc(unsigned int prnr, uint8_t b)
+{
+    output_gfx_t *o = &(output_gfx[prnr]);
+
+    if (b == OUTPUT_NEWLINE) {
+        return output_graphics_newline(prnr);
     } else {
         /* store pixel in buffer */
         if (o->line_pos < o->screenshot.width) {
@@ -296,6 +506,17 @@ static int output_graphics_putc(unsigned int prnr, uint8_t b)
     return 0;
 }
 
+static int output_graphics_putline(unsigned int prnr, const uint8_t *pixels, unsigned int num)
+{
+    output_gfx_t *o = &(output_gfx[prnr]);
+
+    if (num > o->screenshot.width) {
+        num = o->screenshot.width;
+    }
+    memcpy(o->line, pixels, num);
+    return output_graphics_newline(prnr);
+}
+
 static int output_graphics_getc(unsigned int prnr, uint8_t *b)
 {
     return 0;
@@ -325,18 +546,17 @@ static int output_graphics_formfeed(unsigned int prnr)
         unsigned int i;
 
         /* output current line */
-        current_prnr = prnr;
-        (o->gfxoutputdrv->write)(&o->screenshot);
+        output_queue(o, OUTPUT_ITEM_LINE, 0);
         o->line_no++;
 
         /* fill rest of page with blank lines */
         memset(o->line, OUTPUT_PIXEL_WHITE, o->screenshot.width);
         for (i = o->line_no; i < o->screenshot.height; i++) {
-            (o->gfxoutputdrv->write)(&o->screenshot);
+            output_queue(o, OUTPUT_ITEM_LINE, 1);
         }
 
         /* close output */
-        o->gfxoutputdrv->close(&o->screenshot);
+        output_queue(o, OUTPUT_ITEM_CLOSE, 0);
         o->isopen = 0;
     }
 #endif
@@ -349,6 +569,8 @@ void output_graphics_init(void)
 {
     unsigned int i;
 
+    output_sync(NULL);
+
     for (i = 0; i < NUM_OUTPUT_SELECT; i++) {
         if (output_gfx[i].filename) {
             lib_free(output_gfx[i].filename);
@@ -356,8 +578,12 @@ void output_graphics_init(void)
         if (output_gfx[i].line) {
             lib_free(output_gfx[i].line);
         }
+        if (output_gfx[i].blank_line) {
+            lib_free(output_gfx[i].blank_line);
+        }
         output_gfx[i].filename = NULL;
         output_gfx[i].line = NULL;
+        output_gfx[i].blank_line = NULL;
 
         output_gfx[i].line_pos = 0;
     }
@@ -367,6 +593,9 @@ void output_graphics_shutdown(void)
 {
     unsigned int i;
 
+    /* finish the pages already printed */
+    output_sync(NULL);
+
     for (i = 0; i < NUM_OUTPUT_SELECT; i++) {
         if (output_gfx[i].filename) {
             lib_free(output_gfx[i].filename);
@@ -374,8 +603,12 @@ void output_graphics_shutdown(void)
         if (output_gfx[i].line) {
             lib_free(output_gfx[i].line);
         }
+        if (output_gfx[i].blank_line) {
+            lib_free(output_gfx[i].blank_line);
+        }
         output_gfx[i].filename = NULL;
         output_gfx[i].line = NULL;
+        output_gfx[i].blank_line = NULL;
     }
 }
 
@@ -387,6 +620,7 @@ int output_graphics_init_resources(void)
     output_select.output_open = output_graphics_open;
     output_select.output_close = output_graphics_close;
     output_select.output_putc = output_graphics_putc;
+    output_select.output_putline = output_graphics_putline;
     output_select.output_getc = output_graphics_getc;
     output_select.output_flush = output_graphics_flush;
     output_select.output_formfeed = output_graphics_formfeed;
@@ -33,6 +33,7 @@
 #include "lib.h"
 #include "log.h"
 #include "output-select.h"
+#include "output.h"
 #include "resources.h"
 #include "types.h"
 #include "util.h"
@@ -259,6 +260,22 @@ int output_select_putc(unsigned int prnr, uint8_t b)
     return output_select[prnr].output_putc(prnr, b);
 }
 
+/* Output a row of pixels followed by a newline.  */
+int output_select_putline(unsigned int prnr, const uint8_t *pixels, unsigned int num)
+{
+    unsigned int i;
+
+    if (output_select[prnr].output_putline != NULL) {
+        return output_select[prnr].output_putline(prnr, pixels, num);
+    }
+    for (i = 0; i < num; i++) {
+        if (output_select[prnr].output_putc(prnr, pixels[i]) < 0) {
+            return -1;
+        }
+    }
+    return output_select[prnr].output_putc(prnr, OUTPUT_NEWLINE);
+}
+
 int output_select_getc(unsigned int prnr, uint8_t *b)
 {
     return output_select[prnr].output_getc(prnr, b);
@@ -36,6 +36,8 @@ struct output_select_s {
     int (*output_open)(unsigned int prnr, struct output_parameter_s *output_parameter);
     void (*output_close)(unsigned int prnr);
     int (*output_putc)(unsigned int prnr, uint8_t b);
+    /* optional, a row of pixels and a newline at once */
+    int (*output_putline)(unsigned int prnr, const uint8_t *pixels, unsigned int num);
     int (*output_getc)(unsigned int prnr, uint8_t *b);
     int (*output_flush)(unsigned int prnr);
     int (*output_formfeed)(unsigned int prnr);
@@ -55,6 +57,7 @@ void output_select_register(output_select_t *output_select);
 int output_select_open(unsigned int prnr, struct output_parameter_s *output_parameter);
 void output_select_close(unsigned int prnr);
 int output_select_putc(unsigned int prnr, uint8_t b);
+int output_select_putline(unsigned int prnr, const uint8_t *pixels, unsigned int num);
 int output_select_getc(unsigned int prnr, uint8_t *b);
 int output_select_flush(unsigned int prnr);
 int output_select_formfeed(unsigned int prnr);
@@ -263,6 +263,7 @@ int output_text_init_resources(void)
     output_select.output_open = output_text_open;
     output_select.output_close = output_text_close;
     output_select.output_putc = output_text_putc;
+    output_select.output_putline = NULL;
     output_select.output_getc = output_text_getc;
     output_select.output_flush = output_text_flush;
     output_select.output_formfeed = output_text_formfeed;
@@ -31,7 +31,9 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "alarm.h"
 #include "lib.h"
+#include "maincpu.h"
 #include "mem.h"
 #include "profiler.h"
 #include "profiler_data.h"
@@ -54,6 +56,13 @@ unsigned callstack_size = 0;
 bool     context_dirty = true;
 bool     maincpu_profiling = false;
 
+/* In sampling mode the CPU does not account each instruction. Instead an
+ * alarm charges the cycles of each interval to the last instruction executed
+ * when it fires, in the context given by the call stack and the memory bank
+ * configuration at that time. The call stack is tracked as usual. */
+static CLOCK profile_sample_interval = 0;
+static alarm_t *sample_alarm = NULL;
+
 /* (fragile) flags if the current command is a JSR/INT or RTS/RTI */
 bool     entered_context = false;
 bool     exited_context = false;
@@ -296,8 +305,38 @@ void profile_rtx(uint8_t sp)
     exited_context = true;
 }
 
+static void profile_sample_alarm_handler(CLOCK offset, void *data)
+{
+    profiling_data_t *sample;
+    uint16_t pc = (uint16_t)maincpu_state.last_opcode_addr;
+
+    if (context_dirty || mem_get_current_bank_config() != current_context->memory_bank_config) {
+        initialize_context();
+        context_dirty = false;
+    }
+    /* calls and returns between samples cannot be attributed */
+    entered_context = false;
+    exited_context  = false;
+
+    sample = &profiling_get_page(current_context, pc >> 8)->data[pc & 0xff];
+    sample->num_cycles += profile_sample_interval;
+    sample->num_samples++;
+
+    alarm_set(sample_alarm, maincpu_clk - offset + profile_sample_interval);
+}
+
+static void profile_stop_sampling(void)
+{
+    if (sample_alarm) {
+        alarm_destroy(sample_alarm);
+        sample_alarm = NULL;
+    }
+    profile_sample_interval = 0;
+}
+
 void profile_start(void)
 {
+    profile_stop_sampling();
     if (root_context) free_profiling_context(root_context);
     root_context    = alloc_profiling_context();
     num_context_ids = 0;
@@ -308,6 +347,21 @@ void profile_start(void)
     context_dirty   = true;
 }
 
+void profile_start_sampling(CLOCK interval)
+{
+    profile_start();
+    maincpu_profiling = false;
+    profile_sample_interval = interval;
+    sample_alarm = alarm_new(maincpu_alarm_context, "ProfileSample",
+                             profile_sample_alarm_handler, NULL);
+    alarm_set(sample_alarm, maincpu_clk + interval);
+}
+
+bool profile_running(void)
+{
+    return maincpu_profiling || profile_sample_interval != 0;
+}
+
 void compute_aggregate_stats(profiling_context_t *context) {
     profiling_context_t *c;
     profiling_counter_t total_child_cycles        = 0;
@@ -359,9 +413,13 @@ void compute_aggregate_stats(profiling_context_t *context) {
 void profile_stop(void)
 {
     maincpu_profiling = false;
+    profile_stop_sampling();
 }
 
 static void profile_reset(void) {
+    /* the alarm went with the main CPU alarm context already */
+    sample_alarm = NULL;
+    profile_sample_interval = 0;
     free_profiling_context(root_context);
     root_context = NULL;
     current_context = NULL;
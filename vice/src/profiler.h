@@ -34,9 +34,16 @@ extern bool maincpu_profiling;
 /* resets sample statistics and starts profiling sample collection */
 void profile_start(void);
 
+/* resets sample statistics and starts sampling the PC every `interval'
+   cycles instead of profiling each instruction */
+void profile_start_sampling(CLOCK interval);
+
 /* stops profiling and writes profiling log to disk */
 void profile_stop(void);
 
+/* true if profiling in either mode */
+bool profile_running(void);
+
 /* called by the CPU for each instruction */
 void profile_sample_start(uint16_t pc);
 void profile_sample_finish(uint16_t cycle_time, uint16_t stolen_cycles);
@@ -27,7 +27,9 @@
 
 #include "vice.h"
 
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "videoarch.h"
 
@@ -39,6 +41,10 @@
 #include "viewport.h"
 #include "vsync.h"
 
+/* Pixels drawn beyond the viewport on each side, the CRT filter blurs
+   across that many (see refresh_canvas()).  */
+#define RASTER_CLIP_MARGIN 4
+
 inline static void refresh_canvas(raster_t *raster)
 {
     raster_canvas_area_t *update_area;
@@ -105,9 +111,149 @@ inline static void refresh_canvas(raster_t *raster)
     update_area->is_null = 1;
 }
 
+/* Forget the copy of the last refreshed frame.  */
+static void forget_refreshed_frame(raster_t *raster)
+{
+    lib_free(raster->refreshed_frame);
+    raster->refreshed_frame = NULL;
+    raster->refreshed_frame_size = 0;
+}
+
+/* Set the update area to the displayed lines of the draw buffer that are
+   different from the last refreshed frame, and take them over into the copy
+   of that frame.  Identical frames are not refreshed at all, so filters,
+   uploads and presenting are skipped while the screen does not change.
+   Returns 0 if there is no copy of the same size yet, then everything has
+   to be refreshed.  */
+static int update_changed_lines(raster_t *raster)
+{
+    draw_buffer_t *draw_buffer = raster->canvas->draw_buffer;
+    viewport_t *viewport = raster->canvas->viewport;
+    geometry_t *geometry = raster->canvas->geometry;
+    raster_canvas_area_t *update_area = raster->update_area;
+    unsigned int pitch = draw_buffer->draw_buffer_width;
+    unsigned int size = pitch * draw_buffer->draw_buffer_height;
+    unsigned int first, last, y, ys, ye;
+
+    if (raster->refreshed_frame_size != size) {
+        forget_refreshed_frame(raster);
+        raster->refreshed_frame = lib_malloc(size);
+        raster->refreshed_frame_size = size;
+        memcpy(raster->refreshed_frame, draw_buffer->draw_buffer, size);
+        return 0;
+    }
+
+    first = viewport->first_line;
+    last = MIN(viewport->last_line, draw_buffer->draw_buffer_height - 1);
+
+    ys = last + 1;
+    ye = first;
+    for (y = first; y <= last; y++) {
+        uint8_t *line = draw_buffer->draw_buffer + y * pitch;
+        uint8_t *copy = raster->refreshed_frame + y * pitch;
+
+        if (memcmp(line, copy, pitch) != 0) {
+            memcpy(copy, line, pitch);
+            if (ys > last) {
+                ys = y;
+            }
+            ye = y;
+        }
+    }
+
+    if (ys > last) {
+        /* Nothing changed.  The host already shows this frame unless the
+           last one is still pending, then refresh a line to get it out.
+           The flag is set when the last frame is rendered.  */
+        video_canvas_render_wait(raster->canvas);
+        if (!draw_buffer->refresh_pending) {
+            update_area->is_null = 1;
+            return 1;
+        }
+        ys = ye = first;
+    } else if (raster->canvas->videoconfig->filter == VIDEO_FILTER_SCALE2X) {
+        /* Scale2x looks at the lines above and below each line.  The CRT
+           filter is handled by refresh_canvas().  */
+        if (ys > first) {
+            ys--;
+        }
+        if (ye < last) {
+            ye++;
+        }
+    }
+
+    update_area->xs = viewport->first_x;
+    update_area->xe = viewport->first_x
+                      + MIN(draw_buffer->canvas_width,
+                            geometry->screen_size.width - viewport->first_x) - 1;
+    update_area->ys = ys;
+    update_area->ye = ye;
+    update_area->is_null = 0;
+
+    return 1;
+}
+
+/* Draw the whole screen.  */
+void raster_canvas_clip_none(raster_t *raster)
+{
+    raster->clip_xs = 0;
+    raster->clip_xe = raster->geometry->screen_size.width - 1;
+    raster->clip_ys = 0;
+    raster->clip_ye = UINT_MAX;
+}
+
+/* Limit drawing to the part of the screen shown by the viewport.  Nothing
+   is clipped once something asked for the pixels, like screenshots.  */
+static void update_clip(raster_t *raster)
+{
+    viewport_t *viewport = raster->canvas->viewport;
+    geometry_t *geometry = raster->geometry;
+    unsigned int xs = 0;
+    unsigned int xe = geometry->screen_size.width - 1;
+    unsigned int ys = 0;
+    unsigned int ye = UINT_MAX;
+    unsigned int last;
+
+    if (video_pixels_can_clip()) {
+        if (viewport->first_x > RASTER_CLIP_MARGIN) {
+            xs = viewport->first_x - RASTER_CLIP_MARGIN;
+        }
+        last = viewport->first_x + raster->canvas->draw_buffer->canvas_width - 1;
+        if (last + RASTER_CLIP_MARGIN < xe) {
+            xe = last + RASTER_CLIP_MARGIN;
+        }
+
+        /* lines wrapping around to the top of the screen are not clipped */
+        if (geometry->last_displayed_line < geometry->screen_size.height
+            && viewport->last_line >= viewport->first_line) {
+            if (viewport->first_line > geometry->first_displayed_line + 1) {
+                ys = viewport->first_line - 1;
+            }
+            if (viewport->last_line + 1 < geometry->last_displayed_line) {
+                ye = viewport->last_line + 1;
+            }
+        }
+    }
+
+    if (xs != raster->clip_xs || xe != raster->clip_xe
+        || ys != raster->clip_ys || ye != raster->clip_ye) {
+        raster->clip_xs = xs;
+        raster->clip_xe = xe;
+        raster->clip_ys = ys;
+        raster->clip_ye = ye;
+        /* parts that were not drawn may come into view */
+        raster_force_repaint(raster);
+    }
+
+    video_pixels_clipped = xs > 0 || xe < geometry->screen_size.width - 1
+                           || ys > 0 || ye < UINT_MAX;
+}
+
 void raster_canvas_handle_end_of_frame(raster_t *raster)
 {
-    if (video_disabled_mode) {
+    update_clip(raster);
+
+    if (video_disabled_mode || video_pixels_skipped) {
         return;
     }
 
@@ -119,10 +265,25 @@ void raster_canvas_handle_end_of_frame(raster_t *raster)
         return;
     }
 
-    if (raster->dont_cache) {
-        video_canvas_refresh_all(raster->canvas);
+    if (raster->canvas->draw_buffer->refresh_changed_lines
+        && !raster->canvas->videoconfig->interlaced) {
+        /* The video cache is not used, find the changed lines by comparing
+           with the last refreshed frame.  */
+        if (update_changed_lines(raster)) {
+            refresh_canvas(raster);
+        } else {
+            video_canvas_refresh_all(raster->canvas);
+        }
     } else {
-        refresh_canvas(raster);
+        /* Whatever was refreshed now is not in the copy, so it cannot be
+           used for finding changed lines later.  */
+        forget_refreshed_frame(raster);
+
+        if (raster->dont_cache) {
+            video_canvas_refresh_all(raster->canvas);
+        } else {
+            refresh_canvas(raster);
+        }
     }
 
     if (raster->canvas->videoconfig->interlaced) {
@@ -138,9 +299,13 @@ void raster_canvas_init(raster_t *raster)
     raster->update_area = lib_malloc(sizeof(raster_canvas_area_t));
 
     raster->update_area->is_null = 1;
+
+    raster->refreshed_frame = NULL;
+    raster->refreshed_frame_size = 0;
 }
 
 void raster_canvas_shutdown(raster_t *raster)
 {
     lib_free(raster->update_area);
+    forget_refreshed_frame(raster);
 }
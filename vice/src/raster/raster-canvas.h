@@ -43,6 +43,7 @@ void raster_canvas_init(struct raster_s *raster);
 void raster_canvas_shutdown(struct raster_s *raster);
 
 void raster_canvas_handle_end_of_frame(struct raster_s *raster);
+void raster_canvas_clip_none(struct raster_s *raster);
 void raster_canvas_update_all(struct raster_s *raster);
 
 #endif
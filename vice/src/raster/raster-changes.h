@@ -28,6 +28,9 @@
 #ifndef VICE_RASTER_CHANGES_H
 #define VICE_RASTER_CHANGES_H
 
+#include <stdint.h>
+#include <string.h>
+
 #include "raster.h"
 #include "viewport.h"
 
@@ -40,36 +43,23 @@ enum raster_changes_type_s {
 };
 typedef enum raster_changes_type_s raster_changes_type_t;
 
-struct raster_changes_integer_action_value_s {
-    int *oldp;
-    int newone;
-};
-typedef struct raster_changes_integer_action_value_s
-    raster_changes_integer_action_value_t;
-
-struct raster_changes_ptr_action_value_s {
-    void **oldp;
-    void *newone;
-};
-typedef struct raster_changes_ptr_action_value_s
-    raster_changes_ptr_action_value_t;
-
-union raster_changes_action_value_s {
-    raster_changes_integer_action_value_t integer;
-    raster_changes_ptr_action_value_t ptr;
-};
-typedef union raster_changes_action_value_s raster_changes_action_value_t;
-
+/* A change is kept in 16 bytes, so four of them share a cache line. The new
+   values of pointer changes do not fit next to the target pointer and are
+   kept in a separate array instead.  */
 struct raster_changes_action_s {
     /* "Where" the change happens (eg. character position for foreground
        changes, pixel position for other changes).  */
-    int where;
+    int16_t where;
+
+    /* Data type for changed value (`raster_changes_type_t').  */
+    uint8_t type;
 
-    /* Data type for changed value.  */
-    raster_changes_type_t type;
+    /* New value of an int change, or the index of the new value of a
+       pointer change in `ptrs'.  */
+    int value;
 
-    /* Pointer to where the value is stored and new value to assign.  */
-    raster_changes_action_value_t value;
+    /* Where the value is stored.  */
+    void *target;
 };
 typedef struct raster_changes_action_s raster_changes_action_t;
 
@@ -77,8 +67,15 @@ struct raster_changes_s {
     /* Total number of changes. */
     unsigned int count;
 
+    /* Number of pointer changes, if there are none all changes can be
+       applied as int changes.  */
+    unsigned int ptr_count;
+
     /* List of changes to be applied in order.  */
     raster_changes_action_t actions[RASTER_CHANGES_MAX];
+
+    /* New values of the pointer changes.  */
+    void *ptrs[RASTER_CHANGES_MAX];
 };
 typedef struct raster_changes_s raster_changes_t;
 
@@ -102,18 +99,12 @@ void raster_changes_shutdown(struct raster_s *raster);
 inline static void raster_changes_apply(raster_changes_t *changes,
                                         const unsigned int idx)
 {
-    raster_changes_action_t *action;
-
-    action = changes->actions + idx;
+    const raster_changes_action_t *action = changes->actions + idx;
 
-    switch (changes->actions[idx].type) {
-        case RASTER_CHANGES_TYPE_INT:
-            *action->value.integer.oldp = action->value.integer.newone;
-            break;
-        case RASTER_CHANGES_TYPE_PTR:
-        default:                  /* To be faster.  */
-            *action->value.ptr.oldp = action->value.ptr.newone;
-            break;
+    if (changes->ptr_count == 0 || action->type == RASTER_CHANGES_TYPE_INT) {
+        *(int *)action->target = action->value;
+    } else {
+        *(void **)action->target = changes->ptrs[action->value];
     }
 }
 
@@ -121,15 +112,28 @@ inline static void raster_changes_apply(raster_changes_t *changes,
 inline static void raster_changes_remove_all(raster_changes_t *changes)
 {
     changes->count = 0;
+    changes->ptr_count = 0;
 }
 
 /* Apply all the changes in `changes'.  */
 inline static void raster_changes_apply_all(raster_changes_t *changes)
 {
-    unsigned int i;
-
-    for (i = 0; i < changes->count; i++) {
-        raster_changes_apply(changes, i);
+    const raster_changes_action_t *action = changes->actions;
+    const raster_changes_action_t *end = action + changes->count;
+
+    if (changes->ptr_count == 0) {
+        /* the common case, a list of color and mode changes */
+        for (; action < end; action++) {
+            *(int *)action->target = action->value;
+        }
+    } else {
+        for (; action < end; action++) {
+            if (action->type == RASTER_CHANGES_TYPE_INT) {
+                *(int *)action->target = action->value;
+            } else {
+                *(void **)action->target = changes->ptrs[action->value];
+            }
+        }
     }
 
     raster_changes_remove_all(changes);
@@ -145,10 +149,10 @@ inline static void raster_changes_add_int(raster_changes_t *changes,
 
     action = changes->actions + changes->count++;
 
-    action->where = where;
+    action->where = (int16_t)where;
     action->type = RASTER_CHANGES_TYPE_INT;
-    action->value.integer.oldp = ptr;
-    action->value.integer.newone = new_value;
+    action->value = new_value;
+    action->target = ptr;
 }
 
 /* Add an int change in correct order.  */
@@ -158,22 +162,21 @@ inline static void raster_changes_add_sorted_int(raster_changes_t *changes,
                                                  const int new_value)
 {
     raster_changes_action_t *action;
-    int j, i = (int)changes->count - 1;
+    int i = (int)changes->count - 1;
 
     while (i >= 0 && changes->actions[i].where > where) {
         i--;
     }
-    for (j = (int)changes->count - 1; j > i; j--) {
-        changes->actions[j + 1] = changes->actions[j];
-    }
+    action = changes->actions + 1 + i;
+    memmove(action + 1, action,
+            (changes->count - (unsigned int)(i + 1)) * sizeof(raster_changes_action_t));
 
     changes->count++;
-    action = changes->actions + 1 + i;
 
-    action->where = where;
+    action->where = (int16_t)where;
     action->type = RASTER_CHANGES_TYPE_INT;
-    action->value.integer.oldp = ptr;
-    action->value.integer.newone = new_value;
+    action->value = new_value;
+    action->target = ptr;
 }
 
 /* Add a pointer (`void *') change.  */
@@ -186,10 +189,12 @@ inline static void raster_changes_add_ptr(raster_changes_t *changes,
 
     action = changes->actions + changes->count++;
 
-    action->where = where;
+    action->where = (int16_t)where;
     action->type = RASTER_CHANGES_TYPE_PTR;
-    action->value.ptr.oldp = ptr;
-    action->value.ptr.newone = new_value;
+    action->value = (int)changes->ptr_count;
+    action->target = ptr;
+
+    changes->ptrs[changes->ptr_count++] = new_value;
 }
 
 /* Inlined functions.  These need to be *fast*.  */
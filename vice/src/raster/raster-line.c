@@ -41,6 +41,7 @@
 #include "raster-sprite-status.h"
 #include "raster-sprite.h"
 #include "raster.h"
+#include "video.h"
 #include "viewport.h"
 
 
@@ -73,8 +74,17 @@ inline static void add_line_to_area(raster_canvas_area_t *area, unsigned int y,
 inline void raster_line_draw_blank(raster_t *raster, unsigned int start,
                                    unsigned int end)
 {
-    memset(raster->draw_buffer_ptr + start,
-           raster->border_color, end - start + 1);
+    /* border outside the viewport is never shown */
+    if (start < raster->clip_xs) {
+        start = raster->clip_xs;
+    }
+    if (end > raster->clip_xe) {
+        end = raster->clip_xe;
+    }
+    if (start <= end) {
+        memset(raster->draw_buffer_ptr + start,
+               raster->border_color, end - start + 1);
+    }
 }
 
 /* This kludge updates the sprite-sprite collisions without writing to the
@@ -648,6 +658,16 @@ inline static void handle_visible_line(raster_t *raster)
     }
 }
 
+/* Lines outside the viewport are emulated like lines outside the display,
+   except on chips whose sprite collisions come from drawing the line.  */
+inline static int line_is_clipped(raster_t *raster)
+{
+    return (raster->current_line < raster->clip_ys
+            || raster->current_line > raster->clip_ye)
+           && (raster->sprite_status == NULL
+               || raster->sprite_status->draw_function == NULL);
+}
+
 void raster_line_emulate(raster_t *raster)
 {
     raster_draw_buffer_ptr_update(raster);
@@ -660,12 +680,27 @@ void raster_line_emulate(raster_t *raster)
         raster->blank_enabled = 1;
     }
 
-    if ((raster->current_line >= raster->geometry->first_displayed_line
-         && raster->current_line <= raster->geometry->last_displayed_line)
-        /* handle the case when lines 0+ are displayed in the lower border */
-        || (raster->current_line <= raster->geometry->last_displayed_line - raster->geometry->screen_size.height
-            && raster->geometry->screen_size.height <= raster->geometry->last_displayed_line)
-        ) {
+    /* Skipped frames are emulated as if all lines were outside the display,
+       but not on chips whose sprite collisions come from drawing the line.
+       The lines are all redrawn once drawing resumes.  */
+    if (video_pixels_skipped
+        && (raster->sprite_status == NULL || raster->sprite_status->draw_function == NULL)) {
+        raster_force_repaint(raster);
+        update_sprite_collisions(raster);
+
+        if (raster->changes->have_on_this_line) {
+            raster_changes_apply_all(raster->changes->background);
+            raster_changes_apply_all(raster->changes->foreground);
+            raster_changes_apply_all(raster->changes->border);
+            raster_changes_apply_all(raster->changes->sprites);
+            raster->changes->have_on_this_line = 0;
+        }
+    } else if (((raster->current_line >= raster->geometry->first_displayed_line
+          && raster->current_line <= raster->geometry->last_displayed_line)
+         /* handle the case when lines 0+ are displayed in the lower border */
+         || (raster->current_line <= raster->geometry->last_displayed_line - raster->geometry->screen_size.height
+             && raster->geometry->screen_size.height <= raster->geometry->last_displayed_line))
+        && !line_is_clipped(raster)) {
         /* handle lines with no border or with changes that may affect
            the border as visible lines */
         if (raster->can_disable_border && (raster->border_disable || raster->changes->have_on_this_line)) {
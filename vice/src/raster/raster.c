@@ -93,7 +93,7 @@ static int raster_draw_buffer_alloc(video_canvas_t *canvas,
 
     raster_calculate_padding_size(fb_width, fb_height, &padded_size, &unpadded_offset);
 
-    canvas->draw_buffer->draw_buffer_padded_allocations[0] = lib_calloc(1, padded_size);
+    canvas->draw_buffer->draw_buffer_padded_allocations[0] = archdep_large_alloc(padded_size);
     canvas->draw_buffer->draw_buffer_non_padded[0] = canvas->draw_buffer->draw_buffer_padded_allocations[0] + unpadded_offset;
     canvas->draw_buffer->draw_buffer = canvas->draw_buffer->draw_buffer_non_padded[0];
 
@@ -105,7 +105,7 @@ static int raster_draw_buffer_alloc(video_canvas_t *canvas,
          * This was added for rendering within the monitor.
          */
 
-        canvas->draw_buffer->draw_buffer_padded_allocations[1] = lib_calloc(1, padded_size);
+        canvas->draw_buffer->draw_buffer_padded_allocations[1] = archdep_large_alloc(padded_size);
         canvas->draw_buffer->draw_buffer_non_padded[1] = canvas->draw_buffer->draw_buffer_padded_allocations[1] + unpadded_offset;
     }
 
@@ -115,8 +115,8 @@ static int raster_draw_buffer_alloc(video_canvas_t *canvas,
 
 static void raster_draw_buffer_free(video_canvas_t *canvas)
 {
-    lib_free(canvas->draw_buffer->draw_buffer_padded_allocations[0]);
-    lib_free(canvas->draw_buffer->draw_buffer_padded_allocations[1]);
+    archdep_large_free(canvas->draw_buffer->draw_buffer_padded_allocations[0]);
+    archdep_large_free(canvas->draw_buffer->draw_buffer_padded_allocations[1]);
 
     canvas->draw_buffer->draw_buffer_padded_allocations[0] = NULL;
     canvas->draw_buffer->draw_buffer_padded_allocations[1] = NULL;
@@ -442,6 +442,9 @@ void raster_set_geometry(raster_t *raster,
 
     raster->canvas->draw_buffer->visible_width = canvas_width;
     raster->canvas->draw_buffer->visible_height = canvas_height;
+
+    /* draw everything until the viewport is known */
+    raster_canvas_clip_none(raster);
 }
 
 static int raster_realize_init_done = 0;
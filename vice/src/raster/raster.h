@@ -161,6 +161,18 @@ struct raster_s {
     /* Area to update.  */
     struct raster_canvas_area_s *update_area;
 
+    /* Part of the screen shown on the canvas, plus a small margin for the
+       filters.  Border pixels left and right of `clip_xs'..`clip_xe' are not
+       drawn, and lines outside `clip_ys'..`clip_ye' are emulated like lines
+       outside the display.  */
+    unsigned int clip_xs, clip_xe;
+    unsigned int clip_ys, clip_ye;
+
+    /* Copy of the draw buffer as of the last refresh, used for finding the
+       changed lines when the canvas wants only those refreshed.  */
+    uint8_t *refreshed_frame;
+    unsigned int refreshed_frame_size;
+
     /* This is a bit mask representing each pixel on the screen (1 =
        foreground, 0 = background) and is used both for sprite-background
        collision checking and background sprite drawing.  When cache is
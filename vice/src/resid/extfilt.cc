@@ -40,6 +40,8 @@ ExternalFilter::ExternalFilter()
   // accuracy (27 bits). This is crucial since w0lp and w0hp are so far apart.
   w0lp_1_s7 = int(1e-6/(1e-6+1e4*1e-9)*(1 << 7) + 0.5);
   w0hp_1_s17 = int(1e-6/(1e-6+1e3*1e-5)*(1 << 17) + 0.5);
+  w0lp_8_s7 = w0lp_1_s7*8 >> 3;
+  w0hp_8_s17 = w0hp_1_s17*8 >> 3;
 }
 
 
@@ -78,6 +78,10 @@ protected:
   int w0lp_1_s7;
   int w0hp_1_s17;
 
+  // Cutoff frequencies multiplied by the full step of delta_t cycles.
+  int w0lp_8_s7;
+  int w0hp_8_s17;
+
 friend class SID;
 };
 
@@ -132,10 +136,14 @@ void ExternalFilter::clock(cycle_count delta_t, short Vi)
   // Maximum delta cycles for the external filter to work satisfactorily
   // is approximately 8.
   cycle_count delta_t_flt = 8;
+  int w0lp_s7 = w0lp_8_s7;
+  int w0hp_s17 = w0hp_8_s17;
 
   while (delta_t) {
     if (unlikely(delta_t < delta_t_flt)) {
       delta_t_flt = delta_t;
+      w0lp_s7 = w0lp_1_s7*delta_t_flt >> 3;
+      w0hp_s17 = w0hp_1_s17*delta_t_flt >> 3;
     }
 
     // Calculate filter outputs.
@@ -143,8 +151,8 @@ void ExternalFilter::clock(cycle_count delta_t, short Vi)
     // Vhp = Vhp + w0hp*(Vlp - Vhp)*delta_t;
     // Vo  = Vlp - Vhp;
 
-    int dVlp = (w0lp_1_s7*delta_t_flt >> 3)*((Vi << 11) - Vlp) >> 4;
-    int dVhp = (w0hp_1_s17*delta_t_flt >> 3)*(Vlp - Vhp) >> 14;
+    int dVlp = w0lp_s7*((Vi << 11) - Vlp) >> 4;
+    int dVhp = w0hp_s17*(Vlp - Vhp) >> 14;
     Vlp += dVlp;
     Vhp += dVhp;
 
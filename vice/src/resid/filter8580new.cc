@@ -773,6 +773,29 @@ void Filter::set_sum_mix()
   mix =
     (enabled ? (mode & 0x70) | ((~(filt | (mode & 0x80) >> 5)) & 0x0f) : 0x0f)
     & voice_mask;
+
+  static const int summer_offsets[5] = {
+    summer_offset<0>::value, summer_offset<1>::value, summer_offset<2>::value,
+    summer_offset<3>::value, summer_offset<4>::value
+  };
+  static const int mixer_offsets[8] = {
+    mixer_offset<0>::value, mixer_offset<1>::value, mixer_offset<2>::value,
+    mixer_offset<3>::value, mixer_offset<4>::value, mixer_offset<5>::value,
+    mixer_offset<6>::value, mixer_offset<7>::value
+  };
+  int i, n;
+
+  for (i = n = 0; i < 4; i++) {
+    sum_mask[i] = (sum >> i) & 1 ? -1 : 0;
+    n += (sum >> i) & 1;
+  }
+  sum_offset = summer_offsets[n];
+
+  for (i = n = 0; i < 7; i++) {
+    mix_mask[i] = (mix >> i) & 1 ? -1 : 0;
+    n += (mix >> i) & 1;
+  }
+  mix_offset = mixer_offsets[n];
 }
 
 } // namespace reSID
@@ -582,6 +582,15 @@ protected:
   reg8 sum;
   reg8 mix;
 
+  // Masks selecting the inputs of the summer / mixer (v1, v2, v3, ve and
+  // Vlp, Vbp, Vhp), and the offsets of the lookup tables for the number of
+  // inputs.  These are derived from sum and mix, so that the routing is not
+  // decoded again for every cycle.
+  int sum_mask[4];
+  int mix_mask[7];
+  int sum_offset;
+  int mix_offset;
+
   // State of filter.
   int Vhp; // highpass
   int Vbp; // bandpass
@@ -690,75 +699,9 @@ void Filter::clock(int voice1, int voice2, int voice3)
   v3 = ((voice3*f.voice_scale_s14 + rnd.getNoise()) >> 18) + f.voice_DC;
 
   // Sum inputs routed into the filter.
-  int Vi = 0;
-  int offset = 0;
-
-  switch (sum & 0xf) {
-  case 0x0:
-    Vi = 0;
-    offset = summer_offset<0>::value;
-    break;
-  case 0x1:
-    Vi = v1;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x2:
-    Vi = v2;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x3:
-    Vi = v2 + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x4:
-    Vi = v3;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x5:
-    Vi = v3 + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x6:
-    Vi = v3 + v2;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x7:
-    Vi = v3 + v2 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0x8:
-    Vi = ve;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x9:
-    Vi = ve + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xa:
-    Vi = ve + v2;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xb:
-    Vi = ve + v2 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xc:
-    Vi = ve + v3;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xd:
-    Vi = ve + v3 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xe:
-    Vi = ve + v3 + v2;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xf:
-    Vi = ve + v3 + v2 + v1;
-    offset = summer_offset<4>::value;
-    break;
-  }
+  int Vi = (v1 & sum_mask[0]) + (v2 & sum_mask[1]) + (v3 & sum_mask[2])
+    + (ve & sum_mask[3]);
+  int offset = sum_offset;
 
   // Calculate filter outputs.
   if (sid_model == 0) {
@@ -799,75 +742,9 @@ void Filter::clock(cycle_count delta_t, int voice1, int voice2, int voice3)
   }
 
   // Sum inputs routed into the filter.
-  int Vi = 0;
-  int offset = 0;
-
-  switch (sum & 0xf) {
-  case 0x0:
-    Vi = 0;
-    offset = summer_offset<0>::value;
-    break;
-  case 0x1:
-    Vi = v1;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x2:
-    Vi = v2;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x3:
-    Vi = v2 + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x4:
-    Vi = v3;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x5:
-    Vi = v3 + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x6:
-    Vi = v3 + v2;
-    offset = summer_offset<2>::value;
-    break;
-  case 0x7:
-    Vi = v3 + v2 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0x8:
-    Vi = ve;
-    offset = summer_offset<1>::value;
-    break;
-  case 0x9:
-    Vi = ve + v1;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xa:
-    Vi = ve + v2;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xb:
-    Vi = ve + v2 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xc:
-    Vi = ve + v3;
-    offset = summer_offset<2>::value;
-    break;
-  case 0xd:
-    Vi = ve + v3 + v1;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xe:
-    Vi = ve + v3 + v2;
-    offset = summer_offset<3>::value;
-    break;
-  case 0xf:
-    Vi = ve + v3 + v2 + v1;
-    offset = summer_offset<4>::value;
-    break;
-  }
+  int Vi = (v1 & sum_mask[0]) + (v2 & sum_mask[1]) + (v3 & sum_mask[2])
+    + (ve & sum_mask[3]);
+  int offset = sum_offset;
 
   // Maximum delta cycles for filter fixpoint iteration to converge
   // is approximately 3.
@@ -940,555 +817,16 @@ short Filter::output()
 {
   model_filter_t& f = model_filter[sid_model];
 
-  // Writing the switch below manually would be tedious and error-prone;
-  // it is rather generated by the following Perl program:
-
-  /*
-my @i = qw(v1 v2 v3 ve Vlp Vbp Vhp);
-for my $mix (0..2**@i-1) {
-    print sprintf("  case 0x%02x:\n", $mix);
-    my @sumVoice;
-    my @sumFilt;
-    my $bit = 0;
-    for (@i) {
-        if ($bit < 4) {
-            unshift(@sumVoice, $_) if $mix & (1 << $bit);
-        } else {
-            unshift(@sumFilt, $_) if $mix & (1 << $bit);
-        }
-        $bit += 1;
-    }
-    my $sum;
-    if (@sumFilt) {
-        $sumV = (@sumVoice) ? " + ".join(" + ", @sumVoice) : "";
-        $sum = "((((".join(" + ", @sumFilt).") * f.filterGain) + dc_offset) >> 12)" . $sumV;
-    } else {
-        $sum = join(" + ", @sumVoice) || "0";
-    }
-    print "    Vi = $sum;\n";
-    print "    offset = mixer_offset<" . (@sumVoice+@sumFilt) . ">::value;\n";
-    print "    break;\n";
-}
-  */
-
   // Sum inputs routed into the mixer.
-  int Vi = 0;
-  int offset = 0;
+  int Vi = (v1 & mix_mask[0]) + (v2 & mix_mask[1]) + (v3 & mix_mask[2])
+    + (ve & mix_mask[3]);
+  int offset = mix_offset;
   const int dc_offset = 32767 * ((1 << 12) - f.filterGain);
 
-  switch (mix & 0x7f) {
-  case 0x00:
-    Vi = 0;
-    offset = mixer_offset<0>::value;
-    break;
-  case 0x01:
-    Vi = v1;
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x02:
-    Vi = v2;
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x03:
-    Vi = v2 + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x04:
-    Vi = v3;
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x05:
-    Vi = v3 + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x06:
-    Vi = v3 + v2;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x07:
-    Vi = v3 + v2 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x08:
-    Vi = ve;
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x09:
-    Vi = ve + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x0a:
-    Vi = ve + v2;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x0b:
-    Vi = ve + v2 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x0c:
-    Vi = ve + v3;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x0d:
-    Vi = ve + v3 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x0e:
-    Vi = ve + v3 + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x0f:
-    Vi = ve + v3 + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x10:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x11:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x12:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x13:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x14:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x15:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x16:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x17:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x18:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x19:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x1a:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x1b:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x1c:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x1d:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x1e:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x1f:
-    Vi = ((((Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x20:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x21:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x22:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x23:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x24:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x25:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x26:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x27:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x28:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x29:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x2a:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x2b:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x2c:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x2d:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x2e:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x2f:
-    Vi = ((((Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x30:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x31:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x32:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x33:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x34:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x35:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x36:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x37:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x38:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x39:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x3a:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x3b:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x3c:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x3d:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x3e:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x3f:
-    Vi = ((((Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x40:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<1>::value;
-    break;
-  case 0x41:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x42:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x43:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x44:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x45:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x46:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x47:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x48:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x49:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x4a:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x4b:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x4c:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x4d:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x4e:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x4f:
-    Vi = ((((Vhp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x50:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x51:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x52:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x53:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x54:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x55:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x56:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x57:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x58:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x59:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x5a:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x5b:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x5c:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x5d:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x5e:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x5f:
-    Vi = ((((Vhp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x60:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<2>::value;
-    break;
-  case 0x61:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x62:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x63:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x64:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x65:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x66:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x67:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x68:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x69:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x6a:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x6b:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x6c:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x6d:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x6e:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x6f:
-    Vi = ((((Vhp + Vbp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x70:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12);
-    offset = mixer_offset<3>::value;
-    break;
-  case 0x71:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v1;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x72:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x73:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v2 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x74:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x75:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x76:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x77:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + v3 + v2 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x78:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve;
-    offset = mixer_offset<4>::value;
-    break;
-  case 0x79:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v1;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x7a:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x7b:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v2 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x7c:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3;
-    offset = mixer_offset<5>::value;
-    break;
-  case 0x7d:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v1;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x7e:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2;
-    offset = mixer_offset<6>::value;
-    break;
-  case 0x7f:
-    Vi = ((((Vhp + Vbp + Vlp) * f.filterGain) + dc_offset) >> 12) + ve + v3 + v2 + v1;
-    offset = mixer_offset<7>::value;
-    break;
+  // The filter outputs are scaled by the filter gain.
+  if (mix & 0x70) {
+    Vi += ((((Vlp & mix_mask[4]) + (Vbp & mix_mask[5]) + (Vhp & mix_mask[6]))
+            * f.filterGain) + dc_offset) >> 12;
   }
 
   // Sum the inputs in the mixer and run the mixer output through the gain.
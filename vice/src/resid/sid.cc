@@ -32,6 +32,14 @@
 #include <fstream>
 using namespace std;
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESID_CONVOLVE_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESID_CONVOLVE_NEON 1
+#include <arm_neon.h>
+#endif
+
 #ifndef round
 #define round(x) (x>=0.0?floor(x+0.5):ceil(x-0.5))
 #endif
@@ -56,6 +64,164 @@ inline short amplify(int input, int scaleFactor)
     return clip((scaleFactor * input) / 2);
 }
 
+
+// ----------------------------------------------------------------------------
+// Convolution of samples with a FIR table, the inner loop of resampling.
+// The SIMD versions sum in the same 32 bit integers as the plain C version,
+// so all of them yield bit identical results.
+// ----------------------------------------------------------------------------
+static int convolve_c(const short* a, const short* b, int n)
+{
+  int out = 0;
+  for (int i = 0; i < n; i++) {
+    out += a[i]*b[i];
+  }
+  return out;
+}
+
+#ifdef RESID_CONVOLVE_X86
+__attribute__((target("sse2")))
+static int convolve_sse2(const short* a, const short* b, int n)
+{
+  __m128i acc = _mm_setzero_si128();
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(acc) + convolve_c(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int convolve_avx2(const short* a, const short* b, int n)
+{
+  __m256i acc = _mm256_setzero_si256();
+  int i;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  __m128i acc4 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                               _mm256_extracti128_si256(acc, 1));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(acc4) + convolve_c(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef RESID_CONVOLVE_NEON
+static int convolve_neon(const short* a, const short* b, int n)
+{
+  int32x4_t acc = vdupq_n_s32(0);
+  int i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    int16x8_t va = vld1q_s16(a + i);
+    int16x8_t vb = vld1q_s16(b + i);
+    acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+    acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+  }
+  int32x2_t acc2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  acc2 = vpadd_s32(acc2, acc2);
+
+  return vget_lane_s32(acc2, 0) + convolve_c(a + i, b + i, n - i);
+}
+#endif
+
+typedef int (*convolve_func_t)(const short* a, const short* b, int n);
+
+// Pick the fastest convolution the host CPU supports.
+static convolve_func_t convolve_select()
+{
+#if defined(RESID_CONVOLVE_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return convolve_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return convolve_sse2;
+  }
+#elif defined(RESID_CONVOLVE_NEON)
+  return convolve_neon;
+#endif
+  return convolve_c;
+}
+
+static const convolve_func_t convolve = convolve_select();
+
+
+// ----------------------------------------------------------------------------
+// FIR tables are large and expensive to calculate, so SID instances using the
+// same sampling parameters share one table. Like the other class wide tables
+// they must only be set up from one thread.
+// ----------------------------------------------------------------------------
+struct fir_table
+{
+  int N;
+  int RES;
+  double beta;
+  double f_cycles_per_sample;
+  double filter_scale;
+  short* fir;
+  int refs;
+  fir_table* next;
+};
+
+static fir_table* fir_tables = 0;
+
+static short* fir_table_get(int N, int RES, double beta,
+                            double f_cycles_per_sample, double filter_scale)
+{
+  for (fir_table* t = fir_tables; t; t = t->next) {
+    if (t->N == N && t->RES == RES && t->beta == beta &&
+        t->f_cycles_per_sample == f_cycles_per_sample &&
+        t->filter_scale == filter_scale)
+    {
+      t->refs++;
+      return t->fir;
+    }
+  }
+  return 0;
+}
+
+static void fir_table_add(short* fir, int N, int RES, double beta,
+                          double f_cycles_per_sample, double filter_scale)
+{
+  fir_table* t = new fir_table;
+  t->N = N;
+  t->RES = RES;
+  t->beta = beta;
+  t->f_cycles_per_sample = f_cycles_per_sample;
+  t->filter_scale = filter_scale;
+  t->fir = fir;
+  t->refs = 1;
+  t->next = fir_tables;
+  fir_tables = t;
+}
+
+static void fir_table_release(short* fir)
+{
+  for (fir_table** p = &fir_tables; *p; p = &(*p)->next) {
+    fir_table* t = *p;
+    if (t->fir == fir) {
+      if (--t->refs == 0) {
+        *p = t->next;
+        delete[] t->fir;
+        delete t;
+      }
+      return;
+    }
+  }
+}
+
 // ----------------------------------------------------------------------------
 // Constructor.
 // ----------------------------------------------------------------------------
@@ -95,7 +261,7 @@ SID::SID()
 SID::~SID()
 {
   delete[] sample;
-  delete[] fir;
+  fir_table_release(fir);
 }
 
 
@@ -627,7 +793,7 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   if (method != SAMPLE_RESAMPLE && method != SAMPLE_RESAMPLE_FASTMEM)
   {
     delete[] sample;
-    delete[] fir;
+    fir_table_release(fir);
     sample = 0;
     fir = 0;
     return true;
@@ -695,9 +861,18 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   fir_f_cycles_per_sample = f_cycles_per_sample;
   fir_filter_scale = filter_scale;
 
+  // Use the table of another SID with the same parameters if there is one.
+  fir_table_release(fir);
+  fir = fir_table_get(fir_N, fir_RES, fir_beta, fir_f_cycles_per_sample,
+                      fir_filter_scale);
+  if (fir) {
+    return true;
+  }
+
   // Allocate memory for FIR tables.
-  delete[] fir;
   fir = new short[fir_N*fir_RES];
+  fir_table_add(fir, fir_N, fir_RES, fir_beta, fir_f_cycles_per_sample,
+                fir_filter_scale);
 
   // Calculate fir_RES FIR tables for linear interpolation.
   for (int i = 0; i < fir_RES; i++) {
@@ -807,13 +982,17 @@ void SID::clock(cycle_count delta_t)
     }
 
     // Clock oscillators.
+    bool msb_rising = false;
     for (i = 0; i < 3; i++) {
       voice[i].wave.clock(delta_t_min);
+      msb_rising |= voice[i].wave.msb_rising;
     }
 
     // Synchronize oscillators.
-    for (i = 0; i < 3; i++) {
-      voice[i].wave.synchronize();
+    if (unlikely(msb_rising)) {
+      for (i = 0; i < 3; i++) {
+        voice[i].wave.synchronize();
+      }
     }
 
     delta_t_osc -= delta_t_min;
@@ -1005,10 +1184,7 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
     short* sample_start = sample + sample_index - fir_N - 1 + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v1 = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v1 += sample_start[j]*fir_start[j];
-    }
+    int v1 = convolve(sample_start, fir_start, fir_N);
 
     // Use next FIR table, wrap around to first FIR table using
     // next sample.
@@ -1019,10 +1195,7 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
     fir_start = fir + fir_offset*fir_N;
 
     // Convolution with filter impulse response.
-    int v2 = 0;
-    for (int k = 0; k < fir_N; k++) {
-      v2 += sample_start[k]*fir_start[k];
-    }
+    int v2 = convolve(sample_start, fir_start, fir_N);
 
     // Linear interpolation.
     // fir_offset_rmd is equal for all samples, it can thus be factorized out:
@@ -1071,10 +1244,7 @@ int SID::clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int int
     short* sample_start = sample + sample_index - fir_N + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v += sample_start[j]*fir_start[j];
-    }
+    int v = convolve(sample_start, fir_start, fir_N);
 
     v >>= FIR_SHIFT;
 
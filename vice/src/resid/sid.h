@@ -202,19 +202,22 @@ void SID::clock()
 {
   int i;
 
-  // Clock amplitude modulators.
+  // Clock amplitude modulators and oscillators.
+  // The two are independent, so each voice is stepped in one pass while
+  // its state is at hand.
+  bool msb_rising = false;
   for (i = 0; i < 3; i++) {
     voice[i].envelope.clock();
-  }
-
-  // Clock oscillators.
-  for (i = 0; i < 3; i++) {
     voice[i].wave.clock();
+    msb_rising |= voice[i].wave.msb_rising;
   }
 
   // Synchronize oscillators.
-  for (i = 0; i < 3; i++) {
-    voice[i].wave.synchronize();
+  // Only an oscillator whose MSB was set high this cycle can sync another.
+  if (unlikely(msb_rising)) {
+    for (i = 0; i < 3; i++) {
+      voice[i].wave.synchronize();
+    }
   }
 
   // Calculate waveform output.
@@ -37,6 +37,7 @@
 
 /* #define VICE_DEBUG_RESOURCES */
 
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -73,6 +74,14 @@
  */
 #define NUM_ALLOCATED_RESOURCES_INIT    512
 
+/** \brief  Initial number of slots in the hash table, a power of two
+ */
+#define HASH_SIZE_INIT                  1024
+
+/** \brief  Size of the stdio buffer used when writing the resource file
+ */
+#define SAVE_FILE_BUFFER_SIZE           65536
+
 
 typedef struct resource_ram_s {
     /* Resource name.  */
@@ -106,8 +115,8 @@ typedef struct resource_ram_s {
     /* callback function vector chain */
     struct resource_callback_desc_s *callback;
 
-    /* number of next entry in hash collision list */
-    int hash_next;
+    /* full hash key of the name, compared before the name itself */
+    unsigned int hash;
 } resource_ram_t;
 
 
@@ -126,37 +135,76 @@ static char *machine_id = NULL;
 
 static void write_resource_item(FILE *f, int num);
 static char *string_resource_item(int num, const char *delim);
+static uint64_t resources_hash(bool event_safe_only);
 
-/* use a hash table with 1024 entries */
-static const unsigned int logHashSize = 10;
-
+/* open addressing hash table with linear probing. Slots hold the index into
+   the resources array (or -1 when empty) rather than pointers into the array
+   because the array may be reallocated. The table is kept at most half full,
+   so a lookup usually needs a single probe. */
 static int *hashTable = NULL;
+static unsigned int hashSize = 0;
 
 static resource_callback_desc_t *resource_modified_callback = NULL;
 
-/* calculate the hash key */
+/* While loading many resources at once, the callbacks of the resources are
+   only marked here, and issued once per resource when the bulk load ends.  */
+static int bulk_depth = 0;
+static unsigned int bulk_pending_num = 0;
+static uint8_t *bulk_pending = NULL;
+static int bulk_modified = 0;
+
+/* Resource file written by the save thread.  */
+typedef struct save_job_s {
+    char *fname;
+    char *section;
+    void (*done)(int result, void *param);
+    void *param;
+} save_job_t;
+
+static pthread_t save_thread;
+static int save_thread_running = 0;
+
+/* calculate the hash key (FNV-1a of the lower case name) */
 static unsigned int resources_calc_hash_key(const char *name)
 {
-    unsigned int key, i, shift;
+    unsigned int key, i;
 
     DBG(("resources_calc_hash_key: '%s'", name ? name : "<empty/null>"));
 
-    key = 0; shift = 0;
+    key = 2166136261u;
     for (i = 0; name[i] != '\0'; i++) {
         /* resources are case-insensitive */
-        unsigned int sym = (unsigned int)tolower((int)name[i]);
+        key ^= (unsigned int)tolower((unsigned char)name[i]);
+        key *= 16777619u;
+    }
+    return key;
+}
 
-        if (shift >= logHashSize) {
-            shift = 0;
-        }
+/* enter resource number `num' into the hash table */
+static void resources_hash_insert(int num)
+{
+    unsigned int slot = resources[num].hash & (hashSize - 1);
 
-        key ^= (sym << shift);
-        if (shift + 8 > logHashSize) {
-            key ^= (((unsigned int)sym) >> (logHashSize - shift));
-        }
-        shift++;
+    while (hashTable[slot] >= 0) {
+        slot = (slot + 1) & (hashSize - 1);
+    }
+    hashTable[slot] = num;
+}
+
+/* double the hash table and enter all resources again */
+static void resources_hash_grow(void)
+{
+    unsigned int i;
+
+    lib_free(hashTable);
+    hashSize *= 2;
+    hashTable = lib_malloc(hashSize * sizeof(int));
+    for (i = 0; i < hashSize; i++) {
+        hashTable[i] = -1;
+    }
+    for (i = 0; i < num_resources; i++) {
+        resources_hash_insert((int)i);
     }
-    return (key & ((1 << logHashSize) - 1));
 }
 
 
@@ -193,6 +241,16 @@ static void resources_exec_callback_chain(const resource_callback_desc_t
 /* issue callbacks for a modified resource */
 static void resources_issue_callback(resource_ram_t *res, int global_callback)
 {
+    unsigned int num = (unsigned int)(res - resources);
+
+    if (bulk_depth > 0 && num < bulk_pending_num) {
+        bulk_pending[num] = 1;
+        if (global_callback != 0) {
+            bulk_modified = 1;
+        }
+        return;
+    }
+
     if (res->callback != NULL) {
         resources_exec_callback_chain(res->callback, res->name);
     }
@@ -203,34 +261,96 @@ static void resources_issue_callback(resource_ram_t *res, int global_callback)
 }
 
 
+/* issue the callbacks for "any resource modified" */
+static void resources_issue_modified_callback(void)
+{
+    if (bulk_depth > 0) {
+        bulk_modified = 1;
+        return;
+    }
+
+    if (resource_modified_callback != NULL) {
+        resources_exec_callback_chain(resource_modified_callback, NULL);
+    }
+}
+
+/** \brief  Start setting many resources at once
+ *
+ * Until the matching resources_bulk_end(), the resources are set as usual,
+ * but their callbacks are held back.  Setting the defaults and loading the
+ * resource file otherwise notify the UI for every single resource, and
+ * several times for the ones set by both.  Calls can be nested.
+ */
+void resources_bulk_begin(void)
+{
+    if (bulk_depth++ > 0) {
+        return;
+    }
+
+    bulk_pending_num = num_resources;
+    bulk_pending = lib_calloc(1, bulk_pending_num > 0 ? bulk_pending_num : 1);
+    bulk_modified = 0;
+}
+
+/** \brief  Issue the callbacks held back since resources_bulk_begin()
+ *
+ * Every modified resource gets its callbacks once, followed by a single
+ * call of the callbacks for any resource modified.
+ */
+void resources_bulk_end(void)
+{
+    uint8_t *pending;
+    unsigned int i, num;
+
+    if (bulk_depth == 0 || --bulk_depth > 0) {
+        return;
+    }
+
+    pending = bulk_pending;
+    num = bulk_pending_num;
+    bulk_pending = NULL;
+    bulk_pending_num = 0;
+
+    for (i = 0; i < num; i++) {
+        if (pending[i] && resources[i].callback != NULL) {
+            resources_exec_callback_chain(resources[i].callback, resources[i].name);
+        }
+    }
+    lib_free(pending);
+
+    if (bulk_modified) {
+        bulk_modified = 0;
+        resources_issue_modified_callback();
+    }
+}
+
+
 #if 0
-/* for debugging (hash collisions, hash chains, ...) */
+/* for debugging (hash collisions, probe lengths, ...) */
 static void resources_check_hash_table(FILE *f)
 {
-    int i, entries;
+    unsigned int i, probes, longest;
 
-    for (i = 0, entries = 0; i < (1 << logHashSize); i++) {
+    for (i = 0, probes = 0, longest = 0; i < hashSize; i++) {
         if (hashTable[i] >= 0) {
-            int next;
+            unsigned int home = resources[hashTable[i]].hash & (hashSize - 1);
+            unsigned int dist = (i - home) & (hashSize - 1);
 
-            fprintf(f, "%d: %s", i, resources[hashTable[i]].name);
-            next = resources[hashTable[i]].hash_next;
-            while (next >= 0) {
-                fprintf(f, " -> %s", resources[next].name);
-                next = resources[next].hash_next;
+            fprintf(f, "%u: %s (+%u)\n", i, resources[hashTable[i]].name, dist);
+            probes += dist + 1;
+            if (dist + 1 > longest) {
+                longest = dist + 1;
             }
-            fprintf(f, "\n");
-            entries++;
         }
     }
-    fprintf(f, "NUM %d, ENTIES %d\n", num_resources, entries);
+    fprintf(f, "NUM %u, SLOTS %u, PROBES %u, LONGEST %u\n",
+            num_resources, hashSize, probes, longest);
 }
 #endif
 
 static resource_ram_t *lookup(const char *name)
 {
-    resource_ram_t *res;
-    unsigned int hashkey;
+    unsigned int hashkey, slot;
 
     DBG(("lookup name:'%s'", name ? name : "<empty/null>"));
 
@@ -238,16 +358,27 @@ static resource_ram_t *lookup(const char *name)
         return NULL;
     }
     hashkey = resources_calc_hash_key(name);
-    res = (hashTable[hashkey] >= 0) ? resources + hashTable[hashkey] : NULL;
-    while (res != NULL) {
-        if (util_strcasecmp(res->name, name) == 0) {
+    slot = hashkey & (hashSize - 1);
+    while (hashTable[slot] >= 0) {
+        resource_ram_t *res = resources + hashTable[slot];
+
+        if (res->hash == hashkey && util_strcasecmp(res->name, name) == 0) {
             return res;
         }
-        res = (res->hash_next >= 0) ? resources + res->hash_next : NULL;
+        slot = (slot + 1) & (hashSize - 1);
     }
     return NULL;
 }
 
+/* get the resource for a handle, NULL if the handle is invalid */
+static resource_ram_t *lookup_handle(resource_handle_t handle)
+{
+    if (handle < 0 || (unsigned int)handle >= num_resources) {
+        return NULL;
+    }
+    return resources + handle;
+}
+
 /* Configuration filename set via -config */
 char *vice_config_file = NULL;
 
@@ -263,8 +394,6 @@ int resources_register_int(const resource_int_t *r)
     sp = r;
     dp = resources + num_resources;
     while (sp->name != NULL) {
-        unsigned int hashkey;
-
         if (sp->value_ptr == NULL || sp->set_func == NULL) {
             archdep_startup_log_error(
                 "Inconsistent resource declaration '%s'.\n", sp->name);
@@ -294,11 +423,14 @@ int resources_register_int(const resource_int_t *r)
         dp->param = sp->param;
         dp->callback = NULL;
 
-        hashkey = resources_calc_hash_key(sp->name);
-        dp->hash_next = hashTable[hashkey];
-        hashTable[hashkey] = (int)(dp - resources);
+        dp->hash = resources_calc_hash_key(sp->name);
 
         num_resources++;
+        if (num_resources * 2 > hashSize) {
+            resources_hash_grow();
+        } else {
+            resources_hash_insert((int)(dp - resources));
+        }
         sp++;
         dp++;
     }
@@ -316,8 +448,6 @@ int resources_register_string(const resource_string_t *r)
     sp = r;
     dp = resources + num_resources;
     while (sp->name != NULL) {
-        unsigned int hashkey;
-
         if (sp->factory_value == NULL
             || sp->value_ptr == NULL || sp->set_func == NULL) {
             archdep_startup_log_error(
@@ -348,11 +478,14 @@ int resources_register_string(const resource_string_t *r)
         dp->param = sp->param;
         dp->callback = NULL;
 
-        hashkey = resources_calc_hash_key(sp->name);
-        dp->hash_next = hashTable[hashkey];
-        hashTable[hashkey] = (int)(dp - resources);
+        dp->hash = resources_calc_hash_key(sp->name);
 
         num_resources++;
+        if (num_resources * 2 > hashSize) {
+            resources_hash_grow();
+        } else {
+            resources_hash_insert((int)(dp - resources));
+        }
         sp++;
         dp++;
     }
@@ -375,10 +508,13 @@ static void resources_free(void)
  */
 void resources_shutdown(void)
 {
+    resources_save_wait();
     resources_free();
 
     lib_free(resources);
     lib_free(hashTable);
+    hashTable = NULL;
+    hashSize = 0;
     lib_free(machine_id);
     lib_free(vice_config_file);
 }
@@ -496,9 +632,10 @@ int resources_init(const char *machine)
 
     /* hash table maps hash keys to index in resources array rather than
        pointers into the array because the array may be reallocated. */
-    hashTable = lib_malloc((1 << logHashSize) * sizeof(int));
+    hashSize = HASH_SIZE_INIT;
+    hashTable = lib_malloc(hashSize * sizeof(int));
 
-    for (i = 0; i < (unsigned int)(1 << logHashSize); i++) {
+    for (i = 0; i < hashSize; i++) {
         hashTable[i] = -1;
     }
 
@@ -593,17 +730,8 @@ static int resources_set_internal_string(resource_ram_t *r,
     return status;
 }
 
-int resources_set_int(const char *name, int value)
+static int resources_set_int_checked(resource_ram_t *r, int value)
 {
-    resource_ram_t *r = lookup(name);
-
-    if (r == NULL) {
-        log_warning(LOG_DEFAULT,
-                    "Trying to assign value to unknown "
-                    "resource `%s'.", name);
-        return -1;
-    }
-
     /* if netplay is not idle, and resource is tagged RES_EVENT_STRICT,
        it can not be changed at all */
     if ((r->event_relevant == RES_EVENT_STRICT) &&
@@ -621,7 +749,7 @@ int resources_set_int(const char *name, int value)
     return resources_set_internal_int(r, value);
 }
 
-int resources_set_string(const char *name, const char *value)
+int resources_set_int(const char *name, int value)
 {
     resource_ram_t *r = lookup(name);
 
@@ -632,6 +760,11 @@ int resources_set_string(const char *name, const char *value)
         return -1;
     }
 
+    return resources_set_int_checked(r, value);
+}
+
+static int resources_set_string_checked(resource_ram_t *r, const char *value)
+{
     /* if netplay is not idle, and resource is tagged RES_EVENT_STRICT,
        it can not be changed at all */
     if ((r->event_relevant == RES_EVENT_STRICT) &&
@@ -649,6 +782,20 @@ int resources_set_string(const char *name, const char *value)
     return resources_set_internal_string(r, value);
 }
 
+int resources_set_string(const char *name, const char *value)
+{
+    resource_ram_t *r = lookup(name);
+
+    if (r == NULL) {
+        log_warning(LOG_DEFAULT,
+                    "Trying to assign value to unknown "
+                    "resource `%s'.", name);
+        return -1;
+    }
+
+    return resources_set_string_checked(r, value);
+}
+
 void resources_set_value_event(void *data, int size)
 {
     char *name;
@@ -889,6 +1036,115 @@ int resources_get_string_sprintf(const char *name, const char **value_return,
     return result;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Get a handle for resource \a name
+ *
+ * The handle stays valid until resources_shutdown() and lets callers that
+ * access a resource repeatedly skip the lookup by name.
+ *
+ * \param[in]   name    resource name
+ *
+ * \return  handle, or -1 if the resource is unknown
+ */
+resource_handle_t resources_get_handle(const char *name)
+{
+    resource_ram_t *r = lookup(name);
+
+    if (r == NULL) {
+        log_warning(LOG_DEFAULT,
+                    "Trying to get handle of unknown "
+                    "resource `%s'.", name);
+        return -1;
+    }
+
+    return (resource_handle_t)(r - resources);
+}
+
+/** \brief  Set integer resource by handle
+ *
+ * \param[in]   handle  resource handle
+ * \param[in]   value   new value
+ *
+ * \return  0 on success, <0 on failure
+ */
+int resources_set_int_by_handle(resource_handle_t handle, int value)
+{
+    resource_ram_t *r = lookup_handle(handle);
+
+    if (r == NULL) {
+        log_warning(LOG_DEFAULT, "Invalid resource handle %d.", handle);
+        return -1;
+    }
+
+    return resources_set_int_checked(r, value);
+}
+
+/** \brief  Set string resource by handle
+ *
+ * \param[in]   handle  resource handle
+ * \param[in]   value   new value
+ *
+ * \return  0 on success, <0 on failure
+ */
+int resources_set_string_by_handle(resource_handle_t handle, const char *value)
+{
+    resource_ram_t *r = lookup_handle(handle);
+
+    if (r == NULL) {
+        log_warning(LOG_DEFAULT, "Invalid resource handle %d.", handle);
+        return -1;
+    }
+
+    return resources_set_string_checked(r, value);
+}
+
+/** \brief  Get integer resource by handle
+ *
+ * \param[in]   handle          resource handle
+ * \param[out]  value_return    resource value target, 0 on failure
+ *
+ * \return  0 on success, -1 on failure
+ */
+int resources_get_int_by_handle(resource_handle_t handle, int *value_return)
+{
+    resource_ram_t *r = lookup_handle(handle);
+
+    *value_return = 0;
+
+    if (r == NULL || r->type != RES_INTEGER) {
+        log_warning(LOG_DEFAULT, "Invalid integer resource handle %d.", handle);
+        return -1;
+    }
+
+    *value_return = *(int *)r->value_ptr;
+    return 0;
+}
+
+/** \brief  Get string resource by handle
+ *
+ * \param[in]   handle          resource handle
+ * \param[out]  value_return    resource value target, NULL on failure
+ *
+ * \return  0 on success, -1 on failure
+ */
+int resources_get_string_by_handle(resource_handle_t handle, const char **value_return)
+{
+    resource_ram_t *r = lookup_handle(handle);
+
+    *value_return = NULL;
+
+    if (r == NULL || r->type != RES_STRING) {
+        log_warning(LOG_DEFAULT, "Invalid string resource handle %d.", handle);
+        return -1;
+    }
+
+    *value_return = *(const char **)r->value_ptr;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
 int resources_set_default_int(const char *name, int value)
 {
     resource_ram_t *r = lookup(name);
@@ -954,6 +1210,8 @@ int resources_set_defaults(void)
     log_verbose(LOG_DEFAULT, "%s", ""); /* ugly hack to produce a blank log line, but not trigger a warning */
     log_verbose(LOG_DEFAULT, "Setting resources to default...");
 
+    resources_bulk_begin();
+
     /* the cartridge system uses internal state variables so the default cartridge
        can be unset without changing the attached cartridge and/or attach another
        cartridge without changing the default. to completely restore the default,
@@ -995,9 +1253,8 @@ int resources_set_defaults(void)
         resources_issue_callback(resources + i, 0);
     }
 
-    if (resource_modified_callback != NULL) {
-        resources_exec_callback_chain(resource_modified_callback, NULL);
-    }
+    resources_issue_modified_callback();
+    resources_bulk_end();
     log_verbose(LOG_DEFAULT, "Done setting resources to default.");
 
     return 0;
@@ -1063,6 +1320,63 @@ void resources_get_event_safe_list(event_list_state_t *list)
     event_record_in_list(list, EVENT_LIST_END, NULL, 0);
 }
 
+/** \brief  Hash the values of the resources that affect the emulation
+ *
+ * Covers the resources that have to be the same on both sides of netplay,
+ * so two configurations with the same hash emulate the same machine.
+ *
+ * \return  64-bit FNV-1a hash of the names and values
+ */
+uint64_t resources_get_event_safe_hash(void)
+{
+    return resources_hash(true);
+}
+
+/** \brief  Hash the values of all resources
+ *
+ * Unlike resources_get_event_safe_hash() this also covers ROM and cartridge
+ * file names and the like, so two configurations with the same hash start
+ * up the same machine.
+ *
+ * \return  64-bit FNV-1a hash of the names and values
+ */
+uint64_t resources_get_hash(void)
+{
+    return resources_hash(false);
+}
+
+static uint64_t resources_hash(bool event_safe_only)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    unsigned int i;
+    const char *p;
+    char buf[16];
+
+    for (i = 0; i < num_resources; i++) {
+        if (event_safe_only && resources[i].event_relevant != RES_EVENT_SAME) {
+            continue;
+        }
+        for (p = resources[i].name; *p != '\0'; p++) {
+            hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+        }
+        if (resources[i].type == RES_INTEGER) {
+            snprintf(buf, sizeof(buf), "=%d", *(int *)resources[i].value_ptr);
+            p = buf;
+        } else {
+            hash = (hash ^ '=') * 1099511628211ULL;
+            p = *(char **)resources[i].value_ptr;
+            if (p == NULL) {
+                p = "";
+            }
+        }
+        for (; *p != '\0'; p++) {
+            hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+        }
+        hash = (hash ^ 0) * 1099511628211ULL;
+    }
+    return hash;
+}
+
 int resources_toggle(const char *name, int *new_value_return)
 {
     resource_ram_t *r = lookup(name);
@@ -1324,6 +1638,7 @@ static int load_resource_file(const char *fname)
         }
     }
 
+    resources_bulk_begin();
     do {
         retval = resources_read_item_from_file(f);
         switch (retval) {
@@ -1344,9 +1659,8 @@ static int load_resource_file(const char *fname)
 
     fclose(f);
 
-    if (resource_modified_callback != NULL) {
-        resources_exec_callback_chain(resource_modified_callback, NULL);
-    }
+    resources_issue_modified_callback();
+    resources_bulk_end();
 
     return err ? RESERR_FILE_INVALID : 0;
 }
@@ -1357,6 +1671,10 @@ int resources_load(const char *fname)
 {
     char *default_name = NULL;
     int res;
+
+    /* do not read a file the save thread is still writing */
+    resources_save_wait();
+
     if (fname == NULL) {
         if (vice_config_file == NULL) {
             /* try the alternative name/location first */
@@ -1385,6 +1703,9 @@ int resources_load(const char *fname)
    If `fname' is NULL, load them from the default resource file.  */
 int resources_reset_and_load(const char *fname)
 {
+    int res;
+
+    resources_bulk_begin();
     resources_set_defaults();
     if (fname != NULL) {
         /* if fname was not NULL, check it's version here, as this function will
@@ -1392,7 +1713,10 @@ int resources_reset_and_load(const char *fname)
            if fname is NULL. */
         check_resource_file_version(fname);
     }
-    return resources_load(fname);
+    res = resources_load(fname);
+    resources_bulk_end();
+
+    return res;
 }
 
 static char *string_resource_item(int num, const char *delim)
@@ -1468,40 +1792,90 @@ static int resource_item_isdefault(int num)
     return 0;
 }
 
-/* Save all the resources into file `fname'.  If `fname' is NULL, save them
-   in the default resource file.  Writing the resources does not destroy the
-   resources for the other emulators.  */
-int resources_save(const char *fname)
+/* Get the name of the resource file to save to, `fname' or the default
+   one if it is NULL.  */
+static char *save_file_name(const char *fname)
 {
-    char *backup_name = NULL;
-    FILE *in_file = NULL, *out_file;
+    char *default_name;
+
+    if (fname != NULL) {
+        return lib_strdup(fname);
+    }
+
+    if (vice_config_file == NULL) {
+        /* try the alternative name/location first */
+        default_name = archdep_default_portable_resource_file_name();
+        if (default_name != NULL) {
+            if (archdep_access(default_name, ARCHDEP_ACCESS_R_OK) != 0) {
+                /* if not found at alternative location, try the normal one
+                 this also creates the .vice directory if not present */
+                lib_free(default_name);
+                default_name = archdep_default_resource_file_name();
+            }
+        }
+    } else {
+        default_name = lib_strdup(vice_config_file);
+    }
+    return default_name;
+}
+
+static void section_append(char **section, size_t *len, size_t *size,
+                           const char *str)
+{
+    size_t str_len = strlen(str);
+
+    if (*len + str_len + 1 > *size) {
+        while (*len + str_len + 1 > *size) {
+            *size *= 2;
+        }
+        *section = lib_realloc(*section, *size);
+    }
+    memcpy(*section + *len, str, str_len + 1);
+    *len += str_len;
+}
+
+/* Put the section of the current emulator together, with all the resources
+   that differ from the defaults.  */
+static char *save_section(void)
+{
+    char *section, *line;
+    size_t len = 0, size = 1024;
     unsigned int i;
-    char *default_name = NULL;
 
-    /* get name for config file */
-    if (fname == NULL) {
-        if (vice_config_file == NULL) {
-            /* try the alternative name/location first */
-            default_name = archdep_default_portable_resource_file_name();
-            if (default_name != NULL) {
-                if (archdep_access(default_name, ARCHDEP_ACCESS_R_OK) != 0) {
-                    /* if not found at alternative location, try the normal one
-                     this also creates the .vice directory if not present */
-                    lib_free(default_name);
-                    default_name = archdep_default_resource_file_name();
-                }
+    section = lib_malloc(size);
+    *section = '\0';
+
+    section_append(&section, &len, &size, "[");
+    section_append(&section, &len, &size, machine_id);
+    section_append(&section, &len, &size, "]\n");
+
+    for (i = 0; i < num_resources; i++) {
+        /* only dump into the file what is different to the default config */
+        if (!resource_item_isdefault(i)) {
+            line = string_resource_item(i, "\n");
+            if (line != NULL) {
+                section_append(&section, &len, &size, line);
+                lib_free(line);
             }
-        } else {
-            default_name = lib_strdup(vice_config_file);
         }
-        fname = default_name;
     }
+    section_append(&section, &len, &size, "\n");
+
+    return section;
+}
+
+/* Write `section' into the resource file `fname', keeping the sections of
+   the other emulators.  This only works on the files and can run on any
+   thread.  */
+static int save_file(const char *fname, const char *section)
+{
+    char *backup_name = NULL;
+    FILE *in_file = NULL, *out_file;
 
     /* make a backup of an existing config, open it */
     if (util_file_exists(fname) != 0) {
         /* try to open it */
         if (archdep_access(fname, ARCHDEP_ACCESS_W_OK) != 0) {
-            lib_free(default_name);
             return RESERR_WRITE_PROTECTED;
         }
         /* get backup name */
@@ -1510,26 +1884,22 @@ int resources_save(const char *fname)
         if (util_file_exists(backup_name) != 0) {
             if (archdep_access(backup_name, ARCHDEP_ACCESS_W_OK) != 0) {
                 lib_free(backup_name);
-                lib_free(default_name);
                 return RESERR_WRITE_PROTECTED;
             }
             if (archdep_remove(backup_name) != 0) {
                 lib_free(backup_name);
-                lib_free(default_name);
                 return RESERR_CANNOT_REMOVE_BACKUP;
             }
         }
         /* move existing config to backup */
         if (archdep_rename(fname, backup_name) != 0) {
             lib_free(backup_name);
-            lib_free(default_name);
             return RESERR_CANNOT_RENAME_FILE;
         }
         /* open the old config */
         in_file = fopen(backup_name, MODE_READ_TEXT);
         if (!in_file) {
             lib_free(backup_name);
-            lib_free(default_name);
             return RESERR_READ_ERROR;
         }
     }
@@ -1543,11 +1913,11 @@ int resources_save(const char *fname)
             fclose(in_file);
         }
         lib_free(backup_name);
-        lib_free(default_name);
         return RESERR_CANNOT_CREATE_FILE;
     }
 
-    setbuf(out_file, NULL);
+    /* the whole file is written at once when it is closed */
+    setvbuf(out_file, NULL, _IOFBF, SAVE_FILE_BUFFER_SIZE);
 
     /* put version tag at the top of the config file */
     fprintf(out_file, "[Version]\nConfigVersion=%s\n\n", VERSION);
@@ -1582,14 +1952,7 @@ int resources_save(const char *fname)
     }
 
     /* Write our current configuration.  */
-    fprintf(out_file, "[%s]\n", machine_id);
-    for (i = 0; i < num_resources; i++) {
-        /* only dump into the file what is different to the default config */
-        if (!resource_item_isdefault(i)) {
-            write_resource_item(out_file, i);
-        }
-    }
-    fprintf(out_file, "\n");
+    fputs(section, out_file);
 
     if (in_file != NULL) {
         char buf[1024];
@@ -1638,12 +2001,105 @@ int resources_save(const char *fname)
         archdep_remove(backup_name);
     }
 
-    fclose(out_file);
+    if (fclose(out_file) != 0) {
+        lib_free(backup_name);
+        return RESERR_CANNOT_CREATE_FILE;
+    }
     lib_free(backup_name);
-    lib_free(default_name);
     return 0;
 }
 
+/* Save all the resources into file `fname'.  If `fname' is NULL, save them
+   in the default resource file.  Writing the resources does not destroy the
+   resources for the other emulators.  */
+int resources_save(const char *fname)
+{
+    char *name, *section;
+    int res;
+
+    /* a save still running would overwrite this one */
+    resources_save_wait();
+
+    name = save_file_name(fname);
+    section = save_section();
+    res = save_file(name, section);
+    lib_free(section);
+    lib_free(name);
+
+    return res;
+}
+
+static void *save_thread_main(void *arg)
+{
+    save_job_t *job = arg;
+    int res;
+
+    res = save_file(job->fname, job->section);
+    if (res < 0) {
+        log_error(LOG_DEFAULT, "Cannot write configuration file `%s' (%d).",
+                  job->fname, res);
+    }
+    if (job->done != NULL) {
+        job->done(res, job->param);
+    }
+
+    lib_free(job->fname);
+    lib_free(job->section);
+    lib_free(job);
+
+    return NULL;
+}
+
+/** \brief  Save all the resources on a thread of their own
+ *
+ * The resource values are taken right away, only writing the file happens
+ * in the background, so the caller does not wait for the disk.  When it is
+ * done, \a done is called on the save thread with the result that
+ * resources_save() would have returned.
+ *
+ * \param[in]   fname   resource file, NULL for the default one
+ * \param[in]   done    function called when the file is written, or NULL
+ * \param[in]   param   extra parameter for \a done
+ *
+ * \return  0 if the save was started, the result of resources_save() if it
+ *          could not be started and the file was written right away
+ */
+int resources_save_async(const char *fname, void (*done)(int result, void *param),
+                         void *param)
+{
+    save_job_t *job;
+
+    resources_save_wait();
+
+    job = lib_malloc(sizeof(save_job_t));
+    job->fname = save_file_name(fname);
+    job->section = save_section();
+    job->done = done;
+    job->param = param;
+
+    if (pthread_create(&save_thread, NULL, save_thread_main, job) != 0) {
+        int res = save_file(job->fname, job->section);
+
+        lib_free(job->fname);
+        lib_free(job->section);
+        lib_free(job);
+        return res;
+    }
+    save_thread_running = 1;
+
+    return 0;
+}
+
+/** \brief  Wait until a save started by resources_save_async() is done
+ */
+void resources_save_wait(void)
+{
+    if (save_thread_running) {
+        pthread_join(save_thread, NULL);
+        save_thread_running = 0;
+    }
+}
+
 /* dump ALL resources of the current machine into a file */
 int resources_dump(const char *fname)
 {
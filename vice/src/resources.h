@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum resource_type_s {
     RES_INTEGER,
@@ -56,6 +57,9 @@ typedef enum resource_event_relevant_s {
 
 typedef void *resource_value_t;
 
+/* Index of a registered resource, see resources_get_handle() */
+typedef int resource_handle_t;
+
 typedef int resource_set_func_int_t(int, void *);
 typedef int resource_set_func_string_t(const char *, void *);
 
@@ -165,8 +169,24 @@ int resources_get_int_sprintf(const char *name, int *value_return, ...) VICE_ATT
 int resources_get_string_sprintf(const char *name, const char **value_return, ...) VICE_ATTR_RESPRINTF;
 int resources_get_default_value(const char *name, void *value_return);
 resource_type_t resources_query_type(const char *name);
+
+/* access by handle, skipping the lookup by name */
+resource_handle_t resources_get_handle(const char *name);
+int resources_set_int_by_handle(resource_handle_t handle, int value);
+int resources_set_string_by_handle(resource_handle_t handle, const char *value);
+int resources_get_int_by_handle(resource_handle_t handle, int *value_return);
+int resources_get_string_by_handle(resource_handle_t handle, const char **value_return);
 int resources_save(const char *fname);
 
+/* save resources, writing the file on a thread of its own */
+int resources_save_async(const char *fname, void (*done)(int result, void *param),
+                         void *param);
+void resources_save_wait(void);
+
+/* set many resources at once, issuing their callbacks only at the end */
+void resources_bulk_begin(void);
+void resources_bulk_end(void);
+
 /* load resources from a file, keep existing settings */
 int resources_load(const char *fname);
 
@@ -186,6 +206,8 @@ int resources_set_default_string(const char *name, char *value);
 
 int resources_set_event_safe(void);
 void resources_get_event_safe_list(struct event_list_state_s *list);
+uint64_t resources_get_event_safe_hash(void);
+uint64_t resources_get_hash(void);
 
 /* Register a callback for a resource; use name=NULL to register a callback for all.
    Resource-specific callbacks are always called with a valid resource name as parameter.
@@ -0,0 +1,470 @@
+/*
+ * rewind.c - Rewind the emulation using a ring of in-memory snapshots.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* While "Rewind" is enabled the machine state is saved at the end of every
+   "RewindInterval" frames. Saves go to one work buffer; every
+   REWIND_GROUP_SNAPSHOTS saves a full keyframe is copied from it, and for
+   each save only the pages changed since that keyframe are kept. Keyframes
+   and their deltas form groups, and the groups form a ring that covers
+   "RewindSeconds" of emulation; the oldest group is reused once it is full.
+
+   Stepping back restores the chosen snapshot and drops everything newer, so
+   the emulation simply carries on recording from there. */
+
+#include "vice.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "interrupt.h"
+#include "joyport.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "network.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vice-event.h"
+#include "vsync.h"
+
+/* Number of snapshots sharing one keyframe */
+#define REWIND_GROUP_SNAPSHOTS 50
+
+#define REWIND_MAX_SECONDS  600
+#define REWIND_MAX_INTERVAL 50
+
+typedef struct rewind_group_s {
+    /* Full snapshot the deltas of this group are taken against */
+    snapshot_memory_t *keyframe;
+
+    /* Deltas, the first one is taken right after the keyframe */
+    snapshot_memory_t *delta[REWIND_GROUP_SNAPSHOTS];
+
+    /* Number of valid deltas */
+    int count;
+} rewind_group_t;
+
+static log_t rewind_log = LOG_DEFAULT;
+
+/* "Rewind" resource, flag: record the rewind buffer */
+static int rewind_enabled = 0;
+
+/* "RewindSeconds" resource, length of the rewind buffer */
+static int rewind_seconds = 30;
+
+/* "RewindInterval" resource, number of frames between snapshots */
+static int rewind_interval = 1;
+
+/* Ring of groups, `groups_used' of them are valid and `group_newest' is the
+   one being filled */
+static rewind_group_t *groups = NULL;
+static int groups_num = 0;
+static int groups_used = 0;
+static int group_newest = 0;
+
+/* Buffer every snapshot is written to first */
+static snapshot_memory_t *work = NULL;
+
+/* Frames since the last snapshot */
+static int frames_since_save = 0;
+
+/* Number of snapshots to step back at the next vsync, 0 if none */
+static int pending_steps = 0;
+
+/* ------------------------------------------------------------------------- */
+
+/* Free the ring and the work buffer */
+static void rewind_free(void)
+{
+    int i, j;
+
+    for (i = 0; i < groups_num; i++) {
+        snapshot_memory_free(groups[i].keyframe);
+        for (j = 0; j < REWIND_GROUP_SNAPSHOTS; j++) {
+            snapshot_memory_free(groups[i].delta[j]);
+        }
+    }
+    lib_free(groups);
+    groups = NULL;
+    groups_num = 0;
+    groups_used = 0;
+    group_newest = 0;
+
+    snapshot_memory_free(work);
+    work = NULL;
+
+    frames_since_save = 0;
+    pending_steps = 0;
+}
+
+/* Allocate the ring for the current settings */
+static void rewind_alloc(void)
+{
+    double fps = vsync_get_refresh_frequency();
+    int snapshots;
+
+    if (fps <= 0) {
+        fps = 50;
+    }
+    snapshots = (int)(rewind_seconds * fps) / rewind_interval;
+
+    /* one more group for the one being filled */
+    groups_num = (snapshots + REWIND_GROUP_SNAPSHOTS - 1) / REWIND_GROUP_SNAPSHOTS + 1;
+    groups = lib_calloc((size_t)groups_num, sizeof(rewind_group_t));
+    work = snapshot_memory_new();
+}
+
+/* Whether the machine state may be recorded or restored at this vsync */
+static bool rewind_possible(void)
+{
+    return rewind_enabled
+           && machine_class != VICE_MACHINE_VSID
+           && !network_connected()
+           && !event_record_active()
+           && !event_playback_active();
+}
+
+/* Locate the snapshot `steps' snapshots before the newest one, clamped to
+   the oldest. Returns false if the ring is empty. */
+static bool rewind_locate(int steps, int *group, int *index)
+{
+    int g = group_newest;
+    int used = groups_used;
+    int i;
+
+    if (used == 0 || groups[g].count == 0) {
+        return false;
+    }
+
+    i = groups[g].count - 1;
+    while (steps > 0) {
+        if (i > 0) {
+            i--;
+        } else if (used > 1) {
+            used--;
+            g = (g + groups_num - 1) % groups_num;
+            i = groups[g].count - 1;
+        } else {
+            break;
+        }
+        steps--;
+    }
+
+    *group = g;
+    *index = i;
+    return true;
+}
+
+/* Restore the snapshot `steps' back and forget everything newer */
+static int rewind_restore(int steps)
+{
+    int g, i;
+
+    if (!rewind_locate(steps, &g, &i)) {
+        return -1;
+    }
+
+    /* drop the newer snapshots, the restored one becomes the newest */
+    while (group_newest != g) {
+        groups[group_newest].count = 0;
+        group_newest = (group_newest + groups_num - 1) % groups_num;
+        groups_used--;
+    }
+    groups[g].count = i + 1;
+
+    if (snapshot_memory_apply_delta(work, groups[g].keyframe, groups[g].delta[i]) < 0
+        || rewind_read_memory_snapshot(work) < 0) {
+        log_error(rewind_log, "Cannot restore the machine state, clearing the rewind buffer.");
+        groups_used = 0;
+        groups[group_newest].count = 0;
+        return -1;
+    }
+
+    frames_since_save = 0;
+    return 0;
+}
+
+static void rewind_save_trap(uint16_t addr, void *data)
+{
+    rewind_group_t *group;
+    int err;
+
+    if (groups == NULL) {
+        rewind_alloc();
+    }
+
+    snapshot_memory_redirect(work);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_redirect(NULL);
+
+    if (err < 0) {
+        log_error(rewind_log, "Cannot save the machine state, disabling rewind.");
+        resources_set_int("Rewind", 0);
+        return;
+    }
+
+    group = &groups[group_newest];
+    if (groups_used == 0 || group->count == REWIND_GROUP_SNAPSHOTS) {
+        /* start a new group, reusing the oldest one if the ring is full */
+        if (groups_used > 0) {
+            group_newest = (group_newest + 1) % groups_num;
+        }
+        if (groups_used < groups_num) {
+            groups_used++;
+        }
+        group = &groups[group_newest];
+        group->count = 0;
+        if (group->keyframe == NULL) {
+            group->keyframe = snapshot_memory_new();
+        }
+        snapshot_memory_keyframe(work, group->keyframe);
+    }
+
+    if (group->delta[group->count] == NULL) {
+        group->delta[group->count] = snapshot_memory_new();
+    }
+    snapshot_memory_delta(work, group->delta[group->count]);
+    group->count++;
+}
+
+static void rewind_restore_trap(uint16_t addr, void *data)
+{
+    int steps = pending_steps;
+
+    pending_steps = 0;
+    rewind_restore(steps);
+}
+
+/* Number of snapshots covering `frames' frames */
+static int frames_to_steps(int frames)
+{
+    if (frames <= 0) {
+        return 0;
+    }
+    return frames > rewind_interval ? frames / rewind_interval : 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Read a memory snapshot, keeping the state of the host input
+ *
+ * The keyboard matrix and joystick state are part of a snapshot, but when
+ * rewinding they reflect what the user is holding down right now, so these
+ * are kept as they are.
+ *
+ * \param[in]   mem     memory snapshot
+ *
+ * \return 0 on success, -1 on error
+ */
+int rewind_read_memory_snapshot(snapshot_memory_t *mem)
+{
+    int keys[KBD_ROWS];
+    int rev_keys[KBD_COLS];
+    uint16_t joy[JOYPORT_MAX_PORTS];
+    int err;
+
+    memcpy(keys, keyarr, sizeof(keys));
+    memcpy(rev_keys, rev_keyarr, sizeof(rev_keys));
+    joystick_get_state(joy);
+
+    snapshot_memory_redirect(mem);
+    err = machine_read_snapshot("", 0);
+    snapshot_memory_redirect(NULL);
+
+    memcpy(keyarr, keys, sizeof(keys));
+    memcpy(rev_keyarr, rev_keys, sizeof(rev_keys));
+    joystick_set_state(joy);
+
+    return err;
+}
+
+/** \brief  End of frame hook, called by vsync_do_vsync() for shown frames */
+void rewind_do_vsync(void)
+{
+    if (!rewind_possible()) {
+        pending_steps = 0;
+        return;
+    }
+
+    if (pending_steps > 0) {
+        interrupt_maincpu_trigger_trap(rewind_restore_trap, NULL);
+        return;
+    }
+
+    if (++frames_since_save >= rewind_interval) {
+        frames_since_save = 0;
+        interrupt_maincpu_trigger_trap(rewind_save_trap, NULL);
+    }
+}
+
+/** \brief  Step back at the end of the current frame
+ *
+ * \param[in]   frames  number of frames to go back
+ *
+ * \return 0 on success, -1 if there is nothing to go back to
+ */
+int rewind_step_back(int frames)
+{
+    if (!rewind_possible() || rewind_frames_available() == 0) {
+        return -1;
+    }
+
+    pending_steps += frames_to_steps(frames);
+    return 0;
+}
+
+/** \brief  Step back right away
+ *
+ * Only to be used when the CPU is at an instruction boundary, i.e. from the
+ * monitor.
+ *
+ * \param[in]   frames  number of frames to go back
+ *
+ * \return 0 on success, -1 if there is nothing to go back to
+ */
+int rewind_step_back_now(int frames)
+{
+    if (!rewind_possible()) {
+        return -1;
+    }
+
+    return rewind_restore(frames_to_steps(frames));
+}
+
+/** \brief  Get the number of frames that can be stepped back */
+int rewind_frames_available(void)
+{
+    int i, snapshots = 0;
+
+    for (i = 0; i < groups_used; i++) {
+        snapshots += groups[(group_newest + groups_num - i) % groups_num].count;
+    }
+
+    /* the newest snapshot is the current state */
+    return snapshots > 0 ? (snapshots - 1) * rewind_interval : 0;
+}
+
+/** \brief  Get the number of bytes held by the rewind buffer */
+size_t rewind_memory_used(void)
+{
+    rewind_group_t *group;
+    size_t size = 0;
+    int i, j;
+
+    for (i = 0; i < groups_used; i++) {
+        group = &groups[(group_newest + groups_num - i) % groups_num];
+        size += snapshot_memory_size(group->keyframe);
+        for (j = 0; j < group->count; j++) {
+            size += snapshot_memory_size(group->delta[j]);
+        }
+    }
+    if (work != NULL) {
+        size += snapshot_memory_size(work);
+    }
+    return size;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_rewind_enabled(int val, void *param)
+{
+    rewind_enabled = val ? 1 : 0;
+
+    if (!rewind_enabled) {
+        rewind_free();
+    }
+    return 0;
+}
+
+static int set_rewind_seconds(int val, void *param)
+{
+    if (val < 1 || val > REWIND_MAX_SECONDS) {
+        return -1;
+    }
+
+    rewind_seconds = val;
+    rewind_free();
+    return 0;
+}
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 1 || val > REWIND_MAX_INTERVAL) {
+        return -1;
+    }
+
+    rewind_interval = val;
+    rewind_free();
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "Rewind", 0, RES_EVENT_NO, NULL,
+      &rewind_enabled, set_rewind_enabled, NULL },
+    { "RewindSeconds", 30, RES_EVENT_NO, NULL,
+      &rewind_seconds, set_rewind_seconds, NULL },
+    { "RewindInterval", 1, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int rewind_resources_init(void)
+{
+    rewind_log = log_open("Rewind");
+
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-rewind", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Rewind", (resource_value_t)1,
+      NULL, "Record the machine state so the emulation can be rewound" },
+    { "+rewind", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Rewind", (resource_value_t)0,
+      NULL, "Do not record the machine state for rewinding (default)" },
+    { "-rewindseconds", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindSeconds", NULL,
+      "<seconds>", "Length of the rewind buffer (1-600)" },
+    { "-rewindinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindInterval", NULL,
+      "<frames>", "Number of frames between rewind snapshots (1-50)" },
+    CMDLINE_LIST_END
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void rewind_shutdown(void)
+{
+    rewind_free();
+}
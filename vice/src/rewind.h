@@ -0,0 +1,44 @@
+/*
+ * rewind.h - Rewind the emulation using a ring of in-memory snapshots.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_REWIND_H
+#define VICE_REWIND_H
+
+#include <stddef.h>
+
+#include "snapshot.h"
+
+int rewind_resources_init(void);
+int rewind_cmdline_options_init(void);
+void rewind_shutdown(void);
+
+void rewind_do_vsync(void);
+
+int rewind_step_back(int frames);
+int rewind_step_back_now(int frames);
+int rewind_frames_available(void);
+size_t rewind_memory_used(void);
+
+int rewind_read_memory_snapshot(snapshot_memory_t *mem);
+
+#endif
@@ -33,6 +33,12 @@
  *
  * I/O is done to a socket.  If the socket isnt connected, no data
  * is read and written data is discarded.
+ *
+ * Every connection has a thread of its own doing the socket I/O.  It
+ * receives into and sends from a ring buffer per direction, as much as the
+ * socket and the buffer allow at once, so the emulated interfaces only take
+ * bytes from and put bytes into memory.  Errors of the thread are reported
+ * by the next getc or putc of the emulation, which then closes the socket.
  */
 
 #undef DEBUG
@@ -43,6 +49,7 @@
 #ifdef HAVE_RS232NET
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -50,6 +57,7 @@
 #include <io.h>
 #endif
 
+#include "archdep.h"
 #include "lib.h"
 #include "log.h"
 #include "rs232.h"
@@ -87,6 +95,13 @@ int rs232net_cmdline_options_init(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* Sizes of the ring buffers, powers of two.  */
+#define RS232NET_RX_SIZE    0x4000
+#define RS232NET_TX_SIZE    0x4000
+
+/* Time the thread sleeps when there is nothing to do.  */
+#define RS232NET_IDLE_TICKS (TICK_PER_SECOND / 1000)
+
 typedef struct rs232net {
     int inuse; /*!< 0 if the connection has not been opened, 1 otherwise. */
     vice_network_socket_t * fd; /*!< the vice_network_socket_t for the connection.
@@ -98,6 +113,20 @@ typedef struct rs232net {
     int dcd_in;   /*!< ip232 status of DCD line */
     int ri_in;    /*!< ip232 status of RI line */
     int dtr_out;  /*!< ip232 status of DTR line */
+
+    pthread_t thread;           /*!< thread doing the socket I/O */
+    int thread_running;         /*!< 1 if the thread was started */
+    volatile int thread_stop;   /*!< tells the thread to stop */
+    int failed;                 /*!< 1 if the thread stopped because of an error */
+    int error;                  /*!< error code, 0 for EOF */
+    int failed_writing;         /*!< 1 if the error was on sending */
+
+    uint8_t rx_buf[RS232NET_RX_SIZE]; /*!< received bytes */
+    unsigned int rx_head;       /*!< written by the thread */
+    unsigned int rx_tail;       /*!< read by the emulation */
+    uint8_t tx_buf[RS232NET_TX_SIZE]; /*!< bytes to send */
+    unsigned int tx_head;       /*!< written by the emulation */
+    unsigned int tx_tail;       /*!< read by the thread */
 } rs232net_t;
 
 /* C99 standard guarantees all members of an object of static storage are
@@ -106,10 +135,98 @@ static rs232net_t fds[RS232_NUM_DEVICES];
 
 static log_t rs232net_log = LOG_DEFAULT;
 
+/* protects the buffer positions and the error fields */
+static pthread_mutex_t rs232net_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* ------------------------------------------------------------------------- */
+
+static void *rs232net_thread(void *arg)
+{
+    rs232net_t *conn = arg;
+    unsigned int head, tail;
+    size_t len;
+    ssize_t n;
+    int busy, stop;
+
+    do {
+        busy = 0;
+        stop = conn->thread_stop;
+
+        /* send what is queued, straight from the buffer; the emulation only
+           writes behind the head */
+        pthread_mutex_lock(&rs232net_lock);
+        head = conn->tx_head;
+        tail = conn->tx_tail;
+        pthread_mutex_unlock(&rs232net_lock);
+        len = head >= tail ? head - tail : RS232NET_TX_SIZE - tail;
+        if (len > 0) {
+            n = vice_network_send(conn->fd, conn->tx_buf + tail, len, 0);
+            if (n < 0) {
+                pthread_mutex_lock(&rs232net_lock);
+                conn->error = vice_network_get_errorcode();
+                conn->failed_writing = 1;
+                conn->failed = 1;
+                pthread_mutex_unlock(&rs232net_lock);
+                break;
+            }
+            pthread_mutex_lock(&rs232net_lock);
+            conn->tx_tail = (tail + (unsigned int)n) & (RS232NET_TX_SIZE - 1);
+            pthread_mutex_unlock(&rs232net_lock);
+            busy = 1;
+        }
+
+        /* receive into the free part of the buffer up to its end */
+        pthread_mutex_lock(&rs232net_lock);
+        head = conn->rx_head;
+        tail = conn->rx_tail;
+        pthread_mutex_unlock(&rs232net_lock);
+        if (head >= tail) {
+            len = RS232NET_RX_SIZE - head - (tail == 0 ? 1 : 0);
+        } else {
+            len = tail - head - 1;
+        }
+        if (len > 0 && vice_network_select_poll_one(conn->fd) > 0) {
+            n = vice_network_receive(conn->fd, conn->rx_buf + head, len, 0);
+            if (n <= 0) {
+                pthread_mutex_lock(&rs232net_lock);
+                conn->error = n < 0 ? vice_network_get_errorcode() : 0;
+                conn->failed_writing = 0;
+                conn->failed = 1;
+                pthread_mutex_unlock(&rs232net_lock);
+                break;
+            }
+            pthread_mutex_lock(&rs232net_lock);
+            conn->rx_head = (head + (unsigned int)n) & (RS232NET_RX_SIZE - 1);
+            pthread_mutex_unlock(&rs232net_lock);
+            busy = 1;
+        }
+
+        if (!busy) {
+            /* what is queued is sent before stopping */
+            if (stop) {
+                break;
+            }
+            tick_sleep(RS232NET_IDLE_TICKS);
+        }
+    } while (1);
+
+    return NULL;
+}
+
+static void rs232net_thread_join(rs232net_t *conn)
+{
+    if (conn->thread_running) {
+        conn->thread_stop = 1;
+        pthread_join(conn->thread, NULL);
+        conn->thread_running = 0;
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 
 void rs232net_close(int fd);
 static int _rs232net_putc(int fd, uint8_t b);
+static void rs232net_closesocket(int index);
 
 /* initializes all RS232 stuff */
 void rs232net_init(void)
@@ -168,6 +285,18 @@ int rs232net_open(int device)
         fds[i].inuse = 1;
         fds[i].useip232 = rs232_useip232[device];
 
+        fds[i].failed = 0;
+        fds[i].rx_head = fds[i].rx_tail = 0;
+        fds[i].tx_head = fds[i].tx_tail = 0;
+        fds[i].thread_stop = 0;
+        if (pthread_create(&fds[i].thread, NULL, rs232net_thread, &fds[i]) != 0) {
+            log_error(rs232net_log, "Cannot create the connection thread.");
+            rs232net_closesocket(i);
+            fds[i].inuse = 0;
+            break;
+        }
+        fds[i].thread_running = 1;
+
         index = i;
 
     } while (0);
@@ -181,6 +310,7 @@ int rs232net_open(int device)
 
 static void rs232net_closesocket(int index)
 {
+    rs232net_thread_join(&fds[index]);
     vice_network_socket_close(fds[index].fd);
     fds[index].fd = 0;
 }
@@ -212,10 +342,24 @@ void rs232net_close(int fd)
     } while (0);
 }
 
+/* Log the error the thread stopped with and close the socket.  */
+static void rs232net_failed(int fd)
+{
+    if (fds[fd].failed_writing) {
+        log_error(rs232net_log, "Error writing: %d.", fds[fd].error);
+    } else if (fds[fd].error != 0) {
+        log_error(rs232net_log, "Error reading: %d.", fds[fd].error);
+    } else {
+        log_error(rs232net_log, "EOF");
+    }
+    rs232net_closesocket(fd);
+}
+
 /* sends a byte to the RS232 line */
 static int _rs232net_putc(int fd, uint8_t b)
 {
-    ssize_t n;
+    unsigned int next;
+    int failed;
 
     if (fd < 0 || fd >= RS232_NUM_DEVICES) {
         log_error(rs232net_log, "Attempt to write to invalid fd %d.", fd);
@@ -234,20 +378,31 @@ static int _rs232net_putc(int fd, uint8_t b)
     /* for the beginning... */
     DEBUG_LOG_MESSAGE((rs232net_log, "Output 0x%02x '%c'.", b, isgraph((unsigned char)b) ? b : '.'));
 
-    n = vice_network_send(fds[fd].fd, &b, 1, 0);
-    if (n < 0) {
-        log_error(rs232net_log, "Error writing: %d.", vice_network_get_errorcode());
-        rs232net_closesocket(fd);
-        return -1;
-    }
+    /* like a blocking send, wait while the buffer is full */
+    next = (fds[fd].tx_head + 1) & (RS232NET_TX_SIZE - 1);
+    do {
+        pthread_mutex_lock(&rs232net_lock);
+        failed = fds[fd].failed;
+        if (!failed && next != fds[fd].tx_tail) {
+            fds[fd].tx_buf[fds[fd].tx_head] = b;
+            fds[fd].tx_head = next;
+            pthread_mutex_unlock(&rs232net_lock);
+            return 0;
+        }
+        pthread_mutex_unlock(&rs232net_lock);
+        if (!failed) {
+            tick_sleep(RS232NET_IDLE_TICKS);
+        }
+    } while (!failed);
 
-    return 0;
+    rs232net_failed(fd);
+    return -1;
 }
 
 /* gets a byte to the RS232 line, returns !=0 if byte received, byte in *b. */
 static int _rs232net_getc(int fd, uint8_t * b)
 {
-    int ret;
+    int failed = 0;
     ssize_t no_of_read_byte = -1;
 
     do {
@@ -270,23 +425,22 @@ static int _rs232net_getc(int fd, uint8_t * b)
             break;
         }
 
-        ret = vice_network_select_poll_one(fds[fd].fd);
-
-        if (ret > 0) {
+        pthread_mutex_lock(&rs232net_lock);
+        if (fds[fd].rx_tail != fds[fd].rx_head) {
+            *b = fds[fd].rx_buf[fds[fd].rx_tail];
+            fds[fd].rx_tail = (fds[fd].rx_tail + 1) & (RS232NET_RX_SIZE - 1);
+            no_of_read_byte = 1;
+        } else {
+            /* only report an error after what came before it */
+            failed = fds[fd].failed;
+        }
+        pthread_mutex_unlock(&rs232net_lock);
 
-            no_of_read_byte = vice_network_receive(fds[fd].fd, b, 1, 0);
+        if (no_of_read_byte == 1) {
             DEBUG_LOG_MESSAGE((rs232net_log, "Input 0x%02x '%c'.", *b, isgraph((unsigned char)*b) ? *b : '.'));
-
-            if ( no_of_read_byte != 1 ) {
-                if ( no_of_read_byte < 0 ) {
-                    log_error(rs232net_log, "Error reading: %d.",
-                            vice_network_get_errorcode());
-                } else {
-                    log_error(rs232net_log, "EOF");
-                }
-                rs232net_closesocket(fd);
-                no_of_read_byte = -1;
-            }
+        } else if (failed) {
+            rs232net_failed(fd);
+            no_of_read_byte = -1;
         }
     } while (0);
 
@@ -138,10 +138,25 @@ static unsigned int sound_samples_per_frame;
 
 static int current_channels = 0;
 
+/* Only the start of the file is loaded to parse the headers, the sample data
+   is read and converted a block at a time.  */
+#define FILE_HEAD_SIZE      (1024 * 1024)
+
+/* Room needed after the start of a header chunk to parse it.  */
+#define FILE_CHUNK_MARGIN   1024
+
+/* Frames converted at once.  */
+#define CONVERT_FRAMES      65536
+
+static FILE *sample_file = NULL;
 static uint8_t *file_buffer = NULL;
+static unsigned int file_buffer_size = 0;   /* bytes of the file in file_buffer */
 static unsigned int file_pointer = 0;
 static unsigned int file_size = 0;
 
+static uint8_t *data_buffer = NULL;
+static unsigned int data_buffer_size = 0;
+
 static int sound_audio_type = 0;
 static unsigned int sound_audio_channels = 0;
 static unsigned int sound_audio_rate = 0;
@@ -154,6 +169,8 @@ static int wav_fmt_extension_bytes = 0;
 static uint8_t *sample_buffer1 = NULL;
 static uint8_t *sample_buffer2 = NULL;
 
+static void file_free_sample(void);
+
 static int16_t decode_ulaw(uint8_t sample)
 {
     int16_t t;
@@ -189,43 +206,70 @@ static int16_t decode_alaw(uint8_t sample)
     return ((sample & 0x80) ? t : -t);
 }
 
-static int convert_alaw_buffer(int size, int channels)
+/* Load the rest of the file, for the formats that are not parsed from the
+   start of the file only.  */
+static int file_buffer_load_all(void)
 {
-    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
-    unsigned int i;
-    signed char sample;
+    size_t len;
 
-    sample_size = size / frame_size;
+    if (file_buffer_size >= file_size || sample_file == NULL) {
+        return 0;
+    }
 
-    sample_buffer1 = lib_malloc(sample_size);
-    if (channels == SAMPLER_OPEN_STEREO) {
-        if (sound_audio_channels == 2) {
-            sample_buffer2 = lib_malloc(sample_size);
-        } else {
-            sample_buffer2 = sample_buffer1;
-        }
+    file_buffer = lib_realloc(file_buffer, file_size);
+    len = file_size - file_buffer_size;
+    if (fseek(sample_file, (long)file_buffer_size, SEEK_SET) != 0
+        || fread(file_buffer + file_buffer_size, 1, len, sample_file) != len) {
+        log_warning(filedrv_log, "Unexpected end of data in '%s'.", sample_name);
     }
+    file_buffer_size = file_size;
 
-    for (i = 0; i < sample_size; ++i) {
-        sample = file_buffer[file_pointer + (i * frame_size)];
-        sample_buffer1[i] = (uint8_t)(decode_alaw(sample) >> 8) + 0x80;
-        if (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO) {
-            sample = file_buffer[file_pointer + (i * frame_size) + 1];
-            sample_buffer2[i] = (uint8_t)(decode_alaw(sample) >> 4) + 0x80;
-        }
+    return 0;
+}
+
+/* Make sure the header chunk at `offset' was loaded.  */
+static void file_buffer_need(unsigned int offset)
+{
+    if (offset + FILE_CHUNK_MARGIN > file_buffer_size) {
+        file_buffer_load_all();
     }
+}
+
+static void file_buffer_free(void)
+{
     lib_free(file_buffer);
     file_buffer = NULL;
-    return 0;
+    file_buffer_size = 0;
+    lib_free(data_buffer);
+    data_buffer = NULL;
+    data_buffer_size = 0;
 }
 
-static int convert_ulaw_buffer(int size, int channels)
+/* Get `len' bytes of sample data at `offset', from the loaded part of the
+   file or else read from the file.  */
+static const uint8_t *sample_data_get(unsigned int offset, unsigned int len)
 {
-    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
-    unsigned int i;
-    signed char sample;
+    if (offset + len <= file_buffer_size) {
+        return file_buffer + offset;
+    }
 
-    sample_size = size / frame_size;
+    if (sample_file == NULL) {
+        return NULL;
+    }
+    if (len > data_buffer_size) {
+        data_buffer = lib_realloc(data_buffer, len);
+        data_buffer_size = len;
+    }
+    if (fseek(sample_file, (long)offset, SEEK_SET) != 0
+        || fread(data_buffer, 1, len, sample_file) != len) {
+        return NULL;
+    }
+    return data_buffer;
+}
+
+static void sample_buffers_alloc(unsigned int frames, int channels)
+{
+    sample_size = frames;
 
     sample_buffer1 = lib_malloc(sample_size);
     if (channels == SAMPLER_OPEN_STEREO) {
@@ -235,195 +279,194 @@ static int convert_ulaw_buffer(int size, int channels)
             sample_buffer2 = sample_buffer1;
         }
     }
+}
+
+/* Convert `frames' frames at `data' to the samples from `pos' on.  */
+typedef void (*convert_frames_func_t)(const uint8_t *data, unsigned int pos,
+                                      unsigned int frames, int stereo);
 
-    for (i = 0; i < sample_size; ++i) {
-        sample = file_buffer[file_pointer + (i * frame_size)];
-        sample_buffer1[i] = (uint8_t)(decode_ulaw(sample) >> 8) + 0x80;
-        if (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO) {
-            sample = file_buffer[file_pointer + (i * frame_size) + 1];
-            sample_buffer2[i] = (uint8_t)(decode_ulaw(sample) >> 3) + 0x80;
+static void convert_alaw_frames(const uint8_t *data, unsigned int pos,
+                                unsigned int frames, int stereo)
+{
+    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
+    unsigned int i;
+
+    for (i = 0; i < frames; ++i) {
+        sample_buffer1[pos + i] = (uint8_t)(decode_alaw(data[i * frame_size]) >> 8) + 0x80;
+        if (stereo) {
+            sample_buffer2[pos + i] = (uint8_t)(decode_alaw(data[(i * frame_size) + 1]) >> 4) + 0x80;
         }
     }
-    lib_free(file_buffer);
-    file_buffer = NULL;
-    return 0;
 }
 
-static int convert_pcm_buffer(int size, int channels)
+static void convert_ulaw_frames(const uint8_t *data, unsigned int pos,
+                                unsigned int frames, int stereo)
 {
     unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
     unsigned int i;
 
-    sample_size = size / frame_size;
-
-    sample_buffer1 = lib_malloc(sample_size);
-    if (channels == SAMPLER_OPEN_STEREO) {
-        if (sound_audio_channels == 2) {
-            sample_buffer2 = lib_malloc(sample_size);
-        } else {
-            sample_buffer2 = sample_buffer1;
+    for (i = 0; i < frames; ++i) {
+        sample_buffer1[pos + i] = (uint8_t)(decode_ulaw(data[i * frame_size]) >> 8) + 0x80;
+        if (stereo) {
+            sample_buffer2[pos + i] = (uint8_t)(decode_ulaw(data[(i * frame_size) + 1]) >> 3) + 0x80;
         }
     }
+}
 
-    for (i = 0; i < sample_size; ++i) {
-        if (sound_audio_type == AUDIO_TYPE_PCM_BE) {
-            sample_buffer1[i] = file_buffer[file_pointer + (i * frame_size)];
-        } else {
-            sample_buffer1[i] = file_buffer[file_pointer + (i * frame_size) + (sound_audio_bits / 8) - 1];
-        }
-        if (sound_audio_bits != 8 || sound_audio_type == AUDIO_TYPE_PCM_AMIGA || sound_audio_type == AUDIO_TYPE_PCM_BE) {
-            sample_buffer1[i] += 0x80;
-        }
-        if (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO) {
-            if (sound_audio_type == AUDIO_TYPE_PCM_BE) {
-                sample_buffer2[i] = file_buffer[file_pointer + (i * frame_size) + (frame_size / 2)];
-            } else {
-                sample_buffer2[i] = file_buffer[file_pointer + (i * frame_size) + (frame_size / 2) + (sound_audio_bits / 8) - 1];
-            }
-            if (sound_audio_bits != 8 || sound_audio_type == AUDIO_TYPE_PCM_AMIGA || sound_audio_type == AUDIO_TYPE_PCM_BE) {
-                sample_buffer2[i] += 0x80;
-            }
+/* Only the most significant byte of a sample is used.  */
+static void convert_pcm_frames(const uint8_t *data, unsigned int pos,
+                               unsigned int frames, int stereo)
+{
+    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
+    unsigned int msb = 0;
+    uint8_t sign = 0;
+    unsigned int i;
+
+    if (sound_audio_type != AUDIO_TYPE_PCM_BE) {
+        msb = (sound_audio_bits / 8) - 1;
+    }
+    if (sound_audio_bits != 8 || sound_audio_type == AUDIO_TYPE_PCM_AMIGA || sound_audio_type == AUDIO_TYPE_PCM_BE) {
+        sign = 0x80;
+    }
+
+    /* one simple loop per channel, which the compiler can vectorize */
+    data += msb;
+    for (i = 0; i < frames; ++i) {
+        sample_buffer1[pos + i] = (uint8_t)(data[i * frame_size] + sign);
+    }
+    if (stereo) {
+        data += frame_size / 2;
+        for (i = 0; i < frames; ++i) {
+            sample_buffer2[pos + i] = (uint8_t)(data[i * frame_size] + sign);
         }
     }
-    lib_free(file_buffer);
-    file_buffer = NULL;
-    return 0;
 }
 
 /* FIXME: endianess */
-static int convert_float_buffer(int size, int channels)
+static uint8_t convert_float_sample(const uint8_t *data)
 {
-    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
-    unsigned int i;
     unsigned char c[sizeof(float)];
     float f;
     int32_t sample;
 
-    sample_size = size / frame_size;
-
-    sample_buffer1 = lib_malloc(sample_size);
-    if (channels == SAMPLER_OPEN_STEREO) {
-        if (sound_audio_channels == 2) {
-            sample_buffer2 = lib_malloc(sample_size);
-        } else {
-            sample_buffer2 = sample_buffer1;
-        }
+    if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
+        c[3] = data[0];
+        c[2] = data[1];
+        c[1] = data[2];
+        c[0] = data[3];
+    } else {
+        memcpy(c, data, sizeof(float));
     }
+    memcpy(&f, c, sizeof(float));
+    f *= (float)0x7fffffff;
+    sample = (int32_t)f;
+    return (uint8_t)((sample >> 24) + 0x80);
+}
 
-    for (i = 0; i < sample_size; ++i) {
-        if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
-            c[3] = file_buffer[file_pointer + (i * frame_size)];
-            c[2] = file_buffer[file_pointer + (i * frame_size) + 1];
-            c[1] = file_buffer[file_pointer + (i * frame_size) + 2];
-            c[0] = file_buffer[file_pointer + (i * frame_size) + 3];
-        } else {
-            c[0] = file_buffer[file_pointer + (i * frame_size)];
-            c[1] = file_buffer[file_pointer + (i * frame_size) + 1];
-            c[2] = file_buffer[file_pointer + (i * frame_size) + 2];
-            c[3] = file_buffer[file_pointer + (i * frame_size) + 3];
-        }
-        memcpy(&f, c, sizeof(float));
-        f *= (float)0x7fffffff;
-        sample = (int32_t)f;
-        sample_buffer1[i] = (uint8_t)((sample >> 24) + 0x80);
-        if (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO) {
-            if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
-                c[3] = file_buffer[file_pointer + (i * frame_size) + 4];
-                c[2] = file_buffer[file_pointer + (i * frame_size) + 5];
-                c[1] = file_buffer[file_pointer + (i * frame_size) + 6];
-                c[0] = file_buffer[file_pointer + (i * frame_size) + 7];
-            } else {
-                c[0] = file_buffer[file_pointer + (i * frame_size) + 4];
-                c[1] = file_buffer[file_pointer + (i * frame_size) + 5];
-                c[2] = file_buffer[file_pointer + (i * frame_size) + 6];
-                c[3] = file_buffer[file_pointer + (i * frame_size) + 7];
-            }
-            memcpy(&f, c, sizeof(float));
-            f *= (float)0x7fffffff;
-            sample = (int32_t)f;
-            sample_buffer2[i] = (uint8_t)((sample >> 24) + 0x80);
+static void convert_float_frames(const uint8_t *data, unsigned int pos,
+                                 unsigned int frames, int stereo)
+{
+    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
+    unsigned int i;
+
+    for (i = 0; i < frames; ++i) {
+        sample_buffer1[pos + i] = convert_float_sample(data + (i * frame_size));
+        if (stereo) {
+            sample_buffer2[pos + i] = convert_float_sample(data + (i * frame_size) + 4);
         }
     }
-    lib_free(file_buffer);
-    file_buffer = NULL;
-    return 0;
 }
 
 /* FIXME: endianess */
-static int convert_double_buffer(int size, int channels)
+static uint8_t convert_double_sample(const uint8_t *data)
 {
-    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
-    unsigned int i;
     unsigned char c[sizeof(double)];
     double f;
     int32_t sample;
+    int i;
 
-    sample_size = size / frame_size;
+    if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
+        for (i = 0; i < 8; i++) {
+            c[7 - i] = data[i];
+        }
+    } else {
+        memcpy(c, data, sizeof(double));
+    }
+    memcpy(&f, c, sizeof(double));
+    f *= 0x7fffffff;
+    sample = (int32_t)f;
+    return (uint8_t)((sample >> 24) + 0x80);
+}
 
-    sample_buffer1 = lib_malloc(sample_size);
-    if (channels == SAMPLER_OPEN_STEREO) {
-        if (sound_audio_channels == 2) {
-            sample_buffer2 = lib_malloc(sample_size);
-        } else {
-            sample_buffer2 = sample_buffer1;
+static void convert_double_frames(const uint8_t *data, unsigned int pos,
+                                  unsigned int frames, int stereo)
+{
+    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
+    unsigned int i;
+
+    for (i = 0; i < frames; ++i) {
+        sample_buffer1[pos + i] = convert_double_sample(data + (i * frame_size));
+        if (stereo) {
+            sample_buffer2[pos + i] = convert_double_sample(data + (i * frame_size) + 8);
         }
     }
+}
 
-    for (i = 0; i < sample_size; ++i) {
-        if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
-            c[7] = file_buffer[file_pointer + (i * frame_size)];
-            c[6] = file_buffer[file_pointer + (i * frame_size) + 1];
-            c[5] = file_buffer[file_pointer + (i * frame_size) + 2];
-            c[4] = file_buffer[file_pointer + (i * frame_size) + 3];
-            c[3] = file_buffer[file_pointer + (i * frame_size) + 4];
-            c[2] = file_buffer[file_pointer + (i * frame_size) + 5];
-            c[1] = file_buffer[file_pointer + (i * frame_size) + 6];
-            c[0] = file_buffer[file_pointer + (i * frame_size) + 7];
-        } else {
-            c[0] = file_buffer[file_pointer + (i * frame_size)];
-            c[1] = file_buffer[file_pointer + (i * frame_size) + 1];
-            c[2] = file_buffer[file_pointer + (i * frame_size) + 2];
-            c[3] = file_buffer[file_pointer + (i * frame_size) + 3];
-            c[4] = file_buffer[file_pointer + (i * frame_size) + 4];
-            c[5] = file_buffer[file_pointer + (i * frame_size) + 5];
-            c[6] = file_buffer[file_pointer + (i * frame_size) + 6];
-            c[7] = file_buffer[file_pointer + (i * frame_size) + 7];
+/* Convert the `size' bytes of sample data at file_pointer, a block at a
+   time.  */
+static int convert_buffer(int size, int channels, convert_frames_func_t convert)
+{
+    unsigned int frame_size = sound_audio_bits * sound_audio_channels / 8;
+    int stereo = (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO);
+    unsigned int pos, frames;
+    const uint8_t *data;
+
+    sample_buffers_alloc(size / frame_size, channels);
+
+    for (pos = 0; pos < sample_size; pos += frames) {
+        frames = sample_size - pos;
+        if (frames > CONVERT_FRAMES) {
+            frames = CONVERT_FRAMES;
         }
-        memcpy(&f, c, sizeof(double));
-        f *= 0x7fffffff;
-        sample = (int32_t)f;
-        sample_buffer1[i] = (uint8_t)((sample >> 24) + 0x80);
-        if (sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO) {
-            if (sound_audio_type == AUDIO_TYPE_FLOAT_BE) {
-                c[7] = file_buffer[file_pointer + (i * frame_size) + 8];
-                c[6] = file_buffer[file_pointer + (i * frame_size) + 9];
-                c[5] = file_buffer[file_pointer + (i * frame_size) + 10];
-                c[4] = file_buffer[file_pointer + (i * frame_size) + 11];
-                c[3] = file_buffer[file_pointer + (i * frame_size) + 12];
-                c[2] = file_buffer[file_pointer + (i * frame_size) + 13];
-                c[1] = file_buffer[file_pointer + (i * frame_size) + 14];
-                c[0] = file_buffer[file_pointer + (i * frame_size) + 15];
-            } else {
-                c[0] = file_buffer[file_pointer + (i * frame_size) + 8];
-                c[1] = file_buffer[file_pointer + (i * frame_size) + 9];
-                c[2] = file_buffer[file_pointer + (i * frame_size) + 10];
-                c[3] = file_buffer[file_pointer + (i * frame_size) + 11];
-                c[4] = file_buffer[file_pointer + (i * frame_size) + 12];
-                c[5] = file_buffer[file_pointer + (i * frame_size) + 13];
-                c[6] = file_buffer[file_pointer + (i * frame_size) + 14];
-                c[7] = file_buffer[file_pointer + (i * frame_size) + 15];
-            }
-            memcpy(&f, c, sizeof(double));
-            f *= 0x7fffffff;
-            sample = (int32_t)f;
-            sample_buffer2[i] = (uint8_t)((sample >> 24) + 0x80);
+        data = sample_data_get(file_pointer + (pos * frame_size), frames * frame_size);
+        if (data == NULL) {
+            log_error(filedrv_log, "Cannot read the sample data of '%s'.", sample_name);
+            file_buffer_free();
+            file_free_sample();
+            return -1;
         }
+        convert(data, pos, frames, stereo);
     }
-    lib_free(file_buffer);
-    file_buffer = NULL;
+
+    file_buffer_free();
     return 0;
 }
 
+static int convert_alaw_buffer(int size, int channels)
+{
+    return convert_buffer(size, channels, convert_alaw_frames);
+}
+
+static int convert_ulaw_buffer(int size, int channels)
+{
+    return convert_buffer(size, channels, convert_ulaw_frames);
+}
+
+static int convert_pcm_buffer(int size, int channels)
+{
+    return convert_buffer(size, channels, convert_pcm_frames);
+}
+
+static int convert_float_buffer(int size, int channels)
+{
+    return convert_buffer(size, channels, convert_float_frames);
+}
+
+static int convert_double_buffer(int size, int channels)
+{
+    return convert_buffer(size, channels, convert_double_frames);
+}
+
 /* ---------------------------------------------------------------------- */
 
 static void check_and_skip_chunk(void)
@@ -459,6 +502,7 @@ static void check_and_skip_chunk(void)
         file_pointer += 4;
         size = (file_buffer[file_pointer + 3] << 24) | (file_buffer[file_pointer + 2] << 16) | (file_buffer[file_pointer + 1] << 8) | file_buffer[file_pointer];
         file_pointer += size + 4;
+        file_buffer_need(file_pointer);
     }
 }
 
@@ -1010,6 +1054,9 @@ static int handle_voc_file(int channels)
     sound_audio_bits = 0;
     sound_audio_type = AUDIO_TYPE_UNKNOWN;
 
+    /* the sound data is spread over the blocks of the file */
+    file_buffer_load_all();
+
     if (file_buffer[19] != 0x1A) {
         log_error(filedrv_log, "Voc file $1A signature not found");
         return -1;
@@ -1075,13 +1122,12 @@ static int handle_voc_file(int channels)
     }
 
     lib_free(file_buffer);
-    file_buffer = NULL;
-
     file_buffer = voc_buffer1;
     voc_buffer1 = NULL;
 
     file_pointer = 0;
     file_size = voc_buffer_size;
+    file_buffer_size = voc_buffer_size;
 
     switch (sound_audio_type) {
         case AUDIO_TYPE_PCM:
@@ -1222,6 +1268,7 @@ static int handle_iff_file(int channels)
             log_error(filedrv_log, "Iff file too small");
             return -1;
         }
+        file_buffer_need(file_pointer);
 
         header = (file_buffer[file_pointer] << 24) | (file_buffer[file_pointer + 1] << 16) | (file_buffer[file_pointer + 2] << 8) | file_buffer[file_pointer + 3];
 
@@ -1416,6 +1463,7 @@ static int handle_aiff_file(int channels)
             log_error(filedrv_log, "Aiff file too small");
             return -1;
         }
+        file_buffer_need(file_pointer);
 
         header = (file_buffer[file_pointer] << 24) | (file_buffer[file_pointer + 1] << 16) | (file_buffer[file_pointer + 2] << 8) | file_buffer[file_pointer + 3];
 
@@ -1626,6 +1674,7 @@ static int handle_aifc_file(int channels)
             log_error(filedrv_log, "Aifc file too small");
             return -1;
         }
+        file_buffer_need(file_pointer);
 
         header = (file_buffer[file_pointer] << 24) | (file_buffer[file_pointer + 1] << 16) | (file_buffer[file_pointer + 2] << 8) | file_buffer[file_pointer + 3];
 
@@ -1694,6 +1743,8 @@ static int handle_mp3_file(int channels)
     long mp3_rate = 0;
     off_t buffer_size = 0;
     size_t done = 0;
+    unsigned int frame_size, frames, pos;
+    unsigned char *data;
 
     mp3_err = mpg123_getformat(mh, &mp3_rate, &mp3_channels, &mp3_encoding);
     if (mp3_err != MPG123_OK) {
@@ -1720,24 +1771,48 @@ static int handle_mp3_file(int channels)
     mpg123_scan(mh);
     buffer_size = mpg123_length(mh);
 
-    lib_free(file_buffer);
-    file_size = (unsigned int)(buffer_size * 2 * mp3_channels);
-    file_buffer = lib_malloc(file_size);
+    sound_audio_type = AUDIO_TYPE_PCM;
+    sound_audio_channels = mp3_channels;
+    sound_audio_rate = (unsigned int)mp3_rate;
+    sound_audio_bits = 16;
 
-    mp3_err = mpg123_read(mh, file_buffer, file_size, &done);
+    /* decode and convert a block at a time */
+    file_buffer_free();
+    frame_size = 2 * (unsigned int)mp3_channels;
+    data = lib_malloc(CONVERT_FRAMES * frame_size);
+    sample_buffers_alloc((unsigned int)buffer_size, channels);
+
+    pos = 0;
+    while (pos < sample_size) {
+        frames = sample_size - pos;
+        if (frames > CONVERT_FRAMES) {
+            frames = CONVERT_FRAMES;
+        }
+        mp3_err = mpg123_read(mh, data, frames * frame_size, &done);
+        frames = (unsigned int)(done / frame_size);
+        if (frames == 0) {
+            break;
+        }
+        convert_pcm_frames(data, pos, frames, sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO);
+        pos += frames;
+        if (mp3_err != MPG123_OK) {
+            break;
+        }
+    }
 
+    lib_free(data);
     mpg123_close(mh);
     mpg123_delete(mh);
     mpg123_exit();
 
-    file_pointer = 0;
-
-    sound_audio_type = AUDIO_TYPE_PCM;
-    sound_audio_channels = mp3_channels;
-    sound_audio_rate = (unsigned int)mp3_rate;
-    sound_audio_bits = 16;
+    if (pos == 0) {
+        file_free_sample();
+        log_error(filedrv_log, "Cannot decode mp3 file");
+        return -1;
+    }
+    sample_size = pos;
 
-    return convert_pcm_buffer(file_size, channels);
+    return 0;
 }
 
 static int is_mp3_file(void)
@@ -1906,6 +1981,7 @@ static int handle_flac_file(int channels)
     file_buffer = flac_buffer;
     flac_buffer = NULL;
     file_size = flac_total_size;
+    file_buffer_size = flac_total_size;
     file_pointer = 0;
     sound_audio_type = AUDIO_TYPE_PCM;
     sound_audio_channels = flac_channels;
@@ -1936,6 +2012,7 @@ static int handle_vorbis_file(int channels)
     int i;
     ogg_int64_t pcmlength;
     uint8_t *vorbis_buffer;
+    unsigned int frame_size, frames, pos, len;
     int dummy;
     int error;
     vorbis_info *vi;
@@ -1966,34 +2043,55 @@ static int handle_vorbis_file(int channels)
     }
 
     pcmlength = ov_pcm_total(&ov, -1);
-    vorbis_buffer = lib_malloc(pcmlength * sound_audio_channels * 2);
-    i = 0;
-    while (i < pcmlength * sound_audio_channels * 2) {
-        int ret = (int)ov_read(&ov, (char*)vorbis_buffer + i,
-                               (int)((pcmlength * 2 * sound_audio_channels) - i),
-                               0, 2, 1, &dummy);
+
+    /* decode and convert a block at a time, a frame is only converted once
+       all of its samples were read */
+    file_buffer_free();
+    frame_size = 2 * sound_audio_channels;
+    vorbis_buffer = lib_malloc(CONVERT_FRAMES * frame_size);
+    sample_buffers_alloc((unsigned int)pcmlength, channels);
+
+    pos = 0;
+    len = 0;
+    while (pos < sample_size) {
+        int ret;
+
+        frames = sample_size - pos;
+        if (frames > CONVERT_FRAMES) {
+            frames = CONVERT_FRAMES;
+        }
+        ret = (int)ov_read(&ov, (char*)vorbis_buffer + len,
+                           (int)(frames * frame_size - len),
+                           0, 2, 1, &dummy);
         if (ret < 0) {
             ov_clear(&ov);
             lib_free(vorbis_buffer);
-            vorbis_buffer = NULL;
+            file_free_sample();
             log_error(filedrv_log, "Error reading ogg/vorbis stream");
             return -1;
         }
-        if (ret) {
-            i += ret;
-        } else {
-            pcmlength = i / (2 * sound_audio_channels);
+        if (ret == 0) {
+            break;
         }
+        len += (unsigned int)ret;
+        frames = len / frame_size;
+        convert_pcm_frames(vorbis_buffer, pos, frames, sound_audio_channels == 2 && channels == SAMPLER_OPEN_STEREO);
+        pos += frames;
+        len -= frames * frame_size;
+        memmove(vorbis_buffer, vorbis_buffer + frames * frame_size, len);
     }
 
     ov_clear(&ov);
+    lib_free(vorbis_buffer);
 
-    lib_free(file_buffer);
-    file_buffer = vorbis_buffer;
-    file_size = (unsigned int)(pcmlength * 2 * sound_audio_channels);
-    file_pointer = 0;
+    if (pos == 0) {
+        file_free_sample();
+        log_error(filedrv_log, "Error reading ogg/vorbis stream");
+        return -1;
+    }
+    sample_size = pos;
 
-    return convert_pcm_buffer(file_size, channels);
+    return 0;
 }
 
 static int is_vorbis_file(void)
@@ -2094,7 +2192,6 @@ static int handle_file_type(int channels)
 
 static void file_load_sample(int channels)
 {
-    FILE *sample_file = NULL;
     int err = 0;
 
     current_channels = channels;
@@ -2105,12 +2202,14 @@ static void file_load_sample(int channels)
             fseek(sample_file, 0, SEEK_END);
             file_size = (unsigned int)ftell(sample_file);
             fseek(sample_file, 0, SEEK_SET);
-            file_buffer = lib_malloc(file_size);
-            if (fread(file_buffer, 1, file_size, sample_file) != file_size) {
+            file_buffer_size = file_size < FILE_HEAD_SIZE ? file_size : FILE_HEAD_SIZE;
+            file_buffer = lib_malloc(file_buffer_size);
+            if (fread(file_buffer, 1, file_buffer_size, sample_file) != file_buffer_size) {
                 log_warning(filedrv_log, "Unexpected end of data in '%s'.", sample_name);
             }
-            fclose(sample_file);
             err = handle_file_type(channels);
+            fclose(sample_file);
+            sample_file = NULL;
             if (!err) {
                 sound_sampling_started = 0;
                 sound_cycles_per_frame = (unsigned int)machine_get_cycles_per_frame();
@@ -2118,8 +2217,7 @@ static void file_load_sample(int channels)
                 sound_samples_per_frame = sound_audio_rate / sound_frames_per_sec;
                 log_message(filedrv_log, "using %s as the sampler file", sample_name);
             } else {
-                lib_free(file_buffer);
-                file_buffer = NULL;
+                file_buffer_free();
                 log_error(filedrv_log, "Unknown file type for '%s'.", sample_name);
             }
         } else {
@@ -68,7 +68,6 @@ uint8_t scpu64_fastmode = 1;
 static CLOCK buffer_finish, buffer_finish_half;
 static CLOCK maincpu_diff, maincpu_accu;
 int scpu64_emulation_mode;
-alarm_context_t *maincpu_alarm_context = NULL;
 
 /* Mask: BA low */
 int maincpu_ba_low_flags = 0;
@@ -334,29 +333,40 @@ void scpu64_clock_read_ioram(void) /* scpu64 v1 $d200-$d3ff one extra 20 Mhz cyc
 /* SCPU64 needs external reg_pc */
 #define NEED_REG_PC
 
-#define STORE(addr, value) \
-    do { \
-        uint32_t tmpx1 = (addr); \
-        uint8_t tmpx2 = (value); \
-        if (tmpx1 & ~0xffff) { \
-            mem_store2(tmpx1, tmpx2); \
-        } else { \
-            (*_mem_write_tab_ptr[tmpx1 >> 8])((uint16_t)tmpx1, tmpx2); \
-        } \
-    } while (0)
-
-#define LOAD(addr) \
-    (((addr) & ~0xffff)?mem_read2(addr):(*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr)))
-
-#define STORE_LONG(addr, value) store_long((uint32_t)(addr), (uint8_t)(value))
-
-static inline void store_long(uint32_t addr, uint8_t value)
+/* In fast mode `ram_read()' and `ram_store()' do not check BA, so accesses
+   to plain SRAM pages are done directly.  All others (I/O, ROM, mirrored
+   pages, 1MHz mode, watchpoints) call the read or store function.  */
+static inline void scpu64cpu_store(uint32_t addr, uint8_t value)
 {
     if (addr & ~0xffff) {
         mem_store2(addr, value);
+    } else if (scpu64_fastmode && _mem_write_ram_tab_ptr[addr >> 8]) {
+        mem_sram[addr] = value;
     } else {
         (*_mem_write_tab_ptr[addr >> 8])((uint16_t)addr, value);
     }
+}
+
+static inline uint8_t scpu64cpu_load(uint32_t addr)
+{
+    if (addr & ~0xffff) {
+        return mem_read2(addr);
+    }
+    if (scpu64_fastmode && _mem_read_ram_tab_ptr[addr >> 8]) {
+        return mem_sram[addr];
+    }
+    return (*_mem_read_tab_ptr[addr >> 8])((uint16_t)addr);
+}
+
+#define STORE(addr, value) scpu64cpu_store((uint32_t)(addr), (uint8_t)(value))
+
+#define LOAD(addr) scpu64cpu_load((uint32_t)(addr))
+
+#define STORE_LONG(addr, value) store_long((uint32_t)(addr), (uint8_t)(value))
+
+static inline void store_long(uint32_t addr, uint8_t value)
+{
+    scpu64cpu_store(addr, value);
     scpu64_clock_inc(1);
 }
 
@@ -366,11 +376,7 @@ static inline uint8_t load_long(uint32_t addr)
 {
     uint8_t tmp;
 
-    if ((addr) & ~0xffff) {
-        tmp = mem_read2(addr);
-    } else {
-        tmp = (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)addr);
-    }
+    tmp = scpu64cpu_load(addr);
     scpu64_clock_inc(0);
     return tmp;
 }
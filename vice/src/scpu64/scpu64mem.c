@@ -112,15 +112,29 @@ store_func_ptr_t *_mem_write_tab_ptr;
 static uint8_t **_mem_read_base_tab_ptr;
 static uint32_t *mem_read_limit_tab_ptr;
 
+/* Pointers to the currently used direct read and write tables.  */
+uint8_t *_mem_read_ram_tab_ptr;
+uint8_t *_mem_write_ram_tab_ptr;
+
 /* Memory read and write tables.  */
 static store_func_ptr_t mem_write_tab[NUM_MIRRORS][NUM_CONFIGS][0x101];
 static read_func_ptr_t mem_read_tab[NUM_CONFIGS][0x101];
 static uint8_t *mem_read_base_tab[NUM_CONFIGS][0x101];
 static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
 
+/* Nonzero for pages whose read function is `ram_read()' or whose store
+   function is `ram_store()' in the given mirror config.  In fast mode these
+   do nothing but access `mem_sram', so the CPU does that directly.  */
+static uint8_t mem_read_ram_tab[NUM_CONFIGS][0x101];
+static uint8_t mem_write_ram_tab[NUM_MIRRORS][NUM_CONFIGS][0x101];
+
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
 
+/* All loads and stores go through the watchpoint functions.  */
+static uint8_t mem_read_ram_tab_watch[0x101];
+static uint8_t mem_write_ram_tab_watch[0x101];
+
 /* Current mirror config */
 static int mirror;
 
@@ -193,9 +207,13 @@ void mem_toggle_watchpoints(int flag, void *context)
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_ram_tab_ptr = mem_read_ram_tab_watch;
+        _mem_write_ram_tab_ptr = mem_write_ram_tab_watch;
     } else {
         _mem_read_tab_ptr = mem_read_tab[mem_config];
         _mem_write_tab_ptr = mem_write_tab[mirror][mem_config];
+        _mem_read_ram_tab_ptr = mem_read_ram_tab[mem_config];
+        _mem_write_ram_tab_ptr = mem_write_ram_tab[mirror][mem_config];
     }
     watchpoints_active = flag;
 }
@@ -216,9 +234,13 @@ void mem_pla_config_changed(void)
     if (watchpoints_active) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_ram_tab_ptr = mem_read_ram_tab_watch;
+        _mem_write_ram_tab_ptr = mem_write_ram_tab_watch;
     } else {
         _mem_read_tab_ptr = mem_read_tab[mem_config];
         _mem_write_tab_ptr = mem_write_tab[mirror][mem_config];
+        _mem_read_ram_tab_ptr = mem_read_ram_tab[mem_config];
+        _mem_write_ram_tab_ptr = mem_write_ram_tab[mirror][mem_config];
     }
 
     _mem_read_base_tab_ptr = mem_read_base_tab[mem_config];
@@ -1266,18 +1288,45 @@ void scpu64_ultimax_c000_cfff_store(uint16_t addr, uint8_t value)
 
 /* ------------------------------------------------------------------------- */
 
+/* update the direct tables from the function tables */
+static void mem_write_ram_update(int mirr, int config, int page)
+{
+    mem_write_ram_tab[mirr][config][page] = (mem_write_tab[mirr][config][page] == ram_store);
+}
+
+static void mem_read_ram_update(int config, int page)
+{
+    mem_read_ram_tab[config][page] = (mem_read_tab[config][page] == ram_read);
+}
+
+static void mem_direct_tabs_update_all(void)
+{
+    int i, j, l;
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        for (j = 0; j <= 0x100; j++) {
+            for (l = 0; l < NUM_MIRRORS; l++) {
+                mem_write_ram_update(l, i, j);
+            }
+            mem_read_ram_update(i, j);
+        }
+    }
+}
+
 void mem_set_write_hook(int config, int page, store_func_t *f)
 {
     int j;
 
     for (j = 0; j < NUM_MIRRORS; j++) {
         mem_write_tab[j][config][page] = f;
+        mem_write_ram_update(j, config, page);
     }
 }
 
 void mem_read_tab_set(unsigned int base, unsigned int index, read_func_ptr_t read_func)
 {
     mem_read_tab[base][index] = read_func;
+    mem_read_ram_update((int)base, (int)index);
 }
 
 /* set c64 base */
@@ -1383,6 +1432,9 @@ void mem_initialize_memory(void)
         mem_read_limit_tab[i][0x100] = 0;
     }
 
+    /* the function tables above may have been changed directly */
+    mem_direct_tabs_update_all();
+
     vicii_set_chargen_addr_options(0x7000, 0x1000);
 
     mem_pport = 7;
@@ -1477,6 +1529,7 @@ void mem_set_mirroring(int new_mirroring)
     /* Do not override watchpoints on vbank switches.  */
     if (_mem_write_tab_ptr != mem_write_tab_watch) {
         _mem_write_tab_ptr = mem_write_tab[mirror][mem_config];
+        _mem_write_ram_tab_ptr = mem_write_ram_tab[mirror][mem_config];
     }
 }
 
@@ -42,6 +42,10 @@
 extern uint8_t mem_sram[];
 extern uint8_t mem_trap_ram[];
 
+/* Direct read and write tables, nonzero for plain SRAM pages.  */
+extern uint8_t *_mem_read_ram_tab_ptr;
+extern uint8_t *_mem_write_ram_tab_ptr;
+
 extern int mem_reg_soft_1mhz;          /* 1MHz software enabled */
 extern int mem_reg_sys_1mhz;           /* 1MHz system enabled */
 extern int mem_reg_hwenable;           /* hardware enabled */
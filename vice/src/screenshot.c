@@ -30,6 +30,7 @@
 
 #include "vice.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -71,6 +72,36 @@ static struct video_canvas_s *reopen_recording_canvas;
 static char *reopen_filename;
 static char *autosave_screenshot_format;
 
+/* Screenshots in image formats are encoded by a worker thread: the emulation
+   copies the displayed lines of the frame buffer and the palette into a job,
+   so it only waits when SCREENSHOT_QUEUE_MAX jobs are queued already.  Jobs
+   are done in order, one at a time, so the drivers are never used by two
+   threads at once.  Native screenshots need the state of the video chip and
+   are still saved right away.  */
+#define SCREENSHOT_QUEUE_MAX    4
+
+typedef struct screenshot_job_s {
+    screenshot_t screenshot;
+    gfxoutputdrv_t *drv;
+    char *filename;
+    struct screenshot_job_s *next;
+} screenshot_job_t;
+
+static pthread_mutex_t screenshot_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a job was queued */
+static pthread_cond_t screenshot_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when a job was done */
+static pthread_cond_t screenshot_done = PTHREAD_COND_INITIALIZER;
+
+static screenshot_job_t *queue_head = NULL;
+static screenshot_job_t *queue_tail = NULL;
+/* jobs queued or being encoded */
+static unsigned int queue_pending = 0;
+
+static int thread_started = 0;
+static int thread_failed = 0;
+static pthread_t screenshot_thread;
+
 
 /** \brief  Initialize module
  *
@@ -93,6 +124,7 @@ int screenshot_init(void)
  */
 void screenshot_shutdown(void)
 {
+    screenshot_flush();
     lib_free(reopen_recording_drivername);
     lib_free(reopen_filename);
     lib_free(autosave_screenshot_format);
@@ -149,8 +181,9 @@ static void screenshot_line_data(screenshot_t *screenshot, uint8_t *data,
 }
 
 /*-----------------------------------------------------------------------*/
-static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
-                                const char *filename)
+
+/* Set up what is saved of the screen and how lines are converted.  */
+static void screenshot_prepare(screenshot_t *screenshot)
 {
     unsigned int i;
 
@@ -165,6 +198,12 @@ static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
     }
 
     screenshot->convert_line = screenshot_line_data;
+}
+
+static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
+                                const char *filename)
+{
+    screenshot_prepare(screenshot);
 
     if (drv != NULL) {
         if (drv->save_native != NULL) {
@@ -201,6 +240,129 @@ static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
 
 /*-----------------------------------------------------------------------*/
 
+static void screenshot_job_free(screenshot_job_t *job)
+{
+    lib_free(job->screenshot.draw_buffer);
+    lib_free(job->screenshot.color_map);
+    palette_free(job->screenshot.palette);
+    lib_free(job->filename);
+    lib_free(job);
+}
+
+static void *screenshot_thread_main(void *unused)
+{
+    screenshot_job_t *job;
+
+    pthread_mutex_lock(&screenshot_queue_lock);
+    while (1) {
+        while (queue_head == NULL) {
+            pthread_cond_wait(&screenshot_queued, &screenshot_queue_lock);
+        }
+        job = queue_head;
+        queue_head = job->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&screenshot_queue_lock);
+
+        if ((job->drv->save)(&job->screenshot, job->filename) < 0) {
+            log_error(screenshot_log, "Saving `%s' failed...", job->filename);
+        }
+        screenshot_job_free(job);
+
+        pthread_mutex_lock(&screenshot_queue_lock);
+        queue_pending--;
+        pthread_cond_broadcast(&screenshot_done);
+    }
+
+    return NULL;
+}
+
+static int start_thread(void)
+{
+    if (!thread_started && !thread_failed) {
+        if (pthread_create(&screenshot_thread, NULL, screenshot_thread_main, NULL)) {
+            log_error(screenshot_log,
+                      "Cannot start screenshot thread, saving directly.");
+            thread_failed = 1;
+        } else {
+            pthread_detach(screenshot_thread);
+            thread_started = 1;
+        }
+    }
+    return thread_started;
+}
+
+/* Copy what the driver needs of a screenshot into a job and queue it.
+   Returns -1 if the screenshot has to be saved directly.  */
+static int screenshot_save_async(screenshot_t *screenshot, gfxoutputdrv_t *drv,
+                                 const char *filename)
+{
+    screenshot_job_t *job;
+    unsigned int first_row, rows, i;
+
+    pthread_mutex_lock(&screenshot_queue_lock);
+    if (!start_thread()) {
+        pthread_mutex_unlock(&screenshot_queue_lock);
+        return -1;
+    }
+    while (queue_pending >= SCREENSHOT_QUEUE_MAX) {
+        pthread_cond_wait(&screenshot_done, &screenshot_queue_lock);
+    }
+    queue_pending++;
+    pthread_mutex_unlock(&screenshot_queue_lock);
+
+    job = lib_malloc(sizeof(screenshot_job_t));
+    job->screenshot = *screenshot;
+    job->drv = drv;
+    job->filename = lib_strdup(filename);
+    job->next = NULL;
+
+    screenshot_prepare(&job->screenshot);
+
+    /* only the displayed lines are copied, so they start at line 0 */
+    first_row = job->screenshot.y_offset * job->screenshot.size_height;
+    rows = job->screenshot.height * job->screenshot.size_height;
+    job->screenshot.draw_buffer
+        = lib_malloc(rows * job->screenshot.draw_buffer_line_size);
+    memcpy(job->screenshot.draw_buffer,
+           screenshot->draw_buffer + first_row * screenshot->draw_buffer_line_size,
+           rows * screenshot->draw_buffer_line_size);
+    job->screenshot.y_offset = 0;
+
+    job->screenshot.palette = palette_create(screenshot->palette->num_entries, NULL);
+    for (i = 0; i < screenshot->palette->num_entries; i++) {
+        job->screenshot.palette->entries[i].red = screenshot->palette->entries[i].red;
+        job->screenshot.palette->entries[i].green = screenshot->palette->entries[i].green;
+        job->screenshot.palette->entries[i].blue = screenshot->palette->entries[i].blue;
+    }
+
+    pthread_mutex_lock(&screenshot_queue_lock);
+    if (queue_tail == NULL) {
+        queue_head = job;
+    } else {
+        queue_tail->next = job;
+    }
+    queue_tail = job;
+    pthread_cond_signal(&screenshot_queued);
+    pthread_mutex_unlock(&screenshot_queue_lock);
+
+    return 0;
+}
+
+/** \brief  Wait until all queued screenshots are saved
+ */
+void screenshot_flush(void)
+{
+    pthread_mutex_lock(&screenshot_queue_lock);
+    while (queue_pending > 0) {
+        pthread_cond_wait(&screenshot_done, &screenshot_queue_lock);
+    }
+    pthread_mutex_unlock(&screenshot_queue_lock);
+}
+
+/*-----------------------------------------------------------------------*/
+
 int screenshot_save(const char *drvname, const char *filename,
                     struct video_canvas_s *canvas)
 {
@@ -219,6 +381,10 @@ int screenshot_save(const char *drvname, const char *filename,
         return -1;
     }
 
+    if (!video_pixels_request()) {
+        log_warning(screenshot_log, "The last frame was not fully drawn, saving parts of an older one.");
+    }
+
     if (machine_screenshot(&screenshot, canvas) < 0) {
         log_error(screenshot_log, "Retrieving screen geometry failed.");
         return -1;
@@ -233,6 +399,12 @@ int screenshot_save(const char *drvname, const char *filename,
         reopen_filename = lib_strdup(filename);
     }
 
+    if (drv->type == GFXOUTPUTDRV_TYPE_SCREENSHOT_IMAGE && drv->save != NULL
+        && drv->record == NULL
+        && screenshot_save_async(&screenshot, drv, filename) == 0) {
+        return 0;
+    }
+
     result = screenshot_save_core(&screenshot, drv, filename);
     DBG(("screenshot_save_core result:%d", result));
     if (result < 0) {
@@ -252,6 +424,9 @@ int memmap_screenshot_save(const char *drvname, const char *filename, int x_size
         return -1;
     }
 
+    /* the drivers are not used by two threads at once */
+    screenshot_flush();
+
     if ((drv->savememmap)(filename, x_size, y_size, gfx, palette) < 0) {
         log_error(screenshot_log, "Saving failed...");
         return -1;
@@ -137,6 +137,7 @@ typedef struct screenshot_s {
 int screenshot_init(void);
 void screenshot_shutdown(void);
 int screenshot_save(const char *drvname, const char *filename, struct video_canvas_s *canvas);
+void screenshot_flush(void);
 int screenshot_record(void);
 void screenshot_stop_recording(void);
 int screenshot_is_recording(void);
@@ -274,6 +274,56 @@ int serial_trap_receive(void)
     return 1;
 }
 
+/* Receive the rest of a file being loaded in one go.  This replaces the
+   byte loop of the C64 kernal LOAD routine, which is resumed at UNTALK.
+   Verifying is left to the kernal, as is a timeout, which it retries.  */
+int serial_trap_load(void)
+{
+    uint16_t addr;
+    uint8_t data;
+
+    if (!device_uses_serial_traps(ActiveDevice)) {
+        DBG(("serial_trap_load aborted (dev %d) no traps", ActiveDevice));
+        return 0;
+    }
+
+    /* VERCK: verify instead of load */
+    if (mem_read((uint16_t)0x93) != 0) {
+        return 0;
+    }
+
+    DBG(("serial_trap_load (TrapDevice 0x%02x)", TrapDevice));
+
+    if (TrapSecondary == 0) {
+        send_listen_talk_secondary(SECONDARY + 0);
+    }
+
+    /* EAL: end address, the kernal stores each byte there */
+    addr = (uint16_t)(mem_read((uint16_t)0xae) | (mem_read((uint16_t)0xaf) << 8));
+
+    do {
+        mem_store((uint16_t)0x90, (uint8_t)(serial_get_st() & 0xfd));
+        data = serial_iec_bus_read(TrapDevice, TrapSecondary, serial_set_st);
+        if (serial_get_st() & 0x02) {
+            break;
+        }
+        mem_store(addr++, data);
+    } while (!(serial_get_st() & 0x40));
+
+    mem_store((uint16_t)0xae, (uint8_t)(addr & 0xff));
+    mem_store((uint16_t)0xaf, (uint8_t)(addr >> 8));
+
+    if (serial_get_st() & 0x02) {
+        /* let the kernal loop deal with the timeout */
+        return 0;
+    }
+
+    if (eof_callback_func != NULL) {
+        eof_callback_func();
+    }
+
+    return 1;
+}
 
 /* Kernal loops serial-port (0xdd00) to see when serial is ready: fake it.
    EEA9 Get serial data and clk in (TKSA subroutine).  */
@@ -866,6 +866,190 @@ static int16_t fastsid_calculate_single_sample(sound_t *psid, int i)
 }
 #endif
 
+#ifndef SOUND_SYSTEM_FLOAT
+/* Block rendering.
+
+   Without hard sync the voices only depend on each other through ring
+   modulation, which needs nothing but the oscillator of the previous voice.
+   So instead of running all of fastsid_calculate_single_sample() for every
+   sample, each of its steps is done for a block of samples at a time, in
+   plain loops over arrays that the compiler vectorizes: the oscillator and
+   envelope ramps, the waveform table lookups and the mix. Only the noise
+   shift register, envelope state changes and the filters are sequential.
+   The output is identical to the sample by sample rendering. */
+
+#define FASTSID_BLOCK 64
+
+/* oscillator values after each sample of the block */
+static void block_osc(voice_t *pv, uint32_t *f, int n)
+{
+    uint32_t f0 = pv->f;
+    uint32_t fs = pv->fs;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        f[i] = f0 + (uint32_t)(i + 1) * fs;
+    }
+    pv->f = f[n - 1];
+}
+
+/* envelope values after each sample of the block, returns zero if the
+   voice is silent for the whole block */
+static uint32_t block_env(voice_t *pv, uint32_t *env, int n)
+{
+    uint32_t a = pv->adsr;
+    uint32_t s, z;
+    uint32_t any = 0;
+    int i = 0;
+    int k;
+
+    while (i < n) {
+        s = (uint32_t)pv->adsrs;
+        z = pv->adsrz + 0x80000000;
+
+        /* ramp to the end of the block ... */
+        for (k = i; k < n; k++) {
+            env[k] = a + (uint32_t)(k - i + 1) * s;
+        }
+        /* ... and cut it at the next state change */
+        for (k = i; k < n; k++) {
+            if (env[k] + 0x80000000 < z) {
+                break;
+            }
+        }
+        if (k == n) {
+            a = env[n - 1];
+            break;
+        }
+        pv->adsr = env[k];
+        trigger_adsr(pv);
+        a = env[k] = pv->adsr;
+        i = k + 1;
+    }
+    pv->adsr = a;
+
+    for (k = 0; k < n; k++) {
+        env[k] >>= 16;
+        any |= env[k];
+    }
+    return any;
+}
+
+/* envelope times waveform for each sample of the block */
+static void block_wave(voice_t *pv, const uint32_t *f, const uint32_t *fprev,
+                       const uint32_t *env, uint32_t active, uint32_t *o, int n)
+{
+    uint32_t rv = pv->rv;
+    uint32_t fs = pv->fs;
+    int carries = 0;
+    int i;
+
+    if (pv->noise && active) {
+        for (i = 0; i < n; i++) {
+            if (f[i] < fs) {
+                rv = NSHIFT(rv, 16);
+            }
+            o[i] = env[i] * (((uint32_t)NVALUE(NSHIFT(rv, f[i] >> 28))) << 7);
+        }
+        pv->rv = rv;
+        return;
+    }
+
+    /* the noise register still shifts on each oscillator overflow */
+    for (i = 0; i < n; i++) {
+        carries += f[i] < fs;
+    }
+    while (carries--) {
+        rv = NSHIFT(rv, 16);
+    }
+    pv->rv = rv;
+
+    if (!active) {
+        memset(o, 0, n * sizeof(uint32_t));
+    } else {
+        const uint16_t *wt = pv->wt;
+        uint32_t wtpf = pv->wtpf;
+        uint32_t wtl = pv->wtl;
+        uint32_t wtr0 = pv->wtr[0];
+        uint32_t wtrx = pv->wtr[0] ^ pv->wtr[1];
+
+        for (i = 0; i < n; i++) {
+            o[i] = env[i] * (wt[(f[i] + wtpf) >> wtl] ^ (wtr0 ^ (wtrx & (0 - (fprev[i] >> 31)))));
+        }
+    }
+}
+
+/* run the filter of a voice over the block */
+static void block_filter(voice_t *pv, uint32_t *o, int n)
+{
+    /* work on a local copy, so the filter state can stay in registers */
+    voice_t v = *pv;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        v.filtIO = ampMod1x8[(o[i] >> 22)];
+        dofilter(&v);
+        o[i] = ((uint32_t)(v.filtIO) + 0x80) << (7 + 15);
+    }
+    pv->filtIO = v.filtIO;
+    pv->filtLow = v.filtLow;
+    pv->filtRef = v.filtRef;
+}
+
+static void fastsid_calculate_block(sound_t *psid, int16_t *pbuf, int nr, int interleave)
+{
+    uint32_t f[3][FASTSID_BLOCK];
+    uint32_t o[3][FASTSID_BLOCK];
+    uint32_t env[FASTSID_BLOCK];
+    uint32_t active;
+    int32_t vol;
+    int i, j, n, pos;
+
+    setup_sid(psid);
+    for (j = 0; j < 3; j++) {
+        setup_voice(&psid->v[j]);
+    }
+
+    /* hard sync ties the oscillators together sample by sample */
+    if (psid->v[0].sync || psid->v[1].sync || psid->v[2].sync) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i * interleave] = fastsid_calculate_single_sample(psid, i);
+        }
+        return;
+    }
+
+    vol = psid->vol;
+
+    for (pos = 0; pos < nr; pos += n) {
+        n = nr - pos;
+        if (n > FASTSID_BLOCK) {
+            n = FASTSID_BLOCK;
+        }
+
+        for (j = 0; j < 3; j++) {
+            block_osc(&psid->v[j], f[j], n);
+        }
+        for (j = 0; j < 3; j++) {
+            active = block_env(&psid->v[j], env, n);
+            block_wave(&psid->v[j], f[j], f[(j + 2) % 3], env, active, o[j], n);
+        }
+        if (!psid->has3) {
+            memset(o[2], 0, n * sizeof(uint32_t));
+        }
+        if (psid->emulatefilter) {
+            for (j = 0; j < 3; j++) {
+                block_filter(&psid->v[j], o[j], n);
+            }
+        }
+
+        for (i = 0; i < n; i++) {
+            pbuf[(pos + i) * interleave] =
+                (int16_t)(((int32_t)((o[0][i] + o[1][i] + o[2][i]) >> 20) - 0x600) * vol);
+        }
+    }
+}
+#endif
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int fastsid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *delta_t)
@@ -887,19 +1071,14 @@ static int fastsid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *
 #else
 static int fastsid_calculate_samples(sound_t *psid, int16_t *pbuf, int nr, int interleave, CLOCK *delta_t)
 {
-    int i;
     int16_t *tmp_buf;
 
     if (psid->factor == 1000) {
-        for (i = 0; i < nr; i++) {
-            pbuf[i * interleave] = fastsid_calculate_single_sample(psid, i);
-        }
+        fastsid_calculate_block(psid, pbuf, nr, interleave);
         return nr;
     }
     tmp_buf = getbuf(2 * nr * psid->factor / 1000);
-    for (i = 0; i < (nr * psid->factor / 1000); i++) {
-        tmp_buf[i * interleave] = fastsid_calculate_single_sample(psid, i);
-    }
+    fastsid_calculate_block(psid, tmp_buf, nr * psid->factor / 1000, interleave);
     memcpy(pbuf, tmp_buf, 2 * nr);
     return nr;
 }
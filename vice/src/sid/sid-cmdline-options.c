@@ -247,6 +247,12 @@ static const cmdline_option_t resid_cmdline_options[] =
       NULL, NULL, "SidResidEnableRawOutput", (void *)1, NULL, "Enable writing raw reSID output to resid.raw, 16bit little endian data (WARNING: 1MiB per second)." },
     { "+residrawoutput", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "SidResidEnableRawOutput", (void *)0, NULL, "Disable writing raw reSID output to resid.raw." },
+    { "-residparallel", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidParallel", (void *)1,
+      NULL, "Enable clocking multiple reSID chips in parallel threads" },
+    { "+residparallel", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidParallel", (void *)0,
+      NULL, "Disable clocking multiple reSID chips in parallel threads" },
     CMDLINE_LIST_END
 };
 #endif
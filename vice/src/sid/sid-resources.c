@@ -66,6 +66,7 @@ static int sid_resid_8580_gain;
 static int sid_resid_8580_filter_bias;
 static int sid_resid_enable_raw_output;
 #endif
+int sid_resid_parallel = 0;
 int sid_stereo = 0;
 int checking_sid_stereo;
 unsigned int sid2_address_start;
@@ -164,6 +165,13 @@ static int set_sid_resid_enable_raw_output(int val, void *param)
 
     return 0;
 }
+
+static int set_sid_resid_parallel(int val, void *param)
+{
+    sid_resid_parallel = val ? 1 : 0;
+
+    return 0;
+}
 #endif
 
 static int set_sid_stereo(int val, void *param)
@@ -450,6 +458,8 @@ static const resource_int_t resid_resources_int[] = {
       &sid_resid_8580_gain, set_sid_resid_8580_gain, NULL },
     { "SidResid8580FilterBias", RESID_8580_FILTER_BIAS_DEFAULT, RES_EVENT_NO, NULL,
       &sid_resid_8580_filter_bias, set_sid_resid_8580_filter_bias, NULL },
+    { "SidResidParallel", 0, RES_EVENT_NO, NULL,
+      &sid_resid_parallel, set_sid_resid_parallel, NULL },
     RESOURCE_INT_LIST_END
 };
 #endif
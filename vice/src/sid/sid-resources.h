@@ -39,6 +39,7 @@ int sid_set_sid6_address(int val, void *param);
 int sid_set_sid7_address(int val, void *param);
 int sid_set_sid8_address(int val, void *param);
 
+extern int sid_resid_parallel;
 extern int sid_stereo;
 extern int checking_sid_stereo;
 extern unsigned int sid2_address_start;
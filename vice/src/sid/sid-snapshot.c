@@ -236,6 +236,7 @@ static int sid_snapshot_read_module_simple(snapshot_t *s, int sidnr)
     const char *snap_module_name_simple = NULL;
     int sids = 0;
     int sid_address;
+    int reopen = 0;
 
     switch (sidnr) {
         default:
@@ -280,29 +281,46 @@ static int sid_snapshot_read_module_simple(snapshot_t *s, int sidnr)
     /* Handle 1.3+ snapshots differently */
     if (!snapshot_version_is_smaller(major_version, minor_version, 1, 3)) {
         if (sidnr == 0) {
+            int has_model = !snapshot_version_is_smaller(major_version, minor_version, 1, 4);
+            int cur_sids, cur_sound, cur_engine, cur_model;
+            uint8_t model = 0;
+
             if (SMR_B_INT(m, &sids) < 0) {
                 goto fail;
             }
-            resources_set_int("SidStereo", sids);
             if (0
                 || SMR_B(m, &tmp[0]) < 0
-                || SMR_B(m, &tmp[1]) < 0) {
+                || SMR_B(m, &tmp[1]) < 0
+                || (has_model && SMR_B(m, &model) < 0)) {
                 goto fail;
             }
-            screenshot_prepare_reopen();
-            sound_close();
-            screenshot_try_reopen();
-            resources_set_int("Sound", (int)tmp[0]);
+
+            resources_get_int("SidStereo", &cur_sids);
+            resources_get_int("Sound", &cur_sound);
+            resources_get_int("SidEngine", &cur_engine);
+            resources_get_int("SidModel", &cur_model);
 
             intended_sid_engine = tmp[1];
-            set_sid_engine_with_fallback(tmp[1]);
 
-            if (!snapshot_version_is_smaller(major_version, minor_version, 1, 4)) {
-                if (0
-                    || SMR_B(m, &tmp[0]) < 0) {
-                    goto fail;
+            /* Only reopen the sound device and reinitialize the engine when
+               the configuration differs, the chip state itself is restored
+               by the extended module. */
+            if (sids != cur_sids
+                || tmp[0] != cur_sound
+                || tmp[1] != cur_engine
+                || (has_model && model != cur_model)) {
+                reopen = 1;
+                resources_set_int("SidStereo", sids);
+                screenshot_prepare_reopen();
+                sound_close();
+                screenshot_try_reopen();
+                resources_set_int("Sound", (int)tmp[0]);
+
+                set_sid_engine_with_fallback(tmp[1]);
+
+                if (has_model) {
+                    resources_set_int("SidModel", (int)model);
                 }
-                resources_set_int("SidModel", (int)tmp[0]);
             }
         } else {
             if (SMR_W_INT(m, &sid_address) < 0) {
@@ -317,7 +335,9 @@ static int sid_snapshot_read_module_simple(snapshot_t *s, int sidnr)
             goto fail;
         }
         memcpy(sid_get_siddata(sidnr), &tmp[2], 32);
-        sound_open();
+        if (reopen) {
+            sound_open();
+        }
         return snapshot_module_close(m);
     }
 
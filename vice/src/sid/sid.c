@@ -620,6 +620,9 @@ GETBUFx(5)
 GETBUFx(6)
 GETBUFx(7)
 
+/* buffers of the chips clocked in parallel, one per chip */
+static int16_t *parbuf[SOUND_SIDS_MAX];
+static int parblen[SOUND_SIDS_MAX];
 #endif
 
 int sid_sound_machine_init_vbr(sound_t *psid, int speed, int cycles_per_sec, int factor)
@@ -637,6 +640,10 @@ int sid_sound_machine_init(sound_t *psid, int speed, int cycles_per_sec)
 
 void sid_sound_machine_close(sound_t *psid)
 {
+#ifndef SOUND_SYSTEM_FLOAT
+    int i;
+#endif
+
     sid_engine.close(psid);
 #ifndef SOUND_SYSTEM_FLOAT
     /* free the temp. buffers */
@@ -675,6 +682,13 @@ void sid_sound_machine_close(sound_t *psid)
         blen7 = 0;
         buf7 = NULL;
     }
+    for (i = 0; i < SOUND_SIDS_MAX; i++) {
+        if (parbuf[i]) {
+            lib_free(parbuf[i]);
+            parblen[i] = 0;
+            parbuf[i] = NULL;
+        }
+    }
 #endif
 #ifdef HAVE_USBSID
     usbsid_close();
@@ -706,6 +720,64 @@ int sid_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int
     return sid_engine.calculate_samples(psid[scc], pbuf, nr, delta_t);
 }
 #else
+/* Below this many cycles the chips are clocked one after another, as the
+   threads would cost more than they save.  */
+#define SID_PARALLEL_MIN_CYCLES 2000
+
+/* Clock several reSID chips in parallel threads. Every chip renders into a
+   buffer of its own, the buffers are then mixed in the same order and with
+   the same placement as the serial code below does.  */
+static int sid_sound_machine_calculate_samples_parallel(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+{
+    CLOCK chip_delta_t[SOUND_SIDS_MAX];
+    int chip_nr[SOUND_SIDS_MAX];
+    int i, k;
+
+    for (k = 0; k < scc; k++) {
+        if (parblen[k] < nr) {
+            lib_free(parbuf[k]);
+            parbuf[k] = lib_calloc(nr, sizeof(int16_t));
+            parblen[k] = nr;
+        }
+        chip_delta_t[k] = *delta_t;
+    }
+
+#pragma omp parallel for schedule(static, 1) if (*delta_t >= SID_PARALLEL_MIN_CYCLES)
+    for (k = 0; k < scc; k++) {
+        chip_nr[k] = sid_engine.calculate_samples(psid[k], parbuf[k], nr, SOUND_OUTPUT_MONO, &chip_delta_t[k]);
+    }
+
+    *delta_t = chip_delta_t[1];
+    nr = chip_nr[1];
+
+    if (soc == SOUND_OUTPUT_MONO) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i] = parbuf[1][i];
+            pbuf[i] = sound_audio_mix(pbuf[i], parbuf[0][i]);
+            for (k = 2; k < scc; k++) {
+                pbuf[i] = sound_audio_mix(pbuf[i], parbuf[k][i]);
+            }
+        }
+    } else {
+        /* even chips go left, odd chips right, the last chip of an odd
+           number of chips to both */
+        for (i = 0; i < nr; i++) {
+            pbuf[i * 2] = parbuf[0][i];
+            pbuf[(i * 2) + 1] = parbuf[1][i];
+            for (k = 2; k < scc; k++) {
+                if (!(k & 1) || ((scc & 1) && k == scc - 1)) {
+                    pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], parbuf[k][i]);
+                }
+                if ((k & 1) || ((scc & 1) && k == scc - 1)) {
+                    pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], parbuf[k][i]);
+                }
+            }
+        }
+    }
+
+    return nr;
+}
+
 int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
     int i;
@@ -719,6 +791,10 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     int tmp_nr = 0;
     CLOCK tmp_delta_t = *delta_t;
 
+    if (sid_resid_parallel && sidengine == SID_ENGINE_RESID && scc >= SOUND_2_DEVICES) {
+        return sid_sound_machine_calculate_samples_parallel(psid, pbuf, nr, soc, scc, delta_t);
+    }
+
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_1_DEVICE) {
         return sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
     }
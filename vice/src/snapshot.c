@@ -29,13 +29,26 @@
 
 #include "vice.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(UNIX_COMPILE)
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
 
 #include "archdep.h"
+#include "cmdline.h"
 #include "lib.h"
 #include "log.h"
+#include "resources.h"
 #ifdef USE_SVN_REVISION
 #include "svnversion.h"
 #endif
@@ -62,21 +75,121 @@ static char *current_filename = NULL;
 static size_t current_fpos = 0;
 
 static const char snapshot_magic_string[] = "VICE Snapshot File\032";
+static const char snapshot_deflate_magic_string[] = "VICE Snapshot Zlib\032";
 static const char snapshot_version_magic_string[] = "VICE Version\032";
 
 #define SNAPSHOT_MAGIC_LEN              19
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
-struct snapshot_module_s {
-    /* File descriptor.  */
+/* "SnapshotCompression" resource: deflate level used for snapshot files,
+   0 writes the plain format.  */
+static int snapshot_compression = 0;
+
+/* A large array written by snapshot_module_write_byte_array_paged().  */
+typedef struct snapshot_paged_array_s {
+    /* Source of the array and its size.  */
+    const uint8_t *data;
+    unsigned int num;
+
+    /* Where it was stored in the memory buffer.  */
+    size_t offset;
+
+    /* Page generation at the time it was stored.  */
+    uint32_t generation;
+
+    /* Value of `read_serial' at the time it was stored.  */
+    unsigned int serial;
+} snapshot_paged_array_t;
+
+struct snapshot_memory_s {
+    /* Snapshot data.  */
+    uint8_t *data;
+
+    /* Number of valid bytes in `data'.  */
+    size_t size;
+
+    /* Number of allocated bytes in `data'.  */
+    size_t allocated;
+
+    /* Number of bytes of the previous snapshot still present in `data';
+       writing compares against these so unchanged pages are not touched.  */
+    size_t old_size;
+
+    /* One flag per page of `data': set when the page was changed since the
+       last snapshot_memory_keyframe().  */
+    uint8_t *changed;
+
+    /* Paged arrays stored by the previous snapshot, in order.  */
+    snapshot_paged_array_t *arrays;
+    unsigned int arrays_max;
+    unsigned int arrays_next;
+};
+
+/* Where a snapshot is read from or written to: either a file or a memory
+   buffer.  */
+typedef struct snapshot_stream_s {
+    /* File descriptor, NULL for memory snapshots.  */
     FILE *file;
 
+    /* Memory buffer, NULL for file snapshots.  */
+    snapshot_memory_t *memory;
+
+    /* Current offset in the memory buffer.  */
+    size_t pos;
+
+    /* Deflate level of the module payloads when writing, 0 if they are
+       stored as they are; when reading just a flag.  */
+    int compression;
+
+    /* Number of threads compressed modules are deflated with when writing,
+       1 if they are deflated as they are written.  */
+    int zthreads;
+
+    /* Modules of a compressed snapshot that are waiting to be deflated and
+       written, each with its header.  While a module is being written the
+       last one is `memory'.  */
+    snapshot_memory_t **zmodules;
+    int zmodules_num;
+    int zmodules_max;
+
+    /* Number of bytes in `zmodules'.  */
+    size_t zpending;
+
+    /* Deflate or inflate state while the payload of a compressed module is
+       written with a single thread or read, NULL otherwise.  */
+    z_stream *z;
+
+    /* Position in the uncompressed module while `z' is active.  */
+    long zpos;
+
+    /* Compressed bytes of the module not yet read from the file.  */
+    uint32_t zleft;
+
+    /* Buffer between the file and `z'.  */
+    uint8_t *zbuf;
+
+    /* Read-only mapping of an uncompressed snapshot file and its size, NULL
+       if the file is read through `file'.  While mapped, `memory' points to
+       `mapped', which describes the mapping.  */
+    void *map;
+    size_t map_size;
+    snapshot_memory_t mapped;
+} snapshot_stream_t;
+
+struct snapshot_module_s {
+    /* Stream of the snapshot this module belongs to.  */
+    snapshot_stream_t *stream;
+
     /* Flag: are we writing it?  */
     int write_mode;
 
     /* Size of the module.  */
     uint32_t size;
 
+    /* Size of the module in the file, differs from `size' if the module is
+       compressed.  */
+    uint32_t stored_size;
+
     /* Offset of the module in the file.  */
     long offset;
 
@@ -84,84 +197,667 @@ struct snapshot_module_s {
     long size_offset;
 };
 
+/* Where a module of a snapshot being read starts.  */
+typedef struct snapshot_module_index_s {
+    char name[SNAPSHOT_MODULE_NAME_LEN];
+    long offset;
+} snapshot_module_index_t;
+
 struct snapshot_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* File or memory stream.  */
+    snapshot_stream_t stream;
 
     /* Offset of the first module.  */
     long first_module_offset;
 
     /* Flag: are we writing it?  */
     int write_mode;
+
+    /* Modules of a snapshot being read, in file order.  Built by the first
+       snapshot_module_open(), NULL before.  */
+    snapshot_module_index_t *index;
+    int index_num;
 };
 
+/* When set, snapshot_create() and snapshot_open() use this buffer instead of
+   the given file.  */
+static snapshot_memory_t *memory_target = NULL;
+
+/* Generation stamped into the page tables of large memories by
+   SNAPSHOT_PAGE_TOUCH(), advanced each time a paged array is stored.  */
+uint32_t snapshot_page_generation = 1;
+
+/* Incremented whenever a snapshot is read.  Reading changes memory behind
+   the back of the page stamps, so paged arrays stored before are not
+   trusted afterwards.  */
+static unsigned int read_serial = 0;
+
+#define PAGE_MASK ((size_t)SNAPSHOT_PAGE_SIZE - 1)
+#define PAGES(size) (((size) + PAGE_MASK) >> SNAPSHOT_PAGE_SHIFT)
+
+/* Size of the buffer between compressed modules and the file.  */
+#define ZBUF_SIZE 0x10000
+
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
+/* In a compressed snapshot every module header is followed by the size of
+   the uncompressed module, then by the deflated module contents (in zlib
+   format).  The SIZE field of the header holds the size of the module in
+   the file, so modules can still be skipped without inflating them.
+
+   With a single thread the contents of a module are deflated as they are
+   written.  With more threads modules are collected in memory buffers of
+   their own, and deflated in parallel when the snapshot is closed: small
+   modules each in one piece, large ones split into one piece per thread of
+   at least ZCHUNK_MIN bytes.  Each piece ends on a byte boundary and is
+   primed with the data before it, so the pieces simply concatenate into one
+   zlib stream, the same way pigz does it.  A module in one piece is
+   deflated exactly like a streamed one.  When reading, the contents are
+   inflated as they are read, and positions refer to the uncompressed
+   module.  */
+
+#define MODULE_HEADER_SIZE (SNAPSHOT_MODULE_NAME_LEN + 2 + 4)
+
+/* Smallest piece a compressed module is split into; every piece restarts
+   the block statistics of deflate, so pieces must be large.  */
+#define ZCHUNK_MIN 0x400000
+
+/* Amount of preceding data each piece is primed with.  */
+#define ZDICT_SIZE 0x8000
+
+/* Deflate the collected modules once this much data is pending.  */
+#define ZPENDING_MAX 0x4000000
+
+typedef struct zchunk_s {
+    /* Uncompressed data; `dict' bytes before it belong to the same module */
+    const uint8_t *data;
+    size_t size;
+    size_t dict;
+
+    /* Flag: last piece of the module */
+    int last;
+
+    /* Deflated data, `out_max' bytes allocated */
+    uint8_t *out;
+    size_t out_size;
+    size_t out_max;
+
+    /* Adler-32 checksum of `data' */
+    uLong adler;
+
+    /* Flag: deflating failed */
+    int error;
+} zchunk_t;
+
+static void zstream_alloc_buffer(snapshot_stream_t *f)
 {
-    current_fpos = ftell(f);
-    if (fputc(data, f) == EOF) {
-        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
-        return -1;
+    if (f->zbuf == NULL) {
+        f->zbuf = lib_malloc(ZBUF_SIZE);
     }
+}
+
+/* Number of threads to deflate compressed modules with.  */
+static int zstream_threads(void)
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
 
+static int zstream_begin_write(snapshot_stream_t *f, long pos, int level)
+{
+    f->z = lib_calloc(1, sizeof(z_stream));
+    if (deflateInit(f->z, level) != Z_OK) {
+        lib_free(f->z);
+        f->z = NULL;
+        return -1;
+    }
+    zstream_alloc_buffer(f);
+    f->z->next_out = f->zbuf;
+    f->z->avail_out = ZBUF_SIZE;
+    f->zpos = pos;
     return 0;
 }
 
-static int snapshot_write_word(FILE *f, uint16_t data)
+/* Write out whatever deflate() has put into the buffer.  */
+static int zstream_flush(snapshot_stream_t *f)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
-        || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
+    size_t n = ZBUF_SIZE - f->z->avail_out;
+
+    if (n > 0 && fwrite(f->zbuf, n, 1, f->file) < 1) {
         return -1;
     }
+    f->z->next_out = f->zbuf;
+    f->z->avail_out = ZBUF_SIZE;
+    return 0;
+}
+
+static int zstream_write(snapshot_stream_t *f, const void *data, size_t num)
+{
+    z_stream *z = f->z;
 
+    z->next_in = (Bytef *)data;
+    z->avail_in = (uInt)num;
+    while (z->avail_in > 0) {
+        if (deflate(z, Z_NO_FLUSH) != Z_OK) {
+            return -1;
+        }
+        if (z->avail_out == 0 && zstream_flush(f) < 0) {
+            return -1;
+        }
+    }
+    f->zpos += (long)num;
     return 0;
 }
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
+static int zstream_end_write(snapshot_stream_t *f)
+{
+    int err;
+
+    do {
+        err = deflate(f->z, Z_FINISH);
+        if ((err != Z_OK && err != Z_STREAM_END) || zstream_flush(f) < 0) {
+            err = Z_STREAM_ERROR;
+            break;
+        }
+    } while (err != Z_STREAM_END);
+
+    deflateEnd(f->z);
+    lib_free(f->z);
+    f->z = NULL;
+    return err == Z_STREAM_END ? 0 : -1;
+}
+
+/* Start collecting a new module of a compressed snapshot.  */
+static void zstream_begin_module(snapshot_stream_t *f)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
-        || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
+    if (f->zmodules_num == f->zmodules_max) {
+        f->zmodules_max += 16;
+        f->zmodules = lib_realloc(f->zmodules, f->zmodules_max * sizeof(snapshot_memory_t *));
+    }
+    f->memory = snapshot_memory_new();
+    f->zmodules[f->zmodules_num++] = f->memory;
+    f->pos = 0;
+}
+
+/* Deflate one piece as raw deflate data; runs on worker threads, so this
+   must not touch anything but `c'.  */
+static void zchunk_deflate(zchunk_t *c, int level)
+{
+    z_stream z;
+    int flush = c->last ? Z_FINISH : Z_SYNC_FLUSH;
+
+    c->adler = adler32(adler32(0L, Z_NULL, 0), c->data, (uInt)c->size);
+
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        c->error = 1;
+        return;
+    }
+    if (c->dict > 0) {
+        deflateSetDictionary(&z, c->data - c->dict, (uInt)c->dict);
+    }
+    z.next_in = (Bytef *)c->data;
+    z.avail_in = (uInt)c->size;
+    z.next_out = c->out;
+    z.avail_out = (uInt)c->out_max;
+    if (deflate(&z, flush) != (c->last ? Z_STREAM_END : Z_OK) || z.avail_in > 0) {
+        c->error = 1;
+    }
+    c->out_size = c->out_max - z.avail_out;
+    deflateEnd(&z);
+}
+
+static int zstream_write_dword(snapshot_stream_t *f, uint32_t data)
+{
+    uint8_t b[4];
+
+    b[0] = (uint8_t)(data & 0xff);
+    b[1] = (uint8_t)((data >> 8) & 0xff);
+    b[2] = (uint8_t)((data >> 16) & 0xff);
+    b[3] = (uint8_t)(data >> 24);
+    return fwrite(b, sizeof(b), 1, f->file) < 1 ? -1 : 0;
+}
+
+/* Deflate the collected modules and write them out in order.  */
+static int zstream_flush_modules(snapshot_stream_t *f)
+{
+    snapshot_memory_t *mem;
+    zchunk_t *chunks = NULL;
+    zchunk_t *c;
+    size_t payload, pos, stored, piece;
+    uLong adler;
+    uint8_t b[4];
+    int *pieces;
+    int num = 0;
+    int i, k;
+    int err = 0;
+
+    if (f->zmodules_num == 0) {
+        return 0;
+    }
+
+    /* split the modules into pieces */
+    pieces = lib_malloc(f->zmodules_num * sizeof(int));
+    for (k = 0; k < f->zmodules_num; k++) {
+        payload = f->zmodules[k]->size - MODULE_HEADER_SIZE;
+        pieces[k] = (int)(payload / ZCHUNK_MIN) < f->zthreads ? (int)(payload / ZCHUNK_MIN) : f->zthreads;
+        if (pieces[k] < 1) {
+            pieces[k] = 1;
+        }
+        num += pieces[k];
+    }
+    chunks = lib_calloc((size_t)num, sizeof(zchunk_t));
+    c = chunks;
+    for (k = 0; k < f->zmodules_num; k++) {
+        mem = f->zmodules[k];
+        pos = MODULE_HEADER_SIZE;
+        piece = (mem->size - MODULE_HEADER_SIZE + pieces[k] - 1) / pieces[k];
+        do {
+            c->data = mem->data + pos;
+            c->size = mem->size - pos < piece ? mem->size - pos : piece;
+            c->dict = pos - MODULE_HEADER_SIZE < ZDICT_SIZE ? pos - MODULE_HEADER_SIZE : ZDICT_SIZE;
+            c->last = pos + c->size == mem->size;
+            c->out_max = compressBound((uLong)c->size) + 16;
+            c->out = lib_malloc(c->out_max);
+            pos += c->size;
+            c++;
+        } while (pos < mem->size);
+    }
+
+    lib_free(pieces);
+
+#pragma omp parallel for schedule(dynamic)
+    for (i = 0; i < num; i++) {
+        zchunk_deflate(&chunks[i], f->compression);
+    }
+
+    c = chunks;
+    for (k = 0; k < f->zmodules_num; k++) {
+        mem = f->zmodules[k];
+
+        /* stored size: header, uncompressed size, zlib header, pieces and
+           checksum */
+        stored = MODULE_HEADER_SIZE + 4 + 2 + 4;
+        i = 0;
+        do {
+            err |= c[i].error;
+            stored += c[i].out_size;
+        } while (!c[i++].last);
+
+        /* zlib header: deflate with 32K window, compression level hint */
+        b[0] = 0x78;
+        b[1] = f->compression == 1 ? 0x01 : f->compression < 6 ? 0x5e : f->compression == 6 ? 0x9c : 0xda;
+
+        if (err
+            || fwrite(mem->data, MODULE_HEADER_SIZE - 4, 1, f->file) < 1
+            || zstream_write_dword(f, (uint32_t)stored) < 0
+            || zstream_write_dword(f, (uint32_t)mem->size) < 0
+            || fwrite(b, 2, 1, f->file) < 1) {
+            err = 1;
+            break;
+        }
+        adler = adler32(0L, Z_NULL, 0);
+        do {
+            if (c->out_size > 0 && fwrite(c->out, c->out_size, 1, f->file) < 1) {
+                err = 1;
+            }
+            adler = adler32_combine(adler, c->adler, (z_off_t)c->size);
+        } while (!(c++)->last);
+        b[0] = (uint8_t)(adler >> 24);
+        b[1] = (uint8_t)(adler >> 16);
+        b[2] = (uint8_t)(adler >> 8);
+        b[3] = (uint8_t)adler;
+        if (err || fwrite(b, 4, 1, f->file) < 1) {
+            err = 1;
+            break;
+        }
+    }
+
+    for (i = 0; i < num; i++) {
+        lib_free(chunks[i].out);
+    }
+    lib_free(chunks);
+    for (k = 0; k < f->zmodules_num; k++) {
+        snapshot_memory_free(f->zmodules[k]);
+    }
+    f->zmodules_num = 0;
+    f->zpending = 0;
+
+    return err ? -1 : 0;
+}
+
+static int zstream_begin_read(snapshot_stream_t *f, long pos, uint32_t stored_size)
+{
+    f->z = lib_calloc(1, sizeof(z_stream));
+    if (inflateInit(f->z) != Z_OK) {
+        lib_free(f->z);
+        f->z = NULL;
         return -1;
     }
+    zstream_alloc_buffer(f);
+    f->zleft = stored_size;
+    f->zpos = pos;
+    return 0;
+}
 
+static int zstream_read(snapshot_stream_t *f, void *data, size_t num)
+{
+    z_stream *z = f->z;
+    size_t n;
+    int err;
+
+    z->next_out = data;
+    z->avail_out = (uInt)num;
+    while (z->avail_out > 0) {
+        if (z->avail_in == 0) {
+            n = f->zleft < ZBUF_SIZE ? f->zleft : ZBUF_SIZE;
+            if (n == 0 || fread(f->zbuf, n, 1, f->file) < 1) {
+                return -1;
+            }
+            z->next_in = f->zbuf;
+            z->avail_in = (uInt)n;
+            f->zleft -= (uint32_t)n;
+        }
+        err = inflate(z, Z_NO_FLUSH);
+        if (err == Z_STREAM_END && z->avail_out == 0) {
+            break;
+        }
+        if (err != Z_OK) {
+            return -1;
+        }
+    }
+    f->zpos += (long)num;
     return 0;
 }
 
-static int snapshot_write_qword(FILE *f, uint64_t data)
+static void zstream_end_read(snapshot_stream_t *f)
+{
+    inflateEnd(f->z);
+    lib_free(f->z);
+    f->z = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Map the rest of an uncompressed snapshot file into memory and read it
+   from there, so the module data is copied straight from the page cache
+   instead of going through stdio.  The file stays open until the snapshot
+   is closed.  Nothing changes if the file cannot be mapped.  */
+static void stream_map(snapshot_stream_t *f)
+{
+#if defined(UNIX_COMPILE)
+    struct stat st;
+    long pos = ftell(f->file);
+    void *map;
+
+    if (pos < 0
+        || fstat(fileno(f->file), &st) < 0
+        || !S_ISREG(st.st_mode)
+        || st.st_size <= pos
+        || (uintmax_t)st.st_size > (uintmax_t)SIZE_MAX) {
+        return;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(f->file), 0);
+    if (map == MAP_FAILED) {
+        return;
+    }
+#if defined(MADV_SEQUENTIAL)
+    /* modules are mostly read in the order they were written */
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    f->map = map;
+    f->map_size = (size_t)st.st_size;
+    memset(&f->mapped, 0, sizeof(f->mapped));
+    f->mapped.data = map;
+    f->mapped.size = f->map_size;
+    f->memory = &f->mapped;
+    f->pos = (size_t)pos;
+#endif
+}
+
+static void stream_unmap(snapshot_stream_t *f)
+{
+#if defined(UNIX_COMPILE)
+    if (f->map != NULL) {
+        munmap(f->map, f->map_size);
+        f->map = NULL;
+        f->memory = NULL;
+    }
+#endif
+}
+
+static long stream_tell(snapshot_stream_t *f)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_dword(f, (uint32_t)(data & 0xffffffff)) < 0
-        || snapshot_write_dword(f, (uint32_t)(data >> 32)) < 0) {
+    if (f->z != NULL) {
+        return f->zpos;
+    }
+    if (f->memory == NULL) {
+        return ftell(f->file);
+    }
+    return (long)f->pos;
+}
+
+static int stream_seek(snapshot_stream_t *f, long offset)
+{
+    if (f->z != NULL) {
+        /* compressed modules are only ever read or written in order */
+        return offset == f->zpos ? 0 : -1;
+    }
+    if (f->memory == NULL) {
+        return fseek(f->file, offset, SEEK_SET);
+    }
+    if (offset < 0 || (size_t)offset > f->memory->size) {
         return -1;
     }
+    f->pos = (size_t)offset;
+    return 0;
+}
+
+/* Make room for at least `size' bytes in a memory buffer.  */
+static void memory_reserve(snapshot_memory_t *mem, size_t size)
+{
+    size_t pages, new_pages;
+
+    if (size <= mem->allocated) {
+        return;
+    }
+
+    pages = PAGES(mem->allocated);
+    mem->allocated = size * 2;
+    new_pages = PAGES(mem->allocated);
+    mem->data = lib_realloc(mem->data, mem->allocated);
+    mem->changed = lib_realloc(mem->changed, new_pages);
+    memset(mem->changed + pages, 0, new_pages - pages);
+}
+
+/* Store `num' bytes at `offset', leaving pages that already hold the same
+   data alone and flagging the ones that change.  */
+static void memory_store(snapshot_memory_t *mem, size_t offset, const uint8_t *src, size_t num)
+{
+    size_t n;
+
+    while (num > 0) {
+        n = SNAPSHOT_PAGE_SIZE - (offset & PAGE_MASK);
+        if (n > num) {
+            n = num;
+        }
+        if (offset + n > mem->old_size || memcmp(mem->data + offset, src, n) != 0) {
+            memcpy(mem->data + offset, src, n);
+            mem->changed[offset >> SNAPSHOT_PAGE_SHIFT] = 1;
+        }
+        offset += n;
+        src += n;
+        num -= n;
+    }
+}
 
+/* Forget everything known about the previous contents of a buffer after it
+   has been filled by other means than writing a snapshot.  */
+static void memory_forget(snapshot_memory_t *mem)
+{
+    mem->old_size = 0;
+    if (mem->arrays_max > 0) {
+        memset(mem->arrays, 0, mem->arrays_max * sizeof(snapshot_paged_array_t));
+    }
+}
+
+static int stream_write(snapshot_stream_t *f, const void *data, size_t num)
+{
+    snapshot_memory_t *mem = f->memory;
+
+    if (f->z != NULL) {
+        return zstream_write(f, data, num);
+    }
+    if (mem == NULL) {
+        return fwrite(data, num, 1, f->file) < 1 ? -1 : 0;
+    }
+
+    memory_reserve(mem, f->pos + num);
+    memory_store(mem, f->pos, data, num);
+    f->pos += num;
+    if (f->pos > mem->size) {
+        mem->size = f->pos;
+    }
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int stream_putc(snapshot_stream_t *f, uint8_t data)
 {
-    uint8_t *byte_data = (uint8_t *)&data;
-    int i;
+    snapshot_memory_t *mem = f->memory;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        if (snapshot_write_byte(f, byte_data[i]) < 0) {
-            return -1;
+    if (f->z != NULL) {
+        return zstream_write(f, &data, 1);
+    }
+    if (mem == NULL) {
+        return fputc(data, f->file) == EOF ? -1 : 0;
+    }
+
+    if (f->pos < mem->allocated) {
+        if (f->pos >= mem->old_size || mem->data[f->pos] != data) {
+            mem->data[f->pos] = data;
+            mem->changed[f->pos >> SNAPSHOT_PAGE_SHIFT] = 1;
+        }
+        f->pos++;
+        if (f->pos > mem->size) {
+            mem->size = f->pos;
         }
+        return 0;
+    }
+    return stream_write(f, &data, 1);
+}
+
+static int stream_read(snapshot_stream_t *f, void *data, size_t num)
+{
+    if (f->z != NULL) {
+        return zstream_read(f, data, num);
+    }
+    if (f->memory == NULL) {
+        return fread(data, num, 1, f->file) < 1 ? -1 : 0;
+    }
+    if (f->pos + num > f->memory->size) {
+        f->pos = f->memory->size;
+        return -1;
+    }
+    memcpy(data, f->memory->data + f->pos, num);
+    f->pos += num;
+    return 0;
+}
+
+static int stream_getc(snapshot_stream_t *f)
+{
+    uint8_t c;
+
+    if (f->z != NULL) {
+        return zstream_read(f, &c, 1) < 0 ? EOF : c;
+    }
+    if (f->memory == NULL) {
+        return fgetc(f->file);
+    }
+    if (f->pos >= f->memory->size) {
+        return EOF;
+    }
+    return f->memory->data[f->pos++];
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int snapshot_write_byte(snapshot_stream_t *f, uint8_t data)
+{
+    current_fpos = stream_tell(f);
+    if (stream_putc(f, data) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Write `num' already encoded bytes in one go.  */
+static int snapshot_write_bytes(snapshot_stream_t *f, const uint8_t *data, size_t num)
+{
+    current_fpos = stream_tell(f);
+    if (stream_write(f, data, num) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
     }
+
     return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
+static void encode_word(uint8_t *p, uint16_t data)
+{
+    p[0] = (uint8_t)(data & 0xff);
+    p[1] = (uint8_t)(data >> 8);
+}
+
+static void encode_dword(uint8_t *p, uint32_t data)
+{
+    encode_word(p, (uint16_t)(data & 0xffff));
+    encode_word(p + 2, (uint16_t)(data >> 16));
+}
+
+static int snapshot_write_word(snapshot_stream_t *f, uint16_t data)
+{
+    uint8_t buf[2];
+
+    encode_word(buf, data);
+    return snapshot_write_bytes(f, buf, sizeof(buf));
+}
+
+static int snapshot_write_dword(snapshot_stream_t *f, uint32_t data)
+{
+    uint8_t buf[4];
+
+    encode_dword(buf, data);
+    return snapshot_write_bytes(f, buf, sizeof(buf));
+}
+
+static int snapshot_write_qword(snapshot_stream_t *f, uint64_t data)
+{
+    uint8_t buf[8];
+
+    encode_dword(buf, (uint32_t)(data & 0xffffffff));
+    encode_dword(buf + 4, (uint32_t)(data >> 32));
+    return snapshot_write_bytes(f, buf, sizeof(buf));
+}
+
+static int snapshot_write_double(snapshot_stream_t *f, double data)
+{
+    return snapshot_write_bytes(f, (const uint8_t *)&data, sizeof(double));
+}
+
+static int snapshot_write_padded_string(snapshot_stream_t *f, const char *s, uint8_t pad_char,
                                         int len)
 {
     int i, found_zero;
     uint8_t c;
 
-    current_fpos = ftell(f);
+    current_fpos = stream_tell(f);
     for (i = found_zero = 0; i < len; i++) {
         if (!found_zero && s[i] == 0) {
             found_zero = 1;
@@ -175,10 +871,10 @@ static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_stream_t *f, const uint8_t *data, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
+    current_fpos = stream_tell(f);
+    if (num > 0 && stream_write(f, data, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -186,61 +882,74 @@ static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
+/* Word and dword arrays are encoded in chunks of this many bytes.  */
+#define ARRAY_CHUNK_SIZE 256
+
+static int snapshot_write_word_array(snapshot_stream_t *f, const uint16_t *data, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[ARRAY_CHUNK_SIZE];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_word(f, data[i]) < 0) {
+    while (num > 0) {
+        n = (num > ARRAY_CHUNK_SIZE / 2) ? ARRAY_CHUNK_SIZE / 2 : num;
+        for (i = 0; i < n; i++) {
+            encode_word(buf + i * 2, data[i]);
+        }
+        if (snapshot_write_bytes(f, buf, n * 2) < 0) {
             return -1;
         }
+        data += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_stream_t *f, const uint32_t *data, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[ARRAY_CHUNK_SIZE];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_dword(f, data[i]) < 0) {
+    while (num > 0) {
+        n = (num > ARRAY_CHUNK_SIZE / 4) ? ARRAY_CHUNK_SIZE / 4 : num;
+        for (i = 0; i < n; i++) {
+            encode_dword(buf + i * 4, data[i]);
+        }
+        if (snapshot_write_bytes(f, buf, n * 4) < 0) {
             return -1;
         }
+        data += n;
+        num -= n;
     }
 
     return 0;
 }
 
 
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_stream_t *f, const char *s)
 {
-    size_t len, i;
+    size_t len;
 
     len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
 
-    current_fpos = ftell(f);
+    current_fpos = stream_tell(f);
     if (snapshot_write_word(f, (uint16_t)len) < 0) {
         return -1;
     }
 
-    for (i = 0; i < len; i++) {
-        if (snapshot_write_byte(f, s[i]) < 0) {
-            return -1;
-        }
+    if (len > 0 && snapshot_write_bytes(f, (const uint8_t *)s, len) < 0) {
+        return -1;
     }
 
     return (int)(len + sizeof(uint16_t));
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static int snapshot_read_byte(snapshot_stream_t *f, uint8_t *b_return)
 {
     int c;
 
-    current_fpos = ftell(f);
-    c = fgetc(f);
+    current_fpos = stream_tell(f);
+    c = stream_getc(f);
     if (c == EOF) {
         snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
@@ -249,69 +958,73 @@ static int snapshot_read_byte(FILE *f, uint8_t *b_return)
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+/* Read `num' encoded bytes in one go.  */
+static int snapshot_read_bytes(snapshot_stream_t *f, uint8_t *data, size_t num)
 {
-    uint8_t lo, hi;
-
-    current_fpos = ftell(f);
-    if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0) {
+    current_fpos = stream_tell(f);
+    if (stream_read(f, data, num) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *w_return = lo | (hi << 8);
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static uint16_t decode_word(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t decode_dword(const uint8_t *p)
+{
+    return decode_word(p) | ((uint32_t)decode_word(p + 2) << 16);
+}
+
+static int snapshot_read_word(snapshot_stream_t *f, uint16_t *w_return)
 {
-    uint16_t lo, hi;
+    uint8_t buf[2];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0) {
+    if (snapshot_read_bytes(f, buf, sizeof(buf)) < 0) {
         return -1;
     }
 
-    *dw_return = lo | (hi << 16);
+    *w_return = decode_word(buf);
     return 0;
 }
 
-static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
+static int snapshot_read_dword(snapshot_stream_t *f, uint32_t *dw_return)
 {
-    uint32_t lo, hi;
+    uint8_t buf[4];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_dword(f, &lo) < 0 || snapshot_read_dword(f, &hi) < 0) {
+    if (snapshot_read_bytes(f, buf, sizeof(buf)) < 0) {
         return -1;
     }
 
-    *qw_return = lo | ((uint64_t)hi << 32);
+    *dw_return = decode_dword(buf);
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_qword(snapshot_stream_t *f, uint64_t *qw_return)
 {
-    int i;
-    int c;
-    double val;
-    uint8_t *byte_val = (uint8_t *)&val;
-
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
-        if (c == EOF) {
-            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
-            return -1;
-        }
-        byte_val[i] = (uint8_t)c;
+    uint8_t buf[8];
+
+    if (snapshot_read_bytes(f, buf, sizeof(buf)) < 0) {
+        return -1;
     }
-    *d_return = val;
+
+    *qw_return = decode_dword(buf) | ((uint64_t)decode_dword(buf + 4) << 32);
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+static int snapshot_read_double(snapshot_stream_t *f, double *d_return)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
+    return snapshot_read_bytes(f, (uint8_t *)d_return, sizeof(double));
+}
+
+static int snapshot_read_byte_array(snapshot_stream_t *f, uint8_t *b_return, unsigned int num)
+{
+    current_fpos = stream_tell(f);
+    if (num > 0 && stream_read(f, b_return, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -319,37 +1032,49 @@ static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num
     return 0;
 }
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_stream_t *f, uint16_t *w_return, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[ARRAY_CHUNK_SIZE];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_word(f, w_return + i) < 0) {
+    while (num > 0) {
+        n = (num > ARRAY_CHUNK_SIZE / 2) ? ARRAY_CHUNK_SIZE / 2 : num;
+        if (snapshot_read_bytes(f, buf, n * 2) < 0) {
             return -1;
         }
+        for (i = 0; i < n; i++) {
+            w_return[i] = decode_word(buf + i * 2);
+        }
+        w_return += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+static int snapshot_read_dword_array(snapshot_stream_t *f, uint32_t *dw_return, unsigned int num)
 {
-    unsigned int i;
+    uint8_t buf[ARRAY_CHUNK_SIZE];
+    unsigned int i, n;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_dword(f, dw_return + i) < 0) {
+    while (num > 0) {
+        n = (num > ARRAY_CHUNK_SIZE / 4) ? ARRAY_CHUNK_SIZE / 4 : num;
+        if (snapshot_read_bytes(f, buf, n * 4) < 0) {
             return -1;
         }
+        for (i = 0; i < n; i++) {
+            dw_return[i] = decode_dword(buf + i * 4);
+        }
+        dw_return += n;
+        num -= n;
     }
 
     return 0;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_stream_t *f, char **s)
 {
-    int i, len;
+    int len;
     uint16_t w;
     char *p = NULL;
 
@@ -357,7 +1082,7 @@ static int snapshot_read_string(FILE *f, char **s)
     lib_free(*s);
     *s = NULL;      /* don't leave a bogus pointer */
 
-    current_fpos = ftell(f);
+    current_fpos = stream_tell(f);
     if (snapshot_read_word(f, &w) < 0) {
         return -1;
     }
@@ -368,11 +1093,9 @@ static int snapshot_read_string(FILE *f, char **s)
         p = lib_malloc(len);
         *s = p;
 
-        for (i = 0; i < len; i++) {
-            if (snapshot_read_byte(f, (uint8_t *)(p + i)) < 0) {
-                p[0] = 0;
-                return -1;
-            }
+        if (snapshot_read_bytes(f, (uint8_t *)p, (size_t)len) < 0) {
+            p[0] = 0;
+            return -1;
         }
         p[len - 1] = 0;   /* just to be save */
     }
@@ -383,7 +1106,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
+    if (snapshot_write_byte(m->stream, b) < 0) {
         return -1;
     }
 
@@ -393,7 +1116,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
+    if (snapshot_write_word(m->stream, w) < 0) {
         return -1;
     }
 
@@ -403,7 +1126,7 @@ int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
+    if (snapshot_write_dword(m->stream, dw) < 0) {
         return -1;
     }
 
@@ -413,7 +1136,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 
 int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 {
-    if (snapshot_write_qword(m->file, qw) < 0) {
+    if (snapshot_write_qword(m->stream, qw) < 0) {
         return -1;
     }
 
@@ -423,7 +1146,7 @@ int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->stream, db) < 0) {
         return -1;
     }
 
@@ -433,7 +1156,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
+    if (snapshot_write_padded_string(m->stream, s, (uint8_t)pad_char, len) < 0) {
         return -1;
     }
 
@@ -443,7 +1166,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uin
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
+    if (snapshot_write_byte_array(m->stream, b, num) < 0) {
         return -1;
     }
 
@@ -451,9 +1174,75 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, uns
     return 0;
 }
 
+/** \brief  Write a large byte array with page write stamps
+ *
+ * Like snapshot_module_write_byte_array(), but when writing a memory snapshot
+ * into the same buffer as before, pages whose stamp in \a stamps shows they
+ * have not been written since the previous save are skipped entirely.
+ * \a stamps holds one entry per SNAPSHOT_PAGE_SIZE bytes of \a b and is
+ * maintained with SNAPSHOT_PAGE_TOUCH() by whoever writes to \a b.
+ *
+ * \param[in]   m       snapshot module
+ * \param[in]   b       data to write
+ * \param[in]   num     number of bytes in \a b
+ * \param[in]   stamps  page write stamps for \a b
+ *
+ * \return 0 on success, -1 on error
+ */
+int snapshot_module_write_byte_array_paged(snapshot_module_t *m, const uint8_t *b, unsigned int num, const uint32_t *stamps)
+{
+    snapshot_stream_t *f = m->stream;
+    snapshot_memory_t *mem = f->memory;
+    snapshot_paged_array_t *rec;
+    size_t offset, n;
+    unsigned int page;
+
+    if (mem == NULL || memory_target == NULL || stamps == NULL) {
+        return snapshot_module_write_byte_array(m, b, num);
+    }
+
+    if (mem->arrays_next == mem->arrays_max) {
+        mem->arrays_max += 4;
+        mem->arrays = lib_realloc(mem->arrays, mem->arrays_max * sizeof(snapshot_paged_array_t));
+        memset(mem->arrays + mem->arrays_next, 0, 4 * sizeof(snapshot_paged_array_t));
+    }
+    rec = &mem->arrays[mem->arrays_next++];
+    offset = f->pos;
+    current_fpos = offset;
+
+    if (rec->data == b && rec->num == num && rec->offset == offset
+        && rec->serial == read_serial && offset + num <= mem->old_size) {
+        for (page = 0; page < PAGES(num); page++) {
+            if (stamps[page] > rec->generation) {
+                n = num - ((size_t)page << SNAPSHOT_PAGE_SHIFT);
+                if (n > SNAPSHOT_PAGE_SIZE) {
+                    n = SNAPSHOT_PAGE_SIZE;
+                }
+                memory_store(mem, offset + ((size_t)page << SNAPSHOT_PAGE_SHIFT),
+                             b + ((size_t)page << SNAPSHOT_PAGE_SHIFT), n);
+            }
+        }
+        f->pos += num;
+        if (f->pos > mem->size) {
+            mem->size = f->pos;
+        }
+        m->size += num;
+    } else if (snapshot_module_write_byte_array(m, b, num) < 0) {
+        rec->data = NULL;
+        return -1;
+    }
+
+    rec->data = b;
+    rec->num = num;
+    rec->offset = offset;
+    rec->generation = snapshot_page_generation++;
+    rec->serial = read_serial;
+    return 0;
+}
+
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
+    if (snapshot_write_word_array(m->stream, w, num) < 0) {
         return -1;
     }
 
@@ -463,7 +1252,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, un
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
+    if (snapshot_write_dword_array(m->stream, dw, num) < 0) {
         return -1;
     }
 
@@ -474,7 +1263,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->stream, s);
     if (len < 0) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
@@ -488,100 +1277,100 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(uint8_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->stream, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->stream, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(uint32_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->stream, dw_return);
 }
 
 int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint64_t) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(uint64_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_qword(m->file, qw_return);
+    return snapshot_read_qword(m->stream, qw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(double) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->stream, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
+    current_fpos = stream_tell(m->stream);
+    if ((long)(stream_tell(m->stream) + num) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    return snapshot_read_byte_array(m->stream, b_return, num);
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
+    if ((long)(stream_tell(m->stream) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->stream, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
+    current_fpos = stream_tell(m->stream);
+    if ((long)(stream_tell(m->stream) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->stream, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = stream_tell(m->stream);
+    if (stream_tell(m->stream) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->stream, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -680,9 +1469,13 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
 
     current_module = (char *)name;
 
+    if (s->stream.zthreads > 1) {
+        zstream_begin_module(&s->stream);
+    }
+
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
+    m->stream = &s->stream;
+    m->offset = stream_tell(&s->stream);
     if (m->offset == -1) {
         snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
         lib_free(m);
@@ -690,67 +1483,129 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     }
     m->write_mode = 1;
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
+    if (snapshot_write_padded_string(&s->stream, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_write_byte(&s->stream, major_version) < 0
+        || snapshot_write_byte(&s->stream, minor_version) < 0
+        || snapshot_write_dword(&s->stream, 0) < 0) {
         return NULL;
     }
 
-    m->size = (uint32_t)(ftell(s->file) - m->offset);
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size = (uint32_t)(stream_tell(&s->stream) - m->offset);
+    m->size_offset = stream_tell(&s->stream) - sizeof(uint32_t);
+    m->stored_size = 0;
+
+    if (s->stream.zthreads == 1
+        && (snapshot_write_dword(&s->stream, 0) < 0
+            || zstream_begin_write(&s->stream, m->offset + m->size, s->stream.compression) < 0)) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        lib_free(m);
+        return NULL;
+    }
 
     return m;
 }
 
+/* Walk the module headers once and remember where each module starts.  */
+static void snapshot_index_modules(snapshot_t *s)
+{
+    snapshot_stream_t *f = &s->stream;
+    int index_max = 32;
+    long offset = s->first_module_offset;
+    uint8_t version;
+    uint32_t size;
+
+    s->index = lib_malloc(index_max * sizeof(snapshot_module_index_t));
+    s->index_num = 0;
+
+    while (stream_seek(f, offset) == 0) {
+        if (s->index_num == index_max) {
+            index_max *= 2;
+            s->index = lib_realloc(s->index, index_max * sizeof(snapshot_module_index_t));
+        }
+        if (snapshot_read_byte_array(f, (uint8_t *)s->index[s->index_num].name,
+                                     SNAPSHOT_MODULE_NAME_LEN) < 0
+            || snapshot_read_byte(f, &version) < 0
+            || snapshot_read_byte(f, &version) < 0
+            || snapshot_read_dword(f, &size) < 0
+            || size < MODULE_HEADER_SIZE) {
+            break;
+        }
+        s->index[s->index_num++].offset = offset;
+        offset += size;
+    }
+}
+
 snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
 {
     snapshot_module_t *m;
     char n[SNAPSHOT_MODULE_NAME_LEN];
     unsigned int name_len = (unsigned int)strlen(name);
+    int i;
 
     current_module = (char *)name;
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
+    /* a module that was not closed */
+    if (s->stream.z != NULL) {
+        zstream_end_read(&s->stream);
+    }
+
+    if (stream_seek(&s->stream, s->first_module_offset) < 0) {
         snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
         DBG(("snapshot_module_open error: name: '%s' NOT found", name));
         return NULL;
     }
 
+    if (s->index == NULL) {
+        snapshot_index_modules(s);
+    }
+
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m->stream = &s->stream;
     m->write_mode = 0;
 
-    m->offset = s->first_module_offset;
-
     DBG(("snapshot_module_open name: '%s'", name));
 
-    /* Search for the module name.  This is quite inefficient, but I don't
-       think we care.  */
-    while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
-                                     SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
-            snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
-            goto fail;
-        }
+    /* Look up the module name, the first module of that name wins.  */
+    for (i = 0; i < s->index_num; i++) {
+        const char *index_name = s->index[i].name;
 
-        /* Found?  */
-        if (memcmp(n, name, name_len) == 0
-            && (name_len == SNAPSHOT_MODULE_NAME_LEN || n[name_len] == 0)) {
+        if (memcmp(index_name, name, name_len) == 0
+            && (name_len == SNAPSHOT_MODULE_NAME_LEN || index_name[name_len] == 0)) {
             break;
         }
+    }
+    if (i == s->index_num) {
+        /* same error as running into the end of the snapshot */
+        snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
+        goto fail;
+    }
+
+    m->offset = s->index[i].offset;
+    if (stream_seek(&s->stream, m->offset) < 0
+        || snapshot_read_byte_array(&s->stream, (uint8_t *)n,
+                                    SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_read_byte(&s->stream, major_version_return) < 0
+        || snapshot_read_byte(&s->stream, minor_version_return) < 0
+        || snapshot_read_dword(&s->stream, &m->size)) {
+        snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
+        goto fail;
+    }
 
-        m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
-            snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
+    m->size_offset = stream_tell(&s->stream) - sizeof(uint32_t);
+    m->stored_size = m->size;
+
+    if (s->stream.compression) {
+        long header_size = stream_tell(&s->stream) - m->offset;
+
+        if (snapshot_read_dword(&s->stream, &m->size) < 0
+            || m->stored_size < header_size + sizeof(uint32_t)
+            || m->size < header_size
+            || zstream_begin_read(&s->stream, m->offset + header_size,
+                                  m->stored_size - (uint32_t)header_size - sizeof(uint32_t)) < 0) {
+            snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
             goto fail;
         }
     }
-
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
 #if 0
     /* HACK: if any of the errors *this* function can produce is still pending
              in snapshot_error, clear it out - else we might fail for no reason
@@ -766,7 +1621,7 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     return m;
 
 fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
+    stream_seek(&s->stream, s->first_module_offset);
     lib_free(m);
     DBG(("snapshot_module_open error: name: '%s' NOT found", name));
     return NULL;
@@ -774,23 +1629,53 @@ fail:
 
 int snapshot_module_close(snapshot_module_t *m)
 {
+    long end = m->offset + m->size;
+
     DBG(("snapshot_module_close name: '%s'", current_module));
-    /* Backpatch module size if writing.  */
-    if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
+
+    if (m->stream->z != NULL) {
+        if (m->write_mode) {
+            /* Finish the compressed payload, then backpatch both sizes.  */
+            if (zstream_end_write(m->stream) < 0
+                || (end = stream_tell(m->stream)) == -1
+                || stream_seek(m->stream, m->size_offset) < 0
+                || snapshot_write_dword(m->stream, (uint32_t)(end - m->offset)) < 0
+                || snapshot_write_dword(m->stream, m->size) < 0) {
+                snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
+                DBG(("snapshot_module_close error"));
+                return -1;
+            }
+        } else {
+            zstream_end_read(m->stream);
+            end = m->offset + m->stored_size;
+        }
+    } else if (m->write_mode
+        && (stream_seek(m->stream, m->size_offset) < 0
+            || snapshot_write_dword(m->stream, m->size) < 0)) {
         snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
         DBG(("snapshot_module_close error"));
         return -1;
     }
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
+    if (stream_seek(m->stream, end) < 0) {
         snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
         DBG(("snapshot_module_close error"));
         return -1;
     }
 
+    /* The module of a compressed snapshot is complete, queue it.  */
+    if (m->write_mode && m->stream->zthreads > 1) {
+        m->stream->memory = NULL;
+        m->stream->zpending += m->size;
+        if (m->stream->zpending >= ZPENDING_MAX && zstream_flush_modules(m->stream) < 0) {
+            snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+            DBG(("snapshot_module_close error"));
+            lib_free(m);
+            return -1;
+        }
+    }
+
     lib_free(m);
     DBG(("snapshot_module_close ok"));
     return 0;
@@ -800,20 +1685,48 @@ int snapshot_module_close(snapshot_module_t *m)
 
 snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
 {
-    FILE *f;
+    snapshot_stream_t *f;
     snapshot_t *s;
     unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
     current_filename = (char *)filename;
 
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
+    s = lib_malloc(sizeof(snapshot_t));
+    f = &s->stream;
+    f->file = NULL;
+    f->memory = memory_target;
+    f->pos = 0;
+    f->z = NULL;
+    f->zbuf = NULL;
+    f->zmodules = NULL;
+    f->zmodules_num = 0;
+    f->zmodules_max = 0;
+    f->zpending = 0;
+    f->map = NULL;
+    f->map_size = 0;
+    s->index = NULL;
+    s->index_num = 0;
+
+    /* Memory snapshots are never compressed.  */
+    f->compression = memory_target != NULL ? 0 : snapshot_compression;
+    f->zthreads = f->compression > 0 ? zstream_threads() : 0;
+
+    if (memory_target != NULL) {
+        memory_target->old_size = memory_target->size;
+        memory_target->size = 0;
+        memory_target->arrays_next = 0;
+    } else {
+        f->file = fopen(filename, MODE_WRITE);
+        if (f->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(f, f->compression > 0 ? snapshot_deflate_magic_string : snapshot_magic_string,
+                                     (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
         goto fail;
     }
@@ -850,16 +1763,17 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
         goto fail;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
+    s->first_module_offset = stream_tell(f);
     s->write_mode = 1;
 
     return s;
 
 fail:
-    fclose(f);
-    archdep_remove(filename);
+    if (f->file != NULL) {
+        fclose(f->file);
+        archdep_remove(filename);
+    }
+    lib_free(s);
     return NULL;
 }
 
@@ -869,25 +1783,56 @@ static uint32_t snapshot_vicerevision;
 
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
 {
-    FILE *f;
+    snapshot_stream_t *f;
     char magic[SNAPSHOT_MAGIC_LEN];
     snapshot_t *s = NULL;
     int machine_name_len;
-    size_t offs;
+    long offs;
 
     current_machine_name = (char *)snapshot_machine_name;
     current_filename = (char *)filename;
     current_module = NULL;
+    read_serial++;
 
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
-        return NULL;
+    s = lib_malloc(sizeof(snapshot_t));
+    f = &s->stream;
+    f->file = NULL;
+    f->memory = memory_target;
+    f->pos = 0;
+    f->z = NULL;
+    f->zbuf = NULL;
+    f->zmodules = NULL;
+    f->zmodules_num = 0;
+    f->zmodules_max = 0;
+    f->zpending = 0;
+    f->zthreads = 0;
+    f->map = NULL;
+    f->map_size = 0;
+    s->index = NULL;
+    s->index_num = 0;
+
+    if (memory_target == NULL) {
+        f->file = zfile_fopen(filename, MODE_READ);
+        if (f->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
-        || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
+    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0) {
+        snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
+        goto fail;
+    }
+    if (memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) == 0) {
+        f->compression = 0;
+        if (f->file != NULL) {
+            stream_map(f);
+        }
+    } else if (memcmp(magic, snapshot_deflate_magic_string, SNAPSHOT_MAGIC_LEN) == 0 && f->file != NULL) {
+        f->compression = 1;
+    } else {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
         goto fail;
     }
@@ -917,12 +1862,12 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = stream_tell(f);
 
     if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        stream_seek(f, offs);
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
@@ -936,34 +1881,65 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
         }
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
+    s->first_module_offset = stream_tell(f);
     s->write_mode = 0;
 
-    vsync_suspend_speed_eval();
+    /* Memory snapshots are used to rewind the emulation without the user
+       noticing, so leave the speed evaluation alone for those.  */
+    if (f->file != NULL) {
+        vsync_suspend_speed_eval();
+    }
     return s;
 
 fail:
-    fclose(f);
+    stream_unmap(f);
+    if (f->file != NULL) {
+        fclose(f->file);
+    }
+    lib_free(s);
     return NULL;
 }
 
 int snapshot_close(snapshot_t *s)
 {
     int retval;
+    int flush_err = 0;
+
+    /* a module that was not closed */
+    if (s->stream.z != NULL) {
+        if (s->write_mode) {
+            zstream_end_write(&s->stream);
+        } else {
+            zstream_end_read(&s->stream);
+        }
+    }
+    lib_free(s->stream.zbuf);
+    lib_free(s->index);
+    stream_unmap(&s->stream);
+
+    /* write out the rest of a compressed snapshot */
+    if (s->write_mode && s->stream.zthreads > 1) {
+        s->stream.memory = NULL;
+        flush_err = zstream_flush_modules(&s->stream);
+        lib_free(s->stream.zmodules);
+    }
 
-    if (!s->write_mode) {
-        if (zfile_fclose(s->file) == EOF) {
+    if (s->stream.file == NULL) {
+        retval = 0;
+    } else if (!s->write_mode) {
+        if (zfile_fclose(s->stream.file) == EOF) {
             snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
             retval = -1;
         } else {
             retval = 0;
         }
     } else {
-        if (fclose(s->file) == EOF) {
+        if (fclose(s->stream.file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
             retval = -1;
+        } else if (flush_err < 0) {
+            snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+            retval = -1;
         } else {
             retval = 0;
         }
@@ -973,6 +1949,273 @@ int snapshot_close(snapshot_t *s)
     return retval;
 }
 
+/* ------------------------------------------------------------------------- */
+
+static int set_snapshot_compression(int val, void *param)
+{
+    if (val < 0 || val > Z_BEST_COMPRESSION) {
+        return -1;
+    }
+
+    snapshot_compression = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "SnapshotCompression", 0, RES_EVENT_NO, NULL,
+      &snapshot_compression, set_snapshot_compression, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int snapshot_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-snapshotcompression", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SnapshotCompression", NULL,
+      "<level>", "Compress the modules of snapshot files (0: off (default), 1: fastest .. 9: smallest)" },
+    CMDLINE_LIST_END
+};
+
+int snapshot_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  Allocate an empty memory snapshot buffer */
+snapshot_memory_t *snapshot_memory_new(void)
+{
+    return lib_calloc(1, sizeof(snapshot_memory_t));
+}
+
+/** \brief  Free a memory snapshot buffer */
+void snapshot_memory_free(snapshot_memory_t *mem)
+{
+    if (mem != NULL) {
+        if (memory_target == mem) {
+            memory_target = NULL;
+        }
+        lib_free(mem->data);
+        lib_free(mem->changed);
+        lib_free(mem->arrays);
+        lib_free(mem);
+    }
+}
+
+/** \brief  Redirect snapshot_create() and snapshot_open() to memory
+ *
+ * While \a mem is set the filename passed to snapshot_create() and
+ * snapshot_open() is ignored, and the snapshot is written to, or read from,
+ * \a mem instead. This allows the machine_write_snapshot() and
+ * machine_read_snapshot() paths to be used without touching the filesystem.
+ *
+ * \param[in]   mem     memory buffer, or NULL to go back to files
+ */
+void snapshot_memory_redirect(snapshot_memory_t *mem)
+{
+    memory_target = mem;
+}
+
+/** \brief  Get the number of bytes held by a memory snapshot buffer */
+size_t snapshot_memory_size(snapshot_memory_t *mem)
+{
+    return mem->size;
+}
+
+/** \brief  Get the contents of a memory snapshot buffer
+ *
+ * \param[in]   mem     memory snapshot buffer
+ *
+ * \return snapshot_memory_size() bytes of snapshot data
+ */
+const uint8_t *snapshot_memory_data(snapshot_memory_t *mem)
+{
+    return mem->data;
+}
+
+/** \brief  Prepare a memory snapshot buffer to be filled by the caller
+ *
+ * Used to put a snapshot that was stored elsewhere back into a buffer, so it
+ * can be read with snapshot_memory_redirect().
+ *
+ * \param[in]   mem     memory snapshot buffer
+ * \param[in]   size    size of the snapshot
+ *
+ * \return pointer to \a size bytes to be filled in
+ */
+uint8_t *snapshot_memory_fill(snapshot_memory_t *mem, size_t size)
+{
+    memory_reserve(mem, size);
+    memory_forget(mem);
+    if (size > 0) {
+        memset(mem->changed, 1, PAGES(size));
+    }
+    mem->size = size;
+    return mem->data;
+}
+
+/*
+    Delta snapshots
+
+    A buffer that snapshots are written to over and over keeps track of the
+    pages that changed since its last keyframe. snapshot_memory_delta() then
+    stores only those pages, and snapshot_memory_apply_delta() rebuilds the
+    full snapshot from the keyframe and the delta. Deltas only live in
+    memory, so they use the host layout:
+
+        size_t  size of the full snapshot
+        size_t  first page, size_t number of pages, page data... (repeated)
+*/
+
+/* Append raw bytes to a buffer that is not a snapshot write target.  */
+static void memory_append(snapshot_memory_t *mem, const void *data, size_t num)
+{
+    memory_reserve(mem, mem->size + num);
+    memcpy(mem->data + mem->size, data, num);
+    mem->size += num;
+}
+
+/** \brief  Copy a snapshot to \a keyframe and start a new delta run
+ *
+ * \param[in,out]  mem         buffer snapshots are being written to
+ * \param[out]     keyframe    receives a full copy of \a mem
+ */
+void snapshot_memory_keyframe(snapshot_memory_t *mem, snapshot_memory_t *keyframe)
+{
+    keyframe->size = 0;
+    memory_append(keyframe, mem->data, mem->size);
+    memory_forget(keyframe);
+    if (mem->allocated > 0) {
+        memset(mem->changed, 0, PAGES(mem->allocated));
+    }
+}
+
+/** \brief  Store the pages changed since the last keyframe in \a delta
+ *
+ * \param[in]      mem     buffer snapshots are being written to
+ * \param[out]     delta   receives the delta, previous contents are lost
+ */
+void snapshot_memory_delta(snapshot_memory_t *mem, snapshot_memory_t *delta)
+{
+    size_t page, first, count, pages, start, len;
+
+    delta->size = 0;
+    memory_append(delta, &mem->size, sizeof(size_t));
+
+    pages = PAGES(mem->size);
+    for (page = 0; page < pages; page++) {
+        if (!mem->changed[page]) {
+            continue;
+        }
+        first = page;
+        while (page < pages && mem->changed[page]) {
+            page++;
+        }
+        count = page - first;
+        start = first << SNAPSHOT_PAGE_SHIFT;
+        len = count << SNAPSHOT_PAGE_SHIFT;
+        if (start + len > mem->size) {
+            len = mem->size - start;
+        }
+        memory_append(delta, &first, sizeof(size_t));
+        memory_append(delta, &count, sizeof(size_t));
+        memory_append(delta, mem->data + start, len);
+    }
+    memory_forget(delta);
+}
+
+/** \brief  Rebuild a full snapshot from a keyframe and a delta
+ *
+ * \a dst may be the buffer the keyframe was taken from, in which case it
+ * carries on tracking changes relative to \a keyframe.
+ *
+ * \param[out]     dst         receives the full snapshot
+ * \param[in]      keyframe    keyframe the delta was taken against
+ * \param[in]      delta       delta from snapshot_memory_delta()
+ *
+ * \return 0 on success, -1 if \a delta is corrupt
+ */
+int snapshot_memory_apply_delta(snapshot_memory_t *dst, const snapshot_memory_t *keyframe, const snapshot_memory_t *delta)
+{
+    size_t size, first, count, start, len, pos;
+
+    if (delta->size < sizeof(size_t)) {
+        return -1;
+    }
+    memcpy(&size, delta->data, sizeof(size_t));
+
+    memory_reserve(dst, size);
+    memcpy(dst->data, keyframe->data, keyframe->size < size ? keyframe->size : size);
+    dst->size = size;
+    memory_forget(dst);
+    if (dst->allocated > 0) {
+        memset(dst->changed, 0, PAGES(dst->allocated));
+    }
+    /* pages past the end of the keyframe exist only in the delta */
+    for (first = keyframe->size >> SNAPSHOT_PAGE_SHIFT; first < PAGES(size); first++) {
+        dst->changed[first] = 1;
+    }
+
+    pos = sizeof(size_t);
+    while (pos < delta->size) {
+        if (pos + 2 * sizeof(size_t) > delta->size) {
+            return -1;
+        }
+        memcpy(&first, delta->data + pos, sizeof(size_t));
+        memcpy(&count, delta->data + pos + sizeof(size_t), sizeof(size_t));
+        pos += 2 * sizeof(size_t);
+        if (count == 0 || first + count > PAGES(size)) {
+            return -1;
+        }
+        start = first << SNAPSHOT_PAGE_SHIFT;
+        len = count << SNAPSHOT_PAGE_SHIFT;
+        if (len > size - start) {
+            len = size - start;
+        }
+        if (pos + len > delta->size) {
+            return -1;
+        }
+        memcpy(dst->data + start, delta->data + pos, len);
+        memset(dst->changed + first, 1, count);
+        pos += len;
+    }
+    dst->old_size = size;
+    return 0;
+}
+
+/** \brief  Allocate or resize page write stamps for \a size bytes
+ *
+ * All pages are marked as written.
+ *
+ * \param[in]   stamps  stamps to resize, or NULL
+ * \param[in]   size    size of the memory the stamps describe
+ *
+ * \return new stamps
+ */
+uint32_t *snapshot_pages_realloc(uint32_t *stamps, unsigned int size)
+{
+    stamps = lib_realloc(stamps, (PAGES((size_t)size) + 1) * sizeof(uint32_t));
+    snapshot_pages_touch_all(stamps, size);
+    return stamps;
+}
+
+/** \brief  Mark all pages of \a size bytes as written */
+void snapshot_pages_touch_all(uint32_t *stamps, unsigned int size)
+{
+    size_t i;
+
+    if (stamps != NULL) {
+        for (i = 0; i < PAGES((size_t)size); i++) {
+            stamps[i] = snapshot_page_generation;
+        }
+    }
+}
+
 static void display_error_with_vice_version(char *text, char *filename)
 {
     char *vmessage = lib_malloc(0x100);
@@ -67,6 +67,10 @@
 
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
+typedef struct snapshot_memory_s snapshot_memory_t;
+
+int snapshot_resources_init(void);
+int snapshot_cmdline_options_init(void);
 
 void snapshot_display_error(void);
 
@@ -77,6 +81,7 @@ int snapshot_module_write_qword(snapshot_module_t *m, uint64_t data);
 int snapshot_module_write_double(snapshot_module_t *m, double db);
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len);
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *data, unsigned int num);
+int snapshot_module_write_byte_array_paged(snapshot_module_t *m, const uint8_t *data, unsigned int num, const uint32_t *stamps);
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *data, unsigned int num);
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *data, unsigned int num);
 int snapshot_module_write_string(snapshot_module_t *m, const char *s);
@@ -106,6 +111,7 @@ int snapshot_module_read_qword_into_int64(snapshot_module_t *m, int64_t *value_r
 #define SMW_DB       snapshot_module_write_double
 #define SMW_PSTR     snapshot_module_write_padded_string
 #define SMW_BA       snapshot_module_write_byte_array
+#define SMW_BAP      snapshot_module_write_byte_array_paged
 #define SMW_WA       snapshot_module_write_word_array
 #define SMW_DWA      snapshot_module_write_dword_array
 #define SMW_STR      snapshot_module_write_string
@@ -136,6 +142,30 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name);
 int snapshot_close(snapshot_t *s);
 
+snapshot_memory_t *snapshot_memory_new(void);
+void snapshot_memory_free(snapshot_memory_t *mem);
+void snapshot_memory_redirect(snapshot_memory_t *mem);
+size_t snapshot_memory_size(snapshot_memory_t *mem);
+const uint8_t *snapshot_memory_data(snapshot_memory_t *mem);
+uint8_t *snapshot_memory_fill(snapshot_memory_t *mem, size_t size);
+void snapshot_memory_keyframe(snapshot_memory_t *mem, snapshot_memory_t *keyframe);
+void snapshot_memory_delta(snapshot_memory_t *mem, snapshot_memory_t *delta);
+int snapshot_memory_apply_delta(snapshot_memory_t *dst, const snapshot_memory_t *keyframe, const snapshot_memory_t *delta);
+
+/* Page write stamps for large memories (REU, GeoRAM, ...), so that memory
+   snapshots can skip the pages that were not written since the last save.
+   Every store into the memory has to go through SNAPSHOT_PAGE_TOUCH().  */
+#define SNAPSHOT_PAGE_SHIFT 8
+#define SNAPSHOT_PAGE_SIZE  (1 << SNAPSHOT_PAGE_SHIFT)
+
+extern uint32_t snapshot_page_generation;
+
+#define SNAPSHOT_PAGE_TOUCH(stamps, offset) \
+    ((stamps)[(offset) >> SNAPSHOT_PAGE_SHIFT] = snapshot_page_generation)
+
+uint32_t *snapshot_pages_realloc(uint32_t *stamps, unsigned int size);
+void snapshot_pages_touch_all(uint32_t *stamps, unsigned int size);
+
 void snapshot_set_error(int error);
 int snapshot_get_error(void);
 
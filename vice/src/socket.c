@@ -213,12 +213,13 @@ static unsigned short htons(unsigned short ip)
 /*! \internal \brief a memory pool for network addresses */
 static vice_network_socket_address_t address_pool[16];
 /*! \internal \brief usage bit pattern for address_pool */
-static unsigned int address_pool_usage = 0;
+static uint64_t address_pool_usage = 0;
 
-/*! \internal \brief a memory pool for sockets */
-static vice_network_socket_t socket_pool[16];
+/*! \internal \brief a memory pool for sockets, large enough for the
+    spectators of netplay besides everything else */
+static vice_network_socket_t socket_pool[64];
 /*! \internal \brief usage bit pattern for socket_pool */
-static unsigned int socket_pool_usage = 0;
+static uint64_t socket_pool_usage = 0;
 
 /*! \internal \brief Get the next free entry of a pool
 
@@ -226,6 +227,9 @@ static unsigned int socket_pool_usage = 0;
      Pointer to a bit pattern that contains the allocations
      of the pool.
 
+  \param PoolSize
+     Number of entries in the pool.
+
   \return
      The next free pool entry, or -1 if there is none left.
 
@@ -234,40 +238,20 @@ static unsigned int socket_pool_usage = 0;
 
   \remark
      In the current implementation, this function is restricted
-     to 16 entries.
+     to 64 entries.
 */
-static int get_new_pool_entry(unsigned int * PoolUsage)
+static int get_new_pool_entry(uint64_t * PoolUsage, int PoolSize)
 {
-    int next_free = -1;
-
-    static const int nextentry[] = {
-        0, 1, 0, 2, 0, 1, 0, 3,
-        0, 1, 0, 2, 0, 1, 0, -1
-    };
-
-    next_free = nextentry[*PoolUsage & 0x0f];
-    if (next_free < 0) {
-        next_free = nextentry[(*PoolUsage >> 4) & 0x0f];
-        if (next_free >= 0) {
-            next_free += 4;
-        } else {
-            next_free = nextentry[(*PoolUsage >> 8) & 0x0f];
-            if (next_free >= 0) {
-                next_free += 8;
-            } else {
-                next_free = nextentry[(*PoolUsage >> 12) & 0x0f];
-                if (next_free >= 0) {
-                    next_free += 12;
-                }
-            }
-        }
-    }
+    int next_free;
 
-    if (next_free >= 0) {
-        *PoolUsage |= 1u << next_free;
+    for (next_free = 0; next_free < PoolSize; next_free++) {
+        if (!(*PoolUsage & ((uint64_t)1 << next_free))) {
+            *PoolUsage |= (uint64_t)1 << next_free;
+            return next_free;
+        }
     }
 
-    return next_free;
+    return -1;
 }
 
 /*! \internal \brief Get a free memory area for a socket
@@ -286,7 +270,7 @@ static int get_new_pool_entry(unsigned int * PoolUsage)
 static vice_network_socket_t * vice_network_alloc_new_socket(SOCKET sockfd)
 {
     vice_network_socket_t * return_address = NULL;
-    int i = get_new_pool_entry(&socket_pool_usage);
+    int i = get_new_pool_entry(&socket_pool_usage, (int)arraysize(socket_pool));
 
     if (i >= arraysize(socket_pool)) {
         i = -1;
@@ -367,7 +351,7 @@ static void initialize_socket_address(vice_network_socket_address_t * address)
 static vice_network_socket_address_t * vice_network_alloc_new_socket_address(void)
 {
     vice_network_socket_address_t * return_address = NULL;
-    int i = get_new_pool_entry(&address_pool_usage);
+    int i = get_new_pool_entry(&address_pool_usage, (int)arraysize(address_pool));
 
     if (i >= arraysize(address_pool)) {
         i = -1;
@@ -909,10 +893,10 @@ void vice_network_address_close(vice_network_socket_address_t * address)
 {
     if (address) {
         assert(address->used == 1);
-        assert(((address_pool_usage & (1u << (address - address_pool))) != 0));
+        assert(((address_pool_usage & ((uint64_t)1 << (address - address_pool))) != 0));
 
         address->used = 0;
-        address_pool_usage &= ~(1u << (address - address_pool));
+        address_pool_usage &= ~((uint64_t)1 << (address - address_pool));
     }
 }
 
@@ -959,10 +943,10 @@ int vice_network_socket_close(vice_network_socket_t * sockfd)
         localsockfd = sockfd->sockfd;
 
         assert(sockfd->used == 1);
-        assert(((socket_pool_usage & (1u << (sockfd - socket_pool))) != 0));
+        assert(((socket_pool_usage & ((uint64_t)1 << (sockfd - socket_pool))) != 0));
 
         sockfd->used = 0;
-        socket_pool_usage &= ~(1u << (sockfd - socket_pool));
+        socket_pool_usage &= ~((uint64_t)1 << (sockfd - socket_pool));
 
         error = closesocket(localsockfd);
     }
@@ -1080,6 +1064,30 @@ int vice_network_select_poll_one(vice_network_socket_t * readsockfd)
     return select( readsockfd->sockfd + 1, &fdsockset, NULL, NULL, &timeout);
 }
 
+/*! \brief Check if data can be sent on a socket
+
+  This function is called in order to determine if some
+  data can be sent on a socket without blocking.
+
+  \param writesockfd
+     The connected socket to test
+
+  \return
+     1 if the specified socket can take data; 0 if it can not,
+     and -1 in case of an error.
+*/
+int vice_network_select_poll_write_one(vice_network_socket_t * writesockfd)
+{
+    TIMEVAL timeout = { 0, 0 };
+
+    fd_set fdsockset;
+
+    FD_ZERO(&fdsockset);
+    FD_SET(writesockfd->sockfd, &fdsockset);
+
+    return select( writesockfd->sockfd + 1, NULL, &fdsockset, NULL, &timeout);
+}
+
 /*! \brief Monitor multiple sockets
 
   This function blocks for many different connections and returns when any
@@ -41,6 +41,7 @@
 #endif
 
 #include "archdep.h"
+#include "benchmark.h"
 #include "cmdline.h"
 #include "debug.h"
 #include "fixpoint.h"
@@ -49,7 +50,9 @@
 #include "machine.h"
 #include "maincpu.h"
 #include "mainlock.h"
+#include "metrics.h"
 #include "monitor.h"
+#include "perfcounters.h"
 #include "resources.h"
 #include "sound.h"
 #include "types.h"
@@ -131,6 +134,11 @@ static const sound_register_devices_t sound_register_devices[] = {
        works, no files will be created accidently */
     { "dummy", "Dummy sound output (no sound)", sound_init_dummy_device, SOUND_PLAYBACK_DEVICE },
 
+#ifdef USE_HEADLESSUI
+    /* only sends the sound to a client of the frame stream */
+    { "stream", "Frame stream sound output", sound_init_stream_device, SOUND_PLAYBACK_DEVICE },
+#endif
+
     /* FIXME: the dump device (and part of the sound system) needs to be
        rewritten somehow, so it can be used while actually playing sound, ie as
        a record device */
@@ -230,6 +238,30 @@ typedef struct {
     /* is the device suspended? */
     int issuspended;
     int16_t lastsample[SOUND_OUTPUT_CHANNELS_MAX];
+
+    /* dynamic rate control: resampled samples waiting for the device */
+    int16_t *drcbuf;
+
+    /* size of drcbuf in frames */
+    int drcbufsize;
+
+    /* number of frames in drcbuf */
+    int drcptr;
+
+    /* size of the device buffer in frames */
+    int drcdevsize;
+
+    /* output frames per emulated frame */
+    double drcratio;
+
+    /* resampler position between drclast and the next emulated frame */
+    double drcpos;
+
+    /* last emulated frame passed to the resampler */
+    int16_t drclast[SOUND_OUTPUT_CHANNELS_MAX];
+
+    /* frames dropped because the device did not take them in time */
+    unsigned long drcdropped;
 } snddata_t;
 
 static snddata_t snddata;
@@ -274,10 +306,17 @@ static void sound_machine_close(sound_t *psid)
 #ifdef SOUND_SYSTEM_FLOAT
 static float *sound_buffer[SOUND_CHIPS_MAX][SOUND_CHIP_CHANNELS_MAX];
 
+/* Mix bus: the left and the right output channel, `snddata.bufsize'
+   samples apart. Mono output only uses the left one. */
+static float *mix_buffer = NULL;
+
 static void free_sound_buffers(void)
 {
     int i, j;
 
+    lib_free(mix_buffer);
+    mix_buffer = NULL;
+
     /* free buffers */
     for (i = 0; i < SOUND_CHIPS_MAX; i++) {
         for (j = 0; j < SOUND_CHIP_CHANNELS_MAX; j++) {
@@ -293,6 +332,10 @@ static void malloc_sound_buffers(int size)
 {
     int i, j;
 
+    /* `size' holds at least `snddata.bufsize' samples, one such buffer
+       per output channel */
+    mix_buffer = lib_malloc(size * 2);
+
     /* allocate all possibly needed buffers */
     for (i = 0; i < SOUND_CHIPS_MAX; i++) {
         for (j = 0; j < SOUND_CHIP_CHANNELS_MAX; j++) {
@@ -300,6 +343,56 @@ static void malloc_sound_buffers(int size)
         }
     }
 }
+
+/* The mixing loops below work on whole buffers without branches, so the
+   compiler can turn them into vector instructions. */
+
+static void sound_mix_clear(float *dst, int nr)
+{
+    memset(dst, 0, nr * sizeof(float));
+}
+
+static void sound_mix_add(float *dst, const float *src, int nr)
+{
+    int j;
+
+    for (j = 0; j < nr; j++) {
+        dst[j] += src[j];
+    }
+}
+
+static void sound_mix_add_scaled(float *dst, const float *src, int nr, float gain)
+{
+    int j;
+
+    for (j = 0; j < nr; j++) {
+        dst[j] += src[j] * gain;
+    }
+}
+
+/* Add a chip channel to a bus channel at a volume of 0 to 100 percent */
+static void sound_mix_route(float *dst, const float *src, int nr, int volume)
+{
+    if (volume == 100) {
+        sound_mix_add(dst, src, nr);
+    } else if (volume != 0) {
+        sound_mix_add_scaled(dst, src, nr, (float)(volume / 100.0));
+    }
+}
+
+/* Clip a bus channel and convert it to int16_t, `stride' samples apart */
+static void sound_mix_output(int16_t *pbuf, const float *src, int nr, int stride)
+{
+    int j;
+    float sample;
+
+    for (j = 0; j < nr; j++) {
+        sample = src[j];
+        sample = sample < -1.0f ? -1.0f : sample;
+        sample = sample > 1.0f ? 1.0f : sample;
+        pbuf[j * stride] = (int16_t)(sample * 32767.0f);
+    }
+}
 #endif
 
 /*
@@ -312,13 +405,13 @@ static void malloc_sound_buffers(int size)
 */
 static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
-/* FIXME: fix mono stream to stereo mixing next */
 #ifdef SOUND_SYSTEM_FLOAT
-    int i, j, k;
+    int i, k;
     int temp;
     int primary_sound_rendered = 0;
     int sound_channels[SOUND_CHIPS_MAX];
-    float *addition_buffer = NULL;
+    float *left, *right;
+    sound_chip_mixing_spec_t *mixing;
     CLOCK initial_delta_t = *delta_t;
     CLOCK delta_t_for_other_chips;
 
@@ -357,96 +450,35 @@ static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr
         }
     }
 
-    /* allocate buffer to hold added samples */
-    addition_buffer = lib_malloc(snddata.bufsize * soc * sizeof(float));
-
-    if (soc == SOUND_OUTPUT_MONO) {
-
-        /* Add all samples together for enabled sound devices and output in mono */
-        for (j = 0; j < temp; j++) {
-            addition_buffer[j] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    addition_buffer[j] += sound_buffer[i][0][j];
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            addition_buffer[j] += sound_buffer[i][k][j];
-                        }
-                    }
-                }
-            }
+    /* route every channel of the enabled sound devices to the mix bus: all
+       of them at full volume for mono, or as set by the device for stereo */
+    left = mix_buffer;
+    right = mix_buffer + snddata.bufsize;
+    sound_mix_clear(left, temp);
+    if (soc == SOUND_OUTPUT_STEREO) {
+        sound_mix_clear(right, temp);
+    }
+    for (i = 0; i < (offset >> 5); i++) {
+        if (!sound_calls[i]->chip_enabled) {
+            continue;
         }
-    } else {
-
-        /* Add all samples together for enabled sound devices and output in stereo */
-        for (j = 0; j < temp; j++) {
-
-            /* left first */
-            addition_buffer[j * soc] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    if (sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume) {
-                        if (sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume == 100) {
-                            addition_buffer[j * soc] += sound_buffer[i][0][j];
-                        } else {
-                            addition_buffer[j * soc] += (sound_buffer[i][0][j] * sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume / 100.0);
-                        }
-                    }
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            if (sound_calls[i]->sound_chip_channel_mixing[k].left_channel_volume == 100) {
-                                addition_buffer[j * soc] += sound_buffer[i][k][j];
-                            } else {
-                                addition_buffer[j * soc] += (sound_buffer[i][k][j] * sound_calls[i]->sound_chip_channel_mixing[k].left_channel_volume / 100.0);
-                            }
-                        }
-                    }
-                }
-            }
-
-            /* now right */
-            addition_buffer[(j * soc) + 1] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    if (sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume) {
-                        if (sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume == 100) {
-                            addition_buffer[(j * soc) + 1] += sound_buffer[i][0][j];
-                        } else {
-                            addition_buffer[(j * soc) + 1] += (sound_buffer[i][0][j] * sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume / 100.0);
-                        }
-                    }
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            if (sound_calls[i]->sound_chip_channel_mixing[k].right_channel_volume == 100) {
-                                addition_buffer[(j * soc) + 1] += sound_buffer[i][k][j];
-                            } else {
-                                addition_buffer[(j * soc) + 1] += (sound_buffer[i][k][j] * sound_calls[i]->sound_chip_channel_mixing[k].right_channel_volume / 100.0);
-                            }
-                        }
-                    }
-                }
+        for (k = 0; k < sound_channels[i]; k++) {
+            if (soc == SOUND_OUTPUT_MONO) {
+                sound_mix_add(left, sound_buffer[i][k], temp);
+            } else {
+                mixing = &sound_calls[i]->sound_chip_channel_mixing[k];
+                sound_mix_route(left, sound_buffer[i][k], temp, mixing->left_channel_volume);
+                sound_mix_route(right, sound_buffer[i][k], temp, mixing->right_channel_volume);
             }
-
-        }
-    }
-
-    /* clip the addition buffer if needed */
-    for (j = 0; j < (temp * soc); j++) {
-        if (addition_buffer[j] < -1.0) {
-            addition_buffer[j] = -1.0;
-        } else if (addition_buffer[j] > 1.0) {
-            addition_buffer[j] = 1.0;
         }
     }
 
-    /* convert floats to int16_t for output */
-    for (j = 0; j < (temp * soc); j++) {
-        pbuf[j] = (int16_t)(addition_buffer[j] * 32767.0);
+    /* clip and interleave the bus channels into the output */
+    sound_mix_output(pbuf, left, temp, soc);
+    if (soc == SOUND_OUTPUT_STEREO) {
+        sound_mix_output(pbuf + 1, right, temp, soc);
     }
 
-    /* free addition buffer */
-    lib_free(addition_buffer);
-
     return temp;
 #else
     int i;
@@ -545,6 +577,7 @@ static int amp;
 static int fragment_size;
 static int output_option;
 static int sound_emulation_enabled_on_warp;
+static int rate_control;
 
 /* divisors for fragment size calculation */
 static const int fragment_divisor[] = {
@@ -573,6 +606,18 @@ static int cycle_based = 0;
 /* If a current playback device is used to control emulator timing */
 static int sound_is_timing_source = FALSE;
 
+/* Free space of the empty playback device buffer, 0 if unknown */
+static int sound_device_space = 0;
+
+/* If the sample stream is resampled to keep the device buffer half full */
+static int sound_rate_control_active = FALSE;
+
+/* Largest deviation of the dynamic rate control from the nominal rate */
+#define SOUND_DRC_MAX_DEVIATION 0.005
+
+/* Part of the rate error corrected on each flush */
+#define SOUND_DRC_SMOOTHING     0.05
+
 static int set_output_option(int val, void *param)
 {
     switch (val) {
@@ -599,6 +644,17 @@ static int set_sound_emulation_enabled_on_warp(int value, void *param)
     return 0;
 }
 
+static int set_rate_control(int value, void *param)
+{
+    int val = value ? 1 : 0;
+
+    if (rate_control != val) {
+        rate_control = val;
+        sound_state_changed = TRUE;
+    }
+    return 0;
+}
+
 static int set_playback_enabled(int value, void *param)
 {
     int val = value ? 1 : 0;
@@ -732,6 +788,8 @@ static const resource_int_t resources_int[] = {
       (void *)&output_option, set_output_option, NULL },
     { "SoundEmulateOnWarp", 1, RES_EVENT_NO, NULL,
       (void *)&sound_emulation_enabled_on_warp, set_sound_emulation_enabled_on_warp, NULL },
+    { "SoundRateControl", 0, RES_EVENT_NO, NULL,
+      (void *)&rate_control, set_rate_control, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -792,6 +850,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-soundwarpmode", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "SoundEmulateOnWarp", NULL,
       "<mode>", "Specify how to handle sound emulation in warp mode: (0: do not emulate the sound chips, 1: keep emulating the sound chips)" },
+    { "-soundratecontrol", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundRateControl", (resource_value_t)1,
+      NULL, "Enable dynamic rate control: pace the emulation by the host clock and resample the sound to keep the buffer half full" },
+    { "+soundratecontrol", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundRateControl", (resource_value_t)0,
+      NULL, "Disable dynamic rate control: pace the emulation by the sound device" },
     CMDLINE_LIST_END
 };
 
@@ -916,6 +980,9 @@ static double speed_percent;
 /* Flag: Is warp mode enabled?  */
 static int warp_mode_enabled;
 
+/* Flag: Are the samples dropped instead of waiting for the device?  */
+static int unpaced_output;
+
 /* device registration code */
 #define MAX_SOUND_DEVICES 24
 
@@ -1255,10 +1322,37 @@ int sound_open(void)
         sound_is_timing_source = pdev->is_timing_source ? TRUE : FALSE;
         sid_state_changed = FALSE;
 
+        /* Dynamic rate control needs to know how full the device is. */
+        if (rate_control && pdev->bufferspace) {
+            snddata.drcdevsize = pdev->bufferspace();
+            snddata.drcbufsize = snddata.drcdevsize * 2 + fragsize;
+            snddata.drcbuf = lib_malloc(snddata.drcbufsize * snddata.sound_output_channels * sizeof(int16_t));
+            snddata.drcptr = 0;
+            snddata.drcratio = 1.0;
+            snddata.drcpos = 0.0;
+            snddata.drcdropped = 0;
+            for (c = 0; c < snddata.sound_output_channels; c++) {
+                snddata.drclast[c] = 0;
+            }
+            sound_rate_control_active = TRUE;
+            sound_is_timing_source = FALSE;
+            log_message(sound_log, "Dynamic rate control enabled, device buffer %d frames.",
+                        snddata.drcdevsize);
+        } else if (rate_control) {
+            log_warning(sound_log, "Device `%s' cannot report its buffer fill, dynamic rate control disabled.",
+                        pdev->name);
+        }
+
+        sound_device_space = pdev->bufferspace ? pdev->bufferspace() : 0;
+
         /* Fill up the sound hardware buffer. */
         if (pdev->bufferspace) {
-            /* Fill to bufsize - fragsize. */
-            j = pdev->bufferspace() - snddata.fragsize;
+            /* Fill to bufsize - fragsize, or to the rate control target. */
+            if (sound_rate_control_active) {
+                j = pdev->bufferspace() / 2;
+            } else {
+                j = pdev->bufferspace() - snddata.fragsize;
+            }
             if (j > 0) {
                 /* Whole fragments. */
                 j -= j % snddata.fragsize;
@@ -1333,6 +1427,23 @@ static void sounddev_close(const sound_device_t **dev)
     }
 }
 
+/* Clocks of the first sample and of the one after the last sample being
+   rendered, to place the logged DAC writes */
+static CLOCK dac_window_start;
+static CLOCK dac_window_end;
+
+/* DACs that may have logged writes */
+#define SOUND_DACS_MAX  16
+static sound_dac_t *dacs[SOUND_DACS_MAX];
+static int dacs_nr = 0;
+
+static void sound_dacs_reset(void);
+
+/* Samples of the DAC being rendered */
+static int *dac_samples = NULL;
+static float *dac_input = NULL;
+static int dac_samples_size = 0;
+
 /* close sid */
 void sound_close(void)
 {
@@ -1345,6 +1456,15 @@ void sound_close(void)
     sound_playdev_reopen = FALSE;
     sound_is_timing_source = FALSE;
 
+    if (sound_rate_control_active) {
+        if (snddata.drcdropped) {
+            log_message(sound_log, "Dynamic rate control dropped %lu frames.", snddata.drcdropped);
+        }
+        lib_free(snddata.drcbuf);
+        snddata.drcbuf = NULL;
+        sound_rate_control_active = FALSE;
+    }
+
 #ifdef SOUND_SYSTEM_FLOAT
     free_sound_buffers();
 #endif
@@ -1352,6 +1472,12 @@ void sound_close(void)
     snddata.buffer = NULL;
     snddata.bufsize = 0;
 
+    lib_free(dac_samples);
+    dac_samples = NULL;
+    lib_free(dac_input);
+    dac_input = NULL;
+    dac_samples_size = 0;
+
     if (temp_buffer) {
         lib_free(temp_buffer);
         temp_buffer = NULL;
@@ -1374,6 +1500,7 @@ static int sound_run_sound(void)
     int i;
     CLOCK delta_t = 0;
     int16_t *bufferptr;
+    uint64_t bench_start;
 
     if (!playback_enabled) {
         return 1;
@@ -1394,14 +1521,18 @@ static int sound_run_sound(void)
 
     /* Handling of cycle based sound engines. */
     if (cycle_based) {
+        dac_window_start = snddata.lastclk;
+        dac_window_end = maincpu_clk;
         delta_t = maincpu_clk - snddata.lastclk;
         bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+        BENCHMARK_BEGIN(bench_start);
         nr = sound_machine_calculate_samples(snddata.psid,
                                              bufferptr,
                                              snddata.bufsize - snddata.bufptr,
                                              snddata.sound_output_channels,
                                              snddata.sound_chip_channels,
                                              &delta_t);
+        BENCHMARK_END(BENCHMARK_SOUND, bench_start);
         if (delta_t && !archdep_is_exiting()) {
 #if 0
             sound_error_log_only("Sound buffer overflow (cycle based)");
@@ -1429,12 +1560,16 @@ static int sound_run_sound(void)
              nr = snddata.bufsize - snddata.bufptr;
          }
          bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+         dac_window_start = (CLOCK)SOUNDCLK_LONG(snddata.fclk);
+         dac_window_end = (CLOCK)SOUNDCLK_LONG(snddata.fclk + nr * snddata.clkstep);
+         BENCHMARK_BEGIN(bench_start);
          sound_machine_calculate_samples(snddata.psid,
                                          bufferptr,
                                          nr,
                                          snddata.sound_output_channels,
                                          snddata.sound_chip_channels,
                                          &delta_t);
+         BENCHMARK_END(BENCHMARK_SOUND, bench_start);
          snddata.fclk += nr * snddata.clkstep;
      }
 
@@ -1463,6 +1598,7 @@ void sound_reset(void)
     snddata.wclk = maincpu_clk;
     snddata.lastclk = maincpu_clk;
     snddata.bufptr = 0;         /* ugly hack! */
+    sound_dacs_reset();
     for (c = 0; c < snddata.sound_chip_channels; c++) {
         if (snddata.psid[c]) {
             sound_machine_reset(snddata.psid[c], maincpu_clk);
@@ -1471,6 +1607,102 @@ void sound_reset(void)
 }
 
 /* flush all generated samples from buffer to sounddevice. */
+/* Flush with dynamic rate control.
+
+   Instead of blocking until the device takes the samples, the sample stream
+   is stretched or squeezed by up to SOUND_DRC_MAX_DEVIATION so the device
+   buffer settles at half its size, and the emulation is paced by vsync on
+   the host clock. The tiny pitch change is inaudible, and neither the clock
+   drift between the host and the sound card nor the frame rate of the
+   emulated machine shows up as pauses in the emulation. */
+static int sound_flush_rate_controlled(void)
+{
+    int c, i, nr, out, space, fill;
+    int ch = snddata.sound_output_channels;
+    double ratio, step, t, frac, a, b;
+
+    nr = snddata.bufptr;
+    if (nr == 0) {
+        return 0;
+    }
+
+    /* Recordings get the emulated stream as it is. */
+    if (snddata.recdev) {
+        if (snddata.recdev->write(snddata.buffer, nr * ch)) {
+            return sound_error("write to sound device failed.");
+        }
+    }
+
+    space = snddata.playdev->bufferspace();
+    fill = snddata.drcdevsize - space + snddata.drcptr;
+
+    /* Proportional control: full deviation at an empty or full buffer. */
+    ratio = 1.0 - ((double)fill / snddata.drcdevsize - 0.5) * 2.0 * SOUND_DRC_MAX_DEVIATION;
+    if (ratio < 1.0 - SOUND_DRC_MAX_DEVIATION) {
+        ratio = 1.0 - SOUND_DRC_MAX_DEVIATION;
+    } else if (ratio > 1.0 + SOUND_DRC_MAX_DEVIATION) {
+        ratio = 1.0 + SOUND_DRC_MAX_DEVIATION;
+    }
+    snddata.drcratio += (ratio - snddata.drcratio) * SOUND_DRC_SMOOTHING;
+
+    /* Make room for the resampled frames, dropping the oldest if the device
+       stalled. */
+    out = (int)(nr * snddata.drcratio) + 2;
+    if (out > snddata.drcbufsize) {
+        out = snddata.drcbufsize;
+    }
+    if (snddata.drcptr + out > snddata.drcbufsize) {
+        i = snddata.drcptr + out - snddata.drcbufsize;
+        memmove(snddata.drcbuf, snddata.drcbuf + i * ch,
+                (snddata.drcptr - i) * ch * sizeof(int16_t));
+        snddata.drcptr -= i;
+        snddata.drcdropped += i;
+    }
+
+    /* Linear interpolation, position -1 is the last frame of the previous
+       flush. */
+    step = 1.0 / snddata.drcratio;
+    for (t = snddata.drcpos - 1.0; t < nr - 1 && snddata.drcptr < snddata.drcbufsize; t += step) {
+        i = (int)floor(t);
+        frac = t - i;
+        for (c = 0; c < ch; c++) {
+            a = (i < 0) ? snddata.drclast[c] : snddata.buffer[i * ch + c];
+            b = snddata.buffer[(i + 1) * ch + c];
+            snddata.drcbuf[snddata.drcptr * ch + c] = (int16_t)lrint(a + (b - a) * frac);
+        }
+        snddata.drcptr++;
+    }
+    snddata.drcpos = t - (nr - 1);
+    if (snddata.drcpos < 0.0) {
+        snddata.drcpos = 0.0;
+    }
+
+    for (c = 0; c < ch; c++) {
+        snddata.drclast[c] = snddata.buffer[(nr - 1) * ch + c];
+        snddata.lastsample[c] = snddata.drclast[c];
+    }
+    snddata.bufptr = 0;
+
+    /* Write whole fragments as far as the device takes them, never block. */
+    nr = snddata.drcptr < space ? snddata.drcptr : space;
+    nr -= nr % snddata.fragsize;
+    if (nr == 0) {
+        return 0;
+    }
+
+    mainlock_yield_begin();
+    i = snddata.playdev->write(snddata.drcbuf, nr * ch);
+    mainlock_yield_end();
+    if (i) {
+        return sound_error("write to sound device failed.");
+    }
+
+    snddata.drcptr -= nr;
+    memmove(snddata.drcbuf, snddata.drcbuf + nr * ch, snddata.drcptr * ch * sizeof(int16_t));
+
+    return 0;
+}
+
 bool sound_flush(void)
 {
     int c, i, nr, space;
@@ -1525,12 +1757,17 @@ bool sound_flush(void)
         sid_state_changed = FALSE;
     }
 
-    if (warp_mode_enabled && snddata.recdev == NULL) {
+    if ((warp_mode_enabled || unpaced_output) && snddata.recdev == NULL) {
         snddata.bufptr = 0;
         goto done;
     }
     sound_resume();
 
+    if (sound_rate_control_active) {
+        sound_flush_rate_controlled();
+        goto done;
+    }
+
 #if 0
     /* FIXME: This code does not make sense - whatever it is trying to do does
               not work at all:
@@ -1564,13 +1801,23 @@ bool sound_flush(void)
         goto done;
     }
 
+    if (!warp_mode_enabled && !unpaced_output
+        && snddata.playdev->bufferspace && sound_device_space > 0) {
+        space = snddata.playdev->bufferspace();
+        metrics_gauge_set(METRIC_SOUND_BUFFER_FILL,
+                          (double)(sound_device_space - space) * 100.0 / sound_device_space);
+        if (space >= sound_device_space) {
+            metrics_counter_add(METRIC_AUDIO_UNDERRUNS, 1);
+        }
+    }
+
     /*
      * At this point we have to block until we have written at least one fragment.
      *
      * The 'push against the audio device' sync method depends on this.
      */
 
-    while (!warp_mode_enabled) {
+    while (!warp_mode_enabled && !unpaced_output) {
 
         if (snddata.playdev->bufferspace) {
             space = snddata.playdev->bufferspace();
@@ -1777,6 +2024,8 @@ void sound_store(uint16_t addr, uint8_t val, int chipno)
         return;
     }
 
+    PERF_COUNT_SOUND_STORE(chipno);
+
     /* perform the actual write to the sound chip */
     sound_machine_store(snddata.psid[chipno], addr, val);
 
@@ -1827,6 +2076,19 @@ void sound_set_warp_mode(int value)
     }
 }
 
+/* Keep emulating the sound chips, but drop the samples instead of letting
+   the sound device pace the emulation.  */
+void sound_set_unpaced_output(int value)
+{
+    unpaced_output = value;
+
+    if (value) {
+        sound_suspend();
+    } else if (!warp_mode_enabled) {
+        sound_resume();
+    }
+}
+
 void sound_snapshot_prepare(void)
 {
     /* Update lastclk.  */
@@ -1836,90 +2098,198 @@ void sound_snapshot_prepare(void)
 void sound_snapshot_finish(void)
 {
     snddata.lastclk = maincpu_clk;
+    snddata.fclk = SOUNDCLK_CONSTANT(maincpu_clk);
+    sound_dacs_reset();
+}
+
+/* Run the sound chips up to the current clock and throw the generated
+   samples away, used for emulated frames that are never heard (run-ahead). */
+void sound_discard(void)
+{
+    sound_run_sound();
+    snddata.bufptr = 0;
 }
 
 void sound_dac_init(sound_dac_t *dac, int speed)
 {
+    int i;
+
     /* 20 dB/Decade high pass filter, cutoff at 5 Hz. For DC offset filtering. */
     dac->alpha = (float)(0.0318309886 / (0.0318309886 + 1.0 / (float)speed));
     dac->value = 0;
+    dac->input = 0.0;
     dac->output = 0.0;
+    dac->writes_nr = 0;
+
+    for (i = 0; i < dacs_nr; i++) {
+        if (dacs[i] == dac) {
+            return;
+        }
+    }
+    if (dacs_nr < SOUND_DACS_MAX) {
+        dacs[dacs_nr++] = dac;
+    }
 }
 
-/* FIXME: this should use bandlimited step synthesis. Sadly, VICE does not
- * have an easy-to-use infrastructure for blep generation. We should write
- * this code. */
-#ifdef SOUND_SYSTEM_FLOAT
-/* FIXME */
-int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr)
+/* Forget the writes not rendered yet, when the clock jumps */
+static void sound_dacs_reset(void)
 {
     int i;
-    int off = 0;
-    float sample;
 
-    /* A simple high pass digital filter is employed here to get rid of the DC offset,
-       which would cause distortion when mixed with other signal. This filter is formed
-       on the actual hardware by the combination of output decoupling capacitor and load
-       resistance.
-    */
-    if (nr) {
-        dac->output = dac->alpha * (dac->output + (float)(value - dac->value));
-        dac->value = value;
+    for (i = 0; i < dacs_nr; i++) {
+        dacs[i]->writes_nr = 0;
+    }
+}
 
-        if (!(int)dac->output) {
-            return nr;
-        }
+/* Write to a DAC at the current clock.
+
+   Unlike with sound_store(), the sound is not rendered up to the write,
+   the write is logged with its clock and placed in the samples when the
+   next fragment is rendered, see sound_dac_calculate_samples(). `addr' and
+   `val' are passed on to the store function of the sound chip, `value' is
+   the level of the DAC as passed to sound_dac_calculate_samples(). */
+void sound_dac_store(sound_dac_t *dac, uint16_t addr, uint8_t val, int value)
+{
+    /* the dump device wants every write as it happens */
+    if (!playback_enabled || snddata.playdev == NULL || snddata.playdev->dump
+        || dac->writes_nr == SOUND_DAC_WRITES_MAX || snddata.psid[0] == NULL) {
+        sound_store(addr, val, 0);
+        return;
+    }
+
+    sound_machine_store(snddata.psid[0], addr, val);
+
+    dac->writes[dac->writes_nr].clk = maincpu_clk;
+    dac->writes[dac->writes_nr].value = value;
+    dac->writes_nr++;
+}
 
-        sample = (int)dac->output / 32767.0;
+/* Fill dac_input with the level of the DAC averaged over every sample of
+   the fragment, with the logged writes up to its end placed at 1/256
+   sample precision. The averaging is a box filter, a simple band limited
+   step that spreads a write within a sample over it instead of moving it
+   to the sample edge. */
+static void sound_dac_place_writes(sound_dac_t *dac, int nr)
+{
+    CLOCK span = dac_window_end - dac_window_start;
+    float level = (float)dac->value;
+    float acc = 0.0;
+    int cur = 0, cur_f = 0;
+    int w, i, f, k;
+    uint64_t pos;
+
+    for (w = 0; w < dac->writes_nr && dac->writes[w].clk < dac_window_end; w++) {
+        if (dac->writes[w].clk <= dac_window_start) {
+            pos = 0;
+        } else {
+            pos = (dac->writes[w].clk - dac_window_start) * (uint64_t)nr * 256 / span;
+        }
+        i = (int)(pos >> 8);
+        f = (int)(pos & 0xff);
 
-        pbuf[off] = sample;
-        off ++;
+        if (i > cur) {
+            dac_input[cur] = (acc + level * (256 - cur_f)) / 256.0f;
+            for (k = cur + 1; k < i; k++) {
+                dac_input[k] = level;
+            }
+            cur = i;
+            cur_f = 0;
+            acc = 0.0;
+        }
+        acc += level * (f - cur_f);
+        cur_f = f;
+        level = (float)dac->writes[w].value;
     }
 
-    for (i = 1; i < nr; i++) {
-        dac->output *= dac->alpha;
-        sample = (int)dac->output / 32767.0;
-        pbuf[off] = sample;
-        off ++;
+    dac_input[cur] = (acc + level * (256 - cur_f)) / 256.0f;
+    for (k = cur + 1; k < nr; k++) {
+        dac_input[k] = level;
     }
-    return nr;
+    dac->value = (int)level;
+
+    /* keep the writes after the fragment for the next one */
+    dac->writes_nr -= w;
+    memmove(dac->writes, dac->writes + w, dac->writes_nr * sizeof(sound_dac_write_t));
 }
-#else
-int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int nr, int soc, int cs)
+
+/* Render `nr' samples of the DAC into dac_samples, 0 if they are all
+   silent and were left out */
+static int sound_dac_render(sound_dac_t *dac, int value, int nr)
 {
-    int i, sample;
-    int off = 0;
+    int i;
+
+    if (nr > dac_samples_size) {
+        dac_samples_size = nr;
+        dac_samples = lib_realloc(dac_samples, nr * sizeof(int));
+        dac_input = lib_realloc(dac_input, nr * sizeof(float));
+    }
+
     /* A simple high pass digital filter is employed here to get rid of the DC offset,
        which would cause distortion when mixed with other signal. This filter is formed
        on the actual hardware by the combination of output decoupling capacitor and load
        resistance.
     */
-    if (nr) {
-        dac->output = dac->alpha * (dac->output + (float)(value - dac->value));
+    if (dac->writes_nr == 0 || dac->writes[0].clk >= dac_window_end
+        || dac_window_end <= dac_window_start) {
+        /* no writes in this fragment, the level only changes at its start
+           when the device was written the usual way */
+        if (dac->writes_nr) {
+            value = dac->value;
+        }
+        dac->output = dac->alpha * (dac->output + ((float)value - dac->input));
+        dac->input = (float)value;
         dac->value = value;
-        sample = (int)dac->output;
-        if (!sample) {
-            return nr;
+        dac_samples[0] = (int)dac->output;
+        if (!dac_samples[0]) {
+            return 0;
         }
-        if (cs == SOUND_CHANNEL_1 || cs == SOUND_CHANNELS_1_AND_2) {
-            pbuf[off] = sound_audio_mix(pbuf[off], sample);
+        for (i = 1; i < nr; i++) {
+            dac->output *= dac->alpha;
+            dac_samples[i] = (int)dac->output;
         }
-        if (cs == SOUND_CHANNEL_2 || cs == SOUND_CHANNELS_1_AND_2) {
-            pbuf[off + 1] = sound_audio_mix(pbuf[off + 1], sample);
+        return 1;
+    }
+
+    sound_dac_place_writes(dac, nr);
+    for (i = 0; i < nr; i++) {
+        dac->output = dac->alpha * (dac->output + (dac_input[i] - dac->input));
+        dac->input = dac_input[i];
+        dac_samples[i] = (int)dac->output;
+    }
+    return 1;
+}
+
+#ifdef SOUND_SYSTEM_FLOAT
+/* FIXME */
+int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr)
+{
+    int i;
+
+    if (nr && sound_dac_render(dac, value, nr)) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i] = dac_samples[i] / 32767.0;
         }
-        off += soc;
     }
+    return nr;
+}
+#else
+int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int nr, int soc, int cs)
+{
+    int i;
 
-    for (i = 1; i < nr; i++) {
-        dac->output *= dac->alpha;
-        sample = (int)dac->output;
-        if (cs == SOUND_CHANNEL_1 || cs == SOUND_CHANNELS_1_AND_2) {
-            pbuf[off] = sound_audio_mix(pbuf[off], sample);
+    if (!nr || !sound_dac_render(dac, value, nr)) {
+        return nr;
+    }
+
+    if (cs == SOUND_CHANNEL_1 || cs == SOUND_CHANNELS_1_AND_2) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], dac_samples[i]);
         }
-        if (cs == SOUND_CHANNEL_2 || cs == SOUND_CHANNELS_1_AND_2) {
-            pbuf[off + 1] = sound_audio_mix(pbuf[off + 1], sample);
+    }
+    if (cs == SOUND_CHANNEL_2 || cs == SOUND_CHANNELS_1_AND_2) {
+        for (i = 0; i < nr; i++) {
+            pbuf[i * soc + 1] = sound_audio_mix(pbuf[i * soc + 1], dac_samples[i]);
         }
-        off += soc;
     }
     return nr;
 }
@@ -256,9 +256,11 @@ int sound_open(void);
 void sound_close(void);
 void sound_set_relative_speed(int value);
 void sound_set_warp_mode(int value);
+void sound_set_unpaced_output(int value);
 void sound_set_machine_parameter(long clock_rate, long ticks_per_frame);
 void sound_snapshot_prepare(void);
 void sound_snapshot_finish(void);
+void sound_discard(void);
 
 int sound_resources_init(void);
 void sound_resources_shutdown(void);
@@ -268,6 +270,9 @@ int sound_cmdline_options_init(void);
 /* device initialization prototypes */
 int sound_init_alsa_device(void);
 int sound_init_dummy_device(void);
+#ifdef USE_HEADLESSUI
+int sound_init_stream_device(void);
+#endif
 int sound_init_dump_device(void);
 int sound_init_fs_device(void);
 int sound_init_wav_device(void);
@@ -366,13 +371,26 @@ typedef struct sound_chip_s {
 
 uint16_t sound_chip_register(sound_chip_t *chip);
 
+/* Writes logged per DAC between two renders, more make the sound render up
+   to the write like sound_store() does */
+#define SOUND_DAC_WRITES_MAX    1024
+
+typedef struct sound_dac_write_s {
+    CLOCK clk;
+    int value;
+} sound_dac_write_t;
+
 typedef struct sound_dac_s {
     float output;
     float alpha;
     int value;
+    float input;    /* level of the last rendered sample, averaged over it */
+    int writes_nr;
+    sound_dac_write_t writes[SOUND_DAC_WRITES_MAX];
 } sound_dac_t;
 
 void sound_dac_init(sound_dac_t *dac, int speed);
+void sound_dac_store(sound_dac_t *dac, uint16_t addr, uint8_t val, int value);
 
 #ifdef SOUND_SYSTEM_FLOAT
 int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr);
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "archdep.h"
 #include "cmdline.h"
@@ -55,12 +56,100 @@ static char *default_path = NULL;
 static char *system_path = NULL;
 static char *expanded_system_path = NULL;
 
+/* ROM images loaded through sysfile_load() are kept here, so that loading
+   the same image again (several drives of the same type, switching machine
+   models or drive types back and forth) does not read the file again.  The
+   images are mapped read-only where possible, so the pages are shared with
+   other emulator instances through the page cache.  An entry is used as
+   long as the file it came from keeps its size and modification time.  */
+typedef struct sysfile_rom_s {
+    char *name;                 /* name and subpath given to sysfile_load() */
+    char *subpath;
+    char *complete_path;        /* file found for them */
+    size_t size;
+    time_t mtime;
+    archdep_file_map_t *map;    /* mapping of the file, or NULL */
+    uint8_t *data;              /* contents of the file */
+    struct sysfile_rom_s *next;
+} sysfile_rom_t;
+
+static sysfile_rom_t *rom_cache = NULL;
+
+/* Finding a system file probes every directory of the search path in turn,
+   which adds up to hundreds of calls into the filesystem at startup, slow
+   on network home directories.  The results of the searches are kept in
+   an index in the user's cache directory, one per emulator, for the search
+   path it was made for.  It stays valid as long as the directories that
+   are searched keep their modification times, as adding, removing or
+   renaming a file changes that of its directory; those are checked once
+   per session, and the results for a subpath are dropped when one of its
+   directories changed.  Directories modified in the last few seconds are
+   not trusted the next time, as their modification time may not change
+   again when another file is added.
+
+   File format: lines of tab separated fields
+       SYSFILE_INDEX_MAGIC
+       P  search path
+       D  modification time (-1 if missing)  directory
+       F  subpath  name  file found (empty if none)  */
+#define SYSFILE_INDEX_MAGIC     "VICESYSINDEX1"
+
+/* Longest line of the index file.  */
+#define SYSFILE_INDEX_LINE_MAX  (ARCHDEP_PATH_MAX * 4)
+
+typedef struct sysfile_dir_s {
+    char *path;
+    time_t mtime;               /* as recorded, -2 if not to be trusted */
+    int checked;                /* compared to the directory in this session */
+    struct sysfile_dir_s *next;
+} sysfile_dir_t;
+
+typedef struct sysfile_found_s {
+    char *subpath;              /* "" for none */
+    char *name;
+    char *path;                 /* NULL if the file was not found */
+    struct sysfile_found_s *next;
+} sysfile_found_t;
+
+static char *index_emu_id = NULL;
+static char *index_system_path = NULL;  /* search path of the index */
+static sysfile_dir_t *index_dirs = NULL;
+static sysfile_found_t *index_found = NULL;
+static int index_dirty = 0;
+
+static void rom_cache_clear_entry(sysfile_rom_t *rom)
+{
+    if (rom->map != NULL) {
+        archdep_file_map_close(rom->map);
+    } else {
+        lib_free(rom->data);
+    }
+    lib_free(rom->name);
+    lib_free(rom->subpath);
+    lib_free(rom->complete_path);
+    lib_free(rom);
+}
+
+static void rom_cache_clear(void)
+{
+    sysfile_rom_t *rom;
+
+    while (rom_cache != NULL) {
+        rom = rom_cache;
+        rom_cache = rom->next;
+        rom_cache_clear_entry(rom);
+    }
+}
+
 static int set_system_path(const char *val, void *param)
 {
     char *tmp_path, *tmp_path_save, *p, *s, *current_dir;
 
     util_string_set(&system_path, val);
 
+    /* the names may find other files now */
+    rom_cache_clear();
+
     lib_free(expanded_system_path);
     expanded_system_path = NULL; /* will subsequently be replaced */
 
@@ -138,12 +227,294 @@ static const cmdline_option_t cmdline_options[] =
 
 /* ------------------------------------------------------------------------- */
 
+static void index_drop_found(const char *subpath)
+{
+    sysfile_found_t **prev = &index_found;
+    sysfile_found_t *found;
+
+    while ((found = *prev) != NULL) {
+        if (subpath == NULL || strcmp(found->subpath, subpath) == 0) {
+            *prev = found->next;
+            lib_free(found->subpath);
+            lib_free(found->name);
+            lib_free(found->path);
+            lib_free(found);
+        } else {
+            prev = &found->next;
+        }
+    }
+}
+
+static void index_clear(void)
+{
+    sysfile_dir_t *dir;
+
+    index_drop_found(NULL);
+    while (index_dirs != NULL) {
+        dir = index_dirs;
+        index_dirs = dir->next;
+        lib_free(dir->path);
+        lib_free(dir);
+    }
+    index_dirty = 0;
+}
+
+static sysfile_dir_t *index_add_dir(const char *path, time_t mtime)
+{
+    sysfile_dir_t *dir = lib_calloc(1, sizeof(sysfile_dir_t));
+
+    dir->path = lib_strdup(path);
+    dir->mtime = mtime;
+    dir->next = index_dirs;
+    index_dirs = dir;
+    return dir;
+}
+
+static void index_add_found(const char *subpath, const char *name, const char *path)
+{
+    sysfile_found_t *found = lib_malloc(sizeof(sysfile_found_t));
+
+    found->subpath = lib_strdup(subpath);
+    found->name = lib_strdup(name);
+    found->path = path != NULL ? lib_strdup(path) : NULL;
+    found->next = index_found;
+    index_found = found;
+}
+
+static char *index_file_path(void)
+{
+    char *name = util_concat("sysfile-", index_emu_id, ".idx", NULL);
+    char *path = util_join_paths(archdep_user_cache_path(), name, NULL);
+
+    lib_free(name);
+    return path;
+}
+
+/* Split off the next tab separated field of an index line.  */
+static char *index_next_field(char **line)
+{
+    char *field = *line;
+    char *p;
+
+    if (field == NULL) {
+        return NULL;
+    }
+    p = strchr(field, '\t');
+    if (p != NULL) {
+        *p++ = '\0';
+    }
+    *line = p;
+    return field;
+}
+
+/* Read the index file if it was made for the search path in use.  */
+static void index_load(void)
+{
+    char *path;
+    char *buf;
+    char *line, *type, *a, *b, *c;
+    FILE *fd;
+    int valid = 0;
+
+    if (index_emu_id == NULL) {
+        return;
+    }
+    path = index_file_path();
+    fd = fopen(path, MODE_READ);
+    lib_free(path);
+    if (fd == NULL) {
+        return;
+    }
+
+    buf = lib_malloc(SYSFILE_INDEX_LINE_MAX);
+    while (fgets(buf, SYSFILE_INDEX_LINE_MAX, fd) != NULL) {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        line = buf;
+        type = index_next_field(&line);
+        if (valid == 0) {
+            /* the magic */
+            if (strcmp(type, SYSFILE_INDEX_MAGIC) != 0) {
+                break;
+            }
+            valid = 1;
+        } else if (valid == 1) {
+            a = index_next_field(&line);
+            if (strcmp(type, "P") != 0 || a == NULL
+                || strcmp(a, expanded_system_path) != 0) {
+                break;
+            }
+            valid = 2;
+        } else if (strcmp(type, "D") == 0) {
+            a = index_next_field(&line);
+            b = index_next_field(&line);
+            if (b != NULL) {
+                index_add_dir(b, (time_t)strtoll(a, NULL, 10));
+            }
+        } else if (strcmp(type, "F") == 0) {
+            a = index_next_field(&line);
+            b = index_next_field(&line);
+            c = index_next_field(&line);
+            if (c != NULL) {
+                index_add_found(a, b, *c != '\0' ? c : NULL);
+            }
+        }
+    }
+    lib_free(buf);
+    fclose(fd);
+}
+
+static void index_save(void)
+{
+    sysfile_dir_t *dir;
+    sysfile_found_t *found;
+    char *path, *tmp_path;
+    FILE *fd;
+    int err;
+
+    if (!index_dirty || index_emu_id == NULL || index_system_path == NULL) {
+        return;
+    }
+    index_dirty = 0;
+
+    path = index_file_path();
+    tmp_path = util_concat(path, ".tmp", NULL);
+    fd = fopen(tmp_path, MODE_WRITE);
+    if (fd == NULL) {
+        lib_free(tmp_path);
+        lib_free(path);
+        return;
+    }
+    err = fprintf(fd, "%s\nP\t%s\n", SYSFILE_INDEX_MAGIC, index_system_path) < 0;
+    for (dir = index_dirs; dir != NULL && !err; dir = dir->next) {
+        err = fprintf(fd, "D\t%lld\t%s\n", (long long)dir->mtime, dir->path) < 0;
+    }
+    for (found = index_found; found != NULL && !err; found = found->next) {
+        err = fprintf(fd, "F\t%s\t%s\t%s\n", found->subpath, found->name,
+                      found->path != NULL ? found->path : "") < 0;
+    }
+    if (fclose(fd) != 0) {
+        err = 1;
+    }
+    if (err || archdep_rename(tmp_path, path) < 0) {
+        log_warning(sysfile_log, "Cannot write `%s'.", path);
+        archdep_remove(tmp_path);
+    }
+    lib_free(tmp_path);
+    lib_free(path);
+}
+
+/* Compare a directory with the index, once per session.  Returns 0 if it is
+   unchanged, -1 if it changed or is not in the index.  */
+static int index_check_dir(const char *path)
+{
+    sysfile_dir_t *dir;
+    size_t len;
+    time_t mtime;
+    int changed;
+
+    for (dir = index_dirs; dir != NULL; dir = dir->next) {
+        if (strcmp(dir->path, path) == 0) {
+            break;
+        }
+    }
+    if (dir != NULL && dir->checked) {
+        return 0;
+    }
+
+    if (archdep_stat_mtime(path, &len, &mtime) < 0) {
+        mtime = (time_t)-1;
+    }
+    if (dir == NULL) {
+        dir = index_add_dir(path, (time_t)-2);
+    }
+    changed = (dir->mtime != mtime);
+    dir->mtime = (mtime != (time_t)-1 && mtime + 2 > time(NULL)) ? (time_t)-2 : mtime;
+    dir->checked = 1;
+    if (changed || dir->mtime == (time_t)-2) {
+        index_dirty = 1;
+    }
+    return changed ? -1 : 0;
+}
+
+/* Check the directories searched for files in `subpath', and drop what the
+   index has for it if one of them changed.  */
+static void index_check_subpath(const char *subpath)
+{
+    char **elements;
+    char *dir;
+    int changed = 0;
+    int i;
+
+    elements = util_strsplit(expanded_system_path, ARCHDEP_FINDPATH_SEPARATOR_STRING, -1);
+    if (elements == NULL) {
+        return;
+    }
+    for (i = 0; elements[i] != NULL; i++) {
+        if (*subpath != '\0') {
+            dir = util_join_paths(elements[i], subpath, NULL);
+        } else {
+            dir = lib_strdup(elements[i]);
+        }
+        if (index_check_dir(dir) < 0) {
+            changed = 1;
+        }
+        lib_free(dir);
+    }
+    for (i = 0; elements[i] != NULL; i++) {
+        lib_free(elements[i]);
+    }
+    lib_free(elements);
+
+    if (changed) {
+        index_drop_found(subpath);
+        index_dirty = 1;
+    }
+}
+
+/* Find `name' along the search path, through the index.  */
+static char *index_findpath(const char *name, const char *subpath)
+{
+    sysfile_found_t *found;
+    char *p;
+
+    if (expanded_system_path == NULL || strchr(name, ARCHDEP_DIR_SEP_CHR) != NULL) {
+        return findpath(name, expanded_system_path, subpath, ARCHDEP_ACCESS_R_OK);
+    }
+    if (subpath == NULL) {
+        subpath = "";
+    }
+
+    if (index_system_path == NULL || strcmp(index_system_path, expanded_system_path) != 0) {
+        /* the index is made for one search path only */
+        index_clear();
+        util_string_set(&index_system_path, expanded_system_path);
+        index_load();
+    }
+
+    index_check_subpath(subpath);
+
+    for (found = index_found; found != NULL; found = found->next) {
+        if (strcmp(found->name, name) == 0 && strcmp(found->subpath, subpath) == 0) {
+            return found->path != NULL ? lib_strdup(found->path) : NULL;
+        }
+    }
+
+    p = findpath(name, expanded_system_path, *subpath != '\0' ? subpath : NULL,
+                 ARCHDEP_ACCESS_R_OK);
+    index_add_found(subpath, name, p);
+    index_dirty = 1;
+    return p;
+}
+
+/* ------------------------------------------------------------------------- */
+
 int sysfile_init(const char *emu_id)
 {
     if (sysfile_log == LOG_DEFAULT) {
         sysfile_log = log_open("Sysfile");
     }
     default_path = archdep_default_sysfile_pathlist(emu_id);
+    util_string_set(&index_emu_id, emu_id);
     DBG(("sysfile_init(%s) -> default_path:'%s'", emu_id, default_path));
     /* HACK: set the default value early, so the systemfile locater also works
              in early startup */
@@ -153,6 +524,13 @@ int sysfile_init(const char *emu_id)
 
 void sysfile_shutdown(void)
 {
+    rom_cache_clear();
+    index_save();
+    index_clear();
+    lib_free(index_system_path);
+    index_system_path = NULL;
+    lib_free(index_emu_id);
+    index_emu_id = NULL;
     lib_free(default_path);
     lib_free(expanded_system_path);
 }
@@ -193,7 +571,7 @@ FILE *sysfile_open(const char *name, const char *subpath, char **complete_path_r
      * expanded_system_path  - list of search path(es), separated by target specific separator
      * subpath  - path tail component, will be appended to the resulting path
      */
-    p = findpath(name, expanded_system_path, subpath, ARCHDEP_ACCESS_R_OK);
+    p = index_findpath(name, subpath);
 
     if (p == NULL) {
         if (complete_path_return != NULL) {
@@ -242,6 +620,77 @@ int sysfile_locate(const char *name, const char *subpath, char **complete_path_r
 
 /* ------------------------------------------------------------------------- */
 
+/* Find `name' in the ROM cache, dropping the entry if the file has changed
+   since it was loaded.  */
+static sysfile_rom_t *rom_cache_find(const char *name, const char *subpath)
+{
+    sysfile_rom_t **prev, *rom;
+    size_t size;
+    time_t mtime;
+
+    for (prev = &rom_cache; (rom = *prev) != NULL; prev = &rom->next) {
+        if (strcmp(rom->name, name) != 0
+            || (rom->subpath == NULL) != (subpath == NULL)
+            || (subpath != NULL && strcmp(rom->subpath, subpath) != 0)) {
+            continue;
+        }
+        if (archdep_stat_mtime(rom->complete_path, &size, &mtime) == 0
+            && size == rom->size && mtime == rom->mtime) {
+            return rom;
+        }
+        *prev = rom->next;
+        rom->next = NULL;
+        rom_cache_clear_entry(rom);
+        return NULL;
+    }
+    return NULL;
+}
+
+/* Read the file opened as `fp' into the ROM cache.  */
+static sysfile_rom_t *rom_cache_add(const char *name, const char *subpath,
+                                    char *complete_path, FILE *fp)
+{
+    sysfile_rom_t *rom;
+    size_t size;
+    time_t mtime;
+    off_t tmpsize;
+
+    tmpsize = archdep_file_size(fp);
+    if (tmpsize < 0) {
+        log_message(sysfile_log, "Failed to determine size of '%s'.", complete_path);
+        return NULL;
+    }
+    if (archdep_stat_mtime(complete_path, &size, &mtime) < 0) {
+        mtime = 0;
+    }
+
+    rom = lib_calloc(1, sizeof(sysfile_rom_t));
+    rom->size = (size_t)tmpsize;
+    rom->mtime = mtime;
+
+    if (rom->size > 0) {
+        rom->map = archdep_file_map(complete_path, rom->size, 0);
+    }
+    if (rom->map != NULL) {
+        rom->data = archdep_file_map_data(rom->map);
+    } else {
+        rom->data = lib_malloc(rom->size + 1);
+        rewind(fp);
+        if (fread(rom->data, 1, rom->size, fp) != rom->size) {
+            lib_free(rom->data);
+            lib_free(rom);
+            return NULL;
+        }
+    }
+
+    rom->name = lib_strdup(name);
+    rom->subpath = subpath != NULL ? lib_strdup(subpath) : NULL;
+    rom->complete_path = complete_path;
+    rom->next = rom_cache;
+    rom_cache = rom;
+    return rom;
+}
+
 /*
  * If minsize >= 0, and the file is smaller than maxsize, load the data
  * into the end of the memory range.
@@ -250,38 +699,45 @@ int sysfile_locate(const char *name, const char *subpath, char **complete_path_r
 int sysfile_load(const char *name, const char *subpath, uint8_t *dest, int minsize, int maxsize)
 {
     FILE *fp = NULL;
+    sysfile_rom_t *rom;
+    const uint8_t *src;
     size_t rsize = 0;
-    off_t tmpsize;
     char *complete_path = NULL;
     int load_at_end;
 
-    fp = sysfile_open(name, subpath, &complete_path, MODE_READ);
-
-    if (fp == NULL) {
-        /* Try to open the file from the current directory. */
-        const char working_dir_prefix[3] = {
-            '.', ARCHDEP_DIR_SEP_CHR, '\0'
-        };
-        char *local_name = NULL;
-
-        local_name = util_concat(working_dir_prefix, name, NULL);
-        fp = sysfile_open((const char *)local_name, subpath, &complete_path, MODE_READ);
-        lib_free(local_name);
-        local_name = NULL;
+    rom = rom_cache_find(name, subpath);
+    if (rom == NULL) {
+        fp = sysfile_open(name, subpath, &complete_path, MODE_READ);
 
         if (fp == NULL) {
-            goto fail;
+            /* Try to open the file from the current directory. */
+            const char working_dir_prefix[3] = {
+                '.', ARCHDEP_DIR_SEP_CHR, '\0'
+            };
+            char *local_name = NULL;
+
+            local_name = util_concat(working_dir_prefix, name, NULL);
+            fp = sysfile_open((const char *)local_name, subpath, &complete_path, MODE_READ);
+            lib_free(local_name);
+            local_name = NULL;
+
+            if (fp == NULL) {
+                return -1;
+            }
         }
-    }
 
-    log_message(sysfile_log, "Loading `%s'.", complete_path);
+        log_message(sysfile_log, "Loading `%s'.", complete_path);
 
-    tmpsize = archdep_file_size(fp);
-    if (tmpsize < 0) {
-        log_message(sysfile_log, "Failed to determine size of '%s'.", complete_path);
-        goto fail;
+        rom = rom_cache_add(name, subpath, complete_path, fp);
+        fclose(fp);
+        if (rom == NULL) {
+            lib_free(complete_path);
+            return -1;
+        }
     }
-    rsize = (size_t)tmpsize;
+
+    src = rom->data;
+    rsize = rom->size;
     if (minsize < 0) {
         minsize = -minsize;
         load_at_end = 0;
@@ -290,16 +746,15 @@ int sysfile_load(const char *name, const char *subpath, uint8_t *dest, int minsi
     }
 
     if (rsize < ((size_t)minsize)) {
-        log_error(sysfile_log, "ROM %s: short file.", complete_path);
-        goto fail;
+        log_error(sysfile_log, "ROM %s: short file.", rom->complete_path);
+        return -1;
     }
     if (rsize == ((size_t)maxsize + 2)) {
         log_warning(sysfile_log,
                     "ROM `%s': two bytes too large - removing assumed "
-                    "start address.", complete_path);
-        if (fread((char *)dest, 1, 2, fp) < 2) {
-            goto fail;
-        }
+                    "start address.", rom->complete_path);
+        memcpy(dest, src, 2);
+        src += 2;
         rsize -= 2;
     }
     if (load_at_end && rsize < ((size_t)maxsize)) {
@@ -307,18 +762,10 @@ int sysfile_load(const char *name, const char *subpath, uint8_t *dest, int minsi
     } else if (rsize > ((size_t)maxsize)) {
         log_warning(sysfile_log,
                     "ROM `%s': long file (%"PRI_SIZE_T"), discarding end (%"PRI_SIZE_T" bytes).",
-                    complete_path, rsize, rsize - maxsize);
+                    rom->complete_path, rsize, rsize - maxsize);
         rsize = maxsize;
     }
-    if ((rsize = fread((char *)dest, 1, rsize, fp)) < ((size_t)minsize)) {
-        goto fail;
-    }
+    memcpy(dest, src, rsize);
 
-    fclose(fp);
-    lib_free(complete_path);
     return (int)rsize;  /* return ok */
-
-fail:
-    lib_free(complete_path);
-    return -1;
 }
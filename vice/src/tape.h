@@ -105,6 +105,7 @@ int tape_tap_attached(int port);
 
 void tape_traps_install(void);
 void tape_traps_deinstall(void);
+void tape_traps_refresh(void);
 
 tape_file_record_t *tape_get_current_file_record(tape_image_t *tape_image);
 int tape_seek_start(tape_image_t *tape_image);
@@ -1218,6 +1218,54 @@ static int tap_tt_skip_file(tap_t *tap)
 }
 
 
+/* ------------------------------------------------------------------------- */
+
+/* The encodings files on a TAP can be decoded from, indexed by pilot type.
+   Another encoding is added by giving it a pilot type, an entry here, and
+   teaching tap_find_pilot() and tap_determine_pilot_type() its pilot.  */
+typedef struct tap_loader_s {
+    const char *name;
+    /* read the header behind the pilot into tap_file_record */
+    int (*read_header)(tap_t *tap);
+    /* read header and data into current_file_data */
+    int (*read_file)(tap_t *tap);
+    /* skip header and data */
+    int (*skip_file)(tap_t *tap);
+    /* skip a pilot not followed by a valid header */
+    void (*skip_bad_pilot)(tap_t *tap);
+} tap_loader_t;
+
+static void tap_cbm_skip_bad_pilot(tap_t *tap)
+{
+    int pulse, pos_advance;
+
+    do {
+        pulse = tap_get_pulse(tap, &pos_advance);
+    } while (TAP_PULSE_SHORT(pulse));
+}
+
+static void tap_tt_skip_bad_pilot(tap_t *tap)
+{
+    tap_tt_skip_pilot(tap);
+}
+
+static const tap_loader_t tap_loaders[] = {
+    /* PILOT_TYPE_CBM */
+    { "CBM", tap_cbm_read_header, tap_cbm_read_file, tap_cbm_skip_file,
+      tap_cbm_skip_bad_pilot },
+    /* PILOT_TYPE_TT */
+    { "TurboTape", tap_tt_read_header, tap_tt_read_file, tap_tt_skip_file,
+      tap_tt_skip_bad_pilot }
+};
+
+static const tap_loader_t *tap_get_loader(int type)
+{
+    if (type < 0 || type >= (int)(sizeof(tap_loaders) / sizeof(tap_loaders[0]))) {
+        return NULL;
+    }
+    return &tap_loaders[type];
+}
+
 /* ------------------------------------------------------------------------- */
 
 #define PILOT_MIN_LENGTH_TT   200
@@ -1422,6 +1470,7 @@ static int tap_find_header(tap_t *tap)
 {
     int res, type;
     long fpos;
+    const tap_loader_t *loader;
 
     while (1) {
         /* find next pilot */
@@ -1435,24 +1484,14 @@ static int tap_find_header(tap_t *tap)
         fpos = ftell(tap->fd);
 
         /* try to read a header */
-        if (type == PILOT_TYPE_CBM) {
-            res = tap_cbm_read_header(tap);
-            if (res < 0) {
-                int pulse;
-                fseek(tap->fd, fpos, SEEK_SET);
-                do {
-                    int pos_advance;
-                    pulse = tap_get_pulse(tap, &pos_advance);
-                } while (TAP_PULSE_SHORT(pulse));
-            }
-        } else if (type == PILOT_TYPE_TT) {
-            res = tap_tt_read_header(tap);
-            if (res < 0) {
-                fseek(tap->fd, fpos, SEEK_SET);
-                tap_tt_skip_pilot(tap);
-            }
-        } else {
-            res = -2;
+        loader = tap_get_loader(type);
+        if (loader == NULL) {
+            return -1;
+        }
+        res = loader->read_header(tap);
+        if (res < 0) {
+            fseek(tap->fd, fpos, SEEK_SET);
+            loader->skip_bad_pilot(tap);
         }
 
         if (res == 0) {
@@ -1463,7 +1502,7 @@ static int tap_find_header(tap_t *tap)
 
             /* success.  Rewind to start of header and return. */
             fseek(tap->fd, fpos, SEEK_SET);
-            tap->current_file_seek_position = (int)fpos;
+            tap->current_file_seek_position = (int)(fpos - tap->offset);
             return type;
         }
     }
@@ -1474,6 +1513,7 @@ static int tap_read_file(tap_t *tap)
 {
     int ret;
     long fpos;
+    const tap_loader_t *loader;
 
 #if TAP_DEBUG > 0
     log_debug(LOG_DEFAULT, "\nTAP_READ_FILE(START)\n");
@@ -1487,12 +1527,9 @@ static int tap_read_file(tap_t *tap)
     lib_free(tap->current_file_data);
     tap->current_file_data = NULL;
 
-    ret = tap_determine_pilot_type(tap);
-    if (ret < 0) {
-    } else if (ret == PILOT_TYPE_CBM) {
-        ret = tap_cbm_read_file(tap);
-    } else if (ret == PILOT_TYPE_TT) {
-        ret = tap_tt_read_file(tap);
+    loader = tap_get_loader(tap_determine_pilot_type(tap));
+    if (loader != NULL) {
+        ret = loader->read_file(tap);
     } else {
         ret = -2;
     }
@@ -1520,6 +1557,7 @@ static int tap_read_file(tap_t *tap)
 static int tap_skip_file(tap_t *tap)
 {
     int ret;
+    const tap_loader_t *loader;
 
 #if TAP_DEBUG > 0
     log_debug(LOG_DEFAULT, "\nTAP_SKIP_FILE(START)\n");
@@ -1530,15 +1568,11 @@ static int tap_skip_file(tap_t *tap)
     lib_free(tap->current_file_data);
     tap->current_file_data = NULL;
 
-    ret = tap_determine_pilot_type(tap);
-    if (ret < 0) {
-        ret = -1;
-    } else if (ret == PILOT_TYPE_CBM) {
-        ret = tap_cbm_skip_file(tap);
-    } else if (ret == PILOT_TYPE_TT) {
-        ret = tap_tt_skip_file(tap);
+    loader = tap_get_loader(tap_determine_pilot_type(tap));
+    if (loader != NULL) {
+        ret = loader->skip_file(tap);
     } else {
-        ret = -2;
+        ret = -1;
     }
 
 #if TAP_DEBUG > 0
@@ -1649,6 +1683,57 @@ int tap_read(tap_t *tap, uint8_t *buf, size_t size)
     return 0;
 }
 
+/* Used by the kernal tape traps: find the next file the kernal can load,
+   starting at the position of the datasette, decode it for tap_read() and
+   move the datasette behind it.  A loader started by the file then finds
+   the rest of the tape where it expects it.  */
+int tap_seek_to_next_kernal_file(tap_t *tap)
+{
+    int type;
+    long fpos, end;
+
+    if (tap == NULL || tap->fd == NULL) {
+        return -1;
+    }
+
+    /* clear old file content buffer */
+    tap->current_file_size = 0;
+    lib_free(tap->current_file_data);
+    tap->current_file_data = NULL;
+
+    fseek(tap->fd, tap->offset + tap->current_file_seek_position, SEEK_SET);
+
+    while (1) {
+        type = tap_find_header(tap);
+        if (type < 0) {
+            return -1;
+        }
+        if (type == PILOT_TYPE_CBM
+            && (tap->tap_file_record->type == 1 || tap->tap_file_record->type == 3)) {
+            break;
+        }
+        /* turbo and sequential files are left to the datasette */
+        if (tap_skip_file(tap) < 0) {
+            return -1;
+        }
+    }
+
+    fpos = ftell(tap->fd);
+    tap_skip_file(tap);
+    end = ftell(tap->fd);
+
+    fseek(tap->fd, fpos, SEEK_SET);
+    if (tap_read_file(tap) >= 0) {
+        tap->current_file_data_pos = 0;
+    }
+
+    fseek(tap->fd, end, SEEK_SET);
+    tap->current_file_seek_position = (int)(end - tap->offset);
+    tap->current_file_number++;
+
+    return 0;
+}
+
 int tap_seek_to_offset(tap_t *tap, unsigned long offset)
 {
     if (tap && tap->fd) {
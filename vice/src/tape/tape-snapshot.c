@@ -58,7 +58,8 @@ static int tape_snapshot_write_t64image_module(snapshot_t *s)
 
 static int tape_snapshot_read_t64image_module(snapshot_t *s)
 {
-    log_error(tape_snapshot_log, "T64 snapshot support is not implemented");
+    /* the write side never stores a T64 module, so there is nothing to
+       read (and nothing to complain about on every snapshot load) */
     return 0; /* should be -1, but that would make snapshots with default settings fail */
 }
 
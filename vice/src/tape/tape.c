@@ -79,6 +79,9 @@ static int tape_is_initialized = 0;
 /* Tape traps to be installed.  */
 static const trap_t *tape_traps;
 
+/* Flag: are the tape traps installed?  */
+static int tape_traps_installed = 0;
+
 /* Logging goes here.  */
 static log_t tape_log = LOG_DEFAULT;
 
@@ -98,10 +101,11 @@ void tape_traps_install(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && !tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_add(p);
         }
+        tape_traps_installed = 1;
     }
 }
 
@@ -109,11 +113,30 @@ void tape_traps_deinstall(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_remove(p);
         }
     }
+    tape_traps_installed = 0;
+}
+
+/* The traps are removed while a TAP image is attached, so the kernal reads
+   it through the datasette.  With DatasetteKernalTraps set, a TAP image in
+   the first datasette keeps them and they load its kernal files.  */
+void tape_traps_refresh(void)
+{
+    int i;
+
+    for (i = 0; i < TAPEPORT_MAX_PORTS; i++) {
+        if (tape_image_dev[i] != NULL && tape_image_dev[i]->name != NULL
+            && tape_image_dev[i]->type == TAPE_TYPE_TAP
+            && (i != TAPEPORT_PORT_1 || !datasette_kernal_traps)) {
+            tape_traps_deinstall();
+            return;
+        }
+    }
+    tape_traps_install();
 }
 
 static void tape_init_vars(const tape_init_t *init)
@@ -171,7 +194,7 @@ int tape_reinit(const tape_init_t *init)
     tape_traps = NULL;
 
     tape_init_vars(init);
-    tape_traps_install();
+    tape_traps_refresh();
 
     return 0;
 }
@@ -228,43 +251,85 @@ static int default_tape_header_type(void)
     return machine_tape_type_default();
 }
 
-/* Find the next Tape Header and load it onto the Tape Buffer.  */
-int tape_find_header_trap(void)
+/* Find the next file on the tape in the first datasette the kernal can load.
+   `type' is set to the header type to hand to the kernal.  */
+static int find_next_file(int *type, uint16_t *start_addr, uint16_t *end_addr,
+                          uint8_t *name)
 {
-    int err;
-    uint8_t *cassette_buffer;
+    tape_image_t *tape_image = tape_image_dev[TAPEPORT_PORT_1];
 
-    cassette_buffer = mem_ram + (mem_read(buffer_pointer_addr) | (mem_read((uint16_t)(buffer_pointer_addr + 1)) << 8));
+    if (tape_image->name == NULL) {
+        return -1;
+    }
 
-    if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
-        || tape_image_dev[TAPEPORT_PORT_1]->type != TAPE_TYPE_T64) {
-        err = 1;
-    } else {
-        t64_t *t64;
+    if (tape_image->type == TAPE_TYPE_T64) {
+        t64_t *t64 = (t64_t *)tape_image->data;
         t64_file_record_t *rec;
 
-        t64 = (t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data;
-        rec = NULL;
-
-        err = 0;
         do {
             if (t64_seek_to_next_file(t64, 1) < 0) {
-                err = 1;
-                break;
+                return -1;
             }
-
             rec = t64_get_current_file_record(t64);
         } while (rec->entry_type != T64_FILE_RECORD_NORMAL);
 
-        if (!err) {
-            cassette_buffer[CAS_TYPE_OFFSET] = default_tape_header_type();
-            cassette_buffer[CAS_STAD_OFFSET] = rec->start_addr & 0xff;
-            cassette_buffer[CAS_STAD_OFFSET + 1] = rec->start_addr >> 8;
-            cassette_buffer[CAS_ENAD_OFFSET] = rec->end_addr & 0xff;
-            cassette_buffer[CAS_ENAD_OFFSET + 1] = rec->end_addr >> 8;
-            memcpy(cassette_buffer + CAS_NAME_OFFSET,
-                   rec->cbm_name, T64_REC_CBMNAME_LEN);
+        *type = default_tape_header_type();
+        *start_addr = rec->start_addr;
+        *end_addr = rec->end_addr;
+        memcpy(name, rec->cbm_name, T64_REC_CBMNAME_LEN);
+        return 0;
+    }
+
+    if (tape_image->type == TAPE_TYPE_TAP) {
+        tap_t *tap = (tap_t *)tape_image->data;
+        tape_file_record_t *rec;
+
+        if (tap_seek_to_next_kernal_file(tap) < 0) {
+            return -1;
         }
+        rec = tap_get_current_file_record(tap);
+
+        /* a TAP keeps the type of the header, see default_tape_header_type() */
+        *type = rec->type;
+        if (autostart_in_progress() && (autostart_tape_basic_load == 1)) {
+            *type = TAPE_CAS_TYPE_BAS;
+        }
+        *start_addr = rec->start_addr;
+        *end_addr = rec->end_addr;
+        memcpy(name, rec->name, T64_REC_CBMNAME_LEN);
+        return 0;
+    }
+
+    return -1;
+}
+
+/* Read data of the file found by find_next_file().  */
+static int read_file_data(uint8_t *buf, int len)
+{
+    tape_image_t *tape_image = tape_image_dev[TAPEPORT_PORT_1];
+
+    if (tape_image->name != NULL && tape_image->type == TAPE_TYPE_TAP) {
+        return tap_read((tap_t *)tape_image->data, buf, (size_t)len);
+    }
+    return t64_read((t64_t *)tape_image->data, buf, len);
+}
+
+/* Find the next Tape Header and load it onto the Tape Buffer.  */
+int tape_find_header_trap(void)
+{
+    int err, type;
+    uint16_t start_addr, end_addr;
+    uint8_t *cassette_buffer;
+
+    cassette_buffer = mem_ram + (mem_read(buffer_pointer_addr) | (mem_read((uint16_t)(buffer_pointer_addr + 1)) << 8));
+
+    err = find_next_file(&type, &start_addr, &end_addr, cassette_buffer + CAS_NAME_OFFSET);
+    if (!err) {
+        cassette_buffer[CAS_TYPE_OFFSET] = (uint8_t)type;
+        cassette_buffer[CAS_STAD_OFFSET] = start_addr & 0xff;
+        cassette_buffer[CAS_STAD_OFFSET + 1] = start_addr >> 8;
+        cassette_buffer[CAS_ENAD_OFFSET] = end_addr & 0xff;
+        cassette_buffer[CAS_ENAD_OFFSET + 1] = end_addr >> 8;
     }
 
     if (err) {
@@ -298,40 +363,19 @@ int tape_find_header_trap(void)
 
 int tape_find_header_trap_plus4(void)
 {
-    int err;
+    int err, type;
+    uint16_t start_addr, end_addr;
     uint8_t *cassette_buffer;
 
     cassette_buffer = mem_ram + buffer_pointer_addr;
 
-    if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
-        || tape_image_dev[TAPEPORT_PORT_1]->type != TAPE_TYPE_T64) {
-        err = 1;
-    } else {
-        t64_t *t64;
-        t64_file_record_t *rec;
-
-        t64 = (t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data;
-        rec = NULL;
-
-        err = 0;
-        do {
-            if (t64_seek_to_next_file(t64, 1) < 0) {
-                err = 1;
-                break;
-            }
-
-            rec = t64_get_current_file_record(t64);
-        } while (rec->entry_type != T64_FILE_RECORD_NORMAL);
-
-        if (!err) {
-            mem_store(0xF8, default_tape_header_type());
-            cassette_buffer[CAS_STAD_OFFSET - 1] = rec->start_addr & 0xff;
-            cassette_buffer[CAS_STAD_OFFSET] = rec->start_addr >> 8;
-            cassette_buffer[CAS_ENAD_OFFSET - 1] = rec->end_addr & 0xff;
-            cassette_buffer[CAS_ENAD_OFFSET] = rec->end_addr >> 8;
-            memcpy(cassette_buffer + CAS_NAME_OFFSET - 1,
-                   rec->cbm_name, T64_REC_CBMNAME_LEN);
-        }
+    err = find_next_file(&type, &start_addr, &end_addr, cassette_buffer + CAS_NAME_OFFSET - 1);
+    if (!err) {
+        mem_store(0xF8, (uint8_t)type);
+        cassette_buffer[CAS_STAD_OFFSET - 1] = start_addr & 0xff;
+        cassette_buffer[CAS_STAD_OFFSET] = start_addr >> 8;
+        cassette_buffer[CAS_ENAD_OFFSET - 1] = end_addr & 0xff;
+        cassette_buffer[CAS_ENAD_OFFSET] = end_addr >> 8;
     }
 
     if (err) {
@@ -386,7 +430,7 @@ int tape_receive_trap(void)
                 int amount;
 
                 len = (int)(end - start);
-                amount = t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data, mem_ram + (int)start, len);
+                amount = read_file_data(mem_ram + (int)start, len);
                 if (amount == len) {
                     st = 0x40;  /* EOF */
                 } else {
@@ -429,8 +473,7 @@ int tape_receive_trap_plus4(void)
     /* Read block.  */
     len = end - start;
 
-    if (t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data,
-                 mem_ram + (int) start, (int)len) == (int) len) {
+    if (read_file_data(mem_ram + (int) start, (int)len) == (int) len) {
         st = 0x40;      /* EOF */
     } else {
         st = 0x10;
@@ -494,8 +537,6 @@ int tape_image_detach_internal(unsigned int unit)
             log_message(tape_log,
                         "Detaching TAP image `%s'.", tape_image_dev[unit - 1]->name);
             datasette_set_tape_image(unit - 1, NULL);
-
-            tape_traps_install();
             break;
         default:
             log_error(tape_log, "Unknown tape type %u.",
@@ -503,6 +544,7 @@ int tape_image_detach_internal(unsigned int unit)
     }
 
     retval = tape_image_close(tape_image_dev[unit - 1]);
+    tape_traps_refresh();
 
     ui_display_tape_current_image(unit - 1, "");
 
@@ -591,7 +633,7 @@ static int tape_image_attach_internal(unsigned int unit, const char *name)
             log_message(tape_log, "TAP image version: %i, system: %i.",
                         ((tap_t *)tape_image_dev[unit - 1]->data)->version,
                         ((tap_t *)tape_image_dev[unit - 1]->data)->system);
-            tape_traps_deinstall();
+            tape_traps_refresh();
             break;
         default:
             log_error(tape_log, "Unknown tape type %u.",
@@ -0,0 +1,489 @@
+/*
+ * testrunner.c - Run a list of test programs in one emulator instance.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With "-testmanifest" the emulator runs the test programs listed in the
+   manifest one after the other instead of exiting after the first one. The
+   machine state at the first frame is kept as an in-memory snapshot, and
+   every test starts by restoring it and autostarting the program, so the
+   emulator is only started and the ROMs are only loaded once. A test ends
+   when the program writes its exit code to the debug cartridge or when its
+   cycle limit is reached, and the results are written as JUnit XML.
+
+   To run tests in parallel, start one emulator per CPU core with the same
+   manifest and "-testshard <n>/<count>"; each one runs its share of the
+   tests and writes its own report.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "autostart.h"
+#include "cmdline.h"
+#include "fuzz.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "snapshot.h"
+#include "testrunner.h"
+#include "types.h"
+#include "util.h"
+
+typedef enum testrunner_result_e {
+    TEST_NOT_RUN,
+    TEST_PASSED,
+    TEST_FAILED,
+    TEST_TIMEOUT,
+    TEST_ERROR
+} testrunner_result_t;
+
+typedef struct testrunner_test_s {
+    char *program;
+    CLOCK cycles;           /* cycle limit, 0 for the "-limitcycles" default */
+    int expected;           /* expected exit code */
+
+    testrunner_result_t result;
+    int exit_code;
+    CLOCK cycles_used;
+    double seconds;
+} testrunner_test_t;
+
+static log_t testrunner_log = LOG_DEFAULT;
+
+static char *manifest_name = NULL;
+static char *report_name = NULL;
+static int shard_index = 0;
+static int shard_count = 1;
+
+static testrunner_test_t *tests = NULL;
+static int tests_num = 0;
+
+/* Test being run, -1 before the first one */
+static int current = -1;
+
+/* Set once the manifest is loaded and until the last test is done */
+static int running = 0;
+
+/* Set while waiting for the trap starting the next test */
+static int pending = 0;
+
+/* Machine state every test starts from */
+static snapshot_memory_t *baseline = NULL;
+
+static CLOCK default_cycles = 0;
+static CLOCK test_start_clk;
+static tick_t test_start_tick;
+
+/* ------------------------------------------------------------------------- */
+
+/* Get the next field of a manifest line, which may be double quoted */
+static char *next_field(char **line)
+{
+    char *p = *line;
+    char *field;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p == '\0' || *p == '#') {
+        return NULL;
+    }
+
+    if (*p == '"') {
+        field = ++p;
+        while (*p != '\0' && *p != '"') {
+            p++;
+        }
+    } else {
+        field = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+    }
+    if (*p != '\0') {
+        *p++ = '\0';
+    }
+    *line = p;
+
+    return field;
+}
+
+/* Read the manifest, one test per line: the program, optionally followed by
+   the cycle limit and the expected exit code. Empty lines and lines starting
+   with '#' are skipped. Only the tests of our shard are kept.  */
+static int load_manifest(const char *filename)
+{
+    FILE *fp;
+    char buffer[1024];
+    char *line, *field;
+    int index = 0;
+    testrunner_test_t *test;
+
+    fp = fopen(filename, MODE_READ_TEXT);
+    if (fp == NULL) {
+        log_error(testrunner_log, "Cannot open test manifest `%s'.", filename);
+        return -1;
+    }
+
+    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        line = buffer;
+        field = next_field(&line);
+        if (field == NULL) {
+            continue;
+        }
+        if (index++ % shard_count != shard_index) {
+            continue;
+        }
+
+        tests = lib_realloc(tests, sizeof(testrunner_test_t) * (size_t)(tests_num + 1));
+        test = &tests[tests_num++];
+        memset(test, 0, sizeof(testrunner_test_t));
+        test->program = lib_strdup(field);
+        if ((field = next_field(&line)) != NULL) {
+            test->cycles = (CLOCK)strtoull(field, NULL, 0);
+        }
+        if ((field = next_field(&line)) != NULL) {
+            test->expected = (int)strtol(field, NULL, 0);
+        }
+    }
+
+    fclose(fp);
+
+    log_message(testrunner_log, "%d test(s) to run from `%s'.", tests_num, filename);
+    return 0;
+}
+
+static void write_escaped(FILE *fp, const char *s)
+{
+    for (; *s != '\0'; s++) {
+        switch (*s) {
+            case '&':
+                fputs("&amp;", fp);
+                break;
+            case '<':
+                fputs("&lt;", fp);
+                break;
+            case '>':
+                fputs("&gt;", fp);
+                break;
+            case '"':
+                fputs("&quot;", fp);
+                break;
+            default:
+                fputc(*s, fp);
+                break;
+        }
+    }
+}
+
+static int write_report(const char *filename, int failures, int errors, double seconds)
+{
+    FILE *fp;
+    testrunner_test_t *test;
+    int i;
+
+    fp = fopen(filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        log_error(testrunner_log, "Cannot write test report `%s'.", filename);
+        return -1;
+    }
+
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(fp, "<testsuite name=\"%s\" tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.3f\">\n",
+            machine_name, tests_num, failures, errors, seconds);
+
+    for (i = 0; i < tests_num; i++) {
+        test = &tests[i];
+        fprintf(fp, "  <testcase classname=\"%s\" name=\"", machine_name);
+        write_escaped(fp, test->program);
+        fprintf(fp, "\" time=\"%.3f\">\n", test->seconds);
+        switch (test->result) {
+            case TEST_FAILED:
+                fprintf(fp, "    <failure message=\"exit code %d, expected %d\"/>\n",
+                        test->exit_code, test->expected);
+                break;
+            case TEST_TIMEOUT:
+                fprintf(fp, "    <failure message=\"cycle limit reached\"/>\n");
+                break;
+            case TEST_ERROR:
+                fprintf(fp, "    <error message=\"cannot autostart the program\"/>\n");
+                break;
+            case TEST_NOT_RUN:
+                fprintf(fp, "    <skipped/>\n");
+                break;
+            default:
+                break;
+        }
+        fprintf(fp, "    <system-out>cycles: %"PRIu64"</system-out>\n", test->cycles_used);
+        fprintf(fp, "  </testcase>\n");
+    }
+
+    fprintf(fp, "</testsuite>\n");
+    fclose(fp);
+
+    return 0;
+}
+
+/* Write the report and quit, the exit code tells whether all tests passed */
+static void finish(void)
+{
+    int i, failures = 0, errors = 0;
+    double seconds = 0.0;
+
+    running = 0;
+
+    for (i = 0; i < tests_num; i++) {
+        seconds += tests[i].seconds;
+        if (tests[i].result == TEST_FAILED || tests[i].result == TEST_TIMEOUT) {
+            failures++;
+        } else if (tests[i].result != TEST_PASSED) {
+            errors++;
+        }
+    }
+
+    log_message(testrunner_log, "%d test(s), %d failure(s), %d error(s), %.3f seconds.",
+                tests_num, failures, errors, seconds);
+
+    if (report_name != NULL) {
+        write_report(report_name, failures, errors, seconds);
+    }
+
+    archdep_vice_exit((failures || errors) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void end_test(testrunner_result_t result, int exit_code);
+
+/* Restore the baseline and autostart the next test */
+static void start_test_trap(uint16_t addr, void *data)
+{
+    testrunner_test_t *test;
+
+    pending = 0;
+
+    if (++current >= tests_num) {
+        finish();
+        return;
+    }
+    test = &tests[current];
+
+    if (baseline == NULL) {
+        baseline = snapshot_memory_new();
+        snapshot_memory_redirect(baseline);
+        if (machine_write_snapshot("", 0, 0, 0) < 0) {
+            snapshot_memory_redirect(NULL);
+            log_error(testrunner_log, "Cannot save the machine state.");
+            finish();
+            return;
+        }
+        snapshot_memory_redirect(NULL);
+    } else {
+        snapshot_memory_redirect(baseline);
+        if (machine_read_snapshot("", 0) < 0) {
+            snapshot_memory_redirect(NULL);
+            log_error(testrunner_log, "Cannot restore the machine state.");
+            finish();
+            return;
+        }
+        snapshot_memory_redirect(NULL);
+    }
+
+    log_message(testrunner_log, "Test %d/%d: %s", current + 1, tests_num, test->program);
+
+    test_start_clk = maincpu_clk;
+    test_start_tick = tick_now();
+
+    if (autostart_autodetect(test->program, NULL, 0, AUTOSTART_MODE_RUN) < 0) {
+        end_test(TEST_ERROR, 0);
+        return;
+    }
+
+    if (test->cycles != 0) {
+        maincpu_clk_limit = maincpu_clk + test->cycles;
+    } else if (default_cycles != 0) {
+        maincpu_clk_limit = maincpu_clk + default_cycles;
+    } else {
+        maincpu_clk_limit = 0;
+    }
+}
+
+static void end_test(testrunner_result_t result, int exit_code)
+{
+    testrunner_test_t *test = &tests[current];
+
+    maincpu_clk_limit = 0;
+
+    test->result = result;
+    test->exit_code = exit_code;
+    test->cycles_used = maincpu_clk - test_start_clk;
+    test->seconds = (double)(tick_t)(tick_now() - test_start_tick) / tick_per_second();
+
+    log_message(testrunner_log, "Test %d/%d: %s (exit code %d, %"PRIu64" cycles).",
+                current + 1, tests_num,
+                result == TEST_PASSED ? "passed"
+                : result == TEST_FAILED ? "failed"
+                : result == TEST_TIMEOUT ? "cycle limit reached" : "error",
+                exit_code, test->cycles_used);
+
+    pending = 1;
+    interrupt_maincpu_trigger_trap(start_test_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/** \brief  End of frame hook, starts the first test */
+void testrunner_do_vsync(void)
+{
+    if (manifest_name == NULL || running || current >= 0) {
+        return;
+    }
+
+    testrunner_log = log_open("TestRunner");
+
+    if (load_manifest(manifest_name) < 0) {
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+
+    /* "-limitcycles" becomes the limit of every single test */
+    default_cycles = maincpu_clk_limit;
+    maincpu_clk_limit = 0;
+
+    running = 1;
+    pending = 1;
+    interrupt_maincpu_trigger_trap(start_test_trap, NULL);
+}
+
+/** \brief  Handle the exit code written to the debug cartridge
+ *
+ * Ends the current test when running tests, or the current run when
+ * fuzzing, else quits the emulator.
+ *
+ * \param[in]   exit_code   exit code
+ */
+void testrunner_exit(int exit_code)
+{
+    if (fuzz_exit(exit_code)) {
+        return;
+    }
+    if (!running) {
+        archdep_vice_exit(exit_code);
+        return;
+    }
+    if (pending) {
+        return;
+    }
+
+    end_test(exit_code == tests[current].expected ? TEST_PASSED : TEST_FAILED, exit_code);
+}
+
+/** \brief  Handle reaching the "-limitcycles" limit
+ *
+ * Ends the current test when running tests, or the current run when
+ * fuzzing, else quits the emulator.
+ */
+void testrunner_cycle_limit(void)
+{
+    if (fuzz_cycle_limit()) {
+        return;
+    }
+    if (!running) {
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+    if (pending) {
+        return;
+    }
+
+    end_test(TEST_TIMEOUT, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_testmanifest(const char *param, void *extra_param)
+{
+    util_string_set(&manifest_name, param);
+    return 0;
+}
+
+static int cmdline_testreport(const char *param, void *extra_param)
+{
+    util_string_set(&report_name, param);
+    return 0;
+}
+
+static int cmdline_testshard(const char *param, void *extra_param)
+{
+    int index, count;
+
+    if (sscanf(param, "%d/%d", &index, &count) != 2
+        || count < 1 || index < 1 || index > count) {
+        return -1;
+    }
+    shard_index = index - 1;
+    shard_count = count;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-testmanifest", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_testmanifest, NULL, NULL, NULL,
+      "<filename>", "Run the test programs listed in the manifest, then quit" },
+    { "-testreport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_testreport, NULL, NULL, NULL,
+      "<filename>", "Write the test results as JUnit XML" },
+    { "-testshard", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_testshard, NULL, NULL, NULL,
+      "<n>/<count>", "Only run every <count>th test of the manifest, starting with the <n>th" },
+    CMDLINE_LIST_END
+};
+
+int testrunner_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void testrunner_shutdown(void)
+{
+    int i;
+
+    for (i = 0; i < tests_num; i++) {
+        lib_free(tests[i].program);
+    }
+    lib_free(tests);
+    tests = NULL;
+    tests_num = 0;
+
+    snapshot_memory_free(baseline);
+    baseline = NULL;
+
+    lib_free(manifest_name);
+    manifest_name = NULL;
+    lib_free(report_name);
+    report_name = NULL;
+}
@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -44,6 +45,15 @@
 #include <unistd.h>
 #endif
 
+#ifdef UNIX_COMPILE
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#define BATCH_SUPPORTED
+#endif
+
 
 #include "version.h"
 #ifdef USE_SVN_REVISION
@@ -111,6 +121,12 @@ static int repair_mode = 0;
 static int input_padding = 0;
 static char *options_filename = NULL;
 
+/* batch mode */
+static char *batch_dir = NULL;
+static int batch_check = 0;
+static int batch_jobs = 0;
+static char *index_filename = NULL;
+
 int machine_class = VICE_MACHINE_C64;
 
 int verbose = 0;
@@ -200,6 +216,12 @@ void cleanup(void)
     if (options_filename != NULL) {
         free(options_filename);
     }
+    if (batch_dir != NULL) {
+        free(batch_dir);
+    }
+    if (index_filename != NULL) {
+        free(index_filename);
+    }
     if (cart_name != NULL) {
         free(cart_name);
     }
@@ -1381,10 +1403,286 @@ static void usage(void)
             "-v --verbose                verbose\n"
             "--types                     show the supported cart types\n"
             "--version                   print cartconv version\n"
-            "--options-file <filename>   write options for reverting the conversion into a file (for test script)\n");
+            "--options-file <filename>   write options for reverting the conversion into a file (for test script)\n"
+            "--batch <dir>               convert all files in a directory, -o gives the output directory\n"
+            "--check-dir <dir>           check all files in a directory\n"
+            "--index <name>              with --check-dir, write an index of the .crt files\n"
+            "--jobs <n>                  number of files done at the same time in batch mode\n");
+    exit(1);
+}
+
+/*****************************************************************************/
+
+/* In batch mode every file of the directory is done by a child process of
+   its own, which goes on as if cartconv had been started for that file
+   alone.  The conversion keeps its state in globals and gives up with
+   exit(), so that is both the simplest and the safest way to do several
+   files at the same time.  The parent only starts the children, up to
+   `batch_jobs' at once, and tells which files failed.  */
+
+#ifdef BATCH_SUPPORTED
+
+static uint32_t crc32_table[256];
+
+static uint32_t index_crc32(FILE *f)
+{
+    unsigned char buf[0x1000];
+    uint32_t crc = 0xffffffff;
+    size_t len, i;
+    int j;
+
+    if (crc32_table[1] == 0) {
+        for (i = 0; i < 256; i++) {
+            uint32_t c = (uint32_t)i;
+            for (j = 0; j < 8; j++) {
+                c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+            }
+            crc32_table[i] = c;
+        }
+    }
+
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (i = 0; i < len; i++) {
+            crc = crc32_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+        }
+    }
+    return crc ^ 0xffffffff;
+}
+
+/* Add the .crt file `name' to the index: the CRC32 of the whole file, the
+   hardware type, the machine and the cartridge name from its header.  The
+   line is written with a single write() to the index opened for appending,
+   so the lines of the children do not mix.  */
+static void write_index_line(char *name)
+{
+    char line[0x200];
+    char cname[0x21];
+    char machine[0x11];
+    FILE *f;
+    uint32_t crc;
+    int crtid, fd, len;
+
+    if (detect_input_file(name) < 0 || loadfile_is_crt != 1) {
+        return;
+    }
+    f = fopen(name, "rb");
+    if (f == NULL) {
+        return;
+    }
+    crc = index_crc32(f);
+    fclose(f);
+
+    crtid = headerbuffer[0x17] + (headerbuffer[0x16] << 8);
+    memcpy(cname, &headerbuffer[0x20], 0x20);
+    cname[0x20] = 0;
+    /* "C64 CARTRIDGE   " and so on */
+    memcpy(machine, headerbuffer, 0x10);
+    machine[0x10] = 0;
+    *strchr(machine, ' ') = 0;
+
+    len = snprintf(line, sizeof(line), "%08x %-5s %5d \"%s\" %s\n",
+                   (unsigned int)crc, machine, crtid, cname, name);
+    if (len < 0 || len >= (int)sizeof(line)) {
+        return;
+    }
+
+    fd = open(index_filename, O_WRONLY | O_APPEND);
+    if (fd >= 0) {
+        if (write(fd, line, (size_t)len) != len) {
+            fprintf(stderr, "Error: can not write to index '%s'.\n", index_filename);
+        }
+        close(fd);
+    }
+}
+
+static int compare_names(const void *op1, const void *op2)
+{
+    return strcmp(*(char * const *)op1, *(char * const *)op2);
+}
+
+/* Read the names of the regular files in `dir', sorted.  */
+static char **read_dir(char *dir, int *num)
+{
+    DIR *d;
+    struct dirent *entry;
+    struct stat st;
+    char **names = NULL;
+    char *path;
+    int n = 0;
+
+    d = opendir(dir);
+    if (d == NULL) {
+        fprintf(stderr, "Error: can not open directory '%s'.\n", dir);
+        cleanup();
+        exit(1);
+    }
+    while ((entry = readdir(d)) != NULL) {
+        path = malloc(strlen(dir) + strlen(entry->d_name) + 2);
+        sprintf(path, "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        names = realloc(names, sizeof(char *) * (size_t)(n + 1));
+        names[n++] = path;
+    }
+    closedir(d);
+
+    if (n > 0) {
+        qsort(names, (size_t)n, sizeof(char *), compare_names);
+    }
+    *num = n;
+    return names;
+}
+
+/* Name of the output file for `name' in the output directory.  */
+static char *batch_output_name(char *name)
+{
+    const char *ext = ".bin";
+    char *base, *dot, *out;
+
+    if (convert_to_prg) {
+        ext = ".prg";
+    } else if (cart_type != -1) {
+        ext = ".crt";
+    }
+
+    base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    out = malloc(strlen(output_filename[0]) + strlen(base) + strlen(ext) + 2);
+    sprintf(out, "%s/%s", output_filename[0], base);
+    dot = strrchr(out + strlen(output_filename[0]) + 1, '.');
+    if (dot != NULL) {
+        *dot = 0;
+    }
+    strcat(out, ext);
+    return out;
+}
+
+/* Wait for a child and tell if its file failed.  */
+static int wait_child(pid_t *pids, char **names, int num)
+{
+    int status, i;
+    pid_t pid;
+
+    do {
+        pid = wait(&status);
+    } while (pid < 0 && errno == EINTR);
+    if (pid < 0) {
+        return 0;
+    }
+    for (i = 0; i < num; i++) {
+        if (pids[i] == pid) {
+            pids[i] = 0;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "%s: failed\n", names[i]);
+                return 1;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+/* Start a child for every file.  Only returns in the children, with the
+   input and output file set up for the usual conversion.  */
+static void run_batch(void)
+{
+    char **names;
+    pid_t *pids;
+    int num, i, running = 0, failed = 0;
+    int fd;
+
+    if (!batch_check && (output_filenames != 1 || input_filenames != 0)) {
+        fprintf(stderr, "Error: --batch needs one output directory and no input filename\n");
+        cleanup();
+        exit(1);
+    }
+
+    if (!batch_check && mkdir(output_filename[0], 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: can not create directory '%s'.\n", output_filename[0]);
+        cleanup();
+        exit(1);
+    }
+
+    if (index_filename != NULL) {
+        fd = open(index_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "Error: can not create index '%s'.\n", index_filename);
+            cleanup();
+            exit(1);
+        }
+        close(fd);
+    }
+
+    if (batch_jobs <= 0) {
+        batch_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (batch_jobs <= 0) {
+            batch_jobs = 1;
+        }
+    }
+
+    names = read_dir(batch_dir, &num);
+    pids = calloc((size_t)num + 1, sizeof(pid_t));
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i = 0; i < num; i++) {
+        if (running == batch_jobs) {
+            failed += wait_child(pids, names, num);
+            running--;
+        }
+
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            fprintf(stderr, "Error: can not start a job for '%s'.\n", names[i]);
+            pids[i] = 0;
+            failed++;
+            continue;
+        }
+        if (pids[i] == 0) {
+            if (batch_check) {
+                if (index_filename != NULL) {
+                    write_index_line(names[i]);
+                }
+                check_file(names[i]);
+            }
+            input_filename[0] = strdup(names[i]);
+            input_filenames = 1;
+            output_filename[0] = batch_output_name(names[i]);
+            return;
+        }
+        running++;
+    }
+    while (running > 0) {
+        failed += wait_child(pids, names, num);
+        running--;
+    }
+
+    if (!quiet_mode) {
+        printf("%d files, %d failed.\n", num, failed);
+    }
+    for (i = 0; i < num; i++) {
+        free(names[i]);
+    }
+    free(names);
+    free(pids);
+    cleanup();
+    exit(failed ? 1 : 0);
+}
+
+#else /* BATCH_SUPPORTED */
+
+static void run_batch(void)
+{
+    fprintf(stderr, "Error: batch mode is not supported on this platform\n");
+    cleanup();
     exit(1);
 }
 
+#endif /* BATCH_SUPPORTED */
+
 /*****************************************************************************/
 
 static void unknown(char *opt)
@@ -1613,6 +1911,25 @@ static int checkflag(char *flg, char *arg)
         } else if(strcmp(flg, "--verbose") == 0) {
             verbose = 1;
             return 1;
+        } else if (strcmp(flg, "--batch") == 0 || strcmp(flg, "--check-dir") == 0) {
+            checkarg(arg);
+            if (batch_dir != NULL) {
+                usage();
+            }
+            batch_dir = strdup(arg);
+            batch_check = (flg[2] == 'c');
+            return 2;
+        } else if (strcmp(flg, "--index") == 0) {
+            checkarg(arg);
+            if (index_filename != NULL) {
+                usage();
+            }
+            index_filename = strdup(arg);
+            return 2;
+        } else if (strcmp(flg, "--jobs") == 0) {
+            checkarg(arg);
+            batch_jobs = atoi(arg);
+            return 2;
         } else if (strcmp(flg, "--version") == 0) {
 #ifdef USE_SVN_REVISION
             printf("cartconv (VICE %s SVN r%d)\n", VERSION, VICE_SVN_REV_NUMBER);
@@ -1646,6 +1963,15 @@ int main(int argc, char *argv[])
         arg_counter += checkflag(flag, argument);
     }
 
+    if (batch_dir != NULL) {
+        /* only returns in the children doing the files */
+        run_batch();
+    } else if (index_filename != NULL) {
+        fprintf(stderr, "Error: --index needs --check-dir\n");
+        cleanup();
+        exit(1);
+    }
+
     /* check arguments */
 
     if (output_filenames == 0) {
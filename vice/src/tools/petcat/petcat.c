@@ -1074,11 +1074,38 @@ static int verbose = 0;     /* flag, =1 for verbose output */
 static const unsigned char MagicHeaderP00[P00HDR_TAG_LEN + 1] = "C64File\0";
 
 static chksum_t *checksummer = NULL;
+
+/* buffer size for the input and output files */
+#define PETCAT_BUFSIZE  0x10000
+
+/* longest name in a file list */
+#define PETCAT_NAME_MAX 4096
+
+/* read the next name from a file list, NULL at its end */
+static char *next_list_name(FILE *list, char *name)
+{
+    size_t len;
+
+    while (fgets(name, PETCAT_NAME_MAX, list) != NULL) {
+        len = strlen(name);
+        while (len > 0 && (name[len - 1] == '\n' || name[len - 1] == '\r')) {
+            name[--len] = '\0';
+        }
+        if (len > 0) {
+            return name;
+        }
+    }
+    return NULL;
+}
 /* ------------------------------------------------------------------------- */
 
 int main(int argc, char **argv)
 {
     char *progname, *outfilename = NULL;
+    char *listfilename = NULL;
+    FILE *list = NULL;
+    char listname[PETCAT_NAME_MAX];
+    const char *infilename = NULL;
     int c = 0;
 
     unsigned long offset = 0;
@@ -1158,6 +1185,14 @@ int main(int argc, char **argv)
             }
             fprintf (stderr, "\nOutput filename missing\n");
             /* Fall to error */
+        } else if (!strcmp(argv[0], "-files")) {
+            if (argc > 1) {
+                listfilename = argv[1];
+                --argc; ++argv;
+                continue;
+            }
+            fprintf (stderr, "\nFile list name missing\n");
+            /* Fall to error */
         }
 
         /* reading offset */
@@ -1202,8 +1237,21 @@ int main(int argc, char **argv)
  * Check parameters
  */
 
-    if (argc) {
+    if (listfilename != NULL) {
+        if (!strcmp(listfilename, "-")) {
+            list = stdin;
+        } else if ((list = fopen(listfilename, "r")) == NULL) {
+            fprintf(stderr, "\n%s: Can't open file list %s\n", progname, listfilename);
+            exit(1);
+        }
+        fil++;
+        if ((infilename = next_list_name(list, listname)) == NULL) {
+            /* nothing to do */
+            return 0;
+        }
+    } else if (argc) {
         fil++;
+        infilename = argv[0];
     }
 
     if (hdr == -1) {
@@ -1268,6 +1316,17 @@ int main(int argc, char **argv)
         }
     }
 
+    /* all files go to the same output file */
+    if (!outf) {
+        dest = stdout;
+    } else {
+        if ((dest = fopen(outfilename, "wb")) == NULL) {
+            fprintf(stderr, "\n%s: Can't open output file %s\n", progname, outfilename);
+            exit(1);
+        }
+    }
+    setvbuf(dest, NULL, _IOFBF, PETCAT_BUFSIZE);
+
     /*
      * Loop all files
      */
@@ -1301,20 +1360,11 @@ int main(int argc, char **argv)
                 ungetc(c, source);
             }
         } else {
-            if ((source = fopen(argv[0], "rb")) == NULL) {
-                fprintf(stderr, "\n%s: Can't open file %s\n", progname, argv[0]);
-                exit(1);
-            }
-        }
-
-
-        if (!outf) {
-            dest = stdout;
-        } else {
-            if ((dest = fopen(outfilename, "wb")) == NULL) {
-                fprintf(stderr, "\n%s: Can't open output file %s\n", progname, outfilename);
+            if ((source = fopen(infilename, "rb")) == NULL) {
+                fprintf(stderr, "\n%s: Can't open file %s\n", progname, infilename);
                 exit(1);
             }
+            setvbuf(source, NULL, _IOFBF, PETCAT_BUFSIZE);
         }
 
 
@@ -1326,7 +1376,7 @@ int main(int argc, char **argv)
             }
         } else {
             if (hdr) { /* name as comment when using petcat name.prg > name.txt */
-                fprintf(dest, "\n\n;%s ", (fil ? argv[0] : "<stdin>"));
+                fprintf(dest, "\n\n;%s ", (fil ? infilename : "<stdin>"));
             }
 
             /*
@@ -1370,10 +1420,24 @@ int main(int argc, char **argv)
         if (fil) {
             fclose(source);
         }
-        if (outf) {
-            fclose(dest);
+        if (!flg && fil) {
+            /* next file */
+            if (list != NULL) {
+                infilename = next_list_name(list, listname);
+            } else {
+                infilename = (--argc && ++argv) ? argv[0] : NULL;
+            }
         }
-    } while (flg || (fil && --argc && ++argv));           /* next file */
+    } while (flg || (fil && infilename != NULL));
+
+    if (list != NULL && list != stdin) {
+        fclose(list);
+    }
+    if (outf) {
+        fclose(dest);
+    } else {
+        fflush(dest);
+    }
     return(0);
 }
 
@@ -1445,7 +1509,9 @@ void usage(char *progname)
             "   -k\t\tlist all Basic versions available.\n"
             "   -l\t\tSpecify load address for program (in hex, no leading chars!).\n");
     fprintf(stdout,
-            "   -o <name>\tSpecify the output file name\n"
+            "   -o <name>\tSpecify the output file name, all input files are written to it\n"
+            "   -files <name>\tRead the names of the input files from a file, one per line\n"
+            "   \t\t(- for stdin)\n"
             "   -f\t\tForce overwritten the output file\n"
             "   \t\tThe default depends on the BASIC version.\n");
 
@@ -2623,6 +2689,12 @@ static int sstrcmp_codes(unsigned char *line, const char **wordlist, int token,
     kwlen = 1;
     /* search for keyword */
     for (; token < maxitems; token++) {
+        /* a code matches on its first character at least */
+        if (codesnocase
+            ? tolower((unsigned char)wordlist[token][0]) != tolower(*line)
+            : (unsigned char)wordlist[token][0] != *line) {
+            continue;
+        }
         DBG(("compare '%s' vs  '%s' - %u %u\n", wordlist[token], line, j, kwlen));
 
         if (codesnocase) {
@@ -2646,6 +2718,77 @@ static int sstrcmp_codes(unsigned char *line, const char **wordlist, int token,
     return (CODE_NONE);
 }
 
+/*
+     index of a keyword list by the first character of the keywords, so
+     only the keywords starting with the character at hand are compared
+*/
+#define KW_INDEX_MAX    32
+
+typedef struct kw_index_s {
+    const char **wordlist;
+    int token;
+    int maxitems;
+    int first[0x100];   /* first keyword starting with a character, -1 if none */
+    int *next;          /* next keyword starting with the same character */
+} kw_index_t;
+
+static kw_index_t kw_index[KW_INDEX_MAX];
+static int kw_index_num = 0;
+
+/* the tables are changed for some versions before any line is tokenized, so
+   the index made the first time a list is used stays valid */
+static const kw_index_t *kw_index_get(const char **wordlist, int token, int maxitems)
+{
+    kw_index_t *idx;
+    int i;
+
+    for (i = 0; i < kw_index_num; i++) {
+        idx = &kw_index[i];
+        if (idx->wordlist == wordlist && idx->token == token && idx->maxitems == maxitems) {
+            return idx;
+        }
+    }
+    if (kw_index_num == KW_INDEX_MAX || maxitems <= token) {
+        return NULL;
+    }
+
+    idx = &kw_index[kw_index_num++];
+    idx->wordlist = wordlist;
+    idx->token = token;
+    idx->maxitems = maxitems;
+    idx->next = malloc(sizeof(int) * (size_t)(maxitems - token));
+    for (i = 0; i < 0x100; i++) {
+        idx->first[i] = -1;
+    }
+    /* backwards, so every chain is in the order of the list */
+    for (i = maxitems - 1; i >= token; i--) {
+        unsigned char c = (unsigned char)wordlist[i][0];
+
+        idx->next[i - token] = idx->first[c];
+        idx->first[c] = i;
+    }
+    return idx;
+}
+
+/* length of `word' matched at `line', counting the shifted last letter of an
+   abbreviation, 0 if it does not match */
+static unsigned int kw_match(const char *word, const unsigned char *line)
+{
+    unsigned int j;
+    const char *p, *q;
+
+    for (p = word, q = (const char *)line, j = 0;
+         *p && *q && *p == *q; p++, q++, j++) {}
+
+    /* DBG(("compare %s %s - %d %d\n", word, line, j, kwlen));*/
+
+    /* found an exact or abbreviated keyword */
+    if (j && (!*p || (*p && (*p ^ *q) == 0x20 && j++))) {
+        return j;
+    }
+    return 0;
+}
+
 /*
      look up a keyword
 
@@ -2653,27 +2796,31 @@ static int sstrcmp_codes(unsigned char *line, const char **wordlist, int token,
 */
 static unsigned char sstrcmp(unsigned char *line, const char **wordlist, int token, int maxitems)
 {
+    const kw_index_t *idx;
     unsigned int j;
-    const char *p, *q;
     int retval = (KW_NONE);
 
     kwlen = 1;
-    /* search for keyword */
-    for (; token < maxitems; token++) {
-        for (p = wordlist[token], q = (char *)line, j = 0;
-             *p && *q && *p == *q; p++, q++, j++) {}
-
-        /* DBG(("compare %s %s - %d %d\n", wordlist[token], line, j, kwlen));*/
+    idx = kw_index_get(wordlist, token, maxitems);
 
-        /* found an exact or abbreviated keyword */
-        if (j && (!*p || (*p && (*p ^ *q) == 0x20 && j++))) {
-            if (j >= kwlen) {
+    /* search for keyword, the longest match wins, the later one if equal */
+    if (idx != NULL) {
+        for (token = idx->first[*line]; token >= 0; token = idx->next[token - idx->token]) {
+            j = kw_match(wordlist[token], line);
+            if (j && j >= kwlen) {
                 kwlen = j;
-                /* DBG(("found %s %2x\n", wordlist[token], token));*/
                 retval = token;
             }
         }
-    } /* for */
+    } else {
+        for (; token < maxitems; token++) {
+            j = kw_match(wordlist[token], line);
+            if (j && j >= kwlen) {
+                kwlen = j;
+                retval = token;
+            }
+        }
+    }
 
     return (unsigned char)retval;
 }
@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cmdline.h"
 #include "lib.h"
@@ -59,6 +60,12 @@ typedef struct traplist_s {
 
 static traplist_t *traplist = NULL;
 
+/* One bit for every address with a trap in the list, so looking up an
+   address without one does not have to go through the list.  */
+static uint8_t trap_addresses[0x10000 / 8];
+
+#define TRAP_ADDRESS_SET(a)     (trap_addresses[(a) >> 3] & (1 << ((a) & 7)))
+
 static int install_trap(const trap_t *t);
 static int remove_trap(const trap_t *t);
 
@@ -256,6 +263,8 @@ void traps_shutdown(void)
         lib_free(list);
         list = list_next;
     }
+    traplist = NULL;
+    memset(trap_addresses, 0, sizeof(trap_addresses));
 }
 
 static int install_trap(const trap_t *t)
@@ -285,6 +294,7 @@ int traps_add(const trap_t *trap)
     p->next = traplist;
     p->trap = trap;
     traplist = p;
+    trap_addresses[trap->address >> 3] |= (uint8_t)(1 << (trap->address & 7));
 
     if (traps_enabled) {
         log_verbose(traps_log, "Trap '%s' added.", trap->name);
@@ -334,6 +344,15 @@ int traps_remove(const trap_t *trap)
 
     lib_free(p);
 
+    /* another trap may be at the same address */
+    trap_addresses[trap->address >> 3] &= (uint8_t)~(1 << (trap->address & 7));
+    for (p = traplist; p != NULL; p = p->next) {
+        if (p->trap->address == trap->address) {
+            trap_addresses[trap->address >> 3] |= (uint8_t)(1 << (trap->address & 7));
+            break;
+        }
+    }
+
     if (traps_enabled) {
         remove_trap(trap);
     }
@@ -341,14 +360,18 @@ int traps_remove(const trap_t *trap)
     return 0;
 }
 
+/* Install the traps again after the memory configuration changed.  Traps
+   still in place are left alone, only those where the memory now has the
+   original code again are installed.  */
 void traps_refresh(void)
 {
     if (traps_enabled) {
         traplist_t *p;
 
         for (p = traplist; p != NULL; p = p->next) {
-            remove_trap(p->trap);
-            install_trap(p->trap);
+            if ((p->trap->readfunc)(p->trap->address) != TRAP_OPCODE) {
+                install_trap(p->trap);
+            }
         }
     }
     return;
@@ -362,6 +385,10 @@ uint32_t traps_handler(void)
 
     pc = maincpu_get_pc();
 
+    if (pc > 0xffff || !TRAP_ADDRESS_SET(pc)) {
+        return (uint32_t)-1;
+    }
+
     while (p) {
         if (p->trap->address == pc) {
             /* This allows the trap function to remove traps.  */
@@ -384,14 +411,8 @@ uint32_t traps_handler(void)
 
 int traps_checkaddr(unsigned int addr)
 {
-    traplist_t *p = traplist;
-
-    while (p) {
-        if (p->trap->address == addr) {
-            return 1;
-        }
-        p = p->next;
+    if (addr > 0xffff) {
+        return 0;
     }
-
-    return 0;
+    return TRAP_ADDRESS_SET(addr) ? 1 : 0;
 }
@@ -171,8 +171,8 @@ static void userport_dac_store_pbx(uint8_t value, int pulse)
 {
     userport_dac_sound_data = value;
 
-    /* call sound store function in order to update the sound output buffer */
-    sound_store(userport_dac_sound_chip_offset, value, 0);
+    /* log the write for the next sound fragment */
+    sound_dac_store(&userport_dac_dac, userport_dac_sound_chip_offset, value, (int)value * 128);
 }
 
 struct userport_dac_sound_s {
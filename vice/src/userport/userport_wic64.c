@@ -59,6 +59,7 @@
 #include <ctype.h>
 
 #include "alarm.h"
+#include "archdep.h"
 #include "cmdline.h"
 #include "maincpu.h"
 #include "resources.h"
@@ -159,7 +160,7 @@ static userport_device_t userport_wic64_device = {
 static struct alarm_s *http_get_alarm = NULL;
 static struct alarm_s *http_post_alarm = NULL;
 static struct alarm_s *http_post_endalarm = NULL;
-static struct alarm_s *tcp_get_alarm = NULL;
+static struct alarm_s *tcp_connect_alarm = NULL;
 static struct alarm_s *tcp_send_alarm = NULL;
 static struct alarm_s *cmd_timeout_alarm = NULL;
 static struct alarm_s *cmd_remote_timeout_alarm = NULL;
@@ -526,15 +527,16 @@ static char *encoded_helper = NULL;
 #include <unistd.h>
 #endif
 #include <curl/curl.h>
+#include <pthread.h>
 
-#define MAX_PARALLEL 1 /* number of simultaneous transfers */
 #define NUM_URLS 10
-static int still_alive = 0;
-static CURLM *cm = NULL;               /* used for http(s) */
-static CURL *curl = NULL;              /* used for telnet */
+static CURL *curl = NULL;              /* used for http post */
 static uint8_t curl_buf[240];          /* this slows down by smaller chunks sent to C64, improves BBSs  */
-static uint8_t *curl_send_buf = NULL;
-static uint16_t curl_send_len;
+static uint8_t *curl_send_buf = NULL;  /* tcp data not sent yet, from tcp_tx_pos on */
+static size_t curl_send_len;
+
+static void net_http_cancel(void);
+static void net_tcp_close(void);
 
 /* ------------------------------------------------------------------------- */
 static int userport_wic64_enable(int value)
@@ -576,6 +578,9 @@ static int userport_wic64_enable(int value)
         prep_wic64_str();
         userport_wic64_reset();
     } else {
+        /* the network thread must be done with the buffers */
+        net_http_cancel();
+        net_tcp_close();
         if (httpbuffer) {
             lib_free(httpbuffer);
             httpbuffer = NULL;
@@ -622,9 +627,9 @@ static int userport_wic64_enable(int value)
             alarm_destroy(http_post_endalarm);
             http_post_endalarm = NULL;
         }
-        if (tcp_get_alarm) {
-            alarm_destroy(tcp_get_alarm);
-            tcp_get_alarm = NULL;
+        if (tcp_connect_alarm) {
+            alarm_destroy(tcp_connect_alarm);
+            tcp_connect_alarm = NULL;
         }
         if (tcp_send_alarm) {
             alarm_destroy(tcp_send_alarm);
@@ -953,9 +958,81 @@ static size_t write_cb(char *data, size_t n, size_t l, void *userp)
     return n*l;
 }
 
-static void add_transfer(CURLM *cmulti, char *url)
+/* ---------------------------------------------------------------------*/
+/* network thread
+
+   The transfers are done by a thread of their own, so the emulation never
+   waits for the network.  The emulation posts requests and picks up their
+   results under net_lock; the thread sleeps in curl_multi_poll() on the
+   HTTP transfer and the TCP socket until there is something to do, or until
+   it is woken up for a new request.  Only the connect of a TCP connection
+   blocks the thread, never the emulation.  */
+
+#define NET_RX_SIZE     0x4000  /* tcp data received, not read by the C64 yet */
+
+/* curl_multi_wakeup() is there since libcurl 7.68.0, without it the thread
+   looks for new requests a bit more often.  curl_multi_poll() is there since
+   7.66.0, before that curl_multi_wait() is used, which does not sleep when
+   there is nothing to wait for */
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define NET_POLL_MS     1000
+#else
+#define NET_POLL_MS     10
+#endif
+
+typedef enum net_http_state_e {
+    NET_HTTP_IDLE,
+    NET_HTTP_REQUESTED,
+    NET_HTTP_RUNNING,
+    NET_HTTP_DONE
+} net_http_state_t;
+
+typedef enum net_tcp_state_e {
+    NET_TCP_CLOSED,
+    NET_TCP_CONNECT,
+    NET_TCP_CONNECTED,
+    NET_TCP_FAILED
+} net_tcp_state_t;
+
+static pthread_mutex_t net_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t net_http_ended = PTHREAD_COND_INITIALIZER;
+static CURLM *net_multi = NULL;         /* set once the thread is running */
+
+static net_http_state_t http_state = NET_HTTP_IDLE;
+static int http_cancel = 0;
+static char *http_url = NULL;           /* requested url */
+static CURL *http_handle = NULL;        /* only used by the thread */
+static CURLcode http_result = CURLE_OK;
+static long http_response = -1;
+static char *http_effective_url = NULL;
+
+static net_tcp_state_t tcp_state = NET_TCP_CLOSED;
+static int tcp_close = 0;               /* tcp_handle is to be closed */
+static char *tcp_url = NULL;            /* requested url, until connecting */
+static CURL *tcp_handle = NULL;         /* only used by the thread */
+static curl_socket_t tcp_socket;
+static CURLcode tcp_result = CURLE_OK;  /* first error of the connection */
+static int tcp_eof = 0;
+static uint8_t tcp_rx_buf[NET_RX_SIZE];
+static size_t tcp_rx_head = 0, tcp_rx_len = 0;
+static size_t tcp_tx_pos = 0;
+
+static void net_wakeup(void)
+{
+#if LIBCURL_VERSION_NUM >= 0x074400
+    if (net_multi) {
+        curl_multi_wakeup(net_multi);
+    }
+#endif
+}
+
+static CURL *net_http_handle(const char *url)
 {
     CURL *eh = curl_easy_init();
+
+    if (!eh) {
+        return NULL;
+    }
     if (wic64_loglevel > 1) {
         curl_easy_setopt(eh, CURLOPT_VERBOSE, 1L);
     } else {
@@ -963,7 +1040,6 @@ static void add_transfer(CURLM *cmulti, char *url)
     }
     curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, write_cb);
     curl_easy_setopt(eh, CURLOPT_URL, url);
-    curl_easy_setopt(eh, CURLOPT_PRIVATE, url);
     curl_easy_setopt(eh, CURLOPT_FOLLOWLOCATION, 1L);
     /* need to decied if we want to ship a certificate file
     curl_easy_setopt(eh, CURLOPT_CAINFO, PREFIX "/share/vice/etc/ca-bundle.crt");
@@ -977,14 +1053,293 @@ static void add_transfer(CURLM *cmulti, char *url)
 #endif
 
     /* set USERAGENT: otherwise the server won't return data, e.g. wicradio */
-    if (wic64_protocol == WIC64_PROT_LEGACY) {
-        http_user_agent = HTTP_AGENT_LEGACY;
+    curl_easy_setopt(eh, CURLOPT_USERAGENT, http_user_agent);
+    return eh;
+}
+
+/* Thread: drop the http transfer, with net_lock held.  */
+static void net_http_end(CURLM *multi)
+{
+    curl_multi_remove_handle(multi, http_handle);
+    curl_easy_cleanup(http_handle);
+    http_handle = NULL;
+    http_cancel = 0;
+    pthread_cond_broadcast(&net_http_ended);
+}
+
+/* Thread: start or cancel the http transfer, with net_lock held.  */
+static void net_http_update(CURLM *multi)
+{
+    if (http_state == NET_HTTP_REQUESTED) {
+        http_handle = net_http_handle(http_url);
+        lib_free(http_url);
+        http_url = NULL;
+        if (http_handle == NULL) {
+            http_result = CURLE_FAILED_INIT;
+            http_response = -1;
+            http_state = NET_HTTP_DONE;
+        } else {
+            curl_multi_add_handle(multi, http_handle);
+            http_state = NET_HTTP_RUNNING;
+        }
+    }
+    if (http_state == NET_HTTP_RUNNING && http_cancel) {
+        net_http_end(multi);
+        http_state = NET_HTTP_IDLE;
+    }
+}
+
+/* Thread: collect the result of the http transfer, with net_lock held.  */
+static void net_http_check(CURLM *multi)
+{
+    CURLMsg *msg;
+    int msgs_left;
+    char *url;
+
+    while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE || msg->easy_handle != http_handle) {
+            continue;
+        }
+        http_result = msg->data.result;
+        if (curl_easy_getinfo(http_handle, CURLINFO_RESPONSE_CODE, &http_response) != CURLE_OK) {
+            http_response = -1;
+        }
+        url = NULL;
+        if (curl_easy_getinfo(http_handle, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK && url) {
+            http_effective_url = lib_strdup(url);
+        }
+        net_http_end(multi);
+        http_state = NET_HTTP_DONE;
+    }
+}
+
+/* Thread: open a tcp connection, without net_lock held.  */
+static CURL *net_tcp_connect(const char *url, CURLcode *res)
+{
+    CURL *h = curl_easy_init();
+
+    if (!h) {
+        *res = CURLE_FAILED_INIT;
+        return NULL;
+    }
+
+    if (wic64_loglevel > 1) {
+        curl_easy_setopt(h, CURLOPT_VERBOSE, 1L);
     } else {
-        http_user_agent = HTTP_AGENT_REVISED;
+        curl_easy_setopt(h, CURLOPT_VERBOSE, 0L);
     }
-    curl_easy_setopt(eh, CURLOPT_USERAGENT, http_user_agent);
-    curl_multi_add_handle(cmulti, eh);
-    curl_multi_poll(cm, NULL, 0, 1, NULL);
+
+    curl_easy_setopt(h, CURLOPT_FOLLOWLOCATION, 1L);
+    /* need to decied if we want to ship a certificate file
+    curl_easy_setopt(h, CURLOPT_CAINFO, PREFIX "/share/vice/etc/ca-bundle.crt");
+    curl_easy_setopt(h, CURLOPT_CAPATH, PREFIX "/share/vice/etc/ca-bundle.crt");
+    */
+    curl_easy_setopt(h, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(h, CURLOPT_URL, url);
+    /* Do not do the transfer - only connect to host */
+    curl_easy_setopt(h, CURLOPT_CONNECT_ONLY, 1L);
+    *res = curl_easy_perform(h);
+    if (*res == CURLE_OK) {
+        *res = curl_easy_getinfo(h, CURLINFO_ACTIVESOCKET, &tcp_socket);
+    }
+    if (*res != CURLE_OK) {
+        curl_easy_cleanup(h);
+        return NULL;
+    }
+    return h;
+}
+
+/* Thread: connect, close, send and receive, with net_lock held.  */
+static void net_tcp_update(void)
+{
+    CURLcode res;
+    CURL *h;
+    char *url;
+    size_t pos, len, n;
+
+    while (tcp_close || (tcp_state == NET_TCP_CONNECT && tcp_url != NULL)) {
+        if (tcp_close) {
+            if (tcp_handle) {
+                curl_easy_cleanup(tcp_handle);
+                tcp_handle = NULL;
+            }
+            tcp_close = 0;
+            continue;
+        }
+
+        url = tcp_url;
+        tcp_url = NULL;
+        pthread_mutex_unlock(&net_lock);
+        h = net_tcp_connect(url, &res);
+        lib_free(url);
+        pthread_mutex_lock(&net_lock);
+
+        if (tcp_close) {
+            /* closed while connecting */
+            if (h) {
+                curl_easy_cleanup(h);
+            }
+            continue;
+        }
+        tcp_result = res;
+        tcp_handle = h;
+        tcp_state = h ? NET_TCP_CONNECTED : NET_TCP_FAILED;
+    }
+
+    if (tcp_state != NET_TCP_CONNECTED || tcp_result != CURLE_OK) {
+        return;
+    }
+
+    while (tcp_tx_pos < curl_send_len) {
+        res = curl_easy_send(tcp_handle, curl_send_buf + tcp_tx_pos,
+                             curl_send_len - tcp_tx_pos, &n);
+        if (res == CURLE_AGAIN) {
+            break;
+        }
+        if (res != CURLE_OK) {
+            tcp_result = res;
+            return;
+        }
+        tcp_tx_pos += n;
+    }
+
+    while (!tcp_eof && tcp_rx_len < NET_RX_SIZE) {
+        pos = (tcp_rx_head + tcp_rx_len) % NET_RX_SIZE;
+        len = NET_RX_SIZE - pos;
+        if (len > NET_RX_SIZE - tcp_rx_len) {
+            len = NET_RX_SIZE - tcp_rx_len;
+        }
+        res = curl_easy_recv(tcp_handle, tcp_rx_buf + pos, len, &n);
+        if (res == CURLE_AGAIN) {
+            break;
+        }
+        if (res != CURLE_OK) {
+            tcp_result = res;
+            return;
+        }
+        if (n == 0) {
+            tcp_eof = 1;
+            break;
+        }
+        tcp_rx_len += n;
+    }
+}
+
+static void *net_thread(void *arg)
+{
+    CURLM *multi = arg;
+    struct curl_waitfd wfd;
+    unsigned int nfds;
+    int running;
+
+    pthread_mutex_lock(&net_lock);
+    while (1) {
+        net_http_update(multi);
+        net_tcp_update();
+
+        /* wait for the socket only when there is room for what it brings
+           or something to send */
+        nfds = 0;
+        if (tcp_state == NET_TCP_CONNECTED && tcp_result == CURLE_OK) {
+            wfd.fd = tcp_socket;
+            wfd.events = 0;
+            wfd.revents = 0;
+            if (!tcp_eof && tcp_rx_len < NET_RX_SIZE) {
+                wfd.events |= CURL_WAIT_POLLIN;
+            }
+            if (tcp_tx_pos < curl_send_len) {
+                wfd.events |= CURL_WAIT_POLLOUT;
+            }
+            if (wfd.events) {
+                nfds = 1;
+            }
+        }
+        pthread_mutex_unlock(&net_lock);
+
+#if LIBCURL_VERSION_NUM >= 0x074200
+        curl_multi_poll(multi, &wfd, nfds, NET_POLL_MS, NULL);
+#else
+        {
+            int numfds = 0;
+
+            if (curl_multi_wait(multi, &wfd, nfds, NET_POLL_MS, &numfds) == CURLM_OK
+                && numfds == 0) {
+                tick_sleep(tick_per_second() / (1000 / NET_POLL_MS));
+            }
+        }
+#endif
+        curl_multi_perform(multi, &running);
+
+        pthread_mutex_lock(&net_lock);
+        net_http_check(multi);
+    }
+    return NULL;
+}
+
+/* Start the network thread when it is needed first.  */
+static int net_start(void)
+{
+    pthread_t thread;
+    CURLM *multi;
+
+    if (net_multi) {
+        return 0;
+    }
+
+    multi = curl_multi_init();
+    if (!multi) {
+        return -1;
+    }
+    if (pthread_create(&thread, NULL, net_thread, multi) != 0) {
+        wic64_log(LOG_COL_LRED, "%s: cannot start network thread", __FUNCTION__);
+        curl_multi_cleanup(multi);
+        return -1;
+    }
+    pthread_detach(thread);
+    net_multi = multi;
+    return 0;
+}
+
+/* Drop the http transfer and wait for the thread to let go of httpbuffer.  */
+static void net_http_cancel(void)
+{
+    pthread_mutex_lock(&net_lock);
+    if (http_state == NET_HTTP_REQUESTED) {
+        lib_free(http_url);
+        http_url = NULL;
+        http_state = NET_HTTP_IDLE;
+    }
+    if (http_state == NET_HTTP_RUNNING) {
+        http_cancel = 1;
+        net_wakeup();
+        while (http_state == NET_HTTP_RUNNING) {
+            pthread_cond_wait(&net_http_ended, &net_lock);
+        }
+    }
+    if (http_state == NET_HTTP_DONE) {
+        lib_free(http_effective_url);
+        http_effective_url = NULL;
+        http_state = NET_HTTP_IDLE;
+    }
+    pthread_mutex_unlock(&net_lock);
+}
+
+/* Close the tcp connection and drop what was not sent or read.  */
+static void net_tcp_close(void)
+{
+    pthread_mutex_lock(&net_lock);
+    if (tcp_state != NET_TCP_CLOSED) {
+        tcp_close = 1;
+        tcp_state = NET_TCP_CLOSED;
+    }
+    lib_free(tcp_url);
+    tcp_url = NULL;
+    tcp_result = CURLE_OK;
+    tcp_eof = 0;
+    tcp_rx_head = tcp_rx_len = 0;
+    tcp_tx_pos = curl_send_len = 0;
+    pthread_mutex_unlock(&net_lock);
+    net_wakeup();
 }
 
 static void update_prefs(uint8_t *buffer, size_t len)
@@ -1035,73 +1390,48 @@ static void update_prefs(uint8_t *buffer, size_t len)
 
 static void http_get_alarm_handler(CLOCK offset, void *data)
 {
-    CURLMsg *msg = NULL;
-    CURLMcode r;
-    int msgs_left = -1;
-    long response = -1;
-    char *url = "<unknown>";
-
-    still_alive = 0;
-    r = curl_multi_perform(cm, &still_alive);
-    if (r != CURLM_OK) {
-        wic64_log(CONS_COL_NO, "%s: curl_multi_perform failed: %s", __FUNCTION__, curl_multi_strerror(r));
-        msg = curl_multi_info_read(cm, &msgs_left);
-        if (msg) {
-            debug_log(LOG_COL_LRED, 2, "%s: msg: %u, %s", __FUNCTION__,
-                       msg->data.result, curl_easy_strerror(msg->data.result));
-            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &url);
-            debug_log(LOG_COL_LRED, 2, "%s, R: %u - %s <%s>", __FUNCTION__,
-                       msg->data.result, curl_easy_strerror(msg->data.result), url);
-        }
-        send_reply_revised(NETWORK_ERROR, "Failed to read HTTP response", NULL, 0, "!0"); /* maybe wrong here */
-        goto out;
-    }
-    debug_log(CONS_COL_NO, 3, "%s, running handles: %d, r = %d", __FUNCTION__, still_alive, r);
+    CURLcode res;
+    long response;
+    char *effective_url = NULL;
+    const char *url;
 
     if (wic64_remote_timeout_triggered) {
         debug_log(LOG_COL_LRED, 2, "Remote timout expired");
+        net_http_cancel();
         send_reply_revised(NETWORK_ERROR, "Remote timeout", NULL, 0, "!0");
         wic64_remote_timeout_triggered = 0;
         remote_to = wic64_remote_timeout;
-        msg = curl_multi_info_read(cm, &msgs_left); /* ensure all handles are freed when leaving below */
         goto out;
     }
 
-    if (still_alive) {
-        curl_multi_poll(cm, NULL, 0, 1, NULL);
+    /* the transfer is done by the network thread, only look for its end */
+    pthread_mutex_lock(&net_lock);
+    if (http_state != NET_HTTP_DONE) {
+        pthread_mutex_unlock(&net_lock);
         /* http request not yet finished */
         alarm_unset(http_get_alarm);
         alarm_set(http_get_alarm, maincpu_clk + (312 * 65));
         return;
     }
+    res = http_result;
+    response = http_response;
+    effective_url = http_effective_url;
+    http_effective_url = NULL;
+    http_state = NET_HTTP_IDLE;
+    pthread_mutex_unlock(&net_lock);
 
     alarm_unset(cmd_remote_timeout_alarm);
     remote_to = wic64_remote_timeout;
 
-    msg = curl_multi_info_read(cm, &msgs_left);
-    if (msgs_left > 0) {
-        wic64_log(LOG_COL_LRED, "%s, msgs_left: %d (>0! not handled), msg = %p", __FUNCTION__, msgs_left, msg);
+    url = effective_url ? effective_url : "<unknown>";
+    if (res != CURLE_OK) {
+        debug_log(LOG_COL_LRED, 2, "%s, R: %u - %s <%s>", __FUNCTION__,
+                   res, curl_easy_strerror(res), url);
     }
-    if (msg) {
-        CURLcode res;
-        res = curl_easy_getinfo(msg->easy_handle,
-                                CURLINFO_RESPONSE_CODE,
-                                &response);
-        if (res != CURLE_OK) {
-            wic64_log(LOG_COL_LRED, "%s: curl_easy_getinfo(...&response failed: %s", __FUNCTION__,
-                      curl_easy_strerror(res));
-            send_reply_revised(NETWORK_ERROR, "Failed to read HTTP response", NULL, 0, "!0");
-            goto out;
-        }
-        res = curl_easy_getinfo(msg->easy_handle, CURLINFO_EFFECTIVE_URL, &url);
-        if (res != CURLE_OK) {
-            /* ignore problem, URL is only for debugging */
-            debug_log(CONS_COL_NO, 2, "%s: curl_easy_getinfo(...&URL failed: %s", __FUNCTION__,
-                      curl_easy_strerror(res));
-            url = "<unknown>";
-        }
-    } else {
-        wic64_log(LOG_COL_LRED, "%s, msgs_left: %d, msg = %p!", __FUNCTION__, msgs_left, msg);
+    if (response < 0) {
+        wic64_log(LOG_COL_LRED, "%s: no response code for '%s'", __FUNCTION__, url);
+        send_reply_revised(NETWORK_ERROR, "Failed to read HTTP response", NULL, 0, "!0");
+        goto out;
     }
 
     if (response == 201) {
@@ -1125,9 +1455,9 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
         send_reply_revised(SUCCESS, "Success", httpbuffer, httpbufferptr, NULL); /* raw send, supporting big_load */
         cheatlen = 0;
     } else if (response >= 301) {
-        char t[32];
+        char t[40];
         wic64_log(LOG_COL_LRED, "URL '%s' returned %lu bytes (http code: %ld)", url, httpbufferptr, response);
-        snprintf(t, 31, "http response: %ld", response);
+        snprintf(t, sizeof(t), "http response: %ld", response);
         send_reply_revised(SERVER_ERROR, t, NULL, 0, "!0");      /* raw send supporting big_load */
     } else {
         /* firmeare handles codes: 301, 302, 307, 308 - check if needed with libcurl */
@@ -1144,13 +1474,7 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
     }
 
   out:
-    if (msg) {
-        /* cleanup easy handly, fixes FD leak */
-        curl_multi_remove_handle(cm, msg->easy_handle);
-        curl_easy_cleanup(msg->easy_handle);
-    }
-    curl_multi_cleanup(cm);
-    curl_global_cleanup();
+    lib_free(effective_url);
     alarm_unset(http_get_alarm);
     memset(httpbuffer, 0, httpbufferptr);
     big_load = 0;
@@ -1159,18 +1483,24 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
 static void do_http_get(char *url)
 {
     cmd_remote_timeout(1);
-    cm = curl_multi_init();
-    if (!cm) {
+    net_http_cancel();
+    if (net_start() < 0) {
         send_reply_revised(CONNECTION_ERROR, "Can't send HTTP request", NULL, 0, "!0");
         return;
     }
 
-    /* Limit the amount of simultaneous connections curl should allow: */
-    curl_multi_setopt(cm, CURLMOPT_MAXCONNECTS, (long)MAX_PARALLEL);
+    if (wic64_protocol == WIC64_PROT_LEGACY) {
+        http_user_agent = HTTP_AGENT_LEGACY;
+    } else {
+        http_user_agent = HTTP_AGENT_REVISED;
+    }
 
-    still_alive = 1;
     httpbufferptr = 0;
-    add_transfer(cm, url);
+    pthread_mutex_lock(&net_lock);
+    http_url = lib_strdup(url);
+    http_state = NET_HTTP_REQUESTED;
+    pthread_mutex_unlock(&net_lock);
+    net_wakeup();
 
     if (http_get_alarm == NULL) {
         http_get_alarm = alarm_new(maincpu_alarm_context, "HTTPGetAlarm",
@@ -1901,41 +2231,58 @@ static void cmd_get_timezone(void)
     send_reply_revised(SUCCESS, "Success", (uint8_t *)buf, strlen(buf) + 1, NULL);
 }
 
-/* open a curl connection */
-static void do_connect(uint8_t *buffer)
+static void tcp_connect_alarm_handler(CLOCK offset, void *data)
 {
+    net_tcp_state_t state;
     CURLcode res;
 
-    curl = curl_easy_init();
-    if (!curl) {
-        send_reply_revised(NETWORK_ERROR, "Could not open connection", NULL, 0, "!E");
-        return;
+    pthread_mutex_lock(&net_lock);
+    state = tcp_state;
+    res = tcp_result;
+    if (state == NET_TCP_FAILED) {
+        tcp_state = NET_TCP_CLOSED;
     }
+    pthread_mutex_unlock(&net_lock);
 
-    if (wic64_loglevel > 1) {
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-    } else {
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
+    if (state == NET_TCP_CONNECT) {
+        /* still connecting */
+        alarm_set(tcp_connect_alarm, maincpu_clk + (312 * 65));
+        return;
     }
+    alarm_unset(tcp_connect_alarm);
 
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    /* need to decied if we want to ship a certificate file
-    curl_easy_setopt(curl, CURLOPT_CAINFO, PREFIX "/share/vice/etc/ca-bundle.crt");
-    curl_easy_setopt(curl, CURLOPT_CAPATH, PREFIX "/share/vice/etc/ca-bundle.crt");
-    */
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_URL, buffer);
-    /* Do not do the transfer - only connect to host */
-    curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
-    res = curl_easy_perform(curl);
     wic64_log(CONS_COL_NO, "%s: curl_easy_perform: %s",__FUNCTION__, curl_easy_strerror(res));
-    if (res != CURLE_OK) {
+    if (state != NET_TCP_CONNECTED) {
         send_reply_revised(NETWORK_ERROR, "Could not open connection", NULL, 0, "!E");
     } else {
         send_reply_revised(SUCCESS, "Success", NULL, 0, "0");
     }
 }
 
+/* open a curl connection, the network thread does the connect */
+static void do_connect(uint8_t *buffer)
+{
+    net_tcp_close();
+    if (net_start() < 0) {
+        send_reply_revised(NETWORK_ERROR, "Could not open connection", NULL, 0, "!E");
+        return;
+    }
+
+    pthread_mutex_lock(&net_lock);
+    tcp_url = lib_strdup((char *)buffer);
+    tcp_state = NET_TCP_CONNECT;
+    pthread_mutex_unlock(&net_lock);
+    net_wakeup();
+
+    if (tcp_connect_alarm == NULL) {
+        tcp_connect_alarm = alarm_new(maincpu_alarm_context, "TCPConnectAlarm",
+                                      tcp_connect_alarm_handler, NULL);
+    }
+    alarm_unset(tcp_connect_alarm);
+    alarm_set(tcp_connect_alarm, maincpu_clk + (312 * 65 / 2));
+    /* no reply here, but from alarm handler */
+}
+
 static void cmd_tcp_open(void)
 {
     char tmp[COMMANDBUFFER_MAXLEN];
@@ -1953,115 +2300,139 @@ static void cmd_tcp_open(void)
     do_connect(commandbuffer);
 }
 
+static int tcp_is_connected(void)
+{
+    int connected;
+
+    pthread_mutex_lock(&net_lock);
+    connected = (tcp_state == NET_TCP_CONNECTED);
+    pthread_mutex_unlock(&net_lock);
+    return connected;
+}
+
 static void cmd_tcp_available(void)
 {
-    CURLcode res;
-    curl_socket_t sockfd;
     uint8_t t[2];
-    int bytes_available;
+    size_t bytes_available;
+    CURLcode res;
+
+    pthread_mutex_lock(&net_lock);
+    res = tcp_result;
+    bytes_available = tcp_rx_len;
+    pthread_mutex_unlock(&net_lock);
 
-    if (!curl) {
+    if (!tcp_is_connected()) {
         send_reply_revised(NETWORK_ERROR, "NO CONNECTION", NULL, 0, NULL);
         return;
     }
-    res = curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &sockfd);
-    if (res != CURLE_OK) {
-        send_reply_revised(NETWORK_ERROR, "NETWORK ERROR", NULL, 0, NULL);
-        return;
-    }
-
-    if (archdep_socketpeek(sockfd, &bytes_available) < 0) {
+    if (bytes_available == 0 && res != CURLE_OK) {
         send_reply_revised(NETWORK_ERROR, "NETWORK ERROR", NULL, 0, NULL);
         return;
     }
-    debug_log(CONS_COL_NO, 3, "%s: bytes_available = %d", __FUNCTION__, bytes_available);
+    debug_log(CONS_COL_NO, 3, "%s: bytes_available = %d", __FUNCTION__, (int)bytes_available);
     t[0] = bytes_available & 0xff;
     t[1] = (bytes_available >> 8) & 0xff;
     send_reply_revised(SUCCESS, "Success", t, 2, NULL);
 }
 
-static void tcp_get_alarm_handler(CLOCK offset, void *data)
+static void cmd_tcp_read(void)
 {
     CURLcode res;
-    size_t nread;
-    static size_t total_read;
+    size_t nread = 0, n;
+    int closed;
 
-    if (!curl) {
-        return;                 /* connection might be closed */
+    if (commandptr > 0) {
+        wic64_log_hexdump(LOG_COL_LBLUE, (const char *)commandbuffer, commandptr); /* commands may contain '0' */
     }
-    res = curl_easy_recv(curl,
-                         curl_buf + total_read,
-                         sizeof(curl_buf) - total_read,
-                         &nread);
-    alarm_set(tcp_get_alarm, maincpu_clk + (312 * 65 * 30));
-    total_read += nread;
-    if ((res == CURLE_OK) && (nread == 0)) {
-        /* connection closed */
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        alarm_unset(tcp_get_alarm);
-        curl = NULL;
-        wic64_log(CONS_COL_NO, "%s: connection closed", __FUNCTION__);
+
+    if (!tcp_is_connected()) {
+        wic64_log(LOG_COL_LRED, "%s: connection lost", __FUNCTION__);
+        send_reply_revised(NETWORK_ERROR, "TCP connection closed", NULL, 0, "!E");
+        return;
     }
 
-    if ((res == CURLE_OK) || (res == CURLE_AGAIN)) {
-        if (nread) {
-            wic64_log(CONS_COL_NO, "%s: nread = %lu, total_read = %lu", __FUNCTION__, nread, total_read);
+    /* take what the network thread has received so far */
+    pthread_mutex_lock(&net_lock);
+    while (nread < sizeof(curl_buf) && tcp_rx_len > 0) {
+        n = NET_RX_SIZE - tcp_rx_head;
+        if (n > tcp_rx_len) {
+            n = tcp_rx_len;
         }
-        big_load = 0;
-        send_reply_revised(SUCCESS, "Success", curl_buf, total_read, NULL);
-    } else {
+        if (n > sizeof(curl_buf) - nread) {
+            n = sizeof(curl_buf) - nread;
+        }
+        memcpy(curl_buf + nread, tcp_rx_buf + tcp_rx_head, n);
+        tcp_rx_head = (tcp_rx_head + n) % NET_RX_SIZE;
+        tcp_rx_len -= n;
+        nread += n;
+    }
+    res = tcp_result;
+    closed = tcp_eof && tcp_rx_len == 0;
+    pthread_mutex_unlock(&net_lock);
+
+    if (nread == 0 && res != CURLE_OK) {
         wic64_log(LOG_COL_LRED, "%s: curl_easy_recv: %s", __FUNCTION__, curl_easy_strerror(res));
         send_reply_revised(NETWORK_ERROR, "TCP connection closed", NULL, 0, "!E");
+        return;
     }
-    total_read = 0;
+    if (closed) {
+        net_tcp_close();
+        wic64_log(CONS_COL_NO, "%s: connection closed", __FUNCTION__);
+    } else if (nread) {
+        /* room for more */
+        net_wakeup();
+    }
+
+    if (nread) {
+        wic64_log(CONS_COL_NO, "%s: nread = %lu", __FUNCTION__, (unsigned long)nread);
+    }
+    big_load = 0;
+    send_reply_revised(SUCCESS, "Success", curl_buf, nread, NULL);
 }
 
-static void cmd_tcp_read(void)
+/* Hand the command to the network thread, as long as there is room.  */
+static int tcp_queue_write(CURLcode *res)
 {
-    if (commandptr > 0) {
-        wic64_log_hexdump(LOG_COL_LBLUE, (const char *)commandbuffer, commandptr); /* commands may contain '0' */
-    }
+    int queued = 0;
 
-    if (!curl) {
-        wic64_log(LOG_COL_LRED, "%s: connection lost", __FUNCTION__);
-        send_reply_revised(NETWORK_ERROR, "TCP connection closed", NULL, 0, "!E");
-        return;
+    pthread_mutex_lock(&net_lock);
+    *res = tcp_result;
+    if (tcp_tx_pos > 0) {
+        memmove(curl_send_buf, curl_send_buf + tcp_tx_pos, curl_send_len - tcp_tx_pos);
+        curl_send_len -= tcp_tx_pos;
+        tcp_tx_pos = 0;
+    }
+    if (*res == CURLE_OK && curl_send_len + commandptr <= COMMANDBUFFER_MAXLEN) {
+        memcpy(curl_send_buf + curl_send_len, commandbuffer, commandptr);
+        curl_send_len += commandptr;
+        queued = 1;
     }
+    pthread_mutex_unlock(&net_lock);
 
-    if (tcp_get_alarm == NULL) {
-        tcp_get_alarm = alarm_new(maincpu_alarm_context, "TCPGetAlarm",
-                                  tcp_get_alarm_handler, NULL);
+    if (queued) {
+        net_wakeup();
     }
-    alarm_unset(tcp_get_alarm);
-    alarm_set(tcp_get_alarm, maincpu_clk + (312 * 65 / 2));
-    /* no reply here, but from alarm handler */
+    return queued;
 }
 
 static void tcp_send_alarm_handler(CLOCK offset, void *data)
 {
     CURLcode res;
-    size_t nsent;
-    static size_t nsent_total;
 
-    if (!curl) {
+    if (!tcp_is_connected()) {
+        alarm_unset(tcp_send_alarm);
         return;                 /* connection might be closed */
     }
-    alarm_set(tcp_send_alarm, maincpu_clk + (312 * 65));
-
-    nsent = 0;
-    res = curl_easy_send(curl, curl_send_buf + nsent_total,
-                         curl_send_len - nsent_total, &nsent);
-    nsent_total += nsent;
 
-    if (nsent_total < curl_send_len) {
+    if (!tcp_queue_write(&res) && res == CURLE_OK) {
+        /* previous data not sent yet */
+        alarm_set(tcp_send_alarm, maincpu_clk + (312 * 65));
         return;
     }
-    nsent_total = 0; /* reset ptr for sending */
+    alarm_unset(tcp_send_alarm);
 
     if (res == CURLE_OK) {
-        alarm_unset(tcp_send_alarm);
-        wic64_log(CONS_COL_NO, "%s: tcp sent successfully", __FUNCTION__);
+        wic64_log(CONS_COL_NO, "%s: tcp data queued", __FUNCTION__);
         send_reply_revised(SUCCESS, "Success", NULL, 0, "0");
     } else {
         wic64_log(LOG_COL_LRED, "%s: curl_easy_send: %s", __FUNCTION__, curl_easy_strerror(res));
@@ -2073,37 +2444,29 @@ static void cmd_tcp_write(void)
 {
     wic64_log_hexdump(CONS_COL_NO, (const char *)commandbuffer, commandptr); /* commands may contain '0' */
 
-    if (!curl) {
+    if (!tcp_is_connected()) {
         wic64_log(LOG_COL_LRED, "%s: connection lost", __FUNCTION__);
         send_reply_revised(CONNECTION_ERROR, "Can't execute TCP command", NULL, 0, "!0");
         return;
     }
 
-    memcpy(curl_send_buf, commandbuffer, commandptr);
-    curl_send_len = commandptr;
-
+    /* the network thread sends the data, replies do not wait for it unless
+       too much is still waiting to be sent */
     if (tcp_send_alarm == NULL) {
         tcp_send_alarm = alarm_new(maincpu_alarm_context, "TCPSendAlarm",
                                    tcp_send_alarm_handler, NULL);
     }
-    alarm_unset(tcp_send_alarm);
-    alarm_set(tcp_send_alarm, maincpu_clk + (312 * 65));
-    /* no reply here, but from alarm handler */
+    tcp_send_alarm_handler(0, NULL);
 }
 
 static void cmd_tcp_close(void)
 {
-    if (curl) {
-        /* connection closed */
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        curl = NULL;
-    }
+    net_tcp_close();
     if (tcp_send_alarm) {
         alarm_unset(tcp_send_alarm);
     }
-    if (tcp_get_alarm) {
-        alarm_unset(tcp_get_alarm);
+    if (tcp_connect_alarm) {
+        alarm_unset(tcp_connect_alarm);
     }
     send_reply_revised(SUCCESS, "Success", NULL, 0, "0");
 }
@@ -2690,8 +3053,8 @@ static void userport_wic64_reset(void)
     if (http_post_endalarm) {
         alarm_unset(http_post_endalarm);
     }
-    if (tcp_get_alarm) {
-        alarm_unset(tcp_get_alarm);
+    if (tcp_connect_alarm) {
+        alarm_unset(tcp_connect_alarm);
     }
     if (tcp_send_alarm) {
         alarm_unset(tcp_send_alarm);
@@ -2704,6 +3067,8 @@ static void userport_wic64_reset(void)
     }
     /* flag2 and cycle alarms need to be preserverd !*/
     remote_to = wic64_remote_timeout; /* reset to given value */
+    net_http_cancel();
+    net_tcp_close();
     if (curl) {
         /* connection closed */
         curl_easy_cleanup(curl);
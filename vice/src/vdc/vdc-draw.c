@@ -651,6 +651,135 @@ static void draw_std_text_cached(raster_cache_t *cache, unsigned int xs,
     }
 }
 
+/* Per attribute byte transformation of the character data for the fast
+   text renderer: d = ((d & attr_and) | attr_or) ^ attr_xor.  The tables
+   only depend on the state in attr_lut_key and are rebuilt when it
+   changes, which is rarely more than once per frame.  */
+static uint8_t attr_and[256];
+static uint8_t attr_or[256];
+static uint8_t attr_xor[256];
+static int attr_lut_key = -1;
+
+static void update_attr_lut(void)
+{
+    unsigned int a;
+    int underline = (vdc.raster.ycounter == vdc.regs[29]);
+    int blink = vdc.attribute_blink ? 1 : 0;
+    int screen_reverse = (vdc.regs[24] & VDC_REVERSE_ATTR) ? 1 : 0;
+    int key = (int)(dmask << 3) | (underline << 2) | (blink << 1) | screen_reverse;
+
+    if (key == attr_lut_key) {
+        return;
+    }
+    attr_lut_key = key;
+
+    for (a = 0; a < 256; a++) {
+        uint8_t and_mask = (uint8_t)dmask;
+        uint8_t or_mask = 0x00;
+        uint8_t xor_mask = screen_reverse ? 0xFF : 0x00;
+
+        if (underline && (a & VDC_UNDERLINE_ATTR)) {
+            and_mask = 0x00;
+            or_mask = 0xFF;
+        }
+        if (blink && (a & VDC_FLASH_ATTR)) {
+            and_mask = 0x00;
+            or_mask = 0x00;
+        }
+        if (a & VDC_REVERSE_ATTR) {
+            xor_mask ^= 0xFF;
+        }
+        attr_and[a] = and_mask;
+        attr_or[a] = or_mask;
+        attr_xor[a] = xor_mask;
+    }
+}
+
+/* Fast version of draw_std_text() for the usual 80 column text screen: 8
+   pixel wide characters without double pixels, inter character gap or
+   semi-graphics, and a VDC ram mapping that needs no address translation.
+   The per character attribute handling is done with the tables above, and
+   the cursor is looked at only on the lines where it shows.  Returns 0
+   without drawing anything if the current line needs the generic
+   renderer, which is checked for every line so split screen effects still
+   work.  */
+static int draw_std_text_fast(uint8_t *p, const uint8_t *attr_ptr,
+                              const uint8_t *screen_ptr,
+                              unsigned int char_index, unsigned int cpos)
+{
+    unsigned int i, d, ram_mask, alt_offset;
+    unsigned int cursor_xor = 0x00;
+    const uint8_t *ram = vdc.ram;
+    uint32_t *table_ptr;
+
+    if ((vdc.regs[25] & 0x10) || vdc.charwidth != 8 || semi_gfx_test
+        || vdc.raster.ycounter > (signed)vdc.regs[23]) {
+        return 0;
+    }
+
+    /* see vdc_ram_read() */
+    if (vdc.regs[28] & 0x10) {
+        if (!vdc_resources.vdc_64kb_expansion) {
+            return 0;
+        }
+        ram_mask = 0xFFFF;
+    } else {
+        if (vdc_resources.vdc_64kb_expansion) {
+            return 0;
+        }
+        ram_mask = 0x3FFF;
+    }
+
+    if (cpos < vdc.screen_text_cols
+        && ((vdc.frame_counter | 1) & crsrblink[(vdc.regs[10] >> 5) & 3])) {
+        if (((vdc.raster.ycounter >= (vdc.regs[10] & 0x1F)) && (vdc.raster.ycounter < (vdc.regs[11] & 0x1F)))
+            || ((vdc.raster.ycounter == (vdc.regs[10] & 0x1F)) && (vdc.raster.ycounter == (vdc.regs[11] & 0x1F)))
+            || (((vdc.regs[10] & 0x1F) > (vdc.regs[11] & 0x1F)) && ((vdc.raster.ycounter >= (vdc.regs[10] & 0x1F)) || (vdc.raster.ycounter < (vdc.regs[11] & 0x1F))))) {
+            cursor_xor = 0xFF;
+        }
+    }
+
+    if (vdc.regs[25] & 0x40) {  /* Attribute mode */
+        update_attr_lut();
+        table_ptr = hr_table + ((vdc.regs[26] & 0x0F) << 4);
+        alt_offset = 0x100 * vdc.bytes_per_char;
+        for (i = 0; i < vdc.screen_text_cols; i++, p += 8) {
+            unsigned int a = attr_ptr[i];
+            uint32_t *ptr = table_ptr + ((a & 0x0F) << 8);
+
+            d = ram[(uint16_t)(char_index
+                               + ((a & VDC_ALTCHARSET_ATTR) ? alt_offset : 0)
+                               + screen_ptr[i] * vdc.bytes_per_char) & ram_mask];
+            d = ((d & attr_and[a]) | attr_or[a]) ^ attr_xor[a];
+            if (i == cpos) {
+                d ^= cursor_xor;
+            }
+            *((uint32_t *)p) = *(ptr + (d >> 4));
+            *((uint32_t *)p + 1) = *(ptr + (d & 0x0F));
+        }
+    } else {    /* Monochrome mode */
+        uint32_t *ptr = hr_table + (vdc.regs[26] << 4);
+        unsigned int xor_mask = (vdc.regs[24] & VDC_REVERSE_ATTR) ? 0xFF : 0x00;
+
+        for (i = 0; i < vdc.screen_text_cols; i++, p += 8) {
+            d = ram[(uint16_t)(char_index + screen_ptr[i] * vdc.bytes_per_char) & ram_mask];
+            d = (d & dmask) ^ xor_mask;
+            if (i == cpos) {
+                d ^= cursor_xor;
+            }
+            *((uint32_t *)p) = *(ptr + (d >> 4));
+            *((uint32_t *)p + 1) = *(ptr + (d & 0x0F));
+        }
+    }
+
+    /* fill the last few pixels of the display with bg colour if smooth scroll != 0 */
+    for (i = vdc.xsmooth; i < (unsigned)(vdc.regs[22] >> 4); i++, p++) {
+        *p = (vdc.regs[26] & 0x0F);
+    }
+
+    return 1;
+}
+
 static void draw_std_text(void)
 /* raster_modes_draw_line() in raster - draw text mode when cache is not used
    This draws one raster line of text directly into the raster buffer
@@ -691,6 +820,10 @@ static void draw_std_text(void)
 
     calculate_draw_masks();
 
+    if (draw_std_text_fast(p, attr_ptr, screen_ptr, char_index, cpos)) {
+        return;
+    }
+
     /* Now actually render everything */
     if (vdc.regs[25] & 0x40) {  /* Attribute mode - background colour from regs[26] but foreground from attribute ram */
         table_ptr = hr_table + ((vdc.regs[26] & 0x0F) << 4);    /* regs[26] & 0xF is the background colour */
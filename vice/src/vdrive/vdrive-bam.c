@@ -440,6 +440,29 @@ This function find the next suitable sector based on the one passed.
 function reworked to use smaller functions above and to behave like DOS
 code. Interleave is options as it is used by extended directory creation.
 return 0 when sector found, otherwise -1. */
+/* Check the BAM bitmap of a DNP track for free sectors, the bitmap has one
+   bit per sector which is set when the sector is free.  */
+static int vdrive_bam_np_track_full(vdrive_t *vdrive, unsigned int track,
+                                    unsigned int max_sector)
+{
+    unsigned int offset = 0x100 + BAM_BIT_MAP_NP + 32 * (track - 1);
+    unsigned int i;
+
+    if (offset + ((max_sector + 7) >> 3) > vdrive->bam_size) {
+        return 0;
+    }
+    /* make sure bam data is loaded */
+    if (vdrive_bam_read_bam_block(vdrive, offset >> 8)) {
+        return 0;
+    }
+    for (i = 0; i < (max_sector + 7) >> 3; i++) {
+        if (vdrive->bam[offset + i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int vdrive_bam_alloc_next_free_sector_interleave(vdrive_t *vdrive,
                                                  unsigned int *track,
                                                  unsigned int *sector,
@@ -490,6 +513,17 @@ int vdrive_bam_alloc_next_free_sector_interleave(vdrive_t *vdrive,
             if (*track == DIR_TRACK_NP && *sector < 64) {
                 *sector = 64;
             }
+            /* on entering a track, skip all of it if it has no free sectors */
+            if (*sector == (*track == DIR_TRACK_NP ? 64 : 0)
+                && vdrive_bam_np_track_full(vdrive, *track, max_sector)) {
+                unsigned int skip = max_sector - 1 - *sector;
+                if (skip > s) {
+                    skip = s;
+                }
+                s -= skip;
+                *sector += skip;
+                continue;
+            }
             /* try the sector */
             if (vdrive_bam_allocate_sector(vdrive, *track, *sector)) {
                 /* it is good, leave */
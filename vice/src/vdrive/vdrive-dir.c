@@ -207,6 +207,355 @@ void vdrive_dir_remove_slot(vdrive_dir_context_t *dir)
     vdrive_write_sector(vdrive, dir->buffer, dir->track, dir->sector);
 }
 
+/* Start the search of `dir' at the directory header.  */
+static void dir_read_header(vdrive_dir_context_t *dir)
+{
+    vdrive_t *vdrive = dir->vdrive;
+
+    dir->track = vdrive->Header_Track;
+    dir->sector = vdrive->Header_Sector;
+    dir->slot = 7;
+
+    vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
+
+    /* old drives may have needed this, but NP's keep their info correct */
+    if (vdrive->image_format != VDRIVE_IMAGE_FORMAT_NP) {
+        dir->buffer[0] = vdrive->Dir_Track;
+        dir->buffer[1] = vdrive->Dir_Sector;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Directory index.
+
+   Looking up a file by its exact name, or looking for an empty slot, reads
+   the whole directory chain, which gets slow on large D81 and DNP
+   directories.  The index keeps the location and name of every slot of the
+   directory last searched, hashed by name, so such a search can start
+   right at the first slot that matches, reading a single sector.  The
+   normal search then carries on from there, so the result is the same.
+
+   vdrive_write_sector() keeps the index up to date: a written directory
+   sector is indexed again, unless its link changed, then the index is
+   dropped and built again on the next search.  Attaching, detaching and
+   refreshing the drive drop it too.  */
+
+/* Longer chains are most likely looping, leave them to the normal search. */
+#define DIR_INDEX_MAX_SECTORS   4096
+
+struct vdrive_dir_index_s {
+    /* the directory this is the index of */
+    disk_image_t *image;
+    unsigned int current_offset;
+    unsigned int header_track;
+    unsigned int header_sector;
+    unsigned int dir_track;
+    unsigned int dir_sector;
+
+    /* directory sectors following the header, in chain order */
+    unsigned int num_sectors;
+    unsigned int size;
+    uint8_t *track;
+    uint8_t *sector;
+
+    /* per slot (sector number * 8 + slot): file type (0 = empty), name up
+       to the first $a0 and its length, next slot in the same hash bucket */
+    uint8_t *type;
+    uint8_t *name;
+    uint8_t *name_length;
+    int *next;
+
+    int *buckets;
+    unsigned int bucket_mask;
+};
+
+static unsigned int dir_index_name_length(const uint8_t *name)
+{
+    unsigned int length;
+
+    for (length = 0; length < CBMDOS_SLOT_NAME_LENGTH && name[length] != 0xa0; length++) {
+        /* NOP */
+    }
+    return length;
+}
+
+static unsigned int dir_index_hash(const uint8_t *name, unsigned int length)
+{
+    unsigned int hash = 2166136261u;
+    unsigned int i;
+
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void dir_index_remove_slot(vdrive_dir_index_t *index, int slot)
+{
+    int *p;
+
+    if (index->type[slot] == 0) {
+        return;
+    }
+    p = &index->buckets[dir_index_hash(&index->name[slot * CBMDOS_SLOT_NAME_LENGTH],
+                                       index->name_length[slot]) & index->bucket_mask];
+    while (*p != slot) {
+        p = &index->next[*p];
+    }
+    *p = index->next[slot];
+    index->type[slot] = 0;
+}
+
+static void dir_index_add_slot(vdrive_dir_index_t *index, int slot, const uint8_t *buf)
+{
+    uint8_t *name = &index->name[slot * CBMDOS_SLOT_NAME_LENGTH];
+    unsigned int bucket;
+
+    index->type[slot] = buf[SLOT_TYPE_OFFSET];
+    if (index->type[slot] == 0) {
+        return;
+    }
+    memcpy(name, &buf[SLOT_NAME_OFFSET], CBMDOS_SLOT_NAME_LENGTH);
+    index->name_length[slot] = (uint8_t)dir_index_name_length(name);
+    bucket = dir_index_hash(name, index->name_length[slot]) & index->bucket_mask;
+    index->next[slot] = index->buckets[bucket];
+    index->buckets[bucket] = slot;
+}
+
+/* (Re)index the slots of directory sector number n.  */
+static void dir_index_add_sector(vdrive_dir_index_t *index, unsigned int n, const uint8_t *buf)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        dir_index_remove_slot(index, (int)(n * 8 + i));
+        dir_index_add_slot(index, (int)(n * 8 + i), &buf[i * SLOT_SIZE]);
+    }
+}
+
+void vdrive_dir_index_free(vdrive_t *vdrive)
+{
+    vdrive_dir_index_t *index = vdrive->dir_index;
+
+    if (index == NULL) {
+        return;
+    }
+    lib_free(index->track);
+    lib_free(index->sector);
+    lib_free(index->type);
+    lib_free(index->name);
+    lib_free(index->name_length);
+    lib_free(index->next);
+    lib_free(index->buckets);
+    lib_free(index);
+    vdrive->dir_index = NULL;
+}
+
+static int dir_index_is_current(const vdrive_t *vdrive, const vdrive_dir_index_t *index)
+{
+    return index->image == vdrive->image
+           && index->current_offset == vdrive->current_offset
+           && index->header_track == vdrive->Header_Track
+           && index->header_sector == vdrive->Header_Sector
+           && index->dir_track == vdrive->Dir_Track
+           && index->dir_sector == vdrive->Dir_Sector;
+}
+
+/* Read the directory chain the way vdrive_dir_find_next_slot() does.  */
+static vdrive_dir_index_t *dir_index_build(vdrive_t *vdrive)
+{
+    vdrive_dir_index_t *index;
+    uint8_t buf[256];
+    unsigned int t, s, i;
+    unsigned int buckets;
+
+    if (vdrive_read_sector(vdrive, buf, vdrive->Header_Track, vdrive->Header_Sector) != 0) {
+        return NULL;
+    }
+    if (vdrive->image_format != VDRIVE_IMAGE_FORMAT_NP) {
+        buf[0] = vdrive->Dir_Track;
+        buf[1] = vdrive->Dir_Sector;
+    }
+
+    index = lib_calloc(1, sizeof(vdrive_dir_index_t));
+    index->image = vdrive->image;
+    index->current_offset = vdrive->current_offset;
+    index->header_track = vdrive->Header_Track;
+    index->header_sector = vdrive->Header_Sector;
+    index->dir_track = vdrive->Dir_Track;
+    index->dir_sector = vdrive->Dir_Sector;
+
+    index->size = 64;
+    index->track = lib_malloc(index->size);
+    index->sector = lib_malloc(index->size);
+    index->type = lib_malloc(index->size * 8);
+    index->name = lib_malloc(index->size * 8 * CBMDOS_SLOT_NAME_LENGTH);
+
+    while (buf[0] != 0) {
+        t = buf[0];
+        s = buf[1];
+        if (index->num_sectors == DIR_INDEX_MAX_SECTORS
+            || vdrive_read_sector(vdrive, buf, t, s) != 0) {
+            vdrive->dir_index = index;
+            vdrive_dir_index_free(vdrive);
+            return NULL;
+        }
+        if (index->num_sectors == index->size) {
+            index->size *= 2;
+            index->track = lib_realloc(index->track, index->size);
+            index->sector = lib_realloc(index->sector, index->size);
+            index->type = lib_realloc(index->type, index->size * 8);
+            index->name = lib_realloc(index->name, index->size * 8 * CBMDOS_SLOT_NAME_LENGTH);
+        }
+        index->track[index->num_sectors] = (uint8_t)t;
+        index->sector[index->num_sectors] = (uint8_t)s;
+        for (i = 0; i < 8; i++) {
+            index->type[index->num_sectors * 8 + i] = buf[i * SLOT_SIZE + SLOT_TYPE_OFFSET];
+            memcpy(&index->name[(index->num_sectors * 8 + i) * CBMDOS_SLOT_NAME_LENGTH],
+                   &buf[i * SLOT_SIZE + SLOT_NAME_OFFSET], CBMDOS_SLOT_NAME_LENGTH);
+        }
+        index->num_sectors++;
+    }
+
+    /* hash the names */
+    for (buckets = 64; buckets < index->num_sectors * 8; buckets <<= 1) {
+        /* NOP */
+    }
+    index->bucket_mask = buckets - 1;
+    index->buckets = lib_malloc(buckets * sizeof(int));
+    for (i = 0; i < buckets; i++) {
+        index->buckets[i] = -1;
+    }
+    index->name_length = lib_malloc(index->size * 8);
+    index->next = lib_malloc(index->size * 8 * sizeof(int));
+    for (i = 0; i < index->num_sectors * 8; i++) {
+        uint8_t slot[SLOT_SIZE];
+
+        slot[SLOT_TYPE_OFFSET] = index->type[i];
+        memcpy(&slot[SLOT_NAME_OFFSET], &index->name[i * CBMDOS_SLOT_NAME_LENGTH],
+               CBMDOS_SLOT_NAME_LENGTH);
+        dir_index_add_slot(index, (int)i, slot);
+    }
+
+    return index;
+}
+
+/** \brief  Update the directory index after a sector was written
+ *
+ * \param[in]   vdrive  vdrive
+ * \param[in]   buf     sector data
+ * \param[in]   track   logical track
+ * \param[in]   sector  logical sector
+ */
+void vdrive_dir_index_sector_written(vdrive_t *vdrive, const uint8_t *buf,
+                                     unsigned int track, unsigned int sector)
+{
+    vdrive_dir_index_t *index = vdrive->dir_index;
+    unsigned int n;
+
+    if (index == NULL) {
+        return;
+    }
+    if (!dir_index_is_current(vdrive, index)) {
+        vdrive_dir_index_free(vdrive);
+        return;
+    }
+
+    /* only the link of the header of a DNP directory is used */
+    if (track == index->header_track && sector == index->header_sector
+        && vdrive->image_format == VDRIVE_IMAGE_FORMAT_NP
+        && (index->num_sectors == 0
+            || buf[0] != index->track[0] || buf[1] != index->sector[0])) {
+        vdrive_dir_index_free(vdrive);
+        return;
+    }
+
+    for (n = 0; n < index->num_sectors; n++) {
+        if (index->track[n] == track && index->sector[n] == sector) {
+            if (n + 1 < index->num_sectors
+                ? (buf[0] != index->track[n + 1] || buf[1] != index->sector[n + 1])
+                : buf[0] != 0) {
+                /* the chain changed */
+                vdrive_dir_index_free(vdrive);
+                return;
+            }
+            dir_index_add_sector(index, n, buf);
+        }
+    }
+}
+
+/* Move the search of `dir' forward to the first slot that can match, using
+   the index.  */
+static void dir_index_find(vdrive_dir_context_t *dir)
+{
+    vdrive_t *vdrive = dir->vdrive;
+    vdrive_dir_index_t *index = vdrive->dir_index;
+    unsigned int length = 0;
+    unsigned int i, n;
+    int found = -1;
+    int slot;
+
+    if (dir->find_length > 0) {
+        length = dir_index_name_length(dir->find_nslot);
+        for (i = 0; i < length; i++) {
+            if (dir->find_nslot[i] == '*' || dir->find_nslot[i] == '?') {
+                return;
+            }
+        }
+    } else if (dir->find_length == 0) {
+        return;
+    }
+
+    if (index != NULL && !dir_index_is_current(vdrive, index)) {
+        vdrive_dir_index_free(vdrive);
+        index = NULL;
+    }
+    if (index == NULL) {
+        index = dir_index_build(vdrive);
+        if (index == NULL) {
+            return;
+        }
+        vdrive->dir_index = index;
+    }
+    if (index->num_sectors == 0) {
+        return;
+    }
+
+    if (dir->find_length > 0) {
+        for (slot = index->buckets[dir_index_hash(dir->find_nslot, length) & index->bucket_mask];
+             slot >= 0; slot = index->next[slot]) {
+            if (index->name_length[slot] == length
+                && memcmp(&index->name[slot * CBMDOS_SLOT_NAME_LENGTH], dir->find_nslot, length) == 0
+                && (found < 0 || slot < found)) {
+                found = slot;
+            }
+        }
+    } else {
+        for (i = 0; i < index->num_sectors * 8; i++) {
+            if (index->type[i] == 0) {
+                found = (int)i;
+                break;
+            }
+        }
+    }
+
+    if (found < 0) {
+        /* no match, continue at the end of the last sector */
+        n = index->num_sectors - 1;
+        dir->slot = 7;
+    } else {
+        n = (unsigned int)found / 8;
+        dir->slot = (unsigned int)found % 8 - 1;  /* may wrap, incremented first */
+    }
+    dir->track = index->track[n];
+    dir->sector = index->sector[n];
+    if (vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector) != 0) {
+        /* start over the normal way */
+        vdrive_dir_index_free(vdrive);
+        dir_read_header(dir);
+    }
+}
+
 /*
    read first dir buffer into Dir_buffer
 */
@@ -226,25 +575,17 @@ void vdrive_dir_find_first_slot(vdrive_t *vdrive, const uint8_t *name,
     dir->find_length = length;
     dir->find_type = type;
 
-    dir->track = vdrive->Header_Track;
-    dir->sector = vdrive->Header_Sector;
-    dir->slot = 7;
-
     /* date comparisons; show everything */
     dir->time_low = 0;
     dir->time_high = 0xffffffff;
 
-    vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
-
-    /* old drives may have needed this, but NP's keep their info correct */
-    if (vdrive->image_format != VDRIVE_IMAGE_FORMAT_NP) {
-        dir->buffer[0] = vdrive->Dir_Track;
-        dir->buffer[1] = vdrive->Dir_Sector;
-    }
+    dir_read_header(dir);
 #ifdef DEBUG_DRIVE
     log_debug(LOG_DEFAULT, "DIR: vdrive_dir_find_first_slot (curr t:%u/s:%u dir t:%u/s:%u)",
               dir->track, dir->sector, vdrive->Dir_Track, vdrive->Dir_Sector);
 #endif
+
+    dir_index_find(dir);
 }
 
 /* convert date/time into a single 32-bit unsigned value */
@@ -61,6 +61,8 @@ struct vdrive_s;
 struct cbmdos_cmd_parse_plus_s;
 struct bufferinfo_s;
 
+typedef struct vdrive_dir_index_s vdrive_dir_index_t;
+
 typedef struct vdrive_dir_context_s {
     uint8_t buffer[256];      /* Current directory sector. */
     int find_length;       /* -1 allowed.  */
@@ -85,6 +87,8 @@ void vdrive_dir_remove_slot(vdrive_dir_context_t *dir);
 void vdrive_dir_create_slot(struct bufferinfo_s *p, uint8_t *realname, int reallength, int filetype);
 void vdrive_dir_free_chain(struct vdrive_s *vdrive, int t, int s);
 void vdrive_dir_updatetime(struct vdrive_s *vdrive, uint8_t *slot);
+void vdrive_dir_index_free(struct vdrive_s *vdrive);
+void vdrive_dir_index_sector_written(struct vdrive_s *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector);
 uint8_t *vdrive_dir_part_find_next_slot(vdrive_dir_context_t *dir);
 int vdrive_dir_part_next_directory(struct vdrive_s *vdrive, struct bufferinfo_s *b);
 int vdrive_dir_part_first_directory(struct vdrive_s *vdrive, const uint8_t *name, int length, struct bufferinfo_s *p);
@@ -178,6 +178,7 @@ void vdrive_device_shutdown(vdrive_t *vdrive)
             lib_free(p->buffer);
             p->buffer = NULL;
         }
+        vdrive_dir_index_free(vdrive);
     }
 }
 
@@ -198,6 +199,7 @@ log_debug(LOG_DEFAULT, "VDRIVE: refresh unit %u", unit);
     }
 
     vdrive_bam_setup_bam(vdrive);
+    vdrive_dir_index_free(vdrive);
 
     vdrive->current_offset = 0;
     vdrive->sys_offset = UINT32_MAX;
@@ -349,6 +351,7 @@ void vdrive_detach_image(disk_image_t *image, unsigned int unit,
     }
 
     disk_image_detach_log(image, vdrive_log, unit, drive);
+    vdrive_dir_index_free(vdrive);
 
     /* shutdown everything on that drive */
     if (vdrive->haspt) {
@@ -422,6 +425,7 @@ int vdrive_attach_image(disk_image_t *image, unsigned int unit,
     }
 
     disk_image_attach_log(image, vdrive_log, unit, drive);
+    vdrive_dir_index_free(vdrive);
 
     /* fix the number of tracks here as extended tracks aren't supported */
     switch (image->type) {
@@ -990,6 +994,11 @@ int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track
     ui_display_drive_track(vdrive->unit - 8, 0, dadr.track * 2);
 #endif
     ret = disk_image_write_sector(vdrive->image, buf, &dadr);
+    if (ret == 0) {
+        vdrive_dir_index_sector_written(vdrive, buf, track, sector);
+    } else {
+        vdrive_dir_index_free(vdrive);
+    }
 
 #ifdef DEBUG_DRIVE
     log_debug(LOG_DEFAULT, "VDRIVE: write_sector %u %u = %d", dadr.track, dadr.sector, ret);
@@ -1011,6 +1020,7 @@ int vdrive_write_sector_physical(vdrive_t *vdrive, const uint8_t *buf, unsigned
     disk_addr_t dadr;
     dadr.track = track;
     dadr.sector = sector;
+    vdrive_dir_index_free(vdrive);
     return disk_image_write_sector(vdrive->image, buf, &dadr);
 }
 
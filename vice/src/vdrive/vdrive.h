@@ -187,6 +187,9 @@ typedef struct vdrive_s {
     uint8_t *bam;              /* Disk header blk (if any) followed by BAM blocks */
     bufferinfo_t buffers[16];
 
+    /* index of the directory last searched, see vdrive-dir.c */
+    struct vdrive_dir_index_s *dir_index;
+
     /* Memory read command buffer.  */
     uint8_t mem_buf[256];
     unsigned int mem_length;
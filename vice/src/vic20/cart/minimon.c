@@ -696,23 +696,23 @@ static int minimon_rom_reload(char *filename)
             return -1;
         }
         if (crt_read_chip_header(&chip, fd)) {
-            fclose(fd);
+            crt_close(fd);
             goto trybinary;
         }
 
         if (chip.size != CART_ROM_SIZE) {
-            fclose(fd);
+            crt_close(fd);
             goto trybinary;
         }
 
         if (crt_read_chip(&minimon_rom[0], 0, &chip, fd)) {
-            fclose(fd);
+            crt_close(fd);
             goto trybinary;
         }
 
         minimon_bios_type = CARTRIDGE_FILETYPE_CRT;
         DBG(("minimon_rom_attach (loaded: crt)"));
-        fclose(fd);
+        crt_close(fd);
         return 0;
     }
 trybinary:
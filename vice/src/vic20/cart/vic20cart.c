@@ -622,7 +622,7 @@ static int crt_attach(const char *filename, uint8_t *rawcart)
             break;
     }
 
-    fclose(fd);
+    crt_close(fd);
 
     if (ret == -1) {
         DBG(("crt_attach error (%d)", ret));
@@ -222,34 +222,60 @@ static inline void vic_cycle_latch_rows(void)
 /* ------------------------------------------------------------------------- */
 /* Fetch hendling */
 
+/* What the VIC sees in every 1 kB page of the (fixed up) address space,
+   without and with mike's VFLI hack.  NULL for color RAM and unconnected
+   pages.  */
+#define VIC_FETCH_PAGES         (0xa000 >> 10)
+#define VIC_FETCH_PAGE_COLOR    (0x9400 >> 10)
+
+static uint8_t *fetch_pages[2][VIC_FETCH_PAGES];
+
+void vic_cycle_init(void)
+{
+    int i;
+
+    for (i = 0; i < VIC_FETCH_PAGES; i++) {
+        fetch_pages[0][i] = NULL;
+        fetch_pages[1][i] = NULL;
+    }
+
+    /* RAM at $0000-$03FF and $1000-$1FFF, with the VFLI hack also the RAM
+       at $0400-$0FFF */
+    for (i = 0; i < (0x2000 >> 10); i++) {
+        if (i < (0x0400 >> 10) || i >= (0x1000 >> 10)) {
+            fetch_pages[0][i] = mem_ram + (i << 10);
+        }
+        fetch_pages[1][i] = mem_ram + (i << 10);
+    }
+
+    /* chargen at $8000-$8FFF */
+    for (i = 0; i < (0x1000 >> 10); i++) {
+        fetch_pages[0][(0x8000 >> 10) + i] = vic20memrom_chargen_rom + (i << 10);
+        fetch_pages[1][(0x8000 >> 10) + i] = vic20memrom_chargen_rom + (i << 10);
+    }
+}
+
 /* Perform actual fetch */
 static inline uint8_t vic_cycle_do_fetch(int addr, uint8_t *color)
 {
     uint8_t b, c;
-    int color_addr = 0x9400 + (addr & 0x3ff);
-    int color_addr2 = (addr & 0x03ff) | (vic20_vflihack_userport << 10);
-
-    if ((addr & 0x9000) == 0x8000) {
-        /* chargen */
-        b = vic20memrom_chargen_rom[addr & 0xfff];
-        c = vflimod_enabled ? vfli_ram[color_addr2] : mem_ram[color_addr];
-    } else if ((addr < 0x0400) || ((addr >= 0x1000) && (addr < 0x2000))) {
-        /* RAM */
-        b = mem_ram[addr];
-        c = vflimod_enabled ? vfli_ram[color_addr2] : mem_ram[color_addr];
-    } else if (vflimod_enabled && (addr >= 0x0400) && (addr < 0x1000)) {
-        /* only for mike's VFLI hack */
-        /* RAM */
-        b = mem_ram[addr];
-        c = vfli_ram[color_addr2];
-    } else if (addr >= 0x9400 && addr < 0x9800) {
+    uint8_t *page = fetch_pages[vflimod_enabled ? 1 : 0][addr >> 10];
+
+    if (vflimod_enabled) {
+        c = vfli_ram[(addr & 0x03ff) | (vic20_vflihack_userport << 10)];
+    } else {
+        c = mem_ram[0x9400 + (addr & 0x3ff)];
+    }
+
+    if (page != NULL) {
+        /* RAM or chargen */
+        b = page[addr & 0x3ff];
+    } else if ((addr >> 10) == VIC_FETCH_PAGE_COLOR) {
         /* color RAM */
-        b = vflimod_enabled ? vfli_ram[color_addr2] : mem_ram[color_addr];
-        c = b; /* FIXME is this correct? */
+        b = c; /* FIXME is this correct? */
     } else {
-        /* unconnected */
+        /* unconnected, FIXME: is the color correct? */
         b = vic20_v_bus_last_data & (0xf0 | vic20_v_bus_last_high);
-        c = vflimod_enabled ? vfli_ram[color_addr2] : mem_ram[color_addr]; /* FIXME: is this correct? */
     }
     *color = vic20_v_bus_last_high = c;
     vic20_v_bus_last_data = b;
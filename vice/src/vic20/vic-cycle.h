@@ -28,5 +28,6 @@
 #define VICE_VIC_CYCLE_H
 
 void vic_cycle(void);
+void vic_cycle_init(void);
 
 #endif
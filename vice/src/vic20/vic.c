@@ -57,6 +57,7 @@
 #include "vic-snapshot.h"
 #include "vic-timing.h"
 #include "vic-color.h"
+#include "vic-cycle.h"
 #include "vic.h"
 #include "victypes.h"
 #include "vic20.h"
@@ -240,6 +241,7 @@ raster_t *vic_init(void)
     vic_reset();
 
     vic_draw_init();
+    vic_cycle_init();
 
     vic.initialized = 1;
 
@@ -33,8 +33,6 @@
 
 /* ------------------------------------------------------------------------- */
 
-/* Global clock counter.  */
-CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
 
@@ -493,10 +493,11 @@ void mem_initialize_memory(void)
             vic20io3_read, vic20io3_store, io3_peek,
             NULL, 0);
 
-    /* Setup BASIC ROM at $C000-$DFFF. */
+    /* Setup BASIC ROM at $C000-$DFFF.  Reading it has no side effects, so
+       the CPU can fetch opcodes from it directly. */
     set_mem(0xc0, 0xdf,
             vic20memrom_basic_read, store_dummy_c_bus, vic20memrom_basic_read,
-            NULL, 0);
+            vic20memrom_basic_rom, 0x1fff);
 
     /* Setup Kernal ROM at $E000-$FFFF. */
     set_mem(0xe0, 0xff,
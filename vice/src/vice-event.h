@@ -27,6 +27,8 @@
 #ifndef VICE_EVENT_H
 #define VICE_EVENT_H
 
+#include <stddef.h>
+
 #include "types.h"
 
 #define EVENT_LIST_END          0
@@ -45,6 +47,7 @@
 #define EVENT_SYNC_TEST         14
 #define EVENT_KEYBOARD_CLEAR    15
 #define EVENT_RESOURCE          16
+#define EVENT_KEYFRAME          17
 
 #define EVENT_START_MODE_FILE_SAVE 0
 #define EVENT_START_MODE_FILE_LOAD 1
@@ -77,6 +80,8 @@ void event_init_image_list(void);
 void event_destroy_image_list(void);
 void event_clear_list(event_list_state_t *list);
 void event_playback_event_list(event_list_state_t *list);
+uint8_t *event_list_encode(event_list_state_t *list, size_t *len);
+int event_list_decode(event_list_state_t *list, const uint8_t *buf, size_t len);
 
 int event_record_start(void);
 int event_record_stop(void);
@@ -86,6 +91,9 @@ int event_record_active(void);
 int event_playback_active(void);
 int event_record_set_milestone(void);
 int event_record_reset_milestone(void);
+int event_playback_seek(unsigned int seconds);
+int event_playback_skip(int seconds);
+unsigned int event_playback_get_time(void);
 
 void event_reset_ack(void);
 
@@ -56,6 +56,20 @@ static const feature_list_t featurelist[] = {
 #else
         1 },
 #endif
+/* (all) */
+    { "FEATURE_CPU_COMPUTED_GOTO", "Dispatch 65xx opcodes through computed goto.",
+#ifndef FEATURE_CPU_COMPUTED_GOTO
+        0 },
+#else
+        1 },
+#endif
+/* (all) */
+    { "FEATURE_PERF_COUNTERS", "Count hot path events of the emulation.",
+#ifndef FEATURE_PERF_COUNTERS
+        0 },
+#else
+        1 },
+#endif
 #ifdef MACOS_COMPILE /* (osx) */
     { "HAS_HIDMGR", "Enable Mac IOHIDManager Joystick driver.",
 #ifndef HAS_HIDMGR
@@ -383,6 +383,20 @@ const int vicii_sprites_crunch_table[64] =
    collision checking.  */
 static uint8_t *sprline = NULL;
 
+/* The pixels of `sprline' that are taken by a sprite, one bit for each
+   pixel with the leftmost one in the most significant bit.  With this a
+   sprite is checked for sprite-sprite collisions with all of its pixels at
+   once, and only when one of them is already taken it is drawn with the
+   collision checking for every pixel.  Multicolor sprites mark all of the
+   pixels they cover.  The bits start `SPRLINE_BITS_PAD' pixels before
+   `sprline'; if a sprite falls outside of them anyway, every sprite is
+   checked pixel by pixel until the next line.  */
+#define SPRLINE_BITS_PAD 64
+
+static uint64_t *sprline_bits = NULL;
+static int sprline_bits_size = 0;
+static int sprline_bits_overflow = 0;
+
 /* Sprite tables.  */
 static uint16_t sprite_doubling_table[256];
 static uint8_t mcsprtable[256];
@@ -400,6 +414,49 @@ static void init_drawing_tables(void)
     }
 }
 
+/* Return the bits of `size' pixels from `sptr' on, at most 32.  */
+static inline uint32_t sprline_bits_get(const uint8_t *sptr, int size)
+{
+    int pos = (int)(sptr - sprline) + SPRLINE_BITS_PAD;
+    int shift = pos & 63;
+    uint64_t bits;
+
+    if (size <= 0) {
+        return 0;
+    }
+    if (sprline_bits_overflow || pos < 0 || pos + size > sprline_bits_size) {
+        return 0xffffffff;
+    }
+
+    bits = sprline_bits[pos >> 6] << shift;
+    if (shift) {
+        bits |= sprline_bits[(pos >> 6) + 1] >> (64 - shift);
+    }
+    return (uint32_t)(bits >> (64 - size));
+}
+
+/* Mark the pixels of `msk', `size' pixels from `sptr' on, at most 32.  */
+static inline void sprline_bits_set(const uint8_t *sptr, uint32_t msk, int size)
+{
+    int pos = (int)(sptr - sprline) + SPRLINE_BITS_PAD;
+    int shift = pos & 63;
+    uint64_t bits;
+
+    if (size <= 0 || msk == 0) {
+        return;
+    }
+    if (pos < 0 || pos + size > sprline_bits_size) {
+        sprline_bits_overflow = 1;
+        return;
+    }
+
+    bits = (uint64_t)msk << (64 - size);
+    sprline_bits[pos >> 6] |= bits >> shift;
+    if (shift) {
+        sprline_bits[(pos >> 6) + 1] |= bits << (64 - shift);
+    }
+}
+
 /* Sprite drawing macros.  */
 #define SPRITE_PIXEL(do_draw, sprite_bit, imgptr, collmskptr, \
                      pos, color, collmsk_return)              \
@@ -410,6 +467,15 @@ static void init_drawing_tables(void)
         (collmskptr)[(pos)] |= (sprite_bit);                  \
     } while (0)
 
+/* The same for pixels known to be free of other sprites.  */
+#define SPRITE_PIXEL_FREE(do_draw, sprite_bit, imgptr, collmskptr, \
+                          pos, color, collmsk_return)              \
+    do {                                                           \
+        if (do_draw) {                                             \
+            (imgptr)[(pos)] = (uint8_t)(color); }                  \
+        (collmskptr)[(pos)] = (uint8_t)(sprite_bit);               \
+    } while (0)
+
 /* Hires sprites */
 #define _SPRITE_MASK(msk, gfxmsk, size, sprite_bit, imgptr,      \
                      collmskptr, color, collmsk_return, DRAW)    \
@@ -538,6 +604,26 @@ static void init_drawing_tables(void)
     } while (0)
 
 
+/* Draw the pixels `sprmsk' of a hires sprite, `size' pixels from `ptr' on.
+   The sprite-sprite collisions found are added to `cmsk'.  */
+inline static void draw_hires_sprite_mask(uint32_t sprmsk, uint32_t collmsk,
+                                          int size, uint8_t sbit,
+                                          uint8_t *ptr, uint8_t *sptr,
+                                          unsigned int color, uint8_t *cmsk)
+{
+    uint8_t collisions = 0;
+
+    if (sprline_bits_get(sptr, size) & sprmsk) {
+        SPRITE_MASK(sprmsk, collmsk, size, sbit, ptr, sptr, color,
+                    collisions);
+        *cmsk |= collisions;
+    } else {
+        _SPRITE_MASK(sprmsk, collmsk, size, sbit, ptr, sptr, color,
+                     collisions, SPRITE_PIXEL_FREE);
+    }
+    sprline_bits_set(sptr, sprmsk, size);
+}
+
 inline static void draw_hires_sprite_expanded(uint8_t *data_ptr, int n,
                                               uint8_t *msk_ptr, uint8_t *ptr,
                                               int lshift, uint8_t *sptr,
@@ -546,8 +632,8 @@ inline static void draw_hires_sprite_expanded(uint8_t *data_ptr, int n,
 {
     uint32_t sprmsk, collmsk;
     uint32_t trimmsk;
-    uint16_t sbit = 0x101 << n;
-    uint16_t cmsk = 0;
+    uint8_t sbit = 1 << n;
+    uint8_t cmsk = 0;
 
     int size = 48;
     int size1 = 32;
@@ -598,13 +684,10 @@ inline static void draw_hires_sprite_expanded(uint8_t *data_ptr, int n,
     if (sprmsk & collmsk) {
         sprite_status->sprite_background_collisions |= sbit;
     }
-    if (sprite_status->sprites[n].in_background) {
-        SPRITE_MASK(sprmsk, collmsk, size1, sbit, ptr, sptr,
-                    sprite_status->sprites[n].color, cmsk);
-    } else {
-        SPRITE_MASK(sprmsk, 0, size1, sbit, ptr, sptr,
-                    sprite_status->sprites[n].color, cmsk);
-    }
+    draw_hires_sprite_mask(sprmsk,
+                           sprite_status->sprites[n].in_background ? collmsk : 0,
+                           size1, sbit, ptr, sptr,
+                           sprite_status->sprites[n].color, &cmsk);
 
     size1 = size - size1;
     sprmsk = sprite_doubling_table[data_ptr[2]];
@@ -641,16 +724,12 @@ inline static void draw_hires_sprite_expanded(uint8_t *data_ptr, int n,
     if (sprmsk & collmsk) {
         sprite_status->sprite_background_collisions |= sbit;
     }
-    if (sprite_status->sprites[n].in_background) {
-        SPRITE_MASK(sprmsk, collmsk, size1, sbit, ptr + 32, sptr + 32,
-                    sprite_status->sprites[n].color, cmsk);
-    } else {
-        SPRITE_MASK(sprmsk, 0, size1, sbit, ptr + 32, sptr + 32,
-                    sprite_status->sprites[n].color, cmsk);
-    }
+    draw_hires_sprite_mask(sprmsk,
+                           sprite_status->sprites[n].in_background ? collmsk : 0,
+                           size1, sbit, ptr + 32, sptr + 32,
+                           sprite_status->sprites[n].color, &cmsk);
     if (cmsk) {
-        sprite_status->sprite_sprite_collisions
-            |= (cmsk >> 8) | ((cmsk | sbit) & 0xff);
+        sprite_status->sprite_sprite_collisions |= cmsk | sbit;
     }
 }
 
@@ -715,13 +794,10 @@ inline static void draw_hires_sprite_normal(uint8_t *data_ptr, int n,
     if (sprmsk & collmsk) {
         sprite_status->sprite_background_collisions |= sbit;
     }
-    if (sprite_status->sprites[n].in_background) {
-        SPRITE_MASK(sprmsk, collmsk, size, sbit, ptr, sptr,
-                    sprite_status->sprites[n].color, cmsk);
-    } else {
-        SPRITE_MASK(sprmsk, 0, size, sbit, ptr, sptr,
-                    sprite_status->sprites[n].color, cmsk);
-    }
+    draw_hires_sprite_mask(sprmsk,
+                           sprite_status->sprites[n].in_background ? collmsk : 0,
+                           size, sbit, ptr, sptr,
+                           sprite_status->sprites[n].color, &cmsk);
     if (cmsk) {
         sprite_status->sprite_sprite_collisions |= cmsk | sbit;
     }
@@ -1023,6 +1099,7 @@ inline static void draw_mc_sprite(uint8_t *gfx_msk_ptr, uint8_t *data_ptr, int n
                                   int sprite_xs, int sprite_xe)
 {
     uint32_t c[4];
+    int width, p;
 
     c[1] = sprite_status->mc_sprite_color_1;
     c[2] = sprite_status->sprites[n].color;
@@ -1035,6 +1112,17 @@ inline static void draw_mc_sprite(uint8_t *gfx_msk_ptr, uint8_t *data_ptr, int n
         draw_mc_sprite_normal(data_ptr, n, c, msk_ptr, ptr, lshift, sptr,
                               sprite_status, sprite_xs, sprite_xe);
     }
+
+    /* mark all pixels the sprite may have drawn, including the repeated
+       ones */
+    width = sprite_status->sprites[n].x_expanded ? 64 : 32;
+    p = MAX(0, sprite_xs);
+    width = MIN(sprite_xe + 1, width);
+    for (; p < width; p += 32) {
+        int size = MIN(32, width - p);
+
+        sprline_bits_set(sptr + p, 0xffffffff >> (32 - size), size);
+    }
 }
 
 static inline void calculate_idle_sprite_data(uint8_t *data, unsigned int n)
@@ -1338,16 +1426,24 @@ void vicii_sprites_reset_xshift(void)
 void vicii_sprites_reset_sprline(void)
 {
     memset(sprline, 0, vicii.sprite_wrap_x);
+    memset(sprline_bits, 0, (size_t)(sprline_bits_size / 64) * sizeof(uint64_t));
+    sprline_bits_overflow = 0;
 }
 
 void vicii_sprites_init_sprline(void)
 {
     sprline = lib_realloc(sprline, vicii.sprite_wrap_x);
+
+    /* one more word for reading the bits of a sprite at the end */
+    sprline_bits_size = (vicii.sprite_wrap_x + 2 * SPRLINE_BITS_PAD + 63) & ~63;
+    lib_free(sprline_bits);
+    sprline_bits = lib_calloc((size_t)(sprline_bits_size / 64) + 1, sizeof(uint64_t));
 }
 
 void vicii_sprites_shutdown(void)
 {
     lib_free(sprline);
+    lib_free(sprline_bits);
 }
 
 int vicii_sprite_offset(void)
@@ -37,6 +37,7 @@
 #include "lib.h"
 #include "log.h"
 #include "maincpu.h"
+#include "perfcounters.h"
 #include "types.h"
 #include "vicii-chip-model.h"
 #include "vicii-cycle.h"
@@ -53,6 +54,9 @@ static inline void check_badline(void)
     /* Check badline condition (line range and "allow bad lines" handled outside */
     if ((vicii.raster_line & 7) == vicii.ysmooth) {
         vicii.bad_line = 1;
+        if (vicii.idle_state) {
+            PERF_COUNT_VICII(PERF_VICII_IDLE_LEAVE);
+        }
         vicii.idle_state = 0;
     } else {
         vicii.bad_line = 0;
@@ -391,6 +395,7 @@ int vicii_cycle(void)
     /* Next cycle */
     next_vicii_cycle();
     vicii.cycle_flags = vicii.cycle_table[vicii.raster_cycle];
+    PERF_COUNT_VICII(PERF_VICII_CYCLE);
 
     /******
      *
@@ -554,10 +559,16 @@ int vicii_cycle(void)
         /* `rc' makes the chip go to idle state when it reaches the
            maximum value.  */
         if (vicii.rc == 7) {
+            if (!vicii.idle_state) {
+                PERF_COUNT_VICII(PERF_VICII_IDLE_ENTER);
+            }
             vicii.idle_state = 1;
             vicii.vcbase = vicii.vc;
         }
         if (!vicii.idle_state || vicii.bad_line) {
+            if (vicii.idle_state) {
+                PERF_COUNT_VICII(PERF_VICII_IDLE_LEAVE);
+            }
             vicii.rc = (vicii.rc + 1) & 0x7;
             vicii.idle_state = 0;
         }
@@ -580,6 +591,10 @@ int vicii_cycle(void)
     /* if ba_low transitioning from non-active to active, always count
        3 cycles before allowing any Phi2 accesses. */
     if (ba_low) {
+        PERF_COUNT_VICII(PERF_VICII_BA_LOW);
+        if (vicii.prefetch_cycles == 3 + 1) {
+            PERF_COUNT_VICII(PERF_VICII_BA_FALL);
+        }
         /* count down prefetch cycles */
         if (vicii.prefetch_cycles) {
             vicii.prefetch_cycles--;
@@ -598,6 +613,7 @@ int vicii_cycle(void)
             log_debug(LOG_DEFAULT, "DMA at cycle %u   %"PRIu64"", vicii.raster_cycle, maincpu_clk);
         }
 #endif
+        PERF_COUNT_VICII(PERF_VICII_MATRIX_FETCH);
         vicii_fetch_matrix();
     }
 
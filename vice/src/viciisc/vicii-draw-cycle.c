@@ -33,6 +33,7 @@
 #include "vicii-chip-model.h"
 #include "vicii-draw-cycle.h"
 #include "viciitypes.h"
+#include "video.h"
 
 /* disable for debugging */
 #define DRAW_INLINE inline
@@ -60,68 +61,11 @@
 #define COL_D02D     0x2d
 #define COL_D02E     0x2e
 
-/* foreground/background graphics */
-
-static uint8_t gbuf_pipe0_reg = 0;
-static uint8_t cbuf_pipe0_reg = 0;
-static uint8_t vbuf_pipe0_reg = 0;
-static uint8_t gbuf_pipe1_reg = 0;
-static uint8_t cbuf_pipe1_reg = 0;
-static uint8_t vbuf_pipe1_reg = 0;
-
-static uint8_t xscroll_pipe = 0;
-static uint8_t vmode11_pipe = 0;
-static uint8_t vmode16_pipe = 0;
-static uint8_t vmode16_pipe2 = 0;
-
-/* gbuf shift register */
-static uint8_t gbuf_reg = 0;
-static uint8_t gbuf_mc_flop = 0;
-static uint8_t gbuf_pixel_reg = 0;
-
-/* cbuf and vbuf registers */
-static uint8_t cbuf_reg = 0;
-static uint8_t vbuf_reg = 0;
-
-static uint8_t dmli = 0;
-
-/* sprites */
-static int sprite_x_pipe[8];
-static uint8_t sprite_pri_bits = 0;
-static uint8_t sprite_mc_bits = 0;
-static uint8_t sprite_expx_bits = 0;
-
-static uint8_t sprite_pending_bits = 0;
-static uint8_t sprite_active_bits = 0;
-static uint8_t sprite_halt_bits = 0;
-
-/* sbuf shift registers */
-static uint32_t sbuf_reg[8];
-static uint8_t sbuf_pixel_reg[8];
-static uint8_t sbuf_expx_flops;
-static uint8_t sbuf_mc_flops;
-
-/* border */
-static int border_state = 0;
-
-/* pixel buffer */
-static uint8_t render_buffer[8];
-static uint8_t pri_buffer[8];
-
-static uint8_t pixel_buffer[8];
-
-/* color resolution registers */
-static uint8_t cregs[0x2f];
-static uint8_t last_color_reg;
-static uint8_t last_color_value;
-
-static unsigned int cycle_flags_pipe;
-
 void vicii_monitor_colreg_store(int reg, int value)
 {
-    cregs[reg] = value;
-    last_color_reg = reg;
-    last_color_value = value;
+    vicii.draw.cregs[reg] = value;
+    vicii.draw.last_color_reg = reg;
+    vicii.draw.last_color_value = value;
 }
 
 /**************************************************************************
@@ -141,6 +85,34 @@ static const uint8_t colors[] = {
     COL_NONE, COL_NONE, COL_NONE, COL_NONE          /* ECM=1 BMM=1 MCM=1 */
 };
 
+/* resolve the pipeline dependent colors */
+static DRAW_INLINE uint8_t lookup_color(uint8_t cc)
+{
+    switch (cc) {
+        case COL_NONE:
+            cc = 0;
+            break;
+        case COL_VBUF_L:
+            cc = vicii.draw.vbuf_reg & 0x0f;
+            break;
+        case COL_VBUF_H:
+            cc = vicii.draw.vbuf_reg >> 4;
+            break;
+        case COL_CBUF:
+            cc = vicii.draw.cbuf_reg;
+            break;
+        case COL_CBUF_MC:
+            cc = vicii.draw.cbuf_reg & 0x07;
+            break;
+        case COL_D02X_EXT:
+            cc = COL_D021 + (vicii.draw.vbuf_reg >> 6);
+            break;
+        default:
+            break;
+    }
+    return cc;
+}
+
 static DRAW_INLINE void draw_graphics(int i)
 {
     uint8_t px;
@@ -149,27 +121,27 @@ static DRAW_INLINE void draw_graphics(int i)
     uint8_t vmode;
 
     /* Load new gbuf/vbuf/cbuf values at offset == xscroll */
-    if (i == xscroll_pipe) {
+    if (i == vicii.draw.xscroll_pipe) {
         /* latch values at time xs */
-        vbuf_reg = vbuf_pipe1_reg;
-        cbuf_reg = cbuf_pipe1_reg;
-        gbuf_reg = gbuf_pipe1_reg;
-        gbuf_mc_flop = 1;
+        vicii.draw.vbuf_reg = vicii.draw.vbuf_pipe1_reg;
+        vicii.draw.cbuf_reg = vicii.draw.cbuf_pipe1_reg;
+        vicii.draw.gbuf_reg = vicii.draw.gbuf_pipe1_reg;
+        vicii.draw.gbuf_mc_flop = 1;
     }
 
     /*
      * read pixels depending on video mode
      * mc pixels if MCM=1 and BMM=1, or MCM=1 and cbuf bit 3 = 1
      */
-    if (vmode16_pipe2) {
-        if ((vmode11_pipe & 0x08) || (cbuf_reg & 0x08)) {
+    if (vicii.draw.vmode16_pipe2) {
+        if ((vicii.draw.vmode11_pipe & 0x08) || (vicii.draw.cbuf_reg & 0x08)) {
             /* mc pixels */
-            if (gbuf_mc_flop) {
-                gbuf_pixel_reg = gbuf_reg >> 6;
+            if (vicii.draw.gbuf_mc_flop) {
+                vicii.draw.gbuf_pixel_reg = vicii.draw.gbuf_reg >> 6;
             }
         } else {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 3 : 0;
+            vicii.draw.gbuf_pixel_reg = (vicii.draw.gbuf_reg & 0x80) ? 3 : 0;
         }
     } else {
         /*
@@ -177,120 +149,148 @@ static DRAW_INLINE void draw_graphics(int i)
          * MC and non-MC chars.
          * This is rather ugly. There must be a simpler solution.
          */
-        if ((vmode11_pipe & 0x08) || (cbuf_reg & 0x08)) {
+        if ((vicii.draw.vmode11_pipe & 0x08) || (vicii.draw.cbuf_reg & 0x08)) {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 2 : 0;
+            vicii.draw.gbuf_pixel_reg = (vicii.draw.gbuf_reg & 0x80) ? 2 : 0;
         } else {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 3 : 0;
+            vicii.draw.gbuf_pixel_reg = (vicii.draw.gbuf_reg & 0x80) ? 3 : 0;
         }
     }
-    px = gbuf_pixel_reg;
+    px = vicii.draw.gbuf_pixel_reg;
 
     /* shift the graphics buffer */
-    gbuf_reg <<= 1;
-    gbuf_mc_flop ^= 1;
+    vicii.draw.gbuf_reg <<= 1;
+    vicii.draw.gbuf_mc_flop ^= 1;
 
     /* Determine pixel color and priority */
-    vmode = vmode11_pipe | vmode16_pipe;
+    vmode = vicii.draw.vmode11_pipe | vicii.draw.vmode16_pipe;
     pixel_pri = (px & 0x2);
-    cc = colors[vmode | px];
-
     /* lookup colors and render pixel */
-    switch (cc) {
-        case COL_NONE:
-            cc = 0;
-            break;
-        case COL_VBUF_L:
-            cc = vbuf_reg & 0x0f;
-            break;
-        case COL_VBUF_H:
-            cc = vbuf_reg >> 4;
-            break;
-        case COL_CBUF:
-            cc = cbuf_reg;
-            break;
-        case COL_CBUF_MC:
-            cc = cbuf_reg & 0x07;
-            break;
-        case COL_D02X_EXT:
-            cc = COL_D021 + (vbuf_reg >> 6);
-            break;
-        default:
-            break;
+    cc = lookup_color(colors[vmode | px]);
+
+    vicii.draw.render_buffer[i] = cc;
+    vicii.draw.pri_buffer[i] = pixel_pri;
+}
+
+/*
+ * Variants of draw_graphics() for cycles where the graphics shift register
+ * is empty.  The pixels are all background with priority 0, so only the
+ * latches and the mc flop need to be updated besides the color.  If the
+ * cycle is completely covered by the border the color gets overwritten by
+ * draw_border8() anyway.
+ */
+static DRAW_INLINE void draw_graphics_empty(int i)
+{
+    if (i == vicii.draw.xscroll_pipe) {
+        vicii.draw.vbuf_reg = vicii.draw.vbuf_pipe1_reg;
+        vicii.draw.cbuf_reg = vicii.draw.cbuf_pipe1_reg;
+        vicii.draw.gbuf_mc_flop = 1;
     }
+    vicii.draw.gbuf_mc_flop ^= 1;
+
+    vicii.draw.render_buffer[i] = lookup_color(colors[vicii.draw.vmode11_pipe | vicii.draw.vmode16_pipe]);
+}
 
-    render_buffer[i] = cc;
-    pri_buffer[i] = pixel_pri;
+static DRAW_INLINE void draw_graphics_idle(int i)
+{
+    if (i == vicii.draw.xscroll_pipe) {
+        vicii.draw.vbuf_reg = vicii.draw.vbuf_pipe1_reg;
+        vicii.draw.cbuf_reg = vicii.draw.cbuf_pipe1_reg;
+        vicii.draw.gbuf_mc_flop = 1;
+    }
+    vicii.draw.gbuf_mc_flop ^= 1;
 }
 
+#define GFX_FULL    0
+#define GFX_EMPTY   1
+#define GFX_IDLE    2
+
+#define DRAW_GRAPHICS(i)                  \
+    do {                                  \
+        if (gfx == GFX_IDLE) {            \
+            draw_graphics_idle(i);        \
+        } else if (gfx == GFX_EMPTY) {    \
+            draw_graphics_empty(i);       \
+        } else {                          \
+            draw_graphics(i);             \
+        }                                 \
+    } while (0)
+
 static DRAW_INLINE void draw_graphics8(unsigned int cycle_flags)
 {
     int vis_en;
+    int gfx = GFX_FULL;
 
     vis_en = cycle_is_visible(cycle_flags);
 
+    /* no graphics data in the pipe, and nothing but border in this cycle */
+    if (!(vicii.draw.gbuf_reg | vicii.draw.gbuf_pipe1_reg | vicii.draw.gbuf_pixel_reg)) {
+        gfx = (vicii.draw.border_state && vicii.main_border) ? GFX_IDLE : GFX_EMPTY;
+        memset(vicii.draw.pri_buffer, 0, 8);
+    }
+
     /* render pixels */
     /* pixel 0 */
-    draw_graphics(0);
+    DRAW_GRAPHICS(0);
     /* pixel 1 */
-    draw_graphics(1);
+    DRAW_GRAPHICS(1);
     /* pixel 2 */
-    draw_graphics(2);
+    DRAW_GRAPHICS(2);
     /* pixel 3 */
-    draw_graphics(3);
+    DRAW_GRAPHICS(3);
     /* pixel 4 */
-    vmode16_pipe = ( vicii.regs[0x16] & 0x10 ) >> 2;
+    vicii.draw.vmode16_pipe = ( vicii.regs[0x16] & 0x10 ) >> 2;
     if (vicii.color_latency) {
         /* handle rising edge of internal signal */
-        vmode11_pipe |= ( vicii.regs[0x11] & 0x60 ) >> 2;
+        vicii.draw.vmode11_pipe |= ( vicii.regs[0x11] & 0x60 ) >> 2;
     }
-    draw_graphics(4);
+    DRAW_GRAPHICS(4);
     /* pixel 5 */
-    draw_graphics(5);
+    DRAW_GRAPHICS(5);
     /* pixel 6 */
     if (vicii.color_latency) {
         /* handle falling edge of internal signal */
-        vmode11_pipe &= ( vicii.regs[0x11] & 0x60 ) >> 2;
+        vicii.draw.vmode11_pipe &= ( vicii.regs[0x11] & 0x60 ) >> 2;
     }
-    draw_graphics(6);
+    DRAW_GRAPHICS(6);
     /* pixel 7 */
-    if (vmode16_pipe && !vmode16_pipe2) {
-        gbuf_mc_flop = 0;
+    if (vicii.draw.vmode16_pipe && !vicii.draw.vmode16_pipe2) {
+        vicii.draw.gbuf_mc_flop = 0;
     }
-    vmode16_pipe2 = vmode16_pipe;
-    draw_graphics(7);
+    vicii.draw.vmode16_pipe2 = vicii.draw.vmode16_pipe;
+    DRAW_GRAPHICS(7);
 
     if (!vicii.color_latency) {
-        vmode11_pipe = ( vicii.regs[0x11] & 0x60 ) >> 2;
+        vicii.draw.vmode11_pipe = ( vicii.regs[0x11] & 0x60 ) >> 2;
     }
 
     /* shift and put the next data into the pipe. */
-    vbuf_pipe1_reg = vbuf_pipe0_reg;
-    cbuf_pipe1_reg = cbuf_pipe0_reg;
-    gbuf_pipe1_reg = gbuf_pipe0_reg;
+    vicii.draw.vbuf_pipe1_reg = vicii.draw.vbuf_pipe0_reg;
+    vicii.draw.cbuf_pipe1_reg = vicii.draw.cbuf_pipe0_reg;
+    vicii.draw.gbuf_pipe1_reg = vicii.draw.gbuf_pipe0_reg;
 
     /* this makes sure gbuf is 0 outside the visible area
        It should probably be done somewhere around the fetch instead */
     if (vis_en && vicii.vborder == 0) {
-        gbuf_pipe0_reg = vicii.gbuf;
-        xscroll_pipe = vicii.regs[0x16] & 0x07;
+        vicii.draw.gbuf_pipe0_reg = vicii.gbuf;
+        vicii.draw.xscroll_pipe = vicii.regs[0x16] & 0x07;
     } else {
-        gbuf_pipe0_reg = 0;
+        vicii.draw.gbuf_pipe0_reg = 0;
     }
 
     /* Only update vbuf and cbuf registers in the display state. */
     if (vis_en && vicii.vborder == 0) {
         if (!vicii.idle_state) {
-            vbuf_pipe0_reg = vicii.vbuf[dmli];
-            cbuf_pipe0_reg = vicii.cbuf[dmli];
-            dmli++;
+            vicii.draw.vbuf_pipe0_reg = vicii.vbuf[vicii.draw.dmli];
+            vicii.draw.cbuf_pipe0_reg = vicii.cbuf[vicii.draw.dmli];
+            vicii.draw.dmli++;
         } else {
-            vbuf_pipe0_reg = 0;
-            cbuf_pipe0_reg = 0;
+            vicii.draw.vbuf_pipe0_reg = 0;
+            vicii.draw.cbuf_pipe0_reg = 0;
         }
     } else {
-        dmli = 0;
+        vicii.draw.dmli = 0;
     }
 }
 
@@ -308,7 +308,7 @@ static DRAW_INLINE uint8_t get_trigger_candidates(int xpos)
 
     /* check for partial xpos match */
     for (s = 0; s < 8; s++) {
-        if ((xpos & 0x1f8) == (sprite_x_pipe[s] & 0x1f8)) {
+        if ((xpos & 0x1f8) == (vicii.draw.sprite_x_pipe[s] & 0x1f8)) {
             candidate_bits |= 1 << s;
         }
     }
@@ -320,7 +320,7 @@ static DRAW_INLINE void trigger_sprites(int xpos, uint8_t candidate_bits)
     int s;
 
     /* do nothing if no sprites are candidates or pending */
-    if (!candidate_bits || !sprite_pending_bits) {
+    if (!candidate_bits || !vicii.draw.sprite_pending_bits) {
         return;
     }
 
@@ -329,11 +329,11 @@ static DRAW_INLINE void trigger_sprites(int xpos, uint8_t candidate_bits)
         uint8_t m = 1 << s;
 
         /* start rendering on position match */
-        if ((candidate_bits & m) && (sprite_pending_bits & m) && !(sprite_active_bits & m) && !(sprite_halt_bits & m)) {
-            if (xpos == sprite_x_pipe[s]) {
-                sbuf_expx_flops |= m;
-                sbuf_mc_flops |= m;
-                sprite_active_bits |= m;
+        if ((candidate_bits & m) && (vicii.draw.sprite_pending_bits & m) && !(vicii.draw.sprite_active_bits & m) && !(vicii.draw.sprite_halt_bits & m)) {
+            if (xpos == vicii.draw.sprite_x_pipe[s]) {
+                vicii.draw.sbuf_expx_flops |= m;
+                vicii.draw.sbuf_mc_flops |= m;
+                vicii.draw.sprite_active_bits |= m;
             }
         }
     }
@@ -346,7 +346,7 @@ static DRAW_INLINE void draw_sprites(int i)
     uint8_t collision_mask;
 
     /* do nothing if all sprites are inactive */
-    if (!sprite_active_bits) {
+    if (!vicii.draw.sprite_active_bits) {
         return;
     }
 
@@ -356,31 +356,31 @@ static DRAW_INLINE void draw_sprites(int i)
     for (s = 7; s >= 0; --s) {
         uint8_t m = 1 << s;
 
-        if (sprite_active_bits & m) {
+        if (vicii.draw.sprite_active_bits & m) {
             /* render pixels if shift register or pixel reg still contains data */
-            if (sbuf_reg[s] || sbuf_pixel_reg[s]) {
-                if (!(sprite_halt_bits & m)) {
-                    if (sbuf_expx_flops & m) {
-                        if (sprite_mc_bits & m) {
-                            if (sbuf_mc_flops & m) {
+            if (vicii.draw.sbuf_reg[s] || vicii.draw.sbuf_pixel_reg[s]) {
+                if (!(vicii.draw.sprite_halt_bits & m)) {
+                    if (vicii.draw.sbuf_expx_flops & m) {
+                        if (vicii.draw.sprite_mc_bits & m) {
+                            if (vicii.draw.sbuf_mc_flops & m) {
                                 /* fetch 2 bits */
-                                sbuf_pixel_reg[s] = (uint8_t)((sbuf_reg[s] >> 22) & 0x03);
+                                vicii.draw.sbuf_pixel_reg[s] = (uint8_t)((vicii.draw.sbuf_reg[s] >> 22) & 0x03);
                             }
-                            sbuf_mc_flops ^= m;
+                            vicii.draw.sbuf_mc_flops ^= m;
                         } else {
                             /* fetch 1 bit and make it 0 or 2 */
-                            sbuf_pixel_reg[s] = (uint8_t)(((sbuf_reg[s] >> 23) & 0x01 ) << 1);
+                            vicii.draw.sbuf_pixel_reg[s] = (uint8_t)(((vicii.draw.sbuf_reg[s] >> 23) & 0x01 ) << 1);
                         }
                     }
 
                     /* shift the sprite buffer and handle expansion flags */
-                    if (sbuf_expx_flops & m) {
-                        sbuf_reg[s] <<= 1;
+                    if (vicii.draw.sbuf_expx_flops & m) {
+                        vicii.draw.sbuf_reg[s] <<= 1;
                     }
-                    if (sprite_expx_bits & m) {
-                        sbuf_expx_flops ^= m;
+                    if (vicii.draw.sprite_expx_bits & m) {
+                        vicii.draw.sbuf_expx_flops ^= m;
                     } else {
-                        sbuf_expx_flops |= m;
+                        vicii.draw.sbuf_expx_flops |= m;
                     }
                 }
 
@@ -388,30 +388,30 @@ static DRAW_INLINE void draw_sprites(int i)
                  * set collision mask bits and determine the highest
                  * priority sprite number that has a pixel.
                  */
-                if (sbuf_pixel_reg[s]) {
+                if (vicii.draw.sbuf_pixel_reg[s]) {
                     active_sprite = s;
                     collision_mask |= m;
                 }
             } else {
-                sprite_active_bits &= ~m;
+                vicii.draw.sprite_active_bits &= ~m;
             }
         }
     }
 
     if (collision_mask) {
-        uint8_t pixel_pri = pri_buffer[i];
+        uint8_t pixel_pri = vicii.draw.pri_buffer[i];
         int as = active_sprite;
-        uint8_t spri = sprite_pri_bits & (1 << as);
+        uint8_t spri = vicii.draw.sprite_pri_bits & (1 << as);
         if (!(pixel_pri && spri)) {
-            switch (sbuf_pixel_reg[as]) {
+            switch (vicii.draw.sbuf_pixel_reg[as]) {
                 case 1:
-                    render_buffer[i] = COL_D025;
+                    vicii.draw.render_buffer[i] = COL_D025;
                     break;
                 case 2:
-                    render_buffer[i] = COL_D027 + as;
+                    vicii.draw.render_buffer[i] = COL_D027 + as;
                     break;
                 case 3:
-                    render_buffer[i] = COL_D026;
+                    vicii.draw.render_buffer[i] = COL_D026;
                     break;
                 default:
                     break;
@@ -433,26 +433,26 @@ static DRAW_INLINE void draw_sprites(int i)
 static DRAW_INLINE void update_sprite_mc_bits_6569(void)
 {
     uint8_t next_mc_bits = vicii.regs[0x1c];
-    uint8_t toggled = next_mc_bits ^ sprite_mc_bits;
+    uint8_t toggled = next_mc_bits ^ vicii.draw.sprite_mc_bits;
 
-    sbuf_mc_flops &= ~toggled;
-    sprite_mc_bits = next_mc_bits;
+    vicii.draw.sbuf_mc_flops &= ~toggled;
+    vicii.draw.sprite_mc_bits = next_mc_bits;
 }
 
 static DRAW_INLINE void update_sprite_mc_bits_8565(void)
 {
     uint8_t next_mc_bits = vicii.regs[0x1c];
-    uint8_t toggled = next_mc_bits ^ sprite_mc_bits;
+    uint8_t toggled = next_mc_bits ^ vicii.draw.sprite_mc_bits;
 
-    sbuf_mc_flops ^= toggled & (~sbuf_expx_flops);
-    sprite_mc_bits = next_mc_bits;
+    vicii.draw.sbuf_mc_flops ^= toggled & (~vicii.draw.sbuf_expx_flops);
+    vicii.draw.sprite_mc_bits = next_mc_bits;
 }
 
 static DRAW_INLINE void update_sprite_data(unsigned int cycle_flags)
 {
     if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
         int s = cycle_get_sprite_num(cycle_flags);
-        sbuf_reg[s] = vicii.sprite[s].data;
+        vicii.draw.sbuf_reg[s] = vicii.sprite[s].data;
     }
 }
 
@@ -460,7 +460,7 @@ static DRAW_INLINE void update_sprite_xpos(void)
 {
     int s;
     for (s = 0; s < 8; s++) {
-        sprite_x_pipe[s] = vicii.sprite[s].x;
+        vicii.draw.sprite_x_pipe[s] = vicii.sprite[s].x;
     }
 }
 
@@ -484,7 +484,12 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
     if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
         dma_cycle_2 = 1 << cycle_get_sprite_num(cycle_flags);
     }
-    candidate_bits = get_trigger_candidates(xpos);
+    /* sprites can only be triggered if pending, which may happen at pixel 4 */
+    if (vicii.draw.sprite_pending_bits || (spr_en && vicii.sprite_display_bits)) {
+        candidate_bits = get_trigger_candidates(xpos);
+    } else {
+        candidate_bits = 0;
+    }
 
     /* process and render sprites */
     /* pixel 0 */
@@ -494,16 +499,16 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
     trigger_sprites(xpos + 1, candidate_bits);
     draw_sprites(1);
     /* pixel 2 */
-    sprite_active_bits &= ~dma_cycle_2;
+    vicii.draw.sprite_active_bits &= ~dma_cycle_2;
     trigger_sprites(xpos + 2, candidate_bits);
     draw_sprites(2);
     /* pixel 3 */
-    sprite_halt_bits |= dma_cycle_0;
+    vicii.draw.sprite_halt_bits |= dma_cycle_0;
     trigger_sprites(xpos + 3, candidate_bits);
     draw_sprites(3);
     /* pixel 4 */
     if (spr_en) {
-        sprite_pending_bits = vicii.sprite_display_bits;
+        vicii.draw.sprite_pending_bits = vicii.sprite_display_bits;
     }
     update_sprite_data(cycle_flags);
     trigger_sprites(xpos + 4, candidate_bits);
@@ -515,15 +520,15 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
     if (!vicii.color_latency) {
         update_sprite_mc_bits_8565();
     }
-    sprite_pri_bits = vicii.regs[0x1b];
-    sprite_expx_bits = vicii.regs[0x1d];
+    vicii.draw.sprite_pri_bits = vicii.regs[0x1b];
+    vicii.draw.sprite_expx_bits = vicii.regs[0x1d];
     trigger_sprites(xpos + 6, candidate_bits);
     draw_sprites(6);
     /* pixel 7 */
     if (vicii.color_latency) {
         update_sprite_mc_bits_6569();
     }
-    sprite_halt_bits &= ~dma_cycle_2;
+    vicii.draw.sprite_halt_bits &= ~dma_cycle_2;
     trigger_sprites(xpos + 7, candidate_bits);
     draw_sprites(7);
 
@@ -544,12 +549,12 @@ static DRAW_INLINE void draw_border8(void)
 
 #if 1
     /* early exit for the no border case */
-    if (!(border_state || vicii.main_border)) {
+    if (!(vicii.draw.border_state || vicii.main_border)) {
         return;
     }
     /* early exit for the continuous border case */
-    if (border_state && vicii.main_border) {
-        memset(render_buffer, COL_D020, 8);
+    if (vicii.draw.border_state && vicii.main_border) {
+        memset(vicii.draw.render_buffer, COL_D020, 8);
         return;
     }
 #endif
@@ -559,17 +564,17 @@ static DRAW_INLINE void draw_border8(void)
      * (the code below can handle all border logic)
      */
     if (csel) {
-        if (border_state) {
-            memset(render_buffer, COL_D020, 8);
+        if (vicii.draw.border_state) {
+            memset(vicii.draw.render_buffer, COL_D020, 8);
         }
-        border_state = vicii.main_border;
+        vicii.draw.border_state = vicii.main_border;
     } else {
-        if (border_state) {
-            memset(render_buffer, COL_D020, 7);
+        if (vicii.draw.border_state) {
+            memset(vicii.draw.render_buffer, COL_D020, 7);
         }
-        border_state = vicii.main_border;
-        if (border_state) {
-            render_buffer[7] = COL_D020;
+        vicii.draw.border_state = vicii.main_border;
+        if (vicii.draw.border_state) {
+            vicii.draw.render_buffer[7] = COL_D020;
         }
     }
 }
@@ -584,8 +589,8 @@ static DRAW_INLINE void draw_border8(void)
 /* used by draw_colors8() */
 static DRAW_INLINE void update_cregs(void)
 {
-    last_color_reg = vicii.last_color_reg;
-    last_color_value = vicii.last_color_value;
+    vicii.draw.last_color_reg = vicii.last_color_reg;
+    vicii.draw.last_color_value = vicii.last_color_value;
     vicii.last_color_reg = 0xff;
 }
 
@@ -595,12 +600,12 @@ static DRAW_INLINE void draw_colors_6569(int offs, int i)
 
     /* resolve any unresolved colors */
     lookup_index = (i + 1) & 0x07;
-    pixel_buffer[lookup_index] = cregs[pixel_buffer[lookup_index]];
+    vicii.draw.pixel_buffer[lookup_index] = vicii.draw.cregs[vicii.draw.pixel_buffer[lookup_index]];
 
     /* draw pixel to buffer */
-    vicii.dbuf[offs + i] = pixel_buffer[i];
+    vicii.dbuf[offs + i] = vicii.draw.pixel_buffer[i];
 
-    pixel_buffer[i] = render_buffer[i];
+    vicii.draw.pixel_buffer[i] = vicii.draw.render_buffer[i];
 }
 
 static DRAW_INLINE void draw_colors_8565(int offs, int i)
@@ -611,16 +616,16 @@ static DRAW_INLINE void draw_colors_8565(int offs, int i)
     /* resolve any unresolved colors */
 
     /* special case for grey dot handling */
-    if (i == 0 && pixel_buffer[lookup_index] == last_color_reg) {
-        pixel_buffer[lookup_index] = 0x0f;
+    if (i == 0 && vicii.draw.pixel_buffer[lookup_index] == vicii.draw.last_color_reg) {
+        vicii.draw.pixel_buffer[lookup_index] = 0x0f;
     } else {
-        pixel_buffer[lookup_index] = cregs[pixel_buffer[lookup_index]];
+        vicii.draw.pixel_buffer[lookup_index] = vicii.draw.cregs[vicii.draw.pixel_buffer[lookup_index]];
     }
 
     /* draw pixel to buffer */
-    vicii.dbuf[offs + i] = pixel_buffer[i];
+    vicii.dbuf[offs + i] = vicii.draw.pixel_buffer[i];
 
-    pixel_buffer[i] = render_buffer[i];
+    vicii.draw.pixel_buffer[i] = vicii.draw.render_buffer[i];
 }
 
 static DRAW_INLINE void draw_colors8(void)
@@ -633,8 +638,8 @@ static DRAW_INLINE void draw_colors8(void)
     }
 
     /* update color register (if written) */
-    if (last_color_reg != 0xff) {
-        cregs[last_color_reg] = last_color_value;
+    if (vicii.draw.last_color_reg != 0xff) {
+        vicii.draw.cregs[vicii.draw.last_color_reg] = vicii.draw.last_color_value;
     }
 
     /* render pixels */
@@ -662,6 +667,61 @@ static DRAW_INLINE void draw_colors8(void)
     update_cregs();
 }
 
+/*
+ * Shortcut for draw_colors8() when the current and the buffered pixels all
+ * have the same color, e.g. border or empty background.  Returns 0 if the
+ * full color resolution is needed.
+ */
+static DRAW_INLINE int draw_colors8_solid(void)
+{
+    int offs = vicii.dbuf_offset;
+    uint8_t cc;
+
+    if (vicii.draw.last_color_reg != 0xff || offs > VICII_DRAW_BUFFER_SIZE - 8
+        || memcmp(&vicii.draw.render_buffer[0], &vicii.draw.render_buffer[1], 7) != 0) {
+        return 0;
+    }
+
+    if (vicii.color_latency) {
+        /* the first pixel has already been resolved in the previous cycle */
+        cc = vicii.draw.cregs[vicii.draw.pixel_buffer[1]];
+        if (vicii.draw.pixel_buffer[0] != cc
+            || memcmp(&vicii.draw.pixel_buffer[1], &vicii.draw.pixel_buffer[2], 6) != 0) {
+            return 0;
+        }
+        memcpy(vicii.draw.pixel_buffer, vicii.draw.render_buffer, 8);
+        vicii.draw.pixel_buffer[0] = vicii.draw.cregs[vicii.draw.render_buffer[0]];
+    } else {
+        cc = vicii.draw.cregs[vicii.draw.pixel_buffer[0]];
+        if (memcmp(&vicii.draw.pixel_buffer[0], &vicii.draw.pixel_buffer[1], 7) != 0) {
+            return 0;
+        }
+        memcpy(vicii.draw.pixel_buffer, vicii.draw.render_buffer, 8);
+    }
+
+    memset(&vicii.dbuf[offs], cc, 8);
+    vicii.dbuf_offset += 8;
+
+    update_cregs();
+
+    return 1;
+}
+
+/*
+ * Replacement for draw_border8() and draw_colors8() while the pixels of the
+ * frame are skipped.  Only the border flop and the color registers are kept
+ * up to date, so drawing can resume with the next frame.
+ */
+static DRAW_INLINE void skip_colors8(void)
+{
+    vicii.draw.border_state = vicii.main_border;
+
+    if (vicii.draw.last_color_reg != 0xff) {
+        vicii.draw.cregs[vicii.draw.last_color_reg] = vicii.draw.last_color_value;
+    }
+    update_cregs();
+}
+
 
 /**************************************************************************
  *
@@ -676,15 +736,22 @@ void vicii_draw_cycle(void)
         vicii.dbuf_offset = 0;
     }
 
-    draw_graphics8(cycle_flags_pipe);
+    draw_graphics8(vicii.draw.cycle_flags_pipe);
 
-    draw_sprites8(cycle_flags_pipe);
+    draw_sprites8(vicii.draw.cycle_flags_pipe);
 
-    draw_border8();
+    /* graphics and sprites make the collisions, the rest only pixels */
+    if (video_pixels_skipped) {
+        skip_colors8();
+    } else {
+        draw_border8();
 
-    draw_colors8();
+        if (!draw_colors8_solid()) {
+            draw_colors8();
+        }
+    }
 
-    cycle_flags_pipe = vicii.cycle_flags;
+    vicii.draw.cycle_flags_pipe = vicii.cycle_flags;
 }
 
 
@@ -697,17 +764,17 @@ void vicii_draw_cycle_init(void)
     vicii.dbuf_offset = 0;
 
     /* initialize the pixel ring buffer. */
-    memset(pixel_buffer, 0, sizeof(pixel_buffer));
+    memset(vicii.draw.pixel_buffer, 0, sizeof(vicii.draw.pixel_buffer));
 
-    /* clear cregs and fill 0x00-0x0f with 1:1 mapping */
-    memset(cregs, 0, sizeof(cregs));
+    /* clear vicii.draw.cregs and fill 0x00-0x0f with 1:1 mapping */
+    memset(vicii.draw.cregs, 0, sizeof(vicii.draw.cregs));
     for (i = 0; i < 0x10; i++) {
-        cregs[i] = i;
+        vicii.draw.cregs[i] = i;
     }
     vicii.last_color_reg = 0xff;
-    last_color_reg = 0xff;
+    vicii.draw.last_color_reg = 0xff;
 
-    cycle_flags_pipe = 0;
+    vicii.draw.cycle_flags_pipe = 0;
 }
 
 
@@ -724,59 +791,59 @@ int vicii_draw_cycle_snapshot_write(snapshot_module_t *m)
     int i;
 
     if (0
-        || SMW_B(m, gbuf_pipe0_reg) < 0
-        || SMW_B(m, cbuf_pipe0_reg) < 0
-        || SMW_B(m, vbuf_pipe0_reg) < 0
-        || SMW_B(m, gbuf_pipe1_reg) < 0
-        || SMW_B(m, cbuf_pipe1_reg) < 0
-        || SMW_B(m, vbuf_pipe1_reg) < 0
-        || SMW_B(m, xscroll_pipe) < 0
-        || SMW_B(m, vmode11_pipe) < 0
-        || SMW_B(m, vmode16_pipe) < 0
-        || SMW_B(m, vmode16_pipe2) < 0
-        || SMW_B(m, gbuf_reg) < 0
-        || SMW_B(m, gbuf_mc_flop) < 0
-        || SMW_B(m, gbuf_pixel_reg) < 0
-        || SMW_B(m, cbuf_reg) < 0
-        || SMW_B(m, vbuf_reg) < 0
-        || SMW_B(m, dmli) < 0) {
+        || SMW_B(m, vicii.draw.gbuf_pipe0_reg) < 0
+        || SMW_B(m, vicii.draw.cbuf_pipe0_reg) < 0
+        || SMW_B(m, vicii.draw.vbuf_pipe0_reg) < 0
+        || SMW_B(m, vicii.draw.gbuf_pipe1_reg) < 0
+        || SMW_B(m, vicii.draw.cbuf_pipe1_reg) < 0
+        || SMW_B(m, vicii.draw.vbuf_pipe1_reg) < 0
+        || SMW_B(m, vicii.draw.xscroll_pipe) < 0
+        || SMW_B(m, vicii.draw.vmode11_pipe) < 0
+        || SMW_B(m, vicii.draw.vmode16_pipe) < 0
+        || SMW_B(m, vicii.draw.vmode16_pipe2) < 0
+        || SMW_B(m, vicii.draw.gbuf_reg) < 0
+        || SMW_B(m, vicii.draw.gbuf_mc_flop) < 0
+        || SMW_B(m, vicii.draw.gbuf_pixel_reg) < 0
+        || SMW_B(m, vicii.draw.cbuf_reg) < 0
+        || SMW_B(m, vicii.draw.vbuf_reg) < 0
+        || SMW_B(m, vicii.draw.dmli) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMW_DW(m, (uint32_t)sprite_x_pipe[i]) < 0) {
+        if (SMW_DW(m, (uint32_t)vicii.draw.sprite_x_pipe[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMW_B(m, sprite_pri_bits) < 0
-        || SMW_B(m, sprite_mc_bits) < 0
-        || SMW_B(m, sprite_expx_bits) < 0
-        || SMW_B(m, sprite_pending_bits) < 0
-        || SMW_B(m, sprite_active_bits) < 0
-        || SMW_B(m, sprite_halt_bits) < 0) {
+        || SMW_B(m, vicii.draw.sprite_pri_bits) < 0
+        || SMW_B(m, vicii.draw.sprite_mc_bits) < 0
+        || SMW_B(m, vicii.draw.sprite_expx_bits) < 0
+        || SMW_B(m, vicii.draw.sprite_pending_bits) < 0
+        || SMW_B(m, vicii.draw.sprite_active_bits) < 0
+        || SMW_B(m, vicii.draw.sprite_halt_bits) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMW_DW(m, sbuf_reg[i]) < 0) {
+        if (SMW_DW(m, vicii.draw.sbuf_reg[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMW_BA(m, sbuf_pixel_reg, 8) < 0
-        || SMW_B(m, sbuf_expx_flops) < 0
-        || SMW_B(m, sbuf_mc_flops) < 0
-        || SMW_B(m, (uint8_t)border_state) < 0
-        || SMW_BA(m, render_buffer, 8) < 0
-        || SMW_BA(m, pri_buffer, 8) < 0
-        || SMW_BA(m, pixel_buffer, 8) < 0
-        || SMW_BA(m, cregs, 0x2f) < 0
-        || SMW_B(m, last_color_reg) < 0
-        || SMW_B(m, last_color_value) < 0
-        || SMW_DW(m, (uint32_t)cycle_flags_pipe) < 0) {
+        || SMW_BA(m, vicii.draw.sbuf_pixel_reg, 8) < 0
+        || SMW_B(m, vicii.draw.sbuf_expx_flops) < 0
+        || SMW_B(m, vicii.draw.sbuf_mc_flops) < 0
+        || SMW_B(m, (uint8_t)vicii.draw.border_state) < 0
+        || SMW_BA(m, vicii.draw.render_buffer, 8) < 0
+        || SMW_BA(m, vicii.draw.pri_buffer, 8) < 0
+        || SMW_BA(m, vicii.draw.pixel_buffer, 8) < 0
+        || SMW_BA(m, vicii.draw.cregs, 0x2f) < 0
+        || SMW_B(m, vicii.draw.last_color_reg) < 0
+        || SMW_B(m, vicii.draw.last_color_value) < 0
+        || SMW_DW(m, (uint32_t)vicii.draw.cycle_flags_pipe) < 0) {
         return -1;
     }
 
@@ -788,59 +855,59 @@ int vicii_draw_cycle_snapshot_read(snapshot_module_t *m)
     int i;
 
     if (0
-        || SMR_B(m, &gbuf_pipe0_reg) < 0
-        || SMR_B(m, &cbuf_pipe0_reg) < 0
-        || SMR_B(m, &vbuf_pipe0_reg) < 0
-        || SMR_B(m, &gbuf_pipe1_reg) < 0
-        || SMR_B(m, &cbuf_pipe1_reg) < 0
-        || SMR_B(m, &vbuf_pipe1_reg) < 0
-        || SMR_B(m, &xscroll_pipe) < 0
-        || SMR_B(m, &vmode11_pipe) < 0
-        || SMR_B(m, &vmode16_pipe) < 0
-        || SMR_B(m, &vmode16_pipe2) < 0
-        || SMR_B(m, &gbuf_reg) < 0
-        || SMR_B(m, &gbuf_mc_flop) < 0
-        || SMR_B(m, &gbuf_pixel_reg) < 0
-        || SMR_B(m, &cbuf_reg) < 0
-        || SMR_B(m, &vbuf_reg) < 0
-        || SMR_B(m, &dmli) < 0) {
+        || SMR_B(m, &vicii.draw.gbuf_pipe0_reg) < 0
+        || SMR_B(m, &vicii.draw.cbuf_pipe0_reg) < 0
+        || SMR_B(m, &vicii.draw.vbuf_pipe0_reg) < 0
+        || SMR_B(m, &vicii.draw.gbuf_pipe1_reg) < 0
+        || SMR_B(m, &vicii.draw.cbuf_pipe1_reg) < 0
+        || SMR_B(m, &vicii.draw.vbuf_pipe1_reg) < 0
+        || SMR_B(m, &vicii.draw.xscroll_pipe) < 0
+        || SMR_B(m, &vicii.draw.vmode11_pipe) < 0
+        || SMR_B(m, &vicii.draw.vmode16_pipe) < 0
+        || SMR_B(m, &vicii.draw.vmode16_pipe2) < 0
+        || SMR_B(m, &vicii.draw.gbuf_reg) < 0
+        || SMR_B(m, &vicii.draw.gbuf_mc_flop) < 0
+        || SMR_B(m, &vicii.draw.gbuf_pixel_reg) < 0
+        || SMR_B(m, &vicii.draw.cbuf_reg) < 0
+        || SMR_B(m, &vicii.draw.vbuf_reg) < 0
+        || SMR_B(m, &vicii.draw.dmli) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMR_DW_INT(m, &sprite_x_pipe[i]) < 0) {
+        if (SMR_DW_INT(m, &vicii.draw.sprite_x_pipe[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMR_B(m, &sprite_pri_bits) < 0
-        || SMR_B(m, &sprite_mc_bits) < 0
-        || SMR_B(m, &sprite_expx_bits) < 0
-        || SMR_B(m, &sprite_pending_bits) < 0
-        || SMR_B(m, &sprite_active_bits) < 0
-        || SMR_B(m, &sprite_halt_bits) < 0) {
+        || SMR_B(m, &vicii.draw.sprite_pri_bits) < 0
+        || SMR_B(m, &vicii.draw.sprite_mc_bits) < 0
+        || SMR_B(m, &vicii.draw.sprite_expx_bits) < 0
+        || SMR_B(m, &vicii.draw.sprite_pending_bits) < 0
+        || SMR_B(m, &vicii.draw.sprite_active_bits) < 0
+        || SMR_B(m, &vicii.draw.sprite_halt_bits) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMR_DW(m, &sbuf_reg[i]) < 0) {
+        if (SMR_DW(m, &vicii.draw.sbuf_reg[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMR_BA(m, sbuf_pixel_reg, 8) < 0
-        || SMR_B(m, &sbuf_expx_flops) < 0
-        || SMR_B(m, &sbuf_mc_flops) < 0
-        || SMR_B_INT(m, &border_state) < 0
-        || SMR_BA(m, render_buffer, 8) < 0
-        || SMR_BA(m, pri_buffer, 8) < 0
-        || SMR_BA(m, pixel_buffer, 8) < 0
-        || SMR_BA(m, cregs, 0x2f) < 0
-        || SMR_B(m, &last_color_reg) < 0
-        || SMR_B(m, &last_color_value) < 0
-        || SMR_DW_UINT(m, &cycle_flags_pipe) < 0) {
+        || SMR_BA(m, vicii.draw.sbuf_pixel_reg, 8) < 0
+        || SMR_B(m, &vicii.draw.sbuf_expx_flops) < 0
+        || SMR_B(m, &vicii.draw.sbuf_mc_flops) < 0
+        || SMR_B_INT(m, &vicii.draw.border_state) < 0
+        || SMR_BA(m, vicii.draw.render_buffer, 8) < 0
+        || SMR_BA(m, vicii.draw.pri_buffer, 8) < 0
+        || SMR_BA(m, vicii.draw.pixel_buffer, 8) < 0
+        || SMR_BA(m, vicii.draw.cregs, 0x2f) < 0
+        || SMR_B(m, &vicii.draw.last_color_reg) < 0
+        || SMR_B(m, &vicii.draw.last_color_value) < 0
+        || SMR_DW_UINT(m, &vicii.draw.cycle_flags_pipe) < 0) {
         return -1;
     }
 
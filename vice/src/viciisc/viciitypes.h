@@ -89,6 +89,68 @@ struct vicii_sprite_s {
 };
 typedef struct vicii_sprite_s vicii_sprite_t;
 
+/* State of the pixel pipeline of the cycle based renderer, only used by
+   vicii-draw-cycle.c.  */
+struct vicii_draw_s {
+    /* foreground/background graphics */
+    uint8_t gbuf_pipe0_reg;
+    uint8_t cbuf_pipe0_reg;
+    uint8_t vbuf_pipe0_reg;
+    uint8_t gbuf_pipe1_reg;
+    uint8_t cbuf_pipe1_reg;
+    uint8_t vbuf_pipe1_reg;
+
+    uint8_t xscroll_pipe;
+    uint8_t vmode11_pipe;
+    uint8_t vmode16_pipe;
+    uint8_t vmode16_pipe2;
+
+    /* gbuf shift register */
+    uint8_t gbuf_reg;
+    uint8_t gbuf_mc_flop;
+    uint8_t gbuf_pixel_reg;
+
+    /* cbuf and vbuf registers */
+    uint8_t cbuf_reg;
+    uint8_t vbuf_reg;
+
+    uint8_t dmli;
+
+    /* sprites */
+    int sprite_x_pipe[8];
+    uint8_t sprite_pri_bits;
+    uint8_t sprite_mc_bits;
+    uint8_t sprite_expx_bits;
+
+    uint8_t sprite_pending_bits;
+    uint8_t sprite_active_bits;
+    uint8_t sprite_halt_bits;
+
+    /* sbuf shift registers */
+    uint32_t sbuf_reg[8];
+    uint8_t sbuf_pixel_reg[8];
+    uint8_t sbuf_expx_flops;
+    uint8_t sbuf_mc_flops;
+
+    /* border */
+    int border_state;
+
+    /* pixel buffer */
+    uint8_t render_buffer[8];
+    uint8_t pri_buffer[8];
+
+    uint8_t pixel_buffer[8];
+
+    /* color resolution registers */
+    uint8_t cregs[0x2f];
+    uint8_t last_color_reg;
+    uint8_t last_color_value;
+
+    /* cycle flags of the cycle being drawn */
+    unsigned int cycle_flags_pipe;
+};
+typedef struct vicii_draw_s vicii_draw_t;
+
 struct video_chip_cap_s;
 
 struct vicii_s {
@@ -155,6 +217,9 @@ struct vicii_s {
     /* Draw buffer for a full line (one byte per pixel) */
     uint8_t dbuf[VICII_DRAW_BUFFER_SIZE];
 
+    /* Pixel pipeline state of the renderer */
+    vicii_draw_t draw;
+
     /* parsed vicii register fields */
     unsigned int ysmooth;
 
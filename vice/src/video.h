@@ -114,6 +114,12 @@ struct draw_buffer_s {
     unsigned int visible_width;
     /* Height of the visible subset of draw_buffer, in pixels */
     unsigned int visible_height;
+    /* Set by the arch when the host renderer keeps the last frame, then only the lines that
+    changed since the last refresh are passed to video_canvas_refresh() at the end of a frame */
+    int refresh_changed_lines;
+    /* Set by the arch when the last refresh could not be shown yet, then a frame that did not change
+    is refreshed anyway. Otherwise such frames are not passed to video_canvas_refresh() at all */
+    int refresh_pending;
 };
 typedef struct draw_buffer_s draw_buffer_t;
 
@@ -278,11 +284,25 @@ void video_canvas_map(struct video_canvas_s *canvas);
 void video_canvas_unmap(struct video_canvas_s *canvas);
 void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas);
 void video_canvas_render(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht);
+typedef void (*video_canvas_render_done_t)(struct video_canvas_s *canvas, void *param);
+void video_canvas_render_async(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht,
+                               video_canvas_render_done_t done, void *done_param);
+void video_canvas_render_wait(struct video_canvas_s *canvas);
+bool video_canvas_render_busy(struct video_canvas_s *canvas);
+bool video_canvas_ready_for_frame(struct video_canvas_s *canvas);
 void video_canvas_refresh_all(struct video_canvas_s *canvas);
 char video_canvas_can_resize(struct video_canvas_s *canvas);
 void video_viewport_get(struct video_canvas_s *canvas, struct viewport_s **viewport, struct geometry_s **geometry);
 void video_viewport_resize(struct video_canvas_s *canvas, char resize_canvas);
 
+/* Set while the pixels of the frame being emulated are not drawn */
+extern bool video_pixels_skipped;
+extern bool video_pixels_clipped;
+bool video_pixels_request(void);
+bool video_pixels_can_clip(void);
+void video_pixels_set_clipping(bool allow);
+void video_pixels_set_skipped(bool skip);
+
 struct raster_s;
 
 int video_resources_init(void);
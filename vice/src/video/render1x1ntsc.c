@@ -115,6 +115,10 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
         cbtable = yuvtarget ? color_tab->cutable : color_tab->cbtable;
         crtable = yuvtarget ? color_tab->cvtable : color_tab->crtable;
 
+        /* running sum over the 4 pixel wide chroma window */
+        unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+        vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
+
         /* one scanline */
         for (x = 0; x < width; x++) {
             cl0 = tmpsrc[0];
@@ -123,10 +127,12 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
             cl3 = tmpsrc[3];
             tmpsrc += 1;
             l1 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
+            unew += cbtable[cl3];
+            vnew += crtable[cl3];
             u1 = (unew) * off_flip;
             v1 = (vnew) * off_flip;
+            unew -= cbtable[cl0];
+            vnew -= crtable[cl0];
 
             cl0 = tmpsrc[0];
             cl1 = tmpsrc[1];
@@ -134,10 +140,12 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
             cl3 = tmpsrc[3];
             tmpsrc += 1;
             l2 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
+            unew += cbtable[cl3];
+            vnew += crtable[cl3];
             u2 = (unew) * off_flip;
             v2 = (vnew) * off_flip;
+            unew -= cbtable[cl0];
+            vnew -= crtable[cl0];
 
             store_pixel_4(color_tab, tmptrg, l1, u1, v1, l2, u2, v2);
             tmptrg += pixelstride;
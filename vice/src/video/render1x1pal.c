@@ -111,15 +111,18 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
         crtable = yuvtarget ? color_tab->cvtable_odd : color_tab->crtable_odd;
     }
 
-    /* prepare previous (delay-)line */
+    /* prepare previous (delay-)line, keeping a running sum over the
+       4 pixel wide chroma window */
+    unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+    vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
     for (x = 0; x < width; x++) {
-        cl0 = tmpsrc[0];
-        cl1 = tmpsrc[1];
-        cl2 = tmpsrc[2];
-        cl3 = tmpsrc[3];
-        tmpsrc += 1;
-        line[0] = (cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3]);
-        line[1] = (crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3]);
+        unew += cbtable[tmpsrc[3]];
+        vnew += crtable[tmpsrc[3]];
+        line[0] = unew;
+        line[1] = vnew;
+        unew -= cbtable[tmpsrc[0]];
+        vnew -= crtable[tmpsrc[0]];
+        tmpsrc++;
         line += 2;
     }
 
@@ -144,6 +147,9 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
             crtable = yuvtarget ? color_tab->cvtable : color_tab->crtable;
         }
 
+        unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+        vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
+
         /* one scanline */
         for (x = 0; x < width; x++) {
             cl0 = tmpsrc[0];
@@ -152,13 +158,15 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
             cl3 = tmpsrc[3];
             tmpsrc += 1;
             l1 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
+            unew += cbtable[cl3];
+            vnew += crtable[cl3];
             u1 = (unew + line[0]) * off_flip;
             v1 = (vnew + line[1]) * off_flip;
             line[0] = unew;
             line[1] = vnew;
             line += 2;
+            unew -= cbtable[cl0];
+            vnew -= crtable[cl0];
 
             cl0 = tmpsrc[0];
             cl1 = tmpsrc[1];
@@ -166,13 +174,15 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
             cl3 = tmpsrc[3];
             tmpsrc += 1;
             l2 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
+            unew += cbtable[cl3];
+            vnew += crtable[cl3];
             u2 = (unew + line[0]) * off_flip;
             v2 = (vnew + line[1]) * off_flip;
             line[0] = unew;
             line[1] = vnew;
             line += 2;
+            unew -= cbtable[cl0];
+            vnew -= crtable[cl0];
 
             store_pixel_4(color_tab, tmptrg, l1, u1, v1, l2, u2, v2);
             tmptrg += pixelstride;
@@ -36,9 +36,13 @@
 
 #include "videoarch.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "benchmark.h"
+#include "frametrace.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
@@ -46,6 +50,7 @@
 #include "video-canvas.h"
 #include "video-color.h"
 #include "video-render.h"
+#include "video-sound.h"
 #include "video.h"
 #include "viewport.h"
 
@@ -54,6 +59,35 @@
 /** \brief Used to enable video_canvas_refresh_all_tracked() */
 static video_canvas_t *tracked_canvas[TRACKED_CANVAS_MAX];
 
+/* Canvases rendered with video_canvas_render_async() each get a thread, so
+   the filters of several canvases (like the VDC and VIC-II of x128) run at
+   the same time and off the emulation thread.  A canvas has at most one job:
+   starting the next one, or video_canvas_render_wait(), waits until the
+   previous one is done.  The job renders from a copy of the draw buffer, as
+   the emulation goes on drawing the next frame into it.  */
+typedef struct video_canvas_renderer_s {
+    video_canvas_t *canvas;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int busy;               /* a job is queued or being rendered */
+    int stop;
+
+    uint8_t *src;           /* copy of the draw buffer */
+    size_t src_size;
+    unsigned int pitchs;
+
+    uint8_t *trg;
+    int width, height, xs, ys, xt, yt, pitcht;
+    video_canvas_render_done_t done;
+    void *done_param;
+
+    struct video_canvas_renderer_s *next;
+} video_canvas_renderer_t;
+
+static pthread_mutex_t renderers_lock = PTHREAD_MUTEX_INITIALIZER;
+static video_canvas_renderer_t *renderers = NULL;
+
 /* Temporary! */
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -90,11 +124,15 @@ video_canvas_t *video_canvas_init(void)
     return canvas;
 }
 
+static void video_canvas_renderer_free(video_canvas_t *canvas);
+
 void video_canvas_shutdown(video_canvas_t *canvas)
 {
     int i;
 
     if (canvas != NULL) {
+        video_canvas_renderer_free(canvas);
+
         /* Remove canvas from tracking */
         for (i = 0; i < TRACKED_CANVAS_MAX; i++) {
             if (tracked_canvas[i] == canvas) {
@@ -116,6 +154,8 @@ void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
                          int pitcht)
 {
     viewport_t *viewport = canvas->viewport;
+
+    video_canvas_render_wait(canvas);
 #ifdef VIDEO_SCALE_SOURCE
     xs /= canvas->videoconfig->scalex;
     ys /= canvas->videoconfig->scaley;
@@ -130,12 +170,244 @@ void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
     if (!canvas->videoconfig->color_tables.updated) { /* update colors as necessary */
         video_color_update_palette(canvas);
     }
+    if (width > 0) {
+        video_sound_update(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
+                           width, height, xs, ys,
+                           canvas->draw_buffer->draw_buffer_width, viewport);
+    }
     video_render_main(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
                       trg, width, height, xs, ys, xt, yt,
                       canvas->draw_buffer->draw_buffer_width, pitcht,
                       viewport);
 }
 
+static void *video_canvas_renderer_main(void *data)
+{
+    video_canvas_renderer_t *r = data;
+
+    pthread_mutex_lock(&r->lock);
+    while (1) {
+        while (!r->busy && !r->stop) {
+            pthread_cond_wait(&r->cond, &r->lock);
+        }
+        if (!r->busy) {
+            break;
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        video_render_main(r->canvas->videoconfig, r->src, r->trg,
+                          r->width, r->height, r->xs, r->ys, r->xt, r->yt,
+                          r->pitchs, r->pitcht, r->canvas->viewport);
+        if (r->done != NULL) {
+            r->done(r->canvas, r->done_param);
+        }
+
+        pthread_mutex_lock(&r->lock);
+        r->busy = 0;
+        pthread_cond_broadcast(&r->cond);
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    return NULL;
+}
+
+static video_canvas_renderer_t *video_canvas_renderer_find(video_canvas_t *canvas)
+{
+    video_canvas_renderer_t *r;
+
+    pthread_mutex_lock(&renderers_lock);
+    for (r = renderers; r != NULL; r = r->next) {
+        if (r->canvas == canvas) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&renderers_lock);
+
+    return r;
+}
+
+static video_canvas_renderer_t *video_canvas_renderer_get(video_canvas_t *canvas)
+{
+    video_canvas_renderer_t *r = video_canvas_renderer_find(canvas);
+
+    if (r != NULL) {
+        return r;
+    }
+
+    r = lib_calloc(1, sizeof(video_canvas_renderer_t));
+    r->canvas = canvas;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if (pthread_create(&r->thread, NULL, video_canvas_renderer_main, r)) {
+        log_error(LOG_DEFAULT, "Cannot start render thread of canvas, rendering directly.");
+        pthread_cond_destroy(&r->cond);
+        pthread_mutex_destroy(&r->lock);
+        lib_free(r);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&renderers_lock);
+    r->next = renderers;
+    renderers = r;
+    pthread_mutex_unlock(&renderers_lock);
+
+    return r;
+}
+
+static void video_canvas_renderer_free(video_canvas_t *canvas)
+{
+    video_canvas_renderer_t *r, **prev;
+
+    pthread_mutex_lock(&renderers_lock);
+    for (prev = &renderers; *prev != NULL; prev = &(*prev)->next) {
+        if ((*prev)->canvas == canvas) {
+            break;
+        }
+    }
+    r = *prev;
+    if (r != NULL) {
+        *prev = r->next;
+    }
+    pthread_mutex_unlock(&renderers_lock);
+
+    if (r == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+
+    pthread_cond_destroy(&r->cond);
+    pthread_mutex_destroy(&r->lock);
+    lib_free(r->src);
+    lib_free(r);
+}
+
+/** \brief  Wait until the job of a canvas started by
+ *          video_canvas_render_async() is done
+ *
+ * \param[in]   canvas  canvas
+ */
+void video_canvas_render_wait(video_canvas_t *canvas)
+{
+    video_canvas_renderer_t *r = video_canvas_renderer_find(canvas);
+
+    if (r == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&r->lock);
+    while (r->busy) {
+        pthread_cond_wait(&r->cond, &r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+/** \brief  Check if a job started by video_canvas_render_async() is still
+ *          running
+ *
+ * \param[in]   canvas  canvas
+ *
+ * \return  true if the thread of the canvas is still rendering
+ */
+bool video_canvas_render_busy(video_canvas_t *canvas)
+{
+    video_canvas_renderer_t *r = video_canvas_renderer_find(canvas);
+    bool busy;
+
+    if (r == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&r->lock);
+    busy = r->busy != 0;
+    pthread_mutex_unlock(&r->lock);
+
+    return busy;
+}
+
+/** \brief  Render on the thread of the canvas
+ *
+ * Like video_canvas_render(), but the filters run on a thread of the canvas
+ * and \a done is called on that thread when they are.  \a trg must stay
+ * valid until then.  If the thread cannot be started, this renders and calls
+ * \a done right away.
+ *
+ * \param[in]   canvas      canvas
+ * \param[in]   done        called when the frame is rendered, may be NULL
+ * \param[in]   done_param  passed to \a done
+ */
+void video_canvas_render_async(video_canvas_t *canvas, uint8_t *trg,
+                               int width, int height, int xs, int ys,
+                               int xt, int yt, int pitcht,
+                               video_canvas_render_done_t done,
+                               void *done_param)
+{
+    video_canvas_renderer_t *r = video_canvas_renderer_get(canvas);
+    viewport_t *viewport = canvas->viewport;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    size_t size;
+
+    if (r == NULL) {
+        video_canvas_render(canvas, trg, width, height, xs, ys, xt, yt, pitcht);
+        if (done != NULL) {
+            done(canvas, done_param);
+        }
+        return;
+    }
+
+    video_canvas_render_wait(canvas);
+
+    /* what video_canvas_render() does before the filters stays on this
+       thread, the palette and the sound of the video chip are not safe to
+       change from another one */
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= canvas->videoconfig->scalex;
+    ys /= canvas->videoconfig->scaley;
+#endif
+    if (viewport->crt_type != canvas->crt_type) {
+        canvas->videoconfig->color_tables.updated = 0;
+        canvas->crt_type = viewport->crt_type;
+    }
+    if (!canvas->videoconfig->color_tables.updated) {
+        video_color_update_palette(canvas);
+    }
+    if (width > 0) {
+        video_sound_update(canvas->videoconfig, draw_buffer->draw_buffer,
+                           width, height, xs, ys,
+                           draw_buffer->draw_buffer_width, viewport);
+    }
+
+    /* filters read the lines around the ones rendered, copy all of it */
+    size = (size_t)draw_buffer->draw_buffer_width * draw_buffer->draw_buffer_height;
+    if (r->src_size != size) {
+        lib_free(r->src);
+        r->src = lib_malloc(size);
+        r->src_size = size;
+    }
+    memcpy(r->src, draw_buffer->draw_buffer, size);
+    r->pitchs = draw_buffer->draw_buffer_width;
+
+    r->trg = trg;
+    r->width = width;
+    r->height = height;
+    r->xs = xs;
+    r->ys = ys;
+    r->xt = xt;
+    r->yt = yt;
+    r->pitcht = pitcht;
+    r->done = done;
+    r->done_param = done_param;
+
+    pthread_mutex_lock(&r->lock);
+    r->busy = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
 /** \brief Force refresh all tracked canvases.
  *
  * Added to enable visible updates each time the monitor
@@ -152,10 +424,79 @@ void video_canvas_refresh_all_tracked(void)
     }
 }
 
+/* Set while the pixels of the frame being emulated are not drawn */
+bool video_pixels_skipped = false;
+
+/* The pixels of the last complete frame were not drawn */
+static bool last_frame_skipped = false;
+
+/* Someone asked for the pixels, draw them from now on */
+static bool pixels_requested = false;
+
+/* Parts of the last frame outside the viewport were not drawn */
+bool video_pixels_clipped = false;
+
+/* The arch code allows leaving out the pixels outside the viewport */
+static bool clipping_allowed = true;
+
+/** \brief  Ask for the pixels of the frames to be drawn
+ *
+ * Used by everything that reads the draw buffer, like screenshots.  Once
+ * asked for, the pixels are drawn until the emulator exits.
+ *
+ * \return  true if the pixels of the last frame are in the draw buffer,
+ *          false if they were skipped or clipped and the draw buffer holds
+ *          (parts of) an older frame
+ */
+bool video_pixels_request(void)
+{
+    pixels_requested = true;
+    return !last_frame_skipped && !video_pixels_clipped;
+}
+
+/** \brief  Check whether the pixels outside the viewport may be left out
+ *
+ * The chips only leave out border pixels and lines nobody would see.  Like
+ * skipping, this ends once something asked for the pixels.
+ *
+ * \return  true if the viewport may be used to clip the drawing
+ */
+bool video_pixels_can_clip(void)
+{
+    return clipping_allowed && !pixels_requested;
+}
+
+/** \brief  Allow or forbid leaving out the pixels outside the viewport
+ *
+ * For arch code that reads the whole draw buffer at times, like the exit
+ * screenshot of the headless UI.  Clipping is allowed by default.
+ *
+ * \param[in]   allow   nothing reads the pixels outside the viewport
+ */
+void video_pixels_set_clipping(bool allow)
+{
+    clipping_allowed = allow;
+}
+
+/** \brief  Decide whether the pixels of the next frame are drawn
+ *
+ * Called by the arch code at the end of every frame.  The chips still
+ * emulate every cycle of a skipped frame, they only leave out what does
+ * nothing but generate pixels.
+ *
+ * \param[in]   skip    nothing would show the next frame
+ */
+void video_pixels_set_skipped(bool skip)
+{
+    last_frame_skipped = video_pixels_skipped;
+    video_pixels_skipped = skip && !pixels_requested;
+}
+
 void video_canvas_refresh_all(video_canvas_t *canvas)
 {
     viewport_t *viewport;
     geometry_t *geometry;
+    uint64_t bench_start;
 
     if (video_disabled_mode) {
         return;
@@ -164,6 +505,8 @@ void video_canvas_refresh_all(video_canvas_t *canvas)
     viewport = canvas->viewport;
     geometry = canvas->geometry;
 
+    FRAMETRACE_BEGIN(FRAMETRACE_RENDER);
+    BENCHMARK_BEGIN(bench_start);
     video_canvas_refresh(canvas,
                          viewport->first_x
                          + geometry->extra_offscreen_border_left,
@@ -174,6 +517,8 @@ void video_canvas_refresh_all(video_canvas_t *canvas)
                              geometry->screen_size.width - viewport->first_x),
                          MIN(canvas->draw_buffer->canvas_height,
                              viewport->last_line - viewport->first_line + 1));
+    BENCHMARK_END(BENCHMARK_RENDER, bench_start);
+    FRAMETRACE_END(FRAMETRACE_RENDER);
 }
 
 int video_canvas_palette_set(struct video_canvas_s *canvas,
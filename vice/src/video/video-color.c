@@ -40,6 +40,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>       /* needed for pow function */
 
 #include "videoarch.h"
@@ -489,14 +490,54 @@ static float video_get_gamma(video_resources_t *video_resources, int video)
     return ((float)(video_resources->color_gamma)) / 1000.0f;
 }
 
-/* gammatable calculation */
-static void video_calc_gammatable(video_render_color_tables_t *color_tab, video_resources_t *video_resources, int video)
+/* The gamma curve only depends on brightness, contrast, gamma and scanline
+   shade, not on the RGB values of the canvas, so the indices it yields are
+   kept for the last few settings and shared by all canvases.  Changing any
+   other color setting then only looks them up instead of doing ~2300 pow()
+   calls.  */
+#define GAMMA_CURVE_CACHE_SIZE  4
+
+typedef struct video_gamma_curve_s {
+    int valid;
+    int brightness;
+    int contrast;
+    int gamma;
+    int scanlineshade;
+    uint8_t index[256 * 3];
+    uint8_t index_fac[256 * 3 * 2];
+} video_gamma_curve_t;
+
+static video_gamma_curve_t gamma_curve_cache[GAMMA_CURVE_CACHE_SIZE];
+static unsigned int gamma_curve_next = 0;
+
+static uint8_t video_gamma_index(float v)
 {
+    uint32_t vi = (uint32_t)v;
+
+    return (uint8_t)(vi > 255 ? 255 : vi);
+}
+
+static const video_gamma_curve_t *video_get_gamma_curve(video_resources_t *video_resources, int video)
+{
+    video_gamma_curve_t *curve;
     int i;
     float bri, con, gam, scn, v;
     double factor;
-    uint32_t vi;
-    DBG(("video_calc_gammatable"));
+
+    for (i = 0; i < GAMMA_CURVE_CACHE_SIZE; i++) {
+        curve = &gamma_curve_cache[i];
+        if (curve->valid
+            && curve->brightness == video_resources->color_brightness
+            && curve->contrast == video_resources->color_contrast
+            && curve->gamma == video_resources->color_gamma
+            && curve->scanlineshade == video_resources->pal_scanlineshade) {
+            return curve;
+        }
+    }
+
+    curve = &gamma_curve_cache[gamma_curve_next];
+    gamma_curve_next = (gamma_curve_next + 1) % GAMMA_CURVE_CACHE_SIZE;
+
 #ifdef DEBUG_NEUTRAL_SETTINGS
     scn = 1.0;
     bri = 0.0;
@@ -513,30 +554,42 @@ static void video_calc_gammatable(video_render_color_tables_t *color_tab, video_
     DBG((" bri:%f con:%f gam:%f scn:%f", bri, con, gam, scn));
     for (i = 0; i < (256 * 3); i++) {
         v = video_gamma((float)(i - 256), factor, gam, bri, con);
+        curve->index[i] = video_gamma_index(v);
+        curve->index_fac[i * 2] = video_gamma_index(v * scn);
+        v = video_gamma((float)(i - 256) + 0.5f, factor, gam, bri, con);
+        curve->index_fac[i * 2 + 1] = video_gamma_index(v * scn);
+    }
 
-        vi = (uint32_t)v;
-        if (vi > 255) {
-            vi = 255;
-        }
+    curve->brightness = video_resources->color_brightness;
+    curve->contrast = video_resources->color_contrast;
+    curve->gamma = video_resources->color_gamma;
+    curve->scanlineshade = video_resources->pal_scanlineshade;
+    curve->valid = 1;
+
+    return curve;
+}
+
+/* gammatable calculation */
+static void video_calc_gammatable(video_render_color_tables_t *color_tab, video_resources_t *video_resources, int video)
+{
+    const video_gamma_curve_t *curve;
+    int i;
+    uint8_t vi;
+    DBG(("video_calc_gammatable"));
+
+    curve = video_get_gamma_curve(video_resources, video);
+
+    for (i = 0; i < (256 * 3); i++) {
+        vi = curve->index[i];
         color_tab->gamma_red[i] = color_tab->color_red[vi];
         color_tab->gamma_grn[i] = color_tab->color_grn[vi];
         color_tab->gamma_blu[i] = color_tab->color_blu[vi];
-
-        vi = (uint32_t)(v * scn);
-        if (vi > 255) {
-            vi = 255;
-        }
-        color_tab->gamma_red_fac[i * 2] = color_tab->color_red[vi];
-        color_tab->gamma_grn_fac[i * 2] = color_tab->color_grn[vi];
-        color_tab->gamma_blu_fac[i * 2] = color_tab->color_blu[vi];
-        v = video_gamma((float)(i - 256) + 0.5f, factor, gam, bri, con);
-        vi = (uint32_t)(v * scn);
-        if (vi > 255) {
-            vi = 255;
-        }
-        color_tab->gamma_red_fac[i * 2 + 1] = color_tab->color_red[vi];
-        color_tab->gamma_grn_fac[i * 2 + 1] = color_tab->color_grn[vi];
-        color_tab->gamma_blu_fac[i * 2 + 1] = color_tab->color_blu[vi];
+    }
+    for (i = 0; i < (256 * 3 * 2); i++) {
+        vi = curve->index_fac[i];
+        color_tab->gamma_red_fac[i] = color_tab->color_red[vi];
+        color_tab->gamma_grn_fac[i] = color_tab->color_grn[vi];
+        color_tab->gamma_blu_fac[i] = color_tab->color_blu[vi];
     }
 }
 
@@ -863,11 +916,51 @@ static palette_t *video_calc_palette(struct video_canvas_s *canvas, const video_
     return prgb;
 }
 
+/* Palette files that were loaded already, so changing the color settings of
+   a canvas using one does not read the file again.  The cache is flushed
+   when a palette file is selected, so an edited file can be reloaded.  */
+typedef struct video_palette_cache_s {
+    char *name;
+    char *subpath;
+    palette_t *palette;
+    struct video_palette_cache_s *next;
+} video_palette_cache_t;
+
+static video_palette_cache_t *palette_cache = NULL;
+
+/** \brief  Forget all cached palette files
+ */
+void video_color_palette_cache_flush(void)
+{
+    video_palette_cache_t *next;
+
+    while (palette_cache != NULL) {
+        next = palette_cache->next;
+        lib_free(palette_cache->name);
+        lib_free(palette_cache->subpath);
+        palette_free(palette_cache->palette);
+        lib_free(palette_cache);
+        palette_cache = next;
+    }
+}
+
+static void video_copy_palette_rgb(palette_t *dst, const palette_t *src)
+{
+    unsigned int i;
+
+    for (i = 0; i < dst->num_entries; i++) {
+        dst->entries[i].red = src->entries[i].red;
+        dst->entries[i].green = src->entries[i].green;
+        dst->entries[i].blue = src->entries[i].blue;
+    }
+}
+
 /* Load RGB palette.  */
 static palette_t *video_load_palette(const video_cbm_palette_t *p,
                                      const char *name)
 {
     palette_t *palette;
+    video_palette_cache_t *cached;
 
     palette = palette_create(p->num_entries, NULL);
 
@@ -875,12 +968,33 @@ static palette_t *video_load_palette(const video_cbm_palette_t *p,
         return NULL;
     }
 
-    if (!video_disabled_mode && palette_load(name, machine_name, palette) < 0) {
+    if (video_disabled_mode) {
+        return palette;
+    }
+
+    for (cached = palette_cache; cached != NULL; cached = cached->next) {
+        if (cached->palette->num_entries == p->num_entries
+            && strcmp(cached->name, name) == 0
+            && strcmp(cached->subpath, machine_name) == 0) {
+            video_copy_palette_rgb(palette, cached->palette);
+            return palette;
+        }
+    }
+
+    if (palette_load(name, machine_name, palette) < 0) {
         /* log_message(vicii.log, "Cannot load palette file `%s'.", name); */
         palette_free(palette);
         return NULL;
     }
 
+    cached = lib_malloc(sizeof(video_palette_cache_t));
+    cached->name = lib_strdup(name);
+    cached->subpath = lib_strdup(machine_name);
+    cached->palette = palette_create(p->num_entries, NULL);
+    video_copy_palette_rgb(cached->palette, palette);
+    cached->next = palette_cache;
+    palette_cache = cached;
+
     return palette;
 }
 
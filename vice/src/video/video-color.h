@@ -31,5 +31,6 @@
 #include "types.h"
 
 void video_color_palette_free(struct palette_s *palette);
+void video_color_palette_cache_flush(void);
 
 #endif
@@ -107,8 +107,9 @@ void video_render_crt_mono_main(video_render_config_t *config,
             break;
         case VIDEO_RENDER_CRT_MONO_2X2:
             if (scale2x) {
-                render_32_scale2x(colortab, src, trg, width, height,
-                                  xs, ys, xt, yt, pitchs, pitcht);
+                video_render_tiled(render_32_scale2x, 2, colortab, src, trg,
+                                   width, height, xs, ys, xt, yt,
+                                   pitchs, pitcht);
                 return;
             } else if (crtemulation) {
                 /* FIXME: open end, this should use a dedicated monochrome CRT renderer */
@@ -123,8 +123,9 @@ void video_render_pal_ntsc_main(video_render_config_t *config,
                         return;
                 }
             } else if (scale2x) {
-                render_32_scale2x(colortab, src, trg, width, height,
-                                  xs, ys, xt, yt, pitchs, pitcht);
+                video_render_tiled(render_32_scale2x, 2, colortab, src, trg,
+                                   width, height, xs, ys, xt, yt,
+                                   pitchs, pitcht);
                 return;
             } else {
                 render_32_2x2(colortab, src, trg, width, height,
@@ -105,8 +105,9 @@ void video_render_rgbi_main(video_render_config_t *config,
             break;
         case VIDEO_RENDER_RGBI_2X2:
             if (scale2x) {
-                render_32_scale2x(colortab, src, trg, width, height,
-                                  xs, ys, xt, yt, pitchs, pitcht);
+                video_render_tiled(render_32_scale2x, 2, colortab, src, trg,
+                                   width, height, xs, ys, xt, yt,
+                                   pitchs, pitcht);
                 return;
             } else if (crtemulation) {
                 render_32_2x2_rgbi(colortab, src, trg, width, height,
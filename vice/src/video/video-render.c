@@ -27,12 +27,13 @@
 
 #include "vice.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include "log.h"
 #include "types.h"
 #include "video-render.h"
-#include "video-sound.h"
 #include "video.h"
 
 static render_pal_ntsc_func_t  render_pal_ntsc_func  = video_render_pal_ntsc_main;
@@ -69,6 +70,193 @@ void video_render_setphysicalcolor(video_render_config_t *config, int index,
     config->color_tables.physical_colors[index] = color;
 }
 
+/* Tiled rendering
+
+   Renderers of which every target line only depends on the source (like
+   scale2x) can have the frame split into horizontal bands, which are
+   rendered by a pool of worker threads and the calling thread together.
+   The call returns when all bands are done, so for the caller nothing
+   changes except the time it takes.  */
+
+/* Bands are not made smaller than this many target lines.  */
+#define RENDER_BAND_MIN_LINES   32
+
+/* Upper limit of threads rendering a frame, including the caller.  */
+#define RENDER_MAX_THREADS      8
+
+typedef struct render_tiled_job_s {
+    render_band_func_t func;
+    unsigned int scale;
+    const video_render_color_tables_t *color_tab;
+    const uint8_t *src;
+    uint8_t *trg;
+    unsigned int width, height;
+    unsigned int xs, ys, xt, yt;
+    unsigned int pitchs, pitcht;
+
+    unsigned int band_height;
+    unsigned int bands;
+    /* next band to be taken by a thread */
+    unsigned int next_band;
+    unsigned int bands_done;
+} render_tiled_job_t;
+
+/* only one frame is rendered tiled at a time */
+static pthread_mutex_t render_tiled_call_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t render_tiled_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when bands of a new frame can be taken */
+static pthread_cond_t render_tiled_start = PTHREAD_COND_INITIALIZER;
+/* signalled when the last band of a frame is done */
+static pthread_cond_t render_tiled_done = PTHREAD_COND_INITIALIZER;
+
+static render_tiled_job_t render_tiled_job;
+
+/* number of threads rendering a frame including the caller, 0 before the
+   workers were started */
+static unsigned int render_tiled_threads = 0;
+
+static void render_tiled_band(const render_tiled_job_t *job, unsigned int band)
+{
+    unsigned int first = band * job->band_height;
+    unsigned int lines = job->height - first;
+    unsigned int phase = job->yt % job->scale;
+
+    if (lines > job->band_height) {
+        lines = job->band_height;
+    }
+
+    /* `scale' target lines are made of one source line, starting at the
+       phase the first target line has */
+    job->func(job->color_tab, job->src, job->trg, job->width, lines,
+              job->xs, job->ys + (phase + first) / job->scale,
+              job->xt, job->yt + first, job->pitchs, job->pitcht);
+}
+
+/* Take and render bands of the current frame until none are left.  Called
+   with the lock held.  */
+static void render_tiled_run(void)
+{
+    unsigned int band;
+
+    while (render_tiled_job.next_band < render_tiled_job.bands) {
+        band = render_tiled_job.next_band++;
+        pthread_mutex_unlock(&render_tiled_lock);
+
+        render_tiled_band(&render_tiled_job, band);
+
+        pthread_mutex_lock(&render_tiled_lock);
+        if (++render_tiled_job.bands_done == render_tiled_job.bands) {
+            pthread_cond_signal(&render_tiled_done);
+        }
+    }
+}
+
+static void *render_tiled_worker(void *unused)
+{
+    pthread_mutex_lock(&render_tiled_lock);
+    while (1) {
+        while (render_tiled_job.next_band >= render_tiled_job.bands) {
+            pthread_cond_wait(&render_tiled_start, &render_tiled_lock);
+        }
+        render_tiled_run();
+    }
+
+    return NULL;
+}
+
+static void render_tiled_start_workers(void)
+{
+    long cpus = 1;
+    unsigned int i;
+    pthread_t thread;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (cpus < 1) {
+        cpus = 1;
+    } else if (cpus > RENDER_MAX_THREADS) {
+        cpus = RENDER_MAX_THREADS;
+    }
+
+    render_tiled_threads = 1;
+    for (i = 1; i < (unsigned int)cpus; i++) {
+        if (pthread_create(&thread, NULL, render_tiled_worker, NULL)) {
+            log_error(LOG_DEFAULT, "Cannot start render thread, using %u.",
+                      render_tiled_threads);
+            break;
+        }
+        pthread_detach(thread);
+        render_tiled_threads++;
+    }
+}
+
+/** \brief  Render a frame in bands on several threads
+ *
+ * Takes the same arguments as the renderer \a func, plus the number of
+ * target lines made of one source line.
+ *
+ * \param[in]   func    renderer, called with parts of the frame
+ * \param[in]   scale   target lines per source line of \a func
+ */
+void video_render_tiled(render_band_func_t func, unsigned int scale,
+                        const video_render_color_tables_t *color_tab,
+                        const uint8_t *src, uint8_t *trg,
+                        unsigned int width, const unsigned int height,
+                        const unsigned int xs, const unsigned int ys,
+                        const unsigned int xt, const unsigned int yt,
+                        const unsigned int pitchs, const unsigned int pitcht)
+{
+    unsigned int bands;
+
+    pthread_mutex_lock(&render_tiled_call_lock);
+
+    if (render_tiled_threads == 0) {
+        render_tiled_start_workers();
+    }
+
+    bands = height / RENDER_BAND_MIN_LINES;
+    if (bands > render_tiled_threads) {
+        bands = render_tiled_threads;
+    }
+
+    if (bands <= 1) {
+        pthread_mutex_unlock(&render_tiled_call_lock);
+        func(color_tab, src, trg, width, height, xs, ys, xt, yt, pitchs, pitcht);
+        return;
+    }
+
+    pthread_mutex_lock(&render_tiled_lock);
+
+    render_tiled_job.func = func;
+    render_tiled_job.scale = scale;
+    render_tiled_job.color_tab = color_tab;
+    render_tiled_job.src = src;
+    render_tiled_job.trg = trg;
+    render_tiled_job.width = width;
+    render_tiled_job.height = height;
+    render_tiled_job.xs = xs;
+    render_tiled_job.ys = ys;
+    render_tiled_job.xt = xt;
+    render_tiled_job.yt = yt;
+    render_tiled_job.pitchs = pitchs;
+    render_tiled_job.pitcht = pitcht;
+    render_tiled_job.band_height = (height + bands - 1) / bands;
+    render_tiled_job.bands = bands;
+    render_tiled_job.next_band = 0;
+    render_tiled_job.bands_done = 0;
+
+    pthread_cond_broadcast(&render_tiled_start);
+    render_tiled_run();
+    while (render_tiled_job.bands_done < render_tiled_job.bands) {
+        pthread_cond_wait(&render_tiled_done, &render_tiled_lock);
+    }
+
+    pthread_mutex_unlock(&render_tiled_lock);
+    pthread_mutex_unlock(&render_tiled_call_lock);
+}
+
 static int rendermode_error = -1;
 
 void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg,
@@ -86,8 +274,6 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
         return; /* some render routines don't like invalid width */
     }
 
-    video_sound_update(config, src, width, height, xs, ys, pitchs, viewport);
-
     rendermode = config->rendermode;
 
     switch (rendermode) {
@@ -51,12 +51,28 @@ typedef void (*render_crt_mono_func_t)(video_render_config_t *, uint8_t *, uint8
                                   int, int, int, int,
                                   unsigned int, unsigned int);
 
+/* Renderer that can be called with any part of the target lines, see
+   video_render_tiled() */
+typedef void (*render_band_func_t)(const video_render_color_tables_t *,
+                                   const uint8_t *, uint8_t *,
+                                   unsigned int, const unsigned int,
+                                   const unsigned int, const unsigned int,
+                                   const unsigned int, const unsigned int,
+                                   const unsigned int, const unsigned int);
+
 void video_render_main(struct video_render_config_s *config, uint8_t *src,
                        uint8_t *trg, int width, int height,
                        int xs, int ys, int xt, int yt,
                        int pitchs, int pitcht,
                        viewport_t *viewport);
 void video_render_update_palette(struct video_canvas_s *canvas);
+void video_render_tiled(render_band_func_t func, unsigned int scale,
+                        const video_render_color_tables_t *color_tab,
+                        const uint8_t *src, uint8_t *trg,
+                        unsigned int width, const unsigned int height,
+                        const unsigned int xs, const unsigned int ys,
+                        const unsigned int xt, const unsigned int yt,
+                        const unsigned int pitchs, const unsigned int pitcht);
 
 void video_render_palntscfunc_set(render_pal_ntsc_func_t func);
 void video_render_crtmonofunc_set(render_crt_mono_func_t func);
@@ -62,6 +62,7 @@ int video_resources_init(void)
 
 void video_resources_shutdown(void)
 {
+    video_color_palette_cache_flush();
     video_arch_resources_shutdown();
 }
 
@@ -375,6 +376,7 @@ static int set_palette_file_name(const char *filename, void *canvas)
     video_canvas_t *cv = canvas;
 
     util_string_set(&(cv->videoconfig->external_palette_name), filename);
+    video_color_palette_cache_flush();
     cv->videoconfig->color_tables.updated = 0;
     return 0;
 }
@@ -42,6 +42,7 @@
 
 /* Port me... */
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -50,22 +51,34 @@
 #endif
 
 #include "archdep.h"
+#include "benchmark.h"
 #include "cmdline.h"
 #include "debug.h"
+#include "fastpoweron.h"
+#include "frametrace.h"
+#include "init.h"
+#include "interrupt.h"
 #include "joystick.h"
 #include "kbdbuf.h"
 #include "lib.h"
+#include "metrics.h"
 #include "log.h"
 #include "maincpu.h"
 #include "machine.h"
+#include "monitor.h"
 #ifdef HAVE_NETWORK
 #include "monitor_network.h"
 #include "monitor_binary.h"
 #endif
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
+#include "rtc.h"
+#include "snapshot.h"
 #include "sound.h"
+#include "testrunner.h"
 #include "types.h"
+#include "vice-event.h"
 #include "videoarch.h"
 #include "vsync.h"
 #include "vsyncapi.h"
@@ -80,15 +93,38 @@
 static double vsync_metric_cpu_percent;
 static double vsync_metric_emulated_fps;
 
-#ifdef USE_VICE_THREAD
-#   include <pthread.h>
-    pthread_mutex_t vsync_metric_lock = PTHREAD_MUTEX_INITIALIZER;
-#   define METRIC_LOCK() pthread_mutex_lock(&vsync_metric_lock)
-#   define METRIC_UNLOCK() pthread_mutex_unlock(&vsync_metric_lock)
-#else
-#   define METRIC_LOCK()
-#   define METRIC_UNLOCK()
-#endif
+/* public pacing metrics, updated after each paced sleep */
+static double vsync_metric_jitter_us;
+static double vsync_metric_jitter_peak_us;
+
+/* The metrics are written by the emulation thread only and read by the UI
+   many times a second, so they are published with a sequence count instead
+   of a lock: the writer keeps it odd while it updates them, and a reader
+   tries again if it was odd or changed while it copied them.  Neither side
+   ever waits for the other.  */
+static atomic_uint vsync_metric_seq;
+
+static void metric_write_begin(void)
+{
+    atomic_fetch_add_explicit(&vsync_metric_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void metric_write_end(void)
+{
+    atomic_fetch_add_explicit(&vsync_metric_seq, 1, memory_order_release);
+}
+
+static unsigned int metric_read_begin(void)
+{
+    return atomic_load_explicit(&vsync_metric_seq, memory_order_acquire);
+}
+
+static int metric_read_retry(unsigned int seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return (seq & 1) || seq != atomic_load_explicit(&vsync_metric_seq, memory_order_relaxed);
+}
 
 log_t vsync_log = LOG_DEFAULT;
 
@@ -152,6 +188,24 @@ static int relative_speed;
 /* "Warp mode".  If nonzero, attempt to run as fast as possible. */
 static int warp_enabled;
 
+/* "Offline mode".  If nonzero, run as fast as possible without showing any
+   frames but keep every sound sample, for rendering to a file. */
+static int offline_enabled;
+
+/* "Unpaced mode".  If nonzero, run as fast as possible but still show the
+   frames, used while the monitor runs the machine for a given budget. */
+static int unpaced_enabled;
+
+/* "Deterministic" resource.  If nonzero, nothing the emulation sees depends
+   on the host clock: it runs as fast as possible, the clocks of the machine
+   run on emulated time and the random numbers always start from the same
+   seed, so that the same run gives the same results every time. */
+static int deterministic_enabled;
+
+/* Seed of the random numbers in deterministic mode, unless "-seed" is given
+   after "-deterministic". */
+#define DETERMINISTIC_SEED  0x56494345
+
 /* "InitialWarpMode" resource controlling whether warp should be enabled from launch. */
 static int initial_warp_mode_resource;
 
@@ -182,7 +236,7 @@ void vsync_set_warp_mode(int val)
 {
     warp_enabled = val ? 1 : 0;
 
-    sound_set_warp_mode(warp_enabled);
+    sound_set_warp_mode(warp_enabled || unpaced_enabled);
     vsync_suspend_speed_eval();
 
     update_thread_priority = 1;
@@ -193,6 +247,35 @@ int vsync_get_warp_mode(void)
     return warp_enabled;
 }
 
+void vsync_set_offline_mode(int val)
+{
+    offline_enabled = val ? 1 : 0;
+
+    vsync_suspend_speed_eval();
+}
+
+void vsync_set_unpaced_mode(int val)
+{
+    unpaced_enabled = val ? 1 : 0;
+
+    sound_set_warp_mode(warp_enabled || unpaced_enabled);
+    vsync_suspend_speed_eval();
+}
+
+static int set_deterministic(int val, void *param)
+{
+    deterministic_enabled = val ? 1 : 0;
+
+    rtc_set_emulated_time(deterministic_enabled);
+    sound_set_unpaced_output(deterministic_enabled);
+    if (deterministic_enabled) {
+        lib_rand_seed(DETERMINISTIC_SEED);
+    }
+    vsync_suspend_speed_eval();
+
+    return 0;
+}
+
 static int set_initial_warp_mode_resource(int val, void *param)
 {
     initial_warp_mode_resource = val ? 1 : 0;
@@ -200,6 +283,181 @@ static int set_initial_warp_mode_resource(int val, void *param)
     return 0;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Run-ahead: at the end of each frame the machine state is saved to memory,
+   "RunAhead" frames are emulated with the current input and only the last of
+   those is shown, then the state is restored and the next frame is emulated
+   for real. This hides the input lag of games that react a frame or more
+   after reading the controls. */
+
+#define RUNAHEAD_MAX_FRAMES 4
+
+/* "RunAhead" resource, number of frames to run ahead (0 = off) */
+static int runahead_frames;
+
+/* Machine state at the start of the current run-ahead cycle */
+static snapshot_memory_t *runahead_snapshot = NULL;
+
+/* Flag: a run-ahead cycle is in progress, real frames are not displayed */
+static int runahead_active = 0;
+
+/* Number of ahead frames left to emulate, 0 while emulating a real frame */
+static int runahead_ahead_left = 0;
+
+static int set_runahead_frames(int val, void *param)
+{
+    if (val < 0 || val > RUNAHEAD_MAX_FRAMES) {
+        return -1;
+    }
+
+    runahead_frames = val;
+
+    return 0;
+}
+
+/* Whether a new run-ahead cycle may be started at this vsync */
+static bool runahead_possible(void)
+{
+    return runahead_frames > 0
+           && machine_class != VICE_MACHINE_VSID
+           && !warp_enabled
+           && !unpaced_enabled
+           && !network_connected()
+           && !event_record_active()
+           && !event_playback_active()
+           && !monitor_is_inside_monitor();
+}
+
+static void runahead_save_trap(uint16_t addr, void *data)
+{
+    int err;
+
+    /* get rid of the sound of the real frame before it is rewound to */
+    sound_flush();
+
+    if (runahead_snapshot == NULL) {
+        runahead_snapshot = snapshot_memory_new();
+    }
+
+    snapshot_memory_redirect(runahead_snapshot);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_redirect(NULL);
+
+    if (err < 0) {
+        log_error(vsync_log, "Run-ahead: cannot save the machine state, disabling run-ahead.");
+        runahead_frames = 0;
+        runahead_active = 0;
+        return;
+    }
+
+    runahead_active = 1;
+    runahead_ahead_left = runahead_frames;
+}
+
+static void runahead_restore_trap(uint16_t addr, void *data)
+{
+    int err;
+
+    /* the ahead frames are never heard */
+    sound_discard();
+
+    err = rewind_read_memory_snapshot(runahead_snapshot);
+
+    runahead_ahead_left = 0;
+
+    if (err < 0) {
+        log_error(vsync_log, "Run-ahead: cannot restore the machine state, disabling run-ahead.");
+        runahead_frames = 0;
+        runahead_active = 0;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Precise pacing.  Host sleeps overshoot, by a millisecond or two with the
+   default timer slack on Linux and on Windows, which is enough to miss a
+   frame now and then.  So the sleep until the emulation is due ends early
+   by the oversleep measured on this host, and the rest of the wait spins on
+   tick_now().  The oversleep estimate follows longer oversleeps quickly and
+   shorter ones slowly, so an idle host settles at a short spin.  */
+
+#define PACING_SPIN_START_TICKS (tick_per_second() / 2000)     /* 500 us */
+#define PACING_SPIN_MIN_TICKS   (tick_per_second() / 20000)    /* 50 us */
+#define PACING_SPIN_MAX_TICKS   (tick_per_second() / 250)      /* 4 ms */
+
+/* "PrecisePacing" resource */
+static int precise_pacing_enabled;
+
+/* measured oversleep of the host, how long to spin */
+static double pacing_spin_ticks = -1.0;
+
+/* how late the waits ended, smoothed and decaying peak */
+static double pacing_jitter_ticks;
+static double pacing_jitter_peak_ticks;
+static unsigned long pacing_waits;
+
+static int set_precise_pacing(int val, void *param)
+{
+    precise_pacing_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
+/* Wait until `ticks' after `start_tick', without the mainlock.  */
+static void pacing_wait(tick_t start_tick, tick_t ticks)
+{
+    tick_t sleep_ticks;
+    tick_t slept_ticks;
+    tick_t late_ticks;
+    double oversleep;
+
+    if (pacing_spin_ticks < 0.0) {
+        pacing_spin_ticks = PACING_SPIN_START_TICKS;
+    }
+
+    FRAMETRACE_BEGIN(FRAMETRACE_PACING);
+    mainlock_yield_begin();
+
+    if (ticks > (tick_t)pacing_spin_ticks) {
+        sleep_ticks = ticks - (tick_t)pacing_spin_ticks;
+        tick_sleep(sleep_ticks);
+
+        slept_ticks = tick_now_delta(start_tick);
+        oversleep = slept_ticks > sleep_ticks ? (double)(slept_ticks - sleep_ticks) : 0.0;
+        if (oversleep > pacing_spin_ticks) {
+            pacing_spin_ticks += (oversleep - pacing_spin_ticks) * 0.25;
+        } else {
+            pacing_spin_ticks += (oversleep - pacing_spin_ticks) * 0.01;
+        }
+        if (pacing_spin_ticks < PACING_SPIN_MIN_TICKS) {
+            pacing_spin_ticks = PACING_SPIN_MIN_TICKS;
+        } else if (pacing_spin_ticks > PACING_SPIN_MAX_TICKS) {
+            pacing_spin_ticks = PACING_SPIN_MAX_TICKS;
+        }
+    }
+
+    while (tick_now_delta(start_tick) < ticks) {
+        /* spin for the rest */
+    }
+    late_ticks = tick_now_delta(start_tick) - ticks;
+
+    mainlock_yield_end();
+    FRAMETRACE_END(FRAMETRACE_PACING);
+
+    pacing_waits++;
+    pacing_jitter_ticks = 0.99 * pacing_jitter_ticks + 0.01 * late_ticks;
+    pacing_jitter_peak_ticks *= 0.999;
+    if (late_ticks > pacing_jitter_peak_ticks) {
+        pacing_jitter_peak_ticks = late_ticks;
+    }
+
+    metric_write_begin();
+    vsync_metric_jitter_us = (double)TICK_TO_MICRO(pacing_jitter_ticks);
+    vsync_metric_jitter_peak_us = (double)TICK_TO_MICRO(pacing_jitter_peak_ticks);
+    metric_write_end();
+}
+
 /* Vsync-related resources. */
 static const resource_int_t resources_int[] = {
     { "Speed", 100, RES_EVENT_SAME, NULL,
@@ -207,6 +465,12 @@ static const resource_int_t resources_int[] = {
     { "InitialWarpMode", 0, RES_EVENT_STRICT, (resource_value_t)0,
       /* FIXME: maybe RES_EVENT_NO */
       &initial_warp_mode_resource, set_initial_warp_mode_resource, NULL },
+    { "RunAhead", 0, RES_EVENT_NO, NULL,
+      &runahead_frames, set_runahead_frames, NULL },
+    { "PrecisePacing", 1, RES_EVENT_NO, NULL,
+      &precise_pacing_enabled, set_precise_pacing, NULL },
+    { "Deterministic", 0, RES_EVENT_NO, NULL,
+      &deterministic_enabled, set_deterministic, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -241,6 +505,21 @@ static const cmdline_option_t cmdline_options[] =
     { "+warp", CALL_FUNCTION, CMDLINE_ATTRIB_NONE,
       set_initial_warp_mode_cmdline, vice_int_to_ptr(0), NULL, NULL,
       NULL, "Do not initially enable warp mode (default)" },
+    { "-runahead", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RunAhead", NULL,
+      "<frames>", "Run the emulation ahead by up to 4 frames to reduce input lag (0: off)" },
+    { "-precisepacing", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "PrecisePacing", (resource_value_t)1,
+      NULL, "Pace the emulation by sleeping and then spinning for the last part of each wait" },
+    { "+precisepacing", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "PrecisePacing", (resource_value_t)0,
+      NULL, "Pace the emulation by sleeping only" },
+    { "-deterministic", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Deterministic", (resource_value_t)1,
+      NULL, "Run as fast as possible without depending on the host clock, so that runs can be reproduced" },
+    { "+deterministic", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "Deterministic", (resource_value_t)0,
+      NULL, "Pace the emulation by the host clock (default)" },
     CMDLINE_LIST_END
 };
 
@@ -347,6 +626,16 @@ void vsync_shutdown(void)
 {
     int i;
 
+    if (pacing_waits > 0) {
+        log_message(vsync_log,
+                    "Pacing: %lu waits, late by %.0f us on average, spinning for the last %.0f us.",
+                    pacing_waits, (double)TICK_TO_MICRO(pacing_jitter_ticks),
+                    (double)TICK_TO_MICRO(pacing_spin_ticks));
+    }
+
+    snapshot_memory_free(runahead_snapshot);
+    runahead_snapshot = NULL;
+
     for (i = 0; i < 2; i++) {
         if (callback_queues[i].queue) {
             lib_free(callback_queues[i].queue);
@@ -374,13 +663,31 @@ void vsync_reset_hook(void)
 
 void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *is_warp_enabled)
 {
-    METRIC_LOCK();
+    unsigned int seq;
+
+    do {
+        seq = metric_read_begin();
+        *cpu_percent = vsync_metric_cpu_percent;
+        *emulated_fps = vsync_metric_emulated_fps;
+    } while (metric_read_retry(seq));
 
-    *cpu_percent = vsync_metric_cpu_percent;
-    *emulated_fps = vsync_metric_emulated_fps;
     *is_warp_enabled = warp_enabled;
+}
+
+/** \brief  Get how late the emulation woke up from its waits
+ *
+ * \param[out]  jitter_us       smoothed lateness in microseconds
+ * \param[out]  jitter_peak_us  recent peak lateness in microseconds
+ */
+void vsyncarch_get_pacing_metrics(double *jitter_us, double *jitter_peak_us)
+{
+    unsigned int seq;
 
-    METRIC_UNLOCK();
+    do {
+        seq = metric_read_begin();
+        *jitter_us = vsync_metric_jitter_us;
+        *jitter_peak_us = vsync_metric_jitter_peak_us;
+    } while (metric_read_retry(seq));
 }
 
 /*
@@ -419,7 +726,7 @@ static void reset_performance_metrics(tick_t frame_tick)
     cumulative_tick_delta = 0;
     cumulative_clock_delta = 0;
 
-    METRIC_LOCK();
+    metric_write_begin();
 
     /* The final smoothing function requires that we initialise the public metrics. */
     if (timer_speed > 0) {
@@ -430,7 +737,7 @@ static void reset_performance_metrics(tick_t frame_tick)
         vsync_metric_cpu_percent  = (0.0 - timer_speed) / refresh_frequency * 100;
     }
 
-    METRIC_UNLOCK();
+    metric_write_end();
 }
 
 static void update_performance_metrics(tick_t frame_tick)
@@ -471,7 +778,7 @@ static void update_performance_metrics(tick_t frame_tick)
     frame_timespan_seconds = (double)cumulative_tick_delta / tick_per_second();
     clock_delta_seconds = (double)cumulative_clock_delta / cycles_per_sec;
 
-    METRIC_LOCK();
+    metric_write_begin();
 
     /* smooth and make public */
     vsync_metric_cpu_percent  = (MEASUREMENT_SMOOTH_FACTOR * vsync_metric_cpu_percent)  + (1.0 - MEASUREMENT_SMOOTH_FACTOR) * (clock_delta_seconds / frame_timespan_seconds * 100.0);
@@ -479,7 +786,10 @@ static void update_performance_metrics(tick_t frame_tick)
 
     /* printf("%.3f seconds - %0.3f%% cpu, %.3f fps (CLOCK delta: %u)\n", frame_timespan_seconds, vsync_metric_cpu_percent, vsync_metric_emulated_fps, clock_deltas[next_measurement_index]); fflush(stdout); */
 
-    METRIC_UNLOCK();
+    metric_write_end();
+
+    metrics_gauge_set(METRIC_SPEED_PERCENT, vsync_metric_cpu_percent);
+    metrics_gauge_set(METRIC_FRAMES_PER_SECOND, vsync_metric_emulated_fps);
 
     /* Get ready for next invoke */
     if (++next_measurement_index == MEASUREMENT_FRAME_WINDOW) {
@@ -519,8 +829,29 @@ void vsync_do_end_of_line(void)
         return;
     }
 
+    if (runahead_ahead_left || network_resimulating()) {
+        /* frames emulated ahead or again after a netplay rollback are
+           neither heard nor synchronised */
+        sound_discard();
+        return;
+    }
+
     /* deal with any accumulated sound immediately */
+    FRAMETRACE_BEGIN(FRAMETRACE_SOUND_FLUSH);
     tick_based_sync_timing = sound_flush();
+    FRAMETRACE_END(FRAMETRACE_SOUND_FLUSH);
+
+    if (deterministic_enabled) {
+        /* no waiting, and input is looked at every 2 ms of emulated time
+           instead of host time */
+        if (main_cpu_clock - last_sync_clk
+            >= (CLOCK)(cycles_per_sec / (1000000 / microseconds_between_sync))) {
+            mainlock_yield();
+            joystick();
+            last_sync_clk = main_cpu_clock;
+        }
+        return;
+    }
 
     tick_now = tick_now_after(last_sync_tick);
 
@@ -543,7 +874,7 @@ void vsync_do_end_of_line(void)
     /* is it time to consider keyboard, joystick ? */
     if (tick_delta >= tick_between_sync) {
 
-        if (warp_enabled) {
+        if (warp_enabled || offline_enabled || unpaced_enabled) {
             /* During warp we need to periodically allow the UI a chance with the mainlock */
             mainlock_yield();
         } else {
@@ -580,7 +911,13 @@ void vsync_do_end_of_line(void)
 
                 /* If we can't rely on the audio device for timing, slow down here. */
                 if (tick_based_sync_timing) {
-                    mainlock_yield_and_sleep(ticks_until_target);
+                    if (precise_pacing_enabled) {
+                        pacing_wait(tick_now, ticks_until_target);
+                    } else {
+                        FRAMETRACE_BEGIN(FRAMETRACE_PACING);
+                        mainlock_yield_and_sleep(ticks_until_target);
+                        FRAMETRACE_END(FRAMETRACE_PACING);
+                    }
                 }
             } else if ((tick_t)0 - ticks_until_target > tick_per_second()) {
                 /* We are more than a second behind, reset sync and accept that we're not running at full speed. */
@@ -631,12 +968,38 @@ bool vsync_should_skip_frame(struct video_canvas_s *canvas)
         return true;
     }
 
+    /* during run-ahead only the last frame emulated ahead is shown */
+    if (runahead_active && runahead_ahead_left != 1) {
+        return true;
+    }
+
+    /* frames emulated again after a netplay rollback have been shown */
+    if (network_resimulating()) {
+        return true;
+    }
+
+    /* nobody is watching while rendering offline */
+    if (offline_enabled) {
+        return true;
+    }
+
     /*
      * Limit rendering fps if we're in warp mode.
      * It's ugly enough for dqh to weep but makes warp faster.
      */
 
+    if (warp_enabled && deterministic_enabled) {
+        /* one frame per emulated second, the one in which it starts */
+        return maincpu_clk % (CLOCK)cycles_per_sec >= (CLOCK)cycles_per_frame;
+    }
+
     if (warp_enabled) {
+        /* a frame the display has no time for would only replace the last
+           one before it is shown, skip it until the display has caught up */
+        if (!video_canvas_ready_for_frame(canvas)) {
+            return true;
+        }
+
         if (now < canvas->warp_next_render_tick) {
             if (now < canvas->warp_next_render_tick - warp_render_tick_interval) {
                 /* next render tick is further ahead than it should be */
@@ -668,8 +1031,29 @@ void vsync_do_vsync(struct video_canvas_s *c)
     tick_t now;
     tick_t network_hook_time = 0;
 
+    FRAMETRACE_END(FRAMETRACE_FRAME);
+    FRAMETRACE_BEGIN(FRAMETRACE_FRAME);
+
+    if (runahead_ahead_left) {
+        /* rewind once the frame to be shown has been emulated */
+        if (runahead_ahead_left == 1) {
+            interrupt_maincpu_trigger_trap(runahead_restore_trap, NULL);
+        } else {
+            runahead_ahead_left--;
+        }
+        return;
+    }
+
+    if (network_resimulating()) {
+        /* let netplay emulate the next frame again */
+        vsync_hook();
+        return;
+    }
+
     monitor_vsync_hook();
 
+    init_profile_first_frame();
+
     /*
      * process everything wich should be done before the synchronisation
      * e.g. OS/2: exit the programm if trigger_shutdown set
@@ -701,6 +1085,9 @@ void vsync_do_vsync(struct video_canvas_s *c)
     now = tick_now_after(last_vsync);
     update_performance_metrics(now);
 
+    metrics_counter_add(METRIC_FRAMES, 1);
+    metrics_histogram_observe(METRIC_FRAME_TIME, TICK_TO_MICRO(now - last_vsync));
+
     vsyncarch_postsync();
 
 #ifdef VSYNC_DEBUG
@@ -713,4 +1100,16 @@ void vsync_do_vsync(struct video_canvas_s *c)
     kbdbuf_flush();
 
     last_vsync = now;
+
+    rewind_do_vsync();
+    fastpoweron_do_vsync();
+    testrunner_do_vsync();
+    benchmark_do_vsync();
+    metrics_do_vsync();
+
+    if (runahead_possible()) {
+        interrupt_maincpu_trigger_trap(runahead_save_trap, NULL);
+    } else {
+        runahead_active = 0;
+    }
 }
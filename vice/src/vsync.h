@@ -55,5 +55,7 @@ void vsync_do_vsync(struct video_canvas_s *c);
 void vsync_on_vsync_do(vsync_callback_func_t callback_func, void *callback_param);
 void vsync_set_warp_mode(int val);
 int vsync_get_warp_mode(void);
+void vsync_set_offline_mode(int val);
+void vsync_set_unpaced_mode(int val);
 
 #endif
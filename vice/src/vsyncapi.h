@@ -36,6 +36,9 @@ typedef void (*void_hook_t)(void);
 /* current performance metrics */
 void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *warp_enabled);
 
+/* how late the emulation woke up from its waits, in microseconds */
+void vsyncarch_get_pacing_metrics(double *jitter_us, double *jitter_peak_us);
+
 /* this is called before vsync_do_vsync does the synchroniation */
 void vsyncarch_presync(void);
 
@@ -96,10 +96,47 @@ static void z80core_reset(void)
 
 #define opcode_t uint32_t
 
-#define FETCH_OPCODE(o) ((o) = (LOAD(z80_reg_pc)               \
-                                | (LOAD(z80_reg_pc + 1) << 8)  \
-                                | (LOAD(z80_reg_pc + 2) << 16) \
-                                | (LOAD(z80_reg_pc + 3) << 24)))
+/* Number of bytes to fetch for an unprefixed opcode.  CB needs one operand,
+   ED up to three.  DD and FD fetch again after setting the index mode, and
+   in index mode all four bytes are fetched.  */
+static const uint8_t z80_opcode_fetch_len[0x100] = {
+    1, 3, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     /* $00-$0f */
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,     /* $10-$1f */
+    2, 3, 3, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     /* $20-$2f */
+    2, 3, 3, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,     /* $30-$3f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $40-$4f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $50-$5f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $60-$6f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $70-$7f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $80-$8f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $90-$9f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $a0-$af */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     /* $b0-$bf */
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,     /* $c0-$cf */
+    1, 1, 3, 2, 3, 1, 2, 1, 1, 1, 3, 2, 3, 1, 2, 1,     /* $d0-$df */
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 4, 2, 1,     /* $e0-$ef */
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1      /* $f0-$ff */
+};
+
+/* Only the bytes of the instruction are read, the others stay zero.  Each
+   LOAD is a call through the memory tables, and reading past the
+   instruction could also touch I/O.  */
+#define FETCH_OPCODE(o)                                                     \
+    do {                                                                    \
+        unsigned int fetch_len;                                             \
+                                                                            \
+        (o) = (opcode_t)LOAD(z80_reg_pc);                                   \
+        fetch_len = (inst_mode == INST_NONE) ? z80_opcode_fetch_len[(o)] : 4; \
+        if (fetch_len > 1) {                                                \
+            (o) |= (opcode_t)LOAD(z80_reg_pc + 1) << 8;                     \
+            if (fetch_len > 2) {                                            \
+                (o) |= (opcode_t)LOAD(z80_reg_pc + 2) << 16;                \
+                if (fetch_len > 3) {                                        \
+                    (o) |= (opcode_t)LOAD(z80_reg_pc + 3) << 24;            \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    } while (0)
 
 #define p0 (opcode & 0xff)
 #define p1 ((opcode >> 8) & 0xff)
@@ -5023,7 +5060,7 @@ fetchmore:
 
         if (maincpu_clk_limit && (CLK > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(1);
+            testrunner_cycle_limit();
         }
 
     } while (Z80_LOOP_COND);
@@ -34,11 +34,13 @@
 #include "vice.h"
 
 #include <ctype.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
@@ -83,6 +85,7 @@ enum compression_type {
    opened.  */
 struct zfile_s {
     char *tmp_name;              /* Name of the temporary file.  */
+    uint8_t *buffer;             /* Uncompressed data the stream reads from.  */
     char *orig_name;             /* Name of the original file.  */
     int write_mode;              /* Non-zero if the file is open for writing.*/
     FILE *stream;                /* Associated stdio-style stream.  */
@@ -102,6 +105,8 @@ static log_t zlog = LOG_DEFAULT;
 
 static int zinit_done = 0;
 
+static void prefetch_shutdown(void);
+
 
 /** \@brief 'Check' is file \a name is a gzip or compress file
  *
@@ -134,6 +139,7 @@ static void zfile_list_destroy(void)
 
         lib_free(p->orig_name);
         lib_free(p->tmp_name);
+        lib_free(p->buffer);
         next = p->next;
         lib_free(p);
         p = next;
@@ -169,6 +175,7 @@ static void zfile_list_add(const char *tmp_name,
 
     /* The new zfile becomes first on the list.  */
     new_zfile->tmp_name = tmp_name ? lib_strdup(tmp_name) : NULL;
+    new_zfile->buffer = NULL;
     new_zfile->write_mode = write_mode;
     new_zfile->stream = stream;
     new_zfile->fd = fd;
@@ -186,6 +193,7 @@ static void zfile_list_add(const char *tmp_name,
 void zfile_shutdown(void)
 {
     zfile_list_destroy();
+    prefetch_shutdown();
 }
 
 /* ------------------------------------------------------------------------ */
@@ -241,6 +249,96 @@ static char *try_uncompress_with_gzip(const char *name)
     return tmp_name;
 }
 
+/* Uncompress the gzip file `name' into memory.  Return the data and put its
+   size into `len', or return NULL if this fails or the data is empty.  */
+static uint8_t *inflate_gzip(const char *name, size_t *len)
+{
+    gzFile fdsrc;
+    uint8_t *buf = NULL;
+    size_t size = 0;
+    size_t num = 0;
+    int n;
+
+    fdsrc = gzopen(name, MODE_READ);
+    if (fdsrc == NULL) {
+        return NULL;
+    }
+    gzbuffer(fdsrc, 0x10000);
+
+    do {
+        if (num == size) {
+            size = size == 0 ? 0x10000 : size * 2;
+            buf = lib_realloc(buf, size);
+        }
+        n = gzread(fdsrc, buf + num, (unsigned int)(size - num));
+        if (n > 0) {
+            num += (size_t)n;
+        }
+    } while (n > 0);
+
+    gzclose(fdsrc);
+
+    if (n < 0 || num == 0) {
+        lib_free(buf);
+        return NULL;
+    }
+    *len = num;
+    return buf;
+}
+
+/* Write `len' bytes of uncompressed data to a temporary file.  Return the
+   name of the file, or NULL if this fails.  */
+static char *buffer_to_tmpfile(const uint8_t *buf, size_t len)
+{
+    FILE *fddest;
+    char *tmp_name = NULL;
+
+    fddest = archdep_mkstemp_fd(&tmp_name, MODE_WRITE);
+    if (fddest == NULL) {
+        return NULL;
+    }
+    if (fwrite(buf, 1, len, fddest) < len) {
+        fclose(fddest);
+        archdep_remove(tmp_name);
+        lib_free(tmp_name);
+        return NULL;
+    }
+    fclose(fddest);
+    return tmp_name;
+}
+
+#ifdef HAVE_FMEMOPEN
+/* If `name' has a gzip-like extension, try to uncompress it into memory.  If
+   this succeeds, return a stream reading from the uncompressed data, which
+   is returned in `buffer'; return NULL otherwise.  */
+static FILE *try_uncompress_with_gzip_to_memory(const char *name,
+                                                uint8_t **buffer)
+{
+    uint8_t *buf;
+    size_t len;
+    FILE *stream;
+
+    if (!file_is_gzip(name)) {
+        return NULL;
+    }
+
+    /* an empty buffer can't be opened on some systems, leave those to the
+       temporary file */
+    buf = inflate_gzip(name, &len);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    stream = fmemopen(buf, len, MODE_READ);
+    if (stream == NULL) {
+        lib_free(buf);
+        return NULL;
+    }
+    *buffer = buf;
+    return stream;
+}
+#endif
+
 /* If `name' has a bzip-like extension, try to uncompress it into a temporary
    file using bzip.  If this succeeds, return the name of the temporary file;
    return NULL otherwise.  */
@@ -739,6 +837,22 @@ static const valid_archives_t valid_archives[] = {
     { NULL, NULL, NULL, NULL, NULL }
 };
 
+/* Does `name' have the extension of one of the archives above?  */
+static int file_is_archive(const char *name)
+{
+    size_t l = strlen(name);
+    size_t len;
+    int i;
+
+    for (i = 0; valid_archives[i].program; i++) {
+        len = strlen(valid_archives[i].extension);
+        if (l > len && util_strcasecmp(name + l - len, valid_archives[i].extension) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /* Try to uncompress file `name' using the algorithms we know of.  If this is
    not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into a
    temporary file, return the type of algorithm used and the name of the
@@ -789,6 +903,280 @@ static enum compression_type try_uncompress(const char *name,
 
 /* ------------------------------------------------------------------------- */
 
+/* Prefetching.
+
+   zfile_prefetch() hands a file to a background thread, which uncompresses
+   it into memory if it is a plain gzip file, or reads it through once so
+   the host has it cached otherwise.  The next zfile_fopen() of a gzip file
+   takes the uncompressed data instead of inflating the file again, as long
+   as the size and modification time of the file did not change meanwhile.
+   If the thread is still busy with that file, zfile_fopen() waits for it.
+   Only the last few files asked for are kept.  */
+
+/* Number of prefetched files kept.  */
+#define PREFETCH_MAX    4
+
+typedef enum prefetch_state_e {
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE
+} prefetch_state_t;
+
+typedef struct prefetch_s {
+    char *name;                  /* Expanded name of the file.  */
+    size_t file_len;             /* Size of the file when it was asked for.  */
+    time_t mtime;                /* Modification time of the file.  */
+    uint8_t *buffer;             /* Uncompressed data, NULL if not gzip.  */
+    size_t len;                  /* Size of the uncompressed data.  */
+    prefetch_state_t state;
+    int dropped;                 /* Free it when the thread is done.  */
+    struct prefetch_s *next;     /* Next older entry.  */
+} prefetch_t;
+
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when an entry was queued */
+static pthread_cond_t prefetch_queued = PTHREAD_COND_INITIALIZER;
+/* signalled when the thread finished an entry */
+static pthread_cond_t prefetch_done = PTHREAD_COND_INITIALIZER;
+
+/* newest entry first */
+static prefetch_t *prefetch_list = NULL;
+
+static int prefetch_thread_started = 0;
+static int prefetch_thread_failed = 0;
+static pthread_t prefetch_thread;
+
+static void prefetch_free(prefetch_t *entry)
+{
+    lib_free(entry->name);
+    lib_free(entry->buffer);
+    lib_free(entry);
+}
+
+/* Unlink `entry' from the list, free it unless the thread is working on it.
+   Called with the lock held.  */
+static void prefetch_remove(prefetch_t *entry)
+{
+    prefetch_t **p;
+
+    for (p = &prefetch_list; *p != NULL; p = &(*p)->next) {
+        if (*p == entry) {
+            *p = entry->next;
+            break;
+        }
+    }
+    if (entry->state == PREFETCH_RUNNING) {
+        entry->dropped = 1;
+    } else {
+        prefetch_free(entry);
+    }
+}
+
+static prefetch_t *prefetch_find(const char *name)
+{
+    prefetch_t *entry;
+
+    for (entry = prefetch_list; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Get the oldest queued entry.  Called with the lock held.  */
+static prefetch_t *prefetch_next_queued(void)
+{
+    prefetch_t *entry, *found = NULL;
+
+    for (entry = prefetch_list; entry != NULL; entry = entry->next) {
+        if (entry->state == PREFETCH_QUEUED) {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+static void *prefetch_thread_main(void *unused)
+{
+    prefetch_t *entry;
+    char *name;
+    uint8_t *buffer;
+    size_t len = 0;
+
+    pthread_mutex_lock(&prefetch_lock);
+    while (1) {
+        while ((entry = prefetch_next_queued()) == NULL) {
+            pthread_cond_wait(&prefetch_queued, &prefetch_lock);
+        }
+        entry->state = PREFETCH_RUNNING;
+        name = lib_strdup(entry->name);
+        pthread_mutex_unlock(&prefetch_lock);
+
+        buffer = NULL;
+        if (file_is_gzip(name) && !file_is_archive(name)) {
+            buffer = inflate_gzip(name, &len);
+        } else {
+            FILE *fd = fopen(name, MODE_READ);
+
+            if (fd != NULL) {
+                char buf[0x4000];
+
+                while (fread(buf, 1, sizeof(buf), fd) == sizeof(buf)) {
+                }
+                fclose(fd);
+            }
+        }
+        lib_free(name);
+
+        pthread_mutex_lock(&prefetch_lock);
+        if (entry->dropped) {
+            lib_free(buffer);
+            prefetch_free(entry);
+        } else {
+            entry->buffer = buffer;
+            entry->len = len;
+            entry->state = PREFETCH_DONE;
+        }
+        pthread_cond_broadcast(&prefetch_done);
+    }
+
+    return NULL;
+}
+
+static int prefetch_start_thread(void)
+{
+    if (!prefetch_thread_started && !prefetch_thread_failed) {
+        if (pthread_create(&prefetch_thread, NULL, prefetch_thread_main, NULL)) {
+            log_error(zlog, "Cannot start prefetch thread, not prefetching.");
+            prefetch_thread_failed = 1;
+        } else {
+            pthread_detach(prefetch_thread);
+            prefetch_thread_started = 1;
+        }
+    }
+    return prefetch_thread_started;
+}
+
+/* Take the prefetched uncompressed data of `name', waiting for the thread
+   if it is working on it.  Return NULL if there is none.  */
+static uint8_t *prefetch_take(const char *name, size_t *len)
+{
+    prefetch_t *entry;
+    char *fullname = NULL;
+    uint8_t *buffer = NULL;
+    size_t file_len;
+    time_t mtime;
+
+    if (archdep_expand_path(&fullname, name) != 0) {
+        lib_free(fullname);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&prefetch_lock);
+
+    entry = prefetch_find(fullname);
+    while (entry != NULL && entry->state == PREFETCH_RUNNING) {
+        pthread_cond_wait(&prefetch_done, &prefetch_lock);
+        entry = prefetch_find(fullname);
+    }
+
+    if (entry != NULL) {
+        if (entry->buffer != NULL
+            && archdep_stat_mtime(fullname, &file_len, &mtime) == 0
+            && file_len == entry->file_len
+            && mtime == entry->mtime) {
+            buffer = entry->buffer;
+            *len = entry->len;
+            entry->buffer = NULL;
+        }
+        /* a later open has to read the file again, it may be written to */
+        prefetch_remove(entry);
+    }
+
+    pthread_mutex_unlock(&prefetch_lock);
+
+    lib_free(fullname);
+    return buffer;
+}
+
+/** \brief  Read a file in the background, to open it faster later
+ *
+ * Gzip files are uncompressed into memory, other files are read so the host
+ * caches them.  Does nothing if the file is prefetched already.
+ *
+ * \param[in]   name    file name
+ */
+void zfile_prefetch(const char *name)
+{
+    prefetch_t *entry, *p;
+    char *fullname = NULL;
+    size_t file_len;
+    time_t mtime;
+    int count;
+
+    if (!zinit_done) {
+        zinit();
+    }
+
+    if (name == NULL || *name == '\0'
+        || archdep_expand_path(&fullname, name) != 0
+        || archdep_stat_mtime(fullname, &file_len, &mtime) != 0) {
+        lib_free(fullname);
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch_lock);
+
+    if (!prefetch_start_thread()) {
+        pthread_mutex_unlock(&prefetch_lock);
+        lib_free(fullname);
+        return;
+    }
+
+    entry = prefetch_find(fullname);
+    if (entry != NULL) {
+        if (entry->file_len == file_len && entry->mtime == mtime) {
+            pthread_mutex_unlock(&prefetch_lock);
+            lib_free(fullname);
+            return;
+        }
+        prefetch_remove(entry);
+    }
+
+    entry = lib_calloc(1, sizeof(prefetch_t));
+    entry->name = fullname;
+    entry->file_len = file_len;
+    entry->mtime = mtime;
+    entry->state = PREFETCH_QUEUED;
+    entry->next = prefetch_list;
+    prefetch_list = entry;
+
+    /* drop the oldest entries */
+    for (p = prefetch_list, count = 1; p->next != NULL; count++) {
+        if (count >= PREFETCH_MAX) {
+            prefetch_remove(p->next);
+        } else {
+            p = p->next;
+        }
+    }
+
+    pthread_cond_signal(&prefetch_queued);
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+/* Drop all prefetched files.  */
+static void prefetch_shutdown(void)
+{
+    pthread_mutex_lock(&prefetch_lock);
+    while (prefetch_list != NULL) {
+        prefetch_remove(prefetch_list);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* Compression.  */
 
 /* Compress `src' into `dest' using gzip.  */
@@ -991,7 +1379,52 @@ FILE *zfile_fopen(const char *name, const char *mode)
         return NULL;
     }
 
-    type = try_uncompress(name, &tmp_name, write_mode);
+    /* Use the data of a gzip file uncompressed by zfile_prefetch().  */
+    tmp_name = NULL;
+    type = COMPR_NONE;
+    if (file_is_gzip(name) && !file_is_archive(name)) {
+        uint8_t *buffer;
+        size_t len;
+
+        buffer = prefetch_take(name, &len);
+        if (buffer != NULL) {
+#ifdef HAVE_FMEMOPEN
+            if (!write_mode) {
+                stream = fmemopen(buffer, len, MODE_READ);
+                if (stream != NULL) {
+                    zfile_list_add(NULL, name, COMPR_GZIP, write_mode, stream, NULL);
+                    zfile_list->buffer = buffer;
+                    return stream;
+                }
+            }
+#endif
+            tmp_name = buffer_to_tmpfile(buffer, len);
+            if (tmp_name != NULL) {
+                type = COMPR_GZIP;
+            }
+            lib_free(buffer);
+        }
+    }
+
+#ifdef HAVE_FMEMOPEN
+    /* Files only read from don't need a temporary file, uncompress them
+       into memory.  Archives are tried first, like try_uncompress() does,
+       so .tar.gz is not taken for a plain gzip file.  */
+    if (type == COMPR_NONE && !write_mode && !file_is_archive(name)) {
+        uint8_t *buffer = NULL;
+
+        stream = try_uncompress_with_gzip_to_memory(name, &buffer);
+        if (stream != NULL) {
+            zfile_list_add(NULL, name, COMPR_GZIP, write_mode, stream, NULL);
+            zfile_list->buffer = buffer;
+            return stream;
+        }
+    }
+#endif
+
+    if (type == COMPR_NONE) {
+        type = try_uncompress(name, &tmp_name, write_mode);
+    }
     if (type == COMPR_NONE) {
         stream = fopen(name, mode);
         if (stream == NULL) {
@@ -1083,6 +1516,9 @@ static int handle_close(zfile_t *ptr)
     if (ptr->tmp_name) {
         lib_free(ptr->tmp_name);
     }
+    if (ptr->buffer) {
+        lib_free(ptr->buffer);
+    }
     if (ptr->request_string) {
         lib_free(ptr->request_string);
     }